@@ -11,6 +11,11 @@
 #include <linux/module.h>
 #include <linux/slab.h>
 #include <linux/init.h>
+#include <linux/sched.h>
+#include <linux/ktime.h>
+
+/* Batch this many foreground requests ahead of each sync batch */
+#define DEFAULT_FG_RATIO	(16)
 
 /* Batch this many synchronous requests at a time */
 #define	DEFAULT_SYNC_RATIO	(8)
@@ -18,11 +23,31 @@
 /* Run each batch this many times*/
 #define DEFAULT_BATCH_COUNT	(4)
 
+/*
+ * Queue wait histogram: bucket 0 is below 1ms, bucket i covers
+ * [2^(i-1), 2^i) ms and the last one everything slower.
+ */
+#define ANXIETY_LAT_BUCKETS	(8)
+
+enum {
+	ANXIETY_FG,
+	ANXIETY_SYNC,
+	ANXIETY_ASYNC,
+	ANXIETY_NR_QUEUES,
+};
+
+static const char *anxiety_queue_names[ANXIETY_NR_QUEUES] = {
+	"fg", "sync", "async",
+};
+
 struct anxiety_data {
-	struct list_head sync_queue;
-	struct list_head async_queue;
+	struct list_head queue[ANXIETY_NR_QUEUES];
+
+	/* Statistics, updated under the queue lock */
+	u32 lat_hist[ANXIETY_NR_QUEUES][ANXIETY_LAT_BUCKETS];
 
 	/* Tunables */
+	uint8_t fg_ratio;
 	uint8_t sync_ratio;
 	uint8_t batch_count;
 };
@@ -39,12 +64,33 @@ static void anxiety_merged_requests(struct request_queue *q, struct request *rq,
 	list_del_init(&next->queuelist);
 }
 
-static inline int __anxiety_dispatch(struct request_queue *q,
+static void anxiety_account_latency(struct anxiety_data *adata, int type,
 		struct request *rq)
 {
-	if (unlikely(!rq))
+	u64 now = ktime_get_ns();
+	unsigned int bucket = 0;
+	u64 wait_ms;
+
+	if (now > rq->fifo_time) {
+		wait_ms = div_u64(now - rq->fifo_time, NSEC_PER_MSEC);
+		bucket = min_t(unsigned int, fls64(wait_ms),
+			       ANXIETY_LAT_BUCKETS - 1);
+	}
+
+	adata->lat_hist[type][bucket]++;
+}
+
+static inline int __anxiety_dispatch(struct request_queue *q, int type)
+{
+	struct anxiety_data *adata = q->elevator->elevator_data;
+	struct request *rq;
+
+	if (list_empty(&adata->queue[type]))
 		return -EINVAL;
 
+	rq = anxiety_next_entry(&adata->queue[type]);
+	anxiety_account_latency(adata, type, rq);
+
 	list_del_init(&rq->queuelist);
 	elv_dispatch_add_tail(q, rq);
 
@@ -60,26 +106,31 @@ static uint16_t anxiety_dispatch_batch(struct request_queue *q)
 
 	/* Perform each batch adata->batch_count many times */
 	for (i = 0; i < adata->batch_count; i++) {
+		/*
+		 * Foreground requests get their own share ahead of sync;
+		 * keep draining leftovers one at a time if it was set to 0.
+		 */
+		for (j = 0; j < max_t(uint8_t, adata->fg_ratio, 1); j++) {
+			ret = __anxiety_dispatch(q, ANXIETY_FG);
+			if (ret)
+				break;
+
+			dispatched++;
+		}
+
 		/* Batch sync requests according to tunables */
 		for (j = 0; j < adata->sync_ratio; j++) {
-			if (list_empty(&adata->sync_queue))
+			ret = __anxiety_dispatch(q, ANXIETY_SYNC);
+			if (ret)
 				break;
 
-			ret = __anxiety_dispatch(q,
-				anxiety_next_entry(&adata->sync_queue));
-
-			if (!ret)
-				dispatched++;
+			dispatched++;
 		}
 
 		/* Submit one async request after the sync batch to avoid starvation */
-		if (!list_empty(&adata->async_queue)) {
-			ret = __anxiety_dispatch(q,
-				anxiety_next_entry(&adata->async_queue));
-
-			if (!ret)
-				dispatched++;
-		}
+		ret = __anxiety_dispatch(q, ANXIETY_ASYNC);
+		if (!ret)
+			dispatched++;
 
 		/* If we didn't have anything to dispatch; don't batch again */
 		if (!dispatched)
@@ -91,29 +142,16 @@ static uint16_t anxiety_dispatch_batch(struct request_queue *q)
 
 static uint16_t anxiety_dispatch_drain(struct request_queue *q)
 {
-	struct anxiety_data *adata = q->elevator->elevator_data;
 	uint16_t dispatched = 0;
-	int ret;
+	int type;
 
 	/*
-	 * Drain out all of the synchronous requests first,
-	 * then drain the asynchronous requests.
+	 * Drain out the foreground requests first, then the
+	 * synchronous and finally the asynchronous requests.
 	 */
-	while (!list_empty(&adata->sync_queue)) {
-		ret = __anxiety_dispatch(q,
-			anxiety_next_entry(&adata->sync_queue));
-
-		if (!ret)
+	for (type = 0; type < ANXIETY_NR_QUEUES; type++)
+		while (!__anxiety_dispatch(q, type))
 			dispatched++;
-	}
-
-	while (!list_empty(&adata->async_queue)) {
-		ret = __anxiety_dispatch(q,
-			anxiety_next_entry(&adata->async_queue));
-
-		if (!ret)
-			dispatched++;
-	}
 
 	return dispatched;
 }
@@ -130,12 +168,30 @@ static int anxiety_dispatch(struct request_queue *q, int force)
 	return anxiety_dispatch_batch(q);
 }
 
+/*
+ * Requests are inserted from the context of the submitting task, so sync
+ * requests issued by the top-app cgroup are the ones an app launch or a
+ * foreground activity waits for.
+ */
+static inline int anxiety_request_type(struct anxiety_data *adata,
+		struct request *rq)
+{
+	if (!rq_is_sync(rq))
+		return ANXIETY_ASYNC;
+
+	if (adata->fg_ratio && schedtune_task_top_app(current))
+		return ANXIETY_FG;
+
+	return ANXIETY_SYNC;
+}
+
 static void anxiety_add_request(struct request_queue *q, struct request *rq)
 {
 	struct anxiety_data *adata = q->elevator->elevator_data;
 
+	rq->fifo_time = ktime_get_ns();
 	list_add_tail(&rq->queuelist,
-		rq_is_sync(rq) ? &adata->sync_queue : &adata->async_queue);
+		&adata->queue[anxiety_request_type(adata, rq)]);
 }
 
 static int anxiety_init_queue(struct request_queue *q,
@@ -143,12 +199,13 @@ static int anxiety_init_queue(struct request_queue *q,
 {
 	struct anxiety_data *adata;
 	struct elevator_queue *eq = elevator_alloc(q, elv);
+	int type;
 
 	if (!eq)
 		return -ENOMEM;
 
 	/* Allocate the data */
-	adata = kmalloc_node(sizeof(*adata), GFP_KERNEL, q->node);
+	adata = kzalloc_node(sizeof(*adata), GFP_KERNEL, q->node);
 	if (!adata) {
 		kobject_put(&eq->kobj);
 		return -ENOMEM;
@@ -158,8 +215,9 @@ static int anxiety_init_queue(struct request_queue *q,
 	eq->elevator_data = adata;
 
 	/* Initialize */
-	INIT_LIST_HEAD(&adata->sync_queue);
-	INIT_LIST_HEAD(&adata->async_queue);
+	for (type = 0; type < ANXIETY_NR_QUEUES; type++)
+		INIT_LIST_HEAD(&adata->queue[type]);
+	adata->fg_ratio = DEFAULT_FG_RATIO;
 	adata->sync_ratio = DEFAULT_SYNC_RATIO;
 	adata->batch_count = DEFAULT_BATCH_COUNT;
 
@@ -172,6 +230,27 @@ static int anxiety_init_queue(struct request_queue *q,
 }
 
 /* Sysfs access */
+static ssize_t anxiety_fg_ratio_show(struct elevator_queue *e, char *page)
+{
+	struct anxiety_data *adata = e->elevator_data;
+
+	return snprintf(page, PAGE_SIZE, "%u\n", adata->fg_ratio);
+}
+
+static ssize_t anxiety_fg_ratio_store(struct elevator_queue *e,
+		const char *page, size_t count)
+{
+	struct anxiety_data *adata = e->elevator_data;
+	int ret;
+
+	/* 0 queues foreground requests with the other sync requests */
+	ret = kstrtou8(page, 0, &adata->fg_ratio);
+	if (ret < 0)
+		return ret;
+
+	return count;
+}
+
 static ssize_t anxiety_sync_ratio_show(struct elevator_queue *e, char *page)
 {
 	struct anxiety_data *adata = e->elevator_data;
@@ -215,11 +294,50 @@ static ssize_t anxiety_batch_count_store(struct elevator_queue *e,
 	return count;
 }
 
+static ssize_t anxiety_latency_hist_show(struct elevator_queue *e, char *page)
+{
+	struct anxiety_data *adata = e->elevator_data;
+	ssize_t len = 0;
+	int type, i;
+
+	len += snprintf(page + len, PAGE_SIZE - len, "ms");
+	for (i = 0; i < ANXIETY_LAT_BUCKETS - 1; i++)
+		len += snprintf(page + len, PAGE_SIZE - len, " <%u", 1U << i);
+	len += snprintf(page + len, PAGE_SIZE - len, " >=%u\n",
+			1U << (ANXIETY_LAT_BUCKETS - 2));
+
+	for (type = 0; type < ANXIETY_NR_QUEUES; type++) {
+		len += snprintf(page + len, PAGE_SIZE - len, "%s",
+				anxiety_queue_names[type]);
+		for (i = 0; i < ANXIETY_LAT_BUCKETS; i++)
+			len += snprintf(page + len, PAGE_SIZE - len, " %u",
+					adata->lat_hist[type][i]);
+		len += snprintf(page + len, PAGE_SIZE - len, "\n");
+	}
+
+	return len;
+}
+
+/* Any write clears the histogram */
+static ssize_t anxiety_latency_hist_store(struct elevator_queue *e,
+		const char *page, size_t count)
+{
+	struct anxiety_data *adata = e->elevator_data;
+
+	memset(adata->lat_hist, 0, sizeof(adata->lat_hist));
+
+	return count;
+}
+
 static struct elv_fs_entry anxiety_attrs[] = {
+	__ATTR(fg_ratio, 0644, anxiety_fg_ratio_show,
+		anxiety_fg_ratio_store),
 	__ATTR(sync_ratio, 0644, anxiety_sync_ratio_show,
 		anxiety_sync_ratio_store),
 	__ATTR(batch_count, 0644, anxiety_batch_count_show,
 		anxiety_batch_count_store),
+	__ATTR(latency_hist, 0644, anxiety_latency_hist_show,
+		anxiety_latency_hist_store),
 	__ATTR_NULL
 };
 
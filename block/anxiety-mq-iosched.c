@@ -0,0 +1,484 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Anxiety I/O Scheduler - adaptation of the legacy anxiety scheduler
+ * for the blk-mq scheduling framework
+ *
+ * Copyright (c) 2020, Tyler Nijmeh <tylernij@gmail.com>
+ */
+
+#include <linux/kernel.h>
+#include <linux/blkdev.h>
+#include <linux/blk-mq.h>
+#include <linux/elevator.h>
+#include <linux/bio.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/init.h>
+#include <linux/sched.h>
+#include <linux/ktime.h>
+
+#include "blk.h"
+#include "blk-mq.h"
+#include "blk-mq-sched.h"
+
+/* Dispatch this many foreground requests ahead of each sync batch */
+#define DEFAULT_FG_RATIO	(16)
+
+/* Batch this many synchronous requests at a time */
+#define	DEFAULT_SYNC_RATIO	(8)
+
+/* Look this far back in a list for a merge candidate */
+#define ANXIETY_MERGE_DEPTH	(8)
+
+/*
+ * Queue wait histogram: bucket 0 is below 1ms, bucket i covers
+ * [2^(i-1), 2^i) ms and the last one everything slower.
+ */
+#define ANXIETY_LAT_BUCKETS	(8)
+
+enum {
+	ANXIETY_FG,
+	ANXIETY_SYNC,
+	ANXIETY_ASYNC,
+	ANXIETY_NR_QUEUES,
+};
+
+static const char *anxiety_queue_names[ANXIETY_NR_QUEUES] = {
+	"fg", "sync", "async",
+};
+
+struct anxiety_data {
+	struct request_queue *q;
+
+	/* Tunables */
+	uint8_t fg_ratio;
+	uint8_t sync_ratio;
+};
+
+/*
+ * Every hardware queue keeps its own lists, so submitters on different
+ * CPUs mapped to different hardware queues never share a lock.
+ */
+struct anxiety_hctx_data {
+	spinlock_t lock;
+
+	/* Requeued, flush and passthrough requests bypass the ratios */
+	struct list_head dispatch;
+	struct list_head queue[ANXIETY_NR_QUEUES];
+
+	/* Requests left in the current batch round */
+	unsigned int fg_left;
+	unsigned int sync_left;
+
+	/* Statistics, updated under lock */
+	u32 lat_hist[ANXIETY_NR_QUEUES][ANXIETY_LAT_BUCKETS];
+};
+
+static inline int anxiety_rq_type(struct request *rq)
+{
+	return (long)rq->elv.priv[0];
+}
+
+/*
+ * prepare_request runs in the context of the submitting task, so sync
+ * requests of the top-app cgroup are the ones a foreground app waits for.
+ */
+static void anxiety_prepare_request(struct request *rq, struct bio *bio)
+{
+	struct anxiety_data *adata = rq->q->elevator->elevator_data;
+	long type = ANXIETY_ASYNC;
+
+	if (op_is_sync(rq->cmd_flags)) {
+		if (adata->fg_ratio && schedtune_task_top_app(current))
+			type = ANXIETY_FG;
+		else
+			type = ANXIETY_SYNC;
+	}
+
+	rq->elv.priv[0] = (void *)type;
+}
+
+static void anxiety_account_latency(struct anxiety_hctx_data *ahd, int type,
+		struct request *rq)
+{
+	u64 now = ktime_get_ns();
+	unsigned int bucket = 0;
+	u64 wait_ms;
+
+	if (now > rq->fifo_time) {
+		wait_ms = div_u64(now - rq->fifo_time, NSEC_PER_MSEC);
+		bucket = min_t(unsigned int, fls64(wait_ms),
+			       ANXIETY_LAT_BUCKETS - 1);
+	}
+
+	ahd->lat_hist[type][bucket]++;
+}
+
+static struct request *anxiety_pop(struct anxiety_hctx_data *ahd, int type)
+{
+	struct request *rq;
+
+	if (list_empty(&ahd->queue[type]))
+		return NULL;
+
+	rq = list_first_entry(&ahd->queue[type], struct request, queuelist);
+	list_del_init(&rq->queuelist);
+	anxiety_account_latency(ahd, type, rq);
+
+	return rq;
+}
+
+/*
+ * blk-mq pulls one request at a time, so the legacy batch loop becomes
+ * a per hardware queue round: up to fg_ratio foreground requests, then
+ * up to sync_ratio sync requests, then one async request to avoid
+ * starvation before the round starts over.
+ */
+static struct request *__anxiety_dispatch(struct anxiety_data *adata,
+		struct anxiety_hctx_data *ahd)
+{
+	struct request *rq;
+	int pass;
+
+	if (!list_empty(&ahd->dispatch)) {
+		rq = list_first_entry(&ahd->dispatch, struct request,
+				      queuelist);
+		list_del_init(&rq->queuelist);
+		return rq;
+	}
+
+	for (pass = 0; pass < 2; pass++) {
+		if (ahd->fg_left) {
+			rq = anxiety_pop(ahd, ANXIETY_FG);
+			if (rq) {
+				ahd->fg_left--;
+				return rq;
+			}
+		}
+
+		if (ahd->sync_left) {
+			rq = anxiety_pop(ahd, ANXIETY_SYNC);
+			if (rq) {
+				ahd->sync_left--;
+				return rq;
+			}
+		}
+
+		/*
+		 * Keep draining foreground leftovers one per round even
+		 * when fg_ratio was set to 0.
+		 */
+		ahd->fg_left = max_t(unsigned int, adata->fg_ratio, 1);
+		ahd->sync_left = adata->sync_ratio;
+
+		rq = anxiety_pop(ahd, ANXIETY_ASYNC);
+		if (rq)
+			return rq;
+	}
+
+	return NULL;
+}
+
+static struct request *anxiety_dispatch_request(struct blk_mq_hw_ctx *hctx)
+{
+	struct anxiety_data *adata = hctx->queue->elevator->elevator_data;
+	struct anxiety_hctx_data *ahd = hctx->sched_data;
+	struct request *rq;
+
+	spin_lock(&ahd->lock);
+	rq = __anxiety_dispatch(adata, ahd);
+	spin_unlock(&ahd->lock);
+
+	return rq;
+}
+
+static bool anxiety_bio_merge(struct blk_mq_hw_ctx *hctx, struct bio *bio)
+{
+	struct request_queue *q = hctx->queue;
+	struct anxiety_hctx_data *ahd = hctx->sched_data;
+	struct request *rq;
+	bool merged = false;
+	int checked, type;
+
+	spin_lock(&ahd->lock);
+	for (type = 0; type < ANXIETY_NR_QUEUES && !merged; type++) {
+		checked = ANXIETY_MERGE_DEPTH;
+		list_for_each_entry_reverse(rq, &ahd->queue[type], queuelist) {
+			if (!checked--)
+				break;
+
+			if (!blk_rq_merge_ok(rq, bio))
+				continue;
+
+			switch (blk_try_merge(rq, bio)) {
+			case ELEVATOR_BACK_MERGE:
+				merged = bio_attempt_back_merge(q, rq, bio);
+				break;
+			case ELEVATOR_FRONT_MERGE:
+				merged = bio_attempt_front_merge(q, rq, bio);
+				break;
+			case ELEVATOR_DISCARD_MERGE:
+				merged = bio_attempt_discard_merge(q, rq, bio);
+				break;
+			default:
+				continue;
+			}
+			break;
+		}
+	}
+	spin_unlock(&ahd->lock);
+
+	return merged;
+}
+
+static void anxiety_insert_requests(struct blk_mq_hw_ctx *hctx,
+		struct list_head *list, bool at_head)
+{
+	struct anxiety_hctx_data *ahd = hctx->sched_data;
+	u64 now = ktime_get_ns();
+
+	spin_lock(&ahd->lock);
+	while (!list_empty(list)) {
+		struct request *rq;
+
+		rq = list_first_entry(list, struct request, queuelist);
+		list_del_init(&rq->queuelist);
+
+		blk_mq_sched_request_inserted(rq);
+
+		if (at_head || blk_rq_is_passthrough(rq) ||
+		    !(rq->rq_flags & RQF_ELVPRIV)) {
+			if (at_head)
+				list_add(&rq->queuelist, &ahd->dispatch);
+			else
+				list_add_tail(&rq->queuelist, &ahd->dispatch);
+			continue;
+		}
+
+		rq->fifo_time = now;
+		list_add_tail(&rq->queuelist,
+			      &ahd->queue[anxiety_rq_type(rq)]);
+	}
+	spin_unlock(&ahd->lock);
+}
+
+static bool anxiety_has_work(struct blk_mq_hw_ctx *hctx)
+{
+	struct anxiety_hctx_data *ahd = hctx->sched_data;
+	int type;
+
+	if (!list_empty_careful(&ahd->dispatch))
+		return true;
+
+	for (type = 0; type < ANXIETY_NR_QUEUES; type++)
+		if (!list_empty_careful(&ahd->queue[type]))
+			return true;
+
+	return false;
+}
+
+static int anxiety_init_hctx(struct blk_mq_hw_ctx *hctx, unsigned int hctx_idx)
+{
+	struct anxiety_data *adata = hctx->queue->elevator->elevator_data;
+	struct anxiety_hctx_data *ahd;
+	int type;
+
+	ahd = kzalloc_node(sizeof(*ahd), GFP_KERNEL, hctx->numa_node);
+	if (!ahd)
+		return -ENOMEM;
+
+	spin_lock_init(&ahd->lock);
+	INIT_LIST_HEAD(&ahd->dispatch);
+	for (type = 0; type < ANXIETY_NR_QUEUES; type++)
+		INIT_LIST_HEAD(&ahd->queue[type]);
+	ahd->fg_left = adata->fg_ratio;
+	ahd->sync_left = adata->sync_ratio;
+
+	hctx->sched_data = ahd;
+
+	return 0;
+}
+
+static void anxiety_exit_hctx(struct blk_mq_hw_ctx *hctx, unsigned int hctx_idx)
+{
+	kfree(hctx->sched_data);
+}
+
+static int anxiety_init_queue(struct request_queue *q,
+		struct elevator_type *elv)
+{
+	struct anxiety_data *adata;
+	struct elevator_queue *eq = elevator_alloc(q, elv);
+
+	if (!eq)
+		return -ENOMEM;
+
+	/* Allocate the data */
+	adata = kzalloc_node(sizeof(*adata), GFP_KERNEL, q->node);
+	if (!adata) {
+		kobject_put(&eq->kobj);
+		return -ENOMEM;
+	}
+
+	/* Set the elevator data */
+	eq->elevator_data = adata;
+
+	/* Initialize */
+	adata->q = q;
+	adata->fg_ratio = DEFAULT_FG_RATIO;
+	adata->sync_ratio = DEFAULT_SYNC_RATIO;
+
+	q->elevator = eq;
+
+	return 0;
+}
+
+static void anxiety_exit_queue(struct elevator_queue *e)
+{
+	kfree(e->elevator_data);
+}
+
+/* Sysfs access */
+static ssize_t anxiety_fg_ratio_show(struct elevator_queue *e, char *page)
+{
+	struct anxiety_data *adata = e->elevator_data;
+
+	return snprintf(page, PAGE_SIZE, "%u\n", adata->fg_ratio);
+}
+
+static ssize_t anxiety_fg_ratio_store(struct elevator_queue *e,
+		const char *page, size_t count)
+{
+	struct anxiety_data *adata = e->elevator_data;
+	int ret;
+
+	/* 0 queues foreground requests with the other sync requests */
+	ret = kstrtou8(page, 0, &adata->fg_ratio);
+	if (ret < 0)
+		return ret;
+
+	return count;
+}
+
+static ssize_t anxiety_sync_ratio_show(struct elevator_queue *e, char *page)
+{
+	struct anxiety_data *adata = e->elevator_data;
+
+	return snprintf(page, PAGE_SIZE, "%u\n", adata->sync_ratio);
+}
+
+static ssize_t anxiety_sync_ratio_store(struct elevator_queue *e,
+		const char *page, size_t count)
+{
+	struct anxiety_data *adata = e->elevator_data;
+	int ret;
+
+	ret = kstrtou8(page, 0, &adata->sync_ratio);
+	if (ret < 0)
+		return ret;
+
+	return count;
+}
+
+/* Sum of the histograms of all hardware queues */
+static ssize_t anxiety_latency_hist_show(struct elevator_queue *e, char *page)
+{
+	struct anxiety_data *adata = e->elevator_data;
+	struct blk_mq_hw_ctx *hctx;
+	ssize_t len = 0;
+	unsigned int i;
+	int type, b;
+
+	len += snprintf(page + len, PAGE_SIZE - len, "ms");
+	for (b = 0; b < ANXIETY_LAT_BUCKETS - 1; b++)
+		len += snprintf(page + len, PAGE_SIZE - len, " <%u", 1U << b);
+	len += snprintf(page + len, PAGE_SIZE - len, " >=%u\n",
+			1U << (ANXIETY_LAT_BUCKETS - 2));
+
+	for (type = 0; type < ANXIETY_NR_QUEUES; type++) {
+		len += snprintf(page + len, PAGE_SIZE - len, "%s",
+				anxiety_queue_names[type]);
+		for (b = 0; b < ANXIETY_LAT_BUCKETS; b++) {
+			u64 sum = 0;
+
+			queue_for_each_hw_ctx(adata->q, hctx, i) {
+				struct anxiety_hctx_data *ahd = hctx->sched_data;
+
+				if (ahd)
+					sum += ahd->lat_hist[type][b];
+			}
+			len += snprintf(page + len, PAGE_SIZE - len, " %llu",
+					sum);
+		}
+		len += snprintf(page + len, PAGE_SIZE - len, "\n");
+	}
+
+	return len;
+}
+
+/* Any write clears the histograms */
+static ssize_t anxiety_latency_hist_store(struct elevator_queue *e,
+		const char *page, size_t count)
+{
+	struct anxiety_data *adata = e->elevator_data;
+	struct blk_mq_hw_ctx *hctx;
+	unsigned int i;
+
+	queue_for_each_hw_ctx(adata->q, hctx, i) {
+		struct anxiety_hctx_data *ahd = hctx->sched_data;
+
+		if (!ahd)
+			continue;
+
+		spin_lock(&ahd->lock);
+		memset(ahd->lat_hist, 0, sizeof(ahd->lat_hist));
+		spin_unlock(&ahd->lock);
+	}
+
+	return count;
+}
+
+static struct elv_fs_entry anxiety_attrs[] = {
+	__ATTR(fg_ratio, 0644, anxiety_fg_ratio_show,
+		anxiety_fg_ratio_store),
+	__ATTR(sync_ratio, 0644, anxiety_sync_ratio_show,
+		anxiety_sync_ratio_store),
+	__ATTR(latency_hist, 0644, anxiety_latency_hist_show,
+		anxiety_latency_hist_store),
+	__ATTR_NULL
+};
+
+static struct elevator_type elevator_anxiety_mq = {
+	.ops.mq = {
+		.init_sched		= anxiety_init_queue,
+		.exit_sched		= anxiety_exit_queue,
+		.init_hctx		= anxiety_init_hctx,
+		.exit_hctx		= anxiety_exit_hctx,
+		.prepare_request	= anxiety_prepare_request,
+		.bio_merge		= anxiety_bio_merge,
+		.insert_requests	= anxiety_insert_requests,
+		.dispatch_request	= anxiety_dispatch_request,
+		.has_work		= anxiety_has_work,
+	},
+	.uses_mq = true,
+	.elevator_name = "anxiety-mq",
+	.elevator_attrs = anxiety_attrs,
+	.elevator_owner = THIS_MODULE,
+};
+
+static int __init anxiety_mq_init(void)
+{
+	return elv_register(&elevator_anxiety_mq);
+}
+
+static void __exit anxiety_mq_exit(void)
+{
+	elv_unregister(&elevator_anxiety_mq);
+}
+
+module_init(anxiety_mq_init);
+module_exit(anxiety_mq_exit);
+
+MODULE_AUTHOR("Tyler Nijmeh");
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("Anxiety MQ I/O scheduler");
@@ -35,6 +35,14 @@ module_param(num_prealloc_fallback_crypt_ctxs, uint, 0);
 MODULE_PARM_DESC(num_prealloc_crypt_fallback_ctxs,
 		 "Number of preallocated bio fallback crypto contexts for blk-crypto to use during crypto API fallback");
 
+static unsigned int decrypt_split_kb = 64;
+module_param(decrypt_split_kb, uint, 0644);
+MODULE_PARM_DESC(decrypt_split_kb,
+		 "Decrypt reads larger than this many KiB on several CPUs (0 to disable)");
+
+/* Upper bound on the number of works a read is decrypted by */
+#define BLK_CRYPTO_MAX_DECRYPT_PARTS 8
+
 struct bio_fallback_crypt_ctx {
 	struct bio_crypt_ctx crypt_ctx;
 	/*
@@ -45,6 +53,8 @@ struct bio_fallback_crypt_ctx {
 	 */
 	struct bvec_iter crypt_iter;
 	u64 fallback_dun[BLK_CRYPTO_DUN_ARRAY_SIZE];
+	/* Decrypt works still running on this bio */
+	atomic_t parts_pending;
 };
 
 /* The following few vars are only used during the crypto API fallback */
@@ -66,6 +76,9 @@ static bool tfms_inited[BLK_ENCRYPTION_MODE_MAX];
 struct blk_crypto_decrypt_work {
 	struct work_struct work;
 	struct bio *bio;
+	/* Part of the bio to decrypt, and the DUN of its first data unit */
+	struct bvec_iter iter;
+	u64 dun[BLK_CRYPTO_DUN_ARRAY_SIZE];
 };
 
 static struct blk_crypto_keyslot {
@@ -389,49 +402,34 @@ static void blk_crypto_free_fallback_crypt_ctx(struct bio *bio)
 }
 
 /*
- * The crypto API fallback's main decryption routine.
- * Decrypts input bio in place.
+ * Decrypt the data units of a bio described by @iter, starting with @dun.
+ * Several of these may run on one bio at the same time, each with its own
+ * request on the keyslot's tfm.
  */
-static void blk_crypto_decrypt_bio(struct work_struct *work)
+static void blk_crypto_decrypt_range(struct bio *bio, struct bvec_iter iter,
+				     const u64 dun[BLK_CRYPTO_DUN_ARRAY_SIZE])
 {
-	struct blk_crypto_decrypt_work *decrypt_work =
-		container_of(work, struct blk_crypto_decrypt_work, work);
-	struct bio *bio = decrypt_work->bio;
 	struct skcipher_request *ciph_req = NULL;
 	DECLARE_CRYPTO_WAIT(wait);
 	struct bio_vec bv;
-	struct bvec_iter iter;
+	struct bvec_iter it;
 	u64 curr_dun[BLK_CRYPTO_DUN_ARRAY_SIZE];
 	union blk_crypto_iv iv;
 	struct scatterlist sg;
-	struct bio_crypt_ctx *bc = bio->bi_crypt_context;
-	struct bio_fallback_crypt_ctx *f_ctx =
-		container_of(bc, struct bio_fallback_crypt_ctx, crypt_ctx);
-	const int data_unit_size = bc->bc_key->data_unit_size;
+	const int data_unit_size = bio->bi_crypt_context->bc_key->data_unit_size;
 	unsigned int i;
-	int err;
-
-	/*
-	 * Use the crypto API fallback keyslot manager to get a crypto_skcipher
-	 * for the algorithm and key specified for this bio.
-	 */
-	if (bio_crypt_ctx_acquire_keyslot(bc, blk_crypto_ksm)) {
-		bio->bi_status = BLK_STS_RESOURCE;
-		goto out_no_keyslot;
-	}
 
-	/* and then allocate an skcipher_request for it */
-	err = blk_crypto_alloc_cipher_req(bio, &ciph_req, &wait);
-	if (err)
-		goto out;
+	/* allocate an skcipher_request for the keyslot's tfm */
+	if (blk_crypto_alloc_cipher_req(bio, &ciph_req, &wait))
+		return;
 
-	memcpy(curr_dun, f_ctx->fallback_dun, sizeof(curr_dun));
+	memcpy(curr_dun, dun, sizeof(curr_dun));
 	sg_init_table(&sg, 1);
 	skcipher_request_set_crypt(ciph_req, &sg, &sg, data_unit_size,
 				   iv.bytes);
 
-	/* Decrypt each segment in the bio */
-	__bio_for_each_segment(bv, bio, iter, f_ctx->crypt_iter) {
+	/* Decrypt each segment in the range */
+	__bio_for_each_segment(bv, bio, it, iter) {
 		struct page *page = bv.bv_page;
 
 		sg_set_page(&sg, page, data_unit_size, bv.bv_offset);
@@ -451,13 +449,118 @@ static void blk_crypto_decrypt_bio(struct work_struct *work)
 
 out:
 	skcipher_request_free(ciph_req);
+}
+
+/* Complete the bio once the last part of it has been decrypted */
+static void blk_crypto_decrypt_done(struct bio *bio)
+{
+	struct bio_crypt_ctx *bc = bio->bi_crypt_context;
+	struct bio_fallback_crypt_ctx *f_ctx =
+		container_of(bc, struct bio_fallback_crypt_ctx, crypt_ctx);
+
+	if (!atomic_dec_and_test(&f_ctx->parts_pending))
+		return;
+
 	bio_crypt_ctx_release_keyslot(bc);
-out_no_keyslot:
-	kmem_cache_free(blk_crypto_decrypt_work_cache, decrypt_work);
 	blk_crypto_free_fallback_crypt_ctx(bio);
 	bio_endio(bio);
 }
 
+static void blk_crypto_decrypt_part(struct work_struct *work)
+{
+	struct blk_crypto_decrypt_work *decrypt_work =
+		container_of(work, struct blk_crypto_decrypt_work, work);
+	struct bio *bio = decrypt_work->bio;
+
+	blk_crypto_decrypt_range(bio, decrypt_work->iter, decrypt_work->dun);
+	kmem_cache_free(blk_crypto_decrypt_work_cache, decrypt_work);
+	blk_crypto_decrypt_done(bio);
+}
+
+/*
+ * Hand all but the first part of a large bio to other works, so that a
+ * large read is decrypted on several CPUs rather than on one.  Parts are
+ * queued from the end, and whatever could not be queued stays with the
+ * caller, which is left with the range it has to decrypt itself in @iter.
+ */
+static void blk_crypto_split_decrypt(struct bio *bio, struct bvec_iter *iter)
+{
+	struct bio_crypt_ctx *bc = bio->bi_crypt_context;
+	struct bio_fallback_crypt_ctx *f_ctx =
+		container_of(bc, struct bio_fallback_crypt_ctx, crypt_ctx);
+	const unsigned int data_unit_size = bc->bc_key->data_unit_size;
+	unsigned int split_bytes = READ_ONCE(decrypt_split_kb) << 10;
+	unsigned int nr_parts, part_bytes, offset;
+	struct blk_crypto_decrypt_work *part;
+
+	if (!split_bytes || iter->bi_size <= split_bytes)
+		return;
+
+	nr_parts = min(DIV_ROUND_UP(iter->bi_size, split_bytes),
+		       num_online_cpus());
+	nr_parts = min_t(unsigned int, nr_parts, BLK_CRYPTO_MAX_DECRYPT_PARTS);
+	if (nr_parts < 2)
+		return;
+	part_bytes = round_up(DIV_ROUND_UP(iter->bi_size, nr_parts),
+			      data_unit_size);
+
+	while (--nr_parts) {
+		offset = nr_parts * part_bytes;
+		if (offset >= iter->bi_size)
+			continue;
+
+		part = kmem_cache_zalloc(blk_crypto_decrypt_work_cache,
+					 GFP_NOWAIT | __GFP_NOWARN);
+		if (!part)
+			break;
+
+		part->bio = bio;
+		part->iter = *iter;
+		bio_advance_iter(bio, &part->iter, offset);
+		memcpy(part->dun, f_ctx->fallback_dun, sizeof(part->dun));
+		bio_crypt_dun_increment(part->dun, offset / data_unit_size);
+		iter->bi_size = offset;
+
+		INIT_WORK(&part->work, blk_crypto_decrypt_part);
+		atomic_inc(&f_ctx->parts_pending);
+		queue_work(blk_crypto_wq, &part->work);
+	}
+}
+
+/*
+ * The crypto API fallback's main decryption routine.
+ * Decrypts input bio in place.
+ */
+static void blk_crypto_decrypt_bio(struct work_struct *work)
+{
+	struct blk_crypto_decrypt_work *decrypt_work =
+		container_of(work, struct blk_crypto_decrypt_work, work);
+	struct bio *bio = decrypt_work->bio;
+	struct bio_crypt_ctx *bc = bio->bi_crypt_context;
+	struct bio_fallback_crypt_ctx *f_ctx =
+		container_of(bc, struct bio_fallback_crypt_ctx, crypt_ctx);
+	struct bvec_iter iter = f_ctx->crypt_iter;
+
+	kmem_cache_free(blk_crypto_decrypt_work_cache, decrypt_work);
+
+	/*
+	 * Use the crypto API fallback keyslot manager to get a crypto_skcipher
+	 * for the algorithm and key specified for this bio.  The keyslot is
+	 * held until all parts of the bio are decrypted.
+	 */
+	if (bio_crypt_ctx_acquire_keyslot(bc, blk_crypto_ksm)) {
+		bio->bi_status = BLK_STS_RESOURCE;
+		blk_crypto_free_fallback_crypt_ctx(bio);
+		bio_endio(bio);
+		return;
+	}
+
+	atomic_set(&f_ctx->parts_pending, 1);
+	blk_crypto_split_decrypt(bio, &iter);
+	blk_crypto_decrypt_range(bio, iter, f_ctx->fallback_dun);
+	blk_crypto_decrypt_done(bio);
+}
+
 /*
  * Queue bio for decryption.
  * Returns true iff bio was queued for decryption.
@@ -528,6 +631,13 @@ int blk_crypto_fallback_start_using_mode(enum blk_crypto_mode_num mode_num)
 					  CRYPTO_TFM_REQ_WEAK_KEY);
 	}
 
+	/* Throughput depends entirely on which implementation this is */
+	slotp = &blk_crypto_keyslots[0];
+	pr_info("Using %s for %s\n",
+		crypto_tfm_alg_driver_name(
+			crypto_skcipher_tfm(slotp->tfms[mode_num])),
+		cipher_str);
+
 	/*
 	 * Ensure that updates to blk_crypto_keyslots[i].tfms[mode_num]
 	 * for each i are visible before we set tfms_inited[mode_num].
@@ -23,6 +23,7 @@
 #include <linux/slab.h>
 #include <linux/backing-dev.h>
 #include <linux/swap.h>
+#include <linux/blk-cgroup.h>
 
 #include "blk-wbt.h"
 
@@ -58,6 +59,119 @@ static inline bool rwb_enabled(struct rq_wb *rwb)
 	return rwb && rwb->wb_normal != 0;
 }
 
+#ifdef CONFIG_BLK_CGROUP
+/*
+ * Per-blkcg settings and statistics. A cgroup can ask for a tighter read
+ * latency target than the device default, which then drives scaling for
+ * a second after each of its reads, and can cap its buffered writes to a
+ * percentage of the current writeback depth so background writers are
+ * throttled before the device limit is reached.
+ */
+struct wbt_cgrp {
+	struct blkcg_policy_data cpd;
+
+	u64 lat_target_nsec;			/* 0 = device default */
+	unsigned int write_depth_pct;		/* of the wbt limit */
+
+	atomic64_t reads;
+	atomic64_t writes;
+	atomic64_t throttled;
+	atomic64_t wait_nsec;
+};
+
+static struct blkcg_policy blkcg_policy_wbt;
+static bool wbt_blkcg_registered;
+
+static inline struct wbt_cgrp *cpd_to_wbtc(struct blkcg_policy_data *cpd)
+{
+	return cpd ? container_of(cpd, struct wbt_cgrp, cpd) : NULL;
+}
+
+static inline struct wbt_cgrp *blkcg_to_wbtc(struct blkcg *blkcg)
+{
+	if (!wbt_blkcg_registered || !blkcg)
+		return NULL;
+
+	return cpd_to_wbtc(blkcg_to_cpd(blkcg, &blkcg_policy_wbt));
+}
+
+static void wbt_cgrp_account_read(struct rq_wb *rwb, struct bio *bio)
+{
+	struct wbt_cgrp *wc;
+
+	rcu_read_lock();
+	wc = blkcg_to_wbtc(bio_blkcg(bio));
+	if (wc) {
+		atomic64_inc(&wc->reads);
+
+		/* a looser target never replaces a tighter, recent one */
+		if (wc->lat_target_nsec &&
+		    (wc->lat_target_nsec <= rwb->cg_lat_nsec ||
+		     !rwb->cg_lat_nsec ||
+		     time_after(jiffies, rwb->cg_lat_stamp + HZ))) {
+			rwb->cg_lat_nsec = wc->lat_target_nsec;
+			rwb->cg_lat_stamp = jiffies;
+		}
+	}
+	rcu_read_unlock();
+}
+
+static unsigned int wbt_cgrp_account_write(struct bio *bio)
+{
+	unsigned int pct = 100;
+	struct wbt_cgrp *wc;
+
+	rcu_read_lock();
+	wc = blkcg_to_wbtc(bio_blkcg(bio));
+	if (wc) {
+		atomic64_inc(&wc->writes);
+		pct = wc->write_depth_pct;
+	}
+	rcu_read_unlock();
+
+	return pct;
+}
+
+static void wbt_cgrp_account_wait(struct bio *bio, u64 wait_nsec)
+{
+	struct wbt_cgrp *wc;
+
+	rcu_read_lock();
+	wc = blkcg_to_wbtc(bio_blkcg(bio));
+	if (wc) {
+		atomic64_inc(&wc->throttled);
+		atomic64_add(wait_nsec, &wc->wait_nsec);
+	}
+	rcu_read_unlock();
+}
+#else
+static inline void wbt_cgrp_account_read(struct rq_wb *rwb, struct bio *bio)
+{
+}
+static inline unsigned int wbt_cgrp_account_write(struct bio *bio)
+{
+	return 100;
+}
+static inline void wbt_cgrp_account_wait(struct bio *bio, u64 wait_nsec)
+{
+}
+#endif /* CONFIG_BLK_CGROUP */
+
+/*
+ * The read latency target for the current window: the device default,
+ * or a tighter per-cgroup target if such a cgroup read in the last second.
+ */
+static u64 rwb_min_lat_nsec(struct rq_wb *rwb)
+{
+	u64 cg_lat = READ_ONCE(rwb->cg_lat_nsec);
+
+	if (cg_lat && cg_lat < rwb->min_lat_nsec &&
+	    time_before(jiffies, READ_ONCE(rwb->cg_lat_stamp) + HZ))
+		return cg_lat;
+
+	return rwb->min_lat_nsec;
+}
+
 /*
  * Increment 'v', if 'v' is below 'below'. Returns true if we succeeded,
  * false if 'v' + 1 would be bigger than 'below'.
@@ -280,6 +394,7 @@ enum {
 static int latency_exceeded(struct rq_wb *rwb, struct blk_rq_stat *stat)
 {
 	struct backing_dev_info *bdi = rwb->queue->backing_dev_info;
+	u64 min_lat = rwb_min_lat_nsec(rwb);
 	u64 thislat;
 
 	/*
@@ -293,7 +408,7 @@ static int latency_exceeded(struct rq_wb *rwb, struct blk_rq_stat *stat)
 	 */
 	thislat = rwb_sync_issue_lat(rwb);
 	if (thislat > rwb->cur_win_nsec ||
-	    (thislat > rwb->min_lat_nsec && !stat[READ].nr_samples)) {
+	    (thislat > min_lat && !stat[READ].nr_samples)) {
 		trace_wbt_lat(bdi, thislat);
 		return LAT_EXCEEDED;
 	}
@@ -317,7 +432,7 @@ static int latency_exceeded(struct rq_wb *rwb, struct blk_rq_stat *stat)
 	/*
 	 * If the 'min' latency exceeds our target, step down.
 	 */
-	if (stat[READ].min > rwb->min_lat_nsec) {
+	if (stat[READ].min > min_lat) {
 		trace_wbt_lat(bdi, stat[READ].min);
 		trace_wbt_stat(bdi, stat);
 		return LAT_EXCEEDED;
@@ -503,8 +618,11 @@ static inline unsigned int get_limit(struct rq_wb *rwb, unsigned long rw)
 }
 
 static inline bool may_queue(struct rq_wb *rwb, struct rq_wait *rqw,
-			     wait_queue_entry_t *wait, unsigned long rw)
+			     wait_queue_entry_t *wait, unsigned long rw,
+			     unsigned int pct)
 {
+	unsigned int limit;
+
 	/*
 	 * inc it here even if disabled, since we'll dec it at completion.
 	 * this only happens if the task was sleeping in __wbt_wait(),
@@ -523,28 +641,39 @@ static inline bool may_queue(struct rq_wb *rwb, struct rq_wait *rqw,
 	    rqw->wait.head.next != &wait->entry)
 		return false;
 
-	return atomic_inc_below(&rqw->inflight, get_limit(rwb, rw));
+	/*
+	 * A cgroup write budget shrinks the limit for its own buffered
+	 * writeback, sync and kswapd writes keep the full depth.
+	 */
+	limit = get_limit(rwb, rw);
+	if (pct < 100 && !(rw & REQ_HIPRIO) && !current_is_kswapd())
+		limit = max(1U, limit * pct / 100);
+
+	return atomic_inc_below(&rqw->inflight, limit);
 }
 
 /*
  * Block if we will exceed our limit, or if we are currently waiting for
- * the timer to kick off queuing again.
+ * the timer to kick off queuing again. Returns the time spent waiting.
  */
-static void __wbt_wait(struct rq_wb *rwb, unsigned long rw, spinlock_t *lock)
+static u64 __wbt_wait(struct rq_wb *rwb, unsigned long rw, unsigned int pct,
+		      spinlock_t *lock)
 	__releases(lock)
 	__acquires(lock)
 {
 	struct rq_wait *rqw = get_rq_wait(rwb, current_is_kswapd());
 	DEFINE_WAIT(wait);
+	u64 start;
 
-	if (may_queue(rwb, rqw, &wait, rw))
-		return;
+	if (may_queue(rwb, rqw, &wait, rw, pct))
+		return 0;
 
+	start = ktime_get_ns();
 	do {
 		prepare_to_wait_exclusive(&rqw->wait, &wait,
 						TASK_UNINTERRUPTIBLE);
 
-		if (may_queue(rwb, rqw, &wait, rw))
+		if (may_queue(rwb, rqw, &wait, rw, pct))
 			break;
 
 		if (lock) {
@@ -556,6 +685,8 @@ static void __wbt_wait(struct rq_wb *rwb, unsigned long rw, spinlock_t *lock)
 	} while (1);
 
 	finish_wait(&rqw->wait, &wait);
+
+	return ktime_get_ns() - start;
 }
 
 static inline bool wbt_should_throttle(struct rq_wb *rwb, struct bio *bio)
@@ -586,6 +717,7 @@ static inline bool wbt_should_throttle(struct rq_wb *rwb, struct bio *bio)
 enum wbt_flags wbt_wait(struct rq_wb *rwb, struct bio *bio, spinlock_t *lock)
 {
 	unsigned int ret = 0;
+	u64 wait_nsec;
 
 	if (!rwb_enabled(rwb))
 		return 0;
@@ -594,12 +726,17 @@ enum wbt_flags wbt_wait(struct rq_wb *rwb, struct bio *bio, spinlock_t *lock)
 		ret = WBT_READ;
 
 	if (!wbt_should_throttle(rwb, bio)) {
-		if (ret & WBT_READ)
+		if (ret & WBT_READ) {
 			wb_timestamp(rwb, &rwb->last_issue);
+			wbt_cgrp_account_read(rwb, bio);
+		}
 		return ret;
 	}
 
-	__wbt_wait(rwb, bio->bi_opf, lock);
+	wait_nsec = __wbt_wait(rwb, bio->bi_opf, wbt_cgrp_account_write(bio),
+			       lock);
+	if (wait_nsec)
+		wbt_cgrp_account_wait(bio, wait_nsec);
 
 	if (!blk_stat_is_active(rwb->cb))
 		rwb_arm_timer(rwb);
@@ -764,3 +901,152 @@ void wbt_exit(struct request_queue *q)
 		kfree(rwb);
 	}
 }
+
+#ifdef CONFIG_BLK_CGROUP
+static struct blkcg_policy_data *wbt_cpd_alloc(gfp_t gfp)
+{
+	struct wbt_cgrp *wc;
+
+	wc = kzalloc(sizeof(*wc), gfp);
+	if (!wc)
+		return NULL;
+
+	return &wc->cpd;
+}
+
+static void wbt_cpd_init(struct blkcg_policy_data *cpd)
+{
+	struct wbt_cgrp *wc = cpd_to_wbtc(cpd);
+
+	wc->lat_target_nsec = 0;
+	wc->write_depth_pct = 100;
+}
+
+static void wbt_cpd_free(struct blkcg_policy_data *cpd)
+{
+	kfree(cpd_to_wbtc(cpd));
+}
+
+static u64 wbt_lat_target_read(struct cgroup_subsys_state *css,
+			       struct cftype *cft)
+{
+	struct wbt_cgrp *wc = blkcg_to_wbtc(css_to_blkcg(css));
+
+	return wc ? div_u64(wc->lat_target_nsec, 1000) : 0;
+}
+
+static int wbt_lat_target_write(struct cgroup_subsys_state *css,
+				struct cftype *cft, u64 val)
+{
+	struct wbt_cgrp *wc = blkcg_to_wbtc(css_to_blkcg(css));
+
+	if (!wc)
+		return -ENODEV;
+
+	wc->lat_target_nsec = val * 1000;
+	return 0;
+}
+
+static u64 wbt_write_depth_read(struct cgroup_subsys_state *css,
+				struct cftype *cft)
+{
+	struct wbt_cgrp *wc = blkcg_to_wbtc(css_to_blkcg(css));
+
+	return wc ? wc->write_depth_pct : 100;
+}
+
+static int wbt_write_depth_write(struct cgroup_subsys_state *css,
+				 struct cftype *cft, u64 val)
+{
+	struct wbt_cgrp *wc = blkcg_to_wbtc(css_to_blkcg(css));
+
+	if (!wc)
+		return -ENODEV;
+	if (!val || val > 100)
+		return -EINVAL;
+
+	wc->write_depth_pct = val;
+	return 0;
+}
+
+static int wbt_print_stat(struct seq_file *sf, void *v)
+{
+	struct wbt_cgrp *wc = blkcg_to_wbtc(css_to_blkcg(seq_css(sf)));
+
+	if (!wc)
+		return 0;
+
+	seq_printf(sf, "reads %lld\nwrites %lld\nthrottled %lld\nwait_us %lld\n",
+		   (long long)atomic64_read(&wc->reads),
+		   (long long)atomic64_read(&wc->writes),
+		   (long long)atomic64_read(&wc->throttled),
+		   (long long)div_u64(atomic64_read(&wc->wait_nsec), 1000));
+	return 0;
+}
+
+static struct cftype wbt_files[] = {
+	{
+		.name = "wbt.lat_target_us",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.read_u64 = wbt_lat_target_read,
+		.write_u64 = wbt_lat_target_write,
+	},
+	{
+		.name = "wbt.write_depth_pct",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.read_u64 = wbt_write_depth_read,
+		.write_u64 = wbt_write_depth_write,
+	},
+	{
+		.name = "wbt.stat",
+		.seq_show = wbt_print_stat,
+	},
+	{ }	/* terminate */
+};
+
+static struct cftype wbt_legacy_files[] = {
+	{
+		.name = "wbt.lat_target_us",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.read_u64 = wbt_lat_target_read,
+		.write_u64 = wbt_lat_target_write,
+	},
+	{
+		.name = "wbt.write_depth_pct",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.read_u64 = wbt_write_depth_read,
+		.write_u64 = wbt_write_depth_write,
+	},
+	{
+		.name = "wbt.stat",
+		.seq_show = wbt_print_stat,
+	},
+	{ }	/* terminate */
+};
+
+/*
+ * Only per-cgroup data is used: the settings apply to every device and
+ * no per-queue policy activation is needed.
+ */
+static struct blkcg_policy blkcg_policy_wbt = {
+	.dfl_cftypes		= wbt_files,
+	.legacy_cftypes		= wbt_legacy_files,
+
+	.cpd_alloc_fn		= wbt_cpd_alloc,
+	.cpd_init_fn		= wbt_cpd_init,
+	.cpd_free_fn		= wbt_cpd_free,
+};
+
+static int __init wbt_blkcg_init(void)
+{
+	int ret;
+
+	ret = blkcg_policy_register(&blkcg_policy_wbt);
+	if (ret)
+		return ret;
+
+	wbt_blkcg_registered = true;
+	return 0;
+}
+module_init(wbt_blkcg_init);
+#endif /* CONFIG_BLK_CGROUP */
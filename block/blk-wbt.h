@@ -93,6 +93,8 @@ struct rq_wb {
 	unsigned long last_issue;		/* last non-throttled issue */
 	unsigned long last_comp;		/* last non-throttled comp */
 	unsigned long min_lat_nsec;
+	u64 cg_lat_nsec;			/* tightest recent blkcg target */
+	unsigned long cg_lat_stamp;		/* last read under cg_lat_nsec */
 	struct request_queue *queue;
 	struct rq_wait rq_wait[WBT_NUM_RWQ];
 };
@@ -29,7 +29,9 @@
 #include <linux/keyslot-manager.h>
 #include <linux/atomic.h>
 #include <linux/mutex.h>
+#include <linux/percpu.h>
 #include <linux/pm_runtime.h>
+#include <linux/rculist.h>
 #include <linux/wait.h>
 #include <linux/blkdev.h>
 #include <linux/overflow.h>
@@ -71,6 +73,9 @@ struct keyslot_manager {
 	struct hlist_head *slot_hashtable;
 	unsigned int slot_hashtable_size;
 
+	/* Counted per CPU so that hits don't bounce a shared cacheline */
+	struct keyslot_manager_stats __percpu *stats;
+
 	/* Per-keyslot data */
 	struct keyslot slots[];
 };
@@ -114,6 +119,9 @@ static inline void keyslot_manager_pm_put(struct keyslot_manager *ksm)
 }
 #endif /* !CONFIG_PM */
 
+#define keyslot_manager_stat_inc(ksm, field) \
+	this_cpu_inc((ksm)->stats->field)
+
 static inline void keyslot_manager_hw_enter(struct keyslot_manager *ksm)
 {
 	/*
@@ -209,6 +217,10 @@ struct keyslot_manager *keyslot_manager_create(
 	for (i = 0; i < ksm->slot_hashtable_size; i++)
 		INIT_HLIST_HEAD(&ksm->slot_hashtable[i]);
 
+	ksm->stats = alloc_percpu(struct keyslot_manager_stats);
+	if (!ksm->stats)
+		goto err_free_ksm;
+
 	return ksm;
 
 err_free_ksm:
@@ -241,6 +253,16 @@ static void remove_slot_from_lru_list(struct keyslot_manager *ksm, int slot)
 	spin_unlock_irqrestore(&ksm->idle_slots_lock, flags);
 }
 
+static bool keyslot_has_key(const struct keyslot *slotp,
+			    const struct blk_crypto_key *key)
+{
+	return slotp->key.hash == key->hash &&
+	       slotp->key.crypto_mode == key->crypto_mode &&
+	       slotp->key.size == key->size &&
+	       slotp->key.data_unit_size == key->data_unit_size &&
+	       !crypto_memneq(slotp->key.raw, key->raw, key->size);
+}
+
 static int find_keyslot(struct keyslot_manager *ksm,
 			const struct blk_crypto_key *key)
 {
@@ -248,16 +270,49 @@ static int find_keyslot(struct keyslot_manager *ksm,
 	const struct keyslot *slotp;
 
 	hlist_for_each_entry(slotp, head, hash_node) {
-		if (slotp->key.hash == key->hash &&
-		    slotp->key.crypto_mode == key->crypto_mode &&
-		    slotp->key.size == key->size &&
-		    slotp->key.data_unit_size == key->data_unit_size &&
-		    !crypto_memneq(slotp->key.raw, key->raw, key->size))
+		if (keyslot_has_key(slotp, key))
 			return slotp - ksm->slots;
 	}
 	return -ENOKEY;
 }
 
+/*
+ * Look up a key without taking ksm->lock.  This only succeeds for a slot that
+ * is already in use, as a slot is only reprogrammed or evicted while it has no
+ * references: once we hold one the slot can't change under us, so checking
+ * the key again after grabbing it is enough.  Idle slots have to be taken off
+ * the LRU list, which is left to the locked path.  Slots move between hash
+ * buckets without waiting for readers, so this may miss a key and callers
+ * must fall back to the locked lookup.
+ */
+static int find_and_grab_keyslot_rcu(struct keyslot_manager *ksm,
+				     const struct blk_crypto_key *key)
+{
+	const struct hlist_head *head = hash_bucket_for_key(ksm, key);
+	struct keyslot *slotp;
+	int slot = -ENOKEY;
+	bool put = false;
+
+	rcu_read_lock();
+	hlist_for_each_entry_rcu(slotp, head, hash_node) {
+		if (!keyslot_has_key(slotp, key))
+			continue;
+		if (!atomic_inc_not_zero(&slotp->slot_refs))
+			break;
+		slot = slotp - ksm->slots;
+		/* Reprogrammed before we got the reference */
+		put = !keyslot_has_key(slotp, key);
+		break;
+	}
+	rcu_read_unlock();
+
+	if (put) {
+		keyslot_manager_put_slot(ksm, slot);
+		slot = -ENOKEY;
+	}
+	return slot;
+}
+
 static int find_and_grab_keyslot(struct keyslot_manager *ksm,
 				 const struct blk_crypto_key *key)
 {
@@ -283,7 +338,8 @@ static int find_and_grab_keyslot(struct keyslot_manager *ksm,
  * exists, return it with incremented refcount.  Otherwise, wait for a keyslot
  * to become idle and program it.
  *
- * Context: Process context. Takes and releases ksm->lock.
+ * Context: Process context. Takes and releases ksm->lock unless the key is
+ *	    already in a slot that is in use.
  * Return: The keyslot on success, else a -errno value.
  */
 int keyslot_manager_get_slot_for_key(struct keyslot_manager *ksm,
@@ -296,17 +352,26 @@ int keyslot_manager_get_slot_for_key(struct keyslot_manager *ksm,
 	if (keyslot_manager_is_passthrough(ksm))
 		return 0;
 
+	slot = find_and_grab_keyslot_rcu(ksm, key);
+	if (slot >= 0) {
+		keyslot_manager_stat_inc(ksm, fast_hits);
+		return slot;
+	}
+
 	down_read(&ksm->lock);
 	slot = find_and_grab_keyslot(ksm, key);
 	up_read(&ksm->lock);
-	if (slot != -ENOKEY)
+	if (slot != -ENOKEY) {
+		keyslot_manager_stat_inc(ksm, hits);
 		return slot;
+	}
 
 	for (;;) {
 		keyslot_manager_hw_enter(ksm);
 		slot = find_and_grab_keyslot(ksm, key);
 		if (slot != -ENOKEY) {
 			keyslot_manager_hw_exit(ksm);
+			keyslot_manager_stat_inc(ksm, hits);
 			return slot;
 		}
 
@@ -318,6 +383,7 @@ int keyslot_manager_get_slot_for_key(struct keyslot_manager *ksm,
 			break;
 
 		keyslot_manager_hw_exit(ksm);
+		keyslot_manager_stat_inc(ksm, waits);
 		wait_event(ksm->idle_slots_wait_queue,
 			   !list_empty(&ksm->idle_slots));
 	}
@@ -333,17 +399,25 @@ int keyslot_manager_get_slot_for_key(struct keyslot_manager *ksm,
 		return err;
 	}
 
-	/* Move this slot to the hash list for the new key. */
-	if (idle_slot->key.crypto_mode != BLK_ENCRYPTION_MODE_INVALID)
-		hlist_del(&idle_slot->hash_node);
-	hlist_add_head(&idle_slot->hash_node, hash_bucket_for_key(ksm, key));
-
-	atomic_set(&idle_slot->slot_refs, 1);
+	/*
+	 * Move this slot to the hash list for the new key.  Lockless lookups
+	 * may still walk it; they revalidate the key once they hold a
+	 * reference, so the key must be in place before the first one.
+	 */
+	if (idle_slot->key.crypto_mode != BLK_ENCRYPTION_MODE_INVALID) {
+		hlist_del_rcu(&idle_slot->hash_node);
+		keyslot_manager_stat_inc(ksm, evictions);
+	}
 	idle_slot->key = *key;
+	hlist_add_head_rcu(&idle_slot->hash_node,
+			   hash_bucket_for_key(ksm, key));
+
+	atomic_set_release(&idle_slot->slot_refs, 1);
 
 	remove_slot_from_lru_list(ksm, slot);
 
 	keyslot_manager_hw_exit(ksm);
+	keyslot_manager_stat_inc(ksm, programs);
 	return slot;
 }
 
@@ -483,7 +557,7 @@ int keyslot_manager_evict_key(struct keyslot_manager *ksm,
 	if (err)
 		goto out_unlock;
 
-	hlist_del(&slotp->hash_node);
+	hlist_del_rcu(&slotp->hash_node);
 	memzero_explicit(&slotp->key, sizeof(slotp->key));
 	err = 0;
 out_unlock:
@@ -535,9 +609,40 @@ void *keyslot_manager_private(struct keyslot_manager *ksm)
 }
 EXPORT_SYMBOL_GPL(keyslot_manager_private);
 
+/**
+ * keyslot_manager_get_stats() - Get keyslot usage counters
+ * @ksm: The keyslot manager
+ * @stats: (output) the counters summed over all CPUs
+ *
+ * Comparing programs to hits tells whether there are too few keyslots for
+ * the keys in use, in which case keys get reprogrammed on the I/O path.
+ */
+void keyslot_manager_get_stats(struct keyslot_manager *ksm,
+			       struct keyslot_manager_stats *stats)
+{
+	int cpu;
+
+	memset(stats, 0, sizeof(*stats));
+	if (keyslot_manager_is_passthrough(ksm))
+		return;
+
+	for_each_possible_cpu(cpu) {
+		const struct keyslot_manager_stats *s =
+			per_cpu_ptr(ksm->stats, cpu);
+
+		stats->fast_hits += s->fast_hits;
+		stats->hits += s->hits;
+		stats->programs += s->programs;
+		stats->evictions += s->evictions;
+		stats->waits += s->waits;
+	}
+}
+EXPORT_SYMBOL_GPL(keyslot_manager_get_stats);
+
 void keyslot_manager_destroy(struct keyslot_manager *ksm)
 {
 	if (ksm) {
+		free_percpu(ksm->stats);
 		kvfree(ksm->slot_hashtable);
 		memzero_explicit(ksm, struct_size(ksm, slots, ksm->num_slots));
 		kvfree(ksm);
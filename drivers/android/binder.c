@@ -66,14 +66,19 @@
 #include <linux/rbtree.h>
 #include <linux/sched/signal.h>
 #include <linux/sched/mm.h>
+#include <linux/sched/rt.h>
+#include <linux/sched/ux.h>
 #include <linux/seq_file.h>
+#include <linux/topology.h>
 #include <linux/uaccess.h>
+#include <linux/vmalloc.h>
 #include <linux/pid_namespace.h>
 #include <linux/security.h>
 #include <linux/spinlock.h>
 #include <linux/ratelimit.h>
 
 #include <uapi/linux/android/binder.h>
+#include <uapi/linux/binder_latency.h>
 #include <uapi/linux/sched/types.h>
 #include "binder_alloc.h"
 #include "binder_internal.h"
@@ -95,11 +100,16 @@ static DEFINE_SPINLOCK(binder_dead_nodes_lock);
 
 static struct dentry *binder_debugfs_dir_entry_root;
 static struct dentry *binder_debugfs_dir_entry_proc;
+static struct dentry *binder_debugfs_dir_entry_latency;
 static atomic_t binder_last_id;
 
 static int proc_show(struct seq_file *m, void *unused);
 DEFINE_SHOW_ATTRIBUTE(proc);
 
+#ifdef CONFIG_ANDROID_BINDER_LATENCY
+static const struct file_operations binder_latency_fops;
+#endif
+
 /* This is only defined in include/asm-arm/sizes.h */
 #ifndef SZ_1K
 #define SZ_1K                               0x400
@@ -196,6 +206,8 @@ struct binder_stats {
 	atomic_t bc[_IOC_NR(BC_REPLY_SG) + 1];
 	atomic_t obj_created[BINDER_STAT_COUNT];
 	atomic_t obj_deleted[BINDER_STAT_COUNT];
+	atomic_t fast_buf_hit;
+	atomic_t fast_buf_miss;
 };
 
 static struct binder_stats binder_stats;
@@ -320,6 +332,8 @@ struct binder_error {
  *                        (invariant after initialized)
  * @async_todo:           list of async work items
  *                        (protected by @proc->inner_lock)
+ * @latency:              latency histograms of transactions to this node
+ *                        (protected by @proc->inner_lock)
  *
  * Bookkeeping structure for binder nodes.
  */
@@ -361,6 +375,9 @@ struct binder_node {
 	};
 	bool has_async_transaction;
 	struct list_head async_todo;
+#ifdef CONFIG_ANDROID_BINDER_LATENCY
+	struct binder_latency_hist latency[BINDER_LATENCY_NR];
+#endif
 };
 
 struct binder_ref_death {
@@ -517,6 +534,7 @@ struct binder_priority {
  * @binderfs_entry:       process-specific binderfs log file
  * @oneway_spam_detection_enabled: process enabled oneway spam detection
  *                        or not
+ * @latency_entry:        debugfs latency histogram file
  *
  * Bookkeeping structure for binder processes
  */
@@ -556,6 +574,9 @@ struct binder_proc {
 	spinlock_t outer_lock;
 	struct dentry *binderfs_entry;
 	bool oneway_spam_detection_enabled;
+#ifdef CONFIG_ANDROID_BINDER_LATENCY
+	struct dentry *latency_entry;
+#endif
 };
 
 enum {
@@ -601,6 +622,8 @@ enum {
  *                        when outstanding transactions are cleaned up
  *                        (protected by @proc->inner_lock)
  * @task:                 struct task_struct for this thread
+ * @fast_buf:             small buffer kept mapped for the next transaction
+ *                        to this thread (updated with xchg/cmpxchg)
  *
  * Bookkeeping structure for binder threads.
  */
@@ -621,6 +644,7 @@ struct binder_thread {
 	atomic_t tmp_ref;
 	bool is_dead;
 	struct task_struct *task;
+	struct binder_buffer *fast_buf;
 };
 
 struct binder_transaction {
@@ -640,8 +664,19 @@ struct binder_transaction {
 	struct binder_priority	priority;
 	struct binder_priority	saved_priority;
 	bool    set_priority_called;
+#ifdef CONFIG_SCHED_UX
+	/* sent synchronously by a UX task; ux_set once the target got it */
+	bool	ux;
+	bool	ux_set;
+#endif
 	kuid_t	sender_euid;
 	binder_uintptr_t security_ctx;
+#ifdef CONFIG_ANDROID_BINDER_LATENCY
+	/* when queued to and picked up by the target, and the node it hit */
+	u64	queue_ns;
+	u64	dequeue_ns;
+	binder_uintptr_t node_ptr;
+#endif
 	/**
 	 * @lock:  protects @from, @to_proc, and @to_thread
 	 *
@@ -1041,9 +1076,21 @@ static void binder_wakeup_poll_threads_ilocked(struct binder_proc *proc,
 	}
 }
 
+/* Waiting threads looked at for a cluster match on a sync wakeup */
+#define BINDER_SELECT_SCAN	4
+
 /**
  * binder_select_thread_ilocked() - selects a thread for doing proc work.
  * @proc:	process to select a thread from
+ * @sync:	the work is a synchronous transaction from current
+ *
+ * Threads add themselves at the head of waiting_threads, so the first
+ * entry is the one that went idle most recently and is the most likely
+ * to still have warm caches. For a synchronous transaction, prefer a
+ * thread that last ran in current's cluster instead, as the caller is
+ * about to sleep and the wakeup would otherwise pull the work across
+ * clusters. UX and RT callers look at every waiting thread, everyone
+ * else only at the first BINDER_SELECT_SCAN.
  *
  * Note that calling this function moves the thread off the waiting_threads
  * list, so it can only be woken up by the caller of this function, or a
@@ -1054,15 +1101,32 @@ static void binder_wakeup_poll_threads_ilocked(struct binder_proc *proc,
  *		returns that thread. Otherwise returns NULL.
  */
 static struct binder_thread *
-binder_select_thread_ilocked(struct binder_proc *proc)
+binder_select_thread_ilocked(struct binder_proc *proc, bool sync)
 {
-	struct binder_thread *thread;
+	struct binder_thread *thread, *itr;
 
 	assert_spin_locked(&proc->inner_lock);
 	thread = list_first_entry_or_null(&proc->waiting_threads,
 					  struct binder_thread,
 					  waiting_thread_node);
 
+	if (thread && sync) {
+		const struct cpumask *cluster =
+			topology_core_cpumask(smp_processor_id());
+		bool scan_all = task_is_ux(current) || rt_task(current);
+		int scanned = 0;
+
+		list_for_each_entry(itr, &proc->waiting_threads,
+				    waiting_thread_node) {
+			if (cpumask_test_cpu(task_cpu(itr->task), cluster)) {
+				thread = itr;
+				break;
+			}
+			if (!scan_all && ++scanned >= BINDER_SELECT_SCAN)
+				break;
+		}
+	}
+
 	if (thread)
 		list_del_init(&thread->waiting_thread_node);
 
@@ -1117,7 +1181,7 @@ static void binder_wakeup_thread_ilocked(struct binder_proc *proc,
 
 static void binder_wakeup_proc_ilocked(struct binder_proc *proc)
 {
-	struct binder_thread *thread = binder_select_thread_ilocked(proc);
+	struct binder_thread *thread = binder_select_thread_ilocked(proc, false);
 
 	binder_wakeup_thread_ilocked(proc, thread, /* sync = */false);
 }
@@ -1228,6 +1292,18 @@ static void binder_restore_priority(struct task_struct *task,
 	binder_do_set_priority(task, desired, /* verify = */ false);
 }
 
+/* Undo the UX inheritance binder_transaction_priority() applied */
+static void binder_restore_ux(struct task_struct *task,
+			      struct binder_transaction *t)
+{
+#ifdef CONFIG_SCHED_UX
+	if (t->ux_set) {
+		t->ux_set = false;
+		sched_ux_binder_exit(task);
+	}
+#endif
+}
+
 static void binder_transaction_priority(struct task_struct *task,
 					struct binder_transaction *t,
 					struct binder_priority node_prio,
@@ -1242,6 +1318,13 @@ static void binder_transaction_priority(struct task_struct *task,
 	t->saved_priority.sched_policy = task->policy;
 	t->saved_priority.prio = task->normal_prio;
 
+#ifdef CONFIG_SCHED_UX
+	if (t->ux) {
+		t->ux_set = true;
+		sched_ux_binder_enter(task);
+	}
+#endif
+
 	if (!inherit_rt && is_rt_policy(desired_prio.sched_policy)) {
 		desired_prio.prio = NICE_TO_PRIO(0);
 		desired_prio.sched_policy = SCHED_NORMAL;
@@ -2861,6 +2944,78 @@ static int binder_fixup_parent(struct binder_transaction *t,
 	return 0;
 }
 
+#ifdef CONFIG_ANDROID_BINDER_LATENCY
+static void binder_latency_add_ilocked(struct binder_node *node, int type,
+				       u64 delta_ns)
+{
+	struct binder_latency_hist *hist = &node->latency[type];
+	int bucket = fls64(div_u64(delta_ns, NSEC_PER_USEC));
+
+	hist->count++;
+	hist->sum_ns += delta_ns;
+	if (delta_ns > hist->max_ns)
+		hist->max_ns = delta_ns;
+	hist->buckets[min(bucket, BINDER_LATENCY_BUCKETS - 1)]++;
+}
+#endif
+
+static void binder_latency_queued(struct binder_transaction *t)
+{
+#ifdef CONFIG_ANDROID_BINDER_LATENCY
+	t->queue_ns = ktime_get_ns();
+#endif
+}
+
+static void binder_latency_dequeued(struct binder_transaction *t)
+{
+#ifdef CONFIG_ANDROID_BINDER_LATENCY
+	t->dequeue_ns = ktime_get_ns();
+#endif
+}
+
+/* @t was handed to a thread of @proc as BR_TRANSACTION */
+static void binder_latency_received(struct binder_proc *proc,
+				    struct binder_transaction *t)
+{
+#ifdef CONFIG_ANDROID_BINDER_LATENCY
+	struct binder_node *node = t->buffer->target_node;
+	u64 now = ktime_get_ns();
+
+	t->node_ptr = node->ptr;
+	binder_inner_proc_lock(proc);
+	binder_latency_add_ilocked(node, BINDER_LATENCY_QUEUE,
+				   t->dequeue_ns - t->queue_ns);
+	binder_latency_add_ilocked(node, BINDER_LATENCY_READ,
+				   now - t->dequeue_ns);
+	binder_inner_proc_unlock(proc);
+#endif
+}
+
+/*
+ * @proc replied to @in_reply_to. Its buffer may already have been freed,
+ * so the node is looked up again by the ptr recorded when it was received.
+ */
+static void binder_latency_replied(struct binder_proc *proc,
+				   struct binder_transaction *in_reply_to)
+{
+#ifdef CONFIG_ANDROID_BINDER_LATENCY
+	struct binder_node *node;
+
+	if (!in_reply_to->dequeue_ns)
+		return;
+
+	binder_inner_proc_lock(proc);
+	node = binder_get_node_ilocked(proc, in_reply_to->node_ptr);
+	if (node)
+		binder_latency_add_ilocked(node, BINDER_LATENCY_REPLY,
+					   ktime_get_ns() -
+					   in_reply_to->queue_ns);
+	binder_inner_proc_unlock(proc);
+	if (node)
+		binder_put_node(node);
+#endif
+}
+
 /**
  * binder_proc_transaction() - sends a transaction to a process and wakes it up
  * @t:		transaction to send
@@ -2889,6 +3044,7 @@ static int binder_proc_transaction(struct binder_transaction *t,
 	bool pending_async = false;
 
 	BUG_ON(!node);
+	binder_latency_queued(t);
 	binder_node_lock(node);
 	node_prio.prio = node->min_priority;
 	node_prio.sched_policy = node->sched_policy;
@@ -2918,7 +3074,7 @@ static int binder_proc_transaction(struct binder_transaction *t,
 	}
 
 	if (!thread && !pending_async)
-		thread = binder_select_thread_ilocked(proc);
+		thread = binder_select_thread_ilocked(proc, !oneway);
 
 	if (thread) {
 		binder_transaction_priority(thread->task, t, node_prio,
@@ -3139,7 +3295,8 @@ static void binder_transaction(struct binder_proc *proc,
 			&& target_proc
 			&& (task_uid(target_proc->tsk).val > MIN_USERAPP_UID)
 			&& (proc->pid != target_proc->pid)
-			&& is_frozen_tg(target_proc->tsk)) {
+			&& is_frozen_tg(target_proc->tsk)
+			&& !hans_thaw_task_group(target_proc->tsk, HANS_THAW_SYNC_BINDER)) {
 			hans_report(SYNC_BINDER, task_tgid_nr(proc->tsk), task_uid(proc->tsk).val, task_tgid_nr(target_proc->tsk), task_uid(target_proc->tsk).val, "SYNC_BINDER", -1);
 		}
 #endif /*OPLUS_FEATURE_HANS_FREEZE*/
@@ -3289,6 +3446,9 @@ static void binder_transaction(struct binder_proc *proc,
 		/* Otherwise, fall back to the default priority */
 		t->priority = target_proc->default_priority;
 	}
+#ifdef CONFIG_SCHED_UX
+	t->ux = !(t->flags & TF_ONE_WAY) && task_is_ux(current);
+#endif
 
 	if (target_node && target_node->txn_security_ctx) {
 		u32 secid;
@@ -3315,9 +3475,27 @@ static void binder_transaction(struct binder_proc *proc,
 
 	trace_binder_transaction(reply, t, target_node);
 
-	t->buffer = binder_alloc_new_buf(&target_proc->alloc, tr->data_size,
-		tr->offsets_size, extra_buffers_size,
-		!reply && (t->flags & TF_ONE_WAY), current->tgid);
+	if (target_thread && !(!reply && (t->flags & TF_ONE_WAY)) &&
+	    binder_alloc_fast_buf_fits(tr->data_size, tr->offsets_size,
+				       extra_buffers_size)) {
+		bool hit;
+
+		t->buffer = binder_alloc_new_buf_fast(&target_proc->alloc,
+			&target_thread->fast_buf, tr->data_size,
+			tr->offsets_size, extra_buffers_size,
+			current->tgid, &hit);
+		if (hit) {
+			atomic_inc(&binder_stats.fast_buf_hit);
+			atomic_inc(&target_proc->stats.fast_buf_hit);
+		} else {
+			atomic_inc(&binder_stats.fast_buf_miss);
+			atomic_inc(&target_proc->stats.fast_buf_miss);
+		}
+	} else {
+		t->buffer = binder_alloc_new_buf(&target_proc->alloc,
+			tr->data_size, tr->offsets_size, extra_buffers_size,
+			!reply && (t->flags & TF_ONE_WAY), current->tgid);
+	}
 	if (IS_ERR(t->buffer)) {
 		/*
 		 * -ESRCH indicates VMA cleared. The target is dying.
@@ -3398,7 +3576,8 @@ static void binder_transaction(struct binder_proc *proc,
 		&& target_proc
 		&& (task_uid(target_proc->tsk).val > MIN_USERAPP_UID)
 		&& (proc->pid != target_proc->pid)
-		&& is_frozen_tg(target_proc->tsk)) {
+		&& is_frozen_tg(target_proc->tsk)
+		&& !hans_thaw_task_group(target_proc->tsk, HANS_THAW_ASYNC_BINDER)) {
 		buf_data_size = tr->data_size>INTERFACETOKEN_BUFF_SIZE ?INTERFACETOKEN_BUFF_SIZE:tr->data_size;
 		if (!copy_from_user(buf_data, (char*)tr->data.ptr.buffer, buf_data_size)) {
 			//1.skip first PARCEL_OFFSET bytes (useless data)
@@ -3632,6 +3811,8 @@ static void binder_transaction(struct binder_proc *proc,
 		binder_inner_proc_unlock(target_proc);
 		wake_up_interruptible_sync(&target_thread->wait);
 		binder_restore_priority(current, in_reply_to->saved_priority);
+		binder_restore_ux(current, in_reply_to);
+		binder_latency_replied(proc, in_reply_to);
 		binder_free_transaction(in_reply_to);
 	} else if (!(t->flags & TF_ONE_WAY)) {
 		BUG_ON(t->buffer->async_transaction != 0);
@@ -3744,6 +3925,7 @@ static void binder_transaction(struct binder_proc *proc,
 	BUG_ON(thread->return_error.cmd != BR_OK);
 	if (in_reply_to) {
 		binder_restore_priority(current, in_reply_to->saved_priority);
+		binder_restore_ux(current, in_reply_to);
 		thread->return_error.cmd = BR_TRANSACTION_COMPLETE;
 		binder_enqueue_thread_work(thread, &thread->return_error.work);
 		binder_send_failed_reply(in_reply_to, return_error);
@@ -3978,7 +4160,8 @@ static int binder_thread_write(struct binder_proc *proc,
 			}
 			trace_binder_transaction_buffer_release(buffer);
 			binder_transaction_buffer_release(proc, buffer, 0, false);
-			binder_alloc_free_buf(&proc->alloc, buffer);
+			binder_alloc_free_buf_fast(&proc->alloc,
+						   &thread->fast_buf, buffer);
 			break;
 		}
 
@@ -4351,6 +4534,7 @@ static int binder_thread_read(struct binder_proc *proc,
 						 binder_stop_on_user_error < 2);
 		}
 		binder_restore_priority(current, proc->default_priority);
+		sched_ux_binder_reset(current);
 	}
 
 	if (non_block) {
@@ -4402,6 +4586,7 @@ static int binder_thread_read(struct binder_proc *proc,
 		case BINDER_WORK_TRANSACTION: {
 			binder_inner_proc_unlock(proc);
 			t = container_of(w, struct binder_transaction, work);
+			binder_latency_dequeued(t);
 		} break;
 		case BINDER_WORK_RETURN_ERROR: {
 			struct binder_error *e = container_of(
@@ -4636,6 +4821,8 @@ static int binder_thread_read(struct binder_proc *proc,
 
 		trace_binder_transaction_received(t);
 		binder_stat_br(proc, thread, cmd);
+		if (cmd != BR_REPLY)
+			binder_latency_received(proc, t);
 		binder_debug(BINDER_DEBUG_TRANSACTION,
 			     "%d:%d %s %d %d:%d, cmd %d size %zd-%zd ptr %016llx-%016llx\n",
 			     proc->pid, thread->pid,
@@ -4914,6 +5101,7 @@ static int binder_thread_release(struct binder_proc *proc,
 	if (send_reply)
 		binder_send_failed_reply(send_reply, BR_DEAD_REPLY);
 	binder_release_work(proc, &thread->todo);
+	binder_alloc_flush_fast_buf(&proc->alloc, &thread->fast_buf);
 	binder_thread_dec_tmpref(thread);
 	return active_transactions;
 }
@@ -5584,6 +5772,19 @@ static int binder_open(struct inode *nodp, struct file *filp)
 			&proc_fops);
 	}
 
+#ifdef CONFIG_ANDROID_BINDER_LATENCY
+	if (binder_debugfs_dir_entry_latency) {
+		char strbuf[11];
+
+		/* shared between contexts, like the proc entry above */
+		snprintf(strbuf, sizeof(strbuf), "%u", proc->pid);
+		proc->latency_entry = debugfs_create_file(strbuf, 0444,
+			binder_debugfs_dir_entry_latency,
+			(void *)(unsigned long)proc->pid,
+			&binder_latency_fops);
+	}
+#endif
+
 	if (binder_binderfs_dir_entry_proc) {
 		char strbuf[11];
 		struct dentry *binderfs_entry;
@@ -5652,6 +5853,9 @@ static int binder_release(struct inode *nodp, struct file *filp)
 	struct binder_proc *proc = filp->private_data;
 
 	debugfs_remove(proc->debugfs_entry);
+#ifdef CONFIG_ANDROID_BINDER_LATENCY
+	debugfs_remove(proc->latency_entry);
+#endif
 
 	if (proc->binderfs_entry) {
 		binderfs_remove_file(proc->binderfs_entry);
@@ -6165,6 +6369,7 @@ static const char * const binder_objstat_strings[] = {
 static void print_binder_stats(struct seq_file *m, const char *prefix,
 			       struct binder_stats *stats)
 {
+	int fast_hit, fast_miss;
 	int i;
 
 	BUILD_BUG_ON(ARRAY_SIZE(stats->bc) !=
@@ -6202,6 +6407,12 @@ static void print_binder_stats(struct seq_file *m, const char *prefix,
 				created - deleted,
 				created);
 	}
+
+	fast_hit = atomic_read(&stats->fast_buf_hit);
+	fast_miss = atomic_read(&stats->fast_buf_miss);
+	if (fast_hit || fast_miss)
+		seq_printf(m, "%sfast buffers: hit %d miss %d\n",
+			   prefix, fast_hit, fast_miss);
 }
 
 static void print_binder_proc_stats(struct seq_file *m,
@@ -6509,6 +6720,100 @@ int binder_transaction_log_show(struct seq_file *m, void *unused)
 	return 0;
 }
 
+#ifdef CONFIG_ANDROID_BINDER_LATENCY
+static size_t binder_latency_fill(struct binder_proc *proc,
+				  struct binder_latency_node *rec, size_t max)
+{
+	struct rb_node *n;
+	size_t nr = 0;
+
+	binder_inner_proc_lock(proc);
+	for (n = rb_first(&proc->nodes); n && nr < max; n = rb_next(n)) {
+		struct binder_node *node = rb_entry(n, struct binder_node,
+						    rb_node);
+
+		if (!node->latency[BINDER_LATENCY_QUEUE].count)
+			continue;
+
+		rec[nr].ptr = node->ptr;
+		rec[nr].cookie = node->cookie;
+		rec[nr].debug_id = node->debug_id;
+		memcpy(rec[nr].hist, node->latency, sizeof(rec[nr].hist));
+		nr++;
+	}
+	binder_inner_proc_unlock(proc);
+
+	return nr;
+}
+
+/* Snapshot the histograms of every context @pid has open */
+static int binder_latency_open(struct inode *inode, struct file *file)
+{
+	int pid = (unsigned long)inode->i_private;
+	struct binder_latency_hdr *hdr;
+	struct binder_proc *itr;
+	struct rb_node *n;
+	size_t nr = 0, max = 0;
+
+	mutex_lock(&binder_procs_lock);
+	hlist_for_each_entry(itr, &binder_procs, proc_node) {
+		if (itr->pid != pid)
+			continue;
+		binder_inner_proc_lock(itr);
+		for (n = rb_first(&itr->nodes); n; n = rb_next(n))
+			max++;
+		binder_inner_proc_unlock(itr);
+	}
+
+	hdr = vzalloc(sizeof(*hdr) + max * sizeof(struct binder_latency_node));
+	if (!hdr) {
+		mutex_unlock(&binder_procs_lock);
+		return -ENOMEM;
+	}
+
+	hlist_for_each_entry(itr, &binder_procs, proc_node) {
+		if (itr->pid == pid)
+			nr += binder_latency_fill(itr,
+				(struct binder_latency_node *)(hdr + 1) + nr,
+				max - nr);
+	}
+	mutex_unlock(&binder_procs_lock);
+
+	hdr->version = BINDER_LATENCY_VERSION;
+	hdr->hdr_size = sizeof(*hdr);
+	hdr->node_size = sizeof(struct binder_latency_node);
+	hdr->nr_nodes = nr;
+	hdr->nr_buckets = BINDER_LATENCY_BUCKETS;
+	hdr->pid = pid;
+	file->private_data = hdr;
+
+	return 0;
+}
+
+static ssize_t binder_latency_read(struct file *file, char __user *buf,
+				   size_t count, loff_t *ppos)
+{
+	struct binder_latency_hdr *hdr = file->private_data;
+
+	return simple_read_from_buffer(buf, count, ppos, hdr, hdr->hdr_size +
+				       hdr->nr_nodes * hdr->node_size);
+}
+
+static int binder_latency_release(struct inode *inode, struct file *file)
+{
+	vfree(file->private_data);
+	return 0;
+}
+
+static const struct file_operations binder_latency_fops = {
+	.owner = THIS_MODULE,
+	.open = binder_latency_open,
+	.read = binder_latency_read,
+	.llseek = default_llseek,
+	.release = binder_latency_release,
+};
+#endif
+
 const struct file_operations binder_fops = {
 	.owner = THIS_MODULE,
 	.poll = binder_poll,
@@ -6568,6 +6873,10 @@ static int __init binder_init(void)
 	if (binder_debugfs_dir_entry_root)
 		binder_debugfs_dir_entry_proc = debugfs_create_dir("proc",
 						 binder_debugfs_dir_entry_root);
+	if (binder_debugfs_dir_entry_root &&
+	    IS_ENABLED(CONFIG_ANDROID_BINDER_LATENCY))
+		binder_debugfs_dir_entry_latency = debugfs_create_dir("latency",
+						 binder_debugfs_dir_entry_root);
 
 	if (binder_debugfs_dir_entry_root) {
 		debugfs_create_file("state",
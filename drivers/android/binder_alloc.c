@@ -398,7 +398,8 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
 				size_t offsets_size,
 				size_t extra_buffers_size,
 				int is_async,
-				int pid)
+				int pid,
+				bool fast_slot)
 {
 	struct rb_node *n = alloc->free_buffers.rb_node;
 	struct binder_buffer *buffer;
@@ -459,6 +460,9 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
 
 	/* Pad 0-size buffers so they get assigned unique addresses */
 	size = max(size, sizeof(void *));
+	/* Slot buffers all have the same size so any of them can be reused */
+	if (fast_slot)
+		size = max_t(size_t, size, BINDER_ALLOC_FAST_BUF_SIZE);
 
 	while (n) {
 		buffer = rb_entry(n, struct binder_buffer, rb_node);
@@ -560,6 +564,7 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
 	buffer->extra_buffers_size = extra_buffers_size;
 	buffer->pid = pid;
 	buffer->oneway_spam_suspect = false;
+	buffer->fast_slot = fast_slot;
 	if (is_async) {
 		alloc->free_async_space -= size + sizeof(struct binder_buffer);
 		binder_alloc_debug(BINDER_DEBUG_BUFFER_ALLOC_ASYNC,
@@ -612,7 +617,60 @@ struct binder_buffer *binder_alloc_new_buf(struct binder_alloc *alloc,
 
 	mutex_lock(&alloc->mutex);
 	buffer = binder_alloc_new_buf_locked(alloc, data_size, offsets_size,
-					     extra_buffers_size, is_async, pid);
+					     extra_buffers_size, is_async, pid,
+					     false);
+	mutex_unlock(&alloc->mutex);
+	return buffer;
+}
+
+/**
+ * binder_alloc_new_buf_fast() - Allocate a small buffer for a sync transaction
+ * @alloc:              binder_alloc for this proc
+ * @slot:               fast-path slot of the target thread
+ * @data_size:          size of user data buffer
+ * @offsets_size:       user specified buffer offset
+ * @extra_buffers_size: size of extra space for meta-data (eg, security context)
+ * @pid:                pid to attribute allocation to (used for debugging)
+ * @hit:                set to %true if the buffer came from @slot
+ *
+ * The sizes must pass binder_alloc_fast_buf_fits(). A buffer parked in
+ * @slot by binder_alloc_free_buf_fast() is still allocated and mapped, so
+ * it is reused without taking @alloc->mutex. Otherwise a slot sized
+ * buffer is allocated as binder_alloc_new_buf() would.
+ *
+ * Return:	The allocated buffer or %ERR_PTR() if error
+ */
+struct binder_buffer *binder_alloc_new_buf_fast(struct binder_alloc *alloc,
+						struct binder_buffer **slot,
+						size_t data_size,
+						size_t offsets_size,
+						size_t extra_buffers_size,
+						int pid, bool *hit)
+{
+	struct binder_buffer *buffer;
+
+	*hit = false;
+	if (WARN_ON(!binder_alloc_fast_buf_fits(data_size, offsets_size,
+						extra_buffers_size)))
+		return ERR_PTR(-EINVAL);
+
+	buffer = binder_alloc_get_vma(alloc) ? xchg(slot, NULL) : NULL;
+	if (buffer) {
+		buffer->data_size = data_size;
+		buffer->offsets_size = offsets_size;
+		buffer->extra_buffers_size = extra_buffers_size;
+		buffer->pid = pid;
+		*hit = true;
+		binder_alloc_debug(BINDER_DEBUG_BUFFER_ALLOC,
+				   "%d: binder_alloc_buf fast got %pK\n",
+				   alloc->pid, buffer);
+		return buffer;
+	}
+
+	mutex_lock(&alloc->mutex);
+	buffer = binder_alloc_new_buf_locked(alloc, data_size, offsets_size,
+					     extra_buffers_size, 0, pid,
+					     true);
 	mutex_unlock(&alloc->mutex);
 	return buffer;
 }
@@ -761,6 +819,50 @@ void binder_alloc_free_buf(struct binder_alloc *alloc,
 	mutex_unlock(&alloc->mutex);
 }
 
+/**
+ * binder_alloc_free_buf_fast() - free a buffer, parking it in a fast slot
+ * @alloc:	binder_alloc for this proc
+ * @slot:	fast-path slot of the thread freeing the buffer
+ * @buffer:	kernel pointer to buffer
+ *
+ * A buffer from binder_alloc_new_buf_fast() is kept allocated and mapped
+ * in @slot if the slot is empty, for the next small transaction to this
+ * thread. Any other buffer is freed with binder_alloc_free_buf().
+ */
+void binder_alloc_free_buf_fast(struct binder_alloc *alloc,
+				struct binder_buffer **slot,
+				struct binder_buffer *buffer)
+{
+	if (buffer->fast_slot && !buffer->async_transaction) {
+		if (buffer->clear_on_free) {
+			binder_alloc_clear_buf(alloc, buffer);
+			buffer->clear_on_free = false;
+		}
+		/*
+		 * allow_user_free is already clear, so userspace can't
+		 * free the buffer again while it sits in the slot
+		 */
+		if (!cmpxchg(slot, NULL, buffer))
+			return;
+	}
+
+	binder_alloc_free_buf(alloc, buffer);
+}
+
+/**
+ * binder_alloc_flush_fast_buf() - free the buffer parked in a fast slot
+ * @alloc:	binder_alloc for this proc
+ * @slot:	fast-path slot of a thread that is going away
+ */
+void binder_alloc_flush_fast_buf(struct binder_alloc *alloc,
+				 struct binder_buffer **slot)
+{
+	struct binder_buffer *buffer = xchg(slot, NULL);
+
+	if (buffer)
+		binder_alloc_free_buf(alloc, buffer);
+}
+
 /**
  * binder_alloc_mmap_handler() - map virtual address space for proc
  * @alloc:	alloc structure for this proc
@@ -27,6 +27,12 @@
 extern struct list_lru binder_alloc_lru;
 struct binder_transaction;
 
+/*
+ * Transactions up to this size may reuse a buffer parked in the target
+ * thread's fast-path slot instead of going through the free-buffer rbtree
+ */
+#define BINDER_ALLOC_FAST_BUF_SIZE	512
+
 /**
  * struct binder_buffer - buffer used for binder transactions
  * @entry:              entry alloc->buffers
@@ -37,6 +43,8 @@ struct binder_transaction;
  * @async_transaction:  %true if buffer is in use for an async txn
  * @oneway_spam_suspect: %true if total async allocate size just exceed
  * spamming detect threshold
+ * @fast_slot:          %true if buffer is sized to be parked in a
+ *                      thread's fast-path slot when freed
  * @debug_id:           unique ID for debugging
  * @transaction:        pointer to associated struct binder_transaction
  * @target_node:        struct binder_node associated with this buffer
@@ -58,6 +66,7 @@ struct binder_buffer {
 	unsigned async_transaction:1;
 	unsigned oneway_spam_suspect:1;
 	unsigned debug_id:27;
+	unsigned fast_slot:1;
 
 	struct binder_transaction *transaction;
 
@@ -138,6 +147,18 @@ extern struct binder_buffer *binder_alloc_new_buf(struct binder_alloc *alloc,
 						  size_t extra_buffers_size,
 						  int is_async,
 						  int pid);
+extern struct binder_buffer *
+binder_alloc_new_buf_fast(struct binder_alloc *alloc,
+			  struct binder_buffer **slot,
+			  size_t data_size,
+			  size_t offsets_size,
+			  size_t extra_buffers_size,
+			  int pid, bool *hit);
+extern void binder_alloc_free_buf_fast(struct binder_alloc *alloc,
+				       struct binder_buffer **slot,
+				       struct binder_buffer *buffer);
+extern void binder_alloc_flush_fast_buf(struct binder_alloc *alloc,
+					struct binder_buffer **slot);
 extern void binder_alloc_init(struct binder_alloc *alloc);
 extern int binder_alloc_shrinker_init(void);
 extern void binder_alloc_vma_close(struct binder_alloc *alloc);
@@ -155,6 +176,29 @@ extern void binder_alloc_print_allocated(struct seq_file *m,
 void binder_alloc_print_pages(struct seq_file *m,
 			      struct binder_alloc *alloc);
 
+/**
+ * binder_alloc_fast_buf_fits() - check if a transaction may use a fast slot
+ * @data_size:          size of user data buffer
+ * @offsets_size:       user specified buffer offset
+ * @extra_buffers_size: size of extra space for meta-data
+ *
+ * Return:	%true if the buffer fits in %BINDER_ALLOC_FAST_BUF_SIZE
+ */
+static inline bool binder_alloc_fast_buf_fits(size_t data_size,
+					      size_t offsets_size,
+					      size_t extra_buffers_size)
+{
+	if (data_size > BINDER_ALLOC_FAST_BUF_SIZE ||
+	    offsets_size > BINDER_ALLOC_FAST_BUF_SIZE ||
+	    extra_buffers_size > BINDER_ALLOC_FAST_BUF_SIZE)
+		return false;
+
+	return ALIGN(data_size, sizeof(void *)) +
+		ALIGN(offsets_size, sizeof(void *)) +
+		ALIGN(extra_buffers_size, sizeof(void *)) <=
+		BINDER_ALLOC_FAST_BUF_SIZE;
+}
+
 /**
  * binder_alloc_get_free_async_space() - get free space available for async
  * @alloc:	binder_alloc for this proc
@@ -9,7 +9,10 @@
 #include <linux/kthread.h>
 #include <linux/mm.h>
 #include <linux/moduleparam.h>
+#include <linux/msm_kgsl.h>
 #include <linux/oom.h>
+#include <linux/psi.h>
+#include <linux/simple_lmk.h>
 #include <linux/sort.h>
 #include <linux/vmpressure.h>
 #include <uapi/linux/sched/types.h>
@@ -32,7 +35,16 @@ struct victim_info {
 };
 
 static struct victim_info victims[MAX_VICTIMS] __cacheline_aligned_in_smp;
+#ifdef CONFIG_ANDROID_SIMPLE_LMK_PSI
+/* Thread group leaders with a non-negative adj, bucketed by their adj */
+#define ADJ_BUCKETS (OOM_SCORE_ADJ_MAX + 1)
+static struct hlist_head adj_index[ADJ_BUCKETS] __cacheline_aligned;
+static DECLARE_BITMAP(adj_index_map, ADJ_BUCKETS);
+static DEFINE_SPINLOCK(adj_index_lock);
+static char slmk_psi_trigger[32] = CONFIG_ANDROID_SIMPLE_LMK_PSI_TRIGGER;
+#else
 static struct task_struct *task_bucket[SHRT_MAX + 1] __cacheline_aligned;
+#endif
 static DECLARE_WAIT_QUEUE_HEAD(oom_waitq);
 static DECLARE_COMPLETION(reclaim_done);
 static __cacheline_aligned_in_smp DEFINE_RWLOCK(mm_free_lock);
@@ -56,17 +68,137 @@ static void victim_swap(void *lhs_ptr, void *rhs_ptr, int size)
 	swap(*lhs, *rhs);
 }
 
-static unsigned long get_total_mm_pages(struct mm_struct *mm)
+static unsigned long get_total_mm_pages(struct task_struct *tsk)
 {
 	unsigned long pages = 0;
 	int i;
 
 	for (i = 0; i < NR_MM_COUNTERS; i++)
-		pages += get_mm_counter(mm, i);
+		pages += get_mm_counter(tsk->mm, i);
 
-	return pages;
+	/* GPU memory is not in the mm counters but is freed on kill too */
+	return pages + kgsl_task_gpu_pages(tsk);
 }
 
+#ifdef CONFIG_ANDROID_SIMPLE_LMK_PSI
+static void adj_index_del(struct task_struct *tsk)
+{
+	short adj = tsk->simple_lmk_adj;
+
+	hlist_del_init(&tsk->simple_lmk_node);
+	if (hlist_empty(&adj_index[adj]))
+		__clear_bit(adj, adj_index_map);
+}
+
+void simple_lmk_init_task(struct task_struct *tsk)
+{
+	INIT_HLIST_NODE(&tsk->simple_lmk_node);
+}
+
+void simple_lmk_update_adj(struct task_struct *tsk)
+{
+	struct task_struct *leader = tsk->group_leader;
+	short adj = READ_ONCE(leader->signal->oom_score_adj);
+
+	spin_lock(&adj_index_lock);
+	if (!hlist_unhashed(&leader->simple_lmk_node)) {
+		if (leader->simple_lmk_adj == adj)
+			goto unlock;
+		adj_index_del(leader);
+	}
+
+	/* Only tasks with a positive adj can be targeted; see find_victims */
+	if (adj >= 0 && !(leader->flags & (PF_KTHREAD | PF_EXITING))) {
+		leader->simple_lmk_adj = adj;
+		hlist_add_head(&leader->simple_lmk_node, &adj_index[adj]);
+		__set_bit(adj, adj_index_map);
+	}
+unlock:
+	spin_unlock(&adj_index_lock);
+}
+
+void simple_lmk_task_release(struct task_struct *tsk)
+{
+	spin_lock(&adj_index_lock);
+	if (!hlist_unhashed(&tsk->simple_lmk_node))
+		adj_index_del(tsk);
+	spin_unlock(&adj_index_lock);
+}
+
+/* Returns the highest populated bucket below @adj, or ADJ_BUCKETS if none */
+static unsigned long next_adj_bucket(unsigned long adj)
+{
+	unsigned long next;
+
+	if (!adj)
+		return ADJ_BUCKETS;
+
+	next = find_last_bit(adj_index_map, adj);
+	return next < adj ? next : ADJ_BUCKETS;
+}
+
+static unsigned long find_victims(int *vindex)
+{
+	unsigned long pages_found = 0;
+	struct task_struct *tsk;
+	unsigned long adj;
+
+	/*
+	 * The index is kept up to date as oom_score_adj changes, so only the
+	 * buckets needed to satisfy MIN_FREE_PAGES are visited. RSS is read
+	 * for the tasks in those buckets alone.
+	 */
+	rcu_read_lock();
+	spin_lock(&adj_index_lock);
+	for (adj = find_last_bit(adj_index_map, ADJ_BUCKETS); adj < ADJ_BUCKETS;
+	     adj = next_adj_bucket(adj)) {
+		int old_vindex = *vindex;
+
+		hlist_for_each_entry(tsk, &adj_index[adj], simple_lmk_node) {
+			struct signal_struct *sig = tsk->signal;
+			struct task_struct *vtsk;
+
+			if (sig->flags & (SIGNAL_GROUP_EXIT |
+					  SIGNAL_GROUP_COREDUMP) ||
+			    (thread_group_empty(tsk) &&
+			     tsk->flags & PF_EXITING))
+				continue;
+
+			vtsk = find_lock_task_mm(tsk);
+			if (!vtsk)
+				continue;
+
+			/* Store this potential victim away for later */
+			victims[*vindex].tsk = vtsk;
+			victims[*vindex].mm = vtsk->mm;
+			victims[*vindex].size = get_total_mm_pages(vtsk);
+
+			/* Count the number of pages that have been found */
+			pages_found += victims[*vindex].size;
+
+			/* Make sure there's space left in the victim array */
+			if (++*vindex == MAX_VICTIMS)
+				break;
+		}
+
+		/* Go to the next bucket if nothing was found */
+		if (*vindex == old_vindex)
+			continue;
+
+		/* Prioritize killing the larger victims within this bucket */
+		sort(&victims[old_vindex], *vindex - old_vindex,
+		     sizeof(*victims), victim_cmp, victim_swap);
+
+		/* Stop when we are out of space or have enough pages found */
+		if (*vindex == MAX_VICTIMS || pages_found >= MIN_FREE_PAGES)
+			break;
+	}
+	spin_unlock(&adj_index_lock);
+	rcu_read_unlock();
+
+	return pages_found;
+}
+#else
 static unsigned long find_victims(int *vindex)
 {
 	short i, min_adj = SHRT_MAX, max_adj = 0;
@@ -127,7 +259,7 @@ static unsigned long find_victims(int *vindex)
 			/* Store this potential victim away for later */
 			victims[*vindex].tsk = vtsk;
 			victims[*vindex].mm = vtsk->mm;
-			victims[*vindex].size = get_total_mm_pages(vtsk->mm);
+			victims[*vindex].size = get_total_mm_pages(vtsk);
 
 			/* Count the number of pages that have been found */
 			pages_found += victims[*vindex].size;
@@ -161,6 +293,7 @@ static unsigned long find_victims(int *vindex)
 
 	return pages_found;
 }
+#endif
 
 static int process_victims(int vlen)
 {
@@ -192,6 +325,10 @@ static void scan_and_kill(void)
 	int i, nr_to_kill, nr_found = 0;
 	unsigned long pages_found;
 
+	/* Cached GPU pool pages can go before any process has to die */
+	if (kgsl_pool_reclaim(MIN_FREE_PAGES) >= MIN_FREE_PAGES)
+		return;
+
 	/* Populate the victims array with tasks sorted by adj and then size */
 	pages_found = find_victims(&nr_found);
 	if (unlikely(!nr_found)) {
@@ -320,6 +457,46 @@ static struct notifier_block vmpressure_notif = {
 	.priority = INT_MAX
 };
 
+#ifdef CONFIG_ANDROID_SIMPLE_LMK_PSI
+static int simple_lmk_psi_thread(void *data)
+{
+	struct psi_trigger *t = data;
+
+	set_freezable();
+
+	while (1) {
+		wait_event_freezable(t->event_wait,
+				     cmpxchg(&t->event, 1, 0) == 1);
+		simple_lmk_trigger();
+	}
+
+	return 0;
+}
+
+static int simple_lmk_register_psi(void)
+{
+	struct task_struct *thread;
+	struct psi_trigger *t;
+
+	t = psi_system_trigger_create(slmk_psi_trigger, PSI_MEM);
+	if (IS_ERR(t))
+		return PTR_ERR(t);
+
+	thread = kthread_run(simple_lmk_psi_thread, t, "simple_lmk_psi");
+	if (IS_ERR(thread)) {
+		psi_trigger_replace((void **)&t, NULL);
+		return PTR_ERR(thread);
+	}
+
+	return 0;
+}
+#else
+static int simple_lmk_register_psi(void)
+{
+	return -ENODEV;
+}
+#endif
+
 /* Initialize Simple LMK when lmkd in Android writes to the minfree parameter */
 static int simple_lmk_init_set(const char *val, const struct kernel_param *kp)
 {
@@ -332,7 +509,8 @@ static int simple_lmk_init_set(const char *val, const struct kernel_param *kp)
 		thread = kthread_run_perf_critical(cpu_lp_mask, simple_lmk_reclaim_thread,
 						   NULL, "simple_lmkd");
 		BUG_ON(IS_ERR(thread));
-		BUG_ON(vmpressure_notifier_register(&vmpressure_notif));
+		if (simple_lmk_register_psi())
+			BUG_ON(vmpressure_notifier_register(&vmpressure_notif));
 		sched_setscheduler(thread, SCHED_FIFO, &param);
 	}
 
@@ -356,3 +534,7 @@ static const struct kernel_param_ops simple_lmk_init_ops = {
 #undef MODULE_PARAM_PREFIX
 #define MODULE_PARAM_PREFIX "lowmemorykiller."
 module_param_cb(minfree, &simple_lmk_init_ops, NULL, 0200);
+#ifdef CONFIG_ANDROID_SIMPLE_LMK_PSI
+module_param_string(psi_trigger, slmk_psi_trigger, sizeof(slmk_psi_trigger),
+		    0644);
+#endif
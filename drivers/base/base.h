@@ -50,6 +50,10 @@ struct driver_private {
 	struct klist_node knode_bus;
 	struct module_kobject *mkobj;
 	struct device_driver *driver;
+	atomic_t probe_count;
+	atomic_t defer_count;
+	atomic_t dep_defer_count;
+	atomic64_t probe_time_ns;
 };
 #define to_driver(obj) container_of(obj, struct driver_private, kobj)
 
@@ -623,6 +623,23 @@ static ssize_t uevent_store(struct device_driver *drv, const char *buf,
 }
 static DRIVER_ATTR_WO(uevent);
 
+static ssize_t probe_stats_show(struct device_driver *drv, char *buf)
+{
+	struct driver_private *priv = drv->p;
+
+	return scnprintf(buf, PAGE_SIZE,
+			 "probes: %d\n"
+			 "deferrals: %d\n"
+			 "dependency_deferrals: %d\n"
+			 "probe_time_us: %lld\n",
+			 atomic_read(&priv->probe_count),
+			 atomic_read(&priv->defer_count),
+			 atomic_read(&priv->dep_defer_count),
+			 div_s64(atomic64_read(&priv->probe_time_ns),
+				 NSEC_PER_USEC));
+}
+static DRIVER_ATTR_RO(probe_stats);
+
 static void driver_attach_async(void *_drv, async_cookie_t cookie)
 {
 	struct device_driver *drv = _drv;
@@ -683,6 +700,11 @@ int bus_add_driver(struct device_driver *drv)
 		printk(KERN_ERR "%s: uevent attr (%s) failed\n",
 			__func__, drv->name);
 	}
+	error = driver_create_file(drv, &driver_attr_probe_stats);
+	if (error) {
+		printk(KERN_ERR "%s: probe_stats attr (%s) failed\n",
+			__func__, drv->name);
+	}
 	error = driver_add_groups(drv, bus->drv_groups);
 	if (error) {
 		/* How the hell do we get out of this pickle? Give up */
@@ -726,6 +748,7 @@ void bus_remove_driver(struct device_driver *drv)
 	if (!drv->suppress_bind_attrs)
 		remove_bind_files(drv);
 	driver_remove_groups(drv, drv->bus->drv_groups);
+	driver_remove_file(drv, &driver_attr_probe_stats);
 	driver_remove_file(drv, &driver_attr_uevent);
 	klist_remove(&drv->p->knode_bus);
 	pr_debug("bus: '%s': remove driver %s\n", drv->bus->name, drv->name);
@@ -28,6 +28,9 @@
 #include <linux/pm_runtime.h>
 #include <linux/pinctrl/devinfo.h>
 #include <linux/platform_device.h>
+#include <linux/of.h>
+#include <linux/of_platform.h>
+#include <soc/qcom/boot_stats.h>
 
 #include "base.h"
 #include "power/power.h"
@@ -60,6 +63,17 @@ static bool initcalls_done;
 /* Save the async probe drivers' name from kernel cmdline */
 #define ASYNC_DRV_NAMES_MAX_LEN	256
 static char async_probe_drv_names[ASYNC_DRV_NAMES_MAX_LEN];
+static bool async_probe_default;
+
+/*
+ * With "driver_probe_of_deps" on the command line, a platform device is not
+ * probed during boot while a platform device its devicetree node points at
+ * through one of the common provider bindings has no driver yet. The probe
+ * is then skipped rather than run only to defer, and the device is retried
+ * once its suppliers bind. After initcalls every device is probed as usual
+ * so a provider that never gets a driver can't hold up its consumers.
+ */
+static bool probe_of_deps;
 
 /*
  * In some cases, like suspend to RAM or hibernation, It might be reasonable
@@ -95,6 +109,7 @@ static void deferred_probe_work_func(struct work_struct *work)
 {
 	struct device *dev;
 	struct device_private *private;
+	ktime_t calltime;
 	/*
 	 * This block processes every device in the deferred 'active' list.
 	 * Each device is removed from the active list and passed to
@@ -133,10 +148,13 @@ static void deferred_probe_work_func(struct work_struct *work)
 		device_pm_unlock();
 
 		dev_dbg(dev, "Retrying from deferred list\n");
+		calltime = boot_timeline_start();
 		if (initcall_debug && !initcalls_done)
 			deferred_probe_debug(dev);
 		else
 			bus_probe_device(dev);
+		boot_timeline_event(BOOT_TIMELINE_DEFERRED_PROBE, dev_name(dev),
+				    calltime, dev->driver ? 0 : -EPROBE_DEFER);
 
 		mutex_lock(&deferred_probe_mutex);
 
@@ -376,8 +394,111 @@ EXPORT_SYMBOL_GPL(device_bind_driver);
 static atomic_t probe_count = ATOMIC_INIT(0);
 static DECLARE_WAIT_QUEUE_HEAD(probe_waitqueue);
 
+static int __init save_probe_of_deps(char *buf)
+{
+	probe_of_deps = true;
+	return 1;
+}
+__setup("driver_probe_of_deps", save_probe_of_deps);
+
+static const struct {
+	const char *list;
+	const char *cells;
+} of_dep_bindings[] = {
+	{ "clocks", "#clock-cells" },
+	{ "power-domains", "#power-domain-cells" },
+	{ "resets", "#reset-cells" },
+	{ "iommus", "#iommu-cells" },
+	{ "mboxes", "#mbox-cells" },
+	{ "interconnects", "#interconnect-cells" },
+	{ "qcom,smem-states", "#qcom,smem-state-cells" },
+};
+
+/*
+ * Check whether the platform device behind supplier node @np has yet to get
+ * a driver. Providers such as regulators are often child nodes registered
+ * by the driver of an ancestor, so walk up to the first node with a device.
+ */
+static bool of_dep_pending(struct device *dev, struct device_node *np)
+{
+	struct platform_device *pdev = NULL;
+	struct device_node *node;
+	bool pending = false;
+
+	for (node = of_node_get(np); node; node = of_get_next_parent(node)) {
+		if (of_node_check_flag(node, OF_POPULATED)) {
+			pdev = of_find_device_by_node(node);
+			break;
+		}
+		/* A child of a populated bus without a device won't get one */
+		if (node->parent &&
+		    of_node_check_flag(node->parent, OF_POPULATED_BUS))
+			break;
+	}
+	of_node_put(node);
+
+	if (!pdev)
+		return false;
+
+	if (&pdev->dev != dev && !READ_ONCE(pdev->dev.driver))
+		pending = true;
+	put_device(&pdev->dev);
+
+	return pending;
+}
+
+static bool of_deps_pending(struct device *dev)
+{
+	struct device_node *np = dev->of_node;
+	struct of_phandle_args args;
+	struct property *prop;
+	bool pending;
+	int i, j;
+
+	for (i = 0; i < ARRAY_SIZE(of_dep_bindings); i++) {
+		for (j = 0; !of_parse_phandle_with_args(np,
+				of_dep_bindings[i].list,
+				of_dep_bindings[i].cells, j, &args); j++) {
+			pending = of_dep_pending(dev, args.np);
+			of_node_put(args.np);
+			if (pending)
+				return true;
+		}
+	}
+
+	for_each_property_of_node(np, prop) {
+		size_t len = strlen(prop->name);
+		struct device_node *supplier;
+
+		if (len <= 7 || strcmp(prop->name + len - 7, "-supply"))
+			continue;
+
+		supplier = of_parse_phandle(np, prop->name, 0);
+		if (!supplier)
+			continue;
+
+		pending = of_dep_pending(dev, supplier);
+		of_node_put(supplier);
+		if (pending)
+			return true;
+	}
+
+	return false;
+}
+
+static void driver_probe_account(struct device_driver *drv, ktime_t calltime,
+				 int ret)
+{
+	atomic_inc(&drv->p->probe_count);
+	atomic64_add(ktime_to_ns(ktime_sub(ktime_get(), calltime)),
+		     &drv->p->probe_time_ns);
+	if (ret == -EPROBE_DEFER)
+		atomic_inc(&drv->p->defer_count);
+}
+
 static int really_probe(struct device *dev, struct device_driver *drv)
 {
+	ktime_t calltime;
 	int ret = -EPROBE_DEFER;
 	int local_trigger_count = atomic_read(&deferred_trigger_count);
 	bool test_remove = IS_ENABLED(CONFIG_DEBUG_TEST_DRIVER_REMOVE) &&
@@ -398,6 +519,17 @@ static int really_probe(struct device *dev, struct device_driver *drv)
 	if (ret)
 		return ret;
 
+	if (probe_of_deps && !initcalls_done && dev->of_node &&
+	    dev->bus == &platform_bus_type && of_deps_pending(dev)) {
+		dev_dbg(dev, "Driver %s waits for its suppliers\n", drv->name);
+		atomic_inc(&drv->p->dep_defer_count);
+		driver_deferred_probe_add(dev);
+		/* A supplier may have bound since we looked */
+		if (local_trigger_count != atomic_read(&deferred_trigger_count))
+			driver_deferred_probe_trigger();
+		return -EPROBE_DEFER;
+	}
+
 	atomic_inc(&probe_count);
 	pr_debug("bus: '%s': %s: probing driver %s with device %s\n",
 		 drv->bus->name, __func__, drv->name, dev_name(dev));
@@ -431,15 +563,14 @@ static int really_probe(struct device *dev, struct device_driver *drv)
 			goto probe_failed;
 	}
 
-	if (dev->bus->probe) {
+	calltime = ktime_get();
+	if (dev->bus->probe)
 		ret = dev->bus->probe(dev);
-		if (ret)
-			goto probe_failed;
-	} else if (drv->probe) {
+	else if (drv->probe)
 		ret = drv->probe(dev);
-		if (ret)
-			goto probe_failed;
-	}
+	driver_probe_account(drv, calltime, ret);
+	if (ret)
+		goto probe_failed;
 
 	if (test_remove) {
 		test_remove = false;
@@ -538,12 +669,22 @@ int driver_probe_done(void)
  */
 void wait_for_device_probe(void)
 {
+	ktime_t calltime = boot_timeline_start();
+	char caller[BOOT_TIMELINE_NAME_LEN];
+
 	/* wait for the deferred probe workqueue to finish */
 	flush_work(&deferred_probe_work);
 
 	/* wait for the known devices to complete their probing */
 	wait_event(probe_waitqueue, atomic_read(&probe_count) == 0);
 	async_synchronize_full();
+
+	if (boot_marker_enabled()) {
+		snprintf(caller, sizeof(caller), "%ps",
+			 __builtin_return_address(0));
+		boot_timeline_event(BOOT_TIMELINE_ASYNC_WAIT, caller,
+				    calltime, 0);
+	}
 }
 EXPORT_SYMBOL_GPL(wait_for_device_probe);
 
@@ -587,10 +728,17 @@ int driver_probe_device(struct device_driver *drv, struct device *dev)
 
 static inline bool cmdline_requested_async_probing(const char *drv_name)
 {
-	return parse_option_str(async_probe_drv_names, drv_name);
+	bool async_drv;
+
+	async_drv = parse_option_str(async_probe_drv_names, drv_name);
+
+	return (async_probe_default != async_drv);
 }
 
-/* The option format is "driver_async_probe=drv_name1,drv_name2,..." */
+/*
+ * The option format is "driver_async_probe=drv_name1,drv_name2,...". A "*"
+ * in the list probes every driver asynchronously except the ones listed.
+ */
 static int __init save_async_options(char *buf)
 {
 	if (strlen(buf) >= ASYNC_DRV_NAMES_MAX_LEN)
@@ -598,6 +746,7 @@ static int __init save_async_options(char *buf)
 			"Too long list of driver names for 'driver_async_probe'!\n");
 
 	strlcpy(async_probe_drv_names, buf, ASYNC_DRV_NAMES_MAX_LEN);
+	async_probe_default = parse_option_str(async_probe_drv_names, "*");
 	return 0;
 }
 __setup("driver_async_probe=", save_async_options);
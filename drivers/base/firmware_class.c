@@ -32,6 +32,7 @@
 #include <linux/syscore_ops.h>
 #include <linux/reboot.h>
 #include <linux/security.h>
+#include <soc/qcom/boot_stats.h>
 
 #include <generated/utsrelease.h>
 
@@ -1247,6 +1248,7 @@ _request_firmware(const struct firmware **firmware_p, const char *name,
 		  struct device *device, void *buf, size_t size,
 		  unsigned int opt_flags)
 {
+	ktime_t calltime = boot_timeline_start();
 	struct firmware *fw = NULL;
 	int ret;
 
@@ -1288,6 +1290,8 @@ _request_firmware(const struct firmware **firmware_p, const char *name,
 	}
 
 	*firmware_p = fw;
+	if (name)
+		boot_timeline_event(BOOT_TIMELINE_FIRMWARE, name, calltime, ret);
 	return ret;
 }
 
@@ -17,6 +17,7 @@
  * subsystem list maintains.
  */
 
+#include <linux/debugfs.h>
 #include <linux/device.h>
 #include <linux/kallsyms.h>
 #include <linux/export.h>
@@ -29,6 +30,7 @@
 #include <linux/sched.h>
 #include <linux/sched/debug.h>
 #include <linux/async.h>
+#include <linux/seq_file.h>
 #include <linux/suspend.h>
 #include <trace/events/power.h>
 #include <linux/cpufreq.h>
@@ -62,6 +64,23 @@ static pm_message_t pm_transition;
 
 static int async_error;
 
+/* pm_async_all_enabled, sampled once per transition by dpm_prepare() */
+static bool async_all;
+
+/*
+ * Per-phase callback timing. Every phase bumps dpm_phase_seq, callbacks add
+ * their duration to dev->power.cb_ns if dev->power.cb_seq matches it, and
+ * dpm_timing_report() appends the phase's longest dependency chain and its
+ * slowest devices to dpm_timing_buf, which covers the last transition.
+ */
+#define DPM_TIMING_BUF_SIZE	4096
+#define DPM_TIMING_CHAIN_MAX	8
+#define DPM_TIMING_SLOWEST	5
+
+static unsigned int dpm_phase_seq;
+static char dpm_timing_buf[DPM_TIMING_BUF_SIZE];
+static size_t dpm_timing_len;
+
 static const char *pm_verb(int event)
 {
 	switch (event) {
@@ -240,7 +259,8 @@ static void dpm_wait(struct device *dev, bool async)
 	if (!dev)
 		return;
 
-	if (async || (pm_async_enabled && dev->power.async_suspend))
+	if (async || (pm_async_enabled && (dev->power.async_suspend ||
+					   async_all)))
 		wait_for_completion(&dev->power.completion);
 }
 
@@ -473,16 +493,168 @@ static void dpm_show_time(ktime_t starttime, pm_message_t state, int error,
 		  usecs / USEC_PER_MSEC, usecs % USEC_PER_MSEC);
 }
 
+static void dpm_timing_account(struct device *dev, ktime_t starttime)
+{
+	unsigned int seq = READ_ONCE(dpm_phase_seq);
+
+	if (dev->power.cb_seq != seq) {
+		dev->power.cb_seq = seq;
+		dev->power.cb_ns = 0;
+	}
+	dev->power.cb_ns += ktime_to_ns(ktime_sub(ktime_get(), starttime));
+}
+
+static void dpm_timing_begin(void)
+{
+	WRITE_ONCE(dpm_phase_seq, dpm_phase_seq + 1);
+}
+
+static u64 dpm_cb_ns(struct device *dev)
+{
+	return dev->power.cb_seq == dpm_phase_seq ? dev->power.cb_ns : 0;
+}
+
+static u64 dpm_chain_ns(struct device *dev)
+{
+	return dev->power.chain_seq == dpm_phase_seq ? dev->power.chain_ns : 0;
+}
+
+static int dpm_chain_child_fn(struct device *dev, void *data)
+{
+	struct device **gating = data;
+
+	if (!*gating || dpm_chain_ns(dev) > dpm_chain_ns(*gating))
+		*gating = dev;
+	return 0;
+}
+
+/*
+ * Return the device @dev waited for in the current phase which finished its
+ * own chain last, that is its parent or one of its suppliers on resume and
+ * one of its children or consumers on suspend.
+ */
+static struct device *dpm_chain_gating(struct device *dev, bool resume)
+{
+	struct device *gating = NULL;
+	struct device_link *link;
+	struct device *other;
+	int idx;
+
+	if (resume)
+		gating = dev->parent;
+	else
+		device_for_each_child(dev, &gating, dpm_chain_child_fn);
+
+	idx = device_links_read_lock();
+	if (resume) {
+		list_for_each_entry_rcu(link, &dev->links.suppliers, c_node) {
+			other = link->supplier;
+			if (!gating ||
+			    dpm_chain_ns(other) > dpm_chain_ns(gating))
+				gating = other;
+		}
+	} else {
+		list_for_each_entry_rcu(link, &dev->links.consumers, s_node) {
+			other = link->consumer;
+			if (!gating ||
+			    dpm_chain_ns(other) > dpm_chain_ns(gating))
+				gating = other;
+		}
+	}
+	device_links_read_unlock(idx);
+
+	return gating && dpm_chain_ns(gating) ? gating : NULL;
+}
+
+static void dpm_timing_chain(struct device *dev, bool resume,
+			     struct device **tail, struct device **slowest)
+{
+	struct device *gating = dpm_chain_gating(dev, resume);
+	u64 cb_ns = dpm_cb_ns(dev);
+	int i, j;
+
+	dev->power.chain_ns = cb_ns + (gating ? dpm_chain_ns(gating) : 0);
+	dev->power.chain_seq = dpm_phase_seq;
+	if (!*tail || dev->power.chain_ns > dpm_chain_ns(*tail))
+		*tail = dev;
+
+	for (i = 0; i < DPM_TIMING_SLOWEST; i++) {
+		if (!slowest[i] || cb_ns > dpm_cb_ns(slowest[i]))
+			break;
+	}
+	if (i == DPM_TIMING_SLOWEST || !cb_ns)
+		return;
+	for (j = DPM_TIMING_SLOWEST - 1; j > i; j--)
+		slowest[j] = slowest[j - 1];
+	slowest[i] = dev;
+}
+
+/**
+ * dpm_timing_report - Record where the time of a suspend or resume phase went.
+ * @list: List the devices handled in the phase ended up on.
+ * @resume: Whether this was a resume phase.
+ * @phase: Name of the phase.
+ * @starttime: Time the phase started.
+ *
+ * The chain of a device is its own callback time plus the chain of the
+ * device it waited for that completed last, so the longest chain is the
+ * least the phase can take however parallel it is.
+ */
+static void dpm_timing_report(struct list_head *list, bool resume,
+			      const char *phase, ktime_t starttime)
+{
+	struct device *slowest[DPM_TIMING_SLOWEST] = { NULL };
+	struct device *chain[DPM_TIMING_CHAIN_MAX];
+	struct device *dev, *tail = NULL;
+	char *buf = dpm_timing_buf;
+	size_t size = DPM_TIMING_BUF_SIZE, len;
+	int i, n = 0;
+
+	mutex_lock(&dpm_list_mtx);
+
+	/* Visit the devices in the order they were handled in */
+	if (resume) {
+		list_for_each_entry(dev, list, power.entry)
+			dpm_timing_chain(dev, resume, &tail, slowest);
+	} else {
+		list_for_each_entry_reverse(dev, list, power.entry)
+			dpm_timing_chain(dev, resume, &tail, slowest);
+	}
+
+	for (dev = tail; dev && n < DPM_TIMING_CHAIN_MAX;
+	     dev = dpm_chain_gating(dev, resume))
+		chain[n++] = dev;
+
+	len = dpm_timing_len;
+	len += scnprintf(buf + len, size - len,
+			 "%s: %lld us, longest chain %llu us%s\n", phase,
+			 ktime_to_us(ktime_sub(ktime_get(), starttime)),
+			 tail ? div_u64(dpm_chain_ns(tail), NSEC_PER_USEC) : 0,
+			 async_all ? " (async all)" : "");
+	for (i = n - 1; i >= 0; i--)
+		len += scnprintf(buf + len, size - len, "  chain %s %llu us\n",
+				 dev_name(chain[i]),
+				 div_u64(dpm_cb_ns(chain[i]), NSEC_PER_USEC));
+	for (i = 0; i < DPM_TIMING_SLOWEST && slowest[i]; i++)
+		len += scnprintf(buf + len, size - len, "  slow %s %llu us\n",
+				 dev_name(slowest[i]),
+				 div_u64(dpm_cb_ns(slowest[i]), NSEC_PER_USEC));
+	dpm_timing_len = len;
+
+	mutex_unlock(&dpm_list_mtx);
+}
+
 static int dpm_run_callback(pm_callback_t cb, struct device *dev,
 			    pm_message_t state, const char *info)
 {
-	ktime_t calltime;
+	ktime_t calltime, starttime;
 	int error;
 
 	if (!cb)
 		return 0;
 
 	calltime = initcall_debug_start(dev);
+	starttime = ktime_get();
 
 	pm_dev_dbg(dev, state, info);
 	trace_device_pm_callback_start(dev, info, state.event);
@@ -490,6 +662,7 @@ static int dpm_run_callback(pm_callback_t cb, struct device *dev,
 	trace_device_pm_callback_end(dev, error);
 	suspend_report_result(cb, error);
 
+	dpm_timing_account(dev, starttime);
 	initcall_debug_report(dev, calltime, error, state, info);
 
 	return error;
@@ -619,7 +792,7 @@ static int device_resume_noirq(struct device *dev, pm_message_t state, bool asyn
 
 static bool is_async(struct device *dev)
 {
-	return dev->power.async_suspend && pm_async_enabled
+	return (dev->power.async_suspend || async_all) && pm_async_enabled
 		&& !pm_trace_is_enabled();
 }
 
@@ -641,6 +814,7 @@ void dpm_noirq_resume_devices(pm_message_t state)
 	ktime_t starttime = ktime_get();
 
 	trace_suspend_resume(TPS("dpm_resume_noirq"), state.event, true);
+	dpm_timing_begin();
 	mutex_lock(&dpm_list_mtx);
 	pm_transition = state;
 
@@ -681,6 +855,7 @@ void dpm_noirq_resume_devices(pm_message_t state)
 	mutex_unlock(&dpm_list_mtx);
 	async_synchronize_full();
 	dpm_show_time(starttime, state, 0, "noirq");
+	dpm_timing_report(&dpm_late_early_list, true, "resume_noirq", starttime);
 	trace_suspend_resume(TPS("dpm_resume_noirq"), state.event, false);
 }
 
@@ -785,6 +960,7 @@ void dpm_resume_early(pm_message_t state)
 #endif
 
 	trace_suspend_resume(TPS("dpm_resume_early"), state.event, true);
+	dpm_timing_begin();
 	mutex_lock(&dpm_list_mtx);
 	pm_transition = state;
 
@@ -824,6 +1000,7 @@ void dpm_resume_early(pm_message_t state)
 	mutex_unlock(&dpm_list_mtx);
 	async_synchronize_full();
 	dpm_show_time(starttime, state, 0, "early");
+	dpm_timing_report(&dpm_suspended_list, true, "resume_early", starttime);
 	trace_suspend_resume(TPS("dpm_resume_early"), state.event, false);
 }
 
@@ -961,6 +1138,7 @@ void dpm_resume(pm_message_t state)
 	trace_suspend_resume(TPS("dpm_resume"), state.event, true);
 	might_sleep();
 
+	dpm_timing_begin();
 	mutex_lock(&dpm_list_mtx);
 	pm_transition = state;
 	async_error = 0;
@@ -998,6 +1176,7 @@ void dpm_resume(pm_message_t state)
 	mutex_unlock(&dpm_list_mtx);
 	async_synchronize_full();
 	dpm_show_time(starttime, state, 0, NULL);
+	dpm_timing_report(&dpm_prepared_list, true, "resume", starttime);
 
 	cpufreq_resume();
 	trace_suspend_resume(TPS("dpm_resume"), state.event, false);
@@ -1227,6 +1406,7 @@ int dpm_noirq_suspend_devices(pm_message_t state)
 	int error = 0;
 
 	trace_suspend_resume(TPS("dpm_suspend_noirq"), state.event, true);
+	dpm_timing_begin();
 	mutex_lock(&dpm_list_mtx);
 	pm_transition = state;
 	async_error = 0;
@@ -1263,6 +1443,7 @@ int dpm_noirq_suspend_devices(pm_message_t state)
 		dpm_save_failed_step(SUSPEND_SUSPEND_NOIRQ);
 	}
 	dpm_show_time(starttime, state, error, "noirq");
+	dpm_timing_report(&dpm_noirq_list, false, "suspend_noirq", starttime);
 	trace_suspend_resume(TPS("dpm_suspend_noirq"), state.event, false);
 	return error;
 }
@@ -1388,6 +1569,7 @@ int dpm_suspend_late(pm_message_t state)
 	int error = 0;
 
 	trace_suspend_resume(TPS("dpm_suspend_late"), state.event, true);
+	dpm_timing_begin();
 	mutex_lock(&dpm_list_mtx);
 	pm_transition = state;
 	async_error = 0;
@@ -1425,6 +1607,8 @@ int dpm_suspend_late(pm_message_t state)
 		dpm_resume_early(resume_event(state));
 	}
 	dpm_show_time(starttime, state, error, "late");
+	dpm_timing_report(&dpm_late_early_list, false, "suspend_late",
+			  starttime);
 	trace_suspend_resume(TPS("dpm_suspend_late"), state.event, false);
 	return error;
 }
@@ -1461,15 +1645,17 @@ static int legacy_suspend(struct device *dev, pm_message_t state,
 			  const char *info)
 {
 	int error;
-	ktime_t calltime;
+	ktime_t calltime, starttime;
 
 	calltime = initcall_debug_start(dev);
+	starttime = ktime_get();
 
 	trace_device_pm_callback_start(dev, info, state.event);
 	error = cb(dev, state);
 	trace_device_pm_callback_end(dev, error);
 	suspend_report_result(cb, error);
 
+	dpm_timing_account(dev, starttime);
 	initcall_debug_report(dev, calltime, error, state, info);
 
 	return error;
@@ -1672,6 +1858,7 @@ int dpm_suspend(pm_message_t state)
 
 	cpufreq_suspend();
 
+	dpm_timing_begin();
 	mutex_lock(&dpm_list_mtx);
 	pm_transition = state;
 	async_error = 0;
@@ -1705,6 +1892,7 @@ int dpm_suspend(pm_message_t state)
 		dpm_save_failed_step(SUSPEND_SUSPEND);
 	}
 	dpm_show_time(starttime, state, error, NULL);
+	dpm_timing_report(&dpm_suspended_list, false, "suspend", starttime);
 	trace_suspend_resume(TPS("dpm_suspend"), state.event, false);
 	return error;
 }
@@ -1806,6 +1994,8 @@ int dpm_prepare(pm_message_t state)
 	device_block_probing();
 
 	mutex_lock(&dpm_list_mtx);
+	async_all = READ_ONCE(pm_async_all_enabled);
+	dpm_timing_len = 0;
 	while (!list_empty(&dpm_list)) {
 		struct device *dev = to_device(dpm_list.next);
 
@@ -1935,3 +2125,33 @@ void device_pm_check_callbacks(struct device *dev)
 		 !dev->driver->suspend && !dev->driver->resume));
 	spin_unlock_irqrestore(&dev->power.lock, flags);
 }
+
+static int dpm_timing_show(struct seq_file *m, void *unused)
+{
+	mutex_lock(&dpm_list_mtx);
+	seq_write(m, dpm_timing_buf, dpm_timing_len);
+	mutex_unlock(&dpm_list_mtx);
+
+	return 0;
+}
+
+static int dpm_timing_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, dpm_timing_show, NULL);
+}
+
+static const struct file_operations dpm_timing_fops = {
+	.owner = THIS_MODULE,
+	.open = dpm_timing_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int __init dpm_timing_debugfs_init(void)
+{
+	debugfs_create_file("suspend_timing", 0444, NULL, NULL,
+			    &dpm_timing_fops);
+	return 0;
+}
+late_initcall(dpm_timing_debugfs_init);
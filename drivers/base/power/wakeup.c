@@ -27,6 +27,8 @@
 #include <linux/irq.h>
 #include <linux/interrupt.h>
 #include <linux/irqdesc.h>
+#include <linux/vmalloc.h>
+#include <uapi/linux/wakeup_stats.h>
 
 #ifdef OPLUS_FEATURE_POWERINFO_STANDBY
 //Nanwei.Deng@BSP.Power.Basic, 2020/07/27, add for wakelock profiler
@@ -179,6 +181,7 @@ EXPORT_SYMBOL_GPL(wakeup_source_drop);
 static void wakeup_source_record(struct wakeup_source *ws)
 {
 	unsigned long flags;
+	int i;
 
 	spin_lock_irqsave(&deleted_ws.lock, flags);
 
@@ -196,6 +199,8 @@ static void wakeup_source_record(struct wakeup_source *ws)
 		deleted_ws.relax_count += ws->relax_count;
 		deleted_ws.expire_count += ws->expire_count;
 		deleted_ws.wakeup_count += ws->wakeup_count;
+		for (i = 0; i < WAKEUP_HOLD_HIST_BUCKETS; i++)
+			deleted_ws.hold_hist[i] += ws->hold_hist[i];
 	}
 
 	spin_unlock_irqrestore(&deleted_ws.lock, flags);
@@ -801,6 +806,8 @@ static void wakeup_source_deactivate(struct wakeup_source *ws)
 	ws->total_time = ktime_add(ws->total_time, duration);
 	if (ktime_to_ns(duration) > ktime_to_ns(ws->max_time))
 		ws->max_time = duration;
+	ws->hold_hist[min_t(int, fls64(ktime_to_ms(duration)),
+			    WAKEUP_HOLD_HIST_BUCKETS - 1)]++;
 
 	ws->last_time = now;
 	del_timer(&ws->timer);
@@ -1316,6 +1323,121 @@ static const struct file_operations wakeup_sources_stats_fops = {
 #endif /* OPLUS_FEATURE_LOGKIT */
 };
 
+/* Room for wakeup sources registered between counting and copying them */
+#define WAKEUP_STATS_SLACK	16
+#define WAKEUP_STATS_MAX_IRQS	32
+
+static void wakeup_stats_fill_ws(struct wakeup_stats_ws *rec,
+				 struct wakeup_source *ws, ktime_t now)
+{
+	unsigned long flags;
+	ktime_t active_time;
+
+	spin_lock_irqsave(&ws->lock, flags);
+
+	strlcpy(rec->name, ws->name, sizeof(rec->name));
+	rec->total_time_ns = ktime_to_ns(ws->total_time);
+	rec->max_time_ns = ktime_to_ns(ws->max_time);
+	rec->prevent_sleep_time_ns = ktime_to_ns(ws->prevent_sleep_time);
+	if (ws->active) {
+		active_time = ktime_sub(now, ws->last_time);
+		rec->total_time_ns += ktime_to_ns(active_time);
+		if (ktime_to_ns(active_time) > rec->max_time_ns)
+			rec->max_time_ns = ktime_to_ns(active_time);
+		if (ws->autosleep_enabled)
+			rec->prevent_sleep_time_ns += ktime_to_ns(
+				ktime_sub(now, ws->start_prevent_time));
+	}
+	rec->active_count = ws->active_count;
+	rec->event_count = ws->event_count;
+	rec->wakeup_count = ws->wakeup_count;
+	rec->expire_count = ws->expire_count;
+	rec->active = ws->active;
+	memcpy(rec->hold_hist, ws->hold_hist, sizeof(rec->hold_hist));
+
+	spin_unlock_irqrestore(&ws->lock, flags);
+}
+
+/*
+ * Build a binary snapshot of all wakeup sources and of the IRQs that woke
+ * the system up, laid out as described in uapi/linux/wakeup_stats.h.
+ */
+static int wakeup_stats_open(struct inode *inode, struct file *file)
+{
+	struct wakeup_stats_hdr *hdr;
+	struct wakeup_stats_ws *ws_recs;
+	struct wakeup_stats_irq *irq_recs;
+	struct wakeup_source *ws;
+	unsigned int nr_ws = 0, max_ws;
+	ktime_t now = ktime_get();
+	size_t size;
+	int srcuidx;
+
+	BUILD_BUG_ON(WAKEUP_HOLD_HIST_BUCKETS != WAKEUP_STATS_HOLD_BUCKETS);
+
+	srcuidx = srcu_read_lock(&wakeup_srcu);
+	list_for_each_entry_rcu(ws, &wakeup_sources, entry)
+		nr_ws++;
+	srcu_read_unlock(&wakeup_srcu, srcuidx);
+
+	/* One more for deleted_ws */
+	max_ws = nr_ws + 1 + WAKEUP_STATS_SLACK;
+	size = sizeof(*hdr) + max_ws * sizeof(*ws_recs) +
+		WAKEUP_STATS_MAX_IRQS * sizeof(*irq_recs);
+	hdr = vzalloc(size);
+	if (!hdr)
+		return -ENOMEM;
+
+	ws_recs = (void *)(hdr + 1);
+	nr_ws = 0;
+	srcuidx = srcu_read_lock(&wakeup_srcu);
+	list_for_each_entry_rcu(ws, &wakeup_sources, entry) {
+		if (nr_ws == max_ws - 1)
+			break;
+		wakeup_stats_fill_ws(&ws_recs[nr_ws++], ws, now);
+	}
+	srcu_read_unlock(&wakeup_srcu, srcuidx);
+	wakeup_stats_fill_ws(&ws_recs[nr_ws++], &deleted_ws, now);
+
+	irq_recs = (void *)&ws_recs[nr_ws];
+	hdr->nr_irqs = wakeup_reason_stats(hdr, irq_recs,
+					   WAKEUP_STATS_MAX_IRQS);
+	hdr->version = WAKEUP_STATS_VERSION;
+	hdr->hdr_size = sizeof(*hdr);
+	hdr->ws_size = sizeof(*ws_recs);
+	hdr->nr_ws = nr_ws;
+	hdr->irq_size = sizeof(*irq_recs);
+	hdr->timestamp_ns = ktime_to_ns(now);
+
+	file->private_data = hdr;
+
+	return 0;
+}
+
+static ssize_t wakeup_stats_read(struct file *file, char __user *buf,
+				 size_t count, loff_t *ppos)
+{
+	struct wakeup_stats_hdr *hdr = file->private_data;
+	size_t size = hdr->hdr_size + hdr->nr_ws * hdr->ws_size +
+		hdr->nr_irqs * hdr->irq_size;
+
+	return simple_read_from_buffer(buf, count, ppos, hdr, size);
+}
+
+static int wakeup_stats_release(struct inode *inode, struct file *file)
+{
+	vfree(file->private_data);
+	return 0;
+}
+
+static const struct file_operations wakeup_stats_fops = {
+	.owner = THIS_MODULE,
+	.open = wakeup_stats_open,
+	.read = wakeup_stats_read,
+	.llseek = default_llseek,
+	.release = wakeup_stats_release,
+};
+
 static int __init wakeup_sources_debugfs_init(void)
 {
 	#ifndef OPLUS_FEATURE_LOGKIT
@@ -1326,6 +1448,8 @@ static int __init wakeup_sources_debugfs_init(void)
 	wakeup_sources_stats_dentry = debugfs_create_file("wakeup_sources",
 			S_IRUGO| S_IWUGO, NULL, NULL, &wakeup_sources_stats_fops);
 	#endif /* OPLUS_FEATURE_LOGKIT */
+	debugfs_create_file("wakeup_stats", 0400, NULL, NULL,
+			    &wakeup_stats_fops);
 
 	#ifdef OPLUS_FEATURE_POWERINFO_STANDBY
 	//SunFaliang@BSP.Power.Basic, 2020/11/18, add for standby monitor
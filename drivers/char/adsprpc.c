@@ -23,6 +23,7 @@
 #include <linux/cdev.h>
 #include <linux/list.h>
 #include <linux/hash.h>
+#include <linux/interval_tree_generic.h>
 #include <linux/msm_ion.h>
 #include <soc/qcom/secure_buffer.h>
 #include <linux/rpmsg.h>
@@ -32,6 +33,7 @@
 #include <soc/qcom/service-locator.h>
 #include <linux/scatterlist.h>
 #include <linux/fs.h>
+#include <linux/poll.h>
 #include <linux/uaccess.h>
 #include <linux/device.h>
 #include <linux/of.h>
@@ -79,6 +81,14 @@
 #define SESSION_ID_INDEX (30)
 #define FASTRPC_CTX_MAGIC (0xbeeddeed)
 #define FASTRPC_CTX_MAX (256)
+/* Async invokes one file may have outstanding, so it cannot starve others */
+#define FASTRPC_MAX_ASYNC_JOBS (64)
+/* Per-file table of recently invoked methods, used to decide on polling */
+#define FASTRPC_METHOD_STATS_BITS (5)
+#define FASTRPC_POLL_DEFAULT_US (200)
+#define FASTRPC_POLL_MAX_US (10000)
+/* Invokes of a method seen before its average is trusted */
+#define FASTRPC_POLL_MIN_CALLS (4)
 #define FASTRPC_CTXID_MASK (0xFF0)
 #define NUM_DEVICES   2 /* adsprpc-smd, adsprpc-smd-secure */
 #define MINOR_NUM_DEV 0
@@ -108,6 +118,9 @@
 #define INIT_FILELEN_MAX (2*1024*1024)
 #define INIT_MEMLEN_MAX  (8*1024*1024)
 #define MAX_CACHE_BUF_SIZE (8*1024*1024)
+/* Cached buffers are kept per page order, the last class takes the rest */
+#define FASTRPC_BUF_CACHE_CLASSES (12)
+#define FASTRPC_MAX_CACHED_BUFS (64)
 
 #define PERF_END (void)0
 
@@ -234,6 +247,19 @@ struct smq_invoke_ctx {
 	unsigned int magic;
 	uint64_t ctxid;
 	bool pm_awake_voted;
+	/* Set for FASTRPC_IOCTL_INVOKE_ASYNC, the response is queued on fl */
+	bool is_async;
+	bool async_queued;
+	uint64_t job_id;
+	struct list_head asyncn;
+};
+
+struct fastrpc_method_stat {
+	uint32_t handle;
+	uint32_t sc;
+	uint64_t avg_ns;	/* moving average of the DSP round trip */
+	uint64_t calls;
+	uint64_t polled;	/* calls that completed while polling */
 };
 
 struct fastrpc_ctx_lst {
@@ -326,6 +352,9 @@ struct fastrpc_apps {
 
 struct fastrpc_mmap {
 	struct hlist_node hn;
+	/* Node in fl->maps_tree, indexed by [va, va + len] */
+	struct rb_node rb;
+	uintptr_t rb_subtree_last;
 	struct fastrpc_file *fl;
 	struct fastrpc_apps *apps;
 	int fd;
@@ -377,7 +406,23 @@ struct fastrpc_file {
 	struct hlist_node hn;
 	spinlock_t hlock;
 	struct hlist_head maps;
-	struct hlist_head cached_bufs;
+	struct rb_root_cached maps_tree;
+	struct hlist_head cached_bufs[FASTRPC_BUF_CACHE_CLASSES];
+	unsigned int num_cached_buf;
+	uint64_t buf_cache_hits;
+	uint64_t buf_cache_misses;
+	/* Invokes completed and the time spent waiting on the DSP */
+	atomic64_t invoke_count;
+	atomic64_t invoke_wait_ns;
+	/* Completed async invokes waiting for FASTRPC_IOCTL_ASYNC_RESPONSE */
+	spinlock_t async_lock;
+	struct list_head async_done;
+	wait_queue_head_t async_wait;
+	atomic_t async_jobs;
+	/* Spin for the response of short invokes instead of sleeping */
+	uint32_t poll_mode;
+	uint32_t poll_timeout_us;
+	struct fastrpc_method_stat method_stats[1 << FASTRPC_METHOD_STATS_BITS];
 	struct hlist_head remote_bufs;
 	struct fastrpc_ctx_lst clst;
 	struct fastrpc_session_ctx *sctx;
@@ -520,6 +565,11 @@ static inline int64_t *getperfcounter(struct fastrpc_file *fl, int key)
 }
 
 
+static inline int fastrpc_buf_class(size_t size)
+{
+	return min_t(int, get_order(size), FASTRPC_BUF_CACHE_CLASSES - 1);
+}
+
 static void fastrpc_buf_free(struct fastrpc_buf *buf, int cache)
 {
 	struct fastrpc_file *fl = buf == NULL ? NULL : buf->fl;
@@ -530,9 +580,14 @@ static void fastrpc_buf_free(struct fastrpc_buf *buf, int cache)
 		return;
 	if (cache && buf->size < MAX_CACHE_BUF_SIZE) {
 		spin_lock(&fl->hlock);
-		hlist_add_head(&buf->hn, &fl->cached_bufs);
+		if (fl->num_cached_buf < FASTRPC_MAX_CACHED_BUFS) {
+			hlist_add_head(&buf->hn,
+				&fl->cached_bufs[fastrpc_buf_class(buf->size)]);
+			fl->num_cached_buf++;
+			spin_unlock(&fl->hlock);
+			return;
+		}
 		spin_unlock(&fl->hlock);
-		return;
 	}
 	if (buf->remote) {
 		spin_lock(&fl->hlock);
@@ -566,17 +621,20 @@ static void fastrpc_buf_free(struct fastrpc_buf *buf, int cache)
 
 static void fastrpc_cached_buf_list_free(struct fastrpc_file *fl)
 {
-	struct fastrpc_buf *buf, *free;
+	struct fastrpc_buf *free;
+	int i;
 
 	do {
-		struct hlist_node *n;
-
 		free = NULL;
 		spin_lock(&fl->hlock);
-		hlist_for_each_entry_safe(buf, n, &fl->cached_bufs, hn) {
-			hlist_del_init(&buf->hn);
-			free = buf;
-			break;
+		for (i = 0; i < FASTRPC_BUF_CACHE_CLASSES; i++) {
+			free = hlist_entry_safe(fl->cached_bufs[i].first,
+						struct fastrpc_buf, hn);
+			if (free) {
+				hlist_del_init(&free->hn);
+				fl->num_cached_buf--;
+				break;
+			}
 		}
 		spin_unlock(&fl->hlock);
 		if (free)
@@ -584,6 +642,37 @@ static void fastrpc_cached_buf_list_free(struct fastrpc_file *fl)
 	} while (free);
 }
 
+/*
+ * Takes the best fitting buffer of at least @size from the cache: the
+ * smallest one in the size class of @size, or else any one from the
+ * smallest larger class, all of which fit.
+ */
+static struct fastrpc_buf *fastrpc_cached_buf_get(struct fastrpc_file *fl,
+						  size_t size)
+{
+	struct fastrpc_buf *buf, *fr = NULL;
+	int i = fastrpc_buf_class(size);
+
+	spin_lock(&fl->hlock);
+	hlist_for_each_entry(buf, &fl->cached_bufs[i], hn) {
+		if (buf->size >= size && (!fr || fr->size > buf->size))
+			fr = buf;
+	}
+	while (!fr && ++i < FASTRPC_BUF_CACHE_CLASSES)
+		fr = hlist_entry_safe(fl->cached_bufs[i].first,
+				      struct fastrpc_buf, hn);
+	if (fr) {
+		hlist_del_init(&fr->hn);
+		fl->num_cached_buf--;
+		fl->buf_cache_hits++;
+	} else {
+		fl->buf_cache_misses++;
+	}
+	spin_unlock(&fl->hlock);
+
+	return fr;
+}
+
 static void fastrpc_remote_buf_list_free(struct fastrpc_file *fl)
 {
 	struct fastrpc_buf *buf, *free;
@@ -603,6 +692,23 @@ static void fastrpc_remote_buf_list_free(struct fastrpc_file *fl)
 	} while (free);
 }
 
+#define FASTRPC_MMAP_START(map) ((map)->va)
+#define FASTRPC_MMAP_LAST(map) ((map)->va + (map)->len)
+
+INTERVAL_TREE_DEFINE(struct fastrpc_mmap, rb, uintptr_t, rb_subtree_last,
+		     FASTRPC_MMAP_START, FASTRPC_MMAP_LAST, static,
+		     fastrpc_mmap_tree)
+
+/* Takes a per-file map off fl->maps, safe to call more than once */
+static void fastrpc_mmap_unlink(struct fastrpc_mmap *map)
+{
+	hlist_del_init(&map->hn);
+	if (!RB_EMPTY_NODE(&map->rb)) {
+		fastrpc_mmap_tree_remove(map, &map->fl->maps_tree);
+		RB_CLEAR_NODE(&map->rb);
+	}
+}
+
 static void fastrpc_mmap_add(struct fastrpc_mmap *map)
 {
 	if (map->flags == ADSP_MMAP_HEAP_ADDR ||
@@ -616,6 +722,7 @@ static void fastrpc_mmap_add(struct fastrpc_mmap *map)
 		struct fastrpc_file *fl = map->fl;
 
 		hlist_add_head(&map->hn, &fl->maps);
+		fastrpc_mmap_tree_insert(map, &fl->maps_tree);
 	}
 }
 
@@ -649,7 +756,10 @@ static int fastrpc_mmap_find(struct fastrpc_file *fl, int fd,
 		}
 		spin_unlock(&me->hlock);
 	} else {
-		hlist_for_each_entry_safe(map, n, &fl->maps, hn) {
+		for (map = fastrpc_mmap_tree_iter_first(&fl->maps_tree, va,
+							va + len);
+		     map;
+		     map = fastrpc_mmap_tree_iter_next(map, va, va + len)) {
 			if (va >= map->va &&
 				va + len <= map->va + map->len &&
 				map->fd == fd) {
@@ -726,7 +836,7 @@ static int fastrpc_mmap_remove(struct fastrpc_file *fl, uintptr_t va,
 			/*Remove map if not used in process initialization*/
 			!map->is_filemap) {
 			match = map;
-			hlist_del_init(&map->hn);
+			fastrpc_mmap_unlink(map);
 			break;
 		}
 	}
@@ -770,7 +880,7 @@ static void fastrpc_mmap_free(struct fastrpc_mmap *map, uint32_t flags)
 	} else {
 		map->refs--;
 		if (!map->refs)
-			hlist_del_init(&map->hn);
+			fastrpc_mmap_unlink(map);
 		if (map->refs > 0 && !flags)
 			return;
 	}
@@ -853,6 +963,7 @@ static int fastrpc_mmap_create(struct fastrpc_file *fl, int fd,
 	if (err)
 		goto bail;
 	INIT_HLIST_NODE(&map->hn);
+	RB_CLEAR_NODE(&map->rb);
 	map->flags = mflags;
 	map->refs = 1;
 	map->fl = fl;
@@ -1023,7 +1134,6 @@ static int fastrpc_buf_alloc(struct fastrpc_file *fl, size_t size,
 {
 	int err = 0, vmid;
 	struct fastrpc_buf *buf = NULL, *fr = NULL;
-	struct hlist_node *n;
 
 	VERIFY(err, size > 0 && size < MAX_SIZE_LIMIT);
 	if (err) {
@@ -1032,15 +1142,7 @@ static int fastrpc_buf_alloc(struct fastrpc_file *fl, size_t size,
 	}
 
 	if (!remote) {
-		/* find the smallest buffer that fits in the cache */
-		spin_lock(&fl->hlock);
-		hlist_for_each_entry_safe(buf, n, &fl->cached_bufs, hn) {
-			if (buf->size >= size && (!fr || fr->size > buf->size))
-				fr = buf;
-		}
-		if (fr)
-			hlist_del_init(&fr->hn);
-		spin_unlock(&fl->hlock);
+		fr = fastrpc_cached_buf_get(fl, size);
 		if (fr) {
 			*obuf = fr;
 			return 0;
@@ -1244,6 +1346,7 @@ static int context_alloc(struct fastrpc_file *fl, uint32_t kernel,
 
 	INIT_HLIST_NODE(&ctx->hn);
 	hlist_add_fake(&ctx->hn);
+	INIT_LIST_HEAD(&ctx->asyncn);
 	ctx->fl = fl;
 	ctx->maps = (struct fastrpc_mmap **)(&ctx[1]);
 	ctx->lpra = (remote_arg_t *)(&ctx->maps[bufs]);
@@ -1349,15 +1452,52 @@ static void context_free(struct smq_invoke_ctx *ctx)
 	}
 	spin_unlock(&me->ctxlock);
 
+	if (ctx->is_async) {
+		unsigned long flags;
+
+		spin_lock_irqsave(&ctx->fl->async_lock, flags);
+		list_del_init(&ctx->asyncn);
+		spin_unlock_irqrestore(&ctx->fl->async_lock, flags);
+		atomic_dec(&ctx->fl->async_jobs);
+		fastrpc_pm_relax(&ctx->pm_awake_voted,
+			gcinfo[ctx->fl->cid].secure);
+	}
 	kfree(ctx);
 }
 
+/*
+ * Queue a finished async invoke for its file. Output buffers are copied
+ * back by the thread that reaps it, since this may run in the response
+ * callback.
+ */
+static void context_queue_async(struct smq_invoke_ctx *ctx)
+{
+	struct fastrpc_file *fl = ctx->fl;
+	unsigned long flags;
+
+	spin_lock_irqsave(&fl->async_lock, flags);
+	if (!ctx->async_queued) {
+		ctx->async_queued = true;
+		list_add_tail(&ctx->asyncn, &fl->async_done);
+	}
+	spin_unlock_irqrestore(&fl->async_lock, flags);
+	wake_up_interruptible(&fl->async_wait);
+}
+
+static void context_complete(struct smq_invoke_ctx *ctx)
+{
+	if (ctx->is_async)
+		context_queue_async(ctx);
+	else
+		complete(&ctx->work);
+}
+
 static void context_notify_user(struct smq_invoke_ctx *ctx, int retval)
 {
 	ctx->retval = retval;
 	fastrpc_pm_awake(ctx->fl->wake_enable, &ctx->pm_awake_voted,
 		gcinfo[ctx->fl->cid].secure);
-	complete(&ctx->work);
+	context_complete(ctx);
 }
 
 
@@ -1368,7 +1508,7 @@ static void fastrpc_notify_users(struct fastrpc_file *me)
 
 	spin_lock(&me->hlock);
 	hlist_for_each_entry_safe(ictx, n, &me->clst.pending, hn) {
-		complete(&ictx->work);
+		context_complete(ictx);
 	}
 	hlist_for_each_entry_safe(ictx, n, &me->clst.interrupted, hn) {
 		complete(&ictx->work);
@@ -1386,7 +1526,7 @@ static void fastrpc_notify_users_staticpd_pdr(struct fastrpc_file *me)
 	spin_lock(&me->hlock);
 	hlist_for_each_entry_safe(ictx, n, &me->clst.pending, hn) {
 		if (ictx->msg.pid)
-			complete(&ictx->work);
+			context_complete(ictx);
 	}
 	hlist_for_each_entry_safe(ictx, n, &me->clst.interrupted, hn) {
 		if (ictx->msg.pid)
@@ -1973,6 +2113,78 @@ static inline void fastrpc_pm_relax(bool *pm_awake_voted, int channel_type)
 	*pm_awake_voted = false;
 }
 
+static struct fastrpc_method_stat *fastrpc_method_stat(
+			struct fastrpc_file *fl, struct smq_invoke_ctx *ctx)
+{
+	return &fl->method_stats[hash_32(ctx->handle ^ ctx->sc,
+					FASTRPC_METHOD_STATS_BITS)];
+}
+
+static bool fastrpc_poll_wanted(struct fastrpc_file *fl,
+				struct smq_invoke_ctx *ctx)
+{
+	struct fastrpc_method_stat *stat;
+	bool wanted;
+
+	switch (READ_ONCE(fl->poll_mode)) {
+	case FASTRPC_POLL_ALWAYS:
+		return true;
+	case FASTRPC_POLL_ADAPTIVE:
+		break;
+	default:
+		return false;
+	}
+
+	stat = fastrpc_method_stat(fl, ctx);
+	spin_lock(&fl->hlock);
+	wanted = stat->handle == ctx->handle && stat->sc == ctx->sc &&
+		 stat->calls >= FASTRPC_POLL_MIN_CALLS &&
+		 stat->avg_ns < (uint64_t)fl->poll_timeout_us * NSEC_PER_USEC;
+	spin_unlock(&fl->hlock);
+	return wanted;
+}
+
+/*
+ * Spin for the response for up to poll_timeout_us. Returns true if it
+ * arrived, saving the scheduler round trip of sleeping on the completion.
+ */
+static bool fastrpc_poll_completion(struct fastrpc_file *fl,
+				struct smq_invoke_ctx *ctx)
+{
+	u64 end = ktime_get_ns() +
+		  (u64)READ_ONCE(fl->poll_timeout_us) * NSEC_PER_USEC;
+
+	do {
+		if (completion_done(&ctx->work))
+			return true;
+		cpu_relax();
+	} while (!need_resched() && !signal_pending(current) &&
+		 ktime_get_ns() < end);
+
+	return completion_done(&ctx->work);
+}
+
+static void fastrpc_update_method_stat(struct fastrpc_file *fl,
+			struct smq_invoke_ctx *ctx, u64 ns, bool polled)
+{
+	struct fastrpc_method_stat *stat = fastrpc_method_stat(fl, ctx);
+
+	spin_lock(&fl->hlock);
+	if (stat->handle != ctx->handle || stat->sc != ctx->sc) {
+		stat->handle = ctx->handle;
+		stat->sc = ctx->sc;
+		stat->avg_ns = ns;
+		stat->calls = 0;
+		stat->polled = 0;
+	}
+	/* Weight the latest call by 1/8, as the DSP clocks change */
+	stat->avg_ns = stat->avg_ns - (stat->avg_ns >> 3) + (ns >> 3);
+	stat->calls++;
+	if (polled)
+		stat->polled++;
+	spin_unlock(&fl->hlock);
+}
+
 static int fastrpc_internal_invoke(struct fastrpc_file *fl, uint32_t mode,
 				   uint32_t kernel,
 				   struct fastrpc_ioctl_invoke_crc *inv)
@@ -1982,7 +2194,8 @@ static int fastrpc_internal_invoke(struct fastrpc_file *fl, uint32_t mode,
 	int err = 0, cid = -1, interrupted = 0;
 	struct timespec64 invoket = {0};
 	int64_t *perf_counter = NULL;
-	bool pm_awake_voted;
+	bool pm_awake_voted, polled = false;
+	u64 wait_start, wait_ns;
 
 	cid = fl->cid;
 	VERIFY(err, cid >= ADSP_DOMAIN_ID && cid < NUM_CHANNELS);
@@ -2053,6 +2266,9 @@ static int fastrpc_internal_invoke(struct fastrpc_file *fl, uint32_t mode,
 		goto bail;
  wait:
 	fastrpc_pm_relax(&pm_awake_voted, gcinfo[cid].secure);
+	wait_start = ktime_get_ns();
+	if (!kernel && fastrpc_poll_wanted(fl, ctx))
+		polled = fastrpc_poll_completion(fl, ctx);
 	if (kernel)
 		wait_for_completion(&ctx->work);
 	else
@@ -2062,6 +2278,11 @@ static int fastrpc_internal_invoke(struct fastrpc_file *fl, uint32_t mode,
 	VERIFY(err, 0 == (err = interrupted));
 	if (err)
 		goto bail;
+	wait_ns = ktime_get_ns() - wait_start;
+	atomic64_add(wait_ns, &fl->invoke_wait_ns);
+	atomic64_inc(&fl->invoke_count);
+	if (!kernel)
+		fastrpc_update_method_stat(fl, ctx, wait_ns, polled);
 
 	PERF(fl->profile, GET_COUNTER(perf_counter, PERF_INVARGS),
 	if (!fl->sctx->smmu.coherent)
@@ -2104,6 +2325,92 @@ static int fastrpc_internal_invoke(struct fastrpc_file *fl, uint32_t mode,
 	return err;
 }
 
+static int fastrpc_internal_invoke_async(struct fastrpc_file *fl,
+				struct fastrpc_ioctl_invoke_async *inv)
+{
+	struct smq_invoke_ctx *ctx = NULL;
+	struct fastrpc_ioctl_invoke *invoke = &inv->inv.inv;
+	int err = 0, cid = fl->cid;
+
+	VERIFY(err, cid >= ADSP_DOMAIN_ID && cid < NUM_CHANNELS);
+	if (err)
+		return -ECHRNG;
+	VERIFY(err, fl->sctx != NULL);
+	if (err)
+		return -EBADR;
+	VERIFY(err, invoke->handle > FASTRPC_STATIC_HANDLE_MAX);
+	if (err)
+		return -EINVAL;
+	if (fl->sctx->smmu.faults)
+		return FASTRPC_ENOSUCH;
+
+	VERIFY(err, atomic_inc_return(&fl->async_jobs) <=
+			FASTRPC_MAX_ASYNC_JOBS);
+	if (err) {
+		atomic_dec(&fl->async_jobs);
+		return -EBUSY;
+	}
+
+	VERIFY(err, 0 == context_alloc(fl, 0, &inv->inv, &ctx));
+	if (err) {
+		atomic_dec(&fl->async_jobs);
+		return err;
+	}
+	ctx->is_async = true;
+	ctx->job_id = inv->job_id;
+
+	if (REMOTE_SCALARS_LENGTH(ctx->sc)) {
+		VERIFY(err, 0 == get_args(0, ctx));
+		if (err)
+			goto bail;
+	}
+	if (!fl->sctx->smmu.coherent)
+		inv_args_pre(ctx);
+	VERIFY(err, 0 == fastrpc_invoke_send(ctx, 0, invoke->handle));
+bail:
+	if (err)
+		context_free(ctx);
+	return err;
+}
+
+static int fastrpc_async_response(struct fastrpc_file *fl, bool nonblock,
+				struct fastrpc_ioctl_async_response *rsp)
+{
+	struct smq_invoke_ctx *ctx = NULL;
+	unsigned long flags;
+	int err = 0;
+
+	for (;;) {
+		spin_lock_irqsave(&fl->async_lock, flags);
+		ctx = list_first_entry_or_null(&fl->async_done,
+					struct smq_invoke_ctx, asyncn);
+		if (ctx)
+			list_del_init(&ctx->asyncn);
+		spin_unlock_irqrestore(&fl->async_lock, flags);
+		if (ctx)
+			break;
+		if (nonblock)
+			return -EAGAIN;
+		err = wait_event_interruptible(fl->async_wait,
+					!list_empty(&fl->async_done));
+		if (err)
+			return err;
+	}
+
+	if (!fl->sctx->smmu.coherent)
+		inv_args(ctx);
+	VERIFY(err, 0 == put_args(0, ctx, NULL));
+	if (!err)
+		err = ctx->retval;
+	if (fl->ssrcount != fl->apps->channel[fl->cid].ssrcount)
+		err = ECONNRESET;
+	rsp->job_id = ctx->job_id;
+	rsp->result = err;
+	rsp->reserved = 0;
+	context_free(ctx);
+	return 0;
+}
+
 static int fastrpc_get_adsp_session(char *name, int *session)
 {
 	struct fastrpc_apps *me = &gfa;
@@ -3198,7 +3505,7 @@ static int fastrpc_file_free(struct fastrpc_file *fl)
 	do {
 		lmap = NULL;
 		hlist_for_each_entry_safe(map, n, &fl->maps, hn) {
-			hlist_del_init(&map->hn);
+			fastrpc_mmap_unlink(map);
 			lmap = map;
 			break;
 		}
@@ -3424,11 +3731,42 @@ static ssize_t fastrpc_debugfs_read(struct file *filp, char __user *buffer,
 		len += scnprintf(fileinfo + len, DEBUGFS_SIZE - len,
 			"%s%s%s%s%s\n", single_line, single_line,
 			single_line, single_line, single_line);
-		hlist_for_each_entry_safe(buf, n, &fl->cached_bufs, hn) {
-			len += scnprintf(fileinfo + len,
-				DEBUGFS_SIZE - len,
-				"0x%-17p|0x%-17llX|%-19zu\n",
-				buf->virt, (uint64_t)buf->phys, buf->size);
+		for (i = 0; i < FASTRPC_BUF_CACHE_CLASSES; i++) {
+			hlist_for_each_entry_safe(buf, n, &fl->cached_bufs[i],
+						  hn) {
+				len += scnprintf(fileinfo + len,
+					DEBUGFS_SIZE - len,
+					"0x%-17p|0x%-17llX|%-19zu\n",
+					buf->virt, (uint64_t)buf->phys,
+					buf->size);
+			}
+		}
+		len += scnprintf(fileinfo + len, DEBUGFS_SIZE - len,
+			"%-19s|%-19s|%-19s\n",
+			"cached", "cache hits", "cache misses");
+		len += scnprintf(fileinfo + len, DEBUGFS_SIZE - len,
+			"%-19u|%-19llu|%-19llu\n", fl->num_cached_buf,
+			fl->buf_cache_hits, fl->buf_cache_misses);
+		len += scnprintf(fileinfo + len, DEBUGFS_SIZE - len,
+			"%-19s|%-19s\n", "invokes", "dsp wait us");
+		len += scnprintf(fileinfo + len, DEBUGFS_SIZE - len,
+			"%-19lld|%-19lld\n",
+			(long long)atomic64_read(&fl->invoke_count),
+			(long long)div_s64(atomic64_read(
+				&fl->invoke_wait_ns), NSEC_PER_USEC));
+		len += scnprintf(fileinfo + len, DEBUGFS_SIZE - len,
+			"%-19s|%-19s|%-19s|%-19s|%-19s\n",
+			"handle", "sc", "calls", "polled", "avg dsp wait us");
+		for (i = 0; i < ARRAY_SIZE(fl->method_stats); i++) {
+			struct fastrpc_method_stat *stat = &fl->method_stats[i];
+
+			if (!stat->calls)
+				continue;
+			len += scnprintf(fileinfo + len, DEBUGFS_SIZE - len,
+				"0x%-17x|0x%-17x|%-19llu|%-19llu|%-19llu\n",
+				stat->handle, stat->sc, stat->calls,
+				stat->polled, div_u64(stat->avg_ns,
+						NSEC_PER_USEC));
 		}
 
 		len += scnprintf(fileinfo + len, DEBUGFS_SIZE - len,
@@ -3531,7 +3869,7 @@ static int fastrpc_channel_open(struct fastrpc_file *fl)
 
 static int fastrpc_device_open(struct inode *inode, struct file *filp)
 {
-	int err = 0;
+	int err = 0, i;
 	struct fastrpc_file *fl = NULL;
 	struct fastrpc_apps *me = &gfa;
 
@@ -3555,10 +3893,18 @@ static int fastrpc_device_open(struct inode *inode, struct file *filp)
 	context_list_ctor(&fl->clst);
 	spin_lock_init(&fl->hlock);
 	INIT_HLIST_HEAD(&fl->maps);
+	fl->maps_tree = RB_ROOT_CACHED;
 	INIT_HLIST_HEAD(&fl->perf);
-	INIT_HLIST_HEAD(&fl->cached_bufs);
+	for (i = 0; i < FASTRPC_BUF_CACHE_CLASSES; i++)
+		INIT_HLIST_HEAD(&fl->cached_bufs[i]);
 	INIT_HLIST_HEAD(&fl->remote_bufs);
 	INIT_HLIST_NODE(&fl->hn);
+	spin_lock_init(&fl->async_lock);
+	INIT_LIST_HEAD(&fl->async_done);
+	init_waitqueue_head(&fl->async_wait);
+	atomic_set(&fl->async_jobs, 0);
+	fl->poll_mode = FASTRPC_POLL_ADAPTIVE;
+	fl->poll_timeout_us = FASTRPC_POLL_DEFAULT_US;
 	fl->sessionid = 0;
 	fl->apps = me;
 	fl->mode = FASTRPC_MODE_SERIAL;
@@ -3688,6 +4034,17 @@ static int fastrpc_internal_control(struct fastrpc_file *fl,
 	case FASTRPC_CONTROL_WAKELOCK:
 		fl->wake_enable = cp->wp.enable;
 		break;
+	case FASTRPC_CONTROL_POLL:
+		VERIFY(err, cp->pp.mode <= FASTRPC_POLL_ALWAYS &&
+			cp->pp.timeout_us <= FASTRPC_POLL_MAX_US);
+		if (err) {
+			err = -EINVAL;
+			goto bail;
+		}
+		if (cp->pp.timeout_us)
+			WRITE_ONCE(fl->poll_timeout_us, cp->pp.timeout_us);
+		WRITE_ONCE(fl->poll_mode, cp->pp.mode);
+		break;
 	default:
 		err = -EBADRQC;
 		break;
@@ -3810,6 +4167,8 @@ static long fastrpc_device_ioctl(struct file *file, unsigned int ioctl_num,
 {
 	union {
 		struct fastrpc_ioctl_invoke_crc inv;
+		struct fastrpc_ioctl_invoke_async inv_async;
+		struct fastrpc_ioctl_async_response async_rsp;
 		struct fastrpc_ioctl_mmap mmap;
 		struct fastrpc_ioctl_mmap_64 mmap64;
 		struct fastrpc_ioctl_munmap munmap;
@@ -3876,6 +4235,26 @@ static long fastrpc_device_ioctl(struct file *file, unsigned int ioctl_num,
 		if (err)
 			goto bail;
 		break;
+	case FASTRPC_IOCTL_INVOKE_ASYNC:
+		K_COPY_FROM_USER(err, 0, &p.inv_async, param,
+						sizeof(p.inv_async));
+		if (err)
+			goto bail;
+		VERIFY(err, 0 == (err = fastrpc_internal_invoke_async(fl,
+						&p.inv_async)));
+		if (err)
+			goto bail;
+		break;
+	case FASTRPC_IOCTL_ASYNC_RESPONSE:
+		VERIFY(err, 0 == (err = fastrpc_async_response(fl,
+				file->f_flags & O_NONBLOCK, &p.async_rsp)));
+		if (err)
+			goto bail;
+		K_COPY_TO_USER(err, 0, param, &p.async_rsp,
+						sizeof(p.async_rsp));
+		if (err)
+			goto bail;
+		break;
 	case FASTRPC_IOCTL_MMAP:
 		K_COPY_FROM_USER(err, 0, &p.mmap, param,
 						sizeof(p.mmap));
@@ -4096,9 +4475,21 @@ static int fastrpc_get_service_location_notify(struct notifier_block *nb,
 	return NOTIFY_DONE;
 }
 
+static unsigned int fastrpc_device_poll(struct file *file, poll_table *wait)
+{
+	struct fastrpc_file *fl = (struct fastrpc_file *)file->private_data;
+	unsigned int mask = 0;
+
+	poll_wait(file, &fl->async_wait, wait);
+	if (!list_empty_careful(&fl->async_done))
+		mask |= POLLIN | POLLRDNORM;
+	return mask;
+}
+
 static const struct file_operations fops = {
 	.open = fastrpc_device_open,
 	.release = fastrpc_device_release,
+	.poll = fastrpc_device_poll,
 	.unlocked_ioctl = fastrpc_device_ioctl,
 	.compat_ioctl = compat_fastrpc_device_ioctl,
 };
@@ -34,6 +34,10 @@
 #define FASTRPC_IOCTL_MUNMAP_FD _IOWR('R', 13, struct fastrpc_ioctl_munmap_fd)
 #define FASTRPC_IOCTL_GET_DSP_INFO \
 			_IOWR('R', 16, struct fastrpc_ioctl_dsp_capabilities)
+#define FASTRPC_IOCTL_INVOKE_ASYNC \
+			_IOWR('R', 17, struct fastrpc_ioctl_invoke_async)
+#define FASTRPC_IOCTL_ASYNC_RESPONSE \
+			_IOWR('R', 18, struct fastrpc_ioctl_async_response)
 
 #define FASTRPC_GLINK_GUID "fastrpcglink-apps-dsp"
 #define FASTRPC_SMD_GUID "fastrpcsmd-apps-dsp"
@@ -188,6 +192,23 @@ struct fastrpc_ioctl_invoke_crc {
 	unsigned int *crc;
 };
 
+/*
+ * Submitted with FASTRPC_IOCTL_INVOKE_ASYNC, which returns as soon as the
+ * message is sent. The result is reaped later with
+ * FASTRPC_IOCTL_ASYNC_RESPONSE, tagged with job_id. The device becomes
+ * readable (POLLIN) while responses are waiting to be reaped.
+ */
+struct fastrpc_ioctl_invoke_async {
+	struct fastrpc_ioctl_invoke_crc inv;
+	uint64_t job_id;	/* user tag returned with the response */
+};
+
+struct fastrpc_ioctl_async_response {
+	uint64_t job_id;	/* job_id of the completed invoke */
+	int result;		/* result of the remote invoke */
+	uint32_t reserved;
+};
+
 struct fastrpc_ioctl_init {
 	uint32_t flags;		/* one of FASTRPC_INIT_* macros */
 	uintptr_t file;		/* pointer to elf file */
@@ -248,6 +269,7 @@ enum fastrpc_control_type {
 	FASTRPC_CONTROL_SMMU		=	2,
 	FASTRPC_CONTROL_KALLOC		=	3,
 	FASTRPC_CONTROL_WAKELOCK	=	4,
+	FASTRPC_CONTROL_POLL		=	5,
 };
 
 struct fastrpc_ctrl_latency {
@@ -263,12 +285,24 @@ struct fastrpc_ctrl_wakelock {
 	uint32_t enable;	/* wakelock control enable */
 };
 
+enum fastrpc_poll_mode {
+	FASTRPC_POLL_OFF	=	0,
+	FASTRPC_POLL_ADAPTIVE	=	1,	/* poll methods that return fast */
+	FASTRPC_POLL_ALWAYS	=	2,
+};
+
+struct fastrpc_ctrl_poll {
+	uint32_t mode;		/* one of enum fastrpc_poll_mode */
+	uint32_t timeout_us;	/* time to poll before sleeping, 0 to keep */
+};
+
 struct fastrpc_ioctl_control {
 	uint32_t req;
 	union {
 		struct fastrpc_ctrl_latency lp;
 		struct fastrpc_ctrl_kalloc kalloc;
 		struct fastrpc_ctrl_wakelock wp;
+		struct fastrpc_ctrl_poll pp;
 	};
 };
 
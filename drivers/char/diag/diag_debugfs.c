@@ -443,6 +443,7 @@ static ssize_t diag_dbgfs_read_usbinfo(struct file *file, char __user *ubuf,
 			"read pending: %d\n"
 			"read count: %lu\n"
 			"write count: %lu\n"
+			"write drop count: %lu\n"
 			"read work pending: %d\n"
 			"read done work pending: %d\n"
 			"event work pending: %d\n"
@@ -457,6 +458,7 @@ static ssize_t diag_dbgfs_read_usbinfo(struct file *file, char __user *ubuf,
 			atomic_read(&usb_info->read_pending),
 			usb_info->read_cnt,
 			usb_info->write_cnt,
+			usb_info->write_drop_cnt,
 			work_pending(&usb_info->read_work),
 			work_pending(&usb_info->read_done_work),
 			work_pending(&usb_info->event_work),
@@ -494,6 +494,7 @@ static int diag_usb_write_ext(struct diag_usb_info *usb_info,
 			 */
 			pr_err_ratelimited("diag: In %s, cannot retrieve USB write ptrs for USB channel %s\n",
 					   __func__, usb_info->name);
+			usb_info->write_drop_cnt++;
 			spin_unlock_irqrestore(&usb_info->write_lock, flags);
 			return -ENOMEM;
 		}
@@ -531,6 +532,7 @@ static int diag_usb_write_ext(struct diag_usb_info *usb_info,
 			diag_ws_on_copy_fail(DIAG_WS_MUX);
 			diag_usb_buf_tbl_remove(usb_info, buf);
 			diagmem_free(driver, req, usb_info->mempool);
+			usb_info->write_drop_cnt++;
 			spin_unlock_irqrestore(&usb_info->write_lock, flags);
 			return err;
 		}
@@ -584,6 +586,7 @@ int diag_usb_write(int id, unsigned char *buf, int len, int ctxt)
 		pr_err_ratelimited("diag: In %s, cannot retrieve USB write ptrs for USB channel %s\n",
 				   __func__, usb_info->name);
 		diag_usb_buf_tbl_remove(usb_info, buf);
+		usb_info->write_drop_cnt++;
 		spin_unlock_irqrestore(&usb_info->write_lock, flags);
 		return -ENOMEM;
 	}
@@ -621,6 +624,7 @@ int diag_usb_write(int id, unsigned char *buf, int len, int ctxt)
 			 "ERR! unable to write t usb, err: %d\n", err);
 		diag_usb_buf_tbl_remove(usb_info, buf);
 		diagmem_free(driver, req, usb_info->mempool);
+		usb_info->write_drop_cnt++;
 	}
 	spin_unlock_irqrestore(&usb_info->write_lock, flags);
 
@@ -770,6 +774,7 @@ void diag_usb_exit(int id)
 	ch->ctxt = 0;
 	ch->read_cnt = 0;
 	ch->write_cnt = 0;
+	ch->write_drop_cnt = 0;
 	diagmem_exit(driver, ch->mempool);
 	ch->mempool = 0;
 	if (ch->hdl) {
@@ -64,6 +64,7 @@ struct diag_usb_info {
 	struct list_head buf_tbl;
 	unsigned long read_cnt;
 	unsigned long write_cnt;
+	unsigned long write_drop_cnt;
 	spinlock_t lock;
 	spinlock_t write_lock;
 	spinlock_t event_lock;
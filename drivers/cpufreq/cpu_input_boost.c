@@ -7,9 +7,12 @@
 
 #include <linux/cpu.h>
 #include <linux/cpufreq.h>
+#include <linux/cpu_input_boost.h>
+#include <linux/devfreq_boost.h>
 #include <linux/msm_drm_notify.h>
 #include <linux/input.h>
 #include <linux/kthread.h>
+#include <linux/moduleparam.h>
 #include <linux/version.h>
 #include <linux/slab.h>
 
@@ -18,43 +21,235 @@
 #include <uapi/linux/sched/types.h>
 #endif
 
+/*
+ * One engine boosts the CPUs and every registered devfreq device. Input
+ * events and screen state are shared by all of them, so a touch costs a
+ * single timer update and a single thread wakeup. Max boosts keep one
+ * expiry per target since callers ask for different durations.
+ */
 enum {
 	SCREEN_OFF,
 	INPUT_BOOST,
-	MAX_BOOST
+	MAX_BOOST,
+	DF_MAX_BOOST
+};
+
+#define DF_MAX_BOOST_BIT(dev)	(DF_MAX_BOOST + (dev))
+/* The gesture that asked for the input boost sits above the boost bits */
+#define GESTURE_SHIFT		(DF_MAX_BOOST + DEVFREQ_MAX)
+#define GESTURE_MASK		(7UL << GESTURE_SHIFT)
+#define CPU_BOOST_MASK		(BIT(SCREEN_OFF) | BIT(INPUT_BOOST) | \
+				 BIT(MAX_BOOST) | GESTURE_MASK)
+#define DF_BOOST_MASK(dev)	(BIT(SCREEN_OFF) | BIT(INPUT_BOOST) | \
+				 BIT(DF_MAX_BOOST_BIT(dev)))
+
+#ifdef CONFIG_DEVFREQ_BOOST
+#define NR_BOOST_TARGETS	(1 + DEVFREQ_MAX)
+#define DF_WAKE_BOOST_DURATION_MS CONFIG_DEVFREQ_WAKE_BOOST_DURATION_MS
+#define DF_BOOST_FREQS {							\
+	[DEVFREQ_CPU_LLCC_DDR_BW] = CONFIG_DEVFREQ_CPU_LLCC_DDR_BW_BOOST_FREQ,	\
+	[DEVFREQ_CPU_CPU_LLC_BW] = CONFIG_DEVFREQ_CPU_CPU_LLC_BW_BOOST_FREQ,	\
+	[DEVFREQ_GPU] = CONFIG_DEVFREQ_GPU_BOOST_FREQ				\
+}
+#else
+#define NR_BOOST_TARGETS	1
+#define DF_WAKE_BOOST_DURATION_MS 0
+#define DF_BOOST_FREQS { }
+#endif
+
+/* Scenes follow the KProfiles mode: 0 none, 1 battery, 2 balanced, 3 perf */
+#define NR_BOOST_SCENES		4
+
+/*
+ * Touch input is classified per gesture so a tap doesn't pay for the boost
+ * a fling needs. Keys, and boosts asked for by other drivers, use
+ * GESTURE_KEY, which keeps the scene's boost unchanged.
+ */
+enum gesture {
+	GESTURE_KEY,
+	GESTURE_TAP,
+	GESTURE_LONG_PRESS,
+	GESTURE_SCROLL,
+	GESTURE_FLING,
+	NR_GESTURES
+};
+
+static const char *const gesture_names[NR_GESTURES] = {
+	[GESTURE_KEY] = "key",
+	[GESTURE_TAP] = "tap",
+	[GESTURE_LONG_PRESS] = "long_press",
+	[GESTURE_SCROLL] = "scroll",
+	[GESTURE_FLING] = "fling"
+};
+
+/* Scales the scene's input boost: percent of its duration and CPU freqs */
+struct gesture_boost {
+	unsigned int duration_pct;
+	unsigned int freq_pct;
+	atomic_long_t gestures;
+	atomic_long_t boosts;
+};
+
+/* Samples closer together than this don't give a usable fling velocity */
+#define VELOCITY_WINDOW_US	16000
+/* A touch that stopped this long before lifting isn't a fling */
+#define FLING_MAX_STILL_US	50000
+
+struct boost_profile {
+	unsigned int input_ms;
+	unsigned int cpu_lp_freq;
+	unsigned int cpu_perf_freq;
+	unsigned long df_freq[DEVFREQ_MAX];
+};
+
+struct max_boost {
+	struct delayed_work unboost;
+	atomic_long_t expires;
+	unsigned int bit;
 };
 
 struct boost_drv {
 	struct delayed_work input_unboost;
-	struct delayed_work max_unboost;
+	struct max_boost max[NR_BOOST_TARGETS];
 	struct notifier_block cpu_notif;
 	struct notifier_block msm_drm_notif;
 	wait_queue_head_t boost_waitq;
-	atomic_long_t max_boost_expires;
+	struct boost_profile profiles[NR_BOOST_SCENES];
+	struct gesture_boost gestures[NR_GESTURES];
+	unsigned long input_expires;
+	unsigned int scene;
 	unsigned long state;
 };
 
+/* One per connected input device, updated under the device's event_lock */
+struct gesture_tracker {
+	struct input_handle handle;
+	unsigned long contacts;
+	int slot;
+	int primary;
+	bool touch;
+	bool was_down;
+	bool moved;
+	unsigned int max_contacts;
+	enum gesture gesture;
+	int x, y;
+	int down_x, down_y;
+	ktime_t down_time;
+	int last_x, last_y;
+	ktime_t last_time;
+	int prev_x, prev_y;
+	ktime_t prev_time;
+};
+
+static unsigned int gesture_slop_px __read_mostly = 24;
+module_param(gesture_slop_px, uint, 0644);
+
+static unsigned int fling_velocity __read_mostly = 1000;
+module_param(fling_velocity, uint, 0644);
+
+static unsigned int long_press_ms __read_mostly = 500;
+module_param(long_press_ms, uint, 0644);
+
 extern int kp_active_mode(void);
 
 static void input_unboost_worker(struct work_struct *work);
 static void max_unboost_worker(struct work_struct *work);
 
+#define MAX_BOOST_INIT(b, target, state_bit) [target] = {			\
+	.unboost = __DELAYED_WORK_INITIALIZER((b).max[target].unboost,		\
+					      max_unboost_worker, 0),		\
+	.bit = state_bit							\
+}
+
+#define GESTURE_BOOST_INIT(dur, freq) {					\
+	.duration_pct = dur,							\
+	.freq_pct = freq							\
+}
+
+#define BOOST_PROFILE_INIT(ms) {						\
+	.input_ms = ms,								\
+	.cpu_lp_freq = CONFIG_INPUT_BOOST_FREQ_LP,				\
+	.cpu_perf_freq = CONFIG_INPUT_BOOST_FREQ_PERF,				\
+	.df_freq = DF_BOOST_FREQS						\
+}
+
 static struct boost_drv boost_drv_g __read_mostly = {
 	.input_unboost = __DELAYED_WORK_INITIALIZER(boost_drv_g.input_unboost,
 						    input_unboost_worker, 0),
-	.max_unboost = __DELAYED_WORK_INITIALIZER(boost_drv_g.max_unboost,
-						  max_unboost_worker, 0),
-	.boost_waitq = __WAIT_QUEUE_HEAD_INITIALIZER(boost_drv_g.boost_waitq)
+	.max = {
+		MAX_BOOST_INIT(boost_drv_g, 0, MAX_BOOST),
+#ifdef CONFIG_DEVFREQ_BOOST
+		MAX_BOOST_INIT(boost_drv_g, 1 + DEVFREQ_CPU_LLCC_DDR_BW,
+			       DF_MAX_BOOST_BIT(DEVFREQ_CPU_LLCC_DDR_BW)),
+		MAX_BOOST_INIT(boost_drv_g, 1 + DEVFREQ_CPU_CPU_LLC_BW,
+			       DF_MAX_BOOST_BIT(DEVFREQ_CPU_CPU_LLC_BW)),
+		MAX_BOOST_INIT(boost_drv_g, 1 + DEVFREQ_GPU,
+			       DF_MAX_BOOST_BIT(DEVFREQ_GPU)),
+#endif
+	},
+	.boost_waitq = __WAIT_QUEUE_HEAD_INITIALIZER(boost_drv_g.boost_waitq),
+	.profiles = {
+		BOOST_PROFILE_INIT(CONFIG_INPUT_BOOST_DURATION_MS),
+		/* Battery mode doesn't boost on input */
+		BOOST_PROFILE_INIT(0),
+		BOOST_PROFILE_INIT(CONFIG_INPUT_BOOST_DURATION_MS),
+		BOOST_PROFILE_INIT(CONFIG_INPUT_BOOST_DURATION_MS)
+	},
+	.gestures = {
+		[GESTURE_KEY] = GESTURE_BOOST_INIT(100, 100),
+		[GESTURE_TAP] = GESTURE_BOOST_INIT(50, 75),
+		[GESTURE_LONG_PRESS] = GESTURE_BOOST_INIT(50, 75),
+		[GESTURE_SCROLL] = GESTURE_BOOST_INIT(100, 100),
+		/* Cover the fling animation after the finger lifts */
+		[GESTURE_FLING] = GESTURE_BOOST_INIT(300, 100)
+	}
 };
 
-static unsigned int get_input_boost_freq(struct cpufreq_policy *policy)
+static unsigned int get_boost_scene(void)
+{
+	return clamp(kp_active_mode(), 0, NR_BOOST_SCENES - 1);
+}
+
+static const struct boost_profile *get_boost_profile(struct boost_drv *b)
+{
+	return &b->profiles[READ_ONCE(b->scene)];
+}
+
+static enum gesture get_gesture(unsigned long state)
+{
+	return min_t(unsigned long, (state & GESTURE_MASK) >> GESTURE_SHIFT,
+		     NR_GESTURES - 1);
+}
+
+static bool set_gesture(struct boost_drv *b, enum gesture g)
+{
+	unsigned long old, new;
+
+	do {
+		old = READ_ONCE(b->state);
+		new = (old & ~GESTURE_MASK) |
+		      ((unsigned long)g << GESTURE_SHIFT);
+		if (new == old)
+			return false;
+	} while (cmpxchg(&b->state, old, new) != old);
+
+	return true;
+}
+
+static unsigned int get_input_boost_freq(struct boost_drv *b,
+					 struct cpufreq_policy *policy)
 {
+	const struct boost_profile *p = get_boost_profile(b);
+	enum gesture g = get_gesture(READ_ONCE(b->state));
+	unsigned int pct = READ_ONCE(b->gestures[g].freq_pct);
 	unsigned int freq;
 
 	if (cpumask_test_cpu(policy->cpu, cpu_lp_mask))
-		freq = max(CONFIG_INPUT_BOOST_FREQ_LP, CONFIG_MIN_FREQ_LP);
+		freq = max(READ_ONCE(p->cpu_lp_freq) * pct / 100,
+			   (unsigned int)CONFIG_MIN_FREQ_LP);
 	else
-		freq = max(CONFIG_INPUT_BOOST_FREQ_PERF, CONFIG_MIN_FREQ_PERF);
+		freq = max(READ_ONCE(p->cpu_perf_freq) * pct / 100,
+			   (unsigned int)CONFIG_MIN_FREQ_PERF);
 
 	return min(freq, policy->max);
 }
@@ -84,56 +279,92 @@ static void update_online_cpu_policy(void)
 	put_online_cpus();
 }
 
-extern int kp_active_mode(void);
-static void __cpu_input_boost_kick(struct boost_drv *b)
+static void __cpu_input_boost_kick(struct boost_drv *b, enum gesture g)
 {
-       if (!test_bit(SCREEN_OFF, &b->state) || kp_active_mode() == 1)
+	struct gesture_boost *gb = &b->gestures[g];
+	unsigned int scene = get_boost_scene();
+	unsigned int duration_ms = READ_ONCE(b->profiles[scene].input_ms) *
+				   READ_ONCE(gb->duration_pct) / 100;
+	unsigned long state = READ_ONCE(b->state), expires;
+	bool changed;
+
+	if (test_bit(SCREEN_OFF, &b->state) || !duration_ms)
+		return;
+
+	/* Don't let a weaker, shorter boost cut the current one short */
+	expires = jiffies + msecs_to_jiffies(duration_ms);
+	if ((state & BIT(INPUT_BOOST)) &&
+	    time_after(READ_ONCE(b->input_expires), expires) &&
+	    READ_ONCE(gb->freq_pct) <=
+	    READ_ONCE(b->gestures[get_gesture(state)].freq_pct))
 		return;
 
+	atomic_long_inc(&gb->boosts);
+	WRITE_ONCE(b->scene, scene);
+	WRITE_ONCE(b->input_expires, expires);
+	changed = set_gesture(b, g);
 	set_bit(INPUT_BOOST, &b->state);
 	if (!mod_delayed_work(system_unbound_wq, &b->input_unboost,
-			      msecs_to_jiffies(CONFIG_INPUT_BOOST_DURATION_MS)))
+			      msecs_to_jiffies(duration_ms))) {
+		/* Set the bit again in case we raced with the unboost worker */
+		set_bit(INPUT_BOOST, &b->state);
+		wake_up(&b->boost_waitq);
+	} else if (changed) {
 		wake_up(&b->boost_waitq);
+	}
 }
 
 void cpu_input_boost_kick(void)
 {
 	struct boost_drv *b = &boost_drv_g;
 
-	__cpu_input_boost_kick(b);
+	__cpu_input_boost_kick(b, GESTURE_KEY);
 }
 
-static void __cpu_input_boost_kick_max(struct boost_drv *b,
-				       unsigned int duration_ms)
+static void __boost_kick_max(struct boost_drv *b, struct max_boost *m,
+			     unsigned int duration_ms)
 {
 	unsigned long boost_jiffies = msecs_to_jiffies(duration_ms);
 	unsigned long curr_expires, new_expires;
 
-	if (!test_bit(SCREEN_OFF, &b->state) || kp_active_mode() == 1)
+	if (test_bit(SCREEN_OFF, &b->state) || kp_active_mode() == 1)
 		return;
 
 	do {
-		curr_expires = atomic_long_read(&b->max_boost_expires);
+		curr_expires = atomic_long_read(&m->expires);
 		new_expires = jiffies + boost_jiffies;
 
 		/* Skip this boost if there's a longer boost in effect */
 		if (time_after(curr_expires, new_expires))
 			return;
-	} while (atomic_long_cmpxchg(&b->max_boost_expires, curr_expires,
+	} while (atomic_long_cmpxchg(&m->expires, curr_expires,
 				     new_expires) != curr_expires);
 
-	set_bit(MAX_BOOST, &b->state);
-	if (!mod_delayed_work(system_unbound_wq, &b->max_unboost,
-			      boost_jiffies))
+	set_bit(m->bit, &b->state);
+	if (!mod_delayed_work(system_unbound_wq, &m->unboost,
+			      boost_jiffies)) {
+		/* Set the bit again in case we raced with the unboost worker */
+		set_bit(m->bit, &b->state);
 		wake_up(&b->boost_waitq);
+	}
 }
 
 void cpu_input_boost_kick_max(unsigned int duration_ms)
 {
 	struct boost_drv *b = &boost_drv_g;
 
-	__cpu_input_boost_kick_max(b, duration_ms);
+	__boost_kick_max(b, &b->max[0], duration_ms);
+}
+
+#ifdef CONFIG_DEVFREQ_BOOST
+void cpu_input_boost_kick_devfreq_max(enum df_device device,
+				      unsigned int duration_ms)
+{
+	struct boost_drv *b = &boost_drv_g;
+
+	__boost_kick_max(b, &b->max[1 + device], duration_ms);
 }
+#endif
 
 static void input_unboost_worker(struct work_struct *work)
 {
@@ -146,13 +377,33 @@ static void input_unboost_worker(struct work_struct *work)
 
 static void max_unboost_worker(struct work_struct *work)
 {
-	struct boost_drv *b = container_of(to_delayed_work(work),
-					   typeof(*b), max_unboost);
+	struct max_boost *m = container_of(to_delayed_work(work),
+					   typeof(*m), unboost);
+	struct boost_drv *b = &boost_drv_g;
 
-	clear_bit(MAX_BOOST, &b->state);
+	clear_bit(m->bit, &b->state);
 	wake_up(&b->boost_waitq);
 }
 
+static void update_devfreq_boosts(struct boost_drv *b, unsigned long state,
+				  unsigned long changed)
+{
+#ifdef CONFIG_DEVFREQ_BOOST
+	const struct boost_profile *p = get_boost_profile(b);
+	int i;
+
+	for (i = 0; i < DEVFREQ_MAX; i++) {
+		if (!(changed & DF_BOOST_MASK(i)))
+			continue;
+
+		devfreq_boost_update(i, state & BIT(SCREEN_OFF),
+				     state & BIT(INPUT_BOOST) ?
+				     READ_ONCE(p->df_freq[i]) : 0,
+				     state & BIT(DF_MAX_BOOST_BIT(i)));
+	}
+#endif
+}
+
 static int cpu_boost_thread(void *data)
 {
 	static const struct sched_param sched_max_rt_prio = {
@@ -165,7 +416,7 @@ static int cpu_boost_thread(void *data)
 
 	while (1) {
 		bool should_stop = false;
-		unsigned long curr_state;
+		unsigned long curr_state, changed;
 
 		wait_event(b->boost_waitq,
 			(curr_state = READ_ONCE(b->state)) != old_state ||
@@ -174,8 +425,12 @@ static int cpu_boost_thread(void *data)
 		if (should_stop)
 			break;
 
+		changed = curr_state ^ old_state;
 		old_state = curr_state;
-		update_online_cpu_policy();
+
+		if (changed & CPU_BOOST_MASK)
+			update_online_cpu_policy();
+		update_devfreq_boosts(b, curr_state, changed);
 	}
 
 	return 0;
@@ -207,7 +462,7 @@ static int cpu_notifier_cb(struct notifier_block *nb, unsigned long action,
 	 * unboosting, set policy->min to the absolute min freq for the CPU.
 	 */
 	if (test_bit(INPUT_BOOST, &b->state))
-		policy->min = get_input_boost_freq(policy);
+		policy->min = get_input_boost_freq(b, policy);
 	else if (cpumask_test_cpu(policy->cpu, cpu_lp_mask))
 		policy->min = CONFIG_MIN_FREQ_LP;
 	else
@@ -221,7 +476,7 @@ static int msm_drm_notifier_cb(struct notifier_block *nb, unsigned long action,
 {
 	struct boost_drv *b = container_of(nb, typeof(*b), msm_drm_notif);
 	struct msm_drm_notifier *evdata = data;
-	int *blank = evdata->data;
+	int i, *blank = evdata->data;
 
 	/* Parse framebuffer blank events as soon as they occur */
 	if (action != MSM_DRM_EARLY_EVENT_BLANK)
@@ -230,7 +485,10 @@ static int msm_drm_notifier_cb(struct notifier_block *nb, unsigned long action,
 	/* Boost when the screen turns on and unboost when it turns off */
 	if (*blank == MSM_DRM_BLANK_UNBLANK) {
 		clear_bit(SCREEN_OFF, &b->state);
-		__cpu_input_boost_kick_max(b, CONFIG_WAKE_BOOST_DURATION_MS);
+		__boost_kick_max(b, &b->max[0], CONFIG_WAKE_BOOST_DURATION_MS);
+		for (i = 1; i < NR_BOOST_TARGETS; i++)
+			__boost_kick_max(b, &b->max[i],
+					 DF_WAKE_BOOST_DURATION_MS);
 	} else {
 		set_bit(SCREEN_OFF, &b->state);
 		wake_up(&b->boost_waitq);
@@ -239,26 +497,154 @@ static int msm_drm_notifier_cb(struct notifier_block *nb, unsigned long action,
 	return NOTIFY_OK;
 }
 
+static unsigned int gesture_distance(int dx, int dy)
+{
+	return int_sqrt((unsigned long)dx * dx + (unsigned long)dy * dy);
+}
+
+/* Speed of the primary contact over the last samples, in px/s */
+static unsigned int gesture_velocity(struct gesture_tracker *t, ktime_t now)
+{
+	s64 dt_us = ktime_us_delta(t->last_time, t->prev_time);
+
+	if (dt_us <= 0 || ktime_us_delta(now, t->last_time) > FLING_MAX_STILL_US)
+		return 0;
+
+	return div64_s64((s64)gesture_distance(t->last_x - t->prev_x,
+					       t->last_y - t->prev_y) *
+			 USEC_PER_SEC, dt_us);
+}
+
+/*
+ * Called for every input frame. A touch boosts as a tap when it lands,
+ * turns into a scroll once it moves past the slop or a second finger joins,
+ * and into a long press if it stays put. When it lifts, a scroll that was
+ * still moving fast enough is a fling.
+ */
+static void gesture_sync(struct boost_drv *b, struct gesture_tracker *t)
+{
+	bool down = t->touch || t->contacts;
+	ktime_t now = ktime_get();
+
+	t->max_contacts = max_t(unsigned int, t->max_contacts,
+				hweight_long(t->contacts));
+
+	if (down && !t->was_down) {
+		t->gesture = GESTURE_TAP;
+		t->moved = false;
+		t->down_x = t->last_x = t->prev_x = t->x;
+		t->down_y = t->last_y = t->prev_y = t->y;
+		t->down_time = t->last_time = t->prev_time = now;
+		__cpu_input_boost_kick(b, GESTURE_TAP);
+	} else if (down) {
+		bool motion = t->x != t->last_x || t->y != t->last_y;
+
+		if (motion) {
+			if (ktime_us_delta(now, t->prev_time) >=
+			    VELOCITY_WINDOW_US) {
+				t->prev_x = t->last_x;
+				t->prev_y = t->last_y;
+				t->prev_time = t->last_time;
+			}
+			t->last_x = t->x;
+			t->last_y = t->y;
+			t->last_time = now;
+		}
+
+		if (!t->moved && gesture_distance(t->x - t->down_x,
+						  t->y - t->down_y) >
+		    READ_ONCE(gesture_slop_px))
+			t->moved = true;
+
+		if (t->moved || t->max_contacts > 1) {
+			t->gesture = GESTURE_SCROLL;
+			if (motion)
+				__cpu_input_boost_kick(b, GESTURE_SCROLL);
+		} else if (t->gesture == GESTURE_TAP &&
+			   ktime_ms_delta(now, t->down_time) >=
+			   READ_ONCE(long_press_ms)) {
+			t->gesture = GESTURE_LONG_PRESS;
+			__cpu_input_boost_kick(b, GESTURE_LONG_PRESS);
+		}
+	} else if (t->was_down) {
+		if (t->gesture == GESTURE_SCROLL &&
+		    gesture_velocity(t, now) >= READ_ONCE(fling_velocity))
+			t->gesture = GESTURE_FLING;
+
+		atomic_long_inc(&b->gestures[t->gesture].gestures);
+		/* Whatever the touch was, the app reacts to it lifting */
+		__cpu_input_boost_kick(b, t->gesture == GESTURE_LONG_PRESS ?
+				       GESTURE_TAP : t->gesture);
+		t->max_contacts = 0;
+	}
+
+	t->was_down = down;
+}
+
 static void cpu_input_boost_input_event(struct input_handle *handle,
 					unsigned int type, unsigned int code,
 					int value)
 {
+	struct gesture_tracker *t = container_of(handle, typeof(*t), handle);
 	struct boost_drv *b = handle->handler->private;
 
-	__cpu_input_boost_kick(b);
+	switch (type) {
+	case EV_ABS:
+		switch (code) {
+		case ABS_MT_SLOT:
+			t->slot = value;
+			break;
+		case ABS_MT_TRACKING_ID:
+			if (t->slot < 0 || t->slot >= BITS_PER_LONG)
+				break;
+			if (value >= 0) {
+				if (!t->contacts)
+					t->primary = t->slot;
+				__set_bit(t->slot, &t->contacts);
+			} else {
+				__clear_bit(t->slot, &t->contacts);
+			}
+			break;
+		case ABS_X:
+		case ABS_MT_POSITION_X:
+			if (t->slot == t->primary)
+				t->x = value;
+			break;
+		case ABS_Y:
+		case ABS_MT_POSITION_Y:
+			if (t->slot == t->primary)
+				t->y = value;
+			break;
+		}
+		break;
+	case EV_KEY:
+		if (code == BTN_TOUCH) {
+			t->touch = value;
+		} else if (value) {
+			atomic_long_inc(&b->gestures[GESTURE_KEY].gestures);
+			__cpu_input_boost_kick(b, GESTURE_KEY);
+		}
+		break;
+	case EV_SYN:
+		if (code == SYN_REPORT)
+			gesture_sync(b, t);
+		break;
+	}
 }
 
 static int cpu_input_boost_input_connect(struct input_handler *handler,
 					 struct input_dev *dev,
 					 const struct input_device_id *id)
 {
+	struct gesture_tracker *t;
 	struct input_handle *handle;
 	int ret;
 
-	handle = kzalloc(sizeof(*handle), GFP_KERNEL);
-	if (!handle)
+	t = kzalloc(sizeof(*t), GFP_KERNEL);
+	if (!t)
 		return -ENOMEM;
 
+	handle = &t->handle;
 	handle->dev = dev;
 	handle->handler = handler;
 	handle->name = "cpu_input_boost_handle";
@@ -276,7 +662,7 @@ static int cpu_input_boost_input_connect(struct input_handler *handler,
 unregister_handle:
 	input_unregister_handle(handle);
 free_handle:
-	kfree(handle);
+	kfree(t);
 	return ret;
 }
 
@@ -284,7 +670,7 @@ static void cpu_input_boost_input_disconnect(struct input_handle *handle)
 {
 	input_close_device(handle);
 	input_unregister_handle(handle);
-	kfree(handle);
+	kfree(container_of(handle, struct gesture_tracker, handle));
 }
 
 static const struct input_device_id cpu_input_boost_ids[] = {
@@ -326,6 +712,120 @@ static struct input_handler cpu_input_boost_input_handler = {
 	.id_table	= cpu_input_boost_ids
 };
 
+/*
+ * "profiles" lists one scene per line:
+ *	<scene> <input_ms> <cpu_lp_freq> <cpu_perf_freq> <df_freq>...
+ * with one df_freq per devfreq boost device. Writing a line in the same
+ * format replaces that scene.
+ */
+static int set_boost_profiles(const char *buf, const struct kernel_param *kp)
+{
+	struct boost_drv *b = &boost_drv_g;
+	struct boost_profile new = { };
+	unsigned int scene;
+	const char *cp;
+	int i, n;
+
+	if (sscanf(buf, "%u %u %u %u%n", &scene, &new.input_ms,
+		   &new.cpu_lp_freq, &new.cpu_perf_freq, &n) != 4)
+		return -EINVAL;
+
+	if (scene >= NR_BOOST_SCENES)
+		return -EINVAL;
+
+	cp = buf + n;
+	for (i = 0; i < DEVFREQ_MAX; i++) {
+		if (sscanf(cp, "%lu%n", &new.df_freq[i], &n) != 1)
+			return -EINVAL;
+		cp += n;
+	}
+
+	WRITE_ONCE(b->profiles[scene].input_ms, new.input_ms);
+	WRITE_ONCE(b->profiles[scene].cpu_lp_freq, new.cpu_lp_freq);
+	WRITE_ONCE(b->profiles[scene].cpu_perf_freq, new.cpu_perf_freq);
+	for (i = 0; i < DEVFREQ_MAX; i++)
+		WRITE_ONCE(b->profiles[scene].df_freq[i], new.df_freq[i]);
+
+	return 0;
+}
+
+static int get_boost_profiles(char *buf, const struct kernel_param *kp)
+{
+	struct boost_drv *b = &boost_drv_g;
+	int cnt = 0, scene, i;
+
+	for (scene = 0; scene < NR_BOOST_SCENES; scene++) {
+		const struct boost_profile *p = &b->profiles[scene];
+
+		cnt += snprintf(buf + cnt, PAGE_SIZE - cnt, "%d %u %u %u",
+				scene, p->input_ms, p->cpu_lp_freq,
+				p->cpu_perf_freq);
+		for (i = 0; i < DEVFREQ_MAX; i++)
+			cnt += snprintf(buf + cnt, PAGE_SIZE - cnt, " %lu",
+					p->df_freq[i]);
+		cnt += snprintf(buf + cnt, PAGE_SIZE - cnt, "\n");
+	}
+
+	return cnt;
+}
+
+static const struct kernel_param_ops param_ops_boost_profiles = {
+	.set = set_boost_profiles,
+	.get = get_boost_profiles,
+};
+module_param_cb(profiles, &param_ops_boost_profiles, NULL, 0644);
+
+/*
+ * "gesture_boost" lists one gesture per line:
+ *	<gesture> <duration_pct> <freq_pct> <gestures> <boosts>
+ * where the percentages scale the scene's input_ms and CPU freqs. Writing
+ * "<gesture> <duration_pct> <freq_pct>" replaces those for that gesture.
+ */
+static int set_gesture_boost(const char *buf, const struct kernel_param *kp)
+{
+	struct boost_drv *b = &boost_drv_g;
+	unsigned int duration_pct, freq_pct;
+	char name[16];
+	int i;
+
+	if (sscanf(buf, "%15s %u %u", name, &duration_pct, &freq_pct) != 3)
+		return -EINVAL;
+
+	for (i = 0; i < NR_GESTURES; i++) {
+		if (strcmp(name, gesture_names[i]))
+			continue;
+
+		WRITE_ONCE(b->gestures[i].duration_pct, duration_pct);
+		WRITE_ONCE(b->gestures[i].freq_pct, freq_pct);
+		return 0;
+	}
+
+	return -EINVAL;
+}
+
+static int get_gesture_boost(char *buf, const struct kernel_param *kp)
+{
+	struct boost_drv *b = &boost_drv_g;
+	int cnt = 0, i;
+
+	for (i = 0; i < NR_GESTURES; i++) {
+		struct gesture_boost *gb = &b->gestures[i];
+
+		cnt += snprintf(buf + cnt, PAGE_SIZE - cnt, "%s %u %u %ld %ld\n",
+				gesture_names[i], gb->duration_pct,
+				gb->freq_pct, atomic_long_read(&gb->gestures),
+				atomic_long_read(&gb->boosts));
+	}
+
+	return cnt;
+}
+
+static const struct kernel_param_ops param_ops_gesture_boost = {
+	.set = set_gesture_boost,
+	.get = get_gesture_boost,
+};
+module_param_cb(gesture_boost, &param_ops_gesture_boost, NULL, 0644);
+
 static int __init cpu_input_boost_init(void)
 {
 	struct boost_drv *b = &boost_drv_g;
@@ -18,12 +18,20 @@
 #include <linux/hashtable.h>
 #include <linux/init.h>
 #include <linux/jiffies.h>
+#include <linux/mm.h>
+#include <linux/percpu.h>
 #include <linux/proc_fs.h>
 #include <linux/sched.h>
 #include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <linux/spinlock.h>
 #include <linux/threads.h>
+#include <linux/vmalloc.h>
+#include <uapi/linux/cpufreq_times.h>
+
+#ifdef CONFIG_GENERIC_ARCH_TOPOLOGY
+#include <linux/sched/energy.h>
+#endif
 
 #define UID_HASH_BITS 10
 
@@ -37,12 +45,18 @@ struct concurrent_times {
 	atomic64_t policy[NR_CPUS];
 };
 
+/*
+ * Ticks accumulate into the per-CPU pcpu_time_in_state without any lock.
+ * Readers fold those into time_in_state, which only holds what was carried
+ * over when the entry was resized, see uid_entry_time().
+ */
 struct uid_entry {
 	uid_t uid;
 	unsigned int max_state;
 	struct hlist_node hash;
 	struct rcu_head rcu;
 	struct concurrent_times *concurrent_times;
+	u64 __percpu *pcpu_time_in_state;
 	u64 time_in_state[0];
 };
 
@@ -65,6 +79,42 @@ static struct cpu_freqs *all_freqs[NR_CPUS];
 static unsigned int next_offset;
 
 
+static u64 uid_entry_time(struct uid_entry *uid_entry, unsigned int state)
+{
+	u64 time = uid_entry->time_in_state[state];
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		time += READ_ONCE(per_cpu_ptr(uid_entry->pcpu_time_in_state,
+					      cpu)[state]);
+
+	return time;
+}
+
+static u64 __percpu *alloc_uid_pcpu_times(unsigned int max_state)
+{
+	return __alloc_percpu_gfp(max(max_state, 1U) * sizeof(u64),
+				  sizeof(u64), GFP_ATOMIC);
+}
+
+static void uid_entry_reclaim(struct rcu_head *rcu)
+{
+	struct uid_entry *uid_entry = container_of(rcu, struct uid_entry, rcu);
+
+	free_percpu(uid_entry->pcpu_time_in_state);
+	kfree(uid_entry->concurrent_times);
+	kfree(uid_entry);
+}
+
+/* The replacement entry took over concurrent_times */
+static void uid_entry_resize_reclaim(struct rcu_head *rcu)
+{
+	struct uid_entry *uid_entry = container_of(rcu, struct uid_entry, rcu);
+
+	free_percpu(uid_entry->pcpu_time_in_state);
+	kfree(uid_entry);
+}
+
 /* Caller must hold rcu_read_lock() */
 static struct uid_entry *find_uid_entry_rcu(uid_t uid)
 {
@@ -97,25 +147,32 @@ static struct uid_entry *find_or_register_uid_locked(uid_t uid)
 	unsigned int max_state = READ_ONCE(next_offset);
 	size_t alloc_size = sizeof(*uid_entry) + max_state *
 		sizeof(uid_entry->time_in_state[0]);
+	unsigned int i;
 
 	uid_entry = find_uid_entry_locked(uid);
 	if (uid_entry) {
 		if (uid_entry->max_state == max_state)
 			return uid_entry;
 		/* uid_entry->time_in_state is too small to track all freqs, so
-		 * expand it.
+		 * replace it with a bigger one, carrying the folded times over.
+		 * A tick racing with the swap on another CPU may be lost.
 		 */
-		temp = __krealloc(uid_entry, alloc_size, GFP_ATOMIC);
+		temp = kzalloc(alloc_size, GFP_ATOMIC);
 		if (!temp)
 			return uid_entry;
-		temp->max_state = max_state;
-		memset(temp->time_in_state + uid_entry->max_state, 0,
-		       (max_state - uid_entry->max_state) *
-		       sizeof(uid_entry->time_in_state[0]));
-		if (temp != uid_entry) {
-			hlist_replace_rcu(&uid_entry->hash, &temp->hash);
-			kfree_rcu(uid_entry, rcu);
+		temp->pcpu_time_in_state = alloc_uid_pcpu_times(max_state);
+		if (!temp->pcpu_time_in_state) {
+			kfree(temp);
+			return uid_entry;
 		}
+		temp->uid = uid;
+		temp->max_state = max_state;
+		temp->concurrent_times = uid_entry->concurrent_times;
+		for (i = 0; i < uid_entry->max_state; i++)
+			temp->time_in_state[i] = uid_entry_time(uid_entry, i);
+
+		hlist_replace_rcu(&uid_entry->hash, &temp->hash);
+		call_rcu(&uid_entry->rcu, uid_entry_resize_reclaim);
 		return temp;
 	}
 
@@ -127,6 +184,12 @@ static struct uid_entry *find_or_register_uid_locked(uid_t uid)
 		kfree(uid_entry);
 		return NULL;
 	}
+	uid_entry->pcpu_time_in_state = alloc_uid_pcpu_times(max_state);
+	if (!uid_entry->pcpu_time_in_state) {
+		kfree(times);
+		kfree(uid_entry);
+		return NULL;
+	}
 
 	uid_entry->uid = uid;
 	uid_entry->max_state = max_state;
@@ -155,7 +218,7 @@ static int single_uid_time_in_state_show(struct seq_file *m, void *ptr)
 	}
 
 	for (i = 0; i < uid_entry->max_state; ++i) {
-		u64 time = nsec_to_clock_t(uid_entry->time_in_state[i]);
+		u64 time = nsec_to_clock_t(uid_entry_time(uid_entry, i));
 		seq_write(m, &time, sizeof(time));
 	}
 
@@ -215,7 +278,7 @@ static int uid_time_in_state_seq_show(struct seq_file *m, void *v)
 			seq_putc(m, ':');
 		}
 		for (i = 0; i < uid_entry->max_state; ++i) {
-			u64 time = nsec_to_clock_t(uid_entry->time_in_state[i]);
+			u64 time = nsec_to_clock_t(uid_entry_time(uid_entry, i));
 			seq_put_decimal_ull(m, " ", time);
 		}
 		if (uid_entry->max_state)
@@ -346,7 +409,7 @@ static int time_in_state_seq_show(struct seq_file *m, void *v)
 		}
 
 		for (i = 0; i < uid_entry->max_state; ++i) {
-			time = nsec_to_clock_t(uid_entry->time_in_state[i]);
+			time = nsec_to_clock_t(uid_entry_time(uid_entry, i));
 			seq_write(m, &time, sizeof(time));
 		}
 	}
@@ -443,6 +506,75 @@ int proc_time_in_state_show(struct seq_file *m, struct pid_namespace *ns,
 	return 0;
 }
 
+/* Busy power of @cpu at @freq from the energy model, 0 if unknown */
+static unsigned long cpufreq_times_busy_power(int cpu, unsigned int freq)
+{
+#ifdef CONFIG_GENERIC_ARCH_TOPOLOGY
+	struct sched_group_energy *sge = sge_array[cpu][SD_LEVEL0];
+	int i;
+
+	if (!sge)
+		return 0;
+
+	for (i = 0; i < sge->nr_cap_states; i++)
+		if (sge->cap_states[i].frequency == freq)
+			return sge->cap_states[i].power;
+#endif
+	return 0;
+}
+
+/**
+ * cpufreq_task_times_energy() - estimate the cpu energy used by a task
+ * @p: task to account
+ * @cputime: if not NULL, set to the time @p ran on any cpu, in ns
+ *
+ * The energy is the task's time at each frequency weighted by the busy
+ * power of that frequency in the energy model.
+ *
+ * Return: energy in microjoules when the energy model is in mW, 0 if
+ * there is no energy model.
+ */
+u64 cpufreq_task_times_energy(struct task_struct *p, u64 *cputime)
+{
+	unsigned int cpu, i;
+	unsigned long flags;
+	struct cpu_freqs *freqs;
+	struct cpu_freqs *last_freqs = NULL;
+	u64 energy = 0, total = 0;
+
+	spin_lock_irqsave(&task_time_in_state_lock, flags);
+	for_each_possible_cpu(cpu) {
+		freqs = all_freqs[cpu];
+		if (!freqs || freqs == last_freqs)
+			continue;
+		last_freqs = freqs;
+
+		for (i = 0; i < freqs->max_state; i++) {
+			u64 t;
+
+			if (freqs->offset + i >= p->max_state ||
+			    !p->time_in_state)
+				break;
+
+			t = p->time_in_state[freqs->offset + i];
+			if (!t)
+				continue;
+
+			total += t;
+			energy += t * cpufreq_times_busy_power(cpu,
+						freqs->freq_table[i]);
+		}
+	}
+	spin_unlock_irqrestore(&task_time_in_state_lock, flags);
+
+	if (cputime)
+		*cputime = total;
+
+	/* ns * mW is pJ */
+	return div_u64(energy, 1000000);
+}
+EXPORT_SYMBOL_GPL(cpufreq_task_times_energy);
+
 void cpufreq_acct_update_power(struct task_struct *p, u64 cputime)
 {
 	unsigned long flags;
@@ -467,19 +599,25 @@ void cpufreq_acct_update_power(struct task_struct *p, u64 cputime)
 		p->time_in_state[state] += cputime;
 	spin_unlock_irqrestore(&task_time_in_state_lock, flags);
 
-	spin_lock_irqsave(&uid_lock, flags);
-	uid_entry = find_or_register_uid_locked(uid);
-	if (uid_entry && state < uid_entry->max_state)
-		uid_entry->time_in_state[state] += cputime;
-	spin_unlock_irqrestore(&uid_lock, flags);
-
+	/* uid_lock is only needed to add or resize an entry */
 	rcu_read_lock();
 	uid_entry = find_uid_entry_rcu(uid);
+	if (!uid_entry || state >= uid_entry->max_state) {
+		rcu_read_unlock();
+		spin_lock_irqsave(&uid_lock, flags);
+		find_or_register_uid_locked(uid);
+		spin_unlock_irqrestore(&uid_lock, flags);
+		rcu_read_lock();
+		uid_entry = find_uid_entry_rcu(uid);
+	}
 	if (!uid_entry) {
 		rcu_read_unlock();
 		return;
 	}
 
+	if (state < uid_entry->max_state)
+		this_cpu_add(uid_entry->pcpu_time_in_state[state], cputime);
+
 	for_each_possible_cpu(cpu)
 		if (!idle_cpu(cpu))
 			++active_cpu_cnt;
@@ -559,14 +697,6 @@ void cpufreq_times_create_policy(struct cpufreq_policy *policy)
 		all_freqs[cpu] = freqs;
 }
 
-static void uid_entry_reclaim(struct rcu_head *rcu)
-{
-	struct uid_entry *uid_entry = container_of(rcu, struct uid_entry, rcu);
-
-	kfree(uid_entry->concurrent_times);
-	kfree(uid_entry);
-}
-
 void cpufreq_task_times_remove_uids(uid_t uid_start, uid_t uid_end)
 {
 	struct uid_entry *uid_entry;
@@ -683,6 +813,130 @@ const struct file_operations time_in_state_fops = {
 	.release	= seq_release,
 };
 
+struct uid_tis_snapshot {
+	void *buf;
+	size_t len;
+};
+
+/*
+ * Build the binary snapshot described in uapi/linux/cpufreq_times.h.
+ * The buffer is vmalloc_user() memory so that it can be mapped as is.
+ */
+static int uid_time_in_state_bin_open(struct inode *inode, struct file *file)
+{
+	unsigned int nr_freqs = READ_ONCE(next_offset);
+	unsigned int nr_uids = 0, max_uids, bkt, i;
+	struct cpu_freqs *freqs, *last_freqs = NULL;
+	size_t header_size, record_size;
+	struct uid_tis_snapshot *snap;
+	struct uid_entry *uid_entry;
+	struct uid_tis_header *hdr;
+	u32 *freq;
+	int cpu;
+
+	snap = kzalloc(sizeof(*snap), GFP_KERNEL);
+	if (!snap)
+		return -ENOMEM;
+
+	rcu_read_lock();
+	hash_for_each_rcu(uid_hash_table, bkt, uid_entry, hash)
+		nr_uids++;
+	rcu_read_unlock();
+
+	/* Leave room for UIDs registering while the snapshot is taken */
+	max_uids = nr_uids + 16;
+	header_size = ALIGN(sizeof(*hdr) + nr_freqs * sizeof(u32), sizeof(u64));
+	record_size = sizeof(struct uid_tis_record) + nr_freqs * sizeof(u64);
+
+	snap->buf = vmalloc_user(PAGE_ALIGN(header_size +
+					    max_uids * record_size));
+	if (!snap->buf) {
+		kfree(snap);
+		return -ENOMEM;
+	}
+
+	hdr = snap->buf;
+	hdr->magic = UID_TIS_MAGIC;
+	hdr->version = UID_TIS_VERSION;
+	hdr->header_size = header_size;
+	hdr->record_size = record_size;
+	hdr->nr_freqs = nr_freqs;
+
+	freq = (u32 *)(hdr + 1);
+	for_each_possible_cpu(cpu) {
+		freqs = all_freqs[cpu];
+		if (!freqs || freqs == last_freqs)
+			continue;
+		last_freqs = freqs;
+		for (i = 0; i < freqs->max_state &&
+			    freqs->offset + i < nr_freqs; i++)
+			freq[freqs->offset + i] = freqs->freq_table[i];
+	}
+
+	nr_uids = 0;
+	rcu_read_lock();
+	hash_for_each_rcu(uid_hash_table, bkt, uid_entry, hash) {
+		struct uid_tis_record *rec;
+		u64 *time;
+
+		if (nr_uids == max_uids)
+			continue;
+
+		rec = snap->buf + header_size + nr_uids * record_size;
+		rec->uid = uid_entry->uid;
+		time = (u64 *)(rec + 1);
+		for (i = 0; i < min(uid_entry->max_state, nr_freqs); i++)
+			time[i] = uid_entry_time(uid_entry, i);
+		nr_uids++;
+	}
+	rcu_read_unlock();
+
+	hdr->nr_uids = nr_uids;
+	snap->len = header_size + nr_uids * record_size;
+	file->private_data = snap;
+
+	return 0;
+}
+
+static ssize_t uid_time_in_state_bin_read(struct file *file, char __user *buf,
+					  size_t count, loff_t *ppos)
+{
+	struct uid_tis_snapshot *snap = file->private_data;
+
+	return simple_read_from_buffer(buf, count, ppos, snap->buf, snap->len);
+}
+
+static int uid_time_in_state_bin_mmap(struct file *file,
+				      struct vm_area_struct *vma)
+{
+	struct uid_tis_snapshot *snap = file->private_data;
+
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+	vma->vm_flags &= ~VM_MAYWRITE;
+
+	return remap_vmalloc_range(vma, snap->buf, vma->vm_pgoff);
+}
+
+static int uid_time_in_state_bin_release(struct inode *inode,
+					 struct file *file)
+{
+	struct uid_tis_snapshot *snap = file->private_data;
+
+	vfree(snap->buf);
+	kfree(snap);
+
+	return 0;
+}
+
+static const struct file_operations uid_time_in_state_bin_fops = {
+	.open		= uid_time_in_state_bin_open,
+	.read		= uid_time_in_state_bin_read,
+	.mmap		= uid_time_in_state_bin_mmap,
+	.llseek		= default_llseek,
+	.release	= uid_time_in_state_bin_release,
+};
+
 static int __init cpufreq_times_init(void)
 {
 	struct proc_dir_entry *uid_cpupower;
@@ -690,6 +944,9 @@ static int __init cpufreq_times_init(void)
 	proc_create_data("uid_time_in_state", 0444, NULL,
 			 &uid_time_in_state_fops, NULL);
 
+	proc_create_data("uid_time_in_state_bin", 0444, NULL,
+			 &uid_time_in_state_bin_fops, NULL);
+
 	proc_create_data("uid_concurrent_active_time", 0444, NULL,
 			 &concurrent_active_time_fops, NULL);
 
@@ -71,6 +71,13 @@ module_param_named(lpm_prediction, lpm_prediction, bool, 0664);
 static bool lpm_ipi_prediction = true;
 module_param_named(lpm_ipi_prediction, lpm_ipi_prediction, bool, 0664);
 
+/*
+ * Predict the idle duration the way the TEO governor does instead of with
+ * the residency history. Only used where lpm_prediction is enabled.
+ */
+static bool lpm_teo;
+module_param_named(lpm_teo, lpm_teo, bool, 0664);
+
 struct lpm_history {
 	uint32_t resi[MAXSAMPLES];
 	int mode[MAXSAMPLES];
@@ -87,8 +94,34 @@ struct ipi_history {
 	ktime_t cpu_idle_resched_ts;
 };
 
+#define TEO_PULSE 1024
+#define TEO_DECAY_SHIFT 3
+#define TEO_INTERVALS 8
+
+/*
+ * A wakeup matches a level when the idle duration was between its
+ * min_residency and the min_residency of the next level. It is a hit for
+ * the level matching the time till the next timer if that level matched
+ * the idle duration too, else a miss, and an early hit for the level that
+ * matched the idle duration.
+ */
+struct lpm_teo_level {
+	uint32_t early_hits;
+	uint32_t hits;
+	uint32_t misses;
+};
+
+struct lpm_teo_cpu {
+	bool selected;
+	uint32_t sleep_us;
+	int interval_idx;
+	uint32_t intervals[TEO_INTERVALS];
+	struct lpm_teo_level levels[NR_LPM_LEVELS];
+};
+
 static DEFINE_PER_CPU(struct lpm_history, hist);
 static DEFINE_PER_CPU(struct ipi_history, cpu_ipi_history);
+static DEFINE_PER_CPU(struct lpm_teo_cpu, teo_cpu);
 static DEFINE_PER_CPU(struct lpm_cpu*, cpu_lpm);
 static bool suspend_in_progress;
 static struct hrtimer lpm_hrtimer;
@@ -561,6 +594,176 @@ static uint64_t lpm_cpuidle_predict(struct cpuidle_device *dev,
 	return 0;
 }
 
+static void lpm_teo_update(struct cpuidle_device *dev, struct lpm_cpu *cpu,
+		int idx)
+{
+	struct lpm_teo_cpu *teo = &per_cpu(teo_cpu, dev->cpu);
+	struct lpm_history *history = &per_cpu(hist, dev->cpu);
+	uint32_t measured_us = dev->last_residency;
+	uint32_t lat = cpu->levels[idx].pwr.exit_latency;
+	bool timer_wakeup;
+	int i, idx_hit = -1, idx_timer = -1;
+
+	if (!teo->selected)
+		return;
+
+	teo->selected = false;
+
+	/* A wakeup from the history timer stands for the full sleep */
+	timer_wakeup = history->hinvalid || measured_us >= teo->sleep_us;
+	if (timer_wakeup)
+		measured_us = teo->sleep_us;
+	else if (measured_us >= lat)
+		measured_us -= lat / 2;
+	else
+		measured_us /= 2;
+
+	for (i = 0; i < cpu->nlevels; i++) {
+		struct lpm_teo_level *lvl = &teo->levels[i];
+		uint32_t min_residency = cpu->levels[i].pwr.min_residency;
+
+		lvl->early_hits -= lvl->early_hits >> TEO_DECAY_SHIFT;
+
+		if (min_residency <= teo->sleep_us) {
+			idx_timer = i;
+			if (min_residency <= measured_us)
+				idx_hit = i;
+		}
+	}
+
+	if (idx_timer >= 0) {
+		struct lpm_teo_level *lvl = &teo->levels[idx_timer];
+
+		lvl->hits -= lvl->hits >> TEO_DECAY_SHIFT;
+		lvl->misses -= lvl->misses >> TEO_DECAY_SHIFT;
+
+		if (idx_timer > idx_hit) {
+			lvl->misses += TEO_PULSE;
+			if (idx_hit >= 0)
+				teo->levels[idx_hit].early_hits += TEO_PULSE;
+		} else {
+			lvl->hits += TEO_PULSE;
+		}
+	}
+
+	/* Only non-timer wakeups are used for pattern detection */
+	teo->intervals[teo->interval_idx++] = timer_wakeup ? UINT_MAX :
+						measured_us;
+	if (teo->interval_idx >= TEO_INTERVALS)
+		teo->interval_idx = 0;
+}
+
+static int lpm_teo_shallower_level(struct cpuidle_device *dev,
+		struct lpm_cpu *cpu, int idx, uint32_t duration_us)
+{
+	int i;
+
+	for (i = idx - 1; i >= 0; i--) {
+		if (!lpm_cpu_mode_allow(dev->cpu, i, true))
+			continue;
+
+		idx = i;
+		if (cpu->levels[i].pwr.min_residency <= duration_us)
+			break;
+	}
+
+	return idx;
+}
+
+/*
+ * Pick the deepest level the time till the next timer allows, unless it
+ * was missed more often than hit, in which case take the shallower level
+ * with the most early hits. Then, if most recent non-timer wakeups came
+ * before that level's min_residency, go shallower to match their average.
+ * Returns the level and sets *pred_us to the expected idle duration.
+ */
+static int lpm_teo_select(struct cpuidle_device *dev, struct lpm_cpu *cpu,
+		uint32_t sleep_us, uint32_t latency_us, uint32_t *pred_us)
+{
+	struct lpm_teo_cpu *teo = &per_cpu(teo_cpu, dev->cpu);
+	uint32_t duration_us = sleep_us, count = 0;
+	int max_early_idx = -1, idx = -1, i;
+	uint64_t sum = 0;
+
+	teo->selected = true;
+	teo->sleep_us = sleep_us;
+
+	for (i = 0; i < cpu->nlevels; i++) {
+		struct power_params *pwr = &cpu->levels[i].pwr;
+
+		if (!lpm_cpu_mode_allow(dev->cpu, i, true)) {
+			if (max_early_idx >= 0 &&
+			    count < teo->levels[i].early_hits)
+				count = teo->levels[i].early_hits;
+			continue;
+		}
+
+		if (idx < 0)
+			idx = i;
+
+		if (pwr->min_residency > sleep_us ||
+		    latency_us <= pwr->exit_latency)
+			break;
+
+		idx = i;
+
+		if (count < teo->levels[i].early_hits) {
+			count = teo->levels[i].early_hits;
+			max_early_idx = i;
+		}
+	}
+
+	if (idx < 0) {
+		*pred_us = sleep_us;
+		return 0;
+	}
+
+	if (teo->levels[idx].hits <= teo->levels[idx].misses &&
+	    max_early_idx >= 0) {
+		idx = max_early_idx;
+		duration_us = cpu->levels[idx].pwr.min_residency;
+	}
+
+	if (idx > 0) {
+		count = 0;
+		for (i = 0; i < TEO_INTERVALS; i++) {
+			if (teo->intervals[i] >=
+					cpu->levels[idx].pwr.min_residency)
+				continue;
+
+			count++;
+			sum += teo->intervals[i];
+		}
+
+		if (count > TEO_INTERVALS / 2) {
+			duration_us = div64_u64(sum, count);
+			idx = lpm_teo_shallower_level(dev, cpu, idx,
+						      duration_us);
+		}
+	}
+
+	*pred_us = duration_us;
+	return idx;
+}
+
+/*
+ * Classify an idle period against the level it was spent in: too short
+ * when it ended before the level paid off, too long when the next deeper
+ * level would have paid off too.
+ */
+static enum lpm_pred_result lpm_classify_residency(
+		struct power_params *pwr, struct power_params *deeper,
+		uint64_t residency_us)
+{
+	if (residency_us < pwr->min_residency)
+		return LPM_PRED_TOO_SHORT;
+
+	if (deeper && residency_us >= deeper->min_residency)
+		return LPM_PRED_TOO_LONG;
+
+	return LPM_PRED_HIT;
+}
+
 static inline void invalidate_predict_history(struct cpuidle_device *dev)
 {
 	struct lpm_history *history = &per_cpu(hist, dev->cpu);
@@ -668,7 +871,25 @@ static int cpu_power_select(struct cpuidle_device *dev,
 				next_wakeup_us = next_event_us - lvl_latency_us;
 		}
 
-		if (!i && !cpu_isolated(dev->cpu)) {
+		if (!i && !cpu_isolated(dev->cpu) && lpm_prediction &&
+				cpu->lpm_prediction && lpm_teo) {
+			struct lpm_history *history = &per_cpu(hist, dev->cpu);
+			uint32_t teo_us;
+			int teo_idx;
+
+			/* The history timer still catches a misprediction */
+			teo_idx = lpm_teo_select(dev, cpu, next_wakeup_us,
+						 latency_us, &teo_us);
+			if (teo_us < next_wakeup_us) {
+				idx_restrict = teo_idx + 1;
+				idx_restrict_time = teo_us + cpu->tmr_add;
+				history->stime = ktime_to_us(ktime_get()) +
+						 teo_us;
+			} else {
+				history->stime = 0;
+			}
+			invalidate_predict_history(dev);
+		} else if (!i && !cpu_isolated(dev->cpu)) {
 			/*
 			 * If the next_wake_us itself is not sufficient for
 			 * deeper low power modes than clock gating do not
@@ -1213,9 +1434,18 @@ static void cluster_unprepare(struct lpm_cluster *cluster,
 	if (!first_cpu || cluster->last_level == cluster->default_level)
 		goto unlock_return;
 
-	if (!IS_ERR_OR_NULL(cluster->stats) && cluster->stats->sleep_time)
+	if (!IS_ERR_OR_NULL(cluster->stats) && cluster->stats->sleep_time) {
 		cluster->stats->sleep_time = end_time -
 			cluster->stats->sleep_time;
+		if (from_idle && success)
+			lpm_stats_cluster_pred(cluster->stats,
+				cluster->last_level, lpm_classify_residency(
+				&cluster->levels[cluster->last_level].pwr,
+				cluster->last_level + 1 < cluster->nlevels ?
+				&cluster->levels[cluster->last_level + 1].pwr :
+				NULL, div_u64(cluster->stats->sleep_time,
+				NSEC_PER_USEC)));
+	}
 	lpm_stats_cluster_exit(cluster->stats, cluster->last_level, success);
 
 	level = &cluster->levels[cluster->last_level];
@@ -1437,6 +1667,13 @@ static int lpm_cpuidle_enter(struct cpuidle_device *dev,
 	cluster_unprepare(cpu->parent, cpumask, idx, true, end_time, success);
 	cpu_unprepare(cpu, idx, true);
 	dev->last_residency = ktime_us_delta(ktime_get(), start);
+	if (success)
+		lpm_stats_cpu_pred(idx, lpm_classify_residency(
+				&cpu->levels[idx].pwr,
+				idx + 1 < cpu->nlevels ?
+				&cpu->levels[idx + 1].pwr : NULL,
+				dev->last_residency));
+	lpm_teo_update(dev, cpu, idx);
 	update_history(dev, idx);
 	trace_cpu_idle_exit(idx, success);
 	if (lpm_prediction && cpu->lpm_prediction) {
@@ -29,11 +29,15 @@
 #include <linux/platform_device.h>
 #include <linux/of.h>
 #include <linux/devfreq.h>
+#include <linux/msm-bus.h>
 #include <trace/events/power.h>
 #include "governor.h"
 #include "governor_bw_hwmon.h"
 
 #define NUM_MBPS_ZONES		10
+/* Up to NUM_PRED_PERIODS - 1 periodic clients, each learnt in phase buckets */
+#define NUM_PRED_PERIODS	5
+#define PRED_BUCKETS		16
 struct hwmon_node {
 	unsigned int guard_band_mbps;
 	unsigned int decay_rate;
@@ -50,6 +54,14 @@ struct hwmon_node {
 	unsigned int idle_mbps;
 	unsigned int use_ab;
 	unsigned int mbps_zones[NUM_MBPS_ZONES];
+	unsigned int pred_mode;
+	unsigned int pred_period_us[NUM_PRED_PERIODS];
+	unsigned long pred_bkt[NUM_PRED_PERIODS][PRED_BUCKETS];
+	unsigned long pred_mbps;
+	u64 pred_samples;
+	u64 pred_abs_err;
+	u64 pred_under;
+	u64 pred_under_mbps;
 
 	unsigned long prev_ab;
 	unsigned long *dev_ab;
@@ -238,6 +250,7 @@ static int __bw_hwmon_sw_sample_end(struct bw_hwmon *hwmon)
 				mbps,
 				us,
 				wake);
+	msm_bus_dbg_ddr_meas(dev_name(df->dev.parent), mbps);
 
 	return wake;
 }
@@ -274,6 +287,7 @@ static int __bw_hwmon_hw_sample_end(struct bw_hwmon *hwmon)
 				mbps,
 				node->sample_ms * USEC_PER_MSEC,
 				wake);
+	msm_bus_dbg_ddr_meas(dev_name(df->dev.parent), mbps);
 
 	return 1;
 }
@@ -309,6 +323,70 @@ unsigned long to_mbps_zone(struct hwmon_node *node, unsigned long mbps)
 	return node->hw->df->max_freq;
 }
 
+static unsigned int pred_bucket(u64 now_us, unsigned int period_us)
+{
+	u32 rem;
+
+	div_u64_rem(now_us, period_us, &rem);
+	return ((u64)rem * PRED_BUCKETS) / period_us;
+}
+
+/*
+ * Score the previous prediction against the measurement, then learn the
+ * measurement into the phase bucket of every periodic client. A bucket
+ * jumps to a higher measurement and decays by a quarter towards a lower
+ * one, so a burst that recurs every period is remembered.
+ */
+static void pred_update(struct hwmon_node *node, u64 now_us,
+			unsigned long meas_mbps)
+{
+	unsigned long *bkt;
+	unsigned int i;
+
+	if (node->pred_mbps || meas_mbps) {
+		node->pred_samples++;
+		if (meas_mbps > node->pred_mbps) {
+			node->pred_abs_err += meas_mbps - node->pred_mbps;
+			node->pred_under++;
+			node->pred_under_mbps += meas_mbps - node->pred_mbps;
+		} else {
+			node->pred_abs_err += node->pred_mbps - meas_mbps;
+		}
+	}
+
+	for (i = 0; i < NUM_PRED_PERIODS && node->pred_period_us[i]; i++) {
+		bkt = &node->pred_bkt[i][pred_bucket(now_us,
+						node->pred_period_us[i])];
+		if (meas_mbps >= *bkt)
+			*bkt = meas_mbps;
+		else
+			*bkt -= (*bkt - meas_mbps) / 4;
+	}
+}
+
+/* Highest learnt bandwidth over the phases the next window will cover. */
+static unsigned long pred_next(struct hwmon_node *node, u64 now_us,
+			       unsigned int window_ms)
+{
+	unsigned long pred = 0;
+	unsigned int i, b, n, first;
+	u64 window_us = (u64)window_ms * USEC_PER_MSEC;
+
+	for (i = 0; i < NUM_PRED_PERIODS && node->pred_period_us[i]; i++) {
+		first = pred_bucket(now_us, node->pred_period_us[i]);
+		if (window_us >= node->pred_period_us[i])
+			n = PRED_BUCKETS;
+		else
+			n = div_u64(window_us * PRED_BUCKETS,
+				    node->pred_period_us[i]) + 1;
+		for (b = 0; b < n; b++)
+			pred = max(pred, node->pred_bkt[i][(first + b) %
+							PRED_BUCKETS]);
+	}
+
+	return pred;
+}
+
 #define MIN_MBPS	500UL
 #define HIST_PEAK_TOL	60
 static unsigned long get_bw_and_set_irq(struct hwmon_node *node,
@@ -387,6 +465,21 @@ static unsigned long get_bw_and_set_irq(struct hwmon_node *node,
 		req_mbps = min(req_mbps, meas_mbps_zone);
 	}
 
+	/*
+	 * Pre-vote for the bursts the periodic clients are expected to
+	 * make before the next decision. Since the thresholds below follow
+	 * req_mbps, a predicted burst doesn't raise an interrupt and only
+	 * mispredictions do.
+	 */
+	if (node->pred_mode) {
+		u64 now_us = ktime_to_us(ktime_get());
+
+		pred_update(node, now_us, meas_mbps);
+		node->pred_mbps = pred_next(node, now_us,
+					    hw->df->profile->polling_ms);
+		req_mbps = max(req_mbps, node->pred_mbps);
+	}
+
 	hyst_lo_tol = (node->hyst_mbps * HIST_PEAK_TOL) / 100;
 	if (meas_mbps > node->hyst_mbps && meas_mbps > MIN_MBPS) {
 		hyst_lo_tol = (meas_mbps * HIST_PEAK_TOL) / 100;
@@ -813,6 +906,32 @@ gov_attr(hyst_length, 0U, 90U);
 gov_attr(idle_mbps, 0U, 2000U);
 gov_attr(use_ab, 0U, 1U);
 gov_list_attr(mbps_zones, NUM_MBPS_ZONES, 0U, UINT_MAX);
+gov_attr(pred_mode, 0U, 1U);
+gov_list_attr(pred_period_us, NUM_PRED_PERIODS, 1000U, 1000000U);
+
+static ssize_t pred_stats_show(struct device *dev,
+			struct device_attribute *attr, char *buf)
+{
+	struct devfreq *df = to_devfreq(dev);
+	struct hwmon_node *node = df->data;
+	u64 samples, abs_err, under, under_mbps;
+	unsigned long flags;
+
+	spin_lock_irqsave(&irq_lock, flags);
+	samples = node->pred_samples;
+	abs_err = node->pred_abs_err;
+	under = node->pred_under;
+	under_mbps = node->pred_under_mbps;
+	spin_unlock_irqrestore(&irq_lock, flags);
+
+	return snprintf(buf, PAGE_SIZE,
+			"samples: %llu\nmean abs err MBps: %llu\n"
+			"under predicted: %llu\nmean under MBps: %llu\n",
+			samples, samples ? div64_u64(abs_err, samples) : 0,
+			under, under ? div64_u64(under_mbps, under) : 0);
+}
+
+static DEVICE_ATTR_RO(pred_stats);
 
 static struct attribute *dev_attr[] = {
 	&dev_attr_guard_band_mbps.attr,
@@ -831,6 +950,9 @@ static struct attribute *dev_attr[] = {
 	&dev_attr_use_ab.attr,
 	&dev_attr_mbps_zones.attr,
 	&dev_attr_throttle_adj.attr,
+	&dev_attr_pred_mode.attr,
+	&dev_attr_pred_period_us.attr,
+	&dev_attr_pred_stats.attr,
 	NULL,
 };
 
@@ -29,14 +29,39 @@
 #include <linux/device.h>
 #include <linux/of.h>
 #include <linux/devfreq.h>
+#include <linux/slab.h>
+#include <linux/string.h>
 #include "governor.h"
 #include "governor_memlat.h"
 
 #include <trace/events/power.h>
 
+/*
+ * Profile 0 is the core-dev table from DT. The others can be loaded at
+ * runtime through profile_map, so userspace can switch maps per scene.
+ */
+#define MEMLAT_MAX_PROFILES	4
+#define MEMLAT_MAX_MAP_ENTRIES	32
+
+struct memlat_profile_stats {
+	u64 time_ns;
+	u64 samples;
+	u64 vote_sum;
+};
+
 struct memlat_node {
 	unsigned int ratio_ceil;
 	unsigned int stall_floor;
+	/*
+	 * In stall mode the vote follows the fraction of cycles a core is
+	 * stalled, reaching the full map frequency at stall_full percent.
+	 */
+	unsigned int stall_mode;
+	unsigned int stall_full;
+	unsigned int profile;
+	struct core_dev_map *maps[MEMLAT_MAX_PROFILES];
+	struct memlat_profile_stats stats[MEMLAT_MAX_PROFILES];
+	ktime_t last_sample;
 	bool mon_started;
 	bool already_zero;
 	struct list_head list;
@@ -91,16 +116,19 @@ static ssize_t show_map(struct device *dev, struct device_attribute *attr,
 {
 	struct devfreq *df = to_devfreq(dev);
 	struct memlat_node *n = df->data;
-	struct core_dev_map *map = n->hw->freq_map;
+	struct core_dev_map *map;
 	unsigned int cnt = 0;
 
 	cnt += snprintf(buf, PAGE_SIZE, "Core freq (MHz)\tDevice BW\n");
 
+	mutex_lock(&df->lock);
+	map = n->hw->freq_map;
 	while (map->core_mhz && cnt < PAGE_SIZE) {
 		cnt += snprintf(buf + cnt, PAGE_SIZE - cnt, "%15u\t%9u\n",
 				map->core_mhz, map->target_freq);
 		map++;
 	}
+	mutex_unlock(&df->lock);
 	if (cnt < PAGE_SIZE)
 		cnt += snprintf(buf + cnt, PAGE_SIZE - cnt, "\n");
 
@@ -109,6 +137,142 @@ static ssize_t show_map(struct device *dev, struct device_attribute *attr,
 
 static DEVICE_ATTR(freq_map, 0444, show_map, NULL);
 
+static ssize_t show_profile(struct device *dev, struct device_attribute *attr,
+			    char *buf)
+{
+	struct devfreq *df = to_devfreq(dev);
+	struct memlat_node *n = df->data;
+
+	return snprintf(buf, PAGE_SIZE, "%u\n", n->profile);
+}
+
+static ssize_t store_profile(struct device *dev,
+			     struct device_attribute *attr, const char *buf,
+			     size_t count)
+{
+	struct devfreq *df = to_devfreq(dev);
+	struct memlat_node *n = df->data;
+	unsigned int val;
+	int ret;
+
+	ret = kstrtouint(buf, 10, &val);
+	if (ret)
+		return ret;
+	if (val >= MEMLAT_MAX_PROFILES)
+		return -EINVAL;
+
+	mutex_lock(&df->lock);
+	if (!n->maps[val]) {
+		mutex_unlock(&df->lock);
+		return -ENOENT;
+	}
+	n->profile = val;
+	n->hw->freq_map = n->maps[val];
+	mutex_unlock(&df->lock);
+
+	return count;
+}
+
+static DEVICE_ATTR(profile, 0644, show_profile, store_profile);
+
+/*
+ * Load the map of a runtime profile as "<profile> <core kHz> <dev freq>
+ * ...", in the same units as qcom,core-dev-table, with core frequencies
+ * in ascending order.
+ */
+static ssize_t store_profile_map(struct device *dev,
+				 struct device_attribute *attr,
+				 const char *buf, size_t count)
+{
+	struct devfreq *df = to_devfreq(dev);
+	struct memlat_node *n = df->data;
+	unsigned int vals[1 + 2 * MEMLAT_MAX_MAP_ENTRIES];
+	struct core_dev_map *map, *old;
+	char *str, *orig, *tok;
+	int i, nf, nvals = 0;
+	int ret = 0;
+
+	orig = str = kstrndup(buf, count, GFP_KERNEL);
+	if (!str)
+		return -ENOMEM;
+
+	while ((tok = strsep(&str, " \t\n")) != NULL) {
+		if (!*tok)
+			continue;
+		if (nvals == ARRAY_SIZE(vals)) {
+			ret = -EINVAL;
+			break;
+		}
+		ret = kstrtouint(tok, 10, &vals[nvals++]);
+		if (ret)
+			break;
+	}
+	kfree(orig);
+	if (ret)
+		return ret;
+
+	if (nvals < 3 || !(nvals % 2) || !vals[0] ||
+	    vals[0] >= MEMLAT_MAX_PROFILES)
+		return -EINVAL;
+
+	nf = (nvals - 1) / 2;
+	map = kcalloc(nf + 1, sizeof(*map), GFP_KERNEL);
+	if (!map)
+		return -ENOMEM;
+
+	for (i = 0; i < nf; i++) {
+		map[i].core_mhz = vals[1 + 2 * i] / 1000;
+		map[i].target_freq = vals[2 + 2 * i];
+		if (!map[i].core_mhz ||
+		    (i && map[i].core_mhz <= map[i - 1].core_mhz)) {
+			kfree(map);
+			return -EINVAL;
+		}
+	}
+
+	mutex_lock(&df->lock);
+	old = n->maps[vals[0]];
+	n->maps[vals[0]] = map;
+	if (n->profile == vals[0])
+		n->hw->freq_map = map;
+	mutex_unlock(&df->lock);
+	kfree(old);
+
+	return count;
+}
+
+static DEVICE_ATTR(profile_map, 0200, NULL, store_profile_map);
+
+static ssize_t show_profile_stats(struct device *dev,
+				  struct device_attribute *attr, char *buf)
+{
+	struct devfreq *df = to_devfreq(dev);
+	struct memlat_node *n = df->data;
+	struct memlat_profile_stats *st;
+	unsigned int cnt = 0;
+	int i;
+
+	cnt += snprintf(buf, PAGE_SIZE,
+			"Profile\tTime (ms)\tSamples\tAvg vote\n");
+
+	mutex_lock(&df->lock);
+	for (i = 0; i < MEMLAT_MAX_PROFILES && cnt < PAGE_SIZE; i++) {
+		if (!n->maps[i])
+			continue;
+		st = &n->stats[i];
+		cnt += snprintf(buf + cnt, PAGE_SIZE - cnt,
+				"%7d\t%9llu\t%7llu\t%8llu\n", i,
+				div_u64(st->time_ns, NSEC_PER_MSEC),
+				st->samples, st->samples ?
+				div64_u64(st->vote_sum, st->samples) : 0);
+	}
+	mutex_unlock(&df->lock);
+
+	return cnt;
+}
+
+static DEVICE_ATTR(profile_stats, 0444, show_profile_stats, NULL);
+
 static unsigned long core_to_dev_freq(struct memlat_node *node,
 		unsigned long coref)
 {
@@ -266,8 +430,9 @@ static int devfreq_memlat_get_freq(struct devfreq *df,
 	int i, lat_dev = 0;
 	struct memlat_node *node = df->data;
 	struct memlat_hwmon *hw = node->hw;
-	unsigned long max_freq = 0;
-	unsigned int ratio;
+	unsigned long max_freq = 0, eff_freq;
+	unsigned int ratio, stall;
+	ktime_t now;
 
 	/*
 	 * node->resume_freq is set to 0 at the end of resume (after the update)
@@ -278,6 +443,7 @@ static int devfreq_memlat_get_freq(struct devfreq *df,
 	 */
 	if (!node->mon_started) {
 		*freq = node->resume_freq;
+		node->last_sample = 0;
 		return 0;
 	}
 
@@ -303,6 +469,20 @@ static int devfreq_memlat_get_freq(struct devfreq *df,
 		    || !hw->core_stats[i].freq)
 			continue;
 
+		if (node->stall_mode) {
+			stall = min(hw->core_stats[i].stall_pct,
+				    (unsigned long)node->stall_full);
+			if (stall < node->stall_floor)
+				continue;
+			eff_freq = mult_frac(hw->core_stats[i].freq, stall,
+					     node->stall_full);
+			if (eff_freq > max_freq) {
+				lat_dev = i;
+				max_freq = eff_freq;
+			}
+			continue;
+		}
+
 		if (ratio <= node->ratio_ceil
 		    && hw->core_stats[i].stall_pct >= node->stall_floor
 		    && hw->core_stats[i].freq > max_freq) {
@@ -325,22 +505,42 @@ static int devfreq_memlat_get_freq(struct devfreq *df,
 
 	node->already_zero = !max_freq;
 
+	now = ktime_get();
+	if (node->last_sample) {
+		struct memlat_profile_stats *st = &node->stats[node->profile];
+
+		st->time_ns += ktime_to_ns(ktime_sub(now, node->last_sample));
+		st->samples++;
+		st->vote_sum += max_freq;
+	}
+	node->last_sample = now;
+
 	*freq = max_freq;
 	return 0;
 }
 
 gov_attr(ratio_ceil, 1U, 20000U);
 gov_attr(stall_floor, 0U, 100U);
+gov_attr(stall_mode, 0U, 1U);
+gov_attr(stall_full, 1U, 100U);
 
 static struct attribute *memlat_dev_attr[] = {
 	&dev_attr_ratio_ceil.attr,
 	&dev_attr_stall_floor.attr,
+	&dev_attr_stall_mode.attr,
+	&dev_attr_stall_full.attr,
 	&dev_attr_freq_map.attr,
+	&dev_attr_profile.attr,
+	&dev_attr_profile_map.attr,
+	&dev_attr_profile_stats.attr,
 	NULL,
 };
 
 static struct attribute *compute_dev_attr[] = {
 	&dev_attr_freq_map.attr,
+	&dev_attr_profile.attr,
+	&dev_attr_profile_map.attr,
+	&dev_attr_profile_stats.attr,
 	NULL,
 };
 
@@ -490,6 +690,7 @@ static struct memlat_node *register_common(struct device *dev,
 		return ERR_PTR(-ENOMEM);
 
 	node->ratio_ceil = 10;
+	node->stall_full = 50;
 	node->hw = hw;
 
 	if (hw->get_child_of_node) {
@@ -504,6 +705,7 @@ static struct memlat_node *register_common(struct device *dev,
 		dev_err(dev, "Couldn't find the core-dev freq table!\n");
 		return ERR_PTR(-EINVAL);
 	}
+	node->maps[0] = hw->freq_map;
 
 	mutex_lock(&list_lock);
 	list_add_tail(&node->list, &memlat_list);
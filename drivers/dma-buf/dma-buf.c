@@ -120,6 +120,189 @@ static char *dmabuffs_dname(struct dentry *dentry, char *buffer, int buflen)
 			     dentry->d_name.name, ret > 0 ? name : "");
 }
 
+/*
+ * Parked attachments of cache_sgt_mapping exporters, hashed by buffer and
+ * device. dma_buf_map_cache_lock protects the hash, the LRU and every
+ * dmabuf->cached_attachments list, and is held across evictions so that a
+ * buffer cannot be released while one of its attachments is being evicted.
+ */
+#define DMA_BUF_MAP_CACHE_BITS	8
+#define DMA_BUF_MAP_CACHE_MAX	1024
+
+static DEFINE_HASHTABLE(dma_buf_map_cache, DMA_BUF_MAP_CACHE_BITS);
+static LIST_HEAD(dma_buf_map_cache_lru);
+static DEFINE_MUTEX(dma_buf_map_cache_lock);
+static unsigned long dma_buf_map_cache_count;
+
+static struct {
+	atomic_long_t attach_hits;
+	atomic_long_t map_hits;
+	atomic_long_t map_misses;
+	atomic_long_t evictions;
+} dma_buf_map_cache_stats;
+
+static inline unsigned long dma_buf_map_cache_key(struct dma_buf *dmabuf,
+						  struct device *dev)
+{
+	return (unsigned long)dmabuf ^ (unsigned long)dev;
+}
+
+static void dma_buf_map_cache_del(struct dma_buf_attachment *attach)
+{
+	lockdep_assert_held(&dma_buf_map_cache_lock);
+
+	hash_del(&attach->cache_hnode);
+	list_del(&attach->cache_lru);
+	list_del(&attach->cache_node);
+	dma_buf_map_cache_count--;
+}
+
+/*
+ * Unmap and detach an attachment already taken off the cache, with its
+ * buffer's lock held. The caller unlocks and frees the attachment.
+ */
+static void dma_buf_map_cache_evict_locked(struct dma_buf_attachment *attach)
+{
+	struct dma_buf *dmabuf = attach->dmabuf;
+
+	dmabuf->ops->unmap_dma_buf(attach, attach->sgt, attach->dir);
+	attach->sgt = NULL;
+	list_del(&attach->node);
+	if (dmabuf->ops->detach)
+		dmabuf->ops->detach(dmabuf, attach);
+	atomic_long_inc(&dma_buf_map_cache_stats.evictions);
+}
+
+static void dma_buf_map_cache_evict(struct dma_buf_attachment *attach)
+{
+	struct dma_buf *dmabuf = attach->dmabuf;
+
+	mutex_lock(&dmabuf->lock);
+	dma_buf_map_cache_evict_locked(attach);
+	mutex_unlock(&dmabuf->lock);
+	kmem_cache_free(kmem_attach_pool, attach);
+}
+
+static void dma_buf_map_cache_park(struct dma_buf_attachment *attach)
+{
+	struct dma_buf *dmabuf = attach->dmabuf;
+
+	mutex_lock(&dma_buf_map_cache_lock);
+	hash_add(dma_buf_map_cache, &attach->cache_hnode,
+		 dma_buf_map_cache_key(dmabuf, attach->dev));
+	list_add(&attach->cache_lru, &dma_buf_map_cache_lru);
+	list_add(&attach->cache_node, &dmabuf->cached_attachments);
+	if (++dma_buf_map_cache_count > DMA_BUF_MAP_CACHE_MAX) {
+		struct dma_buf_attachment *victim;
+
+		victim = list_last_entry(&dma_buf_map_cache_lru,
+					 struct dma_buf_attachment, cache_lru);
+		dma_buf_map_cache_del(victim);
+		dma_buf_map_cache_evict(victim);
+	}
+	mutex_unlock(&dma_buf_map_cache_lock);
+}
+
+static struct dma_buf_attachment *
+dma_buf_map_cache_take(struct dma_buf *dmabuf, struct device *dev)
+{
+	unsigned long key = dma_buf_map_cache_key(dmabuf, dev);
+	struct dma_buf_attachment *attach;
+
+	mutex_lock(&dma_buf_map_cache_lock);
+	hash_for_each_possible(dma_buf_map_cache, attach, cache_hnode, key) {
+		if (attach->dmabuf == dmabuf && attach->dev == dev) {
+			dma_buf_map_cache_del(attach);
+			mutex_unlock(&dma_buf_map_cache_lock);
+			/* Start out like a fresh attachment would */
+			attach->dma_map_attrs = 0;
+			atomic_long_inc(&dma_buf_map_cache_stats.attach_hits);
+			return attach;
+		}
+	}
+	mutex_unlock(&dma_buf_map_cache_lock);
+
+	return NULL;
+}
+
+static void dma_buf_map_cache_release(struct dma_buf *dmabuf)
+{
+	struct dma_buf_attachment *attach, *tmp;
+
+	mutex_lock(&dma_buf_map_cache_lock);
+	list_for_each_entry_safe(attach, tmp, &dmabuf->cached_attachments,
+				 cache_node) {
+		dma_buf_map_cache_del(attach);
+		dma_buf_map_cache_evict(attach);
+	}
+	mutex_unlock(&dma_buf_map_cache_lock);
+}
+
+/**
+ * dma_buf_map_cache_flush_device - drop the cached mappings of a device
+ * @dev:	[in]	device whose parked attachments are to be detached
+ *
+ * Drivers of devices with cached mappings must call this before the device
+ * goes away, as parked attachments keep pointing at it.
+ */
+void dma_buf_map_cache_flush_device(struct device *dev)
+{
+	struct dma_buf_attachment *attach, *tmp;
+
+	mutex_lock(&dma_buf_map_cache_lock);
+	list_for_each_entry_safe(attach, tmp, &dma_buf_map_cache_lru,
+				 cache_lru) {
+		if (attach->dev != dev)
+			continue;
+		dma_buf_map_cache_del(attach);
+		dma_buf_map_cache_evict(attach);
+	}
+	mutex_unlock(&dma_buf_map_cache_lock);
+}
+EXPORT_SYMBOL_GPL(dma_buf_map_cache_flush_device);
+
+static unsigned long dma_buf_map_cache_shrink_count(struct shrinker *shrink,
+						    struct shrink_control *sc)
+{
+	return READ_ONCE(dma_buf_map_cache_count);
+}
+
+static unsigned long dma_buf_map_cache_shrink_scan(struct shrinker *shrink,
+						   struct shrink_control *sc)
+{
+	struct dma_buf_attachment *attach, *tmp;
+	unsigned long freed = 0;
+
+	/* Either lock may be held by whoever is allocating */
+	if (!mutex_trylock(&dma_buf_map_cache_lock))
+		return SHRINK_STOP;
+
+	list_for_each_entry_safe_reverse(attach, tmp, &dma_buf_map_cache_lru,
+					 cache_lru) {
+		struct dma_buf *dmabuf = attach->dmabuf;
+
+		if (freed >= sc->nr_to_scan)
+			break;
+		if (!mutex_trylock(&dmabuf->lock))
+			continue;
+
+		dma_buf_map_cache_del(attach);
+		dma_buf_map_cache_evict_locked(attach);
+		mutex_unlock(&dmabuf->lock);
+		kmem_cache_free(kmem_attach_pool, attach);
+		freed++;
+	}
+	mutex_unlock(&dma_buf_map_cache_lock);
+
+	return freed;
+}
+
+static struct shrinker dma_buf_map_cache_shrinker = {
+	.count_objects = dma_buf_map_cache_shrink_count,
+	.scan_objects = dma_buf_map_cache_shrink_scan,
+	.seeks = DEFAULT_SEEKS,
+};
+
 static void dma_buf_release(struct dentry *dentry)
 {
 	struct dma_buf *dmabuf;
@@ -141,6 +324,9 @@ static void dma_buf_release(struct dentry *dentry)
 	 */
 	BUG_ON(dmabuf->cb_shared.active || dmabuf->cb_excl.active);
 
+	if (dmabuf->ops->cache_sgt_mapping)
+		dma_buf_map_cache_release(dmabuf);
+
 	dmabuf->ops->release(dmabuf);
 
 	dma_buf_ref_destroy(dmabuf);
@@ -427,11 +613,31 @@ static long dma_buf_set_name(struct dma_buf *dmabuf, const char __user *buf)
 	return ret;
 }
 
+static int dma_buf_sync_dir(u64 flags, enum dma_data_direction *dir)
+{
+	switch (flags & DMA_BUF_SYNC_RW) {
+	case DMA_BUF_SYNC_READ:
+		*dir = DMA_FROM_DEVICE;
+		break;
+	case DMA_BUF_SYNC_WRITE:
+		*dir = DMA_TO_DEVICE;
+		break;
+	case DMA_BUF_SYNC_RW:
+		*dir = DMA_BIDIRECTIONAL;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
 static long dma_buf_ioctl(struct file *file,
 			  unsigned int cmd, unsigned long arg)
 {
 	struct dma_buf *dmabuf;
 	struct dma_buf_sync sync;
+	struct dma_buf_sync_partial sync_p;
 	enum dma_data_direction dir;
 	int ret;
 
@@ -445,19 +651,9 @@ static long dma_buf_ioctl(struct file *file,
 		if (sync.flags & ~DMA_BUF_SYNC_VALID_FLAGS_MASK)
 			return -EINVAL;
 
-		switch (sync.flags & DMA_BUF_SYNC_RW) {
-		case DMA_BUF_SYNC_READ:
-			dir = DMA_FROM_DEVICE;
-			break;
-		case DMA_BUF_SYNC_WRITE:
-			dir = DMA_TO_DEVICE;
-			break;
-		case DMA_BUF_SYNC_RW:
-			dir = DMA_BIDIRECTIONAL;
-			break;
-		default:
-			return -EINVAL;
-		}
+		ret = dma_buf_sync_dir(sync.flags, &dir);
+		if (ret)
+			return ret;
 
 		if (sync.flags & DMA_BUF_SYNC_END)
 			if (sync.flags & DMA_BUF_SYNC_USER_MAPPED)
@@ -474,6 +670,33 @@ static long dma_buf_ioctl(struct file *file,
 
 		return ret;
 
+	case DMA_BUF_IOCTL_SYNC_PARTIAL:
+		if (copy_from_user(&sync_p, (void __user *) arg,
+				   sizeof(sync_p)))
+			return -EFAULT;
+
+		if (sync_p.flags & ~(DMA_BUF_SYNC_RW | DMA_BUF_SYNC_END))
+			return -EINVAL;
+
+		if (!sync_p.len || sync_p.offset > dmabuf->size ||
+		    sync_p.len > dmabuf->size - sync_p.offset)
+			return -EINVAL;
+
+		ret = dma_buf_sync_dir(sync_p.flags, &dir);
+		if (ret)
+			return ret;
+
+		if (sync_p.flags & DMA_BUF_SYNC_END)
+			ret = dma_buf_end_cpu_access_partial(dmabuf, dir,
+							     sync_p.offset,
+							     sync_p.len);
+		else
+			ret = dma_buf_begin_cpu_access_partial(dmabuf, dir,
+							       sync_p.offset,
+							       sync_p.len);
+
+		return ret;
+
 	case DMA_BUF_SET_NAME:
 		return dma_buf_set_name(dmabuf, (const char __user *)arg);
 
@@ -686,6 +909,7 @@ struct dma_buf *dma_buf_export(const struct dma_buf_export_info *exp_info)
 
 	mutex_init(&dmabuf->lock);
 	INIT_LIST_HEAD(&dmabuf->attachments);
+	INIT_LIST_HEAD(&dmabuf->cached_attachments);
 
 	dma_buf_ref_init(dmabuf);
 	dma_buf_ref_mod(dmabuf, 1);
@@ -807,6 +1031,12 @@ struct dma_buf_attachment *dma_buf_attach(struct dma_buf *dmabuf,
 	if (WARN_ON(!dmabuf || !dev))
 		return ERR_PTR(-EINVAL);
 
+	if (dmabuf->ops->cache_sgt_mapping) {
+		attach = dma_buf_map_cache_take(dmabuf, dev);
+		if (attach)
+			return attach;
+	}
+
 	attach = kmem_cache_zalloc(kmem_attach_pool, GFP_KERNEL);
 	if (attach == NULL)
 		return ERR_PTR(-ENOMEM);
@@ -846,6 +1076,11 @@ void dma_buf_detach(struct dma_buf *dmabuf, struct dma_buf_attachment *attach)
 	if (WARN_ON(!dmabuf || !attach))
 		return;
 
+	if (attach->sgt) {
+		dma_buf_map_cache_park(attach);
+		return;
+	}
+
 	mutex_lock(&dmabuf->lock);
 	list_del(&attach->node);
 	if (dmabuf->ops->detach)
@@ -881,10 +1116,34 @@ struct sg_table *dma_buf_map_attachment(struct dma_buf_attachment *attach,
 	if (WARN_ON(!attach || !attach->dmabuf))
 		return ERR_PTR(-EINVAL);
 
+	if (attach->sgt) {
+		if (attach->sgt_attrs == attach->dma_map_attrs &&
+		    (attach->dir == direction ||
+		     attach->dir == DMA_BIDIRECTIONAL)) {
+			atomic_long_inc(&dma_buf_map_cache_stats.map_hits);
+			return attach->sgt;
+		}
+
+		/*
+		 * Typically a parked attachment picked up by an importer that
+		 * maps it differently; the cached mapping is not in use.
+		 */
+		attach->dmabuf->ops->unmap_dma_buf(attach, attach->sgt,
+						   attach->dir);
+		attach->sgt = NULL;
+	}
+
 	sg_table = attach->dmabuf->ops->map_dma_buf(attach, direction);
 	if (!sg_table)
 		sg_table = ERR_PTR(-ENOMEM);
 
+	if (!IS_ERR(sg_table) && attach->dmabuf->ops->cache_sgt_mapping) {
+		attach->sgt = sg_table;
+		attach->dir = direction;
+		attach->sgt_attrs = attach->dma_map_attrs;
+		atomic_long_inc(&dma_buf_map_cache_stats.map_misses);
+	}
+
 	return sg_table;
 }
 EXPORT_SYMBOL_GPL(dma_buf_map_attachment);
@@ -908,6 +1167,9 @@ void dma_buf_unmap_attachment(struct dma_buf_attachment *attach,
 	if (WARN_ON(!attach || !attach->dmabuf || !sg_table))
 		return;
 
+	if (attach->sgt == sg_table)
+		return;
+
 	attach->dmabuf->ops->unmap_dma_buf(attach, sg_table,
 						direction);
 }
@@ -1112,9 +1374,12 @@ int dma_buf_begin_cpu_access_partial(struct dma_buf *dmabuf,
 	if (WARN_ON(!dmabuf))
 		return -EINVAL;
 
+	/* The whole buffer covers the range for exporters without ranges */
 	if (dmabuf->ops->begin_cpu_access_partial)
 		ret = dmabuf->ops->begin_cpu_access_partial(dmabuf, direction,
 							    offset, len);
+	else if (dmabuf->ops->begin_cpu_access)
+		ret = dmabuf->ops->begin_cpu_access(dmabuf, direction);
 
 	/* Ensure that all fences are waited upon - but we first allow
 	 * the native handler the chance to do so more efficiently if it
@@ -1177,6 +1442,8 @@ int dma_buf_end_cpu_access_partial(struct dma_buf *dmabuf,
 	if (dmabuf->ops->end_cpu_access_partial)
 		ret = dmabuf->ops->end_cpu_access_partial(dmabuf, direction,
 							  offset, len);
+	else if (dmabuf->ops->end_cpu_access)
+		ret = dmabuf->ops->end_cpu_access(dmabuf, direction);
 
 	return ret;
 }
@@ -1634,6 +1901,32 @@ static const struct file_operations dma_procs_debug_fops = {
 #ifdef CONFIG_DEBUG_FS
 static struct dentry *dma_buf_debugfs_dir;
 
+static int dma_buf_map_cache_show(struct seq_file *s, void *unused)
+{
+	seq_printf(s, "cached: %lu\n", READ_ONCE(dma_buf_map_cache_count));
+	seq_printf(s, "attach hits: %ld\n",
+		   atomic_long_read(&dma_buf_map_cache_stats.attach_hits));
+	seq_printf(s, "map hits: %ld\n",
+		   atomic_long_read(&dma_buf_map_cache_stats.map_hits));
+	seq_printf(s, "map misses: %ld\n",
+		   atomic_long_read(&dma_buf_map_cache_stats.map_misses));
+	seq_printf(s, "evictions: %ld\n",
+		   atomic_long_read(&dma_buf_map_cache_stats.evictions));
+	return 0;
+}
+
+static int dma_buf_map_cache_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, dma_buf_map_cache_show, NULL);
+}
+
+static const struct file_operations dma_buf_map_cache_fops = {
+	.open           = dma_buf_map_cache_open,
+	.read           = seq_read,
+	.llseek         = seq_lseek,
+	.release        = single_release
+};
+
 static int dma_buf_init_debugfs(void)
 {
 	struct dentry *d;
@@ -1663,8 +1956,14 @@ static int dma_buf_init_debugfs(void)
 		debugfs_remove_recursive(dma_buf_debugfs_dir);
 		dma_buf_debugfs_dir = NULL;
 		err = PTR_ERR(d);
+		return err;
 	}
 
+	d = debugfs_create_file("map_cache", 0444, dma_buf_debugfs_dir,
+				NULL, &dma_buf_map_cache_fops);
+	if (IS_ERR(d))
+		pr_debug("dma_buf: debugfs: failed to create node map_cache\n");
+
 	return err;
 }
 
@@ -1749,6 +2048,7 @@ static int __init dma_buf_init(void)
 
 	mutex_init(&db_list.lock);
 	INIT_LIST_HEAD(&db_list.head);
+	register_shrinker(&dma_buf_map_cache_shrinker);
 	dma_buf_init_debugfs();
 #if defined(OPLUS_FEATURE_PERFORMANCE) && defined(CONFIG_PROC_FS)
 	dma_buf_init_procfs();
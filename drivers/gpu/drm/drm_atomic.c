@@ -32,6 +32,7 @@
 #include <drm/drm_print.h>
 #include <linux/cpu_input_boost.h>
 #include <linux/devfreq_boost.h>
+#include <linux/frame_trace.h>
 #include <linux/sync_file.h>
 
 #include "drm_crtc_internal.h"
@@ -513,6 +514,8 @@ int drm_atomic_crtc_set_property(struct drm_crtc *crtc,
 			return -EFAULT;
 
 		set_out_fence_for_crtc(state->state, crtc, fence_ptr);
+	} else if (property == config->prop_target_vblank) {
+		state->target_vblank = val;
 	} else if (crtc->funcs->atomic_set_property)
 		return crtc->funcs->atomic_set_property(crtc, state, property, val);
 	else
@@ -557,6 +560,8 @@ drm_atomic_crtc_get_property(struct drm_crtc *crtc,
 		*val = (state->gamma_lut) ? state->gamma_lut->base.id : 0;
 	else if (property == config->prop_out_fence_ptr)
 		*val = 0;
+	else if (property == config->prop_target_vblank)
+		*val = state->target_vblank;
 	else if (crtc->funcs->atomic_get_property)
 		return crtc->funcs->atomic_get_property(crtc, state, property, val);
 	else
@@ -2365,11 +2370,13 @@ int drm_mode_atomic_ioctl(struct drm_device *dev,
 	if (arg->flags & DRM_MODE_ATOMIC_TEST_ONLY) {
 		ret = drm_atomic_check_only(state);
 	} else if (arg->flags & DRM_MODE_ATOMIC_NONBLOCK) {
+		frame_trace_commit();
 		ret = drm_atomic_nonblocking_commit(state);
 	} else {
 		if (unlikely(drm_debug & DRM_UT_STATE))
 			drm_atomic_print_state(state);
 
+		frame_trace_commit();
 		ret = drm_atomic_commit(state);
 	}
 
@@ -1345,6 +1345,9 @@ static void commit_tail(struct drm_atomic_state *old_state)
 {
 	struct drm_device *dev = old_state->dev;
 	const struct drm_mode_config_helper_funcs *funcs;
+	struct drm_crtc_state *new_crtc_state;
+	struct drm_crtc *crtc;
+	int i;
 
 	funcs = dev->mode_config.helper_private;
 
@@ -1352,11 +1355,19 @@ static void commit_tail(struct drm_atomic_state *old_state)
 
 	drm_atomic_helper_wait_for_dependencies(old_state);
 
+	for_each_new_crtc_in_state(old_state, crtc, new_crtc_state, i)
+		drm_crtc_wait_commit_deadline(crtc,
+					      new_crtc_state->target_vblank);
+
 	if (funcs && funcs->atomic_commit_tail)
 		funcs->atomic_commit_tail(old_state);
 	else
 		drm_atomic_helper_commit_tail(old_state);
 
+	for_each_new_crtc_in_state(old_state, crtc, new_crtc_state, i)
+		drm_crtc_commit_deadline_done(crtc,
+					      new_crtc_state->target_vblank);
+
 	drm_atomic_helper_commit_cleanup_done(old_state);
 
 	drm_atomic_state_put(old_state);
@@ -3203,6 +3214,7 @@ void __drm_atomic_helper_crtc_duplicate_state(struct drm_crtc *crtc,
 	state->zpos_changed = false;
 	state->event = NULL;
 	state->pageflip_flags = 0;
+	state->target_vblank = 0;
 }
 EXPORT_SYMBOL(__drm_atomic_helper_crtc_duplicate_state);
 
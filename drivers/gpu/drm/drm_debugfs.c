@@ -385,6 +385,36 @@ void drm_debugfs_connector_remove(struct drm_connector *connector)
 	connector->debugfs_entry = NULL;
 }
 
+static int commit_deadline_show(struct seq_file *m, void *data)
+{
+	struct drm_crtc *crtc = m->private;
+	struct drm_device *dev = crtc->dev;
+	struct drm_vblank_crtc *vblank;
+
+	if (!dev->num_crtcs)
+		return 0;
+
+	vblank = &dev->vblank[drm_crtc_index(crtc)];
+	seq_printf(m, "commits: %u\n", vblank->deadline_commits);
+	seq_printf(m, "late: %u\n", vblank->deadline_late);
+	seq_printf(m, "missed: %u\n", vblank->deadline_missed);
+
+	return 0;
+}
+
+static int commit_deadline_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, commit_deadline_show, inode->i_private);
+}
+
+static const struct file_operations drm_commit_deadline_fops = {
+	.owner = THIS_MODULE,
+	.open = commit_deadline_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 int drm_debugfs_crtc_add(struct drm_crtc *crtc)
 {
 	struct drm_minor *minor = crtc->dev->primary;
@@ -405,6 +435,10 @@ int drm_debugfs_crtc_add(struct drm_crtc *crtc)
 	if (drm_debugfs_crtc_crc_add(crtc))
 		goto error;
 
+	if (!debugfs_create_file("commit_deadline", S_IRUGO, root, crtc,
+				 &drm_commit_deadline_fops))
+		goto error;
+
 	return 0;
 
 error:
@@ -26,7 +26,10 @@
 
 #include <drm/drm_vblank.h>
 #include <drm/drmP.h>
+#include <linux/cpu_input_boost.h>
+#include <linux/devfreq_boost.h>
 #include <linux/export.h>
+#include <linux/frame_trace.h>
 
 #include "drm_trace.h"
 #include "drm_internal.h"
@@ -76,6 +79,11 @@
  */
 #define DRM_REDUNDANT_VBLIRQ_THRESH_NS 1000000
 
+/* Commits aiming further ahead than this are not held back */
+#define DRM_COMMIT_DEADLINE_MAX_FRAMES 4
+#define DRM_COMMIT_DEADLINE_SLACK_NS 50000
+#define DRM_COMMIT_DEADLINE_BOOST_MS 25
+
 static bool
 drm_get_last_vbltimestamp(struct drm_device *dev, unsigned int pipe,
 			  struct timeval *tvblank, bool in_vblank_irq);
@@ -90,12 +98,17 @@ unsigned int drm_timestamp_monotonic = 1;
 
 static int drm_vblank_offdelay = 5000;    /* Default to 5000 msecs. */
 
+static unsigned int drm_commit_deadline_margin = 3000;
+
 module_param_named(vblankoffdelay, drm_vblank_offdelay, int, 0600);
 module_param_named(timestamp_precision_usec, drm_timestamp_precision, int, 0600);
 module_param_named(timestamp_monotonic, drm_timestamp_monotonic, int, 0600);
 MODULE_PARM_DESC(vblankoffdelay, "Delay until vblank irq auto-disable [msecs] (0: never disable, <0: disable immediately)");
 MODULE_PARM_DESC(timestamp_precision_usec, "Max. error on timestamps [usecs]");
+module_param_named(commit_deadline_margin_usec, drm_commit_deadline_margin,
+		   uint, 0600);
 MODULE_PARM_DESC(timestamp_monotonic, "Use monotonic timestamps");
+MODULE_PARM_DESC(commit_deadline_margin_usec, "Time before the target vblank at which a commit is flushed [usecs]");
 
 static void store_vblank(struct drm_device *dev, unsigned int pipe,
 			 u32 vblank_count_inc,
@@ -903,6 +916,9 @@ void drm_crtc_send_vblank_event(struct drm_crtc *crtc,
 	e->pipe = pipe;
 	e->event.crtc_id = crtc->base.id;
 	send_vblank_event(dev, e, seq, &now);
+
+	if (e->event.base.type == DRM_EVENT_FLIP_COMPLETE)
+		frame_trace_present();
 }
 EXPORT_SYMBOL(drm_crtc_send_vblank_event);
 
@@ -1033,6 +1049,93 @@ void drm_crtc_vblank_put(struct drm_crtc *crtc)
 }
 EXPORT_SYMBOL(drm_crtc_vblank_put);
 
+extern int kp_active_mode(void);
+
+/**
+ * drm_crtc_wait_commit_deadline - hold a commit back until its target vblank
+ * @crtc: CRTC the commit is for
+ * @target: vblank count the commit should take effect at, 0 for none
+ *
+ * Sleeps until the ``commit_deadline_margin_usec`` module parameter ahead of
+ * the @target vblank, so that the commit is flushed to the hardware just in
+ * time for it rather than on an earlier vblank. The margin is capped to half a
+ * frame. When the commit is already past that point the CPU, GPU and DDR are
+ * boosted to get the following frames out faster. Drivers with their own
+ * commit path should call this right before flushing the hardware, helper
+ * based drivers get it from the commit tail.
+ */
+void drm_crtc_wait_commit_deadline(struct drm_crtc *crtc, u32 target)
+{
+	struct drm_device *dev = crtc->dev;
+	struct drm_vblank_crtc *vblank;
+	struct timeval tv;
+	ktime_t now, flush;
+	s64 margin_ns;
+	int frames;
+	u32 count;
+
+	if (!target || !dev->num_crtcs || !drm_timestamp_monotonic)
+		return;
+
+	vblank = &dev->vblank[drm_crtc_index(crtc)];
+	if (drm_crtc_vblank_get(crtc))
+		return;
+
+	count = drm_crtc_vblank_count_and_time(crtc, &tv);
+	frames = (int)(target - count);
+	if (!vblank->framedur_ns || frames > DRM_COMMIT_DEADLINE_MAX_FRAMES) {
+		drm_crtc_vblank_put(crtc);
+		return;
+	}
+
+	vblank->deadline_commits++;
+	margin_ns = min_t(s64, (s64)drm_commit_deadline_margin * NSEC_PER_USEC,
+			  vblank->framedur_ns / 2);
+	flush = ktime_add_ns(timeval_to_ktime(tv),
+			     (s64)frames * vblank->framedur_ns);
+	flush = ktime_sub_ns(flush, margin_ns);
+
+	now = ktime_get();
+	if (ktime_before(now, flush)) {
+		set_current_state(TASK_UNINTERRUPTIBLE);
+		schedule_hrtimeout_range(&flush, DRM_COMMIT_DEADLINE_SLACK_NS,
+					 HRTIMER_MODE_ABS);
+	} else {
+		vblank->deadline_late++;
+		/* Leave the battery saver profile alone */
+		if (kp_active_mode() != 1) {
+			cpu_input_boost_kick_max(DRM_COMMIT_DEADLINE_BOOST_MS);
+			devfreq_boost_kick_max(DEVFREQ_GPU,
+					       DRM_COMMIT_DEADLINE_BOOST_MS);
+			devfreq_boost_kick_max(DEVFREQ_CPU_LLCC_DDR_BW,
+					       DRM_COMMIT_DEADLINE_BOOST_MS);
+		}
+	}
+
+	drm_crtc_vblank_put(crtc);
+}
+EXPORT_SYMBOL(drm_crtc_wait_commit_deadline);
+
+/**
+ * drm_crtc_commit_deadline_done - account a commit with a target vblank
+ * @crtc: CRTC the commit was for
+ * @target: vblank count the commit should have taken effect at, 0 for none
+ *
+ * Called once the commit has taken effect, counts it as missed when that
+ * happened after @target.
+ */
+void drm_crtc_commit_deadline_done(struct drm_crtc *crtc, u32 target)
+{
+	struct drm_device *dev = crtc->dev;
+
+	if (!target || !dev->num_crtcs)
+		return;
+
+	if ((int)(drm_crtc_vblank_count(crtc) - target) > 0)
+		dev->vblank[drm_crtc_index(crtc)].deadline_missed++;
+}
+EXPORT_SYMBOL(drm_crtc_commit_deadline_done);
+
 /**
  * drm_wait_one_vblank - wait for one vblank
  * @dev: DRM device
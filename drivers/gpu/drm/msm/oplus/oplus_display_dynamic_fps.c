@@ -0,0 +1,391 @@
+/***************************************************************
+** Copyright (C),  2026,  OPLUS Mobile Comm Corp.,  Ltd
+** VENDOR_EDIT
+** File : oplus_display_dynamic_fps.c
+** Description : oplus content driven panel refresh rate switching
+** Version : 1.0
+** Date : 2026/10/14
+** Author : MULTIMEDIA.DISPLAY.LCD
+**
+** ------------------------------- Revision History: -----------
+**  <author>        <data>        <version >        <desc>
+**                  2026/10/14        1.0           Build this feature
+******************************************************************/
+/*
+ * The panel runs at its highest refresh rate while the screen is touched
+ * and for idle_ms afterwards so scrolling and flings stay smooth, and drops
+ * to its lowest rate once the UI goes idle. Only panels with dynamic fps
+ * support are switched, so the DSI driver changes the timing seamlessly
+ * instead of through a full modeset. The switch is flushed right before a
+ * vblank so it never costs a frame.
+ */
+
+#include <linux/input.h>
+#include <linux/kthread.h>
+#include <linux/mutex.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
+#include <drm/drm_atomic.h>
+#include <drm/drm_vblank.h>
+#include "msm_drv.h"
+#include "dsi_display.h"
+#include "oplus_display_dynamic_fps.h"
+
+#define OPLUS_DFPS_IDLE_MS 1000
+#define OPLUS_DFPS_MAX_RATES 4
+
+struct oplus_dfps_residency {
+	int fps;
+	u64 time_ns;
+};
+
+static bool oplus_dfps_enable;
+static unsigned int oplus_dfps_idle_ms = OPLUS_DFPS_IDLE_MS;
+static bool oplus_dfps_want_high;
+static DEFINE_MUTEX(oplus_dfps_lock);
+
+static struct task_struct *oplus_dfps_thread;
+static struct kthread_worker oplus_dfps_worker;
+static struct kthread_work oplus_dfps_work;
+static struct delayed_work oplus_dfps_idle_work;
+
+/* Time spent at each refresh rate while the panel was on */
+static struct oplus_dfps_residency oplus_dfps_res[OPLUS_DFPS_MAX_RATES];
+static bool oplus_dfps_res_active;
+static int oplus_dfps_res_fps;
+static ktime_t oplus_dfps_res_start;
+static DEFINE_SPINLOCK(oplus_dfps_res_lock);
+
+static int oplus_dfps_cur_fps(void)
+{
+	struct dsi_display *display = get_main_display();
+
+	if (!display || !display->panel || !display->panel->cur_mode)
+		return 0;
+
+	return display->panel->cur_mode->timing.refresh_rate;
+}
+
+/*
+ * Charge the time since the last update to the rate the panel ran at, called
+ * with oplus_dfps_res_lock held.
+ */
+static void __oplus_dfps_res_update(int fps)
+{
+	ktime_t now = ktime_get();
+	int i;
+
+	if (oplus_dfps_res_active && oplus_dfps_res_fps) {
+		for (i = 0; i < OPLUS_DFPS_MAX_RATES; i++) {
+			if (oplus_dfps_res[i].fps == oplus_dfps_res_fps ||
+			    !oplus_dfps_res[i].fps)
+				break;
+		}
+		if (i < OPLUS_DFPS_MAX_RATES) {
+			oplus_dfps_res[i].fps = oplus_dfps_res_fps;
+			oplus_dfps_res[i].time_ns +=
+				ktime_to_ns(ktime_sub(now, oplus_dfps_res_start));
+		}
+	}
+	oplus_dfps_res_start = now;
+	oplus_dfps_res_fps = fps;
+}
+
+static void oplus_dfps_res_update(void)
+{
+	int fps = oplus_dfps_cur_fps();
+	unsigned long flags;
+
+	spin_lock_irqsave(&oplus_dfps_res_lock, flags);
+	__oplus_dfps_res_update(fps);
+	spin_unlock_irqrestore(&oplus_dfps_res_lock, flags);
+}
+
+ssize_t oplus_dfps_get_residency(char *buf, size_t size)
+{
+	struct oplus_dfps_residency res[OPLUS_DFPS_MAX_RATES];
+	unsigned long flags;
+	ssize_t len = 0;
+	int i;
+
+	oplus_dfps_res_update();
+
+	spin_lock_irqsave(&oplus_dfps_res_lock, flags);
+	memcpy(res, oplus_dfps_res, sizeof(res));
+	spin_unlock_irqrestore(&oplus_dfps_res_lock, flags);
+
+	for (i = 0; i < OPLUS_DFPS_MAX_RATES && res[i].fps; i++)
+		len += scnprintf(buf + len, size - len, "%d: %llu\n",
+				res[i].fps, div_u64(res[i].time_ns, NSEC_PER_MSEC));
+
+	return len;
+}
+
+void oplus_dfps_reset_residency(void)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&oplus_dfps_res_lock, flags);
+	memset(oplus_dfps_res, 0, sizeof(oplus_dfps_res));
+	oplus_dfps_res_start = ktime_get();
+	spin_unlock_irqrestore(&oplus_dfps_res_lock, flags);
+}
+
+void oplus_dfps_power_changed(enum oppo_display_power_status power_status)
+{
+	int fps = oplus_dfps_cur_fps();
+	unsigned long flags;
+
+	spin_lock_irqsave(&oplus_dfps_res_lock, flags);
+	__oplus_dfps_res_update(fps);
+	oplus_dfps_res_active = (power_status == OPPO_DISPLAY_POWER_ON);
+	spin_unlock_irqrestore(&oplus_dfps_res_lock, flags);
+}
+
+/* Pick the fastest or slowest mode with the timing of the current one */
+static struct drm_display_mode *oplus_dfps_find_mode(
+	struct drm_connector *connector, struct drm_display_mode *cur_mode,
+	bool high)
+{
+	struct drm_display_mode *mode, *set_mode = NULL;
+	u32 panel_flags = DRM_MODE_FLAG_CMD_MODE_PANEL |
+		DRM_MODE_FLAG_VID_MODE_PANEL;
+
+	list_for_each_entry(mode, &connector->modes, head) {
+		if (drm_mode_vrefresh(mode) == 0)
+			continue;
+		if (mode->hdisplay != cur_mode->hdisplay ||
+		    mode->vdisplay != cur_mode->vdisplay)
+			continue;
+		if ((mode->flags & panel_flags) != (cur_mode->flags & panel_flags))
+			continue;
+		if (!set_mode ||
+		    (high && drm_mode_vrefresh(mode) > drm_mode_vrefresh(set_mode)) ||
+		    (!high && drm_mode_vrefresh(mode) < drm_mode_vrefresh(set_mode)))
+			set_mode = mode;
+	}
+
+	return set_mode;
+}
+
+static void oplus_dfps_switch_work(struct kthread_work *work)
+{
+	struct dsi_display *display = get_main_display();
+	struct drm_connector *dsi_connector;
+	struct drm_device *drm_dev;
+	struct drm_atomic_state *state;
+	struct drm_crtc_state *crtc_state;
+	struct drm_display_mode *set_mode;
+	struct drm_crtc *crtc;
+	int err = 0;
+
+	mutex_lock(&oplus_dfps_lock);
+
+	if (!oplus_dfps_enable ||
+	    get_oppo_display_power_status() != OPPO_DISPLAY_POWER_ON)
+		goto out;
+
+	if (!display || !display->panel || !display->drm_dev ||
+	    !display->panel->dfps_caps.dfps_support)
+		goto out;
+
+	drm_dev = display->drm_dev;
+	dsi_connector = display->drm_conn;
+	if (!dsi_connector || !dsi_connector->state ||
+	    !dsi_connector->state->crtc)
+		goto out;
+
+	crtc = dsi_connector->state->crtc;
+	set_mode = oplus_dfps_find_mode(dsi_connector, &crtc->state->mode,
+					oplus_dfps_want_high);
+	if (!set_mode ||
+	    drm_mode_vrefresh(set_mode) == drm_mode_vrefresh(&crtc->state->mode))
+		goto out;
+
+	/* Don't hold the modeset locks while waiting for the vblank */
+	drm_crtc_wait_commit_deadline(crtc, drm_crtc_vblank_count(crtc) + 1);
+
+	drm_modeset_lock_all(drm_dev);
+
+	state = drm_atomic_state_alloc(drm_dev);
+	if (!state) {
+		drm_modeset_unlock_all(drm_dev);
+		goto out;
+	}
+
+	state->acquire_ctx = drm_dev->mode_config.acquire_ctx;
+	crtc_state = drm_atomic_get_crtc_state(state, crtc);
+	if (IS_ERR(crtc_state)) {
+		err = PTR_ERR(crtc_state);
+	} else if (crtc_state->active && crtc_state->enable) {
+		err = drm_atomic_set_mode_for_crtc(crtc_state, set_mode);
+		if (!err)
+			err = drm_atomic_commit(state);
+	}
+	drm_atomic_state_put(state);
+
+	drm_modeset_unlock_all(drm_dev);
+
+	if (err)
+		pr_err("%s: failed to switch to %dfps, err=%d\n", __func__,
+			drm_mode_vrefresh(set_mode), err);
+
+	oplus_dfps_res_update();
+out:
+	mutex_unlock(&oplus_dfps_lock);
+}
+
+static void oplus_dfps_request(bool high)
+{
+	if (READ_ONCE(oplus_dfps_want_high) == high)
+		return;
+
+	WRITE_ONCE(oplus_dfps_want_high, high);
+	kthread_queue_work(&oplus_dfps_worker, &oplus_dfps_work);
+}
+
+static void oplus_dfps_idle_fn(struct work_struct *work)
+{
+	oplus_dfps_request(false);
+}
+
+static void oplus_dfps_input_event(struct input_handle *handle,
+	unsigned int type, unsigned int code, int value)
+{
+	if (!READ_ONCE(oplus_dfps_enable))
+		return;
+
+	if (type != EV_SYN || code != SYN_REPORT)
+		return;
+
+	oplus_dfps_request(true);
+	mod_delayed_work(system_power_efficient_wq, &oplus_dfps_idle_work,
+		msecs_to_jiffies(READ_ONCE(oplus_dfps_idle_ms)));
+}
+
+static int oplus_dfps_input_connect(struct input_handler *handler,
+	struct input_dev *dev, const struct input_device_id *id)
+{
+	struct input_handle *handle;
+	int ret;
+
+	handle = kzalloc(sizeof(*handle), GFP_KERNEL);
+	if (!handle)
+		return -ENOMEM;
+
+	handle->dev = dev;
+	handle->handler = handler;
+	handle->name = "oplus_dfps_handle";
+
+	ret = input_register_handle(handle);
+	if (ret)
+		goto free_handle;
+
+	ret = input_open_device(handle);
+	if (ret)
+		goto unregister_handle;
+
+	return 0;
+
+unregister_handle:
+	input_unregister_handle(handle);
+free_handle:
+	kfree(handle);
+	return ret;
+}
+
+static void oplus_dfps_input_disconnect(struct input_handle *handle)
+{
+	input_close_device(handle);
+	input_unregister_handle(handle);
+	kfree(handle);
+}
+
+static const struct input_device_id oplus_dfps_ids[] = {
+	/* Multi-touch touchscreen */
+	{
+		.flags = INPUT_DEVICE_ID_MATCH_EVBIT |
+			INPUT_DEVICE_ID_MATCH_ABSBIT,
+		.evbit = { BIT_MASK(EV_ABS) },
+		.absbit = { [BIT_WORD(ABS_MT_POSITION_X)] =
+			BIT_MASK(ABS_MT_POSITION_X) |
+			BIT_MASK(ABS_MT_POSITION_Y) }
+	},
+	{ }
+};
+
+static struct input_handler oplus_dfps_input_handler = {
+	.event		= oplus_dfps_input_event,
+	.connect	= oplus_dfps_input_connect,
+	.disconnect	= oplus_dfps_input_disconnect,
+	.name		= "oplus_dfps_handler",
+	.id_table	= oplus_dfps_ids
+};
+
+void oplus_dfps_set_enable(bool enable)
+{
+	mutex_lock(&oplus_dfps_lock);
+	WRITE_ONCE(oplus_dfps_enable, enable);
+	mutex_unlock(&oplus_dfps_lock);
+
+	if (!enable)
+		cancel_delayed_work_sync(&oplus_dfps_idle_work);
+}
+
+bool oplus_dfps_get_enable(void)
+{
+	return oplus_dfps_enable;
+}
+
+void oplus_dfps_set_idle_ms(unsigned int idle_ms)
+{
+	WRITE_ONCE(oplus_dfps_idle_ms, idle_ms);
+}
+
+unsigned int oplus_dfps_get_idle_ms(void)
+{
+	return oplus_dfps_idle_ms;
+}
+
+int oplus_dfps_init(void)
+{
+	int ret;
+
+	INIT_DELAYED_WORK(&oplus_dfps_idle_work, oplus_dfps_idle_fn);
+	kthread_init_worker(&oplus_dfps_worker);
+	kthread_init_work(&oplus_dfps_work, &oplus_dfps_switch_work);
+	oplus_dfps_thread = kthread_run(kthread_worker_fn,
+			&oplus_dfps_worker, "oplus_dfps");
+
+	if (IS_ERR(oplus_dfps_thread)) {
+		pr_err("fail to start oplus_dfps_thread\n");
+		oplus_dfps_thread = NULL;
+		return -1;
+	}
+
+	oplus_dfps_power_changed(get_oppo_display_power_status());
+
+	ret = input_register_handler(&oplus_dfps_input_handler);
+	if (ret) {
+		pr_err("fail to register oplus_dfps input handler, ret=%d\n",
+			ret);
+		kthread_stop(oplus_dfps_thread);
+		oplus_dfps_thread = NULL;
+		return ret;
+	}
+
+	return 0;
+}
+
+void oplus_dfps_exit(void)
+{
+	if (!oplus_dfps_thread)
+		return;
+
+	input_unregister_handler(&oplus_dfps_input_handler);
+	cancel_delayed_work_sync(&oplus_dfps_idle_work);
+	kthread_flush_worker(&oplus_dfps_worker);
+	kthread_stop(oplus_dfps_thread);
+	oplus_dfps_thread = NULL;
+}
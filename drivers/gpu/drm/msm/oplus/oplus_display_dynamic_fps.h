@@ -0,0 +1,30 @@
+/***************************************************************
+** Copyright (C),  2026,  OPLUS Mobile Comm Corp.,  Ltd
+** VENDOR_EDIT
+** File : oplus_display_dynamic_fps.h
+** Description : oplus content driven panel refresh rate switching
+** Version : 1.0
+** Date : 2026/10/14
+** Author : MULTIMEDIA.DISPLAY.LCD
+**
+** ------------------------------- Revision History: -----------
+**  <author>        <data>        <version >        <desc>
+**                  2026/10/14        1.0           Build this feature
+******************************************************************/
+#ifndef _OPLUS_DISPLAY_DYNAMIC_FPS_H_
+#define _OPLUS_DISPLAY_DYNAMIC_FPS_H_
+
+#include <linux/types.h>
+#include "oppo_dsi_support.h"
+
+void oplus_dfps_set_enable(bool enable);
+bool oplus_dfps_get_enable(void);
+void oplus_dfps_set_idle_ms(unsigned int idle_ms);
+unsigned int oplus_dfps_get_idle_ms(void);
+ssize_t oplus_dfps_get_residency(char *buf, size_t size);
+void oplus_dfps_reset_residency(void);
+void oplus_dfps_power_changed(enum oppo_display_power_status power_status);
+int oplus_dfps_init(void);
+void oplus_dfps_exit(void);
+
+#endif /* _OPLUS_DISPLAY_DYNAMIC_FPS_H_ */
@@ -24,6 +24,9 @@ int oppo_datadimming_v3_skip_frame = 2;
 int oppo_panel_alpha = 0;
 int oppo_underbrightness_alpha = 0;
 static struct dsi_panel_cmd_set oppo_priv_seed_cmd_set;
+/* Source commands and alpha oppo_priv_seed_cmd_set was built from */
+static struct dsi_cmd_desc *oppo_priv_seed_cmd_src;
+static int oppo_priv_seed_alpha;
 
 extern int oppo_dimlayer_bl_on_vblank;
 extern int oppo_dimlayer_bl_off_vblank;
@@ -314,6 +317,8 @@ int sde_connector_update_hbm(struct drm_connector *connector)
 		return 0;
 	}
 
+	oppo_display_flush_hbm(dsi_display);
+
 	fingerprint_mode = sde_crtc_get_fingerprint_mode(c_conn->encoder->crtc->state);
 
 	if (OPPO_DISPLAY_AOD_SCENE == get_oppo_display_scene()) {
@@ -600,6 +605,16 @@ oppo_dsi_update_seed_backlight(struct dsi_panel *panel, int brightness,
 	count = panel->cur_mode->priv_info->cmd_sets[type].count;
 	state = panel->cur_mode->priv_info->cmd_sets[type].state;
 
+	/*
+	 * Brightness ramps map runs of levels onto the same alpha, don't
+	 * rebuild the set for every step.
+	 */
+	if (oppo_priv_seed_cmd_set.cmds && oppo_priv_seed_cmd_src == cmds &&
+	    oppo_priv_seed_alpha == alpha) {
+		oppo_dc2_alpha = alpha;
+		return &oppo_priv_seed_cmd_set;
+	}
+
 	oppo_cmd = kmemdup(cmds, sizeof(*cmds) * count, GFP_KERNEL);
 	if (!oppo_cmd) {
 		rc = -ENOMEM;
@@ -642,6 +657,8 @@ oppo_dsi_update_seed_backlight(struct dsi_panel *panel, int brightness,
 	oppo_priv_seed_cmd_set.cmds = oppo_cmd;
 	oppo_priv_seed_cmd_set.count = count;
 	oppo_priv_seed_cmd_set.state = state;
+	oppo_priv_seed_cmd_src = cmds;
+	oppo_priv_seed_alpha = alpha;
 	oppo_dc2_alpha = alpha;
 
 	return &oppo_priv_seed_cmd_set;
@@ -11,11 +11,17 @@
 **  <author>		<data>		<version >		<desc>
 **  Li.Sheng	   2020/07/06		1.0		   Build this feature
 ******************************************************************/
+#include <linux/workqueue.h>
 #include "oppo_display_panel_hbm.h"
 #include "oppo_dsi_support.h"
 
 int hbm_mode = 0;
 DEFINE_MUTEX(oppo_hbm_lock);
+/* hbm mode not sent to the panel yet, -1 if none. Under oppo_hbm_lock */
+static int oppo_hbm_pending = -1;
+
+static void oppo_display_hbm_work(struct work_struct *work);
+static DECLARE_DELAYED_WORK(oppo_hbm_dwork, oppo_display_hbm_work);
 
 int dsi_panel_hbm_on(struct dsi_panel *panel)
 {
@@ -202,6 +208,101 @@ int oppo_display_get_hbm_mode(void)
 	return hbm_mode;
 }
 
+static int oppo_display_send_hbm(struct dsi_display *display, int mode)
+{
+	int ret = 0;
+
+	if ((mode > 1) && (mode <= 10)) {
+		ret = dsi_display_normal_hbm_on(display);
+	} else if (mode == 1) {
+		ret = dsi_display_hbm_on(display);
+	} else if (mode == 0) {
+		ret = dsi_display_hbm_off(display);
+	}
+
+	return ret;
+}
+
+/*
+ * Fallback for when no frame is committed within a frame time of the hbm
+ * mode changing, e.g. on a static screen.
+ */
+static void oppo_display_hbm_work(struct work_struct *work)
+{
+	struct dsi_display *display = get_main_display();
+	int ret;
+
+	mutex_lock(&oppo_hbm_lock);
+	if (oppo_hbm_pending < 0 || !display)
+		goto out;
+
+	if (get_oppo_display_power_status() == OPPO_DISPLAY_POWER_ON) {
+		ret = oppo_display_send_hbm(display, oppo_hbm_pending);
+		if (ret)
+			pr_err("failed to set hbm status ret=%d", ret);
+	}
+	oppo_hbm_pending = -1;
+out:
+	mutex_unlock(&oppo_hbm_lock);
+}
+
+/* Sends the pending hbm mode with the frame being committed */
+void oppo_display_flush_hbm(struct dsi_display *display)
+{
+	struct dsi_panel *panel = display->panel;
+	int mode, rc = 0;
+
+	if (READ_ONCE(oppo_hbm_pending) < 0)
+		return;
+
+	dsi_display_clk_ctrl(display->dsi_clk_handle,
+			DSI_CORE_CLK, DSI_CLK_ON);
+
+	mutex_lock(&oppo_hbm_lock);
+	mode = oppo_hbm_pending;
+	oppo_hbm_pending = -1;
+
+	if ((mode > 1) && (mode <= 10)) {
+		rc = dsi_panel_normal_hbm_on(panel);
+	} else if (mode == 1) {
+		rc = dsi_panel_hbm_on(panel);
+	} else if (mode == 0) {
+		rc = dsi_panel_hbm_off(panel);
+	}
+	mutex_unlock(&oppo_hbm_lock);
+
+	dsi_display_clk_ctrl(display->dsi_clk_handle,
+			DSI_CORE_CLK, DSI_CLK_OFF);
+
+	if (rc)
+		pr_err("failed to set hbm status ret=%d", rc);
+}
+
+/*
+ * Brightness ramps can switch the hbm mode faster than the panel refreshes,
+ * so the mode is only recorded here and sent once with the next frame. Only
+ * the last mode set before that frame reaches the panel.
+ */
+int oppo_display_queue_hbm(int mode)
+{
+	struct dsi_display *display = get_main_display();
+	unsigned long delay = 1;
+
+	if (display && display->panel && display->panel->cur_mode &&
+	    display->panel->cur_mode->timing.refresh_rate)
+		delay = msecs_to_jiffies(DIV_ROUND_UP(1000,
+			display->panel->cur_mode->timing.refresh_rate));
+
+	mutex_lock(&oppo_hbm_lock);
+	hbm_mode = mode;
+	oppo_hbm_pending = mode;
+	mutex_unlock(&oppo_hbm_lock);
+
+	queue_delayed_work(system_highpri_wq, &oppo_hbm_dwork, delay);
+
+	return 0;
+}
+
 int __oppo_display_set_hbm(int mode)
 {
 	mutex_lock(&oppo_hbm_lock);
@@ -229,16 +330,7 @@ int oppo_display_panel_set_hbm(void *buf)
 		printk(KERN_INFO "oppo_display_set_hbm and main display is null");
 		return -EINVAL;
 	}
-	__oppo_display_set_hbm((*temp_save));
-
-	if ((hbm_mode > 1) &&(hbm_mode <= 10)) {
-		ret = dsi_display_normal_hbm_on(get_main_display());
-	} else if (hbm_mode == 1) {
-		ret = dsi_display_hbm_on(get_main_display());
-	} else if (hbm_mode == 0) {
-		ret = dsi_display_hbm_off(get_main_display());
-	}
-
+	ret = oppo_display_queue_hbm((*temp_save));
 	if (ret) {
 		pr_err("failed to set hbm status ret=%d", ret);
 		return ret;
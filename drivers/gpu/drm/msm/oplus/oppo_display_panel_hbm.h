@@ -32,6 +32,8 @@ int dsi_display_hbm_on(struct dsi_display *display);
 int dsi_panel_normal_hbm_on(struct dsi_panel *panel);
 int dsi_panel_hbm_off(struct dsi_panel *panel);
 int dsi_panel_hbm_on(struct dsi_panel *panel);
+int oppo_display_queue_hbm(int mode);
+void oppo_display_flush_hbm(struct dsi_display *display);
 int oppo_display_panel_set_hbm(void *buf);
 int oppo_display_panel_get_hbm(void *buf);
 #endif /*_OPPO_DISPLAY_PANEL_HBM_H_*/
@@ -15,6 +15,7 @@
 #include "oppo_onscreenfingerprint.h"
 #include "oppo_aod.h"
 #include "oppo_ffl.h"
+#include "oplus_display_dynamic_fps.h"
 #include "oppo_display_panel_power.h"
 #include "oppo_display_panel_seed.h"
 #include "oppo_display_panel_hbm.h"
@@ -529,18 +530,7 @@ static ssize_t oppo_display_set_hbm(struct device *dev,
 		return -EINVAL;
 	}
 
-	__oppo_display_set_hbm(temp_save);
-
-	if ((hbm_mode > 1) && (hbm_mode <= 10)) {
-		ret = dsi_display_normal_hbm_on(get_main_display());
-
-	} else if (hbm_mode == 1) {
-		ret = dsi_display_hbm_on(get_main_display());
-
-	} else if (hbm_mode == 0) {
-		ret = dsi_display_hbm_off(get_main_display());
-	}
-
+	ret = oppo_display_queue_hbm(temp_save);
 	if (ret) {
 		pr_err("failed to set hbm status ret=%d", ret);
 		return ret;
@@ -2129,6 +2119,59 @@ static ssize_t oppo_set_ffl_setting(struct device *dev,
 	return count;
 }
 
+static ssize_t oplus_display_get_dynamic_fps(struct device *dev,
+	struct device_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%d\n", oplus_dfps_get_enable());
+}
+
+static ssize_t oplus_display_set_dynamic_fps(struct device *dev,
+	struct device_attribute *attr,
+	const char *buf, size_t count)
+{
+	int enable = 0;
+
+	sscanf(buf, "%du", &enable);
+	oplus_dfps_set_enable(!!enable);
+
+	return count;
+}
+
+static ssize_t oplus_display_get_dynamic_fps_idle_ms(struct device *dev,
+	struct device_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", oplus_dfps_get_idle_ms());
+}
+
+static ssize_t oplus_display_set_dynamic_fps_idle_ms(struct device *dev,
+	struct device_attribute *attr,
+	const char *buf, size_t count)
+{
+	unsigned int idle_ms = 0;
+
+	if (kstrtouint(buf, 0, &idle_ms))
+		return -EINVAL;
+
+	oplus_dfps_set_idle_ms(idle_ms);
+
+	return count;
+}
+
+static ssize_t oplus_display_get_fps_residency(struct device *dev,
+	struct device_attribute *attr, char *buf)
+{
+	return oplus_dfps_get_residency(buf, PAGE_SIZE);
+}
+
+static ssize_t oplus_display_reset_fps_residency(struct device *dev,
+	struct device_attribute *attr,
+	const char *buf, size_t count)
+{
+	oplus_dfps_reset_residency();
+
+	return count;
+}
+
 int oppo_onscreenfp_status = 0;
 ktime_t oppo_onscreenfp_pressed_time;
 u32 oppo_onscreenfp_vblank_count = 0;
@@ -3377,6 +3420,13 @@ static DEVICE_ATTR(notify_panel_blank, S_IRUGO | S_IWUSR, NULL,
 	oppo_display_notify_panel_blank);
 static DEVICE_ATTR(ffl_set, S_IRUGO | S_IWUSR, oppo_get_ffl_setting,
 	oppo_set_ffl_setting);
+static DEVICE_ATTR(dynamic_fps, S_IRUGO | S_IWUSR,
+	oplus_display_get_dynamic_fps, oplus_display_set_dynamic_fps);
+static DEVICE_ATTR(dynamic_fps_idle_ms, S_IRUGO | S_IWUSR,
+	oplus_display_get_dynamic_fps_idle_ms,
+	oplus_display_set_dynamic_fps_idle_ms);
+static DEVICE_ATTR(fps_residency, S_IRUGO | S_IWUSR,
+	oplus_display_get_fps_residency, oplus_display_reset_fps_residency);
 static DEVICE_ATTR(notify_fppress, S_IRUGO | S_IWUSR, NULL,
 	oppo_display_notify_fp_press);
 static DEVICE_ATTR(aod_light_mode_set, S_IRUGO | S_IWUSR,
@@ -3433,6 +3483,9 @@ static struct attribute *oppo_display_attrs[] = {
 	&dev_attr_esd_status.attr,
 	&dev_attr_notify_panel_blank.attr,
 	&dev_attr_ffl_set.attr,
+	&dev_attr_dynamic_fps.attr,
+	&dev_attr_dynamic_fps_idle_ms.attr,
+	&dev_attr_fps_residency.attr,
 	&dev_attr_notify_fppress.attr,
 	&dev_attr_aod_light_mode_set.attr,
 	&dev_attr_aod.attr,
@@ -3510,6 +3563,10 @@ static int __init oppo_display_private_api_init(void)
 		pr_err("fail to init oppo_ffl_thread\n");
 	}
 
+	if (oplus_dfps_init()) {
+		pr_err("fail to init oplus dynamic fps\n");
+	}
+
 
 
 	return 0;
@@ -3526,6 +3583,7 @@ static int __init oppo_display_private_api_init(void)
 
 static void __exit oppo_display_private_api_exit(void)
 {
+	oplus_dfps_exit();
 	oppo_ffl_thread_exit();
 
 	sysfs_remove_link(oppo_display_kobj, "panel");
@@ -12,6 +12,7 @@
 **   Hu.Jie          2018/03/17        1.0           Build this moudle
 ******************************************************************/
 #include "oppo_dsi_support.h"
+#include "oplus_display_dynamic_fps.h"
 #include <soc/oppo/boot_mode.h>
 #include <soc/oplus/system/oppo_project.h>
 #include <soc/oppo/device_info.h>
@@ -193,6 +194,7 @@ void notifier_oppo_display_status(enum oppo_display_power_status power_status)
 
 void set_oppo_display_power_status(enum oppo_display_power_status power_status)
 {
+	oplus_dfps_power_changed(power_status);
 	oppo_display_status = power_status;
 }
 
@@ -295,10 +295,18 @@ enum adreno_preempt_states {
  * @work: A work struct for the preemption worker (for 5XX)
  * @token_submit: Indicates if a preempt token has been submitted in
  * current ringbuffer (for 4XX)
- * preempt_level: The level of preemption (for 6XX)
+ * preempt_level: The level of preemption (for 6XX): 0 switches only at
+ * ringbuffer boundaries, 1 also at draw boundaries and 2 also at bin
+ * boundaries
  * skipsaverestore: To skip saverestore during L1 preemption (for 6XX)
  * usesgmem: enable GMEM save/restore across preemption (for 6XX)
  * count: Track the number of preemptions triggered
+ * trigger_time: Time at which the pending preemption was triggered
+ * latency_last: Trigger to complete latency of the last preemption in usecs
+ * latency_max: Worst trigger to complete latency seen in usecs
+ * latency_total: Sum of all trigger to complete latencies in usecs
+ * rb_prio: Lowest context priority value (i.e. highest priority) placed
+ * on each ringbuffer, or all zero to split the priorities evenly
  */
 struct adreno_preemption {
 	atomic_t state;
@@ -310,6 +318,11 @@ struct adreno_preemption {
 	bool skipsaverestore;
 	bool usesgmem;
 	unsigned int count;
+	ktime_t trigger_time;
+	unsigned int latency_last;
+	unsigned int latency_max;
+	u64 latency_total;
+	unsigned int rb_prio[KGSL_PRIORITY_MAX_RB_LEVELS];
 };
 
 
@@ -1758,6 +1771,7 @@ static inline struct adreno_ringbuffer *adreno_ctx_get_rb(
 				struct adreno_context *drawctxt)
 {
 	struct kgsl_context *context;
+	unsigned int *rb_prio = adreno_dev->preempt.rb_prio;
 	int level;
 
 	if (!drawctxt)
@@ -1773,6 +1787,20 @@ static inline struct adreno_ringbuffer *adreno_ctx_get_rb(
 	if (!adreno_is_preemption_enabled(adreno_dev))
 		return &(adreno_dev->ringbuffers[0]);
 
+	/*
+	 * If userspace assigned priority ranges to the ringbuffers pick the
+	 * lowest priority ringbuffer whose range starts at or before the
+	 * context priority.
+	 */
+	if (rb_prio[adreno_dev->num_ringbuffers - 1]) {
+		for (level = adreno_dev->num_ringbuffers - 1; level > 0;
+			level--)
+			if (context->priority >= rb_prio[level])
+				break;
+
+		return &(adreno_dev->ringbuffers[level]);
+	}
+
 	/*
 	 * Math to convert the priority field in context structure to an RB ID.
 	 * Divide up the context priority based on number of ringbuffer levels.
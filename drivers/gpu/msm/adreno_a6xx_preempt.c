@@ -105,6 +105,20 @@ static inline bool adreno_move_preempt_state(struct adreno_device *adreno_dev,
 	return (atomic_cmpxchg(&adreno_dev->preempt.state, old, new) == old);
 }
 
+static void _a6xx_preemption_latency(struct adreno_device *adreno_dev)
+{
+	struct adreno_preemption *preempt = &adreno_dev->preempt;
+	unsigned int usecs;
+
+	usecs = (unsigned int) ktime_us_delta(ktime_get(),
+		preempt->trigger_time);
+
+	preempt->latency_last = usecs;
+	preempt->latency_max = max(preempt->latency_max, usecs);
+	preempt->latency_total += usecs;
+	preempt->count++;
+}
+
 static void _a6xx_preemption_done(struct adreno_device *adreno_dev)
 {
 	struct kgsl_device *device = KGSL_DEVICE(adreno_dev);
@@ -136,7 +150,7 @@ static void _a6xx_preemption_done(struct adreno_device *adreno_dev)
 		return;
 	}
 
-	adreno_dev->preempt.count++;
+	_a6xx_preemption_latency(adreno_dev);
 
 	del_timer_sync(&adreno_dev->preempt.timer);
 
@@ -403,6 +417,7 @@ void a6xx_preemption_trigger(struct adreno_device *adreno_dev)
 		jiffies + msecs_to_jiffies(ADRENO_PREEMPT_TIMEOUT));
 
 	adreno_set_preempt_state(adreno_dev, ADRENO_PREEMPT_TRIGGERED);
+	adreno_dev->preempt.trigger_time = ktime_get();
 	trace_adreno_preempt_trigger(adreno_dev->cur_rb, adreno_dev->next_rb,
 		cntl);
 
@@ -452,7 +467,7 @@ void a6xx_preemption_callback(struct adreno_device *adreno_dev, int bit)
 		return;
 	}
 
-	adreno_dev->preempt.count++;
+	_a6xx_preemption_latency(adreno_dev);
 
 	/*
 	 * We can now safely clear the preemption keepalive bit, allowing
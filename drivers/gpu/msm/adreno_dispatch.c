@@ -16,6 +16,7 @@
 #include <linux/sched.h>
 #include <linux/jiffies.h>
 #include <linux/err.h>
+#include <linux/frame_trace.h>
 
 #include "kgsl.h"
 #include "kgsl_sharedmem.h"
@@ -446,49 +447,69 @@ static struct kgsl_drawobj *_process_drawqueue_get_next_drawobj(
 	return NULL;
 }
 
+/* Drop the queued accounting of drawobjs taken off the context queue */
+static void _release_drawobjs(struct adreno_context *drawctxt, int count)
+{
+	spin_lock(&drawctxt->lock);
+	drawctxt->queued -= count;
+	spin_unlock(&drawctxt->lock);
+}
+
 /**
- * adreno_dispatcher_requeue_cmdobj() - Put a command back on the context
+ * adreno_dispatcher_requeue_cmdobjs() - Put commands back on the context
  * queue
  * @drawctxt: Pointer to the adreno draw context
- * @cmdobj: Pointer to the KGSL command object to requeue
+ * @cmdobjs: Command objs to requeue, in queue order
+ * @count: Number of entries in @cmdobjs
+ * @taken: Number of drawobjs taken off the queue still counted in queued
  *
  * Failure to submit a command to the ringbuffer isn't the fault of the command
  * being submitted so if a failure happens, push it back on the head of the the
  * context queue to be reconsidered again unless the context got detached.
  */
-static inline int adreno_dispatcher_requeue_cmdobj(
+static int adreno_dispatcher_requeue_cmdobjs(
 		struct adreno_context *drawctxt,
-		struct kgsl_drawobj_cmd *cmdobj)
+		struct kgsl_drawobj_cmd **cmdobjs, int count, int taken)
 {
 	unsigned int prev;
-	struct kgsl_drawobj *drawobj = DRAWOBJ(cmdobj);
+	int i;
 
 	spin_lock(&drawctxt->lock);
 
+	drawctxt->queued -= taken;
+
 	if (kgsl_context_detached(&drawctxt->base) ||
 		kgsl_context_invalid(&drawctxt->base)) {
 		spin_unlock(&drawctxt->lock);
-		/* get rid of this drawobj since the context is bad */
-		kgsl_drawobj_destroy(drawobj);
+		/* get rid of these drawobjs since the context is bad */
+		for (i = 0; i < count; i++)
+			kgsl_drawobj_destroy(DRAWOBJ(cmdobjs[i]));
 		return -ENOENT;
 	}
 
-	prev = drawctxt->drawqueue_head == 0 ?
-		(ADRENO_CONTEXT_DRAWQUEUE_SIZE - 1) :
-		(drawctxt->drawqueue_head - 1);
+	for (i = count - 1; i >= 0; i--) {
+		prev = drawctxt->drawqueue_head == 0 ?
+			(ADRENO_CONTEXT_DRAWQUEUE_SIZE - 1) :
+			(drawctxt->drawqueue_head - 1);
 
-	/*
-	 * The maximum queue size always needs to be one less then the size of
-	 * the ringbuffer queue so there is "room" to put the drawobj back in
-	 */
+		/*
+		 * The slots these came from were kept accounted in queued
+		 * while they were out so they can't have been reused, and
+		 * the maximum queue size is one less than the size of the
+		 * ringbuffer queue
+		 */
 
-	WARN_ON(prev == drawctxt->drawqueue_tail);
+		WARN_ON(prev == drawctxt->drawqueue_tail);
 
-	drawctxt->drawqueue[prev] = drawobj;
-	drawctxt->queued++;
+		drawctxt->drawqueue[prev] = DRAWOBJ(cmdobjs[i]);
+		drawctxt->queued++;
 
-	/* Reset the command queue head to reflect the newly requeued change */
-	drawctxt->drawqueue_head = prev;
+		/*
+		 * Reset the command queue head to reflect the newly requeued
+		 * change
+		 */
+		drawctxt->drawqueue_head = prev;
+	}
 	spin_unlock(&drawctxt->lock);
 	return 0;
 }
@@ -522,30 +543,38 @@ static void  dispatcher_queue_context(struct adreno_device *adreno_dev,
 	spin_unlock(&dispatcher->plist_lock);
 }
 
-/**
- * sendcmd() - Send a drawobj to the GPU hardware
- * @dispatcher: Pointer to the adreno dispatcher struct
- * @drawobj: Pointer to the KGSL drawobj being sent
- *
- * Send a KGSL drawobj to the GPU hardware
+static void _track_submit_latency(struct adreno_dispatcher *dispatcher,
+		struct kgsl_drawobj_cmd *cmdobj)
+{
+	s64 usecs;
+
+	/* Only count the first submission, not replays after a fault */
+	if (!cmdobj->queue_time)
+		return;
+
+	cmdobj->submit_time = ktime_get();
+	usecs = ktime_us_delta(cmdobj->submit_time, cmdobj->queue_time);
+	cmdobj->queue_time = 0;
+
+	atomic_inc(&dispatcher->submit_latency[min_t(int,
+		usecs > 0 ? fls64(usecs) : 0,
+		ADRENO_DISPATCH_LATENCY_BUCKETS - 1)]);
+}
+
+/*
+ * Write a single cmdobj to the ringbuffer. Called with the device mutex held,
+ * returns 0 on success
  */
-static int sendcmd(struct adreno_device *adreno_dev,
+static int _sendcmd_locked(struct adreno_device *adreno_dev,
 	struct kgsl_drawobj_cmd *cmdobj)
 {
 	struct kgsl_device *device = KGSL_DEVICE(adreno_dev);
 	struct kgsl_drawobj *drawobj = DRAWOBJ(cmdobj);
-	struct adreno_gpudev *gpudev = ADRENO_GPU_DEVICE(adreno_dev);
 	struct adreno_dispatcher *dispatcher = &adreno_dev->dispatcher;
 	struct adreno_dispatcher_drawqueue *dispatch_q =
 				ADRENO_DRAWOBJ_DISPATCH_DRAWQUEUE(drawobj);
 	int ret;
 
-	mutex_lock(&device->mutex);
-	if (adreno_gpu_halt(adreno_dev) != 0) {
-		mutex_unlock(&device->mutex);
-		return -EBUSY;
-	}
-
 	dispatcher->inflight++;
 	dispatch_q->inflight++;
 
@@ -556,7 +585,6 @@ static int sendcmd(struct adreno_device *adreno_dev,
 		if (ret) {
 			dispatcher->inflight--;
 			dispatch_q->inflight--;
-			mutex_unlock(&device->mutex);
 			return ret;
 		}
 
@@ -613,8 +641,6 @@ static int sendcmd(struct adreno_device *adreno_dev,
 		dispatcher->inflight--;
 		dispatch_q->inflight--;
 
-		mutex_unlock(&device->mutex);
-
 		/*
 		 * Don't log a message in case of:
 		 * -ENOENT means that the context was detached before the
@@ -642,17 +668,59 @@ static int sendcmd(struct adreno_device *adreno_dev,
 		dispatch_q->expires = jiffies +
 			msecs_to_jiffies(adreno_drawobj_timeout);
 
-	mutex_unlock(&device->mutex);
-
 	dispatch_q->cmd_q[dispatch_q->tail] = cmdobj;
 	dispatch_q->tail = (dispatch_q->tail + 1) %
 		ADRENO_DISPATCH_DRAWQUEUE_SIZE;
 
+	_track_submit_latency(dispatcher, cmdobj);
+	return 0;
+}
+
+/**
+ * sendcmds() - Send a batch of drawobjs to the GPU hardware
+ * @adreno_dev: Pointer to the adreno device struct
+ * @cmdobjs: Command objs to send, all for the same ringbuffer
+ * @count: Number of entries in @cmdobjs
+ * @err: Set to the error that stopped the batch, if any
+ *
+ * Send the command objs in order under a single hold of the device mutex and
+ * readjust the timers and preemption once for the whole batch. Returns the
+ * number of command objs that were sent; the rest still belong to the caller.
+ */
+static int sendcmds(struct adreno_device *adreno_dev,
+	struct kgsl_drawobj_cmd **cmdobjs, int count, int *err)
+{
+	struct kgsl_device *device = KGSL_DEVICE(adreno_dev);
+	struct adreno_gpudev *gpudev = ADRENO_GPU_DEVICE(adreno_dev);
+	struct adreno_dispatcher *dispatcher = &adreno_dev->dispatcher;
+	struct adreno_dispatcher_drawqueue *dispatch_q;
+	int i, ret = 0;
+
+	mutex_lock(&device->mutex);
+	if (adreno_gpu_halt(adreno_dev) != 0) {
+		mutex_unlock(&device->mutex);
+		*err = -EBUSY;
+		return 0;
+	}
+
+	for (i = 0; i < count; i++) {
+		ret = _sendcmd_locked(adreno_dev, cmdobjs[i]);
+		if (ret)
+			break;
+	}
+
+	mutex_unlock(&device->mutex);
+
+	*err = ret;
+	if (!i)
+		return 0;
+
 	/*
 	 * If we believe ourselves to be current and preemption isn't a thing,
 	 * then set up the timer.  If this misses, then preemption is indeed a
 	 * thing and the timer will be set up in due time
 	 */
+	dispatch_q = ADRENO_DRAWOBJ_DISPATCH_DRAWQUEUE(DRAWOBJ(cmdobjs[0]));
 	if (adreno_in_preempt_state(adreno_dev, ADRENO_PREEMPT_NONE)) {
 		if (drawqueue_is_current(dispatch_q))
 			mod_timer(&dispatcher->timer, dispatch_q->expires);
@@ -665,9 +733,24 @@ static int sendcmd(struct adreno_device *adreno_dev,
 	 */
 	if (gpudev->preemption_schedule)
 		gpudev->preemption_schedule(adreno_dev);
-	return 0;
+	return i;
 }
 
+/**
+ * sendcmd() - Send a drawobj to the GPU hardware
+ * @dispatcher: Pointer to the adreno dispatcher struct
+ * @drawobj: Pointer to the KGSL drawobj being sent
+ *
+ * Send a KGSL drawobj to the GPU hardware
+ */
+static int sendcmd(struct adreno_device *adreno_dev,
+	struct kgsl_drawobj_cmd *cmdobj)
+{
+	int ret;
+
+	sendcmds(adreno_dev, &cmdobj, 1, &ret);
+	return ret;
+}
 
 /*
  * Retires all sync objs from the sparse context
@@ -755,7 +838,6 @@ static int dispatcher_context_sendcmds(struct adreno_device *adreno_dev,
 	int count = 0;
 	int ret = 0;
 	int inflight = _drawqueue_inflight(dispatch_q);
-	unsigned int timestamp;
 
 	if (drawctxt->base.flags & KGSL_CONTEXT_SPARSE)
 		return _process_drawqueue_sparse(drawctxt);
@@ -768,65 +850,90 @@ static int dispatcher_context_sendcmds(struct adreno_device *adreno_dev,
 	}
 
 	/*
-	 * Each context can send a specific number of drawobjs per cycle
+	 * Each context can send a specific number of drawobjs per cycle.
+	 * Pull them off the context queue in batches so that the context lock
+	 * and the device mutex are taken once per batch instead of once per
+	 * drawobj.
 	 */
 	while ((count < _context_drawobj_burst) &&
 		(dispatch_q->inflight < inflight)) {
-		struct kgsl_drawobj *drawobj;
-		struct kgsl_drawobj_cmd *cmdobj;
+		struct kgsl_drawobj_cmd *batch[ADRENO_DISPATCH_BATCH_SIZE];
+		unsigned int timestamps[ADRENO_DISPATCH_BATCH_SIZE];
+		int nr, sent, room;
 
 		if (adreno_gpu_fault(adreno_dev) != 0)
 			break;
 
+		room = min_t(int, ADRENO_DISPATCH_BATCH_SIZE,
+			min_t(int, _context_drawobj_burst - count,
+				inflight - dispatch_q->inflight));
+
 		spin_lock(&drawctxt->lock);
-		drawobj = _process_drawqueue_get_next_drawobj(drawctxt);
+		for (nr = 0; nr < room; nr++) {
+			struct kgsl_drawobj *drawobj =
+				_process_drawqueue_get_next_drawobj(drawctxt);
 
-		/*
-		 * adreno_context_get_drawobj returns -EAGAIN if the current
-		 * drawobj has pending sync points so no more to do here.
-		 * When the sync points are satisfied then the context will get
-		 * reqeueued
-		 */
+			/*
+			 * adreno_context_get_drawobj returns -EAGAIN if the
+			 * current drawobj has pending sync points so no more
+			 * to do here. When the sync points are satisfied then
+			 * the context will get reqeueued
+			 */
+			if (IS_ERR_OR_NULL(drawobj)) {
+				if (IS_ERR(drawobj))
+					ret = PTR_ERR(drawobj);
+				break;
+			}
 
-		if (IS_ERR_OR_NULL(drawobj)) {
-			if (IS_ERR(drawobj))
-				ret = PTR_ERR(drawobj);
-			spin_unlock(&drawctxt->lock);
-			break;
+			/*
+			 * Keep the slot accounted in queued until the batch
+			 * has been sent so there is always room to put the
+			 * unsent part back
+			 */
+			drawctxt->drawqueue_head = DRAWQUEUE_NEXT(
+				drawctxt->drawqueue_head,
+				ADRENO_CONTEXT_DRAWQUEUE_SIZE);
+			batch[nr] = CMDOBJ(drawobj);
+			timestamps[nr] = drawobj->timestamp;
 		}
-		_pop_drawobj(drawctxt);
 		spin_unlock(&drawctxt->lock);
 
-		timestamp = drawobj->timestamp;
-		cmdobj = CMDOBJ(drawobj);
-		ret = sendcmd(adreno_dev, cmdobj);
+		if (!nr)
+			break;
+
+		sent = sendcmds(adreno_dev, batch, nr, &ret);
+		if (sent)
+			drawctxt->submitted_timestamp = timestamps[sent - 1];
+		count += sent;
 
 		/*
-		 * On error from sendcmd() try to requeue the cmdobj
+		 * On error from sendcmds() try to requeue the unsent cmdobjs
 		 * unless we got back -ENOENT which means that the context has
 		 * been detached and there will be no more deliveries from here
 		 */
-		if (ret != 0) {
+		if (sent < nr) {
+			int r;
+
 			/* Destroy the cmdobj on -ENOENT */
 			if (ret == -ENOENT)
-				kgsl_drawobj_destroy(drawobj);
-			else {
-				/*
-				 * If the requeue returns an error, return that
-				 * instead of whatever sendcmd() sent us
-				 */
-				int r = adreno_dispatcher_requeue_cmdobj(
-					drawctxt, cmdobj);
-				if (r)
-					ret = r;
-			}
+				kgsl_drawobj_destroy(DRAWOBJ(batch[sent++]));
+
+			/*
+			 * If the requeue returns an error, return that
+			 * instead of whatever sendcmds() sent us
+			 */
+			r = adreno_dispatcher_requeue_cmdobjs(drawctxt,
+				&batch[sent], nr - sent, nr);
+			if (r)
+				ret = r;
 
 			break;
 		}
 
-		drawctxt->submitted_timestamp = timestamp;
+		_release_drawobjs(drawctxt, nr);
 
-		count++;
+		if (ret)
+			break;
 	}
 
 	/*
@@ -1163,18 +1270,43 @@ static inline int _verify_cmdobj(struct kgsl_device_private *dev_priv,
 	return 0;
 }
 
+/*
+ * Return true if count more drawobjs can't be queued right now. Beyond the
+ * tunable limit, a vectored submission must also fit in the ring itself with
+ * the one slot that requeueing relies on to spare.
+ */
+static inline bool _context_queue_full(struct adreno_context *drawctxt,
+	unsigned int count)
+{
+	return drawctxt->queued >= _context_drawqueue_size ||
+		drawctxt->queued + count >= ADRENO_CONTEXT_DRAWQUEUE_SIZE;
+}
+
+static int _check_context_queue_room(struct adreno_context *drawctxt,
+	unsigned int count)
+{
+	int ret;
+
+	spin_lock(&drawctxt->lock);
+	ret = kgsl_context_invalid(&drawctxt->base) ||
+		!_context_queue_full(drawctxt, count);
+	spin_unlock(&drawctxt->lock);
+
+	return ret;
+}
+
 static inline int _wait_for_room_in_context_queue(
-	struct adreno_context *drawctxt)
+	struct adreno_context *drawctxt, unsigned int count)
 {
 	int ret = 0;
 
 	/* Wait for room in the context queue */
-	while (drawctxt->queued >= _context_drawqueue_size) {
+	while (_context_queue_full(drawctxt, count)) {
 		trace_adreno_drawctxt_sleep(drawctxt);
 		spin_unlock(&drawctxt->lock);
 
 		ret = wait_event_interruptible_timeout(drawctxt->wq,
-			_check_context_queue(drawctxt),
+			_check_context_queue_room(drawctxt, count),
 			msecs_to_jiffies(_context_queue_wait));
 
 		spin_lock(&drawctxt->lock);
@@ -1188,14 +1320,14 @@ static inline int _wait_for_room_in_context_queue(
 }
 
 static unsigned int _check_context_state_to_queue_cmds(
-	struct adreno_context *drawctxt)
+	struct adreno_context *drawctxt, unsigned int count)
 {
 	int ret = _check_context_state(&drawctxt->base);
 
 	if (ret)
 		return ret;
 
-	ret = _wait_for_room_in_context_queue(drawctxt);
+	ret = _wait_for_room_in_context_queue(drawctxt, count);
 	if (ret)
 		return ret;
 
@@ -1309,6 +1441,7 @@ static int _queue_cmdobj(struct adreno_device *adreno_dev,
 	}
 
 	drawctxt->queued_timestamp = *timestamp;
+	cmdobj->queue_time = ktime_get();
 	_set_ft_policy(adreno_dev, drawctxt, cmdobj);
 	_cmdobj_set_flags(drawctxt, cmdobj);
 
@@ -1367,7 +1500,7 @@ int adreno_dispatcher_queue_cmds(struct kgsl_device_private *dev_priv,
 
 	spin_lock(&drawctxt->lock);
 
-	ret = _check_context_state_to_queue_cmds(drawctxt);
+	ret = _check_context_state_to_queue_cmds(drawctxt, count);
 	if (ret) {
 		spin_unlock(&drawctxt->lock);
 		return ret;
@@ -2343,6 +2476,12 @@ static void retire_cmdobj(struct adreno_device *adreno_dev,
 			adreno_get_rptr(drawctxt->rb), cmdobj->fault_recovery);
 	}
 
+	if (drawobj->flags & KGSL_DRAWOBJ_END_OF_FRAME) {
+		kgsl_pwrscale_frame_end(KGSL_DEVICE(adreno_dev));
+		frame_trace_gpu_frame(ktime_to_ns(ktime_sub(ktime_get(),
+						  cmdobj->submit_time)));
+	}
+
 	kgsl_drawobj_destroy(drawobj);
 }
 
@@ -2734,6 +2873,38 @@ static ssize_t _show_uint(struct adreno_dispatcher *dispatcher,
 		*((unsigned int *) attr->value));
 }
 
+static ssize_t _show_submit_latency(struct adreno_dispatcher *dispatcher,
+		struct dispatcher_attribute *attr,
+		char *buf)
+{
+	int i, count = 0;
+
+	for (i = 0; i < ADRENO_DISPATCH_LATENCY_BUCKETS; i++)
+		count += scnprintf(buf + count, PAGE_SIZE - count, "<%luus %d\n",
+			1UL << i,
+			atomic_read(&dispatcher->submit_latency[i]));
+
+	return count;
+}
+
+static ssize_t _store_submit_latency(struct adreno_dispatcher *dispatcher,
+		struct dispatcher_attribute *attr,
+		const char *buf, size_t size)
+{
+	int i;
+
+	for (i = 0; i < ADRENO_DISPATCH_LATENCY_BUCKETS; i++)
+		atomic_set(&dispatcher->submit_latency[i], 0);
+
+	return size;
+}
+
+static struct dispatcher_attribute dispatcher_attr_submit_latency = {
+	.attr = { .name = "submit_latency", .mode = 0644 },
+	.show = _show_submit_latency,
+	.store = _store_submit_latency,
+};
+
 static DISPATCHER_UINT_ATTR(inflight, 0644, ADRENO_DISPATCH_DRAWQUEUE_SIZE,
 	_dispatcher_q_inflight_hi);
 
@@ -2769,6 +2940,7 @@ static struct attribute *dispatcher_attrs[] = {
 	&dispatcher_attr_fault_detect_interval.attr,
 	&dispatcher_attr_fault_throttle_time.attr,
 	&dispatcher_attr_fault_throttle_burst.attr,
+	&dispatcher_attr_submit_latency.attr,
 	NULL,
 };
 
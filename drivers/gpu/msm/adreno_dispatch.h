@@ -26,6 +26,12 @@ extern unsigned int adreno_drawobj_timeout;
 
 #define DRAWQUEUE_NEXT(_i, _s) (((_i) + 1) % (_s))
 
+/* Most drawobjs pulled from a context queue and sent in one go */
+#define ADRENO_DISPATCH_BATCH_SIZE 8
+
+/* Buckets of the submit latency histogram, bucket n counts < 2^n usecs */
+#define ADRENO_DISPATCH_LATENCY_BUCKETS 16
+
 /**
  * struct adreno_dispatcher_drawqueue - List of commands for a RB level
  * @cmd_q: List of command obj's submitted to dispatcher
@@ -56,6 +62,8 @@ struct adreno_dispatcher_drawqueue {
  * @work: work_struct to put the dispatcher in a work queue
  * @kobj: kobject for the dispatcher directory in the device sysfs node
  * @idle_gate: Gate to wait on for dispatcher to idle
+ * @submit_latency: Histogram of the time from queueing a cmdobj to writing it
+ * to the ringbuffer
  */
 struct adreno_dispatcher {
 	struct mutex mutex;
@@ -69,6 +77,7 @@ struct adreno_dispatcher {
 	struct kthread_work work;
 	struct kobject kobj;
 	struct completion idle_gate;
+	atomic_t submit_latency[ADRENO_DISPATCH_LATENCY_BUCKETS];
 };
 
 enum adreno_dispatcher_flags {
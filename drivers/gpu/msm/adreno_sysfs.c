@@ -328,6 +328,171 @@ static unsigned int _preempt_count_show(struct adreno_device *adreno_dev)
 	return preempt->count;
 }
 
+static ssize_t preempt_latency_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct adreno_device *adreno_dev = _get_adreno_dev(dev);
+	struct adreno_preemption *preempt;
+	u64 avg;
+
+	if (adreno_dev == NULL)
+		return 0;
+
+	preempt = &adreno_dev->preempt;
+	avg = preempt->latency_total;
+	if (preempt->count)
+		do_div(avg, preempt->count);
+
+	return snprintf(buf, PAGE_SIZE, "last=%u max=%u avg=%llu\n",
+		preempt->latency_last, preempt->latency_max, avg);
+}
+
+static ssize_t preempt_latency_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct adreno_device *adreno_dev = _get_adreno_dev(dev);
+	struct kgsl_device *device;
+
+	if (adreno_dev == NULL)
+		return 0;
+
+	/* Any write resets the statistics */
+	device = KGSL_DEVICE(adreno_dev);
+	mutex_lock(&device->mutex);
+	adreno_dev->preempt.latency_last = 0;
+	adreno_dev->preempt.latency_max = 0;
+	adreno_dev->preempt.latency_total = 0;
+	adreno_dev->preempt.count = 0;
+	mutex_unlock(&device->mutex);
+
+	return count;
+}
+
+static ssize_t preempt_rb_priority_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct adreno_device *adreno_dev = _get_adreno_dev(dev);
+	unsigned int *rb_prio;
+	int i, prio, ret = 0;
+
+	if (adreno_dev == NULL)
+		return 0;
+
+	rb_prio = adreno_dev->preempt.rb_prio;
+
+	for (i = 0; i < adreno_dev->num_ringbuffers; i++) {
+		if (rb_prio[adreno_dev->num_ringbuffers - 1])
+			prio = rb_prio[i];
+		else
+			prio = i * adreno_dev->num_ringbuffers;
+
+		ret += snprintf(buf + ret, PAGE_SIZE - ret, "%d%c", prio,
+			i == adreno_dev->num_ringbuffers - 1 ? '\n' : ' ');
+	}
+
+	return ret;
+}
+
+/*
+ * Write one starting context priority per ringbuffer, in ringbuffer order
+ * and strictly ascending starting with 0, for example "0 1 4 8". Writing
+ * "0" goes back to splitting the priorities evenly. The new ranges apply to
+ * contexts created afterwards.
+ */
+static ssize_t preempt_rb_priority_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct adreno_device *adreno_dev = _get_adreno_dev(dev);
+	unsigned int prio[KGSL_PRIORITY_MAX_RB_LEVELS] = { 0 };
+	struct kgsl_device *device;
+	int i, num;
+
+	if (adreno_dev == NULL)
+		return 0;
+
+	num = sscanf(buf, "%u %u %u %u", &prio[0], &prio[1], &prio[2],
+		&prio[3]);
+
+	if (num == 1 && prio[0] == 0)
+		goto done;
+
+	if (num != adreno_dev->num_ringbuffers || prio[0] != 0)
+		return -EINVAL;
+
+	for (i = 1; i < num; i++)
+		if (prio[i] <= prio[i - 1] ||
+			prio[i] > KGSL_CONTEXT_PRIORITY_MASK >>
+				KGSL_CONTEXT_PRIORITY_SHIFT)
+			return -EINVAL;
+
+done:
+	device = KGSL_DEVICE(adreno_dev);
+	mutex_lock(&device->mutex);
+	memcpy(adreno_dev->preempt.rb_prio, prio, sizeof(prio));
+	mutex_unlock(&device->mutex);
+
+	return count;
+}
+
+static struct gmu_device *_get_gmu(struct adreno_device *adreno_dev)
+{
+	struct kgsl_device *device = KGSL_DEVICE(adreno_dev);
+
+	if (!gmu_core_isenabled(device) ||
+		device->gmu_core.type != GMU_CORE_TYPE_CM3)
+		return NULL;
+
+	return KGSL_GMU_DEVICE(device);
+}
+
+static int _hfi_async_dcvs_store(struct adreno_device *adreno_dev,
+		unsigned int val)
+{
+	struct kgsl_device *device = KGSL_DEVICE(adreno_dev);
+	struct gmu_device *gmu = _get_gmu(adreno_dev);
+
+	if (gmu == NULL)
+		return -ENODEV;
+
+	mutex_lock(&device->mutex);
+	gmu->hfi.async_dcvs = val;
+	if (!val)
+		hfi_dcvs_flush(gmu);
+	mutex_unlock(&device->mutex);
+
+	return 0;
+}
+
+static unsigned int _hfi_async_dcvs_show(struct adreno_device *adreno_dev)
+{
+	struct gmu_device *gmu = _get_gmu(adreno_dev);
+
+	return gmu ? gmu->hfi.async_dcvs : 0;
+}
+
+static ssize_t hfi_dcvs_stats_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct adreno_device *adreno_dev = _get_adreno_dev(dev);
+	struct hfi_dcvs_stats stats;
+	struct gmu_device *gmu;
+
+	if (adreno_dev == NULL)
+		return 0;
+
+	gmu = _get_gmu(adreno_dev);
+	if (gmu == NULL)
+		return 0;
+
+	spin_lock(&gmu->hfi.dcvs_lock);
+	stats = gmu->hfi.dcvs_stats;
+	spin_unlock(&gmu->hfi.dcvs_lock);
+
+	return snprintf(buf, PAGE_SIZE,
+		"queued=%u coalesced=%u acked=%u failed=%u\n",
+		stats.queued, stats.coalesced, stats.acked, stats.failed);
+}
+
 static unsigned int acd_data_index;
 static DEFINE_SPINLOCK(acd_data_index_lock);
 
@@ -633,6 +798,9 @@ static ADRENO_SYSFS_BOOL(gpu_llc_slice_enable);
 static ADRENO_SYSFS_BOOL(gpuhtw_llc_slice_enable);
 
 static DEVICE_INT_ATTR(wake_nice, 0644, adreno_wake_nice);
+static DEVICE_ATTR_RW(preempt_latency);
+static DEVICE_ATTR_RW(preempt_rb_priority);
+static DEVICE_ATTR_RO(hfi_dcvs_stats);
 
 static ADRENO_SYSFS_BOOL(sptp_pc);
 static ADRENO_SYSFS_BOOL(lm);
@@ -642,6 +810,7 @@ static ADRENO_SYSFS_RO_BOOL(throttling);
 static ADRENO_SYSFS_BOOL(ifpc);
 static ADRENO_SYSFS_RO_U32(ifpc_count);
 static ADRENO_SYSFS_BOOL(acd);
+static ADRENO_SYSFS_BOOL(hfi_async_dcvs);
 
 static ADRENO_SYSFS_U32(acd_data_index);
 static ADRENO_SYSFS_U32(acd_version);
@@ -669,7 +838,11 @@ static const struct device_attribute *_attr_list[] = {
 	&adreno_attr_ifpc.attr,
 	&adreno_attr_ifpc_count.attr,
 	&adreno_attr_preempt_count.attr,
+	&dev_attr_preempt_latency.attr,
+	&dev_attr_preempt_rb_priority.attr,
 	&adreno_attr_acd.attr,
+	&adreno_attr_hfi_async_dcvs.attr,
+	&dev_attr_hfi_dcvs_stats.attr,
 	&adreno_attr_acd_data_index.attr,
 	&adreno_attr_acd_version.attr,
 	&adreno_attr_acd_stride.attr,
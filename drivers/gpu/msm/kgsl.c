@@ -34,6 +34,7 @@
 #include <linux/ctype.h>
 #include <linux/mm.h>
 #include <linux/ion.h>
+#include <linux/oom.h>
 #include <asm/cacheflush.h>
 #include <uapi/linux/sched/types.h>
 #include <soc/qcom/boot_stats.h>
@@ -1005,6 +1006,7 @@ static void kgsl_destroy_process_private(struct kref *kref)
 	put_pid(private->pid);
 	idr_destroy(&private->mem_idr);
 	idr_destroy(&private->syncsource_idr);
+	kgsl_drawobj_pool_destroy(&private->drawobj_pool);
 
 	/* When using global pagetables, do not put global pagetable */
 	if (private->pagetable->name != KGSL_MMU_GLOBAL_PT)
@@ -1042,6 +1044,34 @@ struct kgsl_process_private *kgsl_process_private_find(pid_t pid)
 	return private;
 }
 
+/**
+ * kgsl_task_gpu_pages() - Return the number of GPU pages a task holds
+ * @task: The task to look up
+ *
+ * Counts the memory kgsl allocated for the process of @task, which is given
+ * back when the process dies. Safe to call from atomic context.
+ */
+unsigned long kgsl_task_gpu_pages(struct task_struct *task)
+{
+	struct kgsl_process_private *p;
+	struct pid *pid = task_tgid(task);
+	unsigned long pages = 0;
+
+	spin_lock(&kgsl_driver.proclist_lock);
+	list_for_each_entry(p, &kgsl_driver.process_list, list) {
+		if (p->pid == pid) {
+			pages = atomic64_read(
+				&p->stats[KGSL_MEM_ENTRY_KERNEL].cur) >>
+				PAGE_SHIFT;
+			break;
+		}
+	}
+	spin_unlock(&kgsl_driver.proclist_lock);
+
+	return pages;
+}
+EXPORT_SYMBOL(kgsl_task_gpu_pages);
+
 static struct kgsl_process_private *kgsl_process_private_new(
 		struct kgsl_device *device)
 {
@@ -1104,6 +1134,8 @@ static struct kgsl_process_private *kgsl_process_private_new(
 		return private;
 	}
 
+	kgsl_drawobj_pool_init(&private->drawobj_pool);
+
 	kgsl_process_init_sysfs(device, private);
 	kgsl_process_init_debugfs(private);
 	spin_lock(&kgsl_driver.proclist_lock);
@@ -1117,6 +1149,12 @@ static void process_release_memory(struct kgsl_process_private *private)
 {
 	struct kgsl_mem_entry *entry;
 	int next = 0;
+	/*
+	 * If the process was killed to free memory make sure its pages reach
+	 * the system instead of refilling the pool
+	 */
+	bool nopool = test_thread_flag(TIF_MEMDIE) ||
+		tsk_is_oom_victim(current);
 
 	while (1) {
 		spin_lock(&private->mem_lock);
@@ -1133,6 +1171,8 @@ static void process_release_memory(struct kgsl_process_private *private)
 		 */
 		if (!entry->pending_free) {
 			entry->pending_free = 1;
+			if (nopool)
+				entry->memdesc.priv |= KGSL_MEMDESC_NOPOOL;
 			spin_unlock(&private->mem_lock);
 			kgsl_mem_entry_put(entry);
 		} else {
@@ -2027,6 +2067,147 @@ long kgsl_ioctl_gpu_command(struct kgsl_device_private *dev_priv,
 	return result;
 }
 
+static int _copy_command_batches(struct kgsl_gpu_command_batch *batches,
+		struct kgsl_gpu_command_vec *param)
+{
+	void __user *ptr = to_user_ptr(param->batchlist);
+	unsigned int i;
+	int ret;
+
+	/* The common case: one copy for the whole list */
+	if (param->batchsize == sizeof(*batches))
+		return copy_from_user(batches, ptr,
+			param->numbatches * sizeof(*batches)) ? -EFAULT : 0;
+
+	for (i = 0; i < param->numbatches; i++) {
+		ret = kgsl_copy_from_user(&batches[i], ptr, sizeof(*batches),
+			param->batchsize);
+		if (ret)
+			return ret;
+
+		ptr += param->batchsize;
+	}
+
+	return 0;
+}
+
+long kgsl_ioctl_gpu_command_vec(struct kgsl_device_private *dev_priv,
+		unsigned int cmd, void *data)
+{
+	struct kgsl_gpu_command_vec *param = data;
+	struct kgsl_device *device = dev_priv->device;
+	struct kgsl_gpu_command_batch *batches;
+	struct kgsl_drawobj **drawobj;
+	struct kgsl_context *context;
+	long result;
+	unsigned int i = 0, j;
+
+	if (param->flags || !param->numbatches ||
+			param->numbatches > KGSL_MAX_COMMAND_VEC ||
+			param->numsyncs > KGSL_MAX_SYNCPOINTS)
+		return -EINVAL;
+
+	context = kgsl_context_get_owner(dev_priv, param->context_id);
+	if (context == NULL)
+		return -EINVAL;
+
+	/*
+	 * A single user timestamp can't cover several command objs and sparse
+	 * contexts have their own submission path
+	 */
+	if (_check_context_is_sparse(context, 0) ||
+		(context->flags & KGSL_CONTEXT_USER_GENERATED_TS)) {
+		kgsl_context_put(context);
+		return -EINVAL;
+	}
+
+	batches = kcalloc(param->numbatches, sizeof(*batches), GFP_KERNEL);
+	drawobj = kcalloc(param->numbatches + 1, sizeof(*drawobj), GFP_KERNEL);
+	if (batches == NULL || drawobj == NULL) {
+		result = -ENOMEM;
+		goto done;
+	}
+
+	result = _copy_command_batches(batches, param);
+	if (result)
+		goto done;
+
+	/* One sync obj ahead of the batches gates all of them */
+	if (param->numsyncs) {
+		struct kgsl_drawobj_sync *syncobj =
+				kgsl_drawobj_sync_create(device, context);
+
+		if (IS_ERR(syncobj)) {
+			result = PTR_ERR(syncobj);
+			goto done;
+		}
+
+		drawobj[i++] = DRAWOBJ(syncobj);
+
+		result = kgsl_drawobj_sync_add_synclist(device, syncobj,
+				to_user_ptr(param->synclist),
+				param->syncsize, param->numsyncs);
+		if (result)
+			goto done;
+	}
+
+	for (j = 0; j < param->numbatches; j++) {
+		struct kgsl_gpu_command_batch *batch = &batches[j];
+		struct kgsl_drawobj_cmd *cmdobj;
+
+		if (_process_command_input(device, batch->flags,
+				batch->numcmds, batch->numobjs, 0) !=
+				CMDOBJ_TYPE ||
+			_check_context_is_sparse(context, batch->flags)) {
+			result = -EINVAL;
+			goto done;
+		}
+
+		cmdobj = kgsl_drawobj_cmd_create(device, context, batch->flags,
+				CMDOBJ_TYPE);
+		if (IS_ERR(cmdobj)) {
+			result = PTR_ERR(cmdobj);
+			goto done;
+		}
+
+		drawobj[i++] = DRAWOBJ(cmdobj);
+
+		result = kgsl_drawobj_cmd_add_cmdlist(device, cmdobj,
+			to_user_ptr(batch->cmdlist),
+			batch->cmdsize, batch->numcmds);
+		if (result)
+			goto done;
+
+		result = kgsl_drawobj_cmd_add_memlist(device, cmdobj,
+			to_user_ptr(batch->objlist),
+			batch->objsize, batch->numobjs);
+		if (result)
+			goto done;
+
+		/* If no profiling buffer was specified, clear the flag */
+		if (cmdobj->profiling_buf_entry == NULL)
+			DRAWOBJ(cmdobj)->flags &=
+				~(unsigned long)KGSL_DRAWOBJ_PROFILING;
+	}
+
+	result = device->ftbl->queue_cmds(dev_priv, context, drawobj,
+				i, &param->timestamp);
+
+done:
+	/*
+	 * -EPROTO is a "success" error - it just tells the user that the
+	 * context had previously faulted
+	 */
+	if (result && result != -EPROTO)
+		while (i--)
+			kgsl_drawobj_destroy(drawobj[i]);
+
+	kfree(drawobj);
+	kfree(batches);
+	kgsl_context_put(context);
+	return result;
+}
+
 long kgsl_ioctl_cmdstream_readtimestamp_ctxtid(struct kgsl_device_private
 						*dev_priv, unsigned int cmd,
 						void *data)
@@ -3393,7 +3574,8 @@ struct kgsl_mem_entry *gpumem_alloc_entry(
 		| KGSL_MEMFLAGS_SECURE
 		| KGSL_MEMFLAGS_FORCE_32BIT
 		| KGSL_MEMFLAGS_IOCOHERENT
-		| KGSL_MEMFLAGS_GUARD_PAGE;
+		| KGSL_MEMFLAGS_GUARD_PAGE
+		| KGSL_MEMFLAGS_LAZY;
 
 	/* Return not supported error if secure memory isn't enabled */
 	if (!kgsl_mmu_is_secured(mmu) &&
@@ -4865,6 +5047,10 @@ struct kgsl_driver kgsl_driver  = {
 	.stats.mapped_max = ATOMIC_LONG_INIT(0),
 	.stats.page_free_pending = ATOMIC_LONG_INIT(0),
 	.stats.page_alloc_pending = ATOMIC_LONG_INIT(0),
+	.stats.page_alloc_4k = ATOMIC_LONG_INIT(0),
+	.stats.page_alloc_64k = ATOMIC_LONG_INIT(0),
+	.stats.page_alloc_1m = ATOMIC_LONG_INIT(0),
+	.stats.page_alloc_2m = ATOMIC_LONG_INIT(0),
 };
 EXPORT_SYMBOL(kgsl_driver);
 
@@ -101,6 +101,7 @@ static inline void KGSL_STATS_ADD(uint64_t size, atomic_long_t *stat,
 
 #define KGSL_MAX_NUMIBS 100000
 #define KGSL_MAX_SYNCPOINTS 32
+#define KGSL_MAX_COMMAND_VEC 32
 #define KGSL_MAX_SPARSE 1000
 
 struct kgsl_device;
@@ -153,6 +154,10 @@ struct kgsl_driver {
 		atomic_long_t mapped_max;
 		atomic_long_t page_free_pending;
 		atomic_long_t page_alloc_pending;
+		atomic_long_t page_alloc_4k;
+		atomic_long_t page_alloc_64k;
+		atomic_long_t page_alloc_1m;
+		atomic_long_t page_alloc_2m;
 	} stats;
 	unsigned int full_cache_threshold;
 	struct workqueue_struct *workqueue;
@@ -196,6 +201,10 @@ struct kgsl_memdesc_ops {
 #define KGSL_MEMDESC_UCODE BIT(9)
 /* For global buffers, randomly assign an address from the region */
 #define KGSL_MEMDESC_RANDOM BIT(10)
+/* Pages are allocated and mapped on demand */
+#define KGSL_MEMDESC_LAZY BIT(11)
+/* Return the pages to the system instead of the pool when freed */
+#define KGSL_MEMDESC_NOPOOL BIT(12)
 
 /**
  * struct kgsl_memdesc - GPU memory object descriptor
@@ -215,6 +224,7 @@ struct kgsl_memdesc_ops {
  * @pages: An array of pointers to allocated pages
  * @page_count: Total number of pages allocated
  * @cur_bindings: Number of sparse pages actively bound
+ * @memcg: Memory cgroup the pages are charged to, if any
  */
 struct kgsl_memdesc {
 	struct kgsl_pagetable *pagetable;
@@ -233,6 +243,7 @@ struct kgsl_memdesc {
 	struct page **pages;
 	unsigned int page_count;
 	unsigned int cur_bindings;
+	struct mem_cgroup *memcg;
 	/*
 	 * @lock: Spinlock to protect the gpuaddr from being accessed by
 	 * multiple entities trying to map the same SVM region at once
@@ -311,6 +322,7 @@ typedef void (*kgsl_event_func)(struct kgsl_device *, struct kgsl_event_group *,
  * @work: Work struct for dispatching the callback
  * @result: KGSL event result type to pass to the callback
  * group: The event group this event belongs to
+ * @signaled: Time the event was handed to the worker
  */
 struct kgsl_event {
 	struct kgsl_device *device;
@@ -323,6 +335,7 @@ struct kgsl_event {
 	struct kthread_work work;
 	int result;
 	struct kgsl_event_group *group;
+	ktime_t signaled;
 };
 
 typedef int (*readtimestamp_func)(struct kgsl_device *, void *,
@@ -332,8 +345,10 @@ typedef int (*readtimestamp_func)(struct kgsl_device *, void *,
  * struct event_group - A list of GPU events
  * @context: Pointer to the active context for the events
  * @lock: Spinlock for protecting the list
- * @events: List of active GPU events
+ * @events: List of active GPU events, sorted by expiry timestamp
  * @group: Node for the master group list
+ * @active: Node for the list of groups that have pending events
+ * @next: Timestamp of the first event on @events
  * @processed: Last processed timestamp
  * @name: String name for the group (for the debugfs file)
  * @readtimestamp: Function pointer to read a timestamp
@@ -344,6 +359,8 @@ struct kgsl_event_group {
 	spinlock_t lock;
 	struct list_head events;
 	struct list_head group;
+	struct list_head active;
+	unsigned int next;
 	unsigned int processed;
 	char name[64];
 	readtimestamp_func readtimestamp;
@@ -431,6 +448,8 @@ long kgsl_ioctl_gpuobj_sync(struct kgsl_device_private *dev_priv,
 					unsigned int cmd, void *data);
 long kgsl_ioctl_gpu_command(struct kgsl_device_private *dev_priv,
 				unsigned int cmd, void *data);
+long kgsl_ioctl_gpu_command_vec(struct kgsl_device_private *dev_priv,
+				unsigned int cmd, void *data);
 long kgsl_ioctl_gpuobj_set_info(struct kgsl_device_private *dev_priv,
 				unsigned int cmd, void *data);
 
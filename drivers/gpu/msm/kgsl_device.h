@@ -315,6 +315,8 @@ struct kgsl_device {
 	bool snapshot_crashdumper;
 	/* Use HOST side register reads to get GPU snapshot*/
 	bool snapshot_legacy;
+	/* Allocate snapshots on fault and hand them to devcoredump */
+	bool snapshot_stream;
 
 	struct kobject snapshot_kobj;
 
@@ -466,6 +468,7 @@ struct kgsl_context {
  * @fd_count: Counter for the number of FDs for this process
  * @ctxt_count: Count for the number of contexts for this process
  * @ctxt_count_lock: Spinlock to protect ctxt_count
+ * @drawobj_pool: Cache of freed drawobjs and memobj nodes for reuse
  */
 struct kgsl_process_private {
 	unsigned long priv;
@@ -488,6 +491,7 @@ struct kgsl_process_private {
 	int fd_count;
 	atomic_t ctxt_count;
 	spinlock_t ctxt_count_lock;
+	struct kgsl_drawobj_pool drawobj_pool;
 };
 
 /**
@@ -527,6 +531,7 @@ struct kgsl_device_private {
  * @first_read: True until the snapshot read is started
  * @gmu_fault: Snapshot collected when GMU fault happened
  * @recovered: True if GPU was recovered after previous snapshot
+ * @stream: True if the snapshot owns @start and is read through devcoredump
  */
 struct kgsl_snapshot {
 	uint64_t ib1base;
@@ -551,6 +556,7 @@ struct kgsl_snapshot {
 	bool first_read;
 	bool gmu_fault;
 	bool recovered;
+	bool stream;
         #if defined(OPLUS_FEATURE_GPU_MINIDUMP)
         // MeiDongting@MULTIMEIDA.FEATURE.GPU.MINIDUMP, 2020/04/06, Add for OPPO gpu mini dump
         char snapshot_hashid[96];
@@ -47,28 +47,250 @@ static struct kmem_cache *drawobj_sparse_cache;
 static struct kmem_cache *drawobj_sync_cache;
 static struct kmem_cache *drawobj_cmd_cache;
 
+/*
+ * Each process keeps a small cache of the cmd/sync objects and memobj nodes
+ * it has recently freed so that the submission path can usually skip the
+ * slab altogether. The per-process caches are linked on a global list so
+ * that the shrinker can drain them under memory pressure.
+ */
+static LIST_HEAD(drawobj_pools);
+static DEFINE_SPINLOCK(drawobj_pools_lock);
+
+static struct kmem_cache **drawobj_pool_caches[KGSL_DRAWOBJ_POOL_MAX] = {
+	[KGSL_DRAWOBJ_POOL_CMD] = &drawobj_cmd_cache,
+	[KGSL_DRAWOBJ_POOL_SYNC] = &drawobj_sync_cache,
+	[KGSL_DRAWOBJ_POOL_MEM] = &memobjs_cache,
+};
+
+static const unsigned int drawobj_pool_limits[KGSL_DRAWOBJ_POOL_MAX] = {
+	[KGSL_DRAWOBJ_POOL_CMD] = KGSL_DRAWOBJ_POOL_CMDOBJS,
+	[KGSL_DRAWOBJ_POOL_SYNC] = KGSL_DRAWOBJ_POOL_SYNCOBJS,
+	[KGSL_DRAWOBJ_POOL_MEM] = KGSL_DRAWOBJ_POOL_MEMOBJS,
+};
+
+static const char * const drawobj_pool_names[KGSL_DRAWOBJ_POOL_MAX] = {
+	[KGSL_DRAWOBJ_POOL_CMD] = "cmd",
+	[KGSL_DRAWOBJ_POOL_SYNC] = "sync",
+	[KGSL_DRAWOBJ_POOL_MEM] = "memobj",
+};
+
+static inline struct kgsl_drawobj_pool *drawobj_pool(
+		struct kgsl_drawobj *drawobj)
+{
+	return &drawobj->context->proc_priv->drawobj_pool;
+}
+
+static void *drawobj_pool_alloc(struct kgsl_drawobj_pool *pool, int type,
+		bool zero)
+{
+	struct kmem_cache *cache = *drawobj_pool_caches[type];
+	unsigned long flags;
+	void *obj;
+
+	spin_lock_irqsave(&pool->lock, flags);
+	obj = pool->free[type];
+	if (obj) {
+		pool->free[type] = *(void **)obj;
+		pool->count[type]--;
+	}
+	spin_unlock_irqrestore(&pool->lock, flags);
+
+	if (obj == NULL) {
+		atomic_inc(&pool->misses[type]);
+		return zero ? kmem_cache_zalloc(cache, GFP_KERNEL) :
+			kmem_cache_alloc(cache, GFP_KERNEL);
+	}
+
+	atomic_inc(&pool->hits[type]);
+
+	if (zero)
+		memset(obj, 0, kmem_cache_size(cache));
+
+	return obj;
+}
+
+static void drawobj_pool_free(struct kgsl_drawobj_pool *pool, int type,
+		void *obj)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&pool->lock, flags);
+	if (pool->count[type] < drawobj_pool_limits[type]) {
+		*(void **)obj = pool->free[type];
+		pool->free[type] = obj;
+		pool->count[type]++;
+		obj = NULL;
+	}
+	spin_unlock_irqrestore(&pool->lock, flags);
+
+	if (obj)
+		kmem_cache_free(*drawobj_pool_caches[type], obj);
+}
+
+/* Release up to @nr cached objects from @pool and return how many were freed */
+static unsigned long drawobj_pool_drain(struct kgsl_drawobj_pool *pool,
+		unsigned long nr)
+{
+	unsigned long flags, freed = 0;
+	void *list[KGSL_DRAWOBJ_POOL_MAX] = { NULL };
+	void *obj;
+	int i;
+
+	spin_lock_irqsave(&pool->lock, flags);
+	for (i = 0; i < KGSL_DRAWOBJ_POOL_MAX && nr; i++) {
+		while (pool->free[i] && nr) {
+			obj = pool->free[i];
+			pool->free[i] = *(void **)obj;
+			pool->count[i]--;
+
+			*(void **)obj = list[i];
+			list[i] = obj;
+			nr--;
+		}
+	}
+	spin_unlock_irqrestore(&pool->lock, flags);
+
+	for (i = 0; i < KGSL_DRAWOBJ_POOL_MAX; i++) {
+		while (list[i]) {
+			obj = list[i];
+			list[i] = *(void **)obj;
+			kmem_cache_free(*drawobj_pool_caches[i], obj);
+			freed++;
+		}
+	}
+
+	return freed;
+}
+
+/**
+ * kgsl_drawobj_pool_init() - Initialize a per process drawobj pool
+ * @pool: Pointer to the pool embedded in the process private
+ */
+void kgsl_drawobj_pool_init(struct kgsl_drawobj_pool *pool)
+{
+	int i;
+
+	spin_lock_init(&pool->lock);
+
+	for (i = 0; i < KGSL_DRAWOBJ_POOL_MAX; i++) {
+		pool->free[i] = NULL;
+		pool->count[i] = 0;
+		atomic_set(&pool->hits[i], 0);
+		atomic_set(&pool->misses[i], 0);
+	}
+
+	spin_lock(&drawobj_pools_lock);
+	list_add(&pool->node, &drawobj_pools);
+	spin_unlock(&drawobj_pools_lock);
+}
+
+/**
+ * kgsl_drawobj_pool_destroy() - Release everything cached in a drawobj pool
+ * @pool: Pointer to the pool embedded in the process private
+ *
+ * Called when the owning process goes away; no drawobjs can still refer to
+ * the process at this point.
+ */
+void kgsl_drawobj_pool_destroy(struct kgsl_drawobj_pool *pool)
+{
+	spin_lock(&drawobj_pools_lock);
+	list_del_init(&pool->node);
+	spin_unlock(&drawobj_pools_lock);
+
+	drawobj_pool_drain(pool, ULONG_MAX);
+}
+
+/**
+ * kgsl_drawobj_pool_show() - Print the pool statistics for sysfs
+ * @pool: Pointer to the pool embedded in the process private
+ * @buf: Output buffer of PAGE_SIZE bytes
+ */
+ssize_t kgsl_drawobj_pool_show(struct kgsl_drawobj_pool *pool, char *buf)
+{
+	ssize_t len = 0;
+	int i;
+
+	for (i = 0; i < KGSL_DRAWOBJ_POOL_MAX; i++)
+		len += scnprintf(buf + len, PAGE_SIZE - len,
+			"%s: hits %d misses %d cached %u\n",
+			drawobj_pool_names[i],
+			atomic_read(&pool->hits[i]),
+			atomic_read(&pool->misses[i]),
+			READ_ONCE(pool->count[i]));
+
+	return len;
+}
+
+static unsigned long
+kgsl_drawobj_pool_shrink_count(struct shrinker *shrinker,
+		struct shrink_control *sc)
+{
+	struct kgsl_drawobj_pool *pool;
+	unsigned long count = 0;
+	int i;
+
+	spin_lock(&drawobj_pools_lock);
+	list_for_each_entry(pool, &drawobj_pools, node)
+		for (i = 0; i < KGSL_DRAWOBJ_POOL_MAX; i++)
+			count += READ_ONCE(pool->count[i]);
+	spin_unlock(&drawobj_pools_lock);
+
+	return count;
+}
+
+static unsigned long
+kgsl_drawobj_pool_shrink_scan(struct shrinker *shrinker,
+		struct shrink_control *sc)
+{
+	struct kgsl_drawobj_pool *pool;
+	unsigned long freed = 0;
+
+	spin_lock(&drawobj_pools_lock);
+	list_for_each_entry(pool, &drawobj_pools, node) {
+		if (freed >= sc->nr_to_scan)
+			break;
+		freed += drawobj_pool_drain(pool, sc->nr_to_scan - freed);
+	}
+	spin_unlock(&drawobj_pools_lock);
+
+	return freed ? freed : SHRINK_STOP;
+}
+
+static struct shrinker kgsl_drawobj_pool_shrinker = {
+	.count_objects = kgsl_drawobj_pool_shrink_count,
+	.scan_objects = kgsl_drawobj_pool_shrink_scan,
+	.seeks = DEFAULT_SEEKS,
+};
+
 void kgsl_drawobj_destroy_object(struct kref *kref)
 {
 	struct kgsl_drawobj *drawobj = container_of(kref,
 		struct kgsl_drawobj, refcount);
+	struct kgsl_context *context = drawobj->context;
 	struct kgsl_drawobj_sync *syncobj;
 
-	kgsl_context_put(drawobj->context);
-
+	/*
+	 * Return the object to the pool before dropping the context - the
+	 * final context put can take the process (and its pool) with it
+	 */
 	switch (drawobj->type) {
 	case SYNCOBJ_TYPE:
 		syncobj = SYNCOBJ(drawobj);
 		kfree(syncobj->synclist);
-		kmem_cache_free(drawobj_sync_cache, syncobj);
+		drawobj_pool_free(drawobj_pool(drawobj),
+			KGSL_DRAWOBJ_POOL_SYNC, syncobj);
 		break;
 	case CMDOBJ_TYPE:
 	case MARKEROBJ_TYPE:
-		kmem_cache_free(drawobj_cmd_cache, CMDOBJ(drawobj));
+		drawobj_pool_free(drawobj_pool(drawobj),
+			KGSL_DRAWOBJ_POOL_CMD, CMDOBJ(drawobj));
 		break;
 	case SPARSEOBJ_TYPE:
 		kmem_cache_free(drawobj_sparse_cache, SPARSEOBJ(drawobj));
 		break;
 	}
+
+	kgsl_context_put(context);
 }
 
 void kgsl_dump_syncpoints(struct kgsl_device *device,
@@ -208,14 +430,15 @@ static void drawobj_sync_func(struct kgsl_device *device,
 	kgsl_drawobj_put(&event->syncobj->base);
 }
 
-static inline void memobj_list_free(struct list_head *list)
+static inline void memobj_list_free(struct kgsl_drawobj_pool *pool,
+		struct list_head *list)
 {
 	struct kgsl_memobj_node *mem, *tmpmem;
 
 	/* Free the cmd mem here */
 	list_for_each_entry_safe(mem, tmpmem, list, node) {
 		list_del_init(&mem->node);
-		kmem_cache_free(memobjs_cache, mem);
+		drawobj_pool_free(pool, KGSL_DRAWOBJ_POOL_MEM, mem);
 	}
 }
 
@@ -295,10 +518,10 @@ static void drawobj_destroy_cmd(struct kgsl_drawobj *drawobj)
 		kgsl_mem_entry_put(cmdobj->profiling_buf_entry);
 
 	/* Destroy the cmdlist we created */
-	memobj_list_free(&cmdobj->cmdlist);
+	memobj_list_free(drawobj_pool(drawobj), &cmdobj->cmdlist);
 
 	/* Destroy the memlist we created */
-	memobj_list_free(&cmdobj->memlist);
+	memobj_list_free(drawobj_pool(drawobj), &cmdobj->memlist);
 }
 
 /**
@@ -606,7 +829,8 @@ int kgsl_drawobj_cmd_add_ibdesc(struct kgsl_device *device,
 	if (drawobj->type & (SYNCOBJ_TYPE | MARKEROBJ_TYPE))
 		return 0;
 
-	mem = kmem_cache_alloc(memobjs_cache, GFP_KERNEL);
+	mem = drawobj_pool_alloc(drawobj_pool(drawobj),
+		KGSL_DRAWOBJ_POOL_MEM, false);
 	if (mem == NULL)
 		return -ENOMEM;
 
@@ -642,11 +866,13 @@ static void *_drawobj_create(struct kgsl_device *device,
 
 	switch (type) {
 	case SYNCOBJ_TYPE:
-		obj = kmem_cache_zalloc(drawobj_sync_cache, GFP_KERNEL);
+		obj = drawobj_pool_alloc(&context->proc_priv->drawobj_pool,
+			KGSL_DRAWOBJ_POOL_SYNC, true);
 		break;
 	case CMDOBJ_TYPE:
 	case MARKEROBJ_TYPE:
-		obj = kmem_cache_zalloc(drawobj_cmd_cache, GFP_KERNEL);
+		obj = drawobj_pool_alloc(&context->proc_priv->drawobj_pool,
+			KGSL_DRAWOBJ_POOL_CMD, true);
 		break;
 	case SPARSEOBJ_TYPE:
 		obj = kmem_cache_zalloc(drawobj_sparse_cache, GFP_KERNEL);
@@ -926,12 +1152,12 @@ int kgsl_drawobj_sync_add_syncpoints(struct kgsl_device *device,
 	return 0;
 }
 
-static int kgsl_drawobj_add_memobject(struct list_head *head,
-		struct kgsl_command_object *obj)
+static int kgsl_drawobj_add_memobject(struct kgsl_drawobj_pool *pool,
+		struct list_head *head, struct kgsl_command_object *obj)
 {
 	struct kgsl_memobj_node *mem;
 
-	mem = kmem_cache_alloc(memobjs_cache, GFP_KERNEL);
+	mem = drawobj_pool_alloc(pool, KGSL_DRAWOBJ_POOL_MEM, false);
 	if (mem == NULL)
 		return -ENOMEM;
 
@@ -1040,7 +1266,8 @@ int kgsl_drawobj_cmd_add_cmdlist(struct kgsl_device *device,
 			return -EINVAL;
 		}
 
-		ret = kgsl_drawobj_add_memobject(&cmdobj->cmdlist, &obj);
+		ret = kgsl_drawobj_add_memobject(drawobj_pool(baseobj),
+			&cmdobj->cmdlist, &obj);
 		if (ret)
 			return ret;
 
@@ -1085,8 +1312,8 @@ int kgsl_drawobj_cmd_add_memlist(struct kgsl_device *device,
 			add_profiling_buffer(device, cmdobj, obj.gpuaddr,
 				obj.size, obj.id, obj.offset);
 		else {
-			ret = kgsl_drawobj_add_memobject(&cmdobj->memlist,
-				&obj);
+			ret = kgsl_drawobj_add_memobject(drawobj_pool(baseobj),
+				&cmdobj->memlist, &obj);
 			if (ret)
 				return ret;
 		}
@@ -1140,6 +1367,8 @@ int kgsl_drawobj_sync_add_synclist(struct kgsl_device *device,
 
 void kgsl_drawobjs_cache_exit(void)
 {
+	unregister_shrinker(&kgsl_drawobj_pool_shrinker);
+
 	kmem_cache_destroy(memobjs_cache);
 	kmem_cache_destroy(sparseobjs_cache);
 
@@ -1161,5 +1390,7 @@ int kgsl_drawobjs_cache_init(void)
 	    !drawobj_sparse_cache || !drawobj_sync_cache || !drawobj_cmd_cache)
 		return -ENOMEM;
 
+	register_shrinker(&kgsl_drawobj_pool_shrinker);
+
 	return 0;
 }
@@ -26,6 +26,36 @@
 #define SYNCOBJ_TYPE    BIT(2)
 #define SPARSEOBJ_TYPE  BIT(3)
 
+/* Most objects of each type a process keeps cached for reuse */
+#define KGSL_DRAWOBJ_POOL_CMDOBJS	64
+#define KGSL_DRAWOBJ_POOL_SYNCOBJS	32
+#define KGSL_DRAWOBJ_POOL_MEMOBJS	512
+
+enum kgsl_drawobj_pool_type {
+	KGSL_DRAWOBJ_POOL_CMD = 0,
+	KGSL_DRAWOBJ_POOL_SYNC,
+	KGSL_DRAWOBJ_POOL_MEM,
+	KGSL_DRAWOBJ_POOL_MAX,
+};
+
+/**
+ * struct kgsl_drawobj_pool - Per process cache of recently freed objects
+ * @lock: Spinlock to protect the free lists
+ * @node: List node for the global list walked by the shrinker
+ * @free: Head of a singly linked free list for each object type
+ * @count: Number of objects on each free list
+ * @hits: Number of allocations served from each free list
+ * @misses: Number of allocations that went back to the slab
+ */
+struct kgsl_drawobj_pool {
+	spinlock_t lock;
+	struct list_head node;
+	void *free[KGSL_DRAWOBJ_POOL_MAX];
+	unsigned int count[KGSL_DRAWOBJ_POOL_MAX];
+	atomic_t hits[KGSL_DRAWOBJ_POOL_MAX];
+	atomic_t misses[KGSL_DRAWOBJ_POOL_MAX];
+};
+
 /**
  * struct kgsl_drawobj - KGSL drawobj descriptor
  * @device: KGSL GPU device that the command was created for
@@ -66,6 +96,9 @@ struct kgsl_drawobj {
  * for easy access
  * @profile_index: Index to store the start/stop ticks in the kernel profiling
  * buffer
+ * @queue_time: When the command obj was queued to its context, cleared once
+ * it is first submitted to the ringbuffer
+ * @submit_time: When the command obj was first submitted to the ringbuffer
 
  */
 struct kgsl_drawobj_cmd {
@@ -80,6 +113,8 @@ struct kgsl_drawobj_cmd {
 	struct kgsl_mem_entry *profiling_buf_entry;
 	uint64_t profiling_buffer_gpuaddr;
 	unsigned int profile_index;
+	ktime_t queue_time;
+	ktime_t submit_time;
 };
 
 /**
@@ -199,6 +234,10 @@ int kgsl_drawobj_sparse_add_sparselist(struct kgsl_device *device,
 int kgsl_drawobjs_cache_init(void);
 void kgsl_drawobjs_cache_exit(void);
 
+void kgsl_drawobj_pool_init(struct kgsl_drawobj_pool *pool);
+void kgsl_drawobj_pool_destroy(struct kgsl_drawobj_pool *pool);
+ssize_t kgsl_drawobj_pool_show(struct kgsl_drawobj_pool *pool, char *buf);
+
 void kgsl_dump_syncpoints(struct kgsl_device *device,
 	struct kgsl_drawobj_sync *syncobj);
 
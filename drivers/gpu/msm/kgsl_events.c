@@ -27,11 +27,33 @@
 static struct kmem_cache *events_cache;
 static struct dentry *events_dentry;
 
+static DEFINE_RWLOCK(group_lock);
+static LIST_HEAD(group_list);
+
+/*
+ * Groups that have at least one pending event. This is the only list walked
+ * on a timestamp interrupt so idle contexts cost nothing. Lock ordering is
+ * active_lock -> group->lock.
+ */
+static DEFINE_SPINLOCK(active_lock);
+static LIST_HEAD(active_list);
+
+/* Must be called with group->lock held */
+static inline void _update_group_next(struct kgsl_event_group *group)
+{
+	struct kgsl_event *event = list_first_entry_or_null(&group->events,
+		struct kgsl_event, node);
+
+	if (event)
+		WRITE_ONCE(group->next, event->timestamp);
+}
+
 static inline void signal_event(struct kgsl_device *device,
 		struct kgsl_event *event, int result)
 {
 	list_del(&event->node);
 	event->result = result;
+	event->signaled = ktime_get();
 	kthread_queue_work(&kgsl_driver.worker, &event->work);
 }
 
@@ -49,6 +71,10 @@ static void _kgsl_event_worker(struct kthread_work *work)
 	trace_kgsl_fire_event(id, event->timestamp, event->result,
 		jiffies - event->created, event->func);
 
+	trace_kgsl_event_latency(KGSL_CONTEXT_ID(event->context),
+		event->timestamp, event->result,
+		ktime_us_delta(ktime_get(), event->signaled));
+
 	event->func(event->device, event->group, event->priv, event->result);
 
 	kgsl_context_put(event->context);
@@ -101,14 +127,17 @@ static void _process_event_group(struct kgsl_device *device,
 	if (!flush && _do_process_group(group->processed, timestamp) == false)
 		goto out;
 
+	/* The list is in timestamp order so stop at the first pending event */
 	list_for_each_entry_safe(event, tmp, &group->events, node) {
 		if (timestamp_cmp(event->timestamp, timestamp) <= 0)
 			signal_event(device, event, KGSL_EVENT_RETIRED);
 		else if (flush)
 			signal_event(device, event, KGSL_EVENT_CANCELLED);
-
+		else
+			break;
 	}
 
+	_update_group_next(group);
 	group->processed = timestamp;
 
 out:
@@ -160,6 +189,7 @@ void kgsl_cancel_events_timestamp(struct kgsl_device *device,
 			signal_event(device, event, KGSL_EVENT_CANCELLED);
 	}
 
+	_update_group_next(group);
 	spin_unlock(&group->lock);
 }
 EXPORT_SYMBOL(kgsl_cancel_events_timestamp);
@@ -179,6 +209,7 @@ void kgsl_cancel_events(struct kgsl_device *device,
 	list_for_each_entry_safe(event, tmp, &group->events, node)
 		signal_event(device, event, KGSL_EVENT_CANCELLED);
 
+	_update_group_next(group);
 	spin_unlock(&group->lock);
 }
 EXPORT_SYMBOL(kgsl_cancel_events);
@@ -205,6 +236,7 @@ void kgsl_cancel_event(struct kgsl_device *device,
 			signal_event(device, event, KGSL_EVENT_CANCELLED);
 	}
 
+	_update_group_next(group);
 	spin_unlock(&group->lock);
 }
 EXPORT_SYMBOL(kgsl_cancel_event);
@@ -248,7 +280,7 @@ int kgsl_add_event(struct kgsl_device *device, struct kgsl_event_group *group,
 {
 	unsigned int queued;
 	struct kgsl_context *context = group->context;
-	struct kgsl_event *event;
+	struct kgsl_event *event, *tmp;
 	unsigned int retired;
 
 	if (!func)
@@ -299,31 +331,83 @@ int kgsl_add_event(struct kgsl_device *device, struct kgsl_event_group *group,
 
 	if (timestamp_cmp(retired, timestamp) >= 0) {
 		event->result = KGSL_EVENT_RETIRED;
+		event->signaled = ktime_get();
 		kthread_queue_work(&kgsl_driver.worker, &event->work);
 		spin_unlock(&group->lock);
 		return 0;
 	}
 
-	/* Add the event to the group list */
-	list_add_tail(&event->node, &group->events);
+	/*
+	 * Keep the list in timestamp order. Timestamps are almost always
+	 * registered in increasing order so start looking from the tail.
+	 */
+	list_for_each_entry_reverse(tmp, &group->events, node) {
+		if (timestamp_cmp(tmp->timestamp, timestamp) <= 0)
+			break;
+	}
+	list_add(&event->node, &tmp->node);
+	_update_group_next(group);
 
 	spin_unlock(&group->lock);
 
+	/*
+	 * Always take the active lock after the event is on the list so that
+	 * the next pass of kgsl_process_event_groups() sees the new head
+	 */
+	spin_lock(&active_lock);
+	if (list_empty(&group->active))
+		list_add_tail(&group->active, &active_list);
+	spin_unlock(&active_lock);
+
 	return 0;
 }
 EXPORT_SYMBOL(kgsl_add_event);
 
-static DEFINE_RWLOCK(group_lock);
-static LIST_HEAD(group_list);
+/*
+ * Return true if the first pending event in the group has retired. This is
+ * checked without the group lock - a stale answer is corrected by the
+ * interrupt for the next retired timestamp.
+ */
+static bool _group_ready(struct kgsl_device *device,
+		struct kgsl_event_group *group)
+{
+	unsigned int retired;
 
+	if (list_empty(&group->events))
+		return false;
+
+	group->readtimestamp(device, group->priv, KGSL_TIMESTAMP_RETIRED,
+		&retired);
+
+	return timestamp_cmp(READ_ONCE(group->next), retired) <= 0;
+}
+
+/**
+ * kgsl_process_event_groups() - Handle retired events in all active groups
+ * @device: Pointer to a KGSL device
+ *
+ * Only groups with pending events are visited and a group is only locked if
+ * its earliest event has retired.
+ */
 void kgsl_process_event_groups(struct kgsl_device *device)
 {
-	struct kgsl_event_group *group;
+	struct kgsl_event_group *group, *tmp;
+
+	spin_lock(&active_lock);
+	list_for_each_entry_safe(group, tmp, &active_list, active) {
+		/*
+		 * Drop groups that have drained; kgsl_add_event() puts them
+		 * back when a new event shows up
+		 */
+		if (list_empty(&group->events)) {
+			list_del_init(&group->active);
+			continue;
+		}
 
-	read_lock(&group_lock);
-	list_for_each_entry(group, &group_list, group)
-		_process_event_group(device, group, false);
-	read_unlock(&group_lock);
+		if (_group_ready(device, group))
+			_process_event_group(device, group, false);
+	}
+	spin_unlock(&active_lock);
 }
 EXPORT_SYMBOL(kgsl_process_event_groups);
 
@@ -336,6 +420,10 @@ void kgsl_del_event_group(struct kgsl_event_group *group)
 	/* Make sure that all the events have been deleted from the list */
 	WARN_ON(!list_empty(&group->events));
 
+	spin_lock(&active_lock);
+	list_del_init(&group->active);
+	spin_unlock(&active_lock);
+
 	write_lock(&group_lock);
 	list_del(&group->group);
 	write_unlock(&group_lock);
@@ -359,6 +447,7 @@ void kgsl_add_event_group(struct kgsl_event_group *group,
 
 	spin_lock_init(&group->lock);
 	INIT_LIST_HEAD(&group->events);
+	INIT_LIST_HEAD(&group->active);
 
 	group->context = context;
 	group->readtimestamp = readtimestamp;
@@ -571,6 +571,8 @@ static int gmu_dcvs_set(struct kgsl_device *device,
 	if (ADRENO_QUIRK(adreno_dev, ADRENO_QUIRK_HFI_USE_REG))
 		ret = gmu_dev_ops->rpmh_gpu_pwrctrl(adreno_dev,
 			GMU_DCVS_NOHFI, req.freq, req.bw);
+	else if (gmu->hfi.async_dcvs)
+		hfi_dcvs_queue(gmu, &req);
 	else if (test_bit(GMU_HFI_ON, &device->gmu_core.flags))
 		ret = hfi_send_req(gmu, H2F_MSG_GX_BW_PERF_VOTE, &req);
 
@@ -586,6 +588,26 @@ static int gmu_dcvs_set(struct kgsl_device *device,
 	return ret;
 }
 
+/*
+ * gmu_dcvs_done() - Completion callback for asynchronous DCVS votes. It runs
+ * without the device mutex so leave the snapshot to the fault recovery.
+ */
+static void gmu_dcvs_done(struct gmu_device *gmu,
+		struct hfi_gx_bw_perf_vote_cmd *req, int ret)
+{
+	struct kgsl_device *device = gmu->hfi.kgsldev;
+
+	if (!ret)
+		return;
+
+	dev_err_ratelimited(&gmu->pdev->dev,
+		"Failed to set GPU perf idx %d, bw idx %d\n",
+		req->freq, req->bw);
+
+	adreno_set_gpu_fault(ADRENO_DEVICE(device), ADRENO_GMU_FAULT);
+	adreno_dispatcher_schedule(device);
+}
+
 struct rpmh_arc_vals {
 	unsigned int num;
 	uint16_t val[MAX_GX_LEVELS];
@@ -1409,6 +1431,8 @@ static int gmu_probe(struct kgsl_device *device, struct device_node *node)
 
 	tasklet_init(&hfi->tasklet, hfi_receiver, (unsigned long) gmu);
 	hfi->kgsldev = device;
+	hfi->async_dcvs = of_property_read_bool(node, "qcom,gmu-async-dcvs");
+	hfi->dcvs_done = gmu_dcvs_done;
 
 	/* Retrieves GMU/GPU power level configurations*/
 	ret = gmu_pwrlevel_probe(gmu, node);
@@ -1587,6 +1611,8 @@ static int gmu_suspend(struct kgsl_device *device)
 	if (!test_bit(GMU_CLK_ON, &device->gmu_core.flags))
 		return 0;
 
+	hfi_dcvs_flush(gmu);
+
 	/* Pending message in all queues are abandoned */
 	gmu_dev_ops->irq_disable(device);
 	hfi_stop(gmu);
@@ -1736,6 +1762,9 @@ static void gmu_stop(struct kgsl_device *device)
 	if (!test_bit(GMU_CLK_ON, &device->gmu_core.flags))
 		return;
 
+	/* Send the last DCVS vote before the GMU goes down */
+	hfi_dcvs_flush(gmu);
+
 	/* Wait for the lowest idle level we requested */
 	if (gmu_dev_ops->wait_for_lowest_idle &&
 			gmu_dev_ops->wait_for_lowest_idle(adreno_dev))
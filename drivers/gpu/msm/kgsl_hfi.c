@@ -189,6 +189,91 @@ static int hfi_queue_write(struct gmu_device *gmu, uint32_t queue_idx,
 	(((rtype) & 0xFF) << 16) | (((stype) & 0xFF) << 24))
 
 
+static void hfi_dcvs_work(struct work_struct *work)
+{
+	struct kgsl_hfi *hfi = container_of(work, struct kgsl_hfi, dcvs_work);
+	struct gmu_device *gmu = container_of(hfi, struct gmu_device, hfi);
+	struct kgsl_device *device = hfi->kgsldev;
+	struct hfi_gx_bw_perf_vote_cmd req;
+	int ret;
+
+	spin_lock(&hfi->dcvs_lock);
+	if (!hfi->dcvs_pending) {
+		spin_unlock(&hfi->dcvs_lock);
+		return;
+	}
+
+	req = hfi->dcvs_req;
+	hfi->dcvs_pending = false;
+	spin_unlock(&hfi->dcvs_lock);
+
+	/*
+	 * The GMU is stopped only after the worker is flushed, so if HFI is
+	 * off here the vote raced with a failed start. Replay it on the next
+	 * boot instead.
+	 */
+	if (!test_bit(GMU_HFI_ON, &device->gmu_core.flags)) {
+		set_bit(GMU_DCVS_REPLAY, &device->gmu_core.flags);
+		return;
+	}
+
+	ret = hfi_send_req(gmu, H2F_MSG_GX_BW_PERF_VOTE, &req);
+
+	spin_lock(&hfi->dcvs_lock);
+	if (ret)
+		hfi->dcvs_stats.failed++;
+	else
+		hfi->dcvs_stats.acked++;
+	spin_unlock(&hfi->dcvs_lock);
+
+	if (hfi->dcvs_done)
+		hfi->dcvs_done(gmu, &req, ret);
+}
+
+/**
+ * hfi_dcvs_queue() - Queue a DCVS vote to be sent to the GMU asynchronously
+ * @gmu: Pointer to the GMU device
+ * @req: The vote to send
+ *
+ * Only the latest vote matters to the GMU, so a vote that has not been sent
+ * yet is updated in place instead of queueing another message. An index
+ * left at INVALID_DCVS_IDX keeps the value of the pending vote.
+ */
+void hfi_dcvs_queue(struct gmu_device *gmu,
+		struct hfi_gx_bw_perf_vote_cmd *req)
+{
+	struct kgsl_hfi *hfi = &gmu->hfi;
+
+	spin_lock(&hfi->dcvs_lock);
+
+	if (hfi->dcvs_pending) {
+		if (req->freq != INVALID_DCVS_IDX)
+			hfi->dcvs_req.freq = req->freq;
+		if (req->bw != INVALID_DCVS_IDX)
+			hfi->dcvs_req.bw = req->bw;
+		hfi->dcvs_stats.coalesced++;
+	} else {
+		hfi->dcvs_req = *req;
+		hfi->dcvs_pending = true;
+	}
+
+	hfi->dcvs_stats.queued++;
+	spin_unlock(&hfi->dcvs_lock);
+
+	queue_work(system_highpri_wq, &hfi->dcvs_work);
+}
+
+/**
+ * hfi_dcvs_flush() - Wait for the pending asynchronous DCVS vote to be sent
+ * @gmu: Pointer to the GMU device
+ *
+ * Must be called before the GMU is stopped or suspended.
+ */
+void hfi_dcvs_flush(struct gmu_device *gmu)
+{
+	flush_work(&gmu->hfi.dcvs_work);
+}
+
 /* Sizes of the queue and message are in unit of dwords */
 void hfi_init(struct kgsl_hfi *hfi, struct gmu_memdesc *mem_addr,
 		uint32_t queue_sz_bytes)
@@ -246,6 +331,9 @@ void hfi_init(struct kgsl_hfi *hfi, struct gmu_memdesc *mem_addr,
 	}
 
 	mutex_init(&hfi->cmdq_mutex);
+	mutex_init(&hfi->send_mutex);
+	spin_lock_init(&hfi->dcvs_lock);
+	INIT_WORK(&hfi->dcvs_work, hfi_dcvs_work);
 }
 
 #define HDR_CMP_SEQNUM(out_hdr, in_hdr) \
@@ -320,9 +408,12 @@ static int hfi_send_cmd(struct gmu_device *gmu, uint32_t queue_idx,
 
 	ret_cmd->sent_hdr = cmd[0];
 
+	/* Only one sender at a time may wait for an ACK */
+	mutex_lock(&hfi->send_mutex);
+
 	rc = hfi_queue_write(gmu, queue_idx, cmd);
 	if (rc)
-		return rc;
+		goto done;
 
 	rc = poll_adreno_gmu_reg(adreno_dev, ADRENO_REG_GMU_GMU2HOST_INTR_INFO,
 		HFI_IRQ_MSGQ_MASK, HFI_IRQ_MSGQ_MASK, HFI_RSP_TIMEOUT);
@@ -331,7 +422,7 @@ static int hfi_send_cmd(struct gmu_device *gmu, uint32_t queue_idx,
 		dev_err(&gmu->pdev->dev,
 		"Timed out waiting on ack for 0x%8.8x (id %d, sequence %d)\n",
 		cmd[0], MSG_HDR_GET_ID(*cmd), MSG_HDR_GET_SEQNUM(*cmd));
-		return rc;
+		goto done;
 	}
 
 	/* Clear the interrupt */
@@ -340,6 +431,8 @@ static int hfi_send_cmd(struct gmu_device *gmu, uint32_t queue_idx,
 
 	hfi_process_queue(gmu, HFI_MSG_ID, ret_cmd);
 
+done:
+	mutex_unlock(&hfi->send_mutex);
 	return rc;
 }
 
@@ -609,6 +609,23 @@ struct pending_cmd {
 	uint32_t results[MAX_RCVD_SIZE];
 };
 
+struct gmu_device;
+struct gmu_memdesc;
+
+/**
+ * struct hfi_dcvs_stats - counters for asynchronous DCVS votes
+ * @queued: Number of votes handed to the HFI DCVS worker
+ * @coalesced: Number of votes merged into a vote that was still pending
+ * @acked: Number of votes acknowledged by the GMU
+ * @failed: Number of votes that could not be sent or were rejected
+ */
+struct hfi_dcvs_stats {
+	unsigned int queued;
+	unsigned int coalesced;
+	unsigned int acked;
+	unsigned int failed;
+};
+
 /**
  * struct kgsl_hfi - HFI control structure
  * @kgsldev: Point to the kgsl device
@@ -620,6 +637,14 @@ struct pending_cmd {
  *	value of the counter is used as sequence number for HFI message
  * @bwtbl_cmd: HFI BW table buffer
  * @acd_tbl_cmd: HFI table for ACD data
+ * @send_mutex: serializes senders that wait for an ACK on the message queue
+ * @async_dcvs: Send DCVS votes from a worker instead of the caller
+ * @dcvs_work: Worker that sends the pending DCVS vote
+ * @dcvs_lock: Protects @dcvs_req, @dcvs_pending and @dcvs_stats
+ * @dcvs_req: The latest DCVS vote that has not been sent yet
+ * @dcvs_pending: True if @dcvs_req holds a vote
+ * @dcvs_done: Called from the worker once the GMU acked or rejected a vote
+ * @dcvs_stats: Counters for asynchronous DCVS votes
  */
 struct kgsl_hfi {
 	struct kgsl_device *kgsldev;
@@ -630,11 +655,17 @@ struct kgsl_hfi {
 	atomic_t seqnum;
 	struct hfi_bwtable_cmd bwtbl_cmd;
 	struct hfi_acd_table_cmd acd_tbl_cmd;
+	struct mutex send_mutex;
+	bool async_dcvs;
+	struct work_struct dcvs_work;
+	spinlock_t dcvs_lock;
+	struct hfi_gx_bw_perf_vote_cmd dcvs_req;
+	bool dcvs_pending;
+	void (*dcvs_done)(struct gmu_device *gmu,
+		struct hfi_gx_bw_perf_vote_cmd *req, int ret);
+	struct hfi_dcvs_stats dcvs_stats;
 };
 
-struct gmu_device;
-struct gmu_memdesc;
-
 irqreturn_t hfi_irq_handler(int irq, void *data);
 int hfi_start(struct kgsl_device *device, struct gmu_device *gmu,
 		uint32_t boot_state);
@@ -645,4 +676,7 @@ void hfi_init(struct kgsl_hfi *hfi, struct gmu_memdesc *mem_addr,
 
 /* hfi_send_req is only for external (to HFI) requests */
 int hfi_send_req(struct gmu_device *gmu, unsigned int id, void *data);
+void hfi_dcvs_queue(struct gmu_device *gmu,
+		struct hfi_gx_bw_perf_vote_cmd *req);
+void hfi_dcvs_flush(struct gmu_device *gmu);
 #endif  /* __KGSL_HFI_H */
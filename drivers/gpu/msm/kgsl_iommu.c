@@ -796,6 +796,65 @@ static struct kgsl_process_private *kgsl_iommu_get_process(u64 ptbase)
 	return p;
 }
 
+/*
+ * Granule populated on a GPU fault in a lazy buffer. Faulting in more than a
+ * single page keeps the number of stalls down for linear access patterns.
+ */
+#define KGSL_LAZY_FAULT_SIZE SZ_64K
+
+/*
+ * Back the faulting region of a lazily populated buffer and retry the stalled
+ * transaction. Return true if the fault was handled.
+ */
+static bool _iommu_lazy_fault(struct kgsl_iommu_context *ctx,
+		struct kgsl_process_private *private, unsigned long addr,
+		int flags)
+{
+	struct kgsl_mem_entry *entry;
+	struct kgsl_memdesc *memdesc;
+	uint64_t offset, start, end;
+	int ret = -EINVAL;
+
+	if (private == NULL)
+		return false;
+
+	entry = kgsl_sharedmem_find(private, (uint64_t) addr);
+	if (entry == NULL)
+		return false;
+
+	memdesc = &entry->memdesc;
+
+	if (memdesc->priv & KGSL_MEMDESC_LAZY) {
+		offset = addr - memdesc->gpuaddr;
+		ret = kgsl_sharedmem_lazy_populate(memdesc, offset);
+
+		/* The rest of the granule is opportunistic */
+		start = ALIGN_DOWN(offset, KGSL_LAZY_FAULT_SIZE);
+		end = min_t(uint64_t, start + KGSL_LAZY_FAULT_SIZE,
+			memdesc->size);
+		for (; !ret && start < end; start += PAGE_SIZE)
+			if (kgsl_sharedmem_lazy_populate(memdesc, start))
+				break;
+	}
+
+	kgsl_mem_entry_put_deferred(entry);
+
+	if (ret)
+		return false;
+
+	if (flags & IOMMU_FAULT_TRANSACTION_STALLED) {
+		KGSL_IOMMU_SET_CTX_REG(ctx, FSR, 0xffffffff);
+		/* Make sure the FSR is cleared before resuming */
+		wmb();
+
+		/* Write 0 to RESUME.TnR to retry the stalled transaction */
+		KGSL_IOMMU_SET_CTX_REG(ctx, RESUME, 0);
+		wmb();
+	}
+
+	return true;
+}
+
 static int kgsl_iommu_fault_handler(struct iommu_domain *domain,
 	struct device *dev, unsigned long addr, int flags, void *token)
 {
@@ -846,6 +905,17 @@ static int kgsl_iommu_fault_handler(struct iommu_domain *domain,
 	if (private)
 		pid = pid_nr(private->pid);
 
+	/*
+	 * A translation fault in a lazy buffer is expected. Back the page and
+	 * let the GPU carry on. Return -EBUSY for stalled faults so the SMMU
+	 * driver doesn't terminate the transaction we just retried.
+	 */
+	if ((flags & IOMMU_FAULT_TRANSLATION) &&
+		_iommu_lazy_fault(ctx, private, addr, flags)) {
+		kgsl_process_private_put(private);
+		return (flags & IOMMU_FAULT_TRANSACTION_STALLED) ? -EBUSY : 0;
+	}
+
 	if (kgsl_iommu_suppress_pagefault(addr, write, private)) {
 		iommu->pagefault_suppression_count++;
 		kgsl_process_private_put(private);
@@ -1786,12 +1856,35 @@ kgsl_iommu_unmap_offset(struct kgsl_pagetable *pt,
 	return _iommu_unmap_sync_pc(pt, addr + offset, size);
 }
 
+/* Lazy buffers only have their populated pages and the padding mapped */
+static int _iommu_unmap_lazy(struct kgsl_pagetable *pt,
+		struct kgsl_memdesc *memdesc)
+{
+	uint64_t pad_size = kgsl_memdesc_footprint(memdesc) - memdesc->size;
+	unsigned int i;
+
+	for (i = 0; i < (memdesc->size >> PAGE_SHIFT); i++)
+		if (memdesc->pages[i])
+			_iommu_unmap_sync_pc(pt,
+				memdesc->gpuaddr + ((uint64_t) i << PAGE_SHIFT),
+				PAGE_SIZE);
+
+	if (pad_size)
+		return _iommu_unmap_sync_pc(pt,
+			memdesc->gpuaddr + memdesc->size, pad_size);
+
+	return 0;
+}
+
 static int
 kgsl_iommu_unmap(struct kgsl_pagetable *pt, struct kgsl_memdesc *memdesc)
 {
 	if (memdesc->size == 0 || memdesc->gpuaddr == 0)
 		return -EINVAL;
 
+	if (memdesc->priv & KGSL_MEMDESC_LAZY)
+		return _iommu_unmap_lazy(pt, memdesc);
+
 	return kgsl_iommu_unmap_offset(pt, memdesc, memdesc->gpuaddr, 0,
 			kgsl_memdesc_footprint(memdesc));
 }
@@ -1887,6 +1980,50 @@ static unsigned int _get_protection_flags(struct kgsl_pagetable *pt,
 	return flags;
 }
 
+/*
+ * Lazy buffers only get the pages that are already backed (normally none)
+ * mapped up front. The rest is mapped from the fault handler.
+ */
+static int _iommu_map_lazy(struct kgsl_pagetable *pt,
+		struct kgsl_memdesc *memdesc, unsigned int flags)
+{
+	unsigned int i;
+	int ret = 0;
+
+	for (i = 0; i < (memdesc->size >> PAGE_SHIFT); i++) {
+		if (!memdesc->pages[i])
+			continue;
+
+		ret = _iommu_map_single_page_sync_pc(pt,
+			memdesc->gpuaddr + ((uint64_t) i << PAGE_SHIFT),
+			page_to_phys(memdesc->pages[i]), 1, flags);
+		if (ret)
+			break;
+	}
+
+	if (!ret)
+		ret = _iommu_map_guard_page(pt, memdesc,
+			memdesc->gpuaddr + memdesc->size, flags);
+
+	if (ret) {
+		while (i--)
+			if (memdesc->pages[i])
+				_iommu_unmap_sync_pc(pt, memdesc->gpuaddr +
+					((uint64_t) i << PAGE_SHIFT),
+					PAGE_SIZE);
+	}
+
+	return ret;
+}
+
+static int kgsl_iommu_map_page(struct kgsl_pagetable *pt,
+		struct kgsl_memdesc *memdesc, uint64_t offset,
+		struct page *page)
+{
+	return _iommu_map_single_page_sync_pc(pt, memdesc->gpuaddr + offset,
+		page_to_phys(page), 1, _get_protection_flags(pt, memdesc));
+}
+
 static int
 kgsl_iommu_map(struct kgsl_pagetable *pt,
 			struct kgsl_memdesc *memdesc)
@@ -1897,6 +2034,9 @@ kgsl_iommu_map(struct kgsl_pagetable *pt,
 	unsigned int flags = _get_protection_flags(pt, memdesc);
 	struct sg_table *sgt = NULL;
 
+	if (memdesc->priv & KGSL_MEMDESC_LAZY)
+		return _iommu_map_lazy(pt, memdesc, flags);
+
 	/*
 	 * For paged memory allocated through kgsl, memdesc->pages is not NULL.
 	 * Allocate sgt here just for its map operation. Contiguous memory
@@ -2905,4 +3045,5 @@ static struct kgsl_mmu_pt_ops iommu_pt_ops = {
 	.mmu_map_offset = kgsl_iommu_map_offset,
 	.mmu_unmap_offset = kgsl_iommu_unmap_offset,
 	.mmu_sparse_dummy_map = kgsl_iommu_sparse_dummy_map,
+	.mmu_map_page = kgsl_iommu_map_page,
 };
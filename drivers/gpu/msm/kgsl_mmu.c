@@ -558,6 +558,28 @@ int kgsl_mmu_unmap_offset(struct kgsl_pagetable *pagetable,
 }
 EXPORT_SYMBOL(kgsl_mmu_unmap_offset);
 
+/**
+ * kgsl_mmu_map_page() - Map a single page into a lazily backed memdesc
+ * @pagetable: Pagetable the memdesc is mapped in
+ * @memdesc: Lazily backed memory descriptor
+ * @offset: Byte offset of the page in the memdesc
+ * @page: Page to map
+ *
+ * The address range is already accounted to the pagetable when the memdesc
+ * is mapped so this doesn't touch the pagetable stats.
+ */
+int kgsl_mmu_map_page(struct kgsl_pagetable *pagetable,
+		struct kgsl_memdesc *memdesc, uint64_t offset,
+		struct page *page)
+{
+	if (PT_OP_VALID(pagetable, mmu_map_page))
+		return pagetable->pt_ops->mmu_map_page(pagetable, memdesc,
+			offset, page);
+
+	return -EOPNOTSUPP;
+}
+EXPORT_SYMBOL(kgsl_mmu_map_page);
+
 int kgsl_mmu_sparse_dummy_map(struct kgsl_pagetable *pagetable,
 		struct kgsl_memdesc *memdesc, uint64_t offset, uint64_t size)
 {
@@ -16,6 +16,10 @@
 #include <linux/slab.h>
 #include <linux/highmem.h>
 #include <linux/version.h>
+#include <linux/freezer.h>
+#include <linux/kthread.h>
+#include <linux/alloc_bench.h>
+#include <uapi/linux/sched/types.h>
 
 #include "kgsl.h"
 #include "kgsl_device.h"
@@ -24,6 +28,7 @@
 #define KGSL_MAX_POOLS 4
 #define KGSL_MAX_POOL_ORDER 8
 #define KGSL_MAX_RESERVED_PAGES 4096
+#define KGSL_POOL_ZERO_BATCH 16
 
 /**
  * struct kgsl_page_pool - Structure to hold information for the pool
@@ -33,7 +38,8 @@
  * @allocation_allowed: Tells if reserved pool gets exhausted, can we allocate
  * from system memory
  * @list_lock: Spinlock for page list in the pool
- * @page_list: List of pages held/reserved in this pool
+ * @page_list: List of pages held/reserved in this pool that still need zeroing
+ * @zeroed_list: List of pages already zeroed and synced by the zero thread
  */
 struct kgsl_page_pool {
 	unsigned int pool_order;
@@ -42,12 +48,18 @@ struct kgsl_page_pool {
 	bool allocation_allowed;
 	spinlock_t list_lock;
 	struct llist_head page_list;
+	struct llist_head zeroed_list;
 };
 
 static struct kgsl_page_pool kgsl_pools[KGSL_MAX_POOLS];
 static int kgsl_num_pools;
 static int kgsl_pool_max_pages;
 
+/* Background thread that zeroes pool pages off the allocation path */
+static struct task_struct *kgsl_pool_zero_thread;
+static DECLARE_WAIT_QUEUE_HEAD(kgsl_pool_zero_wq);
+static struct device *kgsl_pool_dev;
+
 
 /* Returns KGSL pool corresponding to input page order*/
 static struct kgsl_page_pool *
@@ -103,17 +115,26 @@ _kgsl_pool_add_page(struct kgsl_page_pool *pool, struct page *p)
 	atomic_inc(&pool->page_count);
 	mod_node_page_state(page_pgdat(p), NR_KERNEL_MISC_RECLAIMABLE,
 				(1 << pool->pool_order));
+
+	if (kgsl_pool_zero_thread)
+		wake_up(&kgsl_pool_zero_wq);
 }
 
-/* Returns a page from specified pool */
+/*
+ * Returns a page from specified pool, preferring pages the zero thread has
+ * already cleared. @zeroed tells the caller whether it still has to zero it.
+ */
 static struct page *
-_kgsl_pool_get_page(struct kgsl_page_pool *pool)
+_kgsl_pool_get_page(struct kgsl_page_pool *pool, bool *zeroed)
 {
 	struct llist_node *node;
 	struct page *p = NULL;
 
 	spin_lock(&pool->list_lock);
-	node = llist_del_first(&pool->page_list);
+	node = llist_del_first(&pool->zeroed_list);
+	*zeroed = node != NULL;
+	if (!node)
+		node = llist_del_first(&pool->page_list);
 	spin_unlock(&pool->list_lock);
 
 	if (node) {
@@ -126,6 +147,84 @@ _kgsl_pool_get_page(struct kgsl_page_pool *pool)
 	return p;
 }
 
+/*
+ * Zero up to KGSL_POOL_ZERO_BATCH dirty pages of a pool and move them to the
+ * zeroed list. Cache maintenance is done with one sync for the whole batch.
+ * Pages stay accounted in page_count while the thread holds them.
+ */
+static int kgsl_pool_zero_batch(struct kgsl_page_pool *pool)
+{
+	struct scatterlist sgl[KGSL_POOL_ZERO_BATCH];
+	struct page *pages[KGSL_POOL_ZERO_BATCH];
+	struct llist_node *node;
+	int i, j, n = 0;
+
+	spin_lock(&pool->list_lock);
+	while (n < KGSL_POOL_ZERO_BATCH) {
+		node = llist_del_first(&pool->page_list);
+		if (!node)
+			break;
+		pages[n++] = container_of((struct list_head *)node,
+					struct page, lru);
+	}
+	spin_unlock(&pool->list_lock);
+
+	if (!n)
+		return 0;
+
+	sg_init_table(sgl, n);
+	for (i = 0; i < n; i++) {
+		for (j = 0; j < (1 << pool->pool_order); j++)
+			clear_highpage(nth_page(pages[i], j));
+
+		sg_set_page(&sgl[i], pages[i], PAGE_SIZE << pool->pool_order,
+				0);
+		sg_dma_address(&sgl[i]) = page_to_phys(pages[i]);
+	}
+
+	if (kgsl_pool_dev)
+		dma_sync_sg_for_device(kgsl_pool_dev, sgl, n,
+				DMA_BIDIRECTIONAL);
+
+	for (i = 0; i < n; i++)
+		llist_add((struct llist_node *)&pages[i]->lru,
+				&pool->zeroed_list);
+
+	return n;
+}
+
+static bool kgsl_pool_has_dirty_pages(void)
+{
+	int i;
+
+	for (i = 0; i < kgsl_num_pools; i++)
+		if (!llist_empty(&kgsl_pools[i].page_list))
+			return true;
+
+	return false;
+}
+
+static int kgsl_pool_zero_fn(void *data)
+{
+	static const struct sched_param param = { .sched_priority = 0 };
+	int i;
+
+	sched_setscheduler_nocheck(current, SCHED_IDLE, &param);
+	set_freezable();
+
+	while (!kthread_should_stop()) {
+		wait_event_freezable(kgsl_pool_zero_wq,
+			kgsl_pool_has_dirty_pages() || kthread_should_stop());
+
+		for (i = 0; i < kgsl_num_pools; i++) {
+			while (kgsl_pool_zero_batch(&kgsl_pools[i]))
+				cond_resched();
+		}
+	}
+
+	return 0;
+}
+
 /* Returns the number of pages in specified pool */
 static int
 kgsl_pool_size(struct kgsl_page_pool *pool)
@@ -158,7 +257,8 @@ _kgsl_pool_shrink(struct kgsl_page_pool *pool, int num_pages)
 		return pcount;
 
 	for (j = 0; j < num_pages >> pool->pool_order; j++) {
-		struct page *page = _kgsl_pool_get_page(pool);
+		bool zeroed;
+		struct page *page = _kgsl_pool_get_page(pool, &zeroed);
 
 		if (page != NULL) {
 			__free_pages(page, pool->pool_order);
@@ -256,15 +356,11 @@ void kgsl_pool_free_sgt(struct sg_table *sgt)
 	}
 }
 
-/**
- * kgsl_pool_free_pages() - Free pages in the pages array
- * @pages: pointer of the pages array
- *
- * Free the pages by collapsing any physical adjacent pages.
- * Pages are added back to the pool, if pool has sufficient space
- * otherwise they are given back to system.
- */
-void kgsl_pool_free_pages(struct page **pages, unsigned int pcount)
+static void _kgsl_pool_free_page(struct page *page, bool to_pool);
+
+/* Free each page of the array, to the pool if @to_pool allows it */
+static void _kgsl_pool_free_pages(struct page **pages, unsigned int pcount,
+		bool to_pool)
 {
 	int i;
 
@@ -286,9 +382,34 @@ void kgsl_pool_free_pages(struct page **pages, unsigned int pcount)
 			return;
 
 		i += 1 << compound_order(p);
-		kgsl_pool_free_page(p);
+		_kgsl_pool_free_page(p, to_pool);
 	}
 }
+
+/**
+ * kgsl_pool_free_pages() - Free pages in the pages array
+ * @pages: pointer of the pages array
+ *
+ * Free the pages by collapsing any physical adjacent pages.
+ * Pages are added back to the pool, if pool has sufficient space
+ * otherwise they are given back to system.
+ */
+void kgsl_pool_free_pages(struct page **pages, unsigned int pcount)
+{
+	_kgsl_pool_free_pages(pages, pcount, true);
+}
+
+/**
+ * kgsl_pool_release_pages() - Give the pages in the pages array to the system
+ * @pages: pointer of the pages array
+ *
+ * Like kgsl_pool_free_pages() but the pages always bypass the pool, for
+ * memory of processes that were killed to free memory.
+ */
+void kgsl_pool_release_pages(struct page **pages, unsigned int pcount)
+{
+	_kgsl_pool_free_pages(pages, pcount, false);
+}
 static int kgsl_pool_idx_lookup(unsigned int order)
 {
 	int i;
@@ -331,6 +452,7 @@ int kgsl_pool_alloc_page(int *page_size, struct page **pages,
 	int order = get_order(*page_size);
 	int pool_idx;
 	size_t size = 0;
+	bool zeroed = false;
 
 	if ((pages == NULL) || pages_len < (*page_size >> PAGE_SHIFT))
 		return -EINVAL;
@@ -373,7 +495,7 @@ int kgsl_pool_alloc_page(int *page_size, struct page **pages,
 	}
 
 	pool_idx = kgsl_pool_idx_lookup(order);
-	page = _kgsl_pool_get_page(pool);
+	page = _kgsl_pool_get_page(pool, &zeroed);
 
 	/* Allocate a new page if not allocated from pool */
 	if (page == NULL) {
@@ -400,7 +522,9 @@ int kgsl_pool_alloc_page(int *page_size, struct page **pages,
 	}
 
 done:
-	_kgsl_pool_zero_page(page, order, dev);
+	/* Pages from the zeroed list were cleared and synced in the background */
+	if (!zeroed)
+		_kgsl_pool_zero_page(page, order, dev);
 
 	for (j = 0; j < (*page_size >> PAGE_SHIFT); j++) {
 		p = nth_page(page, j);
@@ -419,7 +543,45 @@ int kgsl_pool_alloc_page(int *page_size, struct page **pages,
 	return -EAGAIN;
 }
 
-void kgsl_pool_free_page(struct page *page)
+/**
+ * kgsl_pool_alloc_large_page() - Allocate a physically contiguous chunk
+ * @page_size: Size of the chunk, a power of two pages
+ * @pages: pointer to hold list of pages, should be big enough to hold
+ * requested chunk
+ * @pages_len: Length of array pages
+ * @dev: device to sync the zeroed chunk for
+ *
+ * Unlike kgsl_pool_alloc_page() this does not depend on a pool of the
+ * requested order being configured and does not retry with lower orders;
+ * the caller is expected to fall back to kgsl_pool_alloc_page().
+ *
+ * Return total page count on success and negative value on failure
+ */
+int kgsl_pool_alloc_large_page(int page_size, struct page **pages,
+			unsigned int pages_len, struct device *dev)
+{
+	int order = get_order(page_size);
+	struct page *page;
+	int j;
+
+	if ((pages == NULL) || pages_len < (page_size >> PAGE_SHIFT))
+		return -EINVAL;
+
+	page = alloc_pages(kgsl_gfp_mask(order), order);
+	if (page == NULL)
+		return -ENOMEM;
+
+	_kgsl_pool_zero_page(page, order, dev);
+
+	for (j = 0; j < (page_size >> PAGE_SHIFT); j++)
+		pages[j] = nth_page(page, j);
+
+	mod_node_page_state(page_pgdat(page), NR_UNRECLAIMABLE_PAGES,
+					(1 << order));
+	return j;
+}
+
+static void _kgsl_pool_free_page(struct page *page, bool to_pool)
 {
 	struct kgsl_page_pool *pool;
 	int page_order;
@@ -432,8 +594,8 @@ void kgsl_pool_free_page(struct page *page)
 	mod_node_page_state(page_pgdat(page), NR_UNRECLAIMABLE_PAGES,
 					-(1 << page_order));
 
-	if (!kgsl_pool_max_pages ||
-			(kgsl_pool_size_total() < kgsl_pool_max_pages)) {
+	if (to_pool && (!kgsl_pool_max_pages ||
+			(kgsl_pool_size_total() < kgsl_pool_max_pages))) {
 		pool = _kgsl_get_pool_from_order(page_order);
 		if (pool != NULL) {
 			_kgsl_pool_add_page(pool, page);
@@ -445,6 +607,11 @@ void kgsl_pool_free_page(struct page *page)
 	__free_pages(page, page_order);
 }
 
+void kgsl_pool_free_page(struct page *page)
+{
+	_kgsl_pool_free_page(page, true);
+}
+
 /*
  * Return true if the pool of specified page size is supported
  * or no pools are supported otherwise return false.
@@ -481,6 +648,26 @@ static void kgsl_pool_reserve_pages(void)
 	}
 }
 
+/**
+ * kgsl_pool_reclaim() - Give pool pages back to the system
+ * @nr_pages: Number of pages to release
+ *
+ * Lets the low memory killer and other page pools take the cached GPU pages
+ * before they resort to killing processes. Reserved pools are left alone,
+ * as they are for the shrinker.
+ *
+ * Return the number of pages released
+ */
+unsigned long kgsl_pool_reclaim(unsigned long nr_pages)
+{
+	int total_pages = kgsl_pool_size_total();
+	int target_pages = (nr_pages > total_pages) ? 0 :
+		(total_pages - nr_pages);
+
+	return kgsl_pool_reduce(target_pages, false);
+}
+EXPORT_SYMBOL(kgsl_pool_reclaim);
+
 /* Functions for the shrinker */
 
 static unsigned long
@@ -536,6 +723,7 @@ static void kgsl_pool_config(unsigned int order, unsigned int reserved_pages,
 	kgsl_pools[kgsl_num_pools].allocation_allowed = allocation_allowed;
 	spin_lock_init(&kgsl_pools[kgsl_num_pools].list_lock);
 	init_llist_head(&kgsl_pools[kgsl_num_pools].page_list);
+	init_llist_head(&kgsl_pools[kgsl_num_pools].zeroed_list);
 	kgsl_num_pools++;
 }
 
@@ -582,21 +770,72 @@ static void kgsl_of_get_mempools(struct device_node *parent)
 	}
 }
 
+#ifdef CONFIG_TEST_ALLOC_BENCH
+/* Allocate one chunk of up to 64K the way sharedmem fills a buffer */
+static unsigned long kgsl_pool_bench_alloc(void *ctx, size_t size)
+{
+	struct page *pages[SZ_64K >> PAGE_SHIFT];
+	unsigned int align = ilog2(size);
+	int page_size = kgsl_get_page_size(PAGE_ALIGN(size), align);
+	int ret;
+
+	do {
+		ret = kgsl_pool_alloc_page(&page_size, pages,
+				ARRAY_SIZE(pages), &align, kgsl_pool_dev);
+	} while (ret == -EAGAIN);
+
+	return ret > 0 ? (unsigned long)pages[0] : 0;
+}
+
+static void kgsl_pool_bench_free(void *ctx, unsigned long handle)
+{
+	kgsl_pool_free_page((struct page *)handle);
+}
+
+static struct alloc_bench_ops kgsl_pool_bench_ops = {
+	.name = "kgsl",
+	.max_size = SZ_64K,
+	.alloc = kgsl_pool_bench_alloc,
+	.free = kgsl_pool_bench_free,
+};
+#endif
+
 void kgsl_init_page_pools(struct platform_device *pdev)
 {
 
 	/* Get GPU mempools data and configure pools */
 	kgsl_of_get_mempools(pdev->dev.of_node);
 
+	kgsl_pool_dev = &pdev->dev;
+	if (kgsl_num_pools) {
+		kgsl_pool_zero_thread = kthread_run(kgsl_pool_zero_fn, NULL,
+				"kgsl_pool_zero");
+		if (IS_ERR(kgsl_pool_zero_thread))
+			kgsl_pool_zero_thread = NULL;
+	}
+
 	/* Reserve the appropriate number of pages for each pool */
 	kgsl_pool_reserve_pages();
 
 	/* Initialize shrinker */
 	register_shrinker(&kgsl_pool_shrinker);
+
+#ifdef CONFIG_TEST_ALLOC_BENCH
+	alloc_bench_register(&kgsl_pool_bench_ops);
+#endif
 }
 
 void kgsl_exit_page_pools(void)
 {
+#ifdef CONFIG_TEST_ALLOC_BENCH
+	alloc_bench_unregister(&kgsl_pool_bench_ops);
+#endif
+
+	if (kgsl_pool_zero_thread) {
+		kthread_stop(kgsl_pool_zero_thread);
+		kgsl_pool_zero_thread = NULL;
+	}
+
 	/* Release all pages in pools, if any.*/
 	kgsl_pool_reduce(0, true);
 
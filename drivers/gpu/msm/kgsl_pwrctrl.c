@@ -1471,6 +1471,74 @@ static ssize_t kgsl_pwrctrl_pwrscale_show(struct device *dev,
 	return snprintf(buf, PAGE_SIZE, "%u\n", psc->enabled);
 }
 
+static ssize_t kgsl_pwrctrl_frame_target_us_store(struct device *dev,
+					   struct device_attribute *attr,
+					   const char *buf, size_t count)
+{
+	struct kgsl_device *device = kgsl_device_from_dev(dev);
+	struct kgsl_pwrscale *psc;
+	unsigned int target = 0;
+	int ret;
+
+	if (device == NULL)
+		return 0;
+	psc = &device->pwrscale;
+
+	ret = kgsl_sysfs_store(buf, &target);
+	if (ret)
+		return ret;
+
+	mutex_lock(&device->mutex);
+	psc->frame_target_us = target;
+	psc->frame_cycles = 0;
+	psc->frame_est_cycles = 0;
+	psc->frame_last = 0;
+	memset(psc->frame_stats, 0, sizeof(psc->frame_stats));
+	mutex_unlock(&device->mutex);
+
+	return count;
+}
+
+static ssize_t kgsl_pwrctrl_frame_target_us_show(struct device *dev,
+					  struct device_attribute *attr,
+					  char *buf)
+{
+	struct kgsl_device *device = kgsl_device_from_dev(dev);
+
+	if (device == NULL)
+		return 0;
+
+	return snprintf(buf, PAGE_SIZE, "%u\n",
+			device->pwrscale.frame_target_us);
+}
+
+static ssize_t kgsl_pwrctrl_frame_stats_show(struct device *dev,
+					struct device_attribute *attr,
+					char *buf)
+{
+	struct kgsl_device *device = kgsl_device_from_dev(dev);
+	struct kgsl_pwrctrl *pwr;
+	int index, num_chars = 0;
+
+	if (device == NULL)
+		return 0;
+
+	pwr = &device->pwrctrl;
+	mutex_lock(&device->mutex);
+	for (index = 0; index < pwr->num_pwrlevels - 1; index++) {
+		struct kgsl_frame_stats *stats =
+			&device->pwrscale.frame_stats[index];
+
+		num_chars += scnprintf(buf + num_chars,
+			PAGE_SIZE - num_chars, "%u %llu %llu\n",
+			pwr->pwrlevels[index].gpu_freq / 1000000,
+			stats->frames, stats->misses);
+	}
+	mutex_unlock(&device->mutex);
+
+	return num_chars;
+}
+
 static DEVICE_ATTR(temp, 0444, kgsl_pwrctrl_temp_show, NULL);
 static DEVICE_ATTR(gpuclk, 0644, kgsl_pwrctrl_gpuclk_show,
 	kgsl_pwrctrl_gpuclk_store);
@@ -1532,6 +1600,11 @@ static DEVICE_ATTR(freq_table_mhz, 0444,
 static DEVICE_ATTR(pwrscale, 0644,
 	kgsl_pwrctrl_pwrscale_show,
 	kgsl_pwrctrl_pwrscale_store);
+static DEVICE_ATTR(frame_target_us, 0644,
+	kgsl_pwrctrl_frame_target_us_show,
+	kgsl_pwrctrl_frame_target_us_store);
+static DEVICE_ATTR(frame_stats, 0444,
+	kgsl_pwrctrl_frame_stats_show, NULL);
 
 static const struct device_attribute *pwrctrl_attr_list[] = {
 	&dev_attr_gpuclk,
@@ -1559,6 +1632,8 @@ static const struct device_attribute *pwrctrl_attr_list[] = {
 	&dev_attr_freq_table_mhz,
 	&dev_attr_temp,
 	&dev_attr_pwrscale,
+	&dev_attr_frame_target_us,
+	&dev_attr_frame_stats,
 	NULL
 };
 
@@ -15,6 +15,7 @@
 #include <linux/kernel.h>
 #include <linux/hrtimer.h>
 #include <linux/devfreq_cooling.h>
+#include <linux/devfreq_boost.h>
 #include <linux/pm_opp.h>
 
 #include "kgsl.h"
@@ -37,6 +38,7 @@ static struct kgsl_midframe_info {
 static void do_devfreq_suspend(struct work_struct *work);
 static void do_devfreq_resume(struct work_struct *work);
 static void do_devfreq_notify(struct work_struct *work);
+static void do_frame_dcvs(struct work_struct *work);
 
 /*
  * These variables are used to keep the latest data
@@ -79,6 +81,7 @@ void kgsl_pwrscale_wake(struct kgsl_device *device)
 	/* clear old stats before waking */
 	memset(&psc->accum_stats, 0, sizeof(psc->accum_stats));
 	memset(&last_xstats, 0, sizeof(last_xstats));
+	psc->frame_cycles = 0;
 
 	/* and any hw activity from waking up*/
 	device->ftbl->power_stats(device, &stats);
@@ -135,6 +138,10 @@ void kgsl_pwrscale_update_stats(struct kgsl_device *device)
 		device->pwrscale.accum_stats.ram_wait += stats.ram_wait;
 		pwrctrl->clock_times[pwrctrl->active_pwrlevel] +=
 				stats.busy_time;
+		if (psc->frame_target_us)
+			psc->frame_cycles += div_u64(stats.busy_time *
+				pwrctrl->pwrlevels[pwrctrl->active_pwrlevel].gpu_freq,
+				USEC_PER_SEC);
 	}
 }
 EXPORT_SYMBOL(kgsl_pwrscale_update_stats);
@@ -172,6 +179,89 @@ void kgsl_pwrscale_update(struct kgsl_device *device)
 }
 EXPORT_SYMBOL(kgsl_pwrscale_update);
 
+/**
+ * kgsl_pwrscale_frame_end() - note that a frame has been retired
+ * @device: The device
+ *
+ * Called by the dispatcher when a drawobj marked as the end of a frame
+ * retires. Level selection is deferred to frame_ws since this is called
+ * without the device mutex.
+ */
+void kgsl_pwrscale_frame_end(struct kgsl_device *device)
+{
+	struct kgsl_pwrscale *psc = &device->pwrscale;
+
+	if (!psc->enabled || !READ_ONCE(psc->frame_target_us))
+		return;
+
+	atomic_inc(&psc->frame_pending);
+	queue_work(psc->devfreq_wq, &psc->frame_ws);
+}
+EXPORT_SYMBOL(kgsl_pwrscale_frame_end);
+
+/*
+ * Frame aware DCVS owns the clock as long as frames keep arriving; once they
+ * stop (screen static, app in background) the devfreq governor is back in
+ * charge.
+ */
+static bool _frame_dcvs_active(struct kgsl_pwrscale *psc)
+{
+	if (!psc->frame_target_us || !psc->frame_last)
+		return false;
+
+	return ktime_ms_delta(ktime_get(), psc->frame_last) < KGSL_FRAME_TIMEOUT;
+}
+
+static void do_frame_dcvs(struct work_struct *work)
+{
+	struct kgsl_pwrscale *psc = container_of(work,
+			struct kgsl_pwrscale, frame_ws);
+	struct kgsl_device *device = container_of(psc,
+			struct kgsl_device, pwrscale);
+	struct kgsl_pwrctrl *pwr = &device->pwrctrl;
+	struct kgsl_frame_stats *stats;
+	unsigned int target, frames, level, freq;
+	u64 cycles, budget, req;
+
+	mutex_lock(&device->mutex);
+
+	frames = atomic_xchg(&psc->frame_pending, 0);
+	target = psc->frame_target_us;
+	if (!psc->enabled || !target || !frames ||
+			device->state != KGSL_STATE_ACTIVE)
+		goto out;
+
+	/* Pick up the busy time of the frame that just retired */
+	kgsl_pwrscale_update_stats(device);
+	cycles = div_u64(psc->frame_cycles, frames);
+	psc->frame_cycles = 0;
+
+	level = pwr->active_pwrlevel;
+	freq = pwr->pwrlevels[level].gpu_freq;
+	stats = &psc->frame_stats[level];
+	stats->frames += frames;
+	if (freq && div_u64(cycles * USEC_PER_SEC, freq) > target)
+		stats->misses += frames;
+
+	/* React to heavier frames at once, decay slowly for lighter ones */
+	if (cycles > psc->frame_est_cycles)
+		psc->frame_est_cycles = cycles;
+	else
+		psc->frame_est_cycles -= (psc->frame_est_cycles - cycles) >> 2;
+
+	/* Lowest frequency that finishes the estimated work in budget */
+	budget = div_u64((u64)target * KGSL_FRAME_HEADROOM, 100);
+	req = div64_u64(psc->frame_est_cycles * USEC_PER_SEC, max(budget, 1ULL));
+	for (level = pwr->min_pwrlevel; level > pwr->max_pwrlevel; level--)
+		if (pwr->pwrlevels[level].gpu_freq >= req)
+			break;
+
+	psc->frame_last = ktime_get();
+	kgsl_pwrctrl_pwrlevel_change(device, level);
+out:
+	mutex_unlock(&device->mutex);
+}
+
 void kgsl_pwrscale_midframe_timer_restart(struct kgsl_device *device)
 {
 	if (kgsl_midframe) {
@@ -334,6 +424,10 @@ int kgsl_devfreq_target(struct device *dev, unsigned long *freq, u32 flags)
 
 	mutex_lock(&device->mutex);
 	cur_freq = kgsl_pwrctrl_active_freq(pwr);
+
+	/* Frame aware DCVS is picking the level, ignore the governor */
+	if (_frame_dcvs_active(&device->pwrscale))
+		rec_freq = cur_freq;
 	level = pwr->active_pwrlevel;
 	pwr_level = &pwr->pwrlevels[level];
 
@@ -761,6 +855,7 @@ int kgsl_pwrscale_init(struct device *dev, const char *governor)
 	}
 
 	pwrscale->devfreqptr = devfreq;
+	devfreq_register_boost_device(DEVFREQ_GPU, devfreq);
 	pwrscale->cooling_dev = of_devfreq_cooling_register(
 					device->pdev->dev.of_node, devfreq);
 	if (IS_ERR(pwrscale->cooling_dev))
@@ -785,6 +880,7 @@ int kgsl_pwrscale_init(struct device *dev, const char *governor)
 	INIT_WORK(&pwrscale->devfreq_suspend_ws, do_devfreq_suspend);
 	INIT_WORK(&pwrscale->devfreq_resume_ws, do_devfreq_resume);
 	INIT_WORK(&pwrscale->devfreq_notify_ws, do_devfreq_notify);
+	INIT_WORK(&pwrscale->frame_ws, do_frame_dcvs);
 	if (kgsl_midframe)
 		INIT_WORK(&kgsl_midframe->timer_check_ws,
 				kgsl_pwrscale_midframe_timer_check);
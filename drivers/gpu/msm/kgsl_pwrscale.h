@@ -33,6 +33,23 @@
  */
 #define STABLE_TIME	150
 
+/*
+ * Frame aware DCVS: share of the frame target the GPU work is sized to, and
+ * how long without a frame before the devfreq governor takes over again (ms)
+ */
+#define KGSL_FRAME_HEADROOM	85
+#define KGSL_FRAME_TIMEOUT	100
+
+/**
+ * struct kgsl_frame_stats - Frame aware DCVS statistics for a power level
+ * @frames - Frames completed while running at this level
+ * @misses - Frames whose GPU time exceeded the frame target at this level
+ */
+struct kgsl_frame_stats {
+	u64 frames;
+	u64 misses;
+};
+
 struct kgsl_power_stats {
 	u64 busy_time;
 	u64 ram_time;
@@ -78,6 +95,13 @@ struct kgsl_pwr_history {
  * ctxt aware power level jump
  * @ctxt_aware_target_pwrlevel - pwrlevel to jump on in case of ctxt aware
  * power level jump
+ * @frame_target_us - Frame time budget for frame aware DCVS, 0 if disabled
+ * @frame_ws - Picks a power level for the frames retired since the last run
+ * @frame_pending - Number of frames retired since the last evaluation
+ * @frame_cycles - GPU busy cycles accumulated since the last evaluation
+ * @frame_est_cycles - Smoothed estimate of GPU cycles needed per frame
+ * @frame_last - Timestamp of the last frame aware level decision
+ * @frame_stats - Per power level frame and deadline miss counts
  */
 struct kgsl_pwrscale {
 	struct devfreq *devfreqptr;
@@ -101,6 +125,13 @@ struct kgsl_pwrscale {
 	bool ctxt_aware_enable;
 	unsigned int ctxt_aware_target_pwrlevel;
 	unsigned int ctxt_aware_busy_penalty;
+	unsigned int frame_target_us;
+	struct work_struct frame_ws;
+	atomic_t frame_pending;
+	u64 frame_cycles;
+	u64 frame_est_cycles;
+	ktime_t frame_last;
+	struct kgsl_frame_stats frame_stats[KGSL_MAX_PWRLEVELS];
 };
 
 int kgsl_pwrscale_init(struct device *dev, const char *governor);
@@ -112,6 +143,8 @@ void kgsl_pwrscale_busy(struct kgsl_device *device);
 void kgsl_pwrscale_sleep(struct kgsl_device *device);
 void kgsl_pwrscale_wake(struct kgsl_device *device);
 
+void kgsl_pwrscale_frame_end(struct kgsl_device *device);
+
 void kgsl_pwrscale_midframe_timer_restart(struct kgsl_device *device);
 void kgsl_pwrscale_midframe_timer_cancel(struct kgsl_device *device);
 
@@ -21,6 +21,7 @@
 #include <soc/qcom/scm.h>
 #include <soc/qcom/secure_buffer.h>
 #include <linux/ratelimit.h>
+#include <linux/memcontrol.h>
 
 #include "kgsl.h"
 #include "kgsl_sharedmem.h"
@@ -46,6 +47,13 @@
 
 static bool sharedmem_noretry_flag;
 
+/*
+ * When set, user allocations prefer physically contiguous 2MB and 64KB chunks
+ * taken straight from the buddy allocator, so that the SMMU can map them with
+ * block entries instead of 4KB pages. Toggled through the driver sysfs node.
+ */
+static bool sharedmem_large_pages_flag;
+
 static DEFINE_MUTEX(kernel_map_global_lock);
 
 struct cp2_mem_chunks {
@@ -182,11 +190,18 @@ gpumem_unmapped_show(struct kgsl_process_private *priv, int type, char *buf)
 			gpumem_total - gpumem_mapped);
 }
 
+static ssize_t
+drawobj_pool_show(struct kgsl_process_private *priv, int type, char *buf)
+{
+	return kgsl_drawobj_pool_show(&priv->drawobj_pool, buf);
+}
+
 static struct kgsl_mem_entry_attribute debug_memstats[] = {
 	__MEM_ENTRY_ATTR(0, imported_mem, imported_mem_show),
 	__MEM_ENTRY_ATTR(0, gpumem_mapped, gpumem_mapped_show),
 	__MEM_ENTRY_ATTR(KGSL_MEM_ENTRY_KERNEL, gpumem_unmapped,
 				gpumem_unmapped_show),
+	__MEM_ENTRY_ATTR(0, drawobj_pool, drawobj_pool_show),
 };
 
 /**
@@ -344,6 +359,14 @@ static ssize_t kgsl_drv_memstat_show(struct device *dev,
 		val = atomic_long_read(&kgsl_driver.stats.mapped);
 	else if (!strcmp(attr->attr.name, "mapped_max"))
 		val = atomic_long_read(&kgsl_driver.stats.mapped_max);
+	else if (!strcmp(attr->attr.name, "page_alloc_4k"))
+		val = atomic_long_read(&kgsl_driver.stats.page_alloc_4k);
+	else if (!strcmp(attr->attr.name, "page_alloc_64k"))
+		val = atomic_long_read(&kgsl_driver.stats.page_alloc_64k);
+	else if (!strcmp(attr->attr.name, "page_alloc_1m"))
+		val = atomic_long_read(&kgsl_driver.stats.page_alloc_1m);
+	else if (!strcmp(attr->attr.name, "page_alloc_2m"))
+		val = atomic_long_read(&kgsl_driver.stats.page_alloc_2m);
 
 	return snprintf(buf, PAGE_SIZE, "%llu\n", val);
 }
@@ -371,6 +394,28 @@ static ssize_t kgsl_drv_full_cache_threshold_show(struct device *dev,
 			kgsl_driver.full_cache_threshold);
 }
 
+static ssize_t kgsl_drv_large_page_alloc_store(struct device *dev,
+					 struct device_attribute *attr,
+					 const char *buf, size_t count)
+{
+	int ret;
+	unsigned int val = 0;
+
+	ret = kgsl_sysfs_store(buf, &val);
+	if (ret)
+		return ret;
+
+	sharedmem_large_pages_flag = val ? true : false;
+	return count;
+}
+
+static ssize_t kgsl_drv_large_page_alloc_show(struct device *dev,
+					struct device_attribute *attr,
+					char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%d\n", sharedmem_large_pages_flag);
+}
+
 static DEVICE_ATTR(vmalloc, 0444, kgsl_drv_memstat_show, NULL);
 static DEVICE_ATTR(vmalloc_max, 0444, kgsl_drv_memstat_show, NULL);
 static DEVICE_ATTR(page_alloc, 0444, kgsl_drv_memstat_show, NULL);
@@ -381,9 +426,16 @@ static DEVICE_ATTR(secure, 0444, kgsl_drv_memstat_show, NULL);
 static DEVICE_ATTR(secure_max, 0444, kgsl_drv_memstat_show, NULL);
 static DEVICE_ATTR(mapped, 0444, kgsl_drv_memstat_show, NULL);
 static DEVICE_ATTR(mapped_max, 0444, kgsl_drv_memstat_show, NULL);
+static DEVICE_ATTR(page_alloc_4k, 0444, kgsl_drv_memstat_show, NULL);
+static DEVICE_ATTR(page_alloc_64k, 0444, kgsl_drv_memstat_show, NULL);
+static DEVICE_ATTR(page_alloc_1m, 0444, kgsl_drv_memstat_show, NULL);
+static DEVICE_ATTR(page_alloc_2m, 0444, kgsl_drv_memstat_show, NULL);
 static DEVICE_ATTR(full_cache_threshold, 0644,
 		kgsl_drv_full_cache_threshold_show,
 		kgsl_drv_full_cache_threshold_store);
+static DEVICE_ATTR(large_page_alloc, 0644,
+		kgsl_drv_large_page_alloc_show,
+		kgsl_drv_large_page_alloc_store);
 
 static const struct device_attribute *drv_attr_list[] = {
 	&dev_attr_vmalloc,
@@ -396,7 +448,12 @@ static const struct device_attribute *drv_attr_list[] = {
 	&dev_attr_secure_max,
 	&dev_attr_mapped,
 	&dev_attr_mapped_max,
+	&dev_attr_page_alloc_4k,
+	&dev_attr_page_alloc_64k,
+	&dev_attr_page_alloc_1m,
+	&dev_attr_page_alloc_2m,
 	&dev_attr_full_cache_threshold,
+	&dev_attr_large_page_alloc,
 	NULL
 };
 
@@ -575,7 +632,14 @@ static void kgsl_page_alloc_free(struct kgsl_memdesc *memdesc)
 		atomic_long_add(memdesc->size,
 			&kgsl_driver.stats.page_free_pending);
 		/* Free pages using pages array for non secure paged memory */
-		kgsl_pool_free_pages(memdesc->pages, memdesc->page_count);
+		if (memdesc->priv & KGSL_MEMDESC_NOPOOL)
+			kgsl_pool_release_pages(memdesc->pages,
+				memdesc->page_count);
+		else
+			kgsl_pool_free_pages(memdesc->pages,
+				memdesc->page_count);
+		memcg_kmem_uncharge_nr(memdesc->memcg, memdesc->page_count);
+		memdesc->memcg = NULL;
 		atomic_long_sub(memdesc->size, &kgsl_driver.stats.page_alloc);
 		atomic_long_sub(memdesc->size,
 			&kgsl_driver.stats.page_free_pending);
@@ -872,6 +936,14 @@ void kgsl_memdesc_init(struct kgsl_device *device,
 	if (!kgsl_cachemode_is_cached(flags))
 		flags &= ~((u64) KGSL_MEMFLAGS_IOCOHERENT);
 
+	/*
+	 * Secure buffers have to be locked in one piece and cached buffers
+	 * need every page present for cache maintenance, so only allow lazy
+	 * population for uncached/write-combined paged memory
+	 */
+	if ((flags & KGSL_MEMFLAGS_SECURE) || kgsl_cachemode_is_cached(flags))
+		flags &= ~((u64) KGSL_MEMFLAGS_LAZY);
+
 	if (MMU_FEATURE(mmu, KGSL_MMU_NEED_GUARD_PAGE) || (flags & KGSL_MEMFLAGS_GUARD_PAGE))
 		memdesc->priv |= KGSL_MEMDESC_GUARD_PAGE;
 
@@ -889,6 +961,147 @@ void kgsl_memdesc_init(struct kgsl_device *device,
 	spin_lock_init(&memdesc->lock);
 }
 
+/*
+ * Pick the contiguous chunk size to try from the buddy allocator before
+ * falling back to the pools, or 0 if the pools should be used directly.
+ * 1MB chunks are left to the pools since they are reserved up front.
+ */
+static int kgsl_get_large_page_size(size_t len, int max_size, int page_size)
+{
+	if (max_size >= SZ_2M && len >= SZ_2M)
+		return SZ_2M;
+	if (max_size >= SZ_64K && page_size < SZ_64K && len >= SZ_64K)
+		return SZ_64K;
+	return 0;
+}
+
+static void kgsl_account_page_size(int page_size)
+{
+	if (page_size >= SZ_2M)
+		atomic_long_add(page_size, &kgsl_driver.stats.page_alloc_2m);
+	else if (page_size >= SZ_1M)
+		atomic_long_add(page_size, &kgsl_driver.stats.page_alloc_1m);
+	else if (page_size >= SZ_64K)
+		atomic_long_add(page_size, &kgsl_driver.stats.page_alloc_64k);
+	else
+		atomic_long_add(page_size, &kgsl_driver.stats.page_alloc_4k);
+}
+
+/* Serializes population of lazily backed buffers */
+static DEFINE_MUTEX(kgsl_lazy_lock);
+
+/**
+ * kgsl_sharedmem_lazy_populate() - Back one page of a lazy allocation
+ * @memdesc: Pointer to a lazily backed memory descriptor
+ * @offset: Byte offset of the page in the buffer
+ *
+ * Allocate a page from the kgsl pools for @offset if it isn't already
+ * backed and map it into the GPU pagetable. Called from the CPU and GPU
+ * fault paths. Return 0 on success or negative on error.
+ */
+int kgsl_sharedmem_lazy_populate(struct kgsl_memdesc *memdesc,
+		uint64_t offset)
+{
+	unsigned int pgoff = offset >> PAGE_SHIFT;
+	unsigned int align = PAGE_SHIFT;
+	int page_size = PAGE_SIZE;
+	struct page *page;
+	int ret = 0;
+
+	if (!(memdesc->priv & KGSL_MEMDESC_LAZY) || offset >= memdesc->size)
+		return -EINVAL;
+
+	mutex_lock(&kgsl_lazy_lock);
+
+	/* Somebody else got here first */
+	if (memdesc->pages[pgoff])
+		goto out;
+
+	if (kgsl_pool_alloc_page(&page_size, &page, 1, &align,
+			memdesc->dev) != 1) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	if (memdesc->pagetable) {
+		ret = kgsl_mmu_map_page(memdesc->pagetable, memdesc,
+			(uint64_t) pgoff << PAGE_SHIFT, page);
+		if (ret) {
+			kgsl_pool_free_page(page);
+			goto out;
+		}
+	}
+
+	memdesc->pages[pgoff] = page;
+	memdesc->page_count++;
+
+	kgsl_account_page_size(PAGE_SIZE);
+	KGSL_STATS_ADD(PAGE_SIZE, &kgsl_driver.stats.page_alloc,
+		&kgsl_driver.stats.page_alloc_max);
+out:
+	mutex_unlock(&kgsl_lazy_lock);
+	return ret;
+}
+
+static int kgsl_lazy_vmfault(struct kgsl_memdesc *memdesc,
+				struct vm_area_struct *vma,
+				struct vm_fault *vmf)
+{
+	unsigned int offset = vmf->address - vma->vm_start;
+	struct page *page;
+
+	if (offset >= memdesc->size)
+		return VM_FAULT_SIGBUS;
+
+	if (kgsl_sharedmem_lazy_populate(memdesc, offset))
+		return VM_FAULT_OOM;
+
+	page = memdesc->pages[offset >> PAGE_SHIFT];
+	get_page(page);
+	vmf->page = page;
+
+	return 0;
+}
+
+static void kgsl_lazy_free(struct kgsl_memdesc *memdesc)
+{
+	unsigned int i;
+
+	/* The array is sparse so walk every slot */
+	for (i = 0; i < (memdesc->size >> PAGE_SHIFT); i++)
+		if (memdesc->pages[i])
+			kgsl_pool_free_page(memdesc->pages[i]);
+
+	atomic_long_sub((long) memdesc->page_count << PAGE_SHIFT,
+		&kgsl_driver.stats.page_alloc);
+}
+
+/* Lazy ops - buffers that are populated a page at a time on fault */
+static struct kgsl_memdesc_ops kgsl_lazy_ops = {
+	.free = kgsl_lazy_free,
+	.vmflags = VM_DONTDUMP | VM_DONTEXPAND | VM_DONTCOPY,
+	.vmfault = kgsl_lazy_vmfault,
+};
+
+static int kgsl_sharedmem_lazy_alloc(struct kgsl_memdesc *memdesc,
+		uint64_t size)
+{
+	size_t len = (size >> PAGE_SHIFT) * sizeof(struct page *);
+
+	memdesc->pages = kgsl_malloc(len);
+	if (memdesc->pages == NULL)
+		return -ENOMEM;
+
+	memset(memdesc->pages, 0, len);
+
+	memdesc->ops = &kgsl_lazy_ops;
+	memdesc->priv |= KGSL_MEMDESC_LAZY;
+	memdesc->page_count = 0;
+	memdesc->size = size;
+
+	return 0;
+}
+
 int
 kgsl_sharedmem_page_alloc_user(struct kgsl_memdesc *memdesc,
 			uint64_t size)
@@ -898,6 +1111,7 @@ kgsl_sharedmem_page_alloc_user(struct kgsl_memdesc *memdesc,
 	unsigned int pcount = 0;
 	size_t len;
 	unsigned int align;
+	int large_size, large_max = 0;
 
 	static DEFINE_RATELIMIT_STATE(_rs,
 					DEFAULT_RATELIMIT_INTERVAL,
@@ -907,6 +1121,9 @@ kgsl_sharedmem_page_alloc_user(struct kgsl_memdesc *memdesc,
 	if (size == 0 || size > UINT_MAX)
 		return -EINVAL;
 
+	if (memdesc->flags & KGSL_MEMFLAGS_LAZY)
+		return kgsl_sharedmem_lazy_alloc(memdesc, size);
+
 	align = (memdesc->flags & KGSL_MEMALIGN_MASK) >> KGSL_MEMALIGN_SHIFT;
 
 	/*
@@ -963,10 +1180,39 @@ kgsl_sharedmem_page_alloc_user(struct kgsl_memdesc *memdesc,
 
 	len = size;
 
+	if (sharedmem_large_pages_flag &&
+			!(memdesc->flags & KGSL_MEMFLAGS_SECURE))
+		large_max = SZ_2M;
+
 	while (len > 0) {
-		int page_count;
+		int page_count = 0;
 
-		page_count = kgsl_pool_alloc_page(&page_size,
+		large_size = kgsl_get_large_page_size(len, large_max,
+					page_size);
+		if (large_size) {
+			page_count = kgsl_pool_alloc_large_page(large_size,
+					memdesc->pages + pcount,
+					len_alloc - pcount, memdesc->dev);
+			if (page_count > 0) {
+				page_size = large_size;
+
+				/*
+				 * Chunks are allocated largest first, so the
+				 * chunk offsets stay aligned if the GPU VA is
+				 */
+				if (kgsl_memdesc_get_align(memdesc) <
+						ilog2(large_size))
+					kgsl_memdesc_set_align(memdesc,
+						ilog2(large_size));
+			} else {
+				/* Don't keep retrying an order that failed */
+				large_max = large_size >> 1;
+				page_size = kgsl_get_page_size(len, align);
+			}
+		}
+
+		if (page_count <= 0)
+			page_count = kgsl_pool_alloc_page(&page_size,
 					memdesc->pages + pcount,
 					len_alloc - pcount,
 					&align, memdesc->dev);
@@ -995,6 +1241,7 @@ kgsl_sharedmem_page_alloc_user(struct kgsl_memdesc *memdesc,
 		len -= page_size;
 		memdesc->size += page_size;
 		memdesc->page_count += page_count;
+		kgsl_account_page_size(page_size);
 
 		/* Get the needed page size for the next iteration */
 		page_size = kgsl_get_page_size(len, align);
@@ -1048,6 +1295,14 @@ kgsl_sharedmem_page_alloc_user(struct kgsl_memdesc *memdesc,
 		goto done;
 	}
 
+	/* Charge the pages to the memory cgroup of the allocating process */
+	memdesc->memcg = memcg_kmem_charge_nr(GFP_KERNEL, memdesc->page_count);
+	if (IS_ERR(memdesc->memcg)) {
+		memdesc->memcg = NULL;
+		ret = -ENOMEM;
+		goto done;
+	}
+
 	KGSL_STATS_ADD(memdesc->size, &kgsl_driver.stats.page_alloc,
 		&kgsl_driver.stats.page_alloc_max);
 
@@ -77,6 +77,9 @@ void kgsl_get_memory_usage(char *str, size_t len, uint64_t memflags);
 int kgsl_sharedmem_page_alloc_user(struct kgsl_memdesc *memdesc,
 				uint64_t size);
 
+int kgsl_sharedmem_lazy_populate(struct kgsl_memdesc *memdesc,
+		uint64_t offset);
+
 void kgsl_free_secure_page(struct page *page);
 
 int kgsl_lock_sgt(struct sg_table *sgt, uint64_t size);
@@ -16,6 +16,7 @@
 #include <linux/utsname.h>
 #include <linux/sched.h>
 #include <linux/idr.h>
+#include <linux/devcoredump.h>
 
 #include "kgsl.h"
 #include "kgsl_log.h"
@@ -623,6 +624,9 @@ static void kgsl_free_snapshot(struct kgsl_snapshot *snapshot)
 	if (snapshot->mempool)
 		vfree(snapshot->mempool);
 
+	if (snapshot->stream)
+		vfree(snapshot->start);
+
 	kfree(snapshot);
 	KGSL_CORE_ERR("snapshot: objects released\n");
 }
@@ -681,12 +685,12 @@ char* kgsl_get_reason(int faulttype, bool gmu_fault){
 void kgsl_device_snapshot(struct kgsl_device *device,
 		struct kgsl_context *context, bool gmu_fault)
 {
-	struct kgsl_snapshot_header *header = device->snapshot_memory.ptr;
+	struct kgsl_snapshot_header *header;
 	struct kgsl_snapshot *snapshot;
 	struct timespec boot;
-	phys_addr_t pa;
+	u8 *start = device->snapshot_memory.ptr;
 
-	if (device->snapshot_memory.ptr == NULL) {
+	if (start == NULL && !device->snapshot_stream) {
 		KGSL_DRV_ERR(device,
 			"snapshot: no snapshot memory available\n");
 		return;
@@ -699,7 +703,18 @@ void kgsl_device_snapshot(struct kgsl_device *device,
 	/* increment the hang count for good book keeping */
 	device->snapshot_faultcount++;
 
-	if (device->snapshot != NULL) {
+	/*
+	 * Streamed snapshots are handed off to devcoredump as soon as the
+	 * frozen objects are saved so there is nothing to over-write
+	 */
+	if (device->snapshot_stream) {
+		start = vmalloc(device->snapshot_memory.size);
+		if (start == NULL) {
+			KGSL_DRV_ERR(device,
+				"snapshot: unable to allocate snapshot memory\n");
+			return;
+		}
+	} else if (device->snapshot != NULL) {
 
 		/*
 		 * Snapshot over-write policy:
@@ -726,21 +741,25 @@ void kgsl_device_snapshot(struct kgsl_device *device,
 
 	/* Allocate memory for the snapshot instance */
 	snapshot = kzalloc(sizeof(*snapshot), GFP_KERNEL);
-	if (snapshot == NULL)
+	if (snapshot == NULL) {
+		if (device->snapshot_stream)
+			vfree(start);
 		return;
+	}
 
 	init_completion(&snapshot->dump_gate);
 	INIT_LIST_HEAD(&snapshot->obj_list);
 	INIT_LIST_HEAD(&snapshot->cp_list);
 	INIT_WORK(&snapshot->work, kgsl_snapshot_save_frozen_objs);
 
-	snapshot->start = device->snapshot_memory.ptr;
-	snapshot->ptr = device->snapshot_memory.ptr;
+	snapshot->start = start;
+	snapshot->ptr = start;
 	snapshot->remain = device->snapshot_memory.size;
 	snapshot->gmu_fault = gmu_fault;
 	snapshot->recovered = false;
 	snapshot->first_read = true;
 	snapshot->sysfs_read = 0;
+	snapshot->stream = device->snapshot_stream;
 
 	header = (struct kgsl_snapshot_header *) snapshot->ptr;
 
@@ -775,13 +794,19 @@ void kgsl_device_snapshot(struct kgsl_device *device,
 	getboottime(&boot);
 	snapshot->timestamp = get_seconds() - boot.tv_sec;
 
-	/* Store the instance in the device until it gets dumped */
-	device->snapshot = snapshot;
+	if (snapshot->stream) {
+		KGSL_DRV_ERR(device, "%s snapshot created, size 0x%zx\n",
+			gmu_fault ? "GMU" : "GPU", snapshot->size);
+	} else {
+		phys_addr_t pa = __pa(device->snapshot_memory.ptr);
 
-	/* log buffer info to aid in ramdump fault tolerance */
-	pa = __pa(device->snapshot_memory.ptr);
-	KGSL_DRV_ERR(device, "%s snapshot created at pa %pa++0x%zx\n",
+		/* Store the instance in the device until it gets dumped */
+		device->snapshot = snapshot;
+
+		/* log buffer info to aid in ramdump fault tolerance */
+		KGSL_DRV_ERR(device, "%s snapshot created at pa %pa++0x%zx\n",
 			gmu_fault ? "GMU" : "GPU", &pa, snapshot->size);
+	}
 	#if defined(OPLUS_FEATURE_GPU_MINIDUMP)
 	// MeiDongting@MULTIMEIDA.FEATURE.GPU.MINIDUMP, 2020/04/06, Add for OPPO gpu mini dump
 	if(context!= NULL){
@@ -1222,6 +1247,9 @@ int kgsl_device_snapshot_init(struct kgsl_device *device)
 	if (device->snapshot_memory.size == 0)
 		return 0;
 
+	device->snapshot_stream = of_property_read_bool(device->pdev->dev.of_node,
+		"qcom,snapshot-stream");
+
 	/*
 	 * I'm not sure why anybody would choose to do so but make sure
 	 * that we can at least fit the snapshot header in the requested
@@ -1231,11 +1259,17 @@ int kgsl_device_snapshot_init(struct kgsl_device *device)
 		device->snapshot_memory.size =
 			sizeof(struct kgsl_snapshot_header);
 
-	device->snapshot_memory.ptr = kzalloc(device->snapshot_memory.size,
-		GFP_KERNEL);
+	/*
+	 * In stream mode the snapshot region is only allocated when a fault
+	 * happens, so nothing is reserved up front
+	 */
+	if (!device->snapshot_stream) {
+		device->snapshot_memory.ptr =
+			kzalloc(device->snapshot_memory.size, GFP_KERNEL);
 
-	if (device->snapshot_memory.ptr == NULL)
-		return -ENOMEM;
+		if (device->snapshot_memory.ptr == NULL)
+			return -ENOMEM;
+	}
 
 	device->snapshot = NULL;
 	device->snapshot_faultcount = 0;
@@ -1397,6 +1431,51 @@ static size_t _mempool_add_object(struct kgsl_snapshot *snapshot, u8 *data,
 	return section->size;
 }
 
+/* devcoredump read callback - emit the snapshot like the sysfs dump file */
+static ssize_t snapshot_stream_read(char *buffer, loff_t offset, size_t count,
+		void *data, size_t datalen)
+{
+	struct kgsl_snapshot *snapshot = data;
+	struct kgsl_snapshot_section_header head;
+	struct snapshot_obj_itr itr;
+
+	obj_itr_init(&itr, buffer, offset, count);
+
+	if (obj_itr_out(&itr, snapshot->start, snapshot->size) == 0)
+		return itr.write;
+
+	if (snapshot->mempool && obj_itr_out(&itr, snapshot->mempool,
+			snapshot->mempool_size) == 0)
+		return itr.write;
+
+	head.magic = SNAPSHOT_SECTION_MAGIC;
+	head.id = KGSL_SNAPSHOT_SECTION_END;
+	head.size = sizeof(head);
+
+	obj_itr_out(&itr, &head, sizeof(head));
+
+	return itr.write;
+}
+
+static void snapshot_stream_free(void *data)
+{
+	kgsl_free_snapshot(data);
+}
+
+/*
+ * Hand a finished snapshot over to devcoredump. From here on the snapshot is
+ * owned by the coredump device and is freed once read or when it times out.
+ */
+static void kgsl_snapshot_stream(struct kgsl_device *device,
+		struct kgsl_snapshot *snapshot)
+{
+	size_t size = snapshot->size + snapshot->mempool_size +
+		sizeof(struct kgsl_snapshot_section_header);
+
+	dev_coredumpm(device->dev, THIS_MODULE, snapshot, size, GFP_KERNEL,
+		snapshot_stream_read, snapshot_stream_free);
+}
+
 /**
  * kgsl_snapshot_save_frozen_objs() - Save the objects frozen in snapshot into
  * memory so that the data reported in these objects is correct when snapshot
@@ -1466,5 +1545,9 @@ static void kgsl_snapshot_save_frozen_objs(struct work_struct *work)
 
 gmu_only:
 	complete_all(&snapshot->dump_gate);
+
+	if (snapshot->stream)
+		kgsl_snapshot_stream(device, snapshot);
+
 	BUG_ON(device->force_panic);
 }
@@ -20,6 +20,7 @@
 #define trace_kgsl_context_create(...) {}
 #define trace_kgsl_context_destroy(...) {}
 #define trace_kgsl_context_detach(...) {}
+#define trace_kgsl_event_latency(...) {}
 #define trace_kgsl_fire_event(...) {}
 #define trace_kgsl_gmu_oob_clear(...) {}
 #define trace_kgsl_gmu_oob_set(...) {}
@@ -971,6 +972,29 @@ TRACE_EVENT(kgsl_fire_event,
 			__entry->age, __entry->func)
 );
 
+TRACE_EVENT(kgsl_event_latency,
+		TP_PROTO(unsigned int id, unsigned int ts,
+			unsigned int type, s64 latency),
+		TP_ARGS(id, ts, type, latency),
+		TP_STRUCT__entry(
+			__field(unsigned int, id)
+			__field(unsigned int, ts)
+			__field(unsigned int, type)
+			__field(s64, latency)
+		),
+		TP_fast_assign(
+			__entry->id = id;
+			__entry->ts = ts;
+			__entry->type = type;
+			__entry->latency = latency;
+		),
+		TP_printk(
+			"ctx=%u ts=%u type=%s latency=%lldus",
+			__entry->id, __entry->ts,
+			__print_symbolic(__entry->type, KGSL_EVENT_TYPES),
+			__entry->latency)
+);
+
 TRACE_EVENT(kgsl_active_count,
 
 	TP_PROTO(struct kgsl_device *device, unsigned long ip),
@@ -19,6 +19,7 @@
 #include <linux/sched.h>
 #include <linux/sched/rt.h>
 #include <linux/task_work.h>
+#include <linux/interrupt.h>
 
 
 #include <linux/version.h>
@@ -2282,6 +2283,16 @@ static int nvt_enable_game_mode(struct chip_data_nt36672c *chip_info, bool enabl
         ret = nvt_cmd_store(chip_info, EVENTBUFFER_GAME_OFF);
     }
 
+    /* the irq thread follows the irq, keep both on the big cores */
+    if (chip_info->irq_num > 0) {
+        if (enable) {
+            irq_set_affinity_hint(chip_info->irq_num, cpu_perf_mask);
+        } else {
+            irq_set_affinity_hint(chip_info->irq_num, cpu_possible_mask);
+            irq_set_affinity_hint(chip_info->irq_num, NULL);
+        }
+    }
+
     return ret;
 }
 
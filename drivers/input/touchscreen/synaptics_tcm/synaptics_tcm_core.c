@@ -158,6 +158,7 @@ static struct syna_tcm_module_pool mod_pool;
 
 SHOW_PROTOTYPE(syna_tcm, info);
 STORE_PROTOTYPE(syna_tcm, irq_en);
+SHOW_STORE_PROTOTYPE(syna_tcm, irq_perf);
 STORE_PROTOTYPE(syna_tcm, reset);
 STORE_PROTOTYPE(syna_tcm, watchdog);
 SHOW_STORE_PROTOTYPE(syna_tcm, no_doze);
@@ -177,6 +178,7 @@ SHOW_STORE_PROTOTYPE(syna_tcm, enable_glove);
 static struct device_attribute *attrs[] = {
 	ATTRIFY(info),
 	ATTRIFY(irq_en),
+	ATTRIFY(irq_perf),
 	ATTRIFY(reset),
 	ATTRIFY(watchdog),
 };
@@ -374,6 +376,59 @@ static ssize_t syna_tcm_sysfs_irq_en_store(struct device *dev,
 	return retval;
 }
 
+static void syna_tcm_set_irq_affinity(struct syna_tcm_hcd *tcm_hcd)
+{
+	if (!tcm_hcd->irq_enabled || tcm_hcd->hw_if->bdata->irq_gpio < 0)
+		return;
+
+	/* The interrupt thread follows the affinity of the interrupt */
+	if (tcm_hcd->irq_perf) {
+		irq_set_affinity_hint(tcm_hcd->irq, cpu_perf_mask);
+	} else {
+		irq_set_affinity_hint(tcm_hcd->irq, cpu_possible_mask);
+		irq_set_affinity_hint(tcm_hcd->irq, NULL);
+	}
+}
+
+static ssize_t syna_tcm_sysfs_irq_perf_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct device *p_dev;
+	struct kobject *p_kobj;
+	struct syna_tcm_hcd *tcm_hcd;
+
+	p_kobj = sysfs_dir->parent;
+	p_dev = container_of(p_kobj, struct device, kobj);
+	tcm_hcd = dev_get_drvdata(p_dev);
+
+	return snprintf(buf, PAGE_SIZE, "%u\n", tcm_hcd->irq_perf);
+}
+
+static ssize_t syna_tcm_sysfs_irq_perf_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	unsigned int input;
+	struct device *p_dev;
+	struct kobject *p_kobj;
+	struct syna_tcm_hcd *tcm_hcd;
+
+	p_kobj = sysfs_dir->parent;
+	p_dev = container_of(p_kobj, struct device, kobj);
+	tcm_hcd = dev_get_drvdata(p_dev);
+
+	if (kstrtouint(buf, 10, &input) || input > 1)
+		return -EINVAL;
+
+	mutex_lock(&tcm_hcd->irq_en_mutex);
+
+	tcm_hcd->irq_perf = input;
+	syna_tcm_set_irq_affinity(tcm_hcd);
+
+	mutex_unlock(&tcm_hcd->irq_en_mutex);
+
+	return count;
+}
+
 static ssize_t syna_tcm_sysfs_reset_store(struct device *dev,
 		struct device_attribute *attr, const char *buf, size_t count)
 {
@@ -1668,6 +1723,8 @@ static void syna_tcm_polling_work(struct work_struct *work)
 	if (!tcm_hcd->do_polling)
 		return;
 
+	tcm_hcd->isr_ts = ktime_get();
+
 	retval = tcm_hcd->read_message(tcm_hcd,
 			NULL,
 			0);
@@ -1685,6 +1742,16 @@ static void syna_tcm_polling_work(struct work_struct *work)
 	}
 }
 
+static irqreturn_t syna_tcm_hardirq(int irq, void *data)
+{
+	struct syna_tcm_hcd *tcm_hcd = data;
+
+	/* Time the report was raised, before the thread gets to run */
+	tcm_hcd->isr_ts = ktime_get();
+
+	return IRQ_WAKE_THREAD;
+}
+
 static irqreturn_t syna_tcm_isr(int irq, void *data)
 {
 	int retval;
@@ -1734,7 +1801,8 @@ static int syna_tcm_enable_irq(struct syna_tcm_hcd *tcm_hcd, bool en, bool ns)
 		}
 
 		if (irq_freed) {
-			retval = request_threaded_irq(tcm_hcd->irq, NULL,
+			retval = request_threaded_irq(tcm_hcd->irq,
+					syna_tcm_hardirq,
 					syna_tcm_isr, bdata->irq_flags,
 					PLATFORM_DRIVER_NAME, tcm_hcd);
 			if (retval < 0) {
@@ -1774,6 +1842,7 @@ static int syna_tcm_enable_irq(struct syna_tcm_hcd *tcm_hcd, bool en, bool ns)
 				disable_irq_nosync(tcm_hcd->irq);
 			} else {
 				disable_irq(tcm_hcd->irq);
+				irq_set_affinity_hint(tcm_hcd->irq, NULL);
 				free_irq(tcm_hcd->irq, tcm_hcd);
 			}
 			irq_freed = !ns;
@@ -1795,6 +1864,9 @@ static int syna_tcm_enable_irq(struct syna_tcm_hcd *tcm_hcd, bool en, bool ns)
 	if (retval == 0)
 		tcm_hcd->irq_enabled = en;
 
+	if (retval == 0 && en && tcm_hcd->irq_perf)
+		syna_tcm_set_irq_affinity(tcm_hcd);
+
 	mutex_unlock(&tcm_hcd->irq_en_mutex);
 
 	return retval;
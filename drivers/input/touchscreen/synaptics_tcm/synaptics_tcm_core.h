@@ -389,6 +389,7 @@ struct syna_tcm_features {
 
 struct syna_tcm_hcd {
 	pid_t isr_pid;
+	ktime_t isr_ts;
 	atomic_t command_status;
 	atomic_t host_downloading;
 	atomic_t firmware_flashing;
@@ -399,6 +400,7 @@ struct syna_tcm_hcd {
 	bool do_polling;
 	bool in_suspend;
 	bool irq_enabled;
+	bool irq_perf;
 	bool host_download_mode;
 	unsigned char marker;
 	unsigned char fb_ready;
@@ -679,6 +679,9 @@ static void touch_report(void)
 #endif
 	}
 
+	/* Let readers measure latency from the interrupt, not from here */
+	input_event(touch_hcd->input_dev, EV_MSC, MSC_TIMESTAMP,
+			(u32)ktime_to_us(tcm_hcd->isr_ts));
 	input_sync(touch_hcd->input_dev);
 
 exit:
@@ -803,6 +806,7 @@ static int touch_set_input_dev(void)
 	set_bit(EV_ABS, touch_hcd->input_dev->evbit);
 	set_bit(BTN_TOUCH, touch_hcd->input_dev->keybit);
 	set_bit(BTN_TOOL_FINGER, touch_hcd->input_dev->keybit);
+	input_set_capability(touch_hcd->input_dev, EV_MSC, MSC_TIMESTAMP);
 #ifdef INPUT_PROP_DIRECT
 	set_bit(INPUT_PROP_DIRECT, touch_hcd->input_dev->propbit);
 #endif
@@ -20,6 +20,7 @@
 #include <linux/slab.h>
 #include <linux/vmalloc.h>
 #include <linux/pci.h>
+#include <linux/percpu.h>
 #include <trace/events/iommu.h>
 #include "io-pgtable.h"
 
@@ -31,6 +32,36 @@
 #define FAST_PAGE_SIZE (1UL << FAST_PAGE_SHIFT)
 #define FAST_PAGE_MASK (~(PAGE_SIZE - 1))
 
+/*
+ * IOVAs of up to (1 << (FAST_IOVA_CACHE_ORDERS - 1)) pages are recycled
+ * through per-CPU magazines instead of the bitmap, so that map and unmap
+ * don't serialize on the mapping lock.
+ */
+#define FAST_IOVA_CACHE_ORDERS	6
+#define FAST_IOVA_MAG_SIZE	16
+#define FAST_IOVA_DEPOT_SIZE	8
+
+struct fast_iova_mag {
+	unsigned int	nr;
+	/* tlbi_gen when the last IOVA was added */
+	unsigned long	gen;
+	unsigned long	bits[FAST_IOVA_MAG_SIZE];
+};
+
+struct fast_iova_cpu_cache {
+	spinlock_t		lock;
+	/* IOVAs that are safe to hand out */
+	struct fast_iova_mag	*clean[FAST_IOVA_CACHE_ORDERS];
+	/* IOVAs that may still be in the TLB */
+	struct fast_iova_mag	*dirty[FAST_IOVA_CACHE_ORDERS];
+};
+
+/* Full magazines come first, then empty ones */
+struct fast_iova_depot {
+	unsigned int		nr_full;
+	struct fast_iova_mag	*mags[FAST_IOVA_DEPOT_SIZE];
+};
+
 static pgprot_t __get_dma_pgprot(unsigned long attrs, pgprot_t prot,
 				 bool coherent)
 {
@@ -125,22 +156,37 @@ static bool __bit_covered_stale(unsigned long upcoming_stale,
 	return true;
 }
 
-static dma_addr_t __fast_smmu_alloc_iova(struct dma_fast_smmu_mapping *mapping,
-					 unsigned long attrs,
-					 size_t size)
+/*
+ * Invalidates the whole TLB. IOVAs freed before tlbi_gen was bumped here
+ * are clean once tlbi_done catches up with it, which lets the IOVA caches
+ * tell without a lock whether their magazines can be reused.
+ *
+ * Called with mapping->lock held.
+ */
+static void __fast_smmu_tlbiall(struct dma_fast_smmu_mapping *mapping,
+				bool skip_sync)
 {
-	unsigned long bit, prev_search_start, nbits;
-	unsigned long align;
-	unsigned long guard_len;
-	dma_addr_t iova;
+	unsigned long gen = mapping->tlbi_gen + 1;
+
+	WRITE_ONCE(mapping->tlbi_gen, gen);
+	smp_mb();
+	iommu_tlbiall(mapping->domain);
+	mapping->have_stale_tlbs = false;
+	av8l_fast_clear_stale_ptes(mapping->pgtbl_ops,
+			mapping->domain->geometry.aperture_start,
+			mapping->base,
+			mapping->base + mapping->size - 1,
+			skip_sync);
+	smp_store_release(&mapping->tlbi_done, gen);
+}
 
-	if (mapping->min_iova_align)
-		guard_len = ALIGN(size, mapping->min_iova_align) - size;
-	else
-		guard_len = 0;
+/* Called with mapping->lock held. Returns ULONG_MAX on failure. */
+static unsigned long __fast_smmu_alloc_bits(
+	struct dma_fast_smmu_mapping *mapping, unsigned long attrs,
+	unsigned long nbits, unsigned long align)
+{
+	unsigned long bit, prev_search_start;
 
-	nbits = (size + guard_len) >> FAST_PAGE_SHIFT;
-	align = (1 << get_order(size + guard_len)) - 1;
 	bit = bitmap_find_next_zero_area(
 		mapping->bitmap, mapping->num_4k_pages, mapping->next_start,
 		nbits, align);
@@ -150,7 +196,7 @@ static dma_addr_t __fast_smmu_alloc_iova(struct dma_fast_smmu_mapping *mapping,
 			mapping->bitmap, mapping->num_4k_pages, 0, nbits,
 			align);
 		if (unlikely(bit > mapping->num_4k_pages))
-			return DMA_ERROR_CODE;
+			return ULONG_MAX;
 	}
 
 	bitmap_set(mapping->bitmap, bit, nbits);
@@ -168,28 +214,10 @@ static dma_addr_t __fast_smmu_alloc_iova(struct dma_fast_smmu_mapping *mapping,
 	if (mapping->have_stale_tlbs &&
 	    __bit_covered_stale(mapping->upcoming_stale_bit,
 				prev_search_start,
-				bit + nbits - 1)) {
-		bool skip_sync = (attrs & DMA_ATTR_SKIP_CPU_SYNC);
-
-		iommu_tlbiall(mapping->domain);
-		mapping->have_stale_tlbs = false;
-		av8l_fast_clear_stale_ptes(mapping->pgtbl_ops,
-				mapping->domain->geometry.aperture_start,
-				mapping->base,
-				mapping->base + mapping->size - 1,
-				skip_sync);
-	}
-
-	iova =  (bit << FAST_PAGE_SHIFT) + mapping->base;
-	if (guard_len &&
-		iommu_map(mapping->domain, iova + size,
-			page_to_phys(mapping->guard_page),
-			guard_len, ARM_SMMU_GUARD_PROT)) {
+				bit + nbits - 1))
+		__fast_smmu_tlbiall(mapping, attrs & DMA_ATTR_SKIP_CPU_SYNC);
 
-		bitmap_clear(mapping->bitmap, bit, nbits);
-		return DMA_ERROR_CODE;
-	}
-	return iova;
+	return bit;
 }
 
 /*
@@ -279,12 +307,236 @@ static bool __bit_is_sooner(unsigned long candidate,
 	return true;
 }
 
+/* Called with mapping->lock held */
+static void __fast_smmu_free_bits(struct dma_fast_smmu_mapping *mapping,
+				  unsigned long start_bit, unsigned long nbits)
+{
+	/*
+	 * We don't invalidate TLBs on unmap.  We invalidate TLBs on map
+	 * when we're about to re-allocate a VA that was previously
+	 * unmapped but hasn't yet been invalidated.  So we need to keep
+	 * track of which bit is the closest to being re-allocated here.
+	 */
+	if (__bit_is_sooner(start_bit, mapping))
+		mapping->upcoming_stale_bit = start_bit;
+
+	bitmap_clear(mapping->bitmap, start_bit, nbits);
+	mapping->have_stale_tlbs = true;
+}
+
+static bool fast_iova_mag_clean(struct dma_fast_smmu_mapping *mapping,
+				struct fast_iova_mag *mag)
+{
+	return mag->nr &&
+	       (long)(smp_load_acquire(&mapping->tlbi_done) - mag->gen) > 0;
+}
+
+/* Called with mapping->lock held */
+static void __fast_iova_mag_drain(struct dma_fast_smmu_mapping *mapping,
+				  struct fast_iova_mag *mag, unsigned int order)
+{
+	while (mag->nr)
+		__fast_smmu_free_bits(mapping, mag->bits[--mag->nr],
+				      1UL << order);
+}
+
+/*
+ * Swaps the empty magazine at @magp for a clean one from the depot. When
+ * the depot is full of magazines that are all still dirty, a single TLB
+ * invalidate cleans every one of them.
+ */
+static bool fast_iova_depot_get(struct dma_fast_smmu_mapping *mapping,
+				unsigned int order, struct fast_iova_mag **magp)
+{
+	struct fast_iova_depot *depot = &mapping->iova_depot[order];
+	struct fast_iova_mag *mag;
+	unsigned long flags;
+	bool ret = false;
+	int i;
+
+	spin_lock_irqsave(&mapping->lock, flags);
+	for (i = depot->nr_full - 1; i >= 0; i--) {
+		if (fast_iova_mag_clean(mapping, depot->mags[i]))
+			break;
+	}
+
+	if (i < 0 && depot->nr_full == FAST_IOVA_DEPOT_SIZE) {
+		__fast_smmu_tlbiall(mapping, false);
+		i = depot->nr_full - 1;
+	}
+
+	if (i >= 0) {
+		mag = depot->mags[i];
+		depot->mags[i] = depot->mags[--depot->nr_full];
+		depot->mags[depot->nr_full] = *magp;
+		*magp = mag;
+		ret = true;
+	}
+	spin_unlock_irqrestore(&mapping->lock, flags);
+
+	return ret;
+}
+
+/*
+ * Swaps the full magazine at @magp for an empty one from the depot, or
+ * returns its IOVAs to the bitmap if the depot is full.
+ */
+static void fast_iova_depot_put(struct dma_fast_smmu_mapping *mapping,
+				unsigned int order, struct fast_iova_mag **magp)
+{
+	struct fast_iova_depot *depot = &mapping->iova_depot[order];
+	struct fast_iova_mag *mag;
+	unsigned long flags;
+
+	spin_lock_irqsave(&mapping->lock, flags);
+	if (depot->nr_full < FAST_IOVA_DEPOT_SIZE) {
+		mag = depot->mags[depot->nr_full];
+		depot->mags[depot->nr_full++] = *magp;
+		*magp = mag;
+	} else {
+		__fast_iova_mag_drain(mapping, *magp, order);
+	}
+	spin_unlock_irqrestore(&mapping->lock, flags);
+}
+
+static bool fast_iova_cache_get(struct dma_fast_smmu_mapping *mapping,
+				unsigned int order, unsigned long *bit)
+{
+	struct fast_iova_cpu_cache *cc = raw_cpu_ptr(mapping->iova_cache);
+	struct fast_iova_mag *mag;
+	unsigned long flags;
+	bool ret = true;
+
+	spin_lock_irqsave(&cc->lock, flags);
+	mag = cc->clean[order];
+	if (!mag->nr) {
+		if (fast_iova_mag_clean(mapping, cc->dirty[order])) {
+			cc->clean[order] = cc->dirty[order];
+			cc->dirty[order] = mag;
+		} else {
+			ret = fast_iova_depot_get(mapping, order,
+						  &cc->clean[order]);
+		}
+		mag = cc->clean[order];
+	}
+
+	if (ret)
+		*bit = mag->bits[--mag->nr];
+	spin_unlock_irqrestore(&cc->lock, flags);
+
+	return ret;
+}
+
+static void fast_iova_cache_put(struct dma_fast_smmu_mapping *mapping,
+				unsigned int order, unsigned long bit)
+{
+	struct fast_iova_cpu_cache *cc = raw_cpu_ptr(mapping->iova_cache);
+	struct fast_iova_mag *mag;
+	unsigned long flags;
+
+	spin_lock_irqsave(&cc->lock, flags);
+	if (cc->dirty[order]->nr == FAST_IOVA_MAG_SIZE)
+		fast_iova_depot_put(mapping, order, &cc->dirty[order]);
+
+	/* The unmap must be visible before sampling the generation */
+	smp_mb();
+	mag = cc->dirty[order];
+	mag->bits[mag->nr++] = bit;
+	mag->gen = READ_ONCE(mapping->tlbi_gen);
+	spin_unlock_irqrestore(&cc->lock, flags);
+}
+
+/* Returns every cached IOVA to the bitmap */
+static void fast_iova_cache_drain(struct dma_fast_smmu_mapping *mapping)
+{
+	struct fast_iova_cpu_cache *cc;
+	struct fast_iova_depot *depot;
+	unsigned long flags;
+	int cpu, i, order;
+
+	for_each_possible_cpu(cpu) {
+		cc = per_cpu_ptr(mapping->iova_cache, cpu);
+		spin_lock_irqsave(&cc->lock, flags);
+		spin_lock(&mapping->lock);
+		for (order = 0; order < FAST_IOVA_CACHE_ORDERS; order++) {
+			__fast_iova_mag_drain(mapping, cc->clean[order], order);
+			__fast_iova_mag_drain(mapping, cc->dirty[order], order);
+		}
+		spin_unlock(&mapping->lock);
+		spin_unlock_irqrestore(&cc->lock, flags);
+	}
+
+	spin_lock_irqsave(&mapping->lock, flags);
+	for (order = 0; order < FAST_IOVA_CACHE_ORDERS; order++) {
+		depot = &mapping->iova_depot[order];
+		for (i = 0; i < depot->nr_full; i++)
+			__fast_iova_mag_drain(mapping, depot->mags[i], order);
+		depot->nr_full = 0;
+	}
+	spin_unlock_irqrestore(&mapping->lock, flags);
+}
+
+static dma_addr_t __fast_smmu_alloc_iova(struct dma_fast_smmu_mapping *mapping,
+					 unsigned long attrs,
+					 size_t size)
+{
+	unsigned long bit, nbits, align, flags;
+	unsigned long guard_len;
+	unsigned int order;
+	dma_addr_t iova;
+
+	if (mapping->min_iova_align)
+		guard_len = ALIGN(size, mapping->min_iova_align) - size;
+	else
+		guard_len = 0;
+
+	nbits = (size + guard_len) >> FAST_PAGE_SHIFT;
+	order = get_order(size + guard_len);
+	align = (1 << order) - 1;
+
+	/* Cached IOVAs always span their whole size class */
+	if (mapping->iova_cache && order < FAST_IOVA_CACHE_ORDERS) {
+		nbits = 1UL << order;
+		if (fast_iova_cache_get(mapping, order, &bit))
+			goto found;
+	}
+
+	spin_lock_irqsave(&mapping->lock, flags);
+	bit = __fast_smmu_alloc_bits(mapping, attrs, nbits, align);
+	spin_unlock_irqrestore(&mapping->lock, flags);
+
+	if (unlikely(bit == ULONG_MAX) && mapping->iova_cache) {
+		fast_iova_cache_drain(mapping);
+		spin_lock_irqsave(&mapping->lock, flags);
+		bit = __fast_smmu_alloc_bits(mapping, attrs, nbits, align);
+		spin_unlock_irqrestore(&mapping->lock, flags);
+	}
+
+	if (unlikely(bit == ULONG_MAX))
+		return DMA_ERROR_CODE;
+
+found:
+	iova =  (bit << FAST_PAGE_SHIFT) + mapping->base;
+	if (guard_len &&
+		iommu_map(mapping->domain, iova + size,
+			page_to_phys(mapping->guard_page),
+			guard_len, ARM_SMMU_GUARD_PROT)) {
+
+		spin_lock_irqsave(&mapping->lock, flags);
+		__fast_smmu_free_bits(mapping, bit, nbits);
+		spin_unlock_irqrestore(&mapping->lock, flags);
+		return DMA_ERROR_CODE;
+	}
+	return iova;
+}
+
 static void __fast_smmu_free_iova(struct dma_fast_smmu_mapping *mapping,
 				  dma_addr_t iova, size_t size)
 {
 	unsigned long start_bit = (iova - mapping->base) >> FAST_PAGE_SHIFT;
-	unsigned long nbits;
+	unsigned long nbits, flags;
 	unsigned long guard_len;
+	unsigned int order;
 
 	if (mapping->min_iova_align) {
 		guard_len = ALIGN(size, mapping->min_iova_align) - size;
@@ -293,19 +545,16 @@ static void __fast_smmu_free_iova(struct dma_fast_smmu_mapping *mapping,
 		guard_len = 0;
 	}
 	nbits = (size + guard_len) >> FAST_PAGE_SHIFT;
+	order = get_order(size + guard_len);
 
+	if (mapping->iova_cache && order < FAST_IOVA_CACHE_ORDERS) {
+		fast_iova_cache_put(mapping, order, start_bit);
+		return;
+	}
 
-	/*
-	 * We don't invalidate TLBs on unmap.  We invalidate TLBs on map
-	 * when we're about to re-allocate a VA that was previously
-	 * unmapped but hasn't yet been invalidated.  So we need to keep
-	 * track of which bit is the closest to being re-allocated here.
-	 */
-	if (__bit_is_sooner(start_bit, mapping))
-		mapping->upcoming_stale_bit = start_bit;
-
-	bitmap_clear(mapping->bitmap, start_bit, nbits);
-	mapping->have_stale_tlbs = true;
+	spin_lock_irqsave(&mapping->lock, flags);
+	__fast_smmu_free_bits(mapping, start_bit, nbits);
+	spin_unlock_irqrestore(&mapping->lock, flags);
 }
 
 
@@ -349,7 +598,6 @@ static dma_addr_t fast_smmu_map_page(struct device *dev, struct page *page,
 {
 	struct dma_fast_smmu_mapping *mapping = dev->archdata.mapping->fast;
 	dma_addr_t iova;
-	unsigned long flags;
 	phys_addr_t phys_plus_off = page_to_phys(page) + offset;
 	phys_addr_t phys_to_map = round_down(phys_plus_off, FAST_PAGE_SIZE);
 	unsigned long offset_from_phys_to_map = phys_plus_off & ~FAST_PAGE_MASK;
@@ -364,27 +612,19 @@ static dma_addr_t fast_smmu_map_page(struct device *dev, struct page *page,
 		__fast_dma_page_cpu_to_dev(phys_to_page(phys_to_map),
 					   offset_from_phys_to_map, size, dir);
 
-	spin_lock_irqsave(&mapping->lock, flags);
-
 	iova = __fast_smmu_alloc_iova(mapping, attrs, len);
 
 	if (unlikely(iova == DMA_ERROR_CODE))
-		goto fail;
+		return DMA_ERROR_CODE;
 
 	if (unlikely(av8l_fast_map_public(mapping->pgtbl_ops, iova,
-					  phys_to_map, len, prot)))
-		goto fail_free_iova;
-
-	spin_unlock_irqrestore(&mapping->lock, flags);
+					  phys_to_map, len, prot))) {
+		__fast_smmu_free_iova(mapping, iova, len);
+		return DMA_ERROR_CODE;
+	}
 
 	trace_map(mapping->domain, iova, phys_to_map, len, prot);
 	return iova + offset_from_phys_to_map;
-
-fail_free_iova:
-	__fast_smmu_free_iova(mapping, iova, size);
-fail:
-	spin_unlock_irqrestore(&mapping->lock, flags);
-	return DMA_ERROR_CODE;
 }
 
 static void fast_smmu_unmap_page(struct device *dev, dma_addr_t iova,
@@ -392,7 +632,6 @@ static void fast_smmu_unmap_page(struct device *dev, dma_addr_t iova,
 			       unsigned long attrs)
 {
 	struct dma_fast_smmu_mapping *mapping = dev->archdata.mapping->fast;
-	unsigned long flags;
 	unsigned long offset = iova & ~FAST_PAGE_MASK;
 	size_t len = ALIGN(size + offset, FAST_PAGE_SIZE);
 	bool skip_sync = (attrs & DMA_ATTR_SKIP_CPU_SYNC);
@@ -408,10 +647,8 @@ static void fast_smmu_unmap_page(struct device *dev, dma_addr_t iova,
 						size, dir);
 	}
 
-	spin_lock_irqsave(&mapping->lock, flags);
 	av8l_fast_unmap_public(mapping->pgtbl_ops, iova, len);
 	__fast_smmu_free_iova(mapping, iova - offset, len);
-	spin_unlock_irqrestore(&mapping->lock, flags);
 
 	trace_unmap(mapping->domain, iova - offset, len, len);
 }
@@ -522,7 +759,6 @@ static void *fast_smmu_alloc(struct device *dev, size_t size,
 	struct sg_table sgt;
 	dma_addr_t dma_addr, iova_iter;
 	void *addr;
-	unsigned long flags;
 	struct sg_mapping_iter miter;
 	size_t count = ALIGN(size, SZ_4K) >> PAGE_SHIFT;
 	int prot = IOMMU_READ | IOMMU_WRITE; /* TODO: extract from attrs */
@@ -568,11 +804,9 @@ static void *fast_smmu_alloc(struct device *dev, size_t size,
 		sg_miter_stop(&miter);
 	}
 
-	spin_lock_irqsave(&mapping->lock, flags);
 	dma_addr = __fast_smmu_alloc_iova(mapping, attrs, size);
 	if (dma_addr == DMA_ERROR_CODE) {
 		dev_err(dev, "no iova\n");
-		spin_unlock_irqrestore(&mapping->lock, flags);
 		goto out_free_sg;
 	}
 	iova_iter = dma_addr;
@@ -584,13 +818,13 @@ static void *fast_smmu_alloc(struct device *dev, size_t size,
 				     page_to_phys(miter.page),
 				     miter.length, prot))) {
 			dev_err(dev, "no map public\n");
+			sg_miter_stop(&miter);
 			/* TODO: unwind previously successful mappings */
 			goto out_free_iova;
 		}
 		iova_iter += miter.length;
 	}
 	sg_miter_stop(&miter);
-	spin_unlock_irqrestore(&mapping->lock, flags);
 
 	addr = dma_common_pages_remap(pages, size, VM_USERMAP, remap_prot,
 				      __builtin_return_address(0));
@@ -604,12 +838,9 @@ static void *fast_smmu_alloc(struct device *dev, size_t size,
 	return addr;
 
 out_unmap:
-	/* need to take the lock again for page tables and iova */
-	spin_lock_irqsave(&mapping->lock, flags);
 	av8l_fast_unmap_public(mapping->pgtbl_ops, dma_addr, size);
 out_free_iova:
 	__fast_smmu_free_iova(mapping, dma_addr, size);
-	spin_unlock_irqrestore(&mapping->lock, flags);
 out_free_sg:
 	sg_free_table(&sgt);
 out_free_pages:
@@ -625,7 +856,6 @@ static void fast_smmu_free(struct device *dev, size_t size,
 	struct vm_struct *area;
 	struct page **pages;
 	size_t count = ALIGN(size, SZ_4K) >> FAST_PAGE_SHIFT;
-	unsigned long flags;
 
 	size = ALIGN(size, SZ_4K);
 
@@ -635,10 +865,8 @@ static void fast_smmu_free(struct device *dev, size_t size,
 
 	pages = area->pages;
 	dma_common_free_remap(vaddr, size, VM_USERMAP, false);
-	spin_lock_irqsave(&mapping->lock, flags);
 	av8l_fast_unmap_public(mapping->pgtbl_ops, dma_handle, size);
 	__fast_smmu_free_iova(mapping, dma_handle, size);
-	spin_unlock_irqrestore(&mapping->lock, flags);
 	__fast_smmu_free_pages(pages, count);
 }
 
@@ -695,11 +923,8 @@ static dma_addr_t fast_smmu_dma_map_resource(
 	size_t len = round_up(size + offset, FAST_PAGE_SIZE);
 	dma_addr_t dma_addr;
 	int prot;
-	unsigned long flags;
 
-	spin_lock_irqsave(&mapping->lock, flags);
 	dma_addr = __fast_smmu_alloc_iova(mapping, attrs, len);
-	spin_unlock_irqrestore(&mapping->lock, flags);
 
 	if (dma_addr == DMA_ERROR_CODE)
 		return dma_addr;
@@ -709,9 +934,7 @@ static dma_addr_t fast_smmu_dma_map_resource(
 
 	if (iommu_map(mapping->domain, dma_addr, phys_addr - offset,
 			len, prot)) {
-		spin_lock_irqsave(&mapping->lock, flags);
 		__fast_smmu_free_iova(mapping, dma_addr, len);
-		spin_unlock_irqrestore(&mapping->lock, flags);
 		return DMA_ERROR_CODE;
 	}
 	return dma_addr + offset;
@@ -725,12 +948,9 @@ static void fast_smmu_dma_unmap_resource(
 	struct dma_fast_smmu_mapping *mapping = dev->archdata.mapping->fast;
 	size_t offset = addr & ~FAST_PAGE_MASK;
 	size_t len = round_up(size + offset, FAST_PAGE_SIZE);
-	unsigned long flags;
 
 	iommu_unmap(mapping->domain, addr - offset, len);
-	spin_lock_irqsave(&mapping->lock, flags);
 	__fast_smmu_free_iova(mapping, addr - offset, len);
-	spin_unlock_irqrestore(&mapping->lock, flags);
 }
 
 static int fast_smmu_mapping_error(struct device *dev,
@@ -794,6 +1014,52 @@ static const struct dma_map_ops fast_smmu_dma_ops = {
 	.mapping_error = fast_smmu_mapping_error,
 };
 
+static void fast_smmu_free_iova_cache(struct dma_fast_smmu_mapping *fast)
+{
+	free_percpu(fast->iova_cache);
+	kfree(fast->iova_depot);
+	kvfree(fast->iova_mags);
+	fast->iova_cache = NULL;
+}
+
+/*
+ * Without the IOVA cache everything goes through the bitmap, so failing
+ * to set it up isn't fatal.
+ */
+static void fast_smmu_init_iova_cache(struct dma_fast_smmu_mapping *fast)
+{
+	struct fast_iova_cpu_cache *cc;
+	struct fast_iova_mag *mag;
+	int cpu, i, order;
+
+	fast->iova_mags = kvmalloc_array(FAST_IOVA_CACHE_ORDERS *
+					 (2 * num_possible_cpus() +
+					  FAST_IOVA_DEPOT_SIZE),
+					 sizeof(*mag), GFP_KERNEL | __GFP_ZERO);
+	fast->iova_depot = kcalloc(FAST_IOVA_CACHE_ORDERS,
+				   sizeof(*fast->iova_depot), GFP_KERNEL);
+	fast->iova_cache = alloc_percpu(struct fast_iova_cpu_cache);
+	if (!fast->iova_mags || !fast->iova_depot || !fast->iova_cache) {
+		fast_smmu_free_iova_cache(fast);
+		return;
+	}
+
+	mag = fast->iova_mags;
+	for (order = 0; order < FAST_IOVA_CACHE_ORDERS; order++) {
+		for (i = 0; i < FAST_IOVA_DEPOT_SIZE; i++)
+			fast->iova_depot[order].mags[i] = mag++;
+	}
+
+	for_each_possible_cpu(cpu) {
+		cc = per_cpu_ptr(fast->iova_cache, cpu);
+		spin_lock_init(&cc->lock);
+		for (order = 0; order < FAST_IOVA_CACHE_ORDERS; order++) {
+			cc->clean[order] = mag++;
+			cc->dirty[order] = mag++;
+		}
+	}
+}
+
 /**
  * __fast_smmu_create_mapping_sized
  * @base: bottom of the VA range
@@ -829,6 +1095,7 @@ static struct dma_fast_smmu_mapping *__fast_smmu_create_mapping_sized(
 		goto err2;
 
 	spin_lock_init(&fast->lock);
+	fast_smmu_init_iova_cache(fast);
 
 	return fast;
 err2:
@@ -954,6 +1221,7 @@ int fast_smmu_init_mapping(struct device *dev,
 	return 0;
 
 release_mapping:
+	fast_smmu_free_iova_cache(mapping->fast);
 	kfree(mapping->fast->bitmap);
 	kfree(mapping->fast);
 	return err;
@@ -970,6 +1238,7 @@ void fast_smmu_release_mapping(struct kref *kref)
 	struct dma_iommu_mapping *mapping =
 		container_of(kref, struct dma_iommu_mapping, kref);
 
+	fast_smmu_free_iova_cache(mapping->fast);
 	kvfree(mapping->fast->bitmap);
 	kfree(mapping->fast);
 	iommu_domain_free(mapping->domain);
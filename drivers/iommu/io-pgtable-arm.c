@@ -624,6 +624,37 @@ static int arm_lpae_map(struct io_pgtable_ops *ops, unsigned long iova,
 	return ret;
 }
 
+/*
+ * Maps @size bytes at @iova into the last-level table held in @ms. Returns
+ * the number of bytes mapped, which is short if a PTE was already valid.
+ */
+static size_t arm_lpae_map_run(struct arm_lpae_io_pgtable *data,
+			    struct map_state *ms, unsigned long iova,
+			    phys_addr_t paddr, size_t size, arm_lpae_iopte prot)
+{
+	arm_lpae_iopte *ptep = ms->pgtable +
+		ARM_LPAE_LVL_IDX(iova, MAP_STATE_LVL, data);
+	size_t pgsize = ARM_LPAE_GRANULE(data);
+	unsigned int i, nptes = size / pgsize;
+
+	for (i = 0; i < nptes; i++) {
+		/* We require an unmap first */
+		if (ptep[i] & ARM_LPAE_PTE_VALID) {
+			WARN_RATELIMIT(1, "map without unmap\n");
+			break;
+		}
+
+		__arm_lpae_init_pte(data, paddr + i * pgsize, prot,
+				    MAP_STATE_LVL, &ptep[i], false);
+	}
+
+	if (ms->prev_pgtable)
+		iopte_tblcnt_add(ms->prev_pgtable, i);
+	ms->num_pte += i;
+
+	return i * pgsize;
+}
+
 static int arm_lpae_map_sg(struct io_pgtable_ops *ops, unsigned long iova,
 			   struct scatterlist *sg, unsigned int nents,
 			   int iommu_prot, size_t *size)
@@ -668,13 +699,20 @@ static int arm_lpae_map_sg(struct io_pgtable_ops *ops, unsigned long iova,
 				cfg->pgsize_bitmap, iova | phys, size);
 
 			if (ms.pgtable && (iova < ms.iova_end)) {
-				arm_lpae_iopte *ptep = ms.pgtable +
-					ARM_LPAE_LVL_IDX(iova, MAP_STATE_LVL,
-							 data);
-				arm_lpae_init_pte(
-					data, iova, phys, prot, MAP_STATE_LVL,
-					ptep, ms.prev_pgtable, false);
-				ms.num_pte++;
+				/*
+				 * Fill the rest of the segment that falls in
+				 * the current table as one run of PTEs.
+				 */
+				size_t run = min_t(size_t, size,
+						   ms.iova_end - iova);
+
+				pgsize = arm_lpae_map_run(data, &ms, iova,
+							  phys, run, prot);
+				if (pgsize != run) {
+					mapped += pgsize;
+					ret = -EEXIST;
+					goto out_err;
+				}
 			} else {
 				ret = __arm_lpae_map(data, iova, phys, pgsize,
 						prot, lvl, ptep, NULL, &ms);
@@ -884,6 +922,35 @@ static int __arm_lpae_unmap(struct arm_lpae_io_pgtable *data,
 	return __arm_lpae_unmap(data, iova, size, lvl + 1, ptep);
 }
 
+/*
+ * Past this many granules it is cheaper to invalidate the whole context than
+ * to post one invalidate per granule.
+ */
+#define ARM_LPAE_TLBI_RANGE_MAX		64
+
+/*
+ * Invalidates everything an unmap of [@iova, @iova + @size) may have left in
+ * the TLB. The unmap can free tables as well as leaves, so walk caches are
+ * invalidated too.
+ */
+static void arm_lpae_tlb_inv_range(struct arm_lpae_io_pgtable *data,
+				   unsigned long iova, size_t size)
+{
+	size_t granule = ARM_LPAE_GRANULE(data);
+
+	if (!size)
+		return;
+
+	if (size > ARM_LPAE_TLBI_RANGE_MAX * granule) {
+		io_pgtable_tlb_flush_all(&data->iop);
+		return;
+	}
+
+	io_pgtable_tlb_add_flush(&data->iop, round_down(iova, granule),
+				 ALIGN(size, granule), granule, false);
+	io_pgtable_tlb_sync(&data->iop);
+}
+
 static size_t arm_lpae_unmap(struct io_pgtable_ops *ops, unsigned long iova,
 			  size_t size)
 {
@@ -911,8 +978,7 @@ static size_t arm_lpae_unmap(struct io_pgtable_ops *ops, unsigned long iova,
 		unmapped += ret;
 		iova += ret;
 	}
-	if (unmapped)
-		io_pgtable_tlb_flush_all(&data->iop);
+	arm_lpae_tlb_inv_range(data, iova - unmapped, unmapped);
 
 	return unmapped;
 }
@@ -189,15 +189,19 @@ void av8l_fast_clear_stale_ptes(struct io_pgtable_ops *ops, u64 base,
 {
 	int i;
 	struct av8l_fast_io_pgtable *data = iof_pgtable_ops_to_data(ops);
-	av8l_fast_iopte *pmdp = iopte_pmd_offset(pmds, base, start);
+	av8l_fast_iopte *pmdp = iopte_pmd_offset(data->pmds, base, start);
 
 	for (i = start >> AV8L_FAST_PAGE_SHIFT;
 			i <= (end >> AV8L_FAST_PAGE_SHIFT); ++i) {
-		if (!(*pmdp & AV8L_FAST_PTE_VALID)) {
-			*pmdp = 0;
-			if (!skip_sync)
-				dmac_clean_range(pmdp, pmdp + 1);
-		}
+		av8l_fast_iopte pte = READ_ONCE(*pmdp);
+
+		/*
+		 * Callers map and unmap without a common lock, so only clear
+		 * the marker if nobody mapped over it in the meantime.
+		 */
+		if (pte && !(pte & AV8L_FAST_PTE_VALID) &&
+		    cmpxchg64_relaxed(pmdp, pte, 0) == pte && !skip_sync)
+			dmac_clean_range(pmdp, pmdp + 1);
 		pmdp++;
 	}
 }
@@ -274,6 +274,15 @@ static int nr_iters_get(void *data, u64 *val)
 DEFINE_SIMPLE_ATTRIBUTE(iommu_debug_nr_iters_ops,
 			nr_iters_get, nr_iters_set, "%llu\n");
 
+/* Throughput in MB/s of an operation on @size bytes that took @ns */
+static u64 iommu_debug_mbps(size_t size, u64 ns)
+{
+	if (!ns)
+		return 0;
+
+	return div64_u64((u64)size * NSEC_PER_SEC, ns * SZ_1M);
+}
+
 static void iommu_debug_device_profiling(struct seq_file *s, struct device *dev,
 					 enum iommu_attr attrs[],
 					 void *attr_values[], int nattrs,
@@ -315,7 +324,8 @@ static void iommu_debug_device_profiling(struct seq_file *s, struct device *dev,
 	}
 
 	seq_printf(s, "(average over %d iterations)\n", iters_per_op);
-	seq_printf(s, "%8s %19s %16s\n", "size", "iommu_map", "iommu_unmap");
+	seq_printf(s, "%8s %19s %16s %10s %10s\n", "size", "iommu_map",
+		   "iommu_unmap", "map MB/s", "unmap MB/s");
 	for (sz = sizes; *sz; ++sz) {
 		size_t size = *sz;
 		size_t unmapped;
@@ -359,14 +369,17 @@ static void iommu_debug_device_profiling(struct seq_file *s, struct device *dev,
 		unmap_elapsed_us = div_u64_rem(unmap_elapsed_ns, 1000,
 						&unmap_elapsed_rem);
 
-		seq_printf(s, "%8s %12lld.%03d us %9lld.%03d us\n",
+		seq_printf(s, "%8s %12lld.%03d us %9lld.%03d us %10llu %10llu\n",
 			_size_to_string(size),
 			map_elapsed_us, map_elapsed_rem,
-			unmap_elapsed_us, unmap_elapsed_rem);
+			unmap_elapsed_us, unmap_elapsed_rem,
+			iommu_debug_mbps(size, map_elapsed_ns),
+			iommu_debug_mbps(size, unmap_elapsed_ns));
 	}
 
 	seq_putc(s, '\n');
-	seq_printf(s, "%8s %19s %16s\n", "size", "iommu_map_sg", "iommu_unmap");
+	seq_printf(s, "%8s %19s %16s %10s %10s\n", "size", "iommu_map_sg",
+		   "iommu_unmap", "map MB/s", "unmap MB/s");
 	for (sz = sizes; *sz; ++sz) {
 		size_t size = *sz;
 		size_t unmapped;
@@ -419,10 +432,12 @@ static void iommu_debug_device_profiling(struct seq_file *s, struct device *dev,
 		unmap_elapsed_us = div_u64_rem(unmap_elapsed_ns, 1000,
 						&unmap_elapsed_rem);
 
-		seq_printf(s, "%8s %12lld.%03d us %9lld.%03d us\n",
+		seq_printf(s, "%8s %12lld.%03d us %9lld.%03d us %10llu %10llu\n",
 			_size_to_string(size),
 			map_elapsed_us, map_elapsed_rem,
-			unmap_elapsed_us, unmap_elapsed_rem);
+			unmap_elapsed_us, unmap_elapsed_rem,
+			iommu_debug_mbps(size, map_elapsed_ns),
+			iommu_debug_mbps(size, unmap_elapsed_ns));
 
 next:
 		iommu_debug_destroy_phoney_sg_table(dev, &table, chunk_size);
@@ -306,6 +306,44 @@ static int fec_read_bufs(struct dm_verity *v, struct dm_verity_io *io,
 	return target_index;
 }
 
+/*
+ * Start reading all data and parity blocks needed to decode an RS block.
+ * The data blocks are interleaved over the whole device, so fec_read_bufs()
+ * waiting for each of them in turn would otherwise stall the read for as
+ * many seeks as there are blocks.
+ */
+static void fec_prefetch_rsb(struct dm_verity *v, u64 rsb)
+{
+	struct blk_plug plug;
+	u64 block, first, last;
+	int i;
+
+	blk_start_plug(&plug);
+
+	for (i = 0; i < v->fec->rsn; i++) {
+		block = fec_interleave(v, rsb * v->fec->rsn + i) >>
+			v->data_dev_block_bits;
+
+		if (block < v->data_blocks) {
+			dm_bufio_prefetch(v->fec->data_bufio, block, 1);
+			continue;
+		}
+
+		block -= v->data_blocks;
+		if (block < v->fec->hash_blocks)
+			dm_bufio_prefetch(v->bufio, v->hash_start + block, 1);
+	}
+
+	/* parity bytes for all RS blocks of a data block are contiguous */
+	first = (rsb * v->fec->roots) >> v->data_dev_block_bits;
+	last = ((rsb + (1 << v->data_dev_block_bits)) * v->fec->roots - 1) >>
+		v->data_dev_block_bits;
+	dm_bufio_prefetch(v->fec->bufio, v->fec->start + first,
+			  last - first + 1);
+
+	blk_finish_plug(&plug);
+}
+
 /*
  * Allocate RS control structure and FEC buffers from preallocated mempools,
  * and attempt to allocate as many extra buffers as available.
@@ -463,6 +501,8 @@ int verity_fec_decode(struct dm_verity *v, struct dm_verity_io *io,
 	 */
 	rsb = offset - res * (v->fec->rounds << v->data_dev_block_bits);
 
+	fec_prefetch_rsb(v, rsb);
+
 	/*
 	 * Locating erasures is slow, so attempt to recover the block without
 	 * them first. Do a second attempt with erasures if the corruption is
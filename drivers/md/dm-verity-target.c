@@ -28,6 +28,8 @@
 #define DM_VERITY_DEFAULT_PREFETCH_SIZE	262144
 
 #define DM_VERITY_MAX_CORRUPTED_ERRS	100
+#define DM_VERITY_DEFAULT_PART_BLOCKS	32
+#define DM_VERITY_MAX_PARTS		8
 
 #define DM_VERITY_OPT_LOGGING		"ignore_corruption"
 #define DM_VERITY_OPT_RESTART		"restart_on_corruption"
@@ -40,6 +42,11 @@ static unsigned dm_verity_prefetch_cluster = DM_VERITY_DEFAULT_PREFETCH_SIZE;
 
 module_param_named(prefetch_cluster, dm_verity_prefetch_cluster, uint, S_IRUGO | S_IWUSR);
 
+/* Blocks per part when a large io is verified on several cpus, 0 disables */
+static unsigned dm_verity_part_blocks = DM_VERITY_DEFAULT_PART_BLOCKS;
+
+module_param_named(part_blocks, dm_verity_part_blocks, uint, S_IRUGO | S_IWUSR);
+
 struct dm_verity_prefetch_work {
 	struct work_struct work;
 	struct dm_verity *v;
@@ -84,6 +91,16 @@ static void dm_bufio_alloc_callback(struct dm_buffer *buf)
 /*
  * Translate input sector number to the sector number on the target device.
  */
+/*
+ * The bio an io, or the io a part belongs to, was submitted for.
+ */
+static inline struct bio *verity_io_bio(struct dm_verity *v,
+					struct dm_verity_io *io)
+{
+	return dm_bio_from_per_bio_data(io->parent ? io->parent : io,
+					v->ti->per_io_data_size);
+}
+
 static sector_t verity_map_sector(struct dm_verity *v, sector_t bi_sector)
 {
 	return v->data_start + dm_target_offset(v->ti, bi_sector);
@@ -361,7 +378,11 @@ static int verity_verify_level(struct dm_verity *v, struct dm_verity_io *io,
 		if (likely(memcmp(verity_io_real_digest(v, io), want_digest,
 				  v->digest_size) == 0))
 			aux->hash_verified = 1;
-		else if (verity_fec_decode(v, io,
+		else if (io->parent) {
+			/* Leave recovery to the serial pass over the io */
+			r = -EIO;
+			goto release_ret_r;
+		} else if (verity_fec_decode(v, io,
 					   DM_VERITY_BLOCK_TYPE_METADATA,
 					   hash_block, data, NULL) == 0)
 			aux->hash_verified = 1;
@@ -427,7 +448,7 @@ int verity_for_io_block(struct dm_verity *v, struct dm_verity_io *io,
 			struct bvec_iter *iter, struct verity_result *res)
 {
 	unsigned int todo = 1 << v->data_dev_block_bits;
-	struct bio *bio = dm_bio_from_per_bio_data(io, v->ti->per_io_data_size);
+	struct bio *bio = verity_io_bio(v, io);
 	struct scatterlist sg;
 	struct ahash_request *req = verity_io_hash_req(v, io);
 
@@ -474,7 +495,7 @@ int verity_for_bv_block(struct dm_verity *v, struct dm_verity_io *io,
 				       size_t len))
 {
 	unsigned todo = 1 << v->data_dev_block_bits;
-	struct bio *bio = dm_bio_from_per_bio_data(io, v->ti->per_io_data_size);
+	struct bio *bio = verity_io_bio(v, io);
 
 	do {
 		int r;
@@ -515,7 +536,7 @@ static inline void verity_bv_skip_block(struct dm_verity *v,
 					struct dm_verity_io *io,
 					struct bvec_iter *iter)
 {
-	struct bio *bio = dm_bio_from_per_bio_data(io, v->ti->per_io_data_size);
+	struct bio *bio = verity_io_bio(v, io);
 
 	bio_advance_iter(bio, iter, 1 << v->data_dev_block_bits);
 }
@@ -581,6 +602,8 @@ static int verity_verify_io(struct dm_verity_io *io)
 				set_bit(cur_block, v->validated_blocks);
 			continue;
 		}
+		else if (io->parent)
+			return -EIO;
 		else if (verity_fec_decode(v, io, DM_VERITY_BLOCK_TYPE_DATA,
 					   cur_block, NULL, &start) == 0)
 			continue;
@@ -608,10 +631,99 @@ static void verity_finish_io(struct dm_verity_io *io, blk_status_t status)
 	bio_endio(bio);
 }
 
+/*
+ * Finish one part of an io. The last part to finish ends the io; if any
+ * part failed, the whole io is verified again serially so that errors go
+ * through forward error correction and the configured error handling.
+ */
+static void verity_part_work(struct work_struct *w)
+{
+	struct dm_verity_io *part = container_of(w, struct dm_verity_io, work);
+	struct dm_verity_io *io = part->parent;
+
+	if (verity_verify_io(part))
+		WRITE_ONCE(io->parts_failed, 1);
+
+	kfree(part);
+
+	if (!atomic_dec_and_test(&io->parts_pending))
+		return;
+
+	if (READ_ONCE(io->parts_failed))
+		verity_finish_io(io, errno_to_blk_status(verity_verify_io(io)));
+	else
+		verity_finish_io(io, BLK_STS_OK);
+}
+
+/*
+ * Split a large io into parts and queue them, so that the blocks of one
+ * readahead get hashed on several cpus. Returns false if the io should be
+ * verified serially instead.
+ */
+static bool verity_split_io(struct dm_verity_io *io)
+{
+	struct dm_verity *v = io->v;
+	struct bio *bio = verity_io_bio(v, io);
+	struct dm_verity_io *parts[DM_VERITY_MAX_PARTS];
+	unsigned part_blocks = READ_ONCE(dm_verity_part_blocks);
+	struct bvec_iter iter = io->iter;
+	sector_t block = io->block;
+	unsigned n_parts, i;
+
+	if (!part_blocks || io->n_blocks < 2 * part_blocks ||
+	    num_online_cpus() < 2)
+		return false;
+
+	n_parts = min_t(unsigned, DIV_ROUND_UP(io->n_blocks, part_blocks),
+			DM_VERITY_MAX_PARTS);
+	part_blocks = DIV_ROUND_UP(io->n_blocks, n_parts);
+
+	for (i = 0; i < n_parts; i++) {
+		parts[i] = kmalloc(sizeof(struct dm_verity_io) +
+				   v->ahash_reqsize + v->digest_size * 2,
+				   GFP_NOIO | __GFP_NORETRY |
+				   __GFP_NOMEMALLOC | __GFP_NOWARN);
+		if (!parts[i]) {
+			while (i--)
+				kfree(parts[i]);
+			return false;
+		}
+	}
+
+	atomic_set(&io->parts_pending, n_parts);
+	io->parts_failed = 0;
+
+	for (i = 0; i < n_parts; i++) {
+		struct dm_verity_io *part = parts[i];
+
+		part->v = v;
+		part->parent = io;
+		part->block = block;
+		part->n_blocks = min_t(unsigned, part_blocks,
+				       io->block + io->n_blocks - block);
+		part->iter = iter;
+		INIT_WORK(&part->work, verity_part_work);
+
+		block += part->n_blocks;
+		bio_advance_iter(bio, &iter,
+				 part->n_blocks << v->data_dev_block_bits);
+	}
+
+	/* Keep the first part on this cpu */
+	for (i = 1; i < n_parts; i++)
+		queue_work(v->verify_wq, &parts[i]->work);
+	verity_part_work(&parts[0]->work);
+
+	return true;
+}
+
 static void verity_work(struct work_struct *w)
 {
 	struct dm_verity_io *io = container_of(w, struct dm_verity_io, work);
 
+	if (verity_split_io(io))
+		return;
+
 	verity_finish_io(io, errno_to_blk_status(verity_verify_io(io)));
 }
 
@@ -715,6 +827,7 @@ int verity_map(struct dm_target *ti, struct bio *bio)
 
 	io = dm_per_bio_data(bio, ti->per_io_data_size);
 	io->v = v;
+	io->parent = NULL;
 	io->orig_bi_end_io = bio->bi_end_io;
 	io->block = bio->bi_iter.bi_sector >> (v->data_dev_block_bits - SECTOR_SHIFT);
 	io->n_blocks = bio->bi_iter.bi_size >> v->data_dev_block_bits;
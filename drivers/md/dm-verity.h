@@ -79,6 +79,14 @@ struct dm_verity_io {
 
 	struct work_struct work;
 
+	/*
+	 * Large ios are split into parts verified in parallel. A part
+	 * points to the io it belongs to, the io counts the parts left.
+	 */
+	struct dm_verity_io *parent;
+	atomic_t parts_pending;
+	int parts_failed;
+
 	/*
 	 * Three variably-size fields follow this struct:
 	 *
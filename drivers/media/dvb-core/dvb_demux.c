@@ -27,6 +27,7 @@
 #include <linux/crc32.h>
 #include <linux/uaccess.h>
 #include <asm/div64.h>
+#include <asm/unaligned.h>
 #include <linux/ratelimit.h>
 
 #include "dvb_demux.h"
@@ -561,11 +562,23 @@ static inline int dvb_dmx_swfilter_payload(struct dvb_demux_feed *feed,
 static int dvb_dmx_swfilter_sectionfilter(struct dvb_demux_feed *feed,
 					  struct dvb_demux_filter *f)
 {
-	u8 neq = 0;
+	const u8 *secbuf = feed->feed.sec.secbuf;
+	u64 neq = 0;
 	int i;
 
-	for (i = 0; i < DVB_DEMUX_MASK_MAX; i++) {
-		u8 xor = f->filter.filter_value[i] ^ feed->feed.sec.secbuf[i];
+	/* Compare a word at a time, the tail of the mask byte by byte */
+	for (i = 0; i + sizeof(u64) <= DVB_DEMUX_MASK_MAX; i += sizeof(u64)) {
+		u64 xor = get_unaligned((u64 *)&f->filter.filter_value[i]) ^
+			  get_unaligned((u64 *)&secbuf[i]);
+
+		if (get_unaligned((u64 *)&f->maskandmode[i]) & xor)
+			return 0;
+
+		neq |= get_unaligned((u64 *)&f->maskandnotmode[i]) & xor;
+	}
+
+	for (; i < DVB_DEMUX_MASK_MAX; i++) {
+		u8 xor = f->filter.filter_value[i] ^ secbuf[i];
 
 		if (f->maskandmode[i] & xor)
 			return 0;
@@ -1538,6 +1551,11 @@ static void dvb_dmx_swfilter_one_packet(struct dvb_demux *demux, const u8 *buf,
 		if (dvb_dmx_swfilter_buffer_check(demux, pid) < 0)
 			return;
 
+	/* Most packets of a multiplex belong to no feed at all */
+	if (demux->pid_feeds && !demux->pid_feeds[pid] &&
+	    !demux->pid_feeds[DMX_MAX_PID])
+		return;
+
 	list_for_each_entry(feed, &demux->feed_list, list_head) {
 		if ((feed->pid != pid) && (feed->pid != 0x2000))
 			continue;
@@ -1598,6 +1616,13 @@ static inline int find_next_packet(const u8 *buf, int pos, size_t count,
 {
 	int start = pos, lost;
 
+	/* Only the sync byte to look for, let memchr scan for it */
+	if (!leadingbytes && pktsize != 204 && pos < count) {
+		const u8 *sync = memchr(buf + pos, 0x47, count - pos);
+
+		pos = sync ? sync - buf : count;
+	}
+
 	while (pos < count) {
 		if ((buf[pos] == 0x47 && !leadingbytes) ||
 		    (pktsize == 204 && buf[pos] == 0xB8) ||
@@ -2082,17 +2107,33 @@ static int dvb_demux_feed_find(struct dvb_demux_feed *feed)
 	return 0;
 }
 
-static void dvb_demux_feed_add(struct dvb_demux_feed *feed)
+static void dvb_demux_feed_account(struct dvb_demux_feed *feed, int add)
+{
+	u16 *pid_feeds = feed->demux->pid_feeds;
+
+	if (!pid_feeds || feed->pid > DMX_MAX_PID)
+		return;
+
+	if (add)
+		pid_feeds[feed->pid]++;
+	else if (pid_feeds[feed->pid])
+		pid_feeds[feed->pid]--;
+}
+
+static void dvb_demux_feed_add(struct dvb_demux_feed *feed, u16 pid)
 {
 	spin_lock_irq(&feed->demux->lock);
 	if (dvb_demux_feed_find(feed)) {
 		pr_err("%s: feed already in list (type=%x state=%x pid=%x)\n",
 		       __func__, feed->type, feed->state, feed->pid);
+		dvb_demux_feed_account(feed, 0);
 		goto out;
 	}
 
 	list_add(&feed->list_head, &feed->demux->feed_list);
 out:
+	feed->pid = pid;
+	dvb_demux_feed_account(feed, 1);
 	spin_unlock_irq(&feed->demux->lock);
 }
 
@@ -2105,6 +2146,7 @@ static void dvb_demux_feed_del(struct dvb_demux_feed *feed)
 		goto out;
 	}
 
+	dvb_demux_feed_account(feed, 0);
 	list_del(&feed->list_head);
 out:
 	spin_unlock_irq(&feed->demux->lock);
@@ -2139,9 +2181,8 @@ static int dmx_ts_feed_set(struct dmx_ts_feed *ts_feed, u16 pid, int ts_type,
 		demux->pids[pes_type] = pid;
 	}
 
-	dvb_demux_feed_add(feed);
+	dvb_demux_feed_add(feed, pid);
 
-	feed->pid = pid;
 	feed->buffer_size = circular_buffer_size;
 	feed->timeout = timeout;
 	feed->ts_type = ts_type;
@@ -2733,9 +2774,8 @@ static int dmx_section_feed_set(struct dmx_section_feed *feed,
 	if (mutex_lock_interruptible(&dvbdmx->mutex))
 		return -ERESTARTSYS;
 
-	dvb_demux_feed_add(dvbdmxfeed);
+	dvb_demux_feed_add(dvbdmxfeed, pid);
 
-	dvbdmxfeed->pid = pid;
 	dvbdmxfeed->buffer_size = circular_buffer_size;
 	dvbdmxfeed->feed.sec.check_crc = check_crc;
 
@@ -3356,6 +3396,8 @@ int dvb_dmx_init(struct dvb_demux *dvbdemux)
 	}
 
 	dvbdemux->cnt_storage = vmalloc(MAX_PID + 1);
+	/* Without it every packet walks the feed list */
+	dvbdemux->pid_feeds = vzalloc((DMX_MAX_PID + 1) * sizeof(u16));
 
 	INIT_LIST_HEAD(&dvbdemux->frontend_list);
 
@@ -3418,6 +3460,7 @@ void dvb_dmx_release(struct dvb_demux *dvbdemux)
 
 	dvb_demux_index--;
 	vfree(dvbdemux->cnt_storage);
+	vfree(dvbdemux->pid_feeds);
 	vfree(dvbdemux->filter);
 	vfree(dvbdemux->feed);
 	vfree(dvbdemux->rec_info_pool);
@@ -265,6 +265,7 @@ struct dvb_demux {
 	spinlock_t lock;
 
 	uint8_t *cnt_storage; /* for TS continuity check */
+	u16 *pid_feeds; /* number of feeds on each pid, 0x2000 for all pids */
 
 	ktime_t speed_last_time; /* for TS speed check */
 	uint32_t speed_pkts_cnt; /* for TS speed check */
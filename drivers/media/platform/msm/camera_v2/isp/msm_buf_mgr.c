@@ -529,6 +529,7 @@ static int msm_isp_get_buf(struct msm_isp_buf_mgr *buf_mgr, uint32_t id,
 	struct msm_isp_buffer *temp_buf_info = NULL;
 	struct msm_isp_bufq *bufq = NULL;
 	struct vb2_v4l2_buffer *vb2_v4l2_buf = NULL;
+	uint32_t session_id, stream_id;
 
 	if (buf_mgr->open_count == 0) {
 		pr_err_ratelimited("%s: bug mgr open cnt = 0\n",
@@ -572,12 +573,29 @@ static int msm_isp_get_buf(struct msm_isp_buf_mgr *buf_mgr, uint32_t id,
 		}
 		break;
 	case MSM_ISP_BUFFER_SRC_HAL:
+		/*
+		 * The vb2 queue has a lock of its own, don't keep irqs off
+		 * while it is searched. Whether the bufq went away meanwhile
+		 * is checked once the lock is back.
+		 */
+		session_id = bufq->session_id;
+		stream_id = bufq->stream_id;
+		spin_unlock_irqrestore(&bufq->bufq_lock, flags);
 		if (buf_index == MSM_ISP_INVALID_BUF_INDEX)
 			vb2_v4l2_buf = buf_mgr->vb2_ops->get_buf(
-				bufq->session_id, bufq->stream_id);
+				session_id, stream_id);
 		else
 			vb2_v4l2_buf = buf_mgr->vb2_ops->get_buf_by_idx(
-				bufq->session_id, bufq->stream_id,  buf_index);
+				session_id, stream_id, buf_index);
+		spin_lock_irqsave(&bufq->bufq_lock, flags);
+		if (bufq->bufq_handle != bufq_handle) {
+			spin_unlock_irqrestore(&bufq->bufq_lock, flags);
+			if (vb2_v4l2_buf)
+				buf_mgr->vb2_ops->put_buf(vb2_v4l2_buf,
+					session_id, stream_id);
+			pr_err_ratelimited("%s: bufq released\n", __func__);
+			return rc;
+		}
 		if (vb2_v4l2_buf) {
 			if (vb2_v4l2_buf->vb2_buf.index < bufq->num_bufs) {
 				*buf_info = &bufq->bufs[vb2_v4l2_buf
@@ -744,11 +762,13 @@ static int msm_isp_buf_divert(struct msm_isp_buf_mgr *buf_mgr,
 	if (buf_info->state == MSM_ISP_BUFFER_STATE_DEQUEUED) {
 		buf_info->state = MSM_ISP_BUFFER_STATE_DIVERTED;
 		buf_info->tv = tv;
+		buf_info->done_ts = ktime_get();
 	}
 #else
 	if (BUF_SRC(bufq->stream_id) == MSM_ISP_BUFFER_SRC_NATIVE) {
 		buf_info->state = MSM_ISP_BUFFER_STATE_DIVERTED;
 		buf_info->tv = tv;
+		buf_info->done_ts = ktime_get();
 	}
 #endif
 	spin_unlock_irqrestore(&bufq->bufq_lock, flags);
@@ -839,6 +859,7 @@ static int msm_isp_buf_done(struct msm_isp_buf_mgr *buf_mgr,
 	if (BUF_SRC(bufq->stream_id) == MSM_ISP_BUFFER_SRC_HAL) {
 		if (state == MSM_ISP_BUFFER_STATE_DEQUEUED) {
 			buf_info->state = MSM_ISP_BUFFER_STATE_DISPATCHED;
+			buf_info->done_ts = ktime_get();
 			spin_unlock_irqrestore(&bufq->bufq_lock, flags);
 			buf_mgr->vb2_ops->buf_done(buf_info->vb2_v4l2_buf,
 				bufq->session_id, bufq->stream_id,
@@ -916,6 +937,30 @@ static int msm_isp_flush_buf(struct msm_isp_buf_mgr *buf_mgr,
 	return 0;
 }
 
+static void msm_isp_buf_account_return(struct msm_isp_buf_mgr *buf_mgr,
+	struct msm_isp_bufq *bufq, uint32_t buf_index)
+{
+	struct msm_isp_bufq_latency *latency = &bufq->latency;
+	struct msm_isp_buffer *buf_info;
+	unsigned long flags;
+	uint64_t us;
+
+	buf_info = msm_isp_get_buf_ptr(buf_mgr, bufq->bufq_handle, buf_index);
+	if (!buf_info)
+		return;
+
+	spin_lock_irqsave(&bufq->bufq_lock, flags);
+	if (buf_info->done_ts) {
+		us = ktime_us_delta(ktime_get(), buf_info->done_ts);
+		buf_info->done_ts = 0;
+		latency->count++;
+		latency->sum_us += us;
+		if (us > latency->max_us)
+			latency->max_us = us;
+	}
+	spin_unlock_irqrestore(&bufq->bufq_lock, flags);
+}
+
 static int msm_isp_buf_enqueue(struct msm_isp_buf_mgr *buf_mgr,
 	struct msm_isp_qbuf_info *info)
 {
@@ -937,6 +982,8 @@ static int msm_isp_buf_enqueue(struct msm_isp_buf_mgr *buf_mgr,
 		return -EINVAL;
 	}
 
+	msm_isp_buf_account_return(buf_mgr, bufq, info->buf_idx);
+
 	if (buf_state == MSM_ISP_BUFFER_STATE_DIVERTED) {
 		buf_info = msm_isp_get_buf_ptr(buf_mgr,
 						info->handle, info->buf_idx);
@@ -1089,6 +1136,7 @@ static int msm_isp_request_bufq(struct msm_isp_buf_mgr *buf_mgr,
 	bufq->buf_type = buf_request->buf_type;
 	INIT_LIST_HEAD(&bufq->head);
 	bufq->security_mode = buf_request->security_mode;
+	memset(&bufq->latency, 0, sizeof(bufq->latency));
 
 	for (i = 0; i < buf_request->num_buf; i++) {
 		bufq->bufs[i].state = MSM_ISP_BUFFER_STATE_INITIALIZED;
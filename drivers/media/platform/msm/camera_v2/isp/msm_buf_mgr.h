@@ -107,11 +107,20 @@ struct msm_isp_buffer {
 	enum msm_isp_buffer_state state;
 
 	struct msm_isp_buffer_debug_t buf_debug;
+	/* Time the buffer was handed to the client, 0 if it was not */
+	ktime_t done_ts;
 
 	/*Vb2 buffer data*/
 	struct vb2_v4l2_buffer *vb2_v4l2_buf;
 };
 
+/* Time from a buffer being done to the client queueing it back */
+struct msm_isp_bufq_latency {
+	uint64_t count;
+	uint64_t sum_us;
+	uint64_t max_us;
+};
+
 struct msm_isp_bufq {
 	uint32_t session_id;
 	uint32_t stream_id;
@@ -123,6 +132,7 @@ struct msm_isp_bufq {
 	/*Native buffer queue*/
 	struct list_head head;
 	enum smmu_attach_mode security_mode;
+	struct msm_isp_bufq_latency latency;
 };
 
 struct msm_isp_buf_ops {
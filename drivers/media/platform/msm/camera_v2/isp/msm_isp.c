@@ -98,11 +98,15 @@ static char *stats_str[MAX_OVERFLOW_COUNTERS] = {
 #define MAX_UB_INFO_BUFF_LEN  1024
 #define MAX_UB_INFO_LINE_BUFF_LEN 256
 
+#define MAX_BUF_LATENCY_BUFF_LEN  2048
+#define MAX_BUF_LATENCY_LINE_BUFF_LEN 96
+
 static struct msm_isp_bw_req_info
 	msm_isp_bw_request_history[MAX_DEPTH_BW_REQ_HISTORY];
 static int msm_isp_bw_request_history_idx;
 static char bw_request_history_buff[MAX_BW_HISTORY_BUFF_LEN];
 static char ub_info_buffer[MAX_UB_INFO_BUFF_LEN];
+static char buf_latency_buffer[MAX_BUF_LATENCY_BUFF_LEN];
 static spinlock_t req_history_lock;
 
 static int vfe_debugfs_statistics_open(struct inode *inode, struct file *file)
@@ -256,6 +260,73 @@ static ssize_t ub_info_write(struct file *t_file,
 	return sizeof(struct msm_isp_ub_info);
 }
 
+static int buf_latency_open(struct inode *inode, struct file *file)
+{
+	file->private_data = inode->i_private;
+	return 0;
+}
+
+static ssize_t buf_latency_read(struct file *t_file, char __user *t_char,
+	size_t t_size_t, loff_t *t_loff_t)
+{
+	int i;
+	char *out_buffer = buf_latency_buffer;
+	char line_buffer[MAX_BUF_LATENCY_LINE_BUFF_LEN] = {0};
+	struct vfe_device *vfe_dev =
+		(struct vfe_device *) t_file->private_data;
+	struct msm_isp_buf_mgr *buf_mgr = vfe_dev->buf_mgr;
+	struct msm_isp_bufq_latency latency;
+	struct msm_isp_bufq *bufq;
+	uint32_t stream_id;
+	unsigned long flags;
+
+	out_buffer[0] = '\0';
+	/* The bufq locks are set up when the buffer manager is opened */
+	for (i = 0; buf_mgr->open_count && i < BUF_MGR_NUM_BUF_Q; i++) {
+		bufq = &buf_mgr->bufq[i];
+		spin_lock_irqsave(&bufq->bufq_lock, flags);
+		if (!bufq->bufq_handle) {
+			spin_unlock_irqrestore(&bufq->bufq_lock, flags);
+			continue;
+		}
+		latency = bufq->latency;
+		stream_id = bufq->stream_id;
+		spin_unlock_irqrestore(&bufq->bufq_lock, flags);
+
+		snprintf(line_buffer, sizeof(line_buffer),
+			"stream 0x%x: count %llu avg_us %llu max_us %llu\n",
+			stream_id, latency.count,
+			latency.count ?
+			div64_u64(latency.sum_us, latency.count) : 0,
+			latency.max_us);
+		strlcat(out_buffer, line_buffer,
+			sizeof(buf_latency_buffer));
+	}
+
+	return simple_read_from_buffer(t_char, t_size_t,
+		t_loff_t, out_buffer, strlen(out_buffer));
+}
+
+static ssize_t buf_latency_write(struct file *t_file,
+	const char __user *t_char, size_t t_size_t, loff_t *t_loff_t)
+{
+	int i;
+	struct vfe_device *vfe_dev =
+		(struct vfe_device *) t_file->private_data;
+	struct msm_isp_buf_mgr *buf_mgr = vfe_dev->buf_mgr;
+	struct msm_isp_bufq *bufq;
+	unsigned long flags;
+
+	for (i = 0; buf_mgr->open_count && i < BUF_MGR_NUM_BUF_Q; i++) {
+		bufq = &buf_mgr->bufq[i];
+		spin_lock_irqsave(&bufq->bufq_lock, flags);
+		memset(&bufq->latency, 0, sizeof(bufq->latency));
+		spin_unlock_irqrestore(&bufq->bufq_lock, flags);
+	}
+
+	return t_size_t;
+}
+
 static const struct file_operations vfe_debugfs_error = {
 	.open = vfe_debugfs_statistics_open,
 	.read = vfe_debugfs_statistics_read,
@@ -274,6 +345,12 @@ static const struct file_operations ub_info_ops = {
 	.write = ub_info_write,
 };
 
+static const struct file_operations buf_latency_ops = {
+	.open = buf_latency_open,
+	.read = buf_latency_read,
+	.write = buf_latency_write,
+};
+
 static int msm_isp_enable_debugfs(struct vfe_device *vfe_dev,
 	struct msm_isp_bw_req_info *isp_req_hist)
 {
@@ -296,6 +373,10 @@ static int msm_isp_enable_debugfs(struct vfe_device *vfe_dev,
 		debugfs_base, vfe_dev, &ub_info_ops))
 		return -ENOMEM;
 
+	if (!debugfs_create_file("buf_latency", 0644,
+		debugfs_base, vfe_dev, &buf_latency_ops))
+		return -ENOMEM;
+
 	return 0;
 }
 
@@ -475,6 +556,13 @@ static int isp_vma_fault(struct vm_fault *vmf)
 	struct vfe_device *vfe_dev = vmf->vma->vm_private_data;
 	struct isp_kstate *isp_page = NULL;
 
+	if (vmf->pgoff == MSM_ISP_STATS_RING_PGOFF) {
+		page = virt_to_page(vfe_dev->stats_ring);
+		get_page(page);
+		vmf->page = page;
+		return 0;
+	}
+
 	isp_page = vfe_dev->isp_page;
 
 	pr_debug("%s: vfeid:%d u_virt_addr:0x%lx k_virt_addr:%pK\n",
@@ -505,6 +593,14 @@ static int msm_isp_v4l2_fops_mmap(struct file *filep,
 	struct v4l2_subdev *sd = vdev_to_v4l2_subdev(vdev);
 	struct vfe_device *vfe_dev = v4l2_get_subdevdata(sd);
 
+	if (vma->vm_pgoff == MSM_ISP_STATS_RING_PGOFF) {
+		/* The stats ring is only ever written by the kernel */
+		if (vma->vm_flags & VM_WRITE ||
+			vma->vm_end - vma->vm_start > PAGE_SIZE)
+			return -EINVAL;
+		vma->vm_flags &= ~VM_MAYWRITE;
+	}
+
 	vma->vm_ops = &isp_vm_ops;
 	vma->vm_flags |=
 		(unsigned long)(VM_DONTEXPAND | VM_DONTDUMP);
@@ -773,6 +869,18 @@ int vfe_hw_probe(struct platform_device *pdev)
 		goto probe_fail3;
 	}
 	vfe_dev->isp_page->vfeid = vfe_dev->pdev->id;
+
+	vfe_dev->stats_ring = (struct msm_isp_stats_ring_hdr *)
+		get_zeroed_page(GFP_KERNEL);
+	if (vfe_dev->stats_ring == NULL) {
+		pr_err("%s: no enough memory\n", __func__);
+		free_page((unsigned long)vfe_dev->isp_page);
+		vfe_dev->isp_page = NULL;
+		rc = -ENOMEM;
+		goto probe_fail3;
+	}
+	spin_lock_init(&vfe_dev->stats_ring_lock);
+	msm_isp_stats_ring_init(vfe_dev);
 	return rc;
 
 probe_fail3:
@@ -868,6 +868,8 @@ struct vfe_device {
 	/* total bandwidth per vfe */
 	uint64_t total_bandwidth;
 	struct isp_kstate *isp_page;
+	struct msm_isp_stats_ring_hdr *stats_ring;
+	spinlock_t stats_ring_lock;
 
 	/* Dual VFE IRQ CAMSS Info*/
 	void __iomem *camss_base;
@@ -147,6 +147,51 @@ static int msm_isp_stats_cfg_ping_pong_address(
 	return rc;
 }
 
+#define MSM_ISP_STATS_RING_SLOTS \
+	((PAGE_SIZE - sizeof(struct msm_isp_stats_ring_hdr)) / \
+	sizeof(struct msm_isp_stats_ring_slot))
+
+void msm_isp_stats_ring_init(struct vfe_device *vfe_dev)
+{
+	struct msm_isp_stats_ring_hdr *hdr = vfe_dev->stats_ring;
+
+	hdr->version = MSM_ISP_STATS_RING_VERSION;
+	hdr->hdr_size = sizeof(*hdr);
+	hdr->slot_size = sizeof(struct msm_isp_stats_ring_slot);
+	hdr->nr_slots = MSM_ISP_STATS_RING_SLOTS;
+}
+
+/* Publish a stats notification in the ring mapped by userspace */
+static void msm_isp_stats_ring_publish(struct vfe_device *vfe_dev,
+	struct msm_isp_timestamp *ts, struct msm_isp_event_data *buf_event)
+{
+	struct msm_isp_stats_ring_hdr *hdr = vfe_dev->stats_ring;
+	struct msm_isp_stats_ring_slot *slot;
+	unsigned long flags;
+
+	if (!hdr)
+		return;
+
+	spin_lock_irqsave(&vfe_dev->stats_ring_lock, flags);
+	slot = (void *)hdr + hdr->hdr_size;
+	slot += hdr->head % MSM_ISP_STATS_RING_SLOTS;
+
+	WRITE_ONCE(slot->seq, slot->seq + 1);
+	smp_wmb();
+	slot->frame_id = buf_event->frame_id;
+	slot->timestamp_ns = timeval_to_ns(&ts->buf_time);
+	slot->stats_mask = buf_event->u.stats.stats_mask;
+	memcpy(slot->stats_buf_idxs, buf_event->u.stats.stats_buf_idxs,
+		sizeof(slot->stats_buf_idxs));
+	slot->pd_stats_idx = buf_event->u.stats.pd_stats_idx;
+	smp_wmb();
+	WRITE_ONCE(slot->seq, slot->seq + 1);
+
+	smp_wmb();
+	WRITE_ONCE(hdr->head, hdr->head + 1);
+	spin_unlock_irqrestore(&vfe_dev->stats_ring_lock, flags);
+}
+
 static int32_t msm_isp_stats_buf_divert(struct vfe_device *vfe_dev,
 	struct msm_isp_timestamp *ts,
 	struct msm_isp_event_data *buf_event,
@@ -253,6 +298,7 @@ static int32_t msm_isp_stats_buf_divert(struct vfe_device *vfe_dev,
 		ISP_DBG("%s: stats frameid: 0x%x %d bufq %x\n",
 			__func__, buf_event->frame_id,
 			stream_info->stats_type, done_buf->bufq_handle);
+		msm_isp_stats_ring_publish(vfe_dev, ts, buf_event);
 		msm_isp_send_event(vfe_dev,
 			ISP_EVENT_STATS_NOTIFY +
 			stream_info->stats_type,
@@ -308,6 +354,7 @@ static int32_t msm_isp_stats_configure(struct vfe_device *vfe_dev,
 			__func__, vfe_dev->pdev->id, buf_event.frame_id,
 			comp_stats_type_mask);
 		stats_event->stats_mask = comp_stats_type_mask;
+		msm_isp_stats_ring_publish(vfe_dev, ts, &buf_event);
 		msm_isp_send_event(vfe_dev,
 			ISP_EVENT_COMP_STATS_NOTIFY, &buf_event);
 		comp_stats_type_mask = 0;
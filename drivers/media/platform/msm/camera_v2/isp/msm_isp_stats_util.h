@@ -27,6 +27,7 @@ int msm_isp_update_stats_stream(struct vfe_device *vfe_dev, void *arg);
 int msm_isp_release_stats_stream(struct vfe_device *vfe_dev, void *arg);
 int msm_isp_request_stats_stream(struct vfe_device *vfe_dev, void *arg);
 void msm_isp_stats_disable(struct vfe_device *vfe_dev);
+void msm_isp_stats_ring_init(struct vfe_device *vfe_dev);
 int msm_isp_stats_reset(struct vfe_device *vfe_dev);
 int msm_isp_stats_restart(struct vfe_device *vfe_dev);
 void msm_isp_release_all_stats_stream(struct vfe_device *vfe_dev);
@@ -255,6 +255,8 @@ struct npu_client {
 	struct npu_device *npu_dev;
 	struct mutex list_lock;
 	struct list_head mapped_buffer_list;
+	/* bumped on every unmap to revalidate registered buffer sets */
+	uint32_t unmap_gen;
 };
 
 /* -------------------------------------------------------------------------
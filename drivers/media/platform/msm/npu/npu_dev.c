@@ -112,6 +112,10 @@ static int npu_exec_network(struct npu_client *client,
 	unsigned long arg);
 static int npu_exec_network_v2(struct npu_client *client,
 	unsigned long arg);
+static int npu_set_buf_set(struct npu_client *client,
+	unsigned long arg);
+static int npu_exec_network_buf_set(struct npu_client *client,
+	unsigned long arg);
 static int npu_set_fw_state(struct npu_client *client, uint32_t enable);
 static int npu_set_property(struct npu_client *client,
 	unsigned long arg);
@@ -1224,6 +1228,7 @@ static int npu_open(struct inode *inode, struct file *file)
 	client->npu_dev = npu_dev;
 	mutex_init(&client->list_lock);
 	INIT_LIST_HEAD(&(client->mapped_buffer_list));
+	client->unmap_gen = 0;
 	file->private_data = client;
 
 	return 0;
@@ -1555,6 +1560,113 @@ static int npu_exec_network_v2(struct npu_client *client,
 	return ret;
 }
 
+static int npu_set_buf_set(struct npu_client *client,
+	unsigned long arg)
+{
+	struct msm_npu_buf_set_ioctl req;
+	void __user *argp = (void __user *)arg;
+	struct msm_npu_patch_buf_info *patch_buf_info = NULL;
+	int ret;
+
+	ret = copy_from_user(&req, argp, sizeof(req));
+	if (ret) {
+		pr_err("fail to copy from user\n");
+		return -EFAULT;
+	}
+
+	if (req.patch_buf_info_num > NPU_MAX_PATCH_NUM) {
+		pr_err("Invalid patch buf info num %d[max:%d]\n",
+			req.patch_buf_info_num, NPU_MAX_PATCH_NUM);
+		return -EINVAL;
+	}
+
+	if (req.patch_buf_info_num) {
+		patch_buf_info = kmalloc_array(req.patch_buf_info_num,
+			sizeof(*patch_buf_info), GFP_KERNEL);
+		if (!patch_buf_info)
+			return -ENOMEM;
+
+		ret = copy_from_user(patch_buf_info,
+			(void __user *)req.patch_buf_info,
+			req.patch_buf_info_num * sizeof(*patch_buf_info));
+		if (ret) {
+			pr_err("fail to copy patch buf info\n");
+			kfree(patch_buf_info);
+			return -EFAULT;
+		}
+	}
+
+	ret = npu_host_set_buf_set(client, &req, patch_buf_info);
+
+	kfree(patch_buf_info);
+	if (ret) {
+		pr_err("npu_host_set_buf_set failed %d\n", ret);
+		return ret;
+	}
+
+	ret = copy_to_user(argp, &req, sizeof(req));
+	if (ret) {
+		pr_err("fail to copy to user\n");
+		ret = -EFAULT;
+	}
+
+	return ret;
+}
+
+static int npu_exec_network_buf_set(struct npu_client *client,
+	unsigned long arg)
+{
+	struct msm_npu_exec_buf_set_ioctl req;
+	void __user *argp = (void __user *)arg;
+	uint32_t *buf_set_ids;
+	int ret;
+
+	ret = copy_from_user(&req, argp, sizeof(req));
+	if (ret) {
+		pr_err("fail to copy from user\n");
+		return -EFAULT;
+	}
+
+	if ((req.num_buf_sets > MSM_NPU_MAX_BUF_SETS) ||
+		(req.num_buf_sets == 0)) {
+		pr_err("Invalid buf set num %d[max:%d]\n",
+			req.num_buf_sets, MSM_NPU_MAX_BUF_SETS);
+		return -EINVAL;
+	}
+
+	if (req.stats_buf_size > NPU_MAX_STATS_BUF_SIZE) {
+		pr_err("Invalid stats buffer size %d max %d\n",
+			req.stats_buf_size, NPU_MAX_STATS_BUF_SIZE);
+		return -EINVAL;
+	}
+
+	buf_set_ids = kmalloc_array(req.num_buf_sets, sizeof(*buf_set_ids),
+		GFP_KERNEL);
+	if (!buf_set_ids)
+		return -ENOMEM;
+
+	ret = copy_from_user(buf_set_ids, (void __user *)req.buf_set_ids,
+		req.num_buf_sets * sizeof(*buf_set_ids));
+	if (ret) {
+		pr_err("fail to copy buf set ids\n");
+		kfree(buf_set_ids);
+		return -EFAULT;
+	}
+
+	ret = npu_host_exec_network_buf_set(client, &req, buf_set_ids);
+	kfree(buf_set_ids);
+	if (ret)
+		pr_err("npu_host_exec_network_buf_set failed %d\n", ret);
+
+	/* num_done tells the caller how far the batch got, even on error */
+	if (copy_to_user(argp, &req, sizeof(req))) {
+		pr_err("fail to copy to user\n");
+		ret = -EFAULT;
+	}
+
+	return ret;
+}
+
 static int npu_set_fw_state(struct npu_client *client, uint32_t enable)
 {
 	struct npu_device *npu_dev = client->npu_dev;
@@ -1706,6 +1818,12 @@ static long npu_ioctl(struct file *file, unsigned int cmd,
 	case MSM_NPU_EXEC_NETWORK_V2:
 		ret = npu_exec_network_v2(client, arg);
 		break;
+	case MSM_NPU_SET_BUF_SET:
+		ret = npu_set_buf_set(client, arg);
+		break;
+	case MSM_NPU_EXEC_NETWORK_BUF_SET:
+		ret = npu_exec_network_buf_set(client, arg);
+		break;
 	case MSM_NPU_SET_PROP:
 		ret = npu_set_property(client, arg);
 		break;
@@ -415,6 +415,7 @@ void npu_mem_unmap(struct npu_client *client, int buf_hdl,  uint64_t addr)
 	if (ion_buf->dma_buf)
 		dma_buf_put(ion_buf->dma_buf);
 	npu_dev->smmu_ctx.attach_cnt--;
+	WRITE_ONCE(client->unmap_gen, client->unmap_gen + 1);
 
 	pr_debug("unmapped mem addr:0x%llx size:0x%x\n", ion_buf->iova,
 		ion_buf->size);
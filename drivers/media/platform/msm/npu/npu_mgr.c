@@ -669,6 +669,10 @@ static void free_network(struct npu_host_ctx *ctx, struct npu_client *client,
 	if (network) {
 		network_put(network);
 		if (atomic_read(&network->ref_cnt) == 0) {
+			int i;
+
+			for (i = 0; i < MSM_NPU_MAX_BUF_SETS; i++)
+				kfree(network->buf_sets[i]);
 			kfree(network->stats_buf);
 			memset(network, 0, sizeof(struct npu_network));
 			ctx->network_num--;
@@ -1817,6 +1821,72 @@ int32_t npu_host_exec_network(struct npu_client *client,
 	return ret;
 }
 
+/*
+ * Send an execute_v2 packet and wait for its response. Called with
+ * host_ctx->lock held, which is dropped while waiting.
+ */
+static int npu_exec_v2_send_wait(struct npu_device *npu_dev,
+	struct npu_network *network,
+	struct ipc_cmd_execute_pkt_v2 *exec_packet,
+	uint64_t stats_buf_addr, uint32_t *stats_buf_size)
+{
+	struct npu_host_ctx *host_ctx = &npu_dev->host_ctx;
+	int ret;
+
+	exec_packet->header.trans_id =
+		atomic_add_return(1, &host_ctx->ipc_trans_id);
+
+	network->stats_buf_u = (void __user *)stats_buf_addr;
+	network->stats_buf_size = *stats_buf_size;
+
+	pr_debug("Execute_v2 flags %x stats_buf_size %d\n",
+		exec_packet->header.flags, *stats_buf_size);
+
+	/* Send it on the high priority queue */
+	reinit_completion(&network->cmd_done);
+	ret = npu_send_network_cmd(npu_dev, network, exec_packet);
+
+	if (ret) {
+		pr_err("NPU_IPC_CMD_EXECUTE_V2 sent failed: %d\n", ret);
+		return ret;
+	}
+
+	mutex_unlock(&host_ctx->lock);
+
+	ret = wait_for_completion_timeout(
+		&network->cmd_done,
+		(host_ctx->fw_dbg_mode & FW_DBG_MODE_INC_TIMEOUT) ?
+		NW_DEBUG_TIMEOUT : NW_CMD_TIMEOUT);
+
+	mutex_lock(&host_ctx->lock);
+	if (!ret) {
+		pr_err_ratelimited("npu: NPU_IPC_CMD_EXECUTE_V2 time out\n");
+		/* dump debug stats */
+		npu_dump_debug_timeout_stats(npu_dev);
+		network->cmd_pending = false;
+		return -ETIMEDOUT;
+	}
+
+	if (network->fw_error) {
+		pr_err("fw is in error state during execute_v2 network\n");
+		return -EIO;
+	}
+
+	ret = network->cmd_ret_status;
+	if (!ret) {
+		*stats_buf_size = network->stats_buf_size;
+		if (copy_to_user((void __user *)stats_buf_addr,
+			network->stats_buf, *stats_buf_size)) {
+			pr_err("copy stats to user failed\n");
+			*stats_buf_size = 0;
+		}
+	} else {
+		pr_err("execution failed %d\n", ret);
+	}
+
+	return ret;
+}
+
 int32_t npu_host_exec_network_v2(struct npu_client *client,
 	struct msm_npu_exec_network_ioctl_v2 *exec_ioctl,
 	struct msm_npu_patch_buf_info *patch_buf_info)
@@ -1884,70 +1954,235 @@ int32_t npu_host_exec_network_v2(struct npu_client *client,
 
 	exec_packet->header.cmd_type = NPU_IPC_CMD_EXECUTE_V2;
 	exec_packet->header.size = pkt_size;
-	exec_packet->header.trans_id =
-		atomic_add_return(1, &host_ctx->ipc_trans_id);
 	exec_packet->header.flags = host_ctx->exec_flags_override > 0 ?
 		host_ctx->exec_flags_override : exec_ioctl->flags;
 	exec_packet->network_hdl = network->network_hdl;
 	exec_packet->num_patch_params = num_patch_params;
 
-	network->stats_buf_u = (void __user *)exec_ioctl->stats_buf_addr;
-	network->stats_buf_size = exec_ioctl->stats_buf_size;
+	ret = npu_exec_v2_send_wait(npu_dev, network, exec_packet,
+		exec_ioctl->stats_buf_addr, &exec_ioctl->stats_buf_size);
 
-	pr_debug("Execute_v2 flags %x stats_buf_size %d\n",
-		exec_packet->header.flags, exec_ioctl->stats_buf_size);
+free_exec_packet:
+	kfree(exec_packet);
+exec_v2_done:
+	network_put(network);
+	mutex_unlock(&host_ctx->lock);
 
-	/* Send it on the high priority queue */
-	reinit_completion(&network->cmd_done);
-	ret = npu_send_network_cmd(npu_dev, network, exec_packet);
+	/*
+	 * treat network execution timed our or interrupted by signal
+	 * as error in order to force npu fw to stop execution
+	 */
+	if ((ret == -ETIMEDOUT) || (ret == -ERESTARTSYS)) {
+		pr_err("Error handling after execution failure\n");
+		host_error_hdlr(npu_dev, true);
+	}
 
-	if (ret) {
-		pr_err("NPU_IPC_CMD_EXECUTE_V2 sent failed: %d\n", ret);
-		goto free_exec_packet;
+	if (atomic_dec_return(&host_ctx->network_execute_cnt) == 0)
+		npu_notify_cdsprm_cxlimit_activity(npu_dev, false);
+
+	return ret;
+}
+
+/*
+ * A buffer set holds the patch params of one execution, verified against
+ * the client's mapped buffers when registered and again only after the
+ * client unmaps something.
+ */
+struct npu_buf_set {
+	uint32_t unmap_gen;
+	uint32_t num_patch_params;
+	struct npu_patch_params_v2 patch_params[];
+};
+
+static bool npu_buf_set_verify(struct npu_client *client,
+	struct npu_buf_set *buf_set)
+{
+	uint32_t gen = READ_ONCE(client->unmap_gen);
+	int i;
+
+	if (buf_set->unmap_gen == gen)
+		return true;
+
+	for (i = 0; i < buf_set->num_patch_params; i++) {
+		if (!npu_mem_verify_addr(client,
+			buf_set->patch_params[i].value)) {
+			pr_err("buf set patch value %x is unmapped\n",
+				buf_set->patch_params[i].value);
+			return false;
+		}
 	}
+	buf_set->unmap_gen = gen;
+
+	return true;
+}
 
+int32_t npu_host_set_buf_set(struct npu_client *client,
+	struct msm_npu_buf_set_ioctl *buf_set_ioctl,
+	struct msm_npu_patch_buf_info *patch_buf_info)
+{
+	struct npu_device *npu_dev = client->npu_dev;
+	struct npu_host_ctx *host_ctx = &npu_dev->host_ctx;
+	uint32_t num_patch_params = buf_set_ioctl->patch_buf_info_num;
+	struct npu_buf_set *buf_set = NULL;
+	struct npu_network *network;
+	int32_t ret = 0;
+	int i;
+
+	if (num_patch_params) {
+		buf_set = kzalloc(sizeof(*buf_set) + num_patch_params *
+			sizeof(struct npu_patch_params_v2), GFP_KERNEL);
+		if (!buf_set)
+			return -ENOMEM;
+
+		buf_set->num_patch_params = num_patch_params;
+		buf_set->unmap_gen = READ_ONCE(client->unmap_gen);
+		for (i = 0; i < num_patch_params; i++) {
+			buf_set->patch_params[i].id = patch_buf_info[i].buf_id;
+			buf_set->patch_params[i].value =
+				patch_buf_info[i].buf_phys_addr;
+
+			if (!npu_mem_verify_addr(client,
+				patch_buf_info[i].buf_phys_addr)) {
+				pr_err("Invalid patch value\n");
+				kfree(buf_set);
+				return -EINVAL;
+			}
+		}
+	}
+
+	mutex_lock(&host_ctx->lock);
+	network = get_network_by_hdl(host_ctx, client,
+		buf_set_ioctl->network_hdl);
+	if (!network) {
+		mutex_unlock(&host_ctx->lock);
+		kfree(buf_set);
+		return -EINVAL;
+	}
+
+	if (!buf_set) {
+		if (buf_set_ioctl->buf_set_id >= MSM_NPU_MAX_BUF_SETS ||
+			!network->buf_sets[buf_set_ioctl->buf_set_id]) {
+			pr_err("invalid buf set id %d\n",
+				buf_set_ioctl->buf_set_id);
+			ret = -EINVAL;
+			goto put_network;
+		}
+		kfree(network->buf_sets[buf_set_ioctl->buf_set_id]);
+		network->buf_sets[buf_set_ioctl->buf_set_id] = NULL;
+		goto put_network;
+	}
+
+	for (i = 0; i < MSM_NPU_MAX_BUF_SETS; i++)
+		if (!network->buf_sets[i])
+			break;
+
+	if (i == MSM_NPU_MAX_BUF_SETS) {
+		pr_err("no free buf set for network %lld\n", network->id);
+		kfree(buf_set);
+		ret = -ENOSPC;
+		goto put_network;
+	}
+
+	network->buf_sets[i] = buf_set;
+	buf_set_ioctl->buf_set_id = i;
+	pr_debug("network %lld buf set %d with %d patches\n", network->id,
+		i, num_patch_params);
+
+put_network:
+	network_put(network);
 	mutex_unlock(&host_ctx->lock);
 
-	ret = wait_for_completion_timeout(
-		&network->cmd_done,
-		(host_ctx->fw_dbg_mode & FW_DBG_MODE_INC_TIMEOUT) ?
-		NW_DEBUG_TIMEOUT : NW_CMD_TIMEOUT);
+	return ret;
+}
+
+int32_t npu_host_exec_network_buf_set(struct npu_client *client,
+	struct msm_npu_exec_buf_set_ioctl *exec_ioctl,
+	uint32_t *buf_set_ids)
+{
+	struct npu_device *npu_dev = client->npu_dev;
+	struct ipc_cmd_execute_pkt_v2 *exec_packet;
+	struct npu_host_ctx *host_ctx = &npu_dev->host_ctx;
+	uint32_t stats_buf_size = 0;
+	struct npu_network *network;
+	struct npu_buf_set *buf_set;
+	int32_t ret = 0;
+	int i;
+
+	exec_ioctl->num_done = 0;
+
+	/* One packet is reused for every execution of the batch */
+	exec_packet = kzalloc(sizeof(*exec_packet) + NPU_MAX_PATCH_NUM *
+		sizeof(struct npu_patch_params_v2), GFP_KERNEL);
+	if (!exec_packet)
+		return -ENOMEM;
 
 	mutex_lock(&host_ctx->lock);
-	if (!ret) {
-		pr_err_ratelimited("npu: NPU_IPC_CMD_EXECUTE_V2 time out\n");
-		/* dump debug stats */
-		npu_dump_debug_timeout_stats(npu_dev);
-		network->cmd_pending = false;
-		ret = -ETIMEDOUT;
-		goto free_exec_packet;
+	network = get_network_by_hdl(host_ctx, client,
+		exec_ioctl->network_hdl);
+
+	if (!network) {
+		mutex_unlock(&host_ctx->lock);
+		kfree(exec_packet);
+		return -EINVAL;
 	}
 
-	if (network->fw_error) {
-		ret = -EIO;
-		pr_err("fw is in error state during execute_v2 network\n");
-		goto free_exec_packet;
+	if (atomic_inc_return(&host_ctx->network_execute_cnt) == 1)
+		npu_notify_cdsprm_cxlimit_activity(npu_dev, true);
+
+	if (!network->is_active) {
+		pr_err("network is not active\n");
+		ret = -EINVAL;
+		goto exec_buf_set_done;
 	}
 
-	ret = network->cmd_ret_status;
-	if (!ret) {
-		exec_ioctl->stats_buf_size = network->stats_buf_size;
-		if (copy_to_user(
-			(void __user *)exec_ioctl->stats_buf_addr,
-			network->stats_buf,
-			exec_ioctl->stats_buf_size)) {
-			pr_err("copy stats to user failed\n");
-			exec_ioctl->stats_buf_size = 0;
+	exec_packet->header.cmd_type = NPU_IPC_CMD_EXECUTE_V2;
+	exec_packet->header.flags = host_ctx->exec_flags_override > 0 ?
+		host_ctx->exec_flags_override : exec_ioctl->flags;
+	exec_packet->network_hdl = network->network_hdl;
+
+	for (i = 0; i < exec_ioctl->num_buf_sets; i++) {
+		if (network->fw_error) {
+			pr_err("fw is in error state\n");
+			ret = -EIO;
+			break;
 		}
-	} else {
-		pr_err("execution failed %d\n", ret);
+
+		/* the set may have been released while the lock was dropped */
+		buf_set = buf_set_ids[i] < MSM_NPU_MAX_BUF_SETS ?
+			network->buf_sets[buf_set_ids[i]] : NULL;
+		if (!buf_set) {
+			pr_err("invalid buf set id %d\n", buf_set_ids[i]);
+			ret = -EINVAL;
+			break;
+		}
+
+		if (!npu_buf_set_verify(client, buf_set)) {
+			ret = -EINVAL;
+			break;
+		}
+
+		exec_packet->header.size = sizeof(*exec_packet) +
+			buf_set->num_patch_params *
+			sizeof(struct npu_patch_params_v2);
+		exec_packet->num_patch_params = buf_set->num_patch_params;
+		memcpy(exec_packet->patch_params, buf_set->patch_params,
+			buf_set->num_patch_params *
+			sizeof(struct npu_patch_params_v2));
+
+		stats_buf_size = exec_ioctl->stats_buf_size;
+		ret = npu_exec_v2_send_wait(npu_dev, network, exec_packet,
+			exec_ioctl->stats_buf_addr, &stats_buf_size);
+		if (ret)
+			break;
+
+		exec_ioctl->num_done++;
 	}
+	exec_ioctl->stats_buf_size = ret ? 0 : stats_buf_size;
 
-free_exec_packet:
-	kfree(exec_packet);
-exec_v2_done:
+exec_buf_set_done:
 	network_put(network);
 	mutex_unlock(&host_ctx->lock);
+	kfree(exec_packet);
 
 	/*
 	 * treat network execution timed our or interrupted by signal
@@ -41,6 +41,8 @@
  * Data Structures
  * -------------------------------------------------------------------------
  */
+struct npu_buf_set;
+
 struct npu_network {
 	uint64_t id;
 	int buf_hdl;
@@ -65,6 +67,8 @@ struct npu_network {
 	int cmd_ret_status;
 	struct completion cmd_done;
 	struct npu_client *client;
+	/* patch buffer sets registered with MSM_NPU_SET_BUF_SET */
+	struct npu_buf_set *buf_sets[MSM_NPU_MAX_BUF_SETS];
 };
 
 enum fw_state {
@@ -138,6 +142,12 @@ int32_t npu_host_exec_network(struct npu_client *client,
 int32_t npu_host_exec_network_v2(struct npu_client *client,
 	struct msm_npu_exec_network_ioctl_v2 *exec_ioctl,
 	struct msm_npu_patch_buf_info *patch_buf_info);
+int32_t npu_host_set_buf_set(struct npu_client *client,
+	struct msm_npu_buf_set_ioctl *buf_set_ioctl,
+	struct msm_npu_patch_buf_info *patch_buf_info);
+int32_t npu_host_exec_network_buf_set(struct npu_client *client,
+	struct msm_npu_exec_buf_set_ioctl *exec_ioctl,
+	uint32_t *buf_set_ids);
 int32_t npu_host_loopback_test(struct npu_device *npu_dev);
 int32_t npu_host_set_fw_property(struct npu_device *npu_dev,
 			struct msm_npu_property *property);
@@ -18,12 +18,32 @@
 #include <linux/msm_dma_iommu_mapping.h>
 #include <linux/msm_ion.h>
 #include <linux/ion_kernel.h>
+#include <linux/mutex.h>
+#include <linux/shrinker.h>
 #include <linux/slab.h>
 #include <linux/types.h>
 #include "msm_vidc.h"
 #include "msm_vidc_debug.h"
+#include "msm_vidc_internal.h"
 #include "msm_vidc_resources.h"
 
+/*
+ * Dequeued client buffers keep their dma_buf reference and mapping in
+ * the session's cache. Entries are keyed by the dma_buf itself: on this
+ * kernel all dma_bufs share one anon inode, and the reference held by the
+ * cache keeps the dma_buf from being freed and its address reused.
+ */
+struct msm_smem_map_cache_entry {
+	struct list_head list;
+	struct dma_buf *dma_buf;
+	unsigned long flags;
+	enum hal_buffer buffer_type;
+	u32 device_addr;
+	struct dma_mapping_info mapping_info;
+};
+
+static LIST_HEAD(msm_smem_map_caches);
+static DEFINE_MUTEX(msm_smem_map_caches_lock);
 
 static int msm_dma_get_device_address(struct dma_buf *dbuf, unsigned long align,
 	dma_addr_t *iova, unsigned long *buffer_size,
@@ -194,6 +214,188 @@ void msm_smem_put_dma_buf(void *dma_buf)
 	return;
 }
 
+static void msm_smem_map_cache_evict(struct msm_smem_map_cache *cache,
+		struct msm_smem_map_cache_entry *entry)
+{
+	list_del(&entry->list);
+	cache->count--;
+	cache->evictions++;
+
+	if (msm_dma_put_device_address(entry->flags, &entry->mapping_info,
+			entry->buffer_type))
+		dprintk(VIDC_ERR, "%s: Failed to put device address\n",
+			__func__);
+	msm_smem_put_dma_buf(entry->dma_buf);
+	kfree(entry);
+}
+
+/* Takes the mapping of dbuf out of the cache, if it is there */
+static bool msm_smem_map_cache_lookup(struct msm_vidc_inst *inst,
+		struct msm_smem *smem, struct dma_buf *dbuf)
+{
+	struct msm_smem_map_cache *cache = &inst->smem_map_cache;
+	struct msm_smem_map_cache_entry *entry;
+	bool found = false;
+
+	mutex_lock(&cache->lock);
+	list_for_each_entry(entry, &cache->list, list) {
+		if (entry->dma_buf != dbuf)
+			continue;
+
+		/* A different context bank needs a mapping of its own */
+		if (entry->flags != smem->flags ||
+			entry->mapping_info.cb_info != msm_smem_get_context_bank(
+				inst->session_type, smem->flags & SMEM_SECURE,
+				&inst->core->resources, smem->buffer_type) ||
+			dbuf->size < smem->size) {
+			msm_smem_map_cache_evict(cache, entry);
+			break;
+		}
+
+		list_del(&entry->list);
+		cache->count--;
+		found = true;
+		break;
+	}
+	if (found)
+		cache->hits++;
+	else
+		cache->misses++;
+	mutex_unlock(&cache->lock);
+
+	if (!found)
+		return false;
+
+	smem->device_addr = entry->device_addr + smem->offset;
+	smem->mapping_info = entry->mapping_info;
+	/* smem has a reference of its own already */
+	msm_smem_put_dma_buf(entry->dma_buf);
+	kfree(entry);
+
+	return true;
+}
+
+/* Keeps the mapping of an unmapped buffer, taking its dma_buf reference */
+static bool msm_smem_map_cache_insert(struct msm_vidc_inst *inst,
+		struct msm_smem *smem)
+{
+	struct msm_smem_map_cache *cache = &inst->smem_map_cache;
+	struct msm_smem_map_cache_entry *entry;
+	u32 max = READ_ONCE(msm_vidc_map_cache_size);
+
+	/* Only the device address is ever used for a mapping without iommu */
+	if (!max || !smem->mapping_info.attach)
+		return false;
+
+	entry = kzalloc(sizeof(*entry), GFP_KERNEL);
+	if (!entry)
+		return false;
+
+	entry->dma_buf = smem->dma_buf;
+	entry->flags = smem->flags;
+	entry->buffer_type = smem->buffer_type;
+	entry->device_addr = smem->device_addr - smem->offset;
+	entry->mapping_info = smem->mapping_info;
+
+	mutex_lock(&cache->lock);
+	list_add(&entry->list, &cache->list);
+	cache->count++;
+	while (cache->count > max)
+		msm_smem_map_cache_evict(cache, list_last_entry(&cache->list,
+				struct msm_smem_map_cache_entry, list));
+	mutex_unlock(&cache->lock);
+
+	return true;
+}
+
+void msm_smem_map_cache_init(struct msm_vidc_inst *inst)
+{
+	struct msm_smem_map_cache *cache = &inst->smem_map_cache;
+
+	INIT_LIST_HEAD(&cache->list);
+	mutex_init(&cache->lock);
+
+	mutex_lock(&msm_smem_map_caches_lock);
+	list_add_tail(&cache->node, &msm_smem_map_caches);
+	mutex_unlock(&msm_smem_map_caches_lock);
+}
+
+void msm_smem_map_cache_deinit(struct msm_vidc_inst *inst)
+{
+	struct msm_smem_map_cache *cache = &inst->smem_map_cache;
+	struct msm_smem_map_cache_entry *entry, *dummy;
+
+	mutex_lock(&msm_smem_map_caches_lock);
+	list_del(&cache->node);
+	mutex_unlock(&msm_smem_map_caches_lock);
+
+	mutex_lock(&cache->lock);
+	list_for_each_entry_safe(entry, dummy, &cache->list, list)
+		msm_smem_map_cache_evict(cache, entry);
+	mutex_unlock(&cache->lock);
+
+	dprintk(VIDC_PROF, "%s: %pK: maps saved %llu misses %llu\n",
+		__func__, inst, cache->hits, cache->misses);
+	mutex_destroy(&cache->lock);
+}
+
+static unsigned long msm_smem_shrink_count(struct shrinker *shrinker,
+		struct shrink_control *sc)
+{
+	struct msm_smem_map_cache *cache;
+	unsigned long count = 0;
+
+	if (!mutex_trylock(&msm_smem_map_caches_lock))
+		return 0;
+	list_for_each_entry(cache, &msm_smem_map_caches, node)
+		count += READ_ONCE(cache->count);
+	mutex_unlock(&msm_smem_map_caches_lock);
+
+	return count;
+}
+
+static unsigned long msm_smem_shrink_scan(struct shrinker *shrinker,
+		struct shrink_control *sc)
+{
+	struct msm_smem_map_cache *cache;
+	unsigned long freed = 0;
+
+	if (!mutex_trylock(&msm_smem_map_caches_lock))
+		return SHRINK_STOP;
+	list_for_each_entry(cache, &msm_smem_map_caches, node) {
+		if (!mutex_trylock(&cache->lock))
+			continue;
+		while (cache->count && freed < sc->nr_to_scan) {
+			msm_smem_map_cache_evict(cache, list_last_entry(
+				&cache->list, struct msm_smem_map_cache_entry,
+				list));
+			freed++;
+		}
+		mutex_unlock(&cache->lock);
+		if (freed >= sc->nr_to_scan)
+			break;
+	}
+	mutex_unlock(&msm_smem_map_caches_lock);
+
+	return freed;
+}
+
+static struct shrinker msm_smem_shrinker = {
+	.count_objects = msm_smem_shrink_count,
+	.scan_objects = msm_smem_shrink_scan,
+	.seeks = DEFAULT_SEEKS,
+};
+
+int msm_smem_register_shrinker(void)
+{
+	return register_shrinker(&msm_smem_shrinker);
+}
+
+void msm_smem_unregister_shrinker(void)
+{
+	unregister_shrinker(&msm_smem_shrinker);
+}
+
 int msm_smem_map_dma_buf(struct msm_vidc_inst *inst, struct msm_smem *smem)
 {
 	int rc = 0;
@@ -236,6 +438,11 @@ int msm_smem_map_dma_buf(struct msm_vidc_inst *inst, struct msm_smem *smem)
 	if (ion_flags & ION_FLAG_SECURE)
 		smem->flags |= SMEM_SECURE;
 
+	if (msm_smem_map_cache_lookup(inst, smem, dbuf)) {
+		smem->refcount++;
+		goto exit;
+	}
+
 	buffer_size = smem->size;
 
 	rc = msm_dma_get_device_address(dbuf, align, &iova, &buffer_size,
@@ -281,6 +488,9 @@ int msm_smem_unmap_dma_buf(struct msm_vidc_inst *inst, struct msm_smem *smem)
 	if (smem->refcount)
 		goto exit;
 
+	if (msm_smem_map_cache_insert(inst, smem))
+		goto cached;
+
 	rc = msm_dma_put_device_address(smem->flags, &smem->mapping_info,
 		smem->buffer_type);
 	if (rc) {
@@ -290,6 +500,8 @@ int msm_smem_unmap_dma_buf(struct msm_vidc_inst *inst, struct msm_smem *smem)
 
 	msm_smem_put_dma_buf(smem->dma_buf);
 
+cached:
+	smem->mapping_info = (struct dma_mapping_info) {0};
 	smem->device_addr = 0x0;
 	smem->dma_buf = NULL;
 
@@ -917,13 +917,19 @@ static int __init msm_vidc_init(void)
 		debugfs_remove_recursive(vidc_driver->debugfs_root);
 		kfree(vidc_driver);
 		vidc_driver = NULL;
+		return rc;
 	}
 
+	/* Without it cached mappings are only dropped at session close */
+	if (msm_smem_register_shrinker())
+		dprintk(VIDC_WARN, "Failed to register mapping shrinker\n");
+
 	return rc;
 }
 
 static void __exit msm_vidc_exit(void)
 {
+	msm_smem_unregister_shrinker();
 	platform_driver_unregister(&msm_vidc_driver);
 	debugfs_remove_recursive(vidc_driver->debugfs_root);
 	mutex_destroy(&vidc_driver->lock);
@@ -1254,9 +1254,10 @@ static inline int start_streaming(struct msm_vidc_inst *inst)
 		inst->batch.enable = true;
 	else
 		inst->batch.enable = false;
+	inst->batch.encode = is_encode_batching_allowed(inst);
 	dprintk(VIDC_DBG, "%s: batching %s for inst %pK (%#x)\n",
-		__func__, inst->batch.enable ? "enabled" : "disabled",
-		inst, hash32_ptr(inst->session));
+		__func__, inst->batch.enable || inst->batch.encode ?
+		"enabled" : "disabled", inst, hash32_ptr(inst->session));
 
 	msm_dcvs_try_enable(inst);
 
@@ -1511,6 +1512,34 @@ static int msm_vidc_queue_buf_decode_batch(struct msm_vidc_inst *inst,
 	return rc;
 }
 
+static int msm_vidc_queue_buf_encode_batch(struct msm_vidc_inst *inst,
+		struct vb2_buffer *vb2)
+{
+	int rc;
+	struct msm_vidc_buffer *mbuf;
+
+	if (!inst || !vb2) {
+		dprintk(VIDC_ERR, "%s: invalid params\n", __func__);
+		return -EINVAL;
+	}
+
+	mbuf = msm_comm_get_vidc_buffer(inst, vb2);
+	if (IS_ERR_OR_NULL(mbuf)) {
+		dprintk(VIDC_ERR, "%s: failed to get vidc-buf\n", __func__);
+		return -EINVAL;
+	}
+	if (!kref_get_mbuf(inst, mbuf)) {
+		dprintk(VIDC_ERR, "%s: mbuf not found\n", __func__);
+		return -EINVAL;
+	}
+	rc = msm_comm_qbuf_encode_batch(inst, mbuf);
+	if (rc)
+		dprintk(VIDC_ERR, "%s: failed qbuf\n", __func__);
+	kref_put_mbuf(mbuf);
+
+	return rc;
+}
+
 static int msm_vidc_queue_buf_batch(struct msm_vidc_inst *inst,
 		struct vb2_buffer *vb2)
 {
@@ -1543,6 +1572,8 @@ static void msm_vidc_buf_queue(struct vb2_buffer *vb2)
 
 	if (inst->batch.enable)
 		rc = msm_vidc_queue_buf_batch(inst, vb2);
+	else if (inst->batch.encode)
+		rc = msm_vidc_queue_buf_encode_batch(inst, vb2);
 	else
 		rc = msm_vidc_queue_buf(inst, vb2);
 	if (rc) {
@@ -1870,7 +1901,7 @@ static void batch_timer_callback(unsigned long data)
 {
 	struct msm_vidc_inst *inst = (struct msm_vidc_inst *)data;
 
-	if (!inst->batch.enable)
+	if (!inst->batch.enable && !inst->batch.encode)
 		return;
 
 	schedule_work(&inst->batch_work);
@@ -1921,6 +1952,7 @@ void *msm_vidc_open(int core_id, int session_type)
 	INIT_MSM_VIDC_LIST(&inst->eosbufs);
 	INIT_MSM_VIDC_LIST(&inst->etb_data);
 	INIT_MSM_VIDC_LIST(&inst->fbd_data);
+	msm_smem_map_cache_init(inst);
 
 	kref_init(&inst->kref);
 
@@ -2044,6 +2076,7 @@ void *msm_vidc_open(int core_id, int session_type)
 	DEINIT_MSM_VIDC_LIST(&inst->buffer_tags);
 	DEINIT_MSM_VIDC_LIST(&inst->etb_data);
 	DEINIT_MSM_VIDC_LIST(&inst->fbd_data);
+	msm_smem_map_cache_deinit(inst);
 
 	kfree(inst);
 	inst = NULL;
@@ -2179,6 +2212,7 @@ int msm_vidc_destroy(struct msm_vidc_inst *inst)
 	DEINIT_MSM_VIDC_LIST(&inst->input_crs);
 	DEINIT_MSM_VIDC_LIST(&inst->etb_data);
 	DEINIT_MSM_VIDC_LIST(&inst->fbd_data);
+	msm_smem_map_cache_deinit(inst);
 
 	mutex_destroy(&inst->sync_lock);
 	mutex_destroy(&inst->bufq[CAPTURE_PORT].lock);
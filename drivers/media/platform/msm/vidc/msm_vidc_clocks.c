@@ -22,6 +22,18 @@
 #define MSM_VIDC_MIN_UBWC_COMPRESSION_RATIO (1 << 16)
 #define MSM_VIDC_MAX_UBWC_COMPRESSION_RATIO (5 << 16)
 
+/*
+ * Content aware DCVS scales the worst case VPP cycles between
+ * CONTENT_DCVS_MIN_PCT and 100% by how complex recent frames were:
+ * the recon complexity factor for encoders and the bitstream bits per
+ * macroblock for decoders, reaching 100% at the REF values. A starved
+ * pipeline goes back to the worst case for CONTENT_DCVS_HOLD_FRAMES.
+ */
+#define CONTENT_DCVS_MIN_PCT 50
+#define CONTENT_DCVS_REF_CF (2 << 16)
+#define CONTENT_DCVS_REF_BITS_PER_MB 32
+#define CONTENT_DCVS_HOLD_FRAMES 30
+
 static unsigned long msm_vidc_calc_freq_ar50(struct msm_vidc_inst *inst,
 	u32 filled_len);
 static int msm_vidc_decide_work_mode_ar50(struct msm_vidc_inst *inst);
@@ -113,6 +125,47 @@ static int msm_vidc_get_fps(struct msm_vidc_inst *inst)
 	return fps;
 }
 
+static u32 msm_vidc_content_vpp_pct(struct msm_vidc_inst *inst,
+	u32 filled_len)
+{
+	struct content_dcvs *c = &inst->clk_data.content;
+	u32 mbs, bits_per_mb, pct = 100;
+
+	if (!msm_vidc_content_dcvs || !inst->clk_data.dcvs_mode) {
+		c->last_pct = 100;
+		return 100;
+	}
+
+	if (inst->session_type == MSM_VIDC_DECODER) {
+		c->bits = c->bits ? (7 * c->bits + filled_len) / 8 :
+			filled_len;
+		mbs = msm_vidc_get_mbs_per_frame(inst);
+		bits_per_mb = mbs ? max(c->bits, filled_len) * 8 / mbs : 0;
+		pct = CONTENT_DCVS_MIN_PCT + (100 - CONTENT_DCVS_MIN_PCT) *
+			bits_per_mb / CONTENT_DCVS_REF_BITS_PER_MB;
+	} else if (c->cf) {
+		pct = CONTENT_DCVS_MIN_PCT + (u64)(100 - CONTENT_DCVS_MIN_PCT) *
+			(c->cf - MSM_VIDC_MIN_UBWC_COMPLEXITY_FACTOR) /
+			(CONTENT_DCVS_REF_CF -
+			 MSM_VIDC_MIN_UBWC_COMPLEXITY_FACTOR);
+	}
+
+	if (c->hold) {
+		c->hold--;
+		pct = 100;
+	}
+
+	pct = min_t(u32, pct, 100);
+	c->last_pct = pct;
+	c->frames++;
+	c->pct_sum += pct;
+
+	dprintk(VIDC_PROF, "%s: %x : cf %#x bits %u vpp load %u%%\n",
+		__func__, hash32_ptr(inst->session), c->cf, c->bits, pct);
+
+	return pct;
+}
+
 void update_recon_stats(struct msm_vidc_inst *inst,
 	struct recon_stats_type *recon_stats)
 {
@@ -138,6 +191,15 @@ void update_recon_stats(struct msm_vidc_inst *inst,
 		}
 	}
 	mutex_unlock(&inst->reconbufs.lock);
+
+	/* Predict the next frame's complexity from the recent ones */
+	if (CF) {
+		struct content_dcvs *c = &inst->clk_data.content;
+
+		CF = clamp_t(u32, CF, MSM_VIDC_MIN_UBWC_COMPLEXITY_FACTOR,
+			MSM_VIDC_MAX_UBWC_COMPLEXITY_FACTOR);
+		c->cf = c->cf ? (3 * c->cf + CF) / 4 : CF;
+	}
 }
 
 static int fill_dynamic_stats(struct msm_vidc_inst *inst,
@@ -182,6 +244,12 @@ static int fill_dynamic_stats(struct msm_vidc_inst *inst,
 
 	vote_data->compression_ratio = min_cr;
 	vote_data->complexity_factor = max_cf;
+
+	/* Vote for the predicted rather than the worst recent frame */
+	if (msm_vidc_content_dcvs && inst->clk_data.dcvs_mode &&
+		inst->clk_data.content.cf && min_cf <= max_cf)
+		vote_data->complexity_factor = clamp_t(u32,
+			inst->clk_data.content.cf, min_cf, max_cf);
 	vote_data->input_cr = min_input_cr;
 	vote_data->use_dpb_read = false;
 
@@ -412,6 +480,11 @@ static int msm_dcvs_scale_clocks(struct msm_vidc_inst *inst,
 	if (bufs_with_client <= dcvs->max_threshold) {
 		dcvs->load = dcvs->load_high;
 		dcvs->dcvs_flags |= MSM_VIDC_DCVS_INCR;
+		/* The content prediction was too low, stop trusting it */
+		if (dcvs->content.last_pct < 100) {
+			dcvs->content.underruns++;
+			dcvs->content.hold = CONTENT_DCVS_HOLD_FRAMES;
+		}
 	} else if (bufs_with_fw < buf_reqs->buffer_count_min) {
 		dcvs->load = dcvs->load_low;
 		dcvs->dcvs_flags |= MSM_VIDC_DCVS_DECR;
@@ -552,6 +625,7 @@ static unsigned long msm_vidc_calc_freq_ar50(struct msm_vidc_inst *inst,
 	struct allowed_clock_rates_table *allowed_clks_tbl = NULL;
 	u64 rate = 0, fps;
 	struct clock_data *dcvs = NULL;
+	u32 vpp_pct;
 
 	core = inst->core;
 	dcvs = &inst->clk_data;
@@ -560,6 +634,7 @@ static unsigned long msm_vidc_calc_freq_ar50(struct msm_vidc_inst *inst,
 		LOAD_CALC_NO_QUIRKS);
 
 	fps = msm_vidc_get_fps(inst);
+	vpp_pct = msm_vidc_content_vpp_pct(inst, filled_len);
 
 	/*
 	 * Calculate vpp, vsp cycles separately for encoder and decoder.
@@ -576,6 +651,7 @@ static unsigned long msm_vidc_calc_freq_ar50(struct msm_vidc_inst *inst,
 			inst->clk_data.entry->vpp_cycles;
 
 		vpp_cycles = mbs_per_second * vpp_cycles_per_mb;
+		vpp_cycles = vpp_cycles * vpp_pct / 100;
 		/* 21 / 20 is minimum overhead factor */
 		vpp_cycles += max(vpp_cycles / 20, fw_vpp_cycles);
 
@@ -585,6 +661,7 @@ static unsigned long msm_vidc_calc_freq_ar50(struct msm_vidc_inst *inst,
 		vsp_cycles += (inst->clk_data.bitrate * 10) / 7;
 	} else if (inst->session_type == MSM_VIDC_DECODER) {
 		vpp_cycles = mbs_per_second * inst->clk_data.entry->vpp_cycles;
+		vpp_cycles = vpp_cycles * vpp_pct / 100;
 		/* 21 / 20 is minimum overhead factor */
 		vpp_cycles += max(vpp_cycles / 20, fw_vpp_cycles);
 
@@ -637,6 +714,7 @@ static unsigned long msm_vidc_calc_freq(struct msm_vidc_inst *inst,
 	u64 rate = 0, fps;
 	struct clock_data *dcvs = NULL;
 	u32 operating_rate, vsp_factor_num = 10, vsp_factor_den = 5;
+	u32 vpp_pct;
 
 	core = inst->core;
 	dcvs = &inst->clk_data;
@@ -645,6 +723,7 @@ static unsigned long msm_vidc_calc_freq(struct msm_vidc_inst *inst,
 		LOAD_CALC_NO_QUIRKS);
 
 	fps = msm_vidc_get_fps(inst);
+	vpp_pct = msm_vidc_content_vpp_pct(inst, filled_len);
 
 	/*
 	 * Calculate vpp, vsp, fw cycles separately for encoder and decoder.
@@ -662,6 +741,7 @@ static unsigned long msm_vidc_calc_freq(struct msm_vidc_inst *inst,
 
 		vpp_cycles = mbs_per_second * vpp_cycles_per_mb /
 				inst->clk_data.work_route;
+		vpp_cycles = vpp_cycles * vpp_pct / 100;
 		vsp_cycles = mbs_per_second * inst->clk_data.entry->vsp_cycles;
 
 		/* bitrate is based on fps, scale it using operating rate */
@@ -687,6 +767,7 @@ static unsigned long msm_vidc_calc_freq(struct msm_vidc_inst *inst,
 	} else if (inst->session_type == MSM_VIDC_DECODER) {
 		vpp_cycles = mbs_per_second * inst->clk_data.entry->vpp_cycles /
 				inst->clk_data.work_route;
+		vpp_cycles = vpp_cycles * vpp_pct / 100;
 
 		vsp_cycles = mbs_per_second * inst->clk_data.entry->vsp_cycles;
 
@@ -1146,6 +1227,9 @@ void msm_clock_data_reset(struct msm_vidc_inst *inst)
 		dcvs->load_norm;
 
 	inst->clk_data.buffer_counter = 0;
+	dcvs->content.cf = 0;
+	dcvs->content.bits = 0;
+	dcvs->content.hold = 0;
 
 	msm_dcvs_print_dcvs_stats(dcvs);
 
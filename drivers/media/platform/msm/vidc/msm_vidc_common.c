@@ -25,6 +25,7 @@
 #include "msm_cvp.h"
 
 #define MSM_VIDC_QBUF_BATCH_TIMEOUT 300
+#define MSM_VIDC_ENC_BATCH_TIMEOUT 20
 #define IS_ALREADY_IN_STATE(__p, __d) (\
 	(__p >= __d)\
 )
@@ -2918,6 +2919,24 @@ bool is_batching_allowed(struct msm_vidc_inst *inst)
 	return allowed;
 }
 
+bool is_encode_batching_allowed(struct msm_vidc_inst *inst)
+{
+	u32 fps;
+
+	if (!inst || !inst->core)
+		return false;
+
+	/*
+	 * Batch the queueing of high frame rate (slow motion) encode
+	 * sessions, where the per-buffer queueing cost adds up, unless
+	 * the client asked for low latency.
+	 */
+	fps = max(inst->clk_data.operating_rate >> 16, inst->prop.fps);
+
+	return is_encode_session(inst) && fps >= MIN_ENC_BATCH_FPS &&
+		!inst->clk_data.low_latency_mode;
+}
+
 static int msm_comm_session_abort(struct msm_vidc_inst *inst)
 {
 	int rc = 0, abort_completion = 0;
@@ -4383,6 +4402,95 @@ static int msm_comm_qbuf_to_hfi(struct msm_vidc_inst *inst,
 	return rc;
 }
 
+/*
+ * msm_comm_hfi_batch_flush - hand the buffers collected in inst->hfi_batch
+ *              to the firmware with a single queue write and doorbell.
+ *              Caller holds registeredbufs.lock.
+ */
+static int msm_comm_hfi_batch_flush(struct msm_vidc_inst *inst)
+{
+	int rc = 0, i;
+	struct hfi_device *hdev;
+	struct msm_vidc_hfi_batch *batch = &inst->hfi_batch;
+
+	hdev = inst->core->device;
+
+	if (batch->num_etbs + batch->num_ftbs == 0)
+		return 0;
+
+	if (batch->num_etbs + batch->num_ftbs == 1) {
+		/* Not worth the extra sync packet */
+		if (batch->num_etbs)
+			rc = call_hfi_op(hdev, session_etb, inst->session,
+					&batch->etbs[0]);
+		else
+			rc = call_hfi_op(hdev, session_ftb, inst->session,
+					&batch->ftbs[0]);
+	} else {
+		dprintk(VIDC_DBG, "%s: %x : %d etbs %d ftbs\n", __func__,
+			hash32_ptr(inst->session), batch->num_etbs,
+			batch->num_ftbs);
+		rc = call_hfi_op(hdev, session_process_batch, inst->session,
+				batch->num_etbs, batch->etbs,
+				batch->num_ftbs, batch->ftbs);
+	}
+	if (rc) {
+		dprintk(VIDC_ERR, "%s: Failed to qbuf: %d\n", __func__, rc);
+		goto exit;
+	}
+
+	for (i = 0; i < batch->num_etbs; i++) {
+		batch->etb_bufs[i]->flags |= MSM_VIDC_FLAG_QUEUED;
+		msm_vidc_debugfs_update(inst, MSM_VIDC_DEBUGFS_EVENT_ETB);
+	}
+	for (i = 0; i < batch->num_ftbs; i++) {
+		batch->ftb_bufs[i]->flags |= MSM_VIDC_FLAG_QUEUED;
+		msm_vidc_debugfs_update(inst, MSM_VIDC_DEBUGFS_EVENT_FTB);
+	}
+
+exit:
+	batch->num_etbs = 0;
+	batch->num_ftbs = 0;
+	return rc;
+}
+
+/*
+ * msm_comm_hfi_batch_add - add a buffer to inst->hfi_batch, flushing the
+ *              batch first if it is full. Caller holds registeredbufs.lock
+ *              and calls msm_comm_hfi_batch_flush() once done adding.
+ */
+static int msm_comm_hfi_batch_add(struct msm_vidc_inst *inst,
+		struct msm_vidc_buffer *mbuf)
+{
+	int rc = 0;
+	struct vidc_frame_data *frame_data;
+	struct msm_vidc_hfi_batch *batch = &inst->hfi_batch;
+
+	if (mbuf->vvb.vb2_buf.type == V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE) {
+		if (batch->num_etbs == MAX_HFI_BATCH_SIZE)
+			rc = msm_comm_hfi_batch_flush(inst);
+		frame_data = &batch->etbs[batch->num_etbs];
+		batch->etb_bufs[batch->num_etbs++] = mbuf;
+	} else if (mbuf->vvb.vb2_buf.type ==
+			V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE) {
+		if (batch->num_ftbs == MAX_HFI_BATCH_SIZE)
+			rc = msm_comm_hfi_batch_flush(inst);
+		frame_data = &batch->ftbs[batch->num_ftbs];
+		batch->ftb_bufs[batch->num_ftbs++] = mbuf;
+	} else {
+		dprintk(VIDC_ERR, "%s: invalid qbuf type %d:\n", __func__,
+			mbuf->vvb.vb2_buf.type);
+		return -EINVAL;
+	}
+
+	*frame_data = (struct vidc_frame_data) {0};
+	populate_frame_data(frame_data, mbuf, inst);
+	/* mbuf is not deferred anymore */
+	mbuf->flags &= ~MSM_VIDC_FLAG_DEFERRED;
+
+	return rc;
+}
+
 void msm_vidc_batch_handler(struct work_struct *work)
 {
 	int rc = 0;
@@ -4479,7 +4587,7 @@ int msm_comm_qbuf(struct msm_vidc_inst *inst, struct msm_vidc_buffer *mbuf)
 
 int msm_comm_qbufs(struct msm_vidc_inst *inst)
 {
-	int rc = 0;
+	int rc = 0, err;
 	struct msm_vidc_buffer *mbuf;
 
 	if (!inst) {
@@ -4503,13 +4611,16 @@ int msm_comm_qbufs(struct msm_vidc_inst *inst)
 		if (!(mbuf->flags & MSM_VIDC_FLAG_DEFERRED))
 			continue;
 		print_vidc_buffer(VIDC_DBG, "qbufs", inst, mbuf);
-		rc = msm_comm_qbuf_to_hfi(inst, mbuf);
-		if (rc) {
-			dprintk(VIDC_ERR, "%s: Failed qbuf to hfi: %d\n",
-				__func__, rc);
+		rc = msm_comm_hfi_batch_add(inst, mbuf);
+		if (rc)
 			break;
-		}
 	}
+	err = msm_comm_hfi_batch_flush(inst);
+	if (!rc)
+		rc = err;
+	if (rc)
+		dprintk(VIDC_ERR, "%s: Failed qbuf to hfi: %d\n",
+			__func__, rc);
 	mutex_unlock(&inst->registeredbufs.lock);
 
 	return rc;
@@ -4518,7 +4629,7 @@ int msm_comm_qbufs(struct msm_vidc_inst *inst)
 int msm_comm_qbufs_batch(struct msm_vidc_inst *inst,
 		struct msm_vidc_buffer *mbuf)
 {
-	int rc = 0;
+	int rc = 0, err;
 	struct msm_vidc_buffer *buf;
 
 	mutex_lock(&inst->registeredbufs.lock);
@@ -4535,17 +4646,20 @@ int msm_comm_qbufs_batch(struct msm_vidc_inst *inst,
 			goto loop_end;
 
 		print_vidc_buffer(VIDC_DBG, "batch-qbuf", inst, buf);
-		rc = msm_comm_qbuf_to_hfi(inst, buf);
-		if (rc) {
-			dprintk(VIDC_ERR, "%s: Failed batch qbuf to hfi: %d\n",
-				__func__, rc);
+		rc = msm_comm_hfi_batch_add(inst, buf);
+		if (rc)
 			break;
-		}
 loop_end:
 		/* Queue pending buffers till the current buffer only */
 		if (buf == mbuf)
 			break;
 	}
+	err = msm_comm_hfi_batch_flush(inst);
+	if (!rc)
+		rc = err;
+	if (rc)
+		dprintk(VIDC_ERR, "%s: Failed batch qbuf to hfi: %d\n",
+			__func__, rc);
 	mutex_unlock(&inst->registeredbufs.lock);
 
 	return rc;
@@ -4609,6 +4723,69 @@ int msm_comm_qbuf_decode_batch(struct msm_vidc_inst *inst,
 	return rc;
 }
 
+/*
+ * msm_comm_qbuf_encode_batch - output buffers of high frame rate encoders
+ *              are held back and sent along with the next input buffer,
+ *              so that each frame costs a single queue write. The batch
+ *              timer sends held back buffers if no input follows.
+ */
+int msm_comm_qbuf_encode_batch(struct msm_vidc_inst *inst,
+		struct msm_vidc_buffer *mbuf)
+{
+	int rc = 0, err;
+	struct msm_vidc_buffer *buf;
+
+	if (!inst || !mbuf) {
+		dprintk(VIDC_ERR, "%s: Invalid arguments\n", __func__);
+		return -EINVAL;
+	}
+
+	if (inst->state == MSM_VIDC_CORE_INVALID) {
+		dprintk(VIDC_ERR, "%s: inst is in bad state\n", __func__);
+		return -EINVAL;
+	}
+
+	if (inst->state != MSM_VIDC_START_DONE ||
+		mbuf->vvb.vb2_buf.type == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE) {
+		mbuf->flags |= MSM_VIDC_FLAG_DEFERRED;
+		if (inst->state == MSM_VIDC_START_DONE)
+			mod_timer(&inst->batch_timer, jiffies +
+				msecs_to_jiffies(MSM_VIDC_ENC_BATCH_TIMEOUT));
+		print_vidc_buffer(VIDC_DBG, "batch-qbuf deferred", inst, mbuf);
+		return 0;
+	}
+
+	rc = msm_comm_scale_clocks_and_bus(inst);
+	if (rc)
+		dprintk(VIDC_ERR, "%s: scale clocks failed\n", __func__);
+
+	mutex_lock(&inst->registeredbufs.lock);
+	list_for_each_entry(buf, &inst->registeredbufs.list, list) {
+		if (buf->vvb.vb2_buf.type !=
+			V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE)
+			continue;
+		if (!(buf->flags & MSM_VIDC_FLAG_DEFERRED))
+			continue;
+		print_vidc_buffer(VIDC_DBG, "batch-qbuf", inst, buf);
+		rc = msm_comm_hfi_batch_add(inst, buf);
+		if (rc)
+			break;
+	}
+	if (!rc) {
+		print_vidc_buffer(VIDC_DBG, "batch-qbuf", inst, mbuf);
+		rc = msm_comm_hfi_batch_add(inst, mbuf);
+	}
+	err = msm_comm_hfi_batch_flush(inst);
+	if (!rc)
+		rc = err;
+	if (rc)
+		dprintk(VIDC_ERR, "%s: Failed batch qbuf to hfi: %d\n",
+			__func__, rc);
+	mutex_unlock(&inst->registeredbufs.lock);
+
+	return rc;
+}
+
 int msm_comm_try_get_bufreqs(struct msm_vidc_inst *inst)
 {
 	int rc = 0, i = 0;
@@ -19,6 +19,7 @@
 #define MAX_DEC_BATCH_WIDTH                    1920
 #define MAX_DEC_BATCH_HEIGHT                   1088
 #define SKIP_BATCH_WINDOW                      100
+#define MIN_ENC_BATCH_FPS                      240
 #define MIN_FRAME_QUALITY 0
 #define MAX_FRAME_QUALITY 100
 #define DEFAULT_FRAME_QUALITY 80
@@ -98,6 +99,7 @@ static inline int msm_comm_s_ctrl(struct msm_vidc_inst *inst,
 	return v4l2_s_ctrl(NULL, &inst->ctrl_handler, ctrl);
 }
 bool is_batching_allowed(struct msm_vidc_inst *inst);
+bool is_encode_batching_allowed(struct msm_vidc_inst *inst);
 enum hal_buffer get_hal_buffer_type(unsigned int type,
 		unsigned int plane_num);
 void put_inst(struct msm_vidc_inst *inst);
@@ -258,6 +260,8 @@ int msm_comm_qbufs_batch(struct msm_vidc_inst *inst,
 		struct msm_vidc_buffer *mbuf);
 int msm_comm_qbuf_decode_batch(struct msm_vidc_inst *inst,
 		struct msm_vidc_buffer *mbuf);
+int msm_comm_qbuf_encode_batch(struct msm_vidc_inst *inst,
+		struct msm_vidc_buffer *mbuf);
 int msm_comm_num_queued_bufs(struct msm_vidc_inst *inst, u32 type);
 bool msm_comm_check_for_inst_overload(struct msm_vidc_core *core);
 void msm_vidc_batch_handler(struct work_struct *work);
@@ -31,6 +31,8 @@ bool msm_vidc_fw_coverage = !true;
 bool msm_vidc_thermal_mitigation_disabled = !true;
 int msm_vidc_clock_voting = !1;
 bool msm_vidc_syscache_disable = !true;
+bool msm_vidc_content_dcvs = !true;
+int msm_vidc_map_cache_size = 32;
 
 #define MAX_DBG_BUF_SIZE 4096
 
@@ -256,7 +258,9 @@ struct dentry *msm_vidc_debugfs_init_drv(void)
 	__debugfs_create(u32, "core_clock_voting",
 			&msm_vidc_clock_voting) &&
 	__debugfs_create(bool, "disable_video_syscache",
-			&msm_vidc_syscache_disable);
+			&msm_vidc_syscache_disable) &&
+	__debugfs_create(bool, "content_dcvs", &msm_vidc_content_dcvs) &&
+	__debugfs_create(u32, "map_cache_size", &msm_vidc_map_cache_size);
 
 #undef __debugfs_create
 
@@ -457,6 +461,24 @@ static ssize_t inst_info_read(struct file *file, char __user *buf,
 	cur += write_str(cur, end - cur, "EBD Count: %d\n", inst->count.ebd);
 	cur += write_str(cur, end - cur, "FTB Count: %d\n", inst->count.ftb);
 	cur += write_str(cur, end - cur, "FBD Count: %d\n", inst->count.fbd);
+	cur += write_str(cur, end - cur, "-----------Content DCVS--------\n");
+	cur += write_str(cur, end - cur, "frames: %llu\n",
+		inst->clk_data.content.frames);
+	cur += write_str(cur, end - cur, "avg vpp load: %llu%%\n",
+		inst->clk_data.content.frames ?
+		div64_u64(inst->clk_data.content.pct_sum,
+			inst->clk_data.content.frames) : 100);
+	cur += write_str(cur, end - cur, "underruns: %llu\n",
+		inst->clk_data.content.underruns);
+	cur += write_str(cur, end - cur, "-----------Mapping Cache-------\n");
+	cur += write_str(cur, end - cur, "cached: %u\n",
+		inst->smem_map_cache.count);
+	cur += write_str(cur, end - cur, "maps saved: %llu\n",
+		inst->smem_map_cache.hits);
+	cur += write_str(cur, end - cur, "misses: %llu\n",
+		inst->smem_map_cache.misses);
+	cur += write_str(cur, end - cur, "evictions: %llu\n",
+		inst->smem_map_cache.evictions);
 
 	publish_unreleased_reference(inst, &cur, end);
 	len = simple_read_from_buffer(buf, count, ppos,
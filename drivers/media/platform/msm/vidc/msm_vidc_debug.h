@@ -69,6 +69,8 @@ extern bool msm_vidc_fw_coverage;
 extern bool msm_vidc_thermal_mitigation_disabled;
 extern int msm_vidc_clock_voting;
 extern bool msm_vidc_syscache_disable;
+extern bool msm_vidc_content_dcvs;
+extern int msm_vidc_map_cache_size;
 
 #define dprintk(__level, __fmt, arg...)	\
 	do { \
@@ -119,6 +121,8 @@ static bool msm_vidc_fw_coverage = false;
 static bool msm_vidc_thermal_mitigation_disabled = false;
 static int msm_vidc_clock_voting = 0;
 static bool msm_vidc_syscache_disable = false;
+static bool msm_vidc_content_dcvs = false;
+static int msm_vidc_map_cache_size = 32;
 
 #define dprintk(__level, __fmt, arg...)	\
 	do { \
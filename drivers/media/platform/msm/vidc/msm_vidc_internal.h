@@ -345,16 +345,58 @@ struct buf_count {
 	int ebd;
 };
 
+/*
+ * Mappings of client buffers that were dequeued, kept so that a buffer
+ * coming back is not attached and mapped again. Most recently used first.
+ */
+struct msm_smem_map_cache {
+	struct list_head list;
+	/* Node in the list walked under memory pressure */
+	struct list_head node;
+	struct mutex lock;
+	u32 count;
+	u64 hits;
+	u64 misses;
+	u64 evictions;
+};
+
 struct batch_mode {
 	bool enable;
+	bool encode;
 	u32 size;
 };
 
+#define MAX_HFI_BATCH_SIZE 8
+
+/* Buffers collected to be handed to the firmware with one queue write */
+struct msm_vidc_hfi_batch {
+	int num_etbs;
+	int num_ftbs;
+	struct vidc_frame_data etbs[MAX_HFI_BATCH_SIZE];
+	struct vidc_frame_data ftbs[MAX_HFI_BATCH_SIZE];
+	struct msm_vidc_buffer *etb_bufs[MAX_HFI_BATCH_SIZE];
+	struct msm_vidc_buffer *ftb_bufs[MAX_HFI_BATCH_SIZE];
+};
+
 enum dcvs_flags {
 	MSM_VIDC_DCVS_INCR = BIT(0),
 	MSM_VIDC_DCVS_DECR = BIT(1),
 };
 
+/*
+ * Content aware DCVS state: predicted per-frame complexity, and how the
+ * prediction has fared.
+ */
+struct content_dcvs {
+	u32 cf;
+	u32 bits;
+	u32 last_pct;
+	u32 hold;
+	u64 frames;
+	u64 pct_sum;
+	u64 underruns;
+};
+
 struct clock_data {
 	int buffer_counter;
 	int load;
@@ -382,6 +424,7 @@ struct clock_data {
 	bool turbo_mode;
 	u32 work_route;
 	u32 dcvs_flags;
+	struct content_dcvs content;
 };
 
 struct profile_data {
@@ -499,6 +542,9 @@ struct msm_vidc_inst {
 	struct batch_mode batch;
 	struct timer_list batch_timer;
 	struct work_struct batch_work;
+	/* Protected by registeredbufs.lock */
+	struct msm_vidc_hfi_batch hfi_batch;
+	struct msm_smem_map_cache smem_map_cache;
 	bool decode_batching;
 	u32 max_filled_length;
 	bool operating_rate_set;
@@ -570,6 +616,10 @@ struct dma_buf *msm_smem_get_dma_buf(int fd);
 void msm_smem_put_dma_buf(void *dma_buf);
 int msm_smem_cache_operations(struct dma_buf *dbuf,
 	enum smem_cache_ops cache_op, unsigned long offset, unsigned long size);
+void msm_smem_map_cache_init(struct msm_vidc_inst *inst);
+void msm_smem_map_cache_deinit(struct msm_vidc_inst *inst);
+int msm_smem_register_shrinker(void);
+void msm_smem_unregister_shrinker(void);
 void msm_vidc_fw_unload_handler(struct work_struct *work);
 void msm_vidc_ssr_handler(struct work_struct *work);
 /*
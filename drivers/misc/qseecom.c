@@ -91,6 +91,8 @@
 
 #define QSEECOM_SEND_CMD_CRYPTO_TIMEOUT	2000
 #define QSEECOM_LOAD_APP_CRYPTO_TIMEOUT	2000
+/* Time clock votes are kept after a command on targets without bus scaling */
+#define QSEECOM_CLK_LINGER_TIMEOUT	100
 #define TWO 2
 #define QSEECOM_UFS_ICE_CE_NUM 10
 #define QSEECOM_SDCC_ICE_CE_NUM 20
@@ -310,6 +312,7 @@ struct qseecom_control {
 	enum qseecom_bandwidth_request_mode  current_mode;
 	struct timer_list bw_scale_down_timer;
 	struct work_struct bw_inactive_req_ws;
+	struct delayed_work clk_linger_work;
 	struct cdev cdev;
 	bool timer_running;
 	bool no_clock_support;
@@ -395,6 +398,10 @@ struct qseecom_dev_handle {
 	bool use_legacy_cmd;
 };
 
+/* Holds the clock votes kept between commands, see qseecom_clk_linger() */
+static struct qseecom_dev_handle qseecom_clk_linger_data;
+static DEFINE_MUTEX(clk_linger_lock);
+
 struct qseecom_key_id_usage_desc {
 	uint8_t desc[QSEECOM_KEY_ID_SIZE];
 };
@@ -1822,6 +1829,36 @@ static int qseecom_scale_bus_bandwidth(struct qseecom_dev_handle *data,
 	return ret;
 }
 
+/*
+ * Without bus scaling, the clock and bus votes taken for a command were
+ * dropped as soon as it completed, so a burst of commands (keymaster and
+ * fingerprint at unlock) turned the crypto clocks on and off around every
+ * one of them.  Keep a vote of our own for a little while after each
+ * command instead; callers take it before dropping their votes.
+ */
+static void qseecom_clk_linger(void)
+{
+	if (qseecom.no_clock_support || qseecom.support_bus_scaling)
+		return;
+
+	mutex_lock(&clk_linger_lock);
+	if (qseecom_clk_linger_data.perf_enabled ||
+	    !qseecom_perf_enable(&qseecom_clk_linger_data))
+		mod_delayed_work(system_wq, &qseecom.clk_linger_work,
+			msecs_to_jiffies(QSEECOM_CLK_LINGER_TIMEOUT));
+	mutex_unlock(&clk_linger_lock);
+}
+
+static void qseecom_clk_linger_work(struct work_struct *work)
+{
+	mutex_lock(&clk_linger_lock);
+	if (qseecom_clk_linger_data.perf_enabled) {
+		qsee_disable_clock_vote(&qseecom_clk_linger_data, CLK_DFAB);
+		qsee_disable_clock_vote(&qseecom_clk_linger_data, CLK_SFPB);
+	}
+	mutex_unlock(&clk_linger_lock);
+}
+
 static void __qseecom_add_bw_scale_down_timer(uint32_t duration)
 {
 	if (qseecom.no_clock_support)
@@ -3446,6 +3483,7 @@ static int qseecom_send_service_cmd(struct qseecom_dev_handle *data,
 
 exit:
 	if (!qseecom.support_bus_scaling) {
+		qseecom_clk_linger();
 		qsee_disable_clock_vote(data, CLK_DFAB);
 		qsee_disable_clock_vote(data, CLK_SFPB);
 	} else {
@@ -5142,6 +5180,7 @@ int qseecom_send_command(struct qseecom_handle *handle, void *send_buf,
 			QSEECOM_SEND_CMD_CRYPTO_TIMEOUT);
 
 	if (perf_enabled) {
+		qseecom_clk_linger();
 		qsee_disable_clock_vote(data, CLK_DFAB);
 		qsee_disable_clock_vote(data, CLK_SFPB);
 	}
@@ -7533,6 +7572,7 @@ static long qseecom_ioctl(struct file *file,
 			__qseecom_add_bw_scale_down_timer(
 				QSEECOM_SEND_CMD_CRYPTO_TIMEOUT);
 		if (perf_enabled) {
+			qseecom_clk_linger();
 			qsee_disable_clock_vote(data, CLK_DFAB);
 			qsee_disable_clock_vote(data, CLK_SFPB);
 		}
@@ -7597,6 +7637,7 @@ static long qseecom_ioctl(struct file *file,
 			__qseecom_add_bw_scale_down_timer(
 				QSEECOM_SEND_CMD_CRYPTO_TIMEOUT);
 		if (perf_enabled) {
+			qseecom_clk_linger();
 			qsee_disable_clock_vote(data, CLK_DFAB);
 			qsee_disable_clock_vote(data, CLK_SFPB);
 		}
@@ -9036,6 +9077,7 @@ static int qseecom_probe(struct platform_device *pdev)
 
 	qseecom.app_block_ref_cnt = 0;
 	init_waitqueue_head(&qseecom.app_block_wq);
+	INIT_DELAYED_WORK(&qseecom.clk_linger_work, qseecom_clk_linger_work);
 	qseecom.whitelist_support = true;
 
 	rc = alloc_chrdev_region(&qseecom_device_no, 0, 1, QSEECOM_DEV);
@@ -9387,6 +9429,9 @@ static int qseecom_remove(struct platform_device *pdev)
 	if (qseecom.qseos_version > QSEEE_VERSION_00)
 		qseecom_unload_commonlib_image();
 
+	mod_delayed_work(system_wq, &qseecom.clk_linger_work, 0);
+	flush_delayed_work(&qseecom.clk_linger_work);
+
 	if (qseecom.qsee_perf_client)
 		msm_bus_scale_client_update_request(qseecom.qsee_perf_client,
 									0);
@@ -9450,6 +9495,10 @@ static int qseecom_suspend(struct platform_device *pdev, pm_message_t state)
 	if (qseecom.no_clock_support)
 		return 0;
 
+	/* Don't keep the clocks to turn them back on at resume */
+	mod_delayed_work(system_wq, &qseecom.clk_linger_work, 0);
+	flush_delayed_work(&qseecom.clk_linger_work);
+
 	mutex_lock(&qsee_bw_mutex);
 	mutex_lock(&clk_access_lock);
 
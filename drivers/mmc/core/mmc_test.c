@@ -2079,6 +2079,58 @@ static int mmc_test_large_seq_write_perf(struct mmc_test_card *test)
 	return mmc_test_large_seq_perf(test, 1);
 }
 
+/*
+ * Copy performance: read each chunk from the first quarter of the card and
+ * write it out to the second, as a file copy to or from the card does.
+ */
+static int mmc_test_copy_perf_sz(struct mmc_test_card *test,
+				 unsigned int tot_sz)
+{
+	struct mmc_test_area *t = &test->area;
+	unsigned int src, dst, i, cnt, sz, ssz;
+	struct timespec ts1, ts2;
+	int ret;
+
+	sz = t->max_tfr;
+	ssz = sz >> 9;
+	src = mmc_test_capacity(test->card) / 4;
+	if (tot_sz > src << 9)
+		tot_sz = src << 9;
+	cnt = tot_sz / sz;
+	src &= 0xffff0000; /* Round to 64MiB boundary */
+	dst = src * 2;
+
+	getnstimeofday(&ts1);
+	for (i = 0; i < cnt; i++) {
+		ret = mmc_test_area_io(test, sz, src, 0, 0, 0);
+		if (ret)
+			return ret;
+		ret = mmc_test_area_io(test, sz, dst, 1, 0, 0);
+		if (ret)
+			return ret;
+		src += ssz;
+		dst += ssz;
+	}
+	getnstimeofday(&ts2);
+
+	mmc_test_print_avg_rate(test, sz, cnt, &ts1, &ts2);
+
+	return 0;
+}
+
+static int mmc_test_copy_perf(struct mmc_test_card *test)
+{
+	int ret, i;
+
+	for (i = 0; i < 3; i++) {
+		ret = mmc_test_copy_perf_sz(test, 100 * 1024 * 1024);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
 static int mmc_test_rw_multiple(struct mmc_test_card *test,
 				struct mmc_test_multiple_rw *tdata,
 				unsigned int reqsize, unsigned int size,
@@ -2935,6 +2987,13 @@ static const struct mmc_test_case mmc_test_cases[] = {
 		.run = mmc_test_cmds_during_write_cmd23_nonblock,
 		.cleanup = mmc_test_area_cleanup,
 	},
+
+	{
+		.name = "Sequential copy performance",
+		.prepare = mmc_test_area_prepare,
+		.run = mmc_test_copy_perf,
+		.cleanup = mmc_test_area_cleanup,
+	},
 };
 
 static DEFINE_MUTEX(mmc_test_lock);
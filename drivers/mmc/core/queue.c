@@ -484,6 +484,17 @@ int mmc_init_queue(struct mmc_queue *mq, struct mmc_card *card,
 	blk_queue_max_segments(mq->queue, host->max_segs);
 	blk_queue_max_segment_size(mq->queue, host->max_seg_size);
 
+	/*
+	 * SD cards are mostly read by large file copies, let read-ahead
+	 * build requests of the maximum size the host takes.
+	 */
+	if (mmc_card_sd(card))
+		mq->queue->backing_dev_info->ra_pages =
+			max_t(unsigned long,
+			      mq->queue->backing_dev_info->ra_pages,
+			      queue_max_hw_sectors(mq->queue) >>
+			      (PAGE_SHIFT - 9));
+
 	sema_init(&mq->thread_sem, 1);
 
 	mq->thread = kthread_run(mmc_queue_thread, mq, "mmcqd/%d%s",
@@ -473,6 +473,18 @@ static ssize_t show_auto_cmd21(struct device *dev,
 	return snprintf(buf, PAGE_SIZE, "%d\n", msm_host->en_auto_cmd21);
 }
 
+static ssize_t show_tuning_stats(struct device *dev,
+				 struct device_attribute *attr, char *buf)
+{
+	struct sdhci_host *host = dev_get_drvdata(dev);
+	struct sdhci_pltfm_host *pltfm_host = sdhci_priv(host);
+	struct sdhci_msm_host *msm_host = pltfm_host->priv;
+
+	return snprintf(buf, PAGE_SIZE, "phase %d cached %u full %u\n",
+			msm_host->saved_tuning_phase, msm_host->tuning_cached,
+			msm_host->tuning_full);
+}
+
 /* MSM auto-tuning handler */
 static int sdhci_msm_config_auto_tuning_cmd(struct sdhci_host *host,
 					    bool enable,
@@ -1199,6 +1211,91 @@ static void sdhci_msm_set_mmc_drv_type(struct sdhci_host *host, u32 opcode,
 			drv_type);
 }
 
+static bool sdhci_msm_tuning_phase_ok(struct sdhci_host *host, u32 opcode,
+				      u8 phase, u8 *data_buf,
+				      const u32 *pattern, int size)
+{
+	struct mmc_host *mmc = host->mmc;
+	struct mmc_command cmd = {0};
+	struct mmc_data data = {0};
+	struct mmc_request mrq = {
+		.cmd = &cmd,
+		.data = &data
+	};
+	struct scatterlist sg;
+
+	if (msm_config_cm_dll_phase(host, phase))
+		return false;
+
+	cmd.opcode = opcode;
+	cmd.flags = MMC_RSP_R1 | MMC_CMD_ADTC;
+
+	data.blksz = size;
+	data.blocks = 1;
+	data.flags = MMC_DATA_READ;
+	data.timeout_ns = 1000 * 1000 * 1000; /* 1 sec */
+
+	data.sg = &sg;
+	data.sg_len = 1;
+	sg_init_one(&sg, data_buf, size);
+	memset(data_buf, 0, size);
+	mmc_wait_for_req(mmc, &mrq);
+
+	/* Ignore crc errors occurred during tuning */
+	if (cmd.error)
+		mmc->err_stats[MMC_ERR_CMD_CRC]--;
+	else if (data.error)
+		mmc->err_stats[MMC_ERR_DAT_CRC]--;
+
+	return !cmd.error && !data.error && !memcmp(data_buf, pattern, size);
+}
+
+/*
+ * Re-tuning the same SD card at the same clock and timing usually ends
+ * up on the phase found last time. Check that phase and its neighbours
+ * instead of sweeping all of them, and fall back to the full sweep when
+ * one of the three fails.
+ */
+static bool sdhci_msm_tuning_cached(struct sdhci_host *host, u32 opcode,
+				    u8 *data_buf, const u32 *pattern,
+				    int size)
+{
+	struct sdhci_pltfm_host *pltfm_host = sdhci_priv(host);
+	struct sdhci_msm_host *msm_host = pltfm_host->priv;
+	struct mmc_card *card = host->mmc->card;
+	u8 phase = msm_host->saved_tuning_phase;
+	int i;
+
+	if (!card || !mmc_card_sd(card) || !msm_host->tuned_clock ||
+	    msm_host->tuned_clock != host->clock ||
+	    msm_host->tuned_timing != host->mmc->ios.timing ||
+	    memcmp(msm_host->tuned_cid, card->raw_cid,
+		   sizeof(msm_host->tuned_cid)))
+		return false;
+
+	if (msm_init_cm_dll(host, DLL_INIT_NORMAL))
+		return false;
+
+	for (i = -1; i <= 1; i++) {
+		if (!sdhci_msm_tuning_phase_ok(host, opcode,
+					       (phase + i) & (MAX_PHASES - 1),
+					       data_buf, pattern, size))
+			goto miss;
+	}
+
+	if (msm_config_cm_dll_phase(host, phase))
+		goto miss;
+
+	msm_host->tuning_cached++;
+	pr_debug("%s: %s: reusing tuning phase %d\n",
+		 mmc_hostname(host->mmc), __func__, phase);
+	return true;
+
+miss:
+	msm_host->tuned_clock = 0;
+	return false;
+}
+
 int sdhci_msm_execute_tuning(struct sdhci_host *host, u32 opcode)
 {
 	unsigned long flags;
@@ -1268,6 +1365,13 @@ int sdhci_msm_execute_tuning(struct sdhci_host *host, u32 opcode)
 		goto out;
 	}
 
+	if (sdhci_msm_tuning_cached(host, opcode, data_buf,
+				    tuning_block_pattern, size)) {
+		rc = 0;
+		goto kfree;
+	}
+	msm_host->tuning_full++;
+
 retry:
 	tuned_phase_cnt = 0;
 
@@ -1419,6 +1523,12 @@ int sdhci_msm_execute_tuning(struct sdhci_host *host, u32 opcode)
 		if (rc)
 			goto kfree;
 		msm_host->saved_tuning_phase = phase;
+		if (card && mmc_card_sd(card)) {
+			memcpy(msm_host->tuned_cid, card->raw_cid,
+			       sizeof(msm_host->tuned_cid));
+			msm_host->tuned_clock = host->clock;
+			msm_host->tuned_timing = ios.timing;
+		}
 		pr_debug("%s: %s: finally setting the tuning phase to %d\n",
 				mmc_hostname(mmc), __func__, phase);
 	} else {
@@ -5186,6 +5296,15 @@ static int sdhci_msm_probe(struct platform_device *pdev)
 		       mmc_hostname(host->mmc), __func__, ret);
 		device_remove_file(&pdev->dev, &msm_host->auto_cmd21_attr);
 	}
+
+	msm_host->tuning_stats_attr.show = show_tuning_stats;
+	sysfs_attr_init(&msm_host->tuning_stats_attr.attr);
+	msm_host->tuning_stats_attr.attr.name = "tuning_stats";
+	msm_host->tuning_stats_attr.attr.mode = 0444;
+	ret = device_create_file(&pdev->dev, &msm_host->tuning_stats_attr);
+	if (ret)
+		pr_err("%s: %s: failed creating tuning_stats attr: %d\n",
+		       mmc_hostname(host->mmc), __func__, ret);
 	if (sdhci_msm_is_bootdevice(&pdev->dev))
 		mmc_flush_detect_work(host->mmc);
 
@@ -5247,6 +5366,7 @@ static int sdhci_msm_remove(struct platform_device *pdev)
 		device_remove_file(&pdev->dev, &msm_host->polling);
 
 	device_remove_file(&pdev->dev, &msm_host->auto_cmd21_attr);
+	device_remove_file(&pdev->dev, &msm_host->tuning_stats_attr);
 	device_remove_file(&pdev->dev, &msm_host->msm_bus_vote.max_bus_bw);
 	pm_runtime_disable(&pdev->dev);
 
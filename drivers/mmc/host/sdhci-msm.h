@@ -237,6 +237,13 @@ struct sdhci_msm_host {
 	bool tuning_done;
 	bool calibration_done;
 	u8 saved_tuning_phase;
+	/* SD card and bus setting saved_tuning_phase was found for */
+	u32 tuned_cid[4];
+	unsigned int tuned_clock;
+	unsigned char tuned_timing;
+	u32 tuning_cached;
+	u32 tuning_full;
+	struct device_attribute tuning_stats_attr;
 	bool en_auto_cmd21;
 	struct device_attribute auto_cmd21_attr;
 	bool is_sdiowakeup_enabled;
@@ -0,0 +1,374 @@
+/* Copyright (c) 2020, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * RMNET ingress benchmark
+ *
+ * A recorded aggregated QMAP frame written to the debugfs "frame" file is
+ * replayed "count" times through the frag ingress path of the real device
+ * named in "dev", as if the hardware had handed it over back to back. The
+ * packets go on to the stack through the rmnet devices configured on that
+ * port, so the figure in "result" covers deaggregation, coalescing and
+ * delivery, but not the hardware driver.
+ */
+
+#include <linux/cpufreq.h>
+#include <linux/debugfs.h>
+#include <linux/if_ether.h>
+#include <linux/ktime.h>
+#include <linux/mm.h>
+#include <linux/mutex.h>
+#include <linux/netdevice.h>
+#include <linux/rtnetlink.h>
+#include <linux/seq_file.h>
+#include <linux/sizes.h>
+#include <linux/skbuff.h>
+#include <linux/string.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+#include <soc/qcom/rmnet_qmi.h>
+#include "rmnet_bench.h"
+#include "rmnet_config.h"
+#include "rmnet_descriptor.h"
+#include "rmnet_flow_stats.h"
+
+#define RMNET_BENCH_MAX_FRAME SZ_64K
+/* Frames prepared ahead of each timed batch */
+#define RMNET_BENCH_BATCH 64
+
+struct rmnet_bench_result {
+	u64 frames;
+	u64 bytes;
+	u64 packets;
+	u64 time_ns;
+	u64 cycles;
+	int err;
+};
+
+static struct dentry *rmnet_bench_dir;
+static DEFINE_MUTEX(rmnet_bench_mutex);
+static u8 *rmnet_bench_frame;
+static size_t rmnet_bench_frame_len;
+static char rmnet_bench_dev[IFNAMSIZ];
+static u32 rmnet_bench_count = 10000;
+static struct rmnet_bench_result rmnet_bench_last;
+
+static struct sk_buff *rmnet_bench_alloc_frame(struct net_device *dev)
+{
+	unsigned int order = get_order(rmnet_bench_frame_len);
+	struct sk_buff *skb;
+	struct page *page;
+
+	page = alloc_pages(GFP_KERNEL | __GFP_COMP, order);
+	if (!page)
+		return NULL;
+
+	skb = alloc_skb(0, GFP_KERNEL);
+	if (!skb) {
+		__free_pages(page, order);
+		return NULL;
+	}
+
+	memcpy(page_address(page), rmnet_bench_frame, rmnet_bench_frame_len);
+	skb_add_rx_frag(skb, 0, page, 0, rmnet_bench_frame_len,
+			PAGE_SIZE << order);
+	skb->dev = dev;
+	skb->protocol = htons(ETH_P_MAP);
+
+	return skb;
+}
+
+/* Hand @n frames to the port of @dev the way rmnet_rx_handler() does */
+static int rmnet_bench_batch(struct net_device *dev, struct sk_buff **skbs,
+			     int n, struct rmnet_bench_result *res)
+{
+	struct rmnet_port *port;
+	unsigned int khz;
+	int cpu, i;
+	u64 start, delta;
+
+	start = ktime_get_ns();
+	local_bh_disable();
+	rcu_read_lock();
+	cpu = smp_processor_id();
+	port = rmnet_get_port(dev);
+	if (!port) {
+		rcu_read_unlock();
+		local_bh_enable();
+		for (i = 0; i < n; i++)
+			kfree_skb(skbs[i]);
+		return -ENODEV;
+	}
+
+	for (i = 0; i < n; i++) {
+		rmnet_flow_stats_rx_start();
+		rmnet_frag_ingress_handler(skbs[i], port);
+		rmnet_flow_stats_set_rx_ts(0);
+	}
+	rcu_read_unlock();
+	/* Runs the GRO cells filled above, delivering to the stack */
+	local_bh_enable();
+	delta = ktime_get_ns() - start;
+
+	/* The arch counter doesn't tick at the CPU clock, estimate from the
+	 * frequency the CPU ran the batch at instead.
+	 */
+	khz = cpufreq_quick_get(cpu);
+	res->cycles += div_u64(delta * khz, USEC_PER_SEC);
+	res->time_ns += delta;
+	res->frames += n;
+	res->bytes += n * rmnet_bench_frame_len;
+
+	return 0;
+}
+
+static void rmnet_bench_run(struct rmnet_bench_result *res)
+{
+	struct sk_buff *skbs[RMNET_BENCH_BATCH];
+	struct net_device *dev;
+	u64 rx_start, rx_end, tx;
+	void *port;
+	u32 left;
+	int i, n;
+
+	memset(res, 0, sizeof(*res));
+	if (!rmnet_bench_frame_len) {
+		res->err = -ENODATA;
+		return;
+	}
+
+	dev = dev_get_by_name(&init_net, rmnet_bench_dev);
+	if (!dev) {
+		res->err = -ENODEV;
+		return;
+	}
+
+	rtnl_lock();
+	port = rmnet_get_port(dev);
+	rmnet_get_packets(port, &rx_start, &tx);
+	rtnl_unlock();
+	if (!port) {
+		res->err = -ENODEV;
+		goto out;
+	}
+
+	for (left = rmnet_bench_count; left; left -= n) {
+		n = min_t(u32, left, RMNET_BENCH_BATCH);
+		for (i = 0; i < n; i++) {
+			skbs[i] = rmnet_bench_alloc_frame(dev);
+			if (!skbs[i])
+				break;
+		}
+
+		if (i < n) {
+			while (i--)
+				kfree_skb(skbs[i]);
+			res->err = -ENOMEM;
+			break;
+		}
+
+		res->err = rmnet_bench_batch(dev, skbs, n, res);
+		if (res->err)
+			break;
+
+		cond_resched();
+	}
+
+	rtnl_lock();
+	port = rmnet_get_port(dev);
+	if (port) {
+		rmnet_get_packets(port, &rx_end, &tx);
+		res->packets = rx_end - rx_start;
+	}
+	rtnl_unlock();
+
+out:
+	dev_put(dev);
+}
+
+static ssize_t rmnet_bench_frame_write(struct file *file,
+				       const char __user *buf, size_t len,
+				       loff_t *ppos)
+{
+	ssize_t ret;
+
+	if (*ppos >= RMNET_BENCH_MAX_FRAME)
+		return -EFBIG;
+
+	mutex_lock(&rmnet_bench_mutex);
+	/* A write from the start of the file replaces the frame */
+	if (!*ppos)
+		rmnet_bench_frame_len = 0;
+	ret = simple_write_to_buffer(rmnet_bench_frame, RMNET_BENCH_MAX_FRAME,
+				     ppos, buf, len);
+	if (ret > 0)
+		rmnet_bench_frame_len = max_t(size_t, rmnet_bench_frame_len,
+					      *ppos);
+	mutex_unlock(&rmnet_bench_mutex);
+
+	return ret;
+}
+
+static ssize_t rmnet_bench_frame_read(struct file *file, char __user *buf,
+				      size_t len, loff_t *ppos)
+{
+	ssize_t ret;
+
+	mutex_lock(&rmnet_bench_mutex);
+	ret = simple_read_from_buffer(buf, len, ppos, rmnet_bench_frame,
+				      rmnet_bench_frame_len);
+	mutex_unlock(&rmnet_bench_mutex);
+
+	return ret;
+}
+
+static const struct file_operations rmnet_bench_frame_fops = {
+	.owner = THIS_MODULE,
+	.write = rmnet_bench_frame_write,
+	.read = rmnet_bench_frame_read,
+	.llseek = default_llseek,
+};
+
+static ssize_t rmnet_bench_dev_write(struct file *file,
+				     const char __user *buf, size_t len,
+				     loff_t *ppos)
+{
+	char name[IFNAMSIZ];
+
+	if (len >= sizeof(name))
+		return -EINVAL;
+
+	if (copy_from_user(name, buf, len))
+		return -EFAULT;
+
+	name[len] = '\0';
+	mutex_lock(&rmnet_bench_mutex);
+	strlcpy(rmnet_bench_dev, strim(name), sizeof(rmnet_bench_dev));
+	mutex_unlock(&rmnet_bench_mutex);
+
+	return len;
+}
+
+static int rmnet_bench_dev_show(struct seq_file *s, void *unused)
+{
+	mutex_lock(&rmnet_bench_mutex);
+	seq_printf(s, "%s\n", rmnet_bench_dev);
+	mutex_unlock(&rmnet_bench_mutex);
+
+	return 0;
+}
+
+static int rmnet_bench_dev_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, rmnet_bench_dev_show, NULL);
+}
+
+static const struct file_operations rmnet_bench_dev_fops = {
+	.owner = THIS_MODULE,
+	.open = rmnet_bench_dev_open,
+	.read = seq_read,
+	.write = rmnet_bench_dev_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int rmnet_bench_run_set(void *data, u64 val)
+{
+	if (val != 1)
+		return -EINVAL;
+
+	mutex_lock(&rmnet_bench_mutex);
+	rmnet_bench_run(&rmnet_bench_last);
+	mutex_unlock(&rmnet_bench_mutex);
+
+	return rmnet_bench_last.err;
+}
+
+DEFINE_SIMPLE_ATTRIBUTE(rmnet_bench_run_fops, NULL, rmnet_bench_run_set,
+			"%llu\n");
+
+static int rmnet_bench_result_show(struct seq_file *s, void *unused)
+{
+	struct rmnet_bench_result *res = &rmnet_bench_last;
+	u64 pps = 0, ns = 0, cycles = 0, mbps = 0;
+
+	mutex_lock(&rmnet_bench_mutex);
+	if (res->time_ns) {
+		pps = div64_u64(res->packets * NSEC_PER_SEC, res->time_ns);
+		mbps = div64_u64(res->bytes * 8 * MSEC_PER_SEC, res->time_ns);
+	}
+	if (res->packets) {
+		ns = div64_u64(res->time_ns, res->packets);
+		cycles = div64_u64(res->cycles, res->packets);
+	}
+
+	seq_printf(s, "frames: %llu\n", res->frames);
+	seq_printf(s, "bytes: %llu\n", res->bytes);
+	seq_printf(s, "packets: %llu\n", res->packets);
+	seq_printf(s, "time_us: %llu\n", div_u64(res->time_ns, NSEC_PER_USEC));
+	seq_printf(s, "pps: %llu\n", pps);
+	seq_printf(s, "mbps: %llu\n", mbps);
+	seq_printf(s, "ns_per_pkt: %llu\n", ns);
+	seq_printf(s, "cycles_per_pkt: %llu\n", cycles);
+	seq_printf(s, "err: %d\n", res->err);
+	mutex_unlock(&rmnet_bench_mutex);
+
+	return 0;
+}
+
+static int rmnet_bench_result_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, rmnet_bench_result_show, NULL);
+}
+
+static const struct file_operations rmnet_bench_result_fops = {
+	.owner = THIS_MODULE,
+	.open = rmnet_bench_result_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+int rmnet_bench_init(void)
+{
+	rmnet_bench_frame = vmalloc(RMNET_BENCH_MAX_FRAME);
+	if (!rmnet_bench_frame)
+		return -ENOMEM;
+
+	rmnet_bench_dir = debugfs_create_dir("rmnet_bench", NULL);
+	if (IS_ERR_OR_NULL(rmnet_bench_dir)) {
+		/* Not fatal, the driver works without its benchmark */
+		vfree(rmnet_bench_frame);
+		rmnet_bench_frame = NULL;
+		rmnet_bench_dir = NULL;
+		return 0;
+	}
+
+	debugfs_create_file("frame", 0600, rmnet_bench_dir, NULL,
+			    &rmnet_bench_frame_fops);
+	debugfs_create_file("dev", 0600, rmnet_bench_dir, NULL,
+			    &rmnet_bench_dev_fops);
+	debugfs_create_u32("count", 0600, rmnet_bench_dir,
+			   &rmnet_bench_count);
+	debugfs_create_file("run", 0200, rmnet_bench_dir, NULL,
+			    &rmnet_bench_run_fops);
+	debugfs_create_file("result", 0400, rmnet_bench_dir, NULL,
+			    &rmnet_bench_result_fops);
+
+	return 0;
+}
+
+void rmnet_bench_exit(void)
+{
+	debugfs_remove_recursive(rmnet_bench_dir);
+	rmnet_bench_dir = NULL;
+	vfree(rmnet_bench_frame);
+	rmnet_bench_frame = NULL;
+}
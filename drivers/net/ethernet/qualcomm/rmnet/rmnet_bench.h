@@ -0,0 +1,33 @@
+/* Copyright (c) 2020, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * RMNET ingress benchmark
+ *
+ */
+
+#ifndef _RMNET_BENCH_H_
+#define _RMNET_BENCH_H_
+
+#ifdef CONFIG_RMNET_BENCH
+int rmnet_bench_init(void);
+void rmnet_bench_exit(void);
+#else
+static inline int rmnet_bench_init(void)
+{
+	return 0;
+}
+
+static inline void rmnet_bench_exit(void)
+{
+}
+#endif
+
+#endif /* _RMNET_BENCH_H_ */
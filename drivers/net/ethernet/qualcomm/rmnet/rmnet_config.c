@@ -25,6 +25,8 @@
 #include "rmnet_private.h"
 #include "rmnet_map.h"
 #include "rmnet_descriptor.h"
+#include "rmnet_flow_stats.h"
+#include "rmnet_bench.h"
 #include <soc/qcom/rmnet_qmi.h>
 #include <soc/qcom/qmi_rmnet.h>
 
@@ -747,6 +749,16 @@ int rmnet_get_dlmarker_info(void *port)
 }
 EXPORT_SYMBOL(rmnet_get_dlmarker_info);
 
+bool rmnet_get_ul_agg_enabled(void *port)
+{
+	if (!port)
+		return false;
+
+	return ((struct rmnet_port *)port)->data_format &
+		RMNET_EGRESS_FORMAT_AGGREGATION;
+}
+EXPORT_SYMBOL(rmnet_get_ul_agg_enabled);
+
 #endif
 
 struct rmnet_endpoint *rmnet_get_ip6_route_endpoint(struct rmnet_port *port,
@@ -897,8 +909,22 @@ static int __init rmnet_init(void)
 	if (rc != 0)
 		goto err2;
 
+	rc = rmnet_flow_stats_init();
+	if (rc != 0)
+		goto err3;
+
+	rc = rmnet_bench_init();
+	if (rc != 0)
+		goto err4;
+
 	return 0;
 
+err4:
+	rmnet_flow_stats_exit();
+
+err3:
+	unregister_inetaddr_notifier(&rmnet_addr4_notifier_block);
+
 err2:
 	unregister_inet6addr_notifier(&rmnet_addr6_notifier_block);
 
@@ -912,6 +938,8 @@ static int __init rmnet_init(void)
 
 static void __exit rmnet_exit(void)
 {
+	rmnet_bench_exit();
+	rmnet_flow_stats_exit();
 	unregister_inetaddr_notifier(&rmnet_addr4_notifier_block);
 	unregister_inet6addr_notifier(&rmnet_addr6_notifier_block);
 	unregister_netdevice_notifier(&rmnet_dev_notifier);
@@ -32,9 +32,16 @@ struct rmnet_endpoint {
 	struct hlist_node hlnode;
 };
 
+#define RMNET_AGG_HIST_BUCKETS 5
+
 struct rmnet_agg_stats {
 	u64 ul_agg_reuse;
 	u64 ul_agg_alloc;
+	u64 ul_agg_prio_flush;
+	/* Packets per aggregate: 1, 2-3, 4-7, 8-15, 16+ */
+	u64 ul_agg_size_hist[RMNET_AGG_HIST_BUCKETS];
+	/* Aggregate age at flush: <100us, <500us, <1ms, <2ms, 2ms+ */
+	u64 ul_agg_delay_hist[RMNET_AGG_HIST_BUCKETS];
 };
 
 struct rmnet_ip_route_endpoint {
@@ -97,6 +104,9 @@ struct rmnet_port {
 	u8 agg_size_order;
 	struct list_head agg_list;
 	struct rmnet_agg_page *agg_head;
+	/* Adaptive aggregation: average packet gap and current time limit */
+	u32 agg_gap_avg;
+	u32 agg_adapt_time;
 
 	void *qmi_info;
 
@@ -108,6 +118,9 @@ struct rmnet_port {
 	/* Descriptor pool */
 	spinlock_t desc_pool_lock;
 	struct rmnet_frag_descriptor_pool *frag_desc_pool;
+
+	/* Per-CPU queues for steering deaggregated frames */
+	struct rmnet_rx_steer_cell __percpu *rx_steer;
 };
 
 extern struct rtnl_link_ops rmnet_link_ops;
@@ -152,6 +165,7 @@ struct rmnet_coal_stats {
 	u64 coal_tcp_bytes;
 	u64 coal_udp;
 	u64 coal_udp_bytes;
+	u64 coal_gso_merge;
 };
 
 struct rmnet_priv_stats {
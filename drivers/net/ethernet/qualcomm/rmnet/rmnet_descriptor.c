@@ -15,10 +15,14 @@
 
 #include <linux/ip.h>
 #include <linux/ipv6.h>
+#include <linux/jhash.h>
+#include <linux/moduleparam.h>
+#include <linux/smp.h>
 #include <net/ipv6.h>
 #include <net/ip6_checksum.h>
 #include "rmnet_config.h"
 #include "rmnet_descriptor.h"
+#include "rmnet_flow_stats.h"
 #include "rmnet_handlers.h"
 #include "rmnet_private.h"
 #include "rmnet_vnd.h"
@@ -448,6 +452,17 @@ static void rmnet_frag_partial_csum(struct sk_buff *skb,
 	skb->csum_start = (u8 *)iph + frag_desc->ip_len - skb->head;
 }
 
+/* Take the sk_buff from the per-CPU NAPI cache when running with BH
+ * disabled, which is the case for everything coming through the rx_handler.
+ * rmnet_frag_deliver() is also exported, so fall back to the slab otherwise.
+ */
+static struct sk_buff *rmnet_alloc_rx_skb(unsigned int len)
+{
+	int flags = (in_softirq() && !in_irq()) ? SKB_ALLOC_NAPI : 0;
+
+	return __alloc_skb(len, GFP_ATOMIC, flags, NUMA_NO_NODE);
+}
+
 /* Allocate and populate an skb to contain the packet represented by the
  * frag descriptor.
  */
@@ -462,8 +477,8 @@ static struct sk_buff *rmnet_alloc_skb(struct rmnet_frag_descriptor *frag_desc,
 	if (frag_desc->hdrs_valid) {
 		u16 hdr_len = frag_desc->ip_len + frag_desc->trans_len;
 
-		head_skb = alloc_skb(hdr_len + RMNET_MAP_DEAGGR_HEADROOM,
-				     GFP_ATOMIC);
+		head_skb = rmnet_alloc_rx_skb(hdr_len +
+					      RMNET_MAP_DEAGGR_HEADROOM);
 		if (!head_skb)
 			return NULL;
 
@@ -491,8 +506,7 @@ static struct sk_buff *rmnet_alloc_skb(struct rmnet_frag_descriptor *frag_desc,
 		/* Allocate enough space to avoid penalties in the stack
 		 * from __pskb_pull_tail()
 		 */
-		head_skb = alloc_skb(256 + RMNET_MAP_DEAGGR_HEADROOM,
-				     GFP_ATOMIC);
+		head_skb = rmnet_alloc_rx_skb(256 + RMNET_MAP_DEAGGR_HEADROOM);
 		if (!head_skb)
 			return NULL;
 
@@ -529,7 +543,7 @@ static struct sk_buff *rmnet_alloc_skb(struct rmnet_frag_descriptor *frag_desc,
 			}
 		} else {
 			/* Alloc a new skb and try again */
-			skb = alloc_skb(0, GFP_ATOMIC);
+			skb = rmnet_alloc_rx_skb(0);
 			if (!skb)
 				break;
 
@@ -863,6 +877,23 @@ rmnet_frag_segment_coal_data(struct rmnet_frag_descriptor *coal_desc,
 		return;
 	}
 
+	/* Same for a TCP frame with a single short packet at the end. The
+	 * shorter last segment is fine for GSO, and the IP length fields are
+	 * rewritten by rmnet_frag_partial_csum() when the skb is built.
+	 */
+	if (gro && coal_desc->trans_proto == IPPROTO_TCP &&
+	    coal_hdr->csum_valid && !nlo_err_mask &&
+	    rmnet_map_v5_coal_tail_ok(coal_hdr)) {
+		coal_desc->csum_valid = true;
+		coal_desc->hdr_ptr = rmnet_frag_data_ptr(coal_desc);
+		coal_desc->gso_size = ntohs(coal_hdr->nl_pairs[0].pkt_len);
+		coal_desc->gso_size -= coal_desc->ip_len + coal_desc->trans_len;
+		coal_desc->gso_segs = coal_hdr->nl_pairs[0].num_packets + 1;
+		priv->stats.coal.coal_gso_merge++;
+		list_add_tail(&coal_desc->list, list);
+		return;
+	}
+
 	/* Segment the coalesced descriptor into new packets */
 	for (nlo = 0; nlo < coal_hdr->num_nlos; nlo++) {
 		pkt_len = ntohs(coal_hdr->nl_pairs[nlo].pkt_len);
@@ -1172,6 +1203,305 @@ __rmnet_frag_ingress_handler(struct rmnet_frag_descriptor *frag_desc,
 rmnet_perf_chain_hook_t rmnet_perf_chain_end __rcu __read_mostly;
 EXPORT_SYMBOL(rmnet_perf_chain_end);
 
+/* RX steering
+ *
+ * Frames are moved to other CPUs straight after deaggregation, so the cost
+ * of segmenting coalesced frames and building the skbs is spread out too.
+ * All frames of a flow hash to the same CPU and each CPU queue is FIFO, so
+ * ordering within a flow is kept.
+ */
+struct rmnet_rx_steer_cell {
+	struct list_head queue;
+	spinlock_t lock;
+	struct napi_struct napi;
+	call_single_data_t csd;
+	struct rmnet_port *port;
+};
+
+struct rmnet_rx_steer_stats {
+	u64 packets;
+	u64 bytes;
+};
+
+static DEFINE_PER_CPU(struct rmnet_rx_steer_stats, rmnet_rx_steer_stats);
+
+/* CPUs to steer to, flattened so the hot path avoids walking the mask */
+static struct cpumask rmnet_rx_steer_mask;
+static int rmnet_rx_steer_map[NR_CPUS];
+static unsigned int rmnet_rx_steer_len;
+static DEFINE_MUTEX(rmnet_rx_steer_mutex);
+
+static int rmnet_rx_steer_cpus_set(const char *val,
+				   const struct kernel_param *kp)
+{
+	struct cpumask mask;
+	unsigned int len = 0;
+	int cpu, rc;
+
+	rc = cpumask_parse(val, &mask);
+	if (rc)
+		return rc;
+
+	mutex_lock(&rmnet_rx_steer_mutex);
+	/* Stop steering while the map is rewritten */
+	WRITE_ONCE(rmnet_rx_steer_len, 0);
+	synchronize_net();
+
+	for_each_cpu(cpu, &mask)
+		rmnet_rx_steer_map[len++] = cpu;
+
+	cpumask_copy(&rmnet_rx_steer_mask, &mask);
+	smp_wmb();
+	WRITE_ONCE(rmnet_rx_steer_len, len);
+	mutex_unlock(&rmnet_rx_steer_mutex);
+
+	return 0;
+}
+
+static int rmnet_rx_steer_cpus_get(char *buf, const struct kernel_param *kp)
+{
+	return scnprintf(buf, PAGE_SIZE, "%*pb\n",
+			 cpumask_pr_args(&rmnet_rx_steer_mask));
+}
+
+static const struct kernel_param_ops rmnet_rx_steer_cpus_ops = {
+	.set = rmnet_rx_steer_cpus_set,
+	.get = rmnet_rx_steer_cpus_get,
+};
+
+module_param_cb(rx_steer_cpus, &rmnet_rx_steer_cpus_ops, NULL, 0644);
+MODULE_PARM_DESC(rx_steer_cpus,
+		 "Hex mask of CPUs deaggregated frames are steered to");
+
+static int rmnet_rx_steer_stats_get(char *buf, const struct kernel_param *kp)
+{
+	int cpu, len = 0;
+
+	for_each_possible_cpu(cpu) {
+		struct rmnet_rx_steer_stats *stats;
+
+		stats = per_cpu_ptr(&rmnet_rx_steer_stats, cpu);
+		len += scnprintf(buf + len, PAGE_SIZE - len,
+				 "cpu%d packets %llu bytes %llu\n", cpu,
+				 stats->packets, stats->bytes);
+	}
+
+	return len;
+}
+
+static const struct kernel_param_ops rmnet_rx_steer_stats_ops = {
+	.get = rmnet_rx_steer_stats_get,
+};
+
+module_param_cb(rx_steer_stats, &rmnet_rx_steer_stats_ops, NULL, 0444);
+MODULE_PARM_DESC(rx_steer_stats, "Per-CPU count of steered frames");
+
+/* Hash the IP addresses and ports of a frame that still has its MAP headers */
+static u32 rmnet_frag_flow_hash(struct rmnet_frag_descriptor *frag_desc)
+{
+	struct rmnet_map_header *qmap;
+	u32 size = skb_frag_size(&frag_desc->frag);
+	u32 offset = sizeof(*qmap);
+	u32 ports = 0, hash;
+	u8 *data, proto;
+
+	data = rmnet_frag_data_ptr(frag_desc);
+	qmap = (struct rmnet_map_header *)data;
+	if (qmap->next_hdr) {
+		if (rmnet_frag_get_next_hdr_type(frag_desc) ==
+		    RMNET_MAP_HEADER_TYPE_COALESCING)
+			offset += sizeof(struct rmnet_map_v5_coal_header);
+		else
+			offset += sizeof(struct rmnet_map_v5_csum_header);
+	}
+
+	if (size < offset + sizeof(struct iphdr))
+		return 0;
+
+	data += offset;
+	size -= offset;
+
+	if ((data[0] & 0xF0) == 0x40) {
+		struct iphdr *iph = (struct iphdr *)data;
+
+		offset = iph->ihl * 4;
+		proto = iph->protocol;
+		hash = jhash_2words((__force u32)iph->saddr,
+				    (__force u32)iph->daddr, proto);
+		if (ip_is_fragment(iph))
+			proto = 0;
+	} else if ((data[0] & 0xF0) == 0x60) {
+		struct ipv6hdr *ip6h = (struct ipv6hdr *)data;
+
+		if (size < sizeof(*ip6h))
+			return 0;
+
+		offset = sizeof(*ip6h);
+		proto = ip6h->nexthdr;
+		hash = jhash2((u32 *)&ip6h->saddr,
+			      2 * sizeof(struct in6_addr) / sizeof(u32),
+			      proto);
+	} else {
+		return 0;
+	}
+
+	if ((proto == IPPROTO_TCP || proto == IPPROTO_UDP) &&
+	    size >= offset + sizeof(ports))
+		memcpy(&ports, data + offset, sizeof(ports));
+
+	return jhash_1word(ports, hash) ? : 1;
+}
+
+/* Returns the CPU a frame should be handled on, or -1 to handle it here */
+static int rmnet_rx_steer_cpu(struct rmnet_frag_descriptor *frag_desc,
+			      struct rmnet_port *port)
+{
+	struct rmnet_map_header *qmap;
+	unsigned int len = READ_ONCE(rmnet_rx_steer_len);
+	u32 hash;
+	int cpu;
+
+	if (!len || !port->rx_steer)
+		return -1;
+
+	/* Commands have to stay in order with the frames around them */
+	qmap = (struct rmnet_map_header *)rmnet_frag_data_ptr(frag_desc);
+	if (qmap->cd_bit)
+		return -1;
+
+	hash = rmnet_frag_flow_hash(frag_desc);
+	if (!hash)
+		return -1;
+
+	smp_rmb();
+	cpu = rmnet_rx_steer_map[reciprocal_scale(hash, len)];
+	if (cpu == smp_processor_id() || !cpu_online(cpu))
+		return -1;
+
+	return cpu;
+}
+
+static void rmnet_rx_steer_ipi(void *data)
+{
+	struct rmnet_rx_steer_cell *cell = data;
+
+	napi_schedule(&cell->napi);
+}
+
+static void rmnet_rx_steer_enqueue(struct rmnet_frag_descriptor *frag_desc,
+				   struct rmnet_port *port, int cpu)
+{
+	struct rmnet_rx_steer_cell *cell = per_cpu_ptr(port->rx_steer, cpu);
+	bool kick;
+
+	/* Delivery delay keeps counting from the original receive */
+	frag_desc->rx_ts = rmnet_flow_stats_rx_ts();
+
+	spin_lock(&cell->lock);
+	kick = list_empty(&cell->queue);
+	list_add_tail(&frag_desc->list, &cell->queue);
+	spin_unlock(&cell->lock);
+
+	/* The queue only empties from the poll, so an idle queue needs a kick */
+	if (kick && smp_call_function_single_async(cpu, &cell->csd))
+		napi_schedule(&cell->napi);
+}
+
+static int rmnet_rx_steer_poll(struct napi_struct *napi, int budget)
+{
+	struct rmnet_rx_steer_cell *cell;
+	struct rmnet_rx_steer_stats *stats;
+	struct rmnet_frag_descriptor *frag_desc, *tmp;
+	rmnet_perf_chain_hook_t rmnet_perf_opt_chain_end;
+	LIST_HEAD(list);
+	int work = 0;
+
+	cell = container_of(napi, struct rmnet_rx_steer_cell, napi);
+	stats = this_cpu_ptr(&rmnet_rx_steer_stats);
+
+	spin_lock(&cell->lock);
+	list_splice_init(&cell->queue, &list);
+	spin_unlock(&cell->lock);
+
+	list_for_each_entry_safe(frag_desc, tmp, &list, list) {
+		if (work == budget)
+			break;
+
+		list_del_init(&frag_desc->list);
+		stats->packets++;
+		stats->bytes += skb_frag_size(&frag_desc->frag);
+		rmnet_flow_stats_set_rx_ts(frag_desc->rx_ts);
+		__rmnet_frag_ingress_handler(frag_desc, cell->port);
+		work++;
+	}
+	rmnet_flow_stats_set_rx_ts(0);
+
+	rcu_read_lock();
+	rmnet_perf_opt_chain_end = rcu_dereference(rmnet_perf_chain_end);
+	if (rmnet_perf_opt_chain_end)
+		rmnet_perf_opt_chain_end();
+	rcu_read_unlock();
+
+	if (work == budget) {
+		/* Put back what is left ahead of anything queued meanwhile */
+		spin_lock(&cell->lock);
+		list_splice(&list, &cell->queue);
+		spin_unlock(&cell->lock);
+		return budget;
+	}
+
+	napi_complete_done(napi, work);
+	return work;
+}
+
+static int rmnet_rx_steer_init(struct rmnet_port *port)
+{
+	int cpu;
+
+	port->rx_steer = alloc_percpu(struct rmnet_rx_steer_cell);
+	if (!port->rx_steer)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu) {
+		struct rmnet_rx_steer_cell *cell;
+
+		cell = per_cpu_ptr(port->rx_steer, cpu);
+		INIT_LIST_HEAD(&cell->queue);
+		spin_lock_init(&cell->lock);
+		cell->csd.func = rmnet_rx_steer_ipi;
+		cell->csd.info = cell;
+		cell->port = port;
+		netif_napi_add(port->dev, &cell->napi, rmnet_rx_steer_poll,
+			       NAPI_POLL_WEIGHT);
+		napi_enable(&cell->napi);
+	}
+
+	return 0;
+}
+
+static void rmnet_rx_steer_deinit(struct rmnet_port *port)
+{
+	struct rmnet_frag_descriptor *frag_desc, *tmp;
+	int cpu;
+
+	if (!port->rx_steer)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		struct rmnet_rx_steer_cell *cell;
+
+		cell = per_cpu_ptr(port->rx_steer, cpu);
+		napi_disable(&cell->napi);
+		netif_napi_del(&cell->napi);
+
+		list_for_each_entry_safe(frag_desc, tmp, &cell->queue, list)
+			rmnet_recycle_frag_descriptor(frag_desc, port);
+	}
+
+	free_percpu(port->rx_steer);
+	port->rx_steer = NULL;
+}
+
 void rmnet_frag_ingress_handler(struct sk_buff *skb,
 				struct rmnet_port *port)
 {
@@ -1191,8 +1521,15 @@ void rmnet_frag_ingress_handler(struct sk_buff *skb,
 
 			list_for_each_entry_safe(frag_desc, tmp, &desc_list,
 						 list) {
+				int cpu = rmnet_rx_steer_cpu(frag_desc, port);
+
 				list_del_init(&frag_desc->list);
-				__rmnet_frag_ingress_handler(frag_desc, port);
+				if (cpu >= 0)
+					rmnet_rx_steer_enqueue(frag_desc, port,
+							       cpu);
+				else
+					__rmnet_frag_ingress_handler(frag_desc,
+								     port);
 			}
 		}
 
@@ -1214,7 +1551,11 @@ void rmnet_descriptor_deinit(struct rmnet_port *port)
 	struct rmnet_frag_descriptor_pool *pool;
 	struct rmnet_frag_descriptor *frag_desc, *tmp;
 
+	rmnet_rx_steer_deinit(port);
+
 	pool = port->frag_desc_pool;
+	if (!pool)
+		return;
 
 	list_for_each_entry_safe(frag_desc, tmp, &pool->free_list, list) {
 		kfree(frag_desc);
@@ -1250,5 +1591,5 @@ int rmnet_descriptor_init(struct rmnet_port *port)
 		pool->pool_size++;
 	}
 
-	return 0;
+	return rmnet_rx_steer_init(port);
 }
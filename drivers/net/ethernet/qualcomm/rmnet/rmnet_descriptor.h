@@ -34,6 +34,7 @@ struct rmnet_frag_descriptor {
 	u8 *hdr_ptr;
 	struct net_device *dev;
 	u32 hash;
+	u64 rx_ts;
 	__be32 tcp_seq;
 	__be16 ip_id;
 	u16 data_offset;
@@ -0,0 +1,276 @@
+/* Copyright (c) 2020, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * RMNET per-flow statistics
+ *
+ * Every skb handed to the stack is accounted to a small direct-mapped
+ * table of flows. While /dev/rmnet_flow_stats is open, the flows that saw
+ * traffic are periodically copied into a ring the reader maps, so a
+ * daemon can follow per-flow throughput, coalescing and delivery delay
+ * without tracing.
+ */
+
+#include <linux/fs.h>
+#include <linux/hash.h>
+#include <linux/if_ether.h>
+#include <linux/ip.h>
+#include <linux/ipv6.h>
+#include <linux/jiffies.h>
+#include <linux/ktime.h>
+#include <linux/miscdevice.h>
+#include <linux/mm.h>
+#include <linux/moduleparam.h>
+#include <linux/mutex.h>
+#include <linux/spinlock.h>
+#include <linux/vmalloc.h>
+#include <linux/workqueue.h>
+#include <uapi/linux/rmnet_flow_stats.h>
+#include "rmnet_config.h"
+#include "rmnet_flow_stats.h"
+
+#define RMNET_FLOW_TABLE_BITS 8
+#define RMNET_FLOW_TABLE_SIZE (1 << RMNET_FLOW_TABLE_BITS)
+#define RMNET_FLOW_RING_SLOTS 1024
+/* An entry idle for this long can be taken over by another flow */
+#define RMNET_FLOW_IDLE_MS 5000
+
+struct rmnet_flow_stats_entry {
+	spinlock_t lock;
+	u32 hash;
+	u8 mux_id;
+	u8 ip_version;
+	u8 trans_proto;
+	bool dirty;
+	unsigned long last_seen;
+	u64 packets;
+	u64 skbs;
+	u64 bytes;
+	u64 delay_sum_ns;
+	u64 delay_max_ns;
+};
+
+DEFINE_PER_CPU(u64, rmnet_flow_rx_ts);
+
+static struct rmnet_flow_stats_entry rmnet_flow_table[RMNET_FLOW_TABLE_SIZE];
+static atomic64_t rmnet_flow_untracked;
+
+static struct rmnet_flow_stats_ring_hdr *rmnet_flow_ring;
+static size_t rmnet_flow_ring_size;
+static unsigned int rmnet_flow_ring_users;
+static DEFINE_MUTEX(rmnet_flow_ring_mutex);
+static struct delayed_work rmnet_flow_sample_work;
+
+static bool rmnet_flow_stats_enable = true;
+module_param_named(flow_stats, rmnet_flow_stats_enable, bool, 0644);
+MODULE_PARM_DESC(flow_stats, "Account delivered packets per flow");
+
+static unsigned int rmnet_flow_stats_interval_ms = 100;
+module_param_named(flow_stats_interval_ms, rmnet_flow_stats_interval_ms,
+		   uint, 0644);
+MODULE_PARM_DESC(flow_stats_interval_ms,
+		 "Interval at which flows are sampled into the ring");
+
+void rmnet_flow_stats_rx_start(void)
+{
+	if (READ_ONCE(rmnet_flow_stats_enable))
+		rmnet_flow_stats_set_rx_ts(ktime_get_ns());
+}
+
+void rmnet_flow_stats_record(struct sk_buff *skb, struct rmnet_priv *priv)
+{
+	struct rmnet_flow_stats_entry *entry;
+	u64 rx_ts, delay = 0;
+	u8 ip_version, trans_proto;
+	u32 hash;
+
+	if (!READ_ONCE(rmnet_flow_stats_enable))
+		return;
+
+	switch (skb->protocol) {
+	case htons(ETH_P_IP):
+		ip_version = 4;
+		trans_proto = ip_hdr(skb)->protocol;
+		break;
+	case htons(ETH_P_IPV6):
+		ip_version = 6;
+		trans_proto = ipv6_hdr(skb)->nexthdr;
+		break;
+	default:
+		return;
+	}
+
+	hash = skb_get_hash(skb);
+	rx_ts = rmnet_flow_stats_rx_ts();
+	if (rx_ts)
+		delay = ktime_get_ns() - rx_ts;
+
+	entry = &rmnet_flow_table[hash_32(hash, RMNET_FLOW_TABLE_BITS)];
+	spin_lock(&entry->lock);
+	if (entry->hash != hash) {
+		/* Keep a busy flow rather than thrash between two */
+		if (entry->hash &&
+		    time_before(jiffies, entry->last_seen +
+				msecs_to_jiffies(RMNET_FLOW_IDLE_MS))) {
+			spin_unlock(&entry->lock);
+			atomic64_inc(&rmnet_flow_untracked);
+			return;
+		}
+
+		entry->hash = hash;
+		entry->mux_id = priv->mux_id;
+		entry->ip_version = ip_version;
+		entry->trans_proto = trans_proto;
+		entry->packets = 0;
+		entry->skbs = 0;
+		entry->bytes = 0;
+		entry->delay_sum_ns = 0;
+		entry->delay_max_ns = 0;
+	}
+
+	entry->packets += skb_is_gso(skb) ? skb_shinfo(skb)->gso_segs : 1;
+	entry->skbs++;
+	entry->bytes += skb->len;
+	entry->delay_sum_ns += delay;
+	if (delay > entry->delay_max_ns)
+		entry->delay_max_ns = delay;
+	entry->last_seen = jiffies;
+	entry->dirty = true;
+	spin_unlock(&entry->lock);
+}
+
+static void rmnet_flow_sample_fn(struct work_struct *work)
+{
+	struct rmnet_flow_stats_ring_hdr *hdr = rmnet_flow_ring;
+	struct rmnet_flow_stats_sample *slots;
+	u64 now = ktime_get_ns();
+	u64 head = hdr->head;
+	int i;
+
+	slots = (void *)hdr + hdr->hdr_size;
+	for (i = 0; i < RMNET_FLOW_TABLE_SIZE; i++) {
+		struct rmnet_flow_stats_entry *entry = &rmnet_flow_table[i];
+		struct rmnet_flow_stats_sample *slot;
+
+		if (!READ_ONCE(entry->dirty))
+			continue;
+
+		slot = &slots[head % RMNET_FLOW_RING_SLOTS];
+		WRITE_ONCE(slot->seq, slot->seq + 1);
+		smp_wmb();
+
+		spin_lock_bh(&entry->lock);
+		slot->hash = entry->hash;
+		slot->mux_id = entry->mux_id;
+		slot->ip_version = entry->ip_version;
+		slot->trans_proto = entry->trans_proto;
+		slot->packets = entry->packets;
+		slot->skbs = entry->skbs;
+		slot->bytes = entry->bytes;
+		slot->delay_sum_ns = entry->delay_sum_ns;
+		slot->delay_max_ns = entry->delay_max_ns;
+		entry->delay_max_ns = 0;
+		entry->dirty = false;
+		spin_unlock_bh(&entry->lock);
+		slot->timestamp_ns = now;
+
+		smp_wmb();
+		WRITE_ONCE(slot->seq, slot->seq + 1);
+		head++;
+	}
+
+	hdr->untracked = atomic64_read(&rmnet_flow_untracked);
+	hdr->interval_ms = READ_ONCE(rmnet_flow_stats_interval_ms);
+	smp_wmb();
+	WRITE_ONCE(hdr->head, head);
+
+	queue_delayed_work(system_power_efficient_wq, &rmnet_flow_sample_work,
+			   msecs_to_jiffies(max(hdr->interval_ms, 10U)));
+}
+
+static int rmnet_flow_stats_open(struct inode *inode, struct file *file)
+{
+	mutex_lock(&rmnet_flow_ring_mutex);
+	if (!rmnet_flow_ring_users++)
+		queue_delayed_work(system_power_efficient_wq,
+				   &rmnet_flow_sample_work, 0);
+	mutex_unlock(&rmnet_flow_ring_mutex);
+
+	return 0;
+}
+
+static int rmnet_flow_stats_release(struct inode *inode, struct file *file)
+{
+	mutex_lock(&rmnet_flow_ring_mutex);
+	if (!--rmnet_flow_ring_users)
+		cancel_delayed_work_sync(&rmnet_flow_sample_work);
+	mutex_unlock(&rmnet_flow_ring_mutex);
+
+	return 0;
+}
+
+static int rmnet_flow_stats_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	/* The ring is only ever written by the kernel */
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+
+	vma->vm_flags &= ~VM_MAYWRITE;
+	return remap_vmalloc_range(vma, rmnet_flow_ring, vma->vm_pgoff);
+}
+
+static const struct file_operations rmnet_flow_stats_fops = {
+	.owner = THIS_MODULE,
+	.open = rmnet_flow_stats_open,
+	.release = rmnet_flow_stats_release,
+	.mmap = rmnet_flow_stats_mmap,
+};
+
+static struct miscdevice rmnet_flow_stats_dev = {
+	.minor = MISC_DYNAMIC_MINOR,
+	.name = "rmnet_flow_stats",
+	.fops = &rmnet_flow_stats_fops,
+};
+
+int rmnet_flow_stats_init(void)
+{
+	int i, rc;
+
+	for (i = 0; i < RMNET_FLOW_TABLE_SIZE; i++)
+		spin_lock_init(&rmnet_flow_table[i].lock);
+
+	rmnet_flow_ring_size = PAGE_ALIGN(sizeof(*rmnet_flow_ring) +
+					  RMNET_FLOW_RING_SLOTS *
+					  sizeof(struct rmnet_flow_stats_sample));
+	rmnet_flow_ring = vmalloc_user(rmnet_flow_ring_size);
+	if (!rmnet_flow_ring)
+		return -ENOMEM;
+
+	rmnet_flow_ring->version = RMNET_FLOW_STATS_VERSION;
+	rmnet_flow_ring->hdr_size = sizeof(*rmnet_flow_ring);
+	rmnet_flow_ring->slot_size = sizeof(struct rmnet_flow_stats_sample);
+	rmnet_flow_ring->nr_slots = RMNET_FLOW_RING_SLOTS;
+	INIT_DELAYED_WORK(&rmnet_flow_sample_work, rmnet_flow_sample_fn);
+
+	rc = misc_register(&rmnet_flow_stats_dev);
+	if (rc) {
+		vfree(rmnet_flow_ring);
+		rmnet_flow_ring = NULL;
+	}
+
+	return rc;
+}
+
+void rmnet_flow_stats_exit(void)
+{
+	misc_deregister(&rmnet_flow_stats_dev);
+	vfree(rmnet_flow_ring);
+	rmnet_flow_ring = NULL;
+}
@@ -0,0 +1,41 @@
+/* Copyright (c) 2020, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * RMNET per-flow statistics
+ *
+ */
+
+#ifndef _RMNET_FLOW_STATS_H_
+#define _RMNET_FLOW_STATS_H_
+
+#include <linux/percpu.h>
+#include <linux/skbuff.h>
+#include "rmnet_config.h"
+
+/* Time the frame being handled on this CPU was received by rmnet */
+DECLARE_PER_CPU(u64, rmnet_flow_rx_ts);
+
+static inline u64 rmnet_flow_stats_rx_ts(void)
+{
+	return __this_cpu_read(rmnet_flow_rx_ts);
+}
+
+static inline void rmnet_flow_stats_set_rx_ts(u64 ts)
+{
+	__this_cpu_write(rmnet_flow_rx_ts, ts);
+}
+
+void rmnet_flow_stats_rx_start(void);
+void rmnet_flow_stats_record(struct sk_buff *skb, struct rmnet_priv *priv);
+int rmnet_flow_stats_init(void);
+void rmnet_flow_stats_exit(void);
+
+#endif /* _RMNET_FLOW_STATS_H_ */
@@ -27,6 +27,7 @@
 #include "rmnet_map.h"
 #include "rmnet_handlers.h"
 #include "rmnet_descriptor.h"
+#include "rmnet_flow_stats.h"
 
 #include <soc/qcom/rmnet_qmi.h>
 #include <soc/qcom/qmi_rmnet.h>
@@ -111,6 +112,7 @@ rmnet_deliver_skb(struct sk_buff *skb, struct rmnet_port *port)
 	skb_reset_transport_header(skb);
 	skb_reset_network_header(skb);
 	rmnet_vnd_rx_fixup(skb->dev, skb->len);
+	rmnet_flow_stats_record(skb, priv);
 
 	skb->pkt_type = PACKET_HOST;
 	skb_set_mac_header(skb, 0);
@@ -509,6 +511,7 @@ rx_handler_result_t rmnet_rx_handler(struct sk_buff **pskb)
 			0xDEF, 0xDEF, 0xDEF, NULL, NULL);
 	dev = skb->dev;
 	port = rmnet_get_port(dev);
+	rmnet_flow_stats_rx_start();
 
 	switch (port->rmnet_mode) {
 	case RMNET_EPMODE_VND:
@@ -519,6 +522,8 @@ rx_handler_result_t rmnet_rx_handler(struct sk_buff **pskb)
 		break;
 	}
 
+	rmnet_flow_stats_set_rx_ts(0);
+
 done:
 	return RX_HANDLER_CONSUMED;
 }
@@ -13,6 +13,7 @@
  *
  */
 
+#include <linux/module.h>
 #include <linux/netdevice.h>
 #include <linux/ip.h>
 #include <linux/ipv6.h>
@@ -598,6 +599,20 @@ bool rmnet_map_v5_csum_buggy(struct rmnet_map_v5_coal_header *coal_hdr)
 	return false;
 }
 
+/* A TCP burst commonly ends with a single shorter packet, which the HW
+ * reports as a second NLO. Every segment but the last still has the same
+ * length, so the frame is a valid GSO packet as-is and doesn't need to be
+ * split up only to be merged again by GRO.
+ */
+bool rmnet_map_v5_coal_tail_ok(struct rmnet_map_v5_coal_header *coal_hdr)
+{
+	if (coal_hdr->num_nlos != 2 || coal_hdr->nl_pairs[1].num_packets != 1)
+		return false;
+
+	return ntohs(coal_hdr->nl_pairs[1].pkt_len) <
+	       ntohs(coal_hdr->nl_pairs[0].pkt_len);
+}
+
 static void rmnet_map_move_headers(struct sk_buff *skb)
 {
 	struct iphdr *iph;
@@ -995,6 +1010,35 @@ static void rmnet_map_segment_coal_skb(struct sk_buff *coal_skb,
 		return;
 	}
 
+	/* Same for a TCP frame with a single short packet at the end. The
+	 * shorter last segment is fine for GSO, so the whole frame goes up
+	 * as one packet once the IP length fields cover all of it.
+	 */
+	if (gro && coal_meta.trans_proto == IPPROTO_TCP &&
+	    coal_hdr->csum_valid && !nlo_err_mask &&
+	    rmnet_map_v5_coal_tail_ok(coal_hdr)) {
+		rmnet_map_move_headers(coal_skb);
+		iph = (struct iphdr *)rmnet_map_data_ptr(coal_skb);
+		if (coal_meta.ip_proto == 4) {
+			iph->tot_len = htons(coal_skb->len);
+			iph->check = 0;
+			iph->check = ip_fast_csum(iph, iph->ihl);
+		} else {
+			((struct ipv6hdr *)iph)->payload_len =
+				htons(coal_skb->len - sizeof(struct ipv6hdr));
+		}
+
+		coal_meta.data_len = ntohs(coal_hdr->nl_pairs[0].pkt_len);
+		coal_meta.data_len -= coal_meta.ip_len + coal_meta.trans_len;
+		coal_meta.pkt_count = coal_hdr->nl_pairs[0].num_packets + 1;
+		rmnet_map_partial_csum(coal_skb, &coal_meta);
+		rmnet_map_gso_stamp(coal_skb, &coal_meta);
+		priv->stats.coal.coal_gso_merge++;
+
+		__skb_queue_tail(list, coal_skb);
+		return;
+	}
+
 	/* Segment the coalesced SKB into new packets */
 	for (nlo = 0; nlo < coal_hdr->num_nlos; nlo++) {
 		pkt_len = ntohs(coal_hdr->nl_pairs[nlo].pkt_len);
@@ -1204,6 +1248,21 @@ int rmnet_map_process_next_hdr_packet(struct sk_buff *skb,
 long rmnet_agg_time_limit __read_mostly = 1000000L;
 long rmnet_agg_bypass_time __read_mostly = 10000000L;
 
+/* Adaptive UL aggregation. When enabled, the aggregation time limit follows
+ * the observed packet gap instead of the fixed rmnet_agg_time_limit, and
+ * packets with a priority mark flush the aggregate right away.
+ */
+static bool rmnet_agg_adaptive __read_mostly;
+module_param_named(ul_agg_adaptive, rmnet_agg_adaptive, bool, 0644);
+MODULE_PARM_DESC(ul_agg_adaptive,
+		 "Adapt UL aggregation time to the traffic pattern");
+
+#define RMNET_AGG_ADAPT_MIN_TIME 100000L
+
+static const long rmnet_agg_delay_buckets[RMNET_AGG_HIST_BUCKETS - 1] = {
+	100000L, 500000L, 1000000L, 2000000L,
+};
+
 int rmnet_map_tx_agg_skip(struct sk_buff *skb, int offset)
 {
 	u8 *packet_start = skb->data + offset;
@@ -1232,6 +1291,56 @@ int rmnet_map_tx_agg_skip(struct sk_buff *skb, int offset)
 	return is_icmp;
 }
 
+/* Called with agg_lock held right before the aggregate is sent out */
+static void rmnet_map_agg_flush_stats(struct rmnet_port *port)
+{
+	struct rmnet_agg_stats *stats = &port->stats.agg;
+	struct timespec now, diff;
+	int i;
+
+	i = min_t(int, fls(port->agg_count) - 1, RMNET_AGG_HIST_BUCKETS - 1);
+	if (i >= 0)
+		stats->ul_agg_size_hist[i]++;
+
+	getnstimeofday(&now);
+	diff = timespec_sub(now, port->agg_time);
+	for (i = 0; i < RMNET_AGG_HIST_BUCKETS - 1; i++) {
+		if (!diff.tv_sec && diff.tv_nsec < rmnet_agg_delay_buckets[i])
+			break;
+	}
+
+	stats->ul_agg_delay_hist[i]++;
+}
+
+/* Track the average gap between UL packets and derive the aggregation time
+ * limit from it. Bulk traffic gets enough time to fill agg_count packets,
+ * up to the configured agg_time. Traffic too sparse to put two packets in
+ * one aggregate within agg_time only waits the minimum time.
+ */
+static void rmnet_map_agg_adapt(struct rmnet_port *port, struct timespec *gap)
+{
+	struct rmnet_egress_agg_params *params = &port->egress_agg_params;
+	u64 gap_ns, limit;
+
+	if (gap->tv_sec > 0 || gap->tv_nsec > rmnet_agg_bypass_time)
+		gap_ns = rmnet_agg_bypass_time;
+	else
+		gap_ns = gap->tv_nsec;
+
+	/* Moving average with a weight of 1/8 for the newest sample */
+	port->agg_gap_avg = port->agg_gap_avg - (port->agg_gap_avg >> 3) +
+			    (gap_ns >> 3);
+
+	if ((u64)port->agg_gap_avg * 2 > params->agg_time)
+		limit = RMNET_AGG_ADAPT_MIN_TIME;
+	else
+		limit = (u64)port->agg_gap_avg * params->agg_count;
+
+	port->agg_adapt_time = clamp_t(u64, limit, RMNET_AGG_ADAPT_MIN_TIME,
+				       max_t(u64, params->agg_time,
+					     RMNET_AGG_ADAPT_MIN_TIME));
+}
+
 static void rmnet_map_flush_tx_packet_work(struct work_struct *work)
 {
 	struct sk_buff *skb = NULL;
@@ -1244,6 +1353,7 @@ static void rmnet_map_flush_tx_packet_work(struct work_struct *work)
 	if (likely(port->agg_state == -EINPROGRESS)) {
 		/* Buffer may have already been shipped out */
 		if (likely(port->agg_skb)) {
+			rmnet_map_agg_flush_stats(port);
 			skb = port->agg_skb;
 			port->agg_skb = NULL;
 			port->agg_count = 0;
@@ -1415,12 +1525,22 @@ void rmnet_map_tx_aggregate(struct sk_buff *skb, struct rmnet_port *port)
 	int size, agg_count = 0;
 	struct sk_buff *agg_skb;
 	unsigned long flags;
+	bool adaptive = READ_ONCE(rmnet_agg_adaptive);
+	bool prio = adaptive && skb->priority;
+	long time_limit = rmnet_agg_time_limit;
+	u64 timer_ns;
 
 new_packet:
 	spin_lock_irqsave(&port->agg_lock, flags);
 	memcpy(&last, &port->agg_last, sizeof(struct timespec));
 	getnstimeofday(&port->agg_last);
 
+	if (adaptive) {
+		diff = timespec_sub(port->agg_last, last);
+		rmnet_map_agg_adapt(port, &diff);
+		time_limit = port->agg_adapt_time;
+	}
+
 	if (!port->agg_skb) {
 		/* Check to see if we should agg first. If the traffic is very
 		 * sparse, don't aggregate. We will need to tune this later
@@ -1429,7 +1549,7 @@ void rmnet_map_tx_aggregate(struct sk_buff *skb, struct rmnet_port *port)
 		size = port->egress_agg_params.agg_size - skb->len;
 
 		if (diff.tv_sec > 0 || diff.tv_nsec > rmnet_agg_bypass_time ||
-		    size <= 0) {
+		    size <= 0 || prio) {
 			spin_unlock_irqrestore(&port->agg_lock, flags);
 			skb->protocol = htons(ETH_P_MAP);
 			dev_queue_xmit(skb);
@@ -1459,7 +1579,8 @@ void rmnet_map_tx_aggregate(struct sk_buff *skb, struct rmnet_port *port)
 
 	if (skb->len > size ||
 	    port->agg_count >= port->egress_agg_params.agg_count ||
-	    diff.tv_sec > 0 || diff.tv_nsec > rmnet_agg_time_limit) {
+	    diff.tv_sec > 0 || diff.tv_nsec > time_limit) {
+		rmnet_map_agg_flush_stats(port);
 		agg_skb = port->agg_skb;
 		agg_count = port->agg_count;
 		port->agg_skb = 0;
@@ -1476,11 +1597,28 @@ void rmnet_map_tx_aggregate(struct sk_buff *skb, struct rmnet_port *port)
 	port->agg_count++;
 	dev_kfree_skb_any(skb);
 
+	/* Don't hold latency sensitive packets back for the timer */
+	if (prio) {
+		port->stats.agg.ul_agg_prio_flush++;
+		rmnet_map_agg_flush_stats(port);
+		agg_skb = port->agg_skb;
+		port->agg_skb = 0;
+		port->agg_count = 0;
+		memset(&port->agg_time, 0, sizeof(struct timespec));
+		port->agg_state = 0;
+		spin_unlock_irqrestore(&port->agg_lock, flags);
+		hrtimer_cancel(&port->hrtimer);
+		dev_queue_xmit(agg_skb);
+		return;
+	}
+
 schedule:
 	if (port->agg_state != -EINPROGRESS) {
 		port->agg_state = -EINPROGRESS;
-		hrtimer_start(&port->hrtimer,
-			      ns_to_ktime(port->egress_agg_params.agg_time),
+		timer_ns = port->egress_agg_params.agg_time;
+		if (adaptive)
+			timer_ns = port->agg_adapt_time;
+		hrtimer_start(&port->hrtimer, ns_to_ktime(timer_ns),
 			      HRTIMER_MODE_REL);
 	}
 	spin_unlock_irqrestore(&port->agg_lock, flags);
@@ -1496,6 +1634,7 @@ void rmnet_map_update_ul_agg_config(struct rmnet_port *port, u16 size,
 	port->egress_agg_params.agg_time = time;
 	port->egress_agg_params.agg_size = size;
 	port->egress_agg_params.agg_features = features;
+	port->agg_adapt_time = time;
 
 	rmnet_free_agg_pages(port);
 
@@ -1569,6 +1708,7 @@ void rmnet_map_tx_qmap_cmd(struct sk_buff *qmap_skb)
 	if (port->data_format & RMNET_EGRESS_FORMAT_AGGREGATION) {
 		spin_lock_irqsave(&port->agg_lock, flags);
 		if (port->agg_skb) {
+			rmnet_map_agg_flush_stats(port);
 			agg_skb = port->agg_skb;
 			port->agg_skb = 0;
 			port->agg_count = 0;
@@ -224,6 +224,7 @@ static const char rmnet_gstrings_stats[][ETH_GSTRING_LEN] = {
 	"Coalescing TCP bytes",
 	"Coalescing UDP frames",
 	"Coalescing UDP bytes",
+	"Coalescing GSO tail merges",
 	"Uplink priority packets",
 };
 
@@ -242,6 +243,17 @@ static const char rmnet_port_gstrings_stats[][ETH_GSTRING_LEN] = {
 	"DL trailer pkts received",
 	"UL agg reuse",
 	"UL agg alloc",
+	"UL agg priority flushes",
+	"UL agg size 1 pkt",
+	"UL agg size 2-3 pkts",
+	"UL agg size 4-7 pkts",
+	"UL agg size 8-15 pkts",
+	"UL agg size 16+ pkts",
+	"UL agg delay <100us",
+	"UL agg delay <500us",
+	"UL agg delay <1ms",
+	"UL agg delay <2ms",
+	"UL agg delay 2ms+",
 };
 
 static void rmnet_get_strings(struct net_device *dev, u32 stringset, u8 *buf)
@@ -140,6 +140,106 @@ static const struct file_operations cnss_stats_fops = {
 	.llseek		= seq_lseek,
 };
 
+static ssize_t cnss_link_pred_write(struct file *fp,
+				    const char __user *user_buf,
+				    size_t count, loff_t *off)
+{
+	struct cnss_plat_data *plat_priv =
+		((struct seq_file *)fp->private_data)->private;
+	struct cnss_pci_data *pci_priv;
+	char buf[64];
+	char *cmd;
+	unsigned int len = 0;
+
+	if (!plat_priv)
+		return -ENODEV;
+
+	pci_priv = plat_priv->bus_priv;
+	if (!pci_priv)
+		return -ENODEV;
+
+	len = min(count, sizeof(buf) - 1);
+	if (copy_from_user(buf, user_buf, len))
+		return -EFAULT;
+
+	buf[len] = '\0';
+	cmd = buf;
+
+	if (sysfs_streq(cmd, "enable"))
+		cnss_pci_link_pred_enable(pci_priv, true);
+	else if (sysfs_streq(cmd, "disable"))
+		cnss_pci_link_pred_enable(pci_priv, false);
+	else if (sysfs_streq(cmd, "reset"))
+		cnss_pci_link_pred_reset(pci_priv);
+	else
+		return -EINVAL;
+
+	return count;
+}
+
+static int cnss_link_pred_show(struct seq_file *s, void *data)
+{
+	struct cnss_plat_data *plat_priv = s->private;
+	struct cnss_pci_data *pci_priv = plat_priv->bus_priv;
+	struct cnss_link_pred *pred;
+	u64 resumes, demand_resumes, prewakes, prewake_hits, false_wakes;
+	u64 lat_sum_us;
+	u32 period_us, lat_max_us;
+	unsigned long flags;
+	bool enabled;
+
+	if (!pci_priv) {
+		seq_puts(s, "PCI device is not probed\n");
+		return 0;
+	}
+
+	pred = &pci_priv->link_pred;
+	spin_lock_irqsave(&pred->lock, flags);
+	enabled = pred->enabled;
+	period_us = pred->period_us;
+	resumes = pred->resumes;
+	demand_resumes = pred->demand_resumes;
+	prewakes = pred->prewakes;
+	prewake_hits = pred->prewake_hits;
+	false_wakes = pred->false_wakes;
+	lat_sum_us = pred->lat_sum_us;
+	lat_max_us = pred->lat_max_us;
+	spin_unlock_irqrestore(&pred->lock, flags);
+
+	seq_printf(s, "enabled: %d\n", enabled);
+	seq_printf(s, "period_us: %u\n", period_us);
+	seq_printf(s, "resumes: %llu\n", resumes);
+	seq_printf(s, "demand_resumes: %llu\n", demand_resumes);
+	seq_printf(s, "prewakes: %llu\n", prewakes);
+	seq_printf(s, "prewake_hits: %llu\n", prewake_hits);
+	seq_printf(s, "false_wakes: %llu\n", false_wakes);
+	seq_printf(s, "resume_latency_avg_us: %llu\n",
+		   resumes ? div64_u64(lat_sum_us, resumes) : 0);
+	seq_printf(s, "resume_latency_max_us: %u\n", lat_max_us);
+
+	seq_puts(s, "\nUsage: echo <action> > <debugfs_path>/cnss/link_pred\n");
+	seq_puts(s, "<action> can be one of below:\n");
+	seq_puts(s, "enable: pre-resume PCIe link for periodic traffic\n");
+	seq_puts(s, "disable: only resume PCIe link on demand\n");
+	seq_puts(s, "reset: forget learned period and clear counters\n");
+
+	return 0;
+}
+
+static int cnss_link_pred_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, cnss_link_pred_show, inode->i_private);
+}
+
+static const struct file_operations cnss_link_pred_fops = {
+	.read		= seq_read,
+	.write		= cnss_link_pred_write,
+	.release	= single_release,
+	.open		= cnss_link_pred_open,
+	.owner		= THIS_MODULE,
+	.llseek		= seq_lseek,
+};
+
 static ssize_t cnss_dev_boot_debug_write(struct file *fp,
 					 const char __user *user_buf,
 					 size_t count, loff_t *off)
@@ -701,6 +801,8 @@ int cnss_debugfs_create(struct cnss_plat_data *plat_priv)
 			    &cnss_pin_connect_fops);
 	debugfs_create_file("stats", 0644, root_dentry, plat_priv,
 			    &cnss_stats_fops);
+	debugfs_create_file("link_pred", 0644, root_dentry, plat_priv,
+			    &cnss_link_pred_fops);
 
 	cnss_create_debug_only_node(plat_priv);
 
@@ -56,6 +56,11 @@
 #define FW_ASSERT_TIMEOUT		5000
 #define DEV_RDDM_TIMEOUT		5000
 
+#define LINK_PRED_MIN_INTERVALS		4
+#define LINK_PRED_MAX_PERIOD_US		(10 * USEC_PER_SEC)
+#define LINK_PRED_MARGIN_US		2000
+#define LINK_PRED_MAX_FALSE_WAKES	2
+
 #ifdef CONFIG_CNSS_EMULATION
 #define EMULATION_HW			1
 #else
@@ -1782,6 +1787,235 @@ static int cnss_pci_resume_noirq(struct device *dev)
 	return ret;
 }
 
+/*
+ * Bursts of traffic that wake the link from runtime suspend are often
+ * periodic (video chunks, VoIP, keepalives). Learn the interval between
+ * bursts and resume the link early enough to absorb the resume latency
+ * of the next one. Whether a burst followed a pre-resume is judged when
+ * the link suspends next, from the runtime PM last_busy mark.
+ */
+static u32 cnss_link_pred_period(struct cnss_link_pred *pred)
+{
+	u32 i, idx, sum = 0, mean;
+
+	if (pred->nr_interval < LINK_PRED_MIN_INTERVALS)
+		return 0;
+
+	for (i = 0; i < LINK_PRED_MIN_INTERVALS; i++) {
+		idx = (pred->interval_idx + CNSS_LINK_PRED_HIST - 1 - i) %
+			CNSS_LINK_PRED_HIST;
+		sum += pred->interval[idx];
+	}
+	mean = sum / LINK_PRED_MIN_INTERVALS;
+
+	/* Only predict when recent intervals agree within 1/8 */
+	for (i = 0; i < LINK_PRED_MIN_INTERVALS; i++) {
+		idx = (pred->interval_idx + CNSS_LINK_PRED_HIST - 1 - i) %
+			CNSS_LINK_PRED_HIST;
+		if (abs((s32)(pred->interval[idx] - mean)) > mean / 8)
+			return 0;
+	}
+
+	return mean;
+}
+
+static void cnss_link_pred_forget(struct cnss_link_pred *pred)
+{
+	pred->nr_interval = 0;
+	pred->interval_idx = 0;
+	pred->period_us = 0;
+	pred->last_burst = 0;
+	pred->false_wake_run = 0;
+	pred->prewake_active = false;
+}
+
+/* Called with pred->lock held */
+static void cnss_link_pred_arm(struct cnss_link_pred *pred)
+{
+	ktime_t now = ktime_get();
+	ktime_t burst;
+	u32 lead;
+
+	if (!pred->enabled || !pred->period_us)
+		return;
+
+	lead = pred->lat_avg_us + max_t(u32, LINK_PRED_MARGIN_US,
+					jiffies_to_usecs(1));
+	lead = min(lead, pred->period_us / 2);
+
+	burst = ktime_add_us(pred->last_burst, pred->period_us);
+	while (ktime_before(ktime_sub_us(burst, lead), now)) {
+		pred->last_burst = burst;
+		burst = ktime_add_us(burst, pred->period_us);
+	}
+
+	hrtimer_start(&pred->timer, ktime_sub_us(burst, lead),
+		      HRTIMER_MODE_ABS);
+}
+
+/* Called with pred->lock held */
+static void cnss_link_pred_burst(struct cnss_link_pred *pred, ktime_t ts)
+{
+	s64 delta_us;
+
+	if (pred->last_burst) {
+		delta_us = ktime_us_delta(ts, pred->last_burst);
+		if (delta_us > 0 && delta_us <= LINK_PRED_MAX_PERIOD_US) {
+			pred->interval[pred->interval_idx] = delta_us;
+			pred->interval_idx = (pred->interval_idx + 1) %
+				CNSS_LINK_PRED_HIST;
+			if (pred->nr_interval < CNSS_LINK_PRED_HIST)
+				pred->nr_interval++;
+		} else {
+			pred->nr_interval = 0;
+		}
+	}
+
+	pred->last_burst = ts;
+	pred->period_us = cnss_link_pred_period(pred);
+	cnss_link_pred_arm(pred);
+}
+
+static enum hrtimer_restart cnss_link_pred_timer_fn(struct hrtimer *timer)
+{
+	struct cnss_link_pred *pred =
+		container_of(timer, struct cnss_link_pred, timer);
+	struct cnss_pci_data *pci_priv =
+		container_of(pred, struct cnss_pci_data, link_pred);
+	struct device *dev = &pci_priv->pci_dev->dev;
+	unsigned long flags;
+	bool prewake = false;
+
+	spin_lock_irqsave(&pred->lock, flags);
+	if (!pred->enabled || !pred->period_us || pci_priv->pci_link_down_ind)
+		goto out;
+
+	if (pm_runtime_suspended(dev)) {
+		pred->prewaking = true;
+		pred->prewake_burst = ktime_add_us(pred->last_burst,
+						   pred->period_us);
+		prewake = true;
+	} else if (!pred->prewake_active) {
+		/* Link already up for the burst, keep following the period */
+		cnss_link_pred_burst(pred, ktime_add_us(pred->last_burst,
+							pred->period_us));
+	}
+out:
+	spin_unlock_irqrestore(&pred->lock, flags);
+
+	if (prewake && pm_request_resume(dev) < 0) {
+		spin_lock_irqsave(&pred->lock, flags);
+		pred->prewaking = false;
+		spin_unlock_irqrestore(&pred->lock, flags);
+	}
+
+	return HRTIMER_NORESTART;
+}
+
+static void cnss_link_pred_resumed(struct cnss_pci_data *pci_priv,
+				   ktime_t start)
+{
+	struct cnss_link_pred *pred = &pci_priv->link_pred;
+	struct device *dev = &pci_priv->pci_dev->dev;
+	u32 lat_us = ktime_us_delta(ktime_get(), start);
+	unsigned long flags;
+
+	spin_lock_irqsave(&pred->lock, flags);
+	pred->resumes++;
+	pred->lat_sum_us += lat_us;
+	pred->lat_max_us = max(pred->lat_max_us, lat_us);
+	pred->lat_avg_us = pred->lat_avg_us ?
+		(pred->lat_avg_us * 7 + lat_us) / 8 : lat_us;
+
+	if (pred->prewaking) {
+		pred->prewaking = false;
+		pred->prewakes++;
+		pred->prewake_active = true;
+		/* Stay up for the autosuspend delay to catch the burst */
+		pm_runtime_mark_last_busy(dev);
+		pred->prewake_last_busy = READ_ONCE(dev->power.last_busy);
+	} else {
+		pred->demand_resumes++;
+		pred->prewake_active = false;
+		cnss_link_pred_burst(pred, start);
+	}
+	spin_unlock_irqrestore(&pred->lock, flags);
+}
+
+static void cnss_link_pred_suspending(struct cnss_pci_data *pci_priv)
+{
+	struct cnss_link_pred *pred = &pci_priv->link_pred;
+	struct device *dev = &pci_priv->pci_dev->dev;
+	unsigned long flags;
+
+	spin_lock_irqsave(&pred->lock, flags);
+	if (!pred->prewake_active)
+		goto out;
+
+	pred->prewake_active = false;
+	if (time_after(READ_ONCE(dev->power.last_busy),
+		       pred->prewake_last_busy)) {
+		pred->prewake_hits++;
+		pred->false_wake_run = 0;
+		cnss_link_pred_burst(pred, pred->prewake_burst);
+	} else if (++pred->false_wake_run >= LINK_PRED_MAX_FALSE_WAKES) {
+		pred->false_wakes++;
+		/* The traffic pattern changed, learn it again */
+		cnss_link_pred_forget(pred);
+	} else {
+		pred->false_wakes++;
+		pred->last_burst = pred->prewake_burst;
+		cnss_link_pred_arm(pred);
+	}
+out:
+	spin_unlock_irqrestore(&pred->lock, flags);
+}
+
+static void cnss_link_pred_init(struct cnss_pci_data *pci_priv)
+{
+	struct cnss_link_pred *pred = &pci_priv->link_pred;
+
+	spin_lock_init(&pred->lock);
+	hrtimer_init(&pred->timer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS);
+	pred->timer.function = cnss_link_pred_timer_fn;
+	pred->enabled = true;
+}
+
+void cnss_pci_link_pred_enable(struct cnss_pci_data *pci_priv, bool enable)
+{
+	struct cnss_link_pred *pred = &pci_priv->link_pred;
+	unsigned long flags;
+
+	spin_lock_irqsave(&pred->lock, flags);
+	pred->enabled = enable;
+	if (enable)
+		cnss_link_pred_arm(pred);
+	spin_unlock_irqrestore(&pred->lock, flags);
+
+	if (!enable)
+		hrtimer_cancel(&pred->timer);
+}
+
+void cnss_pci_link_pred_reset(struct cnss_pci_data *pci_priv)
+{
+	struct cnss_link_pred *pred = &pci_priv->link_pred;
+	unsigned long flags;
+
+	hrtimer_cancel(&pred->timer);
+
+	spin_lock_irqsave(&pred->lock, flags);
+	cnss_link_pred_forget(pred);
+	pred->lat_avg_us = 0;
+	pred->lat_max_us = 0;
+	pred->lat_sum_us = 0;
+	pred->resumes = 0;
+	pred->demand_resumes = 0;
+	pred->prewakes = 0;
+	pred->prewake_hits = 0;
+	pred->false_wakes = 0;
+	spin_unlock_irqrestore(&pred->lock, flags);
+}
+
 static int cnss_pci_runtime_suspend(struct device *dev)
 {
 	int ret = 0;
@@ -1799,6 +2033,8 @@ static int cnss_pci_runtime_suspend(struct device *dev)
 
 	cnss_pr_dbg("Runtime suspend start\n");
 
+	cnss_link_pred_suspending(pci_priv);
+
 	driver_ops = pci_priv->driver_ops;
 	if (driver_ops && driver_ops->runtime_ops &&
 	    driver_ops->runtime_ops->runtime_suspend)
@@ -1817,6 +2053,7 @@ static int cnss_pci_runtime_resume(struct device *dev)
 	struct pci_dev *pci_dev = to_pci_dev(dev);
 	struct cnss_pci_data *pci_priv = cnss_get_pci_priv(pci_dev);
 	struct cnss_wlan_driver *driver_ops;
+	ktime_t start;
 
 	if (!pci_priv)
 		return -EAGAIN;
@@ -1828,6 +2065,7 @@ static int cnss_pci_runtime_resume(struct device *dev)
 
 	cnss_pr_dbg("Runtime resume start\n");
 
+	start = ktime_get();
 	driver_ops = pci_priv->driver_ops;
 	if (driver_ops && driver_ops->runtime_ops &&
 	    driver_ops->runtime_ops->runtime_resume)
@@ -1835,6 +2073,9 @@ static int cnss_pci_runtime_resume(struct device *dev)
 	else
 		ret = cnss_auto_resume(dev);
 
+	if (!ret)
+		cnss_link_pred_resumed(pci_priv, start);
+
 	cnss_pr_info("Runtime resume status: %d\n", ret);
 
 	return ret;
@@ -3599,6 +3840,7 @@ static int cnss_pci_probe(struct pci_dev *pci_dev,
 	cnss_set_pci_priv(pci_dev, pci_priv);
 	plat_priv->device_id = pci_dev->device;
 	plat_priv->bus_priv = pci_priv;
+	cnss_link_pred_init(pci_priv);
 
 	ret = cnss_pci_get_dev_cfg_node(plat_priv);
 	if (ret) {
@@ -3727,6 +3969,8 @@ static void cnss_pci_remove(struct pci_dev *pci_dev)
 	struct cnss_plat_data *plat_priv =
 		cnss_bus_dev_to_plat_priv(&pci_dev->dev);
 
+	hrtimer_cancel(&pci_priv->link_pred.timer);
+
 	cnss_pci_free_m3_mem(pci_priv);
 	cnss_pci_free_fw_mem(pci_priv);
 	cnss_pci_free_qdss_mem(pci_priv);
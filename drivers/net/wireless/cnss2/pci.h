@@ -14,6 +14,7 @@
 #define _CNSS_PCI_H
 
 #include <asm/dma-iommu.h>
+#include <linux/hrtimer.h>
 #include <linux/iommu.h>
 #include <linux/mhi.h>
 #include <linux/msm_pcie.h>
@@ -56,6 +57,56 @@ struct cnss_pci_debug_reg {
 	u32 val;
 };
 
+#define CNSS_LINK_PRED_HIST		8
+
+/**
+ * struct cnss_link_pred - predictive PCIe link resume
+ * @timer:	fires when the next burst is expected, less the resume latency
+ * @lock:	protects all fields below
+ * @enabled:	pre-resume the link when a period has been learned
+ * @prewaking:	the runtime resume in flight was requested by @timer
+ * @prewake_active: the link is up because of a prediction not yet judged
+ * @interval:	recent intervals between burst starts, in us
+ * @nr_interval: number of valid entries in @interval
+ * @interval_idx: next entry of @interval to write
+ * @last_burst:	start of the most recent burst
+ * @period_us:	learned burst period, 0 if traffic is not periodic
+ * @prewake_burst: burst time the active prediction was made for
+ * @prewake_last_busy: runtime PM last_busy when the link was pre-resumed
+ * @false_wake_run: consecutive pre-resumes not followed by traffic
+ * @lat_avg_us:	moving average of the runtime resume latency
+ * @lat_max_us:	worst runtime resume latency
+ * @lat_sum_us:	total runtime resume latency, over @resumes
+ * @resumes:	runtime resumes
+ * @demand_resumes: runtime resumes not requested by @timer
+ * @prewakes:	runtime resumes requested by @timer
+ * @prewake_hits: pre-resumes followed by traffic before the next suspend
+ * @false_wakes: pre-resumes the link suspended again after without traffic
+ */
+struct cnss_link_pred {
+	struct hrtimer timer;
+	spinlock_t lock;
+	bool enabled;
+	bool prewaking;
+	bool prewake_active;
+	u32 interval[CNSS_LINK_PRED_HIST];
+	u32 nr_interval;
+	u32 interval_idx;
+	ktime_t last_burst;
+	u32 period_us;
+	ktime_t prewake_burst;
+	unsigned long prewake_last_busy;
+	u32 false_wake_run;
+	u32 lat_avg_us;
+	u32 lat_max_us;
+	u64 lat_sum_us;
+	u64 resumes;
+	u64 demand_resumes;
+	u64 prewakes;
+	u64 prewake_hits;
+	u64 false_wakes;
+};
+
 struct cnss_pci_data {
 	struct pci_dev *pci_dev;
 	struct cnss_plat_data *plat_priv;
@@ -88,6 +139,7 @@ struct cnss_pci_data {
 	bool disable_pc;
 	struct cnss_pci_debug_reg *debug_reg;
 	u32 iommu_geometry;
+	struct cnss_link_pred link_pred;
 };
 
 static inline void cnss_set_pci_priv(struct pci_dev *pci_dev, void *data)
@@ -171,5 +223,7 @@ void cnss_pci_pm_runtime_put_noidle(struct cnss_pci_data *pci_priv);
 void cnss_pci_pm_runtime_mark_last_busy(struct cnss_pci_data *pci_priv);
 int cnss_pci_update_status(struct cnss_pci_data *pci_priv,
 			   enum cnss_driver_status status);
+void cnss_pci_link_pred_enable(struct cnss_pci_data *pci_priv, bool enable);
+void cnss_pci_link_pred_reset(struct cnss_pci_data *pci_priv);
 
 #endif /* _CNSS_PCI_H */
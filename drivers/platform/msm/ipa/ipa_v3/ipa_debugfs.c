@@ -14,6 +14,7 @@
 
 #include <linux/debugfs.h>
 #include <linux/kernel.h>
+#include <linux/math64.h>
 #include <linux/stringify.h>
 #include "ipa_i.h"
 #include "../ipa_rm_i.h"
@@ -1218,26 +1219,181 @@ static ssize_t ipa3_read_odlstats(struct file *file, char __user *ubuf,
 	return simple_read_from_buffer(ubuf, count, ppos, dbg_buff, cnt);
 }
 
+static unsigned int ipa3_page_recycle_rate(
+	struct ipa3_page_recycle_stats *stats)
+{
+	if (!stats->total_replenished)
+		return 0;
+
+	return div64_u64(stats->recycled * 100, stats->total_replenished);
+}
+
 static ssize_t ipa3_read_page_recycle_stats(struct file *file,
 		char __user *ubuf, size_t count, loff_t *ppos)
 {
+	struct ipa3_page_recycle_stats *coal =
+		&ipa3_ctx->stats.page_recycle_stats[0];
+	struct ipa3_page_recycle_stats *def =
+		&ipa3_ctx->stats.page_recycle_stats[1];
 	int nbytes;
 	int cnt = 0;
 
 	nbytes = scnprintf(dbg_buff, IPA_MAX_MSG_LEN,
 			"COAL : Total number of packets replenished =%llu\n"
 			"COAL : Number of tmp alloc packets  =%llu\n"
+			"COAL : Number of recycled pages  =%llu\n"
+			"COAL : Number of pages found by polling  =%llu\n"
+			"COAL : Recycle rate  =%u%%\n"
 			"DEF  : Total number of packets replenished =%llu\n"
-			"DEF  : Number of tmp alloc packets  =%llu\n",
-			ipa3_ctx->stats.page_recycle_stats[0].total_replenished,
-			ipa3_ctx->stats.page_recycle_stats[0].tmp_alloc,
-			ipa3_ctx->stats.page_recycle_stats[1].total_replenished,
-			ipa3_ctx->stats.page_recycle_stats[1].tmp_alloc);
+			"DEF  : Number of tmp alloc packets  =%llu\n"
+			"DEF  : Number of recycled pages  =%llu\n"
+			"DEF  : Number of pages found by polling  =%llu\n"
+			"DEF  : Recycle rate  =%u%%\n",
+			coal->total_replenished, coal->tmp_alloc,
+			coal->recycled, coal->polled,
+			ipa3_page_recycle_rate(coal),
+			def->total_replenished, def->tmp_alloc,
+			def->recycled, def->polled,
+			ipa3_page_recycle_rate(def));
 
 	cnt += nbytes;
 
 	return simple_read_from_buffer(ubuf, count, ppos, dbg_buff, cnt);
 }
+
+static ssize_t ipa3_read_page_poll_threshold(struct file *file,
+	char __user *ubuf, size_t count, loff_t *ppos)
+{
+	int nbytes;
+
+	nbytes = scnprintf(dbg_buff, IPA_MAX_MSG_LEN, "%u\n",
+			ipa3_ctx->page_poll_threshold);
+
+	return simple_read_from_buffer(ubuf, count, ppos, dbg_buff, nbytes);
+}
+
+static ssize_t ipa3_write_page_poll_threshold(struct file *file,
+	const char __user *buf, size_t count, loff_t *ppos)
+{
+	unsigned long missing;
+	u32 threshold;
+
+	if (sizeof(dbg_buff) < count + 1)
+		return -EFAULT;
+
+	missing = copy_from_user(dbg_buff, buf, min(sizeof(dbg_buff), count));
+	if (missing)
+		return -EFAULT;
+
+	dbg_buff[count] = '\0';
+	if (kstrtou32(dbg_buff, 0, &threshold))
+		return -EFAULT;
+
+	if (threshold > IPA_PAGE_POLL_MAX_THRESHOLD)
+		return -EINVAL;
+
+	WRITE_ONCE(ipa3_ctx->page_poll_threshold, threshold);
+
+	return count;
+}
+
+static ssize_t ipa3_read_pipe_moderation(struct file *file,
+	char __user *ubuf, size_t count, loff_t *ppos)
+{
+	struct ipa3_sys_context *sys;
+	int cnt = 0;
+	int i;
+
+	cnt += scnprintf(dbg_buff + cnt, IPA_MAX_MSG_LEN - cnt,
+		"ep client modt modc inactivity intr polls pkts\n");
+	for (i = 0; i < ipa3_ctx->ipa_num_pipes; i++) {
+		sys = ipa3_ctx->ep[i].sys;
+		if (!ipa3_ctx->ep[i].valid || !sys ||
+			ipa3_ctx->ep[i].gsi_evt_ring_hdl == ~0)
+			continue;
+
+		cnt += scnprintf(dbg_buff + cnt, IPA_MAX_MSG_LEN - cnt,
+			"%d %s %u %u %u %u %llu %llu\n", i,
+			ipa_clients_strings[ipa3_ctx->ep[i].client],
+			sys->int_modt, sys->int_modc,
+			ipa3_ctx->pipe_mod[i].set ?
+			ipa3_ctx->pipe_mod[i].poll_inactivity :
+			IPA_POLL_INACTIVITY_DEFAULT,
+			sys->poll_intr_cnt, sys->poll_cycles,
+			sys->poll_pkts);
+	}
+
+	return simple_read_from_buffer(ubuf, count, ppos, dbg_buff, cnt);
+}
+
+/*
+ * Write "<ep_idx> <int_modt> <int_modc> <poll_inactivity>" to override the
+ * moderation of a pipe. The event ring part applies when the pipe connects,
+ * poll_inactivity right away for pipes not polled from NAPI.
+ */
+static ssize_t ipa3_write_pipe_moderation(struct file *file,
+	const char __user *buf, size_t count, loff_t *ppos)
+{
+	struct ipa3_pipe_moderation *mod;
+	u32 ep_idx, modt, modc, inactivity;
+	unsigned long missing;
+
+	if (sizeof(dbg_buff) < count + 1)
+		return -EFAULT;
+
+	missing = copy_from_user(dbg_buff, buf, min(sizeof(dbg_buff), count));
+	if (missing)
+		return -EFAULT;
+
+	dbg_buff[count] = '\0';
+	if (sscanf(dbg_buff, "%u %u %u %u", &ep_idx, &modt, &modc,
+		&inactivity) != 4)
+		return -EINVAL;
+
+	if (ep_idx >= ipa3_ctx->ipa_num_pipes || modt > U16_MAX ||
+		!modc || modc > U8_MAX)
+		return -EINVAL;
+
+	mod = &ipa3_ctx->pipe_mod[ep_idx];
+	WRITE_ONCE(mod->set, false);
+	mod->int_modt = modt;
+	mod->int_modc = modc;
+	WRITE_ONCE(mod->poll_inactivity, inactivity);
+	WRITE_ONCE(mod->set, true);
+
+	return count;
+}
+
+static ssize_t ipa3_read_rx_ring_stats(struct file *file,
+	char __user *ubuf, size_t count, loff_t *ppos)
+{
+	static const char * const names[IPA_RX_RING_STATS_MAX] = {
+		"COAL", "WAN", "LAN",
+	};
+	struct ipa3_rx_ring_stats *stats;
+	int cnt = 0;
+	int i, j;
+
+	for (i = 0; i < IPA_RX_RING_STATS_MAX; i++) {
+		stats = &ipa3_ctx->stats.rx_ring_stats[i];
+		cnt += scnprintf(dbg_buff + cnt, IPA_MAX_MSG_LEN - cnt,
+			"%s:\n"
+			"\tstarve=%llu\n"
+			"\tcache_miss=%llu\n"
+			"\tnapi_alloc=%llu\n"
+			"\toccupancy(1/%d)=",
+			names[i], stats->starve, stats->cache_miss,
+			stats->napi_alloc, IPA_RX_RING_OCC_BUCKETS);
+		for (j = 0; j < IPA_RX_RING_OCC_BUCKETS; j++)
+			cnt += scnprintf(dbg_buff + cnt,
+				IPA_MAX_MSG_LEN - cnt, "%llu ",
+				stats->occupancy[j]);
+		cnt += scnprintf(dbg_buff + cnt, IPA_MAX_MSG_LEN - cnt, "\n");
+	}
+
+	return simple_read_from_buffer(ubuf, count, ppos, dbg_buff, cnt);
+}
+
 static ssize_t ipa3_read_wstats(struct file *file, char __user *ubuf,
 		size_t count, loff_t *ppos)
 {
@@ -2860,6 +3016,20 @@ static const struct ipa3_debugfs_file debugfs_files[] = {
 		"page_recycle_stats", IPA_READ_ONLY_MODE, NULL, {
 			.read = ipa3_read_page_recycle_stats,
 		}
+	}, {
+		"page_poll_threshold", IPA_READ_WRITE_MODE, NULL, {
+			.read = ipa3_read_page_poll_threshold,
+			.write = ipa3_write_page_poll_threshold,
+		}
+	}, {
+		"pipe_moderation", IPA_READ_WRITE_MODE, NULL, {
+			.read = ipa3_read_pipe_moderation,
+			.write = ipa3_write_pipe_moderation,
+		}
+	}, {
+		"rx_ring_stats", IPA_READ_ONLY_MODE, NULL, {
+			.read = ipa3_read_rx_ring_stats,
+		}
 	}, {
 		"wdi", IPA_READ_ONLY_MODE, NULL, {
 			.read = ipa3_read_wdi,
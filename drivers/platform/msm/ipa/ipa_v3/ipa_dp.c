@@ -26,7 +26,7 @@
 #define IPA_WAN_NAPI_MAX_FRAMES (NAPI_WEIGHT / IPA_WAN_AGGR_PKT_CNT)
 #define IPA_WAN_PAGE_ORDER 3
 #define IPA_LAST_DESC_CNT 0xFFFF
-#define POLLING_INACTIVITY_RX 40
+#define POLLING_INACTIVITY_RX IPA_POLL_INACTIVITY_DEFAULT
 #define POLLING_MIN_SLEEP_RX 1010
 #define POLLING_MAX_SLEEP_RX 1050
 #define POLLING_INACTIVITY_TX 40
@@ -81,6 +81,8 @@
 #define IPA_DEFAULT_SYS_YELLOW_WM 32
 #define IPA_REPL_XFER_THRESH 20
 #define IPA_REPL_XFER_MAX 36
+/* Buffers allocated in the refill path per call when the cache is empty */
+#define IPA_REPL_INLINE_MAX 64
 
 #define IPA_TX_SEND_COMPL_NOP_DELAY_NS (2 * 1000 * 1000)
 
@@ -126,6 +128,7 @@ static int ipa_gsi_setup_event_ring(struct ipa3_ep_context *ep,
 static int ipa_gsi_setup_transfer_ring(struct ipa3_ep_context *ep,
 	u32 ring_size, struct ipa3_sys_context *user_data, gfp_t mem_flag);
 static int ipa3_teardown_coal_def_pipe(u32 clnt_hdl);
+static void ipa3_napi_schedule_ipi(void *info);
 static int ipa_populate_tag_field(struct ipa3_desc *desc,
 		struct ipa3_tx_pkt_wrapper *tx_pkt,
 		struct ipahal_imm_cmd_pyld **tag_pyld_ret);
@@ -785,6 +788,10 @@ static void __ipa3_update_curr_poll_state(enum ipa_client_type client,
 {
 	int ep_idx = IPA_EP_NOT_ALLOCATED;
 
+	/* default pipe has its own event ring and NAPI instance */
+	if (ipa3_ctx->coal_def_napi)
+		return;
+
 	if (client == IPA_CLIENT_APPS_WAN_COAL_CONS)
 		ep_idx = ipa3_get_ep_mapping(IPA_CLIENT_APPS_WAN_CONS);
 	if (client == IPA_CLIENT_APPS_WAN_CONS)
@@ -826,6 +833,22 @@ static int ipa3_rx_switch_to_intr_mode(struct ipa3_sys_context *sys)
 	return ret;
 }
 
+/* Empty polls before the pipe is moved back to interrupt mode */
+static u32 ipa3_poll_inactivity(struct ipa3_sys_context *sys)
+{
+	int ep_idx = ipa3_get_ep_mapping(sys->ep->client);
+	struct ipa3_pipe_moderation *mod;
+
+	if (ep_idx == IPA_EP_NOT_ALLOCATED)
+		return POLLING_INACTIVITY_RX;
+
+	mod = &ipa3_ctx->pipe_mod[ep_idx];
+	if (!READ_ONCE(mod->set))
+		return POLLING_INACTIVITY_RX;
+
+	return READ_ONCE(mod->poll_inactivity);
+}
+
 /**
  * ipa3_handle_rx() - handle packet reception. This function is executed in the
  * context of a work queue.
@@ -836,6 +859,7 @@ static int ipa3_rx_switch_to_intr_mode(struct ipa3_sys_context *sys)
  */
 static void ipa3_handle_rx(struct ipa3_sys_context *sys)
 {
+	u32 inactivity = ipa3_poll_inactivity(sys);
 	int inactive_cycles;
 	int cnt;
 	int ret;
@@ -852,6 +876,8 @@ static void ipa3_handle_rx(struct ipa3_sys_context *sys)
 			inactive_cycles++;
 		else
 			inactive_cycles = 0;
+		sys->poll_cycles++;
+		sys->poll_pkts += cnt;
 
 		trace_idle_sleep_enter3(sys->ep->client);
 		usleep_range(POLLING_MIN_SLEEP_RX, POLLING_MAX_SLEEP_RX);
@@ -865,7 +891,7 @@ static void ipa3_handle_rx(struct ipa3_sys_context *sys)
 		if (sys->len == 0)
 			break;
 
-	} while (inactive_cycles <= POLLING_INACTIVITY_RX);
+	} while (inactive_cycles <= inactivity);
 
 	trace_poll_to_intr3(sys->ep->client);
 	ret = ipa3_rx_switch_to_intr_mode(sys);
@@ -1051,7 +1077,8 @@ int ipa3_setup_sys_pipe(struct ipa_sys_connect_params *sys_in, u32 *clnt_hdl)
 		/* create IPA PM resources for handling polling mode */
 		if (sys_in->client == IPA_CLIENT_APPS_WAN_CONS &&
 			coal_ep_id != IPA_EP_NOT_ALLOCATED &&
-			ipa3_ctx->ep[coal_ep_id].valid == 1) {
+			ipa3_ctx->ep[coal_ep_id].valid == 1 &&
+			!ipa3_ctx->coal_def_napi) {
 			/* Use coalescing pipe PM handle for default pipe also*/
 			ep->sys->pm_hdl = ipa3_ctx->ep[coal_ep_id].sys->pm_hdl;
 		} else if (ipa3_ctx->use_ipa_pm &&
@@ -1101,6 +1128,16 @@ int ipa3_setup_sys_pipe(struct ipa_sys_connect_params *sys_in, u32 *clnt_hdl)
 	ep->client = sys_in->client;
 	ep->client_notify = sys_in->notify;
 	ep->sys->napi_obj = sys_in->napi_obj;
+	ep->sys->napi_cpu = -1;
+	if (sys_in->client == IPA_CLIENT_APPS_WAN_COAL_CONS)
+		ipa3_ctx->coal_def_napi = sys_in->napi_obj &&
+			sys_in->napi_def_obj;
+	if (sys_in->client == IPA_CLIENT_APPS_WAN_CONS &&
+		ipa3_ctx->coal_def_napi && sys_in->napi_def_cpu >= 0 &&
+		sys_in->napi_def_cpu < nr_cpu_ids)
+		ep->sys->napi_cpu = sys_in->napi_def_cpu;
+	ep->sys->napi_csd.func = ipa3_napi_schedule_ipi;
+	ep->sys->napi_csd.info = ep->sys;
 	ep->priv = sys_in->priv;
 	ep->keep_ipa_awake = sys_in->keep_ipa_awake;
 	atomic_set(&ep->avail_fifo_desc,
@@ -1249,6 +1286,8 @@ int ipa3_setup_sys_pipe(struct ipa_sys_connect_params *sys_in, u32 *clnt_hdl)
 
 		sys_in->client = IPA_CLIENT_APPS_WAN_CONS;
 		sys_in->ipa_ep_cfg = ep_cfg_copy;
+		if (ipa3_ctx->coal_def_napi)
+			sys_in->napi_obj = sys_in->napi_def_obj;
 		result = ipa3_setup_sys_pipe(sys_in, &wan_handle);
 		if (result) {
 			IPAERR("failed to setup default coalescing pipe\n");
@@ -1471,6 +1510,14 @@ static int ipa3_teardown_coal_def_pipe(u32 clnt_hdl)
 		ipa_assert();
 		return result;
 	}
+
+	/* polled on its own NAPI instance, wait for it to finish */
+	if (ipa3_ctx->coal_def_napi && ep->sys->napi_obj) {
+		do {
+			usleep_range(95, 105);
+		} while (atomic_read(&ep->sys->curr_polling_state));
+	}
+
 	result = ipa3_reset_gsi_channel(clnt_hdl);
 	if (result != GSI_STATUS_SUCCESS) {
 		IPAERR("Failed to reset chan: %d.\n", result);
@@ -1488,6 +1535,22 @@ static int ipa3_teardown_coal_def_pipe(u32 clnt_hdl)
 		return result;
 	}
 
+	/* the event ring is only ours when not shared with the coal pipe */
+	if (ipa3_ctx->coal_def_napi && ep->gsi_evt_ring_hdl != ~0) {
+		result = gsi_reset_evt_ring(ep->gsi_evt_ring_hdl);
+		if (WARN(result != GSI_STATUS_SUCCESS, "reset evt %d", result))
+			return result;
+
+		dma_free_coherent(ipa3_ctx->pdev,
+			ep->gsi_mem_info.evt_ring_len,
+			ep->gsi_mem_info.evt_ring_base_vaddr,
+			ep->gsi_mem_info.evt_ring_base_addr);
+		result = gsi_dealloc_evt_ring(ep->gsi_evt_ring_hdl);
+		if (WARN(result != GSI_STATUS_SUCCESS, "deall evt %d", result))
+			return result;
+		ep->gsi_evt_ring_hdl = ~0;
+	}
+
 	if (IPA_CLIENT_IS_CONS(ep->client))
 		cancel_delayed_work_sync(&ep->sys->replenish_rx_work);
 
@@ -1977,6 +2040,85 @@ static void ipa3_wq_page_repl(struct work_struct *work)
 
 }
 
+static struct ipa3_rx_ring_stats *ipa3_rx_ring_stats(
+	struct ipa3_sys_context *sys)
+{
+	switch (sys->ep->client) {
+	case IPA_CLIENT_APPS_WAN_COAL_CONS:
+		return &ipa3_ctx->stats.rx_ring_stats[IPA_RX_RING_STATS_COAL];
+	case IPA_CLIENT_APPS_WAN_CONS:
+		return &ipa3_ctx->stats.rx_ring_stats[IPA_RX_RING_STATS_WAN];
+	case IPA_CLIENT_APPS_LAN_CONS:
+		return &ipa3_ctx->stats.rx_ring_stats[IPA_RX_RING_STATS_LAN];
+	default:
+		return NULL;
+	}
+}
+
+/* Record how full the ring was when the refill ran */
+static void ipa3_rx_ring_sample(struct ipa3_sys_context *sys,
+	struct ipa3_rx_ring_stats *stats)
+{
+	u32 bucket;
+
+	if (!stats || !sys->rx_pool_sz)
+		return;
+
+	if (!sys->len)
+		stats->starve++;
+
+	bucket = sys->len * IPA_RX_RING_OCC_BUCKETS / sys->rx_pool_sz;
+	if (bucket >= IPA_RX_RING_OCC_BUCKETS)
+		bucket = IPA_RX_RING_OCC_BUCKETS - 1;
+	stats->occupancy[bucket]++;
+}
+
+/*
+ * Allocate an RX buffer from the refill path itself, for when the
+ * workqueue filling the repl cache can't keep up. This runs with BHs
+ * disabled, so the skb comes from the per-CPU NAPI page fragment cache
+ * when the pipe has a NAPI context.
+ */
+static struct ipa3_rx_pkt_wrapper *ipa3_alloc_rx_pkt_inline(
+	struct ipa3_sys_context *sys)
+{
+	struct ipa3_rx_pkt_wrapper *rx_pkt;
+	gfp_t flag = GFP_ATOMIC | __GFP_NOWARN | __GFP_NOMEMALLOC;
+	void *ptr;
+
+	rx_pkt = kmem_cache_zalloc(ipa3_ctx->rx_pkt_wrapper_cache, flag);
+	if (unlikely(!rx_pkt))
+		return NULL;
+
+	INIT_WORK(&rx_pkt->work, ipa3_wq_rx_avail);
+	rx_pkt->sys = sys;
+
+	if (sys->napi_obj)
+		rx_pkt->data.skb = __napi_alloc_skb(sys->napi_obj,
+			sys->rx_buff_sz, flag);
+	else
+		rx_pkt->data.skb = sys->get_skb(sys->rx_buff_sz, flag);
+	if (unlikely(!rx_pkt->data.skb))
+		goto fail_skb_alloc;
+
+	ptr = skb_put(rx_pkt->data.skb, sys->rx_buff_sz);
+	rx_pkt->data.dma_addr = dma_map_single(ipa3_ctx->pdev, ptr,
+		sys->rx_buff_sz, DMA_FROM_DEVICE);
+	if (dma_mapping_error(ipa3_ctx->pdev, rx_pkt->data.dma_addr)) {
+		pr_err_ratelimited("%s dma map fail %pK for %pK sys=%pK\n",
+			__func__, (void *)rx_pkt->data.dma_addr, ptr, sys);
+		goto fail_dma_mapping;
+	}
+
+	return rx_pkt;
+
+fail_dma_mapping:
+	sys->free_skb(rx_pkt->data.skb);
+fail_skb_alloc:
+	kmem_cache_free(ipa3_ctx->rx_pkt_wrapper_cache, rx_pkt);
+	return NULL;
+}
+
 static inline void __trigger_repl_work(struct ipa3_sys_context *sys)
 {
 	int tail, head, avail;
@@ -1995,6 +2137,40 @@ static inline void __trigger_repl_work(struct ipa3_sys_context *sys)
 }
 
 
+/*
+ * The page at the head of the recycle ring may still be held by the
+ * network stack (e.g. sitting in a socket queue) while pages behind it
+ * were already released. Rather than falling back to a freshly allocated
+ * page as soon as the head is busy, look a bounded number of entries
+ * ahead for an idle page and swap it into the head slot so it gets
+ * reused first.
+ */
+static struct ipa3_rx_pkt_wrapper *ipa3_get_idle_recycle_page(
+	struct ipa3_sys_context *sys, u32 curr, u32 stats_i)
+{
+	struct ipa3_repl_ctx *repl = sys->page_recycle_repl;
+	struct ipa3_rx_pkt_wrapper *rx_pkt;
+	u32 threshold = READ_ONCE(ipa3_ctx->page_poll_threshold);
+	u32 i, idx;
+
+	for (i = 0; i <= threshold && i < repl->capacity; i++) {
+		idx = (curr + i) % repl->capacity;
+		rx_pkt = repl->cache[idx];
+		if (page_ref_count(rx_pkt->page_data.page) != 1)
+			continue;
+
+		if (i) {
+			repl->cache[idx] = repl->cache[curr];
+			repl->cache[curr] = rx_pkt;
+			ipa3_ctx->stats.page_recycle_stats[stats_i].polled++;
+		}
+		page_ref_inc(rx_pkt->page_data.page);
+		return rx_pkt;
+	}
+
+	return NULL;
+}
+
 static void ipa3_replenish_rx_page_recycle(struct ipa3_sys_context *sys)
 {
 	struct ipa3_rx_pkt_wrapper *rx_pkt;
@@ -2004,8 +2180,10 @@ static void ipa3_replenish_rx_page_recycle(struct ipa3_sys_context *sys)
 	u32 curr;
 	u32 curr_wq;
 	int idx = 0;
-	struct page *cur_page;
+	int inline_cnt = 0;
 	u32 stats_i = 0;
+	struct ipa3_rx_ring_stats *ring_stats = ipa3_rx_ring_stats(sys);
+	bool cache_miss = false;
 
 	/* start replenish only when buffers go lower than the threshold */
 	if (sys->rx_pool_sz - sys->len < IPA_REPL_XFER_THRESH)
@@ -2013,16 +2191,16 @@ static void ipa3_replenish_rx_page_recycle(struct ipa3_sys_context *sys)
 	stats_i = (sys->ep->client == IPA_CLIENT_APPS_WAN_COAL_CONS) ? 0 : 1;
 
 	spin_lock_bh(&sys->spinlock);
+	ipa3_rx_ring_sample(sys, ring_stats);
 	rx_len_cached = sys->len;
 	curr = atomic_read(&sys->page_recycle_repl->head_idx);
 	curr_wq = atomic_read(&sys->repl->head_idx);
 
 	while (rx_len_cached < sys->rx_pool_sz) {
-		cur_page = sys->page_recycle_repl->cache[curr]->page_data.page;
+		rx_pkt = ipa3_get_idle_recycle_page(sys, curr, stats_i);
 		/* Found an idle page that can be used */
-		if (page_ref_count(cur_page) == 1) {
-			page_ref_inc(cur_page);
-			rx_pkt = sys->page_recycle_repl->cache[curr];
+		if (rx_pkt) {
+			ipa3_ctx->stats.page_recycle_stats[stats_i].recycled++;
 			curr = (++curr == sys->page_recycle_repl->capacity) ?
 								0 : curr;
 		} else {
@@ -2030,12 +2208,26 @@ static void ipa3_replenish_rx_page_recycle(struct ipa3_sys_context *sys)
 			 * Could not find idle page at curr index.
 			 * Allocate a new one.
 			 */
-			if (curr_wq == atomic_read(&sys->repl->tail_idx))
-				break;
-			ipa3_ctx->stats.page_recycle_stats[stats_i].tmp_alloc++;
-			rx_pkt = sys->repl->cache[curr_wq];
-			curr_wq = (++curr_wq == sys->repl->capacity) ?
+			if (curr_wq != atomic_read(&sys->repl->tail_idx)) {
+				rx_pkt = sys->repl->cache[curr_wq];
+				curr_wq = (++curr_wq == sys->repl->capacity) ?
 								 0 : curr_wq;
+			} else {
+				/*
+				 * The temp ring is refilled from a workqueue,
+				 * don't let the RX ring starve waiting on it.
+				 */
+				cache_miss = true;
+				if (inline_cnt >= IPA_REPL_INLINE_MAX)
+					break;
+				rx_pkt = ipa3_alloc_rx_pkt_page(GFP_ATOMIC |
+					__GFP_NOWARN, true);
+				if (!rx_pkt)
+					break;
+				rx_pkt->sys = sys;
+				inline_cnt++;
+			}
+			ipa3_ctx->stats.page_recycle_stats[stats_i].tmp_alloc++;
 		}
 
 		dma_sync_single_for_device(ipa3_ctx->pdev,
@@ -2081,6 +2273,10 @@ static void ipa3_replenish_rx_page_recycle(struct ipa3_sys_context *sys)
 		IPAERR("failed to provide buffer: %d\n", ret);
 		ipa_assert();
 	}
+	if (ring_stats) {
+		ring_stats->cache_miss += cache_miss;
+		ring_stats->napi_alloc += inline_cnt;
+	}
 	spin_unlock_bh(&sys->spinlock);
 	__trigger_repl_work(sys);
 
@@ -2367,6 +2563,7 @@ static void ipa3_replenish_rx_cache_recycle(struct ipa3_sys_context *sys)
 	if (sys->rx_pool_sz - sys->len < IPA_REPL_XFER_THRESH)
 		return;
 
+	ipa3_rx_ring_sample(sys, ipa3_rx_ring_stats(sys));
 	rx_len_cached = sys->len;
 
 	while (rx_len_cached < sys->rx_pool_sz) {
@@ -2471,19 +2668,37 @@ static void ipa3_fast_replenish_rx_cache(struct ipa3_sys_context *sys)
 	struct gsi_xfer_elem gsi_xfer_elem_array[IPA_REPL_XFER_MAX];
 	u32 curr;
 	int idx = 0;
+	int inline_cnt = 0;
+	struct ipa3_rx_ring_stats *ring_stats = ipa3_rx_ring_stats(sys);
 
 	/* start replenish only when buffers go lower than the threshold */
 	if (sys->rx_pool_sz - sys->len < IPA_REPL_XFER_THRESH)
 		return;
 
 	spin_lock_bh(&sys->spinlock);
+	ipa3_rx_ring_sample(sys, ring_stats);
 	rx_len_cached = sys->len;
 	curr = atomic_read(&sys->repl->head_idx);
 
 	while (rx_len_cached < sys->rx_pool_sz) {
-		if (curr == atomic_read(&sys->repl->tail_idx))
-			break;
-		rx_pkt = sys->repl->cache[curr];
+		if (curr != atomic_read(&sys->repl->tail_idx)) {
+			rx_pkt = sys->repl->cache[curr];
+			curr = (++curr == sys->repl->capacity) ? 0 : curr;
+		} else {
+			/*
+			 * The repl cache is filled from a workqueue. Rather
+			 * than leaving the ring short until it catches up,
+			 * allocate the missing buffers right here.
+			 */
+			if (!inline_cnt && ring_stats)
+				ring_stats->cache_miss++;
+			if (inline_cnt >= IPA_REPL_INLINE_MAX)
+				break;
+			rx_pkt = ipa3_alloc_rx_pkt_inline(sys);
+			if (!rx_pkt)
+				break;
+			inline_cnt++;
+		}
 		gsi_xfer_elem_array[idx].addr = rx_pkt->data.dma_addr;
 		gsi_xfer_elem_array[idx].len = sys->rx_buff_sz;
 		gsi_xfer_elem_array[idx].flags = GSI_XFER_FLAG_EOT;
@@ -2492,7 +2707,6 @@ static void ipa3_fast_replenish_rx_cache(struct ipa3_sys_context *sys)
 		gsi_xfer_elem_array[idx].type = GSI_XFER_ELEM_DATA;
 		gsi_xfer_elem_array[idx].xfer_user_data = rx_pkt;
 		rx_len_cached++;
-		curr = (++curr == sys->repl->capacity) ? 0 : curr;
 		idx++;
 		/*
 		 * gsi_xfer_elem_buffer has a size of IPA_REPL_XFER_THRESH.
@@ -2524,6 +2738,9 @@ static void ipa3_fast_replenish_rx_cache(struct ipa3_sys_context *sys)
 		WARN_ON(1);
 	}
 
+	if (ring_stats)
+		ring_stats->napi_alloc += inline_cnt;
+
 	spin_unlock_bh(&sys->spinlock);
 
 	__trigger_repl_work(sys);
@@ -3469,7 +3686,8 @@ static void ipa3_wq_rx_common(struct ipa3_sys_context *sys,
 		sys->pyld_hdlr(rx_skb, sys);
 
 		/* For coalescing, we have 2 transfer rings to replenish */
-		if (sys->ep->client == IPA_CLIENT_APPS_WAN_COAL_CONS) {
+		if (sys->ep->client == IPA_CLIENT_APPS_WAN_COAL_CONS &&
+			!ipa3_ctx->coal_def_napi) {
 			ipa_ep_idx = ipa3_get_ep_mapping(
 					IPA_CLIENT_APPS_WAN_CONS);
 
@@ -3540,7 +3758,9 @@ static void ipa3_rx_napi_chain(struct ipa3_sys_context *sys,
 					}
 					wan_def_sys =
 						ipa3_ctx->ep[ipa_ep_idx].sys;
-					wan_def_sys->repl_hdlr(wan_def_sys);
+					if (!ipa3_ctx->coal_def_napi)
+						wan_def_sys->repl_hdlr(
+							wan_def_sys);
 					sys->repl_hdlr(sys);
 				}
 			}
@@ -3577,7 +3797,8 @@ static void ipa3_rx_napi_chain(struct ipa3_sys_context *sys,
 				}
 				wan_def_sys =
 					ipa3_ctx->ep[ipa_ep_idx].sys;
-				wan_def_sys->repl_hdlr(wan_def_sys);
+				if (!ipa3_ctx->coal_def_napi)
+					wan_def_sys->repl_hdlr(wan_def_sys);
 			}
 		}
 	}
@@ -4352,6 +4573,41 @@ static void ipa_gsi_irq_tx_notify_cb(struct gsi_chan_xfer_notify *notify)
 	}
 }
 
+static void ipa3_napi_schedule_ipi(void *info)
+{
+	struct ipa3_sys_context *sys = info;
+
+	atomic_set(&sys->napi_ipi_pending, 0);
+	napi_schedule(sys->napi_obj);
+}
+
+/*
+ * Schedule the pipe's NAPI instance, on the CPU it is bound to if any.
+ * The GSI interrupt is shared by all pipes, so this is what spreads the
+ * coalescing and default WAN pipes across CPUs.
+ */
+static void ipa3_napi_schedule(struct ipa3_sys_context *sys)
+{
+	int cpu = sys->napi_cpu;
+	int this_cpu = get_cpu();
+
+	if (cpu < 0 || cpu == this_cpu || !cpu_online(cpu)) {
+		napi_schedule(sys->napi_obj);
+		goto out;
+	}
+
+	/* an IPI already on its way will schedule the poll */
+	if (atomic_xchg(&sys->napi_ipi_pending, 1))
+		goto out;
+
+	if (smp_call_function_single_async(cpu, &sys->napi_csd)) {
+		atomic_set(&sys->napi_ipi_pending, 0);
+		napi_schedule(sys->napi_obj);
+	}
+out:
+	put_cpu();
+}
+
 void __ipa_gsi_irq_rx_scedule_poll(struct ipa3_sys_context *sys)
 {
 	bool clk_off;
@@ -4369,7 +4625,7 @@ void __ipa_gsi_irq_rx_scedule_poll(struct ipa3_sys_context *sys)
 	if (ipa3_ctx->use_ipa_pm) {
 		clk_off = ipa_pm_activate(sys->pm_hdl);
 		if (!clk_off && sys->napi_obj) {
-			napi_schedule(sys->napi_obj);
+			ipa3_napi_schedule(sys);
 			IPA_STATS_INC_CNT(sys->napi_sch_cnt);
 			return;
 		}
@@ -4384,7 +4640,7 @@ void __ipa_gsi_irq_rx_scedule_poll(struct ipa3_sys_context *sys)
 		clk_off = ipa3_inc_client_enable_clks_no_block(
 			&log);
 		if (!clk_off) {
-			napi_schedule(sys->napi_obj);
+			ipa3_napi_schedule(sys);
 			return;
 		}
 	}
@@ -4422,6 +4678,7 @@ static void ipa_gsi_irq_rx_notify_cb(struct gsi_chan_xfer_notify *notify)
 			/* put the gsi channel into polling mode */
 			gsi_config_channel_mode(sys->ep->gsi_chan_hdl,
 				GSI_CHAN_MODE_POLL);
+			sys->poll_intr_cnt++;
 			__ipa_gsi_irq_rx_scedule_poll(sys);
 		}
 		break;
@@ -4455,6 +4712,7 @@ static void ipa_dma_gsi_irq_rx_notify_cb(struct gsi_chan_xfer_notify *notify)
 			/* put the gsi channel into polling mode */
 			gsi_config_channel_mode(sys->ep->gsi_chan_hdl,
 				GSI_CHAN_MODE_POLL);
+			sys->poll_intr_cnt++;
 		#ifdef IPA_WAKELOCKS
 			ipa3_inc_acquire_wakelock();
 		#endif
@@ -4551,7 +4809,8 @@ static int ipa_gsi_setup_channel(struct ipa_sys_connect_params *in,
 
 	} else if (in->client == IPA_CLIENT_APPS_WAN_CONS &&
 			coale_ep_idx != IPA_EP_NOT_ALLOCATED &&
-			ipa3_ctx->ep[coale_ep_idx].valid == 1) {
+			ipa3_ctx->ep[coale_ep_idx].valid == 1 &&
+			!ipa3_ctx->coal_def_napi) {
 		IPADBG("Wan consumer pipe configured\n");
 		result = ipa_gsi_setup_coal_def_channel(in, ep,
 					&ipa3_ctx->ep[coale_ep_idx]);
@@ -4590,7 +4849,9 @@ static int ipa_gsi_setup_event_ring(struct ipa3_ep_context *ep,
 	u32 ring_size, gfp_t mem_flag)
 {
 	struct gsi_evt_ring_props gsi_evt_ring_props;
+	struct ipa3_pipe_moderation *mod = NULL;
 	dma_addr_t evt_dma_addr;
+	int ep_idx;
 	int result;
 
 	evt_dma_addr = 0;
@@ -4624,6 +4885,16 @@ static int ipa_gsi_setup_event_ring(struct ipa3_ep_context *ep,
 		gsi_evt_ring_props.int_modc = 1;
 	}
 
+	ep_idx = ipa3_get_ep_mapping(ep->client);
+	if (ep_idx != IPA_EP_NOT_ALLOCATED)
+		mod = &ipa3_ctx->pipe_mod[ep_idx];
+	if (mod && mod->set) {
+		gsi_evt_ring_props.int_modt = mod->int_modt;
+		gsi_evt_ring_props.int_modc = mod->int_modc;
+	}
+	ep->sys->int_modt = gsi_evt_ring_props.int_modt;
+	ep->sys->int_modc = gsi_evt_ring_props.int_modc;
+
 	IPADBG("client=%d moderation threshold cycles=%u cnt=%u\n",
 		ep->client,
 		gsi_evt_ring_props.int_modt,
@@ -4936,6 +5207,7 @@ int ipa3_rx_poll(u32 clnt_hdl, int weight)
 	}
 
 	ep = &ipa3_ctx->ep[clnt_hdl];
+	ep->sys->poll_cycles++;
 start_poll:
 	while (remain_aggr_weight > 0 &&
 			atomic_read(&ep->sys->curr_polling_state)) {
@@ -4952,6 +5224,7 @@ int ipa3_rx_poll(u32 clnt_hdl, int weight)
 
 		trace_ipa3_rx_poll_num(num);
 		ipa3_rx_napi_chain(ep->sys, notify, num);
+		ep->sys->poll_pkts += num;
 		remain_aggr_weight -= num;
 
 		trace_ipa3_rx_poll_cnt(ep->sys->len);
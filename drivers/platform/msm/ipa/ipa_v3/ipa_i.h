@@ -65,6 +65,9 @@
 #define IPA_DL_CHECKSUM_LENGTH (8)
 #define IPA_NUM_DESC_PER_SW_TX (3)
 #define IPA_GENERIC_RX_POOL_SZ 192
+#define IPA_PAGE_POLL_DEFAULT_THRESHOLD 15
+#define IPA_PAGE_POLL_MAX_THRESHOLD 64
+#define IPA_POLL_INACTIVITY_DEFAULT 40
 #define IPA_UC_FINISH_MAX 6
 #define IPA_UC_WAIT_MIN_SLEEP 1000
 #define IPA_UC_WAII_MAX_SLEEP 1200
@@ -1011,6 +1014,20 @@ struct ipa3_repl_ctx {
 	atomic_t pending;
 };
 
+/**
+ * struct ipa3_pipe_moderation - interrupt moderation set for a pipe
+ * @int_modt: event ring moderation timer, in 32KHz clock cycles
+ * @int_modc: event ring moderation packet count
+ * @poll_inactivity: empty polls before going back to interrupt mode
+ * @set: the values above replace the defaults of the pipe
+ */
+struct ipa3_pipe_moderation {
+	u16 int_modt;
+	u8 int_modc;
+	u32 poll_inactivity;
+	bool set;
+};
+
 /**
  * struct ipa3_sys_context - IPA GPI pipes context
  * @head_desc_list: header descriptors list
@@ -1049,11 +1066,19 @@ struct ipa3_sys_context {
 	struct ipa3_repl_ctx *page_recycle_repl;
 	u32 pkt_sent;
 	struct napi_struct *napi_obj;
+	int napi_cpu;
+	atomic_t napi_ipi_pending;
+	call_single_data_t napi_csd;
 	struct list_head pending_pkts[GSI_VEID_MAX];
 	atomic_t xmit_eot_cnt;
 	struct tasklet_struct tasklet;
 	bool skip_eot;
 	u32 eob_drop_cnt;
+	u16 int_modt;
+	u8 int_modc;
+	u32 poll_intr_cnt;
+	u64 poll_cycles;
+	u64 poll_pkts;
 
 	/* ordering is important - mutable fields go above */
 	struct ipa3_ep_context *ep;
@@ -1369,9 +1394,34 @@ enum ipa3_config_this_ep {
 	IPA_DO_NOT_CONFIGURE_THIS_EP,
 };
 
+#define IPA_RX_RING_OCC_BUCKETS 8
+
+enum ipa3_rx_ring_stats_idx {
+	IPA_RX_RING_STATS_COAL,
+	IPA_RX_RING_STATS_WAN,
+	IPA_RX_RING_STATS_LAN,
+	IPA_RX_RING_STATS_MAX,
+};
+
+/**
+ * struct ipa3_rx_ring_stats - RX ring refill statistics
+ * @starve: refills that found the ring fully drained
+ * @cache_miss: refills that found the prefilled buffer cache empty
+ * @napi_alloc: buffers allocated directly in the refill path
+ * @occupancy: ring fill level seen by the refill, in 1/8 steps
+ */
+struct ipa3_rx_ring_stats {
+	u64 starve;
+	u64 cache_miss;
+	u64 napi_alloc;
+	u64 occupancy[IPA_RX_RING_OCC_BUCKETS];
+};
+
 struct ipa3_page_recycle_stats {
 	u64 total_replenished;
 	u64 tmp_alloc;
+	u64 recycled;
+	u64 polled;
 };
 struct ipa3_stats {
 	u32 tx_sw_pkts;
@@ -1395,6 +1445,7 @@ struct ipa3_stats {
 	u32 tx_non_linear;
 	u32 rx_page_drop_cnt;
 	struct ipa3_page_recycle_stats page_recycle_stats[2];
+	struct ipa3_rx_ring_stats rx_ring_stats[IPA_RX_RING_STATS_MAX];
 };
 
 /* offset for each stats */
@@ -2028,6 +2079,9 @@ struct ipa3_context {
 		gsi_info[IPA_HW_PROTOCOL_MAX];
 	bool ipa_mhi_proxy;
 	bool ipa_wan_skb_page;
+	u32 page_poll_threshold;
+	struct ipa3_pipe_moderation pipe_mod[IPA3_MAX_NUM_PIPES];
+	bool coal_def_napi;
 	struct ipahal_imm_cmd_pyld *coal_cmd_pyld;
 	struct ipa3_app_clock_vote app_clock_vote;
 	struct ipa_mem_buffer uc_act_tbl;
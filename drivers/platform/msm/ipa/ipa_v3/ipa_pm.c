@@ -142,6 +142,13 @@ enum ipa_pm_state {
  * @deactivate work: delayed work for deferred_deactivate function
  * @complete: generic wait-for-completion handler
  * @wlock: wake source to prevent AP suspend
+ * @hold_ms: delay of the deferred deactivation
+ * @off_ts: when the deferred deactivation last dropped the clock vote
+ * @last_gap_ms: time from that drop to the next activation, last time
+ * @clk_on: number of clock votes taken
+ * @clk_off: number of clock votes dropped
+ * @fast_on: votes taken again within IPA_PM_DEFERRED_TIMEOUT_MAX of a
+ *	     deferred drop
  */
 struct ipa_pm_client {
 	char name[IPA_PM_MAX_EX_CL];
@@ -157,6 +164,12 @@ struct ipa_pm_client {
 	struct delayed_work deactivate_work;
 	struct completion complete;
 	struct wakeup_source wlock;
+	u32 hold_ms;
+	ktime_t off_ts;
+	u32 last_gap_ms;
+	u32 clk_on;
+	u32 clk_off;
+	u32 fast_on;
 };
 
 /*
@@ -395,6 +408,57 @@ static void clock_scaling_func(struct work_struct *work)
 	do_clk_scaling();
 }
 
+/**
+ * ipa_pm_deferred_delay() - delay of the deferred deactivation of a client
+ * @client: the client being deactivated
+ */
+static unsigned long ipa_pm_deferred_delay(struct ipa_pm_client *client)
+{
+	unsigned long delay = client->hold_ms;
+
+	if (ipa3_ctx->ipa3_hw_mode == IPA_HW_MODE_VIRTUAL ||
+		ipa3_ctx->ipa3_hw_mode == IPA_HW_MODE_EMULATION)
+		delay *= 5;
+
+	return msecs_to_jiffies(delay);
+}
+
+/**
+ * ipa_pm_hold_update() - tune the deferred deactivation delay of a client
+ * that is activated again after the deferred deactivation dropped its vote
+ * @client: the client being activated, with its state_lock held
+ *
+ * Coming back within IPA_PM_DEFERRED_TIMEOUT_MAX doubles the delay. When the
+ * gap is about the same as the previous one the traffic is periodic, and the
+ * delay is stretched past the period right away so the clock stays on
+ * through it. A longer gap halves the delay back towards the default.
+ */
+static void ipa_pm_hold_update(struct ipa_pm_client *client)
+{
+	u32 gap, prev, hold;
+
+	if (!client->off_ts)
+		return;
+
+	gap = ktime_ms_delta(ktime_get(), client->off_ts);
+	client->off_ts = 0;
+	prev = client->last_gap_ms;
+	client->last_gap_ms = gap;
+
+	if (gap >= IPA_PM_DEFERRED_TIMEOUT_MAX) {
+		client->hold_ms = max_t(u32, client->hold_ms / 2,
+			IPA_PM_DEFERRED_TIMEOUT);
+		return;
+	}
+
+	client->fast_on++;
+	if (prev && abs((int)gap - (int)prev) <= prev / 4)
+		hold = client->hold_ms + gap + gap / 4;
+	else
+		hold = client->hold_ms * 2;
+	client->hold_ms = min_t(u32, hold, IPA_PM_DEFERRED_TIMEOUT_MAX);
+}
+
 /**
  * activate_work_func - activate a client and vote for clock on a work queue
  */
@@ -409,6 +473,7 @@ static void activate_work_func(struct work_struct *work)
 		IPA_ACTIVE_CLIENTS_INC_SPECIAL(client->name);
 		if (client->group == IPA_PM_GROUP_APPS)
 			__pm_stay_awake(&client->wlock);
+		client->clk_on++;
 	}
 
 	spin_lock_irqsave(&client->state_lock, flags);
@@ -431,6 +496,7 @@ static void activate_work_func(struct work_struct *work)
 			IPA_ACTIVE_CLIENTS_DEC_SPECIAL(client->name);
 			if (client->group == IPA_PM_GROUP_APPS)
 				__pm_relax(&client->wlock);
+			client->clk_off++;
 		}
 
 		IPA_PM_DBG_STATE(client->hdl, client->name, client->state);
@@ -461,7 +527,6 @@ static void delayed_deferred_deactivate_work_func(struct work_struct *work)
 	struct delayed_work *dwork;
 	struct ipa_pm_client *client;
 	unsigned long flags;
-	unsigned long delay;
 
 	dwork = container_of(work, struct delayed_work, work);
 	client = container_of(dwork, struct ipa_pm_client, deactivate_work);
@@ -473,23 +538,20 @@ static void delayed_deferred_deactivate_work_func(struct work_struct *work)
 		client->state = IPA_PM_ACTIVATED;
 		goto bail;
 	case IPA_PM_ACTIVATED_PENDING_RESCHEDULE:
-		delay = IPA_PM_DEFERRED_TIMEOUT;
-		if (ipa3_ctx->ipa3_hw_mode == IPA_HW_MODE_VIRTUAL ||
-			ipa3_ctx->ipa3_hw_mode == IPA_HW_MODE_EMULATION)
-			delay *= 5;
-
 		queue_delayed_work(ipa_pm_ctx->wq, &client->deactivate_work,
-			msecs_to_jiffies(delay));
+			ipa_pm_deferred_delay(client));
 		client->state = IPA_PM_ACTIVATED_PENDING_DEACTIVATION;
 		goto bail;
 	case IPA_PM_ACTIVATED_PENDING_DEACTIVATION:
 		client->state = IPA_PM_DEACTIVATED;
+		client->off_ts = ktime_get();
 		IPA_PM_DBG_STATE(client->hdl, client->name, client->state);
 		spin_unlock_irqrestore(&client->state_lock, flags);
 		if (!client->skip_clk_vote) {
 			IPA_ACTIVE_CLIENTS_DEC_SPECIAL(client->name);
 			if (client->group == IPA_PM_GROUP_APPS)
 				__pm_relax(&client->wlock);
+			client->clk_off++;
 		}
 
 		deactivate_client(client->hdl);
@@ -763,6 +825,7 @@ int ipa_pm_register(struct ipa_pm_register_params *params, u32 *hdl)
 	client->group = params->group;
 	client->hdl = *hdl;
 	client->skip_clk_vote = params->skip_clk_vote;
+	client->hold_ms = IPA_PM_DEFERRED_TIMEOUT;
 	wlock = &client->wlock;
 	wakeup_source_init(wlock, client->name);
 
@@ -925,6 +988,7 @@ static int ipa_pm_activate_helper(struct ipa_pm_client *client, bool sync)
 		spin_unlock_irqrestore(&client->state_lock, flags);
 		return 0;
 	case IPA_PM_DEACTIVATED:
+		ipa_pm_hold_update(client);
 		break;
 	default:
 		IPA_PM_ERR("Invalid State\n");
@@ -947,6 +1011,8 @@ static int ipa_pm_activate_helper(struct ipa_pm_client *client, bool sync)
 
 	/* we got the clocks */
 	if (result == 0) {
+		if (!client->skip_clk_vote)
+			client->clk_on++;
 		client->state = IPA_PM_ACTIVATED;
 		if (client->group == IPA_PM_GROUP_APPS)
 			__pm_stay_awake(&client->wlock);
@@ -1025,7 +1091,6 @@ int ipa_pm_deferred_deactivate(u32 hdl)
 {
 	struct ipa_pm_client *client;
 	unsigned long flags;
-	unsigned long delay;
 
 	if (ipa_pm_ctx == NULL) {
 		IPA_PM_ERR("PM_ctx is null\n");
@@ -1049,14 +1114,9 @@ int ipa_pm_deferred_deactivate(u32 hdl)
 		spin_unlock_irqrestore(&client->state_lock, flags);
 		return 0;
 	case IPA_PM_ACTIVATED:
-		delay = IPA_PM_DEFERRED_TIMEOUT;
-		if (ipa3_ctx->ipa3_hw_mode == IPA_HW_MODE_VIRTUAL ||
-			ipa3_ctx->ipa3_hw_mode == IPA_HW_MODE_EMULATION)
-			delay *= 5;
-
 		client->state = IPA_PM_ACTIVATED_PENDING_DEACTIVATION;
 		queue_delayed_work(ipa_pm_ctx->wq, &client->deactivate_work,
-			msecs_to_jiffies(delay));
+			ipa_pm_deferred_delay(client));
 		break;
 	case IPA_PM_ACTIVATED_TIMER_SET:
 	case IPA_PM_ACTIVATED_PENDING_DEACTIVATION:
@@ -1128,6 +1188,7 @@ int ipa_pm_deactivate_all_deferred(void)
 				IPA_ACTIVE_CLIENTS_DEC_SPECIAL(client->name);
 				if (client->group == IPA_PM_GROUP_APPS)
 					__pm_relax(&client->wlock);
+				client->clk_off++;
 			}
 			deactivate_client(client->hdl);
 		} else /* if activated or deactivated, we do nothing */
@@ -1183,6 +1244,7 @@ int ipa_pm_deactivate_sync(u32 hdl)
 		IPA_ACTIVE_CLIENTS_DEC_SPECIAL(client->name);
 		if (client->group == IPA_PM_GROUP_APPS)
 			__pm_relax(&client->wlock);
+		client->clk_off++;
 	}
 
 	spin_lock_irqsave(&client->state_lock, flags);
@@ -1359,11 +1421,17 @@ int ipa_pm_stat(char *buf, int size)
 			tput = ipa_pm_ctx->group_tput[client->group];
 
 		result = scnprintf(buf + cnt, size - cnt,
-		"Client[%d]: %s State:%s\nGroup: %s Throughput: %d Pipes: ",
+		"Client[%d]: %s State:%s\nGroup: %s Throughput: %d\n",
 			i, client->name, client_state_to_str[client->state],
 			ipa_pm_group_to_str[client->group], tput);
 		cnt += result;
 
+		result = scnprintf(buf + cnt, size - cnt,
+			"Hold: %u ms Clk on: %u off: %u fast on: %u Pipes: ",
+			client->hold_ms, client->clk_on, client->clk_off,
+			client->fast_on);
+		cnt += result;
+
 		for (j = 0; j < IPA3_MAX_NUM_PIPES; j++) {
 			if (ipa_pm_ctx->clients_by_pipe[j] == client) {
 				result = scnprintf(buf + cnt, size - cnt,
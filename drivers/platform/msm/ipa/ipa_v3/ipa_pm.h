@@ -21,6 +21,7 @@
 #define IPA_PM_THRESHOLD_MAX 5
 #define IPA_PM_EXCEPTION_MAX 5
 #define IPA_PM_DEFERRED_TIMEOUT 100
+#define IPA_PM_DEFERRED_TIMEOUT_MAX 800
 
 /*
  * ipa_pm group names
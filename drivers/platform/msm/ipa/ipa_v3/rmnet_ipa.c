@@ -92,6 +92,7 @@ static int ipa3_wwan_add_ul_flt_rule_to_ipa(void);
 static int ipa3_wwan_del_ul_flt_rule_to_ipa(void);
 static void ipa3_wwan_msg_free_cb(void*, u32, u32);
 static int ipa3_rmnet_poll(struct napi_struct *napi, int budget);
+static int ipa3_rmnet_def_poll(struct napi_struct *napi, int budget);
 
 static void ipa3_wake_tx_queue(struct work_struct *work);
 static DECLARE_WORK(ipa3_tx_wakequeue_work, ipa3_wake_tx_queue);
@@ -113,6 +114,8 @@ struct ipa3_rmnet_plat_drv_res {
 	bool is_platform_type_msm;
 	bool ipa_advertise_sg_support;
 	bool ipa_napi_enable;
+	bool ipa_napi_def_split;
+	int ipa_napi_def_cpu;
 	u32 wan_rx_desc_size;
 };
 
@@ -136,6 +139,7 @@ struct ipa3_wwan_private {
 	struct completion resource_granted_completion;
 	enum ipa3_wwan_device_status device_status;
 	struct napi_struct napi;
+	struct napi_struct napi_def;
 };
 
 struct rmnet_ipa3_context {
@@ -1143,6 +1147,8 @@ static int __ipa_wwan_open(struct net_device *dev)
 
 	if (ipa3_rmnet_res.ipa_napi_enable)
 		napi_enable(&(wwan_ptr->napi));
+	if (ipa3_rmnet_res.ipa_napi_def_split)
+		napi_enable(&(wwan_ptr->napi_def));
 	return 0;
 }
 
@@ -1209,6 +1215,8 @@ static int ipa3_wwan_stop(struct net_device *dev)
 	__ipa_wwan_close(dev);
 	if (ipa3_rmnet_res.ipa_napi_enable)
 		napi_disable(&(wwan_ptr->napi));
+	if (ipa3_rmnet_res.ipa_napi_def_split)
+		napi_disable(&(wwan_ptr->napi_def));
 	netif_stop_queue(dev);
 	return 0;
 }
@@ -1621,6 +1629,15 @@ static int handle3_ingress_format(struct net_device *dev,
 
 	if (ipa3_rmnet_res.ipa_napi_enable)
 		ipa_wan_ep_cfg->napi_obj = &(rmnet_ipa3_ctx->wwan_priv->napi);
+	/* poll the default pipe on its own NAPI instance */
+	if (ipa3_rmnet_res.ipa_napi_def_split &&
+		ipa_wan_ep_cfg->client == IPA_CLIENT_APPS_WAN_COAL_CONS) {
+		ipa_wan_ep_cfg->napi_def_obj =
+			&(rmnet_ipa3_ctx->wwan_priv->napi_def);
+		ipa_wan_ep_cfg->napi_def_cpu = ipa3_rmnet_res.ipa_napi_def_cpu;
+	} else {
+		ipa_wan_ep_cfg->napi_def_obj = NULL;
+	}
 	ipa_wan_ep_cfg->desc_fifo_sz =
 		ipa3_rmnet_res.wan_rx_desc_size * IPA_FIFO_ELEMENT_SIZE;
 
@@ -2558,6 +2575,19 @@ static int get_ipa_rmnet_dts_configuration(struct platform_device *pdev,
 	pr_info("IPA Napi Enable = %s\n",
 		ipa_rmnet_drv_res->ipa_napi_enable ? "True" : "False");
 
+	ipa_rmnet_drv_res->ipa_napi_def_split =
+		ipa_rmnet_drv_res->ipa_napi_enable &&
+		of_property_read_bool(pdev->dev.of_node,
+			"qcom,ipa-napi-def-split");
+	pr_info("IPA Napi default pipe split = %s\n",
+		ipa_rmnet_drv_res->ipa_napi_def_split ? "True" : "False");
+
+	if (of_property_read_u32(pdev->dev.of_node, "qcom,ipa-napi-def-cpu",
+		&ipa_rmnet_drv_res->ipa_napi_def_cpu))
+		ipa_rmnet_drv_res->ipa_napi_def_cpu = -1;
+	IPAWANDBG(": ipa-napi-def-cpu = %d\n",
+		ipa_rmnet_drv_res->ipa_napi_def_cpu);
+
 	/* Get IPA WAN RX desc fifo size */
 	result = of_property_read_u32(pdev->dev.of_node,
 			"qcom,wan-rx-desc-size",
@@ -2845,6 +2875,9 @@ static int ipa3_wwan_probe(struct platform_device *pdev)
 	if (ipa3_rmnet_res.ipa_napi_enable)
 		netif_napi_add(dev, &(rmnet_ipa3_ctx->wwan_priv->napi),
 		       ipa3_rmnet_poll, NAPI_WEIGHT);
+	if (ipa3_rmnet_res.ipa_napi_def_split)
+		netif_napi_add(dev, &(rmnet_ipa3_ctx->wwan_priv->napi_def),
+		       ipa3_rmnet_def_poll, NAPI_WEIGHT);
 	ret = register_netdev(dev);
 	if (ret) {
 		IPAWANERR("unable to register ipa_netdev %d rc=%d\n",
@@ -2882,6 +2915,8 @@ static int ipa3_wwan_probe(struct platform_device *pdev)
 config_err:
 	if (ipa3_rmnet_res.ipa_napi_enable)
 		netif_napi_del(&(rmnet_ipa3_ctx->wwan_priv->napi));
+	if (ipa3_rmnet_res.ipa_napi_def_split)
+		netif_napi_del(&(rmnet_ipa3_ctx->wwan_priv->napi_def));
 	unregister_netdev(dev);
 set_perf_err:
 	if (ipa3_ctx->use_ipa_pm)
@@ -2925,6 +2960,8 @@ static int ipa3_wwan_remove(struct platform_device *pdev)
 		rmnet_ipa3_ctx->apps_to_ipa3_hdl = -1;
 	if (ipa3_rmnet_res.ipa_napi_enable)
 		netif_napi_del(&(rmnet_ipa3_ctx->wwan_priv->napi));
+	if (ipa3_rmnet_res.ipa_napi_def_split)
+		netif_napi_del(&(rmnet_ipa3_ctx->wwan_priv->napi_def));
 	mutex_unlock(&rmnet_ipa3_ctx->pipe_handle_guard);
 	IPAWANINFO("rmnet_ipa unregister_netdev\n");
 	unregister_netdev(IPA_NETDEV());
@@ -5018,6 +5055,16 @@ static int ipa3_rmnet_poll(struct napi_struct *napi, int budget)
 	return rcvd_pkts;
 }
 
+static int ipa3_rmnet_def_poll(struct napi_struct *napi, int budget)
+{
+	int rcvd_pkts = 0;
+
+	rcvd_pkts = ipa_rx_poll(ipa3_get_ep_mapping(IPA_CLIENT_APPS_WAN_CONS),
+					NAPI_WEIGHT);
+	IPAWANDBG_LOW("rcvd packets on default pipe: %d\n", rcvd_pkts);
+	return rcvd_pkts;
+}
+
 late_initcall(ipa3_wwan_init);
 module_exit(ipa3_wwan_cleanup);
 MODULE_DESCRIPTION("WWAN Network Interface");
@@ -24,6 +24,8 @@
 #include <linux/reboot.h>
 #include <linux/module.h>
 #include <linux/sched/clock.h>
+#include <linux/seq_file.h>
+#include <linux/ktime.h>
 #include <soc/oplus/system/oplus_project.h>
 
 #ifdef CONFIG_OPLUS_CHARGER_MTK
@@ -95,6 +97,30 @@ static struct oplus_chg_chip *g_charger_chip = NULL;
 #define OPLUS_CHG_UPDATE_INTERVAL	round_jiffies_relative(msecs_to_jiffies(OPLUS_CHG_UPDATE_INTERVAL_SEC*1000))
 #define OPLUS_CHGON_WAKEUP_DELAY_COUNT 4  /*20S*/
 
+/*
+ * Runs of update_work asked for by charger events (oplus_chg_wake_update_work)
+ * are kept apart by at least this long, so an interrupt burst is handled by
+ * one run reading the charger and gauge registers instead of one per event.
+ */
+static unsigned int update_min_gap_ms = 500;
+module_param(update_min_gap_ms, uint, 0644);
+MODULE_PARM_DESC(update_min_gap_ms, "min gap between event driven charger updates");
+
+struct oplus_chg_update_stats {
+	u64 periodic;
+	u64 event;
+	u64 run_time_ns;
+	u64 run_time_max_ns;
+	u64 read_time_ns;
+	u64 read_time_max_ns;
+	u64 last_end_ns;
+};
+
+static struct oplus_chg_update_stats update_stats;
+static atomic64_t update_wakeups = ATOMIC64_INIT(0);
+static atomic64_t update_coalesced = ATOMIC64_INIT(0);
+static atomic_t update_event_pending = ATOMIC_INIT(0);
+
 #define OPLUS_CHG_DEFAULT_CHARGING_CURRENT	512
 
 int enable_charger_log = 0;
@@ -1619,6 +1645,41 @@ static const struct file_operations chg_ctl_proc_fops = {
 	.owner = THIS_MODULE,
 };
 
+static int update_stats_proc_show(struct seq_file *seq_filp, void *v)
+{
+	struct oplus_chg_update_stats *s = &update_stats;
+	u64 runs = s->periodic + s->event;
+
+	seq_printf(seq_filp, "periodic_runs: %llu\n", s->periodic);
+	seq_printf(seq_filp, "event_runs: %llu\n", s->event);
+	seq_printf(seq_filp, "event_wakeups: %llu\n",
+		   (u64)atomic64_read(&update_wakeups));
+	seq_printf(seq_filp, "event_coalesced: %llu\n",
+		   (u64)atomic64_read(&update_coalesced));
+	seq_printf(seq_filp, "run_avg_us: %llu\n",
+		   runs ? div64_u64(s->run_time_ns, runs) / NSEC_PER_USEC : 0);
+	seq_printf(seq_filp, "run_max_us: %llu\n",
+		   div_u64(s->run_time_max_ns, NSEC_PER_USEC));
+	seq_printf(seq_filp, "read_avg_us: %llu\n",
+		   runs ? div64_u64(s->read_time_ns, runs) / NSEC_PER_USEC : 0);
+	seq_printf(seq_filp, "read_max_us: %llu\n",
+		   div_u64(s->read_time_max_ns, NSEC_PER_USEC));
+	return 0;
+}
+
+static int update_stats_proc_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, update_stats_proc_show, NULL);
+}
+
+static const struct file_operations update_stats_proc_fops = {
+	.open = update_stats_proc_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+	.owner = THIS_MODULE,
+};
+
 static int init_charger_proc(struct oplus_chg_chip *chip)
 {
 	int ret = 0;
@@ -1685,6 +1746,14 @@ static int init_charger_proc(struct oplus_chg_chip *chip)
 		chg_debug("%s: Couldn't create chg_ctl proc entry, %d\n", __func__,
 			  __LINE__);
 	}
+
+	prEntry_tmp = proc_create_data("update_stats", 0444, prEntry_da,
+				       &update_stats_proc_fops, chip);
+	if (prEntry_tmp == NULL) {
+		ret = -1;
+		chg_debug("%s: Couldn't create update_stats proc entry, %d\n", __func__,
+			  __LINE__);
+	}
 	return 0;
 }
 
@@ -7429,9 +7498,17 @@ static void oplus_chg_update_work(struct work_struct *work)
 {
 	struct delayed_work *dwork = to_delayed_work(work);
 	struct oplus_chg_chip *chip = container_of(dwork, struct oplus_chg_chip, update_work);
+	u64 start, read_end, end;
+
+	if (atomic_xchg(&update_event_pending, 0))
+		update_stats.event++;
+	else
+		update_stats.periodic++;
 
+	start = ktime_get_ns();
 	oplus_charger_detect_check(chip);
 	oplus_chg_get_battery_data(chip);
+	read_end = ktime_get_ns();
 	if (chip->charger_exist) {
 		oplus_chg_aicl_check(chip);
 		oplus_chg_protection_check(chip);
@@ -7452,6 +7529,16 @@ static void oplus_chg_update_work(struct work_struct *work)
 	oplus_chg_battery_update_status(chip);
 	oplus_chg_kpoc_power_off_check(chip);
 	oplus_chg_other_thing(chip);
+
+	end = ktime_get_ns();
+	update_stats.read_time_ns += read_end - start;
+	update_stats.read_time_max_ns = max(update_stats.read_time_max_ns,
+					    read_end - start);
+	update_stats.run_time_ns += end - start;
+	update_stats.run_time_max_ns = max(update_stats.run_time_max_ns,
+					   end - start);
+	WRITE_ONCE(update_stats.last_end_ns, end);
+
 	/* run again after interval */
 	schedule_delayed_work(&chip->update_work, OPLUS_CHG_UPDATE_INTERVAL);
 }
@@ -7474,13 +7561,30 @@ void oplus_chg_restart_update_work(void)
 }
 bool oplus_chg_wake_update_work(void)
 {
-	int shedule_work = 0;
+	struct delayed_work *dwork;
+	unsigned long delay = 0;
+	u64 since;
 
 	if (!g_charger_chip) {
 		chg_err(" g_charger_chip NULL,return\n");
 		return true;
 	}
-	shedule_work = mod_delayed_work(system_wq, &g_charger_chip->update_work, 0);
+	dwork = &g_charger_chip->update_work;
+	atomic64_inc(&update_wakeups);
+
+	since = ktime_get_ns() - READ_ONCE(update_stats.last_end_ns);
+	if (since < (u64)update_min_gap_ms * NSEC_PER_MSEC)
+		delay = nsecs_to_jiffies((u64)update_min_gap_ms * NSEC_PER_MSEC - since);
+
+	atomic_set(&update_event_pending, 1);
+	/* A run already due as soon takes care of this event too */
+	if (delayed_work_pending(dwork) &&
+	    time_before_eq(dwork->timer.expires, jiffies + delay)) {
+		atomic64_inc(&update_coalesced);
+		return true;
+	}
+
+	mod_delayed_work(system_wq, dwork, delay);
 	return true;
 }
 
@@ -12,6 +12,8 @@
  * GNU General Public License for more details.
  */
 
+#include <linux/debugfs.h>
+#include <linux/hrtimer.h>
 #include <linux/idr.h>
 #include <linux/interrupt.h>
 #include <linux/io.h>
@@ -24,6 +26,7 @@
 #include <linux/platform_device.h>
 #include <linux/regmap.h>
 #include <linux/rpmsg.h>
+#include <linux/seq_file.h>
 #include <linux/sizes.h>
 #include <linux/slab.h>
 #include <linux/workqueue.h>
@@ -58,6 +61,13 @@ do {									  \
 } while (0)
 
 #define GLINK_NAME_SIZE		32
+/* Spent single-use intents kept per channel for later intent requests */
+#define GLINK_INTENT_POOL_DEPTH	4
+
+static bool rx_in_place;
+module_param(rx_in_place, bool, 0644);
+MODULE_PARM_DESC(rx_in_place,
+		 "Pass unfragmented messages to callbacks from the fifo");
 #define GLINK_VERSION_1		1
 
 #define RPM_GLINK_CID_MIN	1
@@ -129,6 +139,14 @@ struct glink_core_rx_intent {
  * @tx_avail_notify: Waitqueue for pending tx tasks
  * @sent_read_notify: flag to check cmd sent or not
  * @ilc:	ipc logging context reference
+ * @tx_coalesce_us: default time data writes may wait to share a doorbell
+ * @kick_pending: @kick_timer will ring the doorbell, under @tx_lock
+ * @kick_deadline: expiry of @kick_timer, under @tx_lock
+ * @kick_timer:	timer for the coalesced doorbell
+ * @tx_kicks:	doorbells rung for the remote
+ * @tx_coalesced: writes that didn't need a doorbell of their own
+ * @rx_irqs:	interrupts received from the remote
+ * @debugfs:	debugfs file with the counters above
  */
 struct qcom_glink {
 	struct device *dev;
@@ -165,8 +183,21 @@ struct qcom_glink {
 	bool sent_read_notify;
 
 	void *ilc;
+
+	u32 tx_coalesce_us;
+	bool kick_pending;
+	ktime_t kick_deadline;
+	struct hrtimer kick_timer;
+
+	atomic64_t tx_kicks;
+	atomic64_t tx_coalesced;
+	u64 rx_irqs;
+	struct dentry *debugfs;
 };
 
+static struct dentry *glink_debugfs_root;
+static DEFINE_MUTEX(glink_debugfs_lock);
+
 enum {
 	GLINK_STATE_CLOSED,
 	GLINK_STATE_OPENING,
@@ -198,6 +229,14 @@ enum {
  * @intent_req_result: Result of intent request
  * @intent_req_comp: Status of intent request completion
  * @intent_req_event: Waitqueue for @intent_req_comp
+ * @free_intents: spent single-use intents kept for reuse, under @intent_lock
+ * @free_count:	number of intents on @free_intents
+ * @rx_msgs:	messages delivered to the endpoint
+ * @rx_copy_bytes: bytes copied from the fifo into intents
+ * @rx_in_place_bytes: bytes delivered straight from the fifo
+ * @intent_allocs: intents allocated for the remote, under @intent_lock
+ * @intent_recycles: intents served from @free_intents, under @intent_lock
+ * @tx_coalesce_us: time data written by the channel may wait for the doorbell
  */
 struct glink_channel {
 	struct rpmsg_endpoint ept;
@@ -233,6 +272,17 @@ struct glink_channel {
 	bool intent_req_result;
 	atomic_t intent_req_comp;
 	wait_queue_head_t intent_req_event;
+
+	struct list_head free_intents;
+	unsigned int free_count;
+
+	u64 rx_msgs;
+	u64 rx_copy_bytes;
+	u64 rx_in_place_bytes;
+	u64 intent_allocs;
+	u64 intent_recycles;
+
+	u32 tx_coalesce_us;
 };
 
 #define to_glink_channel(_ept) container_of(_ept, struct glink_channel, ept)
@@ -275,6 +325,7 @@ static struct glink_channel *qcom_glink_alloc_channel(struct qcom_glink *glink,
 
 	channel->glink = glink;
 	channel->name = kstrdup(name, GFP_KERNEL);
+	channel->tx_coalesce_us = glink->tx_coalesce_us;
 
 	init_completion(&channel->open_req);
 	init_completion(&channel->open_ack);
@@ -282,6 +333,7 @@ static struct glink_channel *qcom_glink_alloc_channel(struct qcom_glink *glink,
 	init_waitqueue_head(&channel->intent_req_event);
 
 	INIT_LIST_HEAD(&channel->done_intents);
+	INIT_LIST_HEAD(&channel->free_intents);
 	kthread_init_work(&channel->intent_work, qcom_glink_rx_done_work);
 
 	idr_init(&channel->liids);
@@ -321,6 +373,11 @@ static void qcom_glink_channel_release(struct kref *ref)
 	}
 	idr_destroy(&channel->liids);
 
+	list_for_each_entry_safe(intent, tmp, &channel->free_intents, node) {
+		kfree(intent->data);
+		kfree(intent);
+	}
+
 	idr_for_each_entry(&channel->riids, tmp, iid)
 		kfree(tmp);
 	idr_destroy(&channel->riids);
@@ -367,6 +424,19 @@ static void qcom_glink_pipe_reset(struct qcom_glink *glink)
 		glink->rx_pipe->reset(glink->rx_pipe);
 }
 
+/* Signal the remote of everything written so far */
+static void qcom_glink_kick(struct qcom_glink *glink)
+{
+	if (glink->kick_pending) {
+		glink->kick_pending = false;
+		hrtimer_try_to_cancel(&glink->kick_timer);
+	}
+
+	mbox_send_message(glink->mbox_chan, NULL);
+	mbox_client_txdone(glink->mbox_chan, 0);
+	atomic64_inc(&glink->tx_kicks);
+}
+
 static void qcom_glink_send_read_notify(struct qcom_glink *glink)
 {
 	struct glink_msg msg;
@@ -379,13 +449,54 @@ static void qcom_glink_send_read_notify(struct qcom_glink *glink)
 
 	qcom_glink_tx_write(glink, &msg, sizeof(msg), NULL, 0);
 
-	mbox_send_message(glink->mbox_chan, NULL);
-	mbox_client_txdone(glink->mbox_chan, 0);
+	qcom_glink_kick(glink);
 }
 
-static int qcom_glink_tx(struct qcom_glink *glink,
-			 const void *hdr, size_t hlen,
-			 const void *data, size_t dlen, bool wait)
+static enum hrtimer_restart qcom_glink_kick_timer(struct hrtimer *timer)
+{
+	struct qcom_glink *glink = container_of(timer, struct qcom_glink,
+						kick_timer);
+	unsigned long flags;
+
+	spin_lock_irqsave(&glink->tx_lock, flags);
+	if (glink->kick_pending)
+		qcom_glink_kick(glink);
+	spin_unlock_irqrestore(&glink->tx_lock, flags);
+
+	return HRTIMER_NORESTART;
+}
+
+/*
+ * Ring the doorbell for a write of the tx fifo, or leave it to the kick
+ * timer if the write may wait coalesce_us. Called with @tx_lock held.
+ */
+static void qcom_glink_tx_kick(struct qcom_glink *glink, u32 coalesce_us)
+{
+	ktime_t deadline;
+
+	/* Don't let the remote fall behind on a filling fifo */
+	if (!coalesce_us ||
+	    qcom_glink_tx_avail(glink) < glink->tx_pipe->length / 2) {
+		qcom_glink_kick(glink);
+		return;
+	}
+
+	deadline = ktime_add_us(ktime_get(), coalesce_us);
+	if (glink->kick_pending) {
+		atomic64_inc(&glink->tx_coalesced);
+		if (!ktime_before(deadline, glink->kick_deadline))
+			return;
+	}
+
+	glink->kick_pending = true;
+	glink->kick_deadline = deadline;
+	hrtimer_start(&glink->kick_timer, deadline, HRTIMER_MODE_ABS);
+}
+
+static int __qcom_glink_tx(struct qcom_glink *glink,
+			   const void *hdr, size_t hlen,
+			   const void *data, size_t dlen, bool wait,
+			   u32 coalesce_us)
 {
 	unsigned int tlen = hlen + dlen;
 	unsigned long flags;
@@ -430,9 +541,7 @@ static int qcom_glink_tx(struct qcom_glink *glink,
 	}
 
 	qcom_glink_tx_write(glink, hdr, hlen, data, dlen);
-
-	mbox_send_message(glink->mbox_chan, NULL);
-	mbox_client_txdone(glink->mbox_chan, 0);
+	qcom_glink_tx_kick(glink, coalesce_us);
 
 out:
 	spin_unlock_irqrestore(&glink->tx_lock, flags);
@@ -440,6 +549,13 @@ static int qcom_glink_tx(struct qcom_glink *glink,
 	return ret;
 }
 
+static int qcom_glink_tx(struct qcom_glink *glink,
+			 const void *hdr, size_t hlen,
+			 const void *data, size_t dlen, bool wait)
+{
+	return __qcom_glink_tx(glink, hdr, hlen, data, dlen, wait, 0);
+}
+
 static int qcom_glink_send_version(struct qcom_glink *glink)
 {
 	struct glink_msg msg;
@@ -581,6 +697,23 @@ static void qcom_glink_send_close_ack(struct qcom_glink *glink,
 }
 
 
+/*
+ * Keep a spent single-use intent for the next intent request rather than
+ * freeing its buffer, called with @intent_lock held.
+ */
+static void qcom_glink_recycle_intent(struct glink_channel *channel,
+				      struct glink_core_rx_intent *intent)
+{
+	if (channel->free_count < GLINK_INTENT_POOL_DEPTH) {
+		list_add(&intent->node, &channel->free_intents);
+		channel->free_count++;
+		return;
+	}
+
+	kfree(intent->data);
+	kfree(intent);
+}
+
 static int __qcom_glink_rx_done(struct qcom_glink *glink,
 				struct glink_channel *channel,
 				struct glink_core_rx_intent *intent,
@@ -604,11 +737,6 @@ static int __qcom_glink_rx_done(struct qcom_glink *glink,
 	if (ret)
 		return ret;
 
-	if (!reuse) {
-		kfree(intent->data);
-		kfree(intent);
-	}
-
 	CH_INFO(channel, "reuse:%d liid:%d", reuse, iid);
 	return 0;
 }
@@ -620,15 +748,18 @@ static void qcom_glink_rx_done_work(struct kthread_work *work)
 	struct qcom_glink *glink = channel->glink;
 	struct glink_core_rx_intent *intent, *tmp;
 	unsigned long flags;
+	int ret;
 
 	spin_lock_irqsave(&channel->intent_lock, flags);
 	list_for_each_entry_safe(intent, tmp, &channel->done_intents, node) {
 		list_del(&intent->node);
 		spin_unlock_irqrestore(&channel->intent_lock, flags);
 
-		__qcom_glink_rx_done(glink, channel, intent, true);
+		ret = __qcom_glink_rx_done(glink, channel, intent, true);
 
 		spin_lock_irqsave(&channel->intent_lock, flags);
+		if (!ret && !intent->reuse)
+			qcom_glink_recycle_intent(channel, intent);
 	}
 	spin_unlock_irqrestore(&channel->intent_lock, flags);
 }
@@ -658,7 +789,9 @@ static void qcom_glink_rx_done(struct qcom_glink *glink,
 	if (list_empty(&channel->done_intents))
 		ret = __qcom_glink_rx_done(glink, channel, intent, false);
 
-	if (ret) {
+	if (!ret && !intent->reuse) {
+		qcom_glink_recycle_intent(channel, intent);
+	} else if (ret) {
 		list_add_tail(&intent->node, &channel->done_intents);
 		kthread_queue_work(&glink->kworker, &channel->intent_work);
 	}
@@ -793,15 +926,44 @@ qcom_glink_alloc_intent(struct qcom_glink *glink,
 			size_t size,
 			bool reuseable)
 {
-	struct glink_core_rx_intent *intent;
+	struct glink_core_rx_intent *intent = NULL;
+	struct glink_core_rx_intent *tmp;
 	int ret;
 	unsigned long flags;
 
+	/* Take the smallest spent intent that fits */
+	spin_lock_irqsave(&channel->intent_lock, flags);
+	list_for_each_entry(tmp, &channel->free_intents, node) {
+		if (tmp->size >= size && (!intent || tmp->size < intent->size))
+			intent = tmp;
+	}
+	if (intent) {
+		list_del(&intent->node);
+		channel->free_count--;
+		ret = idr_alloc_cyclic(&channel->liids, intent, 1, -1,
+				       GFP_ATOMIC);
+		if (ret < 0) {
+			qcom_glink_recycle_intent(channel, intent);
+			spin_unlock_irqrestore(&channel->intent_lock, flags);
+			return NULL;
+		}
+		channel->intent_recycles++;
+		spin_unlock_irqrestore(&channel->intent_lock, flags);
+
+		intent->id = ret;
+		intent->reuse = reuseable;
+		intent->in_use = false;
+		intent->offset = 0;
+		return intent;
+	}
+	spin_unlock_irqrestore(&channel->intent_lock, flags);
+
 	intent = kzalloc(sizeof(*intent), GFP_KERNEL);
 	if (!intent)
 		return NULL;
 
-	intent->data = kzalloc(size, GFP_KERNEL);
+	/* Only the received bytes are ever handed out */
+	intent->data = kmalloc(size, GFP_KERNEL);
 	if (!intent->data)
 		goto free_intent;
 
@@ -811,6 +973,7 @@ qcom_glink_alloc_intent(struct qcom_glink *glink,
 		spin_unlock_irqrestore(&channel->intent_lock, flags);
 		goto free_data;
 	}
+	channel->intent_allocs++;
 	spin_unlock_irqrestore(&channel->intent_lock, flags);
 
 	intent->id = ret;
@@ -951,6 +1114,7 @@ static int qcom_glink_rx_data(struct qcom_glink *glink, size_t avail)
 	unsigned int left_size;
 	unsigned int rcid;
 	unsigned int liid;
+	void *data = NULL;
 	int ret = 0;
 	unsigned long flags;
 
@@ -1025,21 +1189,39 @@ static int qcom_glink_rx_data(struct qcom_glink *glink, size_t avail)
 		goto advance_rx;
 	}
 
-	qcom_glink_rx_peak(glink, intent->data + intent->offset,
-			   sizeof(hdr), chunk_size);
-	intent->offset += chunk_size;
+	/*
+	 * An unfragmented message that doesn't wrap in the fifo can be read
+	 * by the callback where it is, the fifo isn't advanced until the
+	 * callback has returned.
+	 */
+	if (!left_size && !intent->offset && glink->rx_pipe->peak_ptr &&
+	    READ_ONCE(rx_in_place))
+		data = glink->rx_pipe->peak_ptr(glink->rx_pipe, sizeof(hdr),
+						chunk_size);
+
+	if (data) {
+		channel->rx_in_place_bytes += chunk_size;
+		intent->offset = chunk_size;
+	} else {
+		qcom_glink_rx_peak(glink, intent->data + intent->offset,
+				   sizeof(hdr), chunk_size);
+		intent->offset += chunk_size;
+		channel->rx_copy_bytes += chunk_size;
+		data = intent->data;
+	}
 
 	/* Handle message when no fragments remain to be received */
 	if (!left_size) {
 		spin_lock(&channel->recv_lock);
 		if (channel->ept.cb) {
 			channel->ept.cb(channel->ept.rpdev,
-					intent->data,
+					data,
 					intent->offset,
 					channel->ept.priv,
 					RPMSG_ADDR_ANY);
 		}
 		spin_unlock(&channel->recv_lock);
+		channel->rx_msgs++;
 
 		intent->offset = 0;
 		channel->buf = NULL;
@@ -1198,6 +1380,7 @@ static irqreturn_t qcom_glink_native_intr(int irq, void *data)
 
 	/* To wakeup any blocking writers */
 	wake_up_all(&glink->tx_avail_notify);
+	glink->rx_irqs++;
 
 	for (;;) {
 		avail = qcom_glink_rx_avail(glink);
@@ -1404,6 +1587,9 @@ static int qcom_glink_announce_create(struct rpmsg_device *rpdev)
 	__be32 *val = defaults;
 	int size;
 
+	of_property_read_u32(np, "qcom,tx-coalesce-us",
+			     &channel->tx_coalesce_us);
+
 	if (glink->intentless || !completion_done(&channel->open_ack))
 		return 0;
 
@@ -1552,7 +1738,8 @@ static int __qcom_glink_send(struct glink_channel *channel,
 	req.chunk_size = cpu_to_le32(chunk_size);
 	req.left_size = cpu_to_le32(left_size);
 
-	ret = qcom_glink_tx(glink, &req, sizeof(req), data, chunk_size, wait);
+	ret = __qcom_glink_tx(glink, &req, sizeof(req), data, chunk_size, wait,
+			      channel->tx_coalesce_us);
 
 	/* Mark intent available if we failed */
 	if (ret && intent) {
@@ -1573,8 +1760,8 @@ static int __qcom_glink_send(struct glink_channel *channel,
 		req.chunk_size = cpu_to_le32(chunk_size);
 		req.left_size = cpu_to_le32(left_size);
 
-		ret = qcom_glink_tx(glink, &req, sizeof(req), data,
-				    chunk_size, wait);
+		ret = __qcom_glink_tx(glink, &req, sizeof(req), data,
+				      chunk_size, wait, channel->tx_coalesce_us);
 
 		/* Mark intent available if we failed */
 		if (ret && intent) {
@@ -1657,6 +1844,26 @@ static const struct rpmsg_endpoint_ops glink_endpoint_ops = {
 	.set_sigs = qcom_glink_set_sigs,
 };
 
+static ssize_t rx_stats_show(struct device *dev,
+			     struct device_attribute *attr, char *buf)
+{
+	struct rpmsg_device *rpdev = to_rpmsg_device(dev);
+	struct glink_channel *channel = to_glink_channel(rpdev->ept);
+
+	return scnprintf(buf, PAGE_SIZE,
+			 "msgs: %llu\ncopied_bytes: %llu\nin_place_bytes: %llu\nintent_allocs: %llu\nintent_recycles: %llu\n",
+			 channel->rx_msgs, channel->rx_copy_bytes,
+			 channel->rx_in_place_bytes, channel->intent_allocs,
+			 channel->intent_recycles);
+}
+static DEVICE_ATTR_RO(rx_stats);
+
+static struct attribute *qcom_glink_channel_attrs[] = {
+	&dev_attr_rx_stats.attr,
+	NULL
+};
+ATTRIBUTE_GROUPS(qcom_glink_channel);
+
 static void qcom_glink_rpdev_release(struct device *dev)
 {
 	struct rpmsg_device *rpdev = to_rpmsg_device(dev);
@@ -1722,6 +1929,7 @@ static int qcom_glink_rx_open(struct qcom_glink *glink, unsigned int rcid,
 		rpdev->dev.of_node = node;
 		rpdev->dev.parent = glink->dev;
 		rpdev->dev.release = qcom_glink_rpdev_release;
+		rpdev->dev.groups = qcom_glink_channel_groups;
 
 		ret = rpmsg_register_device(rpdev);
 		if (ret)
@@ -1968,6 +2176,43 @@ static void qcom_glink_cancel_rx_work(struct qcom_glink *glink)
 	list_for_each_entry_safe(dcmd, tmp, &glink->rx_queue, node)
 		kfree(dcmd);
 }
+static int qcom_glink_stats_show(struct seq_file *s, void *unused)
+{
+	struct qcom_glink *glink = s->private;
+
+	seq_printf(s, "tx_kicks: %lld\n", atomic64_read(&glink->tx_kicks));
+	seq_printf(s, "tx_coalesced: %lld\n",
+		   atomic64_read(&glink->tx_coalesced));
+	seq_printf(s, "rx_irqs: %llu\n", glink->rx_irqs);
+	seq_printf(s, "tx_coalesce_us: %u\n", glink->tx_coalesce_us);
+
+	return 0;
+}
+
+static int qcom_glink_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, qcom_glink_stats_show, inode->i_private);
+}
+
+static const struct file_operations qcom_glink_stats_fops = {
+	.open = qcom_glink_stats_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static void qcom_glink_debugfs_init(struct qcom_glink *glink)
+{
+	mutex_lock(&glink_debugfs_lock);
+	if (!glink_debugfs_root)
+		glink_debugfs_root = debugfs_create_dir("glink", NULL);
+	mutex_unlock(&glink_debugfs_lock);
+
+	glink->debugfs = debugfs_create_file(glink->name, 0444,
+					     glink_debugfs_root, glink,
+					     &qcom_glink_stats_fops);
+}
+
 #ifdef  OPLUS_FEATURE_MODEM_DATA_NWPOWER
 //Ruansong@PSW.NW.DATA.2120730, 2019/07/11 add for RM_TAG_POWER_DEBUG
 #define GLINK_NATIVE_IRQ_NUM_MAX 10
@@ -2023,6 +2268,11 @@ struct qcom_glink *qcom_glink_native_probe(struct device *dev,
 	if (ret < 0)
 		glink->name = dev->of_node->name;
 
+	of_property_read_u32(dev->of_node, "qcom,tx-coalesce-us",
+			     &glink->tx_coalesce_us);
+	hrtimer_init(&glink->kick_timer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS);
+	glink->kick_timer.function = qcom_glink_kick_timer;
+
 	glink->mbox_client.dev = dev;
 	glink->mbox_client.knows_txdone = true;
 	glink->mbox_chan = mbox_request_channel(&glink->mbox_client, 0);
@@ -2111,6 +2361,7 @@ struct qcom_glink *qcom_glink_native_probe(struct device *dev,
 		dev_err(glink->dev, "failed to register chrdev\n");
 
 	glink->ilc = ipc_log_context_create(GLINK_LOG_PAGE_CNT, glink->name, 0);
+	qcom_glink_debugfs_init(glink);
 
 	return glink;
 
@@ -2139,6 +2390,8 @@ void qcom_glink_native_remove(struct qcom_glink *glink)
 	qcom_glink_notif_reset(glink);
 	disable_irq(glink->irq);
 	qcom_glink_cancel_rx_work(glink);
+	hrtimer_cancel(&glink->kick_timer);
+	debugfs_remove(glink->debugfs);
 
 	ret = device_for_each_child(glink->dev, NULL, qcom_glink_remove_device);
 	if (ret)
@@ -25,6 +25,9 @@ struct qcom_glink_pipe {
 
 	void (*peak)(struct qcom_glink_pipe *glink_pipe, void *data,
 		     unsigned int offset, size_t count);
+	/* Optional, pointer to count contiguous bytes of the fifo or NULL */
+	void *(*peak_ptr)(struct qcom_glink_pipe *glink_pipe,
+			  unsigned int offset, size_t count);
 	void (*advance)(struct qcom_glink_pipe *glink_pipe, size_t count);
 
 	void (*write)(struct qcom_glink_pipe *glink_pipe,
@@ -116,6 +116,27 @@ static void glink_smem_rx_peak(struct qcom_glink_pipe *np,
 	}
 }
 
+static void *glink_smem_rx_peak_ptr(struct qcom_glink_pipe *np,
+				    unsigned int offset, size_t count)
+{
+	struct glink_smem_pipe *pipe = to_smem_pipe(np);
+	u32 tail;
+
+	tail = le32_to_cpu(*pipe->tail);
+
+	if (WARN_ON_ONCE(tail > pipe->native.length))
+		return NULL;
+
+	tail += offset;
+	if (tail >= pipe->native.length)
+		tail -= pipe->native.length;
+
+	if (count > pipe->native.length - tail)
+		return NULL;
+
+	return pipe->fifo + tail;
+}
+
 static void glink_smem_rx_advance(struct qcom_glink_pipe *np,
 				  size_t count)
 {
@@ -293,6 +314,7 @@ struct qcom_glink *qcom_glink_smem_register(struct device *parent,
 
 	rx_pipe->native.avail = glink_smem_rx_avail;
 	rx_pipe->native.peak = glink_smem_rx_peak;
+	rx_pipe->native.peak_ptr = glink_smem_rx_peak_ptr;
 	rx_pipe->native.advance = glink_smem_rx_advance;
 	rx_pipe->remote_pid = remote_pid;
 
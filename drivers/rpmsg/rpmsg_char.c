@@ -274,15 +274,155 @@ static unsigned int rpmsg_eptdev_poll(struct file *filp, poll_table *wait)
 	return mask;
 }
 
+static int rpmsg_eptdev_read_batch(struct file *filp,
+				   struct rpmsg_batch *batch)
+{
+	struct rpmsg_eptdev *eptdev = filp->private_data;
+	char __user *buf = u64_to_user_ptr(batch->buf);
+	struct rpmsg_batch_frame frame;
+	unsigned long flags;
+	struct sk_buff *skb;
+	size_t used = 0;
+	size_t room;
+
+	batch->count = 0;
+	if (!eptdev->ept)
+		return -EPIPE;
+
+	if (batch->len < RPMSG_BATCH_FRAME_SIZE(0))
+		return -EINVAL;
+
+	if (skb_queue_empty(&eptdev->queue)) {
+		if (filp->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+
+		/* Wait until we get data or the endpoint goes away */
+		if (wait_event_interruptible(eptdev->readq,
+					     !skb_queue_empty(&eptdev->queue) ||
+					     !eptdev->ept))
+			return -ERESTARTSYS;
+
+		/* We lost the endpoint while waiting */
+		if (!eptdev->ept)
+			return -EPIPE;
+	}
+
+	for (;;) {
+		room = batch->len - used;
+		if (room < RPMSG_BATCH_FRAME_SIZE(0))
+			break;
+
+		spin_lock_irqsave(&eptdev->queue_lock, flags);
+		skb = skb_peek(&eptdev->queue);
+		/* Only the first message is truncated to fit */
+		if (skb && batch->count &&
+		    RPMSG_BATCH_FRAME_SIZE(skb->len) > room)
+			skb = NULL;
+		if (skb)
+			__skb_unlink(skb, &eptdev->queue);
+		spin_unlock_irqrestore(&eptdev->queue_lock, flags);
+		if (!skb)
+			break;
+
+		frame.len = min_t(size_t, skb->len, room - sizeof(frame));
+		if (copy_to_user(buf + used, &frame, sizeof(frame)) ||
+		    copy_to_user(buf + used + sizeof(frame), skb->data,
+				 frame.len)) {
+			kfree_skb(skb);
+			if (!batch->count)
+				return -EFAULT;
+			break;
+		}
+		kfree_skb(skb);
+
+		used += min_t(size_t, RPMSG_BATCH_FRAME_SIZE(frame.len), room);
+		batch->count++;
+	}
+
+	batch->len = used;
+	return 0;
+}
+
+static int rpmsg_eptdev_write_batch(struct file *filp,
+				    struct rpmsg_batch *batch)
+{
+	struct rpmsg_eptdev *eptdev = filp->private_data;
+	char __user *buf = u64_to_user_ptr(batch->buf);
+	struct rpmsg_batch_frame frame;
+	size_t used = 0;
+	void *kbuf;
+	int ret = 0;
+
+	batch->count = 0;
+	if (mutex_lock_interruptible(&eptdev->ept_lock))
+		return -ERESTARTSYS;
+
+	while (used + sizeof(frame) <= batch->len) {
+		if (!eptdev->ept) {
+			ret = -EPIPE;
+			break;
+		}
+
+		if (copy_from_user(&frame, buf + used, sizeof(frame))) {
+			ret = -EFAULT;
+			break;
+		}
+
+		if (frame.len > batch->len - used - sizeof(frame)) {
+			/* The frame runs past the end of the buffer */
+			ret = -EINVAL;
+			break;
+		}
+
+		kbuf = memdup_user(buf + used + sizeof(frame), frame.len);
+		if (IS_ERR(kbuf)) {
+			ret = PTR_ERR(kbuf);
+			break;
+		}
+
+		if (filp->f_flags & O_NONBLOCK)
+			ret = rpmsg_trysend(eptdev->ept, kbuf, frame.len);
+		else
+			ret = rpmsg_send(eptdev->ept, kbuf, frame.len);
+		kfree(kbuf);
+		if (ret)
+			break;
+
+		used += RPMSG_BATCH_FRAME_SIZE(frame.len);
+		batch->count++;
+	}
+	mutex_unlock(&eptdev->ept_lock);
+
+	return batch->count ? 0 : ret;
+}
+
 static long rpmsg_eptdev_ioctl(struct file *fp, unsigned int cmd,
 			       unsigned long arg)
 {
 	struct rpmsg_eptdev *eptdev = fp->private_data;
+	void __user *argp = (void __user *)arg;
+	struct rpmsg_batch batch;
+	int ret;
 
-	if (cmd != RPMSG_DESTROY_EPT_IOCTL)
+	switch (cmd) {
+	case RPMSG_DESTROY_EPT_IOCTL:
+		return rpmsg_eptdev_destroy(&eptdev->dev, NULL);
+	case RPMSG_READ_BATCH_IOCTL:
+	case RPMSG_WRITE_BATCH_IOCTL:
+		if (copy_from_user(&batch, argp, sizeof(batch)))
+			return -EFAULT;
+
+		if (cmd == RPMSG_READ_BATCH_IOCTL)
+			ret = rpmsg_eptdev_read_batch(fp, &batch);
+		else
+			ret = rpmsg_eptdev_write_batch(fp, &batch);
+		if (ret)
+			return ret;
+
+		return copy_to_user(argp, &batch, sizeof(batch)) ? -EFAULT : 0;
+	default:
 		return -EINVAL;
-
-	return rpmsg_eptdev_destroy(&eptdev->dev, NULL);
+	}
 }
 
 static const struct file_operations rpmsg_eptdev_fops = {
@@ -293,6 +433,7 @@ static const struct file_operations rpmsg_eptdev_fops = {
 	.write = rpmsg_eptdev_write,
 	.poll = rpmsg_eptdev_poll,
 	.unlocked_ioctl = rpmsg_eptdev_ioctl,
+	.compat_ioctl = rpmsg_eptdev_ioctl,
 };
 
 static ssize_t name_show(struct device *dev, struct device_attribute *attr,
@@ -17,6 +17,7 @@
  *
  */
 
+#include <linux/keyslot-manager.h>
 #include <linux/random.h>
 #include "ufs-debugfs.h"
 #include "unipro.h"
@@ -796,6 +797,38 @@ static const struct file_operations ufsdbg_err_stats_fops = {
 	.release	= single_release,
 };
 
+#ifdef CONFIG_SCSI_UFS_CRYPTO
+static int ufsdbg_crypto_stats_show(struct seq_file *file, void *data)
+{
+	struct ufs_hba *hba = (struct ufs_hba *)file->private;
+	struct keyslot_manager_stats stats;
+
+	if (!hba->ksm) {
+		seq_puts(file, "inline crypto not enabled\n");
+		return 0;
+	}
+
+	keyslot_manager_get_stats(hba->ksm, &stats);
+	seq_printf(file, "slot hits (lockless):\t%llu\n", stats.fast_hits);
+	seq_printf(file, "slot hits:\t\t%llu\n", stats.hits);
+	seq_printf(file, "slot programs:\t\t%llu\n", stats.programs);
+	seq_printf(file, "slot evictions:\t\t%llu\n", stats.evictions);
+	seq_printf(file, "slot waits:\t\t%llu\n", stats.waits);
+	return 0;
+}
+
+static int ufsdbg_crypto_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, ufsdbg_crypto_stats_show, inode->i_private);
+}
+
+static const struct file_operations ufsdbg_crypto_stats_fops = {
+	.open		= ufsdbg_crypto_stats_open,
+	.read		= seq_read,
+	.release	= single_release,
+};
+#endif
+
 static int ufshcd_init_statistics(struct ufs_hba *hba)
 {
 	struct ufs_stats *stats = &hba->ufs_stats;
@@ -1671,6 +1704,18 @@ void ufsdbg_add_debugfs(struct ufs_hba *hba)
 		goto err;
 	}
 
+#ifdef CONFIG_SCSI_UFS_CRYPTO
+	hba->debugfs_files.crypto_stats =
+		debugfs_create_file("crypto_stats", S_IRUSR,
+					   hba->debugfs_files.stats_folder, hba,
+					   &ufsdbg_crypto_stats_fops);
+	if (!hba->debugfs_files.crypto_stats) {
+		dev_err(hba->dev, "%s:  NULL crypto_stats file, exiting",
+			__func__);
+		goto err;
+	}
+#endif
+
 	if (ufshcd_init_statistics(hba)) {
 		dev_err(hba->dev, "%s: Error initializing statistics",
 			__func__);
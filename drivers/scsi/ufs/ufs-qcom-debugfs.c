@@ -278,6 +278,60 @@ static const struct file_operations ufs_qcom_dbg_pm_qos_desc = {
 	.release	= single_release,
 };
 
+static int ufs_qcom_dbg_clk_scaling_show(struct seq_file *file, void *data)
+{
+	struct ufs_qcom_host *host = (struct ufs_qcom_host *)file->private;
+	struct ufs_clk_scaling *scaling = &host->hba->clk_scaling;
+	struct ufs_clk_scaling_stats st[2];
+	u64 lat_up, stream_down;
+	unsigned long flags;
+	bool scaled_up;
+	int i;
+
+	spin_lock_irqsave(host->hba->host->host_lock, flags);
+	memcpy(st, scaling->stats, sizeof(st));
+	scaled_up = scaling->is_scaled_up;
+	if (scaling->state_ts)
+		st[scaled_up].residency_us +=
+			ktime_us_delta(ktime_get(), scaling->state_ts);
+	lat_up = scaling->nr_lat_up;
+	stream_down = scaling->nr_stream_down;
+	spin_unlock_irqrestore(host->hba->host->host_lock, flags);
+
+	seq_printf(file, "lat_target_us: %u\nqd_threshold: %u\n",
+		   scaling->lat_target_us, scaling->qd_threshold);
+	seq_printf(file, "lat_scale_ups: %llu\nstream_scale_downs: %llu\n",
+		   lat_up, stream_down);
+	for (i = 1; i >= 0; i--)
+		seq_printf(file,
+			"%s%s: gear=%u entries=%llu residency_ms=%llu reads=%llu read_avg_us=%llu read_max_us=%llu writes=%llu write_avg_us=%llu\n",
+			i ? "scaled_up" : "scaled_down",
+			i == scaled_up ? "(current)" : "",
+			st[i].gear, st[i].entries,
+			div_u64(st[i].residency_us, USEC_PER_MSEC),
+			st[i].reads,
+			st[i].reads ? div64_u64(st[i].read_lat_us,
+						st[i].reads) : 0,
+			st[i].read_lat_max_us, st[i].writes,
+			st[i].writes ? div64_u64(st[i].write_lat_us,
+						 st[i].writes) : 0);
+
+	return 0;
+}
+
+static int ufs_qcom_dbg_clk_scaling_open(struct inode *inode,
+					 struct file *file)
+{
+	return single_open(file, ufs_qcom_dbg_clk_scaling_show,
+			   inode->i_private);
+}
+
+static const struct file_operations ufs_qcom_dbg_clk_scaling_desc = {
+	.open		= ufs_qcom_dbg_clk_scaling_open,
+	.read		= seq_read,
+	.release	= single_release,
+};
+
 void ufs_qcom_dbg_add_debugfs(struct ufs_hba *hba, struct dentry *root)
 {
 	struct ufs_qcom_host *host;
@@ -377,6 +431,17 @@ void ufs_qcom_dbg_add_debugfs(struct ufs_hba *hba, struct dentry *root)
 			goto err;
 		}
 
+	host->debugfs_files.clk_scaling =
+		debugfs_create_file("clk_scaling", 0400,
+				host->debugfs_files.debugfs_root, host,
+				&ufs_qcom_dbg_clk_scaling_desc);
+	if (!host->debugfs_files.clk_scaling) {
+		dev_err(host->hba->dev,
+			"%s: failed create clk_scaling debugfs entry\n",
+			__func__);
+		goto err;
+	}
+
 	return;
 
 err:
@@ -246,6 +246,7 @@ struct qcom_debugfs_files {
 	struct dentry *testbus_bus;
 	struct dentry *dbg_regs;
 	struct dentry *pm_qos;
+	struct dentry *clk_scaling;
 };
 #endif
 
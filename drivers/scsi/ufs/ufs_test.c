@@ -18,11 +18,14 @@
 #include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/module.h>
+#include <linux/sort.h>
 #include <linux/test-iosched.h>
+#include <linux/vmalloc.h>
 #include <scsi/scsi_device.h>
 #include <scsi/scsi_cmnd.h>
 #include <linux/delay.h>
 #include <../sd.h>
+#include "ufshcd.h"
 
 #define MODULE_NAME "ufs_test"
 
@@ -57,6 +60,12 @@
 		(LONG_TEST_SIZE_INTEGER(x) * 10))
 /* translation mask from sectors to block */
 #define SECTOR_TO_BLOCK_MASK 0x7
+/* benchmark defaults and limits */
+#define BENCH_DEFAULT_QUEUE_DEPTH	32
+#define BENCH_DEFAULT_NUM_REQS	10000
+#define BENCH_MAX_NUM_REQS	(1 << 20)
+/* bench_hpb and bench_tw value leaving the feature as it is */
+#define BENCH_FEATURE_KEEP	2
 
 #define TEST_OPS(test_name, upper_case_name)				\
 static int ufs_test_ ## test_name ## _show(struct seq_file *file,	\
@@ -96,6 +105,8 @@ enum ufs_test_testcases {
 	UFS_TEST_PARALLEL_READ_AND_WRITE,
 	UFS_TEST_LUN_DEPTH,
 
+	UFS_TEST_BENCHMARK,
+
 	NUM_TESTS,
 };
 
@@ -145,6 +156,29 @@ struct ufs_test_data {
 	u32 sector_range;
 	/* total number of requests to be submitted in long test */
 	u32 long_test_num_reqs;
+
+	/* transfer completion stats of the host when the test started */
+	u64 compl_irqs;
+	u64 compl_reqs;
+	u64 compl_ns;
+
+	/*
+	 * Benchmark pattern: random or sequential, read or write, with
+	 * bench_bios bios per request and up to bench_queue_depth requests
+	 * in flight. bench_hpb and bench_tw turn HPB reads and TurboWrite
+	 * off (0) or on (1) for the run, BENCH_FEATURE_KEEP leaves them.
+	 */
+	u32 bench_random;
+	u32 bench_write;
+	u32 bench_queue_depth;
+	u32 bench_bios;
+	u32 bench_num_reqs;
+	u32 bench_hpb;
+	u32 bench_tw;
+	/* completion latency of each benchmark request, in us */
+	u32 *bench_lat_us;
+	u32 bench_lat_size;
+	atomic_t bench_nr_lat;
 };
 
 static struct ufs_test_data *utd;
@@ -253,6 +287,8 @@ static char *ufs_test_get_test_case_str(struct test_data *td)
 		return "UFS parallel read and write test";
 	case UFS_TEST_LUN_DEPTH:
 		return "UFS LUN depth test";
+	case UFS_TEST_BENCHMARK:
+		return "UFS benchmark";
 	default:
 		return "Unknown test";
 	}
@@ -355,7 +391,8 @@ static int ufs_test_show(struct seq_file *file, int test_case)
 		 "This test runs the following scenarios\n"
 		 "- Long Random Read Test: this test measures read "
 		 "IOPS at the driver level by reading many 4KB requests"
-		 "with random LBAs\n";
+		 "with random LBAs, and the number and cost of the "
+		 "completion interrupts they took\n";
 		break;
 	case UFS_TEST_LONG_SEQUENTIAL_WRITE:
 		test_description =  "\nufs_long_sequential_write_test\n"
@@ -414,6 +451,17 @@ static int ufs_test_show(struct seq_file *file, int test_case)
 		 "The test will test for each iteration once only reads and "
 		 "once only writes.\n";
 		break;
+	case UFS_TEST_BENCHMARK:
+		test_description = "\nufs_test_benchmark\n"
+		 "=========\n"
+		 "Description:\n"
+		 "This test issues bench_num_reqs random or sequential reads "
+		 "or writes of bench_bios 4KB bios each, keeping up to "
+		 "bench_queue_depth requests in flight, and reports the IOPS, "
+		 "the throughput and the p50/p99/p99.9 completion latency. "
+		 "HPB reads and TurboWrite can be turned on or off for the run "
+		 "with bench_hpb and bench_tw to compare feature settings.\n";
+		break;
 	default:
 		test_description = "Unknown test";
 	}
@@ -451,6 +499,55 @@ static struct gendisk *ufs_test_get_rq_disk(void)
 	return gd;
 }
 
+static struct ufs_hba *ufs_test_get_hba(void)
+{
+	struct request_queue *req_q = test_iosched_get_req_queue();
+	struct scsi_device *sd;
+
+	if (!req_q)
+		return NULL;
+
+	sd = (struct scsi_device *)req_q->queuedata;
+	return shost_priv(sd->host);
+}
+
+static void ufs_test_save_compl_stats(void)
+{
+	struct ufs_hba *hba = ufs_test_get_hba();
+
+	if (!hba)
+		return;
+
+	utd->compl_irqs = hba->ufs_stats.tr_compl_irqs;
+	utd->compl_reqs = hba->ufs_stats.tr_compl_reqs;
+	utd->compl_ns = hba->ufs_stats.tr_compl_ns;
+}
+
+/*
+ * Report how many completion interrupts the test took and what they cost,
+ * to compare interrupt aggregation settings.
+ */
+static void ufs_test_report_compl_stats(unsigned long num_ios)
+{
+	struct ufs_hba *hba = ufs_test_get_hba();
+	u64 irqs, reqs, ns;
+
+	if (!hba || !num_ios)
+		return;
+
+	irqs = hba->ufs_stats.tr_compl_irqs - utd->compl_irqs;
+	reqs = hba->ufs_stats.tr_compl_reqs - utd->compl_reqs;
+	ns = hba->ufs_stats.tr_compl_ns - utd->compl_ns;
+
+	pr_info("%s: aggregation cnt %u timeout %uus, %llu interrupts for %llu requests",
+		__func__, ufshcd_is_intr_aggr_allowed(hba) ?
+		hba->intr_aggr_cnt : 0,
+		hba->intr_aggr_tmout * INT_AGGR_TO_UNIT_US, irqs, reqs);
+	pr_info("%s: completion cost %llu ns/IO, %llu ns/interrupt\n",
+		__func__, div64_u64(ns, num_ios),
+		irqs ? div64_u64(ns, irqs) : 0);
+}
+
 static int ufs_test_check_result(struct test_data *td)
 {
 	if (utd->test_stage == UFS_TEST_ERROR) {
@@ -1045,6 +1142,163 @@ static int run_mixed_long_seq_test(struct test_data *td)
 	return ret;
 }
 
+static void ufs_test_bench_set_features(void)
+{
+#if defined(CONFIG_UFSFEATURE)
+	struct ufs_hba *hba = ufs_test_get_hba();
+	int lun;
+
+	if (!hba)
+		return;
+
+#if defined(CONFIG_UFSHPB)
+	if (utd->bench_hpb < BENCH_FEATURE_KEEP)
+		for (lun = 0; lun < UFS_UPIU_MAX_GENERAL_LUN; lun++)
+			if (hba->ufsf.ufshpb_lup[lun])
+				hba->ufsf.ufshpb_lup[lun]->force_disable =
+					!utd->bench_hpb;
+#endif
+#if defined(CONFIG_UFSTW)
+	if (utd->bench_tw < BENCH_FEATURE_KEEP)
+		ufsf_tw_enable(&hba->ufsf, utd->bench_tw);
+#endif
+#endif
+}
+
+static void ufs_test_bench_end_io_fn(struct request *rq, int err)
+{
+	u64 start = rq_io_start_time_ns(rq) ?: rq_start_time_ns(rq);
+	int idx;
+
+	if (start) {
+		idx = atomic_inc_return(&utd->bench_nr_lat) - 1;
+		if (idx < utd->bench_lat_size)
+			utd->bench_lat_us[idx] = div_u64(ktime_get_ns() - start,
+							 NSEC_PER_USEC);
+	}
+
+	long_test_free_end_io_fn(rq, err);
+	wake_up(&utd->wait_q);
+}
+
+static bool ufs_test_bench_check_completion(void)
+{
+	return utd->completed_req_count >= utd->bench_num_reqs;
+}
+
+/**
+ * ufs_test_run_benchmark - issue the configured benchmark pattern
+ * @td - test specific data
+ *
+ * Requests are added one at a time, waiting for a completion whenever
+ * bench_queue_depth of them are in flight, so the device sees a steady
+ * queue depth instead of the bursts the long tests generate.
+ */
+static int ufs_test_run_benchmark(struct test_data *td)
+{
+	u32 req_sectors = utd->bench_bios * (TEST_BIO_SIZE / SECTOR_SIZE);
+	u32 seed = utd->random_test_seed ? utd->random_test_seed : MAGIC_SEED;
+	int direction = utd->bench_write ? WRITE : READ;
+	u32 sector = td->start_sector, blocks;
+	unsigned int i;
+	int ret = 0;
+
+	utd->sector_range = test_iosched->sector_range ?
+		test_iosched->sector_range : TEST_DEFAULT_SECTOR_RANGE;
+
+	if (!utd->bench_queue_depth ||
+	    utd->bench_queue_depth > QUEUE_MAX_REQUESTS ||
+	    !utd->bench_bios || utd->bench_bios > TEST_MAX_BIOS_PER_REQ ||
+	    !utd->bench_num_reqs || utd->bench_num_reqs > BENCH_MAX_NUM_REQS ||
+	    utd->sector_range <= req_sectors) {
+		pr_err("%s: invalid benchmark parameters", __func__);
+		return -EINVAL;
+	}
+	blocks = (utd->sector_range - req_sectors) /
+		(SECTOR_TO_BLOCK_MASK + 1);
+
+	vfree(utd->bench_lat_us);
+	utd->bench_lat_us = vmalloc(utd->bench_num_reqs *
+				    sizeof(*utd->bench_lat_us));
+	utd->bench_lat_size = utd->bench_lat_us ? utd->bench_num_reqs : 0;
+	atomic_set(&utd->bench_nr_lat, 0);
+	utd->completed_req_count = 0;
+
+	ufs_test_bench_set_features();
+
+	pr_info("%s: %s %s, %u x 4KB, queue depth %u, %u requests", __func__,
+		utd->bench_random ? "random" : "sequential",
+		utd->bench_write ? "write" : "read", utd->bench_bios,
+		utd->bench_queue_depth, utd->bench_num_reqs);
+
+	for (i = 0; i < utd->bench_num_reqs; i++) {
+		wait_event(utd->wait_q, i - READ_ONCE(utd->completed_req_count)
+			   < utd->bench_queue_depth);
+
+		if (utd->bench_random) {
+			sector = td->start_sector + (ufs_test_pseudo_random_seed(
+				&seed, 0, blocks) << 3);
+		} else if (i) {
+			sector += req_sectors;
+			if (sector + req_sectors >
+			    td->start_sector + utd->sector_range)
+				sector = td->start_sector;
+		}
+
+		ret = test_iosched_add_wr_rd_test_req(0, direction, sector,
+				utd->bench_bios, TEST_PATTERN_5A,
+				ufs_test_bench_end_io_fn);
+		if (ret) {
+			pr_err("%s: failed to create request", __func__);
+			break;
+		}
+		blk_run_queue(td->req_q);
+	}
+
+	return ret;
+}
+
+static int ufs_test_cmp_u32(const void *a, const void *b)
+{
+	u32 x = *(const u32 *)a, y = *(const u32 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static int ufs_test_bench_report(struct test_data *td)
+{
+	unsigned long mtime, iops, kbps;
+	u32 *lat = utd->bench_lat_us;
+	unsigned int nr;
+
+	mtime = max_t(unsigned long,
+		      ktime_to_ms(utd->test_info.test_duration), 1);
+	iops = utd->completed_req_count * 1000UL / mtime;
+	kbps = iops * utd->bench_bios * (TEST_BIO_SIZE / 1024);
+
+	pr_info("%s: %u requests in %lu msec, %lu IOP/sec, %lu KiB/sec",
+		__func__, utd->completed_req_count, mtime, iops, kbps);
+
+	nr = min_t(unsigned int, atomic_read(&utd->bench_nr_lat),
+		   utd->bench_lat_size);
+	if (nr) {
+		sort(lat, nr, sizeof(*lat), ufs_test_cmp_u32, NULL);
+		pr_info("%s: latency us p50 %u p99 %u p99.9 %u max %u",
+			__func__, lat[(nr - 1) * 500ULL / 1000],
+			lat[(nr - 1) * 990ULL / 1000],
+			lat[(nr - 1) * 999ULL / 1000], lat[nr - 1]);
+	} else {
+		pr_info("%s: no request timestamps for latencies", __func__);
+	}
+	ufs_test_report_compl_stats(utd->completed_req_count);
+
+	vfree(utd->bench_lat_us);
+	utd->bench_lat_us = NULL;
+	utd->bench_lat_size = 0;
+
+	return 0;
+}
+
 static int long_rand_test_calc_iops(struct test_data *td)
 {
 	unsigned long mtime, num_ios, iops;
@@ -1061,6 +1315,7 @@ static int long_rand_test_calc_iops(struct test_data *td)
 	iops = num_ios / mtime;
 
 	pr_info("%s: IOPS: %lu IOP/sec\n", __func__, iops);
+	ufs_test_report_compl_stats(utd->completed_req_count);
 
 	return 0;
 }
@@ -1258,6 +1513,13 @@ static ssize_t ufs_test_write(struct file *file, const char __user *buf,
 	case UFS_TEST_LUN_DEPTH:
 		utd->test_info.run_test_fn = ufs_test_run_lun_depth_test;
 		break;
+	case UFS_TEST_BENCHMARK:
+		utd->test_info.run_test_fn = ufs_test_run_benchmark;
+		utd->test_info.post_test_fn = ufs_test_bench_report;
+		utd->test_info.check_test_result_fn = ufs_test_check_result;
+		utd->test_info.check_test_completion_fn =
+			ufs_test_bench_check_completion;
+		break;
 	default:
 		pr_err("%s: Unknown test-case: %d", __func__, test_case);
 		WARN_ON(true);
@@ -1269,6 +1531,7 @@ static ssize_t ufs_test_write(struct file *file, const char __user *buf,
 		pr_info("%s: ====================", __func__);
 
 		utd->test_info.test_byte_count = 0;
+		ufs_test_save_compl_stats();
 		ret = test_iosched_start_test(&utd->test_info);
 		if (ret) {
 			pr_err("%s: Test failed, err=%d.", __func__, ret);
@@ -1294,6 +1557,7 @@ TEST_OPS(long_sequential_write, LONG_SEQUENTIAL_WRITE);
 TEST_OPS(long_sequential_mixed, LONG_SEQUENTIAL_MIXED);
 TEST_OPS(parallel_read_and_write, PARALLEL_READ_AND_WRITE);
 TEST_OPS(lun_depth, LUN_DEPTH);
+TEST_OPS(benchmark, BENCHMARK);
 
 static void ufs_test_debugfs_cleanup(void)
 {
@@ -1362,6 +1626,24 @@ static int ufs_test_debugfs_init(void)
 	add_test(utd, lun_depth, LUN_DEPTH);
 	if (ret)
 		goto exit_err;
+	ret = add_test(utd, benchmark, BENCHMARK);
+	if (ret)
+		goto exit_err;
+
+	debugfs_create_u32("bench_random", S_IRUGO | S_IWUSR, utils_root,
+			   &utd->bench_random);
+	debugfs_create_u32("bench_write", S_IRUGO | S_IWUSR, utils_root,
+			   &utd->bench_write);
+	debugfs_create_u32("bench_queue_depth", S_IRUGO | S_IWUSR,
+			   utils_root, &utd->bench_queue_depth);
+	debugfs_create_u32("bench_bios", S_IRUGO | S_IWUSR, utils_root,
+			   &utd->bench_bios);
+	debugfs_create_u32("bench_num_reqs", S_IRUGO | S_IWUSR, utils_root,
+			   &utd->bench_num_reqs);
+	debugfs_create_u32("bench_hpb", S_IRUGO | S_IWUSR, utils_root,
+			   &utd->bench_hpb);
+	debugfs_create_u32("bench_tw", S_IRUGO | S_IWUSR, utils_root,
+			   &utd->bench_tw);
 
 	goto exit;
 
@@ -1390,6 +1672,12 @@ int __init ufs_test_init(void)
 	}
 
 	init_waitqueue_head(&utd->wait_q);
+	utd->bench_random = 1;
+	utd->bench_queue_depth = BENCH_DEFAULT_QUEUE_DEPTH;
+	utd->bench_bios = 1;
+	utd->bench_num_reqs = BENCH_DEFAULT_NUM_REQS;
+	utd->bench_hpb = BENCH_FEATURE_KEEP;
+	utd->bench_tw = BENCH_FEATURE_KEEP;
 	utd->bdt.init_fn = ufs_test_probe;
 	utd->bdt.exit_fn = ufs_test_remove;
 	INIT_LIST_HEAD(&utd->bdt.list);
@@ -1402,6 +1690,7 @@ EXPORT_SYMBOL(ufs_test_init);
 static void __exit ufs_test_exit(void)
 {
 	test_iosched_unregister(&utd->bdt);
+	vfree(utd->bench_lat_us);
 	kfree(utd);
 }
 module_init(ufs_test_init);
@@ -260,6 +260,8 @@ static void ufshcd_update_uic_error_cnt(struct ufs_hba *hba, u32 reg, int type)
 
 /* Interrupt aggregation default timeout, unit: 40us */
 #define INT_AGGR_DEF_TO	0x02
+/* Lone requests complete without waiting for the aggregation timeout */
+#define INT_AGGR_DEF_BYPASS_QD	2
 
 /* default value of auto suspend is 3 seconds */
 #define UFSHCD_AUTO_SUSPEND_DELAY_MS 3000 /* millisecs */
@@ -275,6 +277,18 @@ static void ufshcd_update_uic_error_cnt(struct ufs_hba *hba, u32 reg, int type)
 #define UFSHCD_CLK_GATING_DELAY_MS_PWR_SAVE	10
 #define UFSHCD_CLK_GATING_DELAY_MS_PERF		50
 
+/* Pending requests that make a window busy in latency target mode */
+#define UFSHCD_CLK_SCALING_QD_THRESHOLD		8
+
+/* Adaptive clock gating defaults */
+#define UFSHCD_CLK_GATE_ADAPTIVE_MAX_MS		64
+#define UFSHCD_CLK_GATE_ADAPTIVE_WEIGHT_US	20
+#define UFSHCD_CLK_GATE_EXIT_COST_US		500
+/* gaps recorded for a class before its delay is picked again */
+#define UFSHCD_CLK_GATE_REPICK			16
+/* halve a class histogram once it holds that many gaps */
+#define UFSHCD_CLK_GATE_DECAY			256
+
 /* IOCTL opcode for command - ufs set device read only */
 #define UFS_IOCTL_BLKROSET      BLKROSET
 
@@ -1828,6 +1842,25 @@ static void ufshcd_clock_scaling_unprepare(struct ufs_hba *hba)
  * Returns -EBUSY if scaling can't happen at this time
  * Returns non-zero for any other errors
  */
+/* Account the time spent in the current scaling state and switch state */
+static void ufshcd_clk_scaling_set_state(struct ufs_hba *hba, bool scale_up)
+{
+	struct ufs_clk_scaling *scaling = &hba->clk_scaling;
+	unsigned long flags;
+	ktime_t now = ktime_get();
+
+	spin_lock_irqsave(hba->host->host_lock, flags);
+	if (scaling->state_ts)
+		scaling->stats[scaling->is_scaled_up].residency_us +=
+			ktime_us_delta(now, scaling->state_ts);
+	scaling->state_ts = now;
+	if (scaling->is_scaled_up != scale_up)
+		scaling->stats[scale_up].entries++;
+	scaling->stats[scale_up].gear = hba->pwr_info.gear_rx;
+	scaling->is_scaled_up = scale_up;
+	spin_unlock_irqrestore(hba->host->host_lock, flags);
+}
+
 static int ufshcd_devfreq_scale(struct ufs_hba *hba, bool scale_up)
 {
 	int ret = 0;
@@ -1892,7 +1925,7 @@ static int ufshcd_devfreq_scale(struct ufs_hba *hba, bool scale_up)
 	}
 
 	if (!ret) {
-		hba->clk_scaling.is_scaled_up = scale_up;
+		ufshcd_clk_scaling_set_state(hba, scale_up);
 		if (scale_up)
 			hba->clk_gating.delay_ms =
 				hba->clk_gating.delay_ms_perf;
@@ -2008,6 +2041,36 @@ static int ufshcd_devfreq_target(struct device *dev,
 }
 
 
+/*
+ * Latency target mode: the busy time alone doesn't tell a burst of small
+ * foreground reads, which want the high gear however short the burst is,
+ * from a long stream of buffered writes, which keeps the link busy but
+ * doesn't care how fast it completes. Report the window fully busy when
+ * the foreground reads missed the latency target or the queue got deep,
+ * and idle when async writes made up most of the traffic.
+ * Host lock must be held.
+ */
+static void ufshcd_clk_scaling_apply_targets(struct ufs_hba *hba,
+		struct devfreq_dev_status *stat)
+{
+	struct ufs_clk_scaling *scaling = &hba->clk_scaling;
+
+	if (!stat->total_time)
+		return;
+
+	if ((scaling->win_reads && scaling->win_read_lat_us >
+	     (u64)scaling->win_reads * scaling->lat_target_us) ||
+	    (scaling->qd_threshold &&
+	     scaling->win_max_qd >= scaling->qd_threshold)) {
+		stat->busy_time = stat->total_time;
+		scaling->nr_lat_up++;
+	} else if (scaling->win_sectors && scaling->win_stream_sectors * 10 >=
+		   scaling->win_sectors * 9) {
+		stat->busy_time = 0;
+		scaling->nr_stream_down++;
+	}
+}
+
 static int ufshcd_devfreq_get_dev_status(struct device *dev,
 		struct devfreq_dev_status *stat)
 {
@@ -2031,9 +2094,16 @@ static int ufshcd_devfreq_get_dev_status(struct device *dev,
 	stat->total_time = jiffies_to_usecs((long)jiffies -
 				(long)scaling->window_start_t);
 	stat->busy_time = scaling->tot_busy_t;
+	if (scaling->lat_target_us)
+		ufshcd_clk_scaling_apply_targets(hba, stat);
 start_window:
 	scaling->window_start_t = jiffies;
 	scaling->tot_busy_t = 0;
+	scaling->win_reads = 0;
+	scaling->win_read_lat_us = 0;
+	scaling->win_sectors = 0;
+	scaling->win_stream_sectors = 0;
+	scaling->win_max_qd = scaling->active_reqs;
 
 	if (hba->outstanding_reqs) {
 		scaling->busy_start_t = ktime_get();
@@ -2156,6 +2226,50 @@ static ssize_t ufshcd_clkscale_enable_store(struct device *dev,
 	return count;
 }
 
+static ssize_t ufshcd_clkscale_lat_target_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct ufs_hba *hba = dev_get_drvdata(dev);
+
+	return snprintf(buf, PAGE_SIZE, "%u\n",
+			hba->clk_scaling.lat_target_us);
+}
+
+static ssize_t ufshcd_clkscale_lat_target_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct ufs_hba *hba = dev_get_drvdata(dev);
+	u32 value;
+
+	if (kstrtou32(buf, 0, &value))
+		return -EINVAL;
+
+	WRITE_ONCE(hba->clk_scaling.lat_target_us, value);
+	return count;
+}
+
+static ssize_t ufshcd_clkscale_qd_threshold_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct ufs_hba *hba = dev_get_drvdata(dev);
+
+	return snprintf(buf, PAGE_SIZE, "%u\n",
+			hba->clk_scaling.qd_threshold);
+}
+
+static ssize_t ufshcd_clkscale_qd_threshold_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct ufs_hba *hba = dev_get_drvdata(dev);
+	u32 value;
+
+	if (kstrtou32(buf, 0, &value))
+		return -EINVAL;
+
+	WRITE_ONCE(hba->clk_scaling.qd_threshold, value);
+	return count;
+}
+
 static void ufshcd_clkscaling_init_sysfs(struct ufs_hba *hba)
 {
 	hba->clk_scaling.enable_attr.show = ufshcd_clkscale_enable_show;
@@ -2165,6 +2279,143 @@ static void ufshcd_clkscaling_init_sysfs(struct ufs_hba *hba)
 	hba->clk_scaling.enable_attr.attr.mode = 0644;
 	if (device_create_file(hba->dev, &hba->clk_scaling.enable_attr))
 		dev_err(hba->dev, "Failed to create sysfs for clkscale_enable\n");
+
+	hba->clk_scaling.qd_threshold = UFSHCD_CLK_SCALING_QD_THRESHOLD;
+
+	hba->clk_scaling.lat_target_attr.show =
+		ufshcd_clkscale_lat_target_show;
+	hba->clk_scaling.lat_target_attr.store =
+		ufshcd_clkscale_lat_target_store;
+	sysfs_attr_init(&hba->clk_scaling.lat_target_attr.attr);
+	hba->clk_scaling.lat_target_attr.attr.name = "clkscale_lat_target_us";
+	hba->clk_scaling.lat_target_attr.attr.mode = 0644;
+	if (device_create_file(hba->dev, &hba->clk_scaling.lat_target_attr))
+		dev_err(hba->dev, "Failed to create sysfs for clkscale_lat_target_us\n");
+
+	hba->clk_scaling.qd_threshold_attr.show =
+		ufshcd_clkscale_qd_threshold_show;
+	hba->clk_scaling.qd_threshold_attr.store =
+		ufshcd_clkscale_qd_threshold_store;
+	sysfs_attr_init(&hba->clk_scaling.qd_threshold_attr.attr);
+	hba->clk_scaling.qd_threshold_attr.attr.name = "clkscale_qd_threshold";
+	hba->clk_scaling.qd_threshold_attr.attr.mode = 0644;
+	if (device_create_file(hba->dev, &hba->clk_scaling.qd_threshold_attr))
+		dev_err(hba->dev, "Failed to create sysfs for clkscale_qd_threshold\n");
+}
+
+static unsigned int ufshcd_clkgate_gap_bucket(s64 gap_us)
+{
+	if (gap_us < USEC_PER_MSEC)
+		return 0;
+	return min_t(unsigned int, ilog2(gap_us / USEC_PER_MSEC) + 1,
+		     UFS_GATE_GAP_BUCKETS - 1);
+}
+
+/* middle of a gap bucket, in us */
+static u64 ufshcd_clkgate_gap_mid_us(unsigned int bucket)
+{
+	if (!bucket)
+		return USEC_PER_MSEC / 2;
+	return (3 * USEC_PER_MSEC / 2) << (bucket - 1);
+}
+
+/*
+ * Pick the gating delay for @class that minimizes the cost of the gaps
+ * learnt for it: exit_cost_us for each gap longer than the delay, plus
+ * weight_us for each ms the clocks stay on for nothing. Candidates are
+ * the power of two delays up to max_ms, but never below the hibern8 on
+ * idle delay as the link must enter hibern8 before the clocks go off.
+ * Host lock must be held.
+ */
+static void ufshcd_clkgate_pick_delay(struct ufs_hba *hba,
+				      enum ufs_gate_class class)
+{
+	struct ufs_clk_gate_adaptive *ad = &hba->clk_gating.adaptive;
+	u32 *gaps = ad->gaps[class];
+	unsigned long delay_ms, best_ms = 0;
+	u64 cost, best_cost = U64_MAX, on_us, exits;
+	unsigned int i, j;
+
+	for (i = 0; i < UFS_GATE_GAP_BUCKETS - 1; i++) {
+		delay_ms = 1UL << i;
+		if (delay_ms > ad->max_ms)
+			break;
+
+		exits = 0;
+		on_us = 0;
+		for (j = 0; j < UFS_GATE_GAP_BUCKETS; j++) {
+			if (j <= i) {
+				on_us += gaps[j] * ufshcd_clkgate_gap_mid_us(j);
+			} else {
+				exits += gaps[j];
+				on_us += gaps[j] * delay_ms * USEC_PER_MSEC;
+			}
+		}
+
+		cost = exits * ad->exit_cost_us +
+			div_u64(on_us * ad->weight_us, USEC_PER_MSEC);
+		if (cost < best_cost) {
+			best_cost = cost;
+			best_ms = delay_ms;
+		}
+	}
+
+	if (!best_ms)
+		best_ms = ad->max_ms;
+	if (ufshcd_is_hibern8_on_idle_allowed(hba) ||
+	    ufshcd_is_auto_hibern8_supported(hba))
+		best_ms = max(best_ms, hba->hibern8_on_idle.delay_ms + 1);
+
+	ad->delay_ms[class] = best_ms;
+	ad->nr_gaps[class] = 0;
+}
+
+/* End of an idle gap, host lock must be held */
+static void ufshcd_clkgate_record_gap(struct ufs_hba *hba)
+{
+	struct ufs_clk_gate_adaptive *ad = &hba->clk_gating.adaptive;
+	enum ufs_gate_class class = ad->idle_class;
+	u32 *gaps = ad->gaps[class];
+	unsigned int i, total = 0;
+
+	gaps[ufshcd_clkgate_gap_bucket(ktime_us_delta(ktime_get(),
+						      ad->idle_start))]++;
+	ad->idle_start = 0;
+
+	for (i = 0; i < UFS_GATE_GAP_BUCKETS; i++)
+		total += gaps[i];
+	if (total >= UFSHCD_CLK_GATE_DECAY)
+		for (i = 0; i < UFS_GATE_GAP_BUCKETS; i++)
+			gaps[i] >>= 1;
+
+	if (++ad->nr_gaps[class] >= UFSHCD_CLK_GATE_REPICK)
+		ufshcd_clkgate_pick_delay(hba, class);
+}
+
+/* Start of an idle gap, returns the gating delay. Host lock must be held */
+static unsigned long ufshcd_clkgate_idle_delay(struct ufs_hba *hba)
+{
+	struct ufs_clk_gate_adaptive *ad = &hba->clk_gating.adaptive;
+
+	ad->idle_class = ad->burst_writes > ad->burst_reads ?
+		UFS_GATE_CLASS_WRITE : UFS_GATE_CLASS_READ;
+	ad->burst_reads = 0;
+	ad->burst_writes = 0;
+	ad->idle_start = ktime_get();
+
+	if (!ad->enabled)
+		return hba->clk_gating.delay_ms;
+	return ad->delay_ms[ad->idle_class];
+}
+
+/* Host lock must be held */
+static inline void ufshcd_clkgate_count_cmd(struct ufs_hba *hba,
+					    struct scsi_cmnd *cmd)
+{
+	if (cmd->sc_data_direction == DMA_FROM_DEVICE)
+		hba->clk_gating.adaptive.burst_reads++;
+	else
+		hba->clk_gating.adaptive.burst_writes++;
 }
 
 static void ufshcd_ungate_work(struct work_struct *work)
@@ -2173,6 +2424,9 @@ static void ufshcd_ungate_work(struct work_struct *work)
 	unsigned long flags;
 	struct ufs_hba *hba = container_of(work, struct ufs_hba,
 			clk_gating.ungate_work);
+	struct ufs_clk_gate_adaptive *ad = &hba->clk_gating.adaptive;
+	ktime_t start = ktime_get();
+	s64 lat_us;
 
 	ufshcd_cancel_gate_work(hba);
 
@@ -2202,6 +2456,13 @@ static void ufshcd_ungate_work(struct work_struct *work)
 		}
 		hba->clk_gating.is_suspended = false;
 	}
+
+	lat_us = ktime_us_delta(ktime_get(), start);
+	spin_lock_irqsave(hba->host->host_lock, flags);
+	ad->exits++;
+	ad->exit_lat_us += lat_us;
+	ad->exit_cost_us = (ad->exit_cost_us * 7 + lat_us) / 8;
+	spin_unlock_irqrestore(hba->host->host_lock, flags);
 unblock_reqs:
 	ufshcd_scsi_unblock_requests(hba);
 }
@@ -2222,6 +2483,8 @@ int ufshcd_hold(struct ufs_hba *hba, bool async)
 		goto out;
 	spin_lock_irqsave(hba->host->host_lock, flags);
 	hba->clk_gating.active_reqs++;
+	if (hba->clk_gating.adaptive.idle_start)
+		ufshcd_clkgate_record_gap(hba);
 
 	if (ufshcd_eh_in_progress(hba)) {
 		spin_unlock_irqrestore(hba->host->host_lock, flags);
@@ -2420,7 +2683,7 @@ static void __ufshcd_release(struct ufs_hba *hba, bool no_sched)
 	hba->ufs_stats.clk_rel.ts = ktime_get();
 
 	hrtimer_start(&hba->clk_gating.gate_hrtimer,
-			ms_to_ktime(hba->clk_gating.delay_ms),
+			ms_to_ktime(ufshcd_clkgate_idle_delay(hba)),
 			HRTIMER_MODE_REL);
 }
 
@@ -2549,6 +2812,181 @@ static ssize_t ufshcd_clkgate_enable_store(struct device *dev,
 	return count;
 }
 
+static ssize_t ufshcd_clkgate_adaptive_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct ufs_hba *hba = dev_get_drvdata(dev);
+
+	return snprintf(buf, PAGE_SIZE, "%d\n",
+			hba->clk_gating.adaptive.enabled);
+}
+
+static ssize_t ufshcd_clkgate_adaptive_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct ufs_hba *hba = dev_get_drvdata(dev);
+	unsigned long flags;
+	u32 value;
+
+	if (kstrtou32(buf, 0, &value))
+		return -EINVAL;
+
+	spin_lock_irqsave(hba->host->host_lock, flags);
+	hba->clk_gating.adaptive.enabled = !!value;
+	spin_unlock_irqrestore(hba->host->host_lock, flags);
+	return count;
+}
+
+static ssize_t ufshcd_clkgate_adaptive_max_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct ufs_hba *hba = dev_get_drvdata(dev);
+
+	return snprintf(buf, PAGE_SIZE, "%lu\n",
+			hba->clk_gating.adaptive.max_ms);
+}
+
+static ssize_t ufshcd_clkgate_adaptive_max_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct ufs_hba *hba = dev_get_drvdata(dev);
+	struct ufs_clk_gate_adaptive *ad = &hba->clk_gating.adaptive;
+	unsigned long flags, value;
+	int i;
+
+	if (kstrtoul(buf, 0, &value) || !value)
+		return -EINVAL;
+
+	spin_lock_irqsave(hba->host->host_lock, flags);
+	ad->max_ms = value;
+	for (i = 0; i < UFS_GATE_NR_CLASSES; i++)
+		ufshcd_clkgate_pick_delay(hba, i);
+	spin_unlock_irqrestore(hba->host->host_lock, flags);
+	return count;
+}
+
+static ssize_t ufshcd_clkgate_adaptive_weight_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct ufs_hba *hba = dev_get_drvdata(dev);
+
+	return snprintf(buf, PAGE_SIZE, "%u\n",
+			hba->clk_gating.adaptive.weight_us);
+}
+
+static ssize_t ufshcd_clkgate_adaptive_weight_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct ufs_hba *hba = dev_get_drvdata(dev);
+	struct ufs_clk_gate_adaptive *ad = &hba->clk_gating.adaptive;
+	unsigned long flags;
+	u32 value;
+	int i;
+
+	if (kstrtou32(buf, 0, &value))
+		return -EINVAL;
+
+	spin_lock_irqsave(hba->host->host_lock, flags);
+	ad->weight_us = value;
+	for (i = 0; i < UFS_GATE_NR_CLASSES; i++)
+		ufshcd_clkgate_pick_delay(hba, i);
+	spin_unlock_irqrestore(hba->host->host_lock, flags);
+	return count;
+}
+
+/* Rates are over the time since the stats were last read */
+static ssize_t ufshcd_clkgate_adaptive_stats_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct ufs_hba *hba = dev_get_drvdata(dev);
+	struct ufs_clk_gate_adaptive *ad = &hba->clk_gating.adaptive;
+	u64 exits, lat_us, d_exits, d_lat_us;
+	unsigned long flags, delay_read, delay_write;
+	unsigned int cost_us;
+	s64 elapsed_ms;
+	ktime_t now = ktime_get();
+
+	spin_lock_irqsave(hba->host->host_lock, flags);
+	exits = ad->exits;
+	lat_us = ad->exit_lat_us;
+	cost_us = ad->exit_cost_us;
+	delay_read = ad->delay_ms[UFS_GATE_CLASS_READ];
+	delay_write = ad->delay_ms[UFS_GATE_CLASS_WRITE];
+	d_exits = exits - ad->last_exits;
+	d_lat_us = lat_us - ad->last_exit_lat_us;
+	elapsed_ms = ktime_ms_delta(now, ad->last_ts);
+	ad->last_ts = now;
+	ad->last_exits = exits;
+	ad->last_exit_lat_us = lat_us;
+	spin_unlock_irqrestore(hba->host->host_lock, flags);
+
+	if (elapsed_ms <= 0)
+		elapsed_ms = 1;
+
+	return snprintf(buf, PAGE_SIZE,
+			"exits: %llu\nexit_lat_us: %llu\nexit_cost_us: %u\n"
+			"exits_per_sec: %llu\nlat_us_per_sec: %llu\n"
+			"delay_ms_read: %lu\ndelay_ms_write: %lu\n",
+			exits, lat_us, cost_us,
+			div64_u64(d_exits * MSEC_PER_SEC, elapsed_ms),
+			div64_u64(d_lat_us * MSEC_PER_SEC, elapsed_ms),
+			delay_read, delay_write);
+}
+
+static void ufshcd_init_clk_gate_adaptive(struct ufs_hba *hba)
+{
+	struct ufs_clk_gate_adaptive *ad = &hba->clk_gating.adaptive;
+	int i;
+
+	ad->max_ms = UFSHCD_CLK_GATE_ADAPTIVE_MAX_MS;
+	ad->weight_us = UFSHCD_CLK_GATE_ADAPTIVE_WEIGHT_US;
+	ad->exit_cost_us = UFSHCD_CLK_GATE_EXIT_COST_US;
+	ad->last_ts = ktime_get();
+	for (i = 0; i < UFS_GATE_NR_CLASSES; i++)
+		ad->delay_ms[i] = hba->clk_gating.delay_ms;
+
+	ad->enable_attr.show = ufshcd_clkgate_adaptive_show;
+	ad->enable_attr.store = ufshcd_clkgate_adaptive_store;
+	sysfs_attr_init(&ad->enable_attr.attr);
+	ad->enable_attr.attr.name = "clkgate_adaptive";
+	ad->enable_attr.attr.mode = S_IRUGO | S_IWUSR;
+	if (device_create_file(hba->dev, &ad->enable_attr))
+		dev_err(hba->dev, "Failed to create sysfs for clkgate_adaptive\n");
+
+	ad->max_attr.show = ufshcd_clkgate_adaptive_max_show;
+	ad->max_attr.store = ufshcd_clkgate_adaptive_max_store;
+	sysfs_attr_init(&ad->max_attr.attr);
+	ad->max_attr.attr.name = "clkgate_adaptive_max_ms";
+	ad->max_attr.attr.mode = S_IRUGO | S_IWUSR;
+	if (device_create_file(hba->dev, &ad->max_attr))
+		dev_err(hba->dev, "Failed to create sysfs for clkgate_adaptive_max_ms\n");
+
+	ad->weight_attr.show = ufshcd_clkgate_adaptive_weight_show;
+	ad->weight_attr.store = ufshcd_clkgate_adaptive_weight_store;
+	sysfs_attr_init(&ad->weight_attr.attr);
+	ad->weight_attr.attr.name = "clkgate_adaptive_weight_us";
+	ad->weight_attr.attr.mode = S_IRUGO | S_IWUSR;
+	if (device_create_file(hba->dev, &ad->weight_attr))
+		dev_err(hba->dev, "Failed to create sysfs for clkgate_adaptive_weight_us\n");
+
+	ad->stats_attr.show = ufshcd_clkgate_adaptive_stats_show;
+	sysfs_attr_init(&ad->stats_attr.attr);
+	ad->stats_attr.attr.name = "clkgate_adaptive_stats";
+	ad->stats_attr.attr.mode = S_IRUGO;
+	if (device_create_file(hba->dev, &ad->stats_attr))
+		dev_err(hba->dev, "Failed to create sysfs for clkgate_adaptive_stats\n");
+}
+
+static void ufshcd_exit_clk_gate_adaptive(struct ufs_hba *hba)
+{
+	struct ufs_clk_gate_adaptive *ad = &hba->clk_gating.adaptive;
+
+	device_remove_file(hba->dev, &ad->enable_attr);
+	device_remove_file(hba->dev, &ad->max_attr);
+	device_remove_file(hba->dev, &ad->weight_attr);
+	device_remove_file(hba->dev, &ad->stats_attr);
+}
+
 static enum hrtimer_restart ufshcd_clkgate_hrtimer_handler(
 					struct hrtimer *timer)
 {
@@ -2637,6 +3075,8 @@ static void ufshcd_init_clk_gating(struct ufs_hba *hba)
 	gating->enable_attr.attr.mode = S_IRUGO | S_IWUSR;
 	if (device_create_file(hba->dev, &gating->enable_attr))
 		dev_err(hba->dev, "Failed to create sysfs for clkgate_enable\n");
+
+	ufshcd_init_clk_gate_adaptive(hba);
 }
 
 static void ufshcd_exit_clk_gating(struct ufs_hba *hba)
@@ -2651,6 +3091,7 @@ static void ufshcd_exit_clk_gating(struct ufs_hba *hba)
 		device_remove_file(hba->dev, &hba->clk_gating.delay_attr);
 	}
 	device_remove_file(hba->dev, &hba->clk_gating.enable_attr);
+	ufshcd_exit_clk_gate_adaptive(hba);
 	ufshcd_cancel_gate_work(hba);
 	cancel_work_sync(&hba->clk_gating.ungate_work);
 	destroy_workqueue(hba->clk_gating.clk_gating_workq);
@@ -3094,6 +3535,46 @@ static void ufshcd_release_all(struct ufs_hba *hba)
 	ufshcd_release(hba, false);
 }
 
+/* Must be called with host lock acquired */
+static void ufshcd_clk_scaling_update_lat(struct ufs_hba *hba,
+					  struct ufshcd_lrb *lrbp)
+{
+	struct ufs_clk_scaling *scaling = &hba->clk_scaling;
+	struct ufs_clk_scaling_stats *st;
+	struct request *rq = lrbp->cmd->request;
+	unsigned int sectors;
+	s64 lat_us;
+
+	if (!ufshcd_is_clkscaling_supported(hba) || !rq)
+		return;
+
+	sectors = blk_rq_sectors(rq);
+	if (!sectors)
+		return;
+
+	lat_us = ktime_us_delta(lrbp->complete_time_stamp,
+				lrbp->issue_time_stamp);
+	st = &scaling->stats[scaling->is_scaled_up];
+	scaling->win_sectors += sectors;
+
+	if (req_op(rq) == REQ_OP_READ) {
+		st->reads++;
+		st->read_lat_us += lat_us;
+		if (lat_us > st->read_lat_max_us)
+			st->read_lat_max_us = lat_us;
+		/* readahead isn't waited for by anyone yet */
+		if (!(rq->cmd_flags & REQ_RAHEAD)) {
+			scaling->win_reads++;
+			scaling->win_read_lat_us += lat_us;
+		}
+	} else if (op_is_write(req_op(rq))) {
+		st->writes++;
+		st->write_lat_us += lat_us;
+		if (!op_is_sync(rq->cmd_flags))
+			scaling->win_stream_sectors += sectors;
+	}
+}
+
 /* Must be called with host lock acquired */
 static void ufshcd_clk_scaling_start_busy(struct ufs_hba *hba)
 {
@@ -3104,6 +3585,8 @@ static void ufshcd_clk_scaling_start_busy(struct ufs_hba *hba)
 
 	if (!hba->clk_scaling.active_reqs++)
 		queue_resume_work = true;
+	if (hba->clk_scaling.active_reqs > hba->clk_scaling.win_max_qd)
+		hba->clk_scaling.win_max_qd = hba->clk_scaling.active_reqs;
 
 	if (!hba->clk_scaling.is_allowed || hba->pm_op_in_progress)
 		return;
@@ -4057,7 +4540,9 @@ static int ufshcd_queuecommand(struct Scsi_Host *host, struct scsi_cmnd *cmd)
 	lrbp->sense_buffer = cmd->sense_buffer;
 	lrbp->task_tag = tag;
 	lrbp->lun = ufshcd_scsi_to_upiu_lun(cmd->device->lun);
-	lrbp->intr_cmd = !ufshcd_is_intr_aggr_allowed(hba) ? true : false;
+	lrbp->intr_cmd = !ufshcd_is_intr_aggr_allowed(hba) ||
+		hweight_long(READ_ONCE(hba->outstanding_reqs)) <
+		hba->intr_aggr_bypass_qd;
 
 	err = ufshcd_prepare_lrbp_crypto(hba, cmd, lrbp);
 	if (err) {
@@ -4124,6 +4609,7 @@ static int ufshcd_queuecommand(struct Scsi_Host *host, struct scsi_cmnd *cmd)
 #endif
 #endif
 	ufshcd_vops_setup_xfer_req(hba, tag, (lrbp->cmd ? true : false));
+	ufshcd_clkgate_count_cmd(hba, cmd);
 
 	err = ufshcd_send_command(hba, tag);
 #ifdef  VENDOR_EDIT
@@ -6026,7 +6512,8 @@ static int ufshcd_make_hba_operational(struct ufs_hba *hba)
 
 	/* Configure interrupt aggregation */
 	if (ufshcd_is_intr_aggr_allowed(hba))
-		ufshcd_config_intr_aggr(hba, hba->nutrs - 1, INT_AGGR_DEF_TO);
+		ufshcd_config_intr_aggr(hba, hba->intr_aggr_cnt,
+					hba->intr_aggr_tmout);
 	else
 		ufshcd_disable_intr_aggr(hba);
 
@@ -6470,6 +6957,12 @@ static int ufshcd_slave_configure(struct scsi_device *sdev)
 	sdev->use_rpm_auto = 1;
 	ufshcd_crypto_setup_rq_keyslot_manager(hba, q);
 
+	/*
+	 * All completions come from the one UFS interrupt, run them on the
+	 * CPU that submitted the request rather than on its cache group.
+	 */
+	queue_flag_set_unlocked(QUEUE_FLAG_SAME_FORCE, q);
+
 	return 0;
 }
 
@@ -6812,6 +7305,7 @@ static void __ufshcd_transfer_req_compl(struct ufs_hba *hba,
 			clear_bit_unlock(index, &hba->lrb_in_use);
 			lrbp->complete_time_stamp = ktime_get();
 			update_req_stats(hba, lrbp);
+			ufshcd_clk_scaling_update_lat(hba, lrbp);
 			ufshcd_complete_lrbp_crypto(hba, cmd, lrbp);
 			/* Mark completed command as NULL in LRB */
 			lrbp->cmd = NULL;
@@ -6980,7 +7474,13 @@ static irqreturn_t ufshcd_transfer_req_compl(struct ufs_hba *hba)
 	completed_reqs = tr_doorbell ^ hba->outstanding_reqs;
 
 	if (completed_reqs) {
+		ktime_t start = ktime_get();
+
 		__ufshcd_transfer_req_compl(hba, completed_reqs);
+		hba->ufs_stats.tr_compl_irqs++;
+		hba->ufs_stats.tr_compl_reqs += hweight_long(completed_reqs);
+		hba->ufs_stats.tr_compl_ns +=
+			ktime_to_ns(ktime_sub(ktime_get(), start));
 		return IRQ_HANDLED;
 	} else {
 		return IRQ_NONE;
@@ -9356,7 +9856,7 @@ static int ufshcd_probe_hba(struct ufs_hba *hba)
 				&hba->pwr_info,
 				sizeof(struct ufs_pa_layer_attr));
 			hba->clk_scaling.saved_pwr_info.is_valid = true;
-			hba->clk_scaling.is_scaled_up = true;
+			ufshcd_clk_scaling_set_state(hba, true);
 			if (!hba->devfreq) {
 				ret = ufshcd_devfreq_init(hba);
 				if (ret)
@@ -11320,6 +11820,149 @@ static void ufshcd_add_spm_lvl_sysfs_nodes(struct ufs_hba *hba)
 		dev_err(hba->dev, "Failed to create sysfs for spm_lvl\n");
 }
 
+/*
+ * Reprogram the interrupt aggregation with the transfer requests drained,
+ * so that no request in flight was issued for the previous setting.
+ */
+static int ufshcd_update_intr_aggr(struct ufs_hba *hba, u8 cnt, u8 tmout)
+{
+	int ret;
+
+	pm_runtime_get_sync(hba->dev);
+	ufshcd_hold(hba, false);
+
+	ret = ufshcd_clock_scaling_prepare(hba);
+	if (ret)
+		goto out;
+
+	hba->intr_aggr_cnt = cnt;
+	hba->intr_aggr_tmout = tmout;
+	if (cnt) {
+		hba->caps |= UFSHCD_CAP_INTR_AGGR;
+		ufshcd_config_intr_aggr(hba, cnt, tmout);
+	} else {
+		hba->caps &= ~UFSHCD_CAP_INTR_AGGR;
+		ufshcd_disable_intr_aggr(hba);
+	}
+
+	ufshcd_clock_scaling_unprepare(hba);
+out:
+	ufshcd_release(hba, false);
+	pm_runtime_put_sync(hba->dev);
+	return ret;
+}
+
+static ssize_t ufshcd_intr_aggr_cnt_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct ufs_hba *hba = dev_get_drvdata(dev);
+
+	return snprintf(buf, PAGE_SIZE, "%u\n",
+			ufshcd_is_intr_aggr_allowed(hba) ?
+			hba->intr_aggr_cnt : 0);
+}
+
+static ssize_t ufshcd_intr_aggr_cnt_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct ufs_hba *hba = dev_get_drvdata(dev);
+	u32 value;
+	int err;
+
+	if (kstrtou32(buf, 0, &value))
+		return -EINVAL;
+
+	/* the counter threshold is a 5 bit field */
+	if (value >= hba->nutrs || value > 0x1F)
+		return -EINVAL;
+
+	if (value && (hba->quirks & UFSHCD_QUIRK_BROKEN_INTR_AGGR))
+		return -EOPNOTSUPP;
+
+	err = ufshcd_update_intr_aggr(hba, value, hba->intr_aggr_tmout);
+	return err ? err : count;
+}
+
+static ssize_t ufshcd_intr_aggr_tmout_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct ufs_hba *hba = dev_get_drvdata(dev);
+
+	return snprintf(buf, PAGE_SIZE, "%u\n",
+			hba->intr_aggr_tmout * INT_AGGR_TO_UNIT_US);
+}
+
+static ssize_t ufshcd_intr_aggr_tmout_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct ufs_hba *hba = dev_get_drvdata(dev);
+	u32 value;
+	int err;
+
+	if (kstrtou32(buf, 0, &value))
+		return -EINVAL;
+
+	value = DIV_ROUND_UP(value, INT_AGGR_TO_UNIT_US);
+	if (!value || value > INT_AGGR_TIMEOUT_VAL_MASK)
+		return -EINVAL;
+
+	if (!ufshcd_is_intr_aggr_allowed(hba)) {
+		hba->intr_aggr_tmout = value;
+		return count;
+	}
+
+	err = ufshcd_update_intr_aggr(hba, hba->intr_aggr_cnt, value);
+	return err ? err : count;
+}
+
+static ssize_t ufshcd_intr_aggr_bypass_qd_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct ufs_hba *hba = dev_get_drvdata(dev);
+
+	return snprintf(buf, PAGE_SIZE, "%d\n", hba->intr_aggr_bypass_qd);
+}
+
+static ssize_t ufshcd_intr_aggr_bypass_qd_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct ufs_hba *hba = dev_get_drvdata(dev);
+	u32 value;
+
+	if (kstrtou32(buf, 0, &value) || value > hba->nutrs)
+		return -EINVAL;
+
+	WRITE_ONCE(hba->intr_aggr_bypass_qd, value);
+	return count;
+}
+
+static void ufshcd_add_intr_aggr_sysfs_nodes(struct ufs_hba *hba)
+{
+	hba->intr_aggr_cnt_attr.show = ufshcd_intr_aggr_cnt_show;
+	hba->intr_aggr_cnt_attr.store = ufshcd_intr_aggr_cnt_store;
+	sysfs_attr_init(&hba->intr_aggr_cnt_attr.attr);
+	hba->intr_aggr_cnt_attr.attr.name = "intr_aggr_cnt";
+	hba->intr_aggr_cnt_attr.attr.mode = 0644;
+	if (device_create_file(hba->dev, &hba->intr_aggr_cnt_attr))
+		dev_err(hba->dev, "Failed to create sysfs for intr_aggr_cnt\n");
+
+	hba->intr_aggr_tmout_attr.show = ufshcd_intr_aggr_tmout_show;
+	hba->intr_aggr_tmout_attr.store = ufshcd_intr_aggr_tmout_store;
+	sysfs_attr_init(&hba->intr_aggr_tmout_attr.attr);
+	hba->intr_aggr_tmout_attr.attr.name = "intr_aggr_timeout_us";
+	hba->intr_aggr_tmout_attr.attr.mode = 0644;
+	if (device_create_file(hba->dev, &hba->intr_aggr_tmout_attr))
+		dev_err(hba->dev, "Failed to create sysfs for intr_aggr_timeout_us\n");
+
+	hba->intr_aggr_bypass_qd_attr.show = ufshcd_intr_aggr_bypass_qd_show;
+	hba->intr_aggr_bypass_qd_attr.store = ufshcd_intr_aggr_bypass_qd_store;
+	sysfs_attr_init(&hba->intr_aggr_bypass_qd_attr.attr);
+	hba->intr_aggr_bypass_qd_attr.attr.name = "intr_aggr_bypass_qd";
+	hba->intr_aggr_bypass_qd_attr.attr.mode = 0644;
+	if (device_create_file(hba->dev, &hba->intr_aggr_bypass_qd_attr))
+		dev_err(hba->dev, "Failed to create sysfs for intr_aggr_bypass_qd\n");
+}
+
 static ssize_t ufs_sysfs_read_desc_param(struct ufs_hba *hba,
 				  enum desc_idn desc_id,
 				  u8 desc_index,
@@ -11417,6 +12060,7 @@ static inline void ufshcd_add_sysfs_nodes(struct ufs_hba *hba)
 {
 	ufshcd_add_rpm_lvl_sysfs_nodes(hba);
 	ufshcd_add_spm_lvl_sysfs_nodes(hba);
+	ufshcd_add_intr_aggr_sysfs_nodes(hba);
 	ufshcd_add_desc_sysfs_nodes(hba->dev);
 }
 
@@ -11424,6 +12068,9 @@ static inline void ufshcd_remove_sysfs_nodes(struct ufs_hba *hba)
 {
 	device_remove_file(hba->dev, &hba->rpm_lvl_attr);
 	device_remove_file(hba->dev, &hba->spm_lvl_attr);
+	device_remove_file(hba->dev, &hba->intr_aggr_cnt_attr);
+	device_remove_file(hba->dev, &hba->intr_aggr_tmout_attr);
+	device_remove_file(hba->dev, &hba->intr_aggr_bypass_qd_attr);
 	ufshcd_remove_desc_sysfs_nodes(hba->dev);
 }
 
@@ -11463,6 +12110,8 @@ static void ufshcd_shutdown_clkscaling(struct ufs_hba *hba)
 		return;
 	__ufshcd_shutdown_clkscaling(hba);
 	device_remove_file(hba->dev, &hba->clk_scaling.enable_attr);
+	device_remove_file(hba->dev, &hba->clk_scaling.lat_target_attr);
+	device_remove_file(hba->dev, &hba->clk_scaling.qd_threshold_attr);
 }
 
 /**
@@ -11717,6 +12366,10 @@ int ufshcd_init(struct ufs_hba *hba, void __iomem *mmio_base, unsigned int irq)
 	/* Get Interrupt bit mask per version */
 	hba->intr_mask = ufshcd_get_intr_mask(hba);
 
+	hba->intr_aggr_cnt = hba->nutrs - 1;
+	hba->intr_aggr_tmout = INT_AGGR_DEF_TO;
+	hba->intr_aggr_bypass_qd = INT_AGGR_DEF_BYPASS_QD;
+
 	/* Enable debug prints */
 	hba->ufshcd_dbg_print = DEFAULT_UFSHCD_DBG_PRINT_EN;
 
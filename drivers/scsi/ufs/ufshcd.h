@@ -447,6 +447,64 @@ enum clk_gating_state {
 	REQ_CLKS_ON,
 };
 
+/* idle gaps of <1ms, [1, 2)ms, [2, 4)ms, ... and >= 1024ms */
+#define UFS_GATE_GAP_BUCKETS	12
+
+/* class of the burst of commands that preceded an idle gap */
+enum ufs_gate_class {
+	UFS_GATE_CLASS_READ,
+	UFS_GATE_CLASS_WRITE,
+	UFS_GATE_NR_CLASSES,
+};
+
+/**
+ * struct ufs_clk_gate_adaptive - adaptive clock gating delay
+ * @enabled: gate after the delay picked from the learnt idle gaps rather
+ * than after delay_ms
+ * @max_ms: longest delay that may be picked
+ * @weight_us: exit latency, in us, that is worth keeping the clocks on
+ * for 1ms more
+ * @exit_cost_us: average time an ungate took lately
+ * @gaps: decayed histogram of idle gaps for each burst class
+ * @nr_gaps: gaps recorded for each class since its delay was last picked
+ * @delay_ms: delay picked for each class
+ * @burst_reads: read commands issued in the current burst
+ * @burst_writes: other commands issued in the current burst
+ * @idle_class: class of the burst that preceded the current idle gap
+ * @idle_start: start of the current idle gap, 0 while busy
+ * @exits: number of ungates
+ * @exit_lat_us: total time the ungates took
+ * @last_ts: time the stats were last read, for the per second rates
+ * @last_exits: @exits when the stats were last read
+ * @last_exit_lat_us: @exit_lat_us when the stats were last read
+ * @enable_attr: sysfs attribute to enable/disable the adaptive delay
+ * @max_attr: sysfs attribute to control max_ms
+ * @weight_attr: sysfs attribute to control weight_us
+ * @stats_attr: sysfs attribute to read the exit stats and picked delays
+ */
+struct ufs_clk_gate_adaptive {
+	bool enabled;
+	unsigned long max_ms;
+	unsigned int weight_us;
+	unsigned int exit_cost_us;
+	u32 gaps[UFS_GATE_NR_CLASSES][UFS_GATE_GAP_BUCKETS];
+	unsigned int nr_gaps[UFS_GATE_NR_CLASSES];
+	unsigned long delay_ms[UFS_GATE_NR_CLASSES];
+	unsigned int burst_reads;
+	unsigned int burst_writes;
+	enum ufs_gate_class idle_class;
+	ktime_t idle_start;
+	u64 exits;
+	u64 exit_lat_us;
+	ktime_t last_ts;
+	u64 last_exits;
+	u64 last_exit_lat_us;
+	struct device_attribute enable_attr;
+	struct device_attribute max_attr;
+	struct device_attribute weight_attr;
+	struct device_attribute stats_attr;
+};
+
 /**
  * struct ufs_clk_gating - UFS clock gating related info
  * @gate_hrtimer: hrtimer to invoke @gate_work after some delay as
@@ -467,6 +525,7 @@ enum clk_gating_state {
  * @is_enabled: Indicates the current status of clock gating
  * @active_reqs: number of requests that are pending and should be waited for
  * completion before gating clocks.
+ * @adaptive: adaptive gating delay related data
  */
 struct ufs_clk_gating {
 	struct hrtimer gate_hrtimer;
@@ -484,6 +543,7 @@ struct ufs_clk_gating {
 	bool is_enabled;
 	int active_reqs;
 	struct workqueue_struct *clk_gating_workq;
+	struct ufs_clk_gate_adaptive adaptive;
 };
 
 struct ufs_saved_pwr_info {
@@ -529,6 +589,28 @@ struct ufs_hibern8_on_idle {
 	struct mutex enable_mutex;
 };
 
+/**
+ * struct ufs_clk_scaling_stats - statistics for one clock scaling state
+ * @gear: RX gear in use the last time the state was entered
+ * @entries: number of times the state was entered
+ * @residency_us: time spent in the state, up to the last state change
+ * @reads: number of read requests completed in the state
+ * @read_lat_us: total latency of those reads
+ * @read_lat_max_us: worst latency of those reads
+ * @writes: number of write requests completed in the state
+ * @write_lat_us: total latency of those writes
+ */
+struct ufs_clk_scaling_stats {
+	u32 gear;
+	u64 entries;
+	u64 residency_us;
+	u64 reads;
+	u64 read_lat_us;
+	u64 read_lat_max_us;
+	u64 writes;
+	u64 write_lat_us;
+};
+
 /**
  * struct ufs_clk_scaling - UFS clock scaling related data
  * @active_reqs: number of requests that are pending. If this is zero when
@@ -547,6 +629,21 @@ struct ufs_hibern8_on_idle {
  * @is_busy_started: tracks if busy period has started or not
  * @is_suspended: tracks if devfreq is suspended or not
  * @is_scaled_up: tracks if we are currently scaled up or scaled down
+ * @lat_target_us: scale up when foreground reads of the polling window took
+ * longer than this on average, 0 to scale from the busy time only
+ * @qd_threshold: with @lat_target_us, also scale up when that many requests
+ * were pending at once in the polling window
+ * @win_reads: foreground reads completed in the current polling window
+ * @win_read_lat_us: total latency of those reads
+ * @win_sectors: sectors transferred in the current polling window
+ * @win_stream_sectors: of those, sectors written by async writes
+ * @win_max_qd: most requests pending at once in the current polling window
+ * @nr_lat_up: windows reported busy because a latency target was missed
+ * @nr_stream_down: windows reported idle because of streaming writes
+ * @state_ts: time the current scaling state was entered
+ * @stats: statistics of the scaled down ([0]) and scaled up ([1]) states
+ * @lat_target_attr: sysfs attribute to control @lat_target_us
+ * @qd_threshold_attr: sysfs attribute to control @qd_threshold
  */
 struct ufs_clk_scaling {
 	int active_reqs;
@@ -562,6 +659,19 @@ struct ufs_clk_scaling {
 	bool is_busy_started;
 	bool is_suspended;
 	bool is_scaled_up;
+	u32 lat_target_us;
+	u32 qd_threshold;
+	unsigned int win_reads;
+	u64 win_read_lat_us;
+	u64 win_sectors;
+	u64 win_stream_sectors;
+	int win_max_qd;
+	u64 nr_lat_up;
+	u64 nr_stream_down;
+	ktime_t state_ts;
+	struct ufs_clk_scaling_stats stats[2];
+	struct device_attribute lat_target_attr;
+	struct device_attribute qd_threshold_attr;
 };
 
 #define UIC_ERR_REG_HIST_LENGTH 20
@@ -592,6 +702,9 @@ struct debugfs_files {
 	struct dentry *dbg_print_en;
 	struct dentry *req_stats;
 	struct dentry *query_stats;
+#ifdef CONFIG_SCSI_UFS_CRYPTO
+	struct dentry *crypto_stats;
+#endif
 	u32 dme_local_attr_id;
 	u32 dme_peer_attr_id;
 	struct dentry *reset_controller;
@@ -694,6 +807,10 @@ struct ufs_stats {
 	u32 dl_err_cnt_total;
 	u32 dl_err_cnt[UFS_EC_DL_MAX];
 	u32 dme_err_cnt;
+	/* transfer completion interrupts, the requests and time they took */
+	u64 tr_compl_irqs;
+	u64 tr_compl_reqs;
+	u64 tr_compl_ns;
 };
 
 /* UFS Host Controller debug print bitmask */
@@ -851,6 +968,14 @@ struct ufs_hba {
 	int spm_lvl;
 	struct device_attribute rpm_lvl_attr;
 	struct device_attribute spm_lvl_attr;
+	/* Interrupt aggregation counter threshold and timeout (40us units) */
+	u8 intr_aggr_cnt;
+	u8 intr_aggr_tmout;
+	/* Requests issued below this queue depth bypass the aggregation */
+	int intr_aggr_bypass_qd;
+	struct device_attribute intr_aggr_cnt_attr;
+	struct device_attribute intr_aggr_tmout_attr;
+	struct device_attribute intr_aggr_bypass_qd_attr;
 	int pm_op_in_progress;
 
 	struct ufshcd_lrb *lrb;
@@ -333,6 +333,8 @@ enum {
 
 #define INT_AGGR_COUNTER_THLD_VAL(c)	(((c) & 0x1F) << 8)
 #define INT_AGGR_TIMEOUT_VAL(t)		(((t) & 0xFF) << 0)
+/* Interrupt aggregation timeout unit */
+#define INT_AGGR_TO_UNIT_US		40
 
 /* Interrupt disable masks */
 enum {
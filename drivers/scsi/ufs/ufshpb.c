@@ -51,11 +51,19 @@ static int bits_per_byte_shift;
 static int ufshpb_create_sysfs(struct ufsf_feature *ufsf,
 			       struct ufshpb_lu *hpb);
 static int ufshpb_remove_sysfs(struct ufshpb_lu *hpb);
+static void ufshpb_hit_lru_info(struct victim_select_info *lru_info,
+				struct ufshpb_region *rgn);
+static void ufshpb_host_read_miss(struct ufshpb_lu *hpb,
+				  struct ufshpb_subregion *srgn,
+				  bool activate);
 
 /* huangjianan@TECH.Storage.UFS, 2019/12/09, Add for UFS+ RUS */
 static int create_hpbfn_enable_proc(void);
 static void remove_hpbfn_enable_proc(void);
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/ufshpb.h>
+
 static inline void
 ufshpb_get_pos_from_lpn(struct ufshpb_lu *hpb, unsigned long lpn, int *rgn_idx,
 			int *srgn_idx, int *offset)
@@ -118,6 +126,20 @@ static bool ufshpb_ppn_dirty_check(struct ufshpb_lu *hpb, unsigned long lpn,
 	return false;
 }
 
+/*
+ * Must be held hpb_lock. Returns true when @srgn just became hot enough
+ * for the host to load its map without waiting for a device hint.
+ */
+static bool ufshpb_host_heat_srgn(struct ufshpb_lu *hpb,
+				  struct ufshpb_subregion *srgn)
+{
+	if (srgn->heat < HPB_HOST_HEAT_MAX)
+		srgn->heat++;
+
+	return srgn->heat == hpb->host_act_threshold &&
+		srgn->srgn_state != HPBSUBREGION_ISSUED;
+}
+
 static void ufshpb_set_read16_cmd(struct ufshpb_lu *hpb,
 				  struct ufshcd_lrb *lrbp,
 				  unsigned long long ppn,
@@ -800,7 +822,7 @@ void ufshpb_prep_fn(struct ufsf_feature *ufsf, struct ufshcd_lrb *lrbp)
 	unsigned long lpn, flags;
 	int transfer_len = TRANSFER_LEN;
 	int rgn_idx, srgn_idx, srgn_offset, ret, error = 0;
-	bool span_flag = false;
+	bool span_flag = false, activate = false;
 
 	/* WKLU could not be HPB-LU */
 	if (!lrbp || !ufsf_is_valid_lun(lrbp->lun))
@@ -855,6 +877,8 @@ void ufshpb_prep_fn(struct ufsf_feature *ufsf, struct ufshcd_lrb *lrbp)
 	if (!ufshpb_is_read_cmd(lrbp->cmd))
 		goto put_hpb;
 
+	hpb->last_read_jiffies = jiffies;
+
 	if (ufshpb_is_unaligned(rq)) {
 		TMSG_CMD(hpb, "READ_10 not aligned 4KB", rq, rgn_idx, srgn_idx);
 		goto put_hpb;
@@ -875,10 +899,19 @@ void ufshpb_prep_fn(struct ufsf_feature *ufsf, struct ufshcd_lrb *lrbp)
 		atomic64_inc(&hpb->miss);
 		ufsf_para.miss++;
 		TMSG_CMD(hpb, "READ_10 E_D", rq, rgn_idx, srgn_idx);
+		if (hpb->host_control)
+			activate = ufshpb_host_heat_srgn(hpb, srgn);
 		spin_unlock_irqrestore(&hpb->hpb_lock, flags);
+
+		if (hpb->host_control)
+			ufshpb_host_read_miss(hpb, srgn, activate);
 		goto put_hpb;
 	}
 
+	/* keep the LRU ordered by reads, not only by device hints */
+	if (hpb->host_control && rgn->rgn_state == HPBREGION_ACTIVE)
+		ufshpb_hit_lru_info(&hpb->lru_info, rgn);
+
 	ppn = ufshpb_get_ppn(srgn->mctx, srgn_offset, &error);
 	spin_unlock_irqrestore(&hpb->hpb_lock, flags);
 	if (error) {
@@ -1018,19 +1051,22 @@ static void ufshpb_map_compl_process(struct ufshpb_req *map_req)
 	struct ufshpb_lu *hpb = map_req->hpb;
 	struct ufshpb_subregion *srgn;
 	unsigned long flags;
+	int i;
 
 	srgn = hpb->rgn_tbl[map_req->rb.rgn_idx].srgn_tbl +
 		map_req->rb.srgn_idx;
 
 	if (hpb->debug)
-		ufshpb_check_ppn(hpb, srgn->rgn_idx, srgn->srgn_idx, srgn->mctx,
-				 "COMPL");
+		for (i = 0; i < map_req->rb.srgn_cnt; i++)
+			ufshpb_check_ppn(hpb, srgn[i].rgn_idx, srgn[i].srgn_idx,
+					 srgn[i].mctx, "COMPL");
 
-	TMSG(hpb->ufsf, hpb->lun, "Noti: C RB %d - %d", map_req->rb.rgn_idx,
-	     map_req->rb.srgn_idx);
+	TMSG(hpb->ufsf, hpb->lun, "Noti: C RB %d - %d (%u)",
+	     map_req->rb.rgn_idx, map_req->rb.srgn_idx, map_req->rb.srgn_cnt);
 
 	spin_lock_irqsave(&hpb->hpb_lock, flags);
-	ufshpb_clean_active_subregion(hpb, srgn);
+	for (i = 0; i < map_req->rb.srgn_cnt; i++)
+		ufshpb_clean_active_subregion(hpb, srgn + i);
 	spin_unlock_irqrestore(&hpb->hpb_lock, flags);
 }
 
@@ -1074,6 +1110,7 @@ static int ufshpb_map_req_error(struct ufshpb_req *map_req)
 	struct ufshpb_subregion *srgn;
 	struct scsi_sense_hdr sshdr;
 	unsigned long flags;
+	int i;
 
 	rgn = hpb->rgn_tbl + map_req->rb.rgn_idx;
 	srgn = rgn->srgn_tbl + map_req->rb.srgn_idx;
@@ -1105,10 +1142,12 @@ static int ufshpb_map_req_error(struct ufshpb_req *map_req)
 		HPB_DEBUG(hpb, "pinned rb %d - %d(dirty)",
 			  map_req->rb.rgn_idx, map_req->rb.srgn_idx);
 
-		ufshpb_error_active_subregion(hpb, srgn);
+		for (i = 0; i < map_req->rb.srgn_cnt; i++)
+			ufshpb_error_active_subregion(hpb, srgn + i);
 		spin_unlock_irqrestore(&hpb->hpb_lock, flags);
 	} else {
-		ufshpb_error_active_subregion(hpb, srgn);
+		for (i = 0; i < map_req->rb.srgn_cnt; i++)
+			ufshpb_error_active_subregion(hpb, srgn + i);
 
 		spin_unlock_irqrestore(&hpb->hpb_lock, flags);
 
@@ -1142,6 +1181,12 @@ static void ufshpb_map_req_compl_fn(struct request *req, blk_status_t error)
 #ifdef CONFIG_PM
 	ufshpb_mimic_blk_pm_put_request(req);
 #endif
+	trace_ufshpb_map_req_compl(hpb->lun, map_req->rb.rgn_idx,
+				   map_req->rb.srgn_idx, map_req->rb.srgn_cnt,
+				   ktime_us_delta(ktime_get(),
+						  map_req->rb.issue_time),
+				   blk_status_to_errno(error));
+
 	if (hpb->ufsf->ufshpb_state != HPB_PRESENT)
 		goto free_map_req;
 
@@ -1258,15 +1303,14 @@ static inline void ufshpb_set_read_buf_cmd(unsigned char *cdb, int rgn_idx,
 	cdb[9] = 0x00;
 }
 
-static int ufshpb_map_req_add_bio_page(struct ufshpb_lu *hpb,
-				       struct request_queue *q, struct bio *bio,
-				       struct ufshpb_map_ctx *mctx)
+static int __ufshpb_map_req_add_bio_page(struct ufshpb_lu *hpb,
+					 struct request_queue *q,
+					 struct bio *bio,
+					 struct ufshpb_map_ctx *mctx)
 {
 	struct page *page = NULL;
 	int i, ret = 0;
 
-	bio_reset(bio);
-
 	for (i = 0; i < hpb->mpages_per_srgn; i++) {
 		/* virt_to_page(p + (OS_PAGE_SIZE * i)); */
 		page = mctx->m_page[i];
@@ -1284,6 +1328,46 @@ static int ufshpb_map_req_add_bio_page(struct ufshpb_lu *hpb,
 	return 0;
 }
 
+static inline int ufshpb_map_req_add_bio_page(struct ufshpb_lu *hpb,
+					      struct request_queue *q,
+					      struct bio *bio,
+					      struct ufshpb_map_ctx *mctx)
+{
+	bio_reset(bio);
+
+	return __ufshpb_map_req_add_bio_page(hpb, q, bio, mctx);
+}
+
+/*
+ * A batched map_req covers rb.srgn_cnt adjacent subregions of one region,
+ * the device returns their entries back to back.
+ */
+static int ufshpb_map_req_add_batch_page(struct ufshpb_lu *hpb,
+					 struct request_queue *q,
+					 struct ufshpb_req *map_req)
+{
+	struct ufshpb_subregion *srgn;
+	int i, ret;
+
+	if (map_req->rb.srgn_cnt == 1)
+		return ufshpb_map_req_add_bio_page(hpb, q, map_req->bio,
+						   map_req->rb.mctx);
+
+	srgn = hpb->rgn_tbl[map_req->rb.rgn_idx].srgn_tbl +
+		map_req->rb.srgn_idx;
+
+	bio_reset(map_req->bio);
+
+	for (i = 0; i < map_req->rb.srgn_cnt; i++) {
+		ret = __ufshpb_map_req_add_bio_page(hpb, q, map_req->bio,
+						    srgn[i].mctx);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
 static int ufshpb_execute_map_req(struct ufshpb_lu *hpb,
 				  struct scsi_device *sdev,
 				  struct ufshpb_req *map_req)
@@ -1295,7 +1379,7 @@ static int ufshpb_execute_map_req(struct ufshpb_lu *hpb,
 	struct bio *bio = map_req->bio;
 	int ret;
 
-	ret = ufshpb_map_req_add_bio_page(hpb, q, bio, map_req->rb.mctx);
+	ret = ufshpb_map_req_add_batch_page(hpb, q, map_req);
 	if (ret)
 		return ret;
 
@@ -1324,19 +1408,29 @@ static int ufshpb_execute_map_req(struct ufshpb_lu *hpb,
 	/* 2. scsi_request setup */
 	rq = scsi_req(req);
 	ufshpb_set_read_buf_cmd(rq->cmd, map_req->rb.rgn_idx,
-				map_req->rb.srgn_idx, hpb->srgn_mem_size);
+				map_req->rb.srgn_idx,
+				hpb->srgn_mem_size * map_req->rb.srgn_cnt);
 	rq->cmd_len = scsi_command_size(rq->cmd);
 
 	if (hpb->debug)
 		ufshpb_check_ppn(hpb, map_req->rb.rgn_idx, map_req->rb.srgn_idx,
 				 map_req->rb.mctx, "ISSUE");
 
-	TMSG(hpb->ufsf, hpb->lun, "Noti: I RB %d - %d", map_req->rb.rgn_idx,
-	     map_req->rb.srgn_idx);
+	TMSG(hpb->ufsf, hpb->lun, "Noti: I RB %d - %d (%u)",
+	     map_req->rb.rgn_idx, map_req->rb.srgn_idx, map_req->rb.srgn_cnt);
 
-	blk_execute_rq_nowait(q, NULL, req, 1, ufshpb_map_req_compl_fn);
+	map_req->rb.issue_time = ktime_get();
+
+	/*
+	 * A single subregion is usually what the next read waits for, so it
+	 * goes to the head. Batches are refills and queue behind user I/O.
+	 */
+	blk_execute_rq_nowait(q, NULL, req, map_req->rb.srgn_cnt == 1,
+			      ufshpb_map_req_compl_fn);
 
 	atomic64_inc(&hpb->map_req_cnt);
+	if (map_req->rb.srgn_cnt > 1)
+		atomic64_add(map_req->rb.srgn_cnt, &hpb->map_req_batch_cnt);
 	ufsf_para.map_req++;
 
 	return 0;
@@ -1367,12 +1461,14 @@ static int ufshpb_issue_map_req(struct ufshpb_lu *hpb,
 }
 
 static inline void ufshpb_set_map_req(struct ufshpb_lu *hpb, int rgn_idx,
-				      int srgn_idx, struct ufshpb_map_ctx *mctx,
+				      int srgn_idx, int srgn_cnt,
+				      struct ufshpb_map_ctx *mctx,
 				      struct ufshpb_req *map_req)
 {
 	map_req->hpb = hpb;
 	map_req->rb.rgn_idx = rgn_idx;
 	map_req->rb.srgn_idx = srgn_idx;
+	map_req->rb.srgn_cnt = srgn_cnt;
 	map_req->rb.mctx = mctx;
 	map_req->rb.lun = hpb->lun;
 }
@@ -1575,18 +1671,21 @@ ufshpb_rsp_field *ufshpb_get_hpb_rsp(struct ufshcd_lrb *lrbp)
 	return (struct ufshpb_rsp_field *)&lrbp->ucd_rsp_ptr->sr.sense_data_len;
 }
 
+/* @srgn is the first of @srgn_cnt adjacent subregions in one region */
 static int ufshpb_prepare_map_req(struct ufshpb_lu *hpb,
-				  struct ufshpb_subregion *srgn)
+				  struct ufshpb_subregion *srgn, int srgn_cnt)
 {
 	struct ufshpb_req *map_req;
 	unsigned long flags;
-	int ret = 0;
+	int i, ret = 0;
 
 	spin_lock_irqsave(&hpb->hpb_lock, flags);
 
-	if (srgn->srgn_state == HPBSUBREGION_ISSUED) {
-		ret = -EAGAIN;
-		goto unlock_out;
+	for (i = 0; i < srgn_cnt; i++) {
+		if (srgn[i].srgn_state == HPBSUBREGION_ISSUED) {
+			ret = -EAGAIN;
+			goto unlock_out;
+		}
 	}
 
 	map_req = ufshpb_get_map_req(hpb);
@@ -1595,16 +1694,18 @@ static int ufshpb_prepare_map_req(struct ufshpb_lu *hpb,
 		goto unlock_out;
 	}
 
-	srgn->srgn_state = HPBSUBREGION_ISSUED;
+	for (i = 0; i < srgn_cnt; i++) {
+		srgn[i].srgn_state = HPBSUBREGION_ISSUED;
 
-	ret = ufshpb_clean_dirty_bitmap(hpb, srgn);
-	if (ret) {
-		ufshpb_put_map_req(hpb, map_req);
-		goto unlock_out;
+		ret = ufshpb_clean_dirty_bitmap(hpb, srgn + i);
+		if (ret) {
+			ufshpb_put_map_req(hpb, map_req);
+			goto unlock_out;
+		}
 	}
 	spin_unlock_irqrestore(&hpb->hpb_lock, flags);
 
-	ufshpb_set_map_req(hpb, srgn->rgn_idx, srgn->srgn_idx,
+	ufshpb_set_map_req(hpb, srgn->rgn_idx, srgn->srgn_idx, srgn_cnt,
 			   srgn->mctx, map_req);
 
 	ret = ufshpb_lu_get(hpb);
@@ -1617,8 +1718,8 @@ static int ufshpb_prepare_map_req(struct ufshpb_lu *hpb,
 
 	ret = ufshpb_issue_map_req(hpb, map_req);
 	if (ret) {
-		ERR_MSG("issue map_req failed. [%d-%d] err %d",
-			srgn->rgn_idx, srgn->srgn_idx, ret);
+		ERR_MSG("issue map_req failed. [%d-%d] cnt %d err %d",
+			srgn->rgn_idx, srgn->srgn_idx, srgn_cnt, ret);
 		ufshpb_lu_put(hpb);
 		goto wakeup_ee_worker;
 	}
@@ -1652,7 +1753,7 @@ static int ufshpb_load_region(struct ufshpb_lu *hpb, struct ufshpb_region *rgn)
 
 	if (rgn->rgn_state == HPBREGION_INACTIVE) {
 		if (atomic64_read(&lru_info->active_cnt)
-		    == lru_info->max_lru_active_cnt) {
+		    >= lru_info->max_lru_active_cnt) {
 			victim_rgn = ufshpb_victim_lru_info(hpb);
 			if (!victim_rgn) {
 				HPB_DEBUG(hpb, "UFSHPB victim_rgn is NULL");
@@ -1666,6 +1767,7 @@ static int ufshpb_load_region(struct ufshpb_lu *hpb, struct ufshpb_region *rgn)
 				  victim_rgn->rgn_idx);
 
 			__ufshpb_evict_region(hpb, victim_rgn);
+			atomic64_inc(&hpb->lru_evict_cnt);
 		}
 
 		ret = ufshpb_add_region(hpb, rgn);
@@ -2107,12 +2209,76 @@ static void ufshpb_add_active_list(struct ufshpb_lu *hpb,
 	list_add(&srgn->list_act_srgn, &hpb->lh_act_srgn);
 }
 
+/*
+ * Must be held rsp_list_lock. Host initiated loads queue behind the
+ * device hints, and an inactivation hint from the device wins.
+ */
+static void ufshpb_host_add_active_list(struct ufshpb_lu *hpb,
+					struct ufshpb_subregion *srgn)
+{
+	struct ufshpb_region *rgn = hpb->rgn_tbl + srgn->rgn_idx;
+
+	if (!list_empty(&rgn->list_inact_rgn))
+		return;
+
+	if (list_empty(&srgn->list_act_srgn))
+		list_add_tail(&srgn->list_act_srgn, &hpb->lh_act_srgn);
+}
+
+static inline void ufshpb_host_schedule_heat_work(struct ufshpb_lu *hpb)
+{
+	if (!delayed_work_pending(&hpb->ufshpb_heat_work))
+		schedule_delayed_work(&hpb->ufshpb_heat_work,
+				      msecs_to_jiffies(HPB_HOST_HEAT_PERIOD_MS));
+}
+
+static void ufshpb_host_read_miss(struct ufshpb_lu *hpb,
+				  struct ufshpb_subregion *srgn,
+				  bool activate)
+{
+	unsigned long flags;
+
+	if (activate) {
+		spin_lock_irqsave(&hpb->rsp_list_lock, flags);
+		ufshpb_host_add_active_list(hpb, srgn);
+		spin_unlock_irqrestore(&hpb->rsp_list_lock, flags);
+
+		TMSG(hpb->ufsf, hpb->lun, "Noti: HOST ACT %d - %d",
+		     srgn->rgn_idx, srgn->srgn_idx);
+		atomic64_inc(&hpb->host_act_cnt);
+		schedule_work(&hpb->ufshpb_task_workq);
+	}
+
+	ufshpb_host_schedule_heat_work(hpb);
+}
+
+/*
+ * Must be held rsp_list_lock. Pull the queued subregions that follow @srgn
+ * in its region off the active list, so one READ_BUFFER loads them all.
+ * Returns the number of subregions in the batch, @srgn included.
+ */
+static int ufshpb_gather_active_batch(struct ufshpb_lu *hpb,
+				      struct ufshpb_region *rgn,
+				      struct ufshpb_subregion *srgn)
+{
+	int srgn_cnt = 1;
+
+	while (srgn_cnt < hpb->map_req_batch &&
+	       srgn->srgn_idx + srgn_cnt < rgn->srgn_cnt &&
+	       !list_empty(&srgn[srgn_cnt].list_act_srgn)) {
+		list_del_init(&srgn[srgn_cnt].list_act_srgn);
+		srgn_cnt++;
+	}
+
+	return srgn_cnt;
+}
+
 static void ufshpb_run_active_subregion_list(struct ufshpb_lu *hpb)
 {
 	struct ufshpb_region *rgn;
 	struct ufshpb_subregion *srgn;
 	unsigned long flags;
-	int ret = 0;
+	int i, srgn_cnt = 1, ret = 0;
 
 	spin_lock_irqsave(&hpb->rsp_list_lock, flags);
 	while ((srgn = list_first_entry_or_null(&hpb->lh_act_srgn,
@@ -2125,15 +2291,16 @@ static void ufshpb_run_active_subregion_list(struct ufshpb_lu *hpb)
 			continue;
 		}
 
-		spin_unlock_irqrestore(&hpb->rsp_list_lock, flags);
-
 		rgn = hpb->rgn_tbl + srgn->rgn_idx;
+		srgn_cnt = ufshpb_gather_active_batch(hpb, rgn, srgn);
+
+		spin_unlock_irqrestore(&hpb->rsp_list_lock, flags);
 
 		ret = ufshpb_load_region(hpb, rgn);
 		if (ret)
 			break;
 
-		ret = ufshpb_prepare_map_req(hpb, srgn);
+		ret = ufshpb_prepare_map_req(hpb, srgn, srgn_cnt);
 		if (ret)
 			break;
 
@@ -2142,7 +2309,8 @@ static void ufshpb_run_active_subregion_list(struct ufshpb_lu *hpb)
 
 	if (ret) {
 		spin_lock_irqsave(&hpb->rsp_list_lock, flags);
-		ufshpb_add_active_list(hpb, rgn, srgn);
+		for (i = srgn_cnt - 1; i >= 0; i--)
+			ufshpb_add_active_list(hpb, rgn, srgn + i);
 	}
 	spin_unlock_irqrestore(&hpb->rsp_list_lock, flags);
 }
@@ -2165,6 +2333,71 @@ static void ufshpb_task_workq_fn(struct work_struct *work)
 	ufshpb_lu_put(hpb);
 }
 
+/*
+ * Decay the read heat of every subregion. When the LU has been idle for
+ * a while, load the maps of subregions that are warm but not active yet,
+ * so the next burst of the same reads (e.g. an app launch) hits.
+ */
+static void ufshpb_heat_work_handler(struct work_struct *work)
+{
+	struct ufshpb_lu *hpb;
+	struct delayed_work *dwork = to_delayed_work(work);
+	struct ufshpb_subregion *cand[HPB_HOST_PREFETCH_BATCH];
+	struct ufshpb_region *rgn;
+	struct ufshpb_subregion *srgn;
+	unsigned long flags;
+	unsigned int heat;
+	bool idle, hot = false;
+	int rgn_idx, srgn_idx, nr = 0, i;
+
+	hpb = container_of(dwork, struct ufshpb_lu, ufshpb_heat_work);
+
+	if (ufshpb_lu_get(hpb))
+		return;
+
+	idle = time_after(jiffies, hpb->last_read_jiffies +
+			  msecs_to_jiffies(HPB_HOST_IDLE_MS));
+
+	for (rgn_idx = 0; rgn_idx < hpb->rgns_per_lu; rgn_idx++) {
+		rgn = hpb->rgn_tbl + rgn_idx;
+
+		for (srgn_idx = 0; srgn_idx < rgn->srgn_cnt; srgn_idx++) {
+			srgn = rgn->srgn_tbl + srgn_idx;
+
+			heat = READ_ONCE(srgn->heat);
+			if (!heat)
+				continue;
+
+			if (idle && nr < HPB_HOST_PREFETCH_BATCH &&
+			    heat >= hpb->host_prefetch_threshold &&
+			    srgn->srgn_state != HPBSUBREGION_ISSUED &&
+			    !ufshpb_valid_srgn(rgn, srgn))
+				cand[nr++] = srgn;
+
+			heat >>= 1;
+			WRITE_ONCE(srgn->heat, heat);
+			if (heat)
+				hot = true;
+		}
+	}
+
+	if (nr) {
+		spin_lock_irqsave(&hpb->rsp_list_lock, flags);
+		for (i = 0; i < nr; i++)
+			ufshpb_host_add_active_list(hpb, cand[i]);
+		spin_unlock_irqrestore(&hpb->rsp_list_lock, flags);
+
+		HPB_DEBUG(hpb, "host prefetch %d subregions", nr);
+		atomic64_add(nr, &hpb->host_prefetch_cnt);
+		schedule_work(&hpb->ufshpb_task_workq);
+	}
+
+	if (hot && hpb->host_control)
+		ufshpb_host_schedule_heat_work(hpb);
+
+	ufshpb_lu_put(hpb);
+}
+
 static void ufshpb_init_constant(void)
 {
 	sects_per_blk_shift = ffs(BLOCK) - ffs(SECTOR);
@@ -2280,6 +2513,7 @@ static inline void ufshpb_init_jobs(struct ufshpb_lu *hpb)
 	INIT_WORK(&hpb->ufshpb_work, ufshpb_work_handler);
 	INIT_DELAYED_WORK(&hpb->ufshpb_retry_work, ufshpb_retry_work_handler);
 	INIT_WORK(&hpb->ufshpb_task_workq, ufshpb_task_workq_fn);
+	INIT_DELAYED_WORK(&hpb->ufshpb_heat_work, ufshpb_heat_work_handler);
 }
 
 static inline void ufshpb_cancel_jobs(struct ufshpb_lu *hpb)
@@ -2287,6 +2521,7 @@ static inline void ufshpb_cancel_jobs(struct ufshpb_lu *hpb)
 	cancel_work_sync(&hpb->ufshpb_work);
 	cancel_delayed_work_sync(&hpb->ufshpb_retry_work);
 	cancel_work_sync(&hpb->ufshpb_task_workq);
+	cancel_delayed_work_sync(&hpb->ufshpb_heat_work);
 }
 
 static void ufshpb_init_subregion_tbl(struct ufshpb_lu *hpb,
@@ -2407,7 +2642,8 @@ ufshpb_map_req_mempool_init(struct ufshpb_lu *hpb)
 			goto release_mem;
 		}
 
-		map_req->bio = bio_kmalloc(GFP_KERNEL, hpb->mpages_per_srgn);
+		map_req->bio = bio_kmalloc(GFP_KERNEL, hpb->mpages_per_srgn *
+					   HPB_MAP_REQ_BATCH_MAX);
 		if (!map_req->bio) {
 			kfree(hpb->map_req[i].req);
 			for (j = 0; j < i; j++) {
@@ -2511,6 +2747,7 @@ static void ufshpb_find_lu_qd(struct ufshpb_lu *hpb)
 
 	hpb->throttle_map_req = hpb->qd;
 	hpb->throttle_pre_req = hpb->qd;
+	hpb->map_req_batch = 1;
 	hpb->num_inflight_map_req = 0;
 	hpb->num_inflight_pre_req = 0;
 }
@@ -2625,6 +2862,9 @@ static int ufshpb_lu_hpb_init(struct ufsf_feature *ufsf, int lun)
 	INIT_LIST_HEAD(&hpb->lru_info.lh_lru_rgn);
 	hpb->lru_info.selection_type = LRU;
 
+	hpb->host_act_threshold = HPB_HOST_ACT_THRESHOLD;
+	hpb->host_prefetch_threshold = HPB_HOST_PREFETCH_THRESHOLD;
+
 	INIT_LIST_HEAD(&hpb->lh_pinned_srgn);
 	INIT_LIST_HEAD(&hpb->lh_act_srgn);
 	INIT_LIST_HEAD(&hpb->lh_inact_rgn);
@@ -2836,6 +3076,8 @@ int ufshpb_get_lu_info(struct ufsf_feature *ufsf, int lun, u8 *unit_buf)
 		hpb->lru_info.max_lru_active_cnt =
 			lu_desc.lu_max_active_hpb_rgns -
 			lu_desc.lu_num_hpb_pinned_rgns;
+		hpb->lru_info.dev_max_lru_active_cnt =
+			hpb->lru_info.max_lru_active_cnt;
 		hpb->lu_pinned_rgn_startidx =
 			lu_desc.lu_hpb_pinned_rgn_startidx;
 		hpb->lu_pinned_end_offset = lu_desc.lu_hpb_pinned_end_offset;
@@ -3172,7 +3414,11 @@ static void ufshpb_stat_init(struct ufshpb_lu *hpb)
 	atomic64_set(&hpb->rb_active_cnt, 0);
 	atomic64_set(&hpb->rb_inactive_cnt, 0);
 	atomic64_set(&hpb->map_req_cnt, 0);
+	atomic64_set(&hpb->map_req_batch_cnt, 0);
 	atomic64_set(&hpb->pre_req_cnt, 0);
+	atomic64_set(&hpb->host_act_cnt, 0);
+	atomic64_set(&hpb->host_prefetch_cnt, 0);
+	atomic64_set(&hpb->lru_evict_cnt, 0);
 
 	ufsf_para.hit = 0;
 	ufsf_para.miss = 0;
@@ -3282,6 +3528,41 @@ static ssize_t ufshpb_sysfs_throttle_map_req_store(struct ufshpb_lu *hpb,
 	return cnt;
 }
 
+static ssize_t ufshpb_sysfs_map_req_batch_show(struct ufshpb_lu *hpb,
+					       char *buf)
+{
+	int ret;
+
+	ret = snprintf(buf, PAGE_SIZE, "map_req_batch %d\n",
+		       hpb->map_req_batch);
+
+	SYSFS_INFO("%s", buf);
+
+	return ret;
+}
+
+/*
+ * Only raise this on devices whose READ_BUFFER returns the following
+ * subregions when the allocation length covers more than one.
+ */
+static ssize_t ufshpb_sysfs_map_req_batch_store(struct ufshpb_lu *hpb,
+						const char *buf, size_t cnt)
+{
+	unsigned long val;
+
+	if (kstrtoul(buf, 0, &val))
+		return -EINVAL;
+
+	if (val < 1 || val > HPB_MAP_REQ_BATCH_MAX)
+		return -EINVAL;
+
+	hpb->map_req_batch = (int)val;
+
+	SYSFS_INFO("map_req_batch %d", hpb->map_req_batch);
+
+	return cnt;
+}
+
 static ssize_t ufshpb_sysfs_throttle_pre_req_show(struct ufshpb_lu *hpb,
 						  char *buf)
 {
@@ -3453,17 +3734,20 @@ static ssize_t ufshpb_sysfs_miss_show(struct ufshpb_lu *hpb, char *buf)
 static ssize_t ufshpb_sysfs_map_req_show(struct ufshpb_lu *hpb, char *buf)
 {
 	long long rb_noti_cnt, rb_active_cnt, rb_inactive_cnt, map_req_cnt;
+	long long map_req_batch_cnt;
 	int ret;
 
 	rb_noti_cnt = atomic64_read(&hpb->rb_noti_cnt);
 	rb_active_cnt = atomic64_read(&hpb->rb_active_cnt);
 	rb_inactive_cnt = atomic64_read(&hpb->rb_inactive_cnt);
 	map_req_cnt = atomic64_read(&hpb->map_req_cnt);
+	map_req_batch_cnt = atomic64_read(&hpb->map_req_batch_cnt);
 
 	ret = snprintf(buf, PAGE_SIZE,
-		       "rb_noti %lld ACT %lld INACT %lld map_req_count %lld\n",
+		       "rb_noti %lld ACT %lld INACT %lld map_req_count %lld"
+		       " batched_srgn %lld\n",
 		       rb_noti_cnt, rb_active_cnt, rb_inactive_cnt,
-		       map_req_cnt);
+		       map_req_cnt, map_req_batch_cnt);
 
 	SYSFS_INFO("%s", buf);
 
@@ -3506,6 +3790,185 @@ static ssize_t ufshpb_sysfs_region_stat_show(struct ufshpb_lu *hpb, char *buf)
 	return ret;
 }
 
+static ssize_t ufshpb_sysfs_host_control_show(struct ufshpb_lu *hpb,
+					      char *buf)
+{
+	int ret;
+
+	ret = snprintf(buf, PAGE_SIZE, "host_control %d\n", hpb->host_control);
+
+	SYSFS_INFO("%s", buf);
+
+	return ret;
+}
+
+static ssize_t ufshpb_sysfs_host_control_store(struct ufshpb_lu *hpb,
+					       const char *buf, size_t cnt)
+{
+	unsigned long value;
+
+	if (kstrtoul(buf, 0, &value))
+		return -EINVAL;
+
+	hpb->host_control = !!value;
+
+	SYSFS_INFO("host_control %d", hpb->host_control);
+
+	return cnt;
+}
+
+static ssize_t ufshpb_sysfs_host_act_threshold_show(struct ufshpb_lu *hpb,
+						    char *buf)
+{
+	int ret;
+
+	ret = snprintf(buf, PAGE_SIZE, "host_act_threshold %d\n",
+		       hpb->host_act_threshold);
+
+	SYSFS_INFO("%s", buf);
+
+	return ret;
+}
+
+static ssize_t ufshpb_sysfs_host_act_threshold_store(struct ufshpb_lu *hpb,
+						     const char *buf,
+						     size_t cnt)
+{
+	unsigned long val;
+
+	if (kstrtoul(buf, 0, &val))
+		return -EINVAL;
+
+	if (val < 1 || val > HPB_HOST_HEAT_MAX)
+		return -EINVAL;
+
+	hpb->host_act_threshold = (int)val;
+
+	SYSFS_INFO("host_act_threshold %d", hpb->host_act_threshold);
+
+	return cnt;
+}
+
+static ssize_t
+ufshpb_sysfs_host_prefetch_threshold_show(struct ufshpb_lu *hpb, char *buf)
+{
+	int ret;
+
+	ret = snprintf(buf, PAGE_SIZE, "host_prefetch_threshold %d\n",
+		       hpb->host_prefetch_threshold);
+
+	SYSFS_INFO("%s", buf);
+
+	return ret;
+}
+
+static ssize_t
+ufshpb_sysfs_host_prefetch_threshold_store(struct ufshpb_lu *hpb,
+					   const char *buf, size_t cnt)
+{
+	unsigned long val;
+
+	if (kstrtoul(buf, 0, &val))
+		return -EINVAL;
+
+	if (val < 1 || val > HPB_HOST_HEAT_MAX)
+		return -EINVAL;
+
+	hpb->host_prefetch_threshold = (int)val;
+
+	SYSFS_INFO("host_prefetch_threshold %d", hpb->host_prefetch_threshold);
+
+	return cnt;
+}
+
+static ssize_t ufshpb_sysfs_max_active_rgns_show(struct ufshpb_lu *hpb,
+						 char *buf)
+{
+	int ret;
+
+	ret = snprintf(buf, PAGE_SIZE, "max_active_rgns %d device %d\n",
+		       hpb->lru_info.max_lru_active_cnt,
+		       hpb->lru_info.dev_max_lru_active_cnt);
+
+	SYSFS_INFO("%s", buf);
+
+	return ret;
+}
+
+/*
+ * Lowering the limit does not evict anything by itself, the LRU shrinks
+ * by one region on each following activation until it fits.
+ */
+static ssize_t ufshpb_sysfs_max_active_rgns_store(struct ufshpb_lu *hpb,
+						  const char *buf, size_t cnt)
+{
+	unsigned long val;
+
+	if (kstrtoul(buf, 0, &val))
+		return -EINVAL;
+
+	if (val < 1 || val > hpb->lru_info.dev_max_lru_active_cnt)
+		return -EINVAL;
+
+	hpb->lru_info.max_lru_active_cnt = (int)val;
+
+	SYSFS_INFO("max_active_rgns %d", hpb->lru_info.max_lru_active_cnt);
+
+	return cnt;
+}
+
+/* mark a region that is about to be read, e.g. an app launch file set */
+static ssize_t ufshpb_sysfs_hot_region_store(struct ufshpb_lu *hpb,
+					     const char *buf, size_t cnt)
+{
+	struct ufshpb_region *rgn;
+	unsigned long rgn_idx, flags;
+	int srgn_idx;
+
+	if (kstrtoul(buf, 0, &rgn_idx))
+		return -EINVAL;
+
+	if (rgn_idx >= hpb->rgns_per_lu) {
+		ERR_MSG("error region %ld max %d", rgn_idx, hpb->rgns_per_lu);
+		return -EINVAL;
+	}
+
+	rgn = hpb->rgn_tbl + rgn_idx;
+
+	spin_lock_irqsave(&hpb->hpb_lock, flags);
+	for (srgn_idx = 0; srgn_idx < rgn->srgn_cnt; srgn_idx++)
+		rgn->srgn_tbl[srgn_idx].heat =
+			max_t(unsigned int, rgn->srgn_tbl[srgn_idx].heat,
+			      hpb->host_act_threshold);
+	spin_unlock_irqrestore(&hpb->hpb_lock, flags);
+
+	SYSFS_INFO("hot region %ld", rgn_idx);
+
+	ufshpb_host_schedule_heat_work(hpb);
+
+	return cnt;
+}
+
+static ssize_t ufshpb_sysfs_host_stat_show(struct ufshpb_lu *hpb, char *buf)
+{
+	long long host_act_cnt, host_prefetch_cnt, lru_evict_cnt;
+	int ret;
+
+	host_act_cnt = atomic64_read(&hpb->host_act_cnt);
+	host_prefetch_cnt = atomic64_read(&hpb->host_prefetch_cnt);
+	lru_evict_cnt = atomic64_read(&hpb->lru_evict_cnt);
+
+	ret = snprintf(buf, PAGE_SIZE,
+		       "host_act %lld host_prefetch %lld lru_evict %lld"
+		       " lru_active %lld\n", host_act_cnt, host_prefetch_cnt,
+		       lru_evict_cnt,
+		       (long long)atomic64_read(&hpb->lru_info.active_cnt));
+
+	SYSFS_INFO("%s", buf);
+
+	return ret;
+}
+
 static ssize_t ufshpb_sysfs_count_reset_store(struct ufshpb_lu *hpb,
 					      const char *buf, size_t cnt)
 {
@@ -3641,6 +4104,9 @@ static struct ufshpb_sysfs_entry ufshpb_sysfs_entries[] = {
 	__ATTR(throttle_map_req, 0644,
 	       ufshpb_sysfs_throttle_map_req_show,
 	       ufshpb_sysfs_throttle_map_req_store),
+	__ATTR(map_req_batch, 0644,
+	       ufshpb_sysfs_map_req_batch_show,
+	       ufshpb_sysfs_map_req_batch_store),
 	__ATTR(throttle_pre_req, 0644,
 	       ufshpb_sysfs_throttle_pre_req_show,
 	       ufshpb_sysfs_throttle_pre_req_store),
@@ -3658,6 +4124,19 @@ static struct ufshpb_sysfs_entry ufshpb_sysfs_entries[] = {
 	__ATTR(map_req_count, 0444, ufshpb_sysfs_map_req_show, NULL),
 	__ATTR(pre_req_count, 0444, ufshpb_sysfs_pre_req_show, NULL),
 	__ATTR(region_stat_count, 0444, ufshpb_sysfs_region_stat_show, NULL),
+	__ATTR(host_control, 0644,
+	       ufshpb_sysfs_host_control_show, ufshpb_sysfs_host_control_store),
+	__ATTR(host_act_threshold, 0644,
+	       ufshpb_sysfs_host_act_threshold_show,
+	       ufshpb_sysfs_host_act_threshold_store),
+	__ATTR(host_prefetch_threshold, 0644,
+	       ufshpb_sysfs_host_prefetch_threshold_show,
+	       ufshpb_sysfs_host_prefetch_threshold_store),
+	__ATTR(max_active_rgns, 0644,
+	       ufshpb_sysfs_max_active_rgns_show,
+	       ufshpb_sysfs_max_active_rgns_store),
+	__ATTR(hot_region, 0200, NULL, ufshpb_sysfs_hot_region_store),
+	__ATTR(host_stat_count, 0444, ufshpb_sysfs_host_stat_show, NULL),
 	__ATTR(count_reset, 0200, NULL, ufshpb_sysfs_count_reset_store),
 	__ATTR(get_info_from_lba, 0200, NULL, ufshpb_sysfs_info_lba_store),
 	__ATTR(get_info_from_region, 0200, NULL,
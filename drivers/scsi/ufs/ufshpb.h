@@ -61,6 +61,17 @@
 
 #define RETRY_DELAY_MS				5000
 
+/* Host control mode */
+#define HPB_HOST_ACT_THRESHOLD			4
+#define HPB_HOST_PREFETCH_THRESHOLD		2
+#define HPB_HOST_HEAT_MAX			255
+#define HPB_HOST_HEAT_PERIOD_MS			1000
+#define HPB_HOST_IDLE_MS			200
+#define HPB_HOST_PREFETCH_BATCH			8
+
+/* Max adjacent subregions loaded by one READ_BUFFER */
+#define HPB_MAP_REQ_BATCH_MAX			4
+
 /* HPB Support Chunk Size */
 #define HPB_4_CHUNK_LEN				1
 #define HPB_32_CHUNK_LEN			8
@@ -172,6 +183,13 @@ struct ufshpb_subregion {
 	int rgn_idx;
 	int srgn_idx;
 
+	/*
+	 * read heat for host control mode. It is raised under hpb_lock and
+	 * decayed locklessly by the heat worker, a lost update only delays
+	 * an activation by one period.
+	 */
+	unsigned int heat;
+
 	/* below information is used by rsp_list */
 	struct list_head list_act_srgn;
 };
@@ -203,7 +221,9 @@ struct ufshpb_req {
 			struct ufshpb_map_ctx *mctx;
 			unsigned int rgn_idx;
 			unsigned int srgn_idx;
+			unsigned int srgn_cnt;
 			unsigned int lun;
+			ktime_t issue_time;
 		} rb;
 		struct {
 			struct page *m_page;
@@ -221,6 +241,7 @@ struct victim_select_info {
 	int selection_type;
 	struct list_head lh_lru_rgn;
 	int max_lru_active_cnt; /* supported hpb #region - pinned #region */
+	int dev_max_lru_active_cnt; /* upper bound reported by the device */
 	atomic64_t active_cnt;
 };
 
@@ -235,6 +256,7 @@ struct ufshpb_lu {
 	struct ufshpb_req *map_req;
 	int num_inflight_map_req;
 	int throttle_map_req;
+	int map_req_batch;
 	struct list_head lh_map_req_free;
 	struct list_head lh_map_req_retry;
 	struct list_head lh_map_ctx_free;
@@ -260,6 +282,13 @@ struct ufshpb_lu {
 	struct work_struct ufshpb_work;
 	struct delayed_work ufshpb_retry_work;
 	struct work_struct ufshpb_task_workq;
+	struct delayed_work ufshpb_heat_work;
+
+	/* host control mode */
+	bool host_control;
+	int host_act_threshold;
+	int host_prefetch_threshold;
+	unsigned long last_read_jiffies;
 
 	/* for selecting victim */
 	struct victim_select_info lru_info;
@@ -296,7 +325,11 @@ struct ufshpb_lu {
 	atomic64_t rb_active_cnt;
 	atomic64_t rb_inactive_cnt;
 	atomic64_t map_req_cnt;
+	atomic64_t map_req_batch_cnt;
 	atomic64_t pre_req_cnt;
+	atomic64_t host_act_cnt;
+	atomic64_t host_prefetch_cnt;
+	atomic64_t lru_evict_cnt;
 	unsigned long lpn_last;
 };
 
@@ -37,6 +37,7 @@
 
 #include <uapi/scsi/ufs/ufs.h>
 #include <linux/delay.h>
+#include <linux/msm_drm_notify.h>
 
 #include "ufshcd.h"
 #include "ufstw.h"
@@ -92,6 +93,28 @@ static void ufstw_switch_disable_mode(struct ufstw_lu *tw)
 	mutex_unlock(&tw->mode_lock);
 }
 
+/*
+ * Remember how many sectors went through the TW buffer for each step of
+ * dTurboWriteBufferLifeTimeEst, this is the lifetime cost of the policy.
+ */
+static void ufstw_lifetime_step(struct ufstw_lu *tw)
+{
+	unsigned int est = tw->tw_lifetime_est &
+		~MASK_UFSTW_LIFETIME_NOT_GUARANTEE;
+	u64 written;
+
+	if (est == tw->lifetime_last_est)
+		return;
+
+	spin_lock_bh(&tw->lifetime_lock);
+	written = tw->stat_tw_write_sec;
+	spin_unlock_bh(&tw->lifetime_lock);
+
+	tw->lifetime_last_step_sec = written - tw->lifetime_step_sec;
+	tw->lifetime_step_sec = written;
+	tw->lifetime_last_est = est;
+}
+
 static void ufstw_lifetime_work_fn(struct work_struct *work)
 {
 	struct ufstw_lu *tw;
@@ -110,6 +133,8 @@ static void ufstw_lifetime_work_fn(struct work_struct *work)
 			       &tw->tw_lifetime_est))
 		goto out;
 
+	ufstw_lifetime_step(tw);
+
 #if defined(CONFIG_UFSTW_IGNORE_GUARANTEE_BIT)
 	if (tw->tw_lifetime_est & MASK_UFSTW_LIFETIME_NOT_GUARANTEE) {
 		WARNING_MSG("warn: lun %d - dTurboWriteBufferLifeTimeEst[31] == 1", tw->lun);
@@ -160,8 +185,17 @@ void ufstw_prep_fn(struct ufsf_feature *ufsf, struct ufshcd_lrb *lrbp)
 
 	ufsf_para.tw_write_secs += blk_rq_sectors(lrbp->cmd->request);
 
+	if (tw->policy_enable) {
+		atomic_long_add(blk_rq_sectors(lrbp->cmd->request),
+				&tw->win_write_sec);
+		if (!delayed_work_pending(&tw->tw_policy_work))
+			schedule_delayed_work(&tw->tw_policy_work,
+					      msecs_to_jiffies(UFSTW_POLICY_PERIOD_MS));
+	}
+
 	spin_lock_bh(&tw->lifetime_lock);
 	tw->stat_write_sec += blk_rq_sectors(lrbp->cmd->request);
+	tw->stat_tw_write_sec += blk_rq_sectors(lrbp->cmd->request);
 
 	if (tw->stat_write_sec > UFSTW_LIFETIME_SECT) {
 		tw->stat_write_sec = 0;
@@ -467,6 +501,40 @@ static int ufstw_disable_ee(struct ufsf_feature *ufsf)
 	return err;
 }
 
+/*
+ * The device only raises its exception event once the buffer is nearly
+ * full. When the policy expects a burst, or sees an idle or screen-off
+ * window, start flushing in hibern8 as soon as the buffer is below
+ * flush_th_max instead of waiting for flush_th_min.
+ */
+static inline unsigned int ufstw_flush_enable_th(struct ufstw_lu *tw)
+{
+	if (tw->policy_flush && tw->flush_th_max)
+		return tw->flush_th_max - 1;
+
+	return tw->flush_th_min;
+}
+
+static inline void ufstw_flush_stat_start(struct ufstw_lu *tw)
+{
+	tw->stat_flushes++;
+	tw->flush_start = jiffies;
+	tw->flush_start_avail = tw->tw_available_buffer_size;
+}
+
+/* available buffer size is reported in steps of 10% */
+static inline void ufstw_flush_stat_end(struct ufstw_lu *tw)
+{
+	if (!tw->flush_start)
+		return;
+
+	tw->stat_flush_ms += jiffies_to_msecs(jiffies - tw->flush_start);
+	if (tw->tw_available_buffer_size > tw->flush_start_avail)
+		tw->stat_flushed_pct += (tw->tw_available_buffer_size -
+					 tw->flush_start_avail) * 10;
+	tw->flush_start = 0;
+}
+
 static void ufstw_flush_work_fn(struct work_struct *dwork)
 {
 	struct ufs_hba *hba;
@@ -510,23 +578,29 @@ static void ufstw_flush_work_fn(struct work_struct *dwork)
 					QUERY_FLAG_IDN_TW_FLUSH_DURING_HIBERN,
 					&tw->tw_flush_during_hibern_enter))
 			goto error_unlock;
+		ufstw_flush_stat_end(tw);
 		tw->next_q = 0;
 		need_resched = false;
 	} else if (tw->tw_available_buffer_size < tw->flush_th_max) {
 		if (tw->tw_flush_during_hibern_enter) {
 			need_resched = true;
-		} else if (tw->tw_available_buffer_size <= tw->flush_th_min) {
-			TW_DEBUG(tw->ufsf, "flush_enable  QR (%d, %d)",
-				 tw->lun, tw->tw_available_buffer_size);
+		} else if (tw->tw_available_buffer_size <=
+			   ufstw_flush_enable_th(tw)) {
+			TW_DEBUG(tw->ufsf, "flush_enable  QR (%d, %d) policy %d",
+				 tw->lun, tw->tw_available_buffer_size,
+				 tw->policy_flush);
 			if (ufstw_set_lu_flag(tw,
 					      QUERY_FLAG_IDN_TW_FLUSH_DURING_HIBERN,
 					      &tw->tw_flush_during_hibern_enter))
 				goto error_unlock;
+			ufstw_flush_stat_start(tw);
 			need_resched = true;
 		} else {
 			need_resched = false;
 		}
 	}
+	/* a policy request only moves the next enable decision */
+	tw->policy_flush = false;
 	mutex_unlock(&tw->flush_lock);
 
 	pm_runtime_put_noidle(hba->dev);
@@ -592,6 +666,97 @@ void ufstw_ee_handler(struct ufsf_feature *ufsf)
 	}
 }
 
+static void ufstw_policy_kick_flush(struct ufstw_lu *tw)
+{
+	struct ufs_hba *hba = tw->ufsf->hba;
+
+	tw->policy_flush = true;
+	if (!delayed_work_pending(&tw->tw_flush_work)) {
+		tw->next_q = jiffies;
+		if (schedule_delayed_work(&tw->tw_flush_work,
+					  msecs_to_jiffies(0)))
+			pm_runtime_get_noresume(hba->dev);
+	}
+}
+
+/*
+ * Sample the write rate once a period while there are writes. A rate
+ * above burst_kbps for UFSTW_POLICY_BURST_PERIODS periods is taken as the
+ * start of a sustained burst (camera, app install, OTA), so the buffer
+ * starts flushing in the gaps between requests. After
+ * UFSTW_POLICY_IDLE_PERIODS quiet periods the buffer is flushed once
+ * more and the worker stops until the next write.
+ */
+static void ufstw_policy_work_fn(struct work_struct *work)
+{
+	struct ufstw_lu *tw;
+	unsigned long secs;
+	bool kick = false;
+
+	tw = container_of(work, struct ufstw_lu, tw_policy_work.work);
+
+	ufstw_lu_get(tw);
+	if (atomic_read(&tw->ufsf->tw_state) != TW_PRESENT)
+		goto out;
+
+	secs = atomic_long_xchg(&tw->win_write_sec, 0);
+	tw->write_kbps = (secs >> 1) * MSEC_PER_SEC / UFSTW_POLICY_PERIOD_MS;
+	tw->avg_kbps = (tw->avg_kbps * 3 + tw->write_kbps) >> 2;
+
+	if (tw->write_kbps >= tw->burst_kbps) {
+		tw->idle_periods = 0;
+		if (++tw->burst_periods == UFSTW_POLICY_BURST_PERIODS) {
+			tw->stat_bursts++;
+			kick = true;
+		}
+	} else {
+		tw->burst_periods = 0;
+		if (secs)
+			tw->idle_periods = 0;
+		else if (++tw->idle_periods == UFSTW_POLICY_IDLE_PERIODS) {
+			tw->stat_idle_flushes++;
+			kick = true;
+		}
+	}
+
+	blk_add_trace_msg(tw->ufsf->sdev_ufs_lu[tw->lun]->request_queue,
+			  "%s:%d write_kbps %u avg_kbps %u burst %u idle %u",
+			  __func__, __LINE__, tw->write_kbps, tw->avg_kbps,
+			  tw->burst_periods, tw->idle_periods);
+
+	if (kick && tw->policy_enable)
+		ufstw_policy_kick_flush(tw);
+
+	if (tw->policy_enable && tw->idle_periods < UFSTW_POLICY_IDLE_PERIODS)
+		schedule_delayed_work(&tw->tw_policy_work,
+				      msecs_to_jiffies(UFSTW_POLICY_PERIOD_MS));
+out:
+	ufstw_lu_put(tw);
+}
+
+static int ufstw_drm_notifier_cb(struct notifier_block *nb,
+				 unsigned long action, void *data)
+{
+	struct ufstw_lu *tw = container_of(nb, struct ufstw_lu, drm_notif);
+	struct msm_drm_notifier *evdata = data;
+	int *blank = evdata->data;
+
+	if (action != MSM_DRM_EVENT_BLANK)
+		return NOTIFY_OK;
+
+	tw->screen_off = *blank != MSM_DRM_BLANK_UNBLANK;
+	if (!tw->screen_off || !tw->policy_enable)
+		return NOTIFY_OK;
+
+	if (atomic_read(&tw->ufsf->tw_state) != TW_PRESENT)
+		return NOTIFY_OK;
+
+	tw->stat_idle_flushes++;
+	ufstw_policy_kick_flush(tw);
+
+	return NOTIFY_OK;
+}
+
 static inline void ufstw_init_dev_jobs(struct ufsf_feature *ufsf)
 {
 	INIT_INFO("INIT_WORK(tw_reset_work)");
@@ -604,6 +769,8 @@ static inline void ufstw_init_lu_jobs(struct ufstw_lu *tw)
 	INIT_DELAYED_WORK(&tw->tw_flush_work, ufstw_flush_work_fn);
 	INIT_INFO("INIT_WORK(tw_lifetime_work)");
 	INIT_WORK(&tw->tw_lifetime_work, ufstw_lifetime_work_fn);
+	INIT_INFO("INIT_DELAYED_WORK(tw_policy_work) ufstw_lu%d", tw->lun);
+	INIT_DELAYED_WORK(&tw->tw_policy_work, ufstw_policy_work_fn);
 }
 
 static inline void ufstw_cancel_lu_jobs(struct ufstw_lu *tw)
@@ -616,6 +783,11 @@ static inline void ufstw_cancel_lu_jobs(struct ufstw_lu *tw)
 	ret = cancel_work_sync(&tw->tw_lifetime_work);
 	INIT_INFO("cancel_work_sync(tw_lifetime_work) ufstw_lu%d = %d",
 		  tw->lun, ret);
+	ret = cancel_delayed_work_sync(&tw->tw_policy_work);
+	INIT_INFO("cancel_delayed_work_sync(tw_policy_work) ufstw_lu%d = %d",
+		  tw->lun, ret);
+	tw->burst_periods = 0;
+	tw->idle_periods = 0;
 }
 
 static inline int ufstw_version_check(struct ufstw_dev_info *tw_dev_info)
@@ -761,6 +933,15 @@ static inline void ufstw_lu_update(struct ufstw_lu *tw)
 	ufstw_lu_put(tw);
 }
 
+static inline void ufstw_unregister_drm_notifier(struct ufstw_lu *tw)
+{
+	if (!tw->drm_notif.notifier_call)
+		return;
+
+	msm_drm_unregister_client(&tw->drm_notif);
+	tw->drm_notif.notifier_call = NULL;
+}
+
 static void ufstw_lu_init(struct ufsf_feature *ufsf, int lun)
 {
 	struct ufstw_lu *tw = ufsf->tw_lup[lun];
@@ -778,14 +959,26 @@ static void ufstw_lu_init(struct ufsf_feature *ufsf, int lun)
 	tw->flush_th_min = UFSTW_FLUSH_WORKER_TH_MIN;
 	tw->flush_th_max = UFSTW_FLUSH_WORKER_TH_MAX;
 
+	tw->policy_enable = true;
+	tw->burst_kbps = UFSTW_POLICY_BURST_KBPS;
+	atomic_long_set(&tw->win_write_sec, 0);
+
 	/* for Debug */
 	ufstw_init_lu_jobs(tw);
 
+	tw->drm_notif.notifier_call = ufstw_drm_notifier_cb;
+	if (msm_drm_register_client(&tw->drm_notif)) {
+		INIT_INFO("drm notifier fail. screen-off flush disabled.");
+		tw->drm_notif.notifier_call = NULL;
+	}
+
 	if (ufstw_create_sysfs(ufsf, tw))
 		INIT_INFO("sysfs init fail. but tw could run normally.");
 
 	/* Read Flag, Attribute */
 	ufstw_lu_update(tw);
+	tw->lifetime_last_est = tw->tw_lifetime_est &
+		~MASK_UFSTW_LIFETIME_NOT_GUARANTEE;
 
 #if defined(CONFIG_UFSTW_IGNORE_GUARANTEE_BIT)
 	if (tw->tw_lifetime_est & MASK_UFSTW_LIFETIME_NOT_GUARANTEE) {
@@ -963,6 +1156,8 @@ void ufstw_init(struct ufsf_feature *ufsf)
 out_free_mem:
 	/* yujinghua@TECH.Storage.UFS, 2019/12/31, set the ufsf->tw_lup[lun] as NULL after kfree*/
 	seq_scan_lu(lun){
+		if (ufsf->tw_lup[lun])
+			ufstw_unregister_drm_notifier(ufsf->tw_lup[lun]);
 		kfree(ufsf->tw_lup[lun]);
 		ufsf->tw_lup[lun] = NULL;
 	}
@@ -1079,6 +1274,7 @@ void ufstw_release(struct kref *kref)
 		if (!tw)
 			continue;
 
+		ufstw_unregister_drm_notifier(tw);
 		ufstw_cancel_lu_jobs(tw);
 		tw->next_q = 0;
 
@@ -1289,6 +1485,32 @@ void bdev_clear_turbo_write(struct block_device *bdev)
 		ufstw_active_turbo_write(bdev->bd_queue, false);
 }
 
+/*
+ * True while writes land in the TurboWrite buffer or the buffer is being
+ * flushed during hibern8, i.e. when bulk background writes such as f2fs GC
+ * would either eat SLC space reserved for bursts or keep the link out of
+ * hibern8 and stall the flush.
+ */
+bool bdev_turbo_write_busy(struct block_device *bdev)
+{
+	struct request_queue *q = bdev->bd_queue;
+	struct scsi_device *sdev = q->queuedata;
+	struct ufs_hba *hba;
+	struct ufstw_lu *tw;
+
+	if (!q->turbo_write_dev || !sdev ||
+	    sdev->lun >= UFS_UPIU_MAX_GENERAL_LUN)
+		return false;
+
+	hba = shost_priv(sdev->host);
+	tw = hba->ufsf.tw_lup[sdev->lun];
+	if (!tw || atomic_read(&hba->ufsf.tw_state) != TW_PRESENT)
+		return false;
+
+	return READ_ONCE(tw->tw_enable) ||
+	       READ_ONCE(tw->tw_flush_during_hibern_enter);
+}
+
 /* sysfs function */
 static ssize_t ufstw_sysfs_show_ee_mode(struct ufstw_lu *tw, char *buf)
 {
@@ -1677,6 +1899,118 @@ static ssize_t ufstw_sysfs_store_tw_mode(struct ufstw_lu *tw, const char *buf,
 	return count;
 }
 
+static ssize_t ufstw_sysfs_show_policy_enable(struct ufstw_lu *tw, char *buf)
+{
+	SYSFS_INFO("policy_enable %d", tw->policy_enable);
+
+	return snprintf(buf, PAGE_SIZE, "%d", tw->policy_enable);
+}
+
+static ssize_t ufstw_sysfs_store_policy_enable(struct ufstw_lu *tw,
+					       const char *buf, size_t count)
+{
+	unsigned long val;
+
+	if (kstrtoul(buf, 0, &val))
+		return -EINVAL;
+
+	if (val > 1)
+		return -EINVAL;
+
+	tw->policy_enable = val;
+	if (!tw->policy_enable)
+		cancel_delayed_work_sync(&tw->tw_policy_work);
+	tw->burst_periods = 0;
+	tw->idle_periods = 0;
+	atomic_long_set(&tw->win_write_sec, 0);
+
+	SYSFS_INFO("policy_enable %d", tw->policy_enable);
+	return count;
+}
+
+static ssize_t ufstw_sysfs_show_policy_burst_kbps(struct ufstw_lu *tw,
+						  char *buf)
+{
+	SYSFS_INFO("policy_burst_kbps %u", tw->burst_kbps);
+
+	return snprintf(buf, PAGE_SIZE, "%u", tw->burst_kbps);
+}
+
+static ssize_t ufstw_sysfs_store_policy_burst_kbps(struct ufstw_lu *tw,
+						   const char *buf,
+						   size_t count)
+{
+	unsigned int val;
+
+	if (kstrtouint(buf, 0, &val))
+		return -EINVAL;
+
+	if (!val)
+		return -EINVAL;
+
+	tw->burst_kbps = val;
+
+	SYSFS_INFO("policy_burst_kbps %u", tw->burst_kbps);
+	return count;
+}
+
+static ssize_t ufstw_sysfs_show_policy_stat(struct ufstw_lu *tw, char *buf)
+{
+	SYSFS_INFO("write_kbps %u avg_kbps %u bursts %u idle_flushes %u screen_off %d",
+		   tw->write_kbps, tw->avg_kbps, tw->stat_bursts,
+		   tw->stat_idle_flushes, tw->screen_off);
+
+	return snprintf(buf, PAGE_SIZE,
+			"write_kbps %u avg_kbps %u bursts %u idle_flushes %u screen_off %d",
+			tw->write_kbps, tw->avg_kbps, tw->stat_bursts,
+			tw->stat_idle_flushes, tw->screen_off);
+}
+
+/*
+ * Flush throughput is only known in steps of 10% of the buffer, so it is
+ * reported as percent of the buffer reclaimed per second of hibern8 flush.
+ */
+static ssize_t ufstw_sysfs_show_flush_stat(struct ufstw_lu *tw, char *buf)
+{
+	unsigned int fill_pct = 0;
+	u64 pct_per_s = 0;
+
+	if (tw->tw_available_buffer_size <= 10)
+		fill_pct = (10 - tw->tw_available_buffer_size) * 10;
+	if (tw->stat_flush_ms)
+		pct_per_s = div64_u64(tw->stat_flushed_pct * MSEC_PER_SEC,
+				      tw->stat_flush_ms);
+
+	SYSFS_INFO("flushes %u flush_ms %llu flushed_pct %llu pct_per_s %llu fill_pct %u",
+		   tw->stat_flushes, tw->stat_flush_ms, tw->stat_flushed_pct,
+		   pct_per_s, fill_pct);
+
+	return snprintf(buf, PAGE_SIZE,
+			"flushes %u flush_ms %llu flushed_pct %llu pct_per_s %llu fill_pct %u",
+			tw->stat_flushes, tw->stat_flush_ms,
+			tw->stat_flushed_pct, pct_per_s, fill_pct);
+}
+
+static ssize_t ufstw_sysfs_show_lifetime_stat(struct ufstw_lu *tw, char *buf)
+{
+	u64 written;
+
+	spin_lock_bh(&tw->lifetime_lock);
+	written = tw->stat_tw_write_sec;
+	spin_unlock_bh(&tw->lifetime_lock);
+
+	SYSFS_INFO("lifetime_est %u tw_written_mb %llu mb_since_step %llu mb_last_step %llu",
+		   tw->lifetime_last_est, written >> 11,
+		   (written - tw->lifetime_step_sec) >> 11,
+		   tw->lifetime_last_step_sec >> 11);
+
+	return snprintf(buf, PAGE_SIZE,
+			"lifetime_est %u tw_written_mb %llu mb_since_step %llu mb_last_step %llu",
+			tw->lifetime_last_est, written >> 11,
+			(written - tw->lifetime_step_sec) >> 11,
+			tw->lifetime_last_step_sec >> 11);
+}
+
 static struct ufstw_sysfs_entry ufstw_sysfs_entries[] = {
 	/* tw mode select */
 	define_sysfs_rw(tw_mode)
@@ -1700,6 +2034,13 @@ static struct ufstw_sysfs_entry ufstw_sysfs_entries[] = {
 	define_sysfs_rw(flush_th_max)
 	define_sysfs_rw(flush_th_min)
 
+	/* flush policy */
+	define_sysfs_rw(policy_enable)
+	define_sysfs_rw(policy_burst_kbps)
+	define_sysfs_ro(policy_stat)
+	define_sysfs_ro(flush_stat)
+	define_sysfs_ro(lifetime_stat)
+
 	/* device level */
 	define_sysfs_ro(version)
 	__ATTR_NULL
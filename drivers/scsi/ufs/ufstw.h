@@ -42,6 +42,7 @@
 #include <linux/sysfs.h>
 #include <linux/blktrace_api.h>
 #include <linux/blkdev.h>
+#include <linux/notifier.h>
 #include <scsi/scsi_cmnd.h>
 
 #include "../../../block/blk.h"
@@ -56,6 +57,12 @@
 #define UFSTW_MAX_LIFETIME_VALUE			0x0B
 #define MASK_UFSTW_LIFETIME_NOT_GUARANTEE	0x80000000
 
+/* write policy */
+#define UFSTW_POLICY_PERIOD_MS				1000
+#define UFSTW_POLICY_BURST_KBPS				51200
+#define UFSTW_POLICY_BURST_PERIODS			2
+#define UFSTW_POLICY_IDLE_PERIODS			3
+
 /*
  * UFSTW DEBUG
  */
@@ -117,7 +124,11 @@ struct ufstw_lu {
 	unsigned int tw_lifetime_est;
 	spinlock_t lifetime_lock;
 	u32 stat_write_sec;
+	u64 stat_tw_write_sec;
 	struct work_struct tw_lifetime_work;
+	unsigned int lifetime_last_est;
+	u64 lifetime_step_sec;		/* stat_tw_write_sec at last step */
+	u64 lifetime_last_step_sec;	/* sectors written for last step */
 
 	/* Attributes */
 	unsigned int tw_flush_status;
@@ -135,6 +146,28 @@ struct ufstw_lu {
 	unsigned int flush_th_max;
 	unsigned int flush_th_min;
 
+	/* write policy */
+	bool policy_enable;
+	bool policy_flush;		/* flush from flush_th_max once */
+	bool screen_off;
+	unsigned int burst_kbps;
+	atomic_long_t win_write_sec;
+	unsigned int write_kbps;
+	unsigned int avg_kbps;
+	unsigned int burst_periods;
+	unsigned int idle_periods;
+	struct delayed_work tw_policy_work;
+	struct notifier_block drm_notif;
+
+	/* flush statistics */
+	u32 stat_bursts;
+	u32 stat_idle_flushes;
+	u32 stat_flushes;
+	u64 stat_flush_ms;
+	u64 stat_flushed_pct;
+	unsigned long flush_start;
+	unsigned int flush_start_avail;
+
 	/* for sysfs */
 	struct kobject kobj;
 	struct mutex sysfs_lock;
@@ -26,6 +26,7 @@
 #include <linux/err.h>
 #include <linux/delay.h>
 #include <linux/sysfs.h>
+#include <linux/timekeeping.h>
 #include <linux/workqueue.h>
 
 #include <soc/qcom/subsystem_restart.h>
@@ -41,6 +42,7 @@
 #endif
 
 #define QTICK_DIV_FACTOR	0x249F
+#define TIME_SYNC_TRIES		3
 
 struct sns_ssc_control_s {
 	struct class *dev_class;
@@ -309,6 +311,30 @@ static u32 sns_read_qtimer(void)
 	return (u32)val;
 }
 
+/*
+ * Pair a QTimer read with CLOCK_BOOTTIME, keeping the tightest of a few
+ * tries so an interrupt between the reads doesn't skew the offset.
+ */
+static void sns_read_time_sync(struct dsps_time_sync *sync)
+{
+	u64 t0, t1, ticks;
+	int i;
+
+	sync->window_ns = U32_MAX;
+	for (i = 0; i < TIME_SYNC_TRIES; i++) {
+		t0 = ktime_get_boot_ns();
+		ticks = arch_counter_get_cntvct();
+		t1 = ktime_get_boot_ns();
+
+		if (t1 - t0 < sync->window_ns) {
+			sync->window_ns = t1 - t0;
+			sync->qtimer_ticks = ticks;
+			sync->boottime_ns = t0 + (t1 - t0) / 2;
+		}
+	}
+	sync->qtimer_hz = arch_timer_get_rate();
+}
+
 static int sensors_ssc_open(struct inode *ip, struct file *fp)
 {
 	return 0;
@@ -322,6 +348,7 @@ static int sensors_ssc_release(struct inode *inode, struct file *file)
 static long sensors_ssc_ioctl(struct file *file,
 			unsigned int cmd, unsigned long arg)
 {
+	struct dsps_time_sync sync;
 	int ret = 0;
 	u32 val = 0;
 
@@ -334,6 +361,12 @@ static long sensors_ssc_ioctl(struct file *file,
 		ret = put_user(val, (u32 __user *) arg);
 		break;
 
+	case DSPS_IOCTL_READ_TIME_SYNC:
+		sns_read_time_sync(&sync);
+		if (copy_to_user((void __user *)arg, &sync, sizeof(sync)))
+			ret = -EFAULT;
+		break;
+
 	default:
 		ret = -EINVAL;
 		break;
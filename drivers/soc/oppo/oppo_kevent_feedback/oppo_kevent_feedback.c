@@ -37,10 +37,11 @@ int upload_mm_kevent_feedback_data(enum OPPO_MM_DIRVER_FB_EVENT_MODULE module, u
 	len = strlen(payload);
 
 	size = sizeof(struct kernel_packet_info) + len + 1;
-	printk(KERN_INFO "kevent_send_to_user:size=%d\n", size);
+	pr_debug("kevent_send_to_user:size=%d\n", size);
 
-	buffer = kmalloc(size, GFP_ATOMIC);
-	memset(buffer, 0, size);
+	buffer = kzalloc(size, GFP_ATOMIC);
+	if (!buffer)
+		return -ENOMEM;
 	user_msg_info = (struct kernel_packet_info *)buffer;
 	user_msg_info->type = 1;
 
@@ -62,8 +63,8 @@ int upload_mm_kevent_feedback_data(enum OPPO_MM_DIRVER_FB_EVENT_MODULE module, u
 	user_msg_info->payload_length = len + 1;
 	memcpy(user_msg_info->payload, payload, len + 1);
 
-	kevent_send_to_user(user_msg_info);
-	msleep(20);
+	/* Batched and rate limited by the kevent worker, don't block here */
+	kevent_queue_to_user(user_msg_info);
 	kfree(buffer);
 	/* mutex_unlock(&mm_kevent_lock); */
 	return 0;
@@ -26,6 +26,7 @@
 #include <linux/types.h>
 #include <linux/spinlock.h>
 #include <linux/mm.h>
+#include <linux/vmalloc.h>
 #include <asm/arch_timer.h>
 #include <soc/qcom/boot_stats.h>
 
@@ -33,6 +34,7 @@
 #define BOOT_MARKER_MAX_LEN 50
 #define MSM_ARCH_TIMER_FREQ     19200000
 #define BOOTKPI_BUF_SIZE (2 * PAGE_SIZE)
+#define BOOT_TIMELINE_MAX_RECORDS 2048
 
 struct boot_marker {
 	char marker_name[BOOT_MARKER_MAX_LEN];
@@ -41,9 +43,33 @@ struct boot_marker {
 	spinlock_t slock;
 };
 
+struct boot_timeline_entry {
+	struct boot_timeline_record rec;
+	/* Initcall to resolve when the timeline is read */
+	void *fn;
+};
+
 static struct dentry *dent_bkpi, *dent_bkpi_status, *dent_mpm_timer;
 static struct boot_marker boot_marker_list;
 
+/*
+ * Slots are handed out once and never reused, so the timeline keeps the
+ * first BOOT_TIMELINE_MAX_RECORDS events after boot. A slot's type is
+ * written last and readers skip slots that are still being filled in.
+ */
+static struct boot_timeline_entry boot_timeline[BOOT_TIMELINE_MAX_RECORDS];
+static atomic_t boot_timeline_count;
+static atomic_t boot_timeline_dropped;
+
+/*
+ * Most initcalls and deferred probes return in a few microseconds; only
+ * keep the ones worth looking at so the slots last through boot.
+ */
+static unsigned int boot_timeline_min_us = 50;
+module_param_named(timeline_min_us, boot_timeline_min_us, uint, 0644);
+MODULE_PARM_DESC(timeline_min_us,
+		 "Shortest initcall or deferred probe kept in the timeline");
+
 /*
  * Caller is expected to hold the list spinlock.
  */
@@ -159,8 +185,71 @@ static void boot_marker_cleanup(void)
 	spin_unlock(&boot_marker_list.slock);
 }
 
+static struct boot_timeline_entry *boot_timeline_get(int type,
+		ktime_t start, int ret)
+{
+	s64 delta = ktime_us_delta(ktime_get(), start);
+	struct boot_timeline_entry *entry;
+	int idx;
+
+	if ((type == BOOT_TIMELINE_INITCALL ||
+	     type == BOOT_TIMELINE_DEFERRED_PROBE) &&
+	    delta < READ_ONCE(boot_timeline_min_us))
+		return NULL;
+
+	if (atomic_read(&boot_timeline_count) >= BOOT_TIMELINE_MAX_RECORDS)
+		goto full;
+	idx = atomic_inc_return(&boot_timeline_count) - 1;
+	if (idx >= BOOT_TIMELINE_MAX_RECORDS)
+		goto full;
+
+	entry = &boot_timeline[idx];
+	entry->rec.start_ns = ktime_to_ns(start);
+	entry->rec.duration_us = clamp_t(s64, delta, 0, U32_MAX);
+	entry->rec.ret = clamp_t(int, ret, S16_MIN, S16_MAX);
+	return entry;
+
+full:
+	atomic_inc(&boot_timeline_dropped);
+	return NULL;
+}
+
+void boot_timeline_event(int type, const char *name, ktime_t start, int ret)
+{
+	struct boot_timeline_entry *entry;
+
+	entry = boot_timeline_get(type, start, ret);
+	if (!entry)
+		return;
+
+	strlcpy(entry->rec.name, name, sizeof(entry->rec.name));
+	smp_store_release(&entry->rec.type, type);
+}
+EXPORT_SYMBOL(boot_timeline_event);
+
+void boot_timeline_initcall(void *fn, ktime_t start, int ret)
+{
+	struct boot_timeline_entry *entry;
+
+	entry = boot_timeline_get(BOOT_TIMELINE_INITCALL, start, ret);
+	if (!entry)
+		return;
+
+	/*
+	 * Looking up the symbol is deferred to the reader to keep it out of
+	 * boot, but a module drops its init symbols once it is loaded.
+	 */
+	if (is_module_address((unsigned long)fn))
+		snprintf(entry->rec.name, sizeof(entry->rec.name), "%ps", fn);
+	else
+		entry->fn = fn;
+	smp_store_release(&entry->rec.type, BOOT_TIMELINE_INITCALL);
+}
+
 void place_marker(const char *name)
 {
+	boot_timeline_event(BOOT_TIMELINE_MARKER, name, ktime_get(), 0);
+
 #ifdef CONFIG_HIBERNATION
 	if (!strcmp(name, "M - Image Kernel Start")) {
 		/* In restore phase, remove Cold Boot KPIs */
@@ -306,6 +395,67 @@ static const struct file_operations fops_mpm_timer = {
 	.mmap = mpm_timer_mmap,
 };
 
+static int boot_timeline_open(struct inode *inode, struct file *file)
+{
+	u64 sclk = msm_timer_get_sclk_ticks();
+	struct boot_timeline_record *rec;
+	struct boot_timeline_hdr *hdr;
+	unsigned int i, nr;
+
+	nr = min_t(unsigned int, atomic_read(&boot_timeline_count),
+		   BOOT_TIMELINE_MAX_RECORDS);
+	hdr = vzalloc(sizeof(*hdr) + nr * sizeof(*rec));
+	if (!hdr)
+		return -ENOMEM;
+
+	hdr->version = BOOT_TIMELINE_VERSION;
+	hdr->hdr_size = sizeof(*hdr);
+	hdr->rec_size = sizeof(*rec);
+	hdr->dropped = atomic_read(&boot_timeline_dropped);
+	hdr->mono_ns = ktime_get_ns();
+	hdr->sclk_ns = (sclk / TIMER_KHZ) * NSEC_PER_SEC +
+		div_u64((sclk % TIMER_KHZ) * NSEC_PER_SEC, TIMER_KHZ);
+
+	rec = (void *)hdr + hdr->hdr_size;
+	for (i = 0; i < nr; i++) {
+		struct boot_timeline_entry *entry = &boot_timeline[i];
+
+		if (!smp_load_acquire(&entry->rec.type))
+			continue;
+
+		*rec = entry->rec;
+		if (entry->fn)
+			snprintf(rec->name, sizeof(rec->name), "%ps", entry->fn);
+		rec++;
+		hdr->nr_records++;
+	}
+
+	file->private_data = hdr;
+	return 0;
+}
+
+static ssize_t boot_timeline_read(struct file *fp, char __user *user_buffer,
+		size_t count, loff_t *position)
+{
+	struct boot_timeline_hdr *hdr = fp->private_data;
+
+	return simple_read_from_buffer(user_buffer, count, position, hdr,
+			hdr->hdr_size + hdr->nr_records * hdr->rec_size);
+}
+
+static int boot_timeline_release(struct inode *inode, struct file *file)
+{
+	vfree(file->private_data);
+	return 0;
+}
+
+static const struct file_operations fops_timeline = {
+	.owner = THIS_MODULE,
+	.open = boot_timeline_open,
+	.read = boot_timeline_read,
+	.release = boot_timeline_release,
+};
+
 static int __init init_bootkpi(void)
 {
 	dent_bkpi = debugfs_create_dir("bootkpi", NULL);
@@ -333,6 +483,7 @@ static int __init init_bootkpi(void)
 	}
 
 	debugfs_create_dir("bootloader_log", dent_bkpi);
+	debugfs_create_file("timeline", 0400, dent_bkpi, NULL, &fops_timeline);
 
 	INIT_LIST_HEAD(&boot_marker_list.list);
 	spin_lock_init(&boot_marker_list.slock);
@@ -12,8 +12,12 @@
  */
 
 #include <linux/module.h>
+#include <linux/debugfs.h>
 #include <linux/io.h>
 #include <linux/iopoll.h>
+#include <linux/ktime.h>
+#include <linux/list.h>
+#include <linux/seq_file.h>
 #include <linux/printk.h>
 #include <linux/spinlock.h>
 #include <linux/of.h>
@@ -45,16 +49,49 @@ struct cx_ipeak_core_ops {
 	struct cx_ipeak_client* (*register_client)(int client_id);
 };
 
+/*
+ * vote_lock only protects the client list. Votes are serialized per
+ * client, so a client waiting for the limits manager to throttle never
+ * holds up another client dropping its vote, which is what ends the
+ * overlap and lets the wait finish.
+ */
 static struct cx_ipeak_device {
 	spinlock_t vote_lock;
 	void __iomem *tcsr_vptr;
 	struct cx_ipeak_core_ops *core_ops;
+	struct list_head clients;
+	struct dentry *debugfs;
 } device_ipeak;
 
+/**
+ * struct cx_ipeak_stats - mitigation history of a client
+ * @votes:	votes that reached the limits manager
+ * @timeouts:	votes refused because mitigation did not complete in time
+ * @vote_start:	when the current vote was set, 0 when not voting
+ * @voted_us:	total time spent voting, i.e. under mitigation
+ * @max_voted_us:	longest single vote
+ * @wait_us:	total time spent waiting for mitigation to take effect
+ * @max_wait_us:	longest such wait
+ */
+struct cx_ipeak_stats {
+	u64 votes;
+	u64 timeouts;
+	ktime_t vote_start;
+	u64 voted_us;
+	u64 max_voted_us;
+	u64 wait_us;
+	u64 max_wait_us;
+};
+
 struct cx_ipeak_client {
+	spinlock_t lock;
 	int vote_count;
 	unsigned int offset;
+	int client_id;
+	const char *name;
 	struct cx_ipeak_device *dev;
+	struct list_head node;
+	struct cx_ipeak_stats stats;
 };
 
 /**
@@ -90,6 +127,16 @@ struct cx_ipeak_client *cx_ipeak_register(struct device_node *dev_node,
 	if (device_ipeak.core_ops)
 		client =  device_ipeak.core_ops->register_client
 						(cx_spec.args[0]);
+
+	if (!IS_ERR_OR_NULL(client)) {
+		spin_lock_init(&client->lock);
+		client->client_id = cx_spec.args[0];
+		client->name = client_name;
+		spin_lock(&device_ipeak.vote_lock);
+		list_add_tail(&client->node, &device_ipeak.clients);
+		spin_unlock(&device_ipeak.vote_lock);
+	}
+
 	return client;
 }
 EXPORT_SYMBOL(cx_ipeak_register);
@@ -170,15 +217,47 @@ int cx_ipeak_update(struct cx_ipeak_client *client, bool vote)
 }
 EXPORT_SYMBOL(cx_ipeak_update);
 
+/* Caller must hold client->lock */
+static void cx_ipeak_account_wait(struct cx_ipeak_client *client,
+				  ktime_t start, int ret)
+{
+	struct cx_ipeak_stats *stats = &client->stats;
+	ktime_t now = ktime_get();
+	u64 us = ktime_us_delta(now, start);
+
+	stats->wait_us += us;
+	stats->max_wait_us = max(stats->max_wait_us, us);
+
+	if (ret) {
+		stats->timeouts++;
+	} else {
+		stats->votes++;
+		stats->vote_start = now;
+	}
+}
+
+/* Caller must hold client->lock */
+static void cx_ipeak_account_release(struct cx_ipeak_client *client)
+{
+	struct cx_ipeak_stats *stats = &client->stats;
+	u64 us = ktime_us_delta(ktime_get(), stats->vote_start);
+
+	stats->voted_us += us;
+	stats->max_voted_us = max(stats->max_voted_us, us);
+	stats->vote_start = 0;
+}
+
 static int cx_ipeak_update_v1(struct cx_ipeak_client *client, bool vote)
 {
 	unsigned int reg_val;
+	ktime_t start;
 	int ret = 0;
 
-	spin_lock(&client->dev->vote_lock);
+	spin_lock(&client->lock);
 
 	if (vote) {
 		if (client->vote_count == 0) {
+			start = ktime_get();
 			writel_relaxed(client->offset,
 				       client->dev->tcsr_vptr +
 				       TCSR_CXIP_LM_VOTE_SET_OFFSET);
@@ -193,6 +272,7 @@ static int cx_ipeak_update_v1(struct cx_ipeak_client *client, bool vote)
 						 TCSR_CXIP_LM_TRS_OFFSET,
 						 reg_val, !reg_val, 0,
 						 CXIP_POLL_TIMEOUT_US);
+			cx_ipeak_account_wait(client, start, ret);
 			if (ret) {
 				writel_relaxed(client->offset,
 					       client->dev->tcsr_vptr +
@@ -208,25 +288,28 @@ static int cx_ipeak_update_v1(struct cx_ipeak_client *client, bool vote)
 				writel_relaxed(client->offset,
 					       client->dev->tcsr_vptr +
 					       TCSR_CXIP_LM_VOTE_CLEAR_OFFSET);
+				cx_ipeak_account_release(client);
 			}
 		} else
 			ret = -EINVAL;
 	}
 
 done:
-	spin_unlock(&client->dev->vote_lock);
+	spin_unlock(&client->lock);
 	return ret;
 }
 
 static int cx_ipeak_update_v2(struct cx_ipeak_client *client, bool vote)
 {
 	unsigned int reg_val;
+	ktime_t start;
 	int ret = 0;
 
-	spin_lock(&client->dev->vote_lock);
+	spin_lock(&client->lock);
 
 	if (vote) {
 		if (client->vote_count == 0) {
+			start = ktime_get();
 			writel_relaxed(BIT(0),
 				       client->dev->tcsr_vptr +
 				       client->offset);
@@ -235,6 +318,7 @@ static int cx_ipeak_update_v2(struct cx_ipeak_client *client, bool vote)
 						 TCSR_CXIP_LM_DANGER_OFFSET,
 						 reg_val, !reg_val, 0,
 						 CXIP_POLL_TIMEOUT_US);
+			cx_ipeak_account_wait(client, start, ret);
 			if (ret) {
 				writel_relaxed(0,
 					       client->dev->tcsr_vptr +
@@ -250,6 +334,7 @@ static int cx_ipeak_update_v2(struct cx_ipeak_client *client, bool vote)
 				writel_relaxed(0,
 					       client->dev->tcsr_vptr +
 					       client->offset);
+				cx_ipeak_account_release(client);
 			}
 		} else {
 			ret = -EINVAL;
@@ -257,7 +342,7 @@ static int cx_ipeak_update_v2(struct cx_ipeak_client *client, bool vote)
 	}
 
 done:
-	spin_unlock(&client->dev->vote_lock);
+	spin_unlock(&client->lock);
 	return ret;
 }
 
@@ -269,10 +354,64 @@ static int cx_ipeak_update_v2(struct cx_ipeak_client *client, bool vote)
  */
 void cx_ipeak_unregister(struct cx_ipeak_client *client)
 {
+	if (IS_ERR_OR_NULL(client))
+		return;
+
+	spin_lock(&device_ipeak.vote_lock);
+	list_del(&client->node);
+	spin_unlock(&device_ipeak.vote_lock);
+
 	kfree(client);
 }
 EXPORT_SYMBOL(cx_ipeak_unregister);
 
+static int cx_ipeak_clients_show(struct seq_file *s, void *unused)
+{
+	struct cx_ipeak_client *client;
+	struct cx_ipeak_stats stats;
+	u64 voting_us;
+	int vote_count;
+
+	seq_puts(s, "id name vote_count votes timeouts voted_us max_voted_us ");
+	seq_puts(s, "wait_us max_wait_us\n");
+
+	spin_lock(&device_ipeak.vote_lock);
+	list_for_each_entry(client, &device_ipeak.clients, node) {
+		spin_lock(&client->lock);
+		stats = client->stats;
+		vote_count = client->vote_count;
+		spin_unlock(&client->lock);
+
+		/* Count a vote that is still held up to now */
+		voting_us = 0;
+		if (stats.vote_start)
+			voting_us = ktime_us_delta(ktime_get(),
+						   stats.vote_start);
+
+		seq_printf(s, "%d %s %d %llu %llu %llu %llu %llu %llu\n",
+			   client->client_id, client->name, vote_count,
+			   stats.votes,
+			   stats.timeouts, stats.voted_us + voting_us,
+			   max(stats.max_voted_us, voting_us), stats.wait_us,
+			   stats.max_wait_us);
+	}
+	spin_unlock(&device_ipeak.vote_lock);
+
+	return 0;
+}
+
+static int cx_ipeak_clients_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, cx_ipeak_clients_show, NULL);
+}
+
+static const struct file_operations cx_ipeak_clients_fops = {
+	.open = cx_ipeak_clients_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 struct cx_ipeak_core_ops core_ops_v1 = {
 	.update = cx_ipeak_update_v1,
 	.register_client = cx_ipeak_register_v1,
@@ -287,6 +426,9 @@ static int cx_ipeak_probe(struct platform_device *pdev)
 {
 	struct resource *res;
 
+	spin_lock_init(&device_ipeak.vote_lock);
+	INIT_LIST_HEAD(&device_ipeak.clients);
+
 	res = platform_get_resource(pdev, IORESOURCE_MEM, 0);
 	device_ipeak.tcsr_vptr = devm_ioremap_resource(&pdev->dev, res);
 	if (IS_ERR(device_ipeak.tcsr_vptr))
@@ -300,7 +442,11 @@ static int cx_ipeak_probe(struct platform_device *pdev)
 	else
 		device_ipeak.core_ops = NULL;
 
-	spin_lock_init(&device_ipeak.vote_lock);
+	device_ipeak.debugfs = debugfs_create_dir("cx_ipeak", NULL);
+	if (!IS_ERR_OR_NULL(device_ipeak.debugfs))
+		debugfs_create_file("clients", 0444, device_ipeak.debugfs,
+				    NULL, &cx_ipeak_clients_fops);
+
 	return 0;
 }
 
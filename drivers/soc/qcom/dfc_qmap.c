@@ -11,6 +11,7 @@
  * GNU General Public License for more details.
  */
 
+#include <linux/interrupt.h>
 #include <net/pkt_sched.h>
 #include <soc/qcom/rmnet_qmi.h>
 #include <soc/qcom/qmi_rmnet.h>
@@ -32,6 +33,10 @@
 #define QMAP_DFC_QUERY		12
 #define QMAP_DFC_END_MARKER	13
 
+/* Commands queued for the tasklet and acks packed into one frame */
+#define QMAP_CMD_Q_MAX		512
+#define QMAP_ACK_BATCH_MAX	16
+
 struct qmap_hdr {
 	u8	cd_pad;
 	u8	mux_id;
@@ -130,10 +135,13 @@ struct qmap_dfc_end_marker_cnf {
 } __aligned(1);
 
 static struct dfc_flow_status_ind_msg_v01 qmap_flow_ind;
+static struct dfc_flow_status_ind_msg_v01 qmap_ind_batch;
 static struct dfc_tx_link_status_ind_msg_v01 qmap_tx_ind;
 static struct dfc_qmi_data __rcu *qmap_dfc_data;
 static atomic_t qmap_txid;
 static void *rmnet_ctl_handle;
+static struct sk_buff_head qmap_cmd_q;
+static struct tasklet_struct qmap_cmd_tasklet;
 
 static void dfc_qmap_send_end_marker_cnf(struct qos_info *qos,
 					 u8 bearer_id, u16 seq, u32 tx_id);
@@ -163,6 +171,108 @@ static void dfc_qmap_send_inband_ack(struct dfc_qmi_data *dfc,
 	dev_queue_xmit(skb);
 }
 
+/* With UL aggregation the modem deaggregates MAP frames, so the acks of a
+ * batch can go out back to back in a single transfer.
+ */
+static void dfc_qmap_send_inband_acks(struct dfc_qmi_data *dfc,
+				      struct sk_buff_head *acks)
+{
+	struct sk_buff *skb, *nskb;
+	unsigned int len;
+	int i;
+
+	while (!skb_queue_empty(acks)) {
+		if (skb_queue_len(acks) == 1 ||
+		    !rmnet_get_ul_agg_enabled(dfc->rmnet_port))
+			goto send_one;
+
+		len = 0;
+		i = 0;
+		skb_queue_walk(acks, skb) {
+			if (++i > QMAP_ACK_BATCH_MAX)
+				break;
+			len += skb->len;
+		}
+
+		nskb = alloc_skb(len, GFP_ATOMIC);
+		if (!nskb)
+			goto send_one;
+
+		for (i = 0; i < QMAP_ACK_BATCH_MAX; i++) {
+			skb = __skb_dequeue(acks);
+			if (!skb)
+				break;
+
+			skb_put_data(nskb, skb->data, skb->len);
+			consume_skb(skb);
+		}
+
+		dfc_qmap_send_inband_ack(dfc, nskb);
+		continue;
+
+send_one:
+		dfc_qmap_send_inband_ack(dfc, __skb_dequeue(acks));
+	}
+}
+
+static void dfc_qmap_ind_batch_reset(void)
+{
+	memset(&qmap_ind_batch, 0, sizeof(qmap_ind_batch));
+	qmap_ind_batch.flow_status_valid = 1;
+	qmap_ind_batch.ancillary_info_valid = 1;
+}
+
+static void dfc_qmap_ind_batch_flush(struct dfc_qmi_data *dfc)
+{
+	if (!qmap_ind_batch.flow_status_len)
+		return;
+
+	qmap_ind_batch.ancillary_info_len = qmap_ind_batch.flow_status_len;
+	dfc_do_burst_flow_control(dfc, &qmap_ind_batch, false);
+	dfc_qmap_ind_batch_reset();
+}
+
+/* Grant indications carry the absolute grant, so a later indication for
+ * the same bearer supersedes an earlier one still in the batch. Entries
+ * are kept in the order in which bearers first show up. The ancillary
+ * info is kept at the same index as its flow status entry.
+ */
+static void dfc_qmap_ind_batch_add(struct dfc_qmi_data *dfc,
+				   struct qmap_dfc_ind *cmd)
+{
+	struct dfc_flow_status_info_type_v01 *fs;
+	struct dfc_ancillary_info_type_v01 *ai;
+	int i;
+
+	for (i = 0; i < qmap_ind_batch.flow_status_len; i++) {
+		fs = &qmap_ind_batch.flow_status[i];
+		if (fs->mux_id == cmd->hdr.mux_id &&
+		    fs->bearer_id == cmd->bearer_id)
+			goto update;
+	}
+
+	if (i == DFC_MAX_BEARERS_V01) {
+		dfc_qmap_ind_batch_flush(dfc);
+		i = 0;
+	}
+
+	qmap_ind_batch.flow_status_len = i + 1;
+	fs = &qmap_ind_batch.flow_status[i];
+	fs->mux_id = cmd->hdr.mux_id;
+	fs->bearer_id = cmd->bearer_id;
+
+update:
+	ai = &qmap_ind_batch.ancillary_info[i];
+	ai->mux_id = cmd->hdr.mux_id;
+	ai->bearer_id = cmd->bearer_id;
+	ai->reserved = cmd->tcp_bidir ? DFC_MASK_TCP_BIDIR : 0;
+
+	fs->num_bytes = ntohl(cmd->grant);
+	fs->seq_num = ntohs(cmd->seq_num);
+	fs->rx_bytes_valid = cmd->rx_bytes_valid;
+	fs->rx_bytes = cmd->rx_bytes_valid ? ntohl(cmd->rx_bytes) : 0;
+}
+
 static int dfc_qmap_handle_ind(struct dfc_qmi_data *dfc,
 			       struct sk_buff *skb)
 {
@@ -174,6 +284,9 @@ static int dfc_qmap_handle_ind(struct dfc_qmi_data *dfc,
 	cmd = (struct qmap_dfc_ind *)skb->data;
 
 	if (cmd->tx_info_valid) {
+		/* Keep ordering with the grants already batched */
+		dfc_qmap_ind_batch_flush(dfc);
+
 		memset(&qmap_tx_ind, 0, sizeof(qmap_tx_ind));
 		qmap_tx_ind.tx_status = cmd->tx_info;
 		qmap_tx_ind.bearer_info_valid = 1;
@@ -187,29 +300,15 @@ static int dfc_qmap_handle_ind(struct dfc_qmi_data *dfc,
 		goto done;
 	}
 
-	memset(&qmap_flow_ind, 0, sizeof(qmap_flow_ind));
-	qmap_flow_ind.flow_status_valid = 1;
-	qmap_flow_ind.flow_status_len = 1;
-	qmap_flow_ind.flow_status[0].mux_id = cmd->hdr.mux_id;
-	qmap_flow_ind.flow_status[0].bearer_id = cmd->bearer_id;
-	qmap_flow_ind.flow_status[0].num_bytes = ntohl(cmd->grant);
-	qmap_flow_ind.flow_status[0].seq_num = ntohs(cmd->seq_num);
-
-	if (cmd->rx_bytes_valid) {
-		qmap_flow_ind.flow_status[0].rx_bytes_valid = 1;
-		qmap_flow_ind.flow_status[0].rx_bytes = ntohl(cmd->rx_bytes);
-	}
-
-	if (cmd->tcp_bidir) {
-		qmap_flow_ind.ancillary_info_valid = 1;
-		qmap_flow_ind.ancillary_info_len = 1;
-		qmap_flow_ind.ancillary_info[0].mux_id = cmd->hdr.mux_id;
-		qmap_flow_ind.ancillary_info[0].bearer_id = cmd->bearer_id;
-		qmap_flow_ind.ancillary_info[0].reserved = DFC_MASK_TCP_BIDIR;
+	/* A grant for all bearers must not be reordered with the others */
+	if (cmd->bearer_id == 0xFF) {
+		dfc_qmap_ind_batch_flush(dfc);
+		dfc_qmap_ind_batch_add(dfc, cmd);
+		dfc_qmap_ind_batch_flush(dfc);
+	} else {
+		dfc_qmap_ind_batch_add(dfc, cmd);
 	}
 
-	dfc_do_burst_flow_control(dfc, &qmap_flow_ind, false);
-
 done:
 	return QMAP_CMD_ACK;
 }
@@ -299,38 +398,16 @@ static int dfc_qmap_handle_end_marker_req(struct dfc_qmi_data *dfc,
 	return QMAP_CMD_DONE;
 }
 
-static void dfc_qmap_cmd_handler(struct sk_buff *skb)
+static void dfc_qmap_process_cmd(struct dfc_qmi_data *dfc,
+				 struct sk_buff *skb,
+				 struct sk_buff_head *acks)
 {
-	struct qmap_cmd_hdr *cmd;
-	struct dfc_qmi_data *dfc;
-	int rc = QMAP_CMD_DONE;
-
-	if (!skb)
-		return;
-
-	trace_dfc_qmap(skb->data, skb->len, true);
-
-	if (skb->len < sizeof(struct qmap_cmd_hdr))
-		goto free_skb;
-
-	cmd = (struct qmap_cmd_hdr *)skb->data;
-	if (!cmd->cd_bit || skb->len != ntohs(cmd->pkt_len) + QMAP_HDR_LEN)
-		goto free_skb;
-
-	if (cmd->cmd_name == QMAP_DFC_QUERY) {
-		if (cmd->cmd_type != QMAP_CMD_ACK)
-			goto free_skb;
-	} else if (cmd->cmd_type != QMAP_CMD_REQUEST) {
-		goto free_skb;
-	}
-
-	rcu_read_lock();
+	struct qmap_cmd_hdr *cmd = (struct qmap_cmd_hdr *)skb->data;
+	int rc;
 
-	dfc = rcu_dereference(qmap_dfc_data);
-	if (!dfc || READ_ONCE(dfc->restart_state)) {
-		rcu_read_unlock();
-		goto free_skb;
-	}
+	/* Everything else acts on the current grant state */
+	if (cmd->cmd_name != QMAP_DFC_IND)
+		dfc_qmap_ind_batch_flush(dfc);
 
 	switch (cmd->cmd_name) {
 	case QMAP_DFC_IND:
@@ -354,15 +431,91 @@ static void dfc_qmap_cmd_handler(struct sk_buff *skb)
 	if (rc != QMAP_CMD_DONE) {
 		cmd->cmd_type = rc;
 		if (cmd->cmd_name == QMAP_DFC_IND)
-			dfc_qmap_send_inband_ack(dfc, skb);
+			__skb_queue_tail(acks, skb);
 		else
 			dfc_qmap_send_cmd(skb);
 
+		return;
+	}
+
+	kfree_skb(skb);
+}
+
+/* Process all queued commands in one pass. Grant indications are batched
+ * into a single flow control update and their acks sent together.
+ */
+static void dfc_qmap_cmd_tasklet_fn(unsigned long data)
+{
+	struct sk_buff_head cmds, acks;
+	struct dfc_qmi_data *dfc;
+	struct sk_buff *skb;
+	unsigned long flags;
+
+	__skb_queue_head_init(&cmds);
+	__skb_queue_head_init(&acks);
+
+	spin_lock_irqsave(&qmap_cmd_q.lock, flags);
+	skb_queue_splice_init(&qmap_cmd_q, &cmds);
+	spin_unlock_irqrestore(&qmap_cmd_q.lock, flags);
+
+	rcu_read_lock();
+
+	dfc = rcu_dereference(qmap_dfc_data);
+	if (!dfc || READ_ONCE(dfc->restart_state)) {
 		rcu_read_unlock();
+		__skb_queue_purge(&cmds);
+		return;
+	}
+
+	dfc_qmap_ind_batch_reset();
+
+	while ((skb = __skb_dequeue(&cmds)))
+		dfc_qmap_process_cmd(dfc, skb, &acks);
+
+	dfc_qmap_ind_batch_flush(dfc);
+	dfc_qmap_send_inband_acks(dfc, &acks);
+
+	rcu_read_unlock();
+}
+
+static void dfc_qmap_cmd_handler(struct sk_buff *skb)
+{
+	struct qmap_cmd_hdr *cmd;
+	struct dfc_qmi_data *dfc;
+
+	if (!skb)
 		return;
+
+	trace_dfc_qmap(skb->data, skb->len, true);
+
+	if (skb->len < sizeof(struct qmap_cmd_hdr))
+		goto free_skb;
+
+	cmd = (struct qmap_cmd_hdr *)skb->data;
+	if (!cmd->cd_bit || skb->len != ntohs(cmd->pkt_len) + QMAP_HDR_LEN)
+		goto free_skb;
+
+	if (cmd->cmd_name == QMAP_DFC_QUERY) {
+		if (cmd->cmd_type != QMAP_CMD_ACK)
+			goto free_skb;
+	} else if (cmd->cmd_type != QMAP_CMD_REQUEST) {
+		goto free_skb;
+	}
+
+	rcu_read_lock();
+
+	dfc = rcu_dereference(qmap_dfc_data);
+	if (!dfc || READ_ONCE(dfc->restart_state) ||
+	    skb_queue_len(&qmap_cmd_q) >= QMAP_CMD_Q_MAX) {
+		rcu_read_unlock();
+		goto free_skb;
 	}
 
+	skb_queue_tail(&qmap_cmd_q, skb);
+	tasklet_schedule(&qmap_cmd_tasklet);
+
 	rcu_read_unlock();
+	return;
 
 free_skb:
 	kfree_skb(skb);
@@ -497,6 +650,8 @@ int dfc_qmap_client_init(void *port, int index, struct svc_info *psvc,
 	rcu_assign_pointer(qmap_dfc_data, data);
 
 	atomic_set(&qmap_txid, 0);
+	skb_queue_head_init(&qmap_cmd_q);
+	tasklet_init(&qmap_cmd_tasklet, dfc_qmap_cmd_tasklet_fn, 0);
 
 	rmnet_ctl_handle = rmnet_ctl_register_client(&cb);
 	if (!rmnet_ctl_handle)
@@ -529,6 +684,9 @@ void dfc_qmap_client_exit(void *dfc_data)
 	RCU_INIT_POINTER(qmap_dfc_data, NULL);
 	synchronize_rcu();
 
+	tasklet_kill(&qmap_cmd_tasklet);
+	skb_queue_purge(&qmap_cmd_q);
+
 	kfree(data);
 
 	pr_info("DFC QMAP exit\n");
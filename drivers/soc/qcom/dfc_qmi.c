@@ -954,6 +954,9 @@ static int dfc_all_bearer_flow_ctl(struct net_device *dev,
 		bearer->last_grant = fc_info->num_bytes;
 		bearer->last_seq = fc_info->seq_num;
 		bearer->last_adjusted_grant = fc_info->num_bytes;
+		bearer->stats.grant_ind++;
+		if (!fc_info->num_bytes)
+			bearer->stats.grant_zero++;
 
 		dfc_bearer_flow_ctl(dev, bearer, qos);
 	}
@@ -1040,6 +1043,9 @@ static int dfc_update_fc_map(struct net_device *dev, struct qos_info *qos,
 					  itm->seq, DFC_ACK_TYPE_DISABLE);
 
 		itm->grant_size = adjusted_grant;
+		itm->stats.grant_ind++;
+		if (!adjusted_grant)
+			itm->stats.grant_zero++;
 
 		/* No further query if the adjusted grant is less
 		 * than 20% of the original grant. Add to watch to
@@ -1513,6 +1519,7 @@ void dfc_qmi_burst_check(struct net_device *dev, struct qos_info *qos,
 			     len, mark, bearer->grant_size);
 
 	bearer->bytes_in_flight += len;
+	bearer->stats.tx_bytes += len;
 
 	if (!bearer->grant_size)
 		goto out;
@@ -1525,13 +1532,16 @@ void dfc_qmi_burst_check(struct net_device *dev, struct qos_info *qos,
 
 	if (start_grant > bearer->grant_thresh &&
 	    bearer->grant_size <= bearer->grant_thresh) {
+		bearer->stats.thresh_ack++;
 		dfc_send_ack(dev, bearer->bearer_id,
 			     bearer->seq, qos->mux_id,
 			     DFC_ACK_TYPE_THRESHOLD);
 	}
 
-	if (!bearer->grant_size)
+	if (!bearer->grant_size) {
+		bearer->stats.grant_exhausted++;
 		dfc_bearer_flow_ctl(dev, bearer, qos);
+	}
 
 out:
 	spin_unlock_bh(&qos->qos_lock);
@@ -23,7 +23,9 @@
 #include <linux/slab.h>
 #include <linux/io.h>
 #include <linux/err.h>
+#include <linux/math64.h>
 #include <linux/mfd/syscon.h>
+#include <linux/moduleparam.h>
 #include <linux/regmap.h>
 #include <linux/soc/qcom/llcc-qcom.h>
 
@@ -56,12 +58,57 @@
 #define LLCC_TRP_PCB_ACT 0x21F04
 #define LLCC_TRP_SCID_DIS_CAP_ALLOC 0x21F00
 
+/* A managed slice is never shrunk below max_cap >> LLCC_MIN_CAP_SHIFT */
+#define LLCC_MIN_CAP_SHIFT 2
+
+/*
+ * Slices that are active but see little traffic, or that miss most of the
+ * time, give up part of their max capacity to the other slices. Usage is
+ * reported per slice by the perfmon slice monitor.
+ */
+static bool auto_resize;
+module_param(auto_resize, bool, 0644);
+MODULE_PARM_DESC(auto_resize, "Resize active slices based on their hit rate");
+
+static unsigned int min_hit_pct = 30;
+module_param(min_hit_pct, uint, 0644);
+MODULE_PARM_DESC(min_hit_pct, "Hit rate below which a slice is shrunk");
+
+static unsigned int idle_accesses = 1000;
+module_param(idle_accesses, uint, 0644);
+MODULE_PARM_DESC(idle_accesses,
+		 "Accesses per sample below which a slice is idle");
+
+static unsigned int shrink_samples = 3;
+module_param(shrink_samples, uint, 0644);
+MODULE_PARM_DESC(shrink_samples,
+		 "Consecutive poor samples before a slice is shrunk");
+
+/**
+ * Usage of a slice as reported by the perfmon slice monitor
+ * @accesses: cumulative accesses seen on the slice
+ * @hits: cumulative hits seen on the slice
+ * @last_hit_pct: hit rate of the last sample
+ * @cur_cap: max capacity currently programmed, in KB
+ * @poor_samples: consecutive samples that were idle or had a low hit rate
+ * @resizes: number of times the manager changed the max capacity
+ */
+struct llcc_slice_usage {
+	u64 accesses;
+	u64 hits;
+	u32 last_hit_pct;
+	u32 cur_cap;
+	u32 poor_samples;
+	u32 resizes;
+};
+
 /**
  * Driver data for llcc
  * @llcc_virt_base: base address for llcc controller
  * @slice_data: pointer to llcc slice config data
  * @sz: Size of the config data table
  * @llcc_slice_map: Bit map to track the active slice ids
+ * @usage: per slice usage, indexed by slice id
  */
 struct llcc_drv_data {
 	struct regmap *llcc_map;
@@ -73,8 +120,11 @@ struct llcc_drv_data {
 	u32 no_banks;
 	unsigned long *llcc_slice_map;
 	bool cap_based_alloc_and_pwr_collapse;
+	struct llcc_slice_usage *usage;
 };
 
+static struct llcc_drv_data *llcc_drv;
+
 /* Get the slice entry by index */
 static struct llcc_slice_desc *llcc_slice_get_entry(struct device *dev, int n)
 {
@@ -198,6 +248,59 @@ static int llcc_update_act_ctrl(struct llcc_drv_data *drv, u32 sid,
 	return -ETIMEDOUT;
 }
 
+static const struct llcc_slice_config *llcc_slice_cfg(
+		struct llcc_drv_data *drv, u32 sid)
+{
+	u32 i;
+
+	for (i = 0; i < drv->llcc_config_data_sz; i++)
+		if (drv->slice_data[i].slice_id == sid)
+			return &drv->slice_data[i];
+
+	return NULL;
+}
+
+static u32 llcc_attr1_val(struct llcc_drv_data *drv,
+			  const struct llcc_slice_config *cfg, u32 max_cap)
+{
+	u32 attr1_val;
+	u32 max_cap_cacheline;
+
+	attr1_val = cfg->cache_mode;
+	attr1_val |= (cfg->probe_target_ways << ATTR1_PROBE_TARGET_WAYS_SHIFT);
+	attr1_val |= (cfg->fixed_size << ATTR1_FIXED_SIZE_SHIFT);
+	attr1_val |= (cfg->priority << ATTR1_PRIORITY_SHIFT);
+
+	max_cap_cacheline = MAX_CAP_TO_BYTES(max_cap);
+
+	/* LLCC instances can vary for each target.
+	 * The SW writes to broadcast register which gets propagated
+	 * to each llcc instace (llcc0,.. llccN).
+	 * Since the size of the memory is divided equally amongst the
+	 * llcc instances, we need to configure the max cap accordingly.
+	 */
+	max_cap_cacheline = (max_cap_cacheline / drv->no_banks);
+	max_cap_cacheline >>= CACHE_LINE_SIZE_SHIFT;
+	attr1_val |= (max_cap_cacheline << ATTR1_MAX_CAP_SHIFT);
+
+	return attr1_val;
+}
+
+/* Called with slice_mutex held */
+static void llcc_slice_set_cap(struct llcc_drv_data *drv, u32 sid, u32 cap)
+{
+	const struct llcc_slice_config *cfg = llcc_slice_cfg(drv, sid);
+	struct llcc_slice_usage *usage = &drv->usage[sid];
+
+	if (!cfg || usage->cur_cap == cap)
+		return;
+
+	regmap_write(drv->llcc_map, drv->b_off + LLCC_TRP_ATTR1_CFGn(sid),
+		     llcc_attr1_val(drv, cfg, cap));
+	usage->cur_cap = cap;
+	usage->resizes++;
+}
+
 /**
  * llcc_slice_activate - Activate the llcc slice
  * @desc: Pointer to llcc slice descriptor
@@ -235,6 +338,8 @@ int llcc_slice_activate(struct llcc_slice_desc *desc)
 				  DEACTIVATE);
 
 	__set_bit(desc->llcc_slice_id, drv->llcc_slice_map);
+	if (desc->llcc_slice_id < drv->max_slices)
+		drv->usage[desc->llcc_slice_id].poor_samples = 0;
 	mutex_unlock(&drv->slice_mutex);
 
 	return rc;
@@ -253,6 +358,7 @@ int llcc_slice_deactivate(struct llcc_slice_desc *desc)
 	u32 act_ctrl_val;
 	int rc = -EINVAL;
 	struct llcc_drv_data *drv;
+	const struct llcc_slice_config *cfg;
 
 	if (desc == NULL) {
 		pr_err("Input descriptor supplied is invalid\n");
@@ -277,6 +383,11 @@ int llcc_slice_deactivate(struct llcc_slice_desc *desc)
 				  ACTIVATE);
 
 	__clear_bit(desc->llcc_slice_id, drv->llcc_slice_map);
+
+	/* The next session of the client starts with the full slice */
+	cfg = llcc_slice_cfg(drv, desc->llcc_slice_id);
+	if (cfg && desc->llcc_slice_id < drv->max_slices)
+		llcc_slice_set_cap(drv, desc->llcc_slice_id, cfg->max_cap);
 	mutex_unlock(&drv->slice_mutex);
 
 	return rc;
@@ -315,6 +426,88 @@ size_t llcc_get_slice_size(struct llcc_slice_desc *desc)
 }
 EXPORT_SYMBOL(llcc_get_slice_size);
 
+/**
+ * llcc_slice_report_usage - feed a usage sample of a slice to the manager
+ * @sid: llcc slice id
+ * @accesses: accesses seen on the slice during the sample
+ * @hits: hits seen on the slice during the sample
+ *
+ * With auto_resize set, an active slice that stays idle or keeps a low
+ * hit rate for shrink_samples samples has its max capacity halved, down
+ * to a quarter of its configured size. A sample that is busy and hits
+ * well doubles it back up to the configured size. Fixed size slices are
+ * only accounted.
+ */
+void llcc_slice_report_usage(u32 sid, u64 accesses, u64 hits)
+{
+	struct llcc_drv_data *drv = llcc_drv;
+	const struct llcc_slice_config *cfg;
+	struct llcc_slice_usage *usage;
+	u32 min_cap, cap;
+	bool poor;
+
+	if (!drv || sid >= drv->max_slices)
+		return;
+
+	mutex_lock(&drv->slice_mutex);
+	usage = &drv->usage[sid];
+	usage->accesses += accesses;
+	usage->hits += hits;
+	usage->last_hit_pct = accesses ?
+		div64_u64(min(hits, accesses) * 100, accesses) : 0;
+
+	cfg = llcc_slice_cfg(drv, sid);
+	if (!auto_resize || !cfg || cfg->fixed_size ||
+	    !test_bit(sid, drv->llcc_slice_map))
+		goto out;
+
+	poor = accesses < idle_accesses || usage->last_hit_pct < min_hit_pct;
+	cap = usage->cur_cap;
+	if (!poor) {
+		usage->poor_samples = 0;
+		cap = min(cap * 2, cfg->max_cap);
+	} else if (++usage->poor_samples >= shrink_samples) {
+		usage->poor_samples = 0;
+		min_cap = max(cfg->max_cap >> LLCC_MIN_CAP_SHIFT, 1U);
+		cap = max(cap / 2, min_cap);
+	}
+
+	llcc_slice_set_cap(drv, sid, cap);
+out:
+	mutex_unlock(&drv->slice_mutex);
+}
+EXPORT_SYMBOL(llcc_slice_report_usage);
+
+static ssize_t slice_usage_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct llcc_drv_data *drv = dev_get_drvdata(dev);
+	const struct llcc_slice_config *cfg;
+	struct llcc_slice_usage *usage;
+	ssize_t cnt = 0;
+	u32 i;
+
+	mutex_lock(&drv->slice_mutex);
+	for (i = 0; i < drv->llcc_config_data_sz; i++) {
+		cfg = &drv->slice_data[i];
+		if (cfg->slice_id >= drv->max_slices)
+			continue;
+
+		usage = &drv->usage[cfg->slice_id];
+		cnt += scnprintf(buf + cnt, PAGE_SIZE - cnt,
+			"SCID %02d %8s accesses %llu hits %llu last %u%% cap %u/%u KB resizes %u\n",
+			cfg->slice_id,
+			test_bit(cfg->slice_id, drv->llcc_slice_map) ?
+			"ACTIVE" : "DEACTIVE", usage->accesses, usage->hits,
+			usage->last_hit_pct, usage->cur_cap, cfg->max_cap,
+			usage->resizes);
+	}
+	mutex_unlock(&drv->slice_mutex);
+
+	return cnt;
+}
+static DEVICE_ATTR_RO(slice_usage);
+
 static void qcom_llcc_cfg_program(struct platform_device *pdev)
 {
 	int i;
@@ -324,7 +517,6 @@ static void qcom_llcc_cfg_program(struct platform_device *pdev)
 	u32 attr0_val;
 	u32 cad_off;
 	u32 pcb_off;
-	u32 max_cap_cacheline;
 	u32 sz;
 	u32 pcb = 0;
 	u32 cad = 0;
@@ -342,24 +534,11 @@ static void qcom_llcc_cfg_program(struct platform_device *pdev)
 		attr1_cfg = b_off + LLCC_TRP_ATTR1_CFGn(llcc_table[i].slice_id);
 		attr0_cfg = b_off + LLCC_TRP_ATTR0_CFGn(llcc_table[i].slice_id);
 
-		attr1_val = llcc_table[i].cache_mode;
-		attr1_val |= (llcc_table[i].probe_target_ways <<
-				ATTR1_PROBE_TARGET_WAYS_SHIFT);
-		attr1_val |= (llcc_table[i].fixed_size <<
-				ATTR1_FIXED_SIZE_SHIFT);
-		attr1_val |= (llcc_table[i].priority << ATTR1_PRIORITY_SHIFT);
-
-		max_cap_cacheline = MAX_CAP_TO_BYTES(llcc_table[i].max_cap);
-
-		/* LLCC instances can vary for each target.
-		 * The SW writes to broadcast register which gets propagated
-		 * to each llcc instace (llcc0,.. llccN).
-		 * Since the size of the memory is divided equally amongst the
-		 * llcc instances, we need to configure the max cap accordingly.
-		 */
-		max_cap_cacheline = (max_cap_cacheline / drv->no_banks);
-		max_cap_cacheline >>= CACHE_LINE_SIZE_SHIFT;
-		attr1_val |= (max_cap_cacheline << ATTR1_MAX_CAP_SHIFT);
+		attr1_val = llcc_attr1_val(drv, &llcc_table[i],
+					   llcc_table[i].max_cap);
+		if (llcc_table[i].slice_id < drv->max_slices)
+			drv->usage[llcc_table[i].slice_id].cur_cap =
+				llcc_table[i].max_cap;
 
 		attr0_val = llcc_table[i].res_ways & ATTR0_RES_WAYS_MASK;
 		attr0_val |= llcc_table[i].bonus_ways << ATR0_BONUS_WAYS_SHIFT;
@@ -444,6 +623,14 @@ int qcom_llcc_probe(struct platform_device *pdev,
 		return PTR_ERR(drv_data->llcc_slice_map);
 	}
 
+	drv_data->usage = kcalloc(drv_data->max_slices,
+				  sizeof(*drv_data->usage), GFP_KERNEL);
+	if (!drv_data->usage) {
+		kfree(drv_data->llcc_slice_map);
+		devm_kfree(&pdev->dev, drv_data);
+		return -ENOMEM;
+	}
+
 	bitmap_zero(drv_data->llcc_slice_map, drv_data->max_slices);
 	drv_data->slice_data = llcc_cfg;
 	drv_data->llcc_config_data_sz = sz;
@@ -452,6 +639,11 @@ int qcom_llcc_probe(struct platform_device *pdev,
 
 	qcom_llcc_cfg_program(pdev);
 
+	if (device_create_file(dev, &dev_attr_slice_usage))
+		dev_err(dev, "Unable to create slice_usage\n");
+
+	llcc_drv = drv_data;
+
 	return rc;
 }
 EXPORT_SYMBOL(qcom_llcc_probe);
@@ -462,7 +654,10 @@ int qcom_llcc_remove(struct platform_device *pdev)
 
 	drv_data = platform_get_drvdata(pdev);
 
+	llcc_drv = NULL;
+	device_remove_file(&pdev->dev, &dev_attr_slice_usage);
 	mutex_destroy(&drv_data->slice_mutex);
+	kfree(drv_data->usage);
 	kfree(drv_data->llcc_slice_map);
 	devm_kfree(&pdev->dev, drv_data);
 	platform_set_drvdata(pdev, NULL);
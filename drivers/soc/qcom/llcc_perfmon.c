@@ -23,6 +23,7 @@
 #include <linux/soc/qcom/llcc-qcom.h>
 #include <linux/module.h>
 #include <linux/clk.h>
+#include <linux/workqueue.h>
 #include "llcc_events.h"
 #include "llcc_perfmon.h"
 
@@ -79,6 +80,9 @@ struct event_port_ops {
  * @clk:		clock node to enable qdss
  * @num_mc:		number of MCS
  * @version:		Version information of llcc block
+ * @slice_work:		work sampling one SCID per slice monitor window
+ * @slice_window_ms:	slice monitor window, zero when it is stopped
+ * @slice_scid:		SCID the TRP filter currently matches
  */
 struct llcc_perfmon_private {
 	struct regmap *llcc_map;
@@ -97,6 +101,9 @@ struct llcc_perfmon_private {
 	struct clk *clock;
 	unsigned int num_mc;
 	unsigned int version;
+	struct delayed_work slice_work;
+	unsigned int slice_window_ms;
+	unsigned int slice_scid;
 };
 
 static inline void llcc_bcast_write(struct llcc_perfmon_private *llcc_priv,
@@ -271,6 +278,12 @@ static ssize_t perfmon_configure_store(struct device *dev,
 	char *token, *delim = DELIM_CHAR;
 
 	mutex_lock(&llcc_priv->mutex);
+	if (llcc_priv->slice_window_ms) {
+		pr_err("slice monitor running, stop it & try again\n");
+		mutex_unlock(&llcc_priv->mutex);
+		return -EBUSY;
+	}
+
 	if (llcc_priv->configured_counters) {
 		pr_err("Counters configured already, remove & try again\n");
 		mutex_unlock(&llcc_priv->mutex);
@@ -447,6 +460,11 @@ static ssize_t perfmon_filter_config_store(struct device *dev,
 		return count;
 	}
 
+	if (llcc_priv->slice_window_ms) {
+		pr_err("slice monitor running, stop it & try again\n");
+		return -EBUSY;
+	}
+
 	mutex_lock(&llcc_priv->mutex);
 
 	token = strsep((char **)&buf, delim);
@@ -569,6 +587,12 @@ static ssize_t perfmon_start_store(struct device *dev,
 		return -EINVAL;
 
 	mutex_lock(&llcc_priv->mutex);
+	if (llcc_priv->slice_window_ms) {
+		pr_err("slice monitor running, stop it & try again\n");
+		mutex_unlock(&llcc_priv->mutex);
+		return -EBUSY;
+	}
+
 	if (start) {
 		if (!llcc_priv->configured_counters) {
 			pr_err("start failed. perfmon not configured\n");
@@ -676,6 +700,179 @@ static ssize_t perfmon_scid_status_show(struct device *dev,
 	return cnt;
 }
 
+/*
+ * The slice monitor counts TRP accesses and hits with the TRP SCID filter
+ * and moves the filter to the next active SCID every window, so every
+ * active slice is sampled in turn with only two counters. Each sample is
+ * handed to the slice driver, which accounts it and may resize the slice.
+ */
+static unsigned long long slice_counter_read(
+		struct llcc_perfmon_private *llcc_priv, unsigned int counter)
+{
+	unsigned long long total = 0;
+	unsigned int j;
+	uint32_t val;
+
+	for (j = 0; j < llcc_priv->num_banks; j++) {
+		regmap_read(llcc_priv->llcc_map, llcc_priv->bank_off[j] +
+				LLCC_COUNTER_n_VALUE(counter), &val);
+		total += val;
+	}
+
+	return total;
+}
+
+static bool slice_scid_active(struct llcc_perfmon_private *llcc_priv,
+		unsigned int scid)
+{
+	uint32_t val;
+
+	llcc_bcast_read(llcc_priv, TRP_SCID_n_STATUS(scid), &val);
+	return val & TRP_SCID_STATUS_ACTIVE_MASK;
+}
+
+static void slice_monitor_select(struct llcc_perfmon_private *llcc_priv)
+{
+	struct event_port_ops *port_ops = llcc_priv->port_ops[EVENT_PORT_TRP];
+	unsigned int i, scid;
+
+	for (i = 1; i <= SCID_MAX; i++) {
+		scid = (llcc_priv->slice_scid + i) % SCID_MAX;
+		if (slice_scid_active(llcc_priv, scid))
+			break;
+	}
+
+	llcc_priv->slice_scid = scid;
+	port_ops->event_filter_config(llcc_priv, SCID, scid, true);
+
+	/* Drop whatever was counted while the filter was moving */
+	llcc_bcast_write(llcc_priv, PERFMON_DUMP, MONITOR_DUMP);
+}
+
+static void slice_monitor_work(struct work_struct *work)
+{
+	struct llcc_perfmon_private *llcc_priv = container_of(to_delayed_work(
+			work), struct llcc_perfmon_private, slice_work);
+	unsigned long long accesses, hits;
+
+	mutex_lock(&llcc_priv->mutex);
+	if (!llcc_priv->slice_window_ms) {
+		mutex_unlock(&llcc_priv->mutex);
+		return;
+	}
+
+	llcc_bcast_write(llcc_priv, PERFMON_DUMP, MONITOR_DUMP);
+	accesses = slice_counter_read(llcc_priv, 0);
+	hits = slice_counter_read(llcc_priv, 1);
+	if (slice_scid_active(llcc_priv, llcc_priv->slice_scid))
+		llcc_slice_report_usage(llcc_priv->slice_scid, accesses, hits);
+
+	slice_monitor_select(llcc_priv);
+	queue_delayed_work(system_power_efficient_wq, &llcc_priv->slice_work,
+			msecs_to_jiffies(llcc_priv->slice_window_ms));
+	mutex_unlock(&llcc_priv->mutex);
+}
+
+static int slice_monitor_start(struct llcc_perfmon_private *llcc_priv,
+		unsigned int window_ms)
+{
+	struct event_port_ops *port_ops = llcc_priv->port_ops[EVENT_PORT_TRP];
+	int ret;
+
+	if (llcc_priv->configured_counters) {
+		pr_err("Counters configured already, remove & try again\n");
+		return -EBUSY;
+	}
+
+	ret = clk_prepare_enable(llcc_priv->clock);
+	if (ret)
+		return ret;
+
+	llcc_priv->filtered_ports |= 1 << EVENT_PORT_TRP;
+	port_ops->event_config(llcc_priv, TRP_ANY_ACCESS, 0, true);
+	port_ops->event_config(llcc_priv, TRP_ANY_HIT, 1, true);
+	llcc_bcast_modify(llcc_priv, PERFMON_MODE, MANUAL_MODE | MONITOR_EN,
+			PERFMON_MODE_MONITOR_MODE_MASK |
+			PERFMON_MODE_MONITOR_EN_MASK);
+
+	llcc_priv->slice_window_ms = window_ms;
+	llcc_priv->slice_scid = SCID_MAX - 1;
+	slice_monitor_select(llcc_priv);
+	queue_delayed_work(system_power_efficient_wq, &llcc_priv->slice_work,
+			msecs_to_jiffies(window_ms));
+	return 0;
+}
+
+static void slice_monitor_stop(struct llcc_perfmon_private *llcc_priv)
+{
+	struct event_port_ops *port_ops = llcc_priv->port_ops[EVENT_PORT_TRP];
+
+	mutex_lock(&llcc_priv->mutex);
+	if (!llcc_priv->slice_window_ms) {
+		mutex_unlock(&llcc_priv->mutex);
+		return;
+	}
+
+	llcc_priv->slice_window_ms = 0;
+	mutex_unlock(&llcc_priv->mutex);
+	cancel_delayed_work_sync(&llcc_priv->slice_work);
+
+	mutex_lock(&llcc_priv->mutex);
+	llcc_bcast_modify(llcc_priv, PERFMON_MODE, 0,
+			PERFMON_MODE_MONITOR_MODE_MASK |
+			PERFMON_MODE_MONITOR_EN_MASK);
+	port_ops->event_config(llcc_priv, TRP_ANY_ACCESS, 0, false);
+	port_ops->event_config(llcc_priv, TRP_ANY_HIT, 1, false);
+	port_ops->event_filter_config(llcc_priv, SCID, 0, false);
+	llcc_priv->filtered_ports &= ~(1 << EVENT_PORT_TRP);
+	clk_disable_unprepare(llcc_priv->clock);
+	mutex_unlock(&llcc_priv->mutex);
+}
+
+static ssize_t perfmon_slice_monitor_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct llcc_perfmon_private *llcc_priv = dev_get_drvdata(dev);
+	ssize_t cnt;
+
+	mutex_lock(&llcc_priv->mutex);
+	if (llcc_priv->slice_window_ms)
+		cnt = snprintf(buf, PAGE_SIZE, "window %u ms, SCID %02u\n",
+				llcc_priv->slice_window_ms,
+				llcc_priv->slice_scid);
+	else
+		cnt = snprintf(buf, PAGE_SIZE, "stopped\n");
+	mutex_unlock(&llcc_priv->mutex);
+
+	return cnt;
+}
+
+static ssize_t perfmon_slice_monitor_store(struct device *dev,
+		struct device_attribute *attr, const char *buf,
+		size_t count)
+{
+	struct llcc_perfmon_private *llcc_priv = dev_get_drvdata(dev);
+	unsigned int window_ms;
+	int ret = 0;
+
+	if (kstrtouint(buf, 0, &window_ms))
+		return -EINVAL;
+
+	if (!window_ms) {
+		slice_monitor_stop(llcc_priv);
+		return count;
+	}
+
+	mutex_lock(&llcc_priv->mutex);
+	if (llcc_priv->slice_window_ms)
+		llcc_priv->slice_window_ms = window_ms;
+	else
+		ret = slice_monitor_start(llcc_priv, window_ms);
+	mutex_unlock(&llcc_priv->mutex);
+
+	return ret ? ret : count;
+}
+
 static DEVICE_ATTR_RO(perfmon_counter_dump);
 static DEVICE_ATTR_WO(perfmon_configure);
 static DEVICE_ATTR_WO(perfmon_remove);
@@ -684,6 +881,7 @@ static DEVICE_ATTR_WO(perfmon_filter_remove);
 static DEVICE_ATTR_WO(perfmon_start);
 static DEVICE_ATTR_RO(perfmon_scid_status);
 static DEVICE_ATTR_WO(perfmon_ns_periodic_dump);
+static DEVICE_ATTR_RW(perfmon_slice_monitor);
 
 static struct attribute *llcc_perfmon_attrs[] = {
 	&dev_attr_perfmon_counter_dump.attr,
@@ -694,6 +892,7 @@ static struct attribute *llcc_perfmon_attrs[] = {
 	&dev_attr_perfmon_start.attr,
 	&dev_attr_perfmon_scid_status.attr,
 	&dev_attr_perfmon_ns_periodic_dump.attr,
+	&dev_attr_perfmon_slice_monitor.attr,
 	NULL,
 };
 
@@ -1299,6 +1498,7 @@ static int llcc_perfmon_probe(struct platform_device *pdev)
 				llcc_priv->num_mc);
 
 	mutex_init(&llcc_priv->mutex);
+	INIT_DELAYED_WORK(&llcc_priv->slice_work, slice_monitor_work);
 	platform_set_drvdata(pdev, llcc_priv);
 	llcc_register_event_port(llcc_priv, &feac_port_ops, EVENT_PORT_FEAC);
 	llcc_register_event_port(llcc_priv, &ferc_port_ops, EVENT_PORT_FERC);
@@ -1321,6 +1521,8 @@ static int llcc_perfmon_remove(struct platform_device *pdev)
 	while (hrtimer_active(&llcc_priv->hrtimer))
 		hrtimer_cancel(&llcc_priv->hrtimer);
 
+	slice_monitor_stop(llcc_priv);
+
 	mutex_destroy(&llcc_priv->mutex);
 	sysfs_remove_group(&pdev->dev.kobj, &llcc_perfmon_group);
 	platform_set_drvdata(pdev, NULL);
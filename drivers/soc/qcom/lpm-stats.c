@@ -45,6 +45,7 @@ struct level_stats {
 	int64_t max_time[CONFIG_MSM_IDLE_STATS_BUCKET_COUNT];
 	int success_count;
 	int failed_count;
+	int pred[LPM_PRED_NR];
 	uint64_t total_time;
 	uint64_t enter_time;
 };
@@ -123,6 +124,16 @@ static void level_stats_print(struct seq_file *m, struct level_stats *stats)
 		seq_puts(m, seqs);
 	}
 
+	if (stats->pred[LPM_PRED_HIT] || stats->pred[LPM_PRED_TOO_SHORT] ||
+			stats->pred[LPM_PRED_TOO_LONG]) {
+		snprintf(seqs, MAX_STR_LEN,
+			"  residency hit: %7d too short: %7d too long: %7d\n",
+			stats->pred[LPM_PRED_HIT],
+			stats->pred[LPM_PRED_TOO_SHORT],
+			stats->pred[LPM_PRED_TOO_LONG]);
+		seq_puts(m, seqs);
+	}
+
 	bucket_time = stats->first_bucket_time;
 	for (i = 0;
 		i < CONFIG_MSM_IDLE_STATS_BUCKET_COUNT - 1;
@@ -187,6 +198,7 @@ static void level_stats_reset(struct level_stats *stats)
 	memset(stats->bucket, 0, sizeof(stats->bucket));
 	memset(stats->min_time, 0, sizeof(stats->min_time));
 	memset(stats->max_time, 0, sizeof(stats->max_time));
+	memset(stats->pred, 0, sizeof(stats->pred));
 	stats->success_count = 0;
 	stats->failed_count = 0;
 	stats->total_time = 0;
@@ -854,6 +866,42 @@ void lpm_stats_cpu_exit(uint32_t index, uint64_t time, bool success)
 }
 EXPORT_SYMBOL(lpm_stats_cpu_exit);
 
+/**
+ * lpm_stats_cluster_pred() - API to account how long a cluster stayed in
+ * a low power mode compared with what the mode needs.
+ *
+ * @stats:	Pointer to the cluster's lpm_stats object.
+ * @index:	Index of the cluster lpm level.
+ * @result:	Whether the idle period was a hit, too short or too long.
+ */
+void lpm_stats_cluster_pred(struct lpm_stats *stats, uint32_t index,
+				enum lpm_pred_result result)
+{
+	if (IS_ERR_OR_NULL(stats) || index >= stats->num_levels)
+		return;
+
+	stats->time_stats[index].pred[result]++;
+}
+EXPORT_SYMBOL(lpm_stats_cluster_pred);
+
+/**
+ * lpm_stats_cpu_pred() - API to account how long the cpu stayed in a low
+ * power mode compared with what the mode needs.
+ *
+ * @index:	cpu's lpm level index.
+ * @result:	Whether the idle period was a hit, too short or too long.
+ */
+void lpm_stats_cpu_pred(uint32_t index, enum lpm_pred_result result)
+{
+	struct lpm_stats *stats = &(*this_cpu_ptr(&(cpu_stats)));
+
+	if (!stats->time_stats || index >= stats->num_levels)
+		return;
+
+	stats->time_stats[index].pred[result]++;
+}
+EXPORT_SYMBOL(lpm_stats_cpu_pred);
+
 /**
  * lpm_stats_suspend_enter() - API to communicate system entering suspend.
  *
@@ -21,11 +21,88 @@
 #include <asm/sections.h>
 #include <linux/mm.h>
 #include <linux/sched/task.h>
+#include <linux/sched/task_stack.h>
+#include <linux/sched/clock.h>
+#include <linux/sched/stat.h>
 #include <linux/async.h>
+#include <linux/swap.h>
+#include <linux/vmstat.h>
 #ifdef CONFIG_OPLUS_FEATURE_QCOM_MINIDUMP_ENHANCE
 #include <soc/oplus/system/qcom_minidump_enhance.h>
 #endif
 
+#define MD_STACK_PAGES		(THREAD_SIZE / PAGE_SIZE)
+
+struct md_cpu_regions {
+	int stack[MD_STACK_PAGES];
+	int task;
+};
+
+static DEFINE_PER_CPU(struct md_cpu_regions, md_cpu_regions);
+static bool md_cpu_regions_ready;
+
+#ifdef CONFIG_MINIDUMP_SNAPSHOTS
+/*
+ * Compact state for parsers that don't have the vmlinux matching the dump.
+ * Both are laid out without padding so the layout doesn't depend on the
+ * compiler, and are filled in by dump_stack_minidump().
+ */
+#define MD_SNAPSHOT_VERSION	1
+
+struct md_sched_snapshot {
+	u32 version;
+	u32 cpu;
+	u64 timestamp_ns;
+	s32 pid;
+	s32 tgid;
+	char comm[TASK_COMM_LEN];
+	s64 state;
+	s32 prio;
+	u32 policy;
+	u64 sum_exec_runtime_ns;
+	u64 nvcsw;
+	u64 nivcsw;
+	u32 preempt_count;
+	u32 irqs_disabled;
+	u64 nr_running;
+};
+
+struct md_mem_snapshot {
+	u32 version;
+	u32 page_size;
+	u64 timestamp_ns;
+	u64 total_pages;
+	u64 free_pages;
+	u64 file_pages;
+	u64 anon_pages;
+	u64 slab_reclaimable_pages;
+	u64 slab_unreclaimable_pages;
+	u64 kernel_stack_kb;
+	u64 free_swap_pages;
+};
+
+static DEFINE_PER_CPU(struct md_sched_snapshot, md_sched_snapshot);
+static struct md_mem_snapshot md_mem_snapshot;
+#endif
+
+static int __init md_reserve(const char *name, void *virt, phys_addr_t phys,
+			     u64 size)
+{
+	struct md_region entry = { };
+	int regno;
+
+	strlcpy(entry.name, name, sizeof(entry.name));
+	entry.virt_addr = (uintptr_t)virt;
+	entry.phys_addr = phys;
+	entry.size = size;
+
+	regno = msm_minidump_reserve_region(&entry);
+	if (regno < 0)
+		pr_err("Failed to add %s in Minidump\n", name);
+
+	return regno;
+}
+
 static void __init register_log_buf(void)
 {
 	char **log_bufp;
@@ -47,25 +124,6 @@ static void __init register_log_buf(void)
 		pr_err("Failed to add logbuf in Minidump\n");
 }
 
-static void register_stack_entry(struct md_region *ksp_entry, u64 sp, u64 size,
-				 u32 cpu)
-{
-	struct page *sp_page;
-	struct vm_struct *stack_vm_area = task_stack_vm_area(current);
-
-	ksp_entry->virt_addr = sp;
-	ksp_entry->size = size;
-	if (stack_vm_area) {
-		sp_page = vmalloc_to_page((const void *) sp);
-		ksp_entry->phys_addr = page_to_phys(sp_page);
-	} else {
-		ksp_entry->phys_addr = virt_to_phys((uintptr_t *)sp);
-	}
-
-	if (msm_minidump_add_region(ksp_entry))
-		pr_err("Failed to add stack of cpu %d in Minidump\n", cpu);
-}
-
 static void __init register_kernel_sections(void)
 {
 	struct md_region ksec_entry;
@@ -96,43 +154,113 @@ static void __init register_kernel_sections(void)
 	}
 }
 
-static inline bool in_stack_range(u64 sp, u64 base_addr, unsigned int
-				  stack_size)
+/*
+ * Each CPU has regions reserved at init for the stack and task it runs
+ * when the system goes down, pointing at the init task until then. Crash
+ * time capture only moves them, so it takes no locks, walks no lists and
+ * can't find the table full.
+ */
+static void __init register_cpu_regions(void)
 {
-	u64 min_addr = base_addr;
-	u64 max_addr = base_addr + stack_size;
+	char name[MAX_NAME_LENGTH];
+	unsigned int cpu, i;
 
-	return (min_addr <= sp && sp < max_addr);
+	for_each_possible_cpu(cpu) {
+		struct md_cpu_regions *regs = per_cpu_ptr(&md_cpu_regions, cpu);
+		void *snap __maybe_unused;
+
+		for (i = 0; i < MD_STACK_PAGES; i++) {
+			void *page = (void *)init_stack + i * PAGE_SIZE;
+
+			scnprintf(name, sizeof(name), "KSTACK%d_%d", cpu, i);
+			regs->stack[i] = md_reserve(name, page,
+						    virt_to_phys(page),
+						    PAGE_SIZE);
+		}
+
+		scnprintf(name, sizeof(name), "KTASK%d", cpu);
+		regs->task = md_reserve(name, &init_task,
+					virt_to_phys(&init_task),
+					sizeof(struct task_struct));
+
+#ifdef CONFIG_MINIDUMP_SNAPSHOTS
+		snap = per_cpu_ptr(&md_sched_snapshot, cpu);
+		scnprintf(name, sizeof(name), "KSCHED%d", cpu);
+		md_reserve(name, snap, per_cpu_ptr_to_phys(snap),
+			   sizeof(struct md_sched_snapshot));
+#endif
+	}
+
+#ifdef CONFIG_MINIDUMP_SNAPSHOTS
+	md_reserve("KMEMSTAT", &md_mem_snapshot,
+		   virt_to_phys(&md_mem_snapshot), sizeof(md_mem_snapshot));
+#endif
+
+	smp_store_release(&md_cpu_regions_ready, true);
 }
 
-static unsigned int calculate_copy_pages(u64 sp, struct vm_struct *stack_area)
+#ifdef CONFIG_MINIDUMP_SNAPSHOTS
+static void md_take_snapshots(u32 cpu)
 {
-	u64 tsk_stack_base = (u64) stack_area->addr;
-	u64 offset;
-	unsigned int stack_pages, copy_pages;
-
-	if (in_stack_range(sp, tsk_stack_base, get_vm_area_size(stack_area))) {
-		offset = sp - tsk_stack_base;
-		stack_pages = get_vm_area_size(stack_area) / PAGE_SIZE;
-		copy_pages = stack_pages - (offset / PAGE_SIZE);
-	} else {
-		copy_pages = 0;
-	}
-	return copy_pages;
+	struct md_sched_snapshot *sched = this_cpu_ptr(&md_sched_snapshot);
+	struct md_mem_snapshot *mem = &md_mem_snapshot;
+	int panic_owner = atomic_read(&panic_cpu);
+
+	sched->version = MD_SNAPSHOT_VERSION;
+	sched->cpu = cpu;
+	sched->timestamp_ns = local_clock();
+	sched->pid = task_pid_nr(current);
+	sched->tgid = task_tgid_nr(current);
+	memcpy(sched->comm, current->comm, sizeof(sched->comm));
+	sched->state = current->state;
+	sched->prio = current->prio;
+	sched->policy = current->policy;
+	sched->sum_exec_runtime_ns = current->se.sum_exec_runtime;
+	sched->nvcsw = current->nvcsw;
+	sched->nivcsw = current->nivcsw;
+	sched->preempt_count = preempt_count();
+	sched->irqs_disabled = irqs_disabled();
+	sched->nr_running = nr_running();
+
+	/* The memory state is global, let the panicking CPU take it */
+	if (panic_owner != PANIC_CPU_INVALID && panic_owner != cpu)
+		return;
+
+	mem->version = MD_SNAPSHOT_VERSION;
+	mem->page_size = PAGE_SIZE;
+	mem->timestamp_ns = sched->timestamp_ns;
+	mem->total_pages = totalram_pages;
+	mem->free_pages = global_zone_page_state(NR_FREE_PAGES);
+	mem->file_pages = global_node_page_state(NR_FILE_PAGES);
+	mem->anon_pages = global_node_page_state(NR_ANON_MAPPED);
+	mem->slab_reclaimable_pages =
+		global_node_page_state(NR_SLAB_RECLAIMABLE);
+	mem->slab_unreclaimable_pages =
+		global_node_page_state(NR_SLAB_UNRECLAIMABLE);
+	mem->kernel_stack_kb = global_zone_page_state(NR_KERNEL_STACK_KB);
+	mem->free_swap_pages = get_nr_swap_pages();
 }
+#else
+static inline void md_take_snapshots(u32 cpu) { }
+#endif
 
+/*
+ * Point this CPU's regions at the running task. The whole task stack is
+ * captured, so @sp is not needed to find the live part of it any more.
+ */
 void dump_stack_minidump(u64 sp)
 {
-	struct md_region ksp_entry, ktsk_entry;
 	u32 cpu = smp_processor_id();
+	struct md_cpu_regions *regs;
 	struct vm_struct *stack_vm_area;
-	unsigned int i, copy_pages;
+	void *stack;
+	unsigned int i;
 
-	if (is_idle_task(current))
+	if (is_idle_task(current) || !smp_load_acquire(&md_cpu_regions_ready))
 		return;
 
-	if (sp < KIMAGE_VADDR || sp > -256UL)
-		sp = current_stack_pointer;
+	regs = this_cpu_ptr(&md_cpu_regions);
+	stack = task_stack_page(current);
 
 	/*
 	 * Since stacks are now allocated with vmalloc, the translation to
@@ -140,37 +268,26 @@ void dump_stack_minidump(u64 sp)
 	 * for kernel logical addresses, since vmalloc creates a virtual
 	 * mapping. Thus, virt_to_phys() should not be used in this context;
 	 * instead the page table must be walked to acquire the physical
-	 * address of one page of the stack.
+	 * address of each page of the stack.
 	 */
 	stack_vm_area = task_stack_vm_area(current);
-	if (stack_vm_area) {
-		sp &= ~(PAGE_SIZE - 1);
-		copy_pages = calculate_copy_pages(sp, stack_vm_area);
-		for (i = 0; i < copy_pages; i++) {
-			scnprintf(ksp_entry.name, sizeof(ksp_entry.name),
-				  "KSTACK%d_%d", cpu, i);
-			register_stack_entry(&ksp_entry, sp, PAGE_SIZE, cpu);
-			sp += PAGE_SIZE;
-		}
-	} else {
-		sp &= ~(THREAD_SIZE - 1);
-		scnprintf(ksp_entry.name, sizeof(ksp_entry.name), "KSTACK%d",
-			  cpu);
-		register_stack_entry(&ksp_entry, sp, THREAD_SIZE, cpu);
-	}
+	for (i = 0; i < MD_STACK_PAGES; i++, stack += PAGE_SIZE)
+		msm_minidump_update_region(regs->stack[i], (u64)stack,
+				stack_vm_area ?
+				page_to_phys(vmalloc_to_page(stack)) :
+				virt_to_phys(stack));
+
+	msm_minidump_update_region(regs->task, (u64)current,
+				   virt_to_phys(current));
 
-	scnprintf(ktsk_entry.name, sizeof(ktsk_entry.name), "KTASK%d", cpu);
-	ktsk_entry.virt_addr = (u64)current;
-	ktsk_entry.phys_addr = virt_to_phys((uintptr_t *)current);
-	ktsk_entry.size = sizeof(struct task_struct);
-	if (msm_minidump_add_region(&ktsk_entry))
-		pr_err("Failed to add current task %d in Minidump\n", cpu);
+	md_take_snapshots(cpu);
 }
 
 static int __init do_msm_minidump_log_init(void)
 {
 	register_kernel_sections();
 	register_log_buf();
+	register_cpu_regions();
 #ifdef CONFIG_OPLUS_FEATURE_QCOM_MINIDUMP_ENHANCE	
 //yixue.ge@bsp.drv add for dump cpu contex for minidump
 	register_cpu_contex();
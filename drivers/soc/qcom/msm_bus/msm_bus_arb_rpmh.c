@@ -16,6 +16,8 @@
 #include <linux/slab.h>
 #include <linux/rtmutex.h>
 #include <linux/clk.h>
+#include <linux/moduleparam.h>
+#include <linux/workqueue.h>
 #include <linux/msm-bus.h>
 #include <dt-bindings/msm/msm-bus-ids.h>
 #include "msm_bus_core.h"
@@ -778,10 +780,102 @@ static void aggregate_bus_query_req(struct msm_bus_node_device_type *bus_dev,
 	return;
 }
 
+/*
+ * Votes that only lower bandwidth are held back for up to commit_defer_ms,
+ * so the drops from a storm of client updates go out as one batch per RSC.
+ * Any raise commits at once, together with whatever is pending.
+ */
+static unsigned int commit_defer_ms = 2;
+module_param(commit_defer_ms, uint, 0644);
+MODULE_PARM_DESC(commit_defer_ms, "Time lowered votes may wait to be batched");
+
+static u64 votes_requested;
+static u64 votes_deferred;
+static u64 commits_sent;
+
+static int commit_stats_get(char *buf, const struct kernel_param *kp)
+{
+	return snprintf(buf, PAGE_SIZE,
+			"requested: %llu deferred: %llu sent: %llu\n",
+			votes_requested, votes_deferred, commits_sent);
+}
+
+static const struct kernel_param_ops commit_stats_ops = {
+	.get = commit_stats_get,
+};
+module_param_cb(commit_stats, &commit_stats_ops, NULL, 0444);
+
+static struct device *node_rsc(struct msm_bus_node_device_type *node)
+{
+	struct msm_bus_node_device_type *bcm;
+
+	if (!node->node_info->num_bcm_devs)
+		return NULL;
+	bcm = to_msm_bus_node(node->node_info->bcm_devs[0]);
+	if (!bcm || !bcm->node_info->num_rsc_devs)
+		return NULL;
+	return bcm->node_info->rsc_devs[0];
+}
+
+static void flush_commit_list(void)
+{
+	struct msm_bus_node_device_type *node, *node_tmp;
+	struct device *rsc;
+	LIST_HEAD(rsc_list);
+
+	/*
+	 * msm_bus_commit_data() sends to a single RSC, so a list collected
+	 * from several clients is split up. Nodes without a BCM go along
+	 * with the first batch.
+	 */
+	while (!list_empty(&commit_list)) {
+		rsc = NULL;
+		list_for_each_entry(node, &commit_list, link) {
+			rsc = node_rsc(node);
+			if (rsc)
+				break;
+		}
+
+		list_for_each_entry_safe(node, node_tmp, &commit_list, link) {
+			struct device *node_dev_rsc = node_rsc(node);
+
+			if (!node_dev_rsc || node_dev_rsc == rsc)
+				list_move_tail(&node->link, &rsc_list);
+		}
+
+		msm_bus_commit_data(&rsc_list);
+		INIT_LIST_HEAD(&rsc_list);
+		commits_sent++;
+	}
+}
+
+static void commit_work_fn(struct work_struct *work)
+{
+	rt_mutex_lock(&msm_bus_adhoc_lock);
+	flush_commit_list();
+	rt_mutex_unlock(&msm_bus_adhoc_lock);
+}
+
+static DECLARE_DELAYED_WORK(commit_work, commit_work_fn);
+
 static void commit_data(void)
 {
-	msm_bus_commit_data(&commit_list);
-	INIT_LIST_HEAD(&commit_list);
+	votes_requested++;
+	flush_commit_list();
+}
+
+static void commit_data_lazy(bool raise)
+{
+	if (raise || !commit_defer_ms) {
+		commit_data();
+		return;
+	}
+
+	votes_requested++;
+	votes_deferred++;
+	if (!delayed_work_pending(&commit_work))
+		schedule_delayed_work(&commit_work,
+				      msecs_to_jiffies(commit_defer_ms));
 }
 
 int commit_late_init_data(bool lock)
@@ -1345,6 +1439,7 @@ static int update_client_paths(struct msm_bus_client *client, unsigned int idx)
 	int i, ret = 0;
 	struct msm_bus_scale_pdata *pdata;
 	struct device *src_dev;
+	bool raise = false;
 
 	if (!client) {
 		MSM_BUS_ERR("Client handle  Null");
@@ -1379,6 +1474,8 @@ static int update_client_paths(struct msm_bus_client *client, unsigned int idx)
 			MSM_BUS_DBG("%s:ab: %llu ib: %llu\n", __func__,
 					curr_bw, curr_clk);
 		}
+		if (req_clk > curr_clk || req_bw > curr_bw)
+			raise = true;
 
 		if (pdata->active_only) {
 			slp_clk = 0;
@@ -1409,7 +1506,7 @@ static int update_client_paths(struct msm_bus_client *client, unsigned int idx)
 				msm_bus_commit_single(dev);
 		}
 	}
-	commit_data();
+	commit_data_lazy(raise);
 exit_update_client_paths:
 	return ret;
 }
@@ -1831,7 +1928,9 @@ static int update_bw_adhoc(struct msm_bus_client_handle *cl, u64 ab, u64 ib)
 		goto exit_update_request;
 	}
 
-	commit_data();
+	commit_data_lazy(act_ib > cl->cur_act_ib || act_ab > cl->cur_act_ab ||
+			 dual_ib > cl->cur_dual_ib ||
+			 dual_ab > cl->cur_dual_ab);
 	cl->cur_act_ib = act_ib;
 	cl->cur_act_ab = act_ab;
 	cl->cur_dual_ib = dual_ib;
@@ -1876,7 +1975,9 @@ static int update_bw_context(struct msm_bus_client_handle *cl, u64 act_ab,
 				__func__, ret, cl->active_only);
 		goto exit_change_context;
 	}
-	commit_data();
+	commit_data_lazy(act_ib > cl->cur_act_ib || act_ab > cl->cur_act_ab ||
+			 dual_ib > cl->cur_dual_ib ||
+			 dual_ab > cl->cur_dual_ab);
 	cl->cur_act_ib = act_ib;
 	cl->cur_act_ab = act_ab;
 	cl->cur_dual_ib = dual_ib;
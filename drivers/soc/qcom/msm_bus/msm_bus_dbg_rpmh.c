@@ -23,6 +23,7 @@
 #include <linux/string.h>
 #include <linux/uaccess.h>
 #include <linux/hrtimer.h>
+#include <linux/spinlock.h>
 #include <linux/msm-bus-board.h>
 #include <linux/msm-bus.h>
 #include <linux/msm_bus_rules.h>
@@ -33,6 +34,11 @@
 
 #define MAX_BUFF_SIZE 4096
 #define FILL_LIMIT 128
+/* MSM_BUS_SLAVE_EBI_CH0 */
+#define DDR_SLAVE_ID 512
+#define DDR_ACCT_MAX 64
+#define DDR_ACCT_NAME_LEN 32
+#define DDR_TIMELINE_SIZE 512
 
 static struct dentry *clients;
 static struct dentry *dir;
@@ -340,6 +346,271 @@ static struct dentry *msm_bus_dbg_create(const char *name, mode_t mode,
 		&client_data_fops);
 }
 
+/**
+ * The following keep DDR bandwidth accounting per client: the votes each
+ * client places on its paths to DDR are integrated over time, and every
+ * vote change is logged in a timeline together with the traffic the bwmon
+ * governors measure, so clients holding DDR at a high frequency can be
+ * told apart from the ones actually using the bandwidth.
+ */
+
+enum ddr_acct_type {
+	DDR_ACCT_VOTE,
+	DDR_ACCT_MEAS,
+};
+
+struct msm_bus_ddr_acct {
+	char name[DDR_ACCT_NAME_LEN];
+	enum ddr_acct_type type;
+	/* Current vote, or last measurement, in MBps */
+	u32 ab;
+	u32 ib;
+	/* MBps * us since ddr_acct_start */
+	u64 ab_sum;
+	u64 ib_sum;
+	/* Time spent with a non-zero vote, in us */
+	u64 active_us;
+	u64 last_ns;
+};
+
+struct msm_bus_ddr_event {
+	u64 ts_ns;
+	char name[DDR_ACCT_NAME_LEN];
+	enum ddr_acct_type type;
+	u32 ab;
+	u32 ib;
+};
+
+static DEFINE_SPINLOCK(ddr_acct_lock);
+static struct msm_bus_ddr_acct ddr_acct[DDR_ACCT_MAX];
+static int ddr_acct_nr;
+static u64 ddr_acct_start;
+static struct msm_bus_ddr_event ddr_timeline[DDR_TIMELINE_SIZE];
+static unsigned int ddr_timeline_head;
+
+static void ddr_acct_advance(struct msm_bus_ddr_acct *acct, u64 now)
+{
+	u64 us = div_u64(now - acct->last_ns, NSEC_PER_USEC);
+
+	acct->ab_sum += (u64)acct->ab * us;
+	acct->ib_sum += (u64)acct->ib * us;
+	if (acct->ib || acct->ab)
+		acct->active_us += us;
+	acct->last_ns = now;
+}
+
+static void ddr_acct_record(const char *name, enum ddr_acct_type type,
+	u64 ab, u64 ib)
+{
+	struct msm_bus_ddr_acct *acct = NULL;
+	struct msm_bus_ddr_event *ev;
+	unsigned long flags;
+	u64 now;
+	int i;
+
+	if (!name)
+		return;
+
+	spin_lock_irqsave(&ddr_acct_lock, flags);
+	now = ktime_get_ns();
+	if (!ddr_acct_start)
+		ddr_acct_start = now;
+
+	for (i = 0; i < ddr_acct_nr; i++) {
+		if (ddr_acct[i].type == type &&
+			!strncmp(ddr_acct[i].name, name,
+				sizeof(ddr_acct[i].name) - 1)) {
+			acct = &ddr_acct[i];
+			break;
+		}
+	}
+
+	if (!acct && ddr_acct_nr < DDR_ACCT_MAX) {
+		acct = &ddr_acct[ddr_acct_nr++];
+		strlcpy(acct->name, name, sizeof(acct->name));
+		acct->type = type;
+		acct->last_ns = now;
+	}
+
+	if (acct) {
+		ddr_acct_advance(acct, now);
+		acct->ab = min_t(u64, ab, U32_MAX);
+		acct->ib = min_t(u64, ib, U32_MAX);
+	}
+
+	ev = &ddr_timeline[ddr_timeline_head++ % DDR_TIMELINE_SIZE];
+	ev->ts_ns = now;
+	strlcpy(ev->name, name, sizeof(ev->name));
+	ev->type = type;
+	ev->ab = min_t(u64, ab, U32_MAX);
+	ev->ib = min_t(u64, ib, U32_MAX);
+	spin_unlock_irqrestore(&ddr_acct_lock, flags);
+}
+
+/* Sum of ab and max of ib over the DDR paths of usecase @index, in MBps */
+static bool ddr_acct_usecase(const struct msm_bus_scale_pdata *pdata,
+	int index, u64 *ab, u64 *ib)
+{
+	struct msm_bus_vectors *vec;
+	bool ddr = false;
+	int j;
+
+	*ab = 0;
+	*ib = 0;
+	for (j = 0; j < pdata->usecase->num_paths; j++) {
+		vec = &pdata->usecase[index].vectors[j];
+		if (vec->dst != DDR_SLAVE_ID)
+			continue;
+		ddr = true;
+		*ab += vec->ab;
+		*ib = max_t(u64, *ib, vec->ib);
+	}
+	*ab >>= 20;
+	*ib >>= 20;
+
+	return ddr;
+}
+
+/**
+ * msm_bus_dbg_ddr_meas() - Log DDR traffic measured by a bandwidth monitor
+ * @mon: Name of the monitor
+ * @mbps: Traffic measured in the last sample window
+ */
+void msm_bus_dbg_ddr_meas(const char *mon, unsigned long mbps)
+{
+	ddr_acct_record(mon, DDR_ACCT_MEAS, mbps, 0);
+}
+EXPORT_SYMBOL(msm_bus_dbg_ddr_meas);
+
+static void ddr_acct_show_entry(struct seq_file *m,
+	struct msm_bus_ddr_acct *acct, u64 elapsed_us)
+{
+	if (acct->type == DDR_ACCT_VOTE)
+		seq_printf(m, "%-31s %8u %8u %8llu %8llu %3llu%%\n",
+			acct->name, acct->ab, acct->ib,
+			div64_u64(acct->ab_sum, elapsed_us),
+			div64_u64(acct->ib_sum, elapsed_us),
+			div64_u64(acct->active_us * 100, elapsed_us));
+	else
+		seq_printf(m, "%-31s %8u %8llu %3llu%%\n",
+			acct->name, acct->ab,
+			div64_u64(acct->ab_sum, elapsed_us),
+			div64_u64(acct->active_us * 100, elapsed_us));
+}
+
+static int ddr_clients_show(struct seq_file *m, void *unused)
+{
+	struct msm_bus_ddr_acct *acct;
+	unsigned long flags;
+	u64 now, elapsed_us;
+	int i;
+
+	spin_lock_irqsave(&ddr_acct_lock, flags);
+	now = ktime_get_ns();
+	elapsed_us = div_u64(now - ddr_acct_start, NSEC_PER_USEC) ? : 1;
+	seq_printf(m, "since_ms: %llu\n\n", div_u64(elapsed_us, USEC_PER_MSEC));
+
+	seq_printf(m, "%-31s %8s %8s %8s %8s %4s\n", "client", "ab", "ib",
+		"avg_ab", "avg_ib", "on");
+	for (i = 0; i < ddr_acct_nr; i++) {
+		acct = &ddr_acct[i];
+		ddr_acct_advance(acct, now);
+		if (acct->type == DDR_ACCT_VOTE)
+			ddr_acct_show_entry(m, acct, elapsed_us);
+	}
+
+	seq_printf(m, "\n%-31s %8s %8s %4s\n", "monitor", "mbps",
+		"avg_mbps", "on");
+	for (i = 0; i < ddr_acct_nr; i++) {
+		acct = &ddr_acct[i];
+		if (acct->type == DDR_ACCT_MEAS)
+			ddr_acct_show_entry(m, acct, elapsed_us);
+	}
+	spin_unlock_irqrestore(&ddr_acct_lock, flags);
+
+	return 0;
+}
+
+static int ddr_clients_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, ddr_clients_show, NULL);
+}
+
+static ssize_t ddr_clients_write(struct file *file, const char __user *ubuf,
+	size_t cnt, loff_t *ppos)
+{
+	unsigned long flags;
+	u64 now;
+	int i;
+
+	/* Any write restarts the averages */
+	spin_lock_irqsave(&ddr_acct_lock, flags);
+	now = ktime_get_ns();
+	ddr_acct_start = now;
+	for (i = 0; i < ddr_acct_nr; i++) {
+		ddr_acct[i].ab_sum = 0;
+		ddr_acct[i].ib_sum = 0;
+		ddr_acct[i].active_us = 0;
+		ddr_acct[i].last_ns = now;
+	}
+	spin_unlock_irqrestore(&ddr_acct_lock, flags);
+
+	return cnt;
+}
+
+static const struct file_operations ddr_clients_fops = {
+	.open		= ddr_clients_open,
+	.read		= seq_read,
+	.write		= ddr_clients_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int ddr_timeline_show(struct seq_file *m, void *unused)
+{
+	struct msm_bus_ddr_event *ev, *events;
+	unsigned int head, i, n;
+	unsigned long flags;
+
+	events = kmalloc_array(DDR_TIMELINE_SIZE, sizeof(*events),
+		GFP_KERNEL);
+	if (!events)
+		return -ENOMEM;
+
+	/* Copy out, so that logging of votes is not held up by the reader */
+	spin_lock_irqsave(&ddr_acct_lock, flags);
+	head = ddr_timeline_head;
+	memcpy(events, ddr_timeline, sizeof(ddr_timeline));
+	spin_unlock_irqrestore(&ddr_acct_lock, flags);
+
+	n = min_t(unsigned int, head, DDR_TIMELINE_SIZE);
+	for (i = head - n; i != head; i++) {
+		ev = &events[i % DDR_TIMELINE_SIZE];
+		if (ev->type == DDR_ACCT_VOTE)
+			seq_printf(m, "%llu vote %s ab=%u ib=%u\n", ev->ts_ns,
+				ev->name, ev->ab, ev->ib);
+		else
+			seq_printf(m, "%llu meas %s mbps=%u\n", ev->ts_ns,
+				ev->name, ev->ab);
+	}
+	kfree(events);
+
+	return 0;
+}
+
+static int ddr_timeline_open(struct inode *inode, struct file *file)
+{
+	return single_open_size(file, ddr_timeline_show, NULL,
+		DDR_TIMELINE_SIZE * 80);
+}
+
+static const struct file_operations ddr_timeline_fops = {
+	.open		= ddr_timeline_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 int msm_bus_dbg_add_client(const struct msm_bus_client_handle *pdata)
 
 {
@@ -423,6 +694,9 @@ int msm_bus_dbg_rec_transaction(const struct msm_bus_client_handle *pdata,
 	cldata->size = i;
 	rt_mutex_unlock(&msm_bus_dbg_cllist_lock);
 
+	if (pdata->slv == DDR_SLAVE_ID)
+		ddr_acct_record(pdata->name, DDR_ACCT_VOTE, ab >> 20, ib >> 20);
+
 	trace_bus_update_request((int)ts.tv_sec, (int)ts.tv_nsec,
 		pdata->name, pdata->mas, pdata->slv, ab, ib);
 
@@ -433,6 +707,9 @@ void msm_bus_dbg_remove_client(const struct msm_bus_client_handle *pdata)
 {
 	struct msm_bus_cldata *cldata = NULL;
 
+	if (pdata->slv == DDR_SLAVE_ID)
+		ddr_acct_record(pdata->name, DDR_ACCT_VOTE, 0, 0);
+
 	rt_mutex_lock(&msm_bus_dbg_cllist_lock);
 	list_for_each_entry(cldata, &cl_list, list) {
 		if (cldata->handle == pdata) {
@@ -478,10 +755,15 @@ static int msm_bus_dbg_record_client(const struct msm_bus_scale_pdata *pdata,
 static void msm_bus_dbg_free_client(uint32_t clid)
 {
 	struct msm_bus_cldata *cldata = NULL;
+	u64 ab, ib;
 
 	rt_mutex_lock(&msm_bus_dbg_cllist_lock);
 	list_for_each_entry(cldata, &cl_list, list) {
 		if (cldata->clid == clid) {
+			if (cldata->pdata && cldata->pdata->usecase &&
+				ddr_acct_usecase(cldata->pdata, 0, &ab, &ib))
+				ddr_acct_record(cldata->pdata->name,
+					DDR_ACCT_VOTE, 0, 0);
 			debugfs_remove(cldata->file);
 			list_del(&cldata->list);
 			kfree(cldata);
@@ -499,6 +781,7 @@ static int msm_bus_dbg_fill_cl_buffer(const struct msm_bus_scale_pdata *pdata,
 	struct msm_bus_cldata *cldata = NULL;
 	struct timespec ts;
 	int found = 0;
+	u64 ab, ib;
 
 	rt_mutex_lock(&msm_bus_dbg_cllist_lock);
 	list_for_each_entry(cldata, &cl_list, list) {
@@ -565,6 +848,9 @@ static int msm_bus_dbg_fill_cl_buffer(const struct msm_bus_scale_pdata *pdata,
 	cldata->size = i;
 	rt_mutex_unlock(&msm_bus_dbg_cllist_lock);
 
+	if (ddr_acct_usecase(pdata, index, &ab, &ib))
+		ddr_acct_record(pdata->name, DDR_ACCT_VOTE, ab, ib);
+
 	return i;
 }
 
@@ -1053,6 +1339,14 @@ static int __init msm_bus_debugfs_init(void)
 		clients, NULL, &msm_bus_dbg_dump_bcm_clients_fops) == NULL)
 		goto err;
 
+	if (debugfs_create_file("ddr_clients", 0644,
+		dir, NULL, &ddr_clients_fops) == NULL)
+		goto err;
+
+	if (debugfs_create_file("ddr_timeline", 0444,
+		dir, NULL, &ddr_timeline_fops) == NULL)
+		goto err;
+
 	mutex_lock(&msm_bus_dbg_fablist_lock);
 	list_for_each_entry(fablist, &fabdata_list, list) {
 		fablist->file = debugfs_create_file(fablist->name, 0444,
@@ -169,12 +169,11 @@ bool msm_minidump_enabled(void)
 }
 EXPORT_SYMBOL(msm_minidump_enabled);
 
-int msm_minidump_add_region(const struct md_region *entry)
+int msm_minidump_reserve_region(const struct md_region *entry)
 {
 	u32 entries;
 	u32 toc_init;
 	struct md_region *mdr;
-	int ret = 0;
 
 	if (!entry)
 		return -EINVAL;
@@ -227,10 +226,57 @@ int msm_minidump_add_region(const struct md_region *entry)
 
 	spin_unlock(&mdt_lock);
 
-	return ret;
+	return entries;
+}
+EXPORT_SYMBOL(msm_minidump_reserve_region);
+
+int msm_minidump_add_region(const struct md_region *entry)
+{
+	int ret = msm_minidump_reserve_region(entry);
+
+	return ret < 0 ? ret : 0;
 }
 EXPORT_SYMBOL(msm_minidump_add_region);
 
+/*
+ * Point a reserved region at new memory of the same size. Regions are never
+ * removed and every region has a fixed spot in the ToC and ELF header, so
+ * nothing here takes mdt_lock and it is safe to call while the system is
+ * going down.
+ */
+int msm_minidump_update_region(int regno, u64 virt_addr, u64 phys_addr)
+{
+	struct elfhdr *hdr = minidump_elfheader.ehdr;
+	struct md_ss_region *mdr;
+	struct elf_shdr *shdr;
+	struct elf_phdr *phdr;
+
+	if (regno < 0 || regno >= READ_ONCE(minidump_table.num_regions))
+		return -EINVAL;
+
+	minidump_table.entry[regno].virt_addr = virt_addr;
+	minidump_table.entry[regno].phys_addr = phys_addr;
+
+	/* Not in the ToC yet, it is added from the entry at init */
+	if (!minidump_table.md_ss_toc || !hdr ||
+	    READ_ONCE(minidump_table.md_ss_toc->md_ss_enable_status) !=
+	    MD_SS_ENABLED || READ_ONCE(pendings))
+		return 0;
+
+	/* Region 0 is the ELF header, sections 0-3 and segment 0 its own */
+	mdr = &minidump_table.md_regions[regno + 1];
+	shdr = elf_section(hdr, regno + 4);
+	phdr = elf_program(hdr, regno + 1);
+
+	mdr->region_base_address = phys_addr;
+	shdr->sh_addr = (elf_addr_t)virt_addr;
+	phdr->p_vaddr = virt_addr;
+	phdr->p_paddr = phys_addr;
+
+	return 0;
+}
+EXPORT_SYMBOL(msm_minidump_update_region);
+
 static int msm_minidump_add_header(void)
 {
 	struct md_ss_region *mdreg = &minidump_table.md_regions[0];
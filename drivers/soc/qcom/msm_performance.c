@@ -26,6 +26,16 @@
 #include <linux/input.h>
 #include <linux/kthread.h>
 #include <linux/sched/core_ctl.h>
+#include <linux/sched/task.h>
+#include <linux/cpufreq_times.h>
+#include <linux/miscdevice.h>
+#include <linux/mm.h>
+#include <linux/mutex.h>
+#include <linux/perf_event.h>
+#include <linux/poll.h>
+#include <linux/vmalloc.h>
+#include <linux/workqueue.h>
+#include <uapi/linux/msm_perf_tasks.h>
 
 /*
  * Sched will provide the data for every 20ms window,
@@ -491,6 +501,286 @@ static const struct kernel_param_ops param_ops_cc_register = {
 module_param_cb(core_ctl_register, &param_ops_cc_register,
 		&core_ctl_register, 0644);
 
+/*****************************task stats start*******************************/
+#define PERF_TASKS_MAX		8
+#define PERF_TASKS_RING_SLOTS	512
+
+struct perf_task {
+	struct task_struct *task;
+	struct perf_event *cycles;
+	struct perf_event *instructions;
+};
+
+static struct perf_task perf_tasks[PERF_TASKS_MAX];
+static unsigned int nr_perf_tasks;
+static unsigned int perf_tasks_users;
+static DEFINE_MUTEX(perf_tasks_lock);
+static DECLARE_WAIT_QUEUE_HEAD(perf_tasks_wq);
+static struct msm_perf_tasks_ring_hdr *perf_tasks_ring;
+static struct delayed_work perf_tasks_work;
+
+static unsigned int task_sample_ms = 16;
+module_param(task_sample_ms, uint, 0644);
+
+static struct perf_event *perf_task_counter(struct task_struct *task,
+					    u64 config)
+{
+	struct perf_event_attr attr = {
+		.type = PERF_TYPE_HARDWARE,
+		.size = sizeof(attr),
+		.config = config,
+	};
+	struct perf_event *event;
+
+	event = perf_event_create_kernel_counter(&attr, -1, task, NULL, NULL);
+
+	return IS_ERR(event) ? NULL : event;
+}
+
+static u64 perf_task_counter_read(struct perf_event *event)
+{
+	u64 enabled, running;
+
+	if (!event)
+		return 0;
+
+	return perf_event_read_value(event, &enabled, &running);
+}
+
+static void perf_tasks_put(struct perf_task *tasks, unsigned int nr)
+{
+	unsigned int i;
+
+	for (i = 0; i < nr; i++) {
+		if (tasks[i].cycles)
+			perf_event_release_kernel(tasks[i].cycles);
+		if (tasks[i].instructions)
+			perf_event_release_kernel(tasks[i].instructions);
+		put_task_struct(tasks[i].task);
+	}
+}
+
+/* Caller must hold perf_tasks_lock */
+static void perf_tasks_kick(void)
+{
+	if (nr_perf_tasks && perf_tasks_users)
+		mod_delayed_work(system_power_efficient_wq,
+				 &perf_tasks_work, 0);
+}
+
+static int set_task_watch(const char *buf, const struct kernel_param *kp)
+{
+	struct perf_task tasks[PERF_TASKS_MAX] = { };
+	struct task_struct *task;
+	unsigned int nr = 0;
+	const char *cp = buf;
+	int pid, len;
+
+	while (sscanf(cp, "%d%n", &pid, &len) == 1) {
+		cp += len;
+		if (!pid)
+			continue;
+
+		if (pid < 0 || nr == PERF_TASKS_MAX)
+			goto err;
+
+		rcu_read_lock();
+		task = get_pid_task(find_vpid(pid), PIDTYPE_PID);
+		rcu_read_unlock();
+		if (!task)
+			goto err;
+
+		tasks[nr].task = task;
+		tasks[nr].cycles = perf_task_counter(task,
+						PERF_COUNT_HW_CPU_CYCLES);
+		tasks[nr].instructions = perf_task_counter(task,
+						PERF_COUNT_HW_INSTRUCTIONS);
+		nr++;
+	}
+
+	mutex_lock(&perf_tasks_lock);
+	perf_tasks_put(perf_tasks, nr_perf_tasks);
+	memcpy(perf_tasks, tasks, sizeof(tasks));
+	nr_perf_tasks = nr;
+	perf_tasks_kick();
+	mutex_unlock(&perf_tasks_lock);
+
+	return 0;
+err:
+	perf_tasks_put(tasks, nr);
+	return -EINVAL;
+}
+
+static int get_task_watch(char *buf, const struct kernel_param *kp)
+{
+	unsigned int i;
+	int cnt = 0;
+
+	mutex_lock(&perf_tasks_lock);
+	for (i = 0; i < nr_perf_tasks; i++)
+		cnt += snprintf(buf + cnt, PAGE_SIZE - cnt, "%d ",
+				task_pid_vnr(perf_tasks[i].task));
+	mutex_unlock(&perf_tasks_lock);
+	cnt += snprintf(buf + cnt, PAGE_SIZE - cnt, "\n");
+
+	return cnt;
+}
+
+static const struct kernel_param_ops param_ops_task_watch = {
+	.set = set_task_watch,
+	.get = get_task_watch,
+};
+module_param_cb(task_watch, &param_ops_task_watch, NULL, 0644);
+
+static void perf_tasks_sample_fn(struct work_struct *work)
+{
+	struct msm_perf_tasks_ring_hdr *hdr = perf_tasks_ring;
+	struct msm_perf_task_sample *slots;
+	u64 head = hdr->head;
+	unsigned int i;
+
+	slots = (void *)hdr + hdr->hdr_size;
+
+	mutex_lock(&perf_tasks_lock);
+	if (!nr_perf_tasks || !perf_tasks_users) {
+		mutex_unlock(&perf_tasks_lock);
+		return;
+	}
+
+	for (i = 0; i < nr_perf_tasks; i++) {
+		struct perf_task *pt = &perf_tasks[i];
+		struct msm_perf_task_sample *slot;
+
+		slot = &slots[head % PERF_TASKS_RING_SLOTS];
+		WRITE_ONCE(slot->seq, slot->seq + 1);
+		smp_wmb();
+
+		slot->pid = task_pid_vnr(pt->task);
+		slot->timestamp_ns = ktime_get_ns();
+		slot->runtime_ns = READ_ONCE(pt->task->se.sum_exec_runtime);
+		slot->energy_uj = cpufreq_task_times_energy(pt->task,
+							    &slot->freq_time_ns);
+		slot->cycles = perf_task_counter_read(pt->cycles);
+		slot->instructions = perf_task_counter_read(pt->instructions);
+
+		smp_wmb();
+		WRITE_ONCE(slot->seq, slot->seq + 1);
+		head++;
+	}
+
+	hdr->interval_ms = READ_ONCE(task_sample_ms);
+	smp_wmb();
+	WRITE_ONCE(hdr->head, head);
+
+	queue_delayed_work(system_power_efficient_wq, &perf_tasks_work,
+			   msecs_to_jiffies(max(hdr->interval_ms, 4U)));
+	mutex_unlock(&perf_tasks_lock);
+
+	wake_up_interruptible(&perf_tasks_wq);
+}
+
+struct perf_tasks_reader {
+	u64 head;
+};
+
+static int perf_tasks_open(struct inode *inode, struct file *file)
+{
+	struct perf_tasks_reader *reader;
+
+	reader = kzalloc(sizeof(*reader), GFP_KERNEL);
+	if (!reader)
+		return -ENOMEM;
+
+	file->private_data = reader;
+
+	mutex_lock(&perf_tasks_lock);
+	reader->head = perf_tasks_ring->head;
+	perf_tasks_users++;
+	perf_tasks_kick();
+	mutex_unlock(&perf_tasks_lock);
+
+	return 0;
+}
+
+static int perf_tasks_release(struct inode *inode, struct file *file)
+{
+	mutex_lock(&perf_tasks_lock);
+	perf_tasks_users--;
+	mutex_unlock(&perf_tasks_lock);
+
+	/* An idle work exits on its own once there are no users */
+	kfree(file->private_data);
+
+	return 0;
+}
+
+static unsigned int perf_tasks_poll(struct file *file, poll_table *wait)
+{
+	struct perf_tasks_reader *reader = file->private_data;
+	u64 head;
+
+	poll_wait(file, &perf_tasks_wq, wait);
+
+	head = READ_ONCE(perf_tasks_ring->head);
+	if (head == reader->head)
+		return 0;
+
+	reader->head = head;
+	return POLLIN | POLLRDNORM;
+}
+
+static int perf_tasks_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	/* The ring is only ever written by the kernel */
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+
+	vma->vm_flags &= ~VM_MAYWRITE;
+	return remap_vmalloc_range(vma, perf_tasks_ring, vma->vm_pgoff);
+}
+
+static const struct file_operations perf_tasks_fops = {
+	.owner = THIS_MODULE,
+	.open = perf_tasks_open,
+	.release = perf_tasks_release,
+	.poll = perf_tasks_poll,
+	.mmap = perf_tasks_mmap,
+};
+
+static struct miscdevice perf_tasks_dev = {
+	.minor = MISC_DYNAMIC_MINOR,
+	.name = "msm_perf_tasks",
+	.fops = &perf_tasks_fops,
+};
+
+static int init_task_stats(void)
+{
+	size_t size;
+	int ret;
+
+	size = PAGE_ALIGN(sizeof(*perf_tasks_ring) + PERF_TASKS_RING_SLOTS *
+			  sizeof(struct msm_perf_task_sample));
+	perf_tasks_ring = vmalloc_user(size);
+	if (!perf_tasks_ring)
+		return -ENOMEM;
+
+	perf_tasks_ring->version = MSM_PERF_TASKS_VERSION;
+	perf_tasks_ring->hdr_size = sizeof(*perf_tasks_ring);
+	perf_tasks_ring->slot_size = sizeof(struct msm_perf_task_sample);
+	perf_tasks_ring->nr_slots = PERF_TASKS_RING_SLOTS;
+	INIT_DELAYED_WORK(&perf_tasks_work, perf_tasks_sample_fn);
+
+	ret = misc_register(&perf_tasks_dev);
+	if (ret) {
+		pr_err("msm_perf: Failed to register task stats device\n");
+		vfree(perf_tasks_ring);
+		perf_tasks_ring = NULL;
+	}
+
+	return ret;
+}
+/*****************************task stats end*********************************/
+
 static int __init msm_performance_init(void)
 {
 	unsigned int cpu;
@@ -508,6 +798,7 @@ static int __init msm_performance_init(void)
 
 	init_events_group();
 	init_notify_group();
+	init_task_stats();
 
 	return 0;
 }
@@ -20,9 +20,12 @@
 #include <linux/slab.h>
 #include <linux/suspend.h>
 #include <linux/rwsem.h>
+#include <linux/shrinker.h>
 #include <linux/sysfs.h>
 #include <linux/workqueue.h>
 #include <linux/jiffies.h>
+#include <linux/ktime.h>
+#include <linux/ctype.h>
 #include <linux/err.h>
 #include <linux/list.h>
 #include <linux/list_sort.h>
@@ -32,6 +35,7 @@
 #include <linux/of_address.h>
 #include <linux/io.h>
 #include <linux/dma-mapping.h>
+#include <linux/vmalloc.h>
 #include <soc/qcom/ramdump.h>
 #include <soc/qcom/subsystem_restart.h>
 #include <soc/qcom/secure_buffer.h>
@@ -114,6 +118,15 @@ module_param(proxy_timeout_ms, int, 0644);
 
 static bool disable_timeouts;
 
+/**
+ * fw_cache_kb - Memory the firmware caches of all subsystems may use
+ * Subsystems with qcom,pil-fw-cache keep their blobs in memory after a
+ * successful boot so that a restart doesn't read them from the filesystem
+ * again. 0 disables caching.
+ */
+static unsigned int fw_cache_kb = 65536;
+module_param(fw_cache_kb, uint, 0644);
+
 static struct workqueue_struct *pil_wq;
 
 /**
@@ -147,6 +160,35 @@ struct pil_seg {
 	bool relocated;
 };
 
+/**
+ * struct pil_fw_cache - blobs of the last image booted successfully
+ * @list: entry in pil_fw_caches while the cache may be reclaimed
+ * @priv: pil_priv the cache belongs to
+ * @mdt: copy of the mdt the blobs belong to
+ * @mdt_size: size of @mdt
+ * @num_blobs: number of entries in @blobs, one per program header
+ * @blobs: contents of each <name>.bXX, NULL if the blob isn't cached
+ * @size: bytes held in @blobs
+ *
+ * The cache is only used for an mdt identical to @mdt. The mdt carries the
+ * hash table of a signed image, so a stale blob would also fail
+ * authentication, after which the cache is dropped.
+ */
+struct pil_fw_cache {
+	struct list_head list;
+	struct pil_priv *priv;
+	void *mdt;
+	size_t mdt_size;
+	int num_blobs;
+	void **blobs;
+	atomic_long_t size;
+};
+
+/* Caches not in use by a pil_boot(), protected by pil_fw_cache_lock */
+static LIST_HEAD(pil_fw_caches);
+static DEFINE_MUTEX(pil_fw_cache_lock);
+static atomic_long_t pil_fw_cache_bytes = ATOMIC_LONG_INIT(0);
+
 /**
  * struct pil_priv - Private state for a pil_desc
  * @proxy: work item used to run the proxy unvoting routine
@@ -162,6 +204,7 @@ struct pil_seg {
  * non-relocatable images
  * @region: region allocated for relocatable images
  * @unvoted_flag: flag to keep track if we have unvoted or not.
+ * @fw_cache: cached blobs, owned by pil_boot() while it runs
  *
  * This struct contains data for a pil_desc that should not be exposed outside
  * of this file. This structure points to the descriptor and the descriptor
@@ -184,6 +227,7 @@ struct pil_priv {
 	int id;
 	int unvoted_flag;
 	size_t region_size;
+	struct pil_fw_cache *fw_cache;
 };
 
 #ifdef CONFIG_QCOM_MINIDUMP
@@ -1038,6 +1082,33 @@ static int pil_cmp_seg(void *priv, struct list_head *a, struct list_head *b)
 	return ret;
 }
 
+/*
+ * Boot time markers used to be placed for the modem only. Place them for
+ * every subsystem, named "M - Modem ...", "M - Adsp ..." and so on, so that
+ * the existing modem markers keep their names.
+ */
+static void pil_boot_marker(struct pil_desc *desc, const char *event)
+{
+	char name[64];
+
+	if (!boot_marker_enabled())
+		return;
+
+	snprintf(name, sizeof(name), "M - %s %s", desc->name, event);
+	name[4] = toupper(name[4]);
+	place_marker(name);
+}
+
+/* Milliseconds since *stamp, which is then moved on to now */
+static s64 pil_lap_ms(ktime_t *stamp)
+{
+	ktime_t now = ktime_get();
+	s64 ms = ktime_ms_delta(now, *stamp);
+
+	*stamp = now;
+	return ms;
+}
+
 static int pil_init_mmap(struct pil_desc *desc, const struct pil_mdt *mdt)
 {
 	struct pil_priv *priv = desc->priv;
@@ -1049,8 +1120,7 @@ static int pil_init_mmap(struct pil_desc *desc, const struct pil_mdt *mdt)
 	if (ret)
 		return ret;
 
-	if (!strcmp(desc->name, "modem"))
-		place_marker("M - Modem Image Start Loading");
+	pil_boot_marker(desc, "Image Start Loading");
 
 	pil_info(desc, "loading from %pa to %pa\n", &priv->region_start,
 							&priv->region_end);
@@ -1144,6 +1214,166 @@ static void unmap_fw_mem(void *vaddr, size_t size, void *data)
 	dma_unremap(info->dev, vaddr, size);
 }
 
+static void pil_fw_cache_free(struct pil_fw_cache *cache)
+{
+	int i;
+
+	for (i = 0; i < cache->num_blobs; i++)
+		vfree(cache->blobs[i]);
+	atomic_long_sub(atomic_long_read(&cache->size), &pil_fw_cache_bytes);
+	kfree(cache->blobs);
+	kfree(cache->mdt);
+	kfree(cache);
+}
+
+/*
+ * Take the cache of @desc for the boot of the image described by @fw, or
+ * set up an empty one to be filled while the blobs are loaded.
+ */
+static void pil_fw_cache_get(struct pil_desc *desc, const struct firmware *fw)
+{
+	struct pil_priv *priv = desc->priv;
+	const struct pil_mdt *mdt = (const struct pil_mdt *)fw->data;
+	struct pil_fw_cache *cache;
+
+	mutex_lock(&pil_fw_cache_lock);
+	cache = priv->fw_cache;
+	if (cache)
+		list_del_init(&cache->list);
+	mutex_unlock(&pil_fw_cache_lock);
+
+	if (cache && (cache->mdt_size != fw->size ||
+		      memcmp(cache->mdt, fw->data, fw->size))) {
+		pil_info(desc, "Image changed, dropping firmware cache\n");
+		pil_fw_cache_free(cache);
+		cache = NULL;
+	}
+
+	if (!cache && desc->fw_cache && READ_ONCE(fw_cache_kb)) {
+		cache = kzalloc(sizeof(*cache), GFP_KERNEL);
+		if (!cache)
+			goto out;
+		INIT_LIST_HEAD(&cache->list);
+		cache->priv = priv;
+		cache->mdt_size = fw->size;
+		cache->mdt = kmemdup(fw->data, fw->size, GFP_KERNEL);
+		cache->blobs = kcalloc(mdt->hdr.e_phnum, sizeof(*cache->blobs),
+				       GFP_KERNEL);
+		if (!cache->mdt || !cache->blobs) {
+			pil_fw_cache_free(cache);
+			cache = NULL;
+			goto out;
+		}
+		cache->num_blobs = mdt->hdr.e_phnum;
+	}
+out:
+	priv->fw_cache = cache;
+}
+
+/*
+ * Hand the cache back once pil_boot() is done with it. After a failed boot
+ * the blobs may be what failed, so they aren't kept.
+ */
+static void pil_fw_cache_put(struct pil_desc *desc, bool keep)
+{
+	struct pil_priv *priv = desc->priv;
+	struct pil_fw_cache *cache = priv->fw_cache;
+
+	if (!cache)
+		return;
+
+	if (!keep || !atomic_long_read(&cache->size)) {
+		priv->fw_cache = NULL;
+		pil_fw_cache_free(cache);
+		return;
+	}
+
+	mutex_lock(&pil_fw_cache_lock);
+	list_add_tail(&cache->list, &pil_fw_caches);
+	mutex_unlock(&pil_fw_cache_lock);
+}
+
+/* Copy a blob just read from the filesystem into the cache, if it fits */
+static void pil_fw_cache_store(struct pil_desc *desc, struct pil_seg *seg,
+			       const void __iomem *buf)
+{
+	struct pil_fw_cache *cache = desc->priv->fw_cache;
+	long limit = (long)READ_ONCE(fw_cache_kb) * SZ_1K;
+	void *blob;
+
+	if (!cache || seg->num >= cache->num_blobs || cache->blobs[seg->num])
+		return;
+
+	if (atomic_long_add_return(seg->filesz, &pil_fw_cache_bytes) > limit)
+		goto uncharge;
+
+	blob = __vmalloc(seg->filesz, GFP_KERNEL | __GFP_NOWARN, PAGE_KERNEL);
+	if (!blob)
+		goto uncharge;
+
+	memcpy_fromio(blob, buf, seg->filesz);
+	cache->blobs[seg->num] = blob;
+	atomic_long_add(seg->filesz, &cache->size);
+	return;
+uncharge:
+	atomic_long_sub(seg->filesz, &pil_fw_cache_bytes);
+}
+
+static bool pil_fw_cache_load(struct pil_desc *desc, struct pil_seg *seg,
+			      void __iomem *buf)
+{
+	struct pil_fw_cache *cache = desc->priv->fw_cache;
+
+	if (!cache || seg->num >= cache->num_blobs || !cache->blobs[seg->num])
+		return false;
+
+	memcpy_toio(buf, cache->blobs[seg->num], seg->filesz);
+	return true;
+}
+
+static unsigned long pil_fw_cache_count(struct shrinker *shrink,
+					struct shrink_control *sc)
+{
+	unsigned long count = 0;
+	struct pil_fw_cache *cache;
+
+	mutex_lock(&pil_fw_cache_lock);
+	list_for_each_entry(cache, &pil_fw_caches, list)
+		count += atomic_long_read(&cache->size) >> PAGE_SHIFT;
+	mutex_unlock(&pil_fw_cache_lock);
+
+	return count;
+}
+
+/* Drop the caches of the subsystems that restarted least recently first */
+static unsigned long pil_fw_cache_scan(struct shrinker *shrink,
+				       struct shrink_control *sc)
+{
+	unsigned long freed = 0;
+	struct pil_fw_cache *cache;
+
+	if (!mutex_trylock(&pil_fw_cache_lock))
+		return SHRINK_STOP;
+
+	while (freed < sc->nr_to_scan && !list_empty(&pil_fw_caches)) {
+		cache = list_first_entry(&pil_fw_caches, struct pil_fw_cache,
+					 list);
+		list_del(&cache->list);
+		cache->priv->fw_cache = NULL;
+		freed += atomic_long_read(&cache->size) >> PAGE_SHIFT;
+		pil_fw_cache_free(cache);
+	}
+	mutex_unlock(&pil_fw_cache_lock);
+
+	return freed;
+}
+
+static struct shrinker pil_fw_cache_shrinker = {
+	.count_objects = pil_fw_cache_count,
+	.scan_objects = pil_fw_cache_scan,
+	.seeks = DEFAULT_SEEKS,
+};
+
 static int pil_load_seg(struct pil_desc *desc, struct pil_seg *seg)
 {
 	int ret = 0, count;
@@ -1170,8 +1400,15 @@ static int pil_load_seg(struct pil_desc *desc, struct pil_seg *seg)
 			return -ENOMEM;
 		}
 
+		if (pil_fw_cache_load(desc, seg, firmware_buf)) {
+			desc->unmap_fw_mem(firmware_buf, seg->filesz, map_data);
+			goto zero;
+		}
+
 		ret = request_firmware_into_buf(&fw, fw_name, desc->dev,
 						firmware_buf, seg->filesz);
+		if (!ret && fw->size == seg->filesz)
+			pil_fw_cache_store(desc, seg, firmware_buf);
 		desc->unmap_fw_mem(firmware_buf, seg->filesz, map_data);
 
 		if (ret) {
@@ -1190,6 +1427,7 @@ static int pil_load_seg(struct pil_desc *desc, struct pil_seg *seg)
 		release_firmware(fw);
 	}
 
+zero:
 	/* Zero out trailing memory */
 	paddr = seg->paddr + seg->filesz;
 	count = seg->sz - seg->filesz;
@@ -1249,6 +1487,7 @@ static int pil_parse_devicetree(struct pil_desc *desc)
 
 	}
 	desc->proxy_unvote_irq = clk_ready;
+	desc->fw_cache = of_property_read_bool(ofnode, "qcom,pil-fw-cache");
 	return 0;
 }
 
@@ -1371,6 +1610,8 @@ int pil_boot(struct pil_desc *desc)
 	struct pil_priv *priv = desc->priv;
 	bool mem_protect = false;
 	bool hyp_assign = false;
+	ktime_t start = ktime_get(), stamp = start;
+	s64 mdt_ms, init_ms, segs_ms, auth_ms;
 
 	ret = pil_notify_aop(desc, "on");
 	if (ret < 0) {
@@ -1391,6 +1632,7 @@ int pil_boot(struct pil_desc *desc)
 		pil_err(desc, "Failed to locate %s(rc:%d)\n", fw_name, ret);
 		goto out;
 	}
+	mdt_ms = pil_lap_ms(&stamp);
 
 	if (fw->size < sizeof(*ehdr)) {
 		pil_err(desc, "Not big enough to be an elf header\n");
@@ -1419,6 +1661,7 @@ int pil_boot(struct pil_desc *desc)
 		goto release_fw;
 	}
 
+	pil_fw_cache_get(desc, fw);
 	ret = pil_init_mmap(desc, mdt);
 	if (ret)
 		goto release_fw;
@@ -1474,6 +1717,7 @@ int pil_boot(struct pil_desc *desc)
 	}
 
 	pil_log("before_load_seg", desc);
+	init_ms = pil_lap_ms(&stamp);
 
 	/**
 	 * Fallback to serial loading of blobs if the
@@ -1490,6 +1734,7 @@ int pil_boot(struct pil_desc *desc)
 				goto err_deinit_image;
 		}
 	}
+	segs_ms = pil_lap_ms(&stamp);
 
 	if (desc->subsys_vmid > 0) {
 		pil_log("before_reclaim_mem", desc);
@@ -1511,11 +1756,14 @@ int pil_boot(struct pil_desc *desc)
 		goto err_auth_and_reset;
 	}
 	pil_log("reset_done", desc);
+	auth_ms = pil_lap_ms(&stamp);
 
-	if (!strcmp(desc->name, "modem"))
-		place_marker("M - Modem out of reset");
+	pil_boot_marker(desc, "out of reset");
 
 	pil_info(desc, "Brought out of reset\n");
+	pil_info(desc, "Boot took %lld ms: mdt %lld, init %lld, segments %lld, auth and reset %lld\n",
+		 ktime_ms_delta(stamp, start), mdt_ms, init_ms, segs_ms,
+		 auth_ms);
 	desc->modem_ssr = false;
 err_auth_and_reset:
 	if (ret && desc->subsys_vmid > 0) {
@@ -1531,6 +1779,7 @@ int pil_boot(struct pil_desc *desc)
 		disable_irq(desc->proxy_unvote_irq);
 	pil_proxy_unvote(desc, ret);
 release_fw:
+	pil_fw_cache_put(desc, !ret);
 	release_firmware(fw);
 out:
 	up_read(&pil_pm_rwsem);
@@ -1786,6 +2035,13 @@ void pil_desc_release(struct pil_desc *desc)
 		ida_simple_remove(&pil_ida, priv->id);
 		flush_delayed_work(&priv->proxy);
 		wakeup_source_trash(&priv->ws);
+
+		mutex_lock(&pil_fw_cache_lock);
+		if (priv->fw_cache) {
+			list_del(&priv->fw_cache->list);
+			pil_fw_cache_free(priv->fw_cache);
+		}
+		mutex_unlock(&pil_fw_cache_lock);
 	}
 	desc->priv = NULL;
 	kfree(priv);
@@ -1860,6 +2116,8 @@ static int __init msm_pil_init(void)
 	if (!pil_ipc_log)
 		pr_debug("Failed to setup PIL ipc logging\n");
 out:
+	if (register_shrinker(&pil_fw_cache_shrinker))
+		pr_warn("pil: firmware caches won't be reclaimed\n");
 	return register_pm_notifier(&pil_pm_notifier);
 }
 subsys_initcall(msm_pil_init);
@@ -1869,6 +2127,7 @@ static void __exit msm_pil_exit(void)
 	if (pil_wq)
 		destroy_workqueue(pil_wq);
 	unregister_pm_notifier(&pil_pm_notifier);
+	unregister_shrinker(&pil_fw_cache_shrinker);
 	if (pil_info_base)
 		iounmap(pil_info_base);
 
@@ -50,6 +50,7 @@ do { \
  * @modem_ssr: true if modem is restarting, false if booting for first time.
  * @clear_fw_region: Clear fw region on failure in loading.
  * @subsys_vmid: memprot id for the subsystem.
+ * @fw_cache: Keep the blobs in memory for the next boot of the subsystem.
  */
 struct pil_desc {
 	const char *name;
@@ -70,6 +71,7 @@ struct pil_desc {
 	bool modem_ssr;
 	bool clear_fw_region;
 	bool sequential_loading;
+	bool fw_cache;
 	u32 subsys_vmid;
 	bool signal_aop;
 	struct mbox_client cl;
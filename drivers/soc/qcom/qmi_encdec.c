@@ -707,20 +707,408 @@ static int qmi_decode(struct qmi_elem_info *ei_array, void *out_c_struct,
 	return decoded_bytes;
 }
 
+/*
+ * Precompiled message plans
+ *
+ * Most QMI messages are a list of TLVs each holding basic elements, or
+ * structs made only of basic elements, behind an optional flag and a data
+ * length. For those the element info table is flattened once into one
+ * entry per TLV and a list of byte runs to copy, so encoding and decoding
+ * no longer walk the table element by element. Messages using strings or
+ * deeper nesting keep using the generic qmi_encode()/qmi_decode().
+ */
+
+/* A run of bytes copied unmodified between C struct and wire format */
+struct qmi_plan_copy {
+	u32 offset;
+	u32 size;
+};
+
+struct qmi_plan_tlv {
+	u8 type;
+	bool optional;
+	bool bulk;		/* elements are copied with a single memcpy */
+	u8 len_sz;		/* wire size of the element count, 0 if fixed */
+	u8 len_c_sz;		/* C size of the element count */
+	u32 opt_offset;
+	u32 len_offset;
+	u32 offset;		/* of the first element in the C struct */
+	u32 elem_len;		/* number of elements, or maximum if variable */
+	u32 stride;		/* C size of an element */
+	u32 wire_size;		/* encoded size of an element */
+	u32 first_copy;
+	u32 nr_copies;
+};
+
+struct qmi_encdec_plan {
+	struct qmi_elem_info *ei;
+	bool flat;
+	u32 nr_tlvs;
+	u32 nr_copies;
+	struct qmi_plan_tlv *tlvs;
+	struct qmi_plan_copy *copies;
+};
+
+static bool qmi_plan_basic_type(enum qmi_elem_type type)
+{
+	switch (type) {
+	case QMI_UNSIGNED_1_BYTE:
+	case QMI_UNSIGNED_2_BYTE:
+	case QMI_UNSIGNED_4_BYTE:
+	case QMI_UNSIGNED_8_BYTE:
+	case QMI_SIGNED_2_BYTE_ENUM:
+	case QMI_SIGNED_4_BYTE_ENUM:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static void qmi_plan_add_copy(struct qmi_encdec_plan *plan,
+			      struct qmi_plan_tlv *tlv, u32 offset, u32 size)
+{
+	struct qmi_plan_copy *copy;
+
+	tlv->wire_size += size;
+
+	/* Sizing pass, only count */
+	if (!plan->tlvs) {
+		tlv->nr_copies++;
+		plan->nr_copies++;
+		return;
+	}
+
+	copy = &plan->copies[tlv->first_copy + tlv->nr_copies];
+	if (tlv->nr_copies && copy[-1].offset + copy[-1].size == offset) {
+		copy[-1].size += size;
+		return;
+	}
+
+	copy->offset = offset;
+	copy->size = size;
+	tlv->nr_copies++;
+	plan->nr_copies++;
+}
+
+/*
+ * Walk a level 1 element info table, either only sizing the plan when
+ * plan->tlvs is NULL, or filling it in. Returns -EOPNOTSUPP if the table
+ * can't be flattened.
+ */
+static int qmi_plan_walk(struct qmi_encdec_plan *plan,
+			 struct qmi_elem_info *ei)
+{
+	struct qmi_plan_tlv tmp, *tlv;
+	struct qmi_elem_info *sub;
+	u32 elem_len;
+
+	while (ei->data_type != QMI_EOTI) {
+		tlv = plan->tlvs ? &plan->tlvs[plan->nr_tlvs] : &tmp;
+		memset(tlv, 0, sizeof(*tlv));
+		tlv->type = ei->tlv_type;
+		tlv->first_copy = plan->nr_copies;
+
+		if (ei->data_type == QMI_OPT_FLAG) {
+			tlv->optional = true;
+			tlv->opt_offset = ei->offset;
+			ei++;
+		}
+
+		if (ei->data_type == QMI_DATA_LEN) {
+			if (ei->elem_size > sizeof(u32))
+				return -EOPNOTSUPP;
+			tlv->len_sz = ei->elem_size == sizeof(u8) ?
+					sizeof(u8) : sizeof(u16);
+			tlv->len_c_sz = ei->elem_size;
+			tlv->len_offset = ei->offset;
+			ei++;
+		}
+
+		if (ei->data_type == QMI_EOTI || ei->tlv_type != tlv->type)
+			return -EOPNOTSUPP;
+
+		/* Only variable length arrays come with a data length */
+		switch (ei->is_array) {
+		case NO_ARRAY:
+			if (tlv->len_sz)
+				return -EOPNOTSUPP;
+			tlv->elem_len = 1;
+			break;
+		case STATIC_ARRAY:
+			if (tlv->len_sz)
+				return -EOPNOTSUPP;
+			tlv->elem_len = ei->elem_len;
+			break;
+		case VAR_LEN_ARRAY:
+			if (!tlv->len_sz)
+				return -EOPNOTSUPP;
+			tlv->elem_len = ei->elem_len;
+			break;
+		default:
+			return -EOPNOTSUPP;
+		}
+
+		tlv->offset = ei->offset;
+		tlv->stride = ei->elem_size;
+
+		if (qmi_plan_basic_type(ei->data_type)) {
+			qmi_plan_add_copy(plan, tlv, 0, ei->elem_size);
+		} else if (ei->data_type == QMI_STRUCT && ei->ei_array) {
+			for (sub = ei->ei_array; sub->data_type != QMI_EOTI;
+			     sub++) {
+				if (!qmi_plan_basic_type(sub->data_type))
+					return -EOPNOTSUPP;
+				if (sub->is_array == NO_ARRAY)
+					elem_len = 1;
+				else if (sub->is_array == STATIC_ARRAY)
+					elem_len = sub->elem_len;
+				else
+					return -EOPNOTSUPP;
+				qmi_plan_add_copy(plan, tlv, sub->offset,
+						  elem_len * sub->elem_size);
+			}
+		} else {
+			return -EOPNOTSUPP;
+		}
+
+		if (!tlv->wire_size)
+			return -EOPNOTSUPP;
+
+		tlv->bulk = tlv->nr_copies == 1 &&
+			    plan->tlvs &&
+			    plan->copies[tlv->first_copy].offset == 0 &&
+			    plan->copies[tlv->first_copy].size == tlv->stride;
+
+		/* All elements of a TLV must have been consumed */
+		ei++;
+		if (ei->data_type != QMI_EOTI && ei->tlv_type == tlv->type)
+			return -EOPNOTSUPP;
+
+		plan->nr_tlvs++;
+	}
+
+	return 0;
+}
+
 /**
- * qmi_encode_message() - Encode C structure as QMI encoded message
- * @type:	Type of QMI message
- * @msg_id:	Message ID of the message
- * @len:	Passed as max length of the message, updated to actual size
- * @txn_id:	Transaction ID
+ * qmi_encdec_plan_create() - Precompile a QMI message descriptor
  * @ei:		QMI message descriptor
- * @c_struct:	Reference to structure to encode
  *
- * Returns buffer with encoded message, or negative ERR_PTR() on error
+ * Returns a plan to be passed to qmi_encode_message_plan() and
+ * qmi_decode_message_plan(), or NULL on allocation failure.
+ *
+ * The plan refers to @ei, which must stay valid until the plan is
+ * released with qmi_encdec_plan_destroy(). Descriptors that can't be
+ * flattened still get a plan, which uses the generic encoder and decoder.
  */
-void *qmi_encode_message(int type, unsigned int msg_id, size_t *len,
-			 unsigned int txn_id, struct qmi_elem_info *ei,
-			 const void *c_struct)
+struct qmi_encdec_plan *qmi_encdec_plan_create(struct qmi_elem_info *ei)
+{
+	struct qmi_encdec_plan size = {0};
+	struct qmi_encdec_plan *plan;
+	size_t len = sizeof(*plan);
+	bool flat;
+
+	flat = ei && !qmi_plan_walk(&size, ei);
+	if (flat)
+		len += size.nr_tlvs * sizeof(struct qmi_plan_tlv) +
+		       size.nr_copies * sizeof(struct qmi_plan_copy);
+
+	plan = kzalloc(len, GFP_KERNEL);
+	if (!plan)
+		return NULL;
+
+	plan->ei = ei;
+	if (flat) {
+		plan->tlvs = (struct qmi_plan_tlv *)(plan + 1);
+		plan->copies = (struct qmi_plan_copy *)
+				(plan->tlvs + size.nr_tlvs);
+		plan->flat = !qmi_plan_walk(plan, ei);
+	}
+
+	return plan;
+}
+EXPORT_SYMBOL(qmi_encdec_plan_create);
+
+/**
+ * qmi_encdec_plan_destroy() - Release a precompiled QMI message descriptor
+ * @plan:	plan from qmi_encdec_plan_create()
+ */
+void qmi_encdec_plan_destroy(struct qmi_encdec_plan *plan)
+{
+	kfree(plan);
+}
+EXPORT_SYMBOL(qmi_encdec_plan_destroy);
+
+/**
+ * qmi_encdec_plan_flat() - Check if a plan bypasses the generic encoder
+ * @plan:	plan from qmi_encdec_plan_create()
+ */
+bool qmi_encdec_plan_flat(const struct qmi_encdec_plan *plan)
+{
+	return plan->flat;
+}
+EXPORT_SYMBOL(qmi_encdec_plan_flat);
+
+static int qmi_plan_encode(const struct qmi_encdec_plan *plan, void *out_buf,
+			   const void *in_c_struct, u32 out_buf_len)
+{
+	const struct qmi_plan_tlv *tlv;
+	const struct qmi_plan_copy *copy;
+	u8 *buf_dst = out_buf;
+	const u8 *buf_src;
+	u32 count, tlv_len, i, j;
+
+	for (tlv = plan->tlvs; tlv < plan->tlvs + plan->nr_tlvs; tlv++) {
+		if (tlv->optional &&
+		    !*(const u8 *)(in_c_struct + tlv->opt_offset))
+			continue;
+
+		count = tlv->elem_len;
+		if (tlv->len_sz) {
+			count = 0;
+			memcpy(&count, in_c_struct + tlv->len_offset,
+			       tlv->len_c_sz);
+			if (count > tlv->elem_len) {
+				pr_err("%s: Invalid data length\n", __func__);
+				return -EINVAL;
+			}
+		}
+
+		tlv_len = tlv->len_sz + count * tlv->wire_size;
+		if ((buf_dst - (u8 *)out_buf) + TLV_TYPE_SIZE + TLV_LEN_SIZE +
+		    tlv_len > out_buf_len) {
+			pr_err("%s: Too Small Buffer @tlv_type:%d\n",
+			       __func__, tlv->type);
+			return -ETOOSMALL;
+		}
+
+		QMI_ENCDEC_ENCODE_TLV(tlv->type, tlv_len, buf_dst);
+		memcpy(buf_dst, &count, tlv->len_sz);
+		buf_dst += tlv->len_sz;
+
+		buf_src = in_c_struct + tlv->offset;
+		if (tlv->bulk) {
+			memcpy(buf_dst, buf_src, count * tlv->stride);
+			buf_dst += count * tlv->stride;
+			continue;
+		}
+
+		for (i = 0; i < count; i++, buf_src += tlv->stride) {
+			copy = &plan->copies[tlv->first_copy];
+			for (j = 0; j < tlv->nr_copies; j++, copy++) {
+				memcpy(buf_dst, buf_src + copy->offset,
+				       copy->size);
+				buf_dst += copy->size;
+			}
+		}
+	}
+
+	return buf_dst - (u8 *)out_buf;
+}
+
+static const struct qmi_plan_tlv *
+qmi_plan_find_tlv(const struct qmi_encdec_plan *plan, u8 type)
+{
+	const struct qmi_plan_tlv *tlv;
+
+	for (tlv = plan->tlvs; tlv < plan->tlvs + plan->nr_tlvs; tlv++) {
+		if (tlv->type == type)
+			return tlv;
+	}
+
+	return NULL;
+}
+
+static int qmi_plan_decode(const struct qmi_encdec_plan *plan,
+			   void *out_c_struct, const void *in_buf,
+			   u32 in_buf_len)
+{
+	const struct qmi_plan_tlv *tlv;
+	const struct qmi_plan_copy *copy;
+	const u8 *buf_src = in_buf;
+	const u8 *buf_end = buf_src + in_buf_len;
+	const u8 *tlv_pointer;
+	u32 tlv_type, tlv_len, count, i, j;
+	u8 *buf_dst;
+
+	while (buf_src < buf_end) {
+		if (buf_end - buf_src < TLV_TYPE_SIZE + TLV_LEN_SIZE) {
+			pr_err("%s: Truncated TLV header\n", __func__);
+			return -EFAULT;
+		}
+
+		tlv_pointer = buf_src;
+		QMI_ENCDEC_DECODE_TLV(&tlv_type, &tlv_len, tlv_pointer);
+		buf_src += TLV_TYPE_SIZE + TLV_LEN_SIZE;
+		if (tlv_len > buf_end - buf_src) {
+			pr_err("%s: TLV len %d > Input Buffer Len %zd\n",
+			       __func__, tlv_len, buf_end - buf_src);
+			return -EFAULT;
+		}
+
+		tlv_pointer = buf_src;
+		buf_src += tlv_len;
+
+		tlv = qmi_plan_find_tlv(plan, tlv_type);
+		if (!tlv && tlv_type < OPTIONAL_TLV_TYPE_START) {
+			pr_err("%s: Inval element info\n", __func__);
+			return -EINVAL;
+		} else if (!tlv) {
+			continue;
+		}
+
+		if (tlv->optional)
+			*(u8 *)(out_c_struct + tlv->opt_offset) = 1;
+
+		count = tlv->elem_len;
+		if (tlv->len_sz) {
+			if (tlv_len < tlv->len_sz) {
+				pr_err("%s: Truncated data length\n", __func__);
+				return -EFAULT;
+			}
+			count = 0;
+			memcpy(&count, tlv_pointer, tlv->len_sz);
+			tlv_pointer += tlv->len_sz;
+			tlv_len -= tlv->len_sz;
+			if (count > tlv->elem_len) {
+				pr_err("%s: Data len %d > max spec %d\n",
+				       __func__, count, tlv->elem_len);
+				return -ETOOSMALL;
+			}
+			/* Same as qmi_decode(), the length is stored as u32 */
+			memcpy(out_c_struct + tlv->len_offset, &count,
+			       sizeof(u32));
+		}
+
+		if (count * tlv->wire_size > tlv_len) {
+			pr_err("%s: Fault in decoding: tl(%d), el(%d)\n",
+			       __func__, tlv_len, count);
+			return -EFAULT;
+		}
+
+		buf_dst = out_c_struct + tlv->offset;
+		if (tlv->bulk) {
+			memcpy(buf_dst, tlv_pointer, count * tlv->stride);
+			continue;
+		}
+
+		for (i = 0; i < count; i++, buf_dst += tlv->stride) {
+			copy = &plan->copies[tlv->first_copy];
+			for (j = 0; j < tlv->nr_copies; j++, copy++) {
+				memcpy(buf_dst + copy->offset, tlv_pointer,
+				       copy->size);
+				tlv_pointer += copy->size;
+			}
+		}
+	}
+
+	return in_buf_len;
+}
+
+static void *__qmi_encode_message(int type, unsigned int msg_id, size_t *len,
+				  unsigned int txn_id, struct qmi_elem_info *ei,
+				  const struct qmi_encdec_plan *plan,
+				  const void *c_struct)
 {
 	struct qmi_header *hdr;
 	ssize_t msglen = 0;
@@ -745,7 +1133,12 @@ void *qmi_encode_message(int type, unsigned int msg_id, size_t *len,
 
 	/* Encode message, if we have a message */
 	if (c_struct) {
-		msglen = qmi_encode(ei, msg + sizeof(*hdr), c_struct, *len, 1);
+		if (plan && plan->flat)
+			msglen = qmi_plan_encode(plan, msg + sizeof(*hdr),
+						 c_struct, *len);
+		else
+			msglen = qmi_encode(ei, msg + sizeof(*hdr), c_struct,
+					    *len, 1);
 		if (msglen < 0) {
 			kfree(msg);
 			return ERR_PTR(msglen);
@@ -762,8 +1155,48 @@ void *qmi_encode_message(int type, unsigned int msg_id, size_t *len,
 
 	return msg;
 }
+
+/**
+ * qmi_encode_message() - Encode C structure as QMI encoded message
+ * @type:	Type of QMI message
+ * @msg_id:	Message ID of the message
+ * @len:	Passed as max length of the message, updated to actual size
+ * @txn_id:	Transaction ID
+ * @ei:		QMI message descriptor
+ * @c_struct:	Reference to structure to encode
+ *
+ * Returns buffer with encoded message, or negative ERR_PTR() on error
+ */
+void *qmi_encode_message(int type, unsigned int msg_id, size_t *len,
+			 unsigned int txn_id, struct qmi_elem_info *ei,
+			 const void *c_struct)
+{
+	return __qmi_encode_message(type, msg_id, len, txn_id, ei, NULL,
+				    c_struct);
+}
 EXPORT_SYMBOL(qmi_encode_message);
 
+/**
+ * qmi_encode_message_plan() - Encode C structure using a precompiled plan
+ * @type:	Type of QMI message
+ * @msg_id:	Message ID of the message
+ * @len:	Passed as max length of the message, updated to actual size
+ * @txn_id:	Transaction ID
+ * @plan:	plan from qmi_encdec_plan_create()
+ * @c_struct:	Reference to structure to encode
+ *
+ * Returns buffer with encoded message, or negative ERR_PTR() on error
+ */
+void *qmi_encode_message_plan(int type, unsigned int msg_id, size_t *len,
+			      unsigned int txn_id,
+			      const struct qmi_encdec_plan *plan,
+			      const void *c_struct)
+{
+	return __qmi_encode_message(type, msg_id, len, txn_id, plan->ei, plan,
+				    c_struct);
+}
+EXPORT_SYMBOL(qmi_encode_message_plan);
+
 /**
  * qmi_decode_message() - Decode QMI encoded message to C structure
  * @buf:	Buffer with encoded message
@@ -788,6 +1221,30 @@ int qmi_decode_message(const void *buf, size_t len,
 }
 EXPORT_SYMBOL(qmi_decode_message);
 
+/**
+ * qmi_decode_message_plan() - Decode QMI message using a precompiled plan
+ * @buf:	Buffer with encoded message
+ * @len:	Amount of data in @buf
+ * @plan:	plan from qmi_encdec_plan_create()
+ * @c_struct:	Reference to structure to decode into
+ *
+ * Returns the number of bytes of decoded information on success, negative
+ * errno on error.
+ */
+int qmi_decode_message_plan(const void *buf, size_t len,
+			    const struct qmi_encdec_plan *plan, void *c_struct)
+{
+	if (!plan->flat)
+		return qmi_decode_message(buf, len, plan->ei, c_struct);
+
+	if (!c_struct || !buf || len < sizeof(struct qmi_header))
+		return -EINVAL;
+
+	return qmi_plan_decode(plan, c_struct, buf + sizeof(struct qmi_header),
+			       len - sizeof(struct qmi_header));
+}
+EXPORT_SYMBOL(qmi_decode_message_plan);
+
 /* Common header in all QMI responses */
 struct qmi_elem_info qmi_response_type_v01_ei[] = {
 	{
@@ -19,6 +19,8 @@
 #include <linux/net.h>
 #include <linux/completion.h>
 #include <linux/idr.h>
+#include <linux/rculist.h>
+#include <linux/slab.h>
 #include <linux/string.h>
 #include <net/sock.h>
 #include <linux/workqueue.h>
@@ -381,6 +383,86 @@ void qmi_txn_cancel(struct qmi_txn *txn)
 }
 EXPORT_SYMBOL(qmi_txn_cancel);
 
+struct qmi_plan_entry {
+	struct hlist_node node;
+	struct qmi_elem_info *ei;
+	struct qmi_encdec_plan *plan;
+};
+
+/*
+ * Find the precompiled plan for @ei, compiling it on first use. Entries are
+ * only removed in qmi_handle_release(), so a plan stays valid for as long
+ * as the handle. Returns NULL if no plan could be allocated, in which case
+ * the caller falls back to the generic encoder and decoder.
+ */
+static const struct qmi_encdec_plan *qmi_handle_plan(struct qmi_handle *qmi,
+						     struct qmi_elem_info *ei)
+{
+	struct qmi_plan_entry *entry;
+	unsigned long key = (unsigned long)ei;
+
+	if (!ei)
+		return NULL;
+
+	rcu_read_lock();
+	hash_for_each_possible_rcu(qmi->plans, entry, node, key) {
+		if (entry->ei == ei) {
+			rcu_read_unlock();
+			return entry->plan;
+		}
+	}
+	rcu_read_unlock();
+
+	mutex_lock(&qmi->plan_lock);
+	hash_for_each_possible(qmi->plans, entry, node, key) {
+		if (entry->ei == ei)
+			goto out;
+	}
+
+	entry = kzalloc(sizeof(*entry), GFP_KERNEL);
+	if (!entry)
+		goto out;
+
+	entry->plan = qmi_encdec_plan_create(ei);
+	if (!entry->plan) {
+		kfree(entry);
+		entry = NULL;
+		goto out;
+	}
+
+	entry->ei = ei;
+	hash_add_rcu(qmi->plans, &entry->node, key);
+out:
+	mutex_unlock(&qmi->plan_lock);
+
+	return entry ? entry->plan : NULL;
+}
+
+static void qmi_handle_free_plans(struct qmi_handle *qmi)
+{
+	struct qmi_plan_entry *entry;
+	struct hlist_node *tmp;
+	int bkt;
+
+	hash_for_each_safe(qmi->plans, bkt, tmp, entry, node) {
+		hash_del(&entry->node);
+		qmi_encdec_plan_destroy(entry->plan);
+		kfree(entry);
+	}
+}
+
+static int qmi_handle_decode(struct qmi_handle *qmi, const void *buf,
+			     size_t len, struct qmi_elem_info *ei,
+			     void *c_struct)
+{
+	const struct qmi_encdec_plan *plan = qmi_handle_plan(qmi, ei);
+
+	if (plan)
+		return qmi_decode_message_plan(buf, len, plan, c_struct);
+
+	return qmi_decode_message(buf, len, ei, c_struct);
+}
+
 /**
  * qmi_invoke_handler() - find and invoke a handler for a message
  * @qmi:	qmi handle
@@ -415,7 +497,7 @@ static void qmi_invoke_handler(struct qmi_handle *qmi, struct sockaddr_qrtr *sq,
 	if (!dest)
 		return;
 
-	ret = qmi_decode_message(buf, len, handler->ei, dest);
+	ret = qmi_handle_decode(qmi, buf, len, handler->ei, dest);
 	if (ret < 0)
 		pr_err("failed to decode incoming message\n");
 	else
@@ -506,7 +588,8 @@ static void qmi_handle_message(struct qmi_handle *qmi,
 			return;
 		}
 		if (txn->dest && txn->ei) {
-			ret = qmi_decode_message(buf, len, txn->ei, txn->dest);
+			ret = qmi_handle_decode(qmi, buf, len, txn->ei,
+						txn->dest);
 			if (ret < 0)
 				pr_err("failed to decode incoming message\n");
 
@@ -645,10 +728,13 @@ EXPORT_SYMBOL(qmi_set_sndtimeo);
 int qmi_handle_init(struct qmi_handle *qmi, size_t recv_buf_size,
 		    struct qmi_ops *ops, struct qmi_msg_handler *handlers)
 {
+	struct qmi_msg_handler *handler;
 	int ret;
 
 	mutex_init(&qmi->txn_lock);
 	mutex_init(&qmi->sock_lock);
+	mutex_init(&qmi->plan_lock);
+	hash_init(qmi->plans);
 
 	idr_init(&qmi->txns);
 
@@ -686,6 +772,10 @@ int qmi_handle_init(struct qmi_handle *qmi, size_t recv_buf_size,
 		goto err_destroy_wq;
 	}
 
+	/* Compile the incoming messages up front, others on first use */
+	for (handler = handlers; handler && handler->fn; handler++)
+		qmi_handle_plan(qmi, handler->ei);
+
 	return 0;
 
 err_destroy_wq:
@@ -747,6 +837,8 @@ void qmi_handle_release(struct qmi_handle *qmi)
 		list_del(&svc->list_node);
 		kfree(svc);
 	}
+
+	qmi_handle_free_plans(qmi);
 }
 EXPORT_SYMBOL(qmi_handle_release);
 
@@ -772,15 +864,20 @@ static ssize_t qmi_send_message(struct qmi_handle *qmi,
 				int type, int msg_id, size_t len,
 				struct qmi_elem_info *ei, const void *c_struct)
 {
+	const struct qmi_encdec_plan *plan = qmi_handle_plan(qmi, ei);
 	struct msghdr msghdr = {0};
 	struct kvec iv;
 	void *msg;
 	int ret;
 
-	msg = qmi_encode_message(type,
-				 msg_id, &len,
-				 txn->id, ei,
-				 c_struct);
+	if (plan)
+		msg = qmi_encode_message_plan(type, msg_id, &len, txn->id,
+					      plan, c_struct);
+	else
+		msg = qmi_encode_message(type,
+					 msg_id, &len,
+					 txn->id, ei,
+					 c_struct);
 	if (IS_ERR(msg))
 		return PTR_ERR(msg);
 
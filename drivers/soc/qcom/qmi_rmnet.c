@@ -25,6 +25,8 @@
 #include <linux/ip.h>
 #include <linux/ipv6.h>
 #include <linux/alarmtimer.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #define NLMSG_FLOW_ACTIVATE 1
 #define NLMSG_FLOW_DEACTIVATE 2
@@ -61,6 +63,7 @@ MODULE_PARM_DESC(rmnet_wq_frequency, "Frequency of PS check in ms");
 #ifdef CONFIG_QCOM_QMI_DFC
 static unsigned int qmi_rmnet_scale_factor = 5;
 static LIST_HEAD(qos_cleanup_list);
+static LIST_HEAD(qos_active_list);
 #endif
 
 static int
@@ -151,17 +154,23 @@ qmi_rmnet_clean_flow_list(struct qos_info *qos)
 
 	list_for_each_entry_safe(itm, fl_tmp, &qos->flow_head, list) {
 		list_del(&itm->list);
+		hash_del(&itm->hnode);
 		kfree(itm);
 	}
 
 	list_for_each_entry_safe(bearer, br_tmp, &qos->bearer_head, list) {
 		list_del(&bearer->list);
+		hash_del(&bearer->hnode);
 		kfree(bearer);
 	}
 
 	memset(qos->mq, 0, sizeof(qos->mq));
 }
 
+/*
+ * Lookups need either qos_lock or rcu_read_lock. Only the former
+ * allows modifying the returned entry.
+ */
 struct rmnet_flow_map *
 qmi_rmnet_get_flow_map(struct qos_info *qos, u32 flow_id, int ip_type)
 {
@@ -170,7 +179,7 @@ qmi_rmnet_get_flow_map(struct qos_info *qos, u32 flow_id, int ip_type)
 	if (!qos)
 		return NULL;
 
-	list_for_each_entry(itm, &qos->flow_head, list) {
+	hash_for_each_possible_rcu(qos->flow_map, itm, hnode, flow_id) {
 		if ((itm->flow_id == flow_id) && (itm->ip_type == ip_type))
 			return itm;
 	}
@@ -185,7 +194,7 @@ qmi_rmnet_get_bearer_map(struct qos_info *qos, uint8_t bearer_id)
 	if (!qos)
 		return NULL;
 
-	list_for_each_entry(itm, &qos->bearer_head, list) {
+	hash_for_each_possible_rcu(qos->bearer_map, itm, hnode, bearer_id) {
 		if (itm->bearer_id == bearer_id)
 			return itm;
 	}
@@ -315,7 +324,7 @@ static void qmi_rmnet_bearer_clean(struct qos_info *qos)
 	if (qos->removed_bearer) {
 		qos->removed_bearer->watchdog_quit = true;
 		del_timer_sync(&qos->removed_bearer->watchdog);
-		kfree(qos->removed_bearer);
+		kfree_rcu(qos->removed_bearer, rcu);
 		qos->removed_bearer = NULL;
 	}
 }
@@ -342,6 +351,7 @@ static struct rmnet_bearer_map *__qmi_rmnet_bearer_get(
 		bearer->qos = qos_info;
 		timer_setup(&bearer->watchdog, qmi_rmnet_watchdog_fn, 0);
 		list_add(&bearer->list, &qos_info->bearer_head);
+		hash_add_rcu(qos_info->bearer_map, &bearer->hnode, bearer_id);
 	}
 
 	return bearer;
@@ -376,6 +386,7 @@ static void __qmi_rmnet_bearer_put(struct net_device *dev,
 
 		/* Remove from bearer map */
 		list_del(&bearer->list);
+		hash_del_rcu(&bearer->hnode);
 		qos_info->removed_bearer = bearer;
 	}
 }
@@ -424,11 +435,13 @@ static int __qmi_rmnet_rebind_flow(struct net_device *dev,
 	__qmi_rmnet_bearer_put(dev, qos_info, itm->bearer, false);
 
 	bearer = __qmi_rmnet_bearer_get(qos_info, new_map->bearer_id);
-	if (!bearer)
+	if (!bearer) {
+		WRITE_ONCE(itm->bearer, NULL);
 		return -ENOMEM;
+	}
 
 	qmi_rmnet_update_flow_map(itm, new_map);
-	itm->bearer = bearer;
+	WRITE_ONCE(itm->bearer, bearer);
 
 	__qmi_rmnet_update_mq(dev, qos_info, bearer, itm);
 
@@ -492,16 +505,19 @@ static int qmi_rmnet_add_flow(struct net_device *dev, struct tcmsg *tcm,
 	}
 
 	qmi_rmnet_update_flow_map(itm, &new_map);
-	list_add(&itm->list, &qos_info->flow_head);
 
 	/* Create or update bearer map */
 	bearer = __qmi_rmnet_bearer_get(qos_info, new_map.bearer_id);
 	if (!bearer) {
+		kfree(itm);
 		rc = -ENOMEM;
 		goto done;
 	}
 
+	/* Fully set up before it becomes visible to the TX path */
 	itm->bearer = bearer;
+	list_add(&itm->list, &qos_info->flow_head);
+	hash_add_rcu(qos_info->flow_map, &itm->hnode, itm->flow_id);
 
 	__qmi_rmnet_update_mq(dev, qos_info, bearer, itm);
 
@@ -546,7 +562,8 @@ qmi_rmnet_del_flow(struct net_device *dev, struct tcmsg *tcm,
 
 		/* Remove from flow map */
 		list_del(&itm->list);
-		kfree(itm);
+		hash_del_rcu(&itm->hnode);
+		kfree_rcu(itm, rcu);
 	}
 
 	if (list_empty(&qos_info->flow_head))
@@ -858,22 +875,23 @@ bool qmi_rmnet_all_flows_enabled(struct net_device *dev)
 {
 	struct qos_info *qos;
 	struct rmnet_bearer_map *bearer;
+	int bkt;
 	bool ret = true;
 
 	qos = (struct qos_info *)rmnet_get_qos_pt(dev);
 	if (!qos)
 		return true;
 
-	spin_lock_bh(&qos->qos_lock);
+	rcu_read_lock();
 
-	list_for_each_entry(bearer, &qos->bearer_head, list) {
-		if (!bearer->grant_size) {
+	hash_for_each_rcu(qos->bearer_map, bkt, bearer, hnode) {
+		if (!READ_ONCE(bearer->grant_size)) {
 			ret = false;
 			break;
 		}
 	}
 
-	spin_unlock_bh(&qos->qos_lock);
+	rcu_read_unlock();
 
 	return ret;
 }
@@ -935,6 +953,7 @@ static inline bool qmi_rmnet_is_tcp_ack(struct sk_buff *skb)
 static int qmi_rmnet_get_queue_sa(struct qos_info *qos, struct sk_buff *skb)
 {
 	struct rmnet_flow_map *itm;
+	struct rmnet_bearer_map *bearer;
 	int ip_type;
 	int txq = DEFAULT_MQ_NUM;
 
@@ -948,20 +967,21 @@ static int qmi_rmnet_get_queue_sa(struct qos_info *qos, struct sk_buff *skb)
 
 	ip_type = (skb->protocol == htons(ETH_P_IPV6)) ? AF_INET6 : AF_INET;
 
-	spin_lock_bh(&qos->qos_lock);
+	rcu_read_lock();
 
 	itm = qmi_rmnet_get_flow_map(qos, skb->mark, ip_type);
 	if (unlikely(!itm))
 		goto done;
 
 	/* Put the packet in the assigned mq except TCP ack */
-	if (likely(itm->bearer) && qmi_rmnet_is_tcp_ack(skb))
-		txq = itm->bearer->ack_mq_idx;
+	bearer = READ_ONCE(itm->bearer);
+	if (likely(bearer) && qmi_rmnet_is_tcp_ack(skb))
+		txq = READ_ONCE(bearer->ack_mq_idx);
 	else
-		txq = itm->mq_idx;
+		txq = READ_ONCE(itm->mq_idx);
 
 done:
-	spin_unlock_bh(&qos->qos_lock);
+	rcu_read_unlock();
 	return txq;
 }
 
@@ -993,16 +1013,16 @@ int qmi_rmnet_get_queue(struct net_device *dev, struct sk_buff *skb)
 	ip_type = (skb->protocol == htons(ETH_P_IPV6)) ? AF_INET6 : AF_INET;
 
 	/* Dedicated flows */
-	spin_lock_bh(&qos->qos_lock);
+	rcu_read_lock();
 
 	itm = qmi_rmnet_get_flow_map(qos, mark, ip_type);
 	if (unlikely(!itm))
 		goto done;
 
-	txq = itm->mq_idx;
+	txq = READ_ONCE(itm->mq_idx);
 
 done:
-	spin_unlock_bh(&qos->qos_lock);
+	rcu_read_unlock();
 	return txq;
 }
 EXPORT_SYMBOL(qmi_rmnet_get_queue);
@@ -1028,8 +1048,13 @@ void *qmi_rmnet_qos_init(struct net_device *real_dev,
 	qos->tran_num = 0;
 	INIT_LIST_HEAD(&qos->flow_head);
 	INIT_LIST_HEAD(&qos->bearer_head);
+	hash_init(qos->flow_map);
+	hash_init(qos->bearer_map);
 	spin_lock_init(&qos->qos_lock);
 
+	ASSERT_RTNL();
+	list_add(&qos->list, &qos_active_list);
+
 	return qos;
 }
 EXPORT_SYMBOL(qmi_rmnet_qos_init);
@@ -1047,7 +1072,7 @@ void qmi_rmnet_qos_exit_pre(void *qos)
 		del_timer_sync(&bearer->watchdog);
 	}
 
-	list_add(&qosi->list, &qos_cleanup_list);
+	list_move(&qosi->list, &qos_cleanup_list);
 }
 EXPORT_SYMBOL(qmi_rmnet_qos_exit_pre);
 
@@ -1063,6 +1088,66 @@ void qmi_rmnet_qos_exit_post(void)
 	}
 }
 EXPORT_SYMBOL(qmi_rmnet_qos_exit_post);
+
+#ifdef CONFIG_DEBUG_FS
+static int qmi_rmnet_bearer_stats_show(struct seq_file *s, void *unused)
+{
+	struct rmnet_bearer_map *bearer;
+	struct qos_info *qos;
+
+	rtnl_lock();
+
+	list_for_each_entry(qos, &qos_active_list, list) {
+		spin_lock_bh(&qos->qos_lock);
+		list_for_each_entry(bearer, &qos->bearer_head, list) {
+			seq_printf(s, "%s mux=%u bearer=%u grant=%u thresh=%u inflight=%u seq=%u\n",
+				   qos->vnd_dev->name, qos->mux_id,
+				   bearer->bearer_id, bearer->grant_size,
+				   bearer->grant_thresh,
+				   bearer->bytes_in_flight, bearer->seq);
+			seq_printf(s, "\tgrant_ind=%llu grant_zero=%llu exhausted=%llu thresh_ack=%llu tx_bytes=%llu watchdog=%u\n",
+				   bearer->stats.grant_ind,
+				   bearer->stats.grant_zero,
+				   bearer->stats.grant_exhausted,
+				   bearer->stats.thresh_ack,
+				   bearer->stats.tx_bytes,
+				   bearer->watchdog_expire_cnt);
+		}
+		spin_unlock_bh(&qos->qos_lock);
+	}
+
+	rtnl_unlock();
+
+	return 0;
+}
+
+static int qmi_rmnet_bearer_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, qmi_rmnet_bearer_stats_show, NULL);
+}
+
+static const struct file_operations qmi_rmnet_bearer_stats_fops = {
+	.open		= qmi_rmnet_bearer_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init qmi_rmnet_debugfs_init(void)
+{
+	struct dentry *dir;
+
+	dir = debugfs_create_dir("qmi_rmnet", NULL);
+	if (IS_ERR_OR_NULL(dir))
+		return 0;
+
+	debugfs_create_file("bearer_stats", 0444, dir, NULL,
+			    &qmi_rmnet_bearer_stats_fops);
+
+	return 0;
+}
+late_initcall(qmi_rmnet_debugfs_init);
+#endif
 #endif
 
 #ifdef CONFIG_QCOM_QMI_POWER_COLLAPSE
@@ -17,6 +17,8 @@
 #include <linux/netdevice.h>
 #include <linux/skbuff.h>
 #include <linux/timer.h>
+#include <linux/hashtable.h>
+#include <linux/rcupdate.h>
 
 #define MAX_MQ_NUM 16
 #define MAX_CLIENT_NUM 2
@@ -26,6 +28,8 @@
 #define DEFAULT_MQ_NUM 0
 #define ACK_MQ_OFFSET (MAX_MQ_NUM - 1)
 #define INVALID_MQ 0xFF
+#define FLOW_HASH_BITS 5
+#define BEARER_HASH_BITS 4
 
 #define DFC_MODE_FLOW_ID 2
 #define DFC_MODE_MQ_NUM 3
@@ -36,8 +40,22 @@ extern int dfc_qmap;
 
 struct qos_info;
 
+struct rmnet_bearer_stats {
+	u64 grant_ind;
+	u64 grant_zero;
+	u64 grant_exhausted;
+	u64 thresh_ack;
+	u64 tx_bytes;
+};
+
+/* Flow and bearer maps are kept both on a list, walked under qos_lock, and
+ * in a hash table for lookups. The TX path looks them up under RCU only,
+ * so entries must be freed after a grace period.
+ */
 struct rmnet_bearer_map {
 	struct list_head list;
+	struct hlist_node hnode;
+	struct rcu_head rcu;
 	u8 bearer_id;
 	int flow_ref;
 	u32 grant_size;
@@ -60,10 +78,13 @@ struct rmnet_bearer_map {
 	bool watchdog_started;
 	bool watchdog_quit;
 	u32 watchdog_expire_cnt;
+	struct rmnet_bearer_stats stats;
 };
 
 struct rmnet_flow_map {
 	struct list_head list;
+	struct hlist_node hnode;
+	struct rcu_head rcu;
 	u8 bearer_id;
 	u32 flow_id;
 	int ip_type;
@@ -88,6 +109,8 @@ struct qos_info {
 	struct net_device *vnd_dev;
 	struct list_head flow_head;
 	struct list_head bearer_head;
+	DECLARE_HASHTABLE(flow_map, FLOW_HASH_BITS);
+	DECLARE_HASHTABLE(bearer_map, BEARER_HASH_BITS);
 	struct mq_map mq[MAX_MQ_NUM];
 	u32 tran_num;
 	spinlock_t qos_lock;
@@ -25,7 +25,10 @@
 #include <linux/wait.h>
 #include <linux/cdev.h>
 #include <linux/atomic.h>
+#include <linux/lz4.h>
+#include <linux/rwsem.h>
 #include <soc/qcom/ramdump.h>
+#include <uapi/linux/msm_ramdump.h>
 #include <linux/dma-mapping.h>
 #include <linux/of.h>
 
@@ -44,6 +47,7 @@ static bool ramdump_devnode_inited;
 
 struct consumer_entry {
 	bool data_ready;
+	bool lz4;
 	struct ramdump_device *rd_dev;
 	struct list_head list;
 };
@@ -57,6 +61,7 @@ struct ramdump_device {
 
 	struct completion ramdump_complete;
 	struct mutex consumer_lock;
+	struct rw_semaphore dump_rwsem;
 	struct list_head consumer_list;
 	struct cdev cdev;
 	struct device *dev;
@@ -156,127 +161,217 @@ static unsigned long offset_translate(loff_t user_offset,
 
 #define MAX_IOREMAP_SIZE SZ_1M
 
-static ssize_t ramdump_read(struct file *filep, char __user *buf, size_t count,
-			loff_t *pos)
+static void ramdump_copy_from(unsigned char *alignbuf, void *device_mem,
+			      size_t alignsize)
 {
-	struct consumer_entry *entry = filep->private_data;
-	struct ramdump_device *rd_dev = entry->rd_dev;
-	void *device_mem = NULL, *origdevice_mem = NULL, *vaddr = NULL;
-	unsigned long data_left = 0, bytes_before, bytes_after;
-	unsigned long addr = 0;
-	size_t copy_size = 0, alignsize;
-	unsigned char *alignbuf = NULL, *finalbuf = NULL;
-	int ret = 0;
-	loff_t orig_pos = *pos;
+	unsigned long bytes_before, bytes_after;
 
-	if ((filep->f_flags & O_NONBLOCK) && !entry->data_ready)
-		return -EAGAIN;
+	if ((unsigned long)device_mem & 0x7) {
+		bytes_before = 8 - ((unsigned long)device_mem & 0x7);
+		memcpy_fromio(alignbuf, device_mem, bytes_before);
+		device_mem += bytes_before;
+		alignbuf += bytes_before;
+		alignsize -= bytes_before;
+	}
 
-	ret = wait_event_interruptible(rd_dev->dump_wait_q, entry->data_ready);
-	if (ret)
-		return ret;
+	if (alignsize & 0x7) {
+		bytes_after = alignsize & 0x7;
+		memcpy(alignbuf, device_mem, alignsize - bytes_after);
+		device_mem += alignsize - bytes_after;
+		alignbuf += (alignsize - bytes_after);
+		alignsize = bytes_after;
+		memcpy_fromio(alignbuf, device_mem, alignsize);
+	} else
+		memcpy(alignbuf, device_mem, alignsize);
+}
 
-	if (*pos < rd_dev->elfcore_size) {
-		copy_size = rd_dev->elfcore_size - *pos;
-		copy_size = min(copy_size, count);
+/*
+ * Copy up to count bytes of the dump at pos into buf. A copy doesn't cross
+ * from the ELF header into a segment or from one segment into the next.
+ * Returns the number of bytes copied, or 0 at the end of the dump.
+ */
+static ssize_t ramdump_fill(struct ramdump_device *rd_dev, loff_t pos,
+			    void *buf, size_t count)
+{
+	void *device_mem = NULL, *vaddr = NULL;
+	unsigned long data_left = 0;
+	unsigned long addr = 0;
+	size_t copy_size;
 
-		if (copy_to_user(buf, rd_dev->elfcore_buf + *pos, copy_size)) {
-			ret = -EFAULT;
-			goto ramdump_done;
-		}
-		*pos += copy_size;
-		count -= copy_size;
-		buf += copy_size;
-		if (count == 0)
-			return copy_size;
+	if (pos < rd_dev->elfcore_size) {
+		copy_size = min_t(size_t, rd_dev->elfcore_size - pos, count);
+		memcpy(buf, rd_dev->elfcore_buf + pos, copy_size);
+		return copy_size;
 	}
 
-	addr = offset_translate(*pos - rd_dev->elfcore_size, rd_dev,
+	addr = offset_translate(pos - rd_dev->elfcore_size, rd_dev,
 				&data_left, &vaddr);
 
 	/* EOF check */
 	if (data_left == 0) {
 		pr_debug("Ramdump(%s): Ramdump complete. %lld bytes read.",
-			rd_dev->name, *pos);
-		rd_dev->ramdump_status = 0;
-		ret = 0;
-		goto ramdump_done;
+			rd_dev->name, pos);
+		return 0;
 	}
 
 	copy_size = min_t(size_t, count, (size_t)MAX_IOREMAP_SIZE);
 	copy_size = min_t(unsigned long, (unsigned long)copy_size, data_left);
 
-	rd_dev->attrs = 0;
-	rd_dev->attrs |= DMA_ATTR_SKIP_ZEROING;
 	device_mem = vaddr ?: dma_remap(rd_dev->dev->parent, NULL, addr,
 						copy_size, rd_dev->attrs);
-	origdevice_mem = device_mem;
-
 	if (device_mem == NULL) {
 		pr_err("Ramdump(%s): Unable to ioremap: addr %lx, size %zd\n",
 			rd_dev->name, addr, copy_size);
-		rd_dev->ramdump_status = -1;
-		ret = -ENOMEM;
-		goto ramdump_done;
+		return -ENOMEM;
 	}
 
-	alignbuf = kzalloc(copy_size, GFP_KERNEL);
-	if (!alignbuf) {
-		rd_dev->ramdump_status = -1;
-		ret = -ENOMEM;
-		goto ramdump_done;
-	}
+	ramdump_copy_from(buf, device_mem, copy_size);
 
-	finalbuf = alignbuf;
-	alignsize = copy_size;
+	if (!vaddr)
+		dma_unremap(rd_dev->dev->parent, device_mem, copy_size);
 
-	if ((unsigned long)device_mem & 0x7) {
-		bytes_before = 8 - ((unsigned long)device_mem & 0x7);
-		memcpy_fromio(alignbuf, device_mem, bytes_before);
-		device_mem += bytes_before;
-		alignbuf += bytes_before;
-		alignsize -= bytes_before;
+	pr_debug("Ramdump(%s): Read %zd bytes from address %lx.",
+			rd_dev->name, copy_size, addr);
+
+	return copy_size;
+}
+
+static ssize_t ramdump_read_raw(struct ramdump_device *rd_dev,
+				char __user *buf, size_t count, loff_t *pos)
+{
+	size_t copy_size = min_t(size_t, count, (size_t)MAX_IOREMAP_SIZE);
+	unsigned char *kbuf;
+	ssize_t ret;
+
+	/* Not zeroed, ramdump_fill() overwrites what is returned */
+	kbuf = kvmalloc(copy_size, GFP_KERNEL);
+	if (!kbuf)
+		return -ENOMEM;
+
+	ret = ramdump_fill(rd_dev, *pos, kbuf, copy_size);
+	if (ret > 0 && copy_to_user(buf, kbuf, ret)) {
+		pr_err("Ramdump(%s): Couldn't copy all data to user.",
+			rd_dev->name);
+		ret = -EFAULT;
 	}
+	kvfree(kbuf);
 
-	if (alignsize & 0x7) {
-		bytes_after = alignsize & 0x7;
-		memcpy(alignbuf, device_mem, alignsize - bytes_after);
-		device_mem += alignsize - bytes_after;
-		alignbuf += (alignsize - bytes_after);
-		alignsize = bytes_after;
-		memcpy_fromio(alignbuf, device_mem, alignsize);
-	} else
-		memcpy(alignbuf, device_mem, alignsize);
+	if (ret > 0)
+		*pos += ret;
+	return ret;
+}
+
+/* Read one struct ramdump_lz4_frame, see uapi/linux/msm_ramdump.h */
+static ssize_t ramdump_read_lz4(struct ramdump_device *rd_dev,
+				char __user *buf, size_t count, loff_t *pos)
+{
+	struct ramdump_lz4_frame frame = {
+		.magic = RAMDUMP_LZ4_MAGIC,
+		.offset = *pos,
+	};
+	size_t raw_max, comp_max;
+	char *raw, *comp, *data;
+	void *wrkmem;
+	ssize_t ret;
+	int comp_size;
+
+	/* Leave room for the frame and the worst case LZ4 expansion */
+	raw_max = (count - sizeof(frame) - 16) / 256 * 255;
+	raw_max = min_t(size_t, raw_max, (size_t)MAX_IOREMAP_SIZE);
+	comp_max = LZ4_COMPRESSBOUND(raw_max);
+
+	wrkmem = kvmalloc(LZ4_MEM_COMPRESS + raw_max + comp_max, GFP_KERNEL);
+	if (!wrkmem)
+		return -ENOMEM;
+	raw = (char *)wrkmem + LZ4_MEM_COMPRESS;
+	comp = raw + raw_max;
+
+	ret = ramdump_fill(rd_dev, *pos, raw, raw_max);
+	if (ret <= 0)
+		goto out;
+
+	frame.raw_size = ret;
+	comp_size = LZ4_compress_default(raw, comp, ret, comp_max, wrkmem);
+	if (comp_size > 0 && comp_size < ret) {
+		frame.comp_size = comp_size;
+		data = comp;
+	} else {
+		frame.comp_size = ret;
+		data = raw;
+	}
 
-	if (copy_to_user(buf, finalbuf, copy_size)) {
+	if (copy_to_user(buf, &frame, sizeof(frame)) ||
+	    copy_to_user(buf + sizeof(frame), data, frame.comp_size)) {
 		pr_err("Ramdump(%s): Couldn't copy all data to user.",
 			rd_dev->name);
-		rd_dev->ramdump_status = -1;
 		ret = -EFAULT;
-		goto ramdump_done;
+		goto out;
 	}
 
-	kfree(finalbuf);
-	if (!vaddr && origdevice_mem)
-		dma_unremap(rd_dev->dev->parent, origdevice_mem, copy_size);
+	*pos += frame.raw_size;
+	ret = sizeof(frame) + frame.comp_size;
+out:
+	kvfree(wrkmem);
+	return ret;
+}
 
-	*pos += copy_size;
+static ssize_t ramdump_read(struct file *filep, char __user *buf, size_t count,
+			loff_t *pos)
+{
+	struct consumer_entry *entry = filep->private_data;
+	struct ramdump_device *rd_dev = entry->rd_dev;
+	ssize_t ret;
 
-	pr_debug("Ramdump(%s): Read %zd bytes from address %lx.",
-			rd_dev->name, copy_size, addr);
+	if (entry->lz4 && count < RAMDUMP_LZ4_MIN_READ)
+		return -EINVAL;
 
-	return *pos - orig_pos;
+	if ((filep->f_flags & O_NONBLOCK) && !entry->data_ready)
+		return -EAGAIN;
 
-ramdump_done:
-	if (!vaddr && origdevice_mem)
-		dma_unremap(rd_dev->dev->parent, origdevice_mem, copy_size);
+	ret = wait_event_interruptible(rd_dev->dump_wait_q, entry->data_ready);
+	if (ret)
+		return ret;
+
+	/*
+	 * Reads of one file may run in parallel. The session only ends once
+	 * none of them still uses the segments, see ramdump_end_session().
+	 */
+	down_read(&rd_dev->dump_rwsem);
+	if (!entry->data_ready)
+		ret = 0;
+	else if (entry->lz4)
+		ret = ramdump_read_lz4(rd_dev, buf, count, pos);
+	else
+		ret = ramdump_read_raw(rd_dev, buf, count, pos);
+	up_read(&rd_dev->dump_rwsem);
+
+	if (ret > 0)
+		return ret;
 
-	kfree(finalbuf);
 	*pos = 0;
-	reset_ramdump_entry(entry);
+	mutex_lock(&rd_dev->consumer_lock);
+	if (entry->data_ready) {
+		rd_dev->ramdump_status = ret ? -1 : 0;
+		reset_ramdump_entry(entry);
+	}
+	mutex_unlock(&rd_dev->consumer_lock);
 	return ret;
 }
 
+static long ramdump_ioctl(struct file *filep, unsigned int cmd,
+			  unsigned long arg)
+{
+	struct consumer_entry *entry = filep->private_data;
+
+	switch (cmd) {
+	case RAMDUMP_IOCTL_LZ4:
+		entry->lz4 = true;
+		return 0;
+	default:
+		return -ENOTTY;
+	}
+}
+
 static unsigned int ramdump_poll(struct file *filep,
 					struct poll_table_struct *wait)
 {
@@ -295,7 +390,9 @@ static const struct file_operations ramdump_file_ops = {
 	.open = ramdump_open,
 	.release = ramdump_release,
 	.read = ramdump_read,
-	.poll = ramdump_poll
+	.poll = ramdump_poll,
+	.unlocked_ioctl = ramdump_ioctl,
+	.compat_ioctl = ramdump_ioctl,
 };
 
 static int ramdump_devnode_init(void)
@@ -374,6 +471,8 @@ void *create_ramdump_device(const char *dev_name, struct device *parent)
 	}
 
 	mutex_init(&rd_dev->consumer_lock);
+	init_rwsem(&rd_dev->dump_rwsem);
+	rd_dev->attrs = DMA_ATTR_SKIP_ZEROING;
 	atomic_set(&rd_dev->readers_left, 0);
 	cdev_init(&rd_dev->cdev, &ramdump_file_ops);
 
@@ -412,6 +511,23 @@ void destroy_ramdump_device(void *dev)
 }
 EXPORT_SYMBOL(destroy_ramdump_device);
 
+/*
+ * Called once the readers are done or timed out, before the caller frees
+ * the segments. Waits for reads still copying from them and makes any
+ * further read wait for the next dump.
+ */
+static void ramdump_end_session(struct ramdump_device *rd_dev)
+{
+	struct consumer_entry *entry;
+
+	down_write(&rd_dev->dump_rwsem);
+	mutex_lock(&rd_dev->consumer_lock);
+	list_for_each_entry(entry, &rd_dev->consumer_list, list)
+		entry->data_ready = false;
+	mutex_unlock(&rd_dev->consumer_lock);
+	up_write(&rd_dev->dump_rwsem);
+}
+
 static int _do_ramdump(void *handle, struct ramdump_segment *segments,
 		int nsegments, bool use_elf)
 {
@@ -506,6 +622,7 @@ static int _do_ramdump(void *handle, struct ramdump_segment *segments,
 	} else
 		ret = (rd_dev->ramdump_status == 0) ? 0 : -EPIPE;
 
+	ramdump_end_session(rd_dev);
 	rd_dev->elfcore_size = 0;
 	kfree(rd_dev->elfcore_buf);
 	rd_dev->elfcore_buf = NULL;
@@ -636,6 +753,7 @@ static int _do_minidump(void *handle, struct ramdump_segment *segments,
 		ret = (rd_dev->ramdump_status == 0) ? 0 : -EPIPE;
 	}
 
+	ramdump_end_session(rd_dev);
 	rd_dev->elfcore_size = 0;
 	kfree(rd_dev->elfcore_buf);
 	rd_dev->elfcore_buf = NULL;
@@ -150,6 +150,23 @@ static uint16_t g_last_cb_server_id = CBOBJ_SERVER_ID_START;
 static uint16_t g_last_mem_rgn_id, g_last_mem_map_obj_id;
 static size_t g_max_cb_buf_size = SMCINVOKE_TZ_MIN_BUF_SIZE;
 static unsigned int cb_reqs_inflight;
+static struct kmem_cache *g_cb_txn_cache;
+
+/*
+ * Invoke messages and copies of callback requests are page allocations
+ * made for every call, and high order ones for servers with large callback
+ * buffers. Keep a few freed buffers of each order for the next calls.
+ */
+#define SMCINVOKE_MSG_POOL_ORDERS	4
+#define SMCINVOKE_MSG_POOL_DEPTH	4
+
+static struct smcinvoke_msg_pool {
+	spinlock_t lock;
+	unsigned int count[SMCINVOKE_MSG_POOL_ORDERS];
+	void *bufs[SMCINVOKE_MSG_POOL_ORDERS][SMCINVOKE_MSG_POOL_DEPTH];
+} g_msg_pool = {
+	.lock = __SPIN_LOCK_UNLOCKED(g_msg_pool.lock),
+};
 
 static long smcinvoke_ioctl(struct file *, unsigned int, unsigned long);
 static int smcinvoke_open(struct inode *, struct file *);
@@ -259,6 +276,53 @@ struct smcinvoke_mem_obj {
 	struct list_head list;
 };
 
+static void *alloc_msg_buf(size_t size)
+{
+	unsigned int order = get_order(size);
+	void *buf = NULL;
+
+	if (order < SMCINVOKE_MSG_POOL_ORDERS) {
+		spin_lock(&g_msg_pool.lock);
+		if (g_msg_pool.count[order])
+			buf = g_msg_pool.bufs[order][--g_msg_pool.count[order]];
+		spin_unlock(&g_msg_pool.lock);
+	}
+	if (!buf)
+		buf = (void *)__get_free_pages(GFP_KERNEL | __GFP_COMP, order);
+	return buf;
+}
+
+static void free_msg_buf(void *buf, size_t size)
+{
+	unsigned int order = get_order(size);
+
+	if (!buf)
+		return;
+
+	if (order < SMCINVOKE_MSG_POOL_ORDERS) {
+		spin_lock(&g_msg_pool.lock);
+		if (g_msg_pool.count[order] < SMCINVOKE_MSG_POOL_DEPTH) {
+			g_msg_pool.bufs[order][g_msg_pool.count[order]++] = buf;
+			buf = NULL;
+		}
+		spin_unlock(&g_msg_pool.lock);
+	}
+	if (buf)
+		free_pages((unsigned long)buf, order);
+}
+
+static void drain_msg_pool(void)
+{
+	unsigned int order, i;
+
+	for (order = 0; order < SMCINVOKE_MSG_POOL_ORDERS; order++) {
+		for (i = 0; i < g_msg_pool.count[order]; i++)
+			free_pages((unsigned long)g_msg_pool.bufs[order][i],
+				   order);
+		g_msg_pool.count[order] = 0;
+	}
+}
+
 static void destroy_cb_server(struct kref *kref)
 {
 	struct smcinvoke_server_info *server = container_of(kref,
@@ -526,9 +590,9 @@ static void delete_cb_txn(struct kref *kref)
 	if (OBJECT_OP_METHODID(cb_txn->cb_req->hdr.op) == OBJECT_OP_RELEASE)
 		release_tzhandle_locked(cb_txn->cb_req->hdr.tzhandle);
 
-	kfree(cb_txn->cb_req);
+	free_msg_buf(cb_txn->cb_req, cb_txn->cb_req_bytes);
 	hash_del(&cb_txn->hash);
-	kfree(cb_txn);
+	kmem_cache_free(g_cb_txn_cache, cb_txn);
 }
 
 static struct smcinvoke_cb_txn *find_cbtxn_locked(
@@ -947,7 +1011,7 @@ static void process_tzcb_req(void *buf, size_t buf_len, struct file **arr_filp)
 	 * someone kills invoke caller, buf would go away and server would be
 	 * working on already freed buffer, causing a device crash.
 	 */
-	tmp_cb_req = kmemdup(buf, buf_len, GFP_KERNEL);
+	tmp_cb_req = alloc_msg_buf(buf_len);
 	if (!tmp_cb_req) {
 		/* we need to return error to caller so fill up result */
 		cb_req->result = OBJECT_ERROR_KMEM;
@@ -956,15 +1020,16 @@ static void process_tzcb_req(void *buf, size_t buf_len, struct file **arr_filp)
 		return;
 	}
 
-	cb_txn = kzalloc(sizeof(*cb_txn), GFP_KERNEL);
+	memcpy(tmp_cb_req, buf, buf_len);
+
+	cb_txn = kmem_cache_zalloc(g_cb_txn_cache, GFP_KERNEL);
 	if (!cb_txn) {
 		cb_req->result = OBJECT_ERROR_KMEM;
 		pr_err("failed to allocate memory for request, result: %d\n",
 							cb_req->result);
-		kfree(tmp_cb_req);
+		free_msg_buf(tmp_cb_req, buf_len);
 		return;
 	}
-	/* no need for memcpy as we did kmemdup() above */
 	cb_req  = tmp_cb_req;
 
 	cb_txn->state = SMCINVOKE_REQ_PLACED;
@@ -1732,8 +1797,7 @@ static long process_invoke_req(struct file *filp, unsigned int cmd,
 	}
 
 	inmsg_size = compute_in_msg_size(&req, args_buf);
-	in_msg = (void *)__get_free_pages(GFP_KERNEL|__GFP_COMP,
-						get_order(inmsg_size));
+	in_msg = alloc_msg_buf(inmsg_size);
 	if (!in_msg) {
 		ret = -ENOMEM;
 		pr_err("memory alloc failed for in msg in invoke req\n");
@@ -1744,8 +1808,7 @@ static long process_invoke_req(struct file *filp, unsigned int cmd,
 	mutex_lock(&g_smcinvoke_lock);
 	outmsg_size = PAGE_ALIGN(g_max_cb_buf_size);
 	mutex_unlock(&g_smcinvoke_lock);
-	out_msg = (void *)__get_free_pages(GFP_KERNEL | __GFP_COMP,
-						get_order(outmsg_size));
+	out_msg = alloc_msg_buf(outmsg_size);
 	if (!out_msg) {
 		ret = -ENOMEM;
 		pr_err("memory alloc failed for out msg in invoke req\n");
@@ -1798,8 +1861,8 @@ static long process_invoke_req(struct file *filp, unsigned int cmd,
 	release_filp(filp_to_release, OBJECT_COUNTS_MAX_OO);
 	if (ret)
 		release_tzhandles(tzhandles_to_release, OBJECT_COUNTS_MAX_OO);
-	free_pages((long)out_msg, get_order(outmsg_size));
-	free_pages((long)in_msg, get_order(inmsg_size));
+	free_msg_buf(out_msg, outmsg_size);
+	free_msg_buf(in_msg, inmsg_size);
 	kfree(args_buf);
 
 	if (ret)
@@ -1881,8 +1944,8 @@ static int smcinvoke_release(struct inode *nodp, struct file *filp)
 	if (!tzhandle || tzhandle == SMCINVOKE_TZ_ROOT_OBJ)
 		goto out;
 
-	in_buf = (uint8_t *)__get_free_page(GFP_KERNEL | __GFP_COMP);
-	out_buf = (uint8_t *)__get_free_page(GFP_KERNEL | __GFP_COMP);
+	in_buf = alloc_msg_buf(PAGE_SIZE);
+	out_buf = alloc_msg_buf(PAGE_SIZE);
 	if (!in_buf || !out_buf) {
 		ret = -ENOMEM;
 		pr_err("Failed to allocate memory\n");
@@ -1902,8 +1965,8 @@ static int smcinvoke_release(struct inode *nodp, struct file *filp)
 	process_piggyback_data(out_buf, SMCINVOKE_TZ_MIN_BUF_SIZE);
 out:
 	kfree(filp->private_data);
-	free_page((long)in_buf);
-	free_page((long)out_buf);
+	free_msg_buf(in_buf, PAGE_SIZE);
+	free_msg_buf(out_buf, PAGE_SIZE);
 
 	return ret;
 }
@@ -2007,12 +2070,23 @@ static struct platform_driver smcinvoke_plat_driver = {
 
 static int smcinvoke_init(void)
 {
-	return platform_driver_register(&smcinvoke_plat_driver);
+	int rc;
+
+	g_cb_txn_cache = KMEM_CACHE(smcinvoke_cb_txn, 0);
+	if (!g_cb_txn_cache)
+		return -ENOMEM;
+
+	rc = platform_driver_register(&smcinvoke_plat_driver);
+	if (rc)
+		kmem_cache_destroy(g_cb_txn_cache);
+	return rc;
 }
 
 static void smcinvoke_exit(void)
 {
 	platform_driver_unregister(&smcinvoke_plat_driver);
+	kmem_cache_destroy(g_cb_txn_cache);
+	drain_msg_pool();
 }
 
 module_init(smcinvoke_init);
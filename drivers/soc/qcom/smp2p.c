@@ -12,6 +12,8 @@
  * GNU General Public License for more details.
  */
 
+#include <linux/debugfs.h>
+#include <linux/hrtimer.h>
 #include <linux/interrupt.h>
 #include <linux/list.h>
 #include <linux/io.h>
@@ -23,6 +25,7 @@
 #include <linux/module.h>
 #include <linux/platform_device.h>
 #include <linux/regmap.h>
+#include <linux/seq_file.h>
 #include <linux/soc/qcom/smem.h>
 #include <linux/soc/qcom/smem_state.h>
 #include <linux/spinlock.h>
@@ -101,6 +104,7 @@ struct smp2p_smem_item {
  * @irq_falling:bitmap to mark irq bits for falling detection
  * @state:	smem state handle
  * @lock:	spinlock to protect read-modify-write of the value
+ * @pending_mask: bits changed since the last kick, under the edge kick_lock
  */
 struct smp2p_entry {
 	struct list_head node;
@@ -119,6 +123,7 @@ struct smp2p_entry {
 	struct qcom_smem_state *state;
 
 	spinlock_t lock;
+	u32 pending_mask;
 };
 
 #define SMP2P_INBOUND	0
@@ -139,6 +144,15 @@ struct smp2p_entry {
  * @mbox_chan:	apcs ipc mailbox channel handle
  * @inbound:	list of inbound entries
  * @outbound:	list of outbound entries
+ * @kick_coalesce_us: time outbound changes may wait to share a kick, 0 for
+ *		an immediate kick per change
+ * @kick_lock:	protects @kick_pending and the entries' pending_mask
+ * @kick_pending: @kick_timer will kick the remote
+ * @kick_timer:	timer for the coalesced kick
+ * @kicks:	interrupts raised to the remote
+ * @coalesced:	outbound changes that didn't need a kick of their own
+ * @irqs:	interrupts received from the remote
+ * @debugfs:	debugfs file with the counters above
  */
 struct qcom_smp2p {
 	struct device *dev;
@@ -168,8 +182,20 @@ struct qcom_smp2p {
 
 	struct list_head inbound;
 	struct list_head outbound;
+
+	u32 kick_coalesce_us;
+	spinlock_t kick_lock;
+	bool kick_pending;
+	struct hrtimer kick_timer;
+
+	atomic64_t kicks;
+	atomic64_t coalesced;
+	u64 irqs;
+	struct dentry *debugfs;
 };
 
+static struct dentry *smp2p_debugfs_root;
+
 static void *ilc;
 #define SMP2P_LOG_PAGE_CNT 2
 #define SMP2P_INFO(x, ...)	\
@@ -189,6 +215,39 @@ static void qcom_smp2p_kick(struct qcom_smp2p *smp2p)
 	} else {
 		regmap_write(smp2p->ipc_regmap, smp2p->ipc_offset, BIT(smp2p->ipc_bit));
 	}
+	atomic64_inc(&smp2p->kicks);
+}
+
+/* Kick for all coalesced changes now, called with @kick_lock held */
+static void qcom_smp2p_flush_kick(struct qcom_smp2p *smp2p)
+{
+	struct smp2p_entry *entry;
+
+	list_for_each_entry(entry, &smp2p->outbound, node)
+		entry->pending_mask = 0;
+
+	if (smp2p->kick_pending) {
+		smp2p->kick_pending = false;
+		hrtimer_try_to_cancel(&smp2p->kick_timer);
+	}
+
+	qcom_smp2p_kick(smp2p);
+}
+
+static enum hrtimer_restart qcom_smp2p_kick_timer(struct hrtimer *timer)
+{
+	struct qcom_smp2p *smp2p = container_of(timer, struct qcom_smp2p,
+						kick_timer);
+	unsigned long flags;
+
+	spin_lock_irqsave(&smp2p->kick_lock, flags);
+	if (smp2p->kick_pending) {
+		smp2p->kick_pending = false;
+		qcom_smp2p_flush_kick(smp2p);
+	}
+	spin_unlock_irqrestore(&smp2p->kick_lock, flags);
+
+	return HRTIMER_NORESTART;
 }
 
 static bool qcom_smp2p_check_ssr(struct qcom_smp2p *smp2p)
@@ -323,6 +382,7 @@ static irqreturn_t qcom_smp2p_intr(int irq, void *data)
 	size_t size;
 
 	in = smp2p->in;
+	smp2p->irqs++;
 
 	/* Acquire smem item, if not already found */
 	if (!in) {
@@ -435,6 +495,7 @@ static int qcom_smp2p_inbound_entry(struct qcom_smp2p *smp2p,
 static int smp2p_update_bits(void *data, u32 mask, u32 value)
 {
 	struct smp2p_entry *entry = data;
+	struct qcom_smp2p *smp2p = entry->smp2p;
 	unsigned long flags;
 	u32 orig;
 	u32 val;
@@ -443,11 +504,37 @@ static int smp2p_update_bits(void *data, u32 mask, u32 value)
 	val = orig = readl(entry->value);
 	val &= ~mask;
 	val |= value;
+
+	if (val != orig && smp2p->kick_coalesce_us) {
+		spin_lock(&smp2p->kick_lock);
+		/*
+		 * A bit changing back before the remote was told about its
+		 * last change would hide that change, so kick for it first.
+		 */
+		if ((val ^ orig) & entry->pending_mask)
+			qcom_smp2p_flush_kick(smp2p);
+
+		writel(val, entry->value);
+		entry->pending_mask |= val ^ orig;
+
+		if (smp2p->kick_pending) {
+			atomic64_inc(&smp2p->coalesced);
+		} else {
+			smp2p->kick_pending = true;
+			hrtimer_start(&smp2p->kick_timer,
+				      us_to_ktime(smp2p->kick_coalesce_us),
+				      HRTIMER_MODE_REL);
+		}
+		spin_unlock(&smp2p->kick_lock);
+		spin_unlock_irqrestore(&entry->lock, flags);
+		return 0;
+	}
+
 	writel(val, entry->value);
 	spin_unlock_irqrestore(&entry->lock, flags);
 
 	if (val != orig)
-		qcom_smp2p_kick(entry->smp2p);
+		qcom_smp2p_kick(smp2p);
 
 	return 0;
 }
@@ -604,6 +691,30 @@ static int qcom_smp2p_alloc_item(struct platform_device *pdev,
 	return ret;
 }
 
+static int smp2p_stats_show(struct seq_file *s, void *unused)
+{
+	struct qcom_smp2p *smp2p = s->private;
+
+	seq_printf(s, "kicks: %lld\n", atomic64_read(&smp2p->kicks));
+	seq_printf(s, "coalesced: %lld\n", atomic64_read(&smp2p->coalesced));
+	seq_printf(s, "irqs: %llu\n", smp2p->irqs);
+	seq_printf(s, "kick_coalesce_us: %u\n", smp2p->kick_coalesce_us);
+
+	return 0;
+}
+
+static int smp2p_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, smp2p_stats_show, inode->i_private);
+}
+
+static const struct file_operations smp2p_stats_fops = {
+	.open = smp2p_stats_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 static int qcom_smp2p_probe(struct platform_device *pdev)
 {
 	struct smp2p_entry *entry;
@@ -621,6 +732,9 @@ static int qcom_smp2p_probe(struct platform_device *pdev)
 	smp2p->dev = &pdev->dev;
 	INIT_LIST_HEAD(&smp2p->inbound);
 	INIT_LIST_HEAD(&smp2p->outbound);
+	spin_lock_init(&smp2p->kick_lock);
+	hrtimer_init(&smp2p->kick_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	smp2p->kick_timer.function = qcom_smp2p_kick_timer;
 
 	platform_set_drvdata(pdev, smp2p);
 
@@ -644,6 +758,9 @@ static int qcom_smp2p_probe(struct platform_device *pdev)
 		return -EINVAL;
 	}
 
+	of_property_read_u32(pdev->dev.of_node, "qcom,kick-coalesce-us",
+			     &smp2p->kick_coalesce_us);
+
 	smp2p->irq = platform_get_irq(pdev, 0);
 	if (smp2p->irq < 0) {
 		dev_err(&pdev->dev, "unable to acquire smp2p interrupt\n");
@@ -685,6 +802,12 @@ static int qcom_smp2p_probe(struct platform_device *pdev)
 	}
 	enable_irq_wake(smp2p->irq);
 
+	if (!smp2p_debugfs_root)
+		smp2p_debugfs_root = debugfs_create_dir("smp2p", NULL);
+	smp2p->debugfs = debugfs_create_file(dev_name(&pdev->dev), 0444,
+					     smp2p_debugfs_root, smp2p,
+					     &smp2p_stats_fops);
+
 	return 0;
 
 unwind_interfaces:
@@ -707,6 +830,9 @@ static int qcom_smp2p_remove(struct platform_device *pdev)
 	struct qcom_smp2p *smp2p = platform_get_drvdata(pdev);
 	struct smp2p_entry *entry;
 
+	debugfs_remove(smp2p->debugfs);
+	hrtimer_cancel(&smp2p->kick_timer);
+
 	list_for_each_entry(entry, &smp2p->inbound, node)
 		irq_domain_remove(entry->domain);
 
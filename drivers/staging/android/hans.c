@@ -98,6 +98,7 @@ static void hans_handler(struct sk_buff *skb)
 	struct nlmsghdr *nlh = NULL;
 	unsigned int len  = 0;
 	int uid = -1;
+	int *uids = NULL;
 
 	if (!skb) {
 		pr_err("%s: recv skb NULL!\n", __func__);
@@ -148,6 +149,19 @@ static void hans_handler(struct sk_buff *skb)
 				printk(KERN_ERR "%s: --> FROZEN_TRANS, uid = %d\n", __func__, data->target_uid);
 				hans_check_frozen_transcation(data->target_uid, data->type);
 				break;
+        case FREEZE_UIDS:
+        case THAW_UIDS:
+				if (data->code <= 0 || data->code > HANS_MAX_BATCH_UIDS ||
+				    len < sizeof(struct hans_message) + data->code * sizeof(int)) {
+					pr_err("%s: uid batch of %d invalid, len = %d\n", __func__, data->code, len);
+					break;
+				}
+				uids = (int *)(data + 1);
+				if (data->type == THAW_UIDS)
+					hans_thaw_uids(uids, data->code);
+				else if (hans_freeze_uids(uids, data->code, data->pkg_cmd) != HANS_NOERROR)
+					pr_err("%s: freeze of %d uids failed\n", __func__, data->code);
+				break;
 
 		default:
 			pr_err("%s: hans_messag type invalid %d\n", __func__, data->type);
@@ -186,6 +200,7 @@ static void __exit hans_core_exit(void)
 		netlink_kernel_release(sock_handle);
 
 	hans_netfilter_deinit();
+	hans_freeze_deinit();
 	printk(KERN_INFO "%s: -\n", __func__);
 }
 
@@ -0,0 +1,272 @@
+/***********************************************************
+** Copyright (C), 2008-2019, OPPO Mobile Comm Corp., Ltd.
+** VENDOR_EDIT
+** File: hans_freeze.c
+** Description: Add for hans freeze manager, kernel side UID freezer
+**
+** Version: 1.0
+** Date : 2019/09/23
+** Author: #Kun.Zhou@ANDROID.RESCONTROL, 2019/09/23, add for hans freeze manager
+**
+** ------------------ Revision History:------------------------
+** <author>      <data>      <version >       <desc>
+** Kun Zhou    2019/09/23      1.0       OPLUS_FEATURE_HANS_FREEZE
+****************************************************************/
+
+/*
+ * UIDs handed over with FREEZE_UIDS are frozen by the kernel itself: the
+ * UID is added to a set consulted by freezing_slow_path() and every task
+ * of the batch is sent to the refrigerator in a single pass over the task
+ * list. Incoming binder calls, network packets and fatal signals selected
+ * by the freeze flags thaw the UID in kernel. The target process of a
+ * binder call is woken right away, the rest of the UID is woken by a
+ * worker that coalesces all UIDs thawed since it last ran, and the native
+ * deamon gets one UID_THAWED report per UID instead of one per event.
+ */
+
+#include <linux/hashtable.h>
+#include <linux/rculist.h>
+#include <linux/sched/signal.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
+#include <linux/hans.h>
+
+#define HANS_FROZEN_HASH_BITS	(6)
+
+struct hans_frozen_uid {
+	struct hlist_node node;
+	struct list_head thaw_node;
+	struct rcu_head rcu;
+	uid_t uid;
+	unsigned int flags;
+	unsigned int thaw_reason;
+	bool thawing;
+};
+
+static DEFINE_HASHTABLE(hans_frozen_uids, HANS_FROZEN_HASH_BITS);
+static LIST_HEAD(hans_thaw_list);
+static DEFINE_SPINLOCK(hans_freeze_lock);
+static atomic_t hans_nr_frozen = ATOMIC_INIT(0);
+
+static void hans_thaw_work_fn(struct work_struct *work);
+static DECLARE_WORK(hans_thaw_work, hans_thaw_work_fn);
+
+static struct hans_frozen_uid *hans_frozen_lookup(uid_t uid)
+{
+	struct hans_frozen_uid *f;
+
+	hash_for_each_possible_rcu(hans_frozen_uids, f, node, uid)
+		if (f->uid == uid)
+			return f;
+
+	return NULL;
+}
+
+/*Called from freezing_slow_path(), any context*/
+bool hans_uid_freezing(struct task_struct *p)
+{
+	struct hans_frozen_uid *f;
+	bool ret;
+
+	if (!atomic_read(&hans_nr_frozen) || (p->flags & PF_KTHREAD))
+		return false;
+
+	rcu_read_lock();
+	f = hans_frozen_lookup(task_uid(p).val);
+	ret = f && !READ_ONCE(f->thawing);
+	rcu_read_unlock();
+
+	return ret;
+}
+
+static bool hans_uid_in(uid_t uid, const int *uids, int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++)
+		if (uids[i] == uid)
+			return true;
+
+	return false;
+}
+
+/*Freeze all tasks of @uids and thaw them in kernel on the @flags events*/
+int hans_freeze_uids(const int *uids, int count, unsigned int flags)
+{
+	struct task_struct *g, *p;
+	struct hans_frozen_uid *f, *new;
+	unsigned long irqflags;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		if (uids[i] < MIN_USERAPP_UID)
+			return HANS_ERROR;
+	}
+
+	for (i = 0; i < count; i++) {
+		new = kzalloc(sizeof(*new), GFP_KERNEL);
+		if (!new)
+			return HANS_ERROR;
+
+		spin_lock_irqsave(&hans_freeze_lock, irqflags);
+		f = hans_frozen_lookup(uids[i]);
+		if (f) {
+			/*Refrozen before the thaw worker got to it*/
+			WRITE_ONCE(f->thawing, false);
+			f->thaw_reason = 0;
+			list_del_init(&f->thaw_node);
+			f->flags = flags;
+		} else {
+			new->uid = uids[i];
+			new->flags = flags;
+			INIT_LIST_HEAD(&new->thaw_node);
+			if (atomic_inc_return(&hans_nr_frozen) == 1)
+				atomic_inc(&system_freezing_cnt);
+			hash_add_rcu(hans_frozen_uids, &new->node, new->uid);
+			new = NULL;
+		}
+		spin_unlock_irqrestore(&hans_freeze_lock, irqflags);
+		kfree(new);
+	}
+
+	rcu_read_lock();
+	for_each_process_thread(g, p) {
+		if (!(p->flags & PF_KTHREAD) &&
+		    hans_uid_in(task_uid(p).val, uids, count))
+			freeze_task(p);
+	}
+	rcu_read_unlock();
+
+	return HANS_NOERROR;
+}
+
+/*Mark @f as thawing, caller holds hans_freeze_lock*/
+static bool hans_queue_thaw_locked(struct hans_frozen_uid *f,
+				   unsigned int reason)
+{
+	f->thaw_reason |= reason;
+	if (f->thawing)
+		return false;
+
+	WRITE_ONCE(f->thawing, true);
+	list_add_tail(&f->thaw_node, &hans_thaw_list);
+	return true;
+}
+
+void hans_thaw_uids(const int *uids, int count)
+{
+	struct hans_frozen_uid *f;
+	unsigned long irqflags;
+	bool queue = false;
+	int i;
+
+	spin_lock_irqsave(&hans_freeze_lock, irqflags);
+	for (i = 0; i < count; i++) {
+		f = hans_frozen_lookup(uids[i]);
+		if (f)
+			queue |= hans_queue_thaw_locked(f, 0);
+	}
+	spin_unlock_irqrestore(&hans_freeze_lock, irqflags);
+
+	if (queue)
+		queue_work(system_highpri_wq, &hans_thaw_work);
+}
+
+/*
+ * Thaw @uid in kernel if it was frozen with @reason among its flags. Returns
+ * true when the kernel took care of it and the event needn't be reported.
+ */
+bool hans_thaw_uid(uid_t uid, unsigned int reason)
+{
+	struct hans_frozen_uid *f;
+	unsigned long irqflags;
+	bool handled = false, queue = false;
+
+	if (!atomic_read(&hans_nr_frozen))
+		return false;
+
+	spin_lock_irqsave(&hans_freeze_lock, irqflags);
+	f = hans_frozen_lookup(uid);
+	if (f && (f->flags & reason)) {
+		queue = hans_queue_thaw_locked(f, reason);
+		handled = true;
+	}
+	spin_unlock_irqrestore(&hans_freeze_lock, irqflags);
+
+	if (queue)
+		queue_work(system_highpri_wq, &hans_thaw_work);
+
+	return handled;
+}
+
+/*As hans_thaw_uid(), also waking the threads of @task's process now*/
+bool hans_thaw_task_group(struct task_struct *task, unsigned int reason)
+{
+	struct task_struct *t;
+
+	if (!hans_thaw_uid(task_uid(task).val, reason))
+		return false;
+
+	rcu_read_lock();
+	for_each_thread(task, t)
+		__thaw_task(t);
+	rcu_read_unlock();
+
+	return true;
+}
+
+static void hans_thaw_work_fn(struct work_struct *work)
+{
+	struct hans_frozen_uid *f, *n;
+	struct task_struct *g, *p;
+	unsigned long irqflags;
+	LIST_HEAD(thawed);
+
+	spin_lock_irqsave(&hans_freeze_lock, irqflags);
+	list_splice_init(&hans_thaw_list, &thawed);
+	list_for_each_entry(f, &thawed, thaw_node)
+		hash_del_rcu(&f->node);
+	spin_unlock_irqrestore(&hans_freeze_lock, irqflags);
+
+	if (list_empty(&thawed))
+		return;
+
+	/*One pass over the task list for every UID thawed since last run*/
+	rcu_read_lock();
+	for_each_process_thread(g, p) {
+		if (!frozen(p))
+			continue;
+		list_for_each_entry(f, &thawed, thaw_node) {
+			if (task_uid(p).val == f->uid) {
+				__thaw_task(p);
+				break;
+			}
+		}
+	}
+	rcu_read_unlock();
+
+	list_for_each_entry_safe(f, n, &thawed, thaw_node) {
+		if (f->thaw_reason)
+			hans_report(UID_THAWED, -1, -1, -1, f->uid,
+				    "UID_THAWED", f->thaw_reason);
+		if (atomic_dec_and_test(&hans_nr_frozen))
+			atomic_dec(&system_freezing_cnt);
+		kfree_rcu(f, rcu);
+	}
+}
+
+void hans_freeze_deinit(void)
+{
+	struct hans_frozen_uid *f;
+	unsigned long irqflags;
+	int bkt;
+
+	spin_lock_irqsave(&hans_freeze_lock, irqflags);
+	hash_for_each(hans_frozen_uids, bkt, f, node)
+		hans_queue_thaw_locked(f, 0);
+	spin_unlock_irqrestore(&hans_freeze_lock, irqflags);
+
+	cancel_work_sync(&hans_thaw_work);
+	hans_thaw_work_fn(NULL);
+}
@@ -159,6 +159,10 @@ static unsigned int hans_nf_ipv4v6_in(void *priv,
 	uid = sock2uid(sk);
 	if (uid < MIN_USERAPP_UID) return NF_ACCEPT;
 
+	/*Frozen by the kernel freezer with thaw on network, no report needed*/
+	if (hans_thaw_uid(uid, HANS_THAW_NET))
+		return NF_ACCEPT;
+
 	/*Find the monitored UID and clear it from the monitor array*/
 	found = hans_find_remove_monitored_uid(uid);
 	if (!found)
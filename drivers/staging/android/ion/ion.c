@@ -5,7 +5,9 @@
  * Copyright (C) 2019-2021 Sultan Alsawaf <sultan@kerneltoast.com>.
  */
 
+#include <linux/debugfs.h>
 #include <linux/miscdevice.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <linux/uaccess.h>
 #include "ion_secure_util.h"
@@ -70,6 +72,7 @@ static struct ion_buffer *ion_buffer_create(struct ion_heap *heap, size_t len,
 		.free = __WORK_INITIALIZER(buffer->free, ion_buffer_free_work),
 		.map_freelist = LIST_HEAD_INIT(buffer->map_freelist),
 		.freelist_lock = __SPIN_LOCK_INITIALIZER(buffer->freelist_lock),
+		.cpu_sync_lock = __SPIN_LOCK_INITIALIZER(buffer->cpu_sync_lock),
 		.iommu_data = {
 			.map_list = LIST_HEAD_INIT(buffer->iommu_data.map_list),
 			.lock = __MUTEX_INITIALIZER(buffer->iommu_data.lock)
@@ -295,6 +298,49 @@ static void ion_dma_buf_detach(struct dma_buf *dmabuf,
 	spin_unlock(&buffer->freelist_lock);
 }
 
+static atomic64_t ion_cpu_sync_bytes;
+static atomic64_t ion_cpu_sync_skipped_clean;
+static atomic64_t ion_cpu_sync_skipped_range;
+
+/*
+ * Track the range the CPU only reads between begin_cpu_access() and
+ * end_cpu_access() with DMA_FROM_DEVICE. Begin invalidates it and the CPU
+ * leaves no dirty lines there, so the invalidate end would do again is
+ * redundant. Anything else the CPU does to the buffer forgets the range.
+ *
+ * Returns true if the maintenance for [@offset, @offset + @len) can be
+ * skipped.
+ */
+static bool ion_cpu_sync_skip(struct ion_buffer *buffer,
+			      enum dma_data_direction dir,
+			      unsigned long offset, unsigned long len,
+			      bool start)
+{
+	bool skip = false;
+
+	spin_lock(&buffer->cpu_sync_lock);
+	if (!start && dir == DMA_FROM_DEVICE)
+		skip = offset >= buffer->cpu_clean_start &&
+		       offset + len <= buffer->cpu_clean_end;
+
+	if (start && dir == DMA_FROM_DEVICE) {
+		buffer->cpu_clean_start = offset;
+		buffer->cpu_clean_end = offset + len;
+	} else {
+		buffer->cpu_clean_start = 0;
+		buffer->cpu_clean_end = 0;
+	}
+	spin_unlock(&buffer->cpu_sync_lock);
+
+	if (skip)
+		atomic64_add(len, &ion_cpu_sync_skipped_clean);
+	else
+		atomic64_add(len, &ion_cpu_sync_bytes);
+	atomic64_add(buffer->size - len, &ion_cpu_sync_skipped_range);
+
+	return skip;
+}
+
 static int ion_dma_buf_begin_cpu_access(struct dma_buf *dmabuf,
 					enum dma_data_direction dir)
 {
@@ -308,6 +354,7 @@ static int ion_dma_buf_begin_cpu_access(struct dma_buf *dmabuf,
 	if (!(buffer->flags & ION_FLAG_CACHED))
 		return 0;
 
+	ion_cpu_sync_skip(buffer, dir, 0, buffer->size, true);
 	for (a = buffer->attachments; a; a = a->next) {
 		if (a->dma_mapped)
 			dma_sync_sg_for_cpu(a->dev, a->table.sgl,
@@ -330,6 +377,9 @@ static int ion_dma_buf_end_cpu_access(struct dma_buf *dmabuf,
 	if (!(buffer->flags & ION_FLAG_CACHED))
 		return 0;
 
+	if (ion_cpu_sync_skip(buffer, dir, 0, buffer->size, false))
+		return 0;
+
 	for (a = buffer->attachments; a; a = a->next) {
 		if (a->dma_mapped)
 			dma_sync_sg_for_device(a->dev, a->table.sgl,
@@ -339,40 +389,42 @@ static int ion_dma_buf_end_cpu_access(struct dma_buf *dmabuf,
 	return 0;
 }
 
+/*
+ * The DMA segments of a mapping cover the buffer in order, whether or not
+ * the IOMMU merged them, and the first one with no length ends the list.
+ */
 static void ion_sgl_sync_range(struct device *dev, struct scatterlist *sgl,
 			       unsigned int nents, unsigned long offset,
 			       unsigned long len, enum dma_data_direction dir,
 			       bool for_cpu)
 {
-	dma_addr_t sg_dma_addr = sg_dma_address(sgl);
-	unsigned long total = 0;
 	struct scatterlist *sg;
 	int i;
 
 	for_each_sg(sgl, sg, nents, i) {
-		unsigned long sg_offset, sg_left, size;
+		unsigned long seg_len = sg_dma_len(sg), size;
 
-		total += sg->length;
-		if (total <= offset) {
-			sg_dma_addr += sg->length;
+		if (!seg_len)
+			break;
+
+		if (offset >= seg_len) {
+			offset -= seg_len;
 			continue;
 		}
 
-		sg_left = total - offset;
-		sg_offset = sg->length - sg_left;
-		size = min(len, sg_left);
+		size = min(len, seg_len - offset);
 		if (for_cpu)
-			dma_sync_single_range_for_cpu(dev, sg_dma_addr,
-						      sg_offset, size, dir);
+			dma_sync_single_range_for_cpu(dev, sg_dma_address(sg),
+						      offset, size, dir);
 		else
-			dma_sync_single_range_for_device(dev, sg_dma_addr,
-							 sg_offset, size, dir);
+			dma_sync_single_range_for_device(dev,
+							 sg_dma_address(sg),
+							 offset, size, dir);
 		len -= size;
 		if (!len)
 			break;
 
-		offset += size;
-		sg_dma_addr += sg->length;
+		offset = 0;
 	}
 }
 
@@ -384,7 +436,6 @@ static int ion_dma_buf_cpu_access_partial(struct dma_buf *dmabuf,
 	struct ion_buffer *buffer = container_of(dmabuf->priv, typeof(*buffer),
 						 iommu_data);
 	struct ion_dma_buf_attachment *a;
-	int ret = 0;
 
 	if (!hlos_accessible_buffer(buffer))
 		return -EPERM;
@@ -392,20 +443,21 @@ static int ion_dma_buf_cpu_access_partial(struct dma_buf *dmabuf,
 	if (!(buffer->flags & ION_FLAG_CACHED))
 		return 0;
 
+	if (offset > buffer->size || len > buffer->size - offset)
+		return -EINVAL;
+
+	if (ion_cpu_sync_skip(buffer, dir, offset, len, start))
+		return 0;
+
 	for (a = buffer->attachments; a; a = a->next) {
 		if (!a->dma_mapped)
 			continue;
 
-		if (a->table.nents > 1 && sg_next(a->table.sgl)->dma_length) {
-			ret = -EINVAL;
-			continue;
-		}
-
 		ion_sgl_sync_range(a->dev, a->table.sgl, a->table.nents, offset,
 				   len, dir, start);
 	}
 
-	return ret;
+	return 0;
 }
 
 static int ion_dma_buf_begin_cpu_access_partial(struct dma_buf *dmabuf,
@@ -450,7 +502,8 @@ static const struct dma_buf_ops ion_dma_buf_ops = {
 	.unmap = ion_dma_buf_kunmap,
 	.vmap = ion_dma_buf_vmap,
 	.vunmap = ion_dma_buf_vunmap,
-	.get_flags = ion_dma_buf_get_flags
+	.get_flags = ion_dma_buf_get_flags,
+	.cache_sgt_mapping = true
 };
 
 struct dma_buf *ion_alloc_dmabuf(size_t len, unsigned int heap_id_mask,
@@ -636,6 +689,41 @@ static long ion_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 	return 0;
 }
 
+#ifdef CONFIG_DEBUG_FS
+static int ion_cpu_sync_show(struct seq_file *s, void *unused)
+{
+	seq_printf(s, "synced_bytes: %lld\n",
+		   (long long)atomic64_read(&ion_cpu_sync_bytes));
+	seq_printf(s, "skipped_clean_bytes: %lld\n",
+		   (long long)atomic64_read(&ion_cpu_sync_skipped_clean));
+	seq_printf(s, "skipped_range_bytes: %lld\n",
+		   (long long)atomic64_read(&ion_cpu_sync_skipped_range));
+	return 0;
+}
+
+static int ion_cpu_sync_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, ion_cpu_sync_show, inode->i_private);
+}
+
+static const struct file_operations ion_cpu_sync_fops = {
+	.open = ion_cpu_sync_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static void ion_debugfs_init(void)
+{
+	debugfs_create_file("ion_cpu_sync", 0444, NULL, NULL,
+			    &ion_cpu_sync_fops);
+}
+#else
+static void ion_debugfs_init(void)
+{
+}
+#endif
+
 struct ion_device *ion_device_create(struct ion_heap_data *heap_data)
 {
 	struct ion_device *idev = &ion_dev;
@@ -646,5 +734,6 @@ struct ion_device *ion_device_create(struct ion_heap_data *heap_data)
 		return ERR_PTR(ret);
 
 	idev->heap_data = heap_data;
+	ion_debugfs_init();
 	return idev;
 }
@@ -120,6 +120,10 @@ struct ion_vma_list {
  * @vaddr:		the kernel mapping if kmap_cnt is not zero
  * @sg_table:		the sg table for the buffer if dmap_cnt is not zero
  * @vmas:		list of vma's mapping this buffer
+ * @cpu_sync_lock:	protects @cpu_clean_start and @cpu_clean_end
+ * @cpu_clean_start:	start of the range the CPU has only read since
+ *			begin_cpu_access() invalidated it
+ * @cpu_clean_end:	end of that range, equal to @cpu_clean_start if none
  */
 struct ion_dma_buf_attachment;
 struct ion_buffer {
@@ -137,6 +141,9 @@ struct ion_buffer {
 	size_t size;
 	int kmap_refcount;
 	struct msm_iommu_data iommu_data;
+	spinlock_t cpu_sync_lock;
+	unsigned long cpu_clean_start;
+	unsigned long cpu_clean_end;
 };
 
 void ion_buffer_destroy(struct ion_buffer *buffer);
@@ -348,6 +355,24 @@ struct ion_heap *ion_secure_carveout_heap_create(
  * many systems
  */
 
+#define ION_PAGE_POOL_PCP_MAX	32
+
+/**
+ * struct ion_page_pool_pcp - per-cpu magazine of an ion_page_pool
+ * @lock:		protects the magazine; only contended by remote drains
+ * @count:		number of pages currently held
+ * @pages:		the cached pages, most recently freed last
+ * @hit:		allocations served from the magazine
+ * @miss:		allocations that had to go to the lists or the buddy
+ */
+struct ion_page_pool_pcp {
+	spinlock_t lock;
+	int count;
+	struct page *pages[ION_PAGE_POOL_PCP_MAX];
+	unsigned long hit;
+	unsigned long miss;
+};
+
 /**
  * struct ion_page_pool - pagepool struct
  * @high_count:		number of highmem items in the pool
@@ -360,6 +385,10 @@ struct ion_heap *ion_secure_carveout_heap_create(
  * @order:		order of pages in the pool
  * @list:		plist node for list of pools
  * @cached:		it's cached pool or not
+ * @pcp:		per-cpu magazines in front of the shared lists
+ * @pcp_high:		number of pages each magazine may hold, 0 if disabled
+ * @pcp_batch:		pages moved between a magazine and the lists at once
+ * @pcp_node:		entry in the list of pools exported through debugfs
  *
  * Allows you to keep a pool of pre allocated pages to use from your heap.
  * Keeping a pool of pages that is ready for dma, ie any cached mapping have
@@ -378,6 +407,10 @@ struct ion_page_pool {
 	unsigned int order;
 	bool boost_flag;
 	struct plist_node list;
+	struct ion_page_pool_pcp __percpu *pcp;
+	int pcp_high;
+	int pcp_batch;
+	struct list_head pcp_node;
 };
 
 struct ion_page_pool *ion_page_pool_create(gfp_t gfp_mask, unsigned int order,
@@ -391,6 +424,7 @@ struct page *ion_page_pool_alloc_pool_only(struct ion_page_pool *a);
 void ion_page_pool_free_immediate(struct ion_page_pool *pool,
 				  struct page *page);
 int ion_page_pool_total(struct ion_page_pool *pool, bool high);
+void ion_page_pool_pcp_drain(struct ion_page_pool *pool);
 size_t ion_system_heap_secure_page_pool_total(struct ion_heap *heap, int vmid);
 
 inline struct page *ion_page_pool_alloc_pages(struct ion_page_pool *pool);
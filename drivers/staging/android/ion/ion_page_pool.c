@@ -20,9 +20,13 @@
 #include <linux/fs.h>
 #include <linux/list.h>
 #include <linux/init.h>
+#include <linux/mutex.h>
+#include <linux/percpu.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <linux/swap.h>
 #include <linux/sched/signal.h>
+#include <linux/sizes.h>
 
 #include "ion.h"
 
@@ -33,6 +37,9 @@
  */
 static long nr_total_pages;
 
+/* Upper bound on the memory a single cpu may park in one pool's magazine */
+#define ION_PAGE_POOL_PCP_BYTES	SZ_256K
+
 inline struct page *ion_page_pool_alloc_pages(struct ion_page_pool *pool)
 {
 	struct page *page = alloc_pages(pool->gfp_mask, pool->order);
@@ -46,9 +53,15 @@ static void ion_page_pool_free_pages(struct ion_page_pool *pool,
 	__free_pages(page, pool->order);
 }
 
-static int ion_page_pool_add(struct ion_page_pool *pool, struct page *page)
+static void ion_page_pool_account(struct ion_page_pool *pool,
+				  struct page *page, int nr)
+{
+	nr_total_pages += nr;
+	mod_node_page_state(page_pgdat(page), NR_KERNEL_MISC_RECLAIMABLE, nr);
+}
+
+static void __ion_page_pool_put(struct ion_page_pool *pool, struct page *page)
 {
-	spin_lock(&pool->lock);
 	if (PageHighMem(page)) {
 		list_add_tail(&page->lru, &pool->high_items);
 		pool->high_count++;
@@ -56,15 +69,10 @@ static int ion_page_pool_add(struct ion_page_pool *pool, struct page *page)
 		list_add_tail(&page->lru, &pool->low_items);
 		pool->low_count++;
 	}
-
-	nr_total_pages += 1 << pool->order;
-	mod_node_page_state(page_pgdat(page), NR_KERNEL_MISC_RECLAIMABLE,
-							1 << pool->order);
-	spin_unlock(&pool->lock);
-	return 0;
 }
 
-static struct page *ion_page_pool_remove(struct ion_page_pool *pool, bool high)
+static struct page *__ion_page_pool_take(struct ion_page_pool *pool,
+					 bool high)
 {
 	struct page *page;
 
@@ -77,18 +85,156 @@ static struct page *ion_page_pool_remove(struct ion_page_pool *pool, bool high)
 		page = list_first_entry(&pool->low_items, struct page, lru);
 		pool->low_count--;
 	}
+	list_del(&page->lru);
+	return page;
+}
+
+static int ion_page_pool_add(struct ion_page_pool *pool, struct page *page)
+{
+	spin_lock(&pool->lock);
+	__ion_page_pool_put(pool, page);
+	ion_page_pool_account(pool, page, 1 << pool->order);
+	spin_unlock(&pool->lock);
+	return 0;
+}
+
+static struct page *ion_page_pool_remove(struct ion_page_pool *pool, bool high)
+{
+	struct page *page = __ion_page_pool_take(pool, high);
+
 #ifdef OPLUS_FEATURE_HEALTHINFO
 /*Huacai.Zhou@PSW.BSP.Kernel.MM, 2018-09-25, add ion cached account*/
 	zone_page_state_add(-(1L << pool->order), page_zone(page),
 			NR_IONCACHE_PAGES);
 #endif /* OPLUS_FEATURE_HEALTHINFO */
-	list_del(&page->lru);
-	nr_total_pages -= 1 << pool->order;
-	mod_node_page_state(page_pgdat(page), NR_KERNEL_MISC_RECLAIMABLE,
-							-(1 << pool->order));
+	ion_page_pool_account(pool, page, -(1 << pool->order));
+	return page;
+}
+
+/*
+ * Per-cpu magazines sit in front of the shared high/low lists so that the
+ * common alloc/free path only touches a cpu-local lock. Pages held by a
+ * magazine are still accounted as pool pages; they are moved to and from the
+ * lists in batches of pcp_batch under pool->lock.
+ */
+static inline bool ion_page_pool_has_pcp(struct ion_page_pool *pool)
+{
+	return pool->pcp_high && !pool->boost_flag;
+}
+
+static void ion_page_pool_pcp_refill(struct ion_page_pool *pool,
+				     struct ion_page_pool_pcp *pcp)
+{
+	if (!spin_trylock(&pool->lock))
+		return;
+
+	while (pcp->count < pool->pcp_batch) {
+		if (pool->high_count)
+			pcp->pages[pcp->count++] =
+				__ion_page_pool_take(pool, true);
+		else if (pool->low_count)
+			pcp->pages[pcp->count++] =
+				__ion_page_pool_take(pool, false);
+		else
+			break;
+	}
+	spin_unlock(&pool->lock);
+}
+
+static void ion_page_pool_pcp_flush(struct ion_page_pool *pool,
+				    struct ion_page_pool_pcp *pcp, int nr)
+{
+	int i;
+
+	nr = min(nr, pcp->count);
+	if (!nr)
+		return;
+
+	/* Return the oldest pages; the most recently freed ones are hottest */
+	spin_lock(&pool->lock);
+	for (i = 0; i < nr; i++)
+		__ion_page_pool_put(pool, pcp->pages[i]);
+	spin_unlock(&pool->lock);
+
+	pcp->count -= nr;
+	memmove(pcp->pages, pcp->pages + nr, pcp->count * sizeof(*pcp->pages));
+}
+
+static struct page *ion_page_pool_pcp_alloc(struct ion_page_pool *pool)
+{
+	struct ion_page_pool_pcp *pcp;
+	struct page *page = NULL;
+
+	pcp = get_cpu_ptr(pool->pcp);
+	spin_lock(&pcp->lock);
+	if (!pcp->count)
+		ion_page_pool_pcp_refill(pool, pcp);
+	if (pcp->count) {
+		page = pcp->pages[--pcp->count];
+		pcp->hit++;
+	} else {
+		pcp->miss++;
+	}
+	spin_unlock(&pcp->lock);
+	put_cpu_ptr(pool->pcp);
+
+	if (page)
+		ion_page_pool_account(pool, page, -(1 << pool->order));
 	return page;
 }
 
+static bool ion_page_pool_pcp_free(struct ion_page_pool *pool,
+				   struct page *page)
+{
+	struct ion_page_pool_pcp *pcp;
+	bool cached = false;
+
+	pcp = get_cpu_ptr(pool->pcp);
+	spin_lock(&pcp->lock);
+	if (pcp->count == pool->pcp_high)
+		ion_page_pool_pcp_flush(pool, pcp, pool->pcp_batch);
+	if (pcp->count < pool->pcp_high) {
+		pcp->pages[pcp->count++] = page;
+		cached = true;
+	}
+	spin_unlock(&pcp->lock);
+	put_cpu_ptr(pool->pcp);
+
+	if (cached)
+		ion_page_pool_account(pool, page, 1 << pool->order);
+	return cached;
+}
+
+/* Moves every page held by the magazines back to the shared lists */
+void ion_page_pool_pcp_drain(struct ion_page_pool *pool)
+{
+	int cpu;
+
+	if (!pool->pcp)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		struct ion_page_pool_pcp *pcp = per_cpu_ptr(pool->pcp, cpu);
+
+		spin_lock(&pcp->lock);
+		ion_page_pool_pcp_flush(pool, pcp, pcp->count);
+		spin_unlock(&pcp->lock);
+	}
+}
+
+static int ion_page_pool_pcp_total(struct ion_page_pool *pool)
+{
+	int cpu, count = 0;
+
+	if (!pool->pcp)
+		return 0;
+
+	for_each_possible_cpu(cpu)
+		count += READ_ONCE(per_cpu_ptr(pool->pcp, cpu)->count);
+
+	return count;
+}
+
 struct page *ion_page_pool_alloc(struct ion_page_pool *pool, bool *from_pool)
 {
 	struct page *page = NULL;
@@ -98,7 +244,10 @@ struct page *ion_page_pool_alloc(struct ion_page_pool *pool, bool *from_pool)
 	if (fatal_signal_pending(current))
 		return ERR_PTR(-EINTR);
 
-	if (*from_pool && spin_trylock(&pool->lock)) {
+	if (*from_pool && ion_page_pool_has_pcp(pool))
+		page = ion_page_pool_pcp_alloc(pool);
+
+	if (!page && *from_pool && spin_trylock(&pool->lock)) {
 		if (pool->high_count)
 			page = ion_page_pool_remove(pool, true);
 		else if (pool->low_count)
@@ -125,7 +274,10 @@ struct page *ion_page_pool_alloc_pool_only(struct ion_page_pool *pool)
 	if (!pool)
 		return ERR_PTR(-EINVAL);
 
-	if (spin_trylock(&pool->lock)) {
+	if (ion_page_pool_has_pcp(pool))
+		page = ion_page_pool_pcp_alloc(pool);
+
+	if (!page && spin_trylock(&pool->lock)) {
 		if (pool->high_count)
 			page = ion_page_pool_remove(pool, true);
 		else if (pool->low_count)
@@ -142,6 +294,9 @@ void ion_page_pool_free(struct ion_page_pool *pool, struct page *page)
 {
 	int ret;
 
+	if (ion_page_pool_has_pcp(pool) && ion_page_pool_pcp_free(pool, page))
+		return;
+
 	ret = ion_page_pool_add(pool, page);
 	if (ret)
 		ion_page_pool_free_pages(pool, page);
@@ -154,7 +309,7 @@ void ion_page_pool_free_immediate(struct ion_page_pool *pool, struct page *page)
 
 int ion_page_pool_total(struct ion_page_pool *pool, bool high)
 {
-	int count = pool->low_count;
+	int count = pool->low_count + ion_page_pool_pcp_total(pool);
 
 	if (high)
 		count += pool->high_count;
@@ -186,6 +341,9 @@ int ion_page_pool_shrink(struct ion_page_pool *pool, gfp_t gfp_mask,
 	if (nr_to_scan == 0)
 		return ion_page_pool_total(pool, high);
 
+	/* Let the shrinker see the pages parked in the magazines too */
+	ion_page_pool_pcp_drain(pool);
+
 	while (freed < nr_to_scan) {
 		struct page *page;
 
@@ -206,6 +364,43 @@ int ion_page_pool_shrink(struct ion_page_pool *pool, gfp_t gfp_mask,
 	return freed;
 }
 
+static LIST_HEAD(pcp_pools);
+static DEFINE_MUTEX(pcp_pools_lock);
+
+static void ion_page_pool_pcp_init(struct ion_page_pool *pool)
+{
+	int cpu, high;
+
+	pool->pcp = NULL;
+	pool->pcp_high = 0;
+	INIT_LIST_HEAD(&pool->pcp_node);
+
+	/* Bound how much memory each cpu may park in a magazine */
+	high = min_t(int, ION_PAGE_POOL_PCP_BYTES >> (PAGE_SHIFT + pool->order),
+		     ION_PAGE_POOL_PCP_MAX);
+	if (high < 2)
+		return;
+
+	pool->pcp = alloc_percpu(struct ion_page_pool_pcp);
+	if (!pool->pcp)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		struct ion_page_pool_pcp *pcp = per_cpu_ptr(pool->pcp, cpu);
+
+		spin_lock_init(&pcp->lock);
+		pcp->count = 0;
+		pcp->hit = 0;
+		pcp->miss = 0;
+	}
+	pool->pcp_high = high;
+	pool->pcp_batch = high / 2;
+
+	mutex_lock(&pcp_pools_lock);
+	list_add_tail(&pool->pcp_node, &pcp_pools);
+	mutex_unlock(&pcp_pools_lock);
+}
+
 struct ion_page_pool *ion_page_pool_create(gfp_t gfp_mask, unsigned int order,
 					   bool cached)
 {
@@ -221,19 +416,81 @@ struct ion_page_pool *ion_page_pool_create(gfp_t gfp_mask, unsigned int order,
 	pool->order = order;
 	spin_lock_init(&pool->lock);
 	plist_node_init(&pool->list, order);
-	if (cached)
-		pool->cached = true;
+	pool->cached = cached;
+	pool->boost_flag = false;
+	ion_page_pool_pcp_init(pool);
 
 	return pool;
 }
 
 void ion_page_pool_destroy(struct ion_page_pool *pool)
 {
+	if (pool->pcp) {
+		mutex_lock(&pcp_pools_lock);
+		list_del(&pool->pcp_node);
+		mutex_unlock(&pcp_pools_lock);
+		ion_page_pool_pcp_drain(pool);
+		free_percpu(pool->pcp);
+	}
 	kfree(pool);
 }
 
+#ifdef CONFIG_DEBUG_FS
+static int ion_page_pool_pcp_show(struct seq_file *s, void *unused)
+{
+	struct ion_page_pool *pool;
+	int cpu;
+
+	mutex_lock(&pcp_pools_lock);
+	list_for_each_entry(pool, &pcp_pools, pcp_node) {
+		if (!ion_page_pool_has_pcp(pool))
+			continue;
+
+		seq_printf(s, "order %u %s pool (high %d batch %d):\n",
+			   pool->order, pool->cached ? "cached" : "uncached",
+			   pool->pcp_high, pool->pcp_batch);
+		for_each_possible_cpu(cpu) {
+			struct ion_page_pool_pcp *pcp =
+				per_cpu_ptr(pool->pcp, cpu);
+
+			seq_printf(s, "  cpu%d: count %d hit %lu miss %lu\n",
+				   cpu, READ_ONCE(pcp->count),
+				   READ_ONCE(pcp->hit), READ_ONCE(pcp->miss));
+		}
+	}
+	mutex_unlock(&pcp_pools_lock);
+
+	return 0;
+}
+
+static int ion_page_pool_pcp_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, ion_page_pool_pcp_show, inode->i_private);
+}
+
+static const struct file_operations ion_page_pool_pcp_fops = {
+	.open = ion_page_pool_pcp_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int __init ion_page_pool_init(void)
+{
+	struct dentry *root;
+
+	root = debugfs_create_dir("ion_page_pool", NULL);
+	if (IS_ERR_OR_NULL(root))
+		return 0;
+
+	debugfs_create_file("pcp_stats", 0444, root, NULL,
+			    &ion_page_pool_pcp_fops);
+	return 0;
+}
+#else
 static int __init ion_page_pool_init(void)
 {
 	return 0;
 }
+#endif
 device_initcall(ion_page_pool_init);
@@ -372,6 +372,7 @@ static int ion_system_heap_allocate(struct ion_heap *heap,
 			i++;
 		}
 		max_order = orders[0];
+		boost_pool_account(boost_pool, boostpool_sz, size_remaining);
 
 #ifdef BOOSTPOOL_DEBUG
 		if (size_remaining != 0) {
@@ -20,6 +20,8 @@
 #include <linux/poll.h>
 #include <linux/mm.h>
 #include <linux/sched.h>
+#include <linux/workqueue.h>
+#include <linux/msm_kgsl.h>
 #include <uapi/linux/sched/types.h>
 #include <../../../../kernel/sched/sched.h>
 
@@ -33,6 +35,19 @@ static bool boost_pool_enable = true;
 static wait_queue_head_t kcrit_scene_wait;
 static int kcrit_scene_flag = 0;
 
+/* Pre-fill this long before a scene is predicted to recur */
+static unsigned int boost_prefill_lead_ms = 2000;
+/* Allocations within this long after a scene starts count as its demand */
+static unsigned int boost_scene_window_ms = 3000;
+/* Never hold more than this many pages on behalf of a prediction alone */
+static int boost_max_idle_pages = 64 * 256;
+
+static const char * const boost_scene_names[NR_BOOST_SCENES] = {
+	[BOOST_SCENE_NONE]	= "none",
+	[BOOST_SCENE_CAMERA]	= "camera",
+	[BOOST_SCENE_LAUNCH]	= "launch",
+};
+
 static inline unsigned int order_to_size(int order)
 {
 	return PAGE_SIZE << order;
@@ -63,6 +78,115 @@ static int boost_pool_nr_pages(struct ion_boost_pool *pool)
 	return count;
 }
 
+/* Number of pages the refill thread tries to keep in the pool */
+static inline int boost_pool_target(struct ion_boost_pool *pool)
+{
+	return max(pool->high, READ_ONCE(pool->prefill));
+}
+
+static inline unsigned int boost_ewma(unsigned int avg, unsigned int sample,
+				      unsigned int nr)
+{
+	return nr ? (avg * 3 + sample) / 4 : sample;
+}
+
+/* Folds the demand seen during the current scene into its history */
+static void boost_pool_scene_end(struct ion_boost_pool *pool)
+{
+	struct boost_scene_stat *stat;
+
+	if (pool->cur_scene == BOOST_SCENE_NONE)
+		return;
+
+	stat = &pool->scenes[pool->cur_scene];
+	stat->demand = boost_ewma(stat->demand, pool->cur_demand, stat->nr);
+	stat->nr++;
+	pool->cur_scene = BOOST_SCENE_NONE;
+	pool->cur_demand = 0;
+}
+
+static void boost_pool_scene_start(struct ion_boost_pool *pool,
+				   enum boost_scene scene)
+{
+	struct boost_scene_stat *stat = &pool->scenes[scene];
+	unsigned long now = jiffies, delay = 0;
+
+	spin_lock(&pool->scene_lock);
+	boost_pool_scene_end(pool);
+	if (stat->last_start) {
+		stat->interval = boost_ewma(stat->interval,
+					    now - stat->last_start,
+					    stat->nr > 1);
+		if (stat->interval > msecs_to_jiffies(boost_prefill_lead_ms))
+			delay = stat->interval -
+				msecs_to_jiffies(boost_prefill_lead_ms);
+	}
+	stat->last_start = now;
+	pool->cur_scene = scene;
+	pool->predicted = scene;
+	spin_unlock(&pool->scene_lock);
+
+	/* The scene is here; its own watermark takes over from the guess */
+	WRITE_ONCE(pool->prefill, 0);
+	if (delay)
+		mod_delayed_work(system_unbound_wq, &pool->predict_work,
+				 delay);
+}
+
+/*
+ * Runs shortly before the last scene is expected to recur and grows the pool
+ * to that scene's average demand, bounded by boost_max_idle_pages. If the
+ * scene does not show up within twice the lead time, the prediction is
+ * dropped again so the memory can be shrunk.
+ */
+static void boost_pool_predict_work(struct work_struct *work)
+{
+	struct ion_boost_pool *pool = container_of(to_delayed_work(work),
+						   struct ion_boost_pool,
+						   predict_work);
+	struct boost_scene_stat *stat;
+	int prefill;
+
+	if (READ_ONCE(pool->prefill)) {
+		WRITE_ONCE(pool->prefill, 0);
+		return;
+	}
+
+	spin_lock(&pool->scene_lock);
+	stat = &pool->scenes[pool->predicted];
+	prefill = min_t(int, stat->demand, boost_max_idle_pages);
+	spin_unlock(&pool->scene_lock);
+
+	if (prefill <= pool->high)
+		return;
+
+	WRITE_ONCE(pool->prefill, prefill);
+	boost_pool_wakeup_process(pool);
+	queue_delayed_work(system_unbound_wq, &pool->predict_work,
+			   2 * msecs_to_jiffies(boost_prefill_lead_ms));
+}
+
+void boost_pool_account(struct ion_boost_pool *pool, unsigned long hit_sz,
+			unsigned long miss_sz)
+{
+	unsigned int nr_pages = (hit_sz + miss_sz) >> PAGE_SHIFT;
+
+	atomic_long_add(hit_sz >> PAGE_SHIFT, &pool->hit_pages);
+	atomic_long_add(miss_sz >> PAGE_SHIFT, &pool->miss_pages);
+
+	spin_lock(&pool->scene_lock);
+	if (pool->cur_scene != BOOST_SCENE_NONE) {
+		unsigned long start = pool->scenes[pool->cur_scene].last_start;
+
+		if (time_after(jiffies, start +
+			       msecs_to_jiffies(boost_scene_window_ms)))
+			boost_pool_scene_end(pool);
+		else
+			pool->cur_demand += nr_pages;
+	}
+	spin_unlock(&pool->scene_lock);
+}
+
 static int fill_boost_page_pool(struct device *dev, struct ion_page_pool *pool)
 {
 	struct page *page;
@@ -72,6 +196,9 @@ static int fill_boost_page_pool(struct device *dev, struct ion_page_pool *pool)
 		return -ENOENT;
 	}
 	page = ion_page_pool_alloc_pages(pool);
+	/* Take back idle GPU pool pages before giving up on the refill */
+	if (NULL == page && kgsl_pool_reclaim(1 << pool->order))
+		page = ion_page_pool_alloc_pages(pool);
 	if (NULL == page)
 		return -ENOMEM;
 
@@ -128,7 +255,8 @@ static int boost_pool_kworkthread(void *p)
 			current->static_ux = 1;
 		}
 		for (i = 0; i < NUM_ORDERS; i++) {
-			while (boost_pool_nr_pages(pool) < pool->high) {
+			while (boost_pool_nr_pages(pool) <
+			       boost_pool_target(pool)) {
 				if (fill_boost_page_pool(pool->dev,
 							 pool->pools[i]) < 0)
 					break;
@@ -265,7 +393,7 @@ int boost_pool_shrink(struct ion_boost_pool *boost_pool,
 		return ion_page_pool_shrink(pool, gfp_mask, 0);
 
 	nr_max_free = boost_pool_nr_pages(boost_pool) -
-		(boost_pool->high + LOWORDER_WATER_MASK);
+		(boost_pool_target(boost_pool) + LOWORDER_WATER_MASK);
 	nr_to_free = min(nr_max_free, nr_to_scan);
 
 	if (nr_to_free <= 0)
@@ -303,6 +431,8 @@ static int bind_task_min_cap_cpus(struct task_struct *tsk)
 static int boost_pool_proc_show(struct seq_file *s, void *v)
 {
 	struct ion_boost_pool *boost_pool = s->private;
+	long hit = atomic_long_read(&boost_pool->hit_pages);
+	long miss = atomic_long_read(&boost_pool->miss_pages);
 	int i;
 
 	seq_printf(s, "Name:%s: %dMib, low: %dMib high: %dMib\n",
@@ -310,6 +440,19 @@ static int boost_pool_proc_show(struct seq_file *s, void *v)
 		   boost_pool_nr_pages(boost_pool) >> 8,
 		   boost_pool->low >> 8,
 		   boost_pool->high >> 8);
+	seq_printf(s, "prefill: %dMib hit: %ldMib miss: %ldMib hit rate: %ld%%\n",
+		   READ_ONCE(boost_pool->prefill) >> 8, hit >> 8, miss >> 8,
+		   hit + miss ? hit * 100 / (hit + miss) : 0);
+
+	spin_lock(&boost_pool->scene_lock);
+	for (i = BOOST_SCENE_NONE + 1; i < NR_BOOST_SCENES; i++) {
+		struct boost_scene_stat *stat = &boost_pool->scenes[i];
+
+		seq_printf(s, "scene %s: count %u demand %uMib interval %ums\n",
+			   boost_scene_names[i], stat->nr, stat->demand >> 8,
+			   jiffies_to_msecs(stat->interval));
+	}
+	spin_unlock(&boost_pool->scene_lock);
 
 	for (i = 0; i < NUM_ORDERS; i++) {
 		struct ion_page_pool *pool = boost_pool->pools[i];
@@ -349,6 +492,11 @@ static ssize_t boost_pool_proc_write(struct file *file,
 	if (copy_from_user(buffer, buf, count))
 		return -EFAULT;
 
+	if (!strcmp(strstrip(buffer), "launch")) {
+		boost_pool_scene_start(boost_pool, BOOST_SCENE_LAUNCH);
+		return count;
+	}
+
 	err = kstrtoint(strstrip(buffer), 0, &nr_pages);
 	if(err)
 		return err;
@@ -368,6 +516,7 @@ static ssize_t boost_pool_proc_write(struct file *file,
 		/* trigger lmkiller */
 		kcrit_scene_flag = 1;
 		wake_up_interruptible(&kcrit_scene_wait);
+		boost_pool_scene_start(boost_pool, BOOST_SCENE_CAMERA);
 		boost_pool->high = nr_pages;
 		boost_pool_wakeup_process(boost_pool);
 	}
@@ -413,6 +562,8 @@ struct ion_boost_pool *boost_pool_create(struct ion_system_heap *heap,
 
 	boost_pool->high = boost_pool->low = nr_pages;
 	boost_pool->name = name;
+	spin_lock_init(&boost_pool->scene_lock);
+	INIT_DELAYED_WORK(&boost_pool->predict_work, boost_pool_predict_work);
 	boost_pool->usage = ion_flag;
 	boost_pool->dev = heap->heap.priv;
 
@@ -491,3 +642,6 @@ static __init int kcrit_scene_init(void)
 }
 fs_initcall(kcrit_scene_init);
 module_param_named(debug_boost_pool_enable, boost_pool_enable, bool, 0644);
+module_param_named(prefill_lead_ms, boost_prefill_lead_ms, uint, 0644);
+module_param_named(scene_window_ms, boost_scene_window_ms, uint, 0644);
+module_param_named(max_idle_pages, boost_max_idle_pages, int, 0644);
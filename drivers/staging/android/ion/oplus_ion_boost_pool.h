@@ -10,14 +10,43 @@
 #define LOWORDER_WATER_MASK (64*4)
 #define MAX_POOL_SIZE (128*64*4)
 
+enum boost_scene {
+	BOOST_SCENE_NONE,
+	BOOST_SCENE_CAMERA,
+	BOOST_SCENE_LAUNCH,
+	NR_BOOST_SCENES,
+};
+
+/*
+ * Demand history of one scene, used to pre-fill the pool before the scene
+ * is expected to happen again. Both averages are EWMAs with a weight of 1/4.
+ */
+struct boost_scene_stat {
+	unsigned int nr;
+	unsigned int demand;
+	unsigned long interval;
+	unsigned long last_start;
+};
+
 struct ion_boost_pool {
 	char *name;
 	int low, high;
+	int prefill;
 	unsigned long usage;
 	unsigned int wait_flag;
 	wait_queue_head_t waitq;
 	struct device *dev;
 	struct proc_dir_entry *proc_info;
+
+	spinlock_t scene_lock;
+	enum boost_scene cur_scene;
+	unsigned int cur_demand;
+	enum boost_scene predicted;
+	struct boost_scene_stat scenes[NR_BOOST_SCENES];
+	struct delayed_work predict_work;
+	atomic_long_t hit_pages;
+	atomic_long_t miss_pages;
+
 	struct ion_page_pool *pools[0];
 };
 
@@ -37,4 +66,6 @@ struct ion_boost_pool *boost_pool_create(struct ion_system_heap *heap,
 void boost_pool_wakeup_process(struct ion_boost_pool *pool);
 void boost_pool_dec_high(struct ion_boost_pool *pool, int nr_pages);
 void boost_pool_dump(struct ion_boost_pool *pool);
+void boost_pool_account(struct ion_boost_pool *pool, unsigned long hit_sz,
+			unsigned long miss_sz);
 #endif /* _ION_SMART_POOL_H */
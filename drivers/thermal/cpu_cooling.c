@@ -32,7 +32,9 @@
 #include <linux/cpu.h>
 #include <linux/cpu_cooling.h>
 #include <linux/sched.h>
+#include <linux/sched/topology.h>
 #include <linux/of_device.h>
+#include <linux/arch_topology.h>
 #include <linux/suspend.h>
 
 #include <trace/events/thermal.h>
@@ -901,6 +903,62 @@ static int cpufreq_power2state(struct thermal_cooling_device *cdev,
 	return 0;
 }
 
+static unsigned long cpufreq_cdev_capacity(int cpu)
+{
+#ifdef CONFIG_GENERIC_ARCH_TOPOLOGY
+	return topology_get_cpu_scale(NULL, cpu);
+#else
+	return SCHED_CAPACITY_SCALE;
+#endif
+}
+
+/**
+ * cpufreq_get_efficiency() - get the efficiency of the next power step
+ * @cdev:	&thermal_cooling_device pointer
+ * @tz:		a valid thermal zone device pointer
+ * @eff:	pointer in which to store the efficiency
+ *
+ * Estimate how much useful performance the cpus described by @cdev
+ * would turn each extra watt into: the capacity gained by the next
+ * frequency step above the current one (the last step when already at
+ * the top) divided by its extra power, scaled by the average load
+ * measured by the latest cpufreq_get_requested_power().  Capacity is
+ * relative to the biggest cpu, so clusters can be compared, and the
+ * result is in capacity units per watt.
+ *
+ * Return: 0 on success, -EINVAL if the cpus have a single frequency.
+ */
+static int cpufreq_get_efficiency(struct thermal_cooling_device *cdev,
+				  struct thermal_zone_device *tz, u32 *eff)
+{
+	struct cpufreq_cooling_device *cpufreq_cdev = cdev->devdata;
+	struct freq_table *freq_table = cpufreq_cdev->freq_table;
+	struct cpufreq_policy *policy = cpufreq_cdev->policy;
+	unsigned int num_cpus, cur_freq;
+	u32 delta_power;
+	u64 perf;
+	int i;
+
+	if (!cpufreq_cdev->max_level)
+		return -EINVAL;
+
+	num_cpus = cpumask_weight(policy->cpus) ?: 1;
+	cur_freq = cpufreq_quick_get(policy->cpu);
+
+	for (i = 1; i < cpufreq_cdev->max_level; i++)
+		if (cur_freq >= freq_table[i].frequency)
+			break;
+
+	delta_power = freq_table[i - 1].power - freq_table[i].power;
+	perf = (u64)(freq_table[i - 1].frequency - freq_table[i].frequency) *
+	       cpufreq_cdev_capacity(policy->cpu) * cpufreq_cdev->last_load *
+	       10;
+	*eff = div64_u64(perf, (u64)freq_table[0].frequency * num_cpus *
+			 (delta_power ?: 1));
+
+	return 0;
+}
+
 /* Bind cpufreq callbacks to thermal cooling device ops */
 
 static struct thermal_cooling_device_ops cpufreq_cooling_ops = {
@@ -918,6 +976,7 @@ static struct thermal_cooling_device_ops cpufreq_power_cooling_ops = {
 	.get_requested_power	= cpufreq_get_requested_power,
 	.state2power		= cpufreq_state2power,
 	.power2state		= cpufreq_power2state,
+	.get_efficiency		= cpufreq_get_efficiency,
 };
 
 /* Notifier for cpufreq policy change */
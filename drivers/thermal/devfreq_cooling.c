@@ -24,6 +24,7 @@
 #include <linux/idr.h>
 #include <linux/slab.h>
 #include <linux/pm_opp.h>
+#include <linux/sched/topology.h>
 #include <linux/thermal.h>
 
 #include <trace/events/thermal.h>
@@ -431,6 +432,39 @@ static int devfreq_cooling_power2state(struct thermal_cooling_device *cdev,
 	return 0;
 }
 
+/*
+ * Performance gained per watt by the next OPP above the current one
+ * (the last step when already at the top), scaled by utilization.
+ * Performance is relative to the device's highest frequency.
+ */
+static int devfreq_cooling_get_efficiency(struct thermal_cooling_device *cdev,
+					  struct thermal_zone_device *tz,
+					  u32 *eff)
+{
+	struct devfreq_cooling_device *dfc = cdev->devdata;
+	struct devfreq_dev_status *status = &dfc->devfreq->last_status;
+	unsigned long state;
+	u32 delta_power;
+	u64 gain;
+
+	if (dfc->freq_table_size < 2 || !status->total_time)
+		return -EINVAL;
+
+	state = freq_get_state(dfc, status->current_frequency);
+	if (state == THERMAL_CSTATE_INVALID)
+		return -EAGAIN;
+
+	state = max(state, 1UL);
+	delta_power = dfc->power_table[state - 1] - dfc->power_table[state];
+	gain = div_u64((u64)(dfc->freq_table[state - 1] -
+			     dfc->freq_table[state]) *
+		       SCHED_CAPACITY_SCALE * 1000, dfc->freq_table[0]);
+	gain = div_u64(gain * status->busy_time, status->total_time);
+	*eff = div_u64(gain, delta_power ?: 1);
+
+	return 0;
+}
+
 static struct thermal_cooling_device_ops devfreq_cooling_ops = {
 	.get_max_state = devfreq_cooling_get_max_state,
 	.get_cur_state = devfreq_cooling_get_cur_state,
@@ -564,6 +598,8 @@ of_devfreq_cooling_register_power(struct device_node *np, struct devfreq *df,
 			devfreq_cooling_get_requested_power;
 		devfreq_cooling_ops.state2power = devfreq_cooling_state2power;
 		devfreq_cooling_ops.power2state = devfreq_cooling_power2state;
+		devfreq_cooling_ops.get_efficiency =
+			devfreq_cooling_get_efficiency;
 	}
 
 	err = devfreq_cooling_gen_tables(dfc);
@@ -8,6 +8,7 @@
 #include <linux/cpu.h>
 #include <linux/cpufreq.h>
 #include <linux/kernel.h>
+#include <linux/msm_kgsl.h>
 #include <linux/of.h>
 #include <linux/platform_device.h>
 #include <linux/slab.h>
@@ -21,12 +22,64 @@
 	ret;									\
 })
 
+/* Most forecast steps kept, which bounds the horizon to poll-ms * this */
+#define MPC_MAX_STEPS 64
+#define MPC_LEVEL_MAX 1000
+/* Bound on the per-step correction learned from forecast errors */
+#define MPC_MAX_BIAS_MDEG 2000
+
+enum {
+	MPC_SILVER,
+	MPC_GOLD,
+	MPC_GPU,
+	MPC_DOMAINS
+};
+
 struct thermal_zone {
 	u32 gold_khz;
 	u32 silver_khz;
 	s32 trip_deg;
 };
 
+/*
+ * The skin is modelled as a first order system heating towards
+ * ambient + gain * power with time constant tau, where power is a weighted
+ * sum of busy * (freq / max freq)^3 over the domains, in per mille. A bias
+ * learned from the one-step forecast error absorbs what the power proxy
+ * misses. Every poll the highest level whose forecast over the horizon
+ * stays under the budget is found, and the level moves towards it by at
+ * most step_down or step_up per mille. Each domain's limit is placed
+ * between its min and max frequency by the level.
+ */
+struct thermal_mpc {
+	bool enabled;
+	s32 budget_mdeg;
+	s32 ambient_mdeg;
+	s32 gain_mdeg;
+	u32 tau_ms;
+	u32 steps;
+	u32 step_down;
+	u32 step_up;
+	u32 weight[MPC_DOMAINS];
+	u32 min_freq[MPC_DOMAINS];
+	u32 max_freq[MPC_DOMAINS];
+	u32 limit[MPC_DOMAINS];
+	u32 busy[MPC_DOMAINS];
+	u64 prev_idle[MPC_GPU];
+	u64 prev_wall[MPC_GPU];
+	void *gpu_limit;
+	s32 bias_mdeg;
+	s32 next_mdeg;
+	s32 temp_mdeg;
+	s32 pred_mdeg;
+	s32 forecast[MPC_MAX_STEPS];
+	u32 forecast_idx;
+	u32 nr_forecasts;
+	u32 err_avg_mdeg;
+	u32 power;
+	u32 level;
+};
+
 struct thermal_drv {
 	struct notifier_block cpu_notif;
 	struct delayed_work throttle_work;
@@ -36,10 +89,228 @@ struct thermal_drv {
 	struct thermal_zone *curr_zone;
 	enum qpnp_vadc_channels adc_chan;
 	u32 poll_jiffies;
+	u32 poll_ms;
 	u32 start_delay;
 	u32 nr_zones;
+	struct mutex mpc_lock;
+	struct thermal_mpc mpc;
 };
 
+static const struct cpumask *mpc_cluster_mask(int d)
+{
+	return d == MPC_SILVER ? cpu_lp_mask : cpu_perf_mask;
+}
+
+#if IS_REACHABLE(CONFIG_QCOM_KGSL)
+static void mpc_gpu_set_limit(struct thermal_mpc *m, u32 freq)
+{
+	if (!m->gpu_limit)
+		m->gpu_limit = kgsl_pwr_limits_add(KGSL_DEVICE_3D0);
+
+	/* The GPU may not have probed yet; retry on the next poll */
+	if (IS_ERR_OR_NULL(m->gpu_limit)) {
+		m->gpu_limit = NULL;
+		return;
+	}
+
+	if (freq >= m->max_freq[MPC_GPU])
+		kgsl_pwr_limits_set_default(m->gpu_limit);
+	else
+		kgsl_pwr_limits_set_freq(m->gpu_limit, freq);
+}
+#else
+static void mpc_gpu_set_limit(struct thermal_mpc *m, u32 freq)
+{
+}
+#endif
+
+/* Busy time of each CPU cluster since the previous poll, in per mille */
+static void mpc_update_busy(struct thermal_mpc *m)
+{
+	u64 idle, wall;
+	u32 cpu;
+	int d;
+
+	get_online_cpus();
+	for (d = MPC_SILVER; d < MPC_GPU; d++) {
+		idle = wall = 0;
+		for_each_cpu_and(cpu, mpc_cluster_mask(d), cpu_online_mask) {
+			u64 cpu_wall;
+
+			idle += get_cpu_idle_time(cpu, &cpu_wall, 0);
+			wall += cpu_wall;
+		}
+
+		/* CPUs going on or offline make the deltas meaningless */
+		if (wall > m->prev_wall[d] && idle >= m->prev_idle[d] &&
+		    idle - m->prev_idle[d] <= wall - m->prev_wall[d]) {
+			u64 dwall = wall - m->prev_wall[d];
+			u64 dbusy = dwall - (idle - m->prev_idle[d]);
+
+			m->busy[d] = div64_u64(dbusy * 1000, dwall);
+		}
+
+		m->prev_idle[d] = idle;
+		m->prev_wall[d] = wall;
+	}
+	put_online_cpus();
+
+	/* The GPU load is not visible here, so assume it is always busy */
+	m->busy[MPC_GPU] = m->weight[MPC_GPU] ? 1000 : 0;
+}
+
+static u32 mpc_domain_power(struct thermal_mpc *m, int d, u32 freq)
+{
+	u64 r;
+
+	if (!m->max_freq[d])
+		return 0;
+
+	r = min_t(u64, div_u64((u64)freq * 1000, m->max_freq[d]), 1000);
+	return div_u64(r * r * r, 1000000) * m->busy[d] / 1000;
+}
+
+static u32 mpc_level_freq(struct thermal_mpc *m, int d, u32 level)
+{
+	return m->min_freq[d] + (u64)(m->max_freq[d] - m->min_freq[d]) *
+		level / MPC_LEVEL_MAX;
+}
+
+/* Power in per mille with every domain at the frequency of the level */
+static u32 mpc_level_power(struct thermal_mpc *m, u32 level)
+{
+	u64 sum = 0, weights = 0;
+	int d;
+
+	for (d = 0; d < MPC_DOMAINS; d++) {
+		if (!m->max_freq[d])
+			continue;
+
+		sum += (u64)m->weight[d] *
+			mpc_domain_power(m, d, mpc_level_freq(m, d, level));
+		weights += m->weight[d];
+	}
+
+	return weights ? div64_u64(sum, weights) : 0;
+}
+
+/* Power in per mille at the frequencies the domains run at now */
+static u32 mpc_current_power(struct thermal_mpc *m)
+{
+	u64 sum = 0, weights = 0;
+	u32 freq;
+	int d;
+
+	for (d = 0; d < MPC_DOMAINS; d++) {
+		if (!m->max_freq[d])
+			continue;
+
+		if (d == MPC_GPU) {
+			freq = m->limit[d];
+		} else {
+			u32 cpu = cpumask_first_and(mpc_cluster_mask(d),
+						    cpu_online_mask);
+
+			freq = cpu < nr_cpu_ids ? cpufreq_quick_get(cpu) : 0;
+		}
+
+		sum += (u64)m->weight[d] * mpc_domain_power(m, d, freq);
+		weights += m->weight[d];
+	}
+
+	return weights ? div64_u64(sum, weights) : 0;
+}
+
+static s32 mpc_step(struct thermal_drv *t, s32 temp, u32 power)
+{
+	struct thermal_mpc *m = &t->mpc;
+	s64 target = m->ambient_mdeg + (s64)m->gain_mdeg * power / 1000;
+
+	return temp + div_s64((target - temp) * t->poll_ms, m->tau_ms) +
+		m->bias_mdeg;
+}
+
+static s32 mpc_forecast(struct thermal_drv *t, s32 temp, u32 power)
+{
+	u32 i;
+
+	for (i = 0; i < t->mpc.steps; i++)
+		temp = mpc_step(t, temp, power);
+
+	return temp;
+}
+
+/* Returns true when any CPU limit changed */
+static bool thermal_mpc_update(struct thermal_drv *t, s32 temp_mdeg)
+{
+	struct thermal_mpc *m = &t->mpc;
+	u32 lo = 0, hi = MPC_LEVEL_MAX, target, old_silver, old_gold;
+	s32 err;
+	u32 slot;
+
+	/* Sampled outside mpc_lock as it takes the hotplug lock */
+	mpc_update_busy(m);
+
+	mutex_lock(&t->mpc_lock);
+	m->power = mpc_current_power(m);
+
+	/* Learn the bias from how far off the last one-step forecast was */
+	if (m->nr_forecasts)
+		m->bias_mdeg = clamp(m->bias_mdeg +
+				     (temp_mdeg - m->next_mdeg) / 8,
+				     -MPC_MAX_BIAS_MDEG, MPC_MAX_BIAS_MDEG);
+
+	/* Score the forecast made one horizon ago against the reading */
+	slot = m->forecast_idx % m->steps;
+	if (m->nr_forecasts >= m->steps) {
+		err = abs(temp_mdeg - m->forecast[slot]);
+		m->err_avg_mdeg = m->err_avg_mdeg - (m->err_avg_mdeg >> 3) +
+				  (err >> 3);
+	}
+
+	m->temp_mdeg = temp_mdeg;
+	m->next_mdeg = mpc_step(t, temp_mdeg, m->power);
+	m->pred_mdeg = mpc_forecast(t, temp_mdeg, m->power);
+	m->forecast[slot] = m->pred_mdeg;
+	m->forecast_idx++;
+	if (m->nr_forecasts < m->steps)
+		m->nr_forecasts++;
+
+	/* Highest level whose forecast stays under the budget */
+	while (lo < hi) {
+		u32 mid = (lo + hi + 1) / 2;
+
+		if (mpc_forecast(t, temp_mdeg, mpc_level_power(m, mid)) <=
+		    m->budget_mdeg)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+	target = lo;
+
+	if (target < m->level)
+		m->level = max(target, m->level > m->step_down ?
+				       m->level - m->step_down : 0);
+	else
+		m->level = min(target, m->level + m->step_up);
+
+	old_silver = m->limit[MPC_SILVER];
+	old_gold = m->limit[MPC_GOLD];
+	m->limit[MPC_SILVER] = mpc_level_freq(m, MPC_SILVER, m->level);
+	m->limit[MPC_GOLD] = mpc_level_freq(m, MPC_GOLD, m->level);
+	if (m->max_freq[MPC_GPU]) {
+		u32 gpu_freq = mpc_level_freq(m, MPC_GPU, m->level);
+
+		if (gpu_freq != m->limit[MPC_GPU] || !m->gpu_limit)
+			mpc_gpu_set_limit(m, gpu_freq);
+		m->limit[MPC_GPU] = gpu_freq;
+	}
+	mutex_unlock(&t->mpc_lock);
+
+	return old_silver != m->limit[MPC_SILVER] ||
+	       old_gold != m->limit[MPC_GOLD];
+}
+
 static void update_online_cpu_policy(void)
 {
 	u32 cpu;
@@ -59,6 +330,7 @@ static void thermal_throttle_worker(struct work_struct *work)
 					     throttle_work);
 	struct thermal_zone *new_zone, *old_zone;
 	struct qpnp_vadc_result result;
+	bool mpc_changed = false;
 	s64 temp_deg;
 	int i, ret;
 
@@ -82,8 +354,11 @@ static void thermal_throttle_worker(struct work_struct *work)
 		}
 	}
 
+	if (t->mpc.enabled)
+		mpc_changed = thermal_mpc_update(t, temp_deg * 1000);
+
 	/* Update thermal zone if it changed */
-	if (new_zone != old_zone) {
+	if (new_zone != old_zone || mpc_changed) {
 		t->curr_zone = new_zone;
 		update_online_cpu_policy();
 	}
@@ -106,12 +381,27 @@ static int cpu_notifier_cb(struct notifier_block *nb, unsigned long val,
 	struct thermal_drv *t = container_of(nb, typeof(*t), cpu_notif);
 	struct cpufreq_policy *policy = data;
 	struct thermal_zone *zone;
+	u32 mpc_freq = UINT_MAX;
 
 	if (val != CPUFREQ_ADJUST)
 		return NOTIFY_OK;
 
 	zone = t->curr_zone;
-	
+	if (t->mpc.enabled) {
+		int d = cpumask_test_cpu(policy->cpu, cpu_lp_mask) ?
+			MPC_SILVER : MPC_GOLD;
+
+		mutex_lock(&t->mpc_lock);
+		if (!t->mpc.max_freq[d]) {
+			t->mpc.min_freq[d] = policy->cpuinfo.min_freq;
+			t->mpc.max_freq[d] = policy->cpuinfo.max_freq;
+			t->mpc.limit[d] = policy->cpuinfo.max_freq;
+		}
+		if (t->mpc.limit[d] < t->mpc.max_freq[d])
+			mpc_freq = t->mpc.limit[d];
+		mutex_unlock(&t->mpc_lock);
+	}
+
 	if (zone) {
 		u32 target_freq = get_throttle_freq(zone, policy->cpu);
 
@@ -121,12 +411,97 @@ static int cpu_notifier_cb(struct notifier_block *nb, unsigned long val,
 		policy->max = policy->user_policy.max;
 	}
 
+	/* The model's limit only ever lowers what the zones allow */
+	if (mpc_freq < policy->max)
+		policy->max = mpc_freq;
+
 	if (policy->max < policy->min)
 		policy->min = policy->max;
 
 	return NOTIFY_OK;
 }
 
+/*
+ * The predictive controller is optional and only runs when a skin budget
+ * is given; everything else has defaults.
+ */
+static void msm_thermal_simple_parse_mpc(struct device_node *node,
+					 struct thermal_drv *t)
+{
+	struct thermal_mpc *m = &t->mpc;
+	u32 horizon_ms = 3000, val;
+
+	if (of_property_read_u32(node, "qcom,mpc-budget-deg", &val))
+		return;
+
+	m->budget_mdeg = val * 1000;
+	m->ambient_mdeg = 25000;
+	m->gain_mdeg = 20000;
+	m->tau_ms = 30000;
+	m->step_down = 100;
+	m->step_up = 25;
+	m->weight[MPC_SILVER] = 1;
+	m->weight[MPC_GOLD] = 3;
+	m->weight[MPC_GPU] = 2;
+
+	if (!of_property_read_u32(node, "qcom,mpc-ambient-deg", &val))
+		m->ambient_mdeg = val * 1000;
+	if (!of_property_read_u32(node, "qcom,mpc-gain-deg", &val))
+		m->gain_mdeg = val * 1000;
+	of_property_read_u32(node, "qcom,mpc-tau-ms", &m->tau_ms);
+	of_property_read_u32(node, "qcom,mpc-horizon-ms", &horizon_ms);
+	of_property_read_u32(node, "qcom,mpc-step-down", &m->step_down);
+	of_property_read_u32(node, "qcom,mpc-step-up", &m->step_up);
+	of_property_read_u32_array(node, "qcom,mpc-weights", m->weight,
+				   MPC_DOMAINS);
+
+	/* GPU limits are only applied with a GPU frequency range given */
+	if (!of_property_read_u32(node, "qcom,mpc-gpu-min-hz", &val) &&
+	    !of_property_read_u32(node, "qcom,mpc-gpu-max-hz",
+				  &m->max_freq[MPC_GPU])) {
+		m->min_freq[MPC_GPU] = min(val, m->max_freq[MPC_GPU]);
+		m->limit[MPC_GPU] = m->max_freq[MPC_GPU];
+	} else {
+		m->weight[MPC_GPU] = 0;
+	}
+
+	m->tau_ms = max(m->tau_ms, t->poll_ms);
+	m->steps = clamp_t(u32, horizon_ms / max(t->poll_ms, 1U), 1,
+			   MPC_MAX_STEPS);
+	m->level = MPC_LEVEL_MAX;
+	m->enabled = true;
+}
+
+static ssize_t mpc_status_show(struct device *dev,
+			       struct device_attribute *attr, char *buf)
+{
+	struct thermal_drv *t = dev_get_drvdata(dev);
+	struct thermal_mpc *m = &t->mpc;
+	ssize_t len;
+
+	mutex_lock(&t->mpc_lock);
+	len = scnprintf(buf, PAGE_SIZE,
+			"actual_mdeg: %d\n"
+			"predicted_mdeg: %d\n"
+			"horizon_ms: %u\n"
+			"forecast_err_mdeg: %u\n"
+			"bias_mdeg: %d\n"
+			"budget_mdeg: %d\n"
+			"power: %u\n"
+			"level: %u\n"
+			"silver_khz: %u\n"
+			"gold_khz: %u\n"
+			"gpu_hz: %u\n",
+			m->temp_mdeg, m->pred_mdeg, m->steps * t->poll_ms,
+			m->err_avg_mdeg, m->bias_mdeg, m->budget_mdeg,
+			m->power, m->level, m->limit[MPC_SILVER],
+			m->limit[MPC_GOLD], m->limit[MPC_GPU]);
+	mutex_unlock(&t->mpc_lock);
+
+	return len;
+}
+static DEVICE_ATTR_RO(mpc_status);
+
 static int msm_thermal_simple_parse_dt(struct platform_device *pdev,
 				       struct thermal_drv *t)
 {
@@ -153,8 +528,11 @@ static int msm_thermal_simple_parse_dt(struct platform_device *pdev,
 	OF_READ_U32(node, "qcom,start-delay", t->start_delay);
 
 	/* Convert polling milliseconds to jiffies */
+	t->poll_ms = t->poll_jiffies;
 	t->poll_jiffies = msecs_to_jiffies(t->poll_jiffies);
 
+	msm_thermal_simple_parse_mpc(node, t);
+
 	/* Calculate the number of zones */
 	for_each_child_of_node(node, child)
 		t->nr_zones++;
@@ -214,10 +592,16 @@ static int msm_thermal_simple_probe(struct platform_device *pdev)
 		goto free_t;
 	}
 
+	mutex_init(&t->mpc_lock);
 	ret = msm_thermal_simple_parse_dt(pdev, t);
 	if (ret)
 		goto destroy_wq;
 
+	platform_set_drvdata(pdev, t);
+	if (t->mpc.enabled && device_create_file(&pdev->dev,
+						 &dev_attr_mpc_status))
+		pr_err("Unable to create mpc_status\n");
+
 	/* Set the priority to INT_MIN so throttling can't be tampered with */
 	t->cpu_notif.notifier_call = cpu_notifier_cb;
 	t->cpu_notif.priority = INT_MIN;
@@ -1507,6 +1507,9 @@ int __init of_parse_thermal_zones(void)
 		if (!of_property_read_u32(child, "sustainable-power", &prop))
 			tzp->sustainable_power = prop;
 
+		if (!of_property_read_u32(child, "efficiency-weight", &prop))
+			tzp->efficiency_weight = min_t(u32, prop, 100);
+
 		for (i = 0; i < tz->ntrips; i++)
 			mask |= 1 << i;
 
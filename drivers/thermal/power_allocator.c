@@ -25,6 +25,10 @@
 #include "thermal_core.h"
 
 #define INVALID_TRIP -1
+/* Marks an actor that can't report its efficiency */
+#define EFFICIENCY_UNKNOWN U32_MAX
+/* Most an actor's weight can grow by for being efficient */
+#define EFFICIENCY_MAX_BOOST 4
 
 #define FRAC_BITS 10
 #define int_to_frac(x) ((x) << FRAC_BITS)
@@ -329,13 +333,90 @@ static void divvy_up_power(u32 *req_power, u32 *max_power, int num_actors,
 					extra_power) / capped_extra_power;
 }
 
+/**
+ * power_actor_get_efficiency() - update the efficiency of a power actor
+ * @instance:	thermal instance of the power actor
+ *
+ * Ask the cooling device how much performance it would get from each
+ * extra watt and fold it into the instance's running average, so a
+ * single noisy load sample doesn't swing the allocation.
+ *
+ * Return: the smoothed efficiency or EFFICIENCY_UNKNOWN if the cooling
+ * device can't estimate it.
+ */
+static u32 power_actor_get_efficiency(struct thermal_instance *instance)
+{
+	struct thermal_cooling_device *cdev = instance->cdev;
+	u32 eff;
+
+	if (!cdev->ops->get_efficiency ||
+	    cdev->ops->get_efficiency(cdev, instance->tz, &eff))
+		return EFFICIENCY_UNKNOWN;
+
+	if (instance->efficiency)
+		eff = (3 * (u64)instance->efficiency + eff) / 4;
+	instance->efficiency = eff;
+
+	return eff;
+}
+
+/**
+ * weigh_by_efficiency() - scale weighted requests by actor efficiency
+ * @tz:		thermal zone we are operating in
+ * @efficiency:	smoothed efficiency of each actor
+ * @weighted_req_power:	weighted requested power of each actor, updated
+ * @num_actors:	number of actors in the arrays
+ *
+ * Move tzp->efficiency_weight percent of each actor's weight towards
+ * its efficiency relative to the average of the actors that report
+ * one, so the budget goes first to whoever turns it into the most
+ * performance.  Actors without an efficiency estimate keep their
+ * weight.
+ *
+ * Return: the new total weighted requested power.
+ */
+static u32 weigh_by_efficiency(struct thermal_zone_device *tz,
+			       u32 *efficiency, u32 *weighted_req_power,
+			       int num_actors)
+{
+	s32 blend = clamp(tz->tzp->efficiency_weight, 0, 100);
+	u64 total_eff = 0;
+	u32 total = 0;
+	int i, known = 0;
+
+	for (i = 0; i < num_actors; i++) {
+		if (efficiency[i] == EFFICIENCY_UNKNOWN)
+			continue;
+		total_eff += efficiency[i];
+		known++;
+	}
+
+	for (i = 0; i < num_actors; i++) {
+		s64 rel, factor;
+
+		if (efficiency[i] != EFFICIENCY_UNKNOWN && total_eff) {
+			rel = div64_u64((u64)int_to_frac(efficiency[i]) * known,
+					total_eff);
+			rel = min_t(s64, rel, int_to_frac(EFFICIENCY_MAX_BOOST));
+			factor = div_s64(int_to_frac(100 - blend) + blend * rel,
+					 100);
+			weighted_req_power[i] = mul_frac(factor,
+							 weighted_req_power[i]);
+		}
+
+		total += weighted_req_power[i];
+	}
+
+	return total;
+}
+
 static int allocate_power(struct thermal_zone_device *tz,
 			  int control_temp)
 {
 	struct thermal_instance *instance;
 	struct power_allocator_params *params = tz->governor_data;
 	u32 *req_power, *max_power, *granted_power, *extra_actor_power;
-	u32 *weighted_req_power;
+	u32 *weighted_req_power, *efficiency;
 	u32 total_req_power, max_allocatable_power, total_weighted_req_power;
 	u32 total_granted_power, power_range;
 	int i, num_actors, total_weight, ret = 0;
@@ -359,17 +440,18 @@ static int allocate_power(struct thermal_zone_device *tz,
 	}
 
 	/*
-	 * We need to allocate five arrays of the same size:
-	 * req_power, max_power, granted_power, extra_actor_power and
-	 * weighted_req_power.  They are going to be needed until this
-	 * function returns.  Allocate them all in one go to simplify
-	 * the allocation and deallocation logic.
+	 * We need to allocate six arrays of the same size:
+	 * req_power, max_power, granted_power, extra_actor_power,
+	 * weighted_req_power and efficiency.  They are going to be
+	 * needed until this function returns.  Allocate them all in one
+	 * go to simplify the allocation and deallocation logic.
 	 */
 	BUILD_BUG_ON(sizeof(*req_power) != sizeof(*max_power));
 	BUILD_BUG_ON(sizeof(*req_power) != sizeof(*granted_power));
 	BUILD_BUG_ON(sizeof(*req_power) != sizeof(*extra_actor_power));
 	BUILD_BUG_ON(sizeof(*req_power) != sizeof(*weighted_req_power));
-	req_power = kcalloc(num_actors * 5, sizeof(*req_power), GFP_KERNEL);
+	BUILD_BUG_ON(sizeof(*req_power) != sizeof(*efficiency));
+	req_power = kcalloc(num_actors * 6, sizeof(*req_power), GFP_KERNEL);
 	if (!req_power) {
 		ret = -ENOMEM;
 		goto unlock;
@@ -379,6 +461,7 @@ static int allocate_power(struct thermal_zone_device *tz,
 	granted_power = &req_power[2 * num_actors];
 	extra_actor_power = &req_power[3 * num_actors];
 	weighted_req_power = &req_power[4 * num_actors];
+	efficiency = &req_power[5 * num_actors];
 
 	i = 0;
 	total_weighted_req_power = 0;
@@ -408,6 +491,8 @@ static int allocate_power(struct thermal_zone_device *tz,
 		if (power_actor_get_max_power(cdev, tz, &max_power[i]))
 			continue;
 
+		efficiency[i] = power_actor_get_efficiency(instance);
+
 		total_req_power += req_power[i];
 		max_allocatable_power += max_power[i];
 		total_weighted_req_power += weighted_req_power[i];
@@ -415,6 +500,11 @@ static int allocate_power(struct thermal_zone_device *tz,
 		i++;
 	}
 
+	if (tz->tzp->efficiency_weight > 0)
+		total_weighted_req_power =
+			weigh_by_efficiency(tz, efficiency,
+					    weighted_req_power, i);
+
 	power_range = pid_controller(tz, control_temp, max_allocatable_power);
 
 	divvy_up_power(weighted_req_power, max_power, num_actors,
@@ -56,6 +56,7 @@ struct thermal_instance {
 	struct list_head tz_node; /* node in tz->thermal_instances */
 	struct list_head cdev_node; /* node in cdev->thermal_instances */
 	unsigned int weight; /* The weight of the cooling device */
+	u32 efficiency; /* Smoothed efficiency, used by power_allocator */
 };
 
 #define to_thermal_zone(_dev) \
@@ -467,6 +467,7 @@ create_s32_tzp_attr(k_pu);
 create_s32_tzp_attr(k_i);
 create_s32_tzp_attr(k_d);
 create_s32_tzp_attr(integral_cutoff);
+create_s32_tzp_attr(efficiency_weight);
 create_s32_tzp_attr(slope);
 create_s32_tzp_attr(offset);
 #undef create_s32_tzp_attr
@@ -508,6 +509,7 @@ static struct attribute *thermal_zone_dev_attrs[] = {
 	&dev_attr_k_i.attr,
 	&dev_attr_k_d.attr,
 	&dev_attr_integral_cutoff.attr,
+	&dev_attr_efficiency_weight.attr,
 	&dev_attr_slope.attr,
 	&dev_attr_offset.attr,
 	NULL,
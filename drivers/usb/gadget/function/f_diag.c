@@ -194,6 +194,8 @@ struct diag_context {
 	unsigned long dpkts_tolaptop;
 	unsigned long dpkts_tomodem;
 	unsigned int dpkts_tolaptop_pending;
+	unsigned long dpkts_tolaptop_dropped;
+	unsigned long dbytes_tolaptop_dropped;
 
 	/* A list node inside the diag_dev_list */
 	struct list_head list_item;
@@ -593,8 +595,13 @@ int usb_diag_write(struct usb_diag_ch *ch, struct diag_request *d_req)
 	in = ctxt->in;
 
 	if (list_empty(&ctxt->write_pool)) {
+		ctxt->dpkts_tolaptop_dropped++;
+		ctxt->dbytes_tolaptop_dropped += d_req->length;
 		spin_unlock_irqrestore(&ctxt->lock, flags);
-		ERROR(ctxt->cdev, "%s: no requests available\n", __func__);
+		/* logging floods the pool, don't add a message per packet */
+		if (__ratelimit(&rl))
+			ERROR(ctxt->cdev, "%s: no requests available\n",
+								__func__);
 		return -EAGAIN;
 	}
 
@@ -620,6 +627,8 @@ int usb_diag_write(struct usb_diag_ch *ch, struct diag_request *d_req)
 		spin_lock_irqsave(&ctxt->lock, flags);
 		list_add_tail(&req->list, &ctxt->write_pool);
 		ctxt->dpkts_tolaptop_pending--;
+		ctxt->dpkts_tolaptop_dropped++;
+		ctxt->dbytes_tolaptop_dropped += d_req->length;
 		/* 1 error message for every 10 sec */
 		if (__ratelimit(&rl))
 			ERROR(ctxt->cdev, "%s: cannot queue read request\n",
@@ -888,12 +897,16 @@ static ssize_t debug_read_stats(struct file *file, char __user *ubuf,
 					"endpoints: %s, %s\n"
 					"dpkts_tolaptop: %lu\n"
 					"dpkts_tomodem:  %lu\n"
-					"pkts_tolaptop_pending: %u\n",
+					"pkts_tolaptop_pending: %u\n"
+					"dpkts_tolaptop_dropped: %lu\n"
+					"dbytes_tolaptop_dropped: %lu\n",
 					ch->name,
 					ctxt->in->name, ctxt->out->name,
 					ctxt->dpkts_tolaptop,
 					ctxt->dpkts_tomodem,
-					ctxt->dpkts_tolaptop_pending);
+					ctxt->dpkts_tolaptop_pending,
+					ctxt->dpkts_tolaptop_dropped,
+					ctxt->dbytes_tolaptop_dropped);
 			spin_unlock_irqrestore(&ctxt->lock, flags);
 		}
 	}
@@ -915,6 +928,8 @@ static ssize_t debug_reset_stats(struct file *file, const char __user *buf,
 			ctxt->dpkts_tolaptop = 0;
 			ctxt->dpkts_tomodem = 0;
 			ctxt->dpkts_tolaptop_pending = 0;
+			ctxt->dpkts_tolaptop_dropped = 0;
+			ctxt->dbytes_tolaptop_dropped = 0;
 			spin_unlock_irqrestore(&ctxt->lock, flags);
 		}
 	}
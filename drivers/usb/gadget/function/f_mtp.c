@@ -74,7 +74,8 @@
 
 /* number of tx and rx requests to allocate */
 #define MTP_TX_REQ_MAX 8
-#define RX_REQ_MAX 2
+#define RX_REQ_MAX 8
+#define MTP_RX_REQS 4
 #define INTR_REQ_MAX 5
 
 /* ID for Microsoft MTP OS String */
@@ -102,8 +103,18 @@ module_param(mtp_tx_req_len, uint, 0644);
 unsigned int mtp_tx_reqs = MTP_TX_REQ_MAX;
 module_param(mtp_tx_reqs, uint, 0644);
 
+/* RX requests kept queued while receiving a file, 2 to RX_REQ_MAX */
+unsigned int mtp_rx_reqs = MTP_RX_REQS;
+module_param(mtp_rx_reqs, uint, 0644);
+
 static const char mtp_shortname[] = DRIVER_NAME "_usb";
 
+struct mtp_xfer_stats {
+	u64 bytes;
+	u64 time_us;
+	unsigned int files;
+};
+
 struct mtp_dev {
 	struct usb_function function;
 	struct usb_composite_dev *cdev;
@@ -126,6 +137,8 @@ struct mtp_dev {
 	wait_queue_head_t read_wq;
 	wait_queue_head_t write_wq;
 	struct usb_request *rx_req[RX_REQ_MAX];
+	int nr_rx_reqs;
+	/* RX requests completed, they complete in the order queued */
 	int rx_done;
 
 	/* for processing MTP_SEND_FILE, MTP_RECEIVE_FILE and
@@ -141,6 +154,9 @@ struct mtp_dev {
 	uint16_t xfer_command;
 	uint32_t xfer_transaction_id;
 	int xfer_result;
+	int64_t xfer_bytes;
+	/* send and receive throughput, since the stats were last reset */
+	struct mtp_xfer_stats xfer_stats[2];
 	struct {
 		unsigned long vfs_rbytes;
 		unsigned long vfs_wbytes;
@@ -484,8 +500,10 @@ static void mtp_complete_out(struct usb_ep *ep, struct usb_request *req)
 {
 	struct mtp_dev *dev = _mtp_dev;
 
-	dev->rx_done = 1;
-	if (req->status != 0 && dev->state != STATE_OFFLINE)
+	dev->rx_done++;
+	/* requests dequeued at the end of a transfer aren't errors */
+	if (req->status != 0 && req->status != -ECONNRESET &&
+	    dev->state != STATE_OFFLINE)
 		dev->state = STATE_ERROR;
 
 	wake_up(&dev->read_wq);
@@ -566,8 +584,9 @@ static int mtp_create_bulk_endpoints(struct mtp_dev *dev,
 	if (mtp_rx_req_len % 1024)
 		mtp_rx_req_len = MTP_BULK_BUFFER_SIZE;
 
+	dev->nr_rx_reqs = clamp_t(unsigned int, mtp_rx_reqs, 2, RX_REQ_MAX);
 retry_rx_alloc:
-	for (i = 0; i < RX_REQ_MAX; i++) {
+	for (i = 0; i < dev->nr_rx_reqs; i++) {
 		req = mtp_request_new(dev->ep_out, mtp_rx_req_len);
 		if (!req) {
 			if (mtp_rx_req_len <= MTP_BULK_BUFFER_SIZE)
@@ -801,6 +820,22 @@ static ssize_t mtp_write(struct file *fp, const char __user *buf,
 	return r;
 }
 
+/*
+ * The file is read a request at a time, keep the readahead window ahead
+ * of the TX requests in flight so that vfs_read() finds the data in the
+ * page cache, as POSIX_FADV_SEQUENTIAL would.
+ */
+static void mtp_file_readahead(struct file *filp)
+{
+	unsigned long ra_pages;
+
+	ra_pages = (unsigned long)mtp_tx_req_len * 2 >> PAGE_SHIFT;
+	spin_lock(&filp->f_lock);
+	filp->f_mode &= ~FMODE_RANDOM;
+	filp->f_ra.ra_pages = max(filp->f_ra.ra_pages, ra_pages);
+	spin_unlock(&filp->f_lock);
+}
+
 /* read from a local file and write to USB */
 static void send_file_work(struct work_struct *data)
 {
@@ -821,8 +856,10 @@ static void send_file_work(struct work_struct *data)
 	filp = dev->xfer_file;
 	offset = dev->xfer_file_offset;
 	count = dev->xfer_file_length;
+	dev->xfer_bytes = 0;
 
 	mtp_log("(%lld %lld)\n", offset, count);
+	mtp_file_readahead(filp);
 
 	if (dev->xfer_send_header) {
 		hdr_size = sizeof(struct mtp_data_header);
@@ -903,6 +940,7 @@ static void send_file_work(struct work_struct *data)
 		}
 
 		count -= xfer;
+		dev->xfer_bytes += xfer;
 
 		/* zero this so we don't try to free it on error exit */
 		req = 0;
@@ -917,16 +955,32 @@ static void send_file_work(struct work_struct *data)
 	smp_wmb();
 }
 
-/* read from USB and write to a local file */
+/* Dequeue the RX requests still in flight, oldest first */
+static void mtp_rx_dequeue(struct mtp_dev *dev, int head, int in_flight)
+{
+	while (in_flight--) {
+		usb_ep_dequeue(dev->ep_out, dev->rx_req[head]);
+		head = (head + 1) % dev->nr_rx_reqs;
+	}
+}
+
+/*
+ * read from USB and write to a local file
+ *
+ * Up to nr_rx_reqs requests are kept queued on ep_out, so the host keeps
+ * sending while the data of the oldest one is written to the file. The
+ * requests still queued when a short packet ends the transfer are taken
+ * back, the host sends nothing more before our response.
+ */
 static void receive_file_work(struct work_struct *data)
 {
 	struct mtp_dev *dev = container_of(data, struct mtp_dev,
 						receive_file_work);
-	struct usb_request *read_req = NULL, *write_req = NULL;
+	struct usb_request *req;
 	struct file *filp;
 	loff_t offset;
-	int64_t count;
-	int ret, cur_buf = 0;
+	int64_t count, queued = 0;
+	int ret, head = 0, tail = 0, in_flight = 0, completed = 0;
 	int r = 0;
 	ktime_t start_time;
 
@@ -935,98 +989,107 @@ static void receive_file_work(struct work_struct *data)
 	filp = dev->xfer_file;
 	offset = dev->xfer_file_offset;
 	count = dev->xfer_file_length;
+	dev->xfer_bytes = 0;
 
 	mtp_log("(%lld)\n", count);
 	if (!IS_ALIGNED(count, dev->ep_out->maxpacket))
 		mtp_log("- count(%lld) not multiple of mtu(%d)\n",
 						count, dev->ep_out->maxpacket);
+
 	mutex_lock(&dev->read_mutex);
 	if (dev->state == STATE_OFFLINE) {
 		r = -EIO;
 		goto fail;
 	}
-	while (count > 0 || write_req) {
-		if (count > 0) {
-			/* queue a request */
-			read_req = dev->rx_req[cur_buf];
-			cur_buf = (cur_buf + 1) % RX_REQ_MAX;
-
+	dev->rx_done = 0;
+	while (count > 0 || in_flight) {
+		/* keep the requests queued up to the end of the file */
+		while (in_flight < dev->nr_rx_reqs && queued < count) {
+			req = dev->rx_req[tail];
 			/* some h/w expects size to be aligned to ep's MTU */
-			read_req->length = mtp_rx_req_len;
+			req->length = mtp_rx_req_len;
 
-			dev->rx_done = 0;
-			ret = usb_ep_queue(dev->ep_out, read_req, GFP_KERNEL);
+			ret = usb_ep_queue(dev->ep_out, req, GFP_KERNEL);
 			if (ret < 0) {
 				r = -EIO;
 				if (dev->state != STATE_OFFLINE)
 					dev->state = STATE_ERROR;
-				break;
+				goto dequeue;
 			}
+			tail = (tail + 1) % dev->nr_rx_reqs;
+			in_flight++;
+			if (count != 0xFFFFFFFF)
+				queued += mtp_rx_req_len;
 		}
 
-		if (write_req) {
-			mtp_log("rx %pK %d\n", write_req, write_req->actual);
-			start_time = ktime_get();
-			ret = vfs_write(filp, write_req->buf, write_req->actual,
-				&offset);
-			mtp_log("vfs_write %d\n", ret);
-			if (ret != write_req->actual) {
+		/* wait for the oldest read to complete */
+		req = dev->rx_req[head];
+		ret = wait_event_interruptible(dev->read_wq,
+			READ_ONCE(dev->rx_done) != completed ||
+			dev->state != STATE_BUSY);
+		if (dev->state == STATE_CANCELED
+				|| dev->state == STATE_OFFLINE) {
+			if (dev->state == STATE_OFFLINE)
 				r = -EIO;
-				if (dev->state != STATE_OFFLINE)
-					dev->state = STATE_ERROR;
-				if (read_req && !dev->rx_done)
-					usb_ep_dequeue(dev->ep_out, read_req);
-				break;
-			}
-			dev->perf[dev->dbg_write_index].vfs_wtime =
-				ktime_to_us(ktime_sub(ktime_get(), start_time));
-			dev->perf[dev->dbg_write_index].vfs_wbytes = ret;
-			dev->dbg_write_index =
-				(dev->dbg_write_index + 1) % MAX_ITERATION;
-			write_req = NULL;
+			else
+				r = -ECANCELED;
+			goto dequeue;
+		}
+		if (READ_ONCE(dev->rx_done) == completed) {
+			r = ret ? ret : -EIO;
+			goto dequeue;
+		}
+		completed++;
+		head = (head + 1) % dev->nr_rx_reqs;
+		in_flight--;
+		if (req->status) {
+			r = req->status;
+			goto dequeue;
 		}
 
-		if (read_req) {
-			/* wait for our last read to complete */
-			ret = wait_event_interruptible(dev->read_wq,
-				dev->rx_done || dev->state != STATE_BUSY);
-			if (dev->state == STATE_CANCELED
-					|| dev->state == STATE_OFFLINE) {
-				if (dev->state == STATE_OFFLINE)
-					r = -EIO;
-				else
-					r = -ECANCELED;
-				if (!dev->rx_done)
-					usb_ep_dequeue(dev->ep_out, read_req);
-				break;
-			}
-			if (read_req->status) {
-				r = read_req->status;
-				break;
-			}
-
-			/* Check if we aligned the size due to MTU constraint */
-			if (count < read_req->length)
-				read_req->actual = (read_req->actual > count ?
-						count : read_req->actual);
-			/* if xfer_file_length is 0xFFFFFFFF, then we read until
-			 * we get a zero length packet
+		/* Check if we aligned the size due to MTU constraint */
+		if (count < req->length)
+			req->actual = (req->actual > count ?
+					count : req->actual);
+		/* if xfer_file_length is 0xFFFFFFFF, then we read until
+		 * we get a zero length packet
+		 */
+		if (count != 0xFFFFFFFF) {
+			count -= req->actual;
+			queued -= req->length;
+		}
+		if (req->actual < req->length) {
+			/*
+			 * short packet is used to signal EOF for
+			 * sizes > 4 gig
 			 */
-			if (count != 0xFFFFFFFF)
-				count -= read_req->actual;
-			if (read_req->actual < read_req->length) {
-				/*
-				 * short packet is used to signal EOF for
-				 * sizes > 4 gig
-				 */
-				mtp_log("got short packet\n");
-				count = 0;
-			}
+			mtp_log("got short packet\n");
+			count = 0;
+			mtp_rx_dequeue(dev, head, in_flight);
+			in_flight = 0;
+		}
 
-			write_req = read_req;
-			read_req = NULL;
+		mtp_log("rx %pK %d\n", req, req->actual);
+		start_time = ktime_get();
+		ret = vfs_write(filp, req->buf, req->actual, &offset);
+		mtp_log("vfs_write %d\n", ret);
+		if (ret != req->actual) {
+			r = -EIO;
+			if (dev->state != STATE_OFFLINE)
+				dev->state = STATE_ERROR;
+			goto dequeue;
 		}
+		dev->perf[dev->dbg_write_index].vfs_wtime =
+			ktime_to_us(ktime_sub(ktime_get(), start_time));
+		dev->perf[dev->dbg_write_index].vfs_wbytes = ret;
+		dev->dbg_write_index =
+			(dev->dbg_write_index + 1) % MAX_ITERATION;
+		dev->xfer_bytes += ret;
 	}
+	goto fail;
+
+dequeue:
+	mtp_rx_dequeue(dev, head, in_flight);
 fail:
 	mutex_unlock(&dev->read_mutex);
 	mtp_log("returning %d\n", r);
@@ -1071,6 +1134,8 @@ static long mtp_send_receive_ioctl(struct file *fp, unsigned int code,
 	struct mtp_dev *dev = fp->private_data;
 	struct file *filp = NULL;
 	struct work_struct *work;
+	struct mtp_xfer_stats *stats;
+	ktime_t start_time;
 	int ret = -EINVAL;
 
 	mtp_log("entering ioctl with state: %d\n", dev->state);
@@ -1125,6 +1190,7 @@ static long mtp_send_receive_ioctl(struct file *fp, unsigned int code,
 	 * in kernel context, which is necessary for vfs_read and
 	 * vfs_write to use our buffers in the kernel address space.
 	 */
+	start_time = ktime_get();
 	queue_work(dev->wq, work);
 	/* wait for operation to complete */
 	flush_workqueue(dev->wq);
@@ -1134,6 +1200,13 @@ static long mtp_send_receive_ioctl(struct file *fp, unsigned int code,
 	smp_rmb();
 	ret = dev->xfer_result;
 
+	stats = &dev->xfer_stats[work == &dev->receive_file_work];
+	spin_lock_irq(&dev->lock);
+	stats->bytes += dev->xfer_bytes;
+	stats->time_us += ktime_us_delta(ktime_get(), start_time);
+	stats->files++;
+	spin_unlock_irq(&dev->lock);
+
 fail:
 	spin_lock_irq(&dev->lock);
 	if (dev->state == STATE_CANCELED)
@@ -1482,8 +1555,10 @@ mtp_function_unbind(struct usb_configuration *c, struct usb_function *f)
 	mutex_lock(&dev->read_mutex);
 	while ((req = mtp_req_get(dev, &dev->tx_idle)))
 		mtp_request_free(req, dev->ep_in);
-	for (i = 0; i < RX_REQ_MAX; i++)
+	for (i = 0; i < dev->nr_rx_reqs; i++) {
 		mtp_request_free(dev->rx_req[i], dev->ep_out);
+		dev->rx_req[i] = NULL;
+	}
 	while ((req = mtp_req_get(dev, &dev->intr_idle)))
 		mtp_request_free(req, dev->ep_intr);
 	spin_lock_irq(&dev->lock);
@@ -1609,6 +1684,17 @@ static int debug_mtp_read_stats(struct seq_file *s, void *unused)
 
 	seq_printf(s, "vfs_read(time in usec) min:%d\t max:%d\t avg:%d\n",
 				min, max, (iteration ? (sum / iteration) : 0));
+
+	seq_puts(s, "\n=======================\n");
+	seq_puts(s, "MTP Throughput:\n");
+	seq_puts(s, "\n=======================\n");
+	for (i = 0; i < 2; i++)
+		seq_printf(s, "%s: files:%u\t bytes:%llu\t KB/s:%llu\n",
+			i ? "receive" : "send", dev->xfer_stats[i].files,
+			dev->xfer_stats[i].bytes,
+			dev->xfer_stats[i].time_us ?
+			div64_u64(dev->xfer_stats[i].bytes * 1000,
+				  dev->xfer_stats[i].time_us) : 0);
 	spin_unlock_irqrestore(&dev->lock, flags);
 	return 0;
 }
@@ -1634,6 +1720,7 @@ static ssize_t debug_mtp_reset_stats(struct file *file, const char __user *buf,
 	memset(&dev->perf[0], 0, MAX_ITERATION * sizeof(dev->perf[0]));
 	dev->dbg_read_index = 0;
 	dev->dbg_write_index = 0;
+	memset(dev->xfer_stats, 0, sizeof(dev->xfer_stats));
 	spin_unlock_irqrestore(&dev->lock, flags);
 done:
 	return count;
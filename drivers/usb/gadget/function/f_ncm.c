@@ -110,22 +110,27 @@ static inline unsigned ncm_bitrate(struct usb_gadget *g)
  * We cannot group frames so use just the minimal size which ok to put
  * one max-size ethernet frame.
  * If the host can group frames, allow it to do that, 16K is selected,
- * because it's used by default by the current linux host driver
+ * because it's used by default by the current linux host driver.
+ * Up to 32K is offered for IN, which the host picks with
+ * SET_NTB_INPUT_SIZE; it still fits the 16 bit NTB block length.
  */
 #define NTB_DEFAULT_IN_SIZE	16384
+#define NTB_MAX_IN_SIZE		32768
 #define NTB_OUT_SIZE		16384
 
-/* Allocation for storing the NDP, 32 should suffice for a
- * 16k packet. This allows a maximum of 32 * 507 Byte packets to
- * be transmitted in a single 16kB skb, though when sending full size
+/* Allocation for storing the NDP, 64 should suffice for a
+ * 32k packet. This allows a maximum of 64 * 507 Byte packets to
+ * be transmitted in a single 32kB skb, though when sending full size
  * packets this limit will be plenty.
  * Smaller packets are not likely to be trying to maximize the
  * throughput and will be mstly sending smaller infrequent frames.
  */
-#define TX_MAX_NUM_DPE		32
+#define TX_MAX_NUM_DPE		64
 
 /* Delay for the transmit to wait before sending an unfilled NTB frame. */
-#define TX_TIMEOUT_NSECS	300000
+static unsigned int ncm_tx_timeout_us = 300;
+module_param(ncm_tx_timeout_us, uint, 0644);
+MODULE_PARM_DESC(ncm_tx_timeout_us, "Delay before sending an unfilled NTB");
 
 #define FORMATS_SUPPORTED	(USB_CDC_NCM_NTB16_SUPPORTED |	\
 				 USB_CDC_NCM_NTB32_SUPPORTED)
@@ -133,7 +138,7 @@ static inline unsigned ncm_bitrate(struct usb_gadget *g)
 static struct usb_cdc_ncm_ntb_parameters ntb_parameters = {
 	.wLength = cpu_to_le16(sizeof(ntb_parameters)),
 	.bmNtbFormatsSupported = cpu_to_le16(FORMATS_SUPPORTED),
-	.dwNtbInMaxSize = cpu_to_le32(NTB_DEFAULT_IN_SIZE),
+	.dwNtbInMaxSize = cpu_to_le32(NTB_MAX_IN_SIZE),
 	.wNdpInDivisor = cpu_to_le16(4),
 	.wNdpInPayloadRemainder = cpu_to_le16(0),
 	.wNdpInAlignment = cpu_to_le16(4),
@@ -1092,7 +1097,7 @@ static struct sk_buff *ncm_wrap_ntb(struct gether *port,
 
 			/* Allocate an skb for storing the NDP,
 			 * TX_MAX_NUM_DPE should easily suffice for a
-			 * 16k packet.
+			 * 32k packet.
 			 */
 			ncm->skb_tx_ndp = alloc_skb((int)(opts->ndp_size
 						    + opts->dpe_size
@@ -1115,7 +1120,8 @@ static struct sk_buff *ncm_wrap_ntb(struct gether *port,
 		}
 
 		/* Delay the timer. */
-		hrtimer_start(&ncm->task_timer, TX_TIMEOUT_NSECS,
+		hrtimer_start(&ncm->task_timer,
+			      ns_to_ktime(ncm_tx_timeout_us * NSEC_PER_USEC),
 			      HRTIMER_MODE_REL);
 
 		/* Add the datagram position entries */
@@ -25,6 +25,7 @@
 #include <linux/msm_rmnet.h>
 #include <linux/debugfs.h>
 #include <linux/seq_file.h>
+#include <net/gro_cells.h>
 
 #include "u_ether.h"
 
@@ -82,6 +83,7 @@ struct eth_dev {
 	u32			tx_req_bufsize;
 
 	struct sk_buff_head	rx_frames;
+	struct gro_cells	gro_cells;
 
 	unsigned		qmult;
 
@@ -109,6 +111,11 @@ struct eth_dev {
 	unsigned long		rx_throttle;
 	unsigned int		tx_pkts_rcvd;
 	unsigned long		skb_expand_cnt;
+	/* packets and USB transfers, for the aggregation factor */
+	unsigned long		tx_aggr_pkts;
+	unsigned long		tx_aggr_xfers;
+	unsigned long		rx_aggr_pkts;
+	unsigned long		rx_aggr_xfers;
 	struct dentry		*uether_dent;
 	struct dentry		*uether_dfile;
 };
@@ -340,6 +347,7 @@ static void rx_complete(struct usb_ep *ep, struct usb_request *req)
 	/* normal completion */
 	case 0:
 		skb_put(skb, req->actual);
+		dev->rx_aggr_xfers++;
 
 		if (dev->unwrap) {
 			unsigned long	flags;
@@ -571,8 +579,14 @@ static void process_rx_w(struct work_struct *work)
 
 		dev->net->stats.rx_packets++;
 		dev->net->stats.rx_bytes += skb->len;
+		dev->rx_aggr_pkts++;
 
-		status = netif_rx_ni(skb);
+		/* GRO merges the frames of an aggregated transfer, it is
+		 * switched off with ethtool when it isn't wanted.
+		 */
+		local_bh_disable();
+		status = gro_cells_receive(&dev->gro_cells, skb);
+		local_bh_enable();
 	}
 
 	if (netif_running(dev->net))
@@ -830,6 +844,8 @@ static netdev_tx_t eth_start_xmit(struct sk_buff *skb,
 	}
 
 	dev->tx_pkts_rcvd++;
+	if (skb)
+		dev->tx_aggr_pkts++;
 
 	/* Allocate memory for tx_reqs to support multi packet transfer */
 	spin_lock_irqsave(&dev->req_lock, flags);
@@ -1004,6 +1020,7 @@ static netdev_tx_t eth_start_xmit(struct sk_buff *skb,
 		break;
 	case 0:
 		netif_trans_update(net);
+		dev->tx_aggr_xfers++;
 	}
 
 	if (retval) {
@@ -1357,6 +1374,7 @@ struct eth_dev *gether_setup_name(struct usb_gadget *g,
 
 	/* network device setup */
 	dev->net = net;
+	gro_cells_init(&dev->gro_cells, net);
 	dev->qmult = qmult;
 	snprintf(net->name, sizeof(net->name), "%s%%d", netname);
 
@@ -1389,6 +1407,7 @@ struct eth_dev *gether_setup_name(struct usb_gadget *g,
 	status = register_netdev(net);
 	if (status < 0) {
 		dev_dbg(&g->dev, "register_netdev failed, %d\n", status);
+		gro_cells_destroy(&dev->gro_cells);
 		free_netdev(net);
 		dev = ERR_PTR(status);
 	} else {
@@ -1432,6 +1451,7 @@ struct net_device *gether_setup_name_default(const char *netname)
 
 	/* network device setup */
 	dev->net = net;
+	gro_cells_init(&dev->gro_cells, net);
 	dev->qmult = QMULT_DEFAULT;
 	snprintf(net->name, sizeof(net->name), "%s%%d", netname);
 
@@ -1623,6 +1643,7 @@ void gether_cleanup(struct eth_dev *dev)
 	unregister_netdev(dev->net);
 	flush_work(&dev->work);
 	cancel_work_sync(&dev->rx_work);
+	gro_cells_destroy(&dev->gro_cells);
 	free_netdev(dev->net);
 }
 EXPORT_SYMBOL_GPL(gether_cleanup);
@@ -1822,6 +1843,12 @@ void gether_disconnect(struct gether *link)
 }
 EXPORT_SYMBOL_GPL(gether_disconnect);
 
+static unsigned long uether_aggr_factor(unsigned long pkts,
+					unsigned long xfers, unsigned int scale)
+{
+	return xfers ? pkts * scale / xfers : 0;
+}
+
 static int uether_stat_show(struct seq_file *s, void *unused)
 {
 	struct eth_dev *dev = s->private;
@@ -1833,6 +1860,18 @@ static int uether_stat_show(struct seq_file *s, void *unused)
 		seq_printf(s, "rx_throttle = %lu\n", dev->rx_throttle);
 		seq_printf(s, "skb_expand_cnt = %lu\n",
 					dev->skb_expand_cnt);
+		seq_printf(s, "tx_aggr = %lu pkts in %lu xfers (%lu.%02lu)\n",
+			   dev->tx_aggr_pkts, dev->tx_aggr_xfers,
+			   uether_aggr_factor(dev->tx_aggr_pkts,
+					      dev->tx_aggr_xfers, 1),
+			   uether_aggr_factor(dev->tx_aggr_pkts,
+					      dev->tx_aggr_xfers, 100) % 100);
+		seq_printf(s, "rx_aggr = %lu pkts in %lu xfers (%lu.%02lu)\n",
+			   dev->rx_aggr_pkts, dev->rx_aggr_xfers,
+			   uether_aggr_factor(dev->rx_aggr_pkts,
+					      dev->rx_aggr_xfers, 1),
+			   uether_aggr_factor(dev->rx_aggr_pkts,
+					      dev->rx_aggr_xfers, 100) % 100);
 	}
 	return ret;
 }
@@ -1854,6 +1893,10 @@ static ssize_t uether_stat_reset(struct file *file,
 	dev->tx_throttle = 0;
 	dev->rx_throttle = 0;
 	dev->skb_expand_cnt = 0;
+	dev->tx_aggr_pkts = 0;
+	dev->tx_aggr_xfers = 0;
+	dev->rx_aggr_pkts = 0;
+	dev->rx_aggr_xfers = 0;
 	spin_unlock_irqrestore(&dev->lock, flags);
 	return count;
 }
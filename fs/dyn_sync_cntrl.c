@@ -5,6 +5,12 @@
  * 
  * All credits for original implemenation to faux123
  * 
+ * While the screen is on, fsyncs are deferred by policy instead of being
+ * dropped: files in one of the defer_dirs directories, or opened by one of
+ * the defer_uids, are queued, unless their name ends with one of the
+ * keep_suffixes. The queue is synced in one batch at most max_delay_ms
+ * after its first entry, as soon as max_queued files are waiting, and on
+ * screen off, reboot or when dynamic fsync gets disabled.
  */
 
 #include <linux/module.h>
@@ -14,6 +20,14 @@
 #include <linux/notifier.h>
 #include <linux/reboot.h>
 #include <linux/writeback.h>
+#include <linux/fs.h>
+#include <linux/file.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/rcupdate.h>
+#include <linux/workqueue.h>
+#include <linux/cred.h>
+#include <linux/sched.h>
 #include <linux/dyn_sync_cntrl.h>
 #include <linux/lcd_notify.h>
 
@@ -30,16 +44,341 @@ static struct notifier_block lcd_notif;
 
 extern void sync_filesystems(int wait);
 
+struct dyn_fsync_names {
+	unsigned int nr;
+	char name[DYN_FSYNC_MAX_ENTRIES][DYN_FSYNC_NAME_LEN];
+};
+
+struct dyn_fsync_policy {
+	struct rcu_head rcu;
+	struct dyn_fsync_names defer_dirs;
+	struct dyn_fsync_names keep_suffixes;
+	unsigned int nr_uids;
+	uid_t uids[DYN_FSYNC_MAX_ENTRIES];
+};
+
+struct dyn_fsync_entry {
+	struct list_head list;
+	struct file *file;
+	int datasync;
+};
+
+static struct dyn_fsync_policy dyn_fsync_default_policy = {
+	.defer_dirs = {
+		.nr = 2,
+		.name = { "cache", "code_cache" },
+	},
+	.keep_suffixes = {
+		.nr = 4,
+		.name = { ".db", "-journal", "-wal", ".xml" },
+	},
+};
+
+static struct dyn_fsync_policy __rcu *dyn_fsync_policy =
+	RCU_INITIALIZER(&dyn_fsync_default_policy);
+
+// policy_mutex serializes policy updates
+static DEFINE_MUTEX(policy_mutex);
+
+static unsigned int dyn_fsync_max_delay_ms = DYN_FSYNC_MAX_DELAY_MS;
+static unsigned int dyn_fsync_max_queued = DYN_FSYNC_MAX_QUEUED;
+
+// queue_lock protects the deferred queue and nr_queued
+static DEFINE_SPINLOCK(queue_lock);
+static LIST_HEAD(dyn_fsync_queue);
+static unsigned int nr_queued;
+
+// flush_mutex serializes syncing of the deferred queue
+static DEFINE_MUTEX(flush_mutex);
+
+static atomic_long_t nr_deferred = ATOMIC_LONG_INIT(0);
+static atomic_long_t nr_merged = ATOMIC_LONG_INIT(0);
+static atomic_long_t nr_flushed = ATOMIC_LONG_INIT(0);
+static atomic_long_t nr_batches = ATOMIC_LONG_INIT(0);
+
+static void dyn_fsync_work_fn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(dyn_fsync_work, dyn_fsync_work_fn);
+
 
 // Functions
 
-static void dyn_fsync_force_flush(void)
+static void dyn_fsync_flush_queue(void)
+{
+	struct dyn_fsync_entry *e, *n;
+	LIST_HEAD(batch);
+
+	mutex_lock(&flush_mutex);
+
+	spin_lock(&queue_lock);
+	list_splice_init(&dyn_fsync_queue, &batch);
+	nr_queued = 0;
+	spin_unlock(&queue_lock);
+
+	if (!list_empty(&batch))
+		atomic_long_inc(&nr_batches);
+
+	// runs in a kernel thread, so vfs_fsync() won't defer again
+	list_for_each_entry_safe(e, n, &batch, list) {
+		vfs_fsync(e->file, e->datasync);
+		fput(e->file);
+		kfree(e);
+		atomic_long_inc(&nr_flushed);
+	}
+
+	mutex_unlock(&flush_mutex);
+}
+
+
+static void dyn_fsync_work_fn(struct work_struct *work)
+{
+	dyn_fsync_flush_queue();
+}
+
+
+// sync the deferred queue now, from any task
+static void dyn_fsync_flush_deferred(void)
+{
+	mod_delayed_work(system_unbound_wq, &dyn_fsync_work, 0);
+	flush_delayed_work(&dyn_fsync_work);
+}
+
+
+static void dyn_fsync_sync_filesystems(void)
 {
 	sync_filesystems(0);
 	sync_filesystems(1);
 }
 
 
+static void dyn_fsync_force_flush(void)
+{
+	dyn_fsync_flush_deferred();
+	dyn_fsync_sync_filesystems();
+}
+
+
+static bool dyn_fsync_name_in(const struct dyn_fsync_names *names,
+		const char *name)
+{
+	unsigned int i;
+
+	for (i = 0; i < names->nr; i++)
+		if (!strcmp(names->name[i], name))
+			return true;
+
+	return false;
+}
+
+
+static bool dyn_fsync_suffix_in(const struct dyn_fsync_names *names,
+		const char *name)
+{
+	size_t len = strlen(name), slen;
+	unsigned int i;
+
+	for (i = 0; i < names->nr; i++) {
+		slen = strlen(names->name[i]);
+		if (slen <= len && !strcmp(name + len - slen, names->name[i]))
+			return true;
+	}
+
+	return false;
+}
+
+
+static bool dyn_fsync_uid_in(const struct dyn_fsync_policy *policy, uid_t uid)
+{
+	unsigned int i;
+
+	for (i = 0; i < policy->nr_uids; i++)
+		if (policy->uids[i] == uid)
+			return true;
+
+	return false;
+}
+
+
+// called under rcu_read_lock(), names may change under us on rename
+static bool dyn_fsync_should_defer(const struct dyn_fsync_policy *policy,
+		struct dentry *dentry)
+{
+	int depth;
+
+	if (dyn_fsync_suffix_in(&policy->keep_suffixes,
+			(const char *)READ_ONCE(dentry->d_name.name)))
+		return false;
+
+	if (dyn_fsync_uid_in(policy, from_kuid(&init_user_ns, current_uid())))
+		return true;
+
+	for (depth = 0; depth < DYN_FSYNC_MAX_DEPTH && !IS_ROOT(dentry);
+			depth++) {
+		dentry = READ_ONCE(dentry->d_parent);
+		if (dyn_fsync_name_in(&policy->defer_dirs,
+				(const char *)READ_ONCE(dentry->d_name.name)))
+			return true;
+	}
+
+	return false;
+}
+
+
+static bool dyn_fsync_queue_file(struct file *file, int datasync)
+{
+	struct dyn_fsync_entry *e, *new;
+	bool kick, first;
+
+	new = kmalloc(sizeof(*new), GFP_KERNEL);
+	if (!new)
+		return false;
+
+	spin_lock(&queue_lock);
+	list_for_each_entry(e, &dyn_fsync_queue, list) {
+		if (file_inode(e->file) == file_inode(file)) {
+			e->datasync &= datasync;
+			spin_unlock(&queue_lock);
+			kfree(new);
+			atomic_long_inc(&nr_merged);
+			return true;
+		}
+	}
+
+	new->file = get_file(file);
+	new->datasync = datasync;
+	list_add_tail(&new->list, &dyn_fsync_queue);
+	first = !nr_queued++;
+	kick = nr_queued >= READ_ONCE(dyn_fsync_max_queued);
+	spin_unlock(&queue_lock);
+
+	atomic_long_inc(&nr_deferred);
+
+	if (kick)
+		mod_delayed_work(system_unbound_wq, &dyn_fsync_work, 0);
+	else if (first)
+		queue_delayed_work(system_unbound_wq, &dyn_fsync_work,
+			msecs_to_jiffies(READ_ONCE(dyn_fsync_max_delay_ms)));
+
+	return true;
+}
+
+
+/*
+ * Returns true when the fsync of @file has been queued instead, in which
+ * case the caller reports success right away.
+ */
+bool dyn_fsync_defer(struct file *file, int datasync)
+{
+	struct dyn_fsync_policy *policy;
+	bool defer;
+
+	if (!dyn_fsync_active || !suspend_active ||
+			(current->flags & PF_KTHREAD))
+		return false;
+
+	rcu_read_lock();
+	policy = rcu_dereference(dyn_fsync_policy);
+	defer = dyn_fsync_should_defer(policy, file->f_path.dentry);
+	rcu_read_unlock();
+
+	return defer && dyn_fsync_queue_file(file, datasync);
+}
+
+
+static void dyn_fsync_set_policy(struct dyn_fsync_policy *new)
+{
+	struct dyn_fsync_policy *old;
+
+	old = rcu_dereference_protected(dyn_fsync_policy,
+			lockdep_is_held(&policy_mutex));
+	rcu_assign_pointer(dyn_fsync_policy, new);
+	if (old != &dyn_fsync_default_policy)
+		kfree_rcu(old, rcu);
+}
+
+
+static struct dyn_fsync_policy *dyn_fsync_dup_policy(void)
+{
+	struct dyn_fsync_policy *new;
+
+	new = kmalloc(sizeof(*new), GFP_KERNEL);
+	if (new)
+		memcpy(new, rcu_dereference_protected(dyn_fsync_policy,
+				lockdep_is_held(&policy_mutex)), sizeof(*new));
+
+	return new;
+}
+
+
+static ssize_t dyn_fsync_names_show(const struct dyn_fsync_names *names,
+		char *buf)
+{
+	ssize_t len = 0;
+	unsigned int i;
+
+	for (i = 0; i < names->nr; i++)
+		len += scnprintf(buf + len, PAGE_SIZE - len, "%s%s",
+				i ? "," : "", names->name[i]);
+	len += scnprintf(buf + len, PAGE_SIZE - len, "\n");
+
+	return len;
+}
+
+
+// parse a comma or space separated list, an empty one clears it
+static int dyn_fsync_names_parse(struct dyn_fsync_names *names,
+		const char *buf)
+{
+	char *copy, *p, *tok;
+	int ret = 0;
+
+	copy = kstrdup(buf, GFP_KERNEL);
+	if (!copy)
+		return -ENOMEM;
+
+	names->nr = 0;
+	p = strim(copy);
+	while ((tok = strsep(&p, ", ")) != NULL) {
+		if (!*tok)
+			continue;
+		if (names->nr == DYN_FSYNC_MAX_ENTRIES ||
+				strlen(tok) >= DYN_FSYNC_NAME_LEN) {
+			ret = -EINVAL;
+			break;
+		}
+		strlcpy(names->name[names->nr++], tok, DYN_FSYNC_NAME_LEN);
+	}
+
+	kfree(copy);
+	return ret;
+}
+
+
+static ssize_t dyn_fsync_names_store(size_t offset, const char *buf,
+		size_t count)
+{
+	struct dyn_fsync_policy *new;
+	int ret;
+
+	mutex_lock(&policy_mutex);
+	new = dyn_fsync_dup_policy();
+	if (!new) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	ret = dyn_fsync_names_parse((void *)new + offset, buf);
+	if (ret) {
+		kfree(new);
+		goto out;
+	}
+
+	dyn_fsync_set_policy(new);
+out:
+	mutex_unlock(&policy_mutex);
+	return ret ? ret : count;
+}
+
+
 static ssize_t dyn_fsync_active_show(struct kobject *kobj,
 		struct kobj_attribute *attr, char *buf)
 {
@@ -77,6 +416,159 @@ static ssize_t dyn_fsync_active_store(struct kobject *kobj,
 }
 
 
+static ssize_t dyn_fsync_defer_dirs_show(struct kobject *kobj,
+		struct kobj_attribute *attr, char *buf)
+{
+	ssize_t ret;
+
+	rcu_read_lock();
+	ret = dyn_fsync_names_show(
+			&rcu_dereference(dyn_fsync_policy)->defer_dirs, buf);
+	rcu_read_unlock();
+
+	return ret;
+}
+
+
+static ssize_t dyn_fsync_defer_dirs_store(struct kobject *kobj,
+		struct kobj_attribute *attr, const char *buf, size_t count)
+{
+	return dyn_fsync_names_store(
+			offsetof(struct dyn_fsync_policy, defer_dirs),
+			buf, count);
+}
+
+
+static ssize_t dyn_fsync_keep_suffixes_show(struct kobject *kobj,
+		struct kobj_attribute *attr, char *buf)
+{
+	ssize_t ret;
+
+	rcu_read_lock();
+	ret = dyn_fsync_names_show(
+			&rcu_dereference(dyn_fsync_policy)->keep_suffixes, buf);
+	rcu_read_unlock();
+
+	return ret;
+}
+
+
+static ssize_t dyn_fsync_keep_suffixes_store(struct kobject *kobj,
+		struct kobj_attribute *attr, const char *buf, size_t count)
+{
+	return dyn_fsync_names_store(
+			offsetof(struct dyn_fsync_policy, keep_suffixes),
+			buf, count);
+}
+
+
+static ssize_t dyn_fsync_defer_uids_show(struct kobject *kobj,
+		struct kobj_attribute *attr, char *buf)
+{
+	struct dyn_fsync_policy *policy;
+	ssize_t len = 0;
+	unsigned int i;
+
+	rcu_read_lock();
+	policy = rcu_dereference(dyn_fsync_policy);
+	for (i = 0; i < policy->nr_uids; i++)
+		len += scnprintf(buf + len, PAGE_SIZE - len, "%s%u",
+				i ? "," : "", policy->uids[i]);
+	rcu_read_unlock();
+	len += scnprintf(buf + len, PAGE_SIZE - len, "\n");
+
+	return len;
+}
+
+
+static ssize_t dyn_fsync_defer_uids_store(struct kobject *kobj,
+		struct kobj_attribute *attr, const char *buf, size_t count)
+{
+	struct dyn_fsync_names names;
+	struct dyn_fsync_policy *new;
+	unsigned int i;
+	int ret;
+
+	ret = dyn_fsync_names_parse(&names, buf);
+	if (ret)
+		return ret;
+
+	mutex_lock(&policy_mutex);
+	new = dyn_fsync_dup_policy();
+	if (!new) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	for (i = 0; i < names.nr; i++) {
+		ret = kstrtouint(names.name[i], 10, &new->uids[i]);
+		if (ret) {
+			kfree(new);
+			goto out;
+		}
+	}
+	new->nr_uids = names.nr;
+
+	dyn_fsync_set_policy(new);
+out:
+	mutex_unlock(&policy_mutex);
+	return ret ? ret : count;
+}
+
+
+static ssize_t dyn_fsync_max_delay_ms_show(struct kobject *kobj,
+		struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", dyn_fsync_max_delay_ms);
+}
+
+
+static ssize_t dyn_fsync_max_delay_ms_store(struct kobject *kobj,
+		struct kobj_attribute *attr, const char *buf, size_t count)
+{
+	unsigned int data;
+
+	if (kstrtouint(buf, 10, &data))
+		return -EINVAL;
+
+	WRITE_ONCE(dyn_fsync_max_delay_ms, data);
+	return count;
+}
+
+
+static ssize_t dyn_fsync_max_queued_show(struct kobject *kobj,
+		struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", dyn_fsync_max_queued);
+}
+
+
+static ssize_t dyn_fsync_max_queued_store(struct kobject *kobj,
+		struct kobj_attribute *attr, const char *buf, size_t count)
+{
+	unsigned int data;
+
+	if (kstrtouint(buf, 10, &data) || !data)
+		return -EINVAL;
+
+	WRITE_ONCE(dyn_fsync_max_queued, data);
+	return count;
+}
+
+
+static ssize_t dyn_fsync_stats_show(struct kobject *kobj,
+		struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "deferred: %ld\nmerged: %ld\nflushed: %ld\n"
+			"batches: %ld\nqueued: %u\n",
+		atomic_long_read(&nr_deferred),
+		atomic_long_read(&nr_merged),
+		atomic_long_read(&nr_flushed),
+		atomic_long_read(&nr_batches),
+		READ_ONCE(nr_queued));
+}
+
+
 static ssize_t dyn_fsync_version_show(struct kobject *kobj,
 		struct kobj_attribute *attr, char *buf)
 {
@@ -96,9 +588,9 @@ static ssize_t dyn_fsync_suspend_show(struct kobject *kobj,
 static int dyn_fsync_panic_event(struct notifier_block *this,
 		unsigned long event, void *ptr)
 {
-	// kernel panic, force flush now
+	// kernel panic, force flush now, the deferred queue can't be waited for
 	suspend_active = false;
-	dyn_fsync_force_flush();
+	dyn_fsync_sync_filesystems();
 	pr_warn("dynamic fsync: panic - force flush!\n");
 
 	return NOTIFY_DONE;
@@ -114,6 +606,7 @@ static int dyn_fsync_notify_sys(struct notifier_block *this, unsigned long code,
 		suspend_active = false;
 		dyn_fsync_active = false;
 		dyn_fsync_force_flush();
+		cancel_delayed_work_sync(&dyn_fsync_work);
 		pr_warn("dynamic fsync: reboot - force flush!\n");
 	}
 	return NOTIFY_DONE;
@@ -168,11 +661,45 @@ static struct kobj_attribute dyn_fsync_version_attribute =
 static struct kobj_attribute dyn_fsync_suspend_attribute = 
 	__ATTR(Dyn_fsync_suspend, 0444, dyn_fsync_suspend_show, NULL);
 
+static struct kobj_attribute dyn_fsync_defer_dirs_attribute = 
+	__ATTR(Dyn_fsync_defer_dirs, 0664,
+		dyn_fsync_defer_dirs_show,
+		dyn_fsync_defer_dirs_store);
+
+static struct kobj_attribute dyn_fsync_keep_suffixes_attribute = 
+	__ATTR(Dyn_fsync_keep_suffixes, 0664,
+		dyn_fsync_keep_suffixes_show,
+		dyn_fsync_keep_suffixes_store);
+
+static struct kobj_attribute dyn_fsync_defer_uids_attribute = 
+	__ATTR(Dyn_fsync_defer_uids, 0664,
+		dyn_fsync_defer_uids_show,
+		dyn_fsync_defer_uids_store);
+
+static struct kobj_attribute dyn_fsync_max_delay_ms_attribute = 
+	__ATTR(Dyn_fsync_max_delay_ms, 0664,
+		dyn_fsync_max_delay_ms_show,
+		dyn_fsync_max_delay_ms_store);
+
+static struct kobj_attribute dyn_fsync_max_queued_attribute = 
+	__ATTR(Dyn_fsync_max_queued, 0664,
+		dyn_fsync_max_queued_show,
+		dyn_fsync_max_queued_store);
+
+static struct kobj_attribute dyn_fsync_stats_attribute = 
+	__ATTR(Dyn_fsync_stats, 0444, dyn_fsync_stats_show, NULL);
+
 static struct attribute *dyn_fsync_active_attrs[] =
 {
 	&dyn_fsync_active_attribute.attr,
 	&dyn_fsync_version_attribute.attr,
 	&dyn_fsync_suspend_attribute.attr,
+	&dyn_fsync_defer_dirs_attribute.attr,
+	&dyn_fsync_keep_suffixes_attribute.attr,
+	&dyn_fsync_defer_uids_attribute.attr,
+	&dyn_fsync_max_delay_ms_attribute.attr,
+	&dyn_fsync_max_queued_attribute.attr,
+	&dyn_fsync_stats_attribute.attr,
 	NULL,
 };
 
@@ -251,6 +778,10 @@ static void dyn_fsync_exit(void)
 		kobject_put(dyn_fsync_kobj);
 	
 	lcd_unregister_client(&lcd_notif);
+
+	dyn_fsync_active = false;
+	dyn_fsync_flush_deferred();
+	cancel_delayed_work_sync(&dyn_fsync_work);
 		
 	pr_info("%s dynamic fsync unregistration complete\n", __FUNCTION__);
 }
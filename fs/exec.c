@@ -62,6 +62,7 @@
 #include <linux/oom.h>
 #include <linux/compat.h>
 #include <linux/vmalloc.h>
+#include <linux/simple_lmk.h>
 
 #include <linux/uaccess.h>
 #include <asm/mmu_context.h>
@@ -1191,6 +1192,7 @@ static int de_thread(struct task_struct *tsk)
 		cgroup_threadgroup_change_end(tsk);
 
 		release_task(leader);
+		simple_lmk_update_adj(tsk);
 	}
 
 	sig->group_exit_task = NULL;
@@ -32,6 +32,75 @@ struct f2fs_compress_ops {
 	int (*decompress_pages)(struct decompress_io_ctx *dic);
 };
 
+/*
+ * Compressor workspaces are 16KB to several hundred KB, too much to
+ * allocate for every cluster compressed or decompressed. Keep a few idle
+ * ones around, matched by size, since each algorithm and cluster size
+ * always asks for the same one.
+ */
+#define F2FS_WORKSPACE_POOL_DEPTH	8
+
+struct f2fs_workspace {
+	void *mem;
+	unsigned int size;
+};
+
+static struct f2fs_workspace_pool {
+	spinlock_t lock;
+	unsigned int nr;
+	struct f2fs_workspace ws[F2FS_WORKSPACE_POOL_DEPTH];
+} f2fs_workspace_pool = {
+	.lock = __SPIN_LOCK_UNLOCKED(f2fs_workspace_pool.lock),
+};
+
+static void *f2fs_get_workspace(struct f2fs_sb_info *sbi, unsigned int size)
+{
+	struct f2fs_workspace_pool *pool = &f2fs_workspace_pool;
+	void *mem = NULL;
+	unsigned int i;
+
+	spin_lock(&pool->lock);
+	for (i = 0; i < pool->nr; i++) {
+		if (pool->ws[i].size == size) {
+			mem = pool->ws[i].mem;
+			pool->ws[i] = pool->ws[--pool->nr];
+			break;
+		}
+	}
+	spin_unlock(&pool->lock);
+
+	if (!mem)
+		mem = f2fs_kvmalloc(sbi, size, GFP_NOFS);
+	return mem;
+}
+
+static void f2fs_put_workspace(void *mem, unsigned int size)
+{
+	struct f2fs_workspace_pool *pool = &f2fs_workspace_pool;
+
+	if (!mem)
+		return;
+
+	spin_lock(&pool->lock);
+	if (pool->nr < F2FS_WORKSPACE_POOL_DEPTH) {
+		pool->ws[pool->nr].mem = mem;
+		pool->ws[pool->nr].size = size;
+		pool->nr++;
+		mem = NULL;
+	}
+	spin_unlock(&pool->lock);
+
+	kvfree(mem);
+}
+
+static void f2fs_drain_workspace_pool(void)
+{
+	struct f2fs_workspace_pool *pool = &f2fs_workspace_pool;
+
+	while (pool->nr)
+		kvfree(pool->ws[--pool->nr].mem);
+}
+
 static unsigned int offset_in_cluster(struct compress_ctx *cc, pgoff_t index)
 {
 	return index & (cc->cluster_size - 1);
@@ -164,8 +233,8 @@ void f2fs_compress_ctx_add_page(struct compress_ctx *cc, struct page *page)
 #ifdef CONFIG_F2FS_FS_LZO
 static int lzo_init_compress_ctx(struct compress_ctx *cc)
 {
-	cc->private = f2fs_kvmalloc(F2FS_I_SB(cc->inode),
-				LZO1X_MEM_COMPRESS, GFP_NOFS);
+	cc->private = f2fs_get_workspace(F2FS_I_SB(cc->inode),
+				LZO1X_MEM_COMPRESS);
 	if (!cc->private)
 		return -ENOMEM;
 
@@ -175,7 +244,7 @@ static int lzo_init_compress_ctx(struct compress_ctx *cc)
 
 static void lzo_destroy_compress_ctx(struct compress_ctx *cc)
 {
-	kvfree(cc->private);
+	f2fs_put_workspace(cc->private, LZO1X_MEM_COMPRESS);
 	cc->private = NULL;
 }
 
@@ -227,8 +296,8 @@ static const struct f2fs_compress_ops f2fs_lzo_ops = {
 #ifdef CONFIG_F2FS_FS_LZ4
 static int lz4_init_compress_ctx(struct compress_ctx *cc)
 {
-	cc->private = f2fs_kvmalloc(F2FS_I_SB(cc->inode),
-				LZ4_MEM_COMPRESS, GFP_NOFS);
+	cc->private = f2fs_get_workspace(F2FS_I_SB(cc->inode),
+				LZ4_MEM_COMPRESS);
 	if (!cc->private)
 		return -ENOMEM;
 
@@ -243,7 +312,7 @@ static int lz4_init_compress_ctx(struct compress_ctx *cc)
 
 static void lz4_destroy_compress_ctx(struct compress_ctx *cc)
 {
-	kvfree(cc->private);
+	f2fs_put_workspace(cc->private, LZ4_MEM_COMPRESS);
 	cc->private = NULL;
 }
 
@@ -294,6 +363,14 @@ static const struct f2fs_compress_ops f2fs_lz4_ops = {
 #ifdef CONFIG_F2FS_FS_ZSTD
 #define F2FS_ZSTD_DEFAULT_CLEVEL	1
 
+static unsigned int zstd_compress_workspace_size(struct compress_ctx *cc)
+{
+	ZSTD_parameters params;
+
+	params = ZSTD_getParams(F2FS_ZSTD_DEFAULT_CLEVEL, cc->rlen, 0);
+	return ZSTD_CStreamWorkspaceBound(params.cParams);
+}
+
 static int zstd_init_compress_ctx(struct compress_ctx *cc)
 {
 	ZSTD_parameters params;
@@ -302,10 +379,9 @@ static int zstd_init_compress_ctx(struct compress_ctx *cc)
 	unsigned int workspace_size;
 
 	params = ZSTD_getParams(F2FS_ZSTD_DEFAULT_CLEVEL, cc->rlen, 0);
-	workspace_size = ZSTD_CStreamWorkspaceBound(params.cParams);
+	workspace_size = zstd_compress_workspace_size(cc);
 
-	workspace = f2fs_kvmalloc(F2FS_I_SB(cc->inode),
-					workspace_size, GFP_NOFS);
+	workspace = f2fs_get_workspace(F2FS_I_SB(cc->inode), workspace_size);
 	if (!workspace)
 		return -ENOMEM;
 
@@ -314,7 +390,7 @@ static int zstd_init_compress_ctx(struct compress_ctx *cc)
 		printk_ratelimited("%sF2FS-fs (%s): %s ZSTD_initCStream failed\n",
 				KERN_ERR, F2FS_I_SB(cc->inode)->sb->s_id,
 				__func__);
-		kvfree(workspace);
+		f2fs_put_workspace(workspace, workspace_size);
 		return -EIO;
 	}
 
@@ -327,7 +403,7 @@ static int zstd_init_compress_ctx(struct compress_ctx *cc)
 
 static void zstd_destroy_compress_ctx(struct compress_ctx *cc)
 {
-	kvfree(cc->private);
+	f2fs_put_workspace(cc->private, zstd_compress_workspace_size(cc));
 	cc->private = NULL;
 	cc->private2 = NULL;
 }
@@ -384,8 +460,7 @@ static int zstd_init_decompress_ctx(struct decompress_io_ctx *dic)
 
 	workspace_size = ZSTD_DStreamWorkspaceBound(MAX_COMPRESS_WINDOW_SIZE);
 
-	workspace = f2fs_kvmalloc(F2FS_I_SB(dic->inode),
-					workspace_size, GFP_NOFS);
+	workspace = f2fs_get_workspace(F2FS_I_SB(dic->inode), workspace_size);
 	if (!workspace)
 		return -ENOMEM;
 
@@ -395,7 +470,7 @@ static int zstd_init_decompress_ctx(struct decompress_io_ctx *dic)
 		printk_ratelimited("%sF2FS-fs (%s): %s ZSTD_initDStream failed\n",
 				KERN_ERR, F2FS_I_SB(dic->inode)->sb->s_id,
 				__func__);
-		kvfree(workspace);
+		f2fs_put_workspace(workspace, workspace_size);
 		return -EIO;
 	}
 
@@ -407,7 +482,8 @@ static int zstd_init_decompress_ctx(struct decompress_io_ctx *dic)
 
 static void zstd_destroy_decompress_ctx(struct decompress_io_ctx *dic)
 {
-	kvfree(dic->private);
+	f2fs_put_workspace(dic->private,
+		ZSTD_DStreamWorkspaceBound(MAX_COMPRESS_WINDOW_SIZE));
 	dic->private = NULL;
 	dic->private2 = NULL;
 }
@@ -500,6 +576,7 @@ int f2fs_init_compress_mempool(void)
 void f2fs_destroy_compress_mempool(void)
 {
 	mempool_destroy(compress_page_pool);
+	f2fs_drain_workspace_pool();
 }
 
 static struct page *f2fs_compress_alloc_page(void)
@@ -530,6 +607,7 @@ static int f2fs_compress_pages(struct compress_ctx *cc)
 	const struct f2fs_compress_ops *cops =
 				f2fs_cops[fi->i_compress_algorithm];
 	unsigned int max_len, nr_cpages;
+	ktime_t start = ktime_get();
 	int i, ret;
 
 	trace_f2fs_compress_pages_start(cc->inode, cc->cluster_idx,
@@ -606,6 +684,9 @@ static int f2fs_compress_pages(struct compress_ctx *cc)
 
 	cc->nr_cpages = nr_cpages;
 
+	stat_add_compr_cluster(sbi, cc->rlen, cc->clen,
+			ktime_to_ns(ktime_sub(ktime_get(), start)));
+
 	trace_f2fs_compress_pages_end(cc->inode, cc->cluster_idx,
 							cc->clen, ret);
 	return 0;
@@ -630,24 +711,16 @@ static int f2fs_compress_pages(struct compress_ctx *cc)
 	return ret;
 }
 
-void f2fs_decompress_pages(struct bio *bio, struct page *page, bool verity)
+static void f2fs_decompress_cluster(struct decompress_io_ctx *dic,
+							bool verity)
 {
-	struct decompress_io_ctx *dic =
-			(struct decompress_io_ctx *)page_private(page);
 	struct f2fs_sb_info *sbi = F2FS_I_SB(dic->inode);
-	struct f2fs_inode_info *fi= F2FS_I(dic->inode);
+	struct f2fs_inode_info *fi = F2FS_I(dic->inode);
 	const struct f2fs_compress_ops *cops =
 			f2fs_cops[fi->i_compress_algorithm];
+	ktime_t start = ktime_get();
 	int ret;
 
-	dec_page_count(sbi, F2FS_RD_DATA);
-
-	if (bio->bi_status || PageError(page))
-		dic->failed = true;
-
-	if (refcount_dec_not_one(&dic->ref))
-		return;
-
 	trace_f2fs_decompress_pages_start(dic->inode, dic->cluster_idx,
 				dic->cluster_size, fi->i_compress_algorithm);
 
@@ -684,6 +757,9 @@ void f2fs_decompress_pages(struct bio *bio, struct page *page, bool verity)
 	}
 
 	ret = cops->decompress_pages(dic);
+	if (!ret)
+		stat_add_decompr_cluster(sbi, dic->rlen,
+			ktime_to_ns(ktime_sub(ktime_get(), start)));
 
 out_vunmap_cbuf:
 	vunmap(dic->cbuf);
@@ -705,6 +781,46 @@ void f2fs_decompress_pages(struct bio *bio, struct page *page, bool verity)
 		f2fs_free_dic(dic);
 }
 
+static void f2fs_decompress_work(struct work_struct *work)
+{
+	struct decompress_io_ctx *dic =
+		container_of(work, struct decompress_io_ctx, work);
+
+	f2fs_decompress_cluster(dic, false);
+}
+
+void f2fs_decompress_pages(struct bio *bio, struct page *page, bool verity)
+{
+	struct decompress_io_ctx *dic =
+			(struct decompress_io_ctx *)page_private(page);
+	struct f2fs_sb_info *sbi = F2FS_I_SB(dic->inode);
+
+	dec_page_count(sbi, F2FS_RD_DATA);
+
+	if (bio->bi_status || PageError(page))
+		dic->failed = true;
+
+	if (refcount_dec_not_one(&dic->ref))
+		return;
+
+	/*
+	 * A bio usually carries several clusters; hand every cluster but the
+	 * one completed by the last page to post_read_wq so that they are
+	 * decompressed on other CPUs while this worker keeps going. Verity
+	 * has to see the decompressed data before the bio is verified, so
+	 * it stays inline.
+	 */
+	if (!verity && !dic->failed && sbi->post_read_wq &&
+			page != bio->bi_io_vec[bio->bi_vcnt - 1].bv_page) {
+		INIT_WORK(&dic->work, f2fs_decompress_work);
+		stat_inc_decompr_parallel(sbi);
+		queue_work(sbi->post_read_wq, &dic->work);
+		return;
+	}
+
+	f2fs_decompress_cluster(dic, verity);
+}
+
 static bool is_page_in_cluster(struct compress_ctx *cc, pgoff_t index)
 {
 	if (cc->cluster_idx == NULL_CLUSTER)
@@ -1307,7 +1423,11 @@ static int f2fs_write_raw_pages(struct compress_ctx *cc,
 	return err;
 }
 
-int f2fs_write_multi_pages(struct compress_ctx *cc,
+/*
+ * Write out a cluster whose compression has already been attempted; @err is
+ * the result of f2fs_compress_pages(), -EAGAIN meaning raw write.
+ */
+static int f2fs_write_cluster(struct compress_ctx *cc, int err,
 					int *submitted,
 					struct writeback_control *wbc,
 					enum iostat_type io_type)
@@ -1315,14 +1435,10 @@ int f2fs_write_multi_pages(struct compress_ctx *cc,
 	struct f2fs_inode_info *fi = F2FS_I(cc->inode);
 	const struct f2fs_compress_ops *cops =
 			f2fs_cops[fi->i_compress_algorithm];
-	int err;
 
 	*submitted = 0;
-	if (cluster_may_compress(cc)) {
-		err = f2fs_compress_pages(cc);
-		if (err == -EAGAIN) {
-			goto write;
-		} else if (err) {
+	if (err != -EAGAIN) {
+		if (err) {
 			f2fs_put_rpages_wbc(cc, wbc, true, 1);
 			goto destroy_out;
 		}
@@ -1334,7 +1450,7 @@ int f2fs_write_multi_pages(struct compress_ctx *cc,
 			return 0;
 		f2fs_bug_on(F2FS_I_SB(cc->inode), err != -EAGAIN);
 	}
-write:
+
 	f2fs_bug_on(F2FS_I_SB(cc->inode), *submitted);
 
 	err = f2fs_write_raw_pages(cc, submitted, wbc, io_type);
@@ -1344,6 +1460,134 @@ int f2fs_write_multi_pages(struct compress_ctx *cc,
 	return err;
 }
 
+int f2fs_write_multi_pages(struct compress_ctx *cc,
+					int *submitted,
+					struct writeback_control *wbc,
+					enum iostat_type io_type)
+{
+	int err = -EAGAIN;
+
+	if (cluster_may_compress(cc))
+		err = f2fs_compress_pages(cc);
+
+	return f2fs_write_cluster(cc, err, submitted, wbc, io_type);
+}
+
+struct f2fs_compress_work {
+	struct work_struct work;
+	struct compress_ctx cc;		/* cluster owned by this slot */
+	int err;			/* f2fs_compress_pages() result */
+	struct completion done;
+};
+
+static void f2fs_compress_work_fn(struct work_struct *work)
+{
+	struct f2fs_compress_work *cw =
+		container_of(work, struct f2fs_compress_work, work);
+
+	cw->err = f2fs_compress_pages(&cw->cc);
+	complete(&cw->done);
+}
+
+void f2fs_init_compress_batch(struct compress_batch *cb, struct inode *inode)
+{
+	struct f2fs_sb_info *sbi = F2FS_I_SB(inode);
+	unsigned int max = min_t(unsigned int, READ_ONCE(sbi->compress_batch),
+						F2FS_COMPRESS_BATCH_MAX);
+
+	cb->works = NULL;
+	cb->nr = 0;
+	cb->max = 0;
+
+	if (max <= 1 || !sbi->compress_wq)
+		return;
+
+	/* best effort, fall back to compressing inline */
+	cb->works = kcalloc(max, sizeof(struct f2fs_compress_work),
+					GFP_NOFS | __GFP_NOWARN);
+	if (cb->works)
+		cb->max = max;
+}
+
+void f2fs_destroy_compress_batch(struct compress_batch *cb)
+{
+	WARN_ON(cb->nr);
+	kfree(cb->works);
+	cb->works = NULL;
+	cb->max = 0;
+}
+
+/*
+ * Wait for all in-flight clusters and write them in the order they were
+ * queued, so that block allocation stays sequential.
+ */
+int f2fs_flush_compress_batch(struct compress_batch *cb,
+					int *submitted,
+					struct writeback_control *wbc,
+					enum iostat_type io_type)
+{
+	unsigned int i;
+	int ret = 0;
+
+	*submitted = 0;
+
+	for (i = 0; i < cb->nr; i++) {
+		struct f2fs_compress_work *cw = &cb->works[i];
+		int _submitted = 0;
+		int err;
+
+		wait_for_completion(&cw->done);
+
+		err = f2fs_write_cluster(&cw->cc, cw->err, &_submitted,
+							wbc, io_type);
+		*submitted += _submitted;
+		if (err && !ret)
+			ret = err;
+	}
+	cb->nr = 0;
+	return ret;
+}
+
+int f2fs_write_multi_pages_batch(struct compress_batch *cb,
+					struct compress_ctx *cc,
+					int *submitted,
+					struct writeback_control *wbc,
+					enum iostat_type io_type)
+{
+	struct f2fs_compress_work *cw;
+	int _submitted = 0;
+	int err;
+
+	*submitted = 0;
+
+	if (!cb->max || !cluster_may_compress(cc)) {
+		err = f2fs_flush_compress_batch(cb, submitted, wbc, io_type);
+		if (err)
+			return err;
+		err = f2fs_write_multi_pages(cc, &_submitted, wbc, io_type);
+		*submitted += _submitted;
+		return err;
+	}
+
+	/* hand the cluster over to a slot, cc is reset for the next one */
+	cw = &cb->works[cb->nr++];
+	cw->cc = *cc;
+	cc->rpages = NULL;
+	cc->nr_rpages = 0;
+	cc->nr_cpages = 0;
+	cc->cluster_idx = NULL_CLUSTER;
+
+	init_completion(&cw->done);
+	INIT_WORK(&cw->work, f2fs_compress_work_fn);
+	stat_inc_compr_parallel(F2FS_I_SB(cc->inode));
+	queue_work(F2FS_I_SB(cc->inode)->compress_wq, &cw->work);
+
+	if (cb->nr < cb->max)
+		return 0;
+
+	return f2fs_flush_compress_batch(cb, submitted, wbc, io_type);
+}
+
 struct decompress_io_ctx *f2fs_alloc_dic(struct compress_ctx *cc)
 {
 	struct f2fs_sb_info *sbi = F2FS_I_SB(cc->inode);
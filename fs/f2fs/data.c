@@ -2964,6 +2964,7 @@ static int f2fs_write_cache_pages(struct address_space *mapping,
 		.rlen = PAGE_SIZE * F2FS_I(inode)->i_cluster_size,
 		.private = NULL,
 	};
+	struct compress_batch cb;
 #endif
 	int nr_pages;
 	pgoff_t uninitialized_var(writeback_index);
@@ -2977,6 +2978,10 @@ static int f2fs_write_cache_pages(struct address_space *mapping,
 	int i;
 
 	pagevec_init(&pvec, 0);
+#ifdef CONFIG_F2FS_FS_COMPRESSION
+	if (f2fs_compressed_file(inode))
+		f2fs_init_compress_batch(&cb, inode);
+#endif
 
 	if (get_dirty_pages(mapping->host) <=
 				SM_I(F2FS_M_SB(mapping))->min_hot_blocks)
@@ -3024,8 +3029,8 @@ static int f2fs_write_cache_pages(struct address_space *mapping,
 
 				if (!f2fs_cluster_can_merge_page(&cc,
 								page->index)) {
-					ret = f2fs_write_multi_pages(&cc,
-						&submitted, wbc, io_type);
+					ret = f2fs_write_multi_pages_batch(&cb,
+						&cc, &submitted, wbc, io_type);
 					if (!ret)
 						need_readd = true;
 					goto result;
@@ -3146,16 +3151,31 @@ static int f2fs_write_cache_pages(struct address_space *mapping,
 		cond_resched();
 	}
 #ifdef CONFIG_F2FS_FS_COMPRESSION
-	/* flush remained pages in compress cluster */
+	/* flush clusters still being compressed, then the remained one */
+	if (f2fs_compressed_file(inode)) {
+		int err;
+
+		err = f2fs_flush_compress_batch(&cb, &submitted, wbc, io_type);
+		nwritten += submitted;
+		wbc->nr_to_write -= submitted;
+		if (err && !ret)
+			ret = err;
+	}
 	if (f2fs_compressed_file(inode) && !f2fs_cluster_is_empty(&cc)) {
-		ret = f2fs_write_multi_pages(&cc, &submitted, wbc, io_type);
+		int err;
+
+		err = f2fs_write_multi_pages(&cc, &submitted, wbc, io_type);
 		nwritten += submitted;
 		wbc->nr_to_write -= submitted;
-		if (ret) {
-			done = 1;
-			retry = 0;
-		}
+		if (err && !ret)
+			ret = err;
+	}
+	if (f2fs_compressed_file(inode) && ret) {
+		done = 1;
+		retry = 0;
 	}
+	if (f2fs_compressed_file(inode) && !retry)
+		f2fs_destroy_compress_batch(&cb);
 #endif
 	if (retry) {
 		index = 0;
@@ -4142,6 +4162,20 @@ int f2fs_init_post_read_wq(struct f2fs_sb_info *sbi)
 						 num_online_cpus());
 	if (!sbi->post_read_wq)
 		return -ENOMEM;
+
+#ifdef CONFIG_F2FS_FS_COMPRESSION
+	/* clusters handed off by f2fs_write_multi_pages_batch() */
+	if (f2fs_sb_has_compression(sbi)) {
+		sbi->compress_wq = alloc_workqueue("f2fs_compress_wq",
+						WQ_UNBOUND | WQ_MEM_RECLAIM,
+						num_online_cpus());
+		if (!sbi->compress_wq) {
+			destroy_workqueue(sbi->post_read_wq);
+			sbi->post_read_wq = NULL;
+			return -ENOMEM;
+		}
+	}
+#endif
 	return 0;
 }
 
@@ -4149,6 +4183,10 @@ void f2fs_destroy_post_read_wq(struct f2fs_sb_info *sbi)
 {
 	if (sbi->post_read_wq)
 		destroy_workqueue(sbi->post_read_wq);
+#ifdef CONFIG_F2FS_FS_COMPRESSION
+	if (sbi->compress_wq)
+		destroy_workqueue(sbi->compress_wq);
+#endif
 }
 
 int __init f2fs_init_bio_entry_cache(void)
@@ -110,6 +110,10 @@ static void update_general_status(struct f2fs_sb_info *sbi)
 			atomic_read(&SM_I(sbi)->fcc_info->queued_flush);
 		si->flush_list_empty =
 			llist_empty(&SM_I(sbi)->fcc_info->issue_list);
+		spin_lock(&SM_I(sbi)->fcc_info->fsync_lock);
+		si->fsync_groups = SM_I(sbi)->fcc_info->fsync_groups;
+		si->fsync_members = SM_I(sbi)->fcc_info->fsync_members;
+		spin_unlock(&SM_I(sbi)->fcc_info->fsync_lock);
 	}
 	if (SM_I(sbi)->dcc_info) {
 		si->nr_discarded =
@@ -132,6 +136,15 @@ static void update_general_status(struct f2fs_sb_info *sbi)
 	si->inline_dir = atomic_read(&sbi->inline_dir);
 	si->compr_inode = atomic_read(&sbi->compr_inode);
 	si->compr_blocks = atomic_read(&sbi->compr_blocks);
+	si->compr_clusters = atomic64_read(&sbi->compr_clusters);
+	si->compr_parallel = atomic64_read(&sbi->compr_parallel);
+	si->compr_in_bytes = atomic64_read(&sbi->compr_in_bytes);
+	si->compr_out_bytes = atomic64_read(&sbi->compr_out_bytes);
+	si->compr_nsec = atomic64_read(&sbi->compr_nsec);
+	si->decompr_clusters = atomic64_read(&sbi->decompr_clusters);
+	si->decompr_parallel = atomic64_read(&sbi->decompr_parallel);
+	si->decompr_out_bytes = atomic64_read(&sbi->decompr_out_bytes);
+	si->decompr_nsec = atomic64_read(&sbi->decompr_nsec);
 	si->append = sbi->im[APPEND_INO].ino_num;
 	si->update = sbi->im[UPDATE_INO].ino_num;
 	si->orphans = sbi->im[ORPHAN_INO].ino_num;
@@ -324,6 +337,19 @@ static int stat_show(struct seq_file *s, void *v)
 			   si->inline_dir);
 		seq_printf(s, "  - Compressed Inode: %u, Blocks: %u\n",
 			   si->compr_inode, si->compr_blocks);
+		seq_printf(s, "  - Compress: %llu clusters (%llu parallel), "
+			   "%llu -> %llu KB, %llu MB/s\n",
+			   si->compr_clusters, si->compr_parallel,
+			   si->compr_in_bytes >> 10, si->compr_out_bytes >> 10,
+			   si->compr_nsec ? div64_u64(si->compr_in_bytes * 1000,
+						      si->compr_nsec) : 0);
+		seq_printf(s, "  - Decompress: %llu clusters (%llu parallel), "
+			   "%llu KB, %llu MB/s\n",
+			   si->decompr_clusters, si->decompr_parallel,
+			   si->decompr_out_bytes >> 10,
+			   si->decompr_nsec ?
+			   div64_u64(si->decompr_out_bytes * 1000,
+				     si->decompr_nsec) : 0);
 		seq_printf(s, "  - Orphan/Append/Update Inode: %u, %u, %u\n",
 			   si->orphans, si->append, si->update);
 		seq_printf(s, "\nMain area: %d segs, %d secs %d zones\n",
@@ -408,6 +434,15 @@ static int stat_show(struct seq_file *s, void *v)
 			   si->flush_list_empty,
 			   si->nr_discarding, si->nr_discarded,
 			   si->nr_discard_cmd, si->undiscard_blks);
+		if (si->fsync_groups) {
+			unsigned long long avg = div64_u64(
+				si->fsync_members * 100, si->fsync_groups);
+
+			seq_printf(s, "  - batched fsync: %llu in %llu groups "
+				"(avg. %llu.%02llu)\n",
+				si->fsync_members, si->fsync_groups,
+				avg / 100, avg % 100);
+		}
 		seq_printf(s, "  - inmem: %4d, atomic IO: %4d (Max. %4d), "
 			"volatile IO: %4d (Max. %4d)\n",
 			   si->inmem_pages, si->aw_cnt, si->max_aw_cnt,
@@ -514,6 +549,15 @@ int f2fs_build_stats(struct f2fs_sb_info *sbi)
 	atomic_set(&sbi->inline_dir, 0);
 	atomic_set(&sbi->compr_inode, 0);
 	atomic_set(&sbi->compr_blocks, 0);
+	atomic64_set(&sbi->compr_clusters, 0);
+	atomic64_set(&sbi->compr_parallel, 0);
+	atomic64_set(&sbi->compr_in_bytes, 0);
+	atomic64_set(&sbi->compr_out_bytes, 0);
+	atomic64_set(&sbi->compr_nsec, 0);
+	atomic64_set(&sbi->decompr_clusters, 0);
+	atomic64_set(&sbi->decompr_parallel, 0);
+	atomic64_set(&sbi->decompr_out_bytes, 0);
+	atomic64_set(&sbi->decompr_nsec, 0);
 	atomic_set(&sbi->inplace_count, 0);
 	for (i = META_CP; i < META_MAX; i++)
 		atomic_set(&sbi->meta_count[i], 0);
@@ -1059,6 +1059,22 @@ struct flush_cmd_control {
 	atomic_t queued_flush;			/* # of queued flushes */
 	struct llist_head issue_list;		/* list for command issue */
 	struct llist_node *dispatch_list;	/* list for command dispatch */
+
+	/* batched fsync */
+	spinlock_t fsync_lock;			/* protects below */
+	wait_queue_head_t fsync_wait_queue;	/* waiting for group commit */
+	struct list_head fsync_list;		/* fsyncs waiting for a leader */
+	bool fsync_leading;			/* group commit in progress */
+	unsigned long long fsync_groups;	/* # of group commits */
+	unsigned long long fsync_members;	/* # of fsyncs they covered */
+};
+
+struct fsync_batch_cmd {
+	struct list_head list;
+	unsigned int seq_id;			/* last node write to wait for */
+	bool need_flush;			/* needs a device cache flush */
+	bool done;
+	int ret;
 };
 
 struct f2fs_sm_info {
@@ -1452,6 +1468,17 @@ struct decompress_io_ctx {
 	bool failed;			/* indicate IO error during decompression */
 	void *private;			/* payload buffer for specified decompression algorithm */
 	void *private2;			/* extra payload buffer */
+	struct work_struct work;	/* for parallel decompression */
+};
+
+/* clusters compressed in parallel during one writeback pass */
+#define F2FS_COMPRESS_BATCH_MAX		8
+
+struct f2fs_compress_work;
+struct compress_batch {
+	struct f2fs_compress_work *works;	/* in-flight clusters, in order */
+	unsigned int nr;			/* # of in-flight clusters */
+	unsigned int max;			/* 0 or 1 disables batching */
 };
 
 #define NULL_CLUSTER			((unsigned int)(~0))
@@ -1541,6 +1568,7 @@ struct f2fs_sb_info {
 	loff_t max_file_blocks;			/* max block index of file */
 	int dir_level;				/* directory level */
 	int readdir_ra;				/* readahead inode in readdir */
+	unsigned int extent_ra_pages;		/* max readahead of an extent */
 
 	block_t user_block_count;		/* # of user blocks */
 	block_t total_valid_block_count;	/* # of valid blocks */
@@ -1610,6 +1638,15 @@ struct f2fs_sb_info {
 	atomic_t inline_dir;			/* # of inline_dentry inodes */
 	atomic_t compr_inode;			/* # of compressed inodes */
 	atomic_t compr_blocks;			/* # of compressed blocks */
+	atomic64_t compr_clusters;		/* # of compressed clusters */
+	atomic64_t compr_parallel;		/* # of them compressed off-thread */
+	atomic64_t compr_in_bytes;		/* raw bytes fed to compressor */
+	atomic64_t compr_out_bytes;		/* compressed bytes produced */
+	atomic64_t compr_nsec;			/* time spent compressing */
+	atomic64_t decompr_clusters;		/* # of decompressed clusters */
+	atomic64_t decompr_parallel;		/* # of them decompressed off-bio */
+	atomic64_t decompr_out_bytes;		/* raw bytes produced */
+	atomic64_t decompr_nsec;		/* time spent decompressing */
 	atomic_t vw_cnt;			/* # of volatile writes */
 	atomic_t max_aw_cnt;			/* max # of atomic writes */
 	atomic_t max_vw_cnt;			/* max # of volatile writes */
@@ -1631,6 +1668,8 @@ struct f2fs_sb_info {
 	unsigned long iostat_next_period;
 	unsigned int iostat_period_ms;
 
+	unsigned int fsync_batch;		/* group concurrent fsyncs */
+
 	/* to attach REQ_META|REQ_FUA flags */
 	unsigned int data_io_flag;
 	unsigned int node_io_flag;
@@ -1659,6 +1698,8 @@ struct f2fs_sb_info {
 	__u32 s_chksum_seed;
 
 	struct workqueue_struct *post_read_wq;	/* post read workqueue */
+	struct workqueue_struct *compress_wq;	/* parallel compression workqueue */
+	unsigned int compress_batch;		/* max clusters compressed in parallel */
 
 	struct kmem_cache *inline_xattr_slab;	/* inline xattr entry */
 	unsigned int inline_xattr_slab_size;	/* default inline xattr slab size */
@@ -3412,6 +3453,8 @@ int f2fs_commit_inmem_pages(struct inode *inode);
 void f2fs_balance_fs(struct f2fs_sb_info *sbi, bool need);
 void f2fs_balance_fs_bg(struct f2fs_sb_info *sbi, bool from_bg);
 int f2fs_issue_flush(struct f2fs_sb_info *sbi, nid_t ino);
+int f2fs_fsync_batch_commit(struct f2fs_sb_info *sbi, nid_t ino,
+			unsigned int seq_id, bool need_flush);
 int f2fs_create_flush_cmd_control(struct f2fs_sb_info *sbi);
 int f2fs_flush_device_cache(struct f2fs_sb_info *sbi);
 void f2fs_destroy_flush_cmd_control(struct f2fs_sb_info *sbi, bool free);
@@ -3630,11 +3673,16 @@ struct f2fs_stat_info {
 	int nr_dio_read, nr_dio_write;
 	unsigned int io_skip_bggc, other_skip_bggc;
 	int nr_flushing, nr_flushed, flush_list_empty;
+	unsigned long long fsync_groups, fsync_members;
 	int nr_discarding, nr_discarded;
 	int nr_discard_cmd;
 	unsigned int undiscard_blks;
 	int inline_xattr, inline_inode, inline_dir, append, update, orphans;
 	int compr_inode, compr_blocks;
+	unsigned long long compr_clusters, compr_parallel;
+	unsigned long long compr_in_bytes, compr_out_bytes, compr_nsec;
+	unsigned long long decompr_clusters, decompr_parallel;
+	unsigned long long decompr_out_bytes, decompr_nsec;
 	int aw_cnt, max_aw_cnt, vw_cnt, max_vw_cnt;
 	unsigned int valid_count, valid_node_count, valid_inode_count, discard_blks;
 	unsigned int bimodal, avg_vblocks;
@@ -3719,6 +3767,23 @@ static inline struct f2fs_stat_info *F2FS_STAT(struct f2fs_sb_info *sbi)
 		(atomic_add(blocks, &F2FS_I_SB(inode)->compr_blocks))
 #define stat_sub_compr_blocks(inode, blocks)				\
 		(atomic_sub(blocks, &F2FS_I_SB(inode)->compr_blocks))
+#define stat_add_compr_cluster(sbi, in, out, nsec)			\
+	do {								\
+		atomic64_inc(&(sbi)->compr_clusters);			\
+		atomic64_add(in, &(sbi)->compr_in_bytes);		\
+		atomic64_add(out, &(sbi)->compr_out_bytes);		\
+		atomic64_add(nsec, &(sbi)->compr_nsec);			\
+	} while (0)
+#define stat_inc_compr_parallel(sbi)					\
+		(atomic64_inc(&(sbi)->compr_parallel))
+#define stat_add_decompr_cluster(sbi, out, nsec)			\
+	do {								\
+		atomic64_inc(&(sbi)->decompr_clusters);			\
+		atomic64_add(out, &(sbi)->decompr_out_bytes);		\
+		atomic64_add(nsec, &(sbi)->decompr_nsec);		\
+	} while (0)
+#define stat_inc_decompr_parallel(sbi)					\
+		(atomic64_inc(&(sbi)->decompr_parallel))
 #define stat_inc_meta_count(sbi, blkaddr)				\
 	do {								\
 		if (blkaddr < SIT_I(sbi)->sit_base_addr)		\
@@ -3814,6 +3879,10 @@ void f2fs_update_sit_info(struct f2fs_sb_info *sbi);
 #define stat_dec_compr_inode(inode)			do { } while (0)
 #define stat_add_compr_blocks(inode, blocks)		do { } while (0)
 #define stat_sub_compr_blocks(inode, blocks)		do { } while (0)
+#define stat_add_compr_cluster(sbi, in, out, nsec)	do { } while (0)
+#define stat_inc_compr_parallel(sbi)			do { } while (0)
+#define stat_add_decompr_cluster(sbi, out, nsec)	do { } while (0)
+#define stat_inc_decompr_parallel(sbi)			do { } while (0)
 #define stat_inc_atomic_write(inode)			do { } while (0)
 #define stat_dec_atomic_write(inode)			do { } while (0)
 #define stat_update_max_atomic_write(inode)		do { } while (0)
@@ -3988,6 +4057,17 @@ int f2fs_write_multi_pages(struct compress_ctx *cc,
 						int *submitted,
 						struct writeback_control *wbc,
 						enum iostat_type io_type);
+void f2fs_init_compress_batch(struct compress_batch *cb, struct inode *inode);
+void f2fs_destroy_compress_batch(struct compress_batch *cb);
+int f2fs_write_multi_pages_batch(struct compress_batch *cb,
+						struct compress_ctx *cc,
+						int *submitted,
+						struct writeback_control *wbc,
+						enum iostat_type io_type);
+int f2fs_flush_compress_batch(struct compress_batch *cb,
+						int *submitted,
+						struct writeback_control *wbc,
+						enum iostat_type io_type);
 int f2fs_is_compressed_cluster(struct inode *inode, pgoff_t index);
 int f2fs_read_multi_pages(struct compress_ctx *cc, struct bio **bio_ret,
 				unsigned nr_pages, sector_t *last_block_in_bio,
@@ -36,11 +36,39 @@
 #include <trace/events/f2fs.h>
 #include <trace/events/android_fs.h>
 
+/*
+ * Grow the readahead window of @file to the rest of the extent holding
+ * @index, up to extent_ra_pages, so that sequential reads of a contiguous
+ * file are issued as bios of the device's max transfer size rather than
+ * of the default window. The window is never shrunk here.
+ */
+static void f2fs_extent_readahead(struct file *file, pgoff_t index)
+{
+	struct inode *inode = file_inode(file);
+	unsigned int max = READ_ONCE(F2FS_I_SB(inode)->extent_ra_pages);
+	struct extent_info ei;
+	unsigned int len;
+
+	if (!max || (file->f_mode & FMODE_RANDOM) ||
+			f2fs_compressed_file(inode))
+		return;
+
+	if (!f2fs_lookup_extent_cache(inode, index, &ei))
+		return;
+
+	len = min(ei.fofs + ei.len - (unsigned int)index, max);
+	if (len > file->f_ra.ra_pages)
+		file->f_ra.ra_pages = len;
+}
+
 static int f2fs_filemap_fault(struct vm_fault *vmf)
 {
 	struct inode *inode = file_inode(vmf->vma->vm_file);
 	int err;
 
+	if (vmf->vma->vm_flags & VM_SEQ_READ)
+		f2fs_extent_readahead(vmf->vma->vm_file, vmf->pgoff);
+
 	down_read(&F2FS_I(inode)->i_mmap_sem);
 	err = filemap_fault(vmf);
 	up_read(&F2FS_I(inode)->i_mmap_sem);
@@ -257,6 +285,10 @@ static int f2fs_do_sync_file(struct file *file, loff_t start, loff_t end,
 		.for_reclaim = 0,
 	};
 	unsigned int seq_id = 0;
+	bool batch = !atomic && f2fs_fsync_batch_enabled(sbi);
+	bool need_flush = !atomic &&
+		(F2FS_OPTION(sbi).fsync_mode != FSYNC_MODE_NOBARRIER ||
+							sbi->fsync_protect);
 #if defined(VENDOR_EDIT) && defined(CONFIG_UFSTW)
 /* Hank.liu@TECH.PLAT.Storage, 2019-10-31, add UFS+ hpb and tw driver*/
 	bool turbo_set = false;
@@ -389,7 +421,13 @@ static int f2fs_do_sync_file(struct file *file, loff_t start, loff_t end,
 	 * roll-forward recovery. It means we'll recover all or none node blocks
 	 * given fsync mark.
 	 */
-	if (!atomic) {
+	if (batch) {
+		/* the group commit also does the cache flush if needed */
+		ret = f2fs_fsync_batch_commit(sbi, ino, seq_id, need_flush);
+		if (ret)
+			goto out;
+		need_flush = false;
+	} else if (!atomic) {
 		ret = f2fs_wait_on_node_pages_writeback(sbi, seq_id);
 		if (ret)
 			goto out;
@@ -402,13 +440,15 @@ static int f2fs_do_sync_file(struct file *file, loff_t start, loff_t end,
 	/* VENDOR_EDIT yawnu@TECH.Storage.FS.oF2FS
 	 * 2019/09/13, fsync nobarrier protection
 	 */
-	if (!atomic && (F2FS_OPTION(sbi).fsync_mode != FSYNC_MODE_NOBARRIER ||
-							sbi->fsync_protect)) {
+	if (need_flush) {
 	//if (!atomic && F2FS_OPTION(sbi).fsync_mode != FSYNC_MODE_NOBARRIER) {
 #ifdef CONFIG_F2FS_BD_STAT
 		flush_begin = local_clock();
 #endif
-		ret = f2fs_issue_flush(sbi, inode->i_ino);
+		if (batch)
+			ret = f2fs_fsync_batch_commit(sbi, ino, 0, true);
+		else
+			ret = f2fs_issue_flush(sbi, inode->i_ino);
 #ifdef CONFIG_F2FS_BD_STAT
 		flush_end = local_clock();
 #endif
@@ -3884,6 +3924,9 @@ static ssize_t f2fs_file_read_iter(struct kiocb *iocb, struct iov_iter *iter)
 	if (!f2fs_is_compress_backend_ready(inode))
 		return -EOPNOTSUPP;
 
+	if (!(iocb->ki_flags & IOCB_DIRECT))
+		f2fs_extent_readahead(file, iocb->ki_pos >> PAGE_SHIFT);
+
 	ret = generic_file_read_iter(iocb, iter);
 
 	if (ret > 0)
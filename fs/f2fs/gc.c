@@ -14,6 +14,11 @@
 #include <linux/delay.h>
 #include <linux/freezer.h>
 #include <linux/sched/signal.h>
+#include <linux/power_supply.h>
+#include <linux/msm_drm_notify.h>
+#if defined(VENDOR_EDIT) && defined(CONFIG_UFSTW)
+#include <linux/ufstw.h>
+#endif
 
 #include "f2fs.h"
 #include "node.h"
@@ -122,8 +127,8 @@ static inline void of2fs_tune_wait_ms(struct f2fs_sb_info *sbi, unsigned int *wa
 {
 	unsigned int min_wait_ms;
 	struct f2fs_gc_kthread *gc_th = sbi->gc_thread;
-	if (sbi->gc_mode == GC_URGENT) {
-		// do nothing in GC_URGENT mode
+	if (sbi->gc_mode == GC_URGENT || gc_th->in_idle_window) {
+		// do nothing in GC_URGENT mode or an idle window
 		return ;
 	} else if (is_gc_frag(sbi)) {
 		*wait_ms = DEF_GC_FRAG_MIN_SLEEP_TIME;
@@ -140,6 +145,46 @@ static inline void of2fs_tune_wait_ms(struct f2fs_sb_info *sbi, unsigned int *wa
 		*wait_ms = min_wait_ms;
 }
 
+/*
+ * Device state for gc_idle_policy. The display and charger are shared by
+ * all mounted partitions, so a single set of notifiers feeds every GC
+ * thread; both start out as "screen on, on battery".
+ */
+static bool gc_screen_off;
+static bool gc_charging;
+
+enum {
+	GC_WINDOW_BUSY,		/* user is active: defer background GC */
+	GC_WINDOW_NORMAL,	/* default sleep-interval behaviour */
+	GC_WINDOW_IDLE,		/* screen off, charging and I/O quiet */
+};
+
+static int of2fs_gc_window(struct f2fs_sb_info *sbi)
+{
+	struct f2fs_gc_kthread *gc_th = sbi->gc_thread;
+	bool screen_off = READ_ONCE(gc_screen_off);
+	bool charging = READ_ONCE(gc_charging);
+
+	if (!screen_off && !charging)
+		return GC_WINDOW_BUSY;
+	if (!screen_off || !charging)
+		return GC_WINDOW_NORMAL;
+
+	if (!time_after(jiffies, sbi->last_time[REQ_TIME] +
+				msecs_to_jiffies(gc_th->idle_window_ms)))
+		return GC_WINDOW_NORMAL;
+
+#if defined(VENDOR_EDIT) && defined(CONFIG_UFSTW)
+	/*
+	 * Migrated blocks would either fill the TurboWrite buffer or keep
+	 * the device from flushing it, so let the flush finish first.
+	 */
+	if (bdev_turbo_write_busy(sbi->sb->s_bdev))
+		return GC_WINDOW_NORMAL;
+#endif
+	return GC_WINDOW_IDLE;
+}
+
 static inline bool of2fs_gc_wait(struct f2fs_sb_info *sbi, wait_queue_head_t *wq, unsigned int *wait_ms)
 {
 	struct f2fs_gc_kthread *gc_th = sbi->gc_thread;
@@ -260,12 +305,35 @@ static int gc_thread_func(void *data)
 		}
 
 		if (!is_idle(sbi, GC_TIME)) {
+			gc_th->in_idle_window = false;
 			increase_sleep_time(gc_th, &wait_ms);
 			up_write(&sbi->gc_lock);
 			stat_io_skip_bggc_count(sbi);
 			goto next;
 		}
 
+		gc_th->in_idle_window = false;
+		if (gc_th->idle_policy) {
+			int window = of2fs_gc_window(sbi);
+
+			gc_th->in_idle_window = window == GC_WINDOW_IDLE;
+
+			/* only space pressure may interfere with the user */
+			if (window == GC_WINDOW_BUSY && !is_gc_perf(sbi)) {
+				wait_ms = gc_th->max_sleep_time;
+				gc_th->idle_busy_skips++;
+				up_write(&sbi->gc_lock);
+				stat_other_skip_bggc_count(sbi);
+				goto next;
+			}
+
+			if (window == GC_WINDOW_IDLE) {
+				wait_ms = gc_th->urgent_sleep_time;
+				gc_th->idle_window_runs++;
+				goto do_gc;
+			}
+		}
+
 		if (has_enough_invalid_blocks(sbi))
 			decrease_sleep_time(gc_th, &wait_ms);
 		else
@@ -310,6 +378,12 @@ int f2fs_start_gc_thread(struct f2fs_sb_info *sbi)
 
 	gc_th->gc_wake= 0;
 
+	gc_th->idle_policy = GC_IDLE_POLICY_OFF;
+	gc_th->idle_window_ms = DEF_GC_THREAD_IDLE_WINDOW;
+	gc_th->in_idle_window = false;
+	gc_th->idle_busy_skips = 0;
+	gc_th->idle_window_runs = 0;
+
 	gc_th->root = RB_ROOT;
 	INIT_LIST_HEAD(&gc_th->victim_list);
 	gc_th->victim_count = 0;
@@ -364,6 +438,10 @@ static int select_gc_type(struct f2fs_sb_info *sbi, int gc_type)
 		gc_mode = GC_AT;
 		break;
 	}
+
+	/* reclaim as much as possible while nobody is watching */
+	if (sbi->gc_thread && sbi->gc_thread->in_idle_window)
+		gc_mode = GC_GREEDY;
 	return gc_mode;
 }
 
@@ -1997,17 +2075,92 @@ int f2fs_gc(struct f2fs_sb_info *sbi, bool sync,
 	return ret;
 }
 
+#ifdef CONFIG_POWER_SUPPLY
+static void gc_charger_work_fn(struct work_struct *work)
+{
+	struct power_supply *psy = power_supply_get_by_name("battery");
+	union power_supply_propval val;
+
+	if (!psy)
+		return;
+
+	if (!power_supply_get_property(psy, POWER_SUPPLY_PROP_STATUS, &val))
+		WRITE_ONCE(gc_charging,
+			   val.intval == POWER_SUPPLY_STATUS_CHARGING ||
+			   val.intval == POWER_SUPPLY_STATUS_FULL);
+	power_supply_put(psy);
+}
+
+static DECLARE_WORK(gc_charger_work, gc_charger_work_fn);
+
+/* called from an atomic notifier chain, query the battery from a work */
+static int gc_psy_notifier_cb(struct notifier_block *nb,
+				unsigned long event, void *data)
+{
+	struct power_supply *psy = data;
+
+	if (event == PSY_EVENT_PROP_CHANGED &&
+			psy->desc->type == POWER_SUPPLY_TYPE_BATTERY)
+		schedule_work(&gc_charger_work);
+	return NOTIFY_OK;
+}
+
+static struct notifier_block gc_psy_notifier = {
+	.notifier_call = gc_psy_notifier_cb,
+};
+#endif
+
+static int gc_drm_notifier_cb(struct notifier_block *nb,
+				unsigned long action, void *data)
+{
+	struct msm_drm_notifier *evdata = data;
+	int *blank = evdata->data;
+
+	if (action == MSM_DRM_EVENT_BLANK)
+		WRITE_ONCE(gc_screen_off, *blank != MSM_DRM_BLANK_UNBLANK);
+	return NOTIFY_OK;
+}
+
+static struct notifier_block gc_drm_notifier = {
+	.notifier_call = gc_drm_notifier_cb,
+};
+
+static void gc_register_state_notifiers(void)
+{
+#ifdef CONFIG_POWER_SUPPLY
+	if (power_supply_reg_notifier(&gc_psy_notifier))
+		gc_psy_notifier.notifier_call = NULL;
+	else
+		schedule_work(&gc_charger_work);
+#endif
+	if (msm_drm_register_client(&gc_drm_notifier))
+		gc_drm_notifier.notifier_call = NULL;
+}
+
+static void gc_unregister_state_notifiers(void)
+{
+#ifdef CONFIG_POWER_SUPPLY
+	if (gc_psy_notifier.notifier_call)
+		power_supply_unreg_notifier(&gc_psy_notifier);
+	cancel_work_sync(&gc_charger_work);
+#endif
+	if (gc_drm_notifier.notifier_call)
+		msm_drm_unregister_client(&gc_drm_notifier);
+}
+
 int __init create_garbage_collection_cache(void)
 {
 	victim_entry_slab = f2fs_kmem_cache_create("victim_entry",
 					sizeof(struct victim_entry));
 	if (!victim_entry_slab)
 		return -ENOMEM;
+	gc_register_state_notifiers();
 	return 0;
 }
 
 void destroy_garbage_collection_cache(void)
 {
+	gc_unregister_state_notifiers();
 	kmem_cache_destroy(victim_entry_slab);
 }
 
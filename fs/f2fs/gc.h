@@ -14,6 +14,13 @@
 #define DEF_GC_THREAD_MIN_SLEEP_TIME	30000	/* milliseconds */
 #define DEF_GC_THREAD_MAX_SLEEP_TIME	60000
 #define DEF_GC_THREAD_NOGC_SLEEP_TIME	300000	/* wait 5 min */
+#define DEF_GC_THREAD_IDLE_WINDOW	(5 * 60 * 1000)	/* 5 min w/o user I/O */
+
+/* gc_idle_policy */
+enum {
+	GC_IDLE_POLICY_OFF,	/* fixed sleep intervals */
+	GC_IDLE_POLICY_ON,	/* follow screen, charger and I/O idleness */
+};
 
 /* choose candidates from sections which has age of more than 1 day */
 #define DEF_GC_THREAD_AGE_THRESHOLD	(60 * 60 * 24 * 1)
@@ -46,6 +53,13 @@ struct f2fs_gc_kthread {
 
 	/* for changing gc mode */
 	unsigned int gc_wake;
+
+	/* for gc_idle_policy */
+	unsigned int idle_policy;
+	unsigned int idle_window_ms;	/* I/O quiet time for an idle window */
+	bool in_idle_window;		/* greedy victims, urgent sleep time */
+	unsigned int idle_busy_skips;
+	unsigned int idle_window_runs;
 	/* for GC_AT */
 	struct rb_root root;		/* root of victim rb-tree */
 	struct list_head victim_list;	/* linked with all victim entries */
@@ -1767,7 +1767,8 @@ int f2fs_fsync_node_pages(struct f2fs_sb_info *sbi, struct inode *inode,
 		goto retry;
 	}
 out:
-	if (nwritten)
+	/* a batched fsync leaves the node bio to the group commit */
+	if (nwritten && (atomic || !f2fs_fsync_batch_enabled(sbi)))
 		f2fs_submit_merged_write_cond(sbi, NULL, NULL, ino, NODE);
 	return ret ? -EIO: 0;
 }
@@ -892,6 +892,71 @@ int f2fs_issue_flush(struct f2fs_sb_info *sbi, nid_t ino)
 	return cmd.ret;
 }
 
+/*
+ * Group commit for fsync. Each fsync queues itself and the first one to
+ * find no leader running commits everything queued so far: one submit of
+ * the merged node bio, one wait up to the highest node seq_id, and one
+ * cache flush. fsyncs arriving meanwhile queue up for the next leader.
+ */
+int f2fs_fsync_batch_commit(struct f2fs_sb_info *sbi, nid_t ino,
+			unsigned int seq_id, bool need_flush)
+{
+	struct flush_cmd_control *fcc = SM_I(sbi)->fcc_info;
+	struct fsync_batch_cmd cmd = {
+		.seq_id = seq_id,
+		.need_flush = need_flush,
+	};
+	struct fsync_batch_cmd *tmp, *next;
+	LIST_HEAD(batch);
+	unsigned int members, max_seq_id;
+	bool flush;
+	int ret;
+
+	spin_lock(&fcc->fsync_lock);
+	list_add_tail(&cmd.list, &fcc->fsync_list);
+	while (!cmd.done) {
+		if (fcc->fsync_leading) {
+			spin_unlock(&fcc->fsync_lock);
+			wait_event(fcc->fsync_wait_queue, READ_ONCE(cmd.done) ||
+					!READ_ONCE(fcc->fsync_leading));
+			spin_lock(&fcc->fsync_lock);
+			continue;
+		}
+
+		fcc->fsync_leading = true;
+		list_splice_init(&fcc->fsync_list, &batch);
+		spin_unlock(&fcc->fsync_lock);
+
+		members = 0;
+		max_seq_id = 0;
+		flush = false;
+		list_for_each_entry(tmp, &batch, list) {
+			members++;
+			max_seq_id = max(max_seq_id, tmp->seq_id);
+			flush |= tmp->need_flush;
+		}
+
+		f2fs_submit_merged_write(sbi, NODE);
+		ret = f2fs_wait_on_node_pages_writeback(sbi, max_seq_id);
+		if (!ret && flush)
+			ret = f2fs_issue_flush(sbi, ino);
+
+		spin_lock(&fcc->fsync_lock);
+		list_for_each_entry_safe(tmp, next, &batch, list) {
+			list_del(&tmp->list);
+			tmp->ret = ret;
+			tmp->done = true;
+		}
+		fcc->fsync_leading = false;
+		fcc->fsync_groups++;
+		fcc->fsync_members += members;
+		wake_up_all(&fcc->fsync_wait_queue);
+	}
+	spin_unlock(&fcc->fsync_lock);
+
+	return cmd.ret;
+}
+
 int f2fs_create_flush_cmd_control(struct f2fs_sb_info *sbi)
 {
 	dev_t dev = sbi->sb->s_bdev->bd_dev;
@@ -912,6 +977,9 @@ int f2fs_create_flush_cmd_control(struct f2fs_sb_info *sbi)
 	atomic_set(&fcc->queued_flush, 0);
 	init_waitqueue_head(&fcc->flush_wait_queue);
 	init_llist_head(&fcc->issue_list);
+	spin_lock_init(&fcc->fsync_lock);
+	init_waitqueue_head(&fcc->fsync_wait_queue);
+	INIT_LIST_HEAD(&fcc->fsync_list);
 	SM_I(sbi)->fcc_info = fcc;
 	if (!test_opt(sbi, FLUSH_MERGE))
 		return err;
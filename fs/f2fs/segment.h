@@ -930,6 +930,17 @@ static inline void wake_up_discard_thread_aggressive(struct f2fs_sb_info *sbi,
 	dcc->discard_wake = policy;
 	wake_up_interruptible_all(&dcc->discard_wait_queue);
 }
+
+/*
+ * fsyncs are grouped only on a single device, as the flush of a batch
+ * can't tell which devices the other inodes of the batch have dirtied.
+ */
+static inline bool f2fs_fsync_batch_enabled(struct f2fs_sb_info *sbi)
+{
+	return READ_ONCE(sbi->fsync_batch) && SM_I(sbi)->fcc_info &&
+					!f2fs_is_multi_device(sbi);
+}
+
 static inline int check_io_seq(int blks)
 {
 	if (blks >= SSR_CONTIG_LARGE)
@@ -3101,6 +3101,11 @@ static void init_sb_info(struct f2fs_sb_info *sbi)
 
 	sbi->dir_level = DEF_DIR_LEVEL;
 	sbi->readdir_ra = 0;
+	sbi->extent_ra_pages = min_t(unsigned int, BIO_MAX_PAGES,
+		queue_max_sectors(bdev_get_queue(sbi->sb->s_bdev)) >>
+							(PAGE_SHIFT - 9));
+	sbi->compress_batch = min_t(unsigned int, num_online_cpus(),
+						F2FS_COMPRESS_BATCH_MAX);
 	sbi->interval_time[CP_TIME] = DEF_CP_INTERVAL;
 	sbi->interval_time[REQ_TIME] = DEF_IDLE_INTERVAL;
 	sbi->interval_time[DISCARD_TIME] = DEF_IDLE_INTERVAL;
@@ -61,6 +61,69 @@ static ssize_t fuse_conn_waiting_read(struct file *file, char __user *buf,
 	return simple_read_from_buffer(buf, len, ppos, tmp, size);
 }
 
+static const char * const fuse_splice_stat_names[FUSE_SPLICE_NR_STATS] = {
+	[FUSE_SPLICE_IN_COPIED]		= "in_copied",
+	[FUSE_SPLICE_IN_SPLICED]	= "in_spliced",
+	[FUSE_SPLICE_OUT_COPIED]	= "out_copied",
+	[FUSE_SPLICE_OUT_MOVED]		= "out_moved",
+};
+
+/* Bytes of page data passed through the device, one line per way */
+static ssize_t fuse_conn_splice_read(struct file *file, char __user *buf,
+				     size_t len, loff_t *ppos)
+{
+	char tmp[FUSE_SPLICE_NR_STATS * 40];
+	size_t size = 0;
+	struct fuse_conn *fc;
+	int i;
+
+	fc = fuse_ctl_file_conn_get(file);
+	if (!fc)
+		return 0;
+
+	for (i = 0; i < FUSE_SPLICE_NR_STATS; i++)
+		size += sprintf(tmp + size, "%s %ld\n",
+				fuse_splice_stat_names[i],
+				atomic_long_read(&fc->splice_stats[i]));
+	fuse_conn_put(fc);
+
+	return simple_read_from_buffer(buf, len, ppos, tmp, size);
+}
+
+#ifdef VENDOR_EDIT
+static const char * const fuse_sc_stat_names[FUSE_SC_NR_STATS] = {
+	[FUSE_SC_READ]		= "read",
+	[FUSE_SC_WRITE]		= "write",
+	[FUSE_SC_MMAP]		= "mmap",
+	[FUSE_SC_GETATTR]	= "getattr",
+	[FUSE_SC_LOOKUP]	= "lookup",
+	[FUSE_SC_READDIR]	= "readdir",
+};
+
+/* One line per operation: name, served by lower files, sent to userspace */
+static ssize_t fuse_conn_shortcircuit_read(struct file *file, char __user *buf,
+					   size_t len, loff_t *ppos)
+{
+	char tmp[FUSE_SC_NR_STATS * 56];
+	size_t size = 0;
+	struct fuse_conn *fc;
+	int i;
+
+	fc = fuse_ctl_file_conn_get(file);
+	if (!fc)
+		return 0;
+
+	for (i = 0; i < FUSE_SC_NR_STATS; i++)
+		size += sprintf(tmp + size, "%s %ld %ld\n",
+				fuse_sc_stat_names[i],
+				atomic_long_read(&fc->sc_bypassed[i]),
+				atomic_long_read(&fc->sc_forwarded[i]));
+	fuse_conn_put(fc);
+
+	return simple_read_from_buffer(buf, len, ppos, tmp, size);
+}
+#endif /* VENDOR_EDIT */
+
 static ssize_t fuse_conn_limit_read(struct file *file, char __user *buf,
 				    size_t len, loff_t *ppos, unsigned val)
 {
@@ -196,6 +259,20 @@ static const struct file_operations fuse_conn_congestion_threshold_ops = {
 	.llseek = no_llseek,
 };
 
+static const struct file_operations fuse_conn_splice_ops = {
+	.open = nonseekable_open,
+	.read = fuse_conn_splice_read,
+	.llseek = no_llseek,
+};
+
+#ifdef VENDOR_EDIT
+static const struct file_operations fuse_conn_shortcircuit_ops = {
+	.open = nonseekable_open,
+	.read = fuse_conn_shortcircuit_read,
+	.llseek = no_llseek,
+};
+#endif /* VENDOR_EDIT */
+
 static struct dentry *fuse_ctl_add_dentry(struct dentry *parent,
 					  struct fuse_conn *fc,
 					  const char *name,
@@ -264,8 +341,15 @@ int fuse_ctl_add_conn(struct fuse_conn *fc)
 				 1, NULL, &fuse_conn_max_background_ops) ||
 	    !fuse_ctl_add_dentry(parent, fc, "congestion_threshold",
 				 S_IFREG | 0600, 1, NULL,
-				 &fuse_conn_congestion_threshold_ops))
+				 &fuse_conn_congestion_threshold_ops) ||
+	    !fuse_ctl_add_dentry(parent, fc, "splice", S_IFREG | 0400, 1,
+				 NULL, &fuse_conn_splice_ops))
+		goto err;
+#ifdef VENDOR_EDIT
+	if (!fuse_ctl_add_dentry(parent, fc, "shortcircuit", S_IFREG | 0400,
+				 1, NULL, &fuse_conn_shortcircuit_ops))
 		goto err;
+#endif /* VENDOR_EDIT */
 
 	return 0;
 
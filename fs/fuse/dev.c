@@ -33,6 +33,12 @@ MODULE_ALIAS("devname:fuse");
 
 static struct kmem_cache *fuse_req_cachep;
 
+static bool splice_move = true;
+module_param(splice_move, bool, 0644);
+MODULE_PARM_DESC(splice_move,
+ "Move pages of spliced replies into the page cache even if the "
+ "filesystem daemon didn't ask for SPLICE_F_MOVE");
+
 static struct fuse_dev *fuse_get_dev(struct file *file)
 {
 	/*
@@ -322,13 +328,55 @@ static unsigned len_args(unsigned numargs, struct fuse_arg *args)
 
 static u64 fuse_get_unique(struct fuse_iqueue *fiq)
 {
-	return ++fiq->reqctr;
+	fiq->reqctr += FUSE_IQ_ID_STEP;
+	return fiq->reqctr;
+}
+
+/*
+ * Lock the input queue for a request sent from this CPU: the CPU's channel
+ * if a device reads it, fc->iq otherwise.
+ */
+static struct fuse_iqueue *fuse_lock_send_iq(struct fuse_conn *fc)
+{
+	struct fuse_iqueue *fiq;
+
+	fiq = READ_ONCE(fc->cpu_iq[raw_smp_processor_id()]);
+	if (fiq) {
+		spin_lock(&fiq->lock);
+		if (fiq->nr_devs)
+			return fiq;
+		spin_unlock(&fiq->lock);
+	}
+
+	fiq = &fc->iq;
+	spin_lock(&fiq->lock);
+	return fiq;
+}
+
+/* Lock the input queue @req was sent on, or fc->iq if it wasn't sent yet */
+static struct fuse_iqueue *fuse_lock_req_iq(struct fuse_conn *fc,
+					    struct fuse_req *req)
+{
+	struct fuse_iqueue *fiq;
+
+	for (;;) {
+		fiq = READ_ONCE(req->iq) ?: &fc->iq;
+		spin_lock(&fiq->lock);
+		if (fiq == (READ_ONCE(req->iq) ?: &fc->iq))
+			return fiq;
+		spin_unlock(&fiq->lock);
+	}
 }
 
 static void queue_request(struct fuse_iqueue *fiq, struct fuse_req *req)
 {
 	req->in.h.len = sizeof(struct fuse_in_header) +
 		len_args(req->in.numargs, (struct fuse_arg *) req->in.args);
+	req->iq = fiq;
+#ifdef VENDOR_EDIT
+	fuse_shortcircuit_count_forward(container_of(fiq, struct fuse_conn, iq),
+					req->in.h.opcode);
+#endif /* VENDOR_EDIT */
 	list_add_tail(&req->list, &fiq->pending);
 	wake_up(&fiq->waitq);
 	kill_fasync(&fiq->fasync, SIGIO, POLL_IN);
@@ -359,12 +407,12 @@ static void flush_bg_queue(struct fuse_conn *fc)
 	while (fc->active_background < fc->max_background &&
 	       !list_empty(&fc->bg_queue)) {
 		struct fuse_req *req;
-		struct fuse_iqueue *fiq = &fc->iq;
+		struct fuse_iqueue *fiq;
 
 		req = list_entry(fc->bg_queue.next, struct fuse_req, list);
 		list_del(&req->list);
 		fc->active_background++;
-		spin_lock(&fiq->lock);
+		fiq = fuse_lock_send_iq(fc);
 		req->in.h.unique = fuse_get_unique(fiq);
 		queue_request(fiq, req);
 		spin_unlock(&fiq->lock);
@@ -381,12 +429,12 @@ static void flush_bg_queue(struct fuse_conn *fc)
  */
 static void request_end(struct fuse_conn *fc, struct fuse_req *req)
 {
-	struct fuse_iqueue *fiq = &fc->iq;
+	struct fuse_iqueue *fiq;
 
 	if (test_and_set_bit(FR_FINISHED, &req->flags))
 		goto put_request;
 
-	spin_lock(&fiq->lock);
+	fiq = fuse_lock_req_iq(fc, req);
 	list_del_init(&req->intr_entry);
 	spin_unlock(&fiq->lock);
 	WARN_ON(test_bit(FR_PENDING, &req->flags));
@@ -424,9 +472,10 @@ static void request_end(struct fuse_conn *fc, struct fuse_req *req)
 	fuse_put_request(fc, req);
 }
 
-static void queue_interrupt(struct fuse_iqueue *fiq, struct fuse_req *req)
+static void queue_interrupt(struct fuse_conn *fc, struct fuse_req *req)
 {
-	spin_lock(&fiq->lock);
+	struct fuse_iqueue *fiq = fuse_lock_req_iq(fc, req);
+
 	if (test_bit(FR_FINISHED, &req->flags)) {
 		spin_unlock(&fiq->lock);
 		return;
@@ -441,7 +490,7 @@ static void queue_interrupt(struct fuse_iqueue *fiq, struct fuse_req *req)
 
 static void request_wait_answer(struct fuse_conn *fc, struct fuse_req *req)
 {
-	struct fuse_iqueue *fiq = &fc->iq;
+	struct fuse_iqueue *fiq;
 	int err;
 
 	if (!fc->no_interrupt) {
@@ -455,7 +504,7 @@ static void request_wait_answer(struct fuse_conn *fc, struct fuse_req *req)
 		/* matches barrier in fuse_dev_do_read() */
 		smp_mb__after_atomic();
 		if (test_bit(FR_SENT, &req->flags))
-			queue_interrupt(fiq, req);
+			queue_interrupt(fc, req);
 	}
 
 	if (!test_bit(FR_FORCE, &req->flags)) {
@@ -465,7 +514,7 @@ static void request_wait_answer(struct fuse_conn *fc, struct fuse_req *req)
 		if (!err)
 			return;
 
-		spin_lock(&fiq->lock);
+		fiq = fuse_lock_req_iq(fc, req);
 		/* Request is not yet in userspace, bail out */
 		if (test_bit(FR_PENDING, &req->flags)) {
 			list_del(&req->list);
@@ -488,10 +537,10 @@ static void request_wait_answer(struct fuse_conn *fc, struct fuse_req *req)
 
 static void __fuse_request_send(struct fuse_conn *fc, struct fuse_req *req)
 {
-	struct fuse_iqueue *fiq = &fc->iq;
+	struct fuse_iqueue *fiq;
 
 	BUG_ON(test_bit(FR_BACKGROUND, &req->flags));
-	spin_lock(&fiq->lock);
+	fiq = fuse_lock_send_iq(fc);
 	if (!fiq->connected) {
 		spin_unlock(&fiq->lock);
 		req->out.h.error = -ENOTCONN;
@@ -712,6 +761,7 @@ static int unlock_request(struct fuse_req *req)
 
 struct fuse_copy_state {
 	int write;
+	struct fuse_conn *fc;
 	struct fuse_req *req;
 	struct iov_iter *iter;
 	struct pipe_buffer *pipebufs;
@@ -814,6 +864,13 @@ static int fuse_copy_fill(struct fuse_copy_state *cs)
 	return lock_request(cs->req);
 }
 
+static void fuse_copy_stat(struct fuse_copy_state *cs,
+			   enum fuse_splice_stat stat, unsigned nbytes)
+{
+	if (cs->fc)
+		atomic_long_add(nbytes, &cs->fc->splice_stats[stat]);
+}
+
 /* Do as much copy to/from userspace buffer as we can */
 static int fuse_copy_do(struct fuse_copy_state *cs, void **val, unsigned *size)
 {
@@ -988,6 +1045,7 @@ static int fuse_ref_page(struct fuse_copy_state *cs, struct page *page,
 	cs->pipebufs++;
 	cs->nr_segs++;
 	cs->len = 0;
+	fuse_copy_stat(cs, FUSE_SPLICE_IN_SPLICED, count);
 
 	return 0;
 }
@@ -1022,6 +1080,10 @@ static int fuse_copy_page(struct fuse_copy_state *cs, struct page **pagep,
 			if (cs->move_pages && page &&
 			    offset == 0 && count == PAGE_SIZE) {
 				err = fuse_try_move_page(cs, pagep);
+				if (!err)
+					fuse_copy_stat(cs,
+						       FUSE_SPLICE_OUT_MOVED,
+						       PAGE_SIZE);
 				if (err <= 0)
 					return err;
 			} else {
@@ -1033,8 +1095,12 @@ static int fuse_copy_page(struct fuse_copy_state *cs, struct page **pagep,
 		if (page) {
 			void *mapaddr = kmap_atomic(page);
 			void *buf = mapaddr + offset;
-			offset += fuse_copy_do(cs, &buf, &count);
+			unsigned ncpy = fuse_copy_do(cs, &buf, &count);
+
 			kunmap_atomic(mapaddr);
+			offset += ncpy;
+			fuse_copy_stat(cs, cs->write ? FUSE_SPLICE_IN_COPIED :
+				       FUSE_SPLICE_OUT_COPIED, ncpy);
 		} else
 			offset += fuse_copy_do(cs, NULL, &count);
 	}
@@ -1276,12 +1342,13 @@ static ssize_t fuse_dev_do_read(struct fuse_dev *fud, struct file *file,
 {
 	ssize_t err;
 	struct fuse_conn *fc = fud->fc;
-	struct fuse_iqueue *fiq = &fc->iq;
+	struct fuse_iqueue *fiq = fud->iq;
 	struct fuse_pqueue *fpq = &fud->pq;
 	struct fuse_req *req;
 	struct fuse_in *in;
 	unsigned reqsize;
 
+	cs->fc = fc;
  restart:
 	for (;;) {
 		spin_lock(&fiq->lock);
@@ -1378,7 +1445,7 @@ static ssize_t fuse_dev_do_read(struct fuse_dev *fud, struct file *file,
 	/* matches barrier in request_wait_answer() */
 	smp_mb__after_atomic();
 	if (test_bit(FR_INTERRUPTED, &req->flags))
-		queue_interrupt(fiq, req);
+		queue_interrupt(fc, req);
 	fuse_put_request(fc, req);
 
 	return reqsize;
@@ -1907,6 +1974,8 @@ static ssize_t fuse_dev_do_write(struct fuse_dev *fud,
 	if (nbytes < sizeof(struct fuse_out_header))
 		return -EINVAL;
 
+	cs->fc = fc;
+
 	err = fuse_copy_one(cs, &oh, sizeof(oh));
 	if (err)
 		goto err_finish;
@@ -1951,7 +2020,7 @@ static ssize_t fuse_dev_do_write(struct fuse_dev *fud,
 		if (oh.error == -ENOSYS)
 			fc->no_interrupt = 1;
 		else if (oh.error == -EAGAIN)
-			queue_interrupt(&fc->iq, req);
+			queue_interrupt(fc, req);
 		fuse_put_request(fc, req);
 
 		fuse_copy_finish(cs);
@@ -2085,7 +2154,7 @@ static ssize_t fuse_dev_splice_write(struct pipe_inode_info *pipe,
 	cs.nr_segs = nbuf;
 	cs.pipe = pipe;
 
-	if (flags & SPLICE_F_MOVE)
+	if ((flags & SPLICE_F_MOVE) || READ_ONCE(splice_move))
 		cs.move_pages = 1;
 
 	ret = fuse_dev_do_write(fud, &cs, len);
@@ -2113,7 +2182,7 @@ static unsigned fuse_dev_poll(struct file *file, poll_table *wait)
 	if (!fud)
 		return POLLERR;
 
-	fiq = &fud->fc->iq;
+	fiq = fud->iq;
 	poll_wait(file, &fiq->waitq, wait);
 
 	spin_lock(&fiq->lock);
@@ -2179,6 +2248,7 @@ static void end_polls(struct fuse_conn *fc)
 void fuse_abort_conn(struct fuse_conn *fc)
 {
 	struct fuse_iqueue *fiq = &fc->iq;
+	int cpu;
 
 	spin_lock(&fc->lock);
 	if (fc->connected) {
@@ -2212,6 +2282,19 @@ void fuse_abort_conn(struct fuse_conn *fc)
 		fc->max_background = UINT_MAX;
 		flush_bg_queue(fc);
 
+		for (cpu = 0; cpu < NR_CPUS; cpu++) {
+			struct fuse_iqueue *chan = fc->cpu_iq[cpu];
+
+			if (!chan)
+				continue;
+			spin_lock(&chan->lock);
+			chan->connected = 0;
+			list_splice_init(&chan->pending, &to_end2);
+			wake_up_all(&chan->waitq);
+			spin_unlock(&chan->lock);
+			kill_fasync(&chan->fasync, SIGIO, POLL_IN);
+		}
+
 		spin_lock(&fiq->lock);
 		fiq->connected = 0;
 		list_splice_init(&fiq->pending, &to_end2);
@@ -2245,6 +2328,47 @@ void fuse_wait_aborted(struct fuse_conn *fc)
 	wait_event(fc->blocked_waitq, atomic_read(&fc->num_waiting) == 0);
 }
 
+/*
+ * Stop reading the per-CPU channel @fud is bound to.  When it was the last
+ * device of the channel, the requests still queued there are moved to the
+ * main queue, which the CPU's requests go to from now on.
+ */
+static void fuse_dev_unbind(struct fuse_dev *fud)
+{
+	struct fuse_conn *fc = fud->fc;
+	struct fuse_iqueue *chan = fud->iq;
+	struct fuse_iqueue *fiq = &fc->iq;
+	struct fuse_req *req;
+	bool moved = false;
+
+	if (chan == fiq)
+		return;
+
+	spin_lock(&fc->lock);
+	fc->nr_bound_devs--;
+	fud->iq = fiq;
+	spin_unlock(&fc->lock);
+
+	spin_lock(&chan->lock);
+	if (!--chan->nr_devs) {
+		spin_lock(&fiq->lock);
+		list_for_each_entry(req, &chan->pending, list)
+			req->iq = fiq;
+		list_for_each_entry(req, &chan->interrupts, intr_entry)
+			req->iq = fiq;
+		moved = request_pending(chan);
+		list_splice_tail_init(&chan->pending, &fiq->pending);
+		list_splice_tail_init(&chan->interrupts, &fiq->interrupts);
+		if (moved)
+			wake_up_all(&fiq->waitq);
+		spin_unlock(&fiq->lock);
+	}
+	spin_unlock(&chan->lock);
+
+	if (moved)
+		kill_fasync(&fiq->fasync, SIGIO, POLL_IN);
+}
+
 int fuse_dev_release(struct inode *inode, struct file *file)
 {
 	struct fuse_dev *fud = fuse_get_dev(file);
@@ -2254,6 +2378,8 @@ int fuse_dev_release(struct inode *inode, struct file *file)
 		struct fuse_pqueue *fpq = &fud->pq;
 		LIST_HEAD(to_end);
 
+		fuse_dev_unbind(fud);
+
 		spin_lock(&fpq->lock);
 		WARN_ON(!list_empty(&fpq->io));
 		list_splice_init(&fpq->processing, &to_end);
@@ -2280,7 +2406,7 @@ static int fuse_dev_fasync(int fd, struct file *file, int on)
 		return -EPERM;
 
 	/* No locking - fasync_helper does its own locking */
-	return fasync_helper(fd, file, on, &fud->fc->iq.fasync);
+	return fasync_helper(fd, file, on, &fud->iq->fasync);
 }
 
 static int fuse_device_clone(struct fuse_conn *fc, struct file *new)
@@ -2300,6 +2426,57 @@ static int fuse_device_clone(struct fuse_conn *fc, struct file *new)
 	return 0;
 }
 
+/*
+ * Make @fud read only the requests sent from @cpu.  Requests from CPUs
+ * without a bound device, forgets and notify replies stay on the main
+ * queue, so at least one device of the connection has to remain unbound.
+ */
+static int fuse_dev_bind_cpu(struct fuse_dev *fud, u32 cpu)
+{
+	struct fuse_conn *fc = fud->fc;
+	struct fuse_iqueue *chan, *new = NULL;
+	int err = 0;
+
+	if (cpu >= nr_cpu_ids || !cpu_possible(cpu))
+		return -EINVAL;
+
+	if (!READ_ONCE(fc->cpu_iq[cpu])) {
+		new = kmalloc(sizeof(*new), GFP_KERNEL);
+		if (!new)
+			return -ENOMEM;
+		fuse_iqueue_init(new);
+		new->reqctr = cpu + 1;
+	}
+
+	spin_lock(&fc->lock);
+	err = -ENOTCONN;
+	if (!fc->connected)
+		goto out_unlock;
+	err = -EBUSY;
+	if (fud->iq != &fc->iq ||
+	    fc->nr_bound_devs + 1 >= atomic_read(&fc->dev_count))
+		goto out_unlock;
+
+	chan = fc->cpu_iq[cpu];
+	if (!chan) {
+		chan = new;
+		new = NULL;
+		smp_store_release(&fc->cpu_iq[cpu], chan);
+	}
+	fc->nr_bound_devs++;
+	spin_lock(&chan->lock);
+	chan->nr_devs++;
+	spin_unlock(&chan->lock);
+	fud->iq = chan;
+	err = 0;
+
+ out_unlock:
+	spin_unlock(&fc->lock);
+	kfree(new);
+
+	return err;
+}
+
 static long fuse_dev_ioctl(struct file *file, unsigned int cmd,
 			   unsigned long arg)
 {
@@ -2332,6 +2509,16 @@ static long fuse_dev_ioctl(struct file *file, unsigned int cmd,
 				fput(old);
 			}
 		}
+	} else if (cmd == FUSE_DEV_IOC_BIND_CPU) {
+		struct fuse_dev *fud = fuse_get_dev(file);
+		u32 cpu;
+
+		err = -EPERM;
+		if (fud) {
+			err = -EFAULT;
+			if (!get_user(cpu, (__u32 __user *) arg))
+				err = fuse_dev_bind_cpu(fud, cpu);
+		}
 	}
 	return err;
 }
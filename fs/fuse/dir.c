@@ -7,6 +7,9 @@
 */
 
 #include "fuse_i.h"
+#ifdef VENDOR_EDIT
+#include "fuse_shortcircuit.h"
+#endif /* VENDOR_EDIT */
 
 #include <linux/pagemap.h>
 #include <linux/file.h>
@@ -1170,6 +1173,10 @@ static int fuse_update_get_attr(struct inode *inode, struct file *file,
 	int err = 0;
 
 	if (time_before64(fi->i_time, get_jiffies_64())) {
+#ifdef VENDOR_EDIT
+		if (!fuse_shortcircuit_getattr(inode, stat))
+			return 0;
+#endif /* VENDOR_EDIT */
 		forget_all_cached_acls(inode);
 		err = fuse_do_getattr(inode, stat, file);
 	} else if (stat) {
@@ -88,6 +88,7 @@ struct fuse_file *fuse_file_alloc(struct fuse_conn *fc)
 #ifdef VENDOR_EDIT
 //shubin@BSP.Kernel.FS 2020/08/20 improving fuse storage performance
 	ff->rw_lower_file = NULL;
+	INIT_LIST_HEAD(&ff->sc_entry);
 #endif /* VENDOR_EDIT */
 	ff->fc = fc;
 	ff->reserved_req = fuse_request_alloc(0);
@@ -223,6 +224,9 @@ void fuse_finish_open(struct inode *inode, struct file *file)
 		file->f_op = &fuse_direct_io_file_operations;
 	if (!(ff->open_flags & FOPEN_KEEP_CACHE))
 		invalidate_inode_pages2(inode->i_mapping);
+#ifdef VENDOR_EDIT
+	fuse_shortcircuit_open(inode, ff);
+#endif /* VENDOR_EDIT */
 	if (ff->open_flags & FOPEN_STREAM)
 		stream_open(inode, file);
 	else if (ff->open_flags & FOPEN_NONSEEKABLE)
@@ -2170,6 +2174,13 @@ static const struct vm_operations_struct fuse_file_vm_ops = {
 
 static int fuse_file_mmap(struct file *file, struct vm_area_struct *vma)
 {
+#ifdef VENDOR_EDIT
+	struct fuse_file *ff = file->private_data;
+
+	if (ff->rw_lower_file && !fuse_shortcircuit_mmap(file, vma))
+		return 0;
+	atomic_long_inc(&ff->fc->sc_forwarded[FUSE_SC_MMAP]);
+#endif /* VENDOR_EDIT */
 	if ((vma->vm_flags & VM_SHARED) && (vma->vm_flags & VM_MAYWRITE))
 		fuse_link_write_file(file);
 
@@ -37,7 +37,10 @@
 #define FUSE_NAME_MAX 1024
 
 /** Number of dentries for each connection in the control filesystem */
-#define FUSE_CTL_NUM_DENTRIES 5
+#define FUSE_CTL_NUM_DENTRIES 7
+
+/** Stride of request ids, so that each input queue has its own ids */
+#define FUSE_IQ_ID_STEP (NR_CPUS + 1)
 
 /** Number of page pointers embedded in fuse_req */
 #define FUSE_REQ_INLINE_PAGES 1
@@ -107,6 +110,11 @@ struct fuse_inode {
 
 	/** Lock for serializing lookup and readdir for back compatibility*/
 	struct mutex mutex;
+
+#ifdef VENDOR_EDIT
+	/** Open files with a lower file.  Protected by fc->lock */
+	struct list_head sc_files;
+#endif /* VENDOR_EDIT */
 };
 
 /** FUSE inode state bits */
@@ -123,6 +131,30 @@ enum {
 
 struct fuse_conn;
 
+/** Bytes of page data passed through /dev/fuse, by how they were passed */
+enum fuse_splice_stat {
+	/** Requests to userspace, copied or referenced by the pipe */
+	FUSE_SPLICE_IN_COPIED,
+	FUSE_SPLICE_IN_SPLICED,
+	/** Replies from userspace, copied or moved into the page cache */
+	FUSE_SPLICE_OUT_COPIED,
+	FUSE_SPLICE_OUT_MOVED,
+	FUSE_SPLICE_NR_STATS,
+};
+
+#ifdef VENDOR_EDIT
+/** Requests counted as served by the lower file or sent to userspace */
+enum fuse_sc_stat {
+	FUSE_SC_READ,
+	FUSE_SC_WRITE,
+	FUSE_SC_MMAP,
+	FUSE_SC_GETATTR,
+	FUSE_SC_LOOKUP,
+	FUSE_SC_READDIR,
+	FUSE_SC_NR_STATS,
+};
+#endif /* VENDOR_EDIT */
+
 /** FUSE specific file data */
 struct fuse_file {
 	/** Fuse connection for this file */
@@ -162,6 +194,9 @@ struct fuse_file {
 //shubin@BSP.Kernel.FS 2020/08/20 improving fuse storage performance
 	/* the read write file */
 	struct file *rw_lower_file;
+
+	/** Entry on inode's sc_files list */
+	struct list_head sc_entry;
 #endif /* VENDOR_EDIT */
 };
 
@@ -326,6 +361,10 @@ struct fuse_req {
 	/** Entry on the interrupts list  */
 	struct list_head intr_entry;
 
+	/** Input queue the request was sent on, NULL before that.  Changed
+	    with the locks of the old and new queues held */
+	struct fuse_iqueue *iq;
+
 	/** refcount */
 	refcount_t count;
 
@@ -423,6 +462,9 @@ struct fuse_iqueue {
 	/** The next unique request id */
 	u64 reqctr;
 
+	/** Devices bound to this per-CPU channel, unused on fc->iq */
+	unsigned nr_devs;
+
 	/** The list of pending requests */
 	struct list_head pending;
 
@@ -464,6 +506,9 @@ struct fuse_dev {
 	/** Processing queue */
 	struct fuse_pqueue pq;
 
+	/** Input queue requests are read from, fc->iq unless bound to a CPU */
+	struct fuse_iqueue *iq;
+
 	/** list entry on fc->devices */
 	struct list_head entry;
 };
@@ -505,6 +550,13 @@ struct fuse_conn {
 	/** Input queue */
 	struct fuse_iqueue iq;
 
+	/** Per-CPU channels, see FUSE_DEV_IOC_BIND_CPU.  Set once under
+	    fc->lock and freed with the connection */
+	struct fuse_iqueue *cpu_iq[NR_CPUS];
+
+	/** Number of devices bound to a per-CPU channel */
+	unsigned nr_bound_devs;
+
 	/** The next unique kernel file handle */
 	u64 khctr;
 
@@ -677,9 +729,20 @@ struct fuse_conn {
 	/** Dentries in the control filesystem */
 	struct dentry *ctl_dentry[FUSE_CTL_NUM_DENTRIES];
 
+#ifdef VENDOR_EDIT
+	/** Requests served by lower files, by enum fuse_sc_stat */
+	atomic_long_t sc_bypassed[FUSE_SC_NR_STATS];
+
+	/** Requests sent to userspace, by enum fuse_sc_stat */
+	atomic_long_t sc_forwarded[FUSE_SC_NR_STATS];
+#endif /* VENDOR_EDIT */
+
 	/** number of dentries used in the above array */
 	int ctl_ndents;
 
+	/** Page data passed through the device, by enum fuse_splice_stat */
+	atomic_long_t splice_stats[FUSE_SPLICE_NR_STATS];
+
 	/** Key for lock owner ID scrambling */
 	u32 scramble_key[4];
 
@@ -924,6 +987,11 @@ void fuse_conn_init(struct fuse_conn *fc);
  */
 void fuse_conn_put(struct fuse_conn *fc);
 
+/**
+ * Initialize an input queue
+ */
+void fuse_iqueue_init(struct fuse_iqueue *fiq);
+
 struct fuse_dev *fuse_dev_alloc(struct fuse_conn *fc);
 void fuse_dev_free(struct fuse_dev *fud);
 
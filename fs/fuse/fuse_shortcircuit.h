@@ -30,4 +30,12 @@ ssize_t fuse_shortcircuit_write_iter(struct kiocb *iocb, struct iov_iter *from);
 
 void fuse_shortcircuit_release(struct fuse_file *ff);
 
+void fuse_shortcircuit_open(struct inode *inode, struct fuse_file *ff);
+
+int fuse_shortcircuit_mmap(struct file *file, struct vm_area_struct *vma);
+
+int fuse_shortcircuit_getattr(struct inode *inode, struct kstat *stat);
+
+void fuse_shortcircuit_count_forward(struct fuse_conn *fc, u32 opcode);
+
 #endif /* _FS_FUSE_SHORCIRCUIT_H */
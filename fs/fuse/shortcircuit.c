@@ -17,6 +17,7 @@
 
 #include <linux/aio.h>
 #include <linux/fs_stack.h>
+#include <linux/mm.h>
 #include <linux/sched/signal.h>
 
 void fuse_setup_shortcircuit(struct fuse_conn *fc, struct fuse_req *req)
@@ -77,6 +78,8 @@ static ssize_t fuse_shortcircuit_read_write_iter(struct kiocb *iocb,
 	fuse_inode = fuse_filp->f_path.dentry->d_inode;
 	shortcircuit_inode = file_inode(lower_file);
 	iocb->ki_filp = lower_file;
+	atomic_long_inc(&ff->fc->sc_bypassed[do_write ? FUSE_SC_WRITE :
+							FUSE_SC_READ]);
 	if (do_write) {
 		if (!lower_file->f_op->write_iter)
 			goto out;
@@ -113,7 +116,134 @@ void fuse_shortcircuit_release(struct fuse_file *ff)
 	if (!(ff->rw_lower_file))
 		return;
 
+	spin_lock(&ff->fc->lock);
+	list_del_init(&ff->sc_entry);
+	spin_unlock(&ff->fc->lock);
+
 	/* Release the lower file. */
 	fput(ff->rw_lower_file);
 	ff->rw_lower_file = NULL;
 }
+
+/* Make the lower file of @ff available to fuse_shortcircuit_getattr() */
+void fuse_shortcircuit_open(struct inode *inode, struct fuse_file *ff)
+{
+	struct fuse_conn *fc = get_fuse_conn(inode);
+	struct fuse_inode *fi = get_fuse_inode(inode);
+
+	if (!ff->rw_lower_file)
+		return;
+
+	spin_lock(&fc->lock);
+	if (list_empty(&ff->sc_entry))
+		list_add(&ff->sc_entry, &fi->sc_files);
+	spin_unlock(&fc->lock);
+}
+
+/*
+ * Map the lower file in place of the fuse one, so page faults are served
+ * by the lower filesystem without a round trip through the daemon and
+ * without a second copy of the data in the fuse page cache.
+ */
+int fuse_shortcircuit_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct fuse_file *ff = file->private_data;
+	struct file *lower_file = ff->rw_lower_file;
+	int ret;
+
+	if (!lower_file->f_op->mmap)
+		return -ENODEV;
+
+	if (WARN_ON(file != vma->vm_file))
+		return -EIO;
+
+	vma->vm_file = get_file(lower_file);
+	ret = call_mmap(lower_file, vma);
+	if (ret) {
+		vma->vm_file = file;
+		fput(lower_file);
+		return ret;
+	}
+	fput(file);
+
+	atomic_long_inc(&ff->fc->sc_bypassed[FUSE_SC_MMAP]);
+	fsstack_copy_attr_atime(file_inode(file), file_inode(lower_file));
+
+	return 0;
+}
+
+/*
+ * Refresh size and times of @inode from the lower file of one of its open
+ * files instead of sending FUSE_GETATTR. The daemon doesn't see the IO done
+ * through the lower file, so the lower inode is the more accurate source
+ * for those anyway. Ownership and mode are kept from the last getattr.
+ *
+ * Returns -ENOENT when no open file of @inode has a lower file.
+ */
+int fuse_shortcircuit_getattr(struct inode *inode, struct kstat *stat)
+{
+	struct fuse_conn *fc = get_fuse_conn(inode);
+	struct fuse_inode *fi = get_fuse_inode(inode);
+	struct fuse_file *ff;
+	struct file *lower_file = NULL;
+	struct inode *lower_inode;
+
+	if (!fc->shortcircuit_io || !S_ISREG(inode->i_mode))
+		return -ENOENT;
+
+	spin_lock(&fc->lock);
+	ff = list_first_entry_or_null(&fi->sc_files, struct fuse_file,
+				      sc_entry);
+	if (ff)
+		lower_file = get_file(ff->rw_lower_file);
+	spin_unlock(&fc->lock);
+
+	if (!lower_file)
+		return -ENOENT;
+
+	lower_inode = file_inode(lower_file);
+	spin_lock(&fc->lock);
+	fi->attr_version = ++fc->attr_version;
+	fsstack_copy_inode_size(inode, lower_inode);
+	fsstack_copy_attr_times(inode, lower_inode);
+	spin_unlock(&fc->lock);
+	fput(lower_file);
+
+	atomic_long_inc(&fc->sc_bypassed[FUSE_SC_GETATTR]);
+	if (stat) {
+		generic_fillattr(inode, stat);
+		stat->mode = fi->orig_i_mode;
+		stat->ino = fi->orig_ino;
+	}
+
+	return 0;
+}
+
+/* Account a request queued for the daemon that shortcircuit could serve */
+void fuse_shortcircuit_count_forward(struct fuse_conn *fc, u32 opcode)
+{
+	int stat;
+
+	switch (opcode) {
+	case FUSE_READ:
+		stat = FUSE_SC_READ;
+		break;
+	case FUSE_WRITE:
+		stat = FUSE_SC_WRITE;
+		break;
+	case FUSE_GETATTR:
+		stat = FUSE_SC_GETATTR;
+		break;
+	case FUSE_LOOKUP:
+		stat = FUSE_SC_LOOKUP;
+		break;
+	case FUSE_READDIR:
+	case FUSE_READDIRPLUS:
+		stat = FUSE_SC_READDIR;
+		break;
+	default:
+		return;
+	}
+
+	atomic_long_inc(&fc->sc_forwarded[stat]);
+}
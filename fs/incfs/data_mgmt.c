@@ -156,6 +156,8 @@ struct data_file *incfs_open_data_file(struct mount_info *mi, struct file *bf)
 
 	df->df_backing_file_context = bfc;
 	df->df_mount_info = mi;
+	df->df_last_read_block = -1;
+	df->df_prefetch_mark = -1;
 	for (i = 0; i < ARRAY_SIZE(df->df_segments); i++)
 		data_file_segment_init(&df->df_segments[i]);
 
@@ -188,6 +190,32 @@ struct data_file *incfs_open_data_file(struct mount_info *mi, struct file *bf)
 	return df;
 }
 
+static void drop_prefetch_reads(struct data_file *df)
+{
+	struct mount_info *mi = df->df_mount_info;
+	struct pending_read *entry, *tmp;
+	int i;
+
+	if (!mi)
+		return;
+
+	mutex_lock(&mi->mi_pending_reads_mutex);
+	for (i = 0; i < ARRAY_SIZE(df->df_segments); i++) {
+		list_for_each_entry_safe(entry, tmp,
+				&df->df_segments[i].reads_list_head,
+				segment_reads_list) {
+			if (!entry->prefetch)
+				continue;
+			list_del(&entry->mi_reads_list);
+			list_del(&entry->segment_reads_list);
+			mi->mi_pending_reads_count--;
+			mi->mi_prefetch_reads_count--;
+			kfree(entry);
+		}
+	}
+	mutex_unlock(&mi->mi_pending_reads_mutex);
+}
+
 void incfs_free_data_file(struct data_file *df)
 {
 	int i;
@@ -195,6 +223,7 @@ void incfs_free_data_file(struct data_file *df)
 	if (!df)
 		return;
 
+	drop_prefetch_reads(df);
 	incfs_free_mtree(df->df_hash_tree);
 	for (i = 0; i < ARRAY_SIZE(df->df_segments); i++)
 		data_file_segment_destroy(&df->df_segments[i]);
@@ -798,18 +827,215 @@ static void notify_pending_reads(struct mount_info *mi,
 		int index)
 {
 	struct pending_read *entry = NULL;
+	struct pending_read *tmp = NULL;
 
 	/* Notify pending reads waiting for this block. */
 	mutex_lock(&mi->mi_pending_reads_mutex);
-	list_for_each_entry(entry, &segment->reads_list_head,
+	list_for_each_entry_safe(entry, tmp, &segment->reads_list_head,
 						segment_reads_list) {
-		if (entry->block_index == index)
+		if (entry->block_index != index)
+			continue;
+		if (!entry->prefetch) {
 			set_read_done(entry);
+			continue;
+		}
+		/* Nobody waits for a prefetch read, retire it right away */
+		list_del(&entry->mi_reads_list);
+		list_del(&entry->segment_reads_list);
+		mi->mi_pending_reads_count--;
+		mi->mi_prefetch_reads_count--;
+		kfree(entry);
 	}
 	mutex_unlock(&mi->mi_pending_reads_mutex);
 	wake_up_all(&segment->new_data_arrival_wq);
 }
 
+/*
+ * Posts a pending read for a missing block nobody is waiting for yet, so
+ * that the data loader starts fetching it early. Must be called under the
+ * segment's blockmap_mutex, like add_pending_read().
+ * Returns true if a new pending read was posted.
+ */
+static bool add_prefetch_read(struct data_file *df,
+			      struct data_file_segment *segment,
+			      int block_index)
+{
+	struct mount_info *mi = df->df_mount_info;
+	struct pending_read *result = NULL;
+	struct pending_read *entry = NULL;
+
+	result = kzalloc(sizeof(*result), GFP_NOFS);
+	if (!result)
+		return false;
+
+	result->file_id = df->df_id;
+	result->block_index = block_index;
+	result->timestamp_us = ktime_to_us(ktime_get());
+	result->prefetch = true;
+
+	mutex_lock(&mi->mi_pending_reads_mutex);
+	if (mi->mi_prefetch_reads_count >= INCFS_MAX_PREFETCH_READS)
+		goto drop;
+
+	/* The loader already knows about this block */
+	list_for_each_entry(entry, &segment->reads_list_head,
+						segment_reads_list)
+		if (entry->block_index == block_index)
+			goto drop;
+
+	result->serial_number = ++mi->mi_last_pending_read_number;
+	mi->mi_pending_reads_count++;
+	mi->mi_prefetch_reads_count++;
+
+	list_add(&result->mi_reads_list, &mi->mi_reads_list_head);
+	list_add(&result->segment_reads_list, &segment->reads_list_head);
+	mutex_unlock(&mi->mi_pending_reads_mutex);
+	return true;
+
+drop:
+	mutex_unlock(&mi->mi_pending_reads_mutex);
+	kfree(result);
+	return false;
+}
+
+/*
+ * Posts prefetch pending reads for the missing blocks in
+ * [first, first + count). Returns the number of blocks found missing.
+ */
+static int prefetch_blocks(struct data_file *df, int first, int count)
+{
+	struct mount_info *mi = df->df_mount_info;
+	int end = min(first + count, df->df_data_block_count);
+	int missing = 0;
+	int posted = 0;
+	int i;
+
+	if (df->df_blockmap_off <= 0 ||
+	    (df->df_header_flags & INCFS_FILE_COMPLETE))
+		return 0;
+
+	for (i = max(first, 0); i < end; i++) {
+		struct data_file_segment *segment = get_file_segment(df, i);
+		struct data_file_block block = {};
+
+		if (mutex_lock_interruptible(&segment->blockmap_mutex))
+			break;
+
+		if (!get_data_file_block(df, i, &block) &&
+		    !is_data_block_present(&block)) {
+			missing++;
+			posted += add_prefetch_read(df, segment, i);
+		}
+		mutex_unlock(&segment->blockmap_mutex);
+	}
+
+	if (posted)
+		wake_up_all(&mi->mi_pending_reads_notif_wq);
+	return missing;
+}
+
+void incfs_prefetch_data_blocks(struct data_file *df, int first, int count)
+{
+	if (!df || !df->df_mount_info->mi_options.prefetch_blocks)
+		return;
+
+	prefetch_blocks(df, first, count);
+}
+
+/*
+ * Looks for the last time @block_index of this file showed up in the read
+ * log and returns the blocks of the same file that were read right after
+ * it, i.e. replays what the reader did last time.
+ */
+static int log_predict_blocks(struct mount_info *mi, incfs_uuid_t *id,
+			      int block_index, int *blocks, int max)
+{
+	struct read_log *log = &mi->mi_log;
+	struct read_log_state rs;
+	bool found = false;
+	int count = 0;
+
+	if (READ_ONCE(log->rl_size) == 0)
+		return 0;
+
+	spin_lock(&log->rl_lock);
+	if (log->rl_size == 0)
+		goto unlock;
+
+	rs = log->rl_tail;
+	while (rs.current_record_no < log->rl_head.current_record_no) {
+		log_read_one_record(log, &rs);
+
+		if (memcmp(id, &rs.base_record.file_id,
+			   sizeof(incfs_uuid_t))) {
+			found = false;
+			continue;
+		}
+
+		if (rs.base_record.block_index == block_index) {
+			/* keep the most recent occurrence only */
+			found = true;
+			count = 0;
+			continue;
+		}
+
+		if (found && count < max)
+			blocks[count++] = rs.base_record.block_index;
+	}
+
+unlock:
+	spin_unlock(&log->rl_lock);
+	return count;
+}
+
+/*
+ * Called for every data block read, @missing tells whether the reader is
+ * about to wait. Detects sequential streams and previously logged access
+ * sequences and notifies the loader about the blocks that will be needed
+ * next.
+ */
+static void prefetch_on_read(struct data_file *df, int block_index,
+			     bool missing)
+{
+	struct mount_info *mi = df->df_mount_info;
+	int window = mi->mi_options.prefetch_blocks;
+	int blocks[INCFS_PREFETCH_LOG_BLOCKS];
+	int last = READ_ONCE(df->df_last_read_block);
+	int run = 0;
+	int count;
+	int i;
+
+	WRITE_ONCE(df->df_last_read_block, block_index);
+	if (!window)
+		return;
+
+	if (block_index == last + 1)
+		run = READ_ONCE(df->df_seq_run) + 1;
+	WRITE_ONCE(df->df_seq_run, run);
+
+	if (!missing) {
+		/* Keep the window ahead of a sequential reader */
+		if (block_index != READ_ONCE(df->df_prefetch_mark))
+			return;
+		block_index = READ_ONCE(df->df_prefetch_next) - 1;
+	} else if (!run) {
+		count = log_predict_blocks(mi, &df->df_id, block_index,
+					   blocks, ARRAY_SIZE(blocks));
+		for (i = 0; i < count; i++)
+			prefetch_blocks(df, blocks[i], 1);
+		return;
+	}
+
+	/* Sequential: post the next window and arm its midpoint */
+	if (prefetch_blocks(df, block_index + 1, window)) {
+		WRITE_ONCE(df->df_prefetch_next, block_index + 1 + window);
+		WRITE_ONCE(df->df_prefetch_mark, block_index + 1 + window / 2);
+	} else {
+		/* Everything ahead is there already, stop scanning */
+		WRITE_ONCE(df->df_prefetch_mark, -1);
+	}
+}
+
 static int wait_for_data_block(struct data_file *df, int block_index,
 			       int timeout_ms,
 			       struct data_file_block *res_block)
@@ -846,6 +1072,8 @@ static int wait_for_data_block(struct data_file *df, int block_index,
 	if (error)
 		return error;
 
+	prefetch_on_read(df, block_index, !is_data_block_present(&block));
+
 	/* If the block was found, just return it. No need to wait. */
 	if (is_data_block_present(&block)) {
 		*res_block = block;
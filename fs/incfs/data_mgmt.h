@@ -20,6 +20,12 @@
 
 #define SEGMENTS_PER_FILE 3
 
+/* Upper bound of prefetch pending reads outstanding per mount */
+#define INCFS_MAX_PREFETCH_READS 256
+
+/* Blocks replayed from the read log after a miss */
+#define INCFS_PREFETCH_LOG_BLOCKS 8
+
 enum LOG_RECORD_TYPE {
 	FULL,
 	SAME_FILE,
@@ -99,6 +105,7 @@ struct mount_options {
 	unsigned int readahead_pages;
 	unsigned int read_log_pages;
 	unsigned int read_log_wakeup_count;
+	unsigned int prefetch_blocks;
 	bool no_backing_file_cache;
 	bool no_backing_file_readahead;
 };
@@ -127,6 +134,7 @@ struct mount_info {
 	 *  - reads_list_head
 	 *  - mi_pending_reads_count
 	 *  - mi_last_pending_read_number
+	 *  - mi_prefetch_reads_count
 	 *  - data_file_segment.reads_list_head
 	 */
 	struct mutex mi_pending_reads_mutex;
@@ -137,6 +145,9 @@ struct mount_info {
 	/* Total number of items in reads_list_head */
 	int mi_pending_reads_count;
 
+	/* Number of prefetch items in reads_list_head */
+	int mi_prefetch_reads_count;
+
 	/*
 	 * Last serial number that was assigned to a pending read.
 	 * 0 means no pending reads have been seen yet.
@@ -172,6 +183,12 @@ struct pending_read {
 
 	int serial_number;
 
+	/*
+	 * Nobody waits for this read: it was posted ahead of the reader and
+	 * lives until the block arrives or the file goes away.
+	 */
+	bool prefetch;
+
 	struct list_head mi_reads_list;
 
 	struct list_head segment_reads_list;
@@ -237,6 +254,21 @@ struct data_file {
 	struct mtree *df_hash_tree;
 
 	struct incfs_df_signature *df_signature;
+
+	/*
+	 * Access pattern tracking for prefetch. These are hints only and are
+	 * updated without locking.
+	 */
+	int df_last_read_block;
+
+	/* Number of consecutive sequential reads before the last one */
+	int df_seq_run;
+
+	/* First block after the current prefetch window */
+	int df_prefetch_next;
+
+	/* A read of this block moves the prefetch window forward */
+	int df_prefetch_mark;
 };
 
 struct dir_file {
@@ -276,6 +308,8 @@ int incfs_scan_metadata_chain(struct data_file *df);
 struct dir_file *incfs_open_dir_file(struct mount_info *mi, struct file *bf);
 void incfs_free_dir_file(struct dir_file *dir);
 
+void incfs_prefetch_data_blocks(struct data_file *df, int first, int count);
+
 ssize_t incfs_read_data_file_block(struct mem_range dst, struct file *f,
 				   int index, int timeout_ms,
 				   struct mem_range tmp);
@@ -10,6 +10,7 @@
 #include <linux/fs.h>
 #include <linux/fs_stack.h>
 #include <linux/namei.h>
+#include <linux/pagemap.h>
 #include <linux/parser.h>
 #include <linux/poll.h>
 #include <linux/seq_file.h>
@@ -53,6 +54,8 @@ static int dir_rename(struct inode *old_dir, struct dentry *old_dentry,
 static int file_open(struct inode *inode, struct file *file);
 static int file_release(struct inode *inode, struct file *file);
 static int read_single_page(struct file *f, struct page *page);
+static int read_pages(struct file *f, struct address_space *mapping,
+		      struct list_head *pages, unsigned int nr_pages);
 static long dispatch_ioctl(struct file *f, unsigned int req, unsigned long arg);
 
 static ssize_t pending_reads_read(struct file *f, char __user *buf, size_t len,
@@ -123,7 +126,7 @@ static const struct dentry_operations incfs_dentry_ops = {
 
 static const struct address_space_operations incfs_address_space_ops = {
 	.readpage = read_single_page,
-	/* .readpages = readpages */
+	.readpages = read_pages,
 };
 
 static const struct file_operations incfs_file_ops = {
@@ -220,6 +223,7 @@ enum parse_parameter {
 	Opt_no_backing_file_readahead,
 	Opt_rlog_pages,
 	Opt_rlog_wakeup_cnt,
+	Opt_prefetch_blocks,
 	Opt_err
 };
 
@@ -242,6 +246,7 @@ static const match_table_t option_tokens = {
 	{ Opt_no_backing_file_readahead, "no_bf_readahead=%u" },
 	{ Opt_rlog_pages, "rlog_pages=%u" },
 	{ Opt_rlog_wakeup_cnt, "rlog_wakeup_cnt=%u" },
+	{ Opt_prefetch_blocks, "prefetch=%u" },
 	{ Opt_err, NULL }
 };
 
@@ -258,6 +263,7 @@ static int parse_options(struct mount_options *opts, char *str)
 	opts->readahead_pages = 10;
 	opts->read_log_pages = 2;
 	opts->read_log_wakeup_count = 10;
+	opts->prefetch_blocks = 16;
 	opts->no_backing_file_cache = false;
 	opts->no_backing_file_readahead = false;
 	if (str == NULL || *str == 0)
@@ -302,6 +308,11 @@ static int parse_options(struct mount_options *opts, char *str)
 				return -EINVAL;
 			opts->read_log_wakeup_count = value;
 			break;
+		case Opt_prefetch_blocks:
+			if (match_int(&args[0], &value))
+				return -EINVAL;
+			opts->prefetch_blocks = value;
+			break;
 		default:
 			return -EINVAL;
 		}
@@ -793,7 +804,8 @@ static struct dentry *open_or_create_index_dir(struct dentry *backing_dir)
 	return index_dentry;
 }
 
-static int read_single_page(struct file *f, struct page *page)
+static int read_one_page(struct file *f, struct page *page,
+			 struct mem_range tmp)
 {
 	loff_t offset = 0;
 	loff_t size = 0;
@@ -801,30 +813,29 @@ static int read_single_page(struct file *f, struct page *page)
 	ssize_t read_result = 0;
 	struct data_file *df = get_incfs_data_file(f);
 	int result = 0;
-	void *page_start = kmap(page);
+	void *page_start;
 	int block_index;
 	int timeout_ms;
 
-	if (!df)
+	if (!df) {
+		unlock_page(page);
 		return -EBADF;
+	}
 
+	page_start = kmap(page);
 	offset = page_offset(page);
 	block_index = offset / INCFS_DATA_FILE_BLOCK_SIZE;
 	size = df->df_size;
 	timeout_ms = df->df_mount_info->mi_options.read_timeout_ms;
 
 	if (offset < size) {
-		struct mem_range tmp = {
-			.len = 2 * INCFS_DATA_FILE_BLOCK_SIZE
-		};
-
-		tmp.data = (u8 *)__get_free_pages(GFP_NOFS, get_order(tmp.len));
 		bytes_to_read = min_t(loff_t, size - offset, PAGE_SIZE);
-		read_result = incfs_read_data_file_block(
-			range(page_start, bytes_to_read), f, block_index,
-			timeout_ms, tmp);
-
-		free_pages((unsigned long)tmp.data, get_order(tmp.len));
+		if (tmp.data)
+			read_result = incfs_read_data_file_block(
+				range(page_start, bytes_to_read), f,
+				block_index, timeout_ms, tmp);
+		else
+			read_result = -ENOMEM;
 	} else {
 		bytes_to_read = 0;
 		read_result = 0;
@@ -846,6 +857,59 @@ static int read_single_page(struct file *f, struct page *page)
 	return result;
 }
 
+static int read_single_page(struct file *f, struct page *page)
+{
+	struct mem_range tmp = {
+		.len = 2 * INCFS_DATA_FILE_BLOCK_SIZE
+	};
+	int result;
+
+	tmp.data = (u8 *)__get_free_pages(GFP_NOFS, get_order(tmp.len));
+	result = read_one_page(f, page, tmp);
+	free_pages((unsigned long)tmp.data, get_order(tmp.len));
+	return result;
+}
+
+struct read_pages_ctx {
+	struct file *f;
+	struct mem_range tmp;
+};
+
+static int read_pages_filler(void *data, struct page *page)
+{
+	struct read_pages_ctx *ctx = data;
+
+	return read_one_page(ctx->f, page, ctx->tmp);
+}
+
+/*
+ * Readahead batch: let the data loader know about every missing block of
+ * the batch at once, then read and decompress the pages back to back with
+ * a single bounce buffer.
+ */
+static int read_pages(struct file *f, struct address_space *mapping,
+		      struct list_head *pages, unsigned int nr_pages)
+{
+	struct data_file *df = get_incfs_data_file(f);
+	struct read_pages_ctx ctx = {
+		.f = f,
+		.tmp = { .len = 2 * INCFS_DATA_FILE_BLOCK_SIZE },
+	};
+	int result;
+
+	if (!df)
+		return -EBADF;
+
+	incfs_prefetch_data_blocks(df,
+		list_last_entry(pages, struct page, lru)->index, nr_pages);
+
+	ctx.tmp.data = (u8 *)__get_free_pages(GFP_NOFS,
+					      get_order(ctx.tmp.len));
+	result = read_cache_pages(mapping, pages, read_pages_filler, &ctx);
+	free_pages((unsigned long)ctx.tmp.data, get_order(ctx.tmp.len));
+	return result;
+}
+
 static char *file_id_to_str(incfs_uuid_t id)
 {
 	char *result = kmalloc(1 + sizeof(id.bytes) * 2, GFP_NOFS);
@@ -2304,6 +2368,7 @@ static int show_options(struct seq_file *m, struct dentry *root)
 		seq_printf(m, ",rlog_wakeup_cnt=%u",
 			   mi->mi_options.read_log_wakeup_count);
 	}
+	seq_printf(m, ",prefetch=%u", mi->mi_options.prefetch_blocks);
 	if (mi->mi_options.no_backing_file_cache)
 		seq_puts(m, ",no_bf_cache");
 	if (mi->mi_options.no_backing_file_readahead)
@@ -95,7 +95,6 @@ extern int do_remount_sb2(struct vfsmount *, struct super_block *, int,
 extern bool trylock_super(struct super_block *sb);
 extern struct dentry *mount_fs(struct file_system_type *,
 			       int, const char *, struct vfsmount *, void *);
-extern struct super_block *user_get_super(dev_t);
 
 /*
  * open.c
@@ -1418,6 +1418,32 @@ struct discard_cmd_control {
 };
 #endif
 
+/*
+ * Latency of ext4_mb_new_blocks(): bucket 0 counts calls under 1us,
+ * bucket i those in [2^(i-1), 2^i) us and the last one all longer.
+ */
+#define EXT4_MB_LAT_BUCKETS	16
+
+struct ext4_mb_lat_hist {
+	unsigned long bucket[EXT4_MB_LAT_BUCKETS];
+};
+
+/*
+ * Stages of ext4_fill_super() timed for /proc/fs/ext4/<dev>/mount_times
+ */
+enum ext4_mount_stage {
+	EXT4_MS_GROUP_DESC,	/* read and check group descriptors */
+	EXT4_MS_JOURNAL,	/* load the journal, replaying it if needed */
+	EXT4_MS_OVERHEAD,	/* compute overhead not in the superblock */
+	EXT4_MS_ROOT,		/* read the root inode */
+	EXT4_MS_SYSTEM_ZONE,	/* build the block_validity tree */
+	EXT4_MS_MBALLOC,	/* set up the block allocator */
+	EXT4_MS_COUNTERS,	/* count free blocks, inodes, dirs */
+	EXT4_MS_QUOTA,		/* enable quotas */
+	EXT4_MS_ORPHANS,	/* process the orphan list */
+	EXT4_MS_NR,
+};
+
 /*
  * fourth extended-fs super-block data in memory
  */
@@ -1529,6 +1555,7 @@ struct ext4_sb_info {
 	atomic_t s_bal_goals;	/* goal hits */
 	atomic_t s_bal_breaks;	/* too long searches */
 	atomic_t s_bal_2orders;	/* 2^order hits */
+	atomic_t s_bal_busy_skips;	/* groups skipped as locked */
 	spinlock_t s_bal_lock;
 	unsigned long s_mb_buddies_generated;
 	unsigned long long s_mb_generation_time;
@@ -1540,6 +1567,9 @@ struct ext4_sb_info {
 	/* locality groups */
 	struct ext4_locality_group __percpu *s_locality_groups;
 
+	/* allocation latency, see EXT4_MB_LAT_BUCKETS */
+	struct ext4_mb_lat_hist __percpu *s_mb_lat_hist;
+
 	/* for write statistics */
 	unsigned long s_sectors_written_start;
 	u64 s_kbytes_written;
@@ -1594,6 +1624,12 @@ struct ext4_sb_info {
 	 */
 	struct percpu_rw_semaphore s_writepages_rwsem;
 	struct dax_device *s_daxdev;
+
+	/* Time spent in each stage of mounting, and in all of it */
+	u64 s_mount_ns[EXT4_MS_NR];
+	u64 s_mount_total_ns;
+	unsigned int s_mount_orphans;
+	unsigned int s_mount_truncates;
 	/* for discard command control */
 #if defined(CONFIG_OPLUS_FEATURE_EXT4_ASYNC_DISCARD)
         //add for ext4 async discard suppot
@@ -2744,6 +2780,7 @@ extern int ext4_resize_fs(struct super_block *sb, ext4_fsblk_t n_blocks_count);
 extern struct buffer_head *ext4_sb_bread(struct super_block *sb,
 					 sector_t block, int op_flags);
 extern int ext4_seq_options_show(struct seq_file *seq, void *offset);
+extern int ext4_seq_mount_times_show(struct seq_file *seq, void *offset);
 extern int ext4_calculate_overhead(struct super_block *sb);
 extern void ext4_superblock_csum_set(struct super_block *sb);
 extern void *ext4_kvmalloc(size_t size, gfp_t flags);
@@ -3132,6 +3169,13 @@ static inline void ext4_lock_group(struct super_block *sb, ext4_group_t group)
 	}
 }
 
+/* Racy check used to steer away from groups other CPUs allocate from */
+static inline bool ext4_group_lock_busy(struct super_block *sb,
+					ext4_group_t group)
+{
+	return spin_is_locked(ext4_group_lock_ptr(sb, group));
+}
+
 static inline void ext4_unlock_group(struct super_block *sb,
 					ext4_group_t group)
 {
@@ -1688,6 +1688,24 @@ static void ext4_mb_use_best_found(struct ext4_allocation_context *ac,
 		sbi->s_mb_last_start = ac->ac_f_ex.fe_start;
 		spin_unlock(&sbi->s_md_lock);
 	}
+	/*
+	 * and for the next group allocation of this CPU, so that CPUs keep
+	 * to their own groups rather than all starting from the goal of
+	 * the directory their small files are created in
+	 */
+	if ((ac->ac_flags & EXT4_MB_HINT_GROUP_ALLOC) && ac->ac_lg) {
+		struct ext4_locality_group *lg = ac->ac_lg;
+
+		lg->lg_goal_group = ac->ac_b_ex.fe_group;
+		lg->lg_goal_start = ac->ac_b_ex.fe_start + ac->ac_b_ex.fe_len;
+		if (lg->lg_goal_start >= EXT4_CLUSTERS_PER_GROUP(ac->ac_sb)) {
+			if (++lg->lg_goal_group >=
+			    ext4_get_groups_count(ac->ac_sb))
+				lg->lg_goal_group = 0;
+			lg->lg_goal_start = 0;
+		}
+		lg->lg_goal_valid = true;
+	}
 }
 
 /*
@@ -2195,6 +2213,17 @@ ext4_mb_regular_allocator(struct ext4_allocation_context *ac)
 			if (group >= ngroups)
 				group = 0;
 
+			/*
+			 * Leave groups another CPU is allocating from to
+			 * the last pass, rather than wait for their lock.
+			 * The goal group is always tried.
+			 */
+			if (i && cr < 3 && ext4_group_lock_busy(sb, group)) {
+				if (sbi->s_mb_stats)
+					atomic_inc(&sbi->s_bal_busy_skips);
+				continue;
+			}
+
 			/* This now checks without needing the buddy page */
 			ret = ext4_mb_good_group(ac, group, cr);
 			if (ret <= 0) {
@@ -2711,13 +2740,22 @@ int ext4_mb_init(struct super_block *sb)
 		spin_lock_init(&lg->lg_prealloc_lock);
 	}
 
+	sbi->s_mb_lat_hist = alloc_percpu(struct ext4_mb_lat_hist);
+	if (sbi->s_mb_lat_hist == NULL) {
+		ret = -ENOMEM;
+		goto out_free_locality_groups;
+	}
+
 	/* init file for buddy data */
 	ret = ext4_mb_init_backend(sb);
 	if (ret != 0)
-		goto out_free_locality_groups;
+		goto out_free_lat_hist;
 
 	return 0;
 
+out_free_lat_hist:
+	free_percpu(sbi->s_mb_lat_hist);
+	sbi->s_mb_lat_hist = NULL;
 out_free_locality_groups:
 	free_percpu(sbi->s_locality_groups);
 	sbi->s_locality_groups = NULL;
@@ -2802,9 +2840,13 @@ int ext4_mb_release(struct super_block *sb)
 		       "mballoc: %u preallocated, %u discarded",
 				atomic_read(&sbi->s_mb_preallocated),
 				atomic_read(&sbi->s_mb_discarded));
+		ext4_msg(sb, KERN_INFO,
+		       "mballoc: %u busy groups skipped",
+				atomic_read(&sbi->s_bal_busy_skips));
 	}
 
 	free_percpu(sbi->s_locality_groups);
+	free_percpu(sbi->s_mb_lat_hist);
 
 	return 0;
 }
@@ -3104,6 +3146,13 @@ static void ext4_mb_normalize_group_request(struct ext4_allocation_context *ac)
 
 	BUG_ON(lg == NULL);
 	ac->ac_g_ex.fe_len = EXT4_SB(sb)->s_mb_group_prealloc;
+	/* continue where this CPU's last group allocation ended */
+	if (lg->lg_goal_valid &&
+	    ext4_test_inode_flag(ac->ac_inode, EXT4_INODE_EXTENTS) &&
+	    lg->lg_goal_group < ext4_get_groups_count(sb)) {
+		ac->ac_g_ex.fe_group = lg->lg_goal_group;
+		ac->ac_g_ex.fe_start = lg->lg_goal_start;
+	}
 	mb_debug(1, "#%u: goal %u blocks for locality group\n",
 		current->pid, ac->ac_g_ex.fe_len);
 }
@@ -4517,6 +4566,14 @@ static int ext4_mb_discard_preallocations(struct super_block *sb, int needed)
  * it tries to use preallocation first, then falls back
  * to usual allocation
  */
+static void ext4_mb_account_latency(struct ext4_sb_info *sbi, u64 ns)
+{
+	unsigned long us = div_u64(ns, NSEC_PER_USEC);
+	int bucket = us ? min(fls_long(us), EXT4_MB_LAT_BUCKETS - 1) : 0;
+
+	this_cpu_inc(sbi->s_mb_lat_hist->bucket[bucket]);
+}
+
 ext4_fsblk_t ext4_mb_new_blocks(handle_t *handle,
 				struct ext4_allocation_request *ar, int *errp)
 {
@@ -4527,6 +4584,7 @@ ext4_fsblk_t ext4_mb_new_blocks(handle_t *handle,
 	ext4_fsblk_t block = 0;
 	unsigned int inquota = 0;
 	unsigned int reserv_clstrs = 0;
+	u64 start = ktime_get_ns();
 
 	might_sleep();
 	sb = ar->inode->i_sb;
@@ -4645,6 +4703,7 @@ ext4_fsblk_t ext4_mb_new_blocks(handle_t *handle,
 	}
 
 	trace_ext4_allocate_blocks(ar, (unsigned long long)block);
+	ext4_mb_account_latency(sbi, ktime_get_ns() - start);
 
 	return block;
 }
@@ -143,6 +143,10 @@ struct ext4_locality_group {
 	/* list of preallocations */
 	struct list_head	lg_prealloc_list[PREALLOC_TB_SIZE];
 	spinlock_t		lg_prealloc_lock;
+	/* end of the last space allocated, goal for the next, under lg_mutex */
+	bool			lg_goal_valid;
+	ext4_group_t		lg_goal_group;
+	ext4_grpblk_t		lg_goal_start;
 };
 
 struct ext4_allocation_context {
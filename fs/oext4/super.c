@@ -2249,6 +2249,40 @@ int ext4_seq_options_show(struct seq_file *seq, void *offset)
 	return rc;
 }
 
+static const char * const ext4_mount_stage_names[EXT4_MS_NR] = {
+	[EXT4_MS_GROUP_DESC]	= "group_desc",
+	[EXT4_MS_JOURNAL]	= "journal",
+	[EXT4_MS_OVERHEAD]	= "overhead",
+	[EXT4_MS_ROOT]		= "root",
+	[EXT4_MS_SYSTEM_ZONE]	= "system_zone",
+	[EXT4_MS_MBALLOC]	= "mballoc",
+	[EXT4_MS_COUNTERS]	= "counters",
+	[EXT4_MS_QUOTA]		= "quota",
+	[EXT4_MS_ORPHANS]	= "orphans",
+};
+
+static void ext4_mount_stage_done(struct ext4_sb_info *sbi,
+				  enum ext4_mount_stage stage, u64 start)
+{
+	sbi->s_mount_ns[stage] += ktime_get_ns() - start;
+}
+
+int ext4_seq_mount_times_show(struct seq_file *seq, void *offset)
+{
+	struct super_block *sb = seq->private;
+	struct ext4_sb_info *sbi = EXT4_SB(sb);
+	int i;
+
+	for (i = 0; i < EXT4_MS_NR; i++)
+		seq_printf(seq, "%s_us: %llu\n", ext4_mount_stage_names[i],
+			   div_u64(sbi->s_mount_ns[i], NSEC_PER_USEC));
+	seq_printf(seq, "total_us: %llu\n",
+		   div_u64(sbi->s_mount_total_ns, NSEC_PER_USEC));
+	seq_printf(seq, "orphans_deleted: %u\n", sbi->s_mount_orphans);
+	seq_printf(seq, "orphans_truncated: %u\n", sbi->s_mount_truncates);
+	return 0;
+}
+
 static int ext4_setup_super(struct super_block *sb, struct ext4_super_block *es,
 			    int read_only)
 {
@@ -2712,6 +2746,8 @@ static void ext4_orphan_cleanup(struct super_block *sb,
 
 #define PLURAL(x) (x), ((x) == 1) ? "" : "s"
 
+	EXT4_SB(sb)->s_mount_orphans = nr_orphans;
+	EXT4_SB(sb)->s_mount_truncates = nr_truncates;
 	if (nr_orphans)
 		ext4_msg(sb, KERN_INFO, "%d orphan inode%s deleted",
 		       PLURAL(nr_orphans));
@@ -3617,6 +3653,7 @@ static int ext4_fill_super(struct super_block *sb, void *data, int silent)
 	int err = 0;
 	unsigned int journal_ioprio = DEFAULT_JOURNAL_IOPRIO;
 	ext4_group_t first_not_zeroed;
+	u64 mount_start = ktime_get_ns(), stage_start;
 
 	if ((data && !orig_data) || !sbi)
 		goto out_free_base;
@@ -4268,6 +4305,7 @@ static int ext4_fill_super(struct super_block *sb, void *data, int silent)
 
 	bgl_lock_init(sbi->s_blockgroup_lock);
 
+	stage_start = ktime_get_ns();
 	/* Pre-read the descriptors into the buffer cache */
 	for (i = 0; i < db_count; i++) {
 		block = descriptor_loc(sb, logical_sb_block, i);
@@ -4295,6 +4333,7 @@ static int ext4_fill_super(struct super_block *sb, void *data, int silent)
 		ret = -EFSCORRUPTED;
 		goto failed_mount2;
 	}
+	ext4_mount_stage_done(sbi, EXT4_MS_GROUP_DESC, stage_start);
 
 	get_random_bytes(&sbi->s_next_generation, sizeof(u32));
 	spin_lock_init(&sbi->s_next_gen_lock);
@@ -4348,9 +4387,11 @@ static int ext4_fill_super(struct super_block *sb, void *data, int silent)
 	 * root first: it may be modified in the journal!
 	 */
 	if (!test_opt(sb, NOLOAD) && ext4_has_feature_journal(sb)) {
+		stage_start = ktime_get_ns();
 		err = ext4_load_journal(sb, es, journal_devnum);
 		if (err)
 			goto failed_mount3a;
+		ext4_mount_stage_done(sbi, EXT4_MS_JOURNAL, stage_start);
 	} else if (test_opt(sb, NOLOAD) && !sb_rdonly(sb) &&
 		   ext4_has_feature_journal_needs_recovery(sb)) {
 		ext4_msg(sb, KERN_ERR, "required journal recovery "
@@ -4483,9 +4524,11 @@ static int ext4_fill_super(struct super_block *sb, void *data, int silent)
 	if (es->s_overhead_clusters)
 		sbi->s_overhead = le32_to_cpu(es->s_overhead_clusters);
 	else {
+		stage_start = ktime_get_ns();
 		err = ext4_calculate_overhead(sb);
 		if (err)
 			goto failed_mount_wq;
+		ext4_mount_stage_done(sbi, EXT4_MS_OVERHEAD, stage_start);
 	}
 
 	/*
@@ -4505,6 +4548,7 @@ static int ext4_fill_super(struct super_block *sb, void *data, int silent)
 	 * so we can safely mount the rest of the filesystem now.
 	 */
 
+	stage_start = ktime_get_ns();
 	root = ext4_iget(sb, EXT4_ROOT_INO, EXT4_IGET_SPECIAL);
 	if (IS_ERR(root)) {
 		ext4_msg(sb, KERN_ERR, "get root inode failed");
@@ -4512,6 +4556,7 @@ static int ext4_fill_super(struct super_block *sb, void *data, int silent)
 		root = NULL;
 		goto failed_mount4;
 	}
+	ext4_mount_stage_done(sbi, EXT4_MS_ROOT, stage_start);
 	if (!S_ISDIR(root->i_mode) || !root->i_blocks || !root->i_size) {
 		ext4_msg(sb, KERN_ERR, "corrupt root inode, run e2fsck");
 		iput(root);
@@ -4530,13 +4575,16 @@ static int ext4_fill_super(struct super_block *sb, void *data, int silent)
 
 	ext4_set_resv_clusters(sb);
 
+	stage_start = ktime_get_ns();
 	err = ext4_setup_system_zone(sb);
 	if (err) {
 		ext4_msg(sb, KERN_ERR, "failed to initialize system "
 			 "zone (%d)", err);
 		goto failed_mount4a;
 	}
+	ext4_mount_stage_done(sbi, EXT4_MS_SYSTEM_ZONE, stage_start);
 
+	stage_start = ktime_get_ns();
 	ext4_ext_init(sb);
 	err = ext4_mb_init(sb);
 	if (err) {
@@ -4544,7 +4592,9 @@ static int ext4_fill_super(struct super_block *sb, void *data, int silent)
 			 err);
 		goto failed_mount5;
 	}
+	ext4_mount_stage_done(sbi, EXT4_MS_MBALLOC, stage_start);
 
+	stage_start = ktime_get_ns();
 	block = ext4_count_free_clusters(sb);
 	ext4_free_blocks_count_set(sbi->s_es, 
 				   EXT4_C2B(sbi, block));
@@ -4579,6 +4629,7 @@ static int ext4_fill_super(struct super_block *sb, void *data, int silent)
 			       "flex_bg meta info!");
 			goto failed_mount6;
 		}
+	ext4_mount_stage_done(sbi, EXT4_MS_COUNTERS, stage_start);
 
 	err = ext4_register_li_request(sb, first_not_zeroed);
 	if (err)
@@ -4591,15 +4642,19 @@ static int ext4_fill_super(struct super_block *sb, void *data, int silent)
 #ifdef CONFIG_QUOTA
 	/* Enable quota usage during mount. */
 	if (ext4_has_feature_quota(sb) && !sb_rdonly(sb)) {
+		stage_start = ktime_get_ns();
 		err = ext4_enable_quotas(sb);
 		if (err)
 			goto failed_mount8;
+		ext4_mount_stage_done(sbi, EXT4_MS_QUOTA, stage_start);
 	}
 #endif  /* CONFIG_QUOTA */
 
+	stage_start = ktime_get_ns();
 	EXT4_SB(sb)->s_mount_state |= EXT4_ORPHAN_FS;
 	ext4_orphan_cleanup(sb, es);
 	EXT4_SB(sb)->s_mount_state &= ~EXT4_ORPHAN_FS;
+	ext4_mount_stage_done(sbi, EXT4_MS_ORPHANS, stage_start);
 	if (needs_recovery) {
 		ext4_msg(sb, KERN_INFO, "recovery complete");
 		ext4_mark_recovery_complete(sb, es);
@@ -4642,6 +4697,7 @@ static int ext4_fill_super(struct super_block *sb, void *data, int silent)
 	ratelimit_state_init(&sbi->s_warning_ratelimit_state, 5 * HZ, 10);
 	ratelimit_state_init(&sbi->s_msg_ratelimit_state, 5 * HZ, 10);
 
+	sbi->s_mount_total_ns = ktime_get_ns() - mount_start;
 	kfree(orig_data);
 #if defined(CONFIG_OPLUS_FEATURE_EXT4_ASYNC_DISCARD)
         //add for ext4 async discard suppot
@@ -28,6 +28,7 @@ typedef enum {
 	attr_feature,
 	attr_pointer_ui,
 	attr_pointer_atomic,
+	attr_mb_alloc_latency,
 } attr_id_t;
 
 typedef enum {
@@ -78,6 +79,32 @@ static ssize_t lifetime_write_kbytes_show(struct ext4_attr *a,
 			  EXT4_SB(sb)->s_sectors_written_start) >> 1)));
 }
 
+/* Calls per latency bucket, see EXT4_MB_LAT_BUCKETS */
+static ssize_t mb_alloc_latency_show(struct ext4_attr *a,
+				     struct ext4_sb_info *sbi, char *buf)
+{
+	unsigned long sum[EXT4_MB_LAT_BUCKETS] = { 0 };
+	ssize_t len = 0;
+	int cpu, i;
+
+	if (!sbi->s_mb_lat_hist)
+		return 0;
+
+	for_each_possible_cpu(cpu) {
+		struct ext4_mb_lat_hist *h = per_cpu_ptr(sbi->s_mb_lat_hist,
+							 cpu);
+
+		for (i = 0; i < EXT4_MB_LAT_BUCKETS; i++)
+			sum[i] += h->bucket[i];
+	}
+	for (i = 0; i < EXT4_MB_LAT_BUCKETS; i++)
+		len += snprintf(buf + len, PAGE_SIZE - len, "%s%lu",
+				i ? " " : "", sum[i]);
+	len += snprintf(buf + len, PAGE_SIZE - len, "\n");
+
+	return len;
+}
+
 static ssize_t inode_readahead_blks_store(struct ext4_attr *a,
 					  struct ext4_sb_info *sbi,
 					  const char *buf, size_t count)
@@ -176,6 +203,7 @@ EXT4_ATTR_FUNC(delayed_allocation_blocks, 0444);
 EXT4_ATTR_FUNC(session_write_kbytes, 0444);
 EXT4_ATTR_FUNC(lifetime_write_kbytes, 0444);
 EXT4_ATTR_FUNC(reserved_clusters, 0644);
+EXT4_ATTR_FUNC(mb_alloc_latency, 0444);
 
 EXT4_ATTR_OFFSET(inode_readahead_blks, 0644, inode_readahead,
 		 ext4_sb_info, s_inode_readahead_blks);
@@ -225,6 +253,7 @@ static struct attribute *ext4_attrs[] = {
 	ATTR_LIST(mb_order2_req),
 	ATTR_LIST(mb_stream_req),
 	ATTR_LIST(mb_group_prealloc),
+	ATTR_LIST(mb_alloc_latency),
 	ATTR_LIST(max_writeback_mb_bump),
 	ATTR_LIST(extent_max_zeroout_kb),
 	ATTR_LIST(trigger_fs_error),
@@ -322,6 +351,8 @@ static ssize_t ext4_attr_show(struct kobject *kobj,
 		return session_write_kbytes_show(a, sbi, buf);
 	case attr_lifetime_write_kbytes:
 		return lifetime_write_kbytes_show(a, sbi, buf);
+	case attr_mb_alloc_latency:
+		return mb_alloc_latency_show(a, sbi, buf);
 	case attr_reserved_clusters:
 		return snprintf(buf, PAGE_SIZE, "%llu\n",
 				(unsigned long long)
@@ -434,6 +465,7 @@ static const struct file_operations ext4_seq_##name##_fops = { \
 
 PROC_FILE_SHOW_DEFN(es_shrinker_info);
 PROC_FILE_SHOW_DEFN(options);
+PROC_FILE_SHOW_DEFN(mount_times);
 #if defined(CONFIG_OPLUS_FEATURE_EXT4_ASYNC_DISCARD)
 //add for ext4 async discard suppot
 PROC_FILE_SHOW_DEFN(discard_info);
@@ -446,6 +478,7 @@ static const struct ext4_proc_files {
 	PROC_FILE_LIST(options),
 	PROC_FILE_LIST(es_shrinker_info),
 	PROC_FILE_LIST(mb_groups),
+	PROC_FILE_LIST(mount_times),
 #if defined(CONFIG_OPLUS_FEATURE_EXT4_ASYNC_DISCARD)
     //add for ext4 async discard suppot
 	PROC_FILE_LIST(discard_info),
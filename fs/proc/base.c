@@ -92,9 +92,11 @@
 #include <linux/sched/debug.h>
 #include <linux/sched/stat.h>
 #include <linux/sched/clock.h>
+#include <linux/sched/ux.h>
 #include <linux/flex_array.h>
 #include <linux/posix-timers.h>
 #include <linux/cpufreq_times.h>
+#include <linux/simple_lmk.h>
 #ifdef CONFIG_HARDWALL
 #include <asm/hardwall.h>
 #endif
@@ -1095,6 +1097,7 @@ static int __set_oom_adj(struct file *file, int oom_adj, bool legacy)
 	if (!legacy && has_capability_noaudit(current, CAP_SYS_RESOURCE))
 		task->signal->oom_score_adj_min = (short)oom_adj;
 	trace_oom_score_adj_update(task);
+	simple_lmk_update_adj(task);
 
 	if (mm) {
 		struct task_struct *p;
@@ -1115,6 +1118,7 @@ static int __set_oom_adj(struct file *file, int oom_adj, bool legacy)
 					p->signal->oom_score_adj_min = (short)oom_adj;
 			}
 			task_unlock(p);
+			simple_lmk_update_adj(p);
 		}
 		rcu_read_unlock();
 		mmdrop(mm);
@@ -1602,6 +1606,85 @@ static const struct file_operations proc_pid_sched_init_task_load_operations = {
 	.release	= single_release,
 };
 
+static int sched_freq_hint_show(struct seq_file *m, void *v)
+{
+	struct inode *inode = m->private;
+	struct task_struct *p;
+
+	p = get_proc_task(inode);
+	if (!p)
+		return -ESRCH;
+
+	seq_printf(m, "%u\n", sched_get_task_freq_hint(p));
+
+	put_task_struct(p);
+
+	return 0;
+}
+
+/*
+ * Accepts either "<util_pct>" or "<runtime_us> <deadline_us>", the latter
+ * being converted to the share of the deadline the work needs.
+ */
+static ssize_t
+sched_freq_hint_write(struct file *file, const char __user *buf,
+	    size_t count, loff_t *offset)
+{
+	struct inode *inode = file_inode(file);
+	struct task_struct *p;
+	char buffer[32];
+	unsigned int util_pct, runtime, deadline;
+	int err;
+
+	memset(buffer, 0, sizeof(buffer));
+	if (count > sizeof(buffer) - 1)
+		count = sizeof(buffer) - 1;
+	if (copy_from_user(buffer, buf, count)) {
+		err = -EFAULT;
+		goto out;
+	}
+
+	switch (sscanf(strstrip(buffer), "%u %u", &runtime, &deadline)) {
+	case 1:
+		util_pct = runtime;
+		break;
+	case 2:
+		if (!deadline || runtime > deadline) {
+			err = -EINVAL;
+			goto out;
+		}
+		util_pct = DIV_ROUND_UP_ULL(runtime * 100ULL, deadline);
+		break;
+	default:
+		err = -EINVAL;
+		goto out;
+	}
+
+	p = get_proc_task(inode);
+	if (!p)
+		return -ESRCH;
+
+	err = sched_set_task_freq_hint(p, util_pct);
+
+	put_task_struct(p);
+
+out:
+	return err < 0 ? err : count;
+}
+
+static int sched_freq_hint_open(struct inode *inode, struct file *filp)
+{
+	return single_open(filp, sched_freq_hint_show, inode);
+}
+
+static const struct file_operations proc_pid_sched_freq_hint_operations = {
+	.open		= sched_freq_hint_open,
+	.read		= seq_read,
+	.write		= sched_freq_hint_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static int sched_group_id_show(struct seq_file *m, void *v)
 {
 	struct inode *inode = m->private;
@@ -1666,6 +1749,75 @@ static const struct file_operations proc_pid_sched_group_id_operations = {
 
 #endif	/* CONFIG_SCHED_WALT */
 
+#ifdef CONFIG_SCHED_UX
+
+/* "<static> <binder> <lock>": the static flag and both inheritance depths */
+static int sched_ux_state_show(struct seq_file *m, void *v)
+{
+	struct inode *inode = m->private;
+	struct task_struct *p;
+
+	p = get_proc_task(inode);
+	if (!p)
+		return -ESRCH;
+
+	seq_printf(m, "%d %d %d\n", READ_ONCE(p->ux_static),
+		   atomic_read(&p->ux_binder), atomic_read(&p->ux_depth));
+
+	put_task_struct(p);
+
+	return 0;
+}
+
+static ssize_t
+sched_ux_state_write(struct file *file, const char __user *buf,
+	    size_t count, loff_t *offset)
+{
+	struct inode *inode = file_inode(file);
+	struct task_struct *p;
+	char buffer[PROC_NUMBUF];
+	bool ux;
+	int err;
+
+	memset(buffer, 0, sizeof(buffer));
+	if (count > sizeof(buffer) - 1)
+		count = sizeof(buffer) - 1;
+	if (copy_from_user(buffer, buf, count)) {
+		err = -EFAULT;
+		goto out;
+	}
+
+	err = kstrtobool(strstrip(buffer), &ux);
+	if (err)
+		goto out;
+
+	p = get_proc_task(inode);
+	if (!p)
+		return -ESRCH;
+
+	err = sched_ux_set_static(p, ux);
+
+	put_task_struct(p);
+
+out:
+	return err < 0 ? err : count;
+}
+
+static int sched_ux_state_open(struct inode *inode, struct file *filp)
+{
+	return single_open(filp, sched_ux_state_show, inode);
+}
+
+static const struct file_operations proc_pid_sched_ux_state_operations = {
+	.open		= sched_ux_state_open,
+	.read		= seq_read,
+	.write		= sched_ux_state_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+#endif	/* CONFIG_SCHED_UX */
+
 #ifdef CONFIG_SCHED_AUTOGROUP
 /*
  * Print out autogroup related information:
@@ -3324,10 +3476,14 @@ static const struct pid_entry tgid_base_stuff[] = {
 #endif
 #ifdef CONFIG_SCHED_WALT
 	REG("sched_init_task_load", 00644, proc_pid_sched_init_task_load_operations),
+	REG("sched_freq_hint", 00644, proc_pid_sched_freq_hint_operations),
 	REG("sched_group_id", 00666, proc_pid_sched_group_id_operations),
 	REG("sched_boost", 0666,  proc_task_boost_enabled_operations),
 	REG("sched_boost_period_ms", 0666, proc_task_boost_period_operations),
 #endif
+#ifdef CONFIG_SCHED_UX
+	REG("ux_state", 00644, proc_pid_sched_ux_state_operations),
+#endif
 #ifdef CONFIG_SCHED_DEBUG
 	REG("sched",      S_IRUGO|S_IWUSR, proc_pid_sched_operations),
 #endif
@@ -3353,7 +3509,7 @@ static const struct pid_entry tgid_base_stuff[] = {
 	REG("mountinfo",  S_IRUGO, proc_mountinfo_operations),
 	REG("mountstats", S_IRUSR, proc_mountstats_operations),
 #ifdef CONFIG_PROCESS_RECLAIM
-	REG("reclaim", 0200, proc_reclaim_operations),
+	REG("reclaim", 0600, proc_reclaim_operations),
 #endif
 #ifdef CONFIG_PROC_PAGE_MONITOR
 	REG("clear_refs", S_IWUSR, proc_clear_refs_operations),
@@ -3748,6 +3904,9 @@ static const struct pid_entry tid_base_stuff[] = {
 	ONE("limits",	 S_IRUGO, proc_pid_limits),
 #ifdef CONFIG_SCHED_DEBUG
 	REG("sched",     S_IRUGO|S_IWUSR, proc_pid_sched_operations),
+#endif
+#ifdef CONFIG_SCHED_UX
+	REG("ux_state",  00644, proc_pid_sched_ux_state_operations),
 #endif
 	NOD("comm",      S_IFREG|S_IRUGO|S_IWUSR,
 			 &proc_tid_comm_inode_operations,
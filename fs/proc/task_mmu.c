@@ -1707,6 +1707,31 @@ const struct file_operations proc_pagemap_operations = {
 #endif /* CONFIG_PROC_PAGE_MONITOR */
 
 #ifdef CONFIG_PROCESS_RECLAIM
+/*
+ * An anon page is cold when neither its pte nor the page was referenced
+ * since the previous cold pass set it idle. Pages found hot are set idle
+ * for the next pass, and the pte reference is carried over to the page
+ * as page_idle does, so that LRU aging still sees it. Pages shared with
+ * other mms are left to the LRU, their other ptes aren't looked at here.
+ */
+static bool reclaim_page_is_cold(struct vm_area_struct *vma,
+		unsigned long addr, pte_t *pte, struct page *page)
+{
+	bool young;
+
+	if (!PageAnon(page) || page_mapcount(page) > 1)
+		return false;
+
+	young = ptep_test_and_clear_young(vma, addr, pte);
+	if (young)
+		set_page_young(page);
+	else if (page_is_idle(page))
+		return true;
+
+	set_page_idle(page);
+	return false;
+}
+
 static int reclaim_pte_range(pmd_t *pmd, unsigned long addr,
 				unsigned long end, struct mm_walk *walk)
 {
@@ -1734,6 +1759,9 @@ static int reclaim_pte_range(pmd_t *pmd, unsigned long addr,
 		if (!page)
 			continue;
 
+		if (rp->cold && !reclaim_page_is_cold(vma, addr, pte, page))
+			continue;
+
 		if (isolate_lru_page(page))
 			continue;
 
@@ -1758,13 +1786,29 @@ static int reclaim_pte_range(pmd_t *pmd, unsigned long addr,
 			break;
 	}
 	pte_unmap_unlock(pte - 1, ptl);
-	reclaimed = reclaim_pages_from_list(&page_list, vma);
+
+	if (rp->batch) {
+		/*
+		 * Defer the shrink until a full batch has been isolated,
+		 * possibly spanning several vmas. The batch is not tied to
+		 * a single vma, so it is reclaimed with a full rmap walk.
+		 */
+		list_splice(&page_list, rp->batch);
+		rp->nr_batched += isolated;
+		if (rp->nr_batched < min_t(int, RECLAIM_BATCH_PAGES,
+					   rp->nr_to_reclaim))
+			goto next;
+		reclaimed = reclaim_pages_from_list(rp->batch, NULL);
+		rp->nr_batched = 0;
+	} else {
+		reclaimed = reclaim_pages_from_list(&page_list, vma);
+	}
 
 	rp->nr_reclaimed += reclaimed;
 	rp->nr_to_reclaim -= reclaimed;
 	if (rp->nr_to_reclaim < 0)
 		rp->nr_to_reclaim = 0;
-
+next:
 	if (rp->nr_to_reclaim && (addr != end))
 		goto cont;
 
@@ -1777,16 +1821,19 @@ enum reclaim_type {
 	RECLAIM_ANON,
 	RECLAIM_ALL,
 	RECLAIM_RANGE,
+	RECLAIM_COLD,
 };
 
-struct reclaim_param reclaim_task_anon(struct task_struct *task,
-		int nr_to_reclaim)
+static struct reclaim_param __reclaim_task_anon(struct task_struct *task,
+		int nr_to_reclaim, struct list_head *batch, bool cold)
 {
 	struct mm_struct *mm;
 	struct vm_area_struct *vma;
 	struct mm_walk reclaim_walk = {};
 	struct reclaim_param rp = {
 		.nr_to_reclaim = nr_to_reclaim,
+		.batch = batch,
+		.cold = cold,
 	};
 
 	get_task_struct(task);
@@ -1817,12 +1864,46 @@ struct reclaim_param reclaim_task_anon(struct task_struct *task,
 
 	flush_tlb_mm(mm);
 	up_read(&mm->mmap_sem);
+
+	/* Shrink whatever is left of the batch before the mm goes away */
+	if (rp.nr_batched) {
+		int reclaimed = reclaim_pages_from_list(batch, NULL);
+
+		rp.nr_reclaimed += reclaimed;
+		rp.nr_to_reclaim = max(rp.nr_to_reclaim - reclaimed, 0);
+		rp.nr_batched = 0;
+	}
+	atomic_long_add(rp.nr_reclaimed, &mm->reclaimed_pages);
 	mmput(mm);
 out:
 	put_task_struct(task);
 	return rp;
 }
 
+/*
+ * Reclaim up to @nr_to_reclaim anon pages of @task. With @cold only pages
+ * left untouched since the previous cold pass over the task are taken, so
+ * the first pass only marks them.
+ */
+struct reclaim_param reclaim_task_anon(struct task_struct *task,
+		int nr_to_reclaim, bool cold)
+{
+	return __reclaim_task_anon(task, nr_to_reclaim, NULL, cold);
+}
+
+/*
+ * Same as reclaim_task_anon(), but isolated pages from all vmas of the
+ * task are collected on @batch and shrunk RECLAIM_BATCH_PAGES at a time
+ * rather than one pmd at a time. @batch must be empty on entry and is
+ * empty again on return, so callers reclaiming a set of tasks can reuse
+ * one list for all of them.
+ */
+struct reclaim_param reclaim_task_anon_batch(struct task_struct *task,
+		int nr_to_reclaim, struct list_head *batch, bool cold)
+{
+	return __reclaim_task_anon(task, nr_to_reclaim, batch, cold);
+}
+
 static ssize_t reclaim_write(struct file *file, const char __user *buf,
 				size_t count, loff_t *ppos)
 {
@@ -1835,7 +1916,7 @@ static ssize_t reclaim_write(struct file *file, const char __user *buf,
 	struct mm_walk reclaim_walk = {};
 	unsigned long start = 0;
 	unsigned long end = 0;
-	struct reclaim_param rp;
+	struct reclaim_param rp = {};
 
 	memset(buffer, 0, sizeof(buffer));
 	if (count > sizeof(buffer) - 1)
@@ -1851,6 +1932,9 @@ static ssize_t reclaim_write(struct file *file, const char __user *buf,
 		type = RECLAIM_ANON;
 	else if (!strcmp(type_buf, "all"))
 		type = RECLAIM_ALL;
+	else if (!strcmp(type_buf, "cold") &&
+		 IS_ENABLED(CONFIG_IDLE_PAGE_TRACKING))
+		type = RECLAIM_COLD;
 	else if (isdigit(*type_buf))
 		type = RECLAIM_RANGE;
 	else
@@ -1899,7 +1983,7 @@ static ssize_t reclaim_write(struct file *file, const char __user *buf,
 	reclaim_walk.pmd_entry = reclaim_pte_range;
 
 	rp.nr_to_reclaim = INT_MAX;
-	rp.nr_reclaimed = 0;
+	rp.cold = type == RECLAIM_COLD;
 	reclaim_walk.private = &rp;
 
 	down_read(&mm->mmap_sem);
@@ -1922,7 +2006,8 @@ static ssize_t reclaim_write(struct file *file, const char __user *buf,
 			if (is_vm_hugetlb_page(vma))
 				continue;
 
-			if (type == RECLAIM_ANON && vma->vm_file)
+			if ((type == RECLAIM_ANON || type == RECLAIM_COLD) &&
+			    vma->vm_file)
 				continue;
 
 			if (type == RECLAIM_FILE && !vma->vm_file)
@@ -1936,6 +2021,7 @@ static ssize_t reclaim_write(struct file *file, const char __user *buf,
 
 	flush_tlb_mm(mm);
 	up_read(&mm->mmap_sem);
+	atomic_long_add(rp.nr_reclaimed, &mm->reclaimed_pages);
 	mmput(mm);
 out:
 	put_task_struct(task);
@@ -1945,7 +2031,38 @@ static ssize_t reclaim_write(struct file *file, const char __user *buf,
 	return -EINVAL;
 }
 
+/*
+ * Pages process reclaim took from the task, and swap-ins since then. A
+ * swap-in ratio close to the reclaimed count means warm pages are being
+ * reclaimed and decompressed right back.
+ */
+static ssize_t reclaim_read(struct file *file, char __user *buf,
+				size_t count, loff_t *ppos)
+{
+	struct task_struct *task;
+	struct mm_struct *mm;
+	char buffer[64];
+	size_t len;
+
+	task = get_proc_task(file_inode(file));
+	if (!task)
+		return -ESRCH;
+
+	mm = get_task_mm(task);
+	put_task_struct(task);
+	if (!mm)
+		return 0;
+
+	len = scnprintf(buffer, sizeof(buffer), "reclaimed: %ld\nswapin: %ld\n",
+			atomic_long_read(&mm->reclaimed_pages),
+			atomic_long_read(&mm->swapin_refaults));
+	mmput(mm);
+
+	return simple_read_from_buffer(buf, count, ppos, buffer, len);
+}
+
 const struct file_operations proc_reclaim_operations = {
+	.read		= reclaim_read,
 	.write		= reclaim_write,
 	.llseek		= noop_llseek,
 };
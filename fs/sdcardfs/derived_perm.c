@@ -20,6 +20,48 @@
 
 #include "sdcardfs.h"
 
+/*
+ * Generation of all derived permission state. Any change that may alter the
+ * uid, gid or mode reported for an inode bumps this, which drops every
+ * sdcardfs_perm_cache entry at once.
+ */
+atomic_t sdcardfs_perm_gen = ATOMIC_INIT(0);
+
+bool sdcardfs_perm_cache_get(struct sdcardfs_inode_info *info,
+			const void *vfsopts, struct sdcardfs_perm_cache *out)
+{
+	struct sdcardfs_perm_cache *cache;
+	umode_t owner_mode = info->lower_inode->i_mode & 0700;
+	bool hit = false;
+
+	rcu_read_lock();
+	cache = rcu_dereference(info->perm_cache);
+	if (cache && cache->gen == atomic_read(&sdcardfs_perm_gen) &&
+			cache->vfsopts == vfsopts &&
+			cache->owner_mode == owner_mode) {
+		*out = *cache;
+		hit = true;
+	}
+	rcu_read_unlock();
+	return hit;
+}
+
+void sdcardfs_perm_cache_set(struct sdcardfs_inode_info *info,
+			const struct sdcardfs_perm_cache *val)
+{
+	struct sdcardfs_perm_cache *cache, *old;
+
+	/* Callers may be in rcu-walk, so never sleep; a miss is harmless */
+	cache = kmalloc(sizeof(*cache), GFP_ATOMIC | __GFP_NOWARN);
+	if (!cache)
+		return;
+	*cache = *val;
+	old = (struct sdcardfs_perm_cache __force *)xchg(&info->perm_cache,
+			(struct sdcardfs_perm_cache __force __rcu *)cache);
+	if (old)
+		kfree_rcu(old, rcu);
+}
+
 /* copy derived state from parent inode */
 static void inherit_derived_state(struct inode *parent, struct inode *child)
 {
@@ -56,13 +98,14 @@ void setup_derived_state(struct inode *inode, perm_t perm, userid_t userid,
 //Jiemin.Zhu@PSW.Android.SdardFs, 2018/08/08, Modify for adding more protected directorys
 	info->data->oppo_flags = 0;
 #endif /* VENDOR_EDIT */
+	sdcardfs_perm_invalidate();
 }
 
 /* While renaming, there is a point where we want the path from dentry,
  * but the name from newdentry
  */
-void get_derived_permission_new(struct dentry *parent, struct dentry *dentry,
-				const struct qstr *name)
+static void __get_derived_permission_new(struct dentry *parent,
+				struct dentry *dentry, const struct qstr *name)
 {
 	struct sdcardfs_inode_info *info = SDCARDFS_I(d_inode(dentry));
 	struct sdcardfs_inode_info *parent_info = SDCARDFS_I(d_inode(parent));
@@ -215,6 +258,38 @@ void get_derived_permission_new(struct dentry *parent, struct dentry *dentry,
 	}
 }
 
+static bool derived_state_changed(const struct sdcardfs_inode_data *a,
+				const struct sdcardfs_inode_data *b)
+{
+	return a->perm != b->perm || a->userid != b->userid ||
+		a->d_uid != b->d_uid || a->under_android != b->under_android ||
+		a->under_cache != b->under_cache ||
+		a->under_obb != b->under_obb;
+}
+
+void get_derived_permission_new(struct dentry *parent, struct dentry *dentry,
+				const struct qstr *name)
+{
+	struct sdcardfs_inode_info *info = SDCARDFS_I(d_inode(dentry));
+	struct sdcardfs_inode_data old = *info->data;
+	struct sdcardfs_inode_data *old_top;
+
+	spin_lock(&info->top_lock);
+	old_top = info->top_data;
+	spin_unlock(&info->top_lock);
+
+	__get_derived_permission_new(parent, dentry, name);
+
+	/*
+	 * Lookups re-derive the same state over and over; only invalidate the
+	 * permission caches when something visible actually changed. This
+	 * inode's data may be the top of others, so this covers them as well.
+	 */
+	if (old_top != READ_ONCE(info->top_data) ||
+			derived_state_changed(&old, info->data))
+		sdcardfs_perm_invalidate();
+}
+
 void get_derived_permission(struct dentry *parent, struct dentry *dentry)
 {
 	get_derived_permission_new(parent, dentry, &dentry->d_name);
@@ -405,6 +480,7 @@ static void __fixup_perms_recursive(struct dentry *dentry, struct limit_search *
 void fixup_perms_recursive(struct dentry *dentry, struct limit_search *limit)
 {
 	__fixup_perms_recursive(dentry, limit, 0);
+	sdcardfs_perm_invalidate();
 }
 
 /* main function for updating derived permission */
@@ -621,11 +621,50 @@ void copy_attrs(struct inode *dest, const struct inode *src)
 #endif
 }
 
+/*
+ * Derived uid, gid and permission bits of an inode as seen through mnt. These
+ * only change with the derived state, the package list or the view options,
+ * so they are cached per inode and recomputed once the generation moves.
+ */
+static int sdcardfs_derive_perm(struct vfsmount *mnt, struct inode *inode,
+				struct sdcardfs_perm_cache *perm, ktime_t start)
+{
+	struct sdcardfs_inode_info *info = SDCARDFS_I(inode);
+	struct sdcardfs_inode_data *top;
+	bool hit;
+
+	hit = sdcardfs_perm_cache_get(info, mnt->data, perm);
+	if (start)
+		sdcardfs_perf_cache_hit(hit);
+	if (hit)
+		return 0;
+
+	perm->gen = atomic_read(&sdcardfs_perm_gen);
+	/* pairs with the barrier in sdcardfs_perm_invalidate() */
+	smp_rmb();
+	top = top_data_get(info);
+	if (!top)
+		return -EINVAL;
+	perm->vfsopts = mnt->data;
+	perm->owner_mode = info->lower_inode->i_mode & 0700;
+	perm->uid = make_kuid(&init_user_ns, top->d_uid);
+	perm->gid = make_kgid(&init_user_ns, get_gid(mnt, inode->i_sb, top));
+	perm->mode = get_mode(mnt, info, top);
+	data_put(top);
+	/*
+	 * If the generation moved while deriving, this entry is already stale
+	 * and the next call simply misses again.
+	 */
+	sdcardfs_perm_cache_set(info, perm);
+	return 0;
+}
+
 static int sdcardfs_permission(struct vfsmount *mnt, struct inode *inode, int mask)
 {
 	int err;
 	struct inode tmp;
-	struct sdcardfs_inode_data *top = top_data_get(SDCARDFS_I(inode));
+	struct sdcardfs_perm_cache perm;
+	ktime_t start = sdcardfs_perf_start();
 #ifdef VENDOR_EDIT
 	kgid_t media_gid = make_kgid(&init_user_ns, AID_MEDIA_RW);
 	struct sdcardfs_sb_info *sbi = SDCARDFS_SB(inode->i_sb);
@@ -634,8 +673,9 @@ static int sdcardfs_permission(struct vfsmount *mnt, struct inode *inode, int ma
 	if (IS_ERR(mnt))
 		return PTR_ERR(mnt);
 
-	if (!top)
-		return -EINVAL;
+	err = sdcardfs_derive_perm(mnt, inode, &perm, start);
+	if (err)
+		return err;
 
 	/*
 	 * Permission check on sdcardfs inode.
@@ -649,20 +689,19 @@ static int sdcardfs_permission(struct vfsmount *mnt, struct inode *inode, int ma
 	 * locks must be dealt with to avoid undefined behavior.
 	 */
 	copy_attrs(&tmp, inode);
-	tmp.i_uid = make_kuid(&init_user_ns, top->d_uid);
-	tmp.i_gid = make_kgid(&init_user_ns, get_gid(mnt, inode->i_sb, top));
-	tmp.i_mode = (inode->i_mode & S_IFMT)
-			| get_mode(mnt, SDCARDFS_I(inode), top);
+	tmp.i_uid = perm.uid;
+	tmp.i_gid = perm.gid;
+	tmp.i_mode = (inode->i_mode & S_IFMT) | perm.mode;
 #ifdef VENDOR_EDIT
 	if (!sbi->options.multiuser && in_group_p(media_gid) && (mask & MAY_WRITE)) {
 		tmp.i_mode |= (MAY_WRITE << 3);
 	}
 #endif /* VENDOR_EDIT */
-	data_put(top);
 	tmp.i_sb = inode->i_sb;
 	if (IS_POSIXACL(inode))
 		pr_warn("%s: This may be undefined behavior...\n", __func__);
 	err = generic_permission(&tmp, mask);
+	sdcardfs_perf_end(SDCARDFS_PERF_PERMISSION, start);
 	return err;
 }
 
@@ -811,19 +850,19 @@ static int sdcardfs_setattr(struct vfsmount *mnt, struct dentry *dentry, struct
 static int sdcardfs_fillattr(struct vfsmount *mnt, struct inode *inode,
 				struct kstat *lower_stat, struct kstat *stat)
 {
-	struct sdcardfs_inode_info *info = SDCARDFS_I(inode);
-	struct sdcardfs_inode_data *top = top_data_get(info);
-	struct super_block *sb = inode->i_sb;
+	struct sdcardfs_perm_cache perm;
+	int err;
 
-	if (!top)
-		return -EINVAL;
+	err = sdcardfs_derive_perm(mnt, inode, &perm, 0);
+	if (err)
+		return err;
 
 	stat->dev = inode->i_sb->s_dev;
 	stat->ino = inode->i_ino;
-	stat->mode = (inode->i_mode  & S_IFMT) | get_mode(mnt, info, top);
+	stat->mode = (inode->i_mode  & S_IFMT) | perm.mode;
 	stat->nlink = inode->i_nlink;
-	stat->uid = make_kuid(&init_user_ns, top->d_uid);
-	stat->gid = make_kgid(&init_user_ns, get_gid(mnt, sb, top));
+	stat->uid = perm.uid;
+	stat->gid = perm.gid;
 	stat->rdev = inode->i_rdev;
 	stat->size = lower_stat->size;
 	stat->atime = lower_stat->atime;
@@ -831,7 +870,6 @@ static int sdcardfs_fillattr(struct vfsmount *mnt, struct inode *inode,
 	stat->ctime = lower_stat->ctime;
 	stat->blksize = lower_stat->blksize;
 	stat->blocks = lower_stat->blocks;
-	data_put(top);
 	return 0;
 }
 static int sdcardfs_getattr(const struct path *path, struct kstat *stat,
@@ -842,6 +880,7 @@ static int sdcardfs_getattr(const struct path *path, struct kstat *stat,
 	struct kstat lower_stat;
 	struct path lower_path;
 	struct dentry *parent;
+	ktime_t start = sdcardfs_perf_start();
 	int err;
 
 	parent = dget_parent(dentry);
@@ -860,6 +899,7 @@ static int sdcardfs_getattr(const struct path *path, struct kstat *stat,
 	err = sdcardfs_fillattr(mnt, d_inode(dentry), &lower_stat, stat);
 out:
 	sdcardfs_put_lower_path(dentry, &lower_path);
+	sdcardfs_perf_end(SDCARDFS_PERF_GETATTR, start);
 	return err;
 }
 
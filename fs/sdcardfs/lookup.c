@@ -421,6 +421,7 @@ struct dentry *sdcardfs_lookup(struct inode *dir, struct dentry *dentry,
 	struct path lower_parent_path;
 	int err = 0;
 	const struct cred *saved_cred = NULL;
+	ktime_t start = sdcardfs_perf_start();
 
 	parent = dget_parent(dentry);
 
@@ -469,5 +470,6 @@ struct dentry *sdcardfs_lookup(struct inode *dir, struct dentry *dentry,
 	revert_fsids(saved_cred);
 out_err:
 	dput(parent);
+	sdcardfs_perf_end(SDCARDFS_PERF_LOOKUP, start);
 	return ret;
 }
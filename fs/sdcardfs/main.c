@@ -439,6 +439,8 @@ static struct dentry *sdcardfs_mount_wrn(struct file_system_type *fs_type,
 
 void *sdcardfs_alloc_mnt_data(void)
 {
+	/* a new view may reuse the address of a freed one */
+	sdcardfs_perm_invalidate();
 	return kmalloc(sizeof(struct sdcardfs_vfsmount_options), GFP_KERNEL);
 }
 
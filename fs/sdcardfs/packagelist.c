@@ -30,6 +30,7 @@
 #include <linux/slab.h>
 
 #include <linux/configfs.h>
+#include <linux/math64.h>
 
 struct hashtable_entry {
 	struct hlist_node hlist;
@@ -747,6 +748,104 @@ static struct config_item *packages_make_item(struct config_group *group, const
 	return &package_details->item;
 }
 
+/*
+ * While perf_bench is set, lookup, getattr and permission latencies are
+ * accumulated here and reported through perf_stats. Writing perf_bench
+ * clears the counters.
+ */
+bool sdcardfs_perf_bench;
+
+struct sdcardfs_perf_stat {
+	atomic64_t count;
+	atomic64_t total_ns;
+	atomic64_t max_ns;
+};
+
+static struct sdcardfs_perf_stat sdcardfs_perf_stats[SDCARDFS_PERF_NR];
+static atomic64_t sdcardfs_perf_hits, sdcardfs_perf_misses;
+
+static const char * const sdcardfs_perf_names[SDCARDFS_PERF_NR] = {
+	[SDCARDFS_PERF_LOOKUP]		= "lookup",
+	[SDCARDFS_PERF_GETATTR]		= "getattr",
+	[SDCARDFS_PERF_PERMISSION]	= "permission",
+};
+
+void sdcardfs_perf_account(enum sdcardfs_perf_op op, ktime_t start)
+{
+	struct sdcardfs_perf_stat *stat = &sdcardfs_perf_stats[op];
+	s64 delta = ktime_to_ns(ktime_sub(ktime_get(), start));
+	s64 max = atomic64_read(&stat->max_ns);
+
+	atomic64_inc(&stat->count);
+	atomic64_add(delta, &stat->total_ns);
+	while (delta > max) {
+		s64 old = atomic64_cmpxchg(&stat->max_ns, max, delta);
+
+		if (old == max)
+			break;
+		max = old;
+	}
+}
+
+void sdcardfs_perf_cache_hit(bool hit)
+{
+	atomic64_inc(hit ? &sdcardfs_perf_hits : &sdcardfs_perf_misses);
+}
+
+static void sdcardfs_perf_reset(void)
+{
+	int i;
+
+	for (i = 0; i < SDCARDFS_PERF_NR; i++) {
+		atomic64_set(&sdcardfs_perf_stats[i].count, 0);
+		atomic64_set(&sdcardfs_perf_stats[i].total_ns, 0);
+		atomic64_set(&sdcardfs_perf_stats[i].max_ns, 0);
+	}
+	atomic64_set(&sdcardfs_perf_hits, 0);
+	atomic64_set(&sdcardfs_perf_misses, 0);
+}
+
+static ssize_t packages_perf_bench_show(struct config_item *item, char *page)
+{
+	return scnprintf(page, PAGE_SIZE, "%d\n", READ_ONCE(sdcardfs_perf_bench));
+}
+
+static ssize_t packages_perf_bench_store(struct config_item *item,
+				       const char *page, size_t count)
+{
+	bool enable;
+	int ret;
+
+	ret = kstrtobool(page, &enable);
+	if (ret)
+		return ret;
+	sdcardfs_perf_reset();
+	WRITE_ONCE(sdcardfs_perf_bench, enable);
+	return count;
+}
+
+static ssize_t packages_perf_stats_show(struct config_item *item, char *page)
+{
+	int i, count = 0;
+
+	for (i = 0; i < SDCARDFS_PERF_NR; i++) {
+		struct sdcardfs_perf_stat *stat = &sdcardfs_perf_stats[i];
+		u64 nr = atomic64_read(&stat->count);
+		u64 total = atomic64_read(&stat->total_ns);
+
+		count += scnprintf(page + count, PAGE_SIZE - count,
+				"%s count=%llu avg_ns=%llu max_ns=%lld\n",
+				sdcardfs_perf_names[i], nr,
+				nr ? div64_u64(total, nr) : 0,
+				(long long)atomic64_read(&stat->max_ns));
+	}
+	count += scnprintf(page + count, PAGE_SIZE - count,
+			"perm_cache hits=%lld misses=%lld\n",
+			(long long)atomic64_read(&sdcardfs_perf_hits),
+			(long long)atomic64_read(&sdcardfs_perf_misses));
+	return count;
+}
+
 static ssize_t packages_list_show(struct config_item *item, char *page)
 {
 	struct hashtable_entry *hash_cur_app;
@@ -800,10 +899,14 @@ static struct configfs_attribute packages_attr_packages_gid_list = {
 };
 
 SDCARDFS_CONFIGFS_ATTR_WO(packages_, remove_userid);
+SDCARDFS_CONFIGFS_ATTR(packages_, perf_bench);
+SDCARDFS_CONFIGFS_ATTR_RO(packages_, perf_stats);
 
 static struct configfs_attribute *packages_attrs[] = {
 	&packages_attr_packages_gid_list,
 	&packages_attr_remove_userid,
+	&packages_attr_perf_bench,
+	&packages_attr_perf_stats,
 	NULL,
 };
 
@@ -45,6 +45,8 @@
 #include <linux/security.h>
 #include <linux/string.h>
 #include <linux/list.h>
+#include <linux/ktime.h>
+#include <linux/rcupdate.h>
 #include "multiuser.h"
 
 /* the file system name */
@@ -200,6 +202,21 @@ struct sdcardfs_inode_data {
 #endif /* VENDOR_EDIT */
 };
 
+/*
+ * Result of the last permission derivation for an inode, as seen through one
+ * view. It is valid only while gen matches sdcardfs_perm_gen, which is bumped
+ * whenever derived state, the package list or mount options change.
+ */
+struct sdcardfs_perm_cache {
+	struct rcu_head rcu;
+	unsigned int gen;
+	const void *vfsopts;
+	umode_t owner_mode;
+	umode_t mode;
+	kuid_t uid;
+	kgid_t gid;
+};
+
 /* sdcardfs inode data in memory */
 struct sdcardfs_inode_info {
 	struct inode *lower_inode;
@@ -210,6 +227,9 @@ struct sdcardfs_inode_info {
 	spinlock_t top_lock;
 	struct sdcardfs_inode_data *top_data;
 
+	/* last derived uid/gid/mode, see sdcardfs_perm_cache */
+	struct sdcardfs_perm_cache __rcu *perm_cache;
+
 	struct inode vfs_inode;
 };
 
@@ -542,6 +562,43 @@ extern void get_derived_permission_new(struct dentry *parent, struct dentry *den
 extern void fixup_perms_recursive(struct dentry *dentry, struct limit_search *limit);
 
 extern void update_derived_permission_lock(struct dentry *dentry);
+
+extern atomic_t sdcardfs_perm_gen;
+
+static inline void sdcardfs_perm_invalidate(void)
+{
+	/* order the derived state updates before the new generation */
+	smp_mb__before_atomic();
+	atomic_inc(&sdcardfs_perm_gen);
+}
+
+extern bool sdcardfs_perm_cache_get(struct sdcardfs_inode_info *info,
+			const void *vfsopts, struct sdcardfs_perm_cache *out);
+extern void sdcardfs_perm_cache_set(struct sdcardfs_inode_info *info,
+			const struct sdcardfs_perm_cache *val);
+
+/* latency accounting while perf_bench is enabled, see packagelist.c */
+enum sdcardfs_perf_op {
+	SDCARDFS_PERF_LOOKUP,
+	SDCARDFS_PERF_GETATTR,
+	SDCARDFS_PERF_PERMISSION,
+	SDCARDFS_PERF_NR,
+};
+
+extern bool sdcardfs_perf_bench;
+extern void sdcardfs_perf_account(enum sdcardfs_perf_op op, ktime_t start);
+extern void sdcardfs_perf_cache_hit(bool hit);
+
+static inline ktime_t sdcardfs_perf_start(void)
+{
+	return READ_ONCE(sdcardfs_perf_bench) ? ktime_get() : 0;
+}
+
+static inline void sdcardfs_perf_end(enum sdcardfs_perf_op op, ktime_t start)
+{
+	if (start)
+		sdcardfs_perf_account(op, start);
+}
 void fixup_lower_ownership(struct dentry *dentry, const char *name);
 extern int need_graft_path(struct dentry *dentry);
 extern int is_base_obbpath(struct dentry *dentry);
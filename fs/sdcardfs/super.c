@@ -146,6 +146,7 @@ static int sdcardfs_remount_fs2(struct vfsmount *mnt, struct super_block *sb,
 	}
 	pr_debug_ratelimited("Remount options were %s for vfsmnt %pK.\n", options, mnt);
 	err = parse_options_remount(sb, options, *flags & ~MS_SILENT, mnt->data);
+	sdcardfs_perm_invalidate();
 
 
 	return err;
@@ -160,6 +161,8 @@ static void *sdcardfs_clone_mnt_data(void *data)
 		return NULL;
 	opt->gid = old->gid;
 	opt->mask = old->mask;
+	/* a new view may reuse the address of a freed one */
+	sdcardfs_perm_invalidate();
 	return opt;
 }
 
@@ -170,6 +173,7 @@ static void sdcardfs_copy_mnt_data(void *data, void *newdata)
 
 	old->gid = new->gid;
 	old->mask = new->mask;
+	sdcardfs_perm_invalidate();
 }
 
 /*
@@ -228,6 +232,7 @@ static void i_callback(struct rcu_head *head)
 	struct inode *inode = container_of(head, struct inode, i_rcu);
 
 	release_own_data(SDCARDFS_I(inode));
+	kfree(rcu_dereference_protected(SDCARDFS_I(inode)->perm_cache, 1));
 	kmem_cache_free(sdcardfs_inode_cachep, SDCARDFS_I(inode));
 }
 
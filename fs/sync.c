@@ -226,7 +226,7 @@ int vfs_fsync_range(struct file *file, loff_t start, loff_t end, int datasync)
 	struct inode *inode = file->f_mapping->host;
 
 #ifdef CONFIG_DYNAMIC_FSYNC
-	if (dyn_fsync_active && suspend_active)
+	if (dyn_fsync_defer(file, datasync))
 		return 0;
 #endif
 
@@ -288,19 +288,11 @@ static int do_fsync(unsigned int fd, int datasync)
 
 SYSCALL_DEFINE1(fsync, unsigned int, fd)
 {
-#ifdef CONFIG_DYNAMIC_FSYNC
-	if (dyn_fsync_active && suspend_active)
-		return 0;
-#endif
 	return do_fsync(fd, 0);
 }
 
 SYSCALL_DEFINE1(fdatasync, unsigned int, fd)
 {
-#ifdef CONFIG_DYNAMIC_FSYNC
-	if (dyn_fsync_active && suspend_active)
-		return 0;
-#endif
 	return do_fsync(fd, 1);
 }
 
@@ -360,11 +352,6 @@ SYSCALL_DEFINE4(sync_file_range, int, fd, loff_t, offset, loff_t, nbytes,
 	loff_t endbyte;			/* inclusive */
 	umode_t i_mode;
 
-#ifdef CONFIG_DYNAMIC_FSYNC
-	if (dyn_fsync_active && suspend_active)
-		return 0;
-#endif
-
 	ret = -EINVAL;
 	if (flags & ~VALID_FLAGS)
 		goto out;
@@ -413,6 +400,10 @@ SYSCALL_DEFINE4(sync_file_range, int, fd, loff_t, offset, loff_t, nbytes,
 
 	mapping = f.file->f_mapping;
 	ret = 0;
+#ifdef CONFIG_DYNAMIC_FSYNC
+	if (dyn_fsync_defer(f.file, 1))
+		goto out_put;
+#endif
 	if (flags & SYNC_FILE_RANGE_WAIT_BEFORE) {
 		ret = file_fdatawait_range(f.file, offset, endbyte);
 		if (ret < 0)
@@ -440,9 +431,5 @@ SYSCALL_DEFINE4(sync_file_range, int, fd, loff_t, offset, loff_t, nbytes,
 SYSCALL_DEFINE4(sync_file_range2, int, fd, unsigned int, flags,
 				 loff_t, offset, loff_t, nbytes)
 {
-#ifdef CONFIG_DYNAMIC_FSYNC
-	if (dyn_fsync_active && suspend_active)
-		return 0;
-#endif
 	return sys_sync_file_range(fd, offset, nbytes, flags);
 }
@@ -615,6 +615,12 @@ struct drm_mode_config {
 	 * connectors must be of and active must be set to disabled, too.
 	 */
 	struct drm_property *prop_mode_id;
+	/**
+	 * @prop_target_vblank: Default atomic CRTC property to set the vblank
+	 * count a commit should take effect at, see
+	 * &drm_crtc_state.target_vblank. 0 means as soon as possible.
+	 */
+	struct drm_property *prop_target_vblank;
 
 	/**
 	 * @dvi_i_subconnector_property: Optional DVI-I property to
@@ -149,6 +149,22 @@ struct drm_vblank_crtc {
 	 * disabling functions multiple times.
 	 */
 	bool enabled;
+
+	/**
+	 * @deadline_commits: Number of commits that asked for a target vblank,
+	 * see drm_crtc_wait_commit_deadline().
+	 */
+	u32 deadline_commits;
+	/**
+	 * @deadline_late: Number of those commits that were ready later than
+	 * the deadline margin before their target vblank.
+	 */
+	u32 deadline_late;
+	/**
+	 * @deadline_missed: Number of those commits that took effect after
+	 * their target vblank.
+	 */
+	u32 deadline_missed;
 };
 
 int drm_vblank_init(struct drm_device *dev, unsigned int num_crtcs);
@@ -169,6 +185,8 @@ void drm_crtc_vblank_off(struct drm_crtc *crtc);
 void drm_crtc_vblank_reset(struct drm_crtc *crtc);
 void drm_crtc_vblank_on(struct drm_crtc *crtc);
 u32 drm_crtc_accurate_vblank_count(struct drm_crtc *crtc);
+void drm_crtc_wait_commit_deadline(struct drm_crtc *crtc, u32 target);
+void drm_crtc_commit_deadline_done(struct drm_crtc *crtc, u32 target);
 
 bool drm_calc_vbltimestamp_from_scanoutpos(struct drm_device *dev,
 					   unsigned int pipe, int *max_error,
@@ -0,0 +1,40 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _LINUX_ALLOC_BENCH_H
+#define _LINUX_ALLOC_BENCH_H
+
+#include <linux/list.h>
+#include <linux/types.h>
+
+/**
+ * struct alloc_bench_ops - allocator driven by the allocation benchmark
+ * @name: name written to the benchmark's allocator file to select it
+ * @max_size: largest allocation the allocator takes, in bytes
+ * @setup: optional, returns the context passed to the other callbacks for
+ * one run or an ERR_PTR
+ * @teardown: optional, releases the context returned by @setup
+ * @alloc: allocates @size bytes, returns a handle or 0 on failure
+ * @free: frees an allocation returned by @alloc
+ */
+struct alloc_bench_ops {
+	const char *name;
+	size_t max_size;
+	void *(*setup)(void);
+	void (*teardown)(void *ctx);
+	unsigned long (*alloc)(void *ctx, size_t size);
+	void (*free)(void *ctx, unsigned long handle);
+	struct list_head list;
+};
+
+#ifdef CONFIG_TEST_ALLOC_BENCH
+void alloc_bench_register(struct alloc_bench_ops *ops);
+void alloc_bench_unregister(struct alloc_bench_ops *ops);
+#else
+static inline void alloc_bench_register(struct alloc_bench_ops *ops)
+{
+}
+static inline void alloc_bench_unregister(struct alloc_bench_ops *ops)
+{
+}
+#endif
+
+#endif /* _LINUX_ALLOC_BENCH_H */
@@ -453,6 +453,14 @@ struct cgroup_root {
 
 	/* The name for this hierarchy - may be empty */
 	char name[MAX_CGROUP_ROOT_NAMELEN];
+
+	/*
+	 * Attach writes on this hierarchy and the time they took in ns,
+	 * protected by cgroup_mutex.
+	 */
+	u64 nr_migrations;
+	u64 migrate_time;
+	u64 migrate_time_max;
 };
 
 /*
@@ -5,6 +5,8 @@
 #ifndef _CPU_INPUT_BOOST_H_
 #define _CPU_INPUT_BOOST_H_
 
+#include <linux/devfreq_boost.h>
+
 #ifdef CONFIG_CPU_INPUT_BOOST
 void cpu_input_boost_kick(void);
 void cpu_input_boost_kick_max(unsigned int duration_ms);
@@ -17,4 +19,10 @@ static inline void cpu_input_boost_kick_max(unsigned int duration_ms)
 }
 #endif
 
+#ifdef CONFIG_DEVFREQ_BOOST
+/* devfreq_boost has no engine of its own and boosts through this one */
+void cpu_input_boost_kick_devfreq_max(enum df_device device,
+				      unsigned int duration_ms);
+#endif
+
 #endif /* _CPU_INPUT_BOOST_H_ */
@@ -10,6 +10,7 @@
 enum df_device {
 	DEVFREQ_CPU_LLCC_DDR_BW,
 	DEVFREQ_CPU_CPU_LLC_BW,
+	DEVFREQ_GPU,
 	DEVFREQ_MAX
 };
 
@@ -17,6 +18,8 @@ enum df_device {
 void devfreq_boost_kick(enum df_device device);
 void devfreq_boost_kick_max(enum df_device device, unsigned int duration_ms);
 void devfreq_register_boost_device(enum df_device device, struct devfreq *df);
+void devfreq_boost_update(enum df_device device, bool screen_off,
+			  unsigned long boost_freq, bool max_boost);
 #else
 static inline
 void devfreq_boost_kick(enum df_device device)
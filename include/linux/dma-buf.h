@@ -371,6 +371,25 @@ struct dma_buf_ops {
 	 * will be populated with the buffer's flags.
 	 */
 	int (*get_flags)(struct dma_buf *, unsigned long *flags);
+
+	/**
+	 * @cache_sgt_mapping:
+	 *
+	 * If true the framework keeps the first mapping made for each
+	 * attachment until the attachment goes away, instead of calling
+	 * @unmap_dma_buf on every dma_buf_unmap_attachment(). Detaching such
+	 * an attachment parks it with its mapping, and the next
+	 * dma_buf_attach() from the same device gets it back already mapped.
+	 * Parked attachments are really detached when the buffer is
+	 * released, under memory pressure, or by
+	 * dma_buf_map_cache_flush_device().
+	 *
+	 * No cache maintenance is done for a cached mapping after it has
+	 * been created. CPU access has to be bracketed with
+	 * dma_buf_begin_cpu_access() and dma_buf_end_cpu_access(), which
+	 * the exporter must apply to attachments that are still mapped.
+	 */
+	bool cache_sgt_mapping;
 };
 
 /**
@@ -395,6 +414,7 @@ struct dma_buf_ops {
  * @poll: for userspace poll support
  * @cb_excl: for userspace poll support
  * @cb_shared: for userspace poll support
+ * @cached_attachments: detached attachments kept for their cached mapping
  *
  * This represents a shared buffer, created by calling dma_buf_export(). The
  * userspace representation is a normal file descriptor, which can be created by
@@ -437,6 +457,7 @@ struct dma_buf {
 	atomic_t dent_count;
 
 	bool from_kmem;
+	struct list_head cached_attachments;
 };
 
 /**
@@ -445,6 +466,13 @@ struct dma_buf {
  * @dev: device attached to the buffer.
  * @node: list of dma_buf_attachment.
  * @priv: exporter specific attachment data.
+ * @dma_map_attrs: DMA attributes the importer wants the buffer mapped with.
+ * @sgt: mapping kept for &dma_buf_ops.cache_sgt_mapping exporters.
+ * @dir: direction of @sgt.
+ * @sgt_attrs: @dma_map_attrs that @sgt was created with.
+ * @cache_hnode: node in the mapping cache while parked.
+ * @cache_lru: position in the mapping cache LRU while parked.
+ * @cache_node: entry in &dma_buf.cached_attachments while parked.
  *
  * This structure holds the attachment information between the dma_buf buffer
  * and its user device(s). The list contains one attachment struct per device
@@ -461,6 +489,12 @@ struct dma_buf_attachment {
 	struct list_head node;
 	void *priv;
 	unsigned long dma_map_attrs;
+	struct sg_table *sgt;
+	enum dma_data_direction dir;
+	unsigned long sgt_attrs;
+	struct hlist_node cache_hnode;
+	struct list_head cache_lru;
+	struct list_head cache_node;
 };
 
 /**
@@ -527,6 +561,7 @@ struct sg_table *dma_buf_map_attachment(struct dma_buf_attachment *,
 					enum dma_data_direction);
 void dma_buf_unmap_attachment(struct dma_buf_attachment *, struct sg_table *,
 				enum dma_data_direction);
+void dma_buf_map_cache_flush_device(struct device *dev);
 int dma_buf_begin_cpu_access(struct dma_buf *dma_buf,
 			     enum dma_data_direction dir);
 int dma_buf_begin_cpu_access_partial(struct dma_buf *dma_buf,
@@ -18,6 +18,9 @@
 
 struct dma_iommu_mapping;
 struct io_pgtable_ops;
+struct fast_iova_cpu_cache;
+struct fast_iova_depot;
+struct fast_iova_mag;
 
 struct dma_fast_smmu_mapping {
 	struct device		*dev;
@@ -35,6 +38,17 @@ struct dma_fast_smmu_mapping {
 	unsigned long	upcoming_stale_bit;
 	bool		have_stale_tlbs;
 
+	/*
+	 * Per-CPU magazines of freed IOVAs for small sizes. Freed IOVAs may
+	 * still be in the TLB and are only handed out again once an
+	 * invalidate that started after they were freed has completed.
+	 */
+	struct fast_iova_cpu_cache __percpu *iova_cache;
+	struct fast_iova_depot *iova_depot;
+	struct fast_iova_mag *iova_mags;
+	unsigned long	tlbi_gen;
+	unsigned long	tlbi_done;
+
 	dma_addr_t	pgtbl_dma_handle;
 	struct io_pgtable_ops *pgtbl_ops;
 
@@ -6,8 +6,18 @@
  */
 
 #define DYN_FSYNC_ACTIVE_DEFAULT true
-#define DYN_FSYNC_VERSION_MAJOR 2
-#define DYN_FSYNC_VERSION_MINOR 1
+#define DYN_FSYNC_VERSION_MAJOR 3
+#define DYN_FSYNC_VERSION_MINOR 0
+
+#define DYN_FSYNC_MAX_DELAY_MS 5000
+#define DYN_FSYNC_MAX_QUEUED 64
+#define DYN_FSYNC_MAX_ENTRIES 16
+#define DYN_FSYNC_NAME_LEN 32
+#define DYN_FSYNC_MAX_DEPTH 8
+
+struct file;
 
 extern bool suspend_active;
 extern bool dyn_fsync_active;
+
+extern bool dyn_fsync_defer(struct file *file, int datasync);
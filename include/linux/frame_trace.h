@@ -0,0 +1,23 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _LINUX_FRAME_TRACE_H
+#define _LINUX_FRAME_TRACE_H
+
+#include <linux/types.h>
+
+#ifdef CONFIG_FRAME_TRACE
+void frame_trace_commit(void);
+void frame_trace_gpu_frame(u64 latency_ns);
+void frame_trace_present(void);
+#else
+static inline void frame_trace_commit(void)
+{
+}
+static inline void frame_trace_gpu_frame(u64 latency_ns)
+{
+}
+static inline void frame_trace_present(void)
+{
+}
+#endif
+
+#endif /* _LINUX_FRAME_TRACE_H */
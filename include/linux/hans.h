@@ -28,6 +28,13 @@
 #define INTERFACETOKEN_BUFF_SIZE (140)
 #define PARCEL_OFFSET (16) /* sync with the writeInterfaceToken */
 #define CPUCTL_VERSION (2)
+#define HANS_MAX_BATCH_UIDS (64)
+
+/*Events that thaw a UID frozen through FREEZE_UIDS in kernel*/
+#define HANS_THAW_SYNC_BINDER   (1 << 0)
+#define HANS_THAW_ASYNC_BINDER  (1 << 1)
+#define HANS_THAW_NET           (1 << 2)
+#define HANS_THAW_SIGNAL        (1 << 3)
 
 /* hans_message for comunication with HANS native deamon
  * type: async binder/sync binder/signal/pkg/loopback
@@ -36,6 +43,11 @@
  * caller_pid: binder, caller -> unfreeze (target) UID
  * target_uid: UID want to be unfrozen
  * pkg_cmd: Add/Remove monitored UID
+ *
+ * FREEZE_UIDS/THAW_UIDS carry a batch of code UIDs as an int array right
+ * after the message, pkg_cmd holds the HANS_THAW_* flags for FREEZE_UIDS.
+ * UID_THAWED reports a UID thawed in kernel, code holds the HANS_THAW_*
+ * events that thawed it.
  */
 struct hans_message {
         int type;
@@ -66,6 +78,14 @@ enum message_type {
 
         /*kernel <--> native deamon*/
         LOOP_BACK,
+
+        /*native deamon --> kernel*/
+        FREEZE_UIDS,
+        THAW_UIDS,
+
+        /*kernel --> native deamon*/
+        UID_THAWED,
+
         TYPE_MAX
 };
 
@@ -88,6 +108,12 @@ void hans_network_cmd_parse(uid_t uid, enum pkg_cmd cmd);
 void hans_check_frozen_transcation(uid_t uid, enum message_type type);
 int hans_netfilter_init(void);
 void hans_netfilter_deinit(void);
+bool hans_uid_freezing(struct task_struct *p);
+int hans_freeze_uids(const int *uids, int count, unsigned int flags);
+void hans_thaw_uids(const int *uids, int count);
+bool hans_thaw_uid(uid_t uid, unsigned int reason);
+bool hans_thaw_task_group(struct task_struct *task, unsigned int reason);
+void hans_freeze_deinit(void);
 
 #if defined(CONFIG_CFS_BANDWIDTH)
 static inline bool is_belong_cpugrp(struct task_struct *task)
@@ -191,6 +191,13 @@ extern struct cred init_cred;
 # define INIT_NUMA_BALANCING(tsk)
 #endif
 
+#ifdef CONFIG_SCHED_UX
+# define INIT_SCHED_UX(tsk)						\
+	.ux_entry	= LIST_HEAD_INIT(tsk.ux_entry),
+#else
+# define INIT_SCHED_UX(tsk)
+#endif
+
 #ifdef CONFIG_KASAN
 # define INIT_KASAN(tsk)						\
 	.kasan_depth = 1,
@@ -297,6 +304,7 @@ extern struct cred init_cred;
 	INIT_PREV_CPUTIME(tsk)						\
 	INIT_VTIME(tsk)							\
 	INIT_NUMA_BALANCING(tsk)					\
+	INIT_SCHED_UX(tsk)						\
 	INIT_KASAN(tsk)							\
 	INIT_LIVEPATCH(tsk)						\
 	INIT_TASK_SECURITY						\
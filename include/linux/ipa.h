@@ -682,6 +682,11 @@ struct ipa_ext_intf {
  *  by IPA driver
  * @keep_ipa_awake: when true, IPA will not be clock gated
  * @napi_enabled: when true, IPA call client callback to start polling
+ * @napi_def_obj: NAPI instance for the default WAN pipe set up along with
+ *  the coalescing pipe. When set, the default pipe gets its own event ring
+ *  and is polled on this instance instead of sharing @napi_obj
+ * @napi_def_cpu: CPU to schedule @napi_def_obj on, negative for the CPU
+ *  taking the interrupt
  * @bypass_agg: when true, IPA bypasses the aggregation
  */
 struct ipa_sys_connect_params {
@@ -694,6 +699,8 @@ struct ipa_sys_connect_params {
 	bool keep_ipa_awake;
 	struct napi_struct *napi_obj;
 	bool napi_enabled;
+	struct napi_struct *napi_def_obj;
+	int napi_def_cpu;
 	bool recycle_enabled;
 	bool bypass_agg;
 };
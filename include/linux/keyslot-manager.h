@@ -50,6 +50,22 @@ struct keyslot_mgmt_ll_ops {
 				 u8 *secret, unsigned int secret_size);
 };
 
+/**
+ * struct keyslot_manager_stats - keyslot usage counters
+ * @fast_hits: key found in a slot in use, without taking the ksm lock
+ * @hits: key found in a programmed slot under the ksm lock
+ * @programs: key programmed into a slot
+ * @evictions: programs that replaced the key of the least recently used slot
+ * @waits: times no slot was idle and a request had to wait for one
+ */
+struct keyslot_manager_stats {
+	u64 fast_hits;
+	u64 hits;
+	u64 programs;
+	u64 evictions;
+	u64 waits;
+};
+
 struct keyslot_manager *keyslot_manager_create(
 	struct device *dev,
 	unsigned int num_slots,
@@ -81,6 +97,9 @@ void keyslot_manager_reprogram_all_keys(struct keyslot_manager *ksm);
 
 void *keyslot_manager_private(struct keyslot_manager *ksm);
 
+void keyslot_manager_get_stats(struct keyslot_manager *ksm,
+			       struct keyslot_manager_stats *stats);
+
 void keyslot_manager_destroy(struct keyslot_manager *ksm);
 
 struct keyslot_manager *keyslot_manager_create_passthrough(
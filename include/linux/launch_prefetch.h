@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) 2020, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _LINUX_LAUNCH_PREFETCH_H
+#define _LINUX_LAUNCH_PREFETCH_H
+
+#include <linux/atomic.h>
+#include <linux/fs.h>
+
+#ifdef CONFIG_LAUNCH_PREFETCH
+/* Number of launches being recorded */
+extern atomic_t launch_prefetch_sessions;
+
+void __launch_prefetch_record(struct address_space *mapping, pgoff_t offset,
+			      unsigned long nr);
+
+/* Called on a page cache miss of @nr pages at @offset */
+static inline void launch_prefetch_record(struct address_space *mapping,
+					  pgoff_t offset, unsigned long nr)
+{
+	if (atomic_read(&launch_prefetch_sessions))
+		__launch_prefetch_record(mapping, offset, nr);
+}
+#else
+static inline void launch_prefetch_record(struct address_space *mapping,
+					  pgoff_t offset, unsigned long nr)
+{
+}
+#endif
+
+#endif /* _LINUX_LAUNCH_PREFETCH_H */
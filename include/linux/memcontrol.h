@@ -195,6 +195,9 @@ struct mem_cgroup {
 
 	unsigned long soft_limit;
 
+	/* Active page cache kept out of reach of reclaim */
+	unsigned long file_protect;
+
 	/* vmpressure notifications */
 	struct vmpressure vmpressure;
 
@@ -208,6 +211,8 @@ struct mem_cgroup {
 	int		under_oom;
 
 	int	swappiness;
+	/* Bias of slab reclaim priority, > 0 shrinks this group harder */
+	int	slab_reclaim_prio;
 	/* OOM-Killer disable */
 	int		oom_kill_disable;
 
@@ -391,6 +396,15 @@ static inline struct mem_cgroup *lruvec_memcg(struct lruvec *lruvec)
 	return mz->memcg;
 }
 
+/*
+ * Number of active file pages @memcg is guaranteed to keep: refaults are
+ * activated and the active file list isn't aged while it holds fewer.
+ */
+static inline unsigned long mem_cgroup_file_protect(struct mem_cgroup *memcg)
+{
+	return memcg ? READ_ONCE(memcg->file_protect) : 0;
+}
+
 /**
  * parent_mem_cgroup - find the accounting parent of a memcg
  * @memcg: memcg whose parent to find
@@ -439,6 +453,20 @@ static inline bool mem_cgroup_online(struct mem_cgroup *memcg)
 	return !!(memcg->css.flags & CSS_ONLINE);
 }
 
+/*
+ * Reclaim priority to shrink the slab caches of @memcg with, so that
+ * background groups can give up their dentries and inodes well before
+ * foreground ones do.
+ */
+static inline int mem_cgroup_slab_priority(struct mem_cgroup *memcg,
+					   int priority)
+{
+	if (!memcg)
+		return priority;
+	return clamp(priority - READ_ONCE(memcg->slab_reclaim_prio),
+		     0, 2 * DEF_PRIORITY);
+}
+
 /*
  * For memory reclaim.
  */
@@ -862,11 +890,22 @@ static inline struct mem_cgroup *lruvec_memcg(struct lruvec *lruvec)
 	return NULL;
 }
 
+static inline unsigned long mem_cgroup_file_protect(struct mem_cgroup *memcg)
+{
+	return 0;
+}
+
 static inline bool mem_cgroup_online(struct mem_cgroup *memcg)
 {
 	return true;
 }
 
+static inline int mem_cgroup_slab_priority(struct mem_cgroup *memcg,
+					   int priority)
+{
+	return priority;
+}
+
 static inline unsigned long
 mem_cgroup_get_lru_size(struct lruvec *lruvec, enum lru_list lru)
 {
@@ -1215,6 +1254,9 @@ static inline int memcg_cache_id(struct mem_cgroup *memcg)
 	return memcg ? memcg->kmemcg_id : -1;
 }
 
+struct mem_cgroup *memcg_kmem_charge_nr(gfp_t gfp, unsigned int nr_pages);
+void memcg_kmem_uncharge_nr(struct mem_cgroup *memcg, unsigned int nr_pages);
+
 #else
 #define for_each_memcg_cache_index(_idx)	\
 	for (; NULL; )
@@ -1237,6 +1279,17 @@ static inline void memcg_put_cache_ids(void)
 {
 }
 
+static inline struct mem_cgroup *memcg_kmem_charge_nr(gfp_t gfp,
+						      unsigned int nr_pages)
+{
+	return NULL;
+}
+
+static inline void memcg_kmem_uncharge_nr(struct mem_cgroup *memcg,
+					  unsigned int nr_pages)
+{
+}
+
 #endif /* CONFIG_MEMCG && !CONFIG_SLOB */
 
 #endif /* _LINUX_MEMCONTROL_H */
@@ -2860,9 +2860,21 @@ struct reclaim_param {
 	int nr_to_reclaim;
 	/* pages reclaimed */
 	int nr_reclaimed;
+	/* shared list of isolated pages, NULL to shrink per pmd */
+	struct list_head *batch;
+	/* pages currently held on @batch */
+	int nr_batched;
+	/* only take anon pages left idle since the previous cold pass */
+	bool cold;
 };
+
+/* Pages isolated on a shared batch before it is shrunk */
+#define RECLAIM_BATCH_PAGES	(SWAP_CLUSTER_MAX * 4)
+
 extern struct reclaim_param reclaim_task_anon(struct task_struct *task,
-		int nr_to_reclaim);
+		int nr_to_reclaim, bool cold);
+extern struct reclaim_param reclaim_task_anon_batch(struct task_struct *task,
+		int nr_to_reclaim, struct list_head *batch, bool cold);
 #endif
 
 #endif /* __KERNEL__ */
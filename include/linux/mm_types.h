@@ -425,6 +425,12 @@ struct mm_struct {
 						 */
 
 
+#ifdef CONFIG_PROCESS_RECLAIM
+	/* Pages taken by process reclaim, and major faults reading back swap */
+	atomic_long_t reclaimed_pages;
+	atomic_long_t swapin_refaults;
+#endif
+
 	unsigned long hiwater_rss;	/* High-watermark of RSS usage */
 	unsigned long hiwater_vm;	/* High-water virtual memory usage */
 
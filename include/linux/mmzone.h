@@ -18,6 +18,7 @@
 #include <linux/pageblock-flags.h>
 #include <linux/page-flags-layout.h>
 #include <linux/atomic.h>
+#include <linux/multi_kswapd.h>
 #include <asm/page.h>
 /* Free memory management - zoned buddy allocator.  */
 #ifndef CONFIG_FORCE_MAX_ZONEORDER
@@ -176,6 +177,8 @@ enum node_stat_item {
 	WORKINGSET_ACTIVATE,
 	WORKINGSET_RESTORE,
 	WORKINGSET_NODERECLAIM,
+	WORKINGSET_PROTECT_REFAULT,	/* refaults in memcgs with protection */
+	WORKINGSET_PROTECT_ACTIVATE,	/* of those, activated to meet it */
 	NR_ANON_MAPPED,	/* Mapped anonymous pages */
 	NR_FILE_MAPPED,	/* pagecache pages mapped into pagetables.
 			   only modified from process context */
@@ -373,6 +376,14 @@ enum zone_type {
 struct page_label {
     unsigned long label;
     unsigned long segment;
+    /* Placement event counters, approximate */
+    unsigned long high_miss;	/* high-order allocs this label couldn't serve */
+    unsigned long low_alloc;	/* low-order allocs served from this label */
+    unsigned long compact;	/* high-order direct compactions ending here */
+    /* Snapshot of the above at the last boundary adaptation */
+    unsigned long prev_high_miss;
+    unsigned long prev_low_alloc;
+    unsigned long prev_compact;
 };
 #endif
 
@@ -692,6 +703,20 @@ typedef struct pglist_data {
 
 	int kswapd_failures;		/* Number of 'reclaimed == 0' runs */
 
+#ifdef CONFIG_MULTI_KSWAPD
+	/*
+	 * Helper reclaim threads, slot 0 is unused as it stands for
+	 * pgdat->kswapd. Protected by kswapd_threads_lock.
+	 */
+	struct task_struct *mkswapd[MAX_KSWAPD_THREADS];
+	/* Number of running reclaim threads, including kswapd itself */
+	int mkswapd_nr;
+	wait_queue_head_t mkswapd_wait;
+	/* Bumped by kswapd each time it starts balancing the node */
+	unsigned long mkswapd_seq;
+	enum zone_type mkswapd_classzone_idx;
+#endif
+
 #ifdef CONFIG_COMPACTION
 	int kcompactd_max_order;
 	enum zone_type kcompactd_classzone_idx;
@@ -259,4 +259,12 @@ static inline int msm_bus_floor_vote_context(const char *name, u64 floor_hz,
 	return -EINVAL;
 }
 #endif /*defined(CONFIG_DEBUG_BUS_VOTER) && defined(CONFIG_BUS_TOPOLOGY_ADHOC)*/
+
+#if defined(CONFIG_QCOM_BUS_CONFIG_RPMH) && defined(CONFIG_DEBUG_FS)
+void msm_bus_dbg_ddr_meas(const char *mon, unsigned long mbps);
+#else
+static inline void msm_bus_dbg_ddr_meas(const char *mon, unsigned long mbps)
+{
+}
+#endif
 #endif /*_ARCH_ARM_MACH_MSM_BUS_H*/
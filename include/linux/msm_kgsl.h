@@ -10,4 +10,21 @@ int kgsl_pwr_limits_set_freq(void *limit, unsigned int freq);
 void kgsl_pwr_limits_set_default(void *limit);
 unsigned int kgsl_pwr_limits_get_freq(enum kgsl_deviceid id);
 
+struct task_struct;
+
+/* Memory reclaim APIs */
+#if IS_REACHABLE(CONFIG_QCOM_KGSL)
+unsigned long kgsl_pool_reclaim(unsigned long nr_pages);
+unsigned long kgsl_task_gpu_pages(struct task_struct *task);
+#else
+static inline unsigned long kgsl_pool_reclaim(unsigned long nr_pages)
+{
+	return 0;
+}
+static inline unsigned long kgsl_task_gpu_pages(struct task_struct *task)
+{
+	return 0;
+}
+#endif
+
 #endif /* _MSM_KGSL_H */
@@ -8,6 +8,9 @@
 
 #define MAX_KSWAPD_THREADS 16
 
+struct ctl_table;
+
+#ifdef CONFIG_MULTI_KSWAPD
 extern int kswapd_threads;
 extern int max_kswapd_threads;
 
@@ -15,12 +18,15 @@ extern int kswapd_threads_sysctl_handler(struct ctl_table *, int,
 					void __user *, size_t *, loff_t *);
 extern void update_kswapd_threads(void);
 extern int kswapd_cpu_online_ext(unsigned int cpu);
-extern int cpu_callback_ext(struct notifier_block *nfb, unsigned long action,
-			void *hcpu);
 extern int kswapd_run_ext(int nid);
 extern void kswapd_stop_ext(int nid);
-extern int kswapd(void *p);
 
+/* Body of the helper threads, lives in mm/vmscan.c */
+extern int kswapd_helper(void *p);
+#else
+static inline int kswapd_cpu_online_ext(unsigned int cpu) { return 0; }
+static inline int kswapd_run_ext(int nid) { return 0; }
+static inline void kswapd_stop_ext(int nid) {}
+#endif
 
 #endif /*__OPLUS_MULTI_KSWAPD__*/
-
@@ -2832,6 +2832,8 @@ struct softnet_data {
 	unsigned int		time_squeeze;
 	unsigned int		received_rps;
 	unsigned int            gro_coalesced;
+	unsigned int		skb_cache_hit;
+	unsigned int		skb_cache_miss;
 
 #ifdef CONFIG_RPS
 	struct softnet_data	*rps_ipi_list;
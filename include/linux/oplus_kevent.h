@@ -37,6 +37,7 @@ struct kernel_packet_info
 }__attribute__((packed));
 
 int kevent_send_to_user(struct kernel_packet_info *userinfo);
+int kevent_queue_to_user(struct kernel_packet_info *userinfo);
 void kernel_kevent_receive(struct sk_buff *__skbbr);
 #endif /* CONFIG_OPLUS_KEVENT_UPLOAD */
 
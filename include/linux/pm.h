@@ -570,6 +570,10 @@ struct dev_pm_info {
 	bool			wakeup_path:1;
 	bool			syscore:1;
 	bool			no_pm_callbacks:1;	/* Owned by the PM core */
+	unsigned int		cb_seq;		/* Owned by the PM core */
+	unsigned int		chain_seq;	/* Ditto */
+	u64			cb_ns;		/* Ditto */
+	u64			chain_ns;	/* Ditto */
 #else
 	unsigned int		should_wakeup:1;
 #endif
@@ -30,6 +30,8 @@
 
 struct wake_irq;
 
+#define WAKEUP_HOLD_HIST_BUCKETS	16
+
 /**
  * struct wakeup_source - Representation of wakeup sources
  *
@@ -49,6 +51,7 @@ struct wake_irq;
  * @relax_count: Number of times the wakeup source was deactivated.
  * @expire_count: Number of times the wakeup source's timeout has expired.
  * @wakeup_count: Number of times the wakeup source might abort suspend.
+ * @hold_hist: Number of activations by how long they lasted, in log2 ms.
  * @dev: Struct device for sysfs statistics about the wakeup source.
  * @active: Status of the wakeup source.
  * @has_timeout: The wakeup source has been activated with a timeout.
@@ -75,6 +78,7 @@ struct wakeup_source {
 	unsigned long		relax_count;
 	unsigned long		expire_count;
 	unsigned long		wakeup_count;
+	unsigned int		hold_hist[WAKEUP_HOLD_HIST_BUCKETS];
 	struct device		*dev;
 	bool			active:1;
 	bool			autosleep_enabled:1;
@@ -559,6 +559,9 @@ extern int sched_set_group_id(struct task_struct *p, unsigned int group_id);
 extern unsigned int sched_get_group_id(struct task_struct *p);
 extern int sched_set_init_task_load(struct task_struct *p, int init_load_pct);
 extern u32 sched_get_init_task_load(struct task_struct *p);
+extern int sched_set_task_freq_hint(struct task_struct *p,
+				    unsigned int util_pct);
+extern unsigned int sched_get_task_freq_hint(struct task_struct *p);
 extern void sched_update_cpu_freq_min_max(const cpumask_t *cpus, u32 fmin,
 					  u32 fmax);
 extern int sched_set_boost(int enable);
@@ -601,6 +604,10 @@ struct ravg {
 	 * used for prediction
 	 *
 	 * 'demand_scaled' represents task's demand scaled to 1024
+	 *
+	 * 'hint_demand' is the per-window busy time the task declared it
+	 * expects through sched_set_task_freq_hint(). It acts as a floor on
+	 * 'pred_demand' and is reported to the governor while queued.
 	 */
 	u64 mark_start;
 	u32 sum, demand;
@@ -613,6 +620,9 @@ struct ravg {
 	u8 busy_buckets[NUM_BUSY_BUCKETS];
 	u16 demand_scaled;
 	u16 pred_demand_scaled;
+	u32 hint_demand;
+	u16 hint_demand_scaled;
+	u8 hint_pct;
 };
 #else
 static inline void sched_exit(struct task_struct *p) { }
@@ -831,6 +841,13 @@ struct task_struct {
 	int				boost;
 	u64				boost_period;
 	u64				boost_expires;
+#ifdef CONFIG_SCHED_UX
+	bool				ux_static;
+	atomic_t			ux_binder;
+	atomic_t			ux_depth;
+	/* on rq->ux_tasks while queued as UX, protected by rq->lock */
+	struct list_head		ux_entry;
+#endif
 #ifdef CONFIG_SCHED_WALT
 	struct ravg ravg;
 	/*
@@ -1436,6 +1453,10 @@ struct task_struct {
 #endif
 #ifdef CONFIG_ANDROID_SIMPLE_LMK
 	struct task_struct		*simple_lmk_next;
+#ifdef CONFIG_ANDROID_SIMPLE_LMK_PSI
+	struct hlist_node		simple_lmk_node;
+	short				simple_lmk_adj;
+#endif
 #endif
 #endif /* OPLUS_FEATURE_HEALTHINFO */
 
@@ -2083,4 +2104,13 @@ static inline void set_wake_up_idle(bool enabled)
 		current->flags &= ~PF_WAKE_UP_IDLE;
 }
 
+#ifdef CONFIG_SCHED_TUNE
+extern bool schedtune_task_top_app(struct task_struct *p);
+#else
+static inline bool schedtune_task_top_app(struct task_struct *p)
+{
+	return false;
+}
+#endif
+
 #endif
@@ -77,11 +77,21 @@ struct idle_state {
 	unsigned long power;	 /* power consumption in this idle state */
 };
 
+/*
+ * Utilization to capacity state lookup, one entry per SGE_CAP_LUT_SHIFT
+ * worth of utilization. Sized to fit a single cache line.
+ */
+#define SGE_CAP_LUT_SHIFT	4
+#define SGE_CAP_LUT_SIZE	(SCHED_CAPACITY_SCALE >> SGE_CAP_LUT_SHIFT)
+
 struct sched_group_energy {
 	unsigned int nr_idle_states;	/* number of idle states */
 	struct idle_state *idle_states;	/* ptr to idle state array */
 	unsigned int nr_cap_states;	/* number of capacity states */
 	struct capacity_state *cap_states; /* ptr to capacity state array */
+	unsigned int max_cap_idx;	/* highest state allowed by cpufreq */
+	/* first capacity state covering each utilization bucket */
+	u8 cap_lut[SGE_CAP_LUT_SIZE] ____cacheline_aligned;
 };
 
 unsigned long capacity_curr_of(int cpu);
@@ -0,0 +1,51 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _LINUX_SCHED_UX_H
+#define _LINUX_SCHED_UX_H
+
+/*
+ * UX ("user experience") tasks are the threads a frame depends on, e.g.
+ * a UI thread or its RenderThread. Userspace marks them statically; a
+ * task also counts as UX for as long as a UX task is waiting on it:
+ *
+ *  - ux_binder: serving a synchronous binder transaction from a UX task.
+ *    Dropped when the reply is sent.
+ *  - ux_depth: owning an rwsem or a PI futex that a UX task is blocked
+ *    on. Dropped when that waiter stops waiting.
+ *
+ * UX tasks preempt non-UX CFS tasks on wakeup. Each runqueue also keeps
+ * its queued UX tasks on a list, so that pick_next_task_fair() can
+ * nominate one as the next buddy without walking the rbtree.
+ */
+
+#include <linux/sched.h>
+
+#ifdef CONFIG_SCHED_UX
+static inline bool task_is_ux(struct task_struct *p)
+{
+	return READ_ONCE(p->ux_static) || atomic_read(&p->ux_binder) > 0 ||
+		atomic_read(&p->ux_depth) > 0;
+}
+
+extern int sched_ux_set_static(struct task_struct *p, bool ux);
+extern struct task_struct *sched_ux_inherit(struct task_struct *owner);
+extern void sched_ux_uninherit(struct task_struct *owner);
+extern void sched_ux_binder_enter(struct task_struct *p);
+extern void sched_ux_binder_exit(struct task_struct *p);
+extern void sched_ux_binder_reset(struct task_struct *p);
+#else
+static inline bool task_is_ux(struct task_struct *p)
+{
+	return false;
+}
+
+static inline struct task_struct *sched_ux_inherit(struct task_struct *owner)
+{
+	return NULL;
+}
+static inline void sched_ux_uninherit(struct task_struct *owner) { }
+static inline void sched_ux_binder_enter(struct task_struct *p) { }
+static inline void sched_ux_binder_exit(struct task_struct *p) { }
+static inline void sched_ux_binder_reset(struct task_struct *p) { }
+#endif /* CONFIG_SCHED_UX */
+
+#endif /* _LINUX_SCHED_UX_H */
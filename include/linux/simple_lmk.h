@@ -6,6 +6,7 @@
 #define _SIMPLE_LMK_H_
 
 struct mm_struct;
+struct task_struct;
 
 #ifdef CONFIG_ANDROID_SIMPLE_LMK
 void simple_lmk_mm_freed(struct mm_struct *mm);
@@ -19,4 +20,20 @@ static inline void simple_lmk_trigger(void)
 }
 #endif
 
+#ifdef CONFIG_ANDROID_SIMPLE_LMK_PSI
+void simple_lmk_init_task(struct task_struct *tsk);
+void simple_lmk_update_adj(struct task_struct *tsk);
+void simple_lmk_task_release(struct task_struct *tsk);
+#else
+static inline void simple_lmk_init_task(struct task_struct *tsk)
+{
+}
+static inline void simple_lmk_update_adj(struct task_struct *tsk)
+{
+}
+static inline void simple_lmk_task_release(struct task_struct *tsk)
+{
+}
+#endif
+
 #endif /* _SIMPLE_LMK_H_ */
@@ -136,6 +136,10 @@ struct kmem_cache {
 	struct kasan_cache kasan_info;
 #endif
 
+	/* Slab pages allocated and freed, for /proc/slab_stats */
+	atomic_long_t slabs_allocated;
+	atomic_long_t slabs_freed;
+
 	struct kmem_cache_node *node[MAX_NUMNODES];
 };
 
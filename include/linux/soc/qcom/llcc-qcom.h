@@ -95,6 +95,14 @@ int llcc_slice_activate(struct llcc_slice_desc *desc);
  */
 int llcc_slice_deactivate(struct llcc_slice_desc *desc);
 
+/**
+ * llcc_slice_report_usage - report accesses and hits seen on a slice
+ * @sid: llcc slice id
+ * @accesses: accesses during the sample
+ * @hits: hits during the sample
+ */
+void llcc_slice_report_usage(u32 sid, u64 accesses, u64 hits);
+
 /**
  * qcom_llcc_probe - program the sct table
  * @pdev: platform device pointer
@@ -137,6 +145,11 @@ static inline int llcc_slice_deactivate(struct llcc_slice_desc *desc)
 {
 	return -EINVAL;
 }
+
+static inline void llcc_slice_report_usage(u32 sid, u64 accesses, u64 hits)
+{
+}
+
 static inline int qcom_llcc_probe(struct platform_device *pdev,
 		      const struct llcc_slice_config *table, u32 sz)
 {
@@ -15,6 +15,7 @@
 #define __QMI_HELPERS_H__
 
 #include <linux/completion.h>
+#include <linux/hashtable.h>
 #include <linux/idr.h>
 #include <linux/list.h>
 #include <linux/qrtr.h>
@@ -218,6 +219,8 @@ struct qmi_msg_handler {
  * @txns:	outstanding transactions
  * @txn_lock:	lock for modifications of @txns
  * @handlers:	list of handlers for incoming messages
+ * @plans:	precompiled descriptors of messages sent and received
+ * @plan_lock:	lock for additions to @plans
  */
 struct qmi_handle {
 	struct socket *sock;
@@ -241,6 +244,9 @@ struct qmi_handle {
 	struct mutex txn_lock;
 
 	struct qmi_msg_handler *handlers;
+
+	DECLARE_HASHTABLE(plans, 4);
+	struct mutex plan_lock;
 };
 
 int qmi_add_lookup(struct qmi_handle *qmi, unsigned int service,
@@ -269,6 +275,19 @@ void *qmi_encode_message(int type, unsigned int msg_id, size_t *len,
 int qmi_decode_message(const void *buf, size_t len,
 		       struct qmi_elem_info *ei, void *c_struct);
 
+struct qmi_encdec_plan;
+
+struct qmi_encdec_plan *qmi_encdec_plan_create(struct qmi_elem_info *ei);
+void qmi_encdec_plan_destroy(struct qmi_encdec_plan *plan);
+bool qmi_encdec_plan_flat(const struct qmi_encdec_plan *plan);
+
+void *qmi_encode_message_plan(int type, unsigned int msg_id, size_t *len,
+			      unsigned int txn_id,
+			      const struct qmi_encdec_plan *plan,
+			      const void *c_struct);
+int qmi_decode_message_plan(const void *buf, size_t len,
+			    const struct qmi_encdec_plan *plan, void *c_struct);
+
 int qmi_txn_init(struct qmi_handle *qmi, struct qmi_txn *txn,
 		 struct qmi_elem_info *ei, void *c_struct);
 int qmi_txn_wait(struct qmi_txn *txn, unsigned long timeout);
@@ -160,6 +160,8 @@ struct thermal_cooling_device_ops {
 			   struct thermal_zone_device *, unsigned long, u32 *);
 	int (*power2state)(struct thermal_cooling_device *,
 			   struct thermal_zone_device *, u32, unsigned long *);
+	int (*get_efficiency)(struct thermal_cooling_device *,
+			      struct thermal_zone_device *, u32 *);
 };
 
 struct thermal_cooling_device {
@@ -354,6 +356,13 @@ struct thermal_zone_params {
 	/* threshold below which the error is no longer accumulated */
 	s32 integral_cutoff;
 
+	/*
+	 * Percentage of each power actor's weight that follows its
+	 * measured efficiency (performance per watt) instead of the
+	 * static weight.  0 keeps the static weights.
+	 */
+	s32 efficiency_weight;
+
 	/*
 	 * @slope:	slope of a linear temperature adjustment curve.
 	 * 		Used by thermal zone drivers.
@@ -4,5 +4,6 @@
 #if defined(CONFIG_UFSTW)
 extern void bdev_set_turbo_write(struct block_device *bdev);
 extern void bdev_clear_turbo_write(struct block_device *bdev);
+extern bool bdev_turbo_write_busy(struct block_device *bdev);
 #endif
 #endif
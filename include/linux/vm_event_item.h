@@ -22,6 +22,9 @@
 
 #define FOR_ALL_ZONES(xx) DMA_ZONE(xx) DMA32_ZONE(xx) xx##_NORMAL, HIGHMEM_ZONE(xx) xx##_MOVABLE
 
+/* Per reclaim thread counters, MAX_KSWAPD_THREADS pairs */
+#define MKSWAPD_EVENTS(n) PGSCAN_KSWAPD_##n, PGSTEAL_KSWAPD_##n
+
 enum vm_event_item { PGPGIN, PGPGOUT, PGPGOUTCLEAN, PSWPIN, PSWPOUT,
 		FOR_ALL_ZONES(PGALLOC),
 		FOR_ALL_ZONES(ALLOCSTALL),
@@ -110,6 +113,16 @@ enum vm_event_item { PGPGIN, PGPGOUT, PGPGOUTCLEAN, PSWPIN, PSWPOUT,
 		SWAP_RA,
 		SWAP_RA_HIT,
 #endif
+#ifdef CONFIG_MULTI_KSWAPD
+		MKSWAPD_EVENTS(0), MKSWAPD_EVENTS(1),
+		MKSWAPD_EVENTS(2), MKSWAPD_EVENTS(3),
+		MKSWAPD_EVENTS(4), MKSWAPD_EVENTS(5),
+		MKSWAPD_EVENTS(6), MKSWAPD_EVENTS(7),
+		MKSWAPD_EVENTS(8), MKSWAPD_EVENTS(9),
+		MKSWAPD_EVENTS(10), MKSWAPD_EVENTS(11),
+		MKSWAPD_EVENTS(12), MKSWAPD_EVENTS(13),
+		MKSWAPD_EVENTS(14), MKSWAPD_EVENTS(15),
+#endif
 #ifdef CONFIG_SPECULATIVE_PAGE_FAULT
 		SPECULATIVE_PGFAULT,
 #endif
@@ -20,18 +20,28 @@
 
 #define MAX_SUSPEND_ABORT_LEN 256
 
+struct wakeup_stats_hdr;
+struct wakeup_stats_irq;
+
 #ifdef CONFIG_SUSPEND
 void log_irq_wakeup_reason(int irq);
 void log_threaded_irq_wakeup_reason(int irq, int parent_irq);
 void log_suspend_abort_reason(const char *fmt, ...);
 void log_abnormal_wakeup_reason(const char *fmt, ...);
 void clear_wakeup_reasons(void);
+int wakeup_reason_stats(struct wakeup_stats_hdr *hdr,
+			struct wakeup_stats_irq *irqs, int max);
 #else
 static inline void log_irq_wakeup_reason(int irq) { }
 static inline void log_threaded_irq_wakeup_reason(int irq, int parent_irq) { }
 static inline void log_suspend_abort_reason(const char *fmt, ...) { }
 static inline void log_abnormal_wakeup_reason(const char *fmt, ...) { }
 static inline void clear_wakeup_reasons(void) { }
+static inline int wakeup_reason_stats(struct wakeup_stats_hdr *hdr,
+				      struct wakeup_stats_irq *irqs, int max)
+{
+	return 0;
+}
 #endif
 
 #endif /* _LINUX_WAKEUP_REASON_H */
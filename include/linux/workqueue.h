@@ -108,6 +108,9 @@ struct work_struct {
 #ifdef CONFIG_LOCKDEP
 	struct lockdep_map lockdep_map;
 #endif
+#ifdef CONFIG_WQ_LATENCY_STATS
+	u64 queued_ns;
+#endif
 };
 
 #define WORK_DATA_INIT()	ATOMIC_LONG_INIT((unsigned long)WORK_STRUCT_NO_POOL)
@@ -345,6 +348,14 @@ enum {
 	 */
 	WQ_POWER_EFFICIENT	= 1 << 7,
 
+	/*
+	 * Unbound workqueues are normally confined to the CPUs in
+	 * workqueue/cpumask, which keeps bulk work off the big cluster.
+	 * WQ_LATENCY_SENSITIVE workqueues are exempt so that they can be
+	 * placed with workqueue_set_cluster_affinity() instead.
+	 */
+	WQ_LATENCY_SENSITIVE	= 1 << 8,
+
 	__WQ_DRAINING		= 1 << 16, /* internal: workqueue is draining */
 	__WQ_ORDERED		= 1 << 17, /* internal: workqueue is ordered */
 	__WQ_LEGACY		= 1 << 18, /* internal: create*_workqueue() */
@@ -378,6 +389,10 @@ enum {
  * executed immediately as long as max_active limit is not reached and
  * resources are available.
  *
+ * system_highpri_unbound_wq is an unbound WQ_HIGHPRI workqueue that may
+ * run on any CPU, for latency sensitive work that shouldn't queue behind
+ * bulk unbound work.
+ *
  * system_freezable_wq is equivalent to system_wq except that it's
  * freezable.
  *
@@ -391,6 +406,7 @@ extern struct workqueue_struct *system_wq;
 extern struct workqueue_struct *system_highpri_wq;
 extern struct workqueue_struct *system_long_wq;
 extern struct workqueue_struct *system_unbound_wq;
+extern struct workqueue_struct *system_highpri_unbound_wq;
 extern struct workqueue_struct *system_freezable_wq;
 extern struct workqueue_struct *system_power_efficient_wq;
 extern struct workqueue_struct *system_freezable_power_efficient_wq;
@@ -465,6 +481,7 @@ void free_workqueue_attrs(struct workqueue_attrs *attrs);
 int apply_workqueue_attrs(struct workqueue_struct *wq,
 			  const struct workqueue_attrs *attrs);
 int workqueue_set_unbound_cpumask(cpumask_var_t cpumask);
+int workqueue_set_cluster_affinity(struct workqueue_struct *wq, int cpu);
 
 extern bool queue_work_on(int cpu, struct workqueue_struct *wq,
 			struct work_struct *work);
@@ -10,6 +10,9 @@
  * GNU General Public License for more details.
  */
 
+#include <linux/ktime.h>
+#include <uapi/linux/msm_boot_timeline.h>
+
 #ifdef CONFIG_MSM_BOOT_STATS
 
 #define TIMER_KHZ 32768
@@ -43,11 +46,19 @@ static inline int boot_marker_enabled(void) { return 1; }
 void place_marker(const char *name);
 void update_marker(const char *name);
 void measure_wake_up_time(void);
+static inline ktime_t boot_timeline_start(void) { return ktime_get(); }
+void boot_timeline_event(int type, const char *name, ktime_t start, int ret);
+void boot_timeline_initcall(void *fn, ktime_t start, int ret);
 #else
 static inline void place_marker(char *name) { };
 static inline void update_marker(const char *name) { };
 static inline int boot_marker_enabled(void) { return 0; }
 static inline void measure_wake_up_time(void) { };
+static inline ktime_t boot_timeline_start(void) { return 0; }
+static inline void boot_timeline_event(int type, const char *name,
+				       ktime_t start, int ret) { };
+static inline void boot_timeline_initcall(void *fn, ktime_t start,
+					  int ret) { };
 #endif
 
 
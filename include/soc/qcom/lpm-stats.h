@@ -19,6 +19,14 @@ struct lpm_stats;
 
 #define MAX_STR_LEN 256
 
+/* How an idle period compared with the level it was spent in */
+enum lpm_pred_result {
+	LPM_PRED_HIT,
+	LPM_PRED_TOO_SHORT,
+	LPM_PRED_TOO_LONG,
+	LPM_PRED_NR,
+};
+
 struct lifo_stats {
 	uint32_t last_in;
 	uint32_t first_out;
@@ -49,6 +57,9 @@ void lpm_stats_cluster_exit(struct lpm_stats *stats, uint32_t index,
 				bool success);
 void lpm_stats_cpu_enter(uint32_t index, uint64_t time);
 void lpm_stats_cpu_exit(uint32_t index, uint64_t time, bool success);
+void lpm_stats_cluster_pred(struct lpm_stats *stats, uint32_t index,
+				enum lpm_pred_result result);
+void lpm_stats_cpu_pred(uint32_t index, enum lpm_pred_result result);
 void lpm_stats_suspend_enter(void);
 void lpm_stats_suspend_exit(void);
 #else
@@ -74,6 +85,14 @@ static inline void lpm_stats_cpu_exit(uint32_t index, bool success,
 							uint64_t time)
 { }
 
+static inline void lpm_stats_cluster_pred(struct lpm_stats *stats,
+				uint32_t index, enum lpm_pred_result result)
+{ }
+
+static inline void lpm_stats_cpu_pred(uint32_t index,
+				enum lpm_pred_result result)
+{ }
+
 static inline void lpm_stats_suspend_enter(void)
 { }
 
@@ -13,6 +13,8 @@
 #ifndef __MINIDUMP_H
 #define __MINIDUMP_H
 
+#include <linux/errno.h>
+
 #define MAX_NAME_LENGTH		12
 /* md_region -  Minidump table entry
  * @name:	Entry name, Minidump will dump binary with this name.
@@ -34,9 +36,15 @@ struct md_region {
  * Returns:
  *	Zero: on successful addition
  *	Negetive error number on failures
+ *
+ * msm_minidump_reserve_region() returns the region number instead, which
+ * msm_minidump_update_region() takes to move the region without locking.
  */
 #ifdef CONFIG_QCOM_MINIDUMP
 extern int msm_minidump_add_region(const struct md_region *entry);
+extern int msm_minidump_reserve_region(const struct md_region *entry);
+extern int msm_minidump_update_region(int regno, u64 virt_addr,
+				      u64 phys_addr);
 extern bool msm_minidump_enabled(void);
 extern void dump_stack_minidump(u64 sp);
 #else
@@ -45,6 +53,15 @@ static inline int msm_minidump_add_region(const struct md_region *entry)
 	/* Return quietly, if minidump is not supported */
 	return 0;
 }
+static inline int msm_minidump_reserve_region(const struct md_region *entry)
+{
+	return -ENODEV;
+}
+static inline int msm_minidump_update_region(int regno, u64 virt_addr,
+					     u64 phys_addr)
+{
+	return 0;
+}
 static inline bool msm_minidump_enabled(void) { return false; }
 static inline void dump_stack_minidump(u64 sp) {}
 #endif
@@ -34,6 +34,7 @@ void rmnet_get_packets(void *port, u64 *rx, u64 *tx);
 int rmnet_get_powersave_notif(void *port);
 struct net_device *rmnet_get_real_dev(void *port);
 int rmnet_get_dlmarker_info(void *port);
+bool rmnet_get_ul_agg_enabled(void *port);
 #else
 static inline void *rmnet_get_qmi_pt(void *port)
 {
@@ -95,5 +96,10 @@ static inline int rmnet_get_dlmarker_info(void *port)
 {
 	return 0;
 }
+
+static inline bool rmnet_get_ul_agg_enabled(void *port)
+{
+	return false;
+}
 #endif /* CONFIG_QCOM_QMI_RMNET */
 #endif /*_RMNET_QMI_H*/
@@ -0,0 +1,50 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM swap_ratio
+
+#if !defined(_TRACE_EVENT_SWAP_RATIO_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_EVENT_SWAP_RATIO_H
+
+#include <linux/tracepoint.h>
+#include <linux/types.h>
+
+TRACE_EVENT(swap_ratio_rebalance,
+
+	TP_PROTO(int fast_type, int slow_type,
+		unsigned long fast_lat_us, unsigned long slow_lat_us,
+		int slow_inflight, int old_ratio, int new_ratio),
+
+	TP_ARGS(fast_type, slow_type, fast_lat_us, slow_lat_us,
+		slow_inflight, old_ratio, new_ratio),
+
+	TP_STRUCT__entry(
+		__field(int, fast_type)
+		__field(int, slow_type)
+		__field(unsigned long, fast_lat_us)
+		__field(unsigned long, slow_lat_us)
+		__field(int, slow_inflight)
+		__field(int, old_ratio)
+		__field(int, new_ratio)
+	),
+
+	TP_fast_assign(
+		__entry->fast_type	= fast_type;
+		__entry->slow_type	= slow_type;
+		__entry->fast_lat_us	= fast_lat_us;
+		__entry->slow_lat_us	= slow_lat_us;
+		__entry->slow_inflight	= slow_inflight;
+		__entry->old_ratio	= old_ratio;
+		__entry->new_ratio	= new_ratio;
+	),
+
+	TP_printk("fast=%d lat=%luus slow=%d lat=%luus inflight=%d ratio %d -> %d",
+			__entry->fast_type, __entry->fast_lat_us,
+			__entry->slow_type, __entry->slow_lat_us,
+			__entry->slow_inflight, __entry->old_ratio,
+			__entry->new_ratio)
+);
+
+#endif /* _TRACE_EVENT_SWAP_RATIO_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -0,0 +1,43 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM ufshpb
+
+#if !defined(_TRACE_UFSHPB_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_UFSHPB_H
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(ufshpb_map_req_compl,
+
+	TP_PROTO(int lun, int rgn_idx, int srgn_idx, int srgn_cnt,
+		 s64 latency_us, int error),
+
+	TP_ARGS(lun, rgn_idx, srgn_idx, srgn_cnt, latency_us, error),
+
+	TP_STRUCT__entry(
+		__field(int, lun)
+		__field(int, rgn_idx)
+		__field(int, srgn_idx)
+		__field(int, srgn_cnt)
+		__field(s64, latency_us)
+		__field(int, error)
+	),
+
+	TP_fast_assign(
+		__entry->lun		= lun;
+		__entry->rgn_idx	= rgn_idx;
+		__entry->srgn_idx	= srgn_idx;
+		__entry->srgn_cnt	= srgn_cnt;
+		__entry->latency_us	= latency_us;
+		__entry->error		= error;
+	),
+
+	TP_printk("lun=%d rgn=%d srgn=%d cnt=%d latency=%lldus error=%d",
+		  __entry->lun, __entry->rgn_idx, __entry->srgn_idx,
+		  __entry->srgn_cnt, __entry->latency_us, __entry->error)
+);
+
+#endif /* _TRACE_UFSHPB_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
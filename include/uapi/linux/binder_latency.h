@@ -0,0 +1,61 @@
+#ifndef _UAPI_LINUX_BINDER_LATENCY_H_
+#define _UAPI_LINUX_BINDER_LATENCY_H_
+
+#include <linux/types.h>
+
+/* Layout of debugfs binder/latency/<pid>.
+ *
+ * The file starts with a struct binder_latency_hdr, followed by nr_nodes
+ * records of node_size bytes starting at hdr_size, one for every node of
+ * the process that has received a transaction. Histograms count from the
+ * node's creation and are never reset.
+ *
+ * For each node there are three histograms:
+ * QUEUE: from the transaction being queued to the target process until a
+ *        thread of that process picks it up from its todo list
+ * READ:  from the thread picking the transaction up until it has been
+ *        copied out to userspace as BR_TRANSACTION
+ * REPLY: from the transaction being queued until the reply is sent, for
+ *        synchronous transactions only
+ *
+ * Bucket 0 counts latencies below 1us, bucket n counts latencies in
+ * [2^(n-1), 2^n) us, and the last bucket also counts everything above.
+ */
+
+#define BINDER_LATENCY_VERSION 1
+#define BINDER_LATENCY_BUCKETS 20
+
+enum {
+	BINDER_LATENCY_QUEUE,
+	BINDER_LATENCY_READ,
+	BINDER_LATENCY_REPLY,
+	BINDER_LATENCY_NR,
+};
+
+struct binder_latency_hdr {
+	__u32 version;
+	__u32 hdr_size;
+	__u32 node_size;
+	__u32 nr_nodes;
+	__u32 nr_buckets;
+	__s32 pid;
+	__u32 reserved[2];
+};
+
+struct binder_latency_hist {
+	__u64 count;
+	__u64 sum_ns;
+	__u64 max_ns;
+	__u32 buckets[BINDER_LATENCY_BUCKETS];
+};
+
+struct binder_latency_node {
+	/* As in BR_TRANSACTION and the binder/proc/<pid> listing */
+	__u64 ptr;
+	__u64 cookie;
+	__s32 debug_id;
+	__u32 reserved;
+	struct binder_latency_hist hist[BINDER_LATENCY_NR];
+};
+
+#endif /* _UAPI_LINUX_BINDER_LATENCY_H_ */
@@ -0,0 +1,36 @@
+/* SPDX-License-Identifier: GPL-2.0 WITH Linux-syscall-note */
+#ifndef _UAPI_LINUX_CPUFREQ_TIMES_H
+#define _UAPI_LINUX_CPUFREQ_TIMES_H
+
+#include <linux/types.h>
+
+/*
+ * Layout of /proc/uid_time_in_state_bin. Every open takes a snapshot
+ * which can be read() or mmap()ed:
+ *
+ *	struct uid_tis_header
+ *	__u32 freqs[nr_freqs]		kHz, policies in cpu order
+ *	struct uid_tis_record		nr_uids times, each followed by
+ *	__u64 time[nr_freqs]		nanoseconds at each frequency
+ *
+ * Records start at header_size and are record_size bytes apart, so new
+ * fields can be appended without breaking older readers.
+ */
+#define UID_TIS_MAGIC		0x53495455	/* "UTIS" */
+#define UID_TIS_VERSION		1
+
+struct uid_tis_header {
+	__u32 magic;
+	__u32 version;
+	__u32 header_size;
+	__u32 record_size;
+	__u32 nr_freqs;
+	__u32 nr_uids;
+};
+
+struct uid_tis_record {
+	__u32 uid;
+	__u32 reserved;
+};
+
+#endif /* _UAPI_LINUX_CPUFREQ_TIMES_H */
@@ -781,6 +781,7 @@ struct fuse_notify_retrieve_in {
 
 /* Device ioctls: */
 #define FUSE_DEV_IOC_CLONE	_IOR(229, 0, uint32_t)
+#define FUSE_DEV_IOC_BIND_CPU	_IOW(229, 1, uint32_t)
 
 struct fuse_lseek_in {
 	uint64_t	fh;
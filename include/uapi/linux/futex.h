@@ -21,6 +21,8 @@
 #define FUTEX_WAKE_BITSET	10
 #define FUTEX_WAIT_REQUEUE_PI	11
 #define FUTEX_CMP_REQUEUE_PI	12
+#define FUTEX_WAIT_MULTIPLE	13
+#define FUTEX_WAKE_MULTIPLE	14
 
 #define FUTEX_PRIVATE_FLAG	128
 #define FUTEX_CLOCK_REALTIME	256
@@ -40,6 +42,30 @@
 					 FUTEX_PRIVATE_FLAG)
 #define FUTEX_CMP_REQUEUE_PI_PRIVATE	(FUTEX_CMP_REQUEUE_PI | \
 					 FUTEX_PRIVATE_FLAG)
+#define FUTEX_WAIT_MULTIPLE_PRIVATE	(FUTEX_WAIT_MULTIPLE | \
+					 FUTEX_PRIVATE_FLAG)
+#define FUTEX_WAKE_MULTIPLE_PRIVATE	(FUTEX_WAKE_MULTIPLE | \
+					 FUTEX_PRIVATE_FLAG)
+
+/*
+ * FUTEX_WAIT_MULTIPLE and FUTEX_WAKE_MULTIPLE take an array of val
+ * futex_wait_block at uaddr, at most FUTEX_MULTIPLE_MAX_COUNT of them.
+ *
+ * FUTEX_WAIT_MULTIPLE sleeps until one of the futexes is woken, for at most
+ * the relative timeout in utime, and returns the index of the futex that
+ * was woken. It returns -EWOULDBLOCK without sleeping if one of the futexes
+ * doesn't hold its val.
+ *
+ * FUTEX_WAKE_MULTIPLE wakes up to val waiters matching bitset on each of
+ * the futexes and returns the number of waiters woken.
+ */
+#define FUTEX_MULTIPLE_MAX_COUNT	128
+
+struct futex_wait_block {
+	__u32 __user *uaddr;
+	__u32 val;
+	__u32 bitset;
+};
 
 /*
  * Support for robust futexes: the kernel cleans up held futexes at
@@ -0,0 +1,58 @@
+#ifndef _UAPI_MSM_BOOT_TIMELINE_H_
+#define _UAPI_MSM_BOOT_TIMELINE_H_
+
+#include <linux/types.h>
+
+/* Layout of /sys/kernel/debug/bootkpi/timeline.
+ *
+ * The file starts with a struct boot_timeline_hdr, followed by nr_records
+ * records of rec_size bytes starting at hdr_size. Records are in the order
+ * the events completed, which for nested events (a firmware load inside an
+ * initcall) is not the order they started.
+ *
+ * start_ns is CLOCK_MONOTONIC. The header carries the monotonic time and
+ * the sleep clock at the same instant so records can be placed next to the
+ * bootloader markers in kpi_values, which count from the sleep clock.
+ */
+
+#define BOOT_TIMELINE_VERSION 1
+#define BOOT_TIMELINE_NAME_LEN 40
+
+enum boot_timeline_type {
+	BOOT_TIMELINE_NONE,
+	/* A built-in or module initcall, name is the init function */
+	BOOT_TIMELINE_INITCALL,
+	/* Time spent waiting for async probes, name is the caller */
+	BOOT_TIMELINE_ASYNC_WAIT,
+	/* A retry from the deferred probe list, name is the device */
+	BOOT_TIMELINE_DEFERRED_PROBE,
+	/* A request_firmware() call, name is the firmware file */
+	BOOT_TIMELINE_FIRMWARE,
+	/* Reported by the display driver once the first frame is shown */
+	BOOT_TIMELINE_DISPLAY,
+	/* A boot marker, without duration */
+	BOOT_TIMELINE_MARKER,
+};
+
+struct boot_timeline_hdr {
+	__u32 version;
+	__u32 hdr_size;
+	__u32 rec_size;
+	__u32 nr_records;
+	/* Events not recorded because the timeline was full */
+	__u32 dropped;
+	__u32 reserved;
+	__u64 mono_ns;
+	__u64 sclk_ns;
+};
+
+struct boot_timeline_record {
+	__u64 start_ns;
+	__u32 duration_us;
+	__u16 type;
+	/* Return value of the initcall, probe or firmware request */
+	__s16 ret;
+	char name[BOOT_TIMELINE_NAME_LEN];
+};
+
+#endif /* _UAPI_MSM_BOOT_TIMELINE_H_ */
@@ -16,6 +16,7 @@
 #define _UAPI_DSPS_H_
 
 #include <linux/ioctl.h>
+#include <linux/types.h>
 
 #define DSPS_IOCTL_MAGIC 'd'
 
@@ -27,4 +28,19 @@
 
 #define DSPS_IOCTL_RESET _IO(DSPS_IOCTL_MAGIC, 5)
 
+/*
+ * QTimer ticks and CLOCK_BOOTTIME sampled together, for converting the
+ * timestamps of batched sensor samples without one ioctl per sample. The
+ * QTimer was read at boottime_ns, give or take window_ns / 2.
+ */
+struct dsps_time_sync {
+	__u64 qtimer_ticks;
+	__u64 boottime_ns;
+	__u32 window_ns;
+	__u32 qtimer_hz;
+};
+
+#define DSPS_IOCTL_READ_TIME_SYNC _IOR(DSPS_IOCTL_MAGIC, 6, \
+				       struct dsps_time_sync)
+
 #endif	/* _UAPI_DSPS_H_ */
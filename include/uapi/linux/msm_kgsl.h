@@ -145,6 +145,8 @@
 #define KGSL_MEMFLAGS_SPARSE_VIRT (1ULL << 30)
 #define KGSL_MEMFLAGS_IOCOHERENT  (1ULL << 31)
 #define KGSL_MEMFLAGS_GUARD_PAGE  (1ULL << 33)
+/* Back the allocation with pages on first GPU or CPU access */
+#define KGSL_MEMFLAGS_LAZY        (1ULL << 35)
 
 /* Memory types for which allocations are made */
 #define KGSL_MEMTYPE_MASK		0x0000FF00
@@ -1640,4 +1642,56 @@ struct kgsl_gpu_sparse_command {
 #define IOCTL_KGSL_GPU_SPARSE_COMMAND \
 	_IOWR(KGSL_IOC_TYPE, 0x55, struct kgsl_gpu_sparse_command)
 
+/**
+ * struct kgsl_gpu_command_batch - One command obj of
+ * IOCTL_KGSL_GPU_COMMAND_VEC
+ * @flags: Current flags for the object, markers and syncs are not allowed
+ * @cmdlist: List of kgsl_command_objects for submission
+ * @cmdsize: Size of kgsl_command_objects structure
+ * @numcmds: Number of kgsl_command_objects in command list, must not be 0
+ * @objlist: List of kgsl_command_objects for tracking
+ * @objsize: Size of kgsl_command_objects structure
+ * @numobjs: Number of kgsl_command_objects in object list
+ */
+struct kgsl_gpu_command_batch {
+	uint64_t flags;
+	uint64_t __user cmdlist;
+	unsigned int cmdsize;
+	unsigned int numcmds;
+	uint64_t __user objlist;
+	unsigned int objsize;
+	unsigned int numobjs;
+};
+
+/**
+ * struct kgsl_gpu_command_vec - Argument for IOCTL_KGSL_GPU_COMMAND_VEC
+ * @flags: Reserved, must be 0
+ * @batchlist: List of kgsl_gpu_command_batch to submit in order
+ * @batchsize: Size of kgsl_gpu_command_batch structure
+ * @numbatches: Number of kgsl_gpu_command_batch in batchlist
+ * @synclist: List of kgsl_command_syncpoints all the batches wait for
+ * @syncsize: Size of kgsl_command_syncpoint structure
+ * @numsyncs: Number of kgsl_command_syncpoints in syncpoint list
+ * @context_id: Context ID submitting the batches
+ * @timestamp: Returns the timestamp of the last batch; the batches get
+ * consecutive timestamps ending with this one
+ *
+ * Submit several command objs with a single syncpoint list in one call. The
+ * context must not use user generated timestamps.
+ */
+struct kgsl_gpu_command_vec {
+	uint64_t flags;
+	uint64_t __user batchlist;
+	unsigned int batchsize;
+	unsigned int numbatches;
+	uint64_t __user synclist;
+	unsigned int syncsize;
+	unsigned int numsyncs;
+	unsigned int context_id;
+	unsigned int timestamp;
+};
+
+#define IOCTL_KGSL_GPU_COMMAND_VEC \
+	_IOWR(KGSL_IOC_TYPE, 0x56, struct kgsl_gpu_command_vec)
+
 #endif /* _UAPI_MSM_KGSL_H */
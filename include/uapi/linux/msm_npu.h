@@ -57,6 +57,14 @@
 #define MSM_NPU_GET_PROP \
 	_IOW(MSM_NPU_IOCTL_MAGIC, 11, struct msm_npu_property)
 
+/* register or release a patch buffer set of a network */
+#define MSM_NPU_SET_BUF_SET \
+	_IOWR(MSM_NPU_IOCTL_MAGIC, 12, struct msm_npu_buf_set_ioctl)
+
+/* execute a network with registered buffer sets */
+#define MSM_NPU_EXEC_NETWORK_BUF_SET \
+	_IOWR(MSM_NPU_IOCTL_MAGIC, 13, struct msm_npu_exec_buf_set_ioctl)
+
 #define MSM_NPU_EVENT_TYPE_START 0x10000000
 #define MSM_NPU_EVENT_TYPE_EXEC_DONE (MSM_NPU_EVENT_TYPE_START + 1)
 #define MSM_NPU_EVENT_TYPE_EXEC_V2_DONE (MSM_NPU_EVENT_TYPE_START + 2)
@@ -89,6 +97,9 @@
 #define MSM_NPU_FEATURE_ASYNC_EXECUTE  0x2
 #define MSM_NPU_FEATURE_DSP_SID_MAPPED 0x8
 
+/* buffer sets a network can have registered at once */
+#define MSM_NPU_MAX_BUF_SETS 16
+
 #define PROP_PARAM_MAX_SIZE 8
 
 /* -------------------------------------------------------------------------
@@ -259,6 +270,38 @@ struct msm_npu_exec_network_ioctl_v2 {
 	uint32_t reserved;
 };
 
+struct msm_npu_buf_set_ioctl {
+	/* patch buf info for both input and output layers */
+	uint64_t patch_buf_info;
+	/* network handle */
+	uint32_t network_hdl;
+	/* number of layers to be patched, 0 releases buf_set_id */
+	uint32_t patch_buf_info_num;
+	/* buffer set id, returned on register */
+	uint32_t buf_set_id;
+	/* reserved */
+	uint32_t reserved;
+};
+
+struct msm_npu_exec_buf_set_ioctl {
+	/* stats buffer to be filled with stats of the last execution */
+	uint64_t stats_buf_addr;
+	/* array of buffer set ids, executed in order */
+	uint64_t buf_set_ids;
+	/* network handle */
+	uint32_t network_hdl;
+	/* number of buffer set ids */
+	uint32_t num_buf_sets;
+	/* execution flags */
+	uint32_t flags;
+	/* stats buf size allocated */
+	uint32_t stats_buf_size;
+	/* number of executions that completed successfully */
+	uint32_t num_done;
+	/* reserved */
+	uint32_t reserved;
+};
+
 struct msm_npu_event_execute_done {
 	uint32_t network_hdl;
 	int32_t exec_result;
@@ -0,0 +1,51 @@
+#ifndef _UAPI_MSM_PERF_TASKS_H_
+#define _UAPI_MSM_PERF_TASKS_H_
+
+#include <linux/types.h>
+
+/* Layout of the ring mapped read-only from /dev/msm_perf_tasks.
+ *
+ * The tasks to follow are written as a list of pids to the msm_performance
+ * task_watch parameter. Each sampling interval one sample per followed task
+ * is appended to the ring and readers blocked in poll() are woken up.
+ *
+ * The ring starts with a struct msm_perf_tasks_ring_hdr, followed by
+ * nr_slots samples of slot_size bytes starting at hdr_size. Sample n is
+ * in slot n % nr_slots and head is the number of samples written so far.
+ * Counters in a sample are cumulative for the task, so per-frame figures
+ * come from the difference between two samples of the same task.
+ *
+ * A slot's seq is odd while the kernel rewrites it. Readers should read
+ * seq, copy the slot, and retry if seq changed or was odd.
+ */
+
+#define MSM_PERF_TASKS_VERSION 1
+
+struct msm_perf_tasks_ring_hdr {
+	__u32 version;
+	__u32 hdr_size;
+	__u32 slot_size;
+	__u32 nr_slots;
+	__u64 head;
+	__u32 interval_ms;
+	__u32 reserved[9];
+};
+
+struct msm_perf_task_sample {
+	__u32 seq;
+	__u32 pid;
+	/* CLOCK_MONOTONIC time of the sample */
+	__u64 timestamp_ns;
+	/* Time the task ran, from the scheduler */
+	__u64 runtime_ns;
+	/* Time the task ran at a known cpu frequency, and the energy that
+	 * took according to the energy model. Zero without cpufreq_times.
+	 */
+	__u64 freq_time_ns;
+	__u64 energy_uj;
+	/* Zero when the PMU can't count for the task */
+	__u64 cycles;
+	__u64 instructions;
+};
+
+#endif /* _UAPI_MSM_PERF_TASKS_H_ */
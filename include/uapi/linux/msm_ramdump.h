@@ -0,0 +1,35 @@
+#ifndef _UAPI_MSM_RAMDUMP_H_
+#define _UAPI_MSM_RAMDUMP_H_
+
+#include <linux/ioctl.h>
+#include <linux/types.h>
+
+/* Compressed reads from /dev/ramdump_<subsystem>.
+ *
+ * After RAMDUMP_IOCTL_LZ4, each read() returns one frame: a struct
+ * ramdump_lz4_frame followed by comp_size bytes. The frame holds the
+ * raw_size bytes of the dump starting at offset, compressed with LZ4
+ * block compression, or stored as is when comp_size equals raw_size.
+ *
+ * The file position stays an offset into the uncompressed dump and
+ * advances by raw_size, so several threads can pread() different parts
+ * of the dump in parallel. A read of 0 bytes marks the end of the dump as
+ * it does for plain reads. The buffer passed to read() must be at least
+ * RAMDUMP_LZ4_MIN_READ bytes, larger buffers yield larger frames.
+ */
+
+#define RAMDUMP_IOCTL_MAGIC 0xd2
+#define RAMDUMP_IOCTL_LZ4 _IO(RAMDUMP_IOCTL_MAGIC, 1)
+
+#define RAMDUMP_LZ4_MAGIC 0x345a4c52 /* "RLZ4" */
+#define RAMDUMP_LZ4_MIN_READ 8192
+
+struct ramdump_lz4_frame {
+	__u32 magic;
+	__u32 raw_size;
+	__u32 comp_size;
+	__u32 reserved;
+	__u64 offset;
+};
+
+#endif /* _UAPI_MSM_RAMDUMP_H_ */
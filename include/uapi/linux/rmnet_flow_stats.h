@@ -0,0 +1,54 @@
+#ifndef _UAPI_RMNET_FLOW_STATS_H_
+#define _UAPI_RMNET_FLOW_STATS_H_
+
+#include <linux/types.h>
+
+/* Layout of the ring mapped read-only from /dev/rmnet_flow_stats.
+ *
+ * The ring starts with a struct rmnet_flow_stats_ring_hdr, followed by
+ * nr_slots samples of slot_size bytes starting at hdr_size. Sample n is
+ * in slot n % nr_slots and head is the number of samples written so far.
+ * Counters in a sample are cumulative for the flow, so rates come from
+ * the difference between two samples of the same flow.
+ *
+ * A slot's seq is odd while the kernel rewrites it. Readers should read
+ * seq, copy the slot, and retry if seq changed or was odd.
+ */
+
+#define RMNET_FLOW_STATS_VERSION 1
+
+struct rmnet_flow_stats_ring_hdr {
+	__u32 version;
+	__u32 hdr_size;
+	__u32 slot_size;
+	__u32 nr_slots;
+	__u64 head;
+	/* Flows not tracked because their table slot was busy */
+	__u64 untracked;
+	__u32 interval_ms;
+	__u32 reserved[7];
+};
+
+struct rmnet_flow_stats_sample {
+	__u32 seq;
+	__u32 hash;
+	/* CLOCK_MONOTONIC time of the sample */
+	__u64 timestamp_ns;
+	__u8 mux_id;
+	__u8 ip_version;
+	__u8 trans_proto;
+	__u8 reserved[5];
+	/* Packets after coalescing is undone, and skbs handed to the stack.
+	 * packets / skbs is the coalescing factor.
+	 */
+	__u64 packets;
+	__u64 skbs;
+	__u64 bytes;
+	/* Time from rmnet receiving the frame to delivering it: the total,
+	 * and the worst case since the previous sample of the flow.
+	 */
+	__u64 delay_sum_ns;
+	__u64 delay_max_ns;
+};
+
+#endif /* _UAPI_RMNET_FLOW_STATS_H_ */
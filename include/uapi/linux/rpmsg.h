@@ -30,7 +30,36 @@ struct rpmsg_endpoint_info {
 	__u32 dst;
 };
 
+/**
+ * struct rpmsg_batch - several messages in one buffer
+ * @buf: user pointer to a sequence of struct rpmsg_batch_frame
+ * @len: size of @buf, returns the bytes used by RPMSG_READ_BATCH_IOCTL
+ * @count: returns the number of messages read or written
+ *
+ * Each frame is padded so the next one starts on a 4 byte boundary, see
+ * RPMSG_BATCH_FRAME_SIZE(). RPMSG_READ_BATCH_IOCTL waits as read() does
+ * for the first message, then returns as many queued messages as fit. A
+ * first message larger than @buf is truncated, as with read().
+ * RPMSG_WRITE_BATCH_IOCTL sends the frames in order and stops at the
+ * first one that fails, which is only reported if nothing was sent.
+ */
+struct rpmsg_batch {
+	__u64 buf;
+	__u32 len;
+	__u32 count;
+};
+
+struct rpmsg_batch_frame {
+	__u32 len;
+	__u8 data[];
+};
+
+#define RPMSG_BATCH_FRAME_SIZE(len) \
+	(sizeof(struct rpmsg_batch_frame) + (((len) + 3) & ~3U))
+
 #define RPMSG_CREATE_EPT_IOCTL	_IOW(0xb5, 0x1, struct rpmsg_endpoint_info)
 #define RPMSG_DESTROY_EPT_IOCTL	_IO(0xb5, 0x2)
+#define RPMSG_READ_BATCH_IOCTL	_IOWR(0xb5, 0x3, struct rpmsg_batch)
+#define RPMSG_WRITE_BATCH_IOCTL	_IOWR(0xb5, 0x4, struct rpmsg_batch)
 
 #endif
@@ -0,0 +1,64 @@
+#ifndef _UAPI_WAKEUP_STATS_H_
+#define _UAPI_WAKEUP_STATS_H_
+
+#include <linux/types.h>
+
+/* Layout of the snapshot read from /sys/kernel/debug/wakeup_stats.
+ *
+ * The snapshot starts with a struct wakeup_stats_hdr, followed by nr_ws
+ * wakeup source records of ws_size bytes starting at hdr_size, and then
+ * nr_irqs wakeup IRQ records of irq_size bytes. All counters are
+ * cumulative since boot, so rates come from the difference between two
+ * snapshots.
+ *
+ * hold_hist[0] counts the times the wakeup source was held for less than
+ * 1ms, hold_hist[i] those held for [2^(i-1), 2^i) ms, and the last bucket
+ * everything longer.
+ */
+
+#define WAKEUP_STATS_VERSION 1
+#define WAKEUP_STATS_HOLD_BUCKETS 16
+#define WAKEUP_STATS_NAME_LEN 48
+
+struct wakeup_stats_hdr {
+	__u32 version;
+	__u32 hdr_size;
+	__u32 ws_size;
+	__u32 nr_ws;
+	__u32 irq_size;
+	__u32 nr_irqs;
+	/* CLOCK_MONOTONIC time of the snapshot */
+	__u64 timestamp_ns;
+	/* Resumes from suspend, and those not caused by a wakeup IRQ */
+	__u32 resumes;
+	__u32 resumes_abnormal;
+	__u32 resumes_unknown;
+	__u32 suspend_aborts;
+	__u32 reserved[4];
+};
+
+struct wakeup_stats_ws {
+	char name[WAKEUP_STATS_NAME_LEN];
+	__u64 total_time_ns;
+	__u64 max_time_ns;
+	__u64 prevent_sleep_time_ns;
+	__u32 active_count;
+	__u32 event_count;
+	__u32 wakeup_count;
+	__u32 expire_count;
+	__u32 active;
+	__u32 hold_hist[WAKEUP_STATS_HOLD_BUCKETS];
+	__u32 reserved;
+};
+
+struct wakeup_stats_irq {
+	__s32 irq;
+	/* Resumes this IRQ took part in */
+	__u32 resumes;
+	/* CLOCK_MONOTONIC time of the last of them */
+	__u64 last_resume_ns;
+	/* Name of the handler, usually the driver's */
+	char name[WAKEUP_STATS_NAME_LEN];
+};
+
+#endif /* _UAPI_WAKEUP_STATS_H_ */
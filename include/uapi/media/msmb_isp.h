@@ -784,6 +784,37 @@ struct msm_isp_stats_event {
 	uint8_t pd_stats_idx;
 };
 
+/*
+ * Stats ring, mapped read-only from the vfe subdev at page offset
+ * MSM_ISP_STATS_RING_PGOFF. Each stats notification is also published
+ * as a slot, so 3A can follow the stats buffers without subscribing to
+ * the stats events. Slot n is at hdr_size + (n % nr_slots) * slot_size
+ * and head counts the slots written so far. A slot's seq is odd while
+ * it is rewritten: read seq, copy the slot, and retry if seq changed or
+ * was odd.
+ */
+#define MSM_ISP_STATS_RING_PGOFF 1
+#define MSM_ISP_STATS_RING_VERSION 1
+
+struct msm_isp_stats_ring_hdr {
+	uint32_t version;
+	uint32_t hdr_size;
+	uint32_t slot_size;
+	uint32_t nr_slots;
+	uint64_t head;
+	uint32_t reserved[10];
+};
+
+struct msm_isp_stats_ring_slot {
+	uint32_t seq;
+	uint32_t frame_id;
+	/* Monotonic time of the stats done irq */
+	uint64_t timestamp_ns;
+	uint32_t stats_mask;
+	uint8_t stats_buf_idxs[MSM_ISP_STATS_MAX];
+	uint8_t pd_stats_idx;
+};
+
 struct msm_isp_stream_ack {
 	uint32_t session_id;
 	uint32_t stream_id;
@@ -832,16 +832,19 @@ static int __init_or_module do_one_initcall_debug(initcall_t fn)
 int __init_or_module do_one_initcall(initcall_t fn)
 {
 	int count = preempt_count();
+	ktime_t calltime;
 	int ret;
 	char msgbuf[64];
 
 	if (initcall_blacklisted(fn))
 		return -EPERM;
 
+	calltime = boot_timeline_start();
 	if (initcall_debug)
 		ret = do_one_initcall_debug(fn);
 	else
 		ret = fn();
+	boot_timeline_initcall(fn, calltime, ret);
 
 	msgbuf[0] = 0;
 
@@ -1025,13 +1028,17 @@ static inline void mark_readonly(void)
 
 static int __ref kernel_init(void *unused)
 {
+	ktime_t calltime;
 	int ret;
 #ifdef CONFIG_EARLY_SERVICES
 	int status = 0;
 #endif
 	kernel_init_freeable();
 	/* need to finish all async __init code before freeing the memory */
+	calltime = boot_timeline_start();
 	async_synchronize_full();
+	boot_timeline_event(BOOT_TIMELINE_ASYNC_WAIT, "kernel_init",
+			    calltime, 0);
 	ftrace_free_init_mem();
 	free_initmem();
 	mark_readonly();
@@ -1156,10 +1156,194 @@ static void htab_map_free(struct bpf_map *map)
 	kfree(htab);
 }
 
+/* Copy the elements of consecutive buckets to user space, starting at the
+ * bucket in in_batch. For a plain lookup buckets are walked under RCU only,
+ * as in htab_map_get_next_key(), so a dump doesn't contend with the
+ * programs updating the map. The elements of a bucket are never split
+ * between two calls. The bucket to resume from is returned in out_batch,
+ * and -ENOENT once the last one has been copied.
+ */
+static int __htab_map_lookup_and_delete_batch(struct bpf_map *map,
+					      const union bpf_attr *attr,
+					      union bpf_attr __user *uattr,
+					      bool do_delete)
+{
+	struct bpf_htab *htab = container_of(map, struct bpf_htab, map);
+	void __user *uin_batch = u64_to_user_ptr(attr->batch.in_batch);
+	void __user *uout_batch = u64_to_user_ptr(attr->batch.out_batch);
+	void __user *ukeys = u64_to_user_ptr(attr->batch.keys);
+	void __user *uvalues = u64_to_user_ptr(attr->batch.values);
+	u32 batch = 0, total = 0, bucket_cnt, bucket_size = 8;
+	u32 key_size = map->key_size, value_size, size, i;
+	bool percpu = htab_is_percpu(htab), lru = htab_is_lru(htab);
+	void *keys = NULL, *values = NULL, *dst_key, *dst_val;
+	struct htab_elem **freed = NULL;
+	struct hlist_nulls_head *head;
+	struct hlist_nulls_node *n;
+	struct htab_elem *l;
+	unsigned long flags;
+	struct bucket *b;
+	bool moved;
+	int ret = 0, cpu, off;
+
+	if (uin_batch && copy_from_user(&batch, uin_batch, sizeof(batch)))
+		return -EFAULT;
+
+	if (batch >= htab->n_buckets)
+		return -ENOENT;
+
+	size = round_up(map->value_size, 8);
+	value_size = percpu ? size * num_possible_cpus() : map->value_size;
+
+alloc:
+	keys = kvmalloc(key_size * bucket_size, GFP_USER | __GFP_NOWARN);
+	values = kvmalloc(value_size * bucket_size, GFP_USER | __GFP_NOWARN);
+	if (do_delete && lru)
+		freed = kvmalloc_array(bucket_size, sizeof(*freed),
+				       GFP_USER | __GFP_NOWARN);
+	if (!keys || !values || (do_delete && lru && !freed)) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	for (; batch < htab->n_buckets; batch++) {
+		b = &htab->buckets[batch];
+		head = &b->head;
+again:
+		bucket_cnt = 0;
+		dst_key = keys;
+		dst_val = values;
+
+		if (do_delete) {
+			/* as for the single element delete from syscall */
+			preempt_disable();
+			__this_cpu_inc(bpf_prog_active);
+			raw_spin_lock_irqsave(&b->lock, flags);
+		}
+		rcu_read_lock();
+		hlist_nulls_for_each_entry_rcu(l, n, head, hash_node) {
+			if (++bucket_cnt > bucket_size)
+				continue;
+
+			memcpy(dst_key, l->key, key_size);
+			dst_key += key_size;
+
+			if (percpu) {
+				void __percpu *pptr;
+
+				/* no LRU ref, as in bpf_percpu_hash_copy() */
+				pptr = htab_elem_get_ptr(l, key_size);
+				off = 0;
+				for_each_possible_cpu(cpu) {
+					bpf_long_memcpy(dst_val + off,
+							per_cpu_ptr(pptr, cpu),
+							size);
+					off += size;
+				}
+			} else {
+				memcpy(dst_val, l->key + round_up(key_size, 8),
+				       value_size);
+			}
+			dst_val += value_size;
+		}
+		/* an element moved to another bucket while we walked it,
+		 * which can't happen with the bucket lock held
+		 */
+		moved = get_nulls_value(n) != batch;
+
+		i = 0;
+		if (do_delete && bucket_cnt <= bucket_size &&
+		    bucket_cnt <= attr->batch.count - total) {
+			hlist_nulls_for_each_entry_safe(l, n, head, hash_node) {
+				hlist_nulls_del_rcu(&l->hash_node);
+				if (lru)
+					freed[i++] = l;
+				else
+					free_htab_elem(htab, l);
+			}
+		}
+		rcu_read_unlock();
+		if (do_delete) {
+			raw_spin_unlock_irqrestore(&b->lock, flags);
+			/* after the unlock, as in htab_lru_map_delete_elem() */
+			while (i--)
+				bpf_lru_push_free(&htab->lru,
+						  &freed[i]->lru_node);
+			__this_cpu_dec(bpf_prog_active);
+			preempt_enable();
+		}
+
+		if (unlikely(moved))
+			goto again;
+
+		if (bucket_cnt > attr->batch.count - total) {
+			if (!total) {
+				/* tell user space the size it needs */
+				total = bucket_cnt;
+				ret = -ENOSPC;
+			}
+			break;
+		}
+
+		if (bucket_cnt > bucket_size) {
+			bucket_size = bucket_cnt;
+			kvfree(keys);
+			kvfree(values);
+			kvfree(freed);
+			freed = NULL;
+			goto alloc;
+		}
+
+		if (bucket_cnt &&
+		    (copy_to_user(ukeys + total * key_size, keys,
+				  bucket_cnt * key_size) ||
+		     copy_to_user(uvalues + total * value_size, values,
+				  bucket_cnt * value_size))) {
+			ret = -EFAULT;
+			goto out;
+		}
+
+		total += bucket_cnt;
+		cond_resched();
+	}
+
+	if (batch == htab->n_buckets)
+		ret = -ENOENT;
+
+	if (put_user(total, &uattr->batch.count) ||
+	    (uout_batch &&
+	     copy_to_user(uout_batch, &batch, sizeof(batch))))
+		ret = -EFAULT;
+
+out:
+	kvfree(keys);
+	kvfree(values);
+	kvfree(freed);
+	return ret;
+}
+
+static int htab_map_lookup_batch(struct bpf_map *map,
+				 const union bpf_attr *attr,
+				 union bpf_attr __user *uattr)
+{
+	return __htab_map_lookup_and_delete_batch(map, attr, uattr, false);
+}
+
+static int htab_map_lookup_and_delete_batch(struct bpf_map *map,
+					    const union bpf_attr *attr,
+					    union bpf_attr __user *uattr)
+{
+	return __htab_map_lookup_and_delete_batch(map, attr, uattr, true);
+}
+
 const struct bpf_map_ops htab_map_ops = {
 	.map_alloc = htab_map_alloc,
 	.map_free = htab_map_free,
 	.map_get_next_key = htab_map_get_next_key,
+	.map_lookup_batch = htab_map_lookup_batch,
+	.map_lookup_and_delete_batch = htab_map_lookup_and_delete_batch,
+	.map_update_batch = generic_map_update_batch,
+	.map_delete_batch = generic_map_delete_batch,
 	.map_lookup_elem = htab_map_lookup_elem,
 	.map_update_elem = htab_map_update_elem,
 	.map_delete_elem = htab_map_delete_elem,
@@ -1170,6 +1354,10 @@ const struct bpf_map_ops htab_lru_map_ops = {
 	.map_alloc = htab_map_alloc,
 	.map_free = htab_map_free,
 	.map_get_next_key = htab_map_get_next_key,
+	.map_lookup_batch = htab_map_lookup_batch,
+	.map_lookup_and_delete_batch = htab_map_lookup_and_delete_batch,
+	.map_update_batch = generic_map_update_batch,
+	.map_delete_batch = generic_map_delete_batch,
 	.map_lookup_elem = htab_lru_map_lookup_elem,
 	.map_lookup_elem_sys_only = htab_lru_map_lookup_elem_sys,
 	.map_update_elem = htab_lru_map_update_elem,
@@ -1254,6 +1442,10 @@ const struct bpf_map_ops htab_percpu_map_ops = {
 	.map_alloc = htab_map_alloc,
 	.map_free = htab_map_free,
 	.map_get_next_key = htab_map_get_next_key,
+	.map_lookup_batch = htab_map_lookup_batch,
+	.map_lookup_and_delete_batch = htab_map_lookup_and_delete_batch,
+	.map_update_batch = generic_map_update_batch,
+	.map_delete_batch = generic_map_delete_batch,
 	.map_lookup_elem = htab_percpu_map_lookup_elem,
 	.map_update_elem = htab_percpu_map_update_elem,
 	.map_delete_elem = htab_map_delete_elem,
@@ -1263,6 +1455,10 @@ const struct bpf_map_ops htab_lru_percpu_map_ops = {
 	.map_alloc = htab_map_alloc,
 	.map_free = htab_map_free,
 	.map_get_next_key = htab_map_get_next_key,
+	.map_lookup_batch = htab_map_lookup_batch,
+	.map_lookup_and_delete_batch = htab_map_lookup_and_delete_batch,
+	.map_update_batch = generic_map_update_batch,
+	.map_delete_batch = generic_map_delete_batch,
 	.map_lookup_elem = htab_lru_percpu_map_lookup_elem,
 	.map_update_elem = htab_lru_percpu_map_update_elem,
 	.map_delete_elem = htab_lru_map_delete_elem,
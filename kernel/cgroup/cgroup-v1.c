@@ -505,10 +505,22 @@ static int cgroup_pidlist_show(struct seq_file *s, void *v)
 	return 0;
 }
 
+/* Account an attach write that started at @start, under cgroup_mutex */
+static void cgroup1_account_migration(struct cgroup_root *root, u64 start)
+{
+	u64 delta = ktime_get_ns() - start;
+
+	root->nr_migrations++;
+	root->migrate_time += delta;
+	if (delta > root->migrate_time_max)
+		root->migrate_time_max = delta;
+}
+
 static ssize_t __cgroup1_procs_write(struct kernfs_open_file *of,
 				     char *buf, size_t nbytes, loff_t off,
 				     bool threadgroup)
 {
+	u64 start = ktime_get_ns();
 	struct cgroup *cgrp;
 	struct task_struct *task;
 	const struct cred *cred, *tcred;
@@ -544,6 +556,7 @@ static ssize_t __cgroup1_procs_write(struct kernfs_open_file *of,
 out_finish:
 	cgroup_procs_write_finish(task);
 out_unlock:
+	cgroup1_account_migration(cgrp->root, start);
 	cgroup_kn_unlock(of->kn);
 
 	return ret ?: nbytes;
@@ -561,6 +574,59 @@ static ssize_t cgroup1_tasks_write(struct kernfs_open_file *of,
 	return __cgroup1_procs_write(of, buf, nbytes, off, false);
 }
 
+/*
+ * Move every process of a UID with one write, e.g. when an app goes to or
+ * leaves the foreground, instead of one cgroup.procs write per process.
+ */
+static ssize_t cgroup1_uid_procs_write(struct kernfs_open_file *of,
+				       char *buf, size_t nbytes, loff_t off)
+{
+	const struct cred *cred = of->file->f_cred;
+	u64 start = ktime_get_ns();
+	struct cgroup *cgrp;
+	unsigned int val;
+	kuid_t uid;
+	ssize_t ret;
+
+	if (kstrtouint(strstrip(buf), 0, &val))
+		return -EINVAL;
+
+	uid = make_kuid(cred->user_ns, val);
+	if (!uid_valid(uid))
+		return -EINVAL;
+
+	/* Same rule as cgroup.procs, checked once for the whole UID */
+	if (!uid_eq(cred->euid, GLOBAL_ROOT_UID) &&
+	    !uid_eq(cred->euid, uid) &&
+	    !ns_capable(cred->user_ns, CAP_SYS_NICE))
+		return -EACCES;
+
+	cgrp = cgroup_kn_lock_live(of->kn, false);
+	if (!cgrp)
+		return -ENODEV;
+
+	percpu_down_write(&cgroup_threadgroup_rwsem);
+	ret = cgroup_attach_uid(cgrp, uid);
+	cgroup_procs_write_finish(NULL);
+
+	cgroup1_account_migration(cgrp->root, start);
+	cgroup_kn_unlock(of->kn);
+
+	return ret ?: nbytes;
+}
+
+static int cgroup_migrate_stat_show(struct seq_file *seq, void *v)
+{
+	struct cgroup_root *root = seq_css(seq)->cgroup->root;
+
+	seq_printf(seq, "migrations %llu\n", root->nr_migrations);
+	seq_printf(seq, "total_us %llu\n",
+		   div_u64(root->migrate_time, NSEC_PER_USEC));
+	seq_printf(seq, "max_us %llu\n",
+		   div_u64(root->migrate_time_max, NSEC_PER_USEC));
+	return 0;
+}
+
 static ssize_t cgroup_release_agent_write(struct kernfs_open_file *of,
 					  char *buf, size_t nbytes, loff_t off)
 {
@@ -666,6 +732,15 @@ struct cftype cgroup1_base_files[] = {
 		.private = CGROUP_FILE_TASKS,
 		.write = cgroup1_tasks_write,
 	},
+	{
+		.name = "cgroup.uid_procs",
+		.write = cgroup1_uid_procs_write,
+	},
+	{
+		.name = "cgroup.migrate_stat",
+		.flags = CFTYPE_ONLY_ON_ROOT,
+		.seq_show = cgroup_migrate_stat_show,
+	},
 	{
 		.name = "notify_on_release",
 		.read_u64 = cgroup_read_notify_on_release,
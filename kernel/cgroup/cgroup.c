@@ -2719,6 +2719,64 @@ int cgroup_attach_task(struct cgroup *dst_cgrp, struct task_struct *leader,
 	return ret;
 }
 
+static bool cgroup_uid_task_match(struct task_struct *task, kuid_t uid)
+{
+	return !(task->flags & PF_KTHREAD) && !task->no_cgroup_migration &&
+	       !(task->flags & PF_NO_SETAFFINITY) &&
+	       uid_eq(task_uid(task), uid);
+}
+
+/**
+ * cgroup_attach_uid - attach all processes of a user to a cgroup
+ * @dst_cgrp: the cgroup to attach to
+ * @uid: real uid of the processes to attach
+ *
+ * Same as cgroup_attach_task() on every threadgroup owned by @uid, but done
+ * as a single migration, so the controllers' ->can_attach() and ->attach()
+ * run once for the whole set instead of once per process.
+ *
+ * Call holding cgroup_mutex and cgroup_threadgroup_rwsem.
+ */
+int cgroup_attach_uid(struct cgroup *dst_cgrp, kuid_t uid)
+{
+	DEFINE_CGROUP_MGCTX(mgctx);
+	struct task_struct *g, *task;
+	int ret;
+
+	ret = cgroup_migrate_vet_dst(dst_cgrp);
+	if (ret)
+		return ret;
+
+	/* look up all src csets */
+	spin_lock_irq(&css_set_lock);
+	rcu_read_lock();
+	for_each_process_thread(g, task) {
+		if (cgroup_uid_task_match(task, uid))
+			cgroup_migrate_add_src(task_css_set(task), dst_cgrp,
+					       &mgctx);
+	}
+	rcu_read_unlock();
+	spin_unlock_irq(&css_set_lock);
+
+	/* prepare dst csets and commit */
+	ret = cgroup_migrate_prepare_dst(&mgctx);
+	if (!ret) {
+		spin_lock_irq(&css_set_lock);
+		rcu_read_lock();
+		for_each_process_thread(g, task) {
+			if (cgroup_uid_task_match(task, uid))
+				cgroup_migrate_add_task(task, &mgctx);
+		}
+		rcu_read_unlock();
+		spin_unlock_irq(&css_set_lock);
+
+		ret = cgroup_migrate_execute(&mgctx);
+	}
+
+	cgroup_migrate_finish(&mgctx);
+	return ret;
+}
+
 struct task_struct *cgroup_procs_write_start(char *buf, bool threadgroup)
 	__acquires(&cgroup_threadgroup_rwsem)
 {
@@ -2772,7 +2830,8 @@ void cgroup_procs_write_finish(struct task_struct *task)
 	int ssid;
 
 	/* release reference from cgroup_procs_write_start() */
-	put_task_struct(task);
+	if (task)
+		put_task_struct(task);
 
 	percpu_up_write(&cgroup_threadgroup_rwsem);
 	for_each_subsys(ss, ssid)
@@ -63,6 +63,7 @@
 #include <linux/rcuwait.h>
 #include <linux/compat.h>
 #include <linux/sysfs.h>
+#include <linux/simple_lmk.h>
 
 #include <linux/uaccess.h>
 #include <asm/unistd.h>
@@ -241,6 +242,7 @@ void release_task(struct task_struct *p)
 
 	proc_flush_task(p);
 	cgroup_release(p);
+	simple_lmk_task_release(p);
 
 	write_lock_irq(&tasklist_lock);
 	ptrace_release_task(p);
@@ -868,6 +868,10 @@ static struct mm_struct *mm_init(struct mm_struct *mm, struct task_struct *p,
 	mm->locked_vm = 0;
 	mm->pinned_vm = 0;
 	memset(&mm->rss_stat, 0, sizeof(mm->rss_stat));
+#ifdef CONFIG_PROCESS_RECLAIM
+	atomic_long_set(&mm->reclaimed_pages, 0);
+	atomic_long_set(&mm->swapin_refaults, 0);
+#endif
 	spin_lock_init(&mm->page_table_lock);
 	spin_lock_init(&mm->arg_lock);
 	mm_init_cpumask(mm);
@@ -2040,6 +2044,7 @@ static __latent_entropy struct task_struct *copy_process(
 
 	p->pdeath_signal = 0;
 	INIT_LIST_HEAD(&p->thread_group);
+	simple_lmk_init_task(p);
 	p->task_works = NULL;
 
 	cgroup_threadgroup_change_begin(current);
@@ -2167,6 +2172,8 @@ static __latent_entropy struct task_struct *copy_process(
 	uprobe_copy_process(p, clone_flags);
 
 	copy_oom_score_adj(clone_flags, p);
+	if (!(clone_flags & CLONE_THREAD))
+		simple_lmk_update_adj(p);
 
 	return p;
 
@@ -10,6 +10,9 @@
 #include <linux/syscalls.h>
 #include <linux/freezer.h>
 #include <linux/kthread.h>
+#ifdef OPLUS_FEATURE_HANS_FREEZE
+#include <linux/hans.h>
+#endif /*OPLUS_FEATURE_HANS_FREEZE*/
 
 /* total number of freezing conditions in effect */
 atomic_t system_freezing_cnt = ATOMIC_INIT(0);
@@ -48,6 +51,12 @@ bool freezing_slow_path(struct task_struct *p)
 	if (pm_nosig_freezing || cgroup_freezing(p))
 		return true;
 
+#ifdef OPLUS_FEATURE_HANS_FREEZE
+	/* UIDs frozen by hans without a freezer cgroup */
+	if (hans_uid_freezing(p))
+		return true;
+#endif /*OPLUS_FEATURE_HANS_FREEZE*/
+
 	if (pm_freezing && !(p->flags & PF_KTHREAD))
 		return true;
 
@@ -45,8 +45,10 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 #include <linux/compat.h>
+#include <linux/debugfs.h>
 #include <linux/slab.h>
 #include <linux/poll.h>
+#include <linux/seq_file.h>
 #include <linux/fs.h>
 #include <linux/file.h>
 #include <linux/jhash.h>
@@ -64,6 +66,7 @@
 #include <linux/sched/rt.h>
 #include <linux/sched/wake_q.h>
 #include <linux/sched/mm.h>
+#include <linux/sched/ux.h>
 #include <linux/hugetlb.h>
 #include <linux/freezer.h>
 #include <linux/bootmem.h>
@@ -266,6 +269,8 @@ struct futex_hash_bucket {
 	atomic_t waiters;
 	spinlock_t lock;
 	struct plist_head chain;
+	/* Times the lock was found held, protected by lock */
+	unsigned long contended;
 } ____cacheline_aligned_in_smp;
 
 /*
@@ -392,6 +397,19 @@ static inline int hb_waiters_pending(struct futex_hash_bucket *hb)
 #endif
 }
 
+/*
+ * Take hb->lock, counting the times another task already held it.
+ */
+static inline void hb_lock(struct futex_hash_bucket *hb)
+	__acquires(&hb->lock)
+{
+	if (likely(spin_trylock(&hb->lock)))
+		return;
+
+	spin_lock(&hb->lock);
+	hb->contended++;
+}
+
 /**
  * hash_futex - Return the hash bucket in the global hash
  * @key:	Pointer to the futex key for which the hash is calculated
@@ -1677,16 +1695,17 @@ double_unlock_hb(struct futex_hash_bucket *hb1, struct futex_hash_bucket *hb2)
 }
 
 /*
- * Wake up waiters matching bitset queued on this futex (uaddr).
+ * Mark waiters matching bitset queued on this futex (uaddr) for wake up
+ * on @wake_q.
  */
 static int
-futex_wake(u32 __user *uaddr, unsigned int flags, int nr_wake, u32 bitset)
+__futex_wake(u32 __user *uaddr, unsigned int flags, int nr_wake, u32 bitset,
+	     struct wake_q_head *wake_q)
 {
 	struct futex_hash_bucket *hb;
 	struct futex_q *this, *next;
 	union futex_key key = FUTEX_KEY_INIT;
 	int ret;
-	DEFINE_WAKE_Q(wake_q);
 
 	if (!bitset)
 		return -EINVAL;
@@ -1701,7 +1720,7 @@ futex_wake(u32 __user *uaddr, unsigned int flags, int nr_wake, u32 bitset)
 	if (!hb_waiters_pending(hb))
 		goto out_put_key;
 
-	spin_lock(&hb->lock);
+	hb_lock(hb);
 
 	plist_for_each_entry_safe(this, next, &hb->chain, list) {
 		if (match_futex (&this->key, &key)) {
@@ -1714,20 +1733,34 @@ futex_wake(u32 __user *uaddr, unsigned int flags, int nr_wake, u32 bitset)
 			if (!(this->bitset & bitset))
 				continue;
 
-			mark_wake_futex(&wake_q, this);
+			mark_wake_futex(wake_q, this);
 			if (++ret >= nr_wake)
 				break;
 		}
 	}
 
 	spin_unlock(&hb->lock);
-	wake_up_q(&wake_q);
 out_put_key:
 	put_futex_key(&key);
 out:
 	return ret;
 }
 
+/*
+ * Wake up waiters matching bitset queued on this futex (uaddr).
+ */
+static int
+futex_wake(u32 __user *uaddr, unsigned int flags, int nr_wake, u32 bitset)
+{
+	DEFINE_WAKE_Q(wake_q);
+	int ret;
+
+	ret = __futex_wake(uaddr, flags, nr_wake, bitset, &wake_q);
+	wake_up_q(&wake_q);
+
+	return ret;
+}
+
 static int futex_atomic_op_inuser(unsigned int encoded_op, u32 __user *uaddr)
 {
 	unsigned int op =	  (encoded_op & 0x70000000) >> 28;
@@ -2342,7 +2375,7 @@ static inline struct futex_hash_bucket *queue_lock(struct futex_q *q)
 
 	q->lock_ptr = &hb->lock;
 
-	spin_lock(&hb->lock); /* implies smp_mb(); (A) */
+	hb_lock(hb); /* implies smp_mb(); (A) */
 	return hb;
 }
 
@@ -2919,6 +2952,265 @@ static long futex_wait_restart(struct restart_block *restart)
 				restart->futex.val, tp, restart->futex.bitset, (u32)(restart->futex.uaddr2));
 }
 
+#ifdef CONFIG_COMPAT
+struct compat_futex_wait_block {
+	compat_uptr_t uaddr;
+	u32 val;
+	u32 bitset;
+};
+#endif
+
+/*
+ * Copy the @count futex_wait_block of a FUTEX_WAIT_MULTIPLE or
+ * FUTEX_WAKE_MULTIPLE call into a new array.
+ */
+static struct futex_wait_block *
+futex_get_wait_blocks(struct futex_wait_block __user *ublocks, u32 count)
+{
+	struct futex_wait_block *blocks;
+
+	if (!count || count > FUTEX_MULTIPLE_MAX_COUNT)
+		return ERR_PTR(-EINVAL);
+
+	blocks = kmalloc_array(count, sizeof(*blocks), GFP_KERNEL);
+	if (!blocks)
+		return ERR_PTR(-ENOMEM);
+
+#ifdef CONFIG_COMPAT
+	if (in_compat_syscall()) {
+		struct compat_futex_wait_block __user *ucblocks;
+		struct compat_futex_wait_block cblock;
+		u32 i;
+
+		ucblocks = (struct compat_futex_wait_block __user *)ublocks;
+		for (i = 0; i < count; i++) {
+			if (copy_from_user(&cblock, &ucblocks[i],
+					   sizeof(cblock)))
+				goto fault;
+			blocks[i].uaddr = compat_ptr(cblock.uaddr);
+			blocks[i].val = cblock.val;
+			blocks[i].bitset = cblock.bitset;
+		}
+		return blocks;
+	}
+#endif
+	if (copy_from_user(blocks, ublocks, count * sizeof(*blocks)))
+		goto fault;
+
+	return blocks;
+
+fault:
+	kfree(blocks);
+	return ERR_PTR(-EFAULT);
+}
+
+/*
+ * Unqueue the first @count futex_qs of @qs. Returns the index of the first
+ * one that had already been woken, or -1 if none had.
+ */
+static int unqueue_multiple(struct futex_q *qs, u32 count)
+{
+	int ret = -1;
+	u32 i;
+
+	for (i = 0; i < count; i++) {
+		if (!unqueue_me(&qs[i]) && ret < 0)
+			ret = i;
+	}
+
+	return ret;
+}
+
+/**
+ * futex_wait_multiple_setup() - Prepare to wait on several futexes
+ * @blocks:	the futexes and their expected values
+ * @qs:		a futex_q for each of @blocks
+ * @count:	number of entries in @blocks and @qs
+ * @flags:	futex flags (FLAGS_SHARED, etc.)
+ * @woken:	index of a futex woken while backing out
+ *
+ * As futex_wait_setup(), for each of the futexes in turn. As soon as one
+ * of them doesn't hold its expected value the ones already queued are
+ * unqueued again, which may find that one of them was woken meanwhile.
+ *
+ * Return:
+ *  -  0 - all of @qs are queued and the task is TASK_INTERRUPTIBLE;
+ *  -  1 - a futex was woken, its index is stored in @woken;
+ *  - <0 - -EFAULT or -EWOULDBLOCK, none of @qs is queued
+ */
+static int futex_wait_multiple_setup(struct futex_wait_block *blocks,
+				     struct futex_q *qs, u32 count,
+				     unsigned int flags, int *woken)
+{
+	struct futex_hash_bucket *hb;
+	u32 i, j, uval;
+	int ret;
+
+retry:
+	for (i = 0; i < count; i++) {
+		ret = get_futex_key(blocks[i].uaddr, flags & FLAGS_SHARED,
+				    &qs[i].key, VERIFY_READ);
+		if (unlikely(ret)) {
+			while (i--)
+				put_futex_key(&qs[i].key);
+			return ret;
+		}
+	}
+
+	/*
+	 * The task state is set before the first futex_q becomes visible to
+	 * wakers, so a wake up on any futex queued so far is not lost.
+	 */
+	set_current_state(TASK_INTERRUPTIBLE);
+
+	for (i = 0; i < count; i++) {
+		hb = queue_lock(&qs[i]);
+		ret = get_futex_value_locked(&uval, blocks[i].uaddr);
+		if (!ret && uval == blocks[i].val) {
+			queue_me(&qs[i], hb);
+			continue;
+		}
+
+		queue_unlock(hb);
+		__set_current_state(TASK_RUNNING);
+
+		*woken = unqueue_multiple(qs, i);
+		for (j = i; j < count; j++)
+			put_futex_key(&qs[j].key);
+		if (*woken >= 0)
+			return 1;
+
+		if (!ret)
+			return -EWOULDBLOCK;
+
+		if (get_user(uval, blocks[i].uaddr))
+			return -EFAULT;
+		goto retry;
+	}
+
+	return 0;
+}
+
+static int futex_wait_multiple(struct futex_wait_block __user *ublocks,
+			       unsigned int flags, u32 count,
+			       ktime_t *abs_time)
+{
+	struct hrtimer_sleeper timeout, *to = NULL;
+	struct futex_wait_block *blocks;
+	struct futex_q *qs;
+	int ret, woken;
+	u32 i;
+
+	blocks = futex_get_wait_blocks(ublocks, count);
+	if (IS_ERR(blocks))
+		return PTR_ERR(blocks);
+
+	qs = kmalloc_array(count, sizeof(*qs), GFP_KERNEL);
+	if (!qs) {
+		ret = -ENOMEM;
+		goto out_free;
+	}
+
+	for (i = 0; i < count; i++) {
+		if (!blocks[i].bitset) {
+			ret = -EINVAL;
+			goto out_free;
+		}
+		qs[i] = futex_q_init;
+		qs[i].bitset = blocks[i].bitset;
+	}
+
+	if (abs_time) {
+		to = &timeout;
+
+		hrtimer_init_on_stack(&to->timer, CLOCK_MONOTONIC,
+				      HRTIMER_MODE_ABS);
+		hrtimer_init_sleeper(to, current);
+		hrtimer_set_expires_range_ns(&to->timer, *abs_time,
+					     current->timer_slack_ns);
+	}
+
+	for (;;) {
+		ret = futex_wait_multiple_setup(blocks, qs, count, flags,
+						&woken);
+		if (ret) {
+			if (ret > 0)
+				ret = woken;
+			break;
+		}
+
+		if (to)
+			hrtimer_start_expires(&to->timer, HRTIMER_MODE_ABS);
+
+		/* Skip schedule() if one of the futexes was woken already */
+		for (i = 0; i < count; i++) {
+			if (plist_node_empty(&qs[i].list))
+				break;
+		}
+		if (i == count && (!to || to->task))
+			freezable_schedule();
+		__set_current_state(TASK_RUNNING);
+
+		/* unqueue_multiple() drops the q.key refs */
+		ret = unqueue_multiple(qs, count);
+		if (ret >= 0)
+			break;
+
+		ret = -ETIMEDOUT;
+		if (to && !to->task)
+			break;
+
+		/*
+		 * Restarting would start the relative timeout over again, so
+		 * only waits without one are restarted.
+		 */
+		if (signal_pending(current)) {
+			ret = to ? -EINTR : -ERESTARTSYS;
+			break;
+		}
+	}
+
+	if (to) {
+		hrtimer_cancel(&to->timer);
+		destroy_hrtimer_on_stack(&to->timer);
+	}
+out_free:
+	kfree(qs);
+	kfree(blocks);
+	return ret;
+}
+
+/*
+ * Wake up waiters on each of the futexes at ublocks, with a single pass
+ * over the woken tasks once all hash bucket locks are dropped. Stops at the
+ * first futex that fails and returns its error if no waiter was woken yet.
+ */
+static int futex_wake_multiple(struct futex_wait_block __user *ublocks,
+			       unsigned int flags, u32 count)
+{
+	struct futex_wait_block *blocks;
+	DEFINE_WAKE_Q(wake_q);
+	int ret = 0, woken = 0;
+	u32 i;
+
+	blocks = futex_get_wait_blocks(ublocks, count);
+	if (IS_ERR(blocks))
+		return PTR_ERR(blocks);
+
+	for (i = 0; i < count; i++) {
+		ret = __futex_wake(blocks[i].uaddr, flags,
+				   min_t(u32, blocks[i].val, INT_MAX),
+				   blocks[i].bitset, &wake_q);
+		if (ret < 0)
+			break;
+		woken += ret;
+	}
+	wake_up_q(&wake_q);
+
+	kfree(blocks);
+	return woken ? woken : ret;
+}
+
 
 /*
  * Userspace tried a 0 -> TID atomic transition of the futex value
@@ -2934,6 +3226,7 @@ static int futex_lock_pi(u32 __user *uaddr, unsigned int flags,
 {
 	struct hrtimer_sleeper timeout, *to = NULL;
 	struct task_struct *exiting = NULL;
+	struct task_struct *ux_owner = NULL;
 	struct rt_mutex_waiter rt_waiter;
 	struct futex_hash_bucket *hb;
 	struct futex_q q = futex_q_init;
@@ -3035,6 +3328,9 @@ static int futex_lock_pi(u32 __user *uaddr, unsigned int flags,
 	 * it sees the futex_q::pi_state.
 	 */
 	ret = __rt_mutex_start_proxy_lock(&q.pi_state->pi_mutex, &rt_waiter, current);
+	/* The owner is stable under wait_lock while we are enqueued */
+	if (!ret)
+		ux_owner = sched_ux_inherit(rt_mutex_owner(&q.pi_state->pi_mutex));
 	raw_spin_unlock_irq(&q.pi_state->pi_mutex.wait_lock);
 
 	if (ret) {
@@ -3047,6 +3343,7 @@ static int futex_lock_pi(u32 __user *uaddr, unsigned int flags,
 		hrtimer_start_expires(&to->timer, HRTIMER_MODE_ABS);
 
 	ret = rt_mutex_wait_proxy_lock(&q.pi_state->pi_mutex, to, &rt_waiter);
+	sched_ux_uninherit(ux_owner);
 
 cleanup:
 	spin_lock(q.lock_ptr);
@@ -3938,6 +4235,11 @@ long do_futex(u32 __user *uaddr, int op, u32 val, ktime_t *timeout,
 					     uaddr2);
 	case FUTEX_CMP_REQUEUE_PI:
 		return futex_requeue(uaddr, flags, uaddr2, val, val2, &val3, 1);
+	case FUTEX_WAIT_MULTIPLE:
+		return futex_wait_multiple((void __user *)uaddr, flags, val,
+					   timeout);
+	case FUTEX_WAKE_MULTIPLE:
+		return futex_wake_multiple((void __user *)uaddr, flags, val);
 	}
 	return -ENOSYS;
 }
@@ -3954,7 +4256,8 @@ SYSCALL_DEFINE6(futex, u32 __user *, uaddr, int, op, u32, val,
 
 	if (utime && (cmd == FUTEX_WAIT || cmd == FUTEX_LOCK_PI ||
 		      cmd == FUTEX_WAIT_BITSET ||
-		      cmd == FUTEX_WAIT_REQUEUE_PI)) {
+		      cmd == FUTEX_WAIT_REQUEUE_PI ||
+		      cmd == FUTEX_WAIT_MULTIPLE)) {
 		if (unlikely(should_fail_futex(!(op & FUTEX_PRIVATE_FLAG))))
 			return -EFAULT;
 		if (copy_from_user(&ts, utime, sizeof(ts)) != 0)
@@ -3963,7 +4266,7 @@ SYSCALL_DEFINE6(futex, u32 __user *, uaddr, int, op, u32, val,
 			return -EINVAL;
 
 		t = timespec_to_ktime(ts);
-		if (cmd == FUTEX_WAIT)
+		if (cmd == FUTEX_WAIT || cmd == FUTEX_WAIT_MULTIPLE)
 			t = ktime_add_safe(ktime_get(), t);
 		tp = &t;
 	}
@@ -4146,14 +4449,15 @@ COMPAT_SYSCALL_DEFINE6(futex, u32 __user *, uaddr, int, op, u32, val,
 
 	if (utime && (cmd == FUTEX_WAIT || cmd == FUTEX_LOCK_PI ||
 		      cmd == FUTEX_WAIT_BITSET ||
-		      cmd == FUTEX_WAIT_REQUEUE_PI)) {
+		      cmd == FUTEX_WAIT_REQUEUE_PI ||
+		      cmd == FUTEX_WAIT_MULTIPLE)) {
 		if (compat_get_timespec(&ts, utime))
 			return -EFAULT;
 		if (!timespec_valid(&ts))
 			return -EINVAL;
 
 		t = timespec_to_ktime(ts);
-		if (cmd == FUTEX_WAIT)
+		if (cmd == FUTEX_WAIT || cmd == FUTEX_WAIT_MULTIPLE)
 			t = ktime_add_safe(ktime_get(), t);
 		tp = &t;
 	}
@@ -4214,3 +4518,63 @@ static int __init futex_init(void)
 	return 0;
 }
 core_initcall(futex_init);
+
+#ifdef CONFIG_DEBUG_FS
+
+#define FUTEX_CONTENTION_TOP	16
+
+/*
+ * Total hash bucket lock contention and the most contended buckets, to tell
+ * a hot futex from hash collisions between unrelated ones.
+ */
+static int futex_contention_show(struct seq_file *m, void *v)
+{
+	unsigned long top[FUTEX_CONTENTION_TOP] = { 0 };
+	unsigned long idx[FUTEX_CONTENTION_TOP] = { 0 };
+	unsigned long i, total = 0, contended;
+	int j;
+
+	for (i = 0; i < futex_hashsize; i++) {
+		contended = READ_ONCE(futex_queues[i].contended);
+		total += contended;
+		if (contended <= top[FUTEX_CONTENTION_TOP - 1])
+			continue;
+
+		for (j = FUTEX_CONTENTION_TOP - 1;
+		     j > 0 && top[j - 1] < contended; j--) {
+			top[j] = top[j - 1];
+			idx[j] = idx[j - 1];
+		}
+		top[j] = contended;
+		idx[j] = i;
+	}
+
+	seq_printf(m, "buckets: %lu\ncontended: %lu\n", futex_hashsize, total);
+	for (j = 0; j < FUTEX_CONTENTION_TOP && top[j]; j++)
+		seq_printf(m, "bucket %lu: contended %lu waiters %d\n",
+			   idx[j], top[j],
+			   atomic_read(&futex_queues[idx[j]].waiters));
+
+	return 0;
+}
+
+static int futex_contention_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, futex_contention_show, NULL);
+}
+
+static const struct file_operations futex_contention_fops = {
+	.open		= futex_contention_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init futex_contention_debugfs(void)
+{
+	debugfs_create_file("futex_contention", 0400, NULL, NULL,
+			    &futex_contention_fops);
+	return 0;
+}
+late_initcall(futex_contention_debugfs);
+#endif /* CONFIG_DEBUG_FS */
@@ -20,6 +20,11 @@
 #include <linux/netlink.h>
 #include <net/net_namespace.h>
 #include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <linux/jhash.h>
+#include <linux/percpu.h>
+#include <linux/ratelimit.h>
+#include <linux/workqueue.h>
 #include <net/sock.h>
 #include <linux/vmalloc.h>
 #include <linux/version.h>
@@ -100,6 +105,166 @@ int kevent_send_to_user(struct kernel_packet_info *userinfo)
 
 EXPORT_SYMBOL(kevent_send_to_user);
 
+/*
+ * Events queued with kevent_queue_to_user() are copied into a per-cpu ring
+ * and sent by a worker every upload_delay_ms, so callers on hot driver paths
+ * never allocate skbs or call into netlink. Each event type (log tag and
+ * event id) is rate limited, and events that are throttled or don't fit in
+ * the ring are only counted in /proc/kevent_upload.
+ */
+#define KEVENT_RING_SLOTS	16
+#define KEVENT_SLOT_PAYLOAD	256
+#define KEVENT_RATELIMIT_BITS	6
+
+struct kevent_slot {
+	unsigned char data[sizeof(struct kernel_packet_info) +
+			   KEVENT_SLOT_PAYLOAD];
+};
+
+struct kevent_ring {
+	unsigned int head;
+	unsigned int tail;
+	unsigned long dropped_full;
+	unsigned long dropped_ratelimit;
+	struct kevent_slot slots[KEVENT_RING_SLOTS];
+};
+
+static struct kevent_ring __percpu *kevent_rings;
+static struct ratelimit_state kevent_ratelimit[1 << KEVENT_RATELIMIT_BITS];
+static unsigned long kevent_sent, kevent_send_failed;
+
+static unsigned int upload_delay_ms = 200;
+module_param(upload_delay_ms, uint, 0644);
+MODULE_PARM_DESC(upload_delay_ms, "Delay used to batch queued events");
+
+static unsigned int ratelimit_interval_ms = 5000;
+module_param(ratelimit_interval_ms, uint, 0444);
+MODULE_PARM_DESC(ratelimit_interval_ms, "Rate limit interval per event type");
+
+static unsigned int ratelimit_burst = 10;
+module_param(ratelimit_burst, uint, 0444);
+MODULE_PARM_DESC(ratelimit_burst, "Events per type sent per interval");
+
+static void kevent_upload_fn(struct work_struct *work)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct kevent_ring *ring = per_cpu_ptr(kevent_rings, cpu);
+		unsigned int head = READ_ONCE(ring->head);
+		unsigned int tail = ring->tail;
+
+		/* Read slots only after seeing the head that covers them */
+		smp_rmb();
+		for (; tail != head; tail++) {
+			struct kevent_slot *slot;
+
+			slot = &ring->slots[tail % KEVENT_RING_SLOTS];
+			if (kevent_send_to_user((void *)slot->data))
+				kevent_send_failed++;
+			else
+				kevent_sent++;
+		}
+
+		/* Done with the slots before the producer may reuse them */
+		smp_mb();
+		WRITE_ONCE(ring->tail, tail);
+	}
+}
+
+static DECLARE_DELAYED_WORK(kevent_upload_work, kevent_upload_fn);
+
+static struct ratelimit_state *kevent_ratelimit_of(
+		struct kernel_packet_info *userinfo)
+{
+	u32 hash;
+
+	hash = jhash(userinfo->log_tag,
+		     strnlen(userinfo->log_tag, sizeof(userinfo->log_tag)), 0);
+	hash = jhash(userinfo->event_id,
+		     strnlen(userinfo->event_id, sizeof(userinfo->event_id)),
+		     hash);
+
+	return &kevent_ratelimit[hash & ((1 << KEVENT_RATELIMIT_BITS) - 1)];
+}
+
+/*
+ * Queue an event for upload from any context. Returns 0 once the event is
+ * queued, or a negative error if it was dropped. Events with a payload too
+ * large for the ring are sent right away like kevent_send_to_user().
+ */
+int kevent_queue_to_user(struct kernel_packet_info *userinfo)
+{
+	struct kevent_ring *ring;
+	unsigned long flags;
+	unsigned int head;
+
+	if (!kevent_rings)
+		return -ENODEV;
+
+	if (userinfo->payload_length > KEVENT_SLOT_PAYLOAD)
+		return kevent_send_to_user(userinfo) ? -EIO : 0;
+
+	if (!__ratelimit(kevent_ratelimit_of(userinfo))) {
+		this_cpu_inc(kevent_rings->dropped_ratelimit);
+		return -EBUSY;
+	}
+
+	local_irq_save(flags);
+	ring = this_cpu_ptr(kevent_rings);
+	head = ring->head;
+	if (head - READ_ONCE(ring->tail) >= KEVENT_RING_SLOTS) {
+		ring->dropped_full++;
+		local_irq_restore(flags);
+		return -ENOSPC;
+	}
+
+	memcpy(ring->slots[head % KEVENT_RING_SLOTS].data, userinfo,
+	       sizeof(*userinfo) + userinfo->payload_length);
+	/* Publish the slot before the head that makes it visible */
+	smp_wmb();
+	WRITE_ONCE(ring->head, head + 1);
+	local_irq_restore(flags);
+
+	queue_delayed_work(system_power_efficient_wq, &kevent_upload_work,
+			   msecs_to_jiffies(READ_ONCE(upload_delay_ms)));
+
+	return 0;
+}
+EXPORT_SYMBOL(kevent_queue_to_user);
+
+static int kevent_upload_show(struct seq_file *m, void *v)
+{
+	unsigned long dropped_full = 0, dropped_ratelimit = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct kevent_ring *ring = per_cpu_ptr(kevent_rings, cpu);
+
+		dropped_full += READ_ONCE(ring->dropped_full);
+		dropped_ratelimit += READ_ONCE(ring->dropped_ratelimit);
+	}
+
+	seq_printf(m, "sent: %lu\n", READ_ONCE(kevent_sent));
+	seq_printf(m, "send_failed: %lu\n", READ_ONCE(kevent_send_failed));
+	seq_printf(m, "dropped_full: %lu\n", dropped_full);
+	seq_printf(m, "dropped_ratelimit: %lu\n", dropped_ratelimit);
+
+	return 0;
+}
+
+static int kevent_upload_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, kevent_upload_show, NULL);
+}
+
+static const struct file_operations kevent_upload_fops = {
+	.open		= kevent_upload_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 /* kernel receive message from user space */
 void kernel_kevent_receive(struct sk_buff *__skbbr)
 {
@@ -126,16 +291,39 @@ int __init netlink_kevent_init(void)
 		.input  = kernel_kevent_receive,
 	};
 
+	int i;
+
 	netlink_fd = netlink_kernel_create(&init_net, NETLINK_OPLUS_KEVENT, &cfg);
 	if (!netlink_fd) {
 		printk(KERN_ERR "[KEVENT_UPLOAD]Can not create a netlink socket\n");
 		return -1;
 	}
+
+	for (i = 0; i < ARRAY_SIZE(kevent_ratelimit); i++) {
+		ratelimit_state_init(&kevent_ratelimit[i],
+				     msecs_to_jiffies(ratelimit_interval_ms),
+				     ratelimit_burst);
+		ratelimit_set_flags(&kevent_ratelimit[i],
+				    RATELIMIT_MSG_ON_RELEASE);
+	}
+
+	kevent_rings = alloc_percpu(struct kevent_ring);
+	if (!kevent_rings)
+		printk(KERN_ERR "[KEVENT_UPLOAD]Can not allocate event rings\n");
+	else
+		proc_create("kevent_upload", 0444, NULL, &kevent_upload_fops);
+
 	return 0;
 }
 
 void __exit netlink_kevent_exit(void)
 {
+	if (kevent_rings) {
+		remove_proc_entry("kevent_upload", NULL);
+		cancel_delayed_work_sync(&kevent_upload_work);
+		free_percpu(kevent_rings);
+		kevent_rings = NULL;
+	}
 	sock_release(netlink_fd->sk_socket);
 }
 
@@ -17,6 +17,7 @@
 #include <linux/sched/rt.h>
 #include <linux/sched/wake_q.h>
 #include <linux/sched/debug.h>
+#include <linux/sched/ux.h>
 #include <linux/osq_lock.h>
 
 #include "rwsem.h"
@@ -234,6 +235,30 @@ static void __rwsem_mark_wake(struct rw_semaphore *sem,
 	}
 }
 
+/*
+ * Make a writer owner UX while a UX task waits on @sem. Reader owners are
+ * anonymous and cannot be tracked.
+ */
+static struct task_struct *rwsem_ux_inherit(struct rw_semaphore *sem)
+{
+#if defined(CONFIG_SCHED_UX) && defined(CONFIG_RWSEM_SPIN_ON_OWNER)
+	struct task_struct *owner, *ret = NULL;
+
+	if (!task_is_ux(current))
+		return NULL;
+
+	rcu_read_lock();
+	owner = READ_ONCE(sem->owner);
+	if (owner && !rwsem_has_anonymous_owner(owner))
+		ret = sched_ux_inherit(owner);
+	rcu_read_unlock();
+
+	return ret;
+#else
+	return NULL;
+#endif
+}
+
 /*
  * Wait for the read lock to be granted
  */
@@ -242,6 +267,7 @@ __rwsem_down_read_failed_common(struct rw_semaphore *sem, int state)
 {
 	long count, adjustment = -RWSEM_ACTIVE_READ_BIAS;
 	struct rwsem_waiter waiter;
+	struct task_struct *ux_owner;
 	DEFINE_WAKE_Q(wake_q);
 	bool is_first_waiter = false;
 
@@ -272,6 +298,8 @@ __rwsem_down_read_failed_common(struct rw_semaphore *sem, int state)
 	raw_spin_unlock_irq(&sem->wait_lock);
 	wake_up_q(&wake_q);
 
+	ux_owner = rwsem_ux_inherit(sem);
+
 	/* wait to be given the lock */
 	while (true) {
 		set_current_state(state);
@@ -300,6 +328,7 @@ __rwsem_down_read_failed_common(struct rw_semaphore *sem, int state)
 	}
 
 	__set_current_state(TASK_RUNNING);
+	sched_ux_uninherit(ux_owner);
 	return sem;
 out_nolock:
 	list_del(&waiter.list);
@@ -307,6 +336,7 @@ __rwsem_down_read_failed_common(struct rw_semaphore *sem, int state)
 		atomic_long_add(-RWSEM_WAITING_BIAS, &sem->count);
 	raw_spin_unlock_irq(&sem->wait_lock);
 	__set_current_state(TASK_RUNNING);
+	sched_ux_uninherit(ux_owner);
 	return ERR_PTR(-EINTR);
 }
 
@@ -530,6 +560,7 @@ __rwsem_down_write_failed_common(struct rw_semaphore *sem, int state)
 	long count;
 	bool waiting = true; /* any queued threads before us */
 	struct rwsem_waiter waiter;
+	struct task_struct *ux_owner;
 	struct rw_semaphore *ret = sem;
 	DEFINE_WAKE_Q(wake_q);
 	bool is_first_waiter = false;
@@ -548,6 +579,8 @@ __rwsem_down_write_failed_common(struct rw_semaphore *sem, int state)
 	waiter.task = current;
 	waiter.type = RWSEM_WAITING_FOR_WRITE;
 
+	ux_owner = rwsem_ux_inherit(sem);
+
 	raw_spin_lock_irq(&sem->wait_lock);
 
 	/* account for this before adding a new element to the list */
@@ -622,11 +655,13 @@ __rwsem_down_write_failed_common(struct rw_semaphore *sem, int state)
 	__set_current_state(TASK_RUNNING);
 	list_del(&waiter.list);
 	raw_spin_unlock_irq(&sem->wait_lock);
+	sched_ux_uninherit(ux_owner);
 
 	return ret;
 
 out_nolock:
 	__set_current_state(TASK_RUNNING);
+	sched_ux_uninherit(ux_owner);
 	raw_spin_lock_irq(&sem->wait_lock);
 	list_del(&waiter.list);
 	if (list_empty(&sem->wait_list))
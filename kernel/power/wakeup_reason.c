@@ -27,6 +27,8 @@
 #include <linux/notifier.h>
 #include <linux/suspend.h>
 #include <linux/slab.h>
+#include <linux/string.h>
+#include <uapi/linux/wakeup_stats.h>
 
 /*
  * struct wakeup_irq_node - stores data and relationships for IRQs logged as
@@ -41,6 +43,19 @@ struct wakeup_irq_node {
 	const char *irq_name;
 };
 
+/*
+ * struct wakeup_irq_stats - resumes an IRQ took part in, for
+ * wakeup_reason_stats().
+ */
+struct wakeup_irq_stats {
+	int irq;
+	unsigned int resumes;
+	ktime_t last_resume;
+	char name[WAKEUP_STATS_NAME_LEN];
+};
+
+#define WAKEUP_IRQ_STATS_SIZE 32
+
 static DEFINE_SPINLOCK(wakeup_reason_lock);
 
 static LIST_HEAD(leaf_irqs);   /* kept in ascending IRQ sorted order */
@@ -62,6 +77,14 @@ static ktime_t curr_monotime; /* monotonic time after last suspend */
 static ktime_t last_stime; /* monotonic boottime offset before last suspend */
 static ktime_t curr_stime; /* monotonic boottime offset after last suspend */
 
+/* Protected by wakeup_reason_lock */
+static struct wakeup_irq_stats irq_stats[WAKEUP_IRQ_STATS_SIZE];
+static unsigned int nr_irq_stats;
+static unsigned int resumes;
+static unsigned int resumes_abnormal;
+static unsigned int resumes_unknown;
+static unsigned int suspend_aborts;
+
 static void init_node(struct wakeup_irq_node *p, int irq)
 {
 	struct irq_desc *desc;
@@ -249,6 +272,71 @@ void clear_wakeup_reasons(void)
 	spin_unlock_irqrestore(&wakeup_reason_lock, flags);
 }
 
+/* Account a resume to @n, replacing the least recently seen IRQ if full */
+static void account_wakeup_irq(struct wakeup_irq_node *n, ktime_t now)
+{
+	struct wakeup_irq_stats *s = NULL;
+	unsigned int i;
+
+	for (i = 0; i < nr_irq_stats; i++) {
+		if (irq_stats[i].irq == n->irq) {
+			s = &irq_stats[i];
+			break;
+		}
+	}
+
+	if (!s) {
+		if (nr_irq_stats < WAKEUP_IRQ_STATS_SIZE) {
+			s = &irq_stats[nr_irq_stats++];
+		} else {
+			s = &irq_stats[0];
+			for (i = 1; i < WAKEUP_IRQ_STATS_SIZE; i++)
+				if (irq_stats[i].last_resume < s->last_resume)
+					s = &irq_stats[i];
+		}
+		s->irq = n->irq;
+		s->resumes = 0;
+		strlcpy(s->name, n->irq_name, sizeof(s->name));
+	}
+
+	s->resumes++;
+	s->last_resume = now;
+}
+
+/**
+ * wakeup_reason_stats - Copy the resume counters and the IRQs behind them.
+ * @hdr: Header whose resume counters to fill in.
+ * @irqs: Array of @max records to fill with the wakeup IRQs seen so far.
+ * @max: Size of @irqs.
+ *
+ * Returns the number of records stored in @irqs.
+ */
+int wakeup_reason_stats(struct wakeup_stats_hdr *hdr,
+			struct wakeup_stats_irq *irqs, int max)
+{
+	unsigned long flags;
+	int i, nr;
+
+	spin_lock_irqsave(&wakeup_reason_lock, flags);
+
+	hdr->resumes = resumes;
+	hdr->resumes_abnormal = resumes_abnormal;
+	hdr->resumes_unknown = resumes_unknown;
+	hdr->suspend_aborts = suspend_aborts;
+
+	nr = min_t(int, nr_irq_stats, max);
+	for (i = 0; i < nr; i++) {
+		irqs[i].irq = irq_stats[i].irq;
+		irqs[i].resumes = irq_stats[i].resumes;
+		irqs[i].last_resume_ns = ktime_to_ns(irq_stats[i].last_resume);
+		memcpy(irqs[i].name, irq_stats[i].name, sizeof(irqs[i].name));
+	}
+
+	spin_unlock_irqrestore(&wakeup_reason_lock, flags);
+
+	return nr;
+}
+
 static void print_wakeup_sources(void)
 {
 	struct wakeup_irq_node *n;
@@ -259,19 +347,26 @@ static void print_wakeup_sources(void)
 	capture_reasons = false;
 
 	if (suspend_abort) {
+		suspend_aborts++;
 		pr_debug("Abort: %s\n", non_irq_wake_reason);
 		spin_unlock_irqrestore(&wakeup_reason_lock, flags);
 		return;
 	}
 
-	if (!list_empty(&leaf_irqs))
-		list_for_each_entry(n, &leaf_irqs, siblings)
+	resumes++;
+	if (!list_empty(&leaf_irqs)) {
+		list_for_each_entry(n, &leaf_irqs, siblings) {
 			pr_debug("Resume caused by IRQ %d, %s\n", n->irq,
 				n->irq_name);
-	else if (abnormal_wake)
+			account_wakeup_irq(n, curr_monotime);
+		}
+	} else if (abnormal_wake) {
+		resumes_abnormal++;
 		pr_debug("Resume caused by %s\n", non_irq_wake_reason);
-	else
+	} else {
+		resumes_unknown++;
 		pr_debug("Resume cause unknown\n");
+	}
 
 	spin_unlock_irqrestore(&wakeup_reason_lock, flags);
 }
@@ -48,6 +48,7 @@
 #include <linux/sched/clock.h>
 #include <linux/sched/debug.h>
 #include <linux/sched/task_stack.h>
+#include <linux/kthread.h>
 
 #include <linux/uaccess.h>
 #include <asm/sections.h>
@@ -1272,6 +1273,31 @@ static inline void boot_delay_msec(int level)
 static bool printk_time = IS_ENABLED(CONFIG_PRINTK_TIME);
 module_param_named(time, printk_time, bool, S_IRUGO | S_IWUSR);
 
+/*
+ * With console offloading, printk() only stores the record and the console
+ * drivers are run by the printk kthread, so a CPU logging a burst of
+ * messages never spins on console_sem or waits for a slow console. Oopses,
+ * panics and shutdown still print synchronously.
+ */
+static bool console_offload = IS_ENABLED(CONFIG_PRINTK_CONSOLE_OFFLOAD);
+module_param(console_offload, bool, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(console_offload, "Print to consoles from the printk kthread");
+
+static struct task_struct *printk_kthread;
+
+/* records left to the printk kthread, and records it never printed */
+static unsigned long console_deferred;
+module_param(console_deferred, ulong, S_IRUGO);
+static unsigned long console_dropped;
+module_param(console_dropped, ulong, S_IRUGO);
+
+static bool console_offloaded(void)
+{
+	return READ_ONCE(console_offload) && printk_kthread &&
+		!oops_in_progress && system_state == SYSTEM_RUNNING &&
+		atomic_read(&panic_cpu) == PANIC_CPU_INVALID;
+}
+
 static size_t print_time(u64 ts, char *buf)
 {
 	unsigned long rem_nsec;
@@ -1955,6 +1981,7 @@ asmlinkage int vprintk_emit(int facility, int level,
 {
 	int printed_len;
 	bool in_sched = false;
+	bool offload;
 	unsigned long flags;
 
 	if (level == LOGLEVEL_SCHED) {
@@ -1965,13 +1992,20 @@ asmlinkage int vprintk_emit(int facility, int level,
 	boot_delay_msec(level);
 	printk_delay();
 
+	offload = console_offloaded();
+
 	/* This stops the holder of console_sem just where we want him */
 	logbuf_lock_irqsave(flags);
 	printed_len = vprintk_store(facility, level, dict, dictlen, fmt, args);
+	if (offload)
+		console_deferred++;
 	logbuf_unlock_irqrestore(flags);
 
-	/* If called from the scheduler, we can not call up(). */
-	if (!in_sched) {
+	if (offload) {
+		/* The irq_work wakes the printk kthread from a safe context */
+		defer_console_output();
+	} else if (!in_sched) {
+		/* If called from the scheduler, we can not call up(). */
 		/*
 		 * Disable preemption to avoid being preempted while holding
 		 * console_sem which would prevent anyone from printing to
@@ -2076,6 +2110,7 @@ static u32 console_idx;
 static u64 log_first_seq;
 static u32 log_first_idx;
 static u64 log_next_seq;
+static unsigned long console_dropped;
 static char *log_text(const struct printk_log *msg) { return NULL; }
 static char *log_dict(const struct printk_log *msg) { return NULL; }
 static struct printk_log *log_from_idx(u32 idx) { return NULL; }
@@ -2426,6 +2461,7 @@ void console_unlock(void)
 		if (console_seq < log_first_seq) {
 			len = sprintf(text, "** %u printk messages dropped ** ",
 				      (unsigned)(log_first_seq - console_seq));
+			console_dropped += log_first_seq - console_seq;
 
 			/* messages are gone, move to first one */
 			console_seq = log_first_seq;
@@ -2942,8 +2978,10 @@ static void wake_up_klogd_work_func(struct irq_work *irq_work)
 	int pending = __this_cpu_xchg(printk_pending, 0);
 
 	if (pending & PRINTK_PENDING_OUTPUT) {
+		if (console_offloaded())
+			wake_up_process(printk_kthread);
 		/* If trylock fails, someone else is doing the printing */
-		if (console_trylock())
+		else if (console_trylock())
 			console_unlock();
 	}
 
@@ -2974,6 +3012,53 @@ void defer_console_output(void)
 	preempt_enable();
 }
 
+static bool console_output_pending(void)
+{
+	unsigned long flags;
+	bool pending;
+
+	/* resume_console() flushes whatever arrived while suspended */
+	if (console_suspended)
+		return false;
+
+	logbuf_lock_irqsave(flags);
+	pending = console_seq != log_next_seq;
+	logbuf_unlock_irqrestore(flags);
+
+	return pending;
+}
+
+static int printk_kthread_func(void *data)
+{
+	for (;;) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (!console_output_pending())
+			schedule();
+		__set_current_state(TASK_RUNNING);
+
+		/* console_lock() lets console_unlock() reschedule per line */
+		console_lock();
+		console_unlock();
+	}
+
+	return 0;
+}
+
+static int __init printk_kthread_init(void)
+{
+	struct task_struct *tsk;
+
+	tsk = kthread_run(printk_kthread_func, NULL, "printk");
+	if (IS_ERR(tsk)) {
+		pr_err("printk: unable to start console kthread\n");
+		return PTR_ERR(tsk);
+	}
+	printk_kthread = tsk;
+
+	return 0;
+}
+late_initcall(printk_kthread_init);
+
 int vprintk_deferred(const char *fmt, va_list args)
 {
 	int r;
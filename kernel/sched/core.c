@@ -2898,6 +2898,14 @@ static void __sched_fork(unsigned long clone_flags, struct task_struct *p)
 
 	INIT_LIST_HEAD(&p->se.group_node);
 
+#ifdef CONFIG_SCHED_UX
+	/* UX state is never inherited across fork */
+	p->ux_static			= false;
+	atomic_set(&p->ux_binder, 0);
+	atomic_set(&p->ux_depth, 0);
+	INIT_LIST_HEAD(&p->ux_entry);
+#endif
+
 #ifdef CONFIG_FAIR_GROUP_SCHED
 	p->se.cfs_rq			= NULL;
 #endif
@@ -7218,6 +7226,9 @@ void __init sched_init(void)
 #endif /* CONFIG_SMP */
 		init_rq_hrtick(rq);
 		atomic_set(&rq->nr_iowait, 0);
+#ifdef CONFIG_SCHED_UX
+		INIT_LIST_HEAD(&rq->ux_tasks);
+#endif
 	}
 
 	BUG_ON(alloc_related_thread_groups());
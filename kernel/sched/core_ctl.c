@@ -57,6 +57,12 @@ struct cluster_data {
 	unsigned int first_cpu;
 	unsigned int boost;
 	struct kobject kobj;
+	/* predictive mode, see compute_cluster_pred_need() */
+	bool predict;
+	unsigned int pred_need;
+	int prev_nrrun;
+	u64 nr_windows;
+	u64 nr_miss;
 };
 
 struct cpu_data {
@@ -287,6 +293,54 @@ static ssize_t show_enable(const struct cluster_data *state, char *buf)
 	return scnprintf(buf, PAGE_SIZE, "%u\n", state->enable);
 }
 
+static ssize_t store_predict(struct cluster_data *state,
+				const char *buf, size_t count)
+{
+	unsigned int val;
+	bool bval;
+
+	if (sscanf(buf, "%u\n", &val) != 1)
+		return -EINVAL;
+
+	bval = !!val;
+	if (bval != state->predict) {
+		state->predict = bval;
+		state->pred_need = 0;
+		apply_need(state);
+	}
+
+	return count;
+}
+
+static ssize_t show_predict(const struct cluster_data *state, char *buf)
+{
+	return scnprintf(buf, PAGE_SIZE, "%u\n", state->predict);
+}
+
+/* "<windows> <misses>", a write of 0 resets both */
+static ssize_t store_miss_stats(struct cluster_data *state,
+				const char *buf, size_t count)
+{
+	unsigned int val;
+	unsigned long flags;
+
+	if (sscanf(buf, "%u\n", &val) != 1 || val)
+		return -EINVAL;
+
+	spin_lock_irqsave(&state_lock, flags);
+	state->nr_windows = 0;
+	state->nr_miss = 0;
+	spin_unlock_irqrestore(&state_lock, flags);
+
+	return count;
+}
+
+static ssize_t show_miss_stats(const struct cluster_data *state, char *buf)
+{
+	return scnprintf(buf, PAGE_SIZE, "%llu %llu\n", state->nr_windows,
+			 state->nr_miss);
+}
+
 static ssize_t show_need_cpus(const struct cluster_data *state, char *buf)
 {
 	return snprintf(buf, PAGE_SIZE, "%u\n", state->need_cpus);
@@ -421,6 +475,8 @@ core_ctl_attr_ro(active_cpus);
 core_ctl_attr_ro(global_state);
 core_ctl_attr_rw(not_preferred);
 core_ctl_attr_rw(enable);
+core_ctl_attr_rw(predict);
+core_ctl_attr_rw(miss_stats);
 
 static struct attribute *default_attrs[] = {
 	&min_cpus.attr,
@@ -435,6 +491,8 @@ static struct attribute *default_attrs[] = {
 	&active_cpus.attr,
 	&global_state.attr,
 	&not_preferred.attr,
+	&predict.attr,
+	&miss_stats.attr,
 	NULL
 };
 
@@ -631,6 +689,69 @@ static int prev_cluster_nr_need_assist(int index)
 	return need;
 }
 
+/*
+ * pred_need:
+ *   CPUs this cluster is expected to need in the coming window.
+ *   The larger of two forecasts is used:
+ *
+ *   - the WALT predicted demand of the tasks queued on the cluster,
+ *     in units of one CPU loaded up to its busy_up_thres;
+ *   - the runnable task count projected one window ahead along its
+ *     trend, when that trend is rising.
+ *
+ *   eval_need() takes it as a floor, so cores are unisolated before
+ *   the load shows up in the busy averages.
+ */
+static unsigned int compute_cluster_pred_need(struct cluster_data *cluster)
+{
+	unsigned int thres_idx, thres, need, nr_need;
+	unsigned long cap = capacity_orig_of(cluster->first_cpu);
+	u64 pred = 0;
+	int cpu, trend;
+
+	for_each_cpu(cpu, &cluster->cpu_mask)
+		pred += READ_ONCE(cpu_rq(cpu)->walt_stats.pred_demands_sum_scaled);
+
+	thres_idx = cluster->active_cpus ? cluster->active_cpus - 1 : 0;
+	thres = cluster->busy_up_thres[thres_idx] ?: 100;
+	need = DIV_ROUND_UP_ULL(pred * 100, (u64)cap * thres);
+
+	trend = cluster->nrrun - cluster->prev_nrrun;
+	if (trend > 0) {
+		nr_need = cluster->nrrun + trend;
+		need = max(need, nr_need);
+	}
+
+	return min(need, cluster->num_cpus);
+}
+
+/*
+ * A window is a miss when the cluster kept cores isolated although the
+ * demand exceeded its active capacity: more runnable tasks than active
+ * CPUs, or every active CPU at or above busy_up_thres.
+ */
+static bool cluster_window_missed(struct cluster_data *cluster)
+{
+	unsigned int thres_idx, thres;
+	struct cpu_data *c;
+
+	if (!cluster->nr_isolated_cpus)
+		return false;
+
+	if (cluster->nrrun > cluster->active_cpus)
+		return true;
+
+	thres_idx = cluster->active_cpus ? cluster->active_cpus - 1 : 0;
+	thres = cluster->busy_up_thres[thres_idx];
+	list_for_each_entry(c, &cluster->lru, sib) {
+		if (cpu_online(c->cpu) && !cpu_isolated(c->cpu) &&
+		    c->busy < thres)
+			return false;
+	}
+
+	return true;
+}
+
 static void update_running_avg(void)
 {
 	struct cluster_data *cluster;
@@ -650,7 +771,7 @@ static void update_running_avg(void)
 		nr_need = compute_cluster_nr_need(index);
 		prev_misfit_need = compute_prev_cluster_misfit_need(index);
 
-
+		cluster->prev_nrrun = cluster->nrrun;
 		cluster->nrrun = nr_need + prev_misfit_need;
 		cluster->max_nr = compute_cluster_max_nr(index);
 		cluster->nr_prev_assist = prev_cluster_nr_need_assist(index);
@@ -660,6 +781,12 @@ static void update_running_avg(void)
 					cluster->nrrun, cluster->max_nr,
 					cluster->nr_prev_assist);
 
+		cluster->nr_windows++;
+		if (cluster_window_missed(cluster))
+			cluster->nr_miss++;
+		if (cluster->predict)
+			cluster->pred_need = compute_cluster_pred_need(cluster);
+
 		big_avg += cluster_real_big_tasks(index);
 	}
 	spin_unlock_irqrestore(&state_lock, flags);
@@ -759,6 +886,8 @@ static bool eval_need(struct cluster_data *cluster)
 			need_cpus += c->is_busy;
 		}
 		need_cpus = apply_task_need(cluster, need_cpus);
+		if (cluster->predict)
+			need_cpus = max(need_cpus, cluster->pred_need);
 	}
 	new_need = apply_limits(cluster, need_cpus);
 	need_flag = adjustment_possible(cluster, new_need);
@@ -21,6 +21,7 @@
 #include "sched.h"
 
 #define SUGOV_KTHREAD_PRIORITY	50
+#define SUGOV_LAT_BUCKETS	12
 
 struct sugov_tunables {
 	struct gov_attr_set attr_set;
@@ -29,6 +30,8 @@ struct sugov_tunables {
 	unsigned int hispeed_load;
 	unsigned int hispeed_freq;
 	bool pl;
+	bool auto_rate_limit;
+	unsigned int target_latency_us;
 };
 
 struct sugov_policy {
@@ -61,6 +64,15 @@ struct sugov_policy {
 	bool work_in_progress;
 
 	bool need_freq_update;
+
+	/* Rate limit learning, see sugov_tune_rate_limits() */
+	u64 change_pending_since;
+	u64 last_down_time;
+	u64 decision_lat_ns;
+	u64 work_queued_ns;
+	u64 resp_lat_ns;
+	u64 xfer_lat_ns;
+	unsigned long lat_hist[SUGOV_LAT_BUCKETS];
 };
 
 struct sugov_cpu {
@@ -154,6 +166,73 @@ static bool sugov_up_down_rate_limit(struct sugov_policy *sg_policy, u64 time,
 	return false;
 }
 
+/*
+ * Account one frequency change, from the first update asking for it to
+ * the new frequency being set. Buckets are log2 of the latency in usec.
+ */
+static void sugov_record_latency(struct sugov_policy *sg_policy,
+				 u64 decision_ns, u64 xfer_ns)
+{
+	u64 lat_ns = decision_ns + xfer_ns;
+	unsigned int bucket;
+
+	bucket = min_t(unsigned int, fls64(div64_u64(lat_ns, NSEC_PER_USEC)),
+		       SUGOV_LAT_BUCKETS - 1);
+	sg_policy->lat_hist[bucket]++;
+
+	/* 1/8 weight for the newest sample */
+	sg_policy->resp_lat_ns = sg_policy->resp_lat_ns -
+				 (sg_policy->resp_lat_ns >> 3) + (lat_ns >> 3);
+	sg_policy->xfer_lat_ns = sg_policy->xfer_lat_ns -
+				 (sg_policy->xfer_lat_ns >> 3) + (xfer_ns >> 3);
+}
+
+/*
+ * With auto_rate_limit the configured rate limits become ceilings and the
+ * effective ones are learned per policy. Frequency changes shouldn't be
+ * requested faster than a few times the transition cost. Ramp-ups are
+ * let through sooner while the response latency misses target_latency_us
+ * and relaxed again once it is comfortably met. A ramp-down followed by a
+ * ramp-up shortly after means the drop was premature, so the down limit
+ * grows on such bounces and slowly decays otherwise.
+ */
+static void sugov_tune_rate_limits(struct sugov_policy *sg_policy, u64 time,
+				   unsigned int next_freq)
+{
+	struct sugov_tunables *tunables = sg_policy->tunables;
+	s64 up = sg_policy->up_rate_delay_ns;
+	s64 down = sg_policy->down_rate_delay_ns;
+	s64 up_max = tunables->up_rate_limit_us * NSEC_PER_USEC;
+	s64 down_max = tunables->down_rate_limit_us * NSEC_PER_USEC;
+	u64 target = tunables->target_latency_us * NSEC_PER_USEC;
+	s64 floor;
+
+	if (!tunables->auto_rate_limit || sg_policy->next_freq == UINT_MAX)
+		return;
+
+	floor = max_t(s64, 4 * sg_policy->xfer_lat_ns,
+		      sg_policy->policy->cpuinfo.transition_latency);
+
+	if (next_freq > sg_policy->next_freq) {
+		if (sg_policy->resp_lat_ns > target)
+			up -= up >> 3;
+		else if (sg_policy->resp_lat_ns < target / 2)
+			up += (up >> 3) + NSEC_PER_USEC;
+
+		if (time - sg_policy->last_down_time < 2 * down)
+			down += (down >> 3) + NSEC_PER_USEC;
+	} else {
+		down -= down >> 4;
+		sg_policy->last_down_time = time;
+	}
+
+	sg_policy->up_rate_delay_ns = clamp(up, min(floor, up_max), up_max);
+	sg_policy->down_rate_delay_ns = clamp(down, min(floor, down_max),
+					      down_max);
+	sg_policy->min_rate_limit_ns = min(sg_policy->up_rate_delay_ns,
+					   sg_policy->down_rate_delay_ns);
+}
+
 static inline bool use_pelt(void)
 {
 #ifdef CONFIG_SCHED_WALT
@@ -221,9 +300,15 @@ static void sugov_update_commit(struct sugov_policy *sg_policy, u64 time,
 				unsigned int next_freq)
 {
 	struct cpufreq_policy *policy = sg_policy->policy;
+	u64 start;
 
-	if (sg_policy->next_freq == next_freq)
+	if (sg_policy->next_freq == next_freq) {
+		sg_policy->change_pending_since = 0;
 		return;
+	}
+
+	if (!sg_policy->change_pending_since)
+		sg_policy->change_pending_since = time;
 
 	if (sugov_up_down_rate_limit(sg_policy, time, next_freq)) {
 		/* Don't cache a raw freq that didn't become next_freq */
@@ -231,19 +316,27 @@ static void sugov_update_commit(struct sugov_policy *sg_policy, u64 time,
 		return;
 	}
 
+	sugov_tune_rate_limits(sg_policy, time, next_freq);
+	sg_policy->decision_lat_ns = time - sg_policy->change_pending_since;
+	sg_policy->change_pending_since = 0;
+
 	sg_policy->next_freq = next_freq;
 	sg_policy->last_freq_update_time = time;
 
 	if (policy->fast_switch_enabled) {
 		sugov_track_cycles(sg_policy, sg_policy->policy->cur, time);
+		start = ktime_get_ns();
 		next_freq = cpufreq_driver_fast_switch(policy, next_freq);
 		if (!next_freq)
 			return;
 
 		policy->cur = next_freq;
+		sugov_record_latency(sg_policy, sg_policy->decision_lat_ns,
+				     ktime_get_ns() - start);
 	} else {
 		if (use_pelt())
 			sg_policy->work_in_progress = true;
+		sg_policy->work_queued_ns = ktime_get_ns();
 		sched_irq_work_queue(&sg_policy->irq_work);
 	}
 }
@@ -590,6 +683,12 @@ static void sugov_work(struct kthread_work *work)
 	raw_spin_unlock_irqrestore(&sg_policy->update_lock, flags);
 	__cpufreq_driver_target(sg_policy->policy, sg_policy->next_freq,
 				CPUFREQ_RELATION_L);
+
+	/* The kthread wakeup is part of the latency on this path */
+	raw_spin_lock_irqsave(&sg_policy->update_lock, flags);
+	sugov_record_latency(sg_policy, sg_policy->decision_lat_ns,
+			     ktime_get_ns() - sg_policy->work_queued_ns);
+	raw_spin_unlock_irqrestore(&sg_policy->update_lock, flags);
 	mutex_unlock(&sg_policy->work_lock);
 
 	if (use_pelt())
@@ -768,11 +867,105 @@ static ssize_t pl_store(struct gov_attr_set *attr_set, const char *buf,
 	return count;
 }
 
+static ssize_t auto_rate_limit_show(struct gov_attr_set *attr_set, char *buf)
+{
+	struct sugov_tunables *tunables = to_sugov_tunables(attr_set);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n", tunables->auto_rate_limit);
+}
+
+static ssize_t auto_rate_limit_store(struct gov_attr_set *attr_set,
+				     const char *buf, size_t count)
+{
+	struct sugov_tunables *tunables = to_sugov_tunables(attr_set);
+	struct sugov_policy *sg_policy;
+	bool enable;
+
+	if (kstrtobool(buf, &enable))
+		return -EINVAL;
+
+	tunables->auto_rate_limit = enable;
+
+	/* Learning starts from, and falls back to, the configured limits */
+	list_for_each_entry(sg_policy, &attr_set->policy_list, tunables_hook) {
+		sg_policy->up_rate_delay_ns =
+			tunables->up_rate_limit_us * NSEC_PER_USEC;
+		sg_policy->down_rate_delay_ns =
+			tunables->down_rate_limit_us * NSEC_PER_USEC;
+		update_min_rate_limit_ns(sg_policy);
+	}
+
+	return count;
+}
+
+static ssize_t target_latency_us_show(struct gov_attr_set *attr_set,
+				      char *buf)
+{
+	struct sugov_tunables *tunables = to_sugov_tunables(attr_set);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n", tunables->target_latency_us);
+}
+
+static ssize_t target_latency_us_store(struct gov_attr_set *attr_set,
+				       const char *buf, size_t count)
+{
+	struct sugov_tunables *tunables = to_sugov_tunables(attr_set);
+	unsigned int val;
+
+	if (kstrtouint(buf, 10, &val) || !val)
+		return -EINVAL;
+
+	tunables->target_latency_us = val;
+
+	return count;
+}
+
+/*
+ * One line per policy: the policy's first CPU, the learned up and down
+ * rate limits in usec, then the freq change latency histogram where
+ * bucket i counts changes that took [2^(i-1), 2^i) usec.
+ */
+static ssize_t freq_change_latency_show(struct gov_attr_set *attr_set,
+					char *buf)
+{
+	struct sugov_policy *sg_policy;
+	ssize_t cnt = 0;
+	int i;
+
+	list_for_each_entry(sg_policy, &attr_set->policy_list, tunables_hook) {
+		cnt += scnprintf(buf + cnt, PAGE_SIZE - cnt, "%u: %lld %lld",
+				 sg_policy->policy->cpu,
+				 sg_policy->up_rate_delay_ns / NSEC_PER_USEC,
+				 sg_policy->down_rate_delay_ns / NSEC_PER_USEC);
+		for (i = 0; i < SUGOV_LAT_BUCKETS; i++)
+			cnt += scnprintf(buf + cnt, PAGE_SIZE - cnt, " %lu",
+					 READ_ONCE(sg_policy->lat_hist[i]));
+		cnt += scnprintf(buf + cnt, PAGE_SIZE - cnt, "\n");
+	}
+
+	return cnt;
+}
+
+static ssize_t freq_change_latency_store(struct gov_attr_set *attr_set,
+					 const char *buf, size_t count)
+{
+	struct sugov_policy *sg_policy;
+
+	list_for_each_entry(sg_policy, &attr_set->policy_list, tunables_hook)
+		memset(sg_policy->lat_hist, 0, sizeof(sg_policy->lat_hist));
+
+	return count;
+}
+
 static struct governor_attr up_rate_limit_us = __ATTR_RW(up_rate_limit_us);
 static struct governor_attr down_rate_limit_us = __ATTR_RW(down_rate_limit_us);
 static struct governor_attr hispeed_load = __ATTR_RW(hispeed_load);
 static struct governor_attr hispeed_freq = __ATTR_RW(hispeed_freq);
 static struct governor_attr pl = __ATTR_RW(pl);
+static struct governor_attr auto_rate_limit = __ATTR_RW(auto_rate_limit);
+static struct governor_attr target_latency_us = __ATTR_RW(target_latency_us);
+static struct governor_attr freq_change_latency =
+					__ATTR_RW(freq_change_latency);
 
 static struct attribute *sugov_attributes[] = {
 	&up_rate_limit_us.attr,
@@ -780,6 +973,9 @@ static struct attribute *sugov_attributes[] = {
 	&hispeed_load.attr,
 	&hispeed_freq.attr,
 	&pl.attr,
+	&auto_rate_limit.attr,
+	&target_latency_us.attr,
+	&freq_change_latency.attr,
 	NULL
 };
 
@@ -904,6 +1100,8 @@ static void sugov_tunables_restore(struct cpufreq_policy *policy)
 	tunables->hispeed_freq = cached->hispeed_freq;
 	tunables->up_rate_limit_us = cached->up_rate_limit_us;
 	tunables->down_rate_limit_us = cached->down_rate_limit_us;
+	tunables->auto_rate_limit = cached->auto_rate_limit;
+	tunables->target_latency_us = cached->target_latency_us;
 	update_min_rate_limit_ns(sg_policy);
 }
 
@@ -953,6 +1151,8 @@ static int sugov_init(struct cpufreq_policy *policy)
 				CONFIG_SCHEDUTIL_UP_RATE_LIMIT;
 	tunables->down_rate_limit_us =
 				CONFIG_SCHEDUTIL_DOWN_RATE_LIMIT;
+	/* Have a new frequency in effect within half a window by default */
+	tunables->target_latency_us = sched_ravg_window / (2 * NSEC_PER_USEC);
 #ifdef CONFIG_SCHED_KAIR_GLUE
 	tunables->fb_legacy = true;
 #endif
@@ -1026,6 +1226,10 @@ static int sugov_start(struct cpufreq_policy *policy)
 	sg_policy->work_in_progress = false;
 	sg_policy->need_freq_update = false;
 	sg_policy->cached_raw_freq = 0;
+	sg_policy->change_pending_since = 0;
+	sg_policy->last_down_time = 0;
+	sg_policy->resp_lat_ns = 0;
+	sg_policy->xfer_lat_ns = 0;
 	for_each_cpu(cpu, policy->cpus) {
 		struct sugov_cpu *sg_cpu = &per_cpu(sugov_cpu, cpu);
 
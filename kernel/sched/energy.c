@@ -27,6 +27,8 @@
 #include <linux/stddef.h>
 #include <linux/arch_topology.h>
 #include <linux/cpu.h>
+#include <linux/cpufreq.h>
+#include <linux/mutex.h>
 #include <linux/pm_opp.h>
 #include <linux/platform_device.h>
 
@@ -52,6 +54,56 @@ static void free_resources(void)
 }
 static bool sge_ready;
 
+/*
+ * Current cpufreq policy->max of each CPU. Thermal mitigation lands here
+ * as well since it is applied through the policy limits.
+ */
+static unsigned long sge_max_freq[NR_CPUS] = {
+	[0 ... NR_CPUS - 1] = ULONG_MAX,
+};
+static DEFINE_MUTEX(sge_lut_mutex);
+
+/*
+ * Rebuild the utilization to capacity state lookup of @sge. The wakeup
+ * path reads it locklessly, so every entry written has to be a valid
+ * index on its own.
+ */
+static void sge_build_cap_lut(struct sched_group_energy *sge,
+			      unsigned long max_freq)
+{
+	int i, idx = 0, max_idx = sge->nr_cap_states - 1;
+
+	while (max_idx > 0 && sge->cap_states[max_idx].frequency > max_freq)
+		max_idx--;
+
+	for (i = 0; i < SGE_CAP_LUT_SIZE; i++) {
+		unsigned long util = i << SGE_CAP_LUT_SHIFT;
+
+		while (idx < max_idx && sge->cap_states[idx].cap < util)
+			idx++;
+		WRITE_ONCE(sge->cap_lut[i], min_t(int, idx, U8_MAX));
+	}
+
+	WRITE_ONCE(sge->max_cap_idx, max_idx);
+}
+
+static void sched_energy_update_lut(const struct cpumask *cpus)
+{
+	struct sched_group_energy *sge;
+	int cpu, sd_level;
+
+	mutex_lock(&sge_lut_mutex);
+	for_each_cpu(cpu, cpus) {
+		for_each_possible_sd_level(sd_level) {
+			sge = sge_array[cpu][sd_level];
+			if (!sge)
+				break;
+			sge_build_cap_lut(sge, sge_max_freq[cpu]);
+		}
+	}
+	mutex_unlock(&sge_lut_mutex);
+}
+
 void check_max_cap_vs_cpu_scale(int cpu, struct sched_group_energy *sge)
 {
 	unsigned long max_cap, cpu_scale;
@@ -124,6 +176,7 @@ void init_sched_energy_costs(void)
 
 			sge->nr_cap_states = nstates;
 			sge->cap_states = cap_states;
+			sge_build_cap_lut(sge, ULONG_MAX);
 
 			prop = of_find_property(cp, "idle-cost-data", NULL);
 			if (!prop || !prop->value) {
@@ -290,6 +343,7 @@ static int sched_energy_probe(struct platform_device *pdev)
 
 	kfree(max_frequencies);
 
+	sched_energy_update_lut(cpu_possible_mask);
 	walt_map_freq_to_load();
 
 	dev_info(&pdev->dev, "Sched-energy-costs capacity updated\n");
@@ -318,8 +372,41 @@ static struct platform_driver energy_driver = {
 	.probe = sched_energy_probe,
 };
 
+static int sched_energy_policy_notifier(struct notifier_block *nb,
+					unsigned long val, void *data)
+{
+	struct cpufreq_policy *policy = data;
+	bool changed = false;
+	int cpu;
+
+	if (val != CPUFREQ_NOTIFY || !sge_ready)
+		return NOTIFY_DONE;
+
+	for_each_cpu(cpu, policy->related_cpus) {
+		if (sge_max_freq[cpu] != policy->max)
+			changed = true;
+		sge_max_freq[cpu] = policy->max;
+	}
+
+	if (changed)
+		sched_energy_update_lut(policy->related_cpus);
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block sched_energy_policy_nb = {
+	.notifier_call = sched_energy_policy_notifier,
+};
+
 static int __init sched_energy_init(void)
 {
+	int ret;
+
+	ret = cpufreq_register_notifier(&sched_energy_policy_nb,
+					CPUFREQ_POLICY_NOTIFIER);
+	if (ret)
+		pr_warn("cpufreq notifier registration failed: %d\n", ret);
+
 	return platform_driver_register(&energy_driver);
 }
 subsys_initcall(sched_energy_init);
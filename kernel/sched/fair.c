@@ -23,6 +23,7 @@
 
 #include <linux/sched/mm.h>
 #include <linux/sched/topology.h>
+#include <linux/sched/ux.h>
 
 #include <linux/latencytop.h>
 #include <linux/cpumask.h>
@@ -5429,6 +5430,11 @@ enqueue_task_fair(struct rq *rq, struct task_struct *p, int flags)
 			update_overutilized_status(rq);
 	}
 
+#ifdef CONFIG_SCHED_UX
+	if (task_is_ux(p) && list_empty(&p->ux_entry))
+		list_add_tail(&p->ux_entry, &rq->ux_tasks);
+#endif
+
 	hrtick_update(rq);
 }
 
@@ -5500,6 +5506,10 @@ static void dequeue_task_fair(struct rq *rq, struct task_struct *p, int flags)
 		dec_rq_walt_stats(rq, p);
 	}
 
+#ifdef CONFIG_SCHED_UX
+	list_del_init(&p->ux_entry);
+#endif
+
 	util_est_dequeue(&rq->cfs, p, task_sleep);
 	hrtick_update(rq);
 }
@@ -6212,16 +6222,20 @@ static int find_new_capacity(struct energy_env *eenv, int cpu_idx)
 {
 	const struct sched_group_energy *sge = eenv->sg_cap->sge;
 	unsigned long util = group_max_util(eenv, cpu_idx);
-	int idx, cap_idx;
-
-	cap_idx = sge->nr_cap_states - 1;
+	int max_idx = READ_ONCE(sge->max_cap_idx);
+	int cap_idx = max_idx;
 
-	for (idx = 0; idx < sge->nr_cap_states; idx++) {
-		if (sge->cap_states[idx].cap >= util) {
-			cap_idx = idx;
-			break;
-		}
+	/*
+	 * The lookup gives the first state covering the start of util's
+	 * bucket, at most a couple of states short of the one we want.
+	 */
+	if (util < SCHED_CAPACITY_SCALE) {
+		cap_idx = READ_ONCE(sge->cap_lut[util >> SGE_CAP_LUT_SHIFT]);
+		cap_idx = min(cap_idx, max_idx);
+		while (cap_idx < max_idx && sge->cap_states[cap_idx].cap < util)
+			cap_idx++;
 	}
+
 	/* Keep track of SG's capacity */
 	eenv->cpu[cpu_idx].cap = sge->cap_states[cap_idx].cap;
 	eenv->cpu[cpu_idx].cap_idx = cap_idx;
@@ -6860,9 +6874,9 @@ boosted_cpu_util(int cpu, struct sched_walt_cpu_load *walt_load)
 	trace_sched_boost_cpu(cpu, util, margin);
 
 	if (sched_feat(SCHEDTUNE_BOOST_UTIL))
-		return util + margin;
-	else
-		return util;
+		util += margin;
+
+	return schedtune_cpu_util_clamp(cpu, util);
 }
 
 static inline unsigned long
@@ -6874,9 +6888,9 @@ boosted_task_util(struct task_struct *task)
 	trace_sched_boost_task(task, util, margin);
 
 	if (sched_feat(SCHEDTUNE_BOOST_UTIL))
-		return util + margin;
-	else
-		return util;
+		util += margin;
+
+	return schedtune_task_util_clamp(task, util);
 #endif
 }
 
@@ -8739,6 +8753,32 @@ static void set_next_buddy(struct sched_entity *se)
 	}
 }
 
+#ifdef CONFIG_SCHED_UX
+/*
+ * Nominate the oldest queued UX task as the next buddy. pick_next_entity()
+ * still refuses a buddy that is too far ahead of the leftmost entity, so
+ * UX tasks cannot starve the rest of the runqueue.
+ */
+static void ux_pick_buddy(struct rq *rq)
+{
+	struct task_struct *p, *n;
+
+	list_for_each_entry_safe(p, n, &rq->ux_tasks, ux_entry) {
+		/* Inheritance ended since the task was queued */
+		if (!task_is_ux(p)) {
+			list_del_init(&p->ux_entry);
+			continue;
+		}
+
+		if (throttled_hierarchy(cfs_rq_of(&p->se)))
+			continue;
+
+		set_next_buddy(&p->se);
+		return;
+	}
+}
+#endif
+
 static void set_skip_buddy(struct sched_entity *se)
 {
 	for_each_sched_entity(se)
@@ -8798,6 +8838,13 @@ static void check_preempt_wakeup(struct rq *rq, struct task_struct *p, int wake_
 	if (unlikely(p->policy != SCHED_NORMAL) || !sched_feat(WAKEUP_PREEMPTION))
 		return;
 
+	/* A waking UX task preempts a non-UX one outright */
+	if (task_is_ux(p) && !task_is_ux(curr)) {
+		if (!next_buddy_marked)
+			set_next_buddy(pse);
+		goto preempt;
+	}
+
 	find_matching_se(&se, &pse);
 	update_curr(cfs_rq_of(se));
 	BUG_ON(!pse);
@@ -8843,6 +8890,11 @@ pick_next_task_fair(struct rq *rq, struct task_struct *prev, struct rq_flags *rf
 	if (!cfs_rq->nr_running)
 		goto idle;
 
+#ifdef CONFIG_SCHED_UX
+	if (!list_empty(&rq->ux_tasks))
+		ux_pick_buddy(rq);
+#endif
+
 #ifdef CONFIG_FAIR_GROUP_SCHED
 	if (prev->sched_class != &fair_sched_class)
 		goto simple;
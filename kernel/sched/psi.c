@@ -166,7 +166,7 @@ __setup("psi=", setup_psi);
 #define EXP_300s	2034		/* 1/exp(2s/300s) */
 
 /* PSI trigger definitions */
-#define WINDOW_MIN_US 500000	/* Min window size is 500ms */
+#define WINDOW_MIN_US (CONFIG_PSI_WINDOW_MIN_MS * USEC_PER_MSEC)
 #define WINDOW_MAX_US 10000000	/* Max window size is 10s */
 #define UPDATES_PER_WINDOW 10	/* 10 updates per window */
 
@@ -562,8 +562,13 @@ static void psi_schedule_poll_work(struct psi_group *group, unsigned long delay)
 {
 	struct kthread_worker *kworker;
 
-	/* Do not reschedule if already scheduled */
-	if (atomic_cmpxchg(&group->poll_scheduled, 0, 1) != 0)
+	/*
+	 * Do not reschedule if already scheduled. While the monitor is
+	 * active it keeps itself scheduled, so check with a plain read
+	 * first to spare the hotpath a write to the shared cacheline.
+	 */
+	if (atomic_read(&group->poll_scheduled) ||
+	    atomic_cmpxchg(&group->poll_scheduled, 0, 1) != 0)
 		return;
 
 	rcu_read_lock();
@@ -1084,6 +1089,15 @@ struct psi_trigger *psi_trigger_create(struct psi_group *group,
 	return t;
 }
 
+/*
+ * In-kernel consumers (e.g. Simple LMK) have no cgroup or proc file to attach
+ * their trigger to, so let them watch the system-wide group directly.
+ */
+struct psi_trigger *psi_system_trigger_create(char *buf, enum psi_res res)
+{
+	return psi_trigger_create(&psi_system, buf, strlen(buf) + 1, res);
+}
+
 static void psi_trigger_destroy(struct kref *ref)
 {
 	struct psi_trigger *t = container_of(ref, struct psi_trigger, refcount);
@@ -16,6 +16,12 @@
 int sched_rr_timeslice = RR_TIMESLICE;
 int sysctl_sched_rr_timeslice = (MSEC_PER_SEC / HZ) * RR_TIMESLICE;
 
+/*
+ * Idle exit latency (in us) above which an idle CPU is a poor wakeup
+ * target for an RT task. 0 disables the check.
+ */
+unsigned int sysctl_sched_rt_wakeup_latency_us = 100;
+
 static int do_sched_rt_period_timer(struct rt_bandwidth *rt_b, int overrun);
 
 struct rt_bandwidth def_rt_bandwidth;
@@ -1769,6 +1775,35 @@ static struct task_struct *pick_highest_pushable_task(struct rq *rq, int cpu)
 
 static DEFINE_PER_CPU(cpumask_var_t, local_cpu_mask);
 
+/*
+ * How well @cpu fits a waking RT task, lower is better:
+ *
+ *   0 - the task fits at the current frequency
+ *   1 - the CPU has to ramp its frequency up to serve the task
+ *   2 - the CPU sits in an idle state slower to exit than
+ *       sysctl_sched_rt_wakeup_latency_us
+ *
+ * Priority alone does not tell an audio thread that the cheapest CPU is
+ * power collapsed, so prefer a shallow or already running CPU over the
+ * least loaded one.
+ */
+static inline int rt_cpu_rank(int cpu, unsigned long tutil)
+{
+	struct cpuidle_state *idle;
+	unsigned int limit = sysctl_sched_rt_wakeup_latency_us;
+
+	if (limit && idle_cpu(cpu)) {
+		idle = idle_get_state(cpu_rq(cpu));
+		if (idle && idle->exit_latency > limit)
+			return 2;
+	}
+
+	if (cpu_util(cpu) + tutil > capacity_curr_of(cpu))
+		return 1;
+
+	return 0;
+}
+
 static int rt_energy_aware_wake_cpu(struct task_struct *task)
 {
 	struct sched_domain *sd;
@@ -1782,6 +1817,7 @@ static int rt_energy_aware_wake_cpu(struct task_struct *task)
 	unsigned long tutil = task_util(task);
 	int best_cpu_idle_idx = INT_MAX;
 	int cpu_idle_idx = -1, start_cpu;
+	int rank, best_rank = INT_MAX;
 	bool boost_on_big = sched_boost() == FULL_THROTTLE_BOOST ?
 				  (sched_boost_policy() == SCHED_BOOST_ON_BIG) :
 				  false;
@@ -1806,7 +1842,11 @@ static int rt_energy_aware_wake_cpu(struct task_struct *task)
 			if (is_min_capacity_cpu(fcpu))
 				continue;
 		} else {
-			if (capacity_orig > best_capacity)
+			/*
+			 * A bigger cluster is only worth a look while the
+			 * best candidate so far is a poor fit.
+			 */
+			if (capacity_orig > best_capacity && !best_rank)
 				continue;
 		}
 
@@ -1822,6 +1862,24 @@ static int rt_energy_aware_wake_cpu(struct task_struct *task)
 			if (__cpu_overutilized(cpu, tutil))
 				continue;
 
+			rank = rt_cpu_rank(cpu, tutil);
+			if (rank > best_rank)
+				continue;
+
+			/* Don't move up a cluster for anything but a better fit */
+			if (!boost_on_big && capacity_orig > best_capacity &&
+			    rank == best_rank)
+				continue;
+
+			if (sysctl_sched_cstate_aware)
+				cpu_idle_idx = idle_get_state_idx(cpu_rq(cpu));
+
+			util_cum = cpu_util_cum(cpu, 0);
+
+			/* A better fit wins regardless of load */
+			if (rank < best_rank)
+				goto found;
+
 			/* Find the least loaded CPU */
 			if (util > best_cpu_util)
 				continue;
@@ -1840,10 +1898,6 @@ static int rt_energy_aware_wake_cpu(struct task_struct *task)
 			 * conditions are same, select the least cumulative
 			 * window demand CPU.
 			 */
-			if (sysctl_sched_cstate_aware)
-				cpu_idle_idx = idle_get_state_idx(cpu_rq(cpu));
-
-			util_cum = cpu_util_cum(cpu, 0);
 			if (cpu != task_cpu(task) && best_cpu_util == util) {
 				if (best_cpu_idle_idx < cpu_idle_idx)
 					continue;
@@ -1852,7 +1906,8 @@ static int rt_energy_aware_wake_cpu(struct task_struct *task)
 						best_cpu_util_cum < util_cum)
 					continue;
 			}
-
+found:
+			best_rank = rank;
 			best_cpu_idle_idx = cpu_idle_idx;
 			best_cpu_util_cum = util_cum;
 			best_cpu_util = util;
@@ -849,6 +849,11 @@ struct rq {
 
 	atomic_t nr_iowait;
 
+#ifdef CONFIG_SCHED_UX
+	/* queued CFS tasks that were UX when enqueued */
+	struct list_head ux_tasks;
+#endif
+
 #ifdef CONFIG_SMP
 	struct root_domain *rd;
 	struct sched_domain *sd;
@@ -916,6 +921,11 @@ struct rq {
 	bool notif_pending;
 	u64 last_cc_update;
 	u64 cycles;
+	u64 hint_demands_sum_scaled;
+	/* published at rollover, read locklessly by cluster aggregation */
+	seqcount_t walt_snap_seq;
+	u64 walt_snap_ws;
+	u64 walt_snap_grp_prs;
 #endif /* CONFIG_SCHED_WALT */
 
 #ifdef CONFIG_IRQ_TIME_ACCOUNTING
@@ -142,6 +142,12 @@ static inline void psi_task_tick(struct rq *rq) {}
 #endif /* CONFIG_PSI */
 
 #ifdef CONFIG_SCHED_INFO
+#ifdef CONFIG_SCHED_TUNE
+void schedtune_account_wait(struct task_struct *p, u64 delta);
+#else
+static inline void schedtune_account_wait(struct task_struct *p, u64 delta) {}
+#endif
+
 static inline void sched_info_reset_dequeued(struct task_struct *t)
 {
 	t->sched_info.last_queued = 0;
@@ -183,6 +189,7 @@ static void sched_info_arrive(struct rq *rq, struct task_struct *t)
 	t->sched_info.pcount++;
 
 	rq_sched_info_arrive(rq, delta);
+	schedtune_account_wait(t, delta);
 }
 
 /*
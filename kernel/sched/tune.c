@@ -57,6 +57,17 @@ struct schedtune {
 	/* Hint to bias scheduling of tasks on that SchedTune CGroup
 	 * towards idle CPUs */
 	int prefer_idle;
+
+	/*
+	 * Utilization clamps for tasks on that SchedTune CGroup, applied
+	 * on top of the boosted utilization in task placement and, through
+	 * the per-CPU aggregate below, in frequency selection.
+	 */
+	int util_min;
+	int util_max;
+
+	/* Set for the Android "top-app" group, used for block I/O priority */
+	bool top_app;
 };
 
 static inline struct schedtune *css_st(struct cgroup_subsys_state *css)
@@ -93,6 +104,8 @@ root_schedtune = {
 	.colocate_update_disabled = false,
 #endif
 	.prefer_idle = 0,
+	.util_min = 0,
+	.util_max = SCHED_CAPACITY_SCALE,
 };
 
 /*
@@ -127,9 +140,15 @@ struct boost_groups {
 	bool idle;
 	int boost_max;
 	u64 boost_ts;
+	/* Utilization clamps of all RUNNABLE tasks on a CPU */
+	int util_min;
+	int util_max;
 	struct {
 		/* The boost for tasks on that boost group */
 		int boost;
+		/* The utilization clamps for tasks on that boost group */
+		int util_min;
+		int util_max;
 		/* Count of RUNNABLE tasks on that boost group */
 		unsigned tasks;
 		/* Timestamp of boost activation */
@@ -142,6 +161,94 @@ struct boost_groups {
 /* Boost groups affecting each CPU in the system */
 DEFINE_PER_CPU(struct boost_groups, cpu_boost_groups);
 
+/*
+ * Runnable to running latency of the tasks of each boost group. Bucket 0
+ * counts waits shorter than 2^SCHEDTUNE_WAIT_SHIFT ns (~65us), bucket i
+ * those in [2^(i-1), 2^i) times that, and the last one everything longer.
+ */
+#define SCHEDTUNE_WAIT_SHIFT	16
+#define SCHEDTUNE_WAIT_BUCKETS	12
+
+struct wait_hist {
+	u64 count[BOOSTGROUPS_COUNT][SCHEDTUNE_WAIT_BUCKETS];
+	u64 wait_sum[BOOSTGROUPS_COUNT];
+};
+
+static DEFINE_PER_CPU(struct wait_hist, cpu_wait_hist);
+
+/* Called from sched_info_arrive() when @p gets the CPU after @delta ns */
+void schedtune_account_wait(struct task_struct *p, u64 delta)
+{
+	struct wait_hist *wh = this_cpu_ptr(&cpu_wait_hist);
+	int bucket, idx;
+
+	if (unlikely(!schedtune_initialized))
+		return;
+
+	rcu_read_lock();
+	idx = task_schedtune(p)->idx;
+	rcu_read_unlock();
+
+	bucket = min(fls64(delta >> SCHEDTUNE_WAIT_SHIFT),
+		     SCHEDTUNE_WAIT_BUCKETS - 1);
+	wh->count[idx][bucket]++;
+	wh->wait_sum[idx] += delta;
+}
+
+static void schedtune_wait_hist_show_one(struct seq_file *sf,
+					 struct schedtune *st)
+{
+	u64 count[SCHEDTUNE_WAIT_BUCKETS] = { };
+	char name_buf[NAME_MAX + 1];
+	struct wait_hist *wh;
+	u64 wait_sum = 0;
+	int cpu, i;
+
+	for_each_possible_cpu(cpu) {
+		wh = &per_cpu(cpu_wait_hist, cpu);
+		for (i = 0; i < SCHEDTUNE_WAIT_BUCKETS; i++)
+			count[i] += READ_ONCE(wh->count[st->idx][i]);
+		wait_sum += READ_ONCE(wh->wait_sum[st->idx]);
+	}
+
+	if (st == &root_schedtune)
+		strlcpy(name_buf, "/", sizeof(name_buf));
+	else
+		cgroup_name(st->css.cgroup, name_buf, sizeof(name_buf));
+
+	seq_printf(sf, "%-16s", name_buf);
+	for (i = 0; i < SCHEDTUNE_WAIT_BUCKETS; i++)
+		seq_printf(sf, " %llu", count[i]);
+	seq_printf(sf, " %llu\n", div_u64(wait_sum, NSEC_PER_USEC));
+}
+
+/*
+ * All the boost groups in one read: a header with the upper bound of each
+ * bucket in us, then one line per group with its counts and the total
+ * wait in us. Counters are cumulative since the group was created.
+ */
+static int schedtune_wait_hist_show(struct seq_file *sf, void *v)
+{
+	struct cgroup_subsys_state *css;
+	int i;
+
+	seq_printf(sf, "%-16s", "group");
+	for (i = 0; i < SCHEDTUNE_WAIT_BUCKETS - 1; i++)
+		seq_printf(sf, " %llu",
+			   div_u64(1ULL << (SCHEDTUNE_WAIT_SHIFT + i),
+				   NSEC_PER_USEC));
+	seq_puts(sf, " inf total_us\n");
+
+	schedtune_wait_hist_show_one(sf, &root_schedtune);
+
+	rcu_read_lock();
+	css_for_each_child(css, &root_schedtune.css)
+		schedtune_wait_hist_show_one(sf, css_st(css));
+	rcu_read_unlock();
+
+	return 0;
+}
+
 #ifdef CONFIG_SCHED_WALT
 static inline void init_sched_boost(struct schedtune *st)
 {
@@ -226,12 +333,13 @@ schedtune_cpu_update(int cpu, u64 now)
 	struct boost_groups *bg = &per_cpu(cpu_boost_groups, cpu);
 	int boost_max;
 	u64 boost_ts;
+	int util_min = 0, util_max = -1;
 	int idx;
 
 	/* The root boost group is always active */
 	boost_max = bg->group[0].boost;
 	boost_ts = now;
-	for (idx = 1; idx < BOOSTGROUPS_COUNT; ++idx) {
+	for (idx = 0; idx < BOOSTGROUPS_COUNT; ++idx) {
 		/*
 		 * A boost group affects a CPU only if it has
 		 * RUNNABLE tasks on that CPU or it has hold
@@ -240,6 +348,13 @@ schedtune_cpu_update(int cpu, u64 now)
 		if (!schedtune_boost_group_active(idx, bg, now))
 			continue;
 
+		/* As with boosts, the most demanding group wins */
+		util_min = max(util_min, bg->group[idx].util_min);
+		util_max = max(util_max, bg->group[idx].util_max);
+
+		if (!idx)
+			continue;
+
 		/* This boost group is active */
 		if (boost_max > bg->group[idx].boost)
 			continue;
@@ -253,6 +368,30 @@ schedtune_cpu_update(int cpu, u64 now)
 	boost_max = max(boost_max, 0);
 	bg->boost_max = boost_max;
 	bg->boost_ts = boost_ts;
+
+	/* Nothing RUNNABLE, nothing to cap */
+	if (util_max < 0)
+		util_max = SCHED_CAPACITY_SCALE;
+	bg->util_min = min(util_min, util_max);
+	bg->util_max = util_max;
+}
+
+static void
+schedtune_boostgroup_update_clamps(int idx, int util_min, int util_max)
+{
+	struct boost_groups *bg;
+	unsigned long irq_flags;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		bg = &per_cpu(cpu_boost_groups, cpu);
+
+		raw_spin_lock_irqsave(&bg->lock, irq_flags);
+		bg->group[idx].util_min = util_min;
+		bg->group[idx].util_max = util_max;
+		schedtune_cpu_update(cpu, sched_clock_cpu(cpu));
+		raw_spin_unlock_irqrestore(&bg->lock, irq_flags);
+	}
 }
 
 static int
@@ -334,6 +473,9 @@ schedtune_tasks_update(struct task_struct *p, int cpu, int idx, int task_count)
 		/* Boost group activation or deactivation on that RQ */
 		if (bg->group[idx].tasks == 1)
 			schedtune_cpu_update(cpu, now);
+	} else if (!bg->group[idx].tasks) {
+		/* Don't leave a departed group's clamps on the CPU */
+		schedtune_cpu_update(cpu, sched_clock_cpu(cpu));
 	}
 
 	trace_sched_tune_tasks_update(p, cpu, tasks, idx,
@@ -545,6 +687,35 @@ int schedtune_cpu_boost(int cpu)
 	return bg->boost_max;
 }
 
+unsigned long schedtune_cpu_util_clamp(int cpu, unsigned long util)
+{
+	struct boost_groups *bg = &per_cpu(cpu_boost_groups, cpu);
+
+	if (unlikely(!schedtune_initialized))
+		return util;
+
+	return clamp(util, (unsigned long)READ_ONCE(bg->util_min),
+		     (unsigned long)READ_ONCE(bg->util_max));
+}
+
+unsigned long schedtune_task_util_clamp(struct task_struct *p,
+					unsigned long util)
+{
+	struct schedtune *st;
+	unsigned long util_min, util_max;
+
+	if (unlikely(!schedtune_initialized))
+		return util;
+
+	rcu_read_lock();
+	st = task_schedtune(p);
+	util_min = st->util_min;
+	util_max = st->util_max;
+	rcu_read_unlock();
+
+	return clamp(util, util_min, util_max);
+}
+
 static inline int schedtune_adj_ta(struct task_struct *p)
 {
 	struct schedtune *st;
@@ -604,6 +775,24 @@ int schedtune_task_boost_rcu_locked(struct task_struct *p)
 	return task_boost;
 }
 
+/*
+ * True if @p lives in the "top-app" group, i.e. it belongs to the
+ * application currently in the foreground.
+ */
+bool schedtune_task_top_app(struct task_struct *p)
+{
+	bool top_app;
+
+	if (unlikely(!schedtune_initialized))
+		return false;
+
+	rcu_read_lock();
+	top_app = task_schedtune(p)->top_app;
+	rcu_read_unlock();
+
+	return top_app;
+}
+
 int schedtune_prefer_idle(struct task_struct *p)
 {
 	struct schedtune *st;
@@ -642,6 +831,50 @@ prefer_idle_write(struct cgroup_subsys_state *css, struct cftype *cft,
 	return 0;
 }
 
+static u64
+util_min_read(struct cgroup_subsys_state *css, struct cftype *cft)
+{
+	return css_st(css)->util_min;
+}
+
+static int
+util_min_write(struct cgroup_subsys_state *css, struct cftype *cft,
+	       u64 util_min)
+{
+	struct schedtune *st = css_st(css);
+
+	if (util_min > st->util_max)
+		return -EINVAL;
+
+	st->util_min = util_min;
+	schedtune_boostgroup_update_clamps(st->idx, st->util_min,
+					   st->util_max);
+
+	return 0;
+}
+
+static u64
+util_max_read(struct cgroup_subsys_state *css, struct cftype *cft)
+{
+	return css_st(css)->util_max;
+}
+
+static int
+util_max_write(struct cgroup_subsys_state *css, struct cftype *cft,
+	       u64 util_max)
+{
+	struct schedtune *st = css_st(css);
+
+	if (util_max > SCHED_CAPACITY_SCALE || util_max < st->util_min)
+		return -EINVAL;
+
+	st->util_max = util_max;
+	schedtune_boostgroup_update_clamps(st->idx, st->util_min,
+					   st->util_max);
+
+	return 0;
+}
+
 static s64
 boost_read(struct cgroup_subsys_state *css, struct cftype *cft)
 {
@@ -716,6 +949,21 @@ static struct cftype files[] = {
 		.read_u64 = prefer_idle_read,
 		.write_u64 = prefer_idle_write,
 	},
+	{
+		.name = "util_min",
+		.read_u64 = util_min_read,
+		.write_u64 = util_min_write,
+	},
+	{
+		.name = "util_max",
+		.read_u64 = util_max_read,
+		.write_u64 = util_max_write,
+	},
+	{
+		.name = "wait_hist",
+		.flags = CFTYPE_ONLY_ON_ROOT,
+		.seq_show = schedtune_wait_hist_show,
+	},
 	{ }	/* terminate */
 };
 
@@ -732,8 +980,13 @@ schedtune_boostgroup_init(struct schedtune *st)
 	for_each_possible_cpu(cpu) {
 		bg = &per_cpu(cpu_boost_groups, cpu);
 		bg->group[st->idx].boost = 0;
+		bg->group[st->idx].util_min = st->util_min;
+		bg->group[st->idx].util_max = st->util_max;
 		bg->group[st->idx].tasks = 0;
 		bg->group[st->idx].ts = 0;
+		memset(per_cpu(cpu_wait_hist, cpu).count[st->idx], 0,
+		       sizeof(per_cpu(cpu_wait_hist, cpu).count[st->idx]));
+		per_cpu(cpu_wait_hist, cpu).wait_sum[st->idx] = 0;
 	}
 
 	return 0;
@@ -770,6 +1023,7 @@ schedtune_css_alloc(struct cgroup_subsys_state *parent_css)
 
 	/* Initialize per CPUs boost group support */
 	st->idx = idx;
+	st->util_max = SCHED_CAPACITY_SCALE;
 	init_sched_boost(st);
 	if (schedtune_boostgroup_init(st))
 		goto release;
@@ -782,11 +1036,27 @@ schedtune_css_alloc(struct cgroup_subsys_state *parent_css)
 	return ERR_PTR(-ENOMEM);
 }
 
+static int
+schedtune_css_online(struct cgroup_subsys_state *css)
+{
+	struct schedtune *st = css_st(css);
+	char name_buf[NAME_MAX + 1];
+
+	if (st == &root_schedtune)
+		return 0;
+
+	cgroup_name(css->cgroup, name_buf, sizeof(name_buf));
+	st->top_app = !strcmp(name_buf, "top-app");
+
+	return 0;
+}
+
 static void
 schedtune_boostgroup_release(struct schedtune *st)
 {
 	/* Reset this boost group */
 	schedtune_boostgroup_update(st->idx, 0);
+	schedtune_boostgroup_update_clamps(st->idx, 0, SCHED_CAPACITY_SCALE);
 
 	/* Keep track of allocated boost groups */
 	allocated_group[st->idx] = NULL;
@@ -803,6 +1073,7 @@ schedtune_css_free(struct cgroup_subsys_state *css)
 
 struct cgroup_subsys schedtune_cgrp_subsys = {
 	.css_alloc	= schedtune_css_alloc,
+	.css_online	= schedtune_css_online,
 	.css_free	= schedtune_css_free,
 	.attach		= schedtune_attach,
 	.can_attach     = schedtune_can_attach,
@@ -821,6 +1092,8 @@ schedtune_init_cgroups(void)
 	for_each_possible_cpu(cpu) {
 		bg = &per_cpu(cpu_boost_groups, cpu);
 		memset(bg, 0, sizeof(struct boost_groups));
+		bg->util_max = SCHED_CAPACITY_SCALE;
+		bg->group[0].util_max = SCHED_CAPACITY_SCALE;
 		raw_spin_lock_init(&bg->lock);
 	}
 
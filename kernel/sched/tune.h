@@ -18,6 +18,10 @@ int schedtune_task_boost_rcu_locked(struct task_struct *tsk);
 
 int schedtune_prefer_idle(struct task_struct *tsk);
 
+unsigned long schedtune_cpu_util_clamp(int cpu, unsigned long util);
+unsigned long schedtune_task_util_clamp(struct task_struct *tsk,
+					unsigned long util);
+
 void schedtune_enqueue_task(struct task_struct *p, int cpu);
 void schedtune_dequeue_task(struct task_struct *p, int cpu);
 
@@ -28,6 +32,9 @@ void schedtune_dequeue_task(struct task_struct *p, int cpu);
 
 #define schedtune_prefer_idle(tsk) 0
 
+#define schedtune_cpu_util_clamp(cpu, util) (util)
+#define schedtune_task_util_clamp(tsk, util) (util)
+
 #define schedtune_enqueue_task(task, cpu) do { } while (0)
 #define schedtune_dequeue_task(task, cpu) do { } while (0)
 
@@ -0,0 +1,84 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * UX task state and inheritance, see include/linux/sched/ux.h.
+ */
+
+#include <linux/sched/ux.h>
+#include <linux/sched/task.h>
+
+#include "sched.h"
+
+/*
+ * A task that just became UX may already be queued; put it on its
+ * runqueue's UX list now rather than at its next enqueue.
+ */
+static void sched_ux_update(struct task_struct *p)
+{
+	struct rq_flags rf;
+	struct rq *rq;
+
+	rq = task_rq_lock(p, &rf);
+	if (task_on_rq_queued(p) && p->sched_class == &fair_sched_class &&
+	    list_empty(&p->ux_entry) && task_is_ux(p)) {
+		list_add_tail(&p->ux_entry, &rq->ux_tasks);
+		if (rq->curr != p && !task_is_ux(rq->curr))
+			resched_curr(rq);
+	}
+	task_rq_unlock(rq, p, &rf);
+}
+
+int sched_ux_set_static(struct task_struct *p, bool ux)
+{
+	WRITE_ONCE(p->ux_static, ux);
+	if (ux)
+		sched_ux_update(p);
+
+	return 0;
+}
+
+/*
+ * Called by a task about to block on a lock owned by @owner. If current
+ * is UX, @owner is made UX until the matching sched_ux_uninherit(). The
+ * returned pointer holds a reference and must be handed back to it.
+ */
+struct task_struct *sched_ux_inherit(struct task_struct *owner)
+{
+	if (!owner || owner == current || !task_is_ux(current))
+		return NULL;
+
+	get_task_struct(owner);
+	if (atomic_inc_return(&owner->ux_depth) == 1)
+		sched_ux_update(owner);
+
+	return owner;
+}
+
+void sched_ux_uninherit(struct task_struct *owner)
+{
+	if (!owner)
+		return;
+
+	/* The owner drops off the UX list at its next dequeue or pick */
+	atomic_dec(&owner->ux_depth);
+	put_task_struct(owner);
+}
+
+void sched_ux_binder_enter(struct task_struct *p)
+{
+	if (atomic_inc_return(&p->ux_binder) == 1)
+		sched_ux_update(p);
+}
+
+void sched_ux_binder_exit(struct task_struct *p)
+{
+	atomic_dec_if_positive(&p->ux_binder);
+}
+
+/*
+ * A binder thread going back to wait for process work serves nothing,
+ * whatever replies were lost on the way.
+ */
+void sched_ux_binder_reset(struct task_struct *p)
+{
+	atomic_set(&p->ux_binder, 0);
+}
@@ -25,6 +25,8 @@
 #include <linux/jiffies.h>
 #include <linux/sched/core_ctl.h>
 #include <linux/sched/stat.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include <trace/events/sched.h>
 #include "sched.h"
 #include "walt.h"
@@ -535,6 +537,11 @@ u64 freq_policy_load(struct rq *rq)
 		break;
 	}
 
+	/* Declared demand of queued tasks, ahead of their history */
+	if (rq->hint_demands_sum_scaled)
+		load = max_t(u64, load, rq->hint_demands_sum_scaled *
+					walt_scale_demand_divisor);
+
 done:
 	trace_sched_load_to_gov(rq, aggr_grp_load, tt_load, sched_freq_aggr_en,
 				load, reporting_policy, walt_rotation_enabled,
@@ -1756,6 +1763,7 @@ static void update_history(struct rq *rq, struct task_struct *p,
 			demand = max(avg, runtime);
 	}
 	pred_demand = predict_and_update_buckets(rq, p, runtime);
+	pred_demand = max(pred_demand, p->ravg.hint_demand);
 	demand_scaled = scale_demand(demand);
 	pred_demand_scaled = scale_demand(pred_demand);
 
@@ -2033,6 +2041,62 @@ int sched_set_init_task_load(struct task_struct *p, int init_load_pct)
 	return 0;
 }
 
+unsigned int sched_get_task_freq_hint(struct task_struct *p)
+{
+	return p->ravg.hint_pct;
+}
+
+/*
+ * Declare the share of a window, in percent, that @p expects to be busy.
+ * The hint becomes a floor on its predicted demand. While @p is queued it
+ * is also added to its CPU's frequency load, so the governor ramps when
+ * the work arrives rather than a window later. 0 drops the hint.
+ */
+int sched_set_task_freq_hint(struct task_struct *p, unsigned int util_pct)
+{
+	struct rq_flags rf;
+	struct rq *rq;
+	u32 hint, pred;
+	u16 hint_scaled, pred_scaled;
+
+	if (util_pct > 100)
+		return -EINVAL;
+
+	hint = div64_u64((u64)util_pct * (u64)sched_ravg_window, 100);
+	hint_scaled = scale_demand(hint);
+
+	rq = task_rq_lock(p, &rf);
+
+	if (task_on_rq_queued(p)) {
+		rq->hint_demands_sum_scaled -= p->ravg.hint_demand_scaled;
+		rq->hint_demands_sum_scaled += hint_scaled;
+	}
+
+	p->ravg.hint_pct = util_pct;
+	p->ravg.hint_demand = hint;
+	p->ravg.hint_demand_scaled = hint_scaled;
+
+	/* A lower hint decays with the next window, a higher one applies now */
+	pred = max(p->ravg.pred_demand, hint);
+	if (pred != p->ravg.pred_demand) {
+		pred_scaled = scale_demand(pred);
+		if (task_on_rq_queued(p) && (!task_has_dl_policy(p) ||
+					!p->dl.dl_throttled) &&
+					p->sched_class->fixup_walt_sched_stats)
+			p->sched_class->fixup_walt_sched_stats(rq, p,
+					p->ravg.demand_scaled, pred_scaled);
+		p->ravg.pred_demand = pred;
+		p->ravg.pred_demand_scaled = pred_scaled;
+	}
+
+	if (task_on_rq_queued(p))
+		cpufreq_update_util(rq, SCHED_CPUFREQ_WALT);
+
+	task_rq_unlock(rq, p, &rf);
+
+	return 0;
+}
+
 void init_new_task_load(struct task_struct *p)
 {
 	int i;
@@ -2920,8 +2984,17 @@ void update_cpu_cluster_capacity(const cpumask_t *cpus)
 	struct cpumask cpumask;
 	unsigned long flags;
 
+	/*
+	 * A frequency domain update only touches the clusters spanned by
+	 * @cpus, so only their runqueues need to be held. The global
+	 * min/max capacity are plain word stores read without rq locks.
+	 */
+	cpumask_clear(&locked);
+	for_each_cpu(i, cpus)
+		cpumask_or(&locked, &locked, &cpu_rq(i)->cluster->cpus);
+
 	cpumask_copy(&cpumask, cpus);
-	acquire_rq_locks_irqsave(cpu_possible_mask, &flags);
+	acquire_rq_locks_irqsave(&locked, &flags);
 
 	for_each_cpu(i, &cpumask) {
 		cluster = cpu_rq(i)->cluster;
@@ -2933,7 +3006,7 @@ void update_cpu_cluster_capacity(const cpumask_t *cpus)
 
 	__update_min_max_capacity();
 
-	release_rq_locks_irqrestore(cpu_possible_mask, &flags);
+	release_rq_locks_irqrestore(&locked, &flags);
 }
 
 static unsigned long max_cap[NR_CPUS];
@@ -3178,48 +3251,98 @@ int sched_little_cluster_coloc_fmin_khz_handler(struct ctl_table *table,
 	return ret;
 }
 
+/*
+ * Latency histogram of walt_irq_work(), in power-of-two microsecond
+ * buckets: bucket 0 is < 1us, bucket n is [2^(n-1), 2^n) us and the last
+ * bucket collects everything slower.
+ */
+#define WALT_LAT_BUCKETS	12
+
+static DEFINE_PER_CPU(unsigned long [WALT_LAT_BUCKETS], walt_irq_work_lat);
+static DEFINE_PER_CPU(u64, walt_irq_work_lat_max);
+
+static void walt_irq_work_account(u64 delta_ns)
+{
+	u64 us = delta_ns / NSEC_PER_USEC;
+	int bucket = us ? min(fls64(us), WALT_LAT_BUCKETS - 1) : 0;
+
+	this_cpu_inc(walt_irq_work_lat[bucket]);
+	if (delta_ns > this_cpu_read(walt_irq_work_lat_max))
+		this_cpu_write(walt_irq_work_lat_max, delta_ns);
+}
+
+/*
+ * Roll @rq's window forward to @wc and publish the values the cluster
+ * aggregation needs. Only @rq's own lock is taken.
+ */
+static void walt_rollover_rq(struct rq *rq, u64 wc)
+{
+	raw_spin_lock(&rq->lock);
+	if (rq->curr) {
+		update_task_ravg(rq->curr, rq, TASK_UPDATE, wc, 0);
+		/* load_subs are filled in under the cluster's load_lock */
+		raw_spin_lock(&rq->cluster->load_lock);
+		account_load_subtractions(rq);
+		raw_spin_unlock(&rq->cluster->load_lock);
+	}
+	write_seqcount_begin(&rq->walt_snap_seq);
+	rq->walt_snap_ws = rq->curr ? rq->window_start : 0;
+	rq->walt_snap_grp_prs = rq->grp_time.prev_runnable_sum;
+	write_seqcount_end(&rq->walt_snap_seq);
+	raw_spin_unlock(&rq->lock);
+}
+
+static u64 walt_rq_snap_grp_load(struct rq *rq)
+{
+	unsigned int seq;
+	u64 snap_ws, load;
+
+	do {
+		seq = read_seqcount_begin(&rq->walt_snap_seq);
+		snap_ws = rq->walt_snap_ws;
+		load = rq->walt_snap_grp_prs;
+	} while (read_seqcount_retry(&rq->walt_snap_seq, seq));
+
+	/* A runqueue without a current task was never rolled over */
+	return snap_ws ? load : 0;
+}
+
 /*
  * Runs in hard-irq context. This should ideally run just after the latest
  * window roll-over.
+ *
+ * Each CPU is rolled over under its own rq lock only; cluster aggregation
+ * then works from the per-rq snapshots, so no CPU ever waits on all the
+ * runqueue locks at once.
  */
 void walt_irq_work(struct irq_work *irq_work)
 {
 	struct sched_cluster *cluster;
 	struct rq *rq;
 	int cpu;
-	u64 wc;
+	u64 wc, start;
 	bool is_migration = false;
 	u64 total_grp_load = 0;
-	int level = 0;
+
+	start = local_clock();
 
 	/* Am I the window rollover work or the migration work? */
 	if (irq_work == &walt_migration_irq_work)
 		is_migration = true;
 
-	for_each_cpu(cpu, cpu_possible_mask) {
-		if (level == 0)
-			raw_spin_lock(&cpu_rq(cpu)->lock);
-		else
-			raw_spin_lock_nested(&cpu_rq(cpu)->lock, level);
-		level++;
-	}
-
 	wc = sched_ktime_clock();
 	walt_load_reported_window = atomic64_read(&walt_irq_work_lastq_ws);
+
+	for_each_cpu(cpu, cpu_possible_mask)
+		walt_rollover_rq(cpu_rq(cpu), wc);
+
 	for_each_sched_cluster(cluster) {
 		u64 aggr_grp_load = 0;
 
 		raw_spin_lock(&cluster->load_lock);
 
-		for_each_cpu(cpu, &cluster->cpus) {
-			rq = cpu_rq(cpu);
-			if (rq->curr) {
-				update_task_ravg(rq->curr, rq,
-						TASK_UPDATE, wc, 0);
-				account_load_subtractions(rq);
-				aggr_grp_load += rq->grp_time.prev_runnable_sum;
-			}
-		}
+		for_each_cpu(cpu, &cluster->cpus)
+			aggr_grp_load += walt_rq_snap_grp_load(cpu_rq(cpu));
 
 		cluster->aggr_grp_load = aggr_grp_load;
 		total_grp_load += aggr_grp_load;
@@ -3242,6 +3365,7 @@ void walt_irq_work(struct irq_work *irq_work)
 			int flag = SCHED_CPUFREQ_WALT;
 
 			rq = cpu_rq(cpu);
+			raw_spin_lock(&rq->lock);
 
 			if (is_migration) {
 				if (rq->notif_pending) {
@@ -3256,17 +3380,81 @@ void walt_irq_work(struct irq_work *irq_work)
 			else
 				cpufreq_update_util(cpu_rq(cpu), flag |
 							SCHED_CPUFREQ_CONTINUE);
+			raw_spin_unlock(&rq->lock);
 			i++;
 		}
 	}
 
-	for_each_cpu(cpu, cpu_possible_mask)
-		raw_spin_unlock(&cpu_rq(cpu)->lock);
-
 	if (!is_migration)
 		core_ctl_check(this_rq()->window_start);
+
+	walt_irq_work_account(local_clock() - start);
 }
 
+#ifdef CONFIG_DEBUG_FS
+static int walt_irq_work_lat_show(struct seq_file *m, void *v)
+{
+	unsigned long count;
+	u64 max = 0;
+	int cpu, i;
+
+	for_each_possible_cpu(cpu)
+		max = max(max, per_cpu(walt_irq_work_lat_max, cpu));
+
+	for (i = 0; i < WALT_LAT_BUCKETS; i++) {
+		count = 0;
+		for_each_possible_cpu(cpu)
+			count += per_cpu(walt_irq_work_lat[i], cpu);
+
+		if (i == 0)
+			seq_printf(m, "      <1us: %lu\n", count);
+		else if (i == WALT_LAT_BUCKETS - 1)
+			seq_printf(m, "  >=%5uus: %lu\n", 1U << (i - 1), count);
+		else
+			seq_printf(m, "  <%6uus: %lu\n", 1U << i, count);
+	}
+	seq_printf(m, "max: %lluns\n", max);
+
+	return 0;
+}
+
+static int walt_irq_work_lat_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, walt_irq_work_lat_show, NULL);
+}
+
+static ssize_t walt_irq_work_lat_write(struct file *file,
+		const char __user *ubuf, size_t cnt, loff_t *ppos)
+{
+	int cpu, i;
+
+	/* Any write resets the histogram */
+	for_each_possible_cpu(cpu) {
+		for (i = 0; i < WALT_LAT_BUCKETS; i++)
+			per_cpu(walt_irq_work_lat[i], cpu) = 0;
+		per_cpu(walt_irq_work_lat_max, cpu) = 0;
+	}
+
+	return cnt;
+}
+
+static const struct file_operations walt_irq_work_lat_fops = {
+	.open		= walt_irq_work_lat_open,
+	.read		= seq_read,
+	.write		= walt_irq_work_lat_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static __init int walt_init_debugfs(void)
+{
+	debugfs_create_file("walt_rollover_latency", 0644, NULL, NULL,
+			&walt_irq_work_lat_fops);
+	return 0;
+}
+late_initcall(walt_init_debugfs);
+#endif
+
 void walt_rotation_checkpoint(int nr_big)
 {
 	if (!hmp_capable())
@@ -3425,4 +3613,8 @@ void walt_sched_init_rq(struct rq *rq)
 	}
 	rq->cum_window_demand_scaled = 0;
 	rq->notif_pending = false;
+	rq->hint_demands_sum_scaled = 0;
+	seqcount_init(&rq->walt_snap_seq);
+	rq->walt_snap_ws = 0;
+	rq->walt_snap_grp_prs = 0;
 }
@@ -116,6 +116,12 @@ walt_inc_cumulative_runnable_avg(struct rq *rq, struct task_struct *p)
 	fixup_cumulative_runnable_avg(&rq->walt_stats, p->ravg.demand_scaled,
 				      p->ravg.pred_demand_scaled);
 
+	/* Let a hinted task raise the frequency as soon as it is runnable */
+	if (p->ravg.hint_demand_scaled) {
+		rq->hint_demands_sum_scaled += p->ravg.hint_demand_scaled;
+		cpufreq_update_util(rq, SCHED_CPUFREQ_WALT);
+	}
+
 	/*
 	 * Add a task's contribution to the cumulative window demand when
 	 *
@@ -137,6 +143,9 @@ walt_dec_cumulative_runnable_avg(struct rq *rq, struct task_struct *p)
 				      -(s64)p->ravg.demand_scaled,
 				      -(s64)p->ravg.pred_demand_scaled);
 
+	rq->hint_demands_sum_scaled -= p->ravg.hint_demand_scaled;
+	BUG_ON((s64)rq->hint_demands_sum_scaled < 0);
+
 	/*
 	 * on_rq will be 1 for sleeping tasks. So check if the task
 	 * is migrating or dequeuing in RUNNING state to change the
@@ -0,0 +1,275 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Per frame breakdown of what went into each displayed frame.
+ *
+ * A frame starts with the first atomic commit after the previous frame
+ * was presented and ends when the display driver signals that commit's
+ * flip event. For each frame the ring keeps the commit to present time,
+ * the GPU submit to retire time of the last end-of-frame draw and, for
+ * the followed tasks (usually the app's UI thread and RenderThread), the
+ * CPU time they got during the frame, the CPU they last ran on and its
+ * frequency at present time.
+ *
+ * The tasks are set by writing their pids to the frame_trace.tasks
+ * parameter, the last FRAME_TRACE_SLOTS frames are read, oldest first,
+ * from /sys/kernel/debug/frame_trace.
+ */
+
+#include <linux/cpufreq.h>
+#include <linux/debugfs.h>
+#include <linux/frame_trace.h>
+#include <linux/init.h>
+#include <linux/ktime.h>
+#include <linux/moduleparam.h>
+#include <linux/pid.h>
+#include <linux/sched.h>
+#include <linux/sched/task.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+
+#define FRAME_TRACE_SLOTS	256
+#define FRAME_TRACE_TASKS	2
+
+struct frame_task_sample {
+	u32 runtime_us;
+	u32 freq_khz;
+	s32 cpu;
+};
+
+struct frame_record {
+	u64 present_ns;
+	u32 commit_us;
+	u32 gpu_us;
+	u32 gpu_frames;
+	struct frame_task_sample task[FRAME_TRACE_TASKS];
+};
+
+struct frame_task {
+	struct task_struct *task;
+	u64 last_runtime;
+};
+
+static DEFINE_SPINLOCK(frame_trace_lock);
+static struct frame_record frame_ring[FRAME_TRACE_SLOTS];
+static u64 frame_head;
+static struct frame_task frame_tasks[FRAME_TRACE_TASKS];
+
+/* State of the frame being built, protected by frame_trace_lock */
+static u64 frame_commit_ns;
+static u32 frame_gpu_us;
+static u32 frame_gpu_frames;
+
+static bool frame_trace_enabled;
+module_param_named(enable, frame_trace_enabled, bool, 0644);
+
+/* Called for each atomic commit that isn't a test */
+void frame_trace_commit(void)
+{
+	unsigned long flags;
+
+	if (!READ_ONCE(frame_trace_enabled))
+		return;
+
+	spin_lock_irqsave(&frame_trace_lock, flags);
+	if (!frame_commit_ns)
+		frame_commit_ns = ktime_get_ns();
+	spin_unlock_irqrestore(&frame_trace_lock, flags);
+}
+EXPORT_SYMBOL(frame_trace_commit);
+
+/* Called when the GPU retires an end-of-frame draw, @latency_ns after submit */
+void frame_trace_gpu_frame(u64 latency_ns)
+{
+	unsigned long flags;
+
+	if (!READ_ONCE(frame_trace_enabled))
+		return;
+
+	spin_lock_irqsave(&frame_trace_lock, flags);
+	frame_gpu_us = div_u64(latency_ns, NSEC_PER_USEC);
+	frame_gpu_frames++;
+	spin_unlock_irqrestore(&frame_trace_lock, flags);
+}
+EXPORT_SYMBOL(frame_trace_gpu_frame);
+
+static void frame_task_sample(struct frame_task *ft,
+			      struct frame_task_sample *s)
+{
+	u64 runtime;
+
+	if (!ft->task) {
+		s->runtime_us = 0;
+		s->freq_khz = 0;
+		s->cpu = -1;
+		return;
+	}
+
+	runtime = READ_ONCE(ft->task->se.sum_exec_runtime);
+	s->runtime_us = div_u64(runtime - ft->last_runtime, NSEC_PER_USEC);
+	ft->last_runtime = runtime;
+	s->cpu = task_cpu(ft->task);
+	s->freq_khz = cpufreq_quick_get(s->cpu);
+}
+
+/* Called when a flip event is signalled, closes the frame if one is open */
+void frame_trace_present(void)
+{
+	struct frame_record *rec;
+	unsigned long flags;
+	u64 now;
+	int i;
+
+	if (!READ_ONCE(frame_trace_enabled))
+		return;
+
+	now = ktime_get_ns();
+
+	spin_lock_irqsave(&frame_trace_lock, flags);
+	if (!frame_commit_ns)
+		goto unlock;
+
+	rec = &frame_ring[frame_head % FRAME_TRACE_SLOTS];
+	rec->present_ns = now;
+	rec->commit_us = div_u64(now - frame_commit_ns, NSEC_PER_USEC);
+	rec->gpu_us = frame_gpu_us;
+	rec->gpu_frames = frame_gpu_frames;
+	for (i = 0; i < FRAME_TRACE_TASKS; i++)
+		frame_task_sample(&frame_tasks[i], &rec->task[i]);
+	frame_head++;
+
+	frame_commit_ns = 0;
+	frame_gpu_us = 0;
+	frame_gpu_frames = 0;
+unlock:
+	spin_unlock_irqrestore(&frame_trace_lock, flags);
+}
+EXPORT_SYMBOL(frame_trace_present);
+
+static void frame_tasks_put(struct frame_task *tasks)
+{
+	int i;
+
+	for (i = 0; i < FRAME_TRACE_TASKS; i++)
+		if (tasks[i].task)
+			put_task_struct(tasks[i].task);
+}
+
+static int set_frame_tasks(const char *buf, const struct kernel_param *kp)
+{
+	struct frame_task tasks[FRAME_TRACE_TASKS] = { };
+	struct frame_task old[FRAME_TRACE_TASKS];
+	struct task_struct *task;
+	unsigned long flags;
+	const char *cp = buf;
+	int pid, len, nr = 0;
+
+	while (sscanf(cp, "%d%n", &pid, &len) == 1) {
+		cp += len;
+		if (!pid)
+			continue;
+
+		if (pid < 0 || nr == FRAME_TRACE_TASKS)
+			goto err;
+
+		rcu_read_lock();
+		task = get_pid_task(find_vpid(pid), PIDTYPE_PID);
+		rcu_read_unlock();
+		if (!task)
+			goto err;
+
+		tasks[nr].task = task;
+		tasks[nr].last_runtime = READ_ONCE(task->se.sum_exec_runtime);
+		nr++;
+	}
+
+	spin_lock_irqsave(&frame_trace_lock, flags);
+	memcpy(old, frame_tasks, sizeof(old));
+	memcpy(frame_tasks, tasks, sizeof(tasks));
+	spin_unlock_irqrestore(&frame_trace_lock, flags);
+
+	frame_tasks_put(old);
+	return 0;
+err:
+	frame_tasks_put(tasks);
+	return -EINVAL;
+}
+
+static int get_frame_tasks(char *buf, const struct kernel_param *kp)
+{
+	unsigned long flags;
+	int i, cnt = 0;
+
+	spin_lock_irqsave(&frame_trace_lock, flags);
+	for (i = 0; i < FRAME_TRACE_TASKS; i++)
+		if (frame_tasks[i].task)
+			cnt += snprintf(buf + cnt, PAGE_SIZE - cnt, "%d ",
+					task_pid_vnr(frame_tasks[i].task));
+	spin_unlock_irqrestore(&frame_trace_lock, flags);
+	cnt += snprintf(buf + cnt, PAGE_SIZE - cnt, "\n");
+
+	return cnt;
+}
+
+static const struct kernel_param_ops param_ops_frame_tasks = {
+	.set = set_frame_tasks,
+	.get = get_frame_tasks,
+};
+module_param_cb(tasks, &param_ops_frame_tasks, NULL, 0644);
+
+static int frame_trace_show(struct seq_file *m, void *v)
+{
+	struct frame_record *ring, *rec;
+	unsigned long flags;
+	u64 head, seq;
+	int i;
+
+	ring = kmalloc(sizeof(frame_ring), GFP_KERNEL);
+	if (!ring)
+		return -ENOMEM;
+
+	spin_lock_irqsave(&frame_trace_lock, flags);
+	memcpy(ring, frame_ring, sizeof(frame_ring));
+	head = frame_head;
+	spin_unlock_irqrestore(&frame_trace_lock, flags);
+
+	seq_puts(m, "frame present_us commit_us gpu_us gpu_frames");
+	for (i = 0; i < FRAME_TRACE_TASKS; i++)
+		seq_printf(m, " t%d_run_us t%d_cpu t%d_khz", i, i, i);
+	seq_putc(m, '\n');
+
+	seq = head > FRAME_TRACE_SLOTS ? head - FRAME_TRACE_SLOTS : 0;
+	for (; seq < head; seq++) {
+		rec = &ring[seq % FRAME_TRACE_SLOTS];
+		seq_printf(m, "%llu %llu %u %u %u", seq,
+			   div_u64(rec->present_ns, NSEC_PER_USEC),
+			   rec->commit_us, rec->gpu_us, rec->gpu_frames);
+		for (i = 0; i < FRAME_TRACE_TASKS; i++)
+			seq_printf(m, " %u %d %u", rec->task[i].runtime_us,
+				   rec->task[i].cpu, rec->task[i].freq_khz);
+		seq_putc(m, '\n');
+	}
+
+	kfree(ring);
+	return 0;
+}
+
+static int frame_trace_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, frame_trace_show, NULL);
+}
+
+static const struct file_operations frame_trace_fops = {
+	.open		= frame_trace_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init frame_trace_init(void)
+{
+	debugfs_create_file("frame_trace", 0444, NULL, NULL,
+			    &frame_trace_fops);
+	return 0;
+}
+late_initcall(frame_trace_init);
@@ -52,6 +52,10 @@
 #include <linux/delay.h>
 #include <linux/nmi.h>
 #include <linux/kvm_para.h>
+#include <linux/sched/clock.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/topology.h>
 
 #include "workqueue_internal.h"
 
@@ -201,6 +205,9 @@ struct worker_pool {
  * point to the pwq; thus, pwqs need to be aligned at two's power of the
  * number of flag bits.
  */
+/* bucket n counts work items that waited under 2^n us, the last the rest */
+#define WQ_LAT_BUCKETS		16
+
 struct pool_workqueue {
 	struct worker_pool	*pool;		/* I: the associated pool */
 	struct workqueue_struct *wq;		/* I: the owning workqueue */
@@ -214,6 +221,11 @@ struct pool_workqueue {
 	struct list_head	delayed_works;	/* L: delayed works */
 	struct list_head	pwqs_node;	/* WR: node on wq->pwqs */
 	struct list_head	mayday_node;	/* MD: node on wq->maydays */
+#ifdef CONFIG_WQ_LATENCY_STATS
+	unsigned long		lat_hist[WQ_LAT_BUCKETS];
+						/* L: queue-to-execute latency */
+	u64			lat_max_ns;	/* L: worst latency seen */
+#endif
 
 	/*
 	 * Release of unbound pwq is punted to system_wq.  See put_pwq()
@@ -348,6 +360,8 @@ struct workqueue_struct *system_long_wq __read_mostly;
 EXPORT_SYMBOL_GPL(system_long_wq);
 struct workqueue_struct *system_unbound_wq __read_mostly;
 EXPORT_SYMBOL_GPL(system_unbound_wq);
+struct workqueue_struct *system_highpri_unbound_wq __read_mostly;
+EXPORT_SYMBOL_GPL(system_highpri_unbound_wq);
 struct workqueue_struct *system_freezable_wq __read_mostly;
 EXPORT_SYMBOL_GPL(system_freezable_wq);
 struct workqueue_struct *system_power_efficient_wq __read_mostly;
@@ -1333,6 +1347,9 @@ static void insert_work(struct pool_workqueue *pwq, struct work_struct *work,
 	set_work_pwq(work, pwq, extra_flags);
 	list_add_tail(&work->entry, head);
 	get_pwq(pwq);
+#ifdef CONFIG_WQ_LATENCY_STATS
+	work->queued_ns = local_clock();
+#endif
 
 	/*
 	 * Ensure either wq_worker_sleeping() sees the above
@@ -2080,6 +2097,22 @@ static bool manage_workers(struct worker *worker)
  * CONTEXT:
  * spin_lock_irq(pool->lock) which is released and regrabbed.
  */
+#ifdef CONFIG_WQ_LATENCY_STATS
+static void wq_account_latency(struct pool_workqueue *pwq,
+			       struct work_struct *work)
+{
+	u64 lat = local_clock() - work->queued_ns;
+
+	pwq->lat_hist[min(fls64(div_u64(lat, NSEC_PER_USEC)),
+			  WQ_LAT_BUCKETS - 1)]++;
+	if (lat > pwq->lat_max_ns)
+		pwq->lat_max_ns = lat;
+}
+#else
+static inline void wq_account_latency(struct pool_workqueue *pwq,
+				      struct work_struct *work) { }
+#endif
+
 static void process_one_work(struct worker *worker, struct work_struct *work)
 __releases(&pool->lock)
 __acquires(&pool->lock)
@@ -2127,6 +2160,7 @@ __acquires(&pool->lock)
 	work_color = get_work_color(work);
 
 	list_del_init(&work->entry);
+	wq_account_latency(pwq, work);
 
 	/*
 	 * CPU intensive works don't participate in concurrency management.
@@ -3800,9 +3834,17 @@ apply_wqattrs_prepare(struct workqueue_struct *wq,
 	 * wq_unbound_cpumask, we fallback to the wq_unbound_cpumask.
 	 */
 	copy_workqueue_attrs(new_attrs, attrs);
-	cpumask_and(new_attrs->cpumask, new_attrs->cpumask, wq_unbound_cpumask);
-	if (unlikely(cpumask_empty(new_attrs->cpumask)))
-		cpumask_copy(new_attrs->cpumask, wq_unbound_cpumask);
+	if (wq->flags & WQ_LATENCY_SENSITIVE) {
+		cpumask_and(new_attrs->cpumask, new_attrs->cpumask,
+			    cpu_possible_mask);
+		if (unlikely(cpumask_empty(new_attrs->cpumask)))
+			cpumask_copy(new_attrs->cpumask, cpu_possible_mask);
+	} else {
+		cpumask_and(new_attrs->cpumask, new_attrs->cpumask,
+			    wq_unbound_cpumask);
+		if (unlikely(cpumask_empty(new_attrs->cpumask)))
+			cpumask_copy(new_attrs->cpumask, wq_unbound_cpumask);
+	}
 
 	/*
 	 * We may create multiple pwqs with differing cpumasks.  Make a
@@ -3938,6 +3980,44 @@ int apply_workqueue_attrs(struct workqueue_struct *wq,
 	return ret;
 }
 
+/**
+ * workqueue_set_cluster_affinity - keep an unbound workqueue on a cluster
+ * @wq: the target unbound workqueue
+ * @cpu: any CPU of the cluster
+ *
+ * Restrict the workers of @wq to the CPUs sharing a cluster with @cpu, so
+ * that latency sensitive work can be isolated from bulk work or steered to
+ * the big cluster.  Unless @wq is WQ_LATENCY_SENSITIVE, the cluster is
+ * still intersected with workqueue/cpumask.
+ *
+ * Performs GFP_KERNEL allocations.
+ *
+ * Return: 0 on success and -errno on failure.
+ */
+int workqueue_set_cluster_affinity(struct workqueue_struct *wq, int cpu)
+{
+	struct workqueue_attrs *attrs;
+	int ret;
+
+	if (WARN_ON(!(wq->flags & WQ_UNBOUND)) || cpu < 0 ||
+	    cpu >= nr_cpu_ids || !cpu_possible(cpu))
+		return -EINVAL;
+
+	attrs = alloc_workqueue_attrs(GFP_KERNEL);
+	if (!attrs)
+		return -ENOMEM;
+
+	apply_wqattrs_lock();
+	copy_workqueue_attrs(attrs, wq->unbound_attrs);
+	cpumask_copy(attrs->cpumask, topology_core_cpumask(cpu));
+	ret = apply_workqueue_attrs_locked(wq, attrs);
+	apply_wqattrs_unlock();
+
+	free_workqueue_attrs(attrs);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(workqueue_set_cluster_affinity);
+
 /**
  * wq_update_unbound_numa - update NUMA affinity of a wq for CPU hot[un]plug
  * @wq: the target workqueue
@@ -5551,6 +5631,71 @@ static void workqueue_sysfs_unregister(struct workqueue_struct *wq)	{ }
  * "workqueue.watchdog_thresh" which can be updated at runtime through the
  * corresponding sysfs parameter file.
  */
+#ifdef CONFIG_WQ_LATENCY_STATS
+
+static int wq_latency_show(struct seq_file *m, void *v)
+{
+	struct workqueue_struct *wq;
+	int i;
+
+	seq_printf(m, "%-24s %10s %10s", "workqueue", "count", "max_us");
+	for (i = 0; i < WQ_LAT_BUCKETS - 1; i++)
+		seq_printf(m, " <%luus", 1UL << i);
+	seq_puts(m, " more\n");
+
+	rcu_read_lock_sched();
+	list_for_each_entry_rcu(wq, &workqueues, list) {
+		unsigned long hist[WQ_LAT_BUCKETS] = { };
+		unsigned long count = 0;
+		struct pool_workqueue *pwq;
+		u64 max_ns = 0;
+
+		for_each_pwq(pwq, wq) {
+			spin_lock_irq(&pwq->pool->lock);
+			for (i = 0; i < WQ_LAT_BUCKETS; i++)
+				hist[i] += pwq->lat_hist[i];
+			max_ns = max(max_ns, pwq->lat_max_ns);
+			spin_unlock_irq(&pwq->pool->lock);
+		}
+
+		for (i = 0; i < WQ_LAT_BUCKETS; i++)
+			count += hist[i];
+		if (!count)
+			continue;
+
+		seq_printf(m, "%-24s %10lu %10llu", wq->name, count,
+			   div_u64(max_ns, NSEC_PER_USEC));
+		for (i = 0; i < WQ_LAT_BUCKETS; i++)
+			seq_printf(m, " %lu", hist[i]);
+		seq_putc(m, '\n');
+	}
+	rcu_read_unlock_sched();
+
+	return 0;
+}
+
+static int wq_latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, wq_latency_show, NULL);
+}
+
+static const struct file_operations wq_latency_fops = {
+	.open		= wq_latency_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init wq_latency_debugfs_init(void)
+{
+	debugfs_create_file("workqueue_latency", 0400, NULL, NULL,
+			    &wq_latency_fops);
+	return 0;
+}
+late_initcall(wq_latency_debugfs_init);
+
+#endif	/* CONFIG_WQ_LATENCY_STATS */
+
 #ifdef CONFIG_WQ_WATCHDOG
 
 static void wq_watchdog_timer_fn(unsigned long data);
@@ -5796,6 +5941,10 @@ int __init workqueue_init_early(void)
 	system_long_wq = alloc_workqueue("events_long", 0, 0);
 	system_unbound_wq = alloc_workqueue("events_unbound", WQ_UNBOUND,
 					    WQ_UNBOUND_MAX_ACTIVE);
+	system_highpri_unbound_wq = alloc_workqueue("events_highpri_unbound",
+					WQ_UNBOUND | WQ_HIGHPRI |
+					WQ_LATENCY_SENSITIVE,
+					WQ_UNBOUND_MAX_ACTIVE);
 	system_freezable_wq = alloc_workqueue("events_freezable",
 					      WQ_FREEZABLE, 0);
 	system_power_efficient_wq = alloc_workqueue("events_power_efficient",
@@ -5804,7 +5953,8 @@ int __init workqueue_init_early(void)
 					      WQ_FREEZABLE | WQ_POWER_EFFICIENT,
 					      0);
 	BUG_ON(!system_wq || !system_highpri_wq || !system_long_wq ||
-	       !system_unbound_wq || !system_freezable_wq ||
+	       !system_unbound_wq || !system_highpri_unbound_wq ||
+	       !system_freezable_wq ||
 	       !system_power_efficient_wq ||
 	       !system_freezable_power_efficient_wq);
 
@@ -0,0 +1,446 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Allocator hot path benchmark driven from debugfs.
+ *
+ * Allocators register a struct alloc_bench_ops; zsmalloc and the ION
+ * system heap are provided here and KGSL registers its page pools when
+ * the GPU probes. A run starts nr threads that each allocate and free
+ * objects of pseudo-random size in [min_size, max_size], keeping a window
+ * of live objects. Each alloc and free is timed and the aggregate
+ * throughput and latency percentiles are left in the result file:
+ *
+ *   echo kgsl > /sys/kernel/debug/alloc_bench/allocator
+ *   echo 1 > /sys/kernel/debug/alloc_bench/run
+ *   cat /sys/kernel/debug/alloc_bench/result
+ */
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/alloc_bench.h>
+#include <linux/atomic.h>
+#include <linux/completion.h>
+#include <linux/debugfs.h>
+#include <linux/err.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/kthread.h>
+#include <linux/ktime.h>
+#include <linux/mutex.h>
+#include <linux/random.h>
+#include <linux/seq_file.h>
+#include <linux/sizes.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+#include <linux/zsmalloc.h>
+#ifdef CONFIG_ION
+#include <linux/dma-buf.h>
+#include <linux/ion_kernel.h>
+#include <linux/msm_ion.h>
+#endif
+
+/* Latency bucket i counts operations that took [2^(i-1), 2^i) ns */
+#define ALLOC_BENCH_BUCKETS	32
+
+static u32 nr_threads;
+static u32 nr_ops = 1 << 16;
+static u32 nr_live = 256;
+static u32 min_size = PAGE_SIZE;
+static u32 max_size = 16 * PAGE_SIZE;
+
+static LIST_HEAD(alloc_bench_list);
+static DEFINE_MUTEX(alloc_bench_lock);
+static char alloc_bench_name[32] = "zsmalloc";
+static char alloc_bench_result[1024];
+
+struct alloc_bench_thread {
+	const struct alloc_bench_ops *ops;
+	void *ctx;
+	/* Parameters of the run, the debugfs files may change under it */
+	unsigned int nr_ops;
+	unsigned int nr_live;
+	size_t min_size;
+	size_t max_size;
+	struct task_struct *task;
+	u64 elapsed_ns;
+	unsigned int failed;
+	u32 alloc_hist[ALLOC_BENCH_BUCKETS];
+	u32 free_hist[ALLOC_BENCH_BUCKETS];
+};
+
+static atomic_t alloc_bench_running;
+static struct completion alloc_bench_start;
+static struct completion alloc_bench_done;
+
+void alloc_bench_register(struct alloc_bench_ops *ops)
+{
+	mutex_lock(&alloc_bench_lock);
+	list_add_tail(&ops->list, &alloc_bench_list);
+	mutex_unlock(&alloc_bench_lock);
+}
+EXPORT_SYMBOL(alloc_bench_register);
+
+void alloc_bench_unregister(struct alloc_bench_ops *ops)
+{
+	mutex_lock(&alloc_bench_lock);
+	list_del(&ops->list);
+	mutex_unlock(&alloc_bench_lock);
+}
+EXPORT_SYMBOL(alloc_bench_unregister);
+
+static void alloc_bench_account(u32 *hist, ktime_t start)
+{
+	s64 ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	hist[min_t(int, ns > 0 ? fls64(ns) : 0, ALLOC_BENCH_BUCKETS - 1)]++;
+}
+
+static int alloc_bench_fn(void *data)
+{
+	struct alloc_bench_thread *t = data;
+	u32 seed = get_random_u32();
+	unsigned long *handles;
+	unsigned int i, slot;
+	ktime_t start, op;
+	size_t size;
+
+	handles = kcalloc(t->nr_live, sizeof(*handles), GFP_KERNEL);
+	if (!handles) {
+		t->failed = t->nr_ops;
+		goto out;
+	}
+
+	wait_for_completion(&alloc_bench_start);
+
+	start = ktime_get();
+	for (i = 0; i < t->nr_ops; i++) {
+		slot = i % t->nr_live;
+		if (handles[slot]) {
+			op = ktime_get();
+			t->ops->free(t->ctx, handles[slot]);
+			alloc_bench_account(t->free_hist, op);
+		}
+
+		seed = seed * 1664525 + 1013904223;
+		size = t->min_size +
+		       (seed >> 8) % (t->max_size - t->min_size + 1);
+
+		op = ktime_get();
+		handles[slot] = t->ops->alloc(t->ctx, size);
+		alloc_bench_account(t->alloc_hist, op);
+		if (!handles[slot])
+			t->failed++;
+
+		if (!(i & 255))
+			cond_resched();
+	}
+	t->elapsed_ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	for (slot = 0; slot < t->nr_live; slot++)
+		if (handles[slot])
+			t->ops->free(t->ctx, handles[slot]);
+
+	kfree(handles);
+out:
+	if (atomic_dec_and_test(&alloc_bench_running))
+		complete(&alloc_bench_done);
+	return 0;
+}
+
+/* Upper bound in ns of the bucket holding the @permille'th operation */
+static u64 alloc_bench_percentile(const u64 *hist, u64 total,
+				  unsigned int permille)
+{
+	u64 seen = 0, rank = div_u64(total * permille + 999, 1000);
+	int i;
+
+	for (i = 0; i < ALLOC_BENCH_BUCKETS; i++) {
+		seen += hist[i];
+		if (seen >= rank)
+			break;
+	}
+
+	return 1ULL << min(i, ALLOC_BENCH_BUCKETS - 1);
+}
+
+static int alloc_bench_report(char *buf, size_t len, const char *what,
+			      const u64 *hist)
+{
+	static const struct {
+		const char *name;
+		unsigned int permille;
+	} pct[] = {
+		{ "p50", 500 }, { "p90", 900 }, { "p99", 990 }, { "p999", 999 },
+	};
+	u64 total = 0;
+	int i, cnt;
+
+	for (i = 0; i < ALLOC_BENCH_BUCKETS; i++)
+		total += hist[i];
+
+	cnt = scnprintf(buf, len, "%s_ops %llu\n", what, total);
+	if (!total)
+		return cnt;
+
+	for (i = 0; i < ARRAY_SIZE(pct); i++)
+		cnt += scnprintf(buf + cnt, len - cnt, "%s_%s_ns <%llu\n",
+				 what, pct[i].name,
+				 alloc_bench_percentile(hist, total,
+							pct[i].permille));
+	return cnt;
+}
+
+static int alloc_bench_run(const struct alloc_bench_ops *ops)
+{
+	u64 alloc_hist[ALLOC_BENCH_BUCKETS] = { };
+	u64 free_hist[ALLOC_BENCH_BUCKETS] = { };
+	struct alloc_bench_thread *threads;
+	unsigned int i, j, nr, failed = 0;
+	u32 ops_nr = nr_ops, live = nr_live;
+	u32 min = min_size, max = max_size;
+	u64 elapsed_ns = 0;
+	void *ctx = NULL;
+	int cnt, ret = 0;
+
+	nr = nr_threads ?: num_online_cpus();
+	if (!live || !min || min > max || max > ops->max_size)
+		return -EINVAL;
+
+	if (ops->setup) {
+		ctx = ops->setup();
+		if (IS_ERR(ctx))
+			return PTR_ERR(ctx);
+	}
+
+	threads = kcalloc(nr, sizeof(*threads), GFP_KERNEL);
+	if (!threads) {
+		ret = -ENOMEM;
+		goto out_teardown;
+	}
+
+	init_completion(&alloc_bench_start);
+	init_completion(&alloc_bench_done);
+	atomic_set(&alloc_bench_running, nr);
+	for (i = 0; i < nr; i++) {
+		threads[i].ops = ops;
+		threads[i].ctx = ctx;
+		threads[i].nr_ops = ops_nr;
+		threads[i].nr_live = live;
+		threads[i].min_size = min;
+		threads[i].max_size = max;
+		threads[i].task = kthread_run(alloc_bench_fn, &threads[i],
+					      "alloc_bench/%u", i);
+		if (IS_ERR(threads[i].task)) {
+			pr_err("failed to start thread %u\n", i);
+			threads[i].task = NULL;
+			if (atomic_dec_and_test(&alloc_bench_running))
+				complete(&alloc_bench_done);
+		}
+	}
+
+	complete_all(&alloc_bench_start);
+	wait_for_completion(&alloc_bench_done);
+
+	for (i = 0; i < nr; i++) {
+		if (!threads[i].task)
+			continue;
+
+		elapsed_ns = max(elapsed_ns, threads[i].elapsed_ns);
+		failed += threads[i].failed;
+		for (j = 0; j < ALLOC_BENCH_BUCKETS; j++) {
+			alloc_hist[j] += threads[i].alloc_hist[j];
+			free_hist[j] += threads[i].free_hist[j];
+		}
+	}
+	elapsed_ns = max_t(u64, elapsed_ns, 1);
+
+	cnt = scnprintf(alloc_bench_result, sizeof(alloc_bench_result),
+			"allocator %s\nthreads %u\nsizes %u-%u\nlive %u\n"
+			"elapsed_us %llu\nkops_per_sec %llu\nfailed %u\n",
+			ops->name, nr, min, max, live,
+			div_u64(elapsed_ns, NSEC_PER_USEC),
+			div64_u64((u64)nr * ops_nr * NSEC_PER_MSEC, elapsed_ns),
+			failed);
+	cnt += alloc_bench_report(alloc_bench_result + cnt,
+				  sizeof(alloc_bench_result) - cnt,
+				  "alloc", alloc_hist);
+	alloc_bench_report(alloc_bench_result + cnt,
+			   sizeof(alloc_bench_result) - cnt, "free", free_hist);
+
+	kfree(threads);
+out_teardown:
+	if (ops->teardown)
+		ops->teardown(ctx);
+	return ret;
+}
+
+static ssize_t alloc_bench_run_write(struct file *file,
+				     const char __user *ubuf,
+				     size_t count, loff_t *ppos)
+{
+	struct alloc_bench_ops *ops;
+	int ret = -ENODEV;
+
+	mutex_lock(&alloc_bench_lock);
+	list_for_each_entry(ops, &alloc_bench_list, list) {
+		if (!strcmp(ops->name, alloc_bench_name)) {
+			ret = alloc_bench_run(ops);
+			break;
+		}
+	}
+	mutex_unlock(&alloc_bench_lock);
+
+	return ret ?: count;
+}
+
+static const struct file_operations alloc_bench_run_fops = {
+	.write = alloc_bench_run_write,
+	.llseek = noop_llseek,
+};
+
+static int alloc_bench_allocator_show(struct seq_file *m, void *v)
+{
+	struct alloc_bench_ops *ops;
+
+	mutex_lock(&alloc_bench_lock);
+	list_for_each_entry(ops, &alloc_bench_list, list)
+		seq_printf(m, strcmp(ops->name, alloc_bench_name) ?
+			   "%s " : "[%s] ", ops->name);
+	mutex_unlock(&alloc_bench_lock);
+	seq_putc(m, '\n');
+
+	return 0;
+}
+
+static int alloc_bench_allocator_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, alloc_bench_allocator_show, NULL);
+}
+
+static ssize_t alloc_bench_allocator_write(struct file *file,
+					   const char __user *ubuf,
+					   size_t count, loff_t *ppos)
+{
+	char name[sizeof(alloc_bench_name)];
+
+	if (count >= sizeof(name))
+		return -EINVAL;
+	if (copy_from_user(name, ubuf, count))
+		return -EFAULT;
+	name[count] = '\0';
+
+	mutex_lock(&alloc_bench_lock);
+	strlcpy(alloc_bench_name, strim(name), sizeof(alloc_bench_name));
+	mutex_unlock(&alloc_bench_lock);
+
+	return count;
+}
+
+static const struct file_operations alloc_bench_allocator_fops = {
+	.open = alloc_bench_allocator_open,
+	.read = seq_read,
+	.write = alloc_bench_allocator_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int alloc_bench_result_show(struct seq_file *m, void *v)
+{
+	mutex_lock(&alloc_bench_lock);
+	seq_puts(m, alloc_bench_result);
+	mutex_unlock(&alloc_bench_lock);
+
+	return 0;
+}
+
+static int alloc_bench_result_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, alloc_bench_result_show, NULL);
+}
+
+static const struct file_operations alloc_bench_result_fops = {
+	.open = alloc_bench_result_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+#if IS_BUILTIN(CONFIG_ZSMALLOC)
+static void *zs_bench_setup(void)
+{
+	return zs_create_pool("alloc_bench") ?: ERR_PTR(-ENOMEM);
+}
+
+static void zs_bench_teardown(void *ctx)
+{
+	zs_destroy_pool(ctx);
+}
+
+static unsigned long zs_bench_alloc(void *ctx, size_t size)
+{
+	return zs_malloc(ctx, size, GFP_KERNEL | __GFP_NOWARN);
+}
+
+static void zs_bench_free(void *ctx, unsigned long handle)
+{
+	zs_free(ctx, handle);
+}
+
+static struct alloc_bench_ops zs_bench_ops = {
+	.name = "zsmalloc",
+	.max_size = PAGE_SIZE,
+	.setup = zs_bench_setup,
+	.teardown = zs_bench_teardown,
+	.alloc = zs_bench_alloc,
+	.free = zs_bench_free,
+};
+#endif
+
+#ifdef CONFIG_ION
+static unsigned long ion_bench_alloc(void *ctx, size_t size)
+{
+	struct dma_buf *dmabuf;
+
+	dmabuf = ion_alloc(size, ION_HEAP(ION_SYSTEM_HEAP_ID), 0);
+	return IS_ERR(dmabuf) ? 0 : (unsigned long)dmabuf;
+}
+
+static void ion_bench_free(void *ctx, unsigned long handle)
+{
+	dma_buf_put((struct dma_buf *)handle);
+}
+
+static struct alloc_bench_ops ion_bench_ops = {
+	.name = "ion_system",
+	.max_size = SZ_8M,
+	.alloc = ion_bench_alloc,
+	.free = ion_bench_free,
+};
+#endif
+
+static int __init test_alloc_bench_init(void)
+{
+	struct dentry *dir;
+
+	dir = debugfs_create_dir("alloc_bench", NULL);
+	if (IS_ERR_OR_NULL(dir))
+		return -ENOMEM;
+
+	debugfs_create_u32("threads", 0644, dir, &nr_threads);
+	debugfs_create_u32("ops", 0644, dir, &nr_ops);
+	debugfs_create_u32("live", 0644, dir, &nr_live);
+	debugfs_create_u32("min_size", 0644, dir, &min_size);
+	debugfs_create_u32("max_size", 0644, dir, &max_size);
+	debugfs_create_file("allocator", 0644, dir, NULL,
+			    &alloc_bench_allocator_fops);
+	debugfs_create_file("run", 0200, dir, NULL, &alloc_bench_run_fops);
+	debugfs_create_file("result", 0444, dir, NULL,
+			    &alloc_bench_result_fops);
+
+#if IS_BUILTIN(CONFIG_ZSMALLOC)
+	alloc_bench_register(&zs_bench_ops);
+#endif
+#ifdef CONFIG_ION
+	alloc_bench_register(&ion_bench_ops);
+#endif
+	return 0;
+}
+late_initcall(test_alloc_bench_init);
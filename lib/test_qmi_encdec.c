@@ -0,0 +1,413 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * QMI encoder/decoder microbenchmark.
+ *
+ * Encodes and decodes a message shaped like a flow control indication,
+ * once through the generic element info walker and once through a
+ * precompiled plan, checks that both produce the same wire format and C
+ * struct, and reports the time per message in the kernel log. A message
+ * with a string, which can't be flattened, checks the fallback path.
+ */
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/random.h>
+#include <linux/slab.h>
+#include <linux/ktime.h>
+#include <linux/soc/qcom/qmi.h>
+
+static unsigned int nr_iters = 1 << 16;
+module_param(nr_iters, uint, 0444);
+MODULE_PARM_DESC(nr_iters, "Messages encoded and decoded per pass");
+
+static unsigned int nr_flows = 8;
+module_param(nr_flows, uint, 0444);
+MODULE_PARM_DESC(nr_flows, "Flows in the indication (default: 8)");
+
+#define TEST_QMI_MAX_FLOWS 32
+#define TEST_QMI_MAX_IDS 16
+#define TEST_QMI_NAME_LEN 32
+
+struct test_qmi_flow {
+	u8 mux_id;
+	u8 bearer_id;
+	u32 num_bytes;
+	u16 seq_num;
+	u8 qos_ids[4];
+};
+
+struct test_qmi_ind {
+	u64 timestamp[2];
+	struct qmi_response_type_v01 resp;
+	u8 flows_valid;
+	u32 flows_len;
+	struct test_qmi_flow flows[TEST_QMI_MAX_FLOWS];
+	u8 eod_valid;
+	u8 eod;
+	u8 ids_valid;
+	u8 ids_len;
+	u32 ids[TEST_QMI_MAX_IDS];
+};
+
+struct test_qmi_named {
+	u32 id;
+	char name[TEST_QMI_NAME_LEN + 1];
+};
+
+static struct qmi_elem_info test_qmi_flow_ei[] = {
+	{
+		.data_type	= QMI_UNSIGNED_1_BYTE,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u8),
+		.is_array	= NO_ARRAY,
+		.tlv_type	= QMI_COMMON_TLV_TYPE,
+		.offset		= offsetof(struct test_qmi_flow, mux_id),
+	},
+	{
+		.data_type	= QMI_UNSIGNED_1_BYTE,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u8),
+		.is_array	= NO_ARRAY,
+		.tlv_type	= QMI_COMMON_TLV_TYPE,
+		.offset		= offsetof(struct test_qmi_flow, bearer_id),
+	},
+	{
+		.data_type	= QMI_UNSIGNED_4_BYTE,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u32),
+		.is_array	= NO_ARRAY,
+		.tlv_type	= QMI_COMMON_TLV_TYPE,
+		.offset		= offsetof(struct test_qmi_flow, num_bytes),
+	},
+	{
+		.data_type	= QMI_UNSIGNED_2_BYTE,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u16),
+		.is_array	= NO_ARRAY,
+		.tlv_type	= QMI_COMMON_TLV_TYPE,
+		.offset		= offsetof(struct test_qmi_flow, seq_num),
+	},
+	{
+		.data_type	= QMI_UNSIGNED_1_BYTE,
+		.elem_len	= 4,
+		.elem_size	= sizeof(u8),
+		.is_array	= STATIC_ARRAY,
+		.tlv_type	= QMI_COMMON_TLV_TYPE,
+		.offset		= offsetof(struct test_qmi_flow, qos_ids),
+	},
+	{
+		.data_type	= QMI_EOTI,
+		.is_array	= NO_ARRAY,
+		.tlv_type	= QMI_COMMON_TLV_TYPE,
+	},
+};
+
+static struct qmi_elem_info test_qmi_ind_ei[] = {
+	{
+		.data_type	= QMI_UNSIGNED_8_BYTE,
+		.elem_len	= 2,
+		.elem_size	= sizeof(u64),
+		.is_array	= STATIC_ARRAY,
+		.tlv_type	= 0x01,
+		.offset		= offsetof(struct test_qmi_ind, timestamp),
+	},
+	{
+		.data_type	= QMI_STRUCT,
+		.elem_len	= 1,
+		.elem_size	= sizeof(struct qmi_response_type_v01),
+		.is_array	= NO_ARRAY,
+		.tlv_type	= 0x02,
+		.offset		= offsetof(struct test_qmi_ind, resp),
+		.ei_array	= qmi_response_type_v01_ei,
+	},
+	{
+		.data_type	= QMI_OPT_FLAG,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u8),
+		.is_array	= NO_ARRAY,
+		.tlv_type	= 0x10,
+		.offset		= offsetof(struct test_qmi_ind, flows_valid),
+	},
+	{
+		.data_type	= QMI_DATA_LEN,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u8),
+		.is_array	= NO_ARRAY,
+		.tlv_type	= 0x10,
+		.offset		= offsetof(struct test_qmi_ind, flows_len),
+	},
+	{
+		.data_type	= QMI_STRUCT,
+		.elem_len	= TEST_QMI_MAX_FLOWS,
+		.elem_size	= sizeof(struct test_qmi_flow),
+		.is_array	= VAR_LEN_ARRAY,
+		.tlv_type	= 0x10,
+		.offset		= offsetof(struct test_qmi_ind, flows),
+		.ei_array	= test_qmi_flow_ei,
+	},
+	{
+		.data_type	= QMI_OPT_FLAG,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u8),
+		.is_array	= NO_ARRAY,
+		.tlv_type	= 0x11,
+		.offset		= offsetof(struct test_qmi_ind, eod_valid),
+	},
+	{
+		.data_type	= QMI_UNSIGNED_1_BYTE,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u8),
+		.is_array	= NO_ARRAY,
+		.tlv_type	= 0x11,
+		.offset		= offsetof(struct test_qmi_ind, eod),
+	},
+	{
+		.data_type	= QMI_OPT_FLAG,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u8),
+		.is_array	= NO_ARRAY,
+		.tlv_type	= 0x12,
+		.offset		= offsetof(struct test_qmi_ind, ids_valid),
+	},
+	{
+		.data_type	= QMI_DATA_LEN,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u8),
+		.is_array	= NO_ARRAY,
+		.tlv_type	= 0x12,
+		.offset		= offsetof(struct test_qmi_ind, ids_len),
+	},
+	{
+		.data_type	= QMI_UNSIGNED_4_BYTE,
+		.elem_len	= TEST_QMI_MAX_IDS,
+		.elem_size	= sizeof(u32),
+		.is_array	= VAR_LEN_ARRAY,
+		.tlv_type	= 0x12,
+		.offset		= offsetof(struct test_qmi_ind, ids),
+	},
+	{
+		.data_type	= QMI_EOTI,
+		.is_array	= NO_ARRAY,
+		.tlv_type	= QMI_COMMON_TLV_TYPE,
+	},
+};
+
+static struct qmi_elem_info test_qmi_named_ei[] = {
+	{
+		.data_type	= QMI_UNSIGNED_4_BYTE,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u32),
+		.is_array	= NO_ARRAY,
+		.tlv_type	= 0x01,
+		.offset		= offsetof(struct test_qmi_named, id),
+	},
+	{
+		.data_type	= QMI_STRING,
+		.elem_len	= TEST_QMI_NAME_LEN + 1,
+		.elem_size	= sizeof(char),
+		.is_array	= NO_ARRAY,
+		.tlv_type	= 0x02,
+		.offset		= offsetof(struct test_qmi_named, name),
+	},
+	{
+		.data_type	= QMI_EOTI,
+		.is_array	= NO_ARRAY,
+		.tlv_type	= QMI_COMMON_TLV_TYPE,
+	},
+};
+
+#define TEST_QMI_IND_MAX_LEN	(3 + 16 + 3 + 4 + 3 + 1 + \
+				 TEST_QMI_MAX_FLOWS * 12 + 3 + 1 + \
+				 3 + 1 + TEST_QMI_MAX_IDS * 4)
+#define TEST_QMI_NAMED_MAX_LEN	(3 + 4 + 3 + TEST_QMI_NAME_LEN)
+
+static int test_qmi_check(const char *name, struct qmi_elem_info *ei,
+			  const void *c_struct, size_t c_size, size_t max_len,
+			  bool expect_flat)
+{
+	struct qmi_encdec_plan *plan;
+	size_t len, plan_len;
+	void *msg, *plan_msg = NULL;
+	void *dec = NULL, *plan_dec = NULL;
+	u64 enc_ns[2], dec_ns[2];
+	unsigned int i;
+	ktime_t start;
+	int ret;
+
+	plan = qmi_encdec_plan_create(ei);
+	if (!plan)
+		return -ENOMEM;
+
+	if (qmi_encdec_plan_flat(plan) != expect_flat) {
+		pr_err("%s: plan is %sflat\n", name,
+		       qmi_encdec_plan_flat(plan) ? "" : "not ");
+		ret = -EINVAL;
+		goto out_plan;
+	}
+
+	len = max_len;
+	msg = qmi_encode_message(QMI_INDICATION, 1, &len, 0, ei, c_struct);
+	if (IS_ERR(msg)) {
+		ret = PTR_ERR(msg);
+		goto out_plan;
+	}
+
+	plan_len = max_len;
+	plan_msg = qmi_encode_message_plan(QMI_INDICATION, 1, &plan_len, 0,
+					   plan, c_struct);
+	if (IS_ERR(plan_msg)) {
+		ret = PTR_ERR(plan_msg);
+		plan_msg = NULL;
+		goto out_msg;
+	}
+
+	if (len != plan_len || memcmp(msg, plan_msg, len)) {
+		pr_err("%s: encoded messages differ, %zu vs %zu bytes\n",
+		       name, len, plan_len);
+		ret = -EINVAL;
+		goto out_msg;
+	}
+
+	dec = kzalloc(c_size, GFP_KERNEL);
+	plan_dec = kzalloc(c_size, GFP_KERNEL);
+	if (!dec || !plan_dec) {
+		ret = -ENOMEM;
+		goto out_msg;
+	}
+
+	ret = qmi_decode_message(msg, len, ei, dec);
+	if (ret >= 0)
+		ret = qmi_decode_message_plan(msg, len, plan, plan_dec);
+	if (ret < 0)
+		goto out_msg;
+
+	if (memcmp(dec, plan_dec, c_size) || memcmp(dec, c_struct, c_size)) {
+		pr_err("%s: decoded structs differ\n", name);
+		ret = -EINVAL;
+		goto out_msg;
+	}
+
+	for (i = 0; i < 2; i++) {
+		unsigned int n;
+
+		start = ktime_get();
+		for (n = 0; n < nr_iters; n++) {
+			void *tmp;
+
+			len = max_len;
+			if (i)
+				tmp = qmi_encode_message_plan(QMI_INDICATION, 1,
+							      &len, 0, plan,
+							      c_struct);
+			else
+				tmp = qmi_encode_message(QMI_INDICATION, 1,
+							 &len, 0, ei, c_struct);
+			if (!IS_ERR(tmp))
+				kfree(tmp);
+		}
+		enc_ns[i] = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+		start = ktime_get();
+		for (n = 0; n < nr_iters; n++) {
+			if (i)
+				qmi_decode_message_plan(msg, len, plan, dec);
+			else
+				qmi_decode_message(msg, len, ei, dec);
+		}
+		dec_ns[i] = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+		cond_resched();
+	}
+
+	pr_info("%s: %zu bytes, encode %llu -> %llu ns/msg, decode %llu -> %llu ns/msg\n",
+		name, len, div_u64(enc_ns[0], nr_iters),
+		div_u64(enc_ns[1], nr_iters), div_u64(dec_ns[0], nr_iters),
+		div_u64(dec_ns[1], nr_iters));
+	ret = 0;
+
+out_msg:
+	kfree(plan_dec);
+	kfree(dec);
+	kfree(plan_msg);
+	kfree(msg);
+out_plan:
+	qmi_encdec_plan_destroy(plan);
+	return ret;
+}
+
+static int __init test_qmi_encdec_init(void)
+{
+	struct test_qmi_named *named;
+	struct test_qmi_ind *ind;
+	unsigned int i;
+	int ret;
+
+	if (!nr_iters || nr_flows > TEST_QMI_MAX_FLOWS)
+		return -EINVAL;
+
+	ind = kzalloc(sizeof(*ind), GFP_KERNEL);
+	named = kzalloc(sizeof(*named), GFP_KERNEL);
+	if (!ind || !named) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	ind->timestamp[0] = get_random_u64();
+	ind->timestamp[1] = get_random_u64();
+	ind->resp.result = QMI_RESULT_SUCCESS_V01;
+	ind->resp.error = QMI_ERR_NONE_V01;
+	ind->flows_valid = 1;
+	ind->flows_len = nr_flows;
+	for (i = 0; i < nr_flows; i++) {
+		ind->flows[i].mux_id = i;
+		ind->flows[i].bearer_id = get_random_u32();
+		ind->flows[i].num_bytes = get_random_u32();
+		ind->flows[i].seq_num = get_random_u32();
+		get_random_bytes(ind->flows[i].qos_ids,
+				 sizeof(ind->flows[i].qos_ids));
+	}
+	ind->eod_valid = 1;
+	ind->eod = 1;
+	ind->ids_valid = 1;
+	ind->ids_len = TEST_QMI_MAX_IDS / 2;
+	for (i = 0; i < ind->ids_len; i++)
+		ind->ids[i] = get_random_u32();
+
+	ret = test_qmi_check("flow_ind", test_qmi_ind_ei, ind, sizeof(*ind),
+			     TEST_QMI_IND_MAX_LEN, true);
+	if (ret)
+		goto out;
+
+	/* The unset optional TLVs must decode back to zero as well */
+	ind->eod_valid = 0;
+	ind->eod = 0;
+	ind->ids_valid = 0;
+	ind->ids_len = 0;
+	memset(ind->ids, 0, sizeof(ind->ids));
+	ret = test_qmi_check("flow_ind_sparse", test_qmi_ind_ei, ind,
+			     sizeof(*ind), TEST_QMI_IND_MAX_LEN, true);
+	if (ret)
+		goto out;
+
+	named->id = get_random_u32();
+	strlcpy(named->name, "test_qmi_encdec", sizeof(named->name));
+	ret = test_qmi_check("named", test_qmi_named_ei, named, sizeof(*named),
+			     TEST_QMI_NAMED_MAX_LEN, false);
+
+out:
+	kfree(named);
+	kfree(ind);
+	return ret;
+}
+
+static void __exit test_qmi_encdec_exit(void)
+{
+}
+
+module_init(test_qmi_encdec_init);
+module_exit(test_qmi_encdec_exit);
+
+MODULE_DESCRIPTION("QMI encoder/decoder microbenchmark");
+MODULE_LICENSE("GPL");
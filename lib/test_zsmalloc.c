@@ -0,0 +1,160 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Concurrent zs_malloc()/zs_free() microbenchmark.
+ *
+ * One thread per online cpu (or nr_threads) allocates and frees objects
+ * of pseudo-random size across all size classes of a shared pool, keeping
+ * a window of live objects so zspages go through every fullness group.
+ * Per-thread and aggregate throughput are reported in the kernel log.
+ */
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/kthread.h>
+#include <linux/completion.h>
+#include <linux/random.h>
+#include <linux/slab.h>
+#include <linux/ktime.h>
+#include <linux/atomic.h>
+#include <linux/zsmalloc.h>
+
+static unsigned int nr_threads;
+module_param(nr_threads, uint, 0444);
+MODULE_PARM_DESC(nr_threads, "Number of threads (default: online cpus)");
+
+static unsigned int nr_ops = 1 << 20;
+module_param(nr_ops, uint, 0444);
+MODULE_PARM_DESC(nr_ops, "Allocations per thread");
+
+static unsigned int nr_live = 512;
+module_param(nr_live, uint, 0444);
+MODULE_PARM_DESC(nr_live, "Live objects kept by each thread");
+
+static unsigned int max_size = PAGE_SIZE / 2;
+module_param(max_size, uint, 0444);
+MODULE_PARM_DESC(max_size, "Largest object size in bytes");
+
+struct zs_bench_thread {
+	struct zs_pool *pool;
+	struct task_struct *task;
+	u64 elapsed_ns;
+	unsigned int failed;
+};
+
+static atomic_t zs_bench_running;
+static DECLARE_COMPLETION(zs_bench_start);
+static DECLARE_COMPLETION(zs_bench_done);
+
+static int zs_bench_fn(void *data)
+{
+	struct zs_bench_thread *t = data;
+	unsigned long *handles;
+	unsigned int i, slot;
+	u32 seed = get_random_u32();
+	ktime_t start;
+
+	handles = kcalloc(nr_live, sizeof(*handles), GFP_KERNEL);
+	if (!handles) {
+		t->failed = nr_ops;
+		goto out;
+	}
+
+	wait_for_completion(&zs_bench_start);
+
+	start = ktime_get();
+	for (i = 0; i < nr_ops; i++) {
+		slot = i % nr_live;
+		if (handles[slot])
+			zs_free(t->pool, handles[slot]);
+
+		seed = seed * 1664525 + 1013904223;
+		handles[slot] = zs_malloc(t->pool, 1 + (seed >> 8) % max_size,
+					  GFP_KERNEL | __GFP_NOWARN);
+		if (!handles[slot])
+			t->failed++;
+
+		if (!(i & 1023))
+			cond_resched();
+	}
+
+	for (slot = 0; slot < nr_live; slot++)
+		zs_free(t->pool, handles[slot]);
+	t->elapsed_ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	kfree(handles);
+out:
+	if (atomic_dec_and_test(&zs_bench_running))
+		complete(&zs_bench_done);
+	return 0;
+}
+
+static int __init test_zsmalloc_init(void)
+{
+	struct zs_bench_thread *threads;
+	struct zs_pool *pool;
+	u64 total_ops = 0, ns;
+	unsigned int i;
+	int ret = 0;
+
+	if (!nr_threads)
+		nr_threads = num_online_cpus();
+	if (!nr_live || !max_size || max_size > PAGE_SIZE)
+		return -EINVAL;
+
+	pool = zs_create_pool("test_zsmalloc");
+	if (!pool)
+		return -ENOMEM;
+
+	threads = kcalloc(nr_threads, sizeof(*threads), GFP_KERNEL);
+	if (!threads) {
+		ret = -ENOMEM;
+		goto out_pool;
+	}
+
+	atomic_set(&zs_bench_running, nr_threads);
+	for (i = 0; i < nr_threads; i++) {
+		threads[i].pool = pool;
+		threads[i].task = kthread_run(zs_bench_fn, &threads[i],
+					      "zs_bench/%u", i);
+		if (IS_ERR(threads[i].task)) {
+			pr_err("failed to start thread %u\n", i);
+			threads[i].task = NULL;
+			if (atomic_dec_and_test(&zs_bench_running))
+				complete(&zs_bench_done);
+		}
+	}
+
+	complete_all(&zs_bench_start);
+	wait_for_completion(&zs_bench_done);
+
+	for (i = 0; i < nr_threads; i++) {
+		if (!threads[i].task)
+			continue;
+
+		ns = max_t(u64, threads[i].elapsed_ns, 1);
+		pr_info("thread %u: %u ops in %llu us, %llu kops/s, %u failed\n",
+			i, nr_ops, ns / NSEC_PER_USEC,
+			div64_u64((u64)nr_ops * NSEC_PER_MSEC, ns),
+			threads[i].failed);
+		total_ops += div64_u64((u64)nr_ops * NSEC_PER_MSEC, ns);
+	}
+	pr_info("%u threads, %llu kops/s total, %lu pages left in pool\n",
+		nr_threads, total_ops, zs_get_total_pages(pool));
+
+	kfree(threads);
+out_pool:
+	zs_destroy_pool(pool);
+	return ret;
+}
+
+static void __exit test_zsmalloc_exit(void)
+{
+}
+
+module_init(test_zsmalloc_init);
+module_exit(test_zsmalloc_exit);
+
+MODULE_DESCRIPTION("zsmalloc concurrency microbenchmark");
+MODULE_LICENSE("GPL");
@@ -38,6 +38,7 @@
 #include <linux/rmap.h>
 #include <linux/delayacct.h>
 #include <linux/psi.h>
+#include <linux/launch_prefetch.h>
 #include "internal.h"
 
 #define CREATE_TRACE_POINTS
@@ -2400,6 +2401,8 @@ static struct file *do_sync_mmap_readahead(struct vm_fault *vmf)
 	struct file *fpin = NULL;
 	pgoff_t offset = vmf->pgoff;
 
+	launch_prefetch_record(mapping, offset, 1);
+
 	/* If we don't want any read-ahead, don't bother */
 	if (vmf->vma->vm_flags & VM_RAND_READ)
 		return fpin;
@@ -100,12 +100,20 @@
  * @mm_list: link into the mm_slots list, rooted in ksm_mm_head
  * @rmap_list: head for this mm_slot's singly-linked list of rmap_items
  * @mm: the mm that this information is valid for
+ * @merged: pages merged so far in the current scan of this mm
+ * @fresh: scans left during which this newly added mm is never skipped
+ * @idle_scans: consecutive scans of this mm that merged nothing
+ * @skip: full scans this mm sits out before it is scanned again
  */
 struct mm_slot {
 	struct hlist_node link;
 	struct list_head mm_list;
 	struct rmap_item *rmap_list;
 	struct mm_struct *mm;
+	unsigned long merged;
+	unsigned int fresh;
+	unsigned int idle_scans;
+	unsigned int skip;
 };
 
 /**
@@ -256,6 +264,19 @@ static unsigned int ksm_thread_pages_to_scan = 100;
 /* Milliseconds ksmd should sleep between batches */
 static unsigned int ksm_thread_sleep_millisecs = 20;
 
+/* Most full scans an mm that keeps merging nothing is left out of */
+static unsigned int ksm_max_skip_scans = 8;
+
+/* Scans during which a newly forked or advised mm is never skipped */
+#define KSM_FRESH_SCANS		4
+
+/* Scans of an mm skipped because it merged nothing before */
+static unsigned long ksm_skipped_scans;
+
+/* Pages merged by ksmd, and the CPU time it took to scan for them */
+static unsigned long ksm_pages_merged;
+static u64 ksm_scan_time_ns;
+
 /* Checksum of an empty (zeroed) page */
 static unsigned int zero_checksum __read_mostly;
 
@@ -803,6 +824,49 @@ static void remove_trailing_rmap_items(struct mm_slot *mm_slot,
 	}
 }
 
+/*
+ * The unstable tree is rebuilt on every full scan and
+ * remove_rmap_item_from_tree() only copes with rmap_items one scan old,
+ * so drop the unstable ones of an mm that sits out a scan right away:
+ * none of them can be in the tree being built.
+ */
+static void forget_unstable_rmap_items(struct mm_slot *mm_slot)
+{
+	struct rmap_item *rmap_item;
+
+	for (rmap_item = mm_slot->rmap_list; rmap_item;
+	     rmap_item = rmap_item->rmap_list) {
+		if (rmap_item->address & UNSTABLE_FLAG) {
+			rmap_item->address &= PAGE_MASK;
+			ksm_pages_unshared--;
+		}
+	}
+}
+
+/*
+ * Called once a scan of @mm_slot's mm is complete. An mm that keeps
+ * merging nothing has settled, or only holds volatile data: leave it out
+ * of the next 1, 2, 4... full scans, up to ksm_max_skip_scans, until it
+ * merges something again.
+ */
+static void ksm_mm_slot_scanned(struct mm_slot *mm_slot)
+{
+	if (mm_slot->merged) {
+		mm_slot->idle_scans = 0;
+	} else if (mm_slot->fresh) {
+		/* fork children need a few scans to diverge from the parent */
+	} else {
+		mm_slot->skip = min(ksm_max_skip_scans,
+				    1U << mm_slot->idle_scans);
+		if (mm_slot->idle_scans < 31)
+			mm_slot->idle_scans++;
+	}
+
+	if (mm_slot->fresh)
+		mm_slot->fresh--;
+	mm_slot->merged = 0;
+}
+
 /*
  * Though it's very tempting to unmerge rmap_items from stable tree rather
  * than check every pte of a given vma, the locking doesn't quite work for
@@ -2244,6 +2308,24 @@ static struct rmap_item *scan_get_next_rmap_item(struct page **page)
 next_mm:
 		ksm_scan.address = 0;
 		ksm_scan.rmap_list = &slot->rmap_list;
+
+		if (slot->skip && !ksm_test_exit(slot->mm)) {
+			slot->skip--;
+			ksm_skipped_scans++;
+			forget_unstable_rmap_items(slot);
+
+			spin_lock(&ksm_mmlist_lock);
+			slot = list_entry(slot->mm_list.next,
+					  struct mm_slot, mm_list);
+			ksm_scan.mm_slot = slot;
+			spin_unlock(&ksm_mmlist_lock);
+
+			if (slot != &ksm_mm_head)
+				goto next_mm;
+
+			ksm_scan.seqnr++;
+			return NULL;
+		}
 	}
 
 	mm = slot->mm;
@@ -2299,6 +2381,7 @@ static struct rmap_item *scan_get_next_rmap_item(struct page **page)
 	 * because there were no VM_MERGEABLE vmas with such addresses.
 	 */
 	remove_trailing_rmap_items(slot, ksm_scan.rmap_list);
+	ksm_mm_slot_scanned(slot);
 
 	spin_lock(&ksm_mmlist_lock);
 	ksm_scan.mm_slot = list_entry(slot->mm_list.next,
@@ -2348,17 +2431,27 @@ static struct rmap_item *scan_get_next_rmap_item(struct page **page)
  */
 static void ksm_do_scan(unsigned int scan_npages)
 {
+	u64 start = current->se.sum_exec_runtime;
 	struct rmap_item *rmap_item;
+	unsigned long sharing;
 	struct page *page;
 
 	while (scan_npages-- && likely(!freezing(current))) {
 		cond_resched();
 		rmap_item = scan_get_next_rmap_item(&page);
 		if (!rmap_item)
-			return;
+			break;
+		sharing = ksm_pages_sharing;
 		cmp_and_merge_page(page, rmap_item);
 		put_page(page);
+		if (ksm_pages_sharing > sharing) {
+			/* still the cursor, __ksm_exit() leaves that alone */
+			ksm_scan.mm_slot->merged++;
+			ksm_pages_merged++;
+		}
 	}
+
+	ksm_scan_time_ns += current->se.sum_exec_runtime - start;
 }
 
 static int ksmd_should_run(void)
@@ -2446,6 +2539,7 @@ int __ksm_enter(struct mm_struct *mm)
 	mm_slot = alloc_mm_slot();
 	if (!mm_slot)
 		return -ENOMEM;
+	mm_slot->fresh = KSM_FRESH_SCANS;
 
 	/* Check ksm_run too?  Would need tighter locking */
 	needs_wakeup = list_empty(&ksm_mm_head.mm_list);
@@ -3077,6 +3171,61 @@ static ssize_t full_scans_show(struct kobject *kobj,
 }
 KSM_ATTR_RO(full_scans);
 
+static ssize_t max_skip_scans_show(struct kobject *kobj,
+				   struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_max_skip_scans);
+}
+
+static ssize_t max_skip_scans_store(struct kobject *kobj,
+				    struct kobj_attribute *attr,
+				    const char *buf, size_t count)
+{
+	unsigned int scans;
+	int err;
+
+	err = kstrtouint(buf, 10, &scans);
+	if (err)
+		return -EINVAL;
+
+	ksm_max_skip_scans = scans;
+
+	return count;
+}
+KSM_ATTR(max_skip_scans);
+
+static ssize_t skipped_scans_show(struct kobject *kobj,
+				  struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_skipped_scans);
+}
+KSM_ATTR_RO(skipped_scans);
+
+static ssize_t pages_merged_show(struct kobject *kobj,
+				 struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_pages_merged);
+}
+KSM_ATTR_RO(pages_merged);
+
+static ssize_t scan_time_ms_show(struct kobject *kobj,
+				 struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%llu\n", div_u64(ksm_scan_time_ns, NSEC_PER_MSEC));
+}
+KSM_ATTR_RO(scan_time_ms);
+
+/* Pages merged per second of CPU time ksmd spent scanning */
+static ssize_t merged_per_cpu_sec_show(struct kobject *kobj,
+				       struct kobj_attribute *attr, char *buf)
+{
+	u64 ms = div_u64(ksm_scan_time_ns, NSEC_PER_MSEC);
+	u64 merged = (u64)ksm_pages_merged * MSEC_PER_SEC;
+
+	return sprintf(buf, "%llu\n", ms ? div64_u64(merged, ms) : 0);
+}
+KSM_ATTR_RO(merged_per_cpu_sec);
+
 static struct attribute *ksm_attrs[] = {
 	&sleep_millisecs_attr.attr,
 	&pages_to_scan_attr.attr,
@@ -3094,6 +3243,11 @@ static struct attribute *ksm_attrs[] = {
 	&stable_node_dups_attr.attr,
 	&stable_node_chains_prune_millisecs_attr.attr,
 	&use_zero_pages_attr.attr,
+	&max_skip_scans_attr.attr,
+	&skipped_scans_attr.attr,
+	&pages_merged_attr.attr,
+	&scan_time_ms_attr.attr,
+	&merged_per_cpu_sec_attr.attr,
 	NULL,
 };
 
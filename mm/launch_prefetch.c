@@ -0,0 +1,595 @@
+/*
+ * Copyright (c) 2020, The Linux Foundation. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Launch prefetch
+ *
+ * Userspace brackets an app launch by writing "start <uid>" and
+ * "stop <uid>" to /proc/launch_prefetch. While the launch runs, the page
+ * cache misses taken by tasks of that uid are recorded. At stop they are
+ * sorted and merged into ranges that are kept as the uid's trace, and the
+ * next start reads the trace ahead in large batches before the app gets to
+ * fault the pages in one small read at a time.
+ *
+ * When a launch was prefetched, stop also looks at which of the pages the
+ * app used. Ranges it didn't use are dropped from the trace, and the counts
+ * for the last launch of each uid are shown when the file is read.
+ */
+
+#include <linux/blkdev.h>
+#include <linux/cred.h>
+#include <linux/fs.h>
+#include <linux/launch_prefetch.h>
+#include <linux/list.h>
+#include <linux/mm.h>
+#include <linux/mutex.h>
+#include <linux/pagemap.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
+#include <linux/spinlock.h>
+#include <linux/uaccess.h>
+#include <linux/workqueue.h>
+#include "internal.h"
+
+#define LP_MAX_SESSIONS		4
+#define LP_MAX_TRACES		32
+#define LP_MAX_FILES		256
+/* Misses kept while recording a launch, and ranges kept in a trace */
+#define LP_MAX_RECORDS		8192
+#define LP_MAX_RANGES		4096
+/* Ranges closer than this many pages are read as one */
+#define LP_MERGE_GAP		8
+#define LP_MAX_RANGE_PAGES	((2 * 1024 * 1024) / PAGE_SIZE)
+#define LP_MIN_RANGE_PAGES	((VM_MIN_READAHEAD * 1024) / PAGE_SIZE)
+/* A launch that is never stopped ends after this long */
+#define LP_SESSION_TIMEOUT	(30 * HZ)
+
+struct lp_file {
+	dev_t dev;
+	u32 generation;
+	unsigned long ino;
+};
+
+struct lp_range {
+	u32 start;
+	u16 nr;
+	u16 file;
+};
+
+struct lp_trace {
+	struct list_head list;
+	uid_t uid;
+	unsigned int nr_files;
+	unsigned int nr_ranges;
+	struct lp_file *files;
+	struct lp_range *ranges;
+	unsigned long replays;
+	/* Counts for the last launch, in pages */
+	unsigned long misses;
+	unsigned long prefetched;
+	unsigned long cached;
+	unsigned long used;
+	unsigned long wasted;
+};
+
+struct lp_session {
+	spinlock_t lock;
+	bool active;
+	uid_t uid;
+	unsigned long deadline;
+	unsigned int nr_files;
+	unsigned int nr_records;
+	unsigned long misses;
+	struct lp_file *files;
+	struct lp_range *records;
+	/* Trace being prefetched, owned by the session until it stops */
+	struct lp_trace *trace;
+	struct work_struct replay_work;
+	struct delayed_work timeout_work;
+};
+
+atomic_t launch_prefetch_sessions;
+
+static struct lp_session lp_sessions[LP_MAX_SESSIONS];
+static LIST_HEAD(lp_traces);
+static unsigned int lp_nr_traces;
+/* Protects lp_traces and starting and stopping sessions */
+static DEFINE_MUTEX(lp_mutex);
+
+static int lp_file_index(struct lp_session *s, struct inode *inode)
+{
+	unsigned int i;
+
+	/* Misses tend to come in runs on the same file */
+	for (i = s->nr_files; i-- > 0; )
+		if (s->files[i].ino == inode->i_ino &&
+		    s->files[i].dev == inode->i_sb->s_dev)
+			return i;
+
+	if (s->nr_files >= LP_MAX_FILES)
+		return -ENOSPC;
+
+	s->files[s->nr_files].dev = inode->i_sb->s_dev;
+	s->files[s->nr_files].ino = inode->i_ino;
+	s->files[s->nr_files].generation = inode->i_generation;
+	return s->nr_files++;
+}
+
+void __launch_prefetch_record(struct address_space *mapping, pgoff_t offset,
+			      unsigned long nr)
+{
+	struct inode *inode = mapping->host;
+	struct lp_range *r;
+	uid_t uid;
+	int i, file;
+
+	/* Prefetch can only read back files on a block device */
+	if ((current->flags & PF_KTHREAD) || !inode || !inode->i_sb->s_bdev ||
+	    offset > U32_MAX)
+		return;
+
+	uid = from_kuid(&init_user_ns, current_uid());
+	for (i = 0; i < LP_MAX_SESSIONS; i++) {
+		struct lp_session *s = &lp_sessions[i];
+
+		if (!READ_ONCE(s->active) || READ_ONCE(s->uid) != uid)
+			continue;
+
+		spin_lock(&s->lock);
+		if (s->active && s->uid == uid) {
+			s->misses += nr;
+			file = lp_file_index(s, inode);
+			if (file >= 0 && s->nr_records < LP_MAX_RECORDS) {
+				r = &s->records[s->nr_records++];
+				r->start = offset;
+				r->nr = min_t(unsigned long, nr,
+					      LP_MAX_RANGE_PAGES);
+				r->file = file;
+			}
+		}
+		spin_unlock(&s->lock);
+		return;
+	}
+}
+
+static int lp_range_cmp(const void *a, const void *b)
+{
+	const struct lp_range *ra = a, *rb = b;
+
+	if (ra->file != rb->file)
+		return ra->file < rb->file ? -1 : 1;
+	if (ra->start != rb->start)
+		return ra->start < rb->start ? -1 : 1;
+	return 0;
+}
+
+/*
+ * Sort @r by file and offset and merge ranges that overlap or are less
+ * than LP_MERGE_GAP pages apart. Files keep the order the launch first
+ * touched them in, so the files needed first are read first.
+ */
+static unsigned int lp_merge(struct lp_range *r, unsigned int nr)
+{
+	unsigned int i, out = 0;
+
+	if (!nr)
+		return 0;
+
+	sort(r, nr, sizeof(*r), lp_range_cmp, NULL);
+	for (i = 1; i < nr; i++) {
+		struct lp_range *last = &r[out];
+		u64 end = (u64)last->start + last->nr;
+		u64 new_end = max_t(u64, end, (u64)r[i].start + r[i].nr);
+
+		if (r[i].file == last->file &&
+		    r[i].start <= end + LP_MERGE_GAP &&
+		    new_end - last->start <= LP_MAX_RANGE_PAGES) {
+			last->nr = new_end - last->start;
+			continue;
+		}
+		r[++out] = r[i];
+	}
+
+	return out + 1;
+}
+
+/*
+ * Call @fn on each range of @t with the page cache of its file. Files are
+ * only looked up in the inode cache; when the inode is gone so are its
+ * pages, and reading it back would mean a path walk.
+ */
+static void lp_walk(struct lp_trace *t,
+		    void (*fn)(struct lp_trace *, struct address_space *,
+			       struct lp_range *))
+{
+	unsigned int i = 0;
+
+	while (i < t->nr_ranges) {
+		unsigned int file = t->ranges[i].file;
+		struct lp_file *f = &t->files[file];
+		struct inode *inode = NULL;
+		struct super_block *sb;
+		struct blk_plug plug;
+
+		/* Hold s_umount so the inode can't outlive its sb */
+		sb = user_get_super(f->dev);
+		if (sb) {
+			inode = ilookup(sb, f->ino);
+			if (inode && inode->i_generation != f->generation) {
+				iput(inode);
+				inode = NULL;
+			}
+		}
+
+		blk_start_plug(&plug);
+		for (; i < t->nr_ranges && t->ranges[i].file == file; i++)
+			if (inode)
+				fn(t, inode->i_mapping, &t->ranges[i]);
+		blk_finish_plug(&plug);
+
+		iput(inode);
+		if (sb)
+			drop_super(sb);
+		cond_resched();
+	}
+}
+
+static void lp_prefetch_range(struct lp_trace *t,
+			      struct address_space *mapping, struct lp_range *r)
+{
+	unsigned long nr = max_t(unsigned long, r->nr, LP_MIN_RANGE_PAGES);
+	int done;
+
+	done = __do_page_cache_readahead(mapping, NULL, r->start, nr, 0);
+	if (done < 0)
+		return;
+
+	t->prefetched += done;
+	if (done < r->nr)
+		t->cached += r->nr - done;
+}
+
+static void lp_check_range(struct lp_trace *t, struct address_space *mapping,
+			   struct lp_range *r)
+{
+	bool used = false;
+	pgoff_t index;
+
+	for (index = r->start; index < r->start + r->nr; index++) {
+		struct page *page = find_get_page(mapping, index);
+
+		if (!page)
+			continue;
+
+		if (PageReferenced(page) || PageActive(page) ||
+		    page_mapped(page)) {
+			t->used++;
+			used = true;
+		} else {
+			t->wasted++;
+		}
+		put_page(page);
+	}
+
+	/* Drop the range from the trace */
+	if (!used)
+		r->nr = 0;
+}
+
+static void lp_replay_fn(struct work_struct *work)
+{
+	struct lp_session *s = container_of(work, struct lp_session,
+					    replay_work);
+
+	lp_walk(s->trace, lp_prefetch_range);
+}
+
+static struct lp_trace *lp_find_trace(uid_t uid)
+{
+	struct lp_trace *t;
+
+	list_for_each_entry(t, &lp_traces, list)
+		if (t->uid == uid)
+			return t;
+	return NULL;
+}
+
+static void lp_free_trace(struct lp_trace *t)
+{
+	kvfree(t->files);
+	kvfree(t->ranges);
+	kfree(t);
+}
+
+static void lp_add_trace(struct lp_trace *t)
+{
+	list_add(&t->list, &lp_traces);
+	if (++lp_nr_traces > LP_MAX_TRACES) {
+		struct lp_trace *old = list_last_entry(&lp_traces,
+						       struct lp_trace, list);
+
+		list_del(&old->list);
+		lp_nr_traces--;
+		lp_free_trace(old);
+	}
+}
+
+static struct lp_session *lp_find_session(uid_t uid)
+{
+	int i;
+
+	for (i = 0; i < LP_MAX_SESSIONS; i++)
+		if (lp_sessions[i].active && lp_sessions[i].uid == uid)
+			return &lp_sessions[i];
+	return NULL;
+}
+
+static int lp_session_start(uid_t uid)
+{
+	struct lp_session *s = NULL;
+	struct lp_trace *t;
+	int i;
+
+	if (lp_find_session(uid))
+		return -EBUSY;
+
+	for (i = 0; i < LP_MAX_SESSIONS && !s; i++)
+		if (!lp_sessions[i].active)
+			s = &lp_sessions[i];
+	if (!s)
+		return -EBUSY;
+
+	s->files = kvmalloc_array(LP_MAX_FILES, sizeof(*s->files), GFP_KERNEL);
+	s->records = kvmalloc_array(LP_MAX_RECORDS, sizeof(*s->records),
+				    GFP_KERNEL);
+	if (!s->files || !s->records) {
+		kvfree(s->files);
+		kvfree(s->records);
+		s->files = NULL;
+		s->records = NULL;
+		return -ENOMEM;
+	}
+
+	s->nr_files = 0;
+	s->nr_records = 0;
+	s->misses = 0;
+
+	t = lp_find_trace(uid);
+	if (t) {
+		list_del(&t->list);
+		lp_nr_traces--;
+
+		/* Keep the file numbering so the trace's ranges stay valid */
+		memcpy(s->files, t->files, t->nr_files * sizeof(*t->files));
+		s->nr_files = t->nr_files;
+		t->replays++;
+		t->prefetched = 0;
+		t->cached = 0;
+		t->used = 0;
+		t->wasted = 0;
+	}
+	s->trace = t;
+	s->deadline = jiffies + LP_SESSION_TIMEOUT;
+
+	spin_lock(&s->lock);
+	s->uid = uid;
+	s->active = true;
+	spin_unlock(&s->lock);
+	atomic_inc(&launch_prefetch_sessions);
+
+	if (t)
+		queue_work(system_unbound_wq, &s->replay_work);
+	mod_delayed_work(system_wq, &s->timeout_work, LP_SESSION_TIMEOUT);
+
+	return 0;
+}
+
+static int lp_save_trace(struct lp_session *s, struct lp_trace *t)
+{
+	u16 map[LP_MAX_FILES];
+	unsigned int i, nr, nr_files = 0;
+	struct lp_range *ranges;
+	struct lp_file *files;
+
+	nr = min_t(unsigned int, lp_merge(s->records, s->nr_records),
+		   LP_MAX_RANGES);
+
+	/* Renumber the files, leaving out the ones no range refers to */
+	memset(map, 0xff, sizeof(map));
+	for (i = 0; i < nr; i++)
+		if (map[s->records[i].file] == U16_MAX)
+			map[s->records[i].file] = nr_files++;
+
+	ranges = kvmalloc_array(nr, sizeof(*ranges), GFP_KERNEL);
+	files = kvmalloc_array(nr_files, sizeof(*files), GFP_KERNEL);
+	if (!ranges || !files) {
+		kvfree(ranges);
+		kvfree(files);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < nr; i++) {
+		ranges[i] = s->records[i];
+		ranges[i].file = map[s->records[i].file];
+	}
+	for (i = 0; i < s->nr_files; i++)
+		if (map[i] != U16_MAX)
+			files[map[i]] = s->files[i];
+
+	kvfree(t->ranges);
+	kvfree(t->files);
+	t->ranges = ranges;
+	t->nr_ranges = nr;
+	t->files = files;
+	t->nr_files = nr_files;
+	return 0;
+}
+
+static void lp_session_stop(struct lp_session *s)
+{
+	struct lp_trace *t = s->trace;
+	unsigned int i;
+
+	spin_lock(&s->lock);
+	s->active = false;
+	spin_unlock(&s->lock);
+	atomic_dec(&launch_prefetch_sessions);
+	cancel_delayed_work(&s->timeout_work);
+	flush_work(&s->replay_work);
+
+	/* Carry over the prefetched ranges the launch used */
+	if (t) {
+		lp_walk(t, lp_check_range);
+		for (i = 0; i < t->nr_ranges; i++) {
+			if (!t->ranges[i].nr)
+				continue;
+			if (s->nr_records >= LP_MAX_RECORDS)
+				break;
+			s->records[s->nr_records++] = t->ranges[i];
+		}
+	} else if (s->nr_records) {
+		t = kzalloc(sizeof(*t), GFP_KERNEL);
+		if (t)
+			t->uid = s->uid;
+	}
+
+	if (t) {
+		t->misses = s->misses;
+		if (lp_save_trace(s, t) || !t->nr_ranges)
+			lp_free_trace(t);
+		else
+			lp_add_trace(t);
+	}
+
+	s->trace = NULL;
+	kvfree(s->files);
+	kvfree(s->records);
+	s->files = NULL;
+	s->records = NULL;
+}
+
+static void lp_timeout_fn(struct work_struct *work)
+{
+	struct lp_session *s = container_of(to_delayed_work(work),
+					    struct lp_session, timeout_work);
+
+	mutex_lock(&lp_mutex);
+	/* The slot may have been stopped and started again since */
+	if (s->active && time_after_eq(jiffies, s->deadline))
+		lp_session_stop(s);
+	mutex_unlock(&lp_mutex);
+}
+
+static int lp_drop_trace(uid_t uid)
+{
+	struct lp_trace *t = lp_find_trace(uid);
+
+	if (!t)
+		return lp_find_session(uid) ? -EBUSY : -ENOENT;
+
+	list_del(&t->list);
+	lp_nr_traces--;
+	lp_free_trace(t);
+	return 0;
+}
+
+static ssize_t lp_write(struct file *file, const char __user *buf,
+			size_t count, loff_t *ppos)
+{
+	struct lp_session *s;
+	char kbuf[32], cmd[8];
+	unsigned int uid;
+	int ret;
+
+	if (count >= sizeof(kbuf))
+		return -EINVAL;
+	if (copy_from_user(kbuf, buf, count))
+		return -EFAULT;
+	kbuf[count] = '\0';
+
+	if (sscanf(kbuf, "%7s %u", cmd, &uid) != 2)
+		return -EINVAL;
+
+	mutex_lock(&lp_mutex);
+	if (!strcmp(cmd, "start")) {
+		ret = lp_session_start(uid);
+	} else if (!strcmp(cmd, "stop")) {
+		s = lp_find_session(uid);
+		ret = s ? 0 : -ENOENT;
+		if (s)
+			lp_session_stop(s);
+	} else if (!strcmp(cmd, "drop")) {
+		ret = lp_drop_trace(uid);
+	} else {
+		ret = -EINVAL;
+	}
+	mutex_unlock(&lp_mutex);
+
+	return ret ? ret : count;
+}
+
+static int lp_show(struct seq_file *m, void *v)
+{
+	struct lp_trace *t;
+	unsigned long pages;
+	unsigned int i;
+
+	seq_puts(m, "uid replays files ranges pages misses prefetched cached "
+		 "used wasted\n");
+
+	mutex_lock(&lp_mutex);
+	list_for_each_entry(t, &lp_traces, list) {
+		pages = 0;
+		for (i = 0; i < t->nr_ranges; i++)
+			pages += t->ranges[i].nr;
+
+		seq_printf(m, "%u %lu %u %u %lu %lu %lu %lu %lu %lu\n",
+			   t->uid, t->replays, t->nr_files, t->nr_ranges,
+			   pages, t->misses, t->prefetched, t->cached,
+			   t->used, t->wasted);
+	}
+	mutex_unlock(&lp_mutex);
+
+	return 0;
+}
+
+static int lp_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, lp_show, NULL);
+}
+
+static const struct file_operations lp_fops = {
+	.open		= lp_open,
+	.read		= seq_read,
+	.write		= lp_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init launch_prefetch_init(void)
+{
+	int i;
+
+	for (i = 0; i < LP_MAX_SESSIONS; i++) {
+		spin_lock_init(&lp_sessions[i].lock);
+		INIT_WORK(&lp_sessions[i].replay_work, lp_replay_fn);
+		INIT_DELAYED_WORK(&lp_sessions[i].timeout_work,
+				  lp_timeout_fn);
+	}
+
+	if (!proc_create("launch_prefetch", 0600, NULL, &lp_fops))
+		return -ENOMEM;
+
+	return 0;
+}
+module_init(launch_prefetch_init);
@@ -2472,6 +2472,66 @@ void memcg_kmem_uncharge(struct page *page, int order)
 
 	css_put_many(&memcg->css, nr_pages);
 }
+
+/**
+ * memcg_kmem_charge_nr: charge pages to the current memory cgroup without
+ * tagging them
+ * @gfp: reclaim mode
+ * @nr_pages: number of pages to charge
+ *
+ * For drivers that map their pages to userspace, which rules out
+ * PageKmemcg. The caller keeps the returned cgroup and hands it back to
+ * memcg_kmem_uncharge_nr() when the pages are released.
+ *
+ * Returns the charged memory cgroup, NULL if nothing was charged or an
+ * ERR_PTR() if the charge failed.
+ */
+struct mem_cgroup *memcg_kmem_charge_nr(gfp_t gfp, unsigned int nr_pages)
+{
+	struct mem_cgroup *memcg;
+	struct page_counter *counter;
+	int ret;
+
+	if (!memcg_kmem_enabled() || memcg_kmem_bypass())
+		return NULL;
+
+	memcg = get_mem_cgroup_from_mm(current->mm);
+	if (mem_cgroup_is_root(memcg)) {
+		css_put(&memcg->css);
+		return NULL;
+	}
+
+	ret = try_charge(memcg, gfp, nr_pages);
+	if (!ret && !cgroup_subsys_on_dfl(memory_cgrp_subsys) &&
+	    !page_counter_try_charge(&memcg->kmem, nr_pages, &counter)) {
+		cancel_charge(memcg, nr_pages);
+		ret = -ENOMEM;
+	}
+
+	/* The charge itself holds a reference per page */
+	css_put(&memcg->css);
+	return ret ? ERR_PTR(ret) : memcg;
+}
+
+/**
+ * memcg_kmem_uncharge_nr: uncharge pages charged by memcg_kmem_charge_nr()
+ * @memcg: memory cgroup returned by memcg_kmem_charge_nr(), may be NULL
+ * @nr_pages: number of pages to uncharge
+ */
+void memcg_kmem_uncharge_nr(struct mem_cgroup *memcg, unsigned int nr_pages)
+{
+	if (!memcg)
+		return;
+
+	if (!cgroup_subsys_on_dfl(memory_cgrp_subsys))
+		page_counter_uncharge(&memcg->kmem, nr_pages);
+
+	page_counter_uncharge(&memcg->memory, nr_pages);
+	if (do_memsw_account())
+		page_counter_uncharge(&memcg->memsw, nr_pages);
+
+	css_put_many(&memcg->css, nr_pages);
+}
 #endif /* !CONFIG_SLOB */
 
 #ifdef CONFIG_TRANSPARENT_HUGEPAGE
@@ -2871,6 +2931,7 @@ enum {
 	RES_MAX_USAGE,
 	RES_FAILCNT,
 	RES_SOFT_LIMIT,
+	RES_FILE_PROTECT,
 };
 
 static u64 mem_cgroup_read_u64(struct cgroup_subsys_state *css,
@@ -2911,6 +2972,8 @@ static u64 mem_cgroup_read_u64(struct cgroup_subsys_state *css,
 		return counter->failcnt;
 	case RES_SOFT_LIMIT:
 		return (u64)memcg->soft_limit * PAGE_SIZE;
+	case RES_FILE_PROTECT:
+		return (u64)memcg->file_protect * PAGE_SIZE;
 	default:
 		BUG();
 	}
@@ -3105,6 +3168,11 @@ static ssize_t mem_cgroup_write(struct kernfs_open_file *of,
 		memcg->soft_limit = nr_pages;
 		ret = 0;
 		break;
+	case RES_FILE_PROTECT:
+		WRITE_ONCE(memcg->file_protect,
+			   nr_pages == PAGE_COUNTER_MAX ? 0 : nr_pages);
+		ret = 0;
+		break;
 	}
 	return ret ?: nbytes;
 }
@@ -3266,6 +3334,15 @@ static int memcg_stat_show(struct seq_file *m, void *v)
 		seq_printf(m, "%s %lu\n", memcg1_event_names[i],
 			   memcg_sum_events(memcg, memcg1_events[i]));
 
+	seq_printf(m, "workingset_refault %lu\n",
+		   memcg_page_state(memcg, WORKINGSET_REFAULT));
+	seq_printf(m, "workingset_activate %lu\n",
+		   memcg_page_state(memcg, WORKINGSET_ACTIVATE));
+	seq_printf(m, "workingset_protect_refault %lu\n",
+		   memcg_page_state(memcg, WORKINGSET_PROTECT_REFAULT));
+	seq_printf(m, "workingset_protect_activate %lu\n",
+		   memcg_page_state(memcg, WORKINGSET_PROTECT_ACTIVATE));
+
 	for (i = 0; i < NR_LRU_LISTS; i++)
 		seq_printf(m, "%s %lu\n", mem_cgroup_lru_names[i],
 			   mem_cgroup_nr_lru_pages(memcg, BIT(i)) * PAGE_SIZE);
@@ -3360,6 +3437,22 @@ static int mem_cgroup_swappiness_write(struct cgroup_subsys_state *css,
 	return 0;
 }
 
+static s64 mem_cgroup_slab_reclaim_prio_read(struct cgroup_subsys_state *css,
+					     struct cftype *cft)
+{
+	return mem_cgroup_from_css(css)->slab_reclaim_prio;
+}
+
+static int mem_cgroup_slab_reclaim_prio_write(struct cgroup_subsys_state *css,
+					      struct cftype *cft, s64 val)
+{
+	if (val < -DEF_PRIORITY || val > DEF_PRIORITY)
+		return -EINVAL;
+
+	WRITE_ONCE(mem_cgroup_from_css(css)->slab_reclaim_prio, val);
+	return 0;
+}
+
 static void __mem_cgroup_threshold(struct mem_cgroup *memcg, bool swap)
 {
 	struct mem_cgroup_threshold_ary *t;
@@ -4079,6 +4172,12 @@ static struct cftype mem_cgroup_legacy_files[] = {
 		.write = mem_cgroup_write,
 		.read_u64 = mem_cgroup_read_u64,
 	},
+	{
+		.name = "file_protect_in_bytes",
+		.private = MEMFILE_PRIVATE(_MEM, RES_FILE_PROTECT),
+		.write = mem_cgroup_write,
+		.read_u64 = mem_cgroup_read_u64,
+	},
 	{
 		.name = "failcnt",
 		.private = MEMFILE_PRIVATE(_MEM, RES_FAILCNT),
@@ -4108,6 +4207,12 @@ static struct cftype mem_cgroup_legacy_files[] = {
 		.read_u64 = mem_cgroup_swappiness_read,
 		.write_u64 = mem_cgroup_swappiness_write,
 	},
+	{
+		.name = "slab_reclaim_priority",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.read_s64 = mem_cgroup_slab_reclaim_prio_read,
+		.write_s64 = mem_cgroup_slab_reclaim_prio_write,
+	},
 	{
 		.name = "move_charge_at_immigrate",
 		.read_u64 = mem_cgroup_move_charge_read,
@@ -4387,6 +4492,7 @@ mem_cgroup_css_alloc(struct cgroup_subsys_state *parent_css)
 	memcg->soft_limit = PAGE_COUNTER_MAX;
 	if (parent) {
 		memcg->swappiness = mem_cgroup_swappiness(parent);
+		memcg->slab_reclaim_prio = parent->slab_reclaim_prio;
 		memcg->oom_kill_disable = parent->oom_kill_disable;
 	}
 	if (parent && parent->use_hierarchy) {
@@ -5477,6 +5583,10 @@ static int memory_stat_show(struct seq_file *m, void *v)
 		   stat[WORKINGSET_ACTIVATE]);
 	seq_printf(m, "workingset_nodereclaim %lu\n",
 		   stat[WORKINGSET_NODERECLAIM]);
+	seq_printf(m, "workingset_protect_refault %lu\n",
+		   stat[WORKINGSET_PROTECT_REFAULT]);
+	seq_printf(m, "workingset_protect_activate %lu\n",
+		   stat[WORKINGSET_PROTECT_ACTIVATE]);
 
 	return 0;
 }
@@ -3189,6 +3189,9 @@ int do_swap_page(struct vm_fault *vmf)
 		ret = VM_FAULT_MAJOR;
 		count_vm_event(PGMAJFAULT);
 		count_memcg_event_mm(vma->vm_mm, PGMAJFAULT);
+#ifdef CONFIG_PROCESS_RECLAIM
+		atomic_long_inc(&vma->vm_mm->swapin_refaults);
+#endif
 	} else if (PageHWPoison(page)) {
 		/*
 		 * hwpoisoned dirty swapcache pages are kept for killing
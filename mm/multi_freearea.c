@@ -68,6 +68,7 @@
 #include <linux/debugfs.h>
 #include <linux/math64.h>
 #include <linux/writeback.h>
+#include <linux/workqueue.h>
 #include "internal.h"
 
 #include "multi_freearea.h"
@@ -78,6 +79,28 @@
 static unsigned int show_order = 0;
 #define SHOW_ALL (11)
 
+/*
+ * High-order allocations search the labels from the top one down, low-order
+ * ones from the bottom up, so the top label acts as a reserve of contiguous
+ * memory. Its lower boundary is adapted at runtime: direct compaction and
+ * high-order misses in the top label grow it, low-order allocations spilling
+ * into it while high-order demand is served shrink it again. The boundary
+ * moves by FLC_ADAPT_STEP of the zone per round and stays within half a
+ * label of its default position.
+ */
+#define FLC_TOP			(FREE_AREA_COUNTS - 1)
+#define FLC_ADAPT_STEP		64
+
+static bool flc_adapt_enable = true;
+module_param(flc_adapt_enable, bool, 0644);
+
+static unsigned int flc_adapt_interval_ms = 1000;
+module_param(flc_adapt_interval_ms, uint, 0644);
+
+static unsigned long flc_adapt_next;
+static void flc_adapt_fn(struct work_struct *work);
+static DECLARE_WORK(flc_adapt_work, flc_adapt_fn);
+
 static char * const zone_names[MAX_NR_ZONES] = {
 #ifdef CONFIG_ZONE_DMA
 	 "DMA",
@@ -95,6 +118,32 @@ static char * const zone_names[MAX_NR_ZONES] = {
 #endif
 };
 
+/* Same as __fragmentation_index(), restricted to the free lists of @flc */
+static int flc_fragmentation_index(struct zone *zone, int flc,
+				   unsigned int order)
+{
+	unsigned long free_pages = 0, blocks_total = 0, blocks_suitable = 0;
+	unsigned long blocks;
+	unsigned int o;
+
+	for (o = 0; o < MAX_ORDER; o++) {
+		blocks = zone->free_area[flc][o].nr_free;
+		blocks_total += blocks;
+		free_pages += blocks << o;
+		if (o >= order)
+			blocks_suitable += blocks << (o - order);
+	}
+
+	if (!blocks_total)
+		return 0;
+
+	if (blocks_suitable)
+		return -1000;
+
+	return 1000 - div_u64(1000 + div_u64(free_pages * 1000ULL, 1UL << order),
+			      blocks_total);
+}
+
 static int proc_free_area_show(struct seq_file *m, void *p)
 {
 	unsigned int order, t, flc;
@@ -111,8 +160,16 @@ static int proc_free_area_show(struct seq_file *m, void *p)
         }
         seq_printf(m, "---------------------------------------------------------------------------------------------------------------\n");
         seq_printf(m, "zone_name = %s, show_order = %u\n", zone_names[zone_type], show_order);
-        for (flc = 0; flc < FREE_AREA_COUNTS; flc++)
-            seq_printf(m, "[%d]: label = %lu, segment = %lu\n", flc, zone->zone_label[flc].label, zone->zone_label[flc].segment);
+        for (flc = 0; flc < FREE_AREA_COUNTS; flc++) {
+            struct page_label *pl = &zone->zone_label[flc];
+            unsigned int frag_order = show_order < MAX_ORDER ? show_order : HIGH_ORDER_TO_FLC;
+            int index = flc_fragmentation_index(zone, flc, frag_order);
+
+            seq_printf(m, "[%d]: label = %lu, segment = %lu, frag_index(%u) = %d.%03d, high_miss = %lu, low_alloc = %lu, compact = %lu\n",
+                       flc, pl->label, pl->segment, frag_order,
+                       index / 1000, abs(index) % 1000,
+                       pl->high_miss, pl->low_alloc, pl->compact);
+        }
         seq_printf(m, "\n---------------------------------------------------------------------------------------------------------------\n");
         for (flc = 0; flc < FREE_AREA_COUNTS; flc++) {
             seq_printf(m, "flc = %u\n", flc);
@@ -224,6 +281,128 @@ void ajust_zone_label(struct zone *zone)
     }
 }
 
+void flc_account_alloc(struct zone *zone, unsigned int order,
+		       unsigned int flc, bool found)
+{
+	if (order >= HIGH_ORDER_TO_FLC) {
+		if (!found)
+			zone->zone_label[flc].high_miss++;
+	} else if (found) {
+		zone->zone_label[flc].low_alloc++;
+	}
+}
+
+void flc_account_compact(struct zone *zone, struct page *page,
+			 unsigned int order)
+{
+	if (order < HIGH_ORDER_TO_FLC)
+		return;
+
+	/* A failed compaction is charged to the reserve it should have hit */
+	if (page)
+		page_zone(page)->zone_label[page_to_flc(page)].compact++;
+	else
+		zone->zone_label[FLC_TOP].compact++;
+
+	if (!flc_adapt_enable || time_before(jiffies, flc_adapt_next))
+		return;
+
+	flc_adapt_next = jiffies + msecs_to_jiffies(flc_adapt_interval_ms);
+	queue_work(system_unbound_wq, &flc_adapt_work);
+}
+
+static void flc_set_segment(struct zone *zone, int flc)
+{
+	unsigned long prev_base;
+
+	prev_base = flc ? zone->zone_label[flc - 1].label : zone->zone_start_pfn;
+	zone->zone_label[flc].segment = prev_base +
+		((zone->zone_label[flc].label - prev_base) >> 1);
+}
+
+/*
+ * Move the boundary between label FLC_TOP - 1 and FLC_TOP to @new_label and
+ * requeue the free pages that changed label. Called with zone->lock held.
+ */
+static void flc_move_boundary(struct zone *zone, unsigned long new_label)
+{
+	unsigned long old_label = zone->zone_label[FLC_TOP - 1].label;
+	unsigned int order, t;
+	struct page *page, *next;
+	int from, to;
+
+	/* Growing the top label takes pages from the one below and back */
+	from = new_label < old_label ? FLC_TOP - 1 : FLC_TOP;
+
+	zone->zone_label[FLC_TOP - 1].label = new_label;
+	flc_set_segment(zone, FLC_TOP - 1);
+	flc_set_segment(zone, FLC_TOP);
+
+	for_each_migratetype_order(order, t) {
+		struct list_head *list = &zone->free_area[from][order].free_list[t];
+
+		list_for_each_entry_safe(page, next, list, lru) {
+			to = page_to_flc(page);
+			if (to == from)
+				continue;
+
+			list_del(&page->lru);
+			list_sort_add(page, zone, order, t);
+			zone->free_area[from][order].nr_free--;
+			zone->free_area[to][order].nr_free++;
+		}
+	}
+}
+
+static void flc_adapt_zone(struct zone *zone)
+{
+	struct page_label *top = &zone->zone_label[FLC_TOP];
+	unsigned long span = zone->spanned_pages / FREE_AREA_COUNTS;
+	unsigned long def, lo, hi, step, cur, new_label;
+	unsigned long demand, spill;
+	unsigned long flags;
+
+	def = zone->zone_start_pfn + span * (FREE_AREA_COUNTS - 1);
+	lo = max(def - span / 2, zone->zone_label[FLC_TOP - 2].label +
+		 pageblock_nr_pages);
+	hi = def + span / 2;
+	step = max_t(unsigned long,
+		     round_down(zone->spanned_pages / FLC_ADAPT_STEP,
+				pageblock_nr_pages), pageblock_nr_pages);
+
+	spin_lock_irqsave(&zone->lock, flags);
+	demand = (top->compact - top->prev_compact) +
+		 (top->high_miss - top->prev_high_miss);
+	spill = top->low_alloc - top->prev_low_alloc;
+	top->prev_compact = top->compact;
+	top->prev_high_miss = top->high_miss;
+	top->prev_low_alloc = top->low_alloc;
+
+	cur = zone->zone_label[FLC_TOP - 1].label;
+	if (demand > spill)
+		new_label = cur > lo + step ? cur - step : lo;
+	else if (!demand && spill)
+		new_label = min(cur + step, hi);
+	else
+		new_label = cur;
+
+	if (new_label != cur)
+		flc_move_boundary(zone, new_label);
+	spin_unlock_irqrestore(&zone->lock, flags);
+}
+
+static void flc_adapt_fn(struct work_struct *work)
+{
+	struct zone *zone;
+
+	for_each_populated_zone(zone) {
+		/* Labels are set up by ajust_zone_label() */
+		if (!zone->zone_label[FLC_TOP].label)
+			continue;
+		flc_adapt_zone(zone);
+	}
+}
+
 unsigned int ajust_flc(unsigned int current_flc, unsigned int order)
 {
     /* when alloc_order >= HIGH_ORDER_TO_FLC, 
@@ -14,5 +14,9 @@ extern void list_sort_add(struct page *page, struct zone *zone, unsigned int ord
 extern int page_to_flc(struct page *page);
 extern void ajust_zone_label(struct zone *zone);
 extern unsigned int ajust_flc(unsigned int current_flc, unsigned int order);
+extern void flc_account_alloc(struct zone *zone, unsigned int order,
+			      unsigned int flc, bool found);
+extern void flc_account_compact(struct zone *zone, struct page *page,
+				unsigned int order);
 
 #endif //__MULTI_FREEAREA_H__
@@ -0,0 +1,127 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (C) 2018-2020 Oplus. All rights reserved.
+ *
+ * Runtime management of the extra per-node reclaim threads. vm.kswapd_threads
+ * sets the number of reclaim threads per node including kswapd itself; the
+ * way the LRU scanning is split between them lives in mm/vmscan.c.
+ */
+
+#define pr_fmt(fmt) "multi_kswapd: " fmt
+
+#include <linux/kernel.h>
+#include <linux/mm.h>
+#include <linux/mmzone.h>
+#include <linux/kthread.h>
+#include <linux/mutex.h>
+#include <linux/sysctl.h>
+#include <linux/nodemask.h>
+#include <linux/cpumask.h>
+#include <linux/memory_hotplug.h>
+#include <linux/multi_kswapd.h>
+
+int kswapd_threads = 1;
+int max_kswapd_threads = MAX_KSWAPD_THREADS;
+
+static DEFINE_MUTEX(kswapd_threads_lock);
+
+/* Start or stop helpers so that @nid runs @nr reclaim threads */
+static void kswapd_resize(int nid, int nr)
+{
+	pg_data_t *pgdat = NODE_DATA(nid);
+	struct task_struct *tsk;
+	int i;
+
+	lockdep_assert_held(&kswapd_threads_lock);
+
+	/* Let running helpers pick up the smaller split before they stop */
+	if (nr < pgdat->mkswapd_nr)
+		WRITE_ONCE(pgdat->mkswapd_nr, nr);
+
+	for (i = 1; i < MAX_KSWAPD_THREADS; i++) {
+		if (i < nr && !pgdat->mkswapd[i]) {
+			tsk = kthread_create_on_node(kswapd_helper, pgdat, nid,
+						     "kswapd%d:%d", nid, i);
+			if (IS_ERR(tsk)) {
+				pr_err("failed to start helper %d on node %d\n",
+				       i, nid);
+				nr = i;
+				break;
+			}
+			pgdat->mkswapd[i] = tsk;
+			wake_up_process(tsk);
+		} else if (i >= nr && pgdat->mkswapd[i]) {
+			kthread_stop(pgdat->mkswapd[i]);
+			pgdat->mkswapd[i] = NULL;
+		}
+	}
+
+	WRITE_ONCE(pgdat->mkswapd_nr, nr);
+}
+
+int kswapd_run_ext(int nid)
+{
+	mutex_lock(&kswapd_threads_lock);
+	kswapd_resize(nid, kswapd_threads);
+	mutex_unlock(&kswapd_threads_lock);
+
+	return 0;
+}
+
+void kswapd_stop_ext(int nid)
+{
+	mutex_lock(&kswapd_threads_lock);
+	kswapd_resize(nid, 1);
+	mutex_unlock(&kswapd_threads_lock);
+}
+
+void update_kswapd_threads(void)
+{
+	int nid;
+
+	get_online_mems();
+	mutex_lock(&kswapd_threads_lock);
+	for_each_node_state(nid, N_MEMORY)
+		if (NODE_DATA(nid)->kswapd)
+			kswapd_resize(nid, kswapd_threads);
+	mutex_unlock(&kswapd_threads_lock);
+	put_online_mems();
+}
+
+int kswapd_threads_sysctl_handler(struct ctl_table *table, int write,
+				  void __user *buffer, size_t *lenp,
+				  loff_t *ppos)
+{
+	int ret;
+
+	ret = proc_dointvec_minmax(table, write, buffer, lenp, ppos);
+	if (ret || !write)
+		return ret;
+
+	update_kswapd_threads();
+	return 0;
+}
+
+/* Same as kswapd_cpu_online(), for the helpers */
+int kswapd_cpu_online_ext(unsigned int cpu)
+{
+	const struct cpumask *mask;
+	pg_data_t *pgdat;
+	int nid, i;
+
+	mutex_lock(&kswapd_threads_lock);
+	for_each_node_state(nid, N_MEMORY) {
+		pgdat = NODE_DATA(nid);
+		mask = cpumask_of_node(pgdat->node_id);
+
+		if (cpumask_any_and(cpu_online_mask, mask) >= nr_cpu_ids)
+			continue;
+
+		for (i = 1; i < MAX_KSWAPD_THREADS; i++)
+			if (pgdat->mkswapd[i])
+				set_cpus_allowed_ptr(pgdat->mkswapd[i], mask);
+	}
+	mutex_unlock(&kswapd_threads_lock);
+
+	return 0;
+}
@@ -1947,6 +1947,7 @@ struct page *__rmqueue_smallest(struct zone *zone, unsigned int order,
 #if defined(OPLUS_FEATURE_MULTI_FREEAREA) && defined(CONFIG_PHYSICAL_ANTI_FRAGMENTATION)
 		flc_last = page_to_flc(page);
 		zone->free_area[flc_last][current_order].nr_free--;
+		flc_account_alloc(zone, order, flc_tmp, true);
 #else
 		area->nr_free--;
 #endif
@@ -1955,6 +1956,7 @@ struct page *__rmqueue_smallest(struct zone *zone, unsigned int order,
 		return page;
 	}
 #if defined(OPLUS_FEATURE_MULTI_FREEAREA) && defined(CONFIG_PHYSICAL_ANTI_FRAGMENTATION)
+        flc_account_alloc(zone, order, flc_tmp, false);
     }
 #endif
 	return NULL;
@@ -3694,6 +3696,9 @@ __alloc_pages_direct_compact(gfp_t gfp_mask, unsigned int order,
 	count_vm_event(COMPACTSTALL);
 
 	page = get_page_from_freelist(gfp_mask, order, alloc_flags, ac);
+#if defined(OPLUS_FEATURE_MULTI_FREEAREA) && defined(CONFIG_PHYSICAL_ANTI_FRAGMENTATION)
+	flc_account_compact(ac->preferred_zoneref->zone, page, order);
+#endif
 
 	if (page) {
 		struct zone *zone = page_zone(page);
@@ -6533,6 +6538,10 @@ static void __paginginit free_area_init_core(struct pglist_data *pgdat)
 	pgdat->split_queue_len = 0;
 #endif
 	init_waitqueue_head(&pgdat->kswapd_wait);
+#ifdef CONFIG_MULTI_KSWAPD
+	init_waitqueue_head(&pgdat->mkswapd_wait);
+	pgdat->mkswapd_nr = 1;
+#endif
 	init_waitqueue_head(&pgdat->pfmemalloc_wait);
 #ifdef CONFIG_COMPACTION
 	init_waitqueue_head(&pgdat->kcompactd_wait);
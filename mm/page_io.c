@@ -16,6 +16,7 @@
 #include <linux/gfp.h>
 #include <linux/pagemap.h>
 #include <linux/swap.h>
+#include <linux/swapfile.h>
 #include <linux/bio.h>
 #include <linux/swapops.h>
 #include <linux/buffer_head.h>
@@ -69,6 +70,9 @@ void end_swap_bio_write(struct bio *bio)
 			 (unsigned long long)bio->bi_iter.bi_sector);
 		ClearPageReclaim(page);
 	}
+	if (bio->bi_private)
+		swap_ratio_write_done(page_swap_info(page),
+				      (unsigned long)bio->bi_private);
 	end_page_writeback(page);
 	bio_put(bio);
 }
@@ -278,6 +282,7 @@ int __swap_writepage(struct page *page, struct writeback_control *wbc,
 	struct bio *bio;
 	int ret;
 	struct swap_info_struct *sis = page_swap_info(page);
+	unsigned long start;
 
 	VM_BUG_ON_PAGE(!PageSwapCache(page), page);
 	if (sis->flags & SWP_FILE) {
@@ -321,8 +326,11 @@ int __swap_writepage(struct page *page, struct writeback_control *wbc,
 		return ret;
 	}
 
+	start = swap_ratio_write_start(sis);
 	ret = bdev_write_page(sis->bdev, map_swap_page(page, &sis->bdev),
 			      page, wbc);
+	if (start)
+		swap_ratio_write_done(sis, ret ? 0 : start);
 	if (!ret) {
 		count_swpout_vm_event(page);
 		return 0;
@@ -337,6 +345,9 @@ int __swap_writepage(struct page *page, struct writeback_control *wbc,
 		goto out;
 	}
 	bio->bi_opf = REQ_OP_WRITE | wbc_to_write_flags(wbc);
+	/* Only end_swap_bio_write knows to close the latency sample */
+	if (end_write_func == end_swap_bio_write)
+		bio->bi_private = (void *)swap_ratio_write_start(sis);
 	count_swpout_vm_event(page);
 	set_page_writeback(page);
 	unlock_page(page);
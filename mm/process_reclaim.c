@@ -20,6 +20,11 @@
 #include <linux/rcupdate.h>
 #include <linux/notifier.h>
 #include <linux/vmpressure.h>
+#include <linux/proc_fs.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+#include <linux/memcontrol.h>
+#include <linux/cgroup.h>
 
 #define CREATE_TRACE_POINTS
 #include <trace/events/process_reclaim.h>
@@ -49,6 +54,13 @@ module_param_named(pressure_max, pressure_max, ulong, 0644);
 static short min_score_adj = 360;
 module_param_named(min_score_adj, min_score_adj, short, 0644);
 
+/*
+ * Only reclaim anon pages left idle since the previous run over the task,
+ * instead of whatever the walk finds first. Needs CONFIG_IDLE_PAGE_TRACKING.
+ */
+static bool cold_only;
+module_param_named(cold_only, cold_only, bool, 0644);
+
 /*
  * Scheduling process reclaim workqueue unecessarily
  * when the reclaim efficiency is low does not make
@@ -185,7 +197,9 @@ static void swap_fn(struct work_struct *work)
 		if (!nr_to_reclaim)
 			nr_to_reclaim = 1;
 
-		rp = reclaim_task_anon(selected[si].p, nr_to_reclaim);
+		rp = reclaim_task_anon(selected[si].p, nr_to_reclaim,
+				       cold_only &&
+				       IS_ENABLED(CONFIG_IDLE_PAGE_TRACKING));
 
 		trace_process_reclaim(selected[si].tasksize,
 				selected[si].oom_score_adj, rp.nr_scanned,
@@ -214,6 +228,237 @@ static void swap_fn(struct work_struct *work)
 	}
 }
 
+/*
+ * /proc/process_reclaim_batch lets userspace reclaim the anon pages of a
+ * set of processes in one pass instead of writing /proc/<pid>/reclaim for
+ * each of them. A write takes a space separated list of:
+ *
+ *   <pid>         reclaim the process <pid>
+ *   memcg=<pid>   reclaim every process in the memory cgroup of <pid>
+ *   nr=<pages>    per-process budget for the following tasks (default all)
+ *   cold          only take pages left idle since the previous cold pass
+ *
+ * All tasks share one batch of isolated pages. A subsequent read on the
+ * same file descriptor returns one "<pid> <nr_scanned> <nr_reclaimed>"
+ * line per reclaimed process.
+ */
+#define BATCH_MAX_TASKS		64
+#define BATCH_CMD_SIZE		1024
+
+struct batch_task {
+	struct task_struct *p;
+	int nr_to_reclaim;
+};
+
+struct batch_result {
+	char *buf;
+	size_t len;
+};
+
+static int batch_add_task(struct batch_task *tasks, int nr,
+			  struct task_struct *p, int nr_to_reclaim)
+{
+	int i;
+
+	if (nr >= BATCH_MAX_TASKS || (p->flags & PF_KTHREAD))
+		return nr;
+
+	for (i = 0; i < nr; i++)
+		if (tasks[i].p == p)
+			return nr;
+
+	get_task_struct(p);
+	tasks[nr].p = p;
+	tasks[nr].nr_to_reclaim = nr_to_reclaim;
+	return nr + 1;
+}
+
+#ifdef CONFIG_MEMCG
+static int batch_add_memcg(struct batch_task *tasks, int nr,
+			   struct task_struct *p, int nr_to_reclaim)
+{
+	struct mem_cgroup *memcg;
+	struct css_task_iter it;
+	struct task_struct *t;
+
+	rcu_read_lock();
+	memcg = mem_cgroup_from_task(p);
+	if (!memcg || !css_tryget(&memcg->css)) {
+		rcu_read_unlock();
+		return nr;
+	}
+	rcu_read_unlock();
+
+	css_task_iter_start(&memcg->css, 0, &it);
+	while ((t = css_task_iter_next(&it)) && nr < BATCH_MAX_TASKS)
+		if (thread_group_leader(t))
+			nr = batch_add_task(tasks, nr, t, nr_to_reclaim);
+	css_task_iter_end(&it);
+	css_put(&memcg->css);
+
+	return nr;
+}
+#else
+static int batch_add_memcg(struct batch_task *tasks, int nr,
+			   struct task_struct *p, int nr_to_reclaim)
+{
+	return batch_add_task(tasks, nr, p, nr_to_reclaim);
+}
+#endif
+
+static int batch_parse(char *cmd, struct batch_task *tasks, bool *cold)
+{
+	int nr_to_reclaim = INT_MAX;
+	struct task_struct *p;
+	bool memcg;
+	char *tok;
+	int nr = 0;
+	int val;
+
+	while ((tok = strsep(&cmd, " \t\n")) != NULL) {
+		if (!*tok)
+			continue;
+
+		if (!strncmp(tok, "nr=", 3)) {
+			if (kstrtoint(tok + 3, 10, &val) || val <= 0)
+				goto err;
+			nr_to_reclaim = val;
+			continue;
+		}
+
+		if (!strcmp(tok, "cold")) {
+			if (!IS_ENABLED(CONFIG_IDLE_PAGE_TRACKING))
+				goto err;
+			*cold = true;
+			continue;
+		}
+
+		memcg = !strncmp(tok, "memcg=", 6);
+		if (kstrtoint(memcg ? tok + 6 : tok, 10, &val) || val <= 0)
+			goto err;
+
+		rcu_read_lock();
+		p = find_task_by_vpid(val);
+		if (p)
+			get_task_struct(p);
+		rcu_read_unlock();
+		if (!p)
+			continue;
+
+		if (memcg)
+			nr = batch_add_memcg(tasks, nr, p, nr_to_reclaim);
+		else
+			nr = batch_add_task(tasks, nr, p, nr_to_reclaim);
+		put_task_struct(p);
+	}
+
+	return nr;
+err:
+	while (nr--)
+		put_task_struct(tasks[nr].p);
+	return -EINVAL;
+}
+
+static ssize_t batch_write(struct file *file, const char __user *ubuf,
+			   size_t count, loff_t *ppos)
+{
+	struct batch_result *res = file->private_data;
+	struct batch_task *tasks;
+	struct reclaim_param rp;
+	LIST_HEAD(batch);
+	bool cold = false;
+	char *cmd;
+	size_t len = 0;
+	int nr, i;
+	ssize_t ret;
+
+	if (count >= BATCH_CMD_SIZE)
+		return -EINVAL;
+
+	cmd = memdup_user_nul(ubuf, count);
+	if (IS_ERR(cmd))
+		return PTR_ERR(cmd);
+
+	tasks = kcalloc(BATCH_MAX_TASKS, sizeof(*tasks), GFP_KERNEL);
+	if (!tasks) {
+		ret = -ENOMEM;
+		goto out_cmd;
+	}
+
+	nr = batch_parse(cmd, tasks, &cold);
+	if (nr < 0) {
+		ret = nr;
+		goto out_tasks;
+	}
+
+	if (!res->buf) {
+		res->buf = kmalloc(PAGE_SIZE, GFP_KERNEL);
+		if (!res->buf) {
+			ret = -ENOMEM;
+			goto out_put;
+		}
+	}
+
+	for (i = 0; i < nr; i++) {
+		rp = reclaim_task_anon_batch(tasks[i].p,
+					     tasks[i].nr_to_reclaim, &batch,
+					     cold);
+		len += scnprintf(res->buf + len, PAGE_SIZE - len,
+				 "%d %d %d\n", task_pid_vnr(tasks[i].p),
+				 rp.nr_scanned, rp.nr_reclaimed);
+	}
+	res->len = len;
+	/* Let the next read start at the new results */
+	*ppos = 0;
+	ret = count;
+
+out_put:
+	for (i = 0; i < nr; i++)
+		put_task_struct(tasks[i].p);
+out_tasks:
+	kfree(tasks);
+out_cmd:
+	kfree(cmd);
+	return ret;
+}
+
+static ssize_t batch_read(struct file *file, char __user *ubuf,
+			  size_t count, loff_t *ppos)
+{
+	struct batch_result *res = file->private_data;
+
+	if (!res->buf)
+		return 0;
+
+	return simple_read_from_buffer(ubuf, count, ppos, res->buf, res->len);
+}
+
+static int batch_open(struct inode *inode, struct file *file)
+{
+	file->private_data = kzalloc(sizeof(struct batch_result), GFP_KERNEL);
+	if (!file->private_data)
+		return -ENOMEM;
+
+	return nonseekable_open(inode, file);
+}
+
+static int batch_release(struct inode *inode, struct file *file)
+{
+	struct batch_result *res = file->private_data;
+
+	kfree(res->buf);
+	kfree(res);
+	return 0;
+}
+
+static const struct file_operations batch_fops = {
+	.open		= batch_open,
+	.read		= batch_read,
+	.write		= batch_write,
+	.release	= batch_release,
+	.llseek		= no_llseek,
+};
+
 static int vmpressure_notifier(struct notifier_block *nb,
 			unsigned long action, void *data)
 {
@@ -241,11 +486,13 @@ static struct notifier_block vmpr_nb = {
 static int __init process_reclaim_init(void)
 {
 	vmpressure_notifier_register(&vmpr_nb);
+	proc_create("process_reclaim_batch", 0600, NULL, &batch_fops);
 	return 0;
 }
 
 static void __exit process_reclaim_exit(void)
 {
+	remove_proc_entry("process_reclaim_batch", NULL);
 	vmpressure_notifier_unregister(&vmpr_nb);
 }
 
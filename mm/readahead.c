@@ -19,6 +19,7 @@
 #include <linux/syscalls.h>
 #include <linux/file.h>
 #include <linux/mm_inline.h>
+#include <linux/launch_prefetch.h>
 
 #include "internal.h"
 
@@ -511,6 +512,8 @@ void page_cache_sync_readahead(struct address_space *mapping,
 			       struct file_ra_state *ra, struct file *filp,
 			       pgoff_t offset, unsigned long req_size)
 {
+	launch_prefetch_record(mapping, offset, req_size);
+
 	/* no read-ahead */
 	if (!ra->ra_pages)
 		return;
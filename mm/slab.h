@@ -187,6 +187,8 @@ struct slabinfo {
 	unsigned int shared;
 	unsigned int objects_per_slab;
 	unsigned int cache_order;
+	unsigned long slabs_allocated;
+	unsigned long slabs_freed;
 };
 
 void get_slabinfo(struct kmem_cache *s, struct slabinfo *sinfo);
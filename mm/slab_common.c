@@ -1335,6 +1335,8 @@ memcg_accumulate_slabinfo(struct kmem_cache *s, struct slabinfo *info)
 		info->shared_avail += sinfo.shared_avail;
 		info->active_objs += sinfo.active_objs;
 		info->num_objs += sinfo.num_objs;
+		info->slabs_allocated += sinfo.slabs_allocated;
+		info->slabs_freed += sinfo.slabs_freed;
 	}
 }
 
@@ -1444,10 +1446,64 @@ static const struct file_operations proc_slabinfo_operations = {
 	.release	= seq_release,
 };
 
+/*
+ * /proc/slab_stats: the space wasted by each root cache, memcg children
+ * included, and the number of slab pages it has allocated and freed so
+ * far. Allocation rates are the difference between two reads.
+ */
+static int slab_stats_show(struct seq_file *m, void *p)
+{
+	struct kmem_cache *s = list_entry(p, struct kmem_cache,
+					  root_caches_node);
+	unsigned long slab_bytes, used_bytes, waste;
+	struct slabinfo sinfo;
+
+	if (p == slab_root_caches.next)
+		seq_puts(m, "# name <objsize> <active_objs> <num_objs> "
+			 "<num_slabs> <pagesperslab> <waste_kb> <frag_pct> "
+			 "<slabs_allocated> <slabs_freed>\n");
+
+	memset(&sinfo, 0, sizeof(sinfo));
+	get_slabinfo(s, &sinfo);
+	memcg_accumulate_slabinfo(s, &sinfo);
+
+	slab_bytes = (sinfo.num_slabs << sinfo.cache_order) << PAGE_SHIFT;
+	used_bytes = sinfo.active_objs * s->object_size;
+	waste = slab_bytes > used_bytes ? slab_bytes - used_bytes : 0;
+
+	seq_printf(m, "%-17s %6u %6lu %6lu %6lu %4d %8lu %3lu %10lu %10lu\n",
+		   cache_name(s), s->object_size, sinfo.active_objs,
+		   sinfo.num_objs, sinfo.num_slabs, 1 << sinfo.cache_order,
+		   waste >> 10, slab_bytes ? waste * 100 / slab_bytes : 0,
+		   sinfo.slabs_allocated, sinfo.slabs_freed);
+	return 0;
+}
+
+static const struct seq_operations slab_stats_op = {
+	.start = slab_start,
+	.next = slab_next,
+	.stop = slab_stop,
+	.show = slab_stats_show,
+};
+
+static int slab_stats_open(struct inode *inode, struct file *file)
+{
+	return seq_open(file, &slab_stats_op);
+}
+
+static const struct file_operations proc_slab_stats_operations = {
+	.open		= slab_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= seq_release,
+};
+
 static int __init slab_proc_init(void)
 {
 	proc_create("slabinfo", SLABINFO_RIGHTS, NULL,
 						&proc_slabinfo_operations);
+	proc_create("slab_stats", SLABINFO_RIGHTS, NULL,
+						&proc_slab_stats_operations);
 	return 0;
 }
 module_init(slab_proc_init);
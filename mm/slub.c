@@ -1815,6 +1815,7 @@ static struct page *allocate_slab(struct kmem_cache *s, gfp_t flags, int node)
 		1 << oo_order(oo));
 
 	inc_slabs_node(s, page_to_nid(page), page->objects);
+	atomic_long_inc(&s->slabs_allocated);
 
 	return page;
 }
@@ -1846,6 +1847,7 @@ static void __free_slab(struct kmem_cache *s, struct page *page)
 		(s->flags & SLAB_RECLAIM_ACCOUNT) ?
 		NR_SLAB_RECLAIMABLE : NR_SLAB_UNRECLAIMABLE,
 		-pages);
+	atomic_long_inc(&s->slabs_freed);
 
 	__ClearPageSlabPfmemalloc(page);
 	__ClearPageSlab(page);
@@ -6141,6 +6143,8 @@ void get_slabinfo(struct kmem_cache *s, struct slabinfo *sinfo)
 	sinfo->num_slabs = nr_slabs;
 	sinfo->objects_per_slab = oo_objects(s->oo);
 	sinfo->cache_order = oo_order(s->oo);
+	sinfo->slabs_allocated = atomic_long_read(&s->slabs_allocated);
+	sinfo->slabs_freed = atomic_long_read(&s->slabs_freed);
 }
 
 void slabinfo_show_stats(struct seq_file *m, struct kmem_cache *s)
@@ -14,6 +14,10 @@
 #include <linux/mm_types.h>
 #include <linux/swapfile.h>
 #include <linux/swap.h>
+#include <linux/ktime.h>
+
+#define CREATE_TRACE_POINTS
+#include <trace/events/swap_ratio.h>
 
 #define SWAP_RATIO_GROUP_START (SWAP_FLAG_PRIO_MASK - 9) /* 32758 */
 #define SWAP_RATIO_GROUP_END (SWAP_FLAG_PRIO_MASK) /* 32767 */
@@ -31,6 +35,21 @@ int sysctl_swap_ratio = 100;
 /* Enable the swap ratio feature */
 int sysctl_swap_ratio_enable;
 
+/*
+ * Let the slow device's write latency and queue depth steer the ratio.
+ * When the slow device goes above the latency target, or builds up a
+ * deep queue, more writes are pushed to the fast device; once it has
+ * drained the ratio walks back to sysctl_swap_ratio.
+ */
+int sysctl_swap_ratio_feedback;
+int sysctl_swap_ratio_target_us = 2000;
+
+#define SWAP_RATIO_STEP		10
+#define SWAP_RATIO_QUEUE_HIGH	64
+
+/* Effective ratio in feedback mode, protected by swap_avail_lock */
+static int swap_ratio_cur = -1;
+
 static bool is_same_group(struct swap_info_struct *a,
 		struct swap_info_struct *b)
 {
@@ -46,6 +65,73 @@ static bool is_same_group(struct swap_info_struct *a,
 	return false;
 }
 
+static bool swap_ratio_tracked(struct swap_info_struct *p)
+{
+	return sysctl_swap_ratio_enable && sysctl_swap_ratio_feedback &&
+		is_swap_ratio_group(p->prio);
+}
+
+/*
+ * Returns a non-zero timestamp to hand back to swap_ratio_write_done(),
+ * or 0 if @p is not being sampled.
+ */
+unsigned long swap_ratio_write_start(struct swap_info_struct *p)
+{
+	if (!swap_ratio_tracked(p))
+		return 0;
+
+	atomic_inc(&p->write_inflight);
+	return (unsigned long)ktime_to_us(ktime_get()) ?: 1;
+}
+
+/* A zero @start drops the sample, e.g. when the write was not issued */
+void swap_ratio_write_done(struct swap_info_struct *p, unsigned long start)
+{
+	unsigned long lat, avg;
+
+	atomic_dec(&p->write_inflight);
+	if (!start)
+		return;
+
+	lat = (unsigned long)ktime_to_us(ktime_get()) - start;
+	avg = READ_ONCE(p->write_lat_us);
+	/* EWMA with a weight of 1/8 for the new sample */
+	avg = avg ? avg - (avg >> 3) + (lat >> 3) : lat;
+	WRITE_ONCE(p->write_lat_us, avg);
+}
+
+/* Caller must hold swap_avail_lock */
+static int swap_ratio_adjust(struct swap_info_struct *si,
+			struct swap_info_struct *n)
+{
+	int base = sysctl_swap_ratio;
+	int target = sysctl_swap_ratio_target_us;
+	unsigned long slow_lat = READ_ONCE(n->write_lat_us);
+	int inflight = atomic_read(&n->write_inflight);
+	int ratio, old;
+
+	if (!sysctl_swap_ratio_feedback) {
+		swap_ratio_cur = -1;
+		return base;
+	}
+
+	old = swap_ratio_cur < base ? base : swap_ratio_cur;
+	ratio = old;
+	if (slow_lat > target || inflight > SWAP_RATIO_QUEUE_HIGH)
+		ratio = min(ratio + SWAP_RATIO_STEP, 100);
+	else if (slow_lat < target / 2 &&
+		 inflight < SWAP_RATIO_QUEUE_HIGH / 2)
+		ratio = max(ratio - SWAP_RATIO_STEP, base);
+
+	if (ratio != old)
+		trace_swap_ratio_rebalance(si->type, n->type,
+					   READ_ONCE(si->write_lat_us),
+					   slow_lat, inflight, old, ratio);
+	swap_ratio_cur = ratio;
+
+	return ratio;
+}
+
 /* Caller must hold swap_avail_lock */
 static int calculate_write_pending(struct swap_info_struct *si,
 			struct swap_info_struct *n)
@@ -61,6 +147,8 @@ static int calculate_write_pending(struct swap_info_struct *si,
 	if ((n->flags & SWP_SYNCHRONOUS_IO) || !is_same_group(si, n))
 		return -ENODEV;
 
+	ratio = swap_ratio_adjust(si, n);
+
 	si->max_writes = ratio ? SWAP_FAST_WRITES : 0;
 	n->max_writes  = ratio ? (SWAP_FAST_WRITES * 100) /
 			ratio - SWAP_FAST_WRITES : SWAP_SLOW_WRITES;
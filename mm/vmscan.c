@@ -124,8 +124,82 @@ struct scan_control {
 	 */
 	struct vm_area_struct *target_vma;
 
+#ifdef CONFIG_MULTI_KSWAPD
+	/*
+	 * Slot of this reclaimer among the mkswapd_nr threads balancing
+	 * the node, see mkswapd_skip_lru() and mkswapd_skip_memcg().
+	 */
+	unsigned int mkswapd_idx;
+	unsigned int mkswapd_nr;
+#endif
 };
 
+#ifdef CONFIG_MULTI_KSWAPD
+/*
+ * With more than one reclaim thread on a node the LRU scanning is split:
+ * kswapd itself (slot 0) scans the file lists and shrinks slab, while the
+ * helper threads scan the anon lists, which is where zram compression
+ * burns the cpu time. Helpers further split non-root memcgs between them
+ * by memcg id; the root memcg is shared by all of them since that is
+ * where most anon memory lives without per-app memcgs.
+ */
+static bool mkswapd_skip_lru(struct scan_control *sc, enum lru_list lru)
+{
+	if (sc->mkswapd_nr <= 1)
+		return false;
+
+	return is_file_lru(lru) != !sc->mkswapd_idx;
+}
+
+static bool mkswapd_skip_memcg(struct scan_control *sc,
+			       struct mem_cgroup *memcg)
+{
+	unsigned int nr_helpers = sc->mkswapd_nr - 1;
+
+	if (!sc->mkswapd_idx || nr_helpers <= 1 || !memcg)
+		return false;
+#ifdef CONFIG_MEMCG
+	if (!parent_mem_cgroup(memcg))
+		return false;
+#endif
+	return mem_cgroup_id(memcg) % nr_helpers != sc->mkswapd_idx - 1;
+}
+
+static bool mkswapd_skip_slab(struct scan_control *sc)
+{
+	return sc->mkswapd_idx != 0;
+}
+
+static void mkswapd_account(unsigned int idx, unsigned long scanned,
+			    unsigned long reclaimed)
+{
+	count_vm_events(PGSCAN_KSWAPD_0 + 2 * idx, scanned);
+	count_vm_events(PGSTEAL_KSWAPD_0 + 2 * idx, reclaimed);
+}
+#else
+static inline bool mkswapd_skip_lru(struct scan_control *sc,
+				    enum lru_list lru)
+{
+	return false;
+}
+
+static inline bool mkswapd_skip_memcg(struct scan_control *sc,
+				      struct mem_cgroup *memcg)
+{
+	return false;
+}
+
+static inline bool mkswapd_skip_slab(struct scan_control *sc)
+{
+	return false;
+}
+
+static inline void mkswapd_account(unsigned int idx, unsigned long scanned,
+				   unsigned long reclaimed)
+{
+}
+#endif
+
 #ifdef ARCH_HAS_PREFETCH
 #define prefetch_prev_lru_page(_page, _base, _field)			\
 	do {								\
@@ -2277,10 +2351,25 @@ static bool inactive_list_is_low(struct lruvec *lruvec, bool file,
 	return inactive * inactive_ratio < active;
 }
 
+/*
+ * Leave the active file list of a memcg below its file_protect alone,
+ * unless reclaim is struggling to make progress elsewhere.
+ */
+static bool active_file_is_protected(struct lruvec *lruvec,
+				     struct scan_control *sc)
+{
+	unsigned long protect = mem_cgroup_file_protect(lruvec_memcg(lruvec));
+
+	return protect && sc->priority >= DEF_PRIORITY / 2 &&
+	       lruvec_lru_size(lruvec, LRU_ACTIVE_FILE, MAX_NR_ZONES) < protect;
+}
+
 static unsigned long shrink_list(enum lru_list lru, unsigned long nr_to_scan,
 				 struct lruvec *lruvec, struct scan_control *sc)
 {
 	if (is_active_lru(lru)) {
+		if (is_file_lru(lru) && active_file_is_protected(lruvec, sc))
+			return 0;
 		if (inactive_list_is_low(lruvec, is_file_lru(lru), sc, true))
 			shrink_active_list(nr_to_scan, lruvec, sc, lru);
 		return 0;
@@ -2536,6 +2625,10 @@ static void shrink_node_memcg(struct pglist_data *pgdat, struct mem_cgroup *memc
 
 	get_scan_count(lruvec, memcg, sc, nr, lru_pages);
 
+	for_each_evictable_lru(lru)
+		if (mkswapd_skip_lru(sc, lru))
+			nr[lru] = 0;
+
 	/* Record the original scan target for proportional adjustments later */
 	memcpy(targets, nr, sizeof(nr));
 
@@ -2632,7 +2725,8 @@ static void shrink_node_memcg(struct pglist_data *pgdat, struct mem_cgroup *memc
 	 * Even if we did not try to evict anon pages at all, we want to
 	 * rebalance the anon lru active/inactive ratio.
 	 */
-	if (inactive_list_is_low(lruvec, false, sc, true))
+	if (!mkswapd_skip_lru(sc, LRU_ACTIVE_ANON) &&
+	    inactive_list_is_low(lruvec, false, sc, true))
 		shrink_active_list(SWAP_CLUSTER_MAX, lruvec,
 				   sc, LRU_ACTIVE_ANON);
 }
@@ -2745,6 +2839,9 @@ static bool shrink_node(pg_data_t *pgdat, struct scan_control *sc)
 			unsigned long reclaimed;
 			unsigned long scanned;
 
+			if (mkswapd_skip_memcg(sc, memcg))
+				continue;
+
 			if (mem_cgroup_low(root, memcg)) {
 				if (!sc->memcg_low_reclaim) {
 					sc->memcg_low_skipped = 1;
@@ -2758,9 +2855,10 @@ static bool shrink_node(pg_data_t *pgdat, struct scan_control *sc)
 			shrink_node_memcg(pgdat, memcg, sc, &lru_pages);
 			node_lru_pages += lru_pages;
 
-			if (memcg)
-				shrink_slab(sc->gfp_mask, pgdat->node_id,
-					    memcg, sc->priority);
+			if (memcg && !mkswapd_skip_slab(sc))
+				shrink_slab(sc->gfp_mask, pgdat->node_id, memcg,
+					    mem_cgroup_slab_priority(memcg,
+							sc->priority));
 
 			/* Record the group's reclaim efficiency */
 			vmpressure(sc->gfp_mask, memcg, false,
@@ -2784,7 +2882,7 @@ static bool shrink_node(pg_data_t *pgdat, struct scan_control *sc)
 			}
 		} while ((memcg = mem_cgroup_iter(root, memcg, &reclaim)));
 
-		if (global_reclaim(sc))
+		if (global_reclaim(sc) && !mkswapd_skip_slab(sc))
 			shrink_slab(sc->gfp_mask, pgdat->node_id, NULL,
 				    sc->priority);
 
@@ -3439,6 +3537,116 @@ static bool kswapd_shrink_node(pg_data_t *pgdat,
 	return sc->nr_scanned >= sc->nr_to_reclaim;
 }
 
+#ifdef CONFIG_MULTI_KSWAPD
+/* Called by kswapd when it starts balancing @pgdat */
+static void mkswapd_wake(pg_data_t *pgdat, int classzone_idx,
+			 struct scan_control *sc)
+{
+	sc->mkswapd_idx = 0;
+	sc->mkswapd_nr = READ_ONCE(pgdat->mkswapd_nr);
+	if (sc->mkswapd_nr <= 1)
+		return;
+
+	WRITE_ONCE(pgdat->mkswapd_classzone_idx, classzone_idx);
+	smp_wmb();
+	WRITE_ONCE(pgdat->mkswapd_seq, pgdat->mkswapd_seq + 1);
+	wake_up_interruptible(&pgdat->mkswapd_wait);
+}
+
+/*
+ * Order-0 version of balance_pgdat() for the helper threads. Watermark
+ * and high-order handling stay with kswapd, the helpers only add reclaim
+ * throughput on their share of the LRUs until the node is balanced.
+ */
+static void mkswapd_balance(pg_data_t *pgdat, unsigned int idx)
+{
+	unsigned long nr_scanned = 0;
+	struct scan_control sc = {
+		.gfp_mask = GFP_KERNEL,
+		.priority = DEF_PRIORITY,
+		.may_writepage = !laptop_mode,
+		.may_unmap = 1,
+		.may_swap = 1,
+		.mkswapd_idx = idx,
+	};
+
+	do {
+		unsigned long nr_reclaimed = sc.nr_reclaimed;
+		bool raise_priority = true;
+
+		sc.mkswapd_nr = READ_ONCE(pgdat->mkswapd_nr);
+		if (idx >= sc.mkswapd_nr)
+			break;
+
+		sc.reclaim_idx = READ_ONCE(pgdat->mkswapd_classzone_idx);
+		if (pgdat_balanced(pgdat, 0, sc.reclaim_idx))
+			break;
+
+		if (sc.priority < DEF_PRIORITY - 2)
+			sc.may_writepage = 1;
+
+		sc.nr_scanned = 0;
+		if (kswapd_shrink_node(pgdat, &sc))
+			raise_priority = false;
+		nr_scanned += sc.nr_scanned;
+
+		if (try_to_freeze() || kthread_should_stop())
+			break;
+
+		nr_reclaimed = sc.nr_reclaimed - nr_reclaimed;
+		if (raise_priority || !nr_reclaimed)
+			sc.priority--;
+	} while (sc.priority >= 1);
+
+	mkswapd_account(idx, nr_scanned, sc.nr_reclaimed);
+}
+
+int kswapd_helper(void *p)
+{
+	pg_data_t *pgdat = (pg_data_t *)p;
+	struct task_struct *tsk = current;
+	struct reclaim_state reclaim_state = {
+		.reclaimed_slab = 0,
+	};
+	const struct cpumask *cpumask = cpumask_of_node(pgdat->node_id);
+	unsigned long seq = READ_ONCE(pgdat->mkswapd_seq);
+	unsigned int idx;
+
+	/* The thread is only woken once its slot has been filled in */
+	for (idx = 1; idx < MAX_KSWAPD_THREADS; idx++)
+		if (pgdat->mkswapd[idx] == tsk)
+			break;
+
+	if (!cpumask_empty(cpumask))
+		set_cpus_allowed_ptr(tsk, cpumask);
+	tsk->reclaim_state = &reclaim_state;
+	tsk->flags |= PF_MEMALLOC | PF_SWAPWRITE | PF_KSWAPD;
+	set_freezable();
+
+	while (!kthread_should_stop()) {
+		wait_event_freezable(pgdat->mkswapd_wait,
+				READ_ONCE(pgdat->mkswapd_seq) != seq ||
+				kthread_should_stop());
+		if (kthread_should_stop())
+			break;
+
+		seq = READ_ONCE(pgdat->mkswapd_seq);
+		smp_rmb();
+		mkswapd_balance(pgdat, idx);
+	}
+
+	tsk->flags &= ~(PF_MEMALLOC | PF_SWAPWRITE | PF_KSWAPD);
+	tsk->reclaim_state = NULL;
+
+	return 0;
+}
+#else
+static inline void mkswapd_wake(pg_data_t *pgdat, int classzone_idx,
+				struct scan_control *sc)
+{
+}
+#endif
+
 /*
  * For kswapd, balance_pgdat() will reclaim pages across a node from zones
  * that are eligible for use by the caller until at least one zone is
@@ -3457,6 +3665,7 @@ static int balance_pgdat(pg_data_t *pgdat, int order, int classzone_idx)
 	int i;
 	unsigned long nr_soft_reclaimed;
 	unsigned long nr_soft_scanned;
+	unsigned long nr_scanned = 0;
 	unsigned long pflags;
 	struct zone *zone;
 	struct scan_control sc = {
@@ -3469,6 +3678,7 @@ static int balance_pgdat(pg_data_t *pgdat, int order, int classzone_idx)
 	};
 	psi_memstall_enter(&pflags);
 	count_vm_event(PAGEOUTRUN);
+	mkswapd_wake(pgdat, classzone_idx, &sc);
 
 	do {
 		unsigned long nr_reclaimed = sc.nr_reclaimed;
@@ -3534,6 +3744,7 @@ static int balance_pgdat(pg_data_t *pgdat, int order, int classzone_idx)
 		 */
 		if (kswapd_shrink_node(pgdat, &sc))
 			raise_priority = false;
+		nr_scanned += sc.nr_scanned;
 
 		/*
 		 * If the low watermark is met there is no need for processes
@@ -3561,6 +3772,7 @@ static int balance_pgdat(pg_data_t *pgdat, int order, int classzone_idx)
 		pgdat->kswapd_failures++;
 
 out:
+	mkswapd_account(0, nr_scanned, sc.nr_reclaimed);
 	snapshot_refaults(NULL, pgdat);
 	psi_memstall_leave(&pflags);
 	/*
@@ -3863,7 +4075,7 @@ static int kswapd_cpu_online(unsigned int cpu)
 			/* One of our CPUs online: restore mask */
 			set_cpus_allowed_ptr(pgdat->kswapd, mask);
 	}
-	return 0;
+	return kswapd_cpu_online_ext(cpu);
 }
 
 /*
@@ -3885,8 +4097,9 @@ int kswapd_run(int nid)
 		pr_err("Failed to start kswapd on node %d\n", nid);
 		ret = PTR_ERR(pgdat->kswapd);
 		pgdat->kswapd = NULL;
+		return ret;
 	}
-	return ret;
+	return kswapd_run_ext(nid);
 }
 
 /*
@@ -3897,6 +4110,7 @@ void kswapd_stop(int nid)
 {
 	struct task_struct *kswapd = NODE_DATA(nid)->kswapd;
 
+	kswapd_stop_ext(nid);
 	if (kswapd) {
 		kthread_stop(kswapd);
 		NODE_DATA(nid)->kswapd = NULL;
@@ -1099,6 +1099,8 @@ const char * const vmstat_text[] = {
 	"workingset_activate",
 	"workingset_restore",
 	"workingset_nodereclaim",
+	"workingset_protect_refault",
+	"workingset_protect_activate",
 	"nr_anon_pages",
 	"nr_mapped",
 	"nr_file_pages",
@@ -1241,6 +1243,13 @@ const char * const vmstat_text[] = {
 	"swap_ra",
 	"swap_ra_hit",
 #endif
+#ifdef CONFIG_MULTI_KSWAPD
+#define MKSWAPD_TEXT(n) "pgscan_kswapd_t" #n, "pgsteal_kswapd_t" #n
+	MKSWAPD_TEXT(0), MKSWAPD_TEXT(1), MKSWAPD_TEXT(2), MKSWAPD_TEXT(3),
+	MKSWAPD_TEXT(4), MKSWAPD_TEXT(5), MKSWAPD_TEXT(6), MKSWAPD_TEXT(7),
+	MKSWAPD_TEXT(8), MKSWAPD_TEXT(9), MKSWAPD_TEXT(10), MKSWAPD_TEXT(11),
+	MKSWAPD_TEXT(12), MKSWAPD_TEXT(13), MKSWAPD_TEXT(14), MKSWAPD_TEXT(15),
+#endif
 #ifdef CONFIG_SPECULATIVE_PAGE_FAULT
 	"speculative_pgfault"
 #endif
@@ -257,6 +257,7 @@ void workingset_refault(struct page *page, void *shadow)
 	unsigned long eviction;
 	struct lruvec *lruvec;
 	unsigned long refault;
+	unsigned long protect;
 	bool workingset;
 	int memcgid;
 
@@ -306,13 +307,21 @@ void workingset_refault(struct page *page, void *shadow)
 
 	inc_lruvec_state(lruvec, WORKINGSET_REFAULT);
 
+	protect = mem_cgroup_file_protect(memcg);
+	if (protect)
+		inc_lruvec_state(lruvec, WORKINGSET_PROTECT_REFAULT);
+
 	/*
 	 * Compare the distance to the existing workingset size. We
 	 * don't act on pages that couldn't stay resident even if all
-	 * the memory was available to the page cache.
+	 * the memory was available to the page cache, unless the
+	 * memcg holds less active cache than it is guaranteed.
 	 */
-	if (refault_distance > active_file)
-		goto out;
+	if (refault_distance > active_file) {
+		if (active_file >= protect)
+			goto out;
+		inc_lruvec_state(lruvec, WORKINGSET_PROTECT_ACTIVATE);
+	}
 
 	SetPageActive(page);
 	atomic_long_inc(&lruvec->inactive_age);
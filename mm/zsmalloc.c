@@ -202,6 +202,22 @@ static struct vfsmount *zsmalloc_mnt;
 static const int fullness_threshold_frac = 4;
 static size_t huge_class_size;
 
+/*
+ * Each size class keeps a small per-cpu cache of freed objects. zs_free()
+ * parks the handle there, object still allocated in its zspage, and the
+ * next zs_malloc() of the same class on that cpu hands it straight back
+ * without touching class->lock. A cache holds at most ZS_PCP_BYTES worth
+ * of objects and is drained before compaction and on pool destruction.
+ */
+#define ZS_PCP_MAX	16
+#define ZS_PCP_BYTES	PAGE_SIZE
+
+struct zs_pcp {
+	spinlock_t lock;
+	int count;
+	unsigned long handles[ZS_PCP_MAX];
+};
+
 struct size_class {
 	spinlock_t lock;
 	struct list_head fullness_list[NR_ZS_FULLNESS];
@@ -216,6 +232,10 @@ struct size_class {
 
 	unsigned int index;
 	struct zs_size_stat stats;
+
+	struct zs_pcp __percpu *pcp;
+	/* Max objects held by each per-cpu cache */
+	int pcp_high;
 };
 
 /* huge object: pages_per_zspage == 1 && maxobj_per_zspage == 1 */
@@ -563,29 +583,49 @@ static int get_size_class_index(int size)
 	return min_t(int, ZS_SIZE_CLASSES - 1, idx);
 }
 
+/*
+ * Stats are only modified under class->lock but may be read without it,
+ * so the updates are single stores and readers get a racy but untorn
+ * snapshot.
+ */
+
 /* type can be of enum type class_stat_type or fullness_group */
 static inline void class_stat_inc(struct size_class *class,
 				int type, unsigned long cnt)
 {
-	class->stats.objs[type] += cnt;
+	WRITE_ONCE(class->stats.objs[type], class->stats.objs[type] + cnt);
 }
 
 /* type can be of enum type class_stat_type or fullness_group */
 static inline void class_stat_dec(struct size_class *class,
 				int type, unsigned long cnt)
 {
-	class->stats.objs[type] -= cnt;
+	WRITE_ONCE(class->stats.objs[type], class->stats.objs[type] - cnt);
 }
 
 /* type can be of enum type class_stat_type or fullness_group */
 static inline unsigned long zs_stat_get(struct size_class *class,
 				int type)
 {
-	return class->stats.objs[type];
+	return READ_ONCE(class->stats.objs[type]);
 }
 
 #ifdef CONFIG_ZSMALLOC_STAT
 
+static unsigned long zs_pcp_count(struct size_class *class)
+{
+	unsigned long count = 0;
+	int cpu;
+
+	if (!class->pcp)
+		return 0;
+
+	for_each_possible_cpu(cpu)
+		count += READ_ONCE(per_cpu_ptr(class->pcp, cpu)->count);
+
+	return count;
+}
+
 static void __init zs_stat_init(void)
 {
 	if (!debugfs_initialized()) {
@@ -612,15 +652,15 @@ static int zs_stats_size_show(struct seq_file *s, void *v)
 	struct size_class *class;
 	int objs_per_zspage;
 	unsigned long class_almost_full, class_almost_empty;
-	unsigned long obj_allocated, obj_used, pages_used, freeable;
+	unsigned long obj_allocated, obj_used, pages_used, freeable, cached;
 	unsigned long total_class_almost_full = 0, total_class_almost_empty = 0;
 	unsigned long total_objs = 0, total_used_objs = 0, total_pages = 0;
-	unsigned long total_freeable = 0;
+	unsigned long total_freeable = 0, total_cached = 0;
 
-	seq_printf(s, " %5s %5s %11s %12s %13s %10s %10s %16s %8s\n",
+	seq_printf(s, " %5s %5s %11s %12s %13s %10s %10s %16s %8s %8s\n",
 			"class", "size", "almost_full", "almost_empty",
 			"obj_allocated", "obj_used", "pages_used",
-			"pages_per_zspage", "freeable");
+			"pages_per_zspage", "freeable", "cached");
 
 	for (i = 0; i < ZS_SIZE_CLASSES; i++) {
 		class = pool->size_class[i];
@@ -628,23 +668,22 @@ static int zs_stats_size_show(struct seq_file *s, void *v)
 		if (class->index != i)
 			continue;
 
-		spin_lock(&class->lock);
 		class_almost_full = zs_stat_get(class, CLASS_ALMOST_FULL);
 		class_almost_empty = zs_stat_get(class, CLASS_ALMOST_EMPTY);
 		obj_allocated = zs_stat_get(class, OBJ_ALLOCATED);
 		obj_used = zs_stat_get(class, OBJ_USED);
 		freeable = zs_can_compact(class);
-		spin_unlock(&class->lock);
+		cached = zs_pcp_count(class);
 
 		objs_per_zspage = class->objs_per_zspage;
 		pages_used = obj_allocated / objs_per_zspage *
 				class->pages_per_zspage;
 
 		seq_printf(s, " %5u %5u %11lu %12lu %13lu"
-				" %10lu %10lu %16d %8lu\n",
+				" %10lu %10lu %16d %8lu %8lu\n",
 			i, class->size, class_almost_full, class_almost_empty,
 			obj_allocated, obj_used, pages_used,
-			class->pages_per_zspage, freeable);
+			class->pages_per_zspage, freeable, cached);
 
 		total_class_almost_full += class_almost_full;
 		total_class_almost_empty += class_almost_empty;
@@ -652,13 +691,15 @@ static int zs_stats_size_show(struct seq_file *s, void *v)
 		total_used_objs += obj_used;
 		total_pages += pages_used;
 		total_freeable += freeable;
+		total_cached += cached;
 	}
 
 	seq_puts(s, "\n");
-	seq_printf(s, " %5s %5s %11lu %12lu %13lu %10lu %10lu %16s %8lu\n",
+	seq_printf(s, " %5s %5s %11lu %12lu %13lu %10lu %10lu %16s %8lu %8lu\n",
 			"Total", "", total_class_almost_full,
 			total_class_almost_empty, total_objs,
-			total_used_objs, total_pages, "", total_freeable);
+			total_used_objs, total_pages, "", total_freeable,
+			total_cached);
 
 	return 0;
 }
@@ -1532,6 +1573,43 @@ static unsigned long obj_malloc(struct zs_pool *pool,
 }
 
 
+/*
+ * Objects sitting in a per-cpu cache stay allocated in their zspage and
+ * keep counting as OBJ_USED; only the handle changes owner. Both helpers
+ * run with the cpu pinned, the per-cpu lock is there for remote drains.
+ */
+static unsigned long zs_pcp_get(struct size_class *class)
+{
+	unsigned long handle = 0;
+	struct zs_pcp *pcp;
+
+	pcp = get_cpu_ptr(class->pcp);
+	spin_lock(&pcp->lock);
+	if (pcp->count)
+		handle = pcp->handles[--pcp->count];
+	spin_unlock(&pcp->lock);
+	put_cpu_ptr(class->pcp);
+
+	return handle;
+}
+
+static bool zs_pcp_put(struct size_class *class, unsigned long handle)
+{
+	struct zs_pcp *pcp;
+	bool cached = false;
+
+	pcp = get_cpu_ptr(class->pcp);
+	spin_lock(&pcp->lock);
+	if (pcp->count < class->pcp_high) {
+		pcp->handles[pcp->count++] = handle;
+		cached = true;
+	}
+	spin_unlock(&pcp->lock);
+	put_cpu_ptr(class->pcp);
+
+	return cached;
+}
+
 /**
  * zs_malloc - Allocate block of given size from pool.
  * @pool: pool to allocate from
@@ -1552,14 +1630,18 @@ unsigned long zs_malloc(struct zs_pool *pool, size_t size, gfp_t gfp)
 	if (unlikely(!size || size > ZS_MAX_ALLOC_SIZE))
 		return 0;
 
-	handle = cache_alloc_handle(pool, gfp);
-	if (!handle)
-		return 0;
-
 	/* extra space in chunk to keep the handle */
 	size += ZS_HANDLE_SIZE;
 	class = pool->size_class[get_size_class_index(size)];
 
+	handle = zs_pcp_get(class);
+	if (handle)
+		return handle;
+
+	handle = cache_alloc_handle(pool, gfp);
+	if (!handle)
+		return 0;
+
 	spin_lock(&class->lock);
 	zspage = find_get_zspage(class);
 	if (likely(zspage)) {
@@ -1624,7 +1706,7 @@ static void obj_free(int class_size, unsigned long obj)
 	mod_zspage_inuse(zspage, -1);
 }
 
-void zs_free(struct zs_pool *pool, unsigned long handle)
+static void __zs_free(struct zs_pool *pool, unsigned long handle, bool cache)
 {
 	struct zspage *zspage;
 	struct page *f_page;
@@ -1632,9 +1714,6 @@ void zs_free(struct zs_pool *pool, unsigned long handle)
 	struct size_class *class;
 	enum fullness_group fullness;
 
-	if (unlikely(!handle))
-		return;
-
 	pin_tag(handle);
 	obj = handle_to_obj(handle);
 	obj_to_page(obj, &f_page);
@@ -1643,6 +1722,12 @@ void zs_free(struct zs_pool *pool, unsigned long handle)
 	migrate_read_lock(zspage);
 	class = zspage_class(pool, zspage);
 
+	if (cache && zs_pcp_put(class, handle)) {
+		migrate_read_unlock(zspage);
+		unpin_tag(handle);
+		return;
+	}
+
 	spin_lock(&class->lock);
 	obj_free(class->size, obj);
 	class_stat_dec(class, OBJ_USED, 1);
@@ -1661,8 +1746,39 @@ void zs_free(struct zs_pool *pool, unsigned long handle)
 	unpin_tag(handle);
 	cache_free_handle(pool, handle);
 }
+
+void zs_free(struct zs_pool *pool, unsigned long handle)
+{
+	if (unlikely(!handle))
+		return;
+
+	__zs_free(pool, handle, true);
+}
 EXPORT_SYMBOL_GPL(zs_free);
 
+/* Give every cached object of @class back to its zspage */
+static void zs_pcp_drain(struct zs_pool *pool, struct size_class *class)
+{
+	unsigned long handles[ZS_PCP_MAX];
+	struct zs_pcp *pcp;
+	int cpu, i, nr;
+
+	if (!class->pcp)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		pcp = per_cpu_ptr(class->pcp, cpu);
+		spin_lock(&pcp->lock);
+		nr = pcp->count;
+		memcpy(handles, pcp->handles, nr * sizeof(handles[0]));
+		pcp->count = 0;
+		spin_unlock(&pcp->lock);
+
+		for (i = 0; i < nr; i++)
+			__zs_free(pool, handles[i], false);
+	}
+}
+
 static void zs_object_copy(struct size_class *class, unsigned long dst,
 				unsigned long src)
 {
@@ -2258,6 +2374,7 @@ unsigned long zs_compact(struct zs_pool *pool)
 			continue;
 		if (class->index != i)
 			continue;
+		zs_pcp_drain(pool, class);
 		pages_freed += __zs_compact(pool, class);
 	}
 	atomic_long_add(pages_freed, &pool->stats.pages_compacted);
@@ -2341,7 +2458,7 @@ static int zs_register_shrinker(struct zs_pool *pool)
  */
 struct zs_pool *zs_create_pool(const char *name)
 {
-	int i;
+	int i, cpu;
 	struct zs_pool *pool;
 	struct size_class *prev_class = NULL;
 
@@ -2422,10 +2539,19 @@ struct zs_pool *zs_create_pool(const char *name)
 		class->objs_per_zspage = objs_per_zspage;
 		spin_lock_init(&class->lock);
 		pool->size_class[i] = class;
+
 		for (fullness = ZS_EMPTY; fullness < NR_ZS_FULLNESS;
 							fullness++)
 			INIT_LIST_HEAD(&class->fullness_list[fullness]);
 
+		class->pcp = alloc_percpu(struct zs_pcp);
+		if (!class->pcp)
+			goto err;
+		for_each_possible_cpu(cpu)
+			spin_lock_init(&per_cpu_ptr(class->pcp, cpu)->lock);
+		class->pcp_high = clamp_t(int, ZS_PCP_BYTES / size,
+					  1, ZS_PCP_MAX);
+
 		prev_class = class;
 	}
 
@@ -2453,6 +2579,13 @@ void zs_destroy_pool(struct zs_pool *pool)
 {
 	int i;
 
+	for (i = 0; i < ZS_SIZE_CLASSES; i++) {
+		struct size_class *class = pool->size_class[i];
+
+		if (class && class->index == i)
+			zs_pcp_drain(pool, class);
+	}
+
 	zs_unregister_shrinker(pool);
 	zs_unregister_migration(pool);
 	zs_pool_stat_destroy(pool);
@@ -2467,6 +2600,8 @@ void zs_destroy_pool(struct zs_pool *pool)
 		if (class->index != i)
 			continue;
 
+		free_percpu(class->pcp);
+
 		for (fg = ZS_EMPTY; fg < NR_ZS_FULLNESS; fg++) {
 			if (!list_empty(&class->fullness_list[fg])) {
 				pr_info("Freeing non-empty class with size %db, fullness group %d\n",
@@ -160,11 +160,13 @@ static int softnet_seq_show(struct seq_file *seq, void *v)
 #endif
 
 	seq_printf
-	(seq, "%08x %08x %08x %08x %08x %08x %08x %08x %08x %08x %08x %08x\n",
+	(seq, "%08x %08x %08x %08x %08x %08x %08x %08x %08x %08x %08x %08x "
+	 "%08x %08x\n",
 	 sd->processed, sd->dropped, sd->time_squeeze, 0,
 	 0, 0, 0, 0, /* was fastroute */
 	 0, /* was cpu_collision */
-	 sd->received_rps, flow_limit_count, sd->gro_coalesced);
+	 sd->received_rps, flow_limit_count, sd->gro_coalesced,
+	 sd->skb_cache_hit, sd->skb_cache_miss);
 	return 0;
 }
 
@@ -52,6 +52,8 @@
 #include <linux/regmap.h>
 #include <linux/module.h>
 #include <linux/version.h>
+#include <linux/workqueue.h>
+#include <linux/ktime.h>
 
 
 #include "sia81xx_common.h"
@@ -111,6 +113,10 @@
 #define OWI_DATA_BIG_END
 #endif
 
+/* class d register, written with the defaults at power up */
+#define SIA81XX_REG_CLASSD				(0x02)
+#define SIA81XX_MAX_START_REG_NUM		(16)
+
 /* error list */
 #define EPTOUT	(100) /* pulse width time out */
 #define EPOLAR	(101) /* pulse electrical level opposite with the polarity */
@@ -130,6 +136,22 @@ struct sia81xx_err {
 	unsigned long owi_write_data_cnt;
 };
 
+struct sia81xx_start_seq {
+	unsigned int reg;
+	unsigned int num;
+	/* class d value is already in vals */
+	unsigned int has_classd;
+	char vals[SIA81XX_MAX_START_REG_NUM];
+};
+
+/* time from the speaker path powering up to the amp being ready */
+struct sia81xx_start_latency {
+	unsigned long cnt;
+	unsigned long last_us;
+	unsigned long max_us;
+	unsigned long total_us;
+};
+
 typedef struct sia81xx_dev_s {
 	char name[32];
 	unsigned int chip_type;
@@ -160,6 +182,11 @@ typedef struct sia81xx_dev_s {
 	struct list_head list;
 
 	struct sia81xx_err err_info;
+
+	struct sia81xx_start_seq start_seq[AUDIO_SCENE_NUM];
+	struct work_struct start_work;
+	ktime_t start_ts;
+	struct sia81xx_start_latency start_latency;
 }sia81xx_dev_t;
 
 static ssize_t sia81xx_cmd_show(struct device* cd,
@@ -173,8 +200,15 @@ static ssize_t sia81xx_device_store(struct device* cd,
 	struct device_attribute *attr,const char* buf, size_t len);
 
 
+static ssize_t sia81xx_latency_show(struct device* cd,
+	struct device_attribute *attr, char* buf);
+static ssize_t sia81xx_latency_store(struct device* cd, 
+	struct device_attribute *attr,const char* buf, size_t len);
+
+
 static DEVICE_ATTR_RW(sia81xx_cmd);
 static DEVICE_ATTR_RW(sia81xx_device);
+static DEVICE_ATTR_RW(sia81xx_latency);
 
 static DEFINE_MUTEX(sia81xx_list_mutex);
 static LIST_HEAD(sia81xx_list);
@@ -681,20 +715,68 @@ static int sia81xx_owi_init(
 /********************************************************************
  * sia81xx chip option
  ********************************************************************/
+static void sia81xx_build_start_seq(
+	struct sia81xx_dev_s *sia81xx)
+{
+	struct sia81xx_start_seq *seq = NULL;
+	const char *vals = NULL;
+	unsigned int reg = 0, num = 0;
+	int i = 0;
+
+	for(i = 0; i < ARRAY_SIZE(sia81xx->start_seq); i++) {
+		seq = &sia81xx->start_seq[i];
+		memset(seq, 0, sizeof(*seq));
+
+		if(0 != sia81xx_regmap_get_defaults(sia81xx->chip_type, 
+				i, sia81xx->channel_num, &reg, &vals, &num))
+			continue;
+
+		if(num > ARRAY_SIZE(seq->vals)) {
+			pr_err("[  err][%s] %s: scene = %d, num = %u !!! \r\n", 
+				LOG_FLAG, __func__, i, num);
+			continue;
+		}
+
+		seq->reg = reg;
+		seq->num = num;
+		memcpy(seq->vals, vals, num);
+
+		/* the defaults of a sia8101 right channel go through the
+		 * left channel's regmap, class d must still go to its own */
+		if(CHIP_TYPE_SIA8101 == sia81xx->chip_type 
+			&& 0 != sia81xx->channel_num)
+			continue;
+
+		if(SIA81XX_CHANNEL_NUM <= sia81xx->channel_num || 
+			SIA81XX_REG_CLASSD < reg || 
+			SIA81XX_REG_CLASSD >= reg + num)
+			continue;
+
+		seq->vals[SIA81XX_REG_CLASSD - reg] = 
+			(0 == sia81xx->channel_num) ? 0xE0 : 0xE8;
+		seq->has_classd = 1;
+	}
+}
+
 static int sia81xx_reg_init(
 	struct sia81xx_dev_s *sia81xx) 
 {
+	const struct sia81xx_start_seq *seq = &sia81xx->start_seq[sia81xx->scene];
+	struct regmap *regmap = sia81xx->regmap;
+
 	if(NULL == sia81xx->client)
 		return 0;
 	
 	udelay(10);/* wait for xfilter ready */
 	if (CHIP_TYPE_SIA8101 == sia81xx->chip_type 
 		&& 0 != sia81xx->channel_num) {
-		sia81xx_regmap_defaults(g_default_sia_dev->regmap, 
-			sia81xx->chip_type, sia81xx->scene, sia81xx->channel_num);
-	} else {
-		sia81xx_regmap_defaults(sia81xx->regmap, 
-			sia81xx->chip_type, sia81xx->scene, sia81xx->channel_num);
+		regmap = g_default_sia_dev->regmap;
+	}
+
+	if(0 != seq->num && 
+		0 != sia81xx_regmap_write(regmap, seq->reg, seq->num, seq->vals)) {
+		pr_err("[  err][%s] %s: write defaults err, scene = %u !!! \r\n", 
+			LOG_FLAG, __func__, sia81xx->scene);
 	}
 	
 	udelay(10);
@@ -747,7 +829,9 @@ static int sia81xx_resume(
 		sia81xx_reg_init(sia81xx);
 
 		udelay(10);
-		if (0 == sia81xx->channel_num) {
+		if (sia81xx->start_seq[sia81xx->scene].has_classd) {
+			/* already written with the defaults */
+		} else if (0 == sia81xx->channel_num) {
 			buf = 0xE0;
 			if (0 != sia81xx_regmap_write(sia81xx->regmap, 0x02, 1, &buf))
 				pr_err("[  err][%s] %s: write classd reg:0xE0 err !!! \r\n", 
@@ -759,7 +843,7 @@ static int sia81xx_resume(
 					LOG_FLAG, __func__);
 		}
 
-		mdelay(40); /* wait  */
+		msleep(40); /* wait  */
 		buf = 0x00;
 		if (0 != sia81xx_regmap_write(sia81xx->regmap, 0x06, 1, &buf)){
 			pr_err("[  err][%s] %s: write test reg:0x00 err !!! \r\n", 
@@ -804,7 +888,7 @@ static int sia81xx_suspend(
 		if (0 != sia81xx_regmap_write(sia81xx->regmap, 0x06, 1, &buf))
 			pr_err("[  err][%s] %s: write test reg err !!! \r\n", 
 				LOG_FLAG, __func__);
-		mdelay(10); /* wait  */
+		msleep(10); /* wait  */
 
 		spin_lock_irqsave(&sia81xx->rst_lock, flags);
 
@@ -818,6 +902,24 @@ static int sia81xx_suspend(
 	return 0;
 }
 
+static void sia81xx_start_work(
+	struct work_struct *work)
+{
+	sia81xx_dev_t *sia81xx = 
+		container_of(work, sia81xx_dev_t, start_work);
+	struct sia81xx_start_latency *lat = &sia81xx->start_latency;
+	unsigned long us = 0;
+
+	sia81xx_resume(sia81xx);
+
+	us = (unsigned long)ktime_us_delta(ktime_get(), sia81xx->start_ts);
+	lat->cnt ++;
+	lat->last_us = us;
+	lat->total_us += us;
+	if(us > lat->max_us)
+		lat->max_us = us;
+}
+
 static int sia81xx_reboot(
 	struct sia81xx_dev_s *sia81xx)
 {
@@ -905,6 +1007,7 @@ static int sia81xx_dev_init(
 	sia81xx->en_dyn_ud_vdd = (unsigned int)en_dyn_ud_vdd;
 	sia81xx->dyn_ud_vdd_port = (unsigned int)dyn_ud_vdd_port;
 	sia81xx->scene = AUDIO_SCENE_PLAYBACK;
+	sia81xx_build_start_seq(sia81xx);
 	sia81xx_owi_init(sia81xx, (unsigned int)owi_mode);
 
 	sia81xx_suspend(sia81xx);
@@ -919,6 +1022,7 @@ static int sia81xx_dev_remove(
 
 	sia81xx->timer_task_hdl = SIA81XX_TIMER_TASK_INVALID_HDL;
 	
+	cancel_work_sync(&sia81xx->start_work);
 	sia81xx_suspend(sia81xx);
 	
 	return 0;
@@ -1158,6 +1262,34 @@ static ssize_t sia81xx_cmd_store(
 	
 	return len;
 }
+
+static ssize_t sia81xx_latency_show(
+	struct device* cd,
+	struct device_attribute *attr, 
+	char* buf)
+{
+	sia81xx_dev_t *sia81xx = (sia81xx_dev_t *)dev_get_drvdata(cd);
+	struct sia81xx_start_latency *lat = &sia81xx->start_latency;
+
+	return snprintf(buf, PAGE_SIZE, "start_cnt = %lu, last_us = %lu, "
+		"max_us = %lu, avg_us = %lu \r\n", 
+		lat->cnt, lat->last_us, lat->max_us, 
+		lat->cnt ? lat->total_us / lat->cnt : 0);
+}
+
+static ssize_t sia81xx_latency_store(
+	struct device* cd, 
+	struct device_attribute *attr, 
+	const char* buf, 
+	size_t len)
+{
+	sia81xx_dev_t *sia81xx = (sia81xx_dev_t *)dev_get_drvdata(cd);
+
+	/* any write clears the statistics */
+	memset(&sia81xx->start_latency, 0, sizeof(sia81xx->start_latency));
+
+	return len;
+}
 /********************************************************************
  * end - device attr option
  ********************************************************************/
@@ -1275,9 +1407,12 @@ static int sia81xx_spkr_pa_event(
 
 	switch (event) {
 		case SND_SOC_DAPM_POST_PMU : 
-			sia81xx_resume(sia81xx);
+			/* power up takes > 40ms, don't hold the stream start */
+			sia81xx->start_ts = ktime_get();
+			queue_work(system_highpri_wq, &sia81xx->start_work);
 			break;
 		case SND_SOC_DAPM_PRE_PMD :
+			cancel_work_sync(&sia81xx->start_work);
 			sia81xx_suspend(sia81xx);
 			break;
 		default :
@@ -1870,6 +2005,7 @@ static int sia81xx_probe(struct platform_device *pdev)
 	
 	spin_lock_init(&sia81xx->owi_lock);
 	spin_lock_init(&sia81xx->rst_lock);
+	INIT_WORK(&sia81xx->start_work, sia81xx_start_work);
 
 	if(0 == disable_pin) {
 		/* set rst pin's direction */
@@ -1893,6 +2029,7 @@ static int sia81xx_probe(struct platform_device *pdev)
 	}
 
 	device_create_file(&pdev->dev, &dev_attr_sia81xx_cmd);
+	device_create_file(&pdev->dev, &dev_attr_sia81xx_latency);
 
 	/* save platform dev */
 	sia81xx->pdev = pdev;
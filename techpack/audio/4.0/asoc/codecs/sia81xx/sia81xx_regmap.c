@@ -118,57 +118,53 @@ int sia81xx_regmap_write(
 
 
 /*
- * Update regmap default register values based on machine id
+ * Get the default register block of a scene based on machine id,
+ * the caller writes it to the chip with one bulk write.
  */
-void sia81xx_regmap_defaults(
-	struct regmap *regmap, 
+int sia81xx_regmap_get_defaults(
 	unsigned int chip_type, 
 	unsigned int scene,
-	unsigned int channel_num)
+	unsigned int channel_num,
+	unsigned int *start_reg,
+	const char **vals,
+	unsigned int *reg_num)
 {
-	int ret = -ENOENT;
+	const struct sia81xx_reg_vals *reg_vals = NULL;
 	int i = 0;
 	
 	pr_debug("[debug][%s] %s: running, chip_type = %u, channel_num = %u \r\n", 
 		LOG_FLAG, __func__, chip_type, channel_num);
 
-	if(NULL == regmap) {
-		pr_warn("[ warn][%s] %s: NULL == regmap \r\n", 
-			LOG_FLAG, __func__);
-		return ;
-	}
-
 	if(AUDIO_SCENE_NUM <= scene) {
 		pr_err("[  err][%s] %s: scene = %u, AUDIO_SCENE_NUM = %u \r\n", 
 			LOG_FLAG, __func__, scene, AUDIO_SCENE_NUM);
-		return ;
+		return -EINVAL;
 	}
 
 	if(SIA81XX_CHANNEL_NUM <= channel_num) {
 		pr_err("[  err][%s] %s: channel_num = %u, SIA81XX_CHANNEL_NUM = %u \r\n", 
 			LOG_FLAG, __func__, channel_num, SIA81XX_CHANNEL_NUM);
-		return ;
+		return -EINVAL;
 	}
 
 	for(i = 0; i < ARRAY_SIZE(reg_map_info_table); i++) {
 		
-		if(chip_type == reg_map_info_table[i].reg_default->chip_type) {			
-			ret = sia81xx_regmap_write(
-				regmap, 
-				reg_map_info_table[i].reg_default->offset,
-				reg_map_info_table[i].reg_default->reg_defaults[scene].num,
-				reg_map_info_table[i].reg_default->reg_defaults[scene].vals + 
-					(reg_map_info_table[i].reg_default->reg_defaults[scene].num * channel_num)
-				);
-			
-			break;
+		if(chip_type == reg_map_info_table[i].reg_default->chip_type) {
+			reg_vals = &reg_map_info_table[i].reg_default->reg_defaults[scene];
+			if(NULL == reg_vals->vals || 0 == reg_vals->num)
+				break;
+
+			*start_reg = reg_map_info_table[i].reg_default->offset;
+			*vals = reg_vals->vals + (reg_vals->num * channel_num);
+			*reg_num = reg_vals->num;
+			return 0;
 		}
 	}
 	
-	if(0 != ret) {
-		pr_err("[  err][%s] %s: ret = %d, chip_type = %u, regmap = %p \r\n", 
-			LOG_FLAG, __func__, ret, chip_type, regmap);
-	}
+	pr_err("[  err][%s] %s: no defaults, chip_type = %u, scene = %u \r\n", 
+		LOG_FLAG, __func__, chip_type, scene);
+
+	return -ENOENT;
 }
 
 struct regmap *sia81xx_regmap_init(
@@ -36,8 +36,9 @@ int sia81xx_regmap_read(struct regmap *regmap,
 	unsigned int start_reg, unsigned int reg_num, void *buf);
 int sia81xx_regmap_write(struct regmap *regmap, 
 	unsigned int start_reg, unsigned int reg_num, const char *buf);
-void sia81xx_regmap_defaults(struct regmap *regmap, 
-	unsigned int chip_type, unsigned int scene, unsigned int channel_num);
+int sia81xx_regmap_get_defaults(unsigned int chip_type, 
+	unsigned int scene, unsigned int channel_num, 
+	unsigned int *start_reg, const char **vals, unsigned int *reg_num);
 struct regmap *sia81xx_regmap_init(struct i2c_client *client, 
 	unsigned int chip_type);
 void sia81xx_regmap_remove(struct regmap *regmap);
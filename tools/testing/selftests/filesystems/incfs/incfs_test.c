@@ -2441,6 +2441,110 @@ static int get_blocks_test(char *mount_dir)
 	return TEST_FAILURE;
 }
 
+static int prefetch_test(char *mount_dir)
+{
+	const int window = 8;
+	char *backing_dir;
+	char *filename = NULL;
+	int cmd_fd = -1;
+	int fd = -1;
+	int read_count;
+	int i;
+	struct test_files_set test = get_test_files_set();
+	struct test_file *file = NULL;
+	struct incfs_pending_read_info prs[32] = {};
+	uint8_t data[INCFS_DATA_FILE_BLOCK_SIZE];
+
+	for (i = 0; i < test.files_count; i++) {
+		if (test.files[i].size >=
+		    (window + 2) * INCFS_DATA_FILE_BLOCK_SIZE) {
+			file = &test.files[i];
+			break;
+		}
+	}
+	if (!file) {
+		ksft_print_msg("No test file large enough.\n");
+		return TEST_FAILURE;
+	}
+
+	backing_dir = create_backing_dir(mount_dir);
+	if (!backing_dir)
+		goto failure;
+
+	if (mount_fs_opt(mount_dir, backing_dir,
+			 "read_timeout_ms=10,readahead=0,prefetch=8",
+			 false) != 0)
+		goto failure;
+
+	cmd_fd = open_commands_file(mount_dir);
+	if (cmd_fd < 0)
+		goto failure;
+
+	if (emit_file(cmd_fd, NULL, file->name, &file->id, file->size, NULL))
+		goto failure;
+
+	filename = concat_file_name(mount_dir, file->name);
+	fd = open(filename, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		goto failure;
+
+	/* Two sequential misses make a stream */
+	for (i = 0; i < 2; i++) {
+		if (pread(fd, data, sizeof(data),
+			  INCFS_DATA_FILE_BLOCK_SIZE * i) >= 0) {
+			ksft_print_msg("Read of a missing block succeeded.\n");
+			goto failure;
+		}
+	}
+
+	/* Timed out reads are gone, the window ahead must be pending */
+	read_count = wait_for_pending_reads(cmd_fd, 0, prs, ARRAY_SIZE(prs));
+	if (read_count != window) {
+		ksft_print_msg("Bad prefetch read count %d\n", read_count);
+		goto failure;
+	}
+
+	for (i = 0; i < read_count; i++) {
+		if (!same_id(&prs[i].file_id, &file->id) ||
+		    prs[i].block_index < 2 ||
+		    prs[i].block_index >= 2 + window) {
+			ksft_print_msg("Unexpected prefetch of block %d\n",
+				       prs[i].block_index);
+			goto failure;
+		}
+	}
+
+	/* Data arrival retires them */
+	if (emit_test_file_data(mount_dir, file))
+		goto failure;
+
+	close(cmd_fd);
+	cmd_fd = open_commands_file(mount_dir);
+	if (cmd_fd < 0)
+		goto failure;
+
+	read_count = wait_for_pending_reads(cmd_fd, 0, prs, ARRAY_SIZE(prs));
+	if (read_count != 0) {
+		ksft_print_msg("Prefetch reads left after data arrived\n");
+		goto failure;
+	}
+
+	close(fd);
+	close(cmd_fd);
+	free(filename);
+	umount(mount_dir);
+	free(backing_dir);
+	return TEST_SUCCESS;
+
+failure:
+	close(fd);
+	close(cmd_fd);
+	free(filename);
+	umount(mount_dir);
+	free(backing_dir);
+	return TEST_FAILURE;
+}
+
 static int emit_partial_test_file_hash(char *mount_dir, struct test_file *file)
 {
 	int err;
@@ -2736,6 +2840,7 @@ int main(int argc, char *argv[])
 		MAKE_TEST(hash_tree_test),
 		MAKE_TEST(read_log_test),
 		MAKE_TEST(get_blocks_test),
+		MAKE_TEST(prefetch_test),
 		MAKE_TEST(get_hash_blocks_test),
 		MAKE_TEST(large_file),
 	};
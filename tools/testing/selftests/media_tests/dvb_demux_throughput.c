@@ -0,0 +1,180 @@
+/*
+ * dvb_demux_throughput.c - DVB software demux throughput test
+ *
+ * This file is released under the GPLv2.
+ */
+
+/*
+ * This test feeds a recorded TS file through the software demux of
+ * a DVR device and reports the throughput. It should be run as root
+ * and should not be included in the Kselftest run, it needs a DVB
+ * adapter whose demux takes its input from the DVR device.
+ *
+ * Each pid given with -p gets a TS filter whose output is drained
+ * from the demux while the file is written, the rest of the stream
+ * is dropped by the demux like it is during playback.
+ *
+ * Usage:
+ *	sudo ./dvb_demux_throughput -f <file.ts> [-a adapter] [-d demux]
+ *		[-p pid]... [-l loops]
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <linux/dvb/dmx.h>
+
+#define MAX_PIDS	16
+#define CHUNK_SIZE	(188 * 512)
+
+static char chunk[CHUNK_SIZE];
+static char drain[CHUNK_SIZE];
+
+static void usage(const char *prog)
+{
+	printf("Usage: %s -f <file.ts> [-a adapter] [-d demux] "
+		"[-p pid]... [-l loops]\n", prog);
+	exit(-1);
+}
+
+static double now_sec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv)
+{
+	int opt;
+	char file[256] = "";
+	char path[64];
+	int adapter = 0, demux = 0, loops = 1;
+	int pids[MAX_PIDS];
+	int pid_fds[MAX_PIDS];
+	int num_pids = 0;
+	unsigned long long total = 0;
+	double start, elapsed;
+	dmx_source_t source;
+	int dvr_fd, ts_fd;
+	int i, loop;
+	ssize_t len;
+
+	/* Process arguments */
+	while ((opt = getopt(argc, argv, "f:a:d:p:l:")) != -1) {
+		switch (opt) {
+		case 'f':
+			strncpy(file, optarg, sizeof(file) - 1);
+			file[sizeof(file) - 1] = '\0';
+			break;
+		case 'a':
+			adapter = atoi(optarg);
+			break;
+		case 'd':
+			demux = atoi(optarg);
+			break;
+		case 'p':
+			if (num_pids == MAX_PIDS) {
+				printf("At most %d pids\n", MAX_PIDS);
+				exit(-1);
+			}
+			pids[num_pids++] = strtol(optarg, NULL, 0);
+			break;
+		case 'l':
+			loops = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	if (!file[0] || loops < 1)
+		usage(argv[0]);
+
+	if (getuid() != 0) {
+		printf("Please run the test as root - Exiting.\n");
+		exit(-1);
+	}
+
+	snprintf(path, sizeof(path), "/dev/dvb/adapter%d/demux%d",
+		adapter, demux);
+	for (i = 0; i < num_pids; i++) {
+		struct dmx_pes_filter_params params;
+
+		pid_fds[i] = open(path, O_RDWR | O_NONBLOCK);
+		if (pid_fds[i] == -1) {
+			printf("Demux open errno %s\n", strerror(errno));
+			exit(-1);
+		}
+
+		source = DMX_SOURCE_DVR0 + demux;
+		if (ioctl(pid_fds[i], DMX_SET_SOURCE, &source) < 0) {
+			printf("DMX_SET_SOURCE errno %s\n", strerror(errno));
+			exit(-1);
+		}
+
+		memset(&params, 0, sizeof(params));
+		params.pid = pids[i];
+		params.input = DMX_IN_DVR;
+		params.output = DMX_OUT_TSDEMUX_TAP;
+		params.pes_type = DMX_PES_OTHER;
+		params.flags = DMX_IMMEDIATE_START;
+		if (ioctl(pid_fds[i], DMX_SET_PES_FILTER, &params) < 0) {
+			printf("DMX_SET_PES_FILTER pid %d errno %s\n",
+				pids[i], strerror(errno));
+			exit(-1);
+		}
+	}
+
+	snprintf(path, sizeof(path), "/dev/dvb/adapter%d/dvr%d",
+		adapter, demux);
+	dvr_fd = open(path, O_WRONLY);
+	if (dvr_fd == -1) {
+		printf("DVR open errno %s\n", strerror(errno));
+		exit(-1);
+	}
+
+	start = now_sec();
+	for (loop = 0; loop < loops; loop++) {
+		ts_fd = open(file, O_RDONLY);
+		if (ts_fd == -1) {
+			printf("TS file open errno %s\n", strerror(errno));
+			exit(-1);
+		}
+
+		/* Whole packets only, a short tail is dropped */
+		while ((len = read(ts_fd, chunk, sizeof(chunk))) >= 188) {
+			len -= len % 188;
+			if (write(dvr_fd, chunk, len) != len) {
+				printf("DVR write errno %s\n", strerror(errno));
+				exit(-1);
+			}
+			total += len;
+
+			for (i = 0; i < num_pids; i++)
+				while (read(pid_fds[i], drain,
+					    sizeof(drain)) > 0)
+					;
+		}
+
+		close(ts_fd);
+	}
+	elapsed = now_sec() - start;
+
+	printf("%llu bytes, %d pids, %.3f sec, %.1f Mbit/s\n",
+		total, num_pids, elapsed,
+		elapsed > 0 ? total * 8 / elapsed / 1e6 : 0.0);
+
+	close(dvr_fd);
+	for (i = 0; i < num_pids; i++)
+		close(pid_fds[i]);
+
+	return 0;
+}
@@ -0,0 +1,150 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Measure cross-thread wakeup latency.
+ *
+ * A waker thread stamps CLOCK_MONOTONIC and writes to a pipe, the sleeper
+ * stamps again once its read returns. The waker idles a little between
+ * rounds so the sleeper really blocks and every wakeup goes through task
+ * placement (and, on EAS systems, the energy estimation in
+ * find_best_target). Run on the kernels to compare and diff the output.
+ *
+ * With -r the sleeper runs SCHED_FIFO at the given priority, cyclictest
+ * style, which exercises the RT placement in rt_energy_aware_wake_cpu()
+ * instead of the fair class.
+ *
+ *	$ ./wakeup_latency [-n rounds] [-s sleep_us] [-r rt_prio]
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../kselftest.h"
+
+#define NSEC_PER_SEC	1000000000ULL
+
+static int wake_pipe[2];
+static unsigned long long *samples;
+static int rounds = 10000;
+static int sleep_us = 1000;
+static int rt_prio;
+
+static unsigned long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+static void *sleeper(void *arg)
+{
+	unsigned long long sent;
+	int i;
+
+	for (i = 0; i < rounds; i++) {
+		if (read(wake_pipe[0], &sent, sizeof(sent)) != sizeof(sent))
+			return (void *)-1L;
+		samples[i] = now_ns() - sent;
+	}
+
+	return NULL;
+}
+
+static int cmp_ull(const void *a, const void *b)
+{
+	unsigned long long x = *(const unsigned long long *)a;
+	unsigned long long y = *(const unsigned long long *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+int main(int argc, char **argv)
+{
+	struct timespec gap;
+	unsigned long long sum = 0, stamp;
+	pthread_attr_t attr;
+	pthread_t thread;
+	void *status;
+	int i, opt;
+
+	while ((opt = getopt(argc, argv, "n:s:r:")) != -1) {
+		switch (opt) {
+		case 'n':
+			rounds = atoi(optarg);
+			break;
+		case 's':
+			sleep_us = atoi(optarg);
+			break;
+		case 'r':
+			rt_prio = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr,
+				"usage: %s [-n rounds] [-s sleep_us] [-r rt_prio]\n",
+				argv[0]);
+			return ksft_exit_fail();
+		}
+	}
+
+	if (rounds <= 0 || sleep_us < 0 || rt_prio < 0 ||
+	    rt_prio > sched_get_priority_max(SCHED_FIFO)) {
+		fprintf(stderr, "invalid arguments\n");
+		return ksft_exit_fail();
+	}
+
+	samples = calloc(rounds, sizeof(*samples));
+	if (!samples || pipe(wake_pipe)) {
+		perror("setup");
+		return ksft_exit_fail();
+	}
+
+	pthread_attr_init(&attr);
+	if (rt_prio) {
+		struct sched_param param = { .sched_priority = rt_prio };
+
+		pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+		pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+		pthread_attr_setschedparam(&attr, &param);
+	}
+
+	if (pthread_create(&thread, &attr, sleeper, NULL)) {
+		perror("pthread_create");
+		return ksft_exit_fail();
+	}
+
+	gap.tv_sec = sleep_us / 1000000;
+	gap.tv_nsec = (sleep_us % 1000000) * 1000;
+
+	for (i = 0; i < rounds; i++) {
+		nanosleep(&gap, NULL);
+		stamp = now_ns();
+		if (write(wake_pipe[1], &stamp, sizeof(stamp)) != sizeof(stamp)) {
+			perror("write");
+			return ksft_exit_fail();
+		}
+	}
+
+	pthread_join(thread, &status);
+	if (status) {
+		fprintf(stderr, "sleeper failed: %s\n", strerror(errno));
+		return ksft_exit_fail();
+	}
+
+	qsort(samples, rounds, sizeof(*samples), cmp_ull);
+	for (i = 0; i < rounds; i++)
+		sum += samples[i];
+
+	printf("rounds %d sleep %dus %s\n", rounds, sleep_us,
+	       rt_prio ? "SCHED_FIFO" : "SCHED_OTHER");
+	printf("min %lluns avg %lluns p50 %lluns p99 %lluns max %lluns\n",
+	       samples[0], sum / rounds, samples[rounds / 2],
+	       samples[(rounds * 99) / 100], samples[rounds - 1]);
+
+	return ksft_exit_pass();
+}